@@ -0,0 +1,150 @@
+#!/bin/sh
+#
+# run-bench.sh - Run the emulation speed benchmarks (make bench).
+#
+# usage: run-bench.sh <build dir>
+#
+# Runs every emulator found in <build dir>/src headless over a fixed set of
+# workloads, each typed in as a BASIC program with -keybuf and timed with
+# -benchmark after the machine has booted.  One line per run is printed to
+# stdout:
+#
+#   BENCH: revision=<git revision> emulator=x64sc machine=C64 workload=basic
+#          cycles=... seconds=... cycles_per_second=... speed=...
+#
+# (on one line), so the results can be collected per commit.  Runs that fail
+# are reported as `workload=<name> failed' and make the script exit with 1.
+#
+# Environment:
+#   BENCH_CYCLES     cycles timed per run (default: 20000000)
+#   BENCH_EMULATORS  emulators to run (default: all listed below)
+#   BENCH_WORKLOADS  workloads to run (default: all listed below)
+#
+# Workloads, each run on the emulators that have the hardware for it:
+#
+#   basic   floating point BASIC loop                        all
+#   video   eight moving expanded sprites over a bitmap      C64, C128, SCPU64
+#           screen, border and background colour writes      VIC20, PLUS4
+#           screen memory fill                               PET
+#   sid     three SIDs playing with filters (reSID)          C64, C128, SCPU64
+#   drive   reading a file from a 1541 with true drive       C64, C128, SCPU64,
+#           emulation, using the KERNAL serial routines      VIC20, PLUS4
+#   reu     64 KiB REU stash and verify transfers            C64, C128, SCPU64
+
+BUILDDIR=${1:-.}
+EMUDIR=$BUILDDIR/src
+CYCLES=${BENCH_CYCLES:-20000000}
+EMULATORS=${BENCH_EMULATORS:-"x64 x64sc x128 xscpu64 xvic xplus4 xpet"}
+WORKLOADS=${BENCH_WORKLOADS:-"basic video sid drive reu"}
+
+SCRIPT_PATH=`dirname $0`
+REVISION=`cd $SCRIPT_PATH && git rev-parse --short HEAD 2>/dev/null`
+if [ x"$REVISION" = x ]; then
+    REVISION=unknown
+fi
+
+TMPDIR=`mktemp -d ${TMPDIR:-/tmp}/vicebench.XXXXXX` || exit 1
+trap 'rm -rf "$TMPDIR"' 0 1 2 15
+
+# keyboard input is lower case, which is upper case on the emulated machines
+
+BASIC_PRG='10 a=0:b=1.5\n20 for i=1 to 100:a=a+sin(i)*b/(i+1):a$=str$(a):next\n30 goto 20\nrun\n'
+
+VIDEO_VICII='10 v=53248:poke v+21,255:poke v+23,255:poke v+29,255:poke v+17,59\n20 for i=0 to 7:poke 2040+i,13:poke v+39+i,i+1:next\n30 for x=0 to 255:for i=0 to 14 step 2:poke v+i,x:poke v+i+1,50+i*8:next:poke v+32,x and 15:next:goto 30\nrun\n'
+VIDEO_VIC='10 for i=0 to 255:poke 36879,i:next:goto 10\nrun\n'
+VIDEO_TED='10 for i=0 to 127:poke 65305,i:poke 65301,i:next:goto 10\nrun\n'
+VIDEO_PET='10 for i=32768 to 33767:poke i,i and 255:next:goto 10\nrun\n'
+
+SID_PRG='10 for s=54272 to 54336 step 32\n20 poke s+5,9:poke s+6,240:poke s+12,9:poke s+13,240:poke s+19,9:poke s+20,240:poke s+3,8:poke s+4,65:poke s+11,33:poke s+18,17:poke s+23,247:poke s+24,31:next\n30 for f=0 to 255:for s=54272 to 54336 step 32:poke s+1,f:poke s+8,255-f:poke s+22,f:next:next:goto 30\nrun\n'
+
+DRIVE_PRG='10 open 2,8,2,"data,p,r"\n20 get#2,a$:if st=0 goto 20\n30 close 2:goto 10\nrun\n'
+
+REU_PRG='10 poke 57095,0:poke 57096,0:poke 57090,0:poke 57091,4\n20 for b=0 to 7:poke 57094,b:poke 57089,144:poke 57089,147:next:goto 20\nrun\n'
+
+# a disk with an 8 KiB file for the drive workload
+DISK=$TMPDIR/bench.d64
+if [ -x "$EMUDIR/c1541" ]; then
+    dd if=/dev/zero of="$TMPDIR/data" bs=1024 count=8 2>/dev/null
+    "$EMUDIR/c1541" -format "bench,01" d64 "$DISK" -write "$TMPDIR/data" data >/dev/null 2>&1 || DISK=
+else
+    DISK=
+fi
+
+FAILED=0
+
+run_workload()
+{
+    emu=$1
+    workload=$2
+    keybuf=$3
+    shift 3
+
+    out=`"$EMUDIR/$emu" -default -console -sounddev dummy -sound \
+            -benchmark $CYCLES -benchname $workload \
+            -keybuf "$keybuf" "$@" 2>/dev/null </dev/null | grep '^BENCH: '`
+    if [ x"$out" = x ]; then
+        echo "BENCH: revision=$REVISION emulator=$emu workload=$workload failed"
+        FAILED=1
+    else
+        echo "$out" | sed "s/^BENCH: /BENCH: revision=$REVISION emulator=$emu /"
+    fi
+}
+
+for emu in $EMULATORS; do
+    if [ ! -x "$EMUDIR/$emu" ]; then
+        continue
+    fi
+
+    case $emu in
+        x64|x64sc|x128|xscpu64)
+            family=c64
+            ;;
+        xvic)
+            family=vic20
+            ;;
+        xplus4)
+            family=plus4
+            ;;
+        xpet)
+            family=pet
+            ;;
+        *)
+            continue
+            ;;
+    esac
+
+    for workload in $WORKLOADS; do
+        case $workload/$family in
+            basic/*)
+                run_workload $emu basic "$BASIC_PRG"
+                ;;
+            video/c64)
+                run_workload $emu video "$VIDEO_VICII"
+                ;;
+            video/vic20)
+                run_workload $emu video "$VIDEO_VIC"
+                ;;
+            video/plus4)
+                run_workload $emu video "$VIDEO_TED"
+                ;;
+            video/pet)
+                run_workload $emu video "$VIDEO_PET"
+                ;;
+            sid/c64)
+                run_workload $emu sid "$SID_PRG" \
+                    -sidenginemodel resid -sidextra 2 -sid2address 0xd420 -sid3address 0xd440
+                ;;
+            drive/c64|drive/vic20|drive/plus4)
+                if [ x"$DISK" != x ]; then
+                    run_workload $emu drive "$DRIVE_PRG" \
+                        -drive8type 1541 -drive8truedrive -8 "$DISK"
+                fi
+                ;;
+            reu/c64)
+                run_workload $emu reu "$REU_PRG" -reu -reusize 512
+                ;;
+        esac
+    done
+done
+
+exit $FAILED
@@ -0,0 +1,143 @@
+#!/bin/sh
+#
+# run-pgo.sh - Profile-guided optimization build of the emulators (make pgo).
+#
+# usage: run-pgo.sh <build dir> <gcc|clang> [<llvm-profdata>]
+#
+# Builds the emulators three times in <build dir>, each time from a clean
+# src directory:
+#
+#   1. as configured, and runs the benchmarks (run-bench.sh) for reference
+#   2. with -fprofile-generate, and runs the benchmarks to train the profile
+#   3. with -fprofile-use, and runs the benchmarks again
+#
+# and prints the speed of every benchmark before and after:
+#
+#   PGO: emulator=x64sc workload=basic before=... after=... gain=+12.3%
+#
+# (cycles per second).  The profile is kept in <build dir>/pgo-data together
+# with the output of the benchmark runs.  The emulators left in <build dir>
+# are the optimized ones; `make clean' gets back to a normal build.
+#
+# Environment:
+#   MAKE             make program (set by make)
+#   PGO_BASELINE     set to `no' to skip step 1 and the comparison
+#   PGO_TRAIN_CYCLES cycles per training run (default: BENCH_CYCLES)
+#
+# BENCH_CYCLES, BENCH_EMULATORS and BENCH_WORKLOADS are used as in
+# run-bench.sh, for all three runs.
+
+BUILDDIR=${1:-.}
+COMPILER=$2
+LLVM_PROFDATA=${3:-llvm-profdata}
+MAKE=${MAKE:-make}
+
+SCRIPT_PATH=`dirname $0`
+BUILDDIR=`cd "$BUILDDIR" && pwd`
+PGODIR=$BUILDDIR/pgo-data
+
+# the flags the tree was configured with, extended per stage
+CFLAGS=`sed -n 's/^CFLAGS = //p' "$BUILDDIR/src/Makefile"`
+CXXFLAGS=`sed -n 's/^CXXFLAGS = //p' "$BUILDDIR/src/Makefile"`
+LDFLAGS=`sed -n 's/^LDFLAGS = //p' "$BUILDDIR/src/Makefile"`
+
+case $COMPILER in
+    gcc)
+        # The drive, sound and UI threads update the counters too; atomic
+        # updates keep them exact where the target has cheap atomics.
+        GENERATE_FLAGS="-fprofile-generate=$PGODIR -fprofile-update=prefer-atomic"
+        USE_FLAGS="-fprofile-use=$PGODIR -fprofile-correction -Wno-missing-profile"
+        ;;
+    clang)
+        GENERATE_FLAGS="-fprofile-generate=$PGODIR"
+        USE_FLAGS="-fprofile-use=$PGODIR/vice.profdata -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date"
+        ;;
+    *)
+        echo "run-pgo.sh: unknown compiler \`$COMPILER'" >&2
+        exit 1
+        ;;
+esac
+
+build()
+{
+    stage=$1
+    flags=$2
+
+    echo "PGO: building ($stage)"
+    $MAKE -C "$BUILDDIR/src" clean >/dev/null || exit 1
+    $MAKE -C "$BUILDDIR" \
+        CFLAGS="$CFLAGS $flags" CXXFLAGS="$CXXFLAGS $flags" LDFLAGS="$LDFLAGS $flags" \
+        >"$PGODIR/build-$stage.log" 2>&1
+    if [ $? -ne 0 ]; then
+        echo "PGO: build failed, see $PGODIR/build-$stage.log" >&2
+        exit 1
+    fi
+}
+
+bench()
+{
+    stage=$1
+
+    echo "PGO: running the benchmarks ($stage)"
+    sh "$SCRIPT_PATH/run-bench.sh" "$BUILDDIR" >"$PGODIR/bench-$stage.txt"
+    if [ $? -ne 0 ]; then
+        echo "PGO: some benchmarks failed, see $PGODIR/bench-$stage.txt" >&2
+    fi
+}
+
+rm -rf "$PGODIR"
+mkdir -p "$PGODIR" || exit 1
+
+if [ x"$PGO_BASELINE" != "xno" ]; then
+    build baseline ""
+    bench baseline
+fi
+
+build generate "$GENERATE_FLAGS"
+BENCH_CYCLES=${PGO_TRAIN_CYCLES:-$BENCH_CYCLES} bench train
+
+if [ x"$COMPILER" = "xclang" ]; then
+    "$LLVM_PROFDATA" merge -output="$PGODIR/vice.profdata" "$PGODIR"/*.profraw || exit 1
+fi
+
+build use "$USE_FLAGS"
+bench use
+
+if [ x"$PGO_BASELINE" = "xno" ]; then
+    grep '^BENCH: ' "$PGODIR/bench-use.txt"
+    exit 0
+fi
+
+# match the runs by emulator and workload
+awk '
+    /^BENCH: / {
+        emu = ""; workload = ""; cps = ""
+        for (i = 2; i <= NF; i++) {
+            split($i, kv, "=")
+            if (kv[1] == "emulator") emu = kv[2]
+            if (kv[1] == "workload") workload = kv[2]
+            if (kv[1] == "cycles_per_second") cps = kv[2]
+        }
+        key = emu " " workload
+        if (FILENAME == ARGV[1]) {
+            order[n++] = key
+            before[key] = cps
+        } else {
+            after[key] = cps
+        }
+    }
+    END {
+        for (i = 0; i < n; i++) {
+            key = order[i]
+            split(key, k, " ")
+            if (before[key] == "" || after[key] == "") {
+                printf "PGO: emulator=%s workload=%s before=%s after=%s\n", k[1], k[2],
+                       before[key] == "" ? "failed" : before[key],
+                       after[key] == "" ? "failed" : after[key]
+                continue
+            }
+            printf "PGO: emulator=%s workload=%s before=%s after=%s gain=%+.1f%%\n",
+                   k[1], k[2], before[key], after[key],
+                   (after[key] / before[key] - 1) * 100
+        }
+    }' "$PGODIR/bench-baseline.txt" "$PGODIR/bench-use.txt"
@@ -0,0 +1,87 @@
+#version 150
+
+// PAL CRT emulation on the palette indices of the draw buffer, the same
+// integer arithmetic as render1x1pal.c and render2x2pal.c: luma blur,
+// chroma blur with the delay line, odd line phase and the scanlines.
+
+uniform usampler2D this_frame;      // palette indices
+uniform isampler2D color_table;     // ytableh, ytablel, cbtable, crtable; row 1 for odd lines
+uniform sampler2D gamma_table;      // row 0 gamma, rows 1 and 2 scanline gamma
+uniform int first_line;             // draw buffer line of the first row
+uniform int oddlines_offset;
+uniform bool double_size;
+
+in vec2 tex_coord;
+out vec4 output_color;
+
+ivec2 frame_size;
+
+int pixel(int x, int y)
+{
+    return int(texelFetch(this_frame, ivec2(clamp(x, 0, frame_size.x - 1), y), 0).r);
+}
+
+ivec4 colors(int index, int odd)
+{
+    return texelFetch(color_table, ivec2(index, odd), 0);
+}
+
+ivec2 chroma(int x, int y, int odd)
+{
+    return colors(pixel(x - 2, y), odd).zw
+         + colors(pixel(x - 1, y), odd).zw
+         + colors(pixel(x,     y), odd).zw
+         + colors(pixel(x + 1, y), odd).zw;
+}
+
+ivec3 yuv(int x, int y)
+{
+    int line = first_line + y;
+    int odd = line & 1;
+    int off_flip = odd != 0 ? oddlines_offset : 32;
+    int l = colors(pixel(x - 1, y), 0).y + colors(pixel(x, y), 0).x + colors(pixel(x + 1, y), 0).y;
+    ivec2 uv = (chroma(x, y, odd) + chroma(x, max(y - 1, 0), odd ^ 1)) * off_flip;
+
+    return ivec3(l, uv);
+}
+
+ivec3 rgb(int x, int y, bool interpolate)
+{
+    ivec3 c = yuv(x, y);
+
+    if (interpolate) {
+        c = (c + yuv(x + 1, y)) >> 1;
+    }
+
+    return ivec3((c.x + c.z) >> 16,
+                 (c.x - ((50 * c.y + 130 * c.z) >> 8)) >> 16,
+                 (c.x + c.y) >> 16);
+}
+
+vec4 gamma(int index, int row, int entries)
+{
+    index = clamp(index, 0, entries - 1);
+    return texelFetch(gamma_table, ivec2(index % 768, row + index / 768), 0);
+}
+
+void main()
+{
+    vec2 pos;
+    ivec2 p;
+    ivec3 c;
+    bool right;
+
+    frame_size = textureSize(this_frame, 0);
+    pos = tex_coord * vec2(frame_size);
+    p = clamp(ivec2(pos), ivec2(0), frame_size - 1);
+    right = double_size && fract(pos.x) >= 0.5;
+    c = rgb(p.x, p.y, right);
+
+    if (double_size && fract(pos.y) >= 0.5) {
+        c += rgb(p.x, min(p.y + 1, frame_size.y - 1), right) + 512;
+        output_color = vec4(gamma(c.r, 1, 1536).r, gamma(c.g, 1, 1536).g, gamma(c.b, 1, 1536).b, 1.0);
+    } else {
+        c += 256;
+        output_color = vec4(gamma(c.r, 0, 768).r, gamma(c.g, 0, 768).g, gamma(c.b, 0, 768).b, 1.0);
+    }
+}
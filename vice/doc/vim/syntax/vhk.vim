@@ -74,6 +74,7 @@ syn match vhkActionName "\<help-hotkeys\>"
 syn match vhkActionName "\<help-manual\>"
 syn match vhkActionName "\<history-milestone-reset\>"
 syn match vhkActionName "\<history-milestone-set\>"
+syn match vhkActionName "\<history-playback-seek-\(back\|forward\)\>"
 syn match vhkActionName "\<history-playback-start\>"
 syn match vhkActionName "\<history-playback-stop\>"
 syn match vhkActionName "\<history-record-start\>"
@@ -39,6 +39,74 @@
     drivecpu.c
 */
 
+/* The including file may include this file a second time with CPU_HOOKS
+   defined to 0 and a different TRAP_SKIPPED_LABEL, to get a copy of the
+   core without the monitor, profiler and trace hooks.  That copy must only
+   run while none of them is active.  cpu_is_jammed must then be declared
+   by the including file (CPU_IS_JAMMED_DECLARED), so both copies share it.  */
+#ifndef CPU_HOOKS
+#define CPU_HOOKS 1
+#endif
+
+#ifndef TRAP_SKIPPED_LABEL
+#define TRAP_SKIPPED_LABEL trap_skipped
+#endif
+
+/* The CPU history and memmap of the monitor are only collected by the copy
+   with hooks, and only while monitor_cpuhistory_enabled is set, so the
+   including file must run that copy whenever it is.  The macro is looked
+   at where it is used, so both copies can share the definition.  */
+#ifndef CPU_HISTORY_ACTIVE
+#ifdef FEATURE_CPUMEMHISTORY
+#define CPU_HISTORY_ACTIVE() (CPU_HOOKS && monitor_cpuhistory_enabled)
+#else
+#define CPU_HISTORY_ACTIVE() 0
+#endif
+#endif
+
+/* If the including file defines CPU_BLOCK_CHAIN, the copy without hooks
+   runs up to CPU_BLOCK_CHAIN_MAX instructions per call, going straight
+   from one to the next as long as no interrupt is pending, no alarm is
+   due and CPU_BLOCK_CHAIN_ALLOWED() holds.  The checks at the top of this
+   file would do nothing for those instructions anyway, so the emulation
+   is the same; only the per-instruction work of the including file runs
+   less often.  */
+#if defined(CPU_BLOCK_CHAIN) && !CPU_HOOKS
+#define CPU_BLOCK_CHAIN_ACTIVE
+#ifndef CPU_BLOCK_CHAIN_MAX
+#define CPU_BLOCK_CHAIN_MAX 64
+#endif
+#else
+#undef CPU_BLOCK_CHAIN_ACTIVE
+#endif
+
+/* If the including file defines CPU_EVENT_CLK, the alarms are dispatched
+   and the interrupt state is looked at only once CLK reaches
+   `next_event_clk' of the interrupt status, which the interrupt, trap,
+   DMA and monitor setters lower to 0 and alarm_set() lowers to the clock
+   of the alarm.  The alarm context must point its `event_clk' at it.  When
+   nothing happens, an instruction then costs one compare instead of the
+   checks of the alarm clock and of every interrupt kind.  */
+
+/* With --enable-threaded-dispatch, GCC compatible compilers jump to the
+   opcode handlers through a table of label addresses instead of the
+   switch.  GCC assumes a computed goto may land on any label whose address
+   is taken in the function, so when the core is included twice only one
+   copy may use it; the other one defines CPU_SWITCH_DISPATCH.  */
+#undef CPU_THREADED_DISPATCH
+#undef OPCODE_CASE
+#if defined(USE_THREADED_DISPATCH) && defined(__GNUC__) && !defined(CPU_SWITCH_DISPATCH)
+#define CPU_THREADED_DISPATCH
+#define OPCODE_CASE(n) case n: opcode_##n
+#define OPCODE_DISPATCH_ROW(h)                                                 \
+    &&opcode_##h##0, &&opcode_##h##1, &&opcode_##h##2, &&opcode_##h##3,        \
+    &&opcode_##h##4, &&opcode_##h##5, &&opcode_##h##6, &&opcode_##h##7,        \
+    &&opcode_##h##8, &&opcode_##h##9, &&opcode_##h##a, &&opcode_##h##b,        \
+    &&opcode_##h##c, &&opcode_##h##d, &&opcode_##h##e, &&opcode_##h##f
+#else
+#define OPCODE_CASE(n) case n
+#endif
+
 #ifdef DRIVE_CPU
 #define CPU_STR "Drive CPU"
 #else
@@ -394,26 +462,33 @@ do {                                                                   \
 #define CHECK_PROFILE_RTI()
 #endif
 
+/* Edge coverage for fuzzing, see cpucoverage.h.  */
+#if defined(USE_CPU_COVERAGE) && !defined(DRIVE_CPU)
+#define CPU_COVERAGE_EDGE(dest_addr) CPUCOVERAGE_EDGE(dest_addr)
+#else
+#define CPU_COVERAGE_EDGE(dest_addr)
+#endif
+
 #ifdef DEBUG
 #define TRACE_NMI(clk)                        \
     do {                                      \
-        if (TRACEFLG) {                       \
+        if (CPU_HOOKS && TRACEFLG) {          \
             debug_nmi(CPU_INT_STATUS, (clk)); \
         }                                     \
     } while (0)
 
 #define TRACE_IRQ(clk)                        \
     do {                                      \
-        if (TRACEFLG) {                       \
+        if (CPU_HOOKS && TRACEFLG) {          \
             debug_irq(CPU_INT_STATUS, (clk)); \
         }                                     \
     } while (0)
 
-#define TRACE_BRK()                \
-    do {                           \
-        if (TRACEFLG) {            \
-            debug_text("*** BRK"); \
-        }                          \
+#define TRACE_BRK()                  \
+    do {                             \
+        if (CPU_HOOKS && TRACEFLG) { \
+            debug_text("*** BRK");   \
+        }                            \
     } while (0)
 #else
 #define TRACE_NMI(clk)
@@ -435,7 +510,7 @@ do {                                                                   \
                 || ((ik & (IK_IRQ | IK_IRQPEND)) && (!LOCAL_INTERRUPT()                        \
                                                      || OPINFO_DISABLES_IRQ(LAST_OPCODE_INFO)) \
                     && interrupt_check_irq_delay(CPU_INT_STATUS, CLK))) {                      \
-                if (monitor_mask[CALLER] & (MI_STEP)) {                                        \
+                if (CPU_HOOKS && (monitor_mask[CALLER] & (MI_STEP))) {                         \
                     monitor_check_icount_interrupt();                                          \
                 }                                                                              \
                 if (NMI_CYCLES == 7) {                                                         \
@@ -949,6 +1024,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
             } else {                                                      \
                 OPCODE_DELAYS_INTERRUPT();                                \
             }                                                             \
+            CPU_COVERAGE_EDGE(dest_addr & 0xffff);                        \
             JUMP(dest_addr & 0xffff);                                     \
         }                                                                 \
     } while (0)
@@ -971,7 +1047,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
             && (CLK >= (CPU_INT_STATUS->nmi_clk + INTERRUPT_DELAY))) {                            \
             LOCAL_SET_INTERRUPT(1);                                                               \
             TRACE_NMI(CLK - CLK_BRK);                                                             \
-            if (monitor_mask[CALLER] & (MI_STEP)) {                                               \
+            if (CPU_HOOKS && (monitor_mask[CALLER] & (MI_STEP))) {                                \
                 monitor_check_icount_interrupt();                                                 \
             }                                                                                     \
             interrupt_ack_nmi(CPU_INT_STATUS);                                                    \
@@ -980,7 +1056,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
                  && !LOCAL_INTERRUPT() && (CLK >= (CPU_INT_STATUS->irq_clk + INTERRUPT_DELAY))) { \
             LOCAL_SET_INTERRUPT(1);                                                               \
             TRACE_IRQ(CLK - CLK_BRK);                                                             \
-            if (monitor_mask[CALLER] & (MI_STEP)) {                                               \
+            if (CPU_HOOKS && (monitor_mask[CALLER] & (MI_STEP))) {                                \
                 monitor_check_icount_interrupt();                                                 \
             }                                                                                     \
             interrupt_ack_irq(CPU_INT_STATUS);                                                    \
@@ -1211,16 +1287,17 @@ FIXME: perhaps we really have to add some randomness to (some) bits
                 REWIND_FETCH_OPCODE(CLK);                                                \
                 SET_OPCODE(trap_result);                                                 \
                 IMPORT_REGISTERS();                                                      \
-                goto trap_skipped;                                                       \
+                goto TRAP_SKIPPED_LABEL;                                                 \
             } else {                                                                     \
                 IMPORT_REGISTERS();                                                      \
             }                                                                            \
         }                                                                                \
     } while (0)
 
-#define JMP(addr)   \
-    do {            \
-        JUMP(addr); \
+#define JMP(addr)                \
+    do {                         \
+        CPU_COVERAGE_EDGE(addr); \
+        JUMP(addr);              \
     } while (0)
 
 #define JMP_IND()                                                    \
@@ -1230,12 +1307,18 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         CLK_ADD(CLK, 1);                                             \
         dest_addr |= (LOAD((p2 & 0xff00) | ((p2 + 1) & 0xff)) << 8); \
         CLK_ADD(CLK, 1);                                             \
+        CPU_COVERAGE_EDGE(dest_addr);                                \
         JUMP(dest_addr);                                             \
     } while (0)
 
 /* HACK: fix JSR MSB in monitor CPU history */
 #if defined(FEATURE_CPUMEMHISTORY) && !defined(DRIVE_CPU)
-#define JSR_FIXUP_MSB(x)    monitor_cpuhistory_fix_p2(x)
+#define JSR_FIXUP_MSB(x)                  \
+    do {                                  \
+        if (CPU_HISTORY_ACTIVE()) {       \
+            monitor_cpuhistory_fix_p2(x); \
+        }                                 \
+    } while (0)
 #else
 #define JSR_FIXUP_MSB(x)
 #endif
@@ -1256,6 +1339,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         tmp_addr = (p1 | (addr_msb << 8));            \
         CLK_ADD(CLK, CLK_JSR_INT_CYCLE);              \
         CHECK_PROFILE_JSR(tmp_addr);                  \
+        CPU_COVERAGE_EDGE(tmp_addr);                  \
         JUMP(tmp_addr);                               \
     } while (0)
 
@@ -1605,6 +1689,7 @@ FIXME: perhaps we really have to add some randomness to (some) bits
         FETCH_PARAM(reg_pc);         \
         CLK_ADD(CLK, CLK_INT_CYCLE); \
         INC_PC(1);                   \
+        CPU_COVERAGE_EDGE(reg_pc);   \
     } while (0)
 
 #define SAX(addr, clk_inc1, clk_inc2, pc_inc) \
@@ -2205,11 +2290,16 @@ static const uint8_t rewind_fetch_tab[] = {
 /* Here, the CPU is emulated. */
 
 {
+#ifndef CPU_IS_JAMMED_DECLARED
     static int cpu_is_jammed = 0;
+#endif
     unsigned int tmpa; /* needed for some of the opcode macros */
 #if !defined(DRIVE_CPU)
     CLOCK profiling_clock_start;
 #endif
+#ifdef CPU_BLOCK_CHAIN_ACTIVE
+    unsigned int block_chain_left = CPU_BLOCK_CHAIN_MAX;
+#endif
 
     /* handle 8502 fast mode refresh cycles */
     CPU_REFRESH_CLK
@@ -2221,43 +2311,57 @@ static const uint8_t rewind_fetch_tab[] = {
 
     CPU_DELAY_CLK
 
-    PROCESS_ALARMS
-
-    /* HACK: when the CPU is jammed, no interrupts are served, the only way
-       to recover is reset. so we clear the interrupt flags and force
-       acknowledging them here in this case. */
-    if (cpu_is_jammed) {
-        interrupt_ack_irq(CPU_INT_STATUS);
-        CPU_INT_STATUS->global_pending_int &= ~(IK_IRQ | IK_NMI);
-        if (CPU_INT_STATUS->global_pending_int & IK_RESET) {
-            cpu_is_jammed = 0;
-        }
-    }
-
+#ifdef CPU_EVENT_CLK
+    if (CLK >= CPU_INT_STATUS->next_event_clk) {
+#else
     {
-        enum cpu_int pending_interrupt;
+#endif
+        PROCESS_ALARMS
 
-        if (!(CPU_INT_STATUS->global_pending_int & IK_IRQ)
-            && (CPU_INT_STATUS->global_pending_int & IK_IRQPEND)
-            && CPU_INT_STATUS->irq_pending_clk <= CLK) {
+        /* HACK: when the CPU is jammed, no interrupts are served, the only way
+           to recover is reset. so we clear the interrupt flags and force
+           acknowledging them here in this case. */
+        if (cpu_is_jammed) {
             interrupt_ack_irq(CPU_INT_STATUS);
+            CPU_INT_STATUS->global_pending_int &= ~(IK_IRQ | IK_NMI);
+            if (CPU_INT_STATUS->global_pending_int & IK_RESET) {
+                cpu_is_jammed = 0;
+            }
         }
 
-        pending_interrupt = CPU_INT_STATUS->global_pending_int;
-        if (pending_interrupt != IK_NONE) {
+        {
+            enum cpu_int pending_interrupt;
+
+            if (!(CPU_INT_STATUS->global_pending_int & IK_IRQ)
+                && (CPU_INT_STATUS->global_pending_int & IK_IRQPEND)
+                && CPU_INT_STATUS->irq_pending_clk <= CLK) {
+                interrupt_ack_irq(CPU_INT_STATUS);
+            }
+
+            pending_interrupt = CPU_INT_STATUS->global_pending_int;
+            if (pending_interrupt != IK_NONE) {
 #if !defined(DRIVE_CPU)
-            profiling_clock_start = CLK;
+                profiling_clock_start = CLK;
 #endif
 
-            DO_INTERRUPT(pending_interrupt);
-            if (!(CPU_INT_STATUS->global_pending_int & IK_IRQ)
-                && CPU_INT_STATUS->global_pending_int & IK_IRQPEND) {
-                CPU_INT_STATUS->global_pending_int &= ~IK_IRQPEND;
+                DO_INTERRUPT(pending_interrupt);
+                if (!(CPU_INT_STATUS->global_pending_int & IK_IRQ)
+                    && CPU_INT_STATUS->global_pending_int & IK_IRQPEND) {
+                    CPU_INT_STATUS->global_pending_int &= ~IK_IRQPEND;
+                }
+                CPU_DELAY_CLK
+
+                PROCESS_ALARMS
             }
-            CPU_DELAY_CLK
+        }
 
-            PROCESS_ALARMS
+#ifdef CPU_EVENT_CLK
+        if (CPU_INT_STATUS->global_pending_int != IK_NONE || cpu_is_jammed) {
+            CPU_INT_STATUS->next_event_clk = 0;
+        } else {
+            CPU_INT_STATUS->next_event_clk = alarm_context_next_pending_clk(ALARM_CONTEXT);
         }
+#endif
     }
 
     {
@@ -2275,15 +2379,20 @@ static const uint8_t rewind_fetch_tab[] = {
         CLOCK history_clk;
 #ifndef DRIVE_CPU
         history_clk = maincpu_clk;
-        memmap_state |= (MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        if (CPU_HISTORY_ACTIVE()) {
+            memmap_state |= (MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        }
 #else
         history_clk = CLK;
 #endif
 #endif
 
+#ifdef CPU_BLOCK_CHAIN_ACTIVE
+block_chain_next:
+#endif
 #if !defined(DRIVE_CPU)
         profiling_clock_start = CLK;
-        if (maincpu_profiling) {
+        if (CPU_HOOKS && maincpu_profiling) {
             profile_sample_start(reg_pc);
         }
 #endif
@@ -2293,26 +2402,28 @@ static const uint8_t rewind_fetch_tab[] = {
         FETCH_OPCODE(opcode);
 
 #ifdef FEATURE_CPUMEMHISTORY
+        if (CPU_HISTORY_ACTIVE()) {
 #ifndef DRIVE_CPU
 #ifndef C64DTV
-        /* HACK to cope with FETCH_OPCODE optimization in x64 */
-        if (((int)reg_pc) < bank_limit) {
-            memmap_mark_read(reg_pc);
-        }
+            /* HACK to cope with FETCH_OPCODE optimization in x64 */
+            if (((int)reg_pc) < bank_limit) {
+                memmap_mark_read(reg_pc);
+            }
 #endif
 #endif
-        /* If reg_pc >= bank_limit  then JSR (0x20) hasn't load p2 yet.
-           The earlier LOAD(reg_pc+2) hack can break stealing badly.
-           The fixing is now handled in JSR(). */
-        monitor_cpuhistory_store(history_clk, reg_pc, p0, p1, p2 >> 8, reg_a_read, reg_x_read, reg_y_read, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
+            /* If reg_pc >= bank_limit  then JSR (0x20) hasn't load p2 yet.
+               The earlier LOAD(reg_pc+2) hack can break stealing badly.
+               The fixing is now handled in JSR(). */
+            monitor_cpuhistory_store(history_clk, reg_pc, p0, p1, p2 >> 8, reg_a_read, reg_x_read, reg_y_read, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
 #ifndef DRIVE_CPU
-        memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+            memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
 #endif
+        }
 #endif
 
 #ifdef DEBUG
 #ifdef DRIVE_CPU
-        if (TRACEFLG) {
+        if (CPU_HOOKS && TRACEFLG) {
             uint8_t op = (uint8_t)(p0);
             uint8_t lo = (uint8_t)(p1);
             uint8_t hi = (uint8_t)(p2 >> 8);
@@ -2324,7 +2435,7 @@ static const uint8_t rewind_fetch_tab[] = {
                         reg_a_read, reg_x_read, reg_y_read, reg_sp, drv->mynumber + 8);
         }
 #else
-        if (TRACEFLG) {
+        if (CPU_HOOKS && TRACEFLG) {
             uint8_t op = (uint8_t)(p0);
             uint8_t lo = (uint8_t)(p1);
             uint8_t hi = (uint8_t)(p2 >> 8);
@@ -2346,35 +2457,53 @@ static const uint8_t rewind_fetch_tab[] = {
 #endif
 #endif
 
-trap_skipped:
+TRAP_SKIPPED_LABEL:
         SET_LAST_OPCODE(p0);
 
+#ifdef CPU_THREADED_DISPATCH
+        {
+            static void * const opcode_dispatch[0x100] = {
+                OPCODE_DISPATCH_ROW(0x0), OPCODE_DISPATCH_ROW(0x1),
+                OPCODE_DISPATCH_ROW(0x2), OPCODE_DISPATCH_ROW(0x3),
+                OPCODE_DISPATCH_ROW(0x4), OPCODE_DISPATCH_ROW(0x5),
+                OPCODE_DISPATCH_ROW(0x6), OPCODE_DISPATCH_ROW(0x7),
+                OPCODE_DISPATCH_ROW(0x8), OPCODE_DISPATCH_ROW(0x9),
+                OPCODE_DISPATCH_ROW(0xa), OPCODE_DISPATCH_ROW(0xb),
+                OPCODE_DISPATCH_ROW(0xc), OPCODE_DISPATCH_ROW(0xd),
+                OPCODE_DISPATCH_ROW(0xe), OPCODE_DISPATCH_ROW(0xf)
+            };
+
+            /* jumps right into the switch below */
+            goto *opcode_dispatch[p0 & 0xff];
+        }
+#endif
+
         switch (p0) {
-            case 0x00:          /* BRK */
+            OPCODE_CASE(0x00):          /* BRK */
                 BRK();
                 break;
 
-            case 0x01:          /* ORA ($nn,X) */
+            OPCODE_CASE(0x01):          /* ORA ($nn,X) */
                 ORA(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0x02:          /* JAM - also used for traps */
+            OPCODE_CASE(0x02):          /* JAM - also used for traps */
                 STATIC_ASSERT(TRAP_OPCODE == 0x02);
                 JAM_02();
                 break;
 
-            case 0x22:          /* JAM */
-            case 0x52:          /* JAM */
-            case 0x62:          /* JAM */
-            case 0x72:          /* JAM */
-            case 0x92:          /* JAM */
-            case 0xb2:          /* JAM */
-            case 0xd2:          /* JAM */
-            case 0xf2:          /* JAM */
+            OPCODE_CASE(0x22):          /* JAM */
+            OPCODE_CASE(0x52):          /* JAM */
+            OPCODE_CASE(0x62):          /* JAM */
+            OPCODE_CASE(0x72):          /* JAM */
+            OPCODE_CASE(0x92):          /* JAM */
+            OPCODE_CASE(0xb2):          /* JAM */
+            OPCODE_CASE(0xd2):          /* JAM */
+            OPCODE_CASE(0xf2):          /* JAM */
 #ifndef C64DTV
-            case 0x12:          /* JAM */
-            case 0x32:          /* JAM */
-            case 0x42:          /* JAM */
+            OPCODE_CASE(0x12):          /* JAM */
+            OPCODE_CASE(0x32):          /* JAM */
+            OPCODE_CASE(0x42):          /* JAM */
 #endif
                 cpu_is_jammed = 1;
                 REWIND_FETCH_OPCODE(CLK);
@@ -2383,44 +2512,44 @@ trap_skipped:
 
 #ifdef C64DTV
             /* These opcodes are defined in c64/c64dtvcpu.c */
-            case 0x12:          /* BRA */
+            OPCODE_CASE(0x12):          /* BRA */
                 BRANCH(1, p1);
                 break;
 
-            case 0x32:          /* SAC */
+            OPCODE_CASE(0x32):          /* SAC */
                 SAC(p1);
                 break;
 
-            case 0x42:          /* SIR */
+            OPCODE_CASE(0x42):          /* SIR */
                 SIR(p1);
                 break;
 #endif
 
-            case 0x03:          /* SLO ($nn,X) */
+            OPCODE_CASE(0x03):          /* SLO ($nn,X) */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 SLO(LOAD_ZERO_ADDR(p1 + reg_x_read), 2, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x04:          /* NOOP $nn */
-            case 0x44:          /* NOOP $nn */
-            case 0x64:          /* NOOP $nn */
+            OPCODE_CASE(0x04):          /* NOOP $nn */
+            OPCODE_CASE(0x44):          /* NOOP $nn */
+            OPCODE_CASE(0x64):          /* NOOP $nn */
                 NOOP(1, 2);
                 break;
 
-            case 0x05:          /* ORA $nn */
+            OPCODE_CASE(0x05):          /* ORA $nn */
                 ORA(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0x06:          /* ASL $nn */
+            OPCODE_CASE(0x06):          /* ASL $nn */
                 ASL(p1, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x07:          /* SLO $nn */
+            OPCODE_CASE(0x07):          /* SLO $nn */
                 SLO(p1, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x08:          /* PHP */
+            OPCODE_CASE(0x08):          /* PHP */
 #ifdef DRIVE_CPU
                 drivecpu_rotate();
                 if (drivecpu_byte_ready()) {
@@ -2431,283 +2560,283 @@ trap_skipped:
                 PHP();
                 break;
 
-            case 0x09:          /* ORA #$nn */
+            OPCODE_CASE(0x09):          /* ORA #$nn */
                 ORA(p1, 0, 2);
                 break;
 
-            case 0x0a:          /* ASL A */
+            OPCODE_CASE(0x0a):          /* ASL A */
                 ASL_A();
                 break;
 
-            case 0x0b:          /* ANC #$nn */
-            case 0x2b:          /* ANC #$nn */
+            OPCODE_CASE(0x0b):          /* ANC #$nn */
+            OPCODE_CASE(0x2b):          /* ANC #$nn */
                 ANC(p1, 2);
                 break;
 
-            case 0x0c:          /* NOOP $nnnn */
+            OPCODE_CASE(0x0c):          /* NOOP $nnnn */
                 NOOP_ABS();
                 break;
 
-            case 0x0d:          /* ORA $nnnn */
+            OPCODE_CASE(0x0d):          /* ORA $nnnn */
                 ORA(LOAD(p2), 1, 3);
                 break;
 
-            case 0x0e:          /* ASL $nnnn */
+            OPCODE_CASE(0x0e):          /* ASL $nnnn */
                 ASL(p2, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x0f:          /* SLO $nnnn */
+            OPCODE_CASE(0x0f):          /* SLO $nnnn */
                 SLO(p2, 0, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x10:          /* BPL $nnnn */
+            OPCODE_CASE(0x10):          /* BPL $nnnn */
                 BRANCH(!LOCAL_SIGN(), p1);
                 break;
 
-            case 0x11:          /* ORA ($nn),Y */
+            OPCODE_CASE(0x11):          /* ORA ($nn),Y */
                 ORA(LOAD_IND_Y(p1), 1, 2);
                 break;
 
-            case 0x13:          /* SLO ($nn),Y */
+            OPCODE_CASE(0x13):          /* SLO ($nn),Y */
                 SLO_IND_Y(p1);
                 break;
 
-            case 0x14:          /* NOOP $nn,X */
-            case 0x34:          /* NOOP $nn,X */
-            case 0x54:          /* NOOP $nn,X */
-            case 0x74:          /* NOOP $nn,X */
-            case 0xd4:          /* NOOP $nn,X */
-            case 0xf4:          /* NOOP $nn,X */
+            OPCODE_CASE(0x14):          /* NOOP $nn,X */
+            OPCODE_CASE(0x34):          /* NOOP $nn,X */
+            OPCODE_CASE(0x54):          /* NOOP $nn,X */
+            OPCODE_CASE(0x74):          /* NOOP $nn,X */
+            OPCODE_CASE(0xd4):          /* NOOP $nn,X */
+            OPCODE_CASE(0xf4):          /* NOOP $nn,X */
                 NOOP((NOOP_LOAD_ZERO_X(p1), CLK_NOOP_ZERO_X), 2);
                 break;
 
-            case 0x15:          /* ORA $nn,X */
+            OPCODE_CASE(0x15):          /* ORA $nn,X */
                 ORA(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0x16:          /* ASL $nn,X */
+            OPCODE_CASE(0x16):          /* ASL $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 ASL((p1 + reg_x_read) & 0xff, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x17:          /* SLO $nn,X */
+            OPCODE_CASE(0x17):          /* SLO $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 SLO((p1 + reg_x_read) & 0xff, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x18:          /* CLC */
+            OPCODE_CASE(0x18):          /* CLC */
                 CLC();
                 break;
 
-            case 0x19:          /* ORA $nnnn,Y */
+            OPCODE_CASE(0x19):          /* ORA $nnnn,Y */
                 ORA(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0x1a:          /* NOOP */
-            case 0x3a:          /* NOOP */
-            case 0x5a:          /* NOOP */
-            case 0x7a:          /* NOOP */
-            case 0xda:          /* NOOP */
-            case 0xfa:          /* NOOP */
+            OPCODE_CASE(0x1a):          /* NOOP */
+            OPCODE_CASE(0x3a):          /* NOOP */
+            OPCODE_CASE(0x5a):          /* NOOP */
+            OPCODE_CASE(0x7a):          /* NOOP */
+            OPCODE_CASE(0xda):          /* NOOP */
+            OPCODE_CASE(0xfa):          /* NOOP */
                 NOOP_IMM(1);
                 break;
 
-            case 0x1b:          /* SLO $nnnn,Y */
+            OPCODE_CASE(0x1b):          /* SLO $nnnn,Y */
                 SLO(p2, 0, 3, LOAD_ABS_Y_RMW, STORE_ABS_Y_RMW, DUMMY_STORE_ABS_Y_RMW);
                 break;
 
-            case 0x1c:          /* NOOP $nnnn,X */
-            case 0x3c:          /* NOOP $nnnn,X */
-            case 0x5c:          /* NOOP $nnnn,X */
-            case 0x7c:          /* NOOP $nnnn,X */
-            case 0xdc:          /* NOOP $nnnn,X */
-            case 0xfc:          /* NOOP $nnnn,X */
+            OPCODE_CASE(0x1c):          /* NOOP $nnnn,X */
+            OPCODE_CASE(0x3c):          /* NOOP $nnnn,X */
+            OPCODE_CASE(0x5c):          /* NOOP $nnnn,X */
+            OPCODE_CASE(0x7c):          /* NOOP $nnnn,X */
+            OPCODE_CASE(0xdc):          /* NOOP $nnnn,X */
+            OPCODE_CASE(0xfc):          /* NOOP $nnnn,X */
                 NOOP_ABS_X();
                 break;
 
-            case 0x1d:          /* ORA $nnnn,X */
+            OPCODE_CASE(0x1d):          /* ORA $nnnn,X */
                 ORA(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0x1e:          /* ASL $nnnn,X */
+            OPCODE_CASE(0x1e):          /* ASL $nnnn,X */
                 ASL(p2, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x1f:          /* SLO $nnnn,X */
+            OPCODE_CASE(0x1f):          /* SLO $nnnn,X */
                 SLO(p2, 0, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x20:          /* JSR $nnnn */
+            OPCODE_CASE(0x20):          /* JSR $nnnn */
                 JSR();
                 break;
 
-            case 0x21:          /* AND ($nn,X) */
+            OPCODE_CASE(0x21):          /* AND ($nn,X) */
                 AND(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0x23:          /* RLA ($nn,X) */
+            OPCODE_CASE(0x23):          /* RLA ($nn,X) */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 RLA(LOAD_ZERO_ADDR(p1 + reg_x_read), 2, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x24:          /* BIT $nn */
+            OPCODE_CASE(0x24):          /* BIT $nn */
                 BIT(LOAD_ZERO(p1), 2);
                 break;
 
-            case 0x25:          /* AND $nn */
+            OPCODE_CASE(0x25):          /* AND $nn */
                 AND(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0x26:          /* ROL $nn */
+            OPCODE_CASE(0x26):          /* ROL $nn */
                 ROL(p1, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x27:          /* RLA $nn */
+            OPCODE_CASE(0x27):          /* RLA $nn */
                 RLA(p1, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x28:          /* PLP */
+            OPCODE_CASE(0x28):          /* PLP */
                 PLP();
                 break;
 
-            case 0x29:          /* AND #$nn */
+            OPCODE_CASE(0x29):          /* AND #$nn */
                 AND(p1, 0, 2);
                 break;
 
-            case 0x2a:          /* ROL A */
+            OPCODE_CASE(0x2a):          /* ROL A */
                 ROL_A();
                 break;
 
-            case 0x2c:          /* BIT $nnnn */
+            OPCODE_CASE(0x2c):          /* BIT $nnnn */
                 BIT(LOAD(p2), 3);
                 break;
 
-            case 0x2d:          /* AND $nnnn */
+            OPCODE_CASE(0x2d):          /* AND $nnnn */
                 AND(LOAD(p2), 1, 3);
                 break;
 
-            case 0x2e:          /* ROL $nnnn */
+            OPCODE_CASE(0x2e):          /* ROL $nnnn */
                 ROL(p2, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x2f:          /* RLA $nnnn */
+            OPCODE_CASE(0x2f):          /* RLA $nnnn */
                 RLA(p2, 0, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x30:          /* BMI $nnnn */
+            OPCODE_CASE(0x30):          /* BMI $nnnn */
                 BRANCH(LOCAL_SIGN(), p1);
                 break;
 
-            case 0x31:          /* AND ($nn),Y */
+            OPCODE_CASE(0x31):          /* AND ($nn),Y */
                 AND(LOAD_IND_Y(p1), 1, 2);
                 break;
 
-            case 0x33:          /* RLA ($nn),Y */
+            OPCODE_CASE(0x33):          /* RLA ($nn),Y */
                 RLA_IND_Y(p1);
                 break;
 
-            case 0x35:          /* AND $nn,X */
+            OPCODE_CASE(0x35):          /* AND $nn,X */
                 AND(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0x36:          /* ROL $nn,X */
+            OPCODE_CASE(0x36):          /* ROL $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 ROL((p1 + reg_x_read) & 0xff, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x37:          /* RLA $nn,X */
+            OPCODE_CASE(0x37):          /* RLA $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 RLA((p1 + reg_x_read) & 0xff, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x38:          /* SEC */
+            OPCODE_CASE(0x38):          /* SEC */
                 SEC();
                 break;
 
-            case 0x39:          /* AND $nnnn,Y */
+            OPCODE_CASE(0x39):          /* AND $nnnn,Y */
                 AND(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0x3b:          /* RLA $nnnn,Y */
+            OPCODE_CASE(0x3b):          /* RLA $nnnn,Y */
                 RLA(p2, 0, 3, LOAD_ABS_Y_RMW, STORE_ABS_Y_RMW, DUMMY_STORE_ABS_Y_RMW);
                 break;
 
-            case 0x3d:          /* AND $nnnn,X */
+            OPCODE_CASE(0x3d):          /* AND $nnnn,X */
                 AND(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0x3e:          /* ROL $nnnn,X */
+            OPCODE_CASE(0x3e):          /* ROL $nnnn,X */
                 ROL(p2, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x3f:          /* RLA $nnnn,X */
+            OPCODE_CASE(0x3f):          /* RLA $nnnn,X */
                 RLA(p2, 0, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x40:          /* RTI */
+            OPCODE_CASE(0x40):          /* RTI */
                 RTI();
                 break;
 
-            case 0x41:          /* EOR ($nn,X) */
+            OPCODE_CASE(0x41):          /* EOR ($nn,X) */
                 EOR(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0x43:          /* SRE ($nn,X) */
+            OPCODE_CASE(0x43):          /* SRE ($nn,X) */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 SRE(LOAD_ZERO_ADDR(p1 + reg_x_read), 2, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x45:          /* EOR $nn */
+            OPCODE_CASE(0x45):          /* EOR $nn */
                 EOR(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0x46:          /* LSR $nn */
+            OPCODE_CASE(0x46):          /* LSR $nn */
                 LSR(p1, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x47:          /* SRE $nn */
+            OPCODE_CASE(0x47):          /* SRE $nn */
                 SRE(p1, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x48:          /* PHA */
+            OPCODE_CASE(0x48):          /* PHA */
                 PHA();
                 break;
 
-            case 0x49:          /* EOR #$nn */
+            OPCODE_CASE(0x49):          /* EOR #$nn */
                 EOR(p1, 0, 2);
                 break;
 
-            case 0x4a:          /* LSR A */
+            OPCODE_CASE(0x4a):          /* LSR A */
                 LSR_A();
                 break;
 
-            case 0x4b:          /* ASR #$nn */
+            OPCODE_CASE(0x4b):          /* ASR #$nn */
                 ASR(p1, 2);
                 break;
 
-            case 0x4c:          /* JMP $nnnn */
+            OPCODE_CASE(0x4c):          /* JMP $nnnn */
                 JMP(p2);
                 break;
 
-            case 0x4d:          /* EOR $nnnn */
+            OPCODE_CASE(0x4d):          /* EOR $nnnn */
                 EOR(LOAD(p2), 1, 3);
                 break;
 
-            case 0x4e:          /* LSR $nnnn */
+            OPCODE_CASE(0x4e):          /* LSR $nnnn */
                 LSR(p2, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x4f:          /* SRE $nnnn */
+            OPCODE_CASE(0x4f):          /* SRE $nnnn */
                 SRE(p2, 0, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x50:          /* BVC $nnnn */
+            OPCODE_CASE(0x50):          /* BVC $nnnn */
 #ifdef DRIVE_CPU
                 CLK_ADD(CLK, -1);
                 drivecpu_rotate();
@@ -2720,113 +2849,113 @@ trap_skipped:
                 BRANCH(!LOCAL_OVERFLOW(), p1);
                 break;
 
-            case 0x51:          /* EOR ($nn),Y */
+            OPCODE_CASE(0x51):          /* EOR ($nn),Y */
                 EOR(LOAD_IND_Y(p1), 1, 2);
                 break;
 
-            case 0x53:          /* SRE ($nn),Y */
+            OPCODE_CASE(0x53):          /* SRE ($nn),Y */
                 SRE_IND_Y(p1);
                 break;
 
-            case 0x55:          /* EOR $nn,X */
+            OPCODE_CASE(0x55):          /* EOR $nn,X */
                 EOR(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0x56:          /* LSR $nn,X */
+            OPCODE_CASE(0x56):          /* LSR $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 LSR((p1 + reg_x_read) & 0xff, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x57:          /* SRE $nn,X */
+            OPCODE_CASE(0x57):          /* SRE $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 SRE((p1 + reg_x_read) & 0xff, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x58:          /* CLI */
+            OPCODE_CASE(0x58):          /* CLI */
                 CLI();
                 break;
 
-            case 0x59:          /* EOR $nnnn,Y */
+            OPCODE_CASE(0x59):          /* EOR $nnnn,Y */
                 EOR(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0x5b:          /* SRE $nnnn,Y */
+            OPCODE_CASE(0x5b):          /* SRE $nnnn,Y */
                 SRE(p2, 0, 3, LOAD_ABS_Y_RMW, STORE_ABS_Y_RMW, DUMMY_STORE_ABS_Y_RMW);
                 break;
 
-            case 0x5d:          /* EOR $nnnn,X */
+            OPCODE_CASE(0x5d):          /* EOR $nnnn,X */
                 EOR(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0x5e:          /* LSR $nnnn,X */
+            OPCODE_CASE(0x5e):          /* LSR $nnnn,X */
                 LSR(p2, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x5f:          /* SRE $nnnn,X */
+            OPCODE_CASE(0x5f):          /* SRE $nnnn,X */
                 SRE(p2, 0, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x60:          /* RTS */
+            OPCODE_CASE(0x60):          /* RTS */
                 RTS();
                 break;
 
-            case 0x61:          /* ADC ($nn,X) */
+            OPCODE_CASE(0x61):          /* ADC ($nn,X) */
                 ADC(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0x63:          /* RRA ($nn,X) */
+            OPCODE_CASE(0x63):          /* RRA ($nn,X) */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 RRA(LOAD_ZERO_ADDR(p1 + reg_x_read), 2, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x65:          /* ADC $nn */
+            OPCODE_CASE(0x65):          /* ADC $nn */
                 ADC(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0x66:          /* ROR $nn */
+            OPCODE_CASE(0x66):          /* ROR $nn */
                 ROR(p1, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x67:          /* RRA $nn */
+            OPCODE_CASE(0x67):          /* RRA $nn */
                 RRA(p1, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x68:          /* PLA */
+            OPCODE_CASE(0x68):          /* PLA */
                 PLA();
                 break;
 
-            case 0x69:          /* ADC #$nn */
+            OPCODE_CASE(0x69):          /* ADC #$nn */
                 ADC(p1, 0, 2);
                 break;
 
-            case 0x6a:          /* ROR A */
+            OPCODE_CASE(0x6a):          /* ROR A */
                 ROR_A();
                 break;
 
-            case 0x6b:          /* ARR #$nn */
+            OPCODE_CASE(0x6b):          /* ARR #$nn */
                 ARR(p1, 2);
                 break;
 
-            case 0x6c:          /* JMP ($nnnn) */
+            OPCODE_CASE(0x6c):          /* JMP ($nnnn) */
                 JMP_IND();
                 break;
 
-            case 0x6d:          /* ADC $nnnn */
+            OPCODE_CASE(0x6d):          /* ADC $nnnn */
                 ADC(LOAD(p2), 1, 3);
                 break;
 
-            case 0x6e:          /* ROR $nnnn */
+            OPCODE_CASE(0x6e):          /* ROR $nnnn */
                 ROR(p2, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x6f:          /* RRA $nnnn */
+            OPCODE_CASE(0x6f):          /* RRA $nnnn */
                 RRA(p2, 0, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x70:          /* BVS $nnnn */
+            OPCODE_CASE(0x70):          /* BVS $nnnn */
 #ifdef DRIVE_CPU
                 CLK_ADD(CLK, -1);
                 drivecpu_rotate();
@@ -2839,155 +2968,155 @@ trap_skipped:
                 BRANCH(LOCAL_OVERFLOW(), p1);
                 break;
 
-            case 0x71:          /* ADC ($nn),Y */
+            OPCODE_CASE(0x71):          /* ADC ($nn),Y */
                 ADC(LOAD_IND_Y(p1), 1, 2);
                 break;
 
-            case 0x73:          /* RRA ($nn),Y */
+            OPCODE_CASE(0x73):          /* RRA ($nn),Y */
                 RRA_IND_Y(p1);
                 break;
 
-            case 0x75:          /* ADC $nn,X */
+            OPCODE_CASE(0x75):          /* ADC $nn,X */
                 ADC(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0x76:          /* ROR $nn,X */
+            OPCODE_CASE(0x76):          /* ROR $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 ROR((p1 + reg_x_read) & 0xff, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x77:          /* RRA $nn,X */
+            OPCODE_CASE(0x77):          /* RRA $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 RRA((p1 + reg_x_read) & 0xff, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0x78:          /* SEI */
+            OPCODE_CASE(0x78):          /* SEI */
                 SEI();
                 break;
 
-            case 0x79:          /* ADC $nnnn,Y */
+            OPCODE_CASE(0x79):          /* ADC $nnnn,Y */
                 ADC(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0x7b:          /* RRA $nnnn,Y */
+            OPCODE_CASE(0x7b):          /* RRA $nnnn,Y */
                 RRA(p2, 0, 3, LOAD_ABS_Y_RMW, STORE_ABS_Y_RMW, DUMMY_STORE_ABS_Y_RMW);
                 break;
 
-            case 0x7d:          /* ADC $nnnn,X */
+            OPCODE_CASE(0x7d):          /* ADC $nnnn,X */
                 ADC(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0x7e:          /* ROR $nnnn,X */
+            OPCODE_CASE(0x7e):          /* ROR $nnnn,X */
                 ROR(p2, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x7f:          /* RRA $nnnn,X */
+            OPCODE_CASE(0x7f):          /* RRA $nnnn,X */
                 RRA(p2, 0, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0x80:          /* NOOP #$nn */
-            case 0x82:          /* NOOP #$nn */
-            case 0x89:          /* NOOP #$nn */
-            case 0xc2:          /* NOOP #$nn */
-            case 0xe2:          /* NOOP #$nn */
+            OPCODE_CASE(0x80):          /* NOOP #$nn */
+            OPCODE_CASE(0x82):          /* NOOP #$nn */
+            OPCODE_CASE(0x89):          /* NOOP #$nn */
+            OPCODE_CASE(0xc2):          /* NOOP #$nn */
+            OPCODE_CASE(0xe2):          /* NOOP #$nn */
                 NOOP_IMM(2);
                 break;
 
-            case 0x81:          /* STA ($nn,X) */
+            OPCODE_CASE(0x81):          /* STA ($nn,X) */
                 STA((LOAD_ZERO_DUMMY(p1), LOAD_ZERO_ADDR(p1 + reg_x_read)), 3, 1, 2, STORE_ABS);
                 break;
 
-            case 0x83:          /* SAX ($nn,X) */
+            OPCODE_CASE(0x83):          /* SAX ($nn,X) */
                 SAX((LOAD_ZERO_DUMMY(p1), LOAD_ZERO_ADDR(p1 + reg_x_read)), 3, 1, 2);
                 break;
 
-            case 0x84:          /* STY $nn */
+            OPCODE_CASE(0x84):          /* STY $nn */
                 STY_ZERO(p1, 1, 2);
                 break;
 
-            case 0x85:          /* STA $nn */
+            OPCODE_CASE(0x85):          /* STA $nn */
                 STA_ZERO(p1, 1, 2);
                 break;
 
-            case 0x86:          /* STX $nn */
+            OPCODE_CASE(0x86):          /* STX $nn */
                 STX_ZERO(p1, 1, 2);
                 break;
 
-            case 0x87:          /* SAX $nn */
+            OPCODE_CASE(0x87):          /* SAX $nn */
                 SAX_ZERO(p1, 1, 2);
                 break;
 
-            case 0x88:          /* DEY */
+            OPCODE_CASE(0x88):          /* DEY */
                 DEY();
                 break;
 
-            case 0x8a:          /* TXA */
+            OPCODE_CASE(0x8a):          /* TXA */
                 TXA();
                 break;
 
-            case 0x8b:          /* ANE #$nn */
+            OPCODE_CASE(0x8b):          /* ANE #$nn */
                 ANE(p1, 2);
                 break;
 
-            case 0x8c:          /* STY $nnnn */
+            OPCODE_CASE(0x8c):          /* STY $nnnn */
                 STY(p2, 1, 3);
                 break;
 
-            case 0x8d:          /* STA $nnnn */
+            OPCODE_CASE(0x8d):          /* STA $nnnn */
                 STA(p2, 0, 1, 3, STORE_ABS);
                 break;
 
-            case 0x8e:          /* STX $nnnn */
+            OPCODE_CASE(0x8e):          /* STX $nnnn */
                 STX(p2, 1, 3);
                 break;
 
-            case 0x8f:          /* SAX $nnnn */
+            OPCODE_CASE(0x8f):          /* SAX $nnnn */
                 SAX(p2, 0, 1, 3);
                 break;
 
-            case 0x90:          /* BCC $nnnn */
+            OPCODE_CASE(0x90):          /* BCC $nnnn */
                 BRANCH(!LOCAL_CARRY(), p1);
                 break;
 
-            case 0x91:          /* STA ($nn),Y */
+            OPCODE_CASE(0x91):          /* STA ($nn),Y */
                 STA_IND_Y(p1);
                 break;
 
-            case 0x93:          /* SHA ($nn),Y */
+            OPCODE_CASE(0x93):          /* SHA ($nn),Y */
                 SHA_IND_Y(p1);
                 break;
 
-            case 0x94:          /* STY $nn,X */
+            OPCODE_CASE(0x94):          /* STY $nn,X */
                 STY_ZERO((LOAD_ZERO_DUMMY(p1), p1 + reg_x_read), CLK_ZERO_I_STORE, 2);
                 break;
 
-            case 0x95:          /* STA $nn,X */
+            OPCODE_CASE(0x95):          /* STA $nn,X */
                 STA_ZERO((LOAD_ZERO_DUMMY(p1), p1 + reg_x_read), CLK_ZERO_I_STORE, 2);
                 break;
 
-            case 0x96:          /* STX $nn,Y */
+            OPCODE_CASE(0x96):          /* STX $nn,Y */
                 STX_ZERO((LOAD_ZERO_DUMMY(p1), p1 + reg_y_read), CLK_ZERO_I_STORE, 2);
                 break;
 
-            case 0x97:          /* SAX $nn,Y */
+            OPCODE_CASE(0x97):          /* SAX $nn,Y */
                 SAX((LOAD_ZERO_DUMMY(p1), (p1 + reg_y_read) & 0xff), 0, CLK_ZERO_I_STORE, 2);
                 break;
 
-            case 0x98:          /* TYA */
+            OPCODE_CASE(0x98):          /* TYA */
                 TYA();
                 break;
 
-            case 0x99:          /* STA $nnnn,Y */
+            OPCODE_CASE(0x99):          /* STA $nnnn,Y */
                 STA(p2, 0, CLK_ABS_I_STORE2, 3, STORE_ABS_Y);
                 break;
 
-            case 0x9a:          /* TXS */
+            OPCODE_CASE(0x9a):          /* TXS */
                 TXS();
                 break;
 
-            case 0x9b:          /* SHS $nnnn,Y */
+            OPCODE_CASE(0x9b):          /* SHS $nnnn,Y */
 #ifdef C64DTV
                 NOOP_ABS_Y();
 #else
@@ -2995,380 +3124,394 @@ trap_skipped:
 #endif
                 break;
 
-            case 0x9c:          /* SHY $nnnn,X */
+            OPCODE_CASE(0x9c):          /* SHY $nnnn,X */
                 SHY_ABS_X(p2);
                 break;
 
-            case 0x9d:          /* STA $nnnn,X */
+            OPCODE_CASE(0x9d):          /* STA $nnnn,X */
                 STA(p2, 0, CLK_ABS_I_STORE2, 3, STORE_ABS_X);
                 break;
 
-            case 0x9e:          /* SHX $nnnn,Y */
+            OPCODE_CASE(0x9e):          /* SHX $nnnn,Y */
                 SHX_ABS_Y(p2);
                 break;
 
-            case 0x9f:          /* SHA $nnnn,Y */
+            OPCODE_CASE(0x9f):          /* SHA $nnnn,Y */
                 SHA_ABS_Y(p2);
                 break;
 
-            case 0xa0:          /* LDY #$nn */
+            OPCODE_CASE(0xa0):          /* LDY #$nn */
                 LDY(p1, 0, 2);
                 break;
 
-            case 0xa1:          /* LDA ($nn,X) */
+            OPCODE_CASE(0xa1):          /* LDA ($nn,X) */
                 LDA(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0xa2:          /* LDX #$nn */
+            OPCODE_CASE(0xa2):          /* LDX #$nn */
                 LDX(p1, 0, 2);
                 break;
 
-            case 0xa3:          /* LAX ($nn,X) */
+            OPCODE_CASE(0xa3):          /* LAX ($nn,X) */
                 LAX(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0xa4:          /* LDY $nn */
+            OPCODE_CASE(0xa4):          /* LDY $nn */
                 LDY(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xa5:          /* LDA $nn */
+            OPCODE_CASE(0xa5):          /* LDA $nn */
                 LDA(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xa6:          /* LDX $nn */
+            OPCODE_CASE(0xa6):          /* LDX $nn */
                 LDX(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xa7:          /* LAX $nn */
+            OPCODE_CASE(0xa7):          /* LAX $nn */
                 LAX(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xa8:          /* TAY */
+            OPCODE_CASE(0xa8):          /* TAY */
                 TAY();
                 break;
 
-            case 0xa9:          /* LDA #$nn */
+            OPCODE_CASE(0xa9):          /* LDA #$nn */
                 LDA(p1, 0, 2);
                 break;
 
-            case 0xaa:          /* TAX */
+            OPCODE_CASE(0xaa):          /* TAX */
                 TAX();
                 break;
 
-            case 0xab:          /* LXA #$nn */
+            OPCODE_CASE(0xab):          /* LXA #$nn */
                 LXA(p1, 2);
                 break;
 
-            case 0xac:          /* LDY $nnnn */
+            OPCODE_CASE(0xac):          /* LDY $nnnn */
                 LDY(LOAD(p2), 1, 3);
                 break;
 
-            case 0xad:          /* LDA $nnnn */
+            OPCODE_CASE(0xad):          /* LDA $nnnn */
                 LDA(LOAD(p2), 1, 3);
                 break;
 
-            case 0xae:          /* LDX $nnnn */
+            OPCODE_CASE(0xae):          /* LDX $nnnn */
                 LDX(LOAD(p2), 1, 3);
                 break;
 
-            case 0xaf:          /* LAX $nnnn */
+            OPCODE_CASE(0xaf):          /* LAX $nnnn */
                 LAX(LOAD(p2), 1, 3);
                 break;
 
-            case 0xb0:          /* BCS $nnnn */
+            OPCODE_CASE(0xb0):          /* BCS $nnnn */
                 BRANCH(LOCAL_CARRY(), p1);
                 break;
 
-            case 0xb1:          /* LDA ($nn),Y */
+            OPCODE_CASE(0xb1):          /* LDA ($nn),Y */
                 LDA(LOAD_IND_Y_BANK(p1), 1, 2);
                 break;
 
-            case 0xb3:          /* LAX ($nn),Y */
+            OPCODE_CASE(0xb3):          /* LAX ($nn),Y */
                 LAX(LOAD_IND_Y(p1), 1, 2);
                 break;
 
-            case 0xb4:          /* LDY $nn,X */
+            OPCODE_CASE(0xb4):          /* LDY $nn,X */
                 LDY(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0xb5:          /* LDA $nn,X */
+            OPCODE_CASE(0xb5):          /* LDA $nn,X */
                 LDA(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0xb6:          /* LDX $nn,Y */
+            OPCODE_CASE(0xb6):          /* LDX $nn,Y */
                 LDX(LOAD_ZERO_Y(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0xb7:          /* LAX $nn,Y */
+            OPCODE_CASE(0xb7):          /* LAX $nn,Y */
                 LAX(LOAD_ZERO_Y(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0xb8:          /* CLV */
+            OPCODE_CASE(0xb8):          /* CLV */
                 CLV();
                 break;
 
-            case 0xb9:          /* LDA $nnnn,Y */
+            OPCODE_CASE(0xb9):          /* LDA $nnnn,Y */
                 LDA(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0xba:          /* TSX */
+            OPCODE_CASE(0xba):          /* TSX */
                 TSX();
                 break;
 
-            case 0xbb:          /* LAS $nnnn,Y */
+            OPCODE_CASE(0xbb):          /* LAS $nnnn,Y */
                 LAS(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0xbc:          /* LDY $nnnn,X */
+            OPCODE_CASE(0xbc):          /* LDY $nnnn,X */
                 LDY(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0xbd:          /* LDA $nnnn,X */
+            OPCODE_CASE(0xbd):          /* LDA $nnnn,X */
                 LDA(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0xbe:          /* LDX $nnnn,Y */
+            OPCODE_CASE(0xbe):          /* LDX $nnnn,Y */
                 LDX(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0xbf:          /* LAX $nnnn,Y */
+            OPCODE_CASE(0xbf):          /* LAX $nnnn,Y */
                 LAX(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0xc0:          /* CPY #$nn */
+            OPCODE_CASE(0xc0):          /* CPY #$nn */
                 CPY(p1, 0, 2);
                 break;
 
-            case 0xc1:          /* CMP ($nn,X) */
+            OPCODE_CASE(0xc1):          /* CMP ($nn,X) */
                 CMP(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0xc3:          /* DCP ($nn,X) */
+            OPCODE_CASE(0xc3):          /* DCP ($nn,X) */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 DCP(LOAD_ZERO_ADDR(p1 + reg_x_read), 2, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xc4:          /* CPY $nn */
+            OPCODE_CASE(0xc4):          /* CPY $nn */
                 CPY(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xc5:          /* CMP $nn */
+            OPCODE_CASE(0xc5):          /* CMP $nn */
                 CMP(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xc6:          /* DEC $nn */
+            OPCODE_CASE(0xc6):          /* DEC $nn */
                 DEC(p1, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xc7:          /* DCP $nn */
+            OPCODE_CASE(0xc7):          /* DCP $nn */
                 DCP(p1, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xc8:          /* INY */
+            OPCODE_CASE(0xc8):          /* INY */
                 INY();
                 break;
 
-            case 0xc9:          /* CMP #$nn */
+            OPCODE_CASE(0xc9):          /* CMP #$nn */
                 CMP(p1, 0, 2);
                 break;
 
-            case 0xca:          /* DEX */
+            OPCODE_CASE(0xca):          /* DEX */
                 DEX();
                 break;
 
-            case 0xcb:          /* SBX #$nn */
+            OPCODE_CASE(0xcb):          /* SBX #$nn */
                 SBX(p1, 2);
                 break;
 
-            case 0xcc:          /* CPY $nnnn */
+            OPCODE_CASE(0xcc):          /* CPY $nnnn */
                 CPY(LOAD(p2), 1, 3);
                 break;
 
-            case 0xcd:          /* CMP $nnnn */
+            OPCODE_CASE(0xcd):          /* CMP $nnnn */
                 CMP(LOAD(p2), 1, 3);
                 break;
 
-            case 0xce:          /* DEC $nnnn */
+            OPCODE_CASE(0xce):          /* DEC $nnnn */
                 DEC(p2, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xcf:          /* DCP $nnnn */
+            OPCODE_CASE(0xcf):          /* DCP $nnnn */
                 DCP(p2, 0, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xd0:          /* BNE $nnnn */
+            OPCODE_CASE(0xd0):          /* BNE $nnnn */
                 BRANCH(!LOCAL_ZERO(), p1);
                 break;
 
-            case 0xd1:          /* CMP ($nn),Y */
+            OPCODE_CASE(0xd1):          /* CMP ($nn),Y */
                 CMP(LOAD_IND_Y(p1), 1, 2);
                 break;
 
-            case 0xd3:          /* DCP ($nn),Y */
+            OPCODE_CASE(0xd3):          /* DCP ($nn),Y */
                 DCP_IND_Y(p1);
                 break;
 
-            case 0xd5:          /* CMP $nn,X */
+            OPCODE_CASE(0xd5):          /* CMP $nn,X */
                 CMP(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0xd6:          /* DEC $nn,X */
+            OPCODE_CASE(0xd6):          /* DEC $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 DEC((p1 + reg_x_read) & 0xff, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xd7:          /* DCP $nn,X */
+            OPCODE_CASE(0xd7):          /* DCP $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 DCP((p1 + reg_x_read) & 0xff, 0, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xd8:          /* CLD */
+            OPCODE_CASE(0xd8):          /* CLD */
                 CLD();
                 break;
 
-            case 0xd9:          /* CMP $nnnn,Y */
+            OPCODE_CASE(0xd9):          /* CMP $nnnn,Y */
                 CMP(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0xdb:          /* DCP $nnnn,Y */
+            OPCODE_CASE(0xdb):          /* DCP $nnnn,Y */
                 DCP(p2, 0, 3, LOAD_ABS_Y_RMW, STORE_ABS_Y_RMW, DUMMY_STORE_ABS_Y_RMW);
                 break;
 
-            case 0xdd:          /* CMP $nnnn,X */
+            OPCODE_CASE(0xdd):          /* CMP $nnnn,X */
                 CMP(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0xde:          /* DEC $nnnn,X */
+            OPCODE_CASE(0xde):          /* DEC $nnnn,X */
                 DEC(p2, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0xdf:          /* DCP $nnnn,X */
+            OPCODE_CASE(0xdf):          /* DCP $nnnn,X */
                 DCP(p2, 0, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0xe0:          /* CPX #$nn */
+            OPCODE_CASE(0xe0):          /* CPX #$nn */
                 CPX(p1, 0, 2);
                 break;
 
-            case 0xe1:          /* SBC ($nn,X) */
+            OPCODE_CASE(0xe1):          /* SBC ($nn,X) */
                 SBC(LOAD_IND_X(p1), 1, 2);
                 break;
 
-            case 0xe3:          /* ISB ($nn,X) */
+            OPCODE_CASE(0xe3):          /* ISB ($nn,X) */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 ISB(LOAD_ZERO_ADDR(p1 + reg_x_read), 2, 2, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xe4:          /* CPX $nn */
+            OPCODE_CASE(0xe4):          /* CPX $nn */
                 CPX(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xe5:          /* SBC $nn */
+            OPCODE_CASE(0xe5):          /* SBC $nn */
                 SBC(LOAD_ZERO(p1), 1, 2);
                 break;
 
-            case 0xe6:          /* INC $nn */
+            OPCODE_CASE(0xe6):          /* INC $nn */
                 INC(p1, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xe7:          /* ISB $nn */
+            OPCODE_CASE(0xe7):          /* ISB $nn */
                 ISB(p1, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xe8:          /* INX */
+            OPCODE_CASE(0xe8):          /* INX */
                 INX();
                 break;
 
-            case 0xe9:          /* SBC #$nn */
+            OPCODE_CASE(0xe9):          /* SBC #$nn */
                 SBC(p1, 0, 2);
                 break;
 
-            case 0xea:          /* NOP */
+            OPCODE_CASE(0xea):          /* NOP */
                 NOP();
                 break;
 
-            case 0xeb:          /* USBC #$nn (same as SBC) */
+            OPCODE_CASE(0xeb):          /* USBC #$nn (same as SBC) */
                 SBC(p1, 0, 2);
                 break;
 
-            case 0xec:          /* CPX $nnnn */
+            OPCODE_CASE(0xec):          /* CPX $nnnn */
                 CPX(LOAD(p2), 1, 3);
                 break;
 
-            case 0xed:          /* SBC $nnnn */
+            OPCODE_CASE(0xed):          /* SBC $nnnn */
                 SBC(LOAD(p2), 1, 3);
                 break;
 
-            case 0xee:          /* INC $nnnn */
+            OPCODE_CASE(0xee):          /* INC $nnnn */
                 INC(p2, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xef:          /* ISB $nnnn */
+            OPCODE_CASE(0xef):          /* ISB $nnnn */
                 ISB(p2, 0, 3, LOAD_ABS, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xf0:          /* BEQ $nnnn */
+            OPCODE_CASE(0xf0):          /* BEQ $nnnn */
                 BRANCH(LOCAL_ZERO(), p1);
                 break;
 
-            case 0xf1:          /* SBC ($nn),Y */
+            OPCODE_CASE(0xf1):          /* SBC ($nn),Y */
                 SBC(LOAD_IND_Y(p1), 1, 2);
                 break;
 
-            case 0xf3:          /* ISB ($nn),Y */
+            OPCODE_CASE(0xf3):          /* ISB ($nn),Y */
                 ISB_IND_Y(p1);
                 break;
 
-            case 0xf5:          /* SBC $nn,X */
+            OPCODE_CASE(0xf5):          /* SBC $nn,X */
                 SBC(LOAD_ZERO_X(p1), CLK_ZERO_I2, 2);
                 break;
 
-            case 0xf6:          /* INC $nn,X */
+            OPCODE_CASE(0xf6):          /* INC $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 INC((p1 + reg_x_read) & 0xff, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xf7:          /* ISB $nn,X */
+            OPCODE_CASE(0xf7):          /* ISB $nn,X */
                 LOAD_ZERO_DUMMY(p1);
                 CLK_ADD_DUMMY(CLK, 1);
                 ISB((p1 + reg_x_read) & 0xff, 0, 2, LOAD_ZERO, STORE_ABS, DUMMY_STORE_ABS_RMW);
                 break;
 
-            case 0xf8:          /* SED */
+            OPCODE_CASE(0xf8):          /* SED */
                 SED();
                 break;
 
-            case 0xf9:          /* SBC $nnnn,Y */
+            OPCODE_CASE(0xf9):          /* SBC $nnnn,Y */
                 SBC(LOAD_ABS_Y(p2), 1, 3);
                 break;
 
-            case 0xfb:          /* ISB $nnnn,Y */
+            OPCODE_CASE(0xfb):          /* ISB $nnnn,Y */
                 ISB(p2, 0, 3, LOAD_ABS_Y_RMW, STORE_ABS_Y_RMW, DUMMY_STORE_ABS_Y_RMW);
                 break;
 
-            case 0xfd:          /* SBC $nnnn,X */
+            OPCODE_CASE(0xfd):          /* SBC $nnnn,X */
                 SBC(LOAD_ABS_X(p2), 1, 3);
                 break;
 
-            case 0xfe:          /* INC $nnnn,X */
+            OPCODE_CASE(0xfe):          /* INC $nnnn,X */
                 INC(p2, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
 
-            case 0xff:          /* ISB $nnnn,X */
+            OPCODE_CASE(0xff):          /* ISB $nnnn,X */
                 ISB(p2, 0, 3, LOAD_ABS_X_RMW, STORE_ABS_X_RMW, DUMMY_STORE_ABS_X_RMW);
                 break;
         }
 
 #if !defined(DRIVE_CPU)
-        if (maincpu_profiling) {
+        if (CPU_HOOKS && maincpu_profiling) {
             profile_sample_finish(CLK - profiling_clock_start, 0 /* stolen_cycles */);
         }
 #endif
 
+#ifdef CPU_BLOCK_CHAIN_ACTIVE
+        if (--block_chain_left > 0
+            && !cpu_is_jammed
+#ifdef CPU_EVENT_CLK
+            && CLK < CPU_INT_STATUS->next_event_clk
+#else
+            && CPU_INT_STATUS->global_pending_int == IK_NONE
+            && CLK < alarm_context_next_pending_clk(ALARM_CONTEXT)
+#endif
+            && CPU_BLOCK_CHAIN_ALLOWED()) {
+            CPU_INT_STATUS->num_dma_per_opcode = 0;
+            goto block_chain_next;
+        }
+#endif
     }
 }
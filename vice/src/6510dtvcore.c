@@ -274,6 +274,13 @@
 #define CHECK_PROFILE_RTI()
 #endif
 
+/* Edge coverage for fuzzing, see cpucoverage.h.  */
+#if defined(USE_CPU_COVERAGE) && !defined(DRIVE_CPU)
+#define CPU_COVERAGE_EDGE(dest_addr) CPUCOVERAGE_EDGE(dest_addr)
+#else
+#define CPU_COVERAGE_EDGE(dest_addr)
+#endif
+
 #ifdef DEBUG
 #define TRACE_NMI()                         \
     do {                                    \
@@ -963,6 +970,7 @@ static int ane_log_level = 1; /* 0: none, 1: unstable only 2: all */
                     OPCODE_DELAYS_INTERRUPT();                    \
                 }                                                 \
             }                                                     \
+            CPU_COVERAGE_EDGE(dest_addr & 0xffff);                \
             JUMP(dest_addr & 0xffff);                             \
         }                                                         \
     } while (0)
@@ -986,6 +994,7 @@ static int ane_log_level = 1; /* 0: none, 1: unstable only 2: all */
             } else {                                          \
                 OPCODE_DELAYS_INTERRUPT();                    \
             }                                                 \
+            CPU_COVERAGE_EDGE(dest_addr & 0xffff);            \
             JUMP(dest_addr & 0xffff);                         \
         }                                                     \
     } while (0)
@@ -1162,9 +1171,10 @@ static int ane_log_level = 1; /* 0: none, 1: unstable only 2: all */
         set_func(old_value, new_value)      \
     } while (0)
 
-#define JMP(addr)   \
-    do {            \
-        JUMP(addr); \
+#define JMP(addr)                \
+    do {                         \
+        CPU_COVERAGE_EDGE(addr); \
+        JUMP(addr);              \
     } while (0)
 
 #define JMP_IND()                                                    \
@@ -1174,12 +1184,18 @@ static int ane_log_level = 1; /* 0: none, 1: unstable only 2: all */
         CLK_INC();                                                   \
         dest_addr |= (LOAD((p2 & 0xff00) | ((p2 + 1) & 0xff)) << 8); \
         CLK_INC();                                                   \
+        CPU_COVERAGE_EDGE(dest_addr);                                \
         JUMP(dest_addr);                                             \
     } while (0)
 
 /* HACK: fix JSR MSB in monitor CPU history */
 #ifdef FEATURE_CPUMEMHISTORY
-#define JSR_FIXUP_MSB(x)    monitor_cpuhistory_fix_p2(x)
+#define JSR_FIXUP_MSB(x)                  \
+    do {                                  \
+        if (monitor_cpuhistory_enabled) { \
+            monitor_cpuhistory_fix_p2(x); \
+        }                                 \
+    } while (0)
 #else
 #define JSR_FIXUP_MSB(x)
 #endif
@@ -1202,6 +1218,7 @@ static int ane_log_level = 1; /* 0: none, 1: unstable only 2: all */
         dest_addr = (uint16_t)(p1 | (addr_msb << 8)); \
         CLK_INC();                                \
         CHECK_PROFILE_JSR(dest_addr);             \
+        CPU_COVERAGE_EDGE(dest_addr);             \
         JUMP(dest_addr);                          \
     } while (0)
 
@@ -1470,23 +1487,24 @@ static int lxa_log_level = 1; /* 0: none, 1: unstable only 2: all */
         JUMP(tmp);                      \
     } while (0)
 
-#define RTS()                 \
-    do {                      \
-        uint16_t tmp;         \
-                              \
-        CHECK_PROFILE_RTS();  \
-        if (!SKIP_CYCLE) {    \
-            STACK_PEEK();     \
-            CLK_INC();        \
-        }                     \
-        tmp = PULL();         \
-        CLK_INC();            \
-        tmp |= (PULL() << 8); \
-        CLK_INC();            \
-        LOAD(tmp);            \
-        CLK_INC();            \
-        tmp++;                \
-        JUMP(tmp);            \
+#define RTS()                   \
+    do {                        \
+        uint16_t tmp;           \
+                                \
+        CHECK_PROFILE_RTS();    \
+        if (!SKIP_CYCLE) {      \
+            STACK_PEEK();       \
+            CLK_INC();          \
+        }                       \
+        tmp = PULL();           \
+        CLK_INC();              \
+        tmp |= (PULL() << 8);   \
+        CLK_INC();              \
+        LOAD(tmp);              \
+        CLK_INC();              \
+        tmp++;                  \
+        CPU_COVERAGE_EDGE(tmp); \
+        JUMP(tmp);              \
     } while (0)
 
 #define SAC()                       \
@@ -1749,7 +1767,9 @@ static const uint8_t fetch_tab[] = {
 #endif
 
 #ifdef FEATURE_CPUMEMHISTORY
-        memmap_state |= (MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        if (monitor_cpuhistory_enabled) {
+            memmap_state |= (MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        }
 #endif
 
 #if !defined(DRIVE_CPU)
@@ -1768,8 +1788,10 @@ static const uint8_t fetch_tab[] = {
         /* If reg_pc >= bank_limit  then JSR (0x20) hasn't load p2 yet.
            The earlier LOAD(reg_pc+2) hack can break stealing badly on x64sc.
            The fixing is now handled in JSR(). */
-        monitor_cpuhistory_store(debug_clk, reg_pc, p0, p1, p2 >> 8, reg_a_read, reg_x, reg_y, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
-        memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        if (monitor_cpuhistory_enabled) {
+            monitor_cpuhistory_store(debug_clk, reg_pc, p0, p1, p2 >> 8, reg_a_read, reg_x, reg_y, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
+            memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        }
 #endif
 
 #ifdef DEBUG
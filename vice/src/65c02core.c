@@ -1644,7 +1644,9 @@
         CLOCK history_clk;
 #ifndef DRIVE_CPU
         history_clk = maincpu_clk;
-        memmap_state |= (MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        if (monitor_cpuhistory_enabled) {
+            memmap_state |= (MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+        }
 #else
         history_clk = CLK;
 #endif
@@ -1653,20 +1655,22 @@
         FETCH_OPCODE(opcode);
 
 #ifdef FEATURE_CPUMEMHISTORY
+        if (monitor_cpuhistory_enabled) {
 #ifndef DRIVE_CPU
-        /* HACK to cope with FETCH_OPCODE optimization in x64 */
-        if (((int)reg_pc) < bank_limit) {
-            memmap_mem_read(reg_pc);
-        }
+            /* HACK to cope with FETCH_OPCODE optimization in x64 */
+            if (((int)reg_pc) < bank_limit) {
+                memmap_mem_read(reg_pc);
+            }
 #endif
-        if (p0 == 0x20) {
-            monitor_cpuhistory_store(history_clk, reg_pc, p0, p1, LOAD(reg_pc + 2), reg_a, reg_x, reg_y, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
-        } else {
-            monitor_cpuhistory_store(history_clk, reg_pc, p0, p1, p2 >> 8, reg_a, reg_x, reg_y, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
-        }
+            if (p0 == 0x20) {
+                monitor_cpuhistory_store(history_clk, reg_pc, p0, p1, LOAD(reg_pc + 2), reg_a, reg_x, reg_y, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
+            } else {
+                monitor_cpuhistory_store(history_clk, reg_pc, p0, p1, p2 >> 8, reg_a, reg_x, reg_y, reg_sp, LOCAL_STATUS(), ORIGIN_MEMSPACE);
+            }
 #ifndef DRIVE_CPU
-        memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
+            memmap_state &= ~(MEMMAP_STATE_INSTR | MEMMAP_STATE_OPCODE);
 #endif
+        }
 #endif
 
 #ifdef DEBUG
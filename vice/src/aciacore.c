@@ -160,8 +160,20 @@ typedef struct acia_struct {
     /*! \brief The handshake lines as currently seen by the ACIA */
     enum rs232handshake_out rs232_status_lines;
 
+    /*! \brief 1 if the ACIA ignores the bps rate ("unlimited baud").
+
+      Characters are then transferred every ACIA_UNLIMITED_TICKS
+      clock ticks, and a received character is only taken from the
+      RS232 device once the previous one has been read, so the
+      transfer runs as fast as the program can handle it.
+    */
+    int unlimited;
+
 } acia_type;
 
+/*! \brief clock ticks per character in unlimited baud mode */
+#define ACIA_UNLIMITED_TICKS 32
+
 /******************************************************************/
 
 static acia_type acia = { NULL, NULL, 0, 0, 0, (enum acia_tx_state)0,
@@ -418,6 +430,9 @@ static void set_acia_ticks(void)
      */
     acia.ticks = (int) (machine_get_cycles_per_second() / get_acia_bps() * bits);
 
+    if (acia.unlimited) {
+        acia.ticks = ACIA_UNLIMITED_TICKS;
+    }
 
     /* adjust the alarm rate for reception */
     if (acia.alarm_active_rx) {
@@ -434,6 +449,28 @@ static void set_acia_ticks(void)
     }
 }
 
+/*! \internal \brief Change the unlimited baud resource for this ACIA
+
+ \param val
+   1 to ignore the bps rate, 0 to honour it
+
+ \param param
+   Unused
+
+ \return
+   0 on success, -1 on error.
+
+ \remark
+   This function is called whenever the resource
+   MYACIA "Unlimited" is changed.
+*/
+static int acia_set_unlimited(int val, void *param)
+{
+    acia.unlimited = val ? 1 : 0;
+    set_acia_ticks();
+    return 0;
+}
+
 /*! \internal \brief Change the emulation mode for this ACIA
 
  \param new_mode
@@ -473,6 +510,8 @@ static int acia_set_mode(int new_mode, void *param)
 static const resource_int_t resources_int[] = {
     { MYACIA "Dev", MyDevice, RES_EVENT_NO, NULL,
       &acia.device, acia_set_device, NULL },
+    { MYACIA "Unlimited", 0, RES_EVENT_NO, NULL,
+      &acia.unlimited, acia_set_unlimited, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -501,6 +540,12 @@ static const cmdline_option_t cmdline_options[] =
     { "-myaciadev", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, MYACIA "Dev", NULL,
       "<0-3>", "Specify RS232 device this ACIA should work on" },
+    { "-myaciaunlimited", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, MYACIA "Unlimited", (void *)1,
+      NULL, "Transfer characters as fast as the program handles them, ignoring the bps rate" },
+    { "+myaciaunlimited", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, MYACIA "Unlimited", (void *)0,
+      NULL, "Transfer characters at the programmed bps rate" },
     CMDLINE_LIST_END
 };
 
@@ -1235,6 +1280,12 @@ static void int_acia_rx(CLOCK offset, void *data)
             break;
         }
 
+        /* without a bps rate, leave the byte in the RS232 device
+           until the program has read the last one */
+        if (acia.unlimited && (acia.status & ACIA_SR_BITS_RECEIVE_DR_FULL)) {
+            break;
+        }
+
         if (!rs232drv_getc(acia.fd, &received_byte)) {
             break;
         }
@@ -54,6 +54,15 @@ void alarm_context_init(alarm_context_t *context, const char *name)
 
     context->num_pending_alarms = 0;
     context->next_pending_alarm_clk = CLOCK_MAX;
+    context->next_pending_alarm_idx = -1;
+#ifdef ALARM_USE_HEAP
+    context->next_pending_alarm = NULL;
+#endif
+    context->event_clk = NULL;
+
+#ifdef USE_TRACE_ZONES
+    context->trace_zone = tracezone_register(name);
+#endif
 }
 
 void alarm_context_destroy(alarm_context_t *context)
@@ -93,11 +102,23 @@ void alarm_context_time_warp(alarm_context_t *context, CLOCK warp_amount,
         }
     }
 
+#ifdef ALARM_USE_HEAP
+    /* Shifting all entries keeps the heap ordered unless one of them
+       wrapped around, so simply rebuild it.  The next alarm stays the same,
+       as with the linear backend.  */
+    for (i = context->num_pending_alarms / 2; i-- > 0;) {
+        alarm_context_heap_sift_down(context, i);
+    }
+#endif
     if (warp_direction > 0) {
         context->next_pending_alarm_clk += warp_amount;
     } else {
         context->next_pending_alarm_clk -= warp_amount;
     }
+
+    if (context->event_clk != NULL) {
+        *context->event_clk = 0;
+    }
 }
 
 /* ------------------------------------------------------------------------ */
@@ -109,6 +130,7 @@ static void alarm_init(alarm_t *alarm, alarm_context_t *context,
     alarm->context = context;
     alarm->callback = callback;
     alarm->data = data;
+    alarm->dispatched = 0;
 
     alarm->pending_idx = -1;      /* Not pending.  */
 
@@ -176,6 +198,49 @@ void alarm_unset(alarm_t *alarm)
     }
     context = alarm->context;
 
+#ifdef ALARM_USE_HEAP
+    {
+        unsigned int last;
+        int linear_idx;
+
+        last = --context->num_pending_alarms;
+
+        if ((unsigned int)idx != last) {
+            /* Move the last heap entry into the hole and let it find its
+               place again.  */
+            context->pending_alarms[idx].alarm
+                = context->pending_alarms[last].alarm;
+            context->pending_alarms[idx].clk
+                = context->pending_alarms[last].clk;
+
+            context->pending_alarms[idx].alarm->pending_idx = idx;
+
+            if (idx > 0
+                && alarm_context_heap_before(context, (unsigned int)idx,
+                                             (unsigned int)(idx - 1) >> 1)) {
+                alarm_context_heap_sift_up(context, (unsigned int)idx);
+            } else {
+                alarm_context_heap_sift_down(context, (unsigned int)idx);
+            }
+        }
+
+        /* The linear backend moves its last entry into the hole as well,
+           which makes that alarm lose ties it used to win.  */
+        linear_idx = alarm->linear_idx;
+        if ((unsigned int)linear_idx != last) {
+            alarm_t *moved = context->linear_alarms[last];
+
+            context->linear_alarms[linear_idx] = moved;
+            moved->linear_idx = linear_idx;
+            alarm_context_heap_sift_down(context, (unsigned int)moved->pending_idx);
+        }
+
+        if (alarm == context->next_pending_alarm
+            || context->num_pending_alarms == 0) {
+            alarm_context_update_next_pending(context);
+        }
+    }
+#else
     if (context->num_pending_alarms > 1) {
         int last;
 
@@ -202,6 +267,7 @@ void alarm_unset(alarm_t *alarm)
         context->next_pending_alarm_clk = CLOCK_MAX;
         context->next_pending_alarm_idx = -1;
     }
+#endif
 
     alarm->pending_idx = -1;
 }
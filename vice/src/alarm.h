@@ -28,6 +28,7 @@
 #ifndef VICE_ALARM_H
 #define VICE_ALARM_H
 
+#include "tracezone.h"
 #include "types.h"
 
 #define ALARM_CONTEXT_MAX_PENDING_ALARMS 0x100
@@ -49,9 +50,18 @@ struct alarm_s {
        pending.  */
     int pending_idx;
 
+#ifdef ALARM_USE_HEAP
+    /* Index the alarm would have in the pending alarm array of the linear
+       backend, used to order alarms that are due on the same clock tick.  */
+    int linear_idx;
+#endif
+
     /* Call data */
     void *data;
 
+    /* Number of times the alarm has been dispatched.  */
+    unsigned long dispatched;
+
     /* Link to the next and previous alarms in the list.  */
     struct alarm_s *next, *prev;
 };
@@ -84,6 +94,24 @@ struct alarm_context_s {
 
     /* Pending alarm number.  */
     int next_pending_alarm_idx;
+
+#ifdef ALARM_USE_HEAP
+    /* Alarm to dispatch next; not always the top of the heap, see below.  */
+    struct alarm_s *next_pending_alarm;
+
+    /* Pending alarms in the order of the pending alarm array of the linear
+       backend.  */
+    struct alarm_s *linear_alarms[ALARM_CONTEXT_MAX_PENDING_ALARMS];
+#endif
+
+    /* If not NULL, lowered to the clock tick of every alarm that is set
+       before it, see `next_event_clk' in interrupt.h.  */
+    CLOCK *event_clk;
+
+#ifdef USE_TRACE_ZONES
+    /* Trace zone covering the dispatches of this context.  */
+    int trace_zone;
+#endif
 };
 typedef struct alarm_context_s alarm_context_t;
 
@@ -107,6 +135,95 @@ inline static CLOCK alarm_context_next_pending_clk(alarm_context_t *context)
     return context->next_pending_alarm_clk;
 }
 
+#ifdef ALARM_USE_HEAP
+
+/* Binary min-heap backend: `pending_alarms[0]' always holds the alarm that
+   fires first, so looking up the next pending alarm is O(1) and adding,
+   modifying or removing one is O(log n).
+
+   Chips like the CIA depend on the order in which alarms due on the very
+   same clock tick are dispatched, so this has to be the order of the
+   linear backend.  Its scan picks the alarm with the highest index in the
+   pending array among the earliest ones, and that choice only changes when
+   the linear backend would scan again or an earlier alarm is added.  The
+   heap therefore breaks ties on the linear index (`linear_idx'), and
+   `next_pending_alarm' keeps the alarm picked until then.  */
+
+inline static int alarm_context_heap_before(alarm_context_t *context,
+                                            unsigned int a, unsigned int b)
+{
+    if (context->pending_alarms[a].clk != context->pending_alarms[b].clk) {
+        return context->pending_alarms[a].clk < context->pending_alarms[b].clk;
+    }
+    return context->pending_alarms[a].alarm->linear_idx
+           > context->pending_alarms[b].alarm->linear_idx;
+}
+
+inline static void alarm_context_heap_swap(alarm_context_t *context,
+                                           unsigned int a, unsigned int b)
+{
+    pending_alarms_t tmp;
+
+    tmp = context->pending_alarms[a];
+    context->pending_alarms[a] = context->pending_alarms[b];
+    context->pending_alarms[b] = tmp;
+
+    context->pending_alarms[a].alarm->pending_idx = (int)a;
+    context->pending_alarms[b].alarm->pending_idx = (int)b;
+}
+
+inline static void alarm_context_heap_sift_up(alarm_context_t *context,
+                                              unsigned int idx)
+{
+    while (idx > 0) {
+        unsigned int parent = (idx - 1) >> 1;
+
+        if (!alarm_context_heap_before(context, idx, parent)) {
+            break;
+        }
+        alarm_context_heap_swap(context, parent, idx);
+        idx = parent;
+    }
+}
+
+inline static void alarm_context_heap_sift_down(alarm_context_t *context,
+                                                unsigned int idx)
+{
+    unsigned int num = context->num_pending_alarms;
+
+    for (;;) {
+        unsigned int child = (idx << 1) + 1;
+        unsigned int smallest = idx;
+
+        if (child < num && alarm_context_heap_before(context, child, smallest)) {
+            smallest = child;
+        }
+        child++;
+        if (child < num && alarm_context_heap_before(context, child, smallest)) {
+            smallest = child;
+        }
+        if (smallest == idx) {
+            break;
+        }
+        alarm_context_heap_swap(context, idx, smallest);
+        idx = smallest;
+    }
+}
+
+/* What a scan of the linear backend would find.  */
+inline static void alarm_context_update_next_pending(alarm_context_t *context)
+{
+    if (context->num_pending_alarms > 0) {
+        context->next_pending_alarm_clk = context->pending_alarms[0].clk;
+        context->next_pending_alarm = context->pending_alarms[0].alarm;
+    } else {
+        context->next_pending_alarm_clk = CLOCK_MAX;
+        context->next_pending_alarm = NULL;
+    }
+}
+
+#else
+
 inline static void alarm_context_update_next_pending(alarm_context_t *context)
 {
     CLOCK next_pending_alarm_clk = CLOCK_MAX;
@@ -128,19 +245,30 @@ inline static void alarm_context_update_next_pending(alarm_context_t *context)
     context->next_pending_alarm_idx = next_pending_alarm_idx;
 }
 
+#endif
+
 inline static void alarm_context_dispatch(alarm_context_t *context,
                                           CLOCK cpu_clk)
 {
     CLOCK offset;
+#ifndef ALARM_USE_HEAP
     int idx;
+#endif
     alarm_t *alarm;
 
     offset = cpu_clk - context->next_pending_alarm_clk;
 
+#ifdef ALARM_USE_HEAP
+    alarm = context->next_pending_alarm;
+#else
     idx = context->next_pending_alarm_idx;
     alarm = context->pending_alarms[idx].alarm;
+#endif
 
+    alarm->dispatched++;
+    TRACEZONE_BEGIN(context->trace_zone);
     (alarm->callback)(offset, alarm->data);
+    TRACEZONE_END(context->trace_zone);
 }
 
 inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
@@ -151,6 +279,51 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
     context = alarm->context;
     idx = alarm->pending_idx;
 
+#ifdef ALARM_USE_HEAP
+    if (idx < 0) {
+        unsigned int new_idx;
+
+        /* Not pending yet: add at the bottom of the heap.  */
+
+        new_idx = context->num_pending_alarms;
+        if (new_idx >= ALARM_CONTEXT_MAX_PENDING_ALARMS) {
+            alarm_log_too_many_alarms();
+            return;
+        }
+
+        context->pending_alarms[new_idx].alarm = alarm;
+        context->pending_alarms[new_idx].clk = cpu_clk;
+        alarm->pending_idx = (int)new_idx;
+
+        context->linear_alarms[new_idx] = alarm;
+        alarm->linear_idx = (int)new_idx;
+
+        context->num_pending_alarms++;
+
+        alarm_context_heap_sift_up(context, new_idx);
+
+        if (cpu_clk < context->next_pending_alarm_clk) {
+            context->next_pending_alarm_clk = cpu_clk;
+            context->next_pending_alarm = alarm;
+        }
+    } else {
+        CLOCK old_clk = context->pending_alarms[idx].clk;
+
+        /* Already pending: modify and restore the heap property.  */
+
+        context->pending_alarms[idx].clk = cpu_clk;
+        if (cpu_clk < old_clk) {
+            alarm_context_heap_sift_up(context, (unsigned int)idx);
+        } else {
+            alarm_context_heap_sift_down(context, (unsigned int)idx);
+        }
+
+        if (context->next_pending_alarm_clk > cpu_clk
+            || alarm == context->next_pending_alarm) {
+            alarm_context_update_next_pending(context);
+        }
+    }
+#else
     if (idx < 0) {
         int new_idx;
 
@@ -182,6 +355,10 @@ inline static void alarm_set(alarm_t *alarm, CLOCK cpu_clk)
             alarm_context_update_next_pending(context);
         }
     }
+#endif
+    if (context->event_clk != NULL && cpu_clk < *context->event_clk) {
+        *context->event_clk = cpu_clk;
+    }
 }
 
 #endif
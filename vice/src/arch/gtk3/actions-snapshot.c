@@ -34,6 +34,7 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "rewind.h"
 #include "uiactions.h"
 #include "uiapi.h"
 #include "uisnapshot.h"
@@ -78,6 +79,15 @@ static void snapshot_quicksave_action(ui_action_map_t *self)
 {
     ui_snapshot_quicksave_snapshot();
 }
+
+/** \brief  Rewind to previous rewind buffer state action
+ *
+ * \param[in]   self    action map
+ */
+static void snapshot_rewind_action(ui_action_map_t *self)
+{
+    rewind_trigger_step_back(1);
+}
 /* }}} */
 
 /* {{{ History actions */
@@ -121,6 +131,24 @@ static void history_playback_stop_action(ui_action_map_t *self)
     event_playback_stop();
 }
 
+/** \brief  Seek history playback back action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_seek_back_action(ui_action_map_t *self)
+{
+    event_playback_seek_by(-EVENT_SEEK_STEP);
+}
+
+/** \brief  Seek history playback forward action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_seek_forward_action(ui_action_map_t *self)
+{
+    event_playback_seek_by(EVENT_SEEK_STEP);
+}
+
 /** \brief  Set history milestone action
  *
  * \param[in]   self    action map
@@ -160,6 +188,9 @@ static const ui_action_map_t snapshot_actions[] = {
     {   .action  = ACTION_SNAPSHOT_QUICKSAVE,
         .handler = snapshot_quicksave_action
     },
+    {   .action  = ACTION_SNAPSHOT_REWIND,
+        .handler = snapshot_rewind_action
+    },
 
     /* History actions */
     {   .action   = ACTION_HISTORY_RECORD_START,
@@ -178,6 +209,12 @@ static const ui_action_map_t snapshot_actions[] = {
         .handler  = history_playback_stop_action,
         .uithread = true
     },
+    {   .action  = ACTION_HISTORY_PLAYBACK_SEEK_BACK,
+        .handler = history_playback_seek_back_action
+    },
+    {   .action  = ACTION_HISTORY_PLAYBACK_SEEK_FORWARD,
+        .handler = history_playback_seek_forward_action
+    },
     {   .action  = ACTION_HISTORY_MILESTONE_SET,
         .handler = history_milestone_set_action
     },
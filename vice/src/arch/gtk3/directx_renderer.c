@@ -44,6 +44,7 @@
 #include "palette.h"
 #include "render_queue.h"
 #include "resources.h"
+#include "tracezone.h"
 #include "ui.h"
 #include "uistatusbar.h"
 
@@ -121,6 +122,7 @@ static void vice_directx_destroy_context(video_canvas_t *canvas)
 
     if (context) {
         pthread_mutex_destroy(&context->render_lock);
+        lib_free(context->frame);
         lib_free(context);
         canvas->renderer_context = NULL;
     }
@@ -271,7 +273,9 @@ static void vice_directx_refresh_rect(video_canvas_t *canvas,
 {
     context_t *context;
     backbuffer_t *backbuffer;
-    int pixel_data_size_bytes;
+    unsigned int width;
+    unsigned int height;
+    bool reset;
 
     CANVAS_LOCK();
 
@@ -281,29 +285,56 @@ static void vice_directx_refresh_rect(video_canvas_t *canvas,
         return;
     }
 
-    /* Obtain an unused backbuffer to render to */
-    pixel_data_size_bytes = context->emulated_width_next * context->emulated_height_next * 4;
-    backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
+    TRACEZONE_BEGIN(TRACEZONE_RENDER_HANDOFF);
+
+    width = context->emulated_width_next;
+    height = context->emulated_height_next;
+
+    /*
+     * The render thread renders to the frame kept in the context, only the
+     * lines that changed since the last frame, unless the frame changed
+     * size or missed some of them.
+     */
+    if (context->frame_width != width || context->frame_height != height) {
+        context->frame_width = width;
+        context->frame_height = height;
+        context->frame_reset = true;
+    }
+
+    /* Obtain an unused backbuffer to render to, it only holds the changed rows */
+    backbuffer = render_queue_get_from_pool(context->render_queue, height);
 
     if (!backbuffer) {
+        /* the lines that changed in this frame never reach the frame */
+        context->frame_reset = true;
         CANVAS_UNLOCK();
+        TRACEZONE_END(TRACEZONE_RENDER_HANDOFF);
         return;
     }
 
-    backbuffer->width = context->emulated_width_next;
-    backbuffer->height = context->emulated_height_next;
+    backbuffer->width = width;
+    backbuffer->height = height;
     backbuffer->pixel_aspect_ratio = context->pixel_aspect_ratio_next;
     backbuffer->interlaced = canvas->videoconfig->interlaced;
     backbuffer->interlace_field = canvas->videoconfig->interlace_field;
+    backbuffer->render_deferred = true;
+    backbuffer->changed_rows = backbuffer->pixel_data;
+    if (!backbuffer->deferred) {
+        backbuffer->deferred = video_render_deferred_new();
+    }
+    reset = context->frame_reset;
+    context->frame_reset = false;
 
     CANVAS_UNLOCK();
 
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
+    video_canvas_render_deferred(canvas, backbuffer->deferred, w, h, xs, ys, xi, yi, reset);
 
     CANVAS_LOCK();
     render_queue_enqueue_for_display(context->render_queue, backbuffer);
     render_thread_push_job(context->render_thread, render_thread_render);
     CANVAS_UNLOCK();
+
+    TRACEZONE_END(TRACEZONE_RENDER_HANDOFF);
 }
 
 static void vice_directx_on_ui_frame_clock(GdkFrameClock *clock, video_canvas_t *canvas)
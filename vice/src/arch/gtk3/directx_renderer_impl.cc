@@ -36,10 +36,12 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 extern "C"
 {
 #include "archdep.h"
+#include "lib.h"
 #include "log.h"
 #include "render_queue.h"
 #include "resources.h"
@@ -245,8 +247,8 @@ static void build_directx_resources(vice_directx_renderer_context_t *context)
         swap_chain_desc.BufferUsage           = DXGI_USAGE_RENDER_TARGET_OUTPUT;
         swap_chain_desc.BufferCount           = 2;                                // use double buffering to enable flip
         swap_chain_desc.Scaling               = DXGI_SCALING_STRETCH;
-        swap_chain_desc.SwapEffect            = DXGI_SWAP_EFFECT_DISCARD;
-        swap_chain_desc.Flags                 = 0;
+        swap_chain_desc.SwapEffect            = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL; // present without a copy by DWM
+        swap_chain_desc.Flags                 = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
         result =
             context->dxgi_factory->CreateSwapChainForHwnd(
@@ -258,14 +260,42 @@ static void build_directx_resources(vice_directx_renderer_context_t *context)
                 &context->d3d_swap_chain
             );
         if (FAILED(result))
+        {
+            /* The waitable flip model needs Windows 8.1, fall back to the blt model */
+            swap_chain_desc.SwapEffect        = DXGI_SWAP_EFFECT_DISCARD;
+            swap_chain_desc.Flags             = 0;
+
+            result =
+                context->dxgi_factory->CreateSwapChainForHwnd(
+                    context->d3d_device,
+                    context->window,
+                    &swap_chain_desc,
+                    NULL,
+                    NULL,
+                    &context->d3d_swap_chain
+                );
+        }
+        if (FAILED(result))
         {
             vice_directx_impl_log_windows_error("d3d_swap_chain");
             vice_directx_destroy_context_impl(context);
             return;
         }
 
-        // Ensure that DXGI doesn't queue more than one frame at a time.
-        context->dxgi_device->SetMaximumFrameLatency(1);
+        if (swap_chain_desc.Flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT) {
+            IDXGISwapChain2 *swap_chain2;
+
+            result = context->d3d_swap_chain->QueryInterface(__uuidof(IDXGISwapChain2), (void **)&swap_chain2);
+            if (SUCCEEDED(result)) {
+                // Queue at most one frame, the render thread waits for its turn before drawing.
+                swap_chain2->SetMaximumFrameLatency(1);
+                context->frame_latency_waitable = swap_chain2->GetFrameLatencyWaitableObject();
+                swap_chain2->Release();
+            }
+        } else {
+            // Ensure that DXGI doesn't queue more than one frame at a time.
+            context->dxgi_device->SetMaximumFrameLatency(1);
+        }
     }
 
     /*
@@ -316,6 +346,10 @@ static void destroy_size_dependent_resources(vice_directx_renderer_context_t *co
 {
     DX_RELEASE(context->dxgi_bitmap);
     DX_RELEASE(context->dxgi_surface);
+    if (context->frame_latency_waitable) {
+        CloseHandle(context->frame_latency_waitable);
+        context->frame_latency_waitable = NULL;
+    }
     DX_RELEASE(context->d3d_swap_chain);
     DX_RELEASE(context->dxgi_factory);
     DX_RELEASE(context->dxgi_adapter);
@@ -325,6 +359,7 @@ static void destroy_device_dependent_resources(vice_directx_renderer_context_t *
 {
     DX_RELEASE(context->render_bitmap);
     DX_RELEASE(context->previous_frame_render_bitmap);
+    context->render_bitmap_complete = false;
 
     DX_RELEASE(context->d2d_effect_scale);
     DX_RELEASE(context->d2d_effect_combine);
@@ -344,9 +379,57 @@ void vice_directx_destroy_context_impl(vice_directx_renderer_context_t *context)
     destroy_device_dependent_resources(context);
 }
 
+/** \brief Render the RGBA pixels of a backbuffer to the frame, on the render thread */
+static void render_deferred_frame(vice_directx_renderer_context_t *context, backbuffer_t *backbuffer)
+{
+    unsigned int size = backbuffer->width * backbuffer->height * 4;
+
+    if (context->frame_size < size) {
+        lib_free(context->frame);
+        context->frame = (unsigned char *)lib_malloc(size);
+        context->frame_size = size;
+    }
+
+    memset(backbuffer->changed_rows, 0, backbuffer->height);
+    video_render_deferred_run(backbuffer->deferred, context->frame, backbuffer->width * 4, backbuffer->changed_rows);
+}
+
+/** \brief Copy the runs of changed rows to the bitmap */
+static HRESULT copy_changed_rows(ID2D1Bitmap *bitmap, const unsigned char *pixels,
+                                 unsigned int width, unsigned int height,
+                                 const unsigned char *changed_rows)
+{
+    HRESULT result = S_OK;
+    unsigned int row_bytes = width * 4;
+    unsigned int y = 0;
+
+    while (y < height) {
+        unsigned int first;
+
+        if (!changed_rows[y]) {
+            y++;
+            continue;
+        }
+        first = y;
+        while (y < height && changed_rows[y]) {
+            y++;
+        }
+
+        D2D1_RECT_U band_rect = D2D1::RectU(0, first, width, y);
+
+        result = bitmap->CopyFromMemory(&band_rect, pixels + first * row_bytes, row_bytes);
+        if (FAILED(result)) {
+            break;
+        }
+    }
+
+    return result;
+}
+
 static void build_render_bitmap(vice_directx_renderer_context_t *context, backbuffer_t *backbuffer)
 {
     HRESULT result = S_OK;
+    const unsigned char *pixels;
 
     if (context->d2d_device_context) {
         if (backbuffer->interlace_field != context->current_interlace_field) {
@@ -361,6 +444,7 @@ static void build_render_bitmap(vice_directx_renderer_context_t *context, backbu
             context->bitmap_width                 = swap_width;
             context->bitmap_height                = swap_height;
             context->current_interlace_field      = backbuffer->interlace_field;
+            context->render_bitmap_complete       = false;
         }
 
         /* Is it sill the right size? */
@@ -368,6 +452,7 @@ static void build_render_bitmap(vice_directx_renderer_context_t *context, backbu
         if (context->render_bitmap && (context->bitmap_width != backbuffer->width || context->bitmap_height != backbuffer->height)) {
             /* Nope, release it and let another be created */
             DX_RELEASE(context->render_bitmap);
+            context->render_bitmap_complete = false;
         }
 
         /* Create bitmaps, if needed */
@@ -400,19 +485,34 @@ static void build_render_bitmap(vice_directx_renderer_context_t *context, backbu
         context->interlaced = backbuffer->interlaced;
         context->pixel_aspect_ratio = backbuffer->pixel_aspect_ratio;
 
-        /* Copy the emulated screen to the Bitmap */
-        D2D1_RECT_U bitmap_rect = D2D1::RectU(0, 0, backbuffer->width, backbuffer->height);
+        /* the RGBA pixels were rendered to the frame */
+        pixels = backbuffer->render_deferred ? context->frame : backbuffer->pixel_data;
 
-        result =
-            context->render_bitmap->CopyFromMemory(
-                &bitmap_rect,
-                backbuffer->pixel_data,
-                backbuffer->width * 4);
+        /* Copy the emulated screen to the Bitmap, only the changed rows when it has the previous frame */
+        if (backbuffer->changed_rows && context->render_bitmap_complete) {
+            result =
+                copy_changed_rows(
+                    context->render_bitmap,
+                    pixels,
+                    backbuffer->width,
+                    backbuffer->height,
+                    backbuffer->changed_rows);
+        } else {
+            D2D1_RECT_U bitmap_rect = D2D1::RectU(0, 0, backbuffer->width, backbuffer->height);
+
+            result =
+                context->render_bitmap->CopyFromMemory(
+                    &bitmap_rect,
+                    pixels,
+                    backbuffer->width * 4);
+        }
         if (FAILED(result)) {
             vice_directx_impl_log_windows_error("CopyFromMemory");
             DX_RELEASE(context->render_bitmap);
+            context->render_bitmap_complete = false;
             return;
         }
+        context->render_bitmap_complete = backbuffer->changed_rows != NULL;
     }
 }
 
@@ -531,14 +631,22 @@ void vice_directx_impl_async_render(void *job_data, void *pool_data)
         context->resized = false;
     }
 
-    RENDER_LOCK();
-
     /*
      * Update the bitmaps. All need to be processed for correct interlace rendering,
      * especially when the monitor is open and stepping through code.
      */
 
     backbuffer = render_queue_dequeue_for_display(context->render_queue);
+
+    if (backbuffer && backbuffer->render_deferred) {
+        /* the emulation thread may refresh the canvas meanwhile */
+        CANVAS_UNLOCK();
+        render_deferred_frame(context, backbuffer);
+        CANVAS_LOCK();
+    }
+
+    RENDER_LOCK();
+
     if (backbuffer) {
         build_render_bitmap(context, backbuffer);
         render_queue_return_to_pool(context->render_queue, backbuffer);
@@ -558,6 +666,14 @@ void vice_directx_impl_async_render(void *job_data, void *pool_data)
         return;
     }
 
+    /*
+     * With the flip model swap chain, wait here until it takes another frame
+     * rather than in Present1(), so the frame drawn is the latest one.
+     */
+    if (context->frame_latency_waitable) {
+        WaitForSingleObjectEx(context->frame_latency_waitable, 1000, TRUE);
+    }
+
     /* Each frame, set the backbuffer bitmap as the Direct2D render target. */
     context->d2d_device_context->SetTarget(context->dxgi_bitmap);
 
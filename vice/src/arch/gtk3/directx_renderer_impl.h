@@ -34,6 +34,7 @@
 #include <windows.h>
 
 #include <d3d11_1.h>
+#include <dxgi1_3.h>
 #include <d2d1_1.h>
 #include <glib.h>
 #include <pthread.h>
@@ -84,12 +85,19 @@ typedef struct vice_directx_renderer_context_s {
     IDXGIAdapter *dxgi_adapter;
     IDXGIFactory2 *dxgi_factory;
     IDXGISwapChain1 *d3d_swap_chain;
+
+    /** \brief signalled when the swap chain takes the next frame, NULL without a flip model swap chain */
+    HANDLE frame_latency_waitable;
+
     IDXGISurface *dxgi_surface;
     ID2D1Bitmap1 *dxgi_bitmap;
 
     /** \brief Direct2D bitmap used to get emu bitmap into the GPU */
     ID2D1Bitmap *render_bitmap;
 
+    /** \brief render_bitmap holds the previous frame, only the changed rows need uploading */
+    bool render_bitmap_complete;
+
     /** \brief size of the current gpu bitmap in pixels */
     unsigned int bitmap_width;
 
@@ -144,6 +152,21 @@ typedef struct vice_directx_renderer_context_s {
     /** \brief the even/odd of the most recent interlaced field */
     int current_interlace_field;
 
+    /** \brief RGBA pixels of the emulated frame, rendered on the render thread */
+    unsigned char *frame;
+
+    /** \brief size of the frame allocation in bytes */
+    unsigned int frame_size;
+
+    /** \brief size of the frame the emulation thread last handed over */
+    unsigned int frame_width;
+
+    /** \brief size of the frame the emulation thread last handed over */
+    unsigned int frame_height;
+
+    /** \brief the next frame must be rendered in full */
+    bool frame_reset;
+
 } vice_directx_renderer_context_t;
 
 void vice_directx_impl_log_windows_error(const char *prefix);
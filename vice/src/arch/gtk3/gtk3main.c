@@ -38,6 +38,7 @@
 #include "main.h"
 #include "mainlock.h"
 #include "render_thread.h"
+#include "tracezone.h"
 #include "ui.h"
 #include "video.h"
 
@@ -67,6 +68,8 @@ int main(int argc, char **argv)
      */
     archdep_set_main_thread();
 
+    TRACEZONE_THREAD_NAME("ui");
+
     int init_result = main_program(argc, argv);
     if (init_result) {
         return init_result;
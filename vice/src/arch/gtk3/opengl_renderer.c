@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <gtk/gtk.h>
 #include <math.h>
+#include <string.h>
 
 #ifdef MACOS_COMPILE
 #include <CoreGraphics/CGDirectDisplay.h>
@@ -47,6 +48,7 @@
 #include "render_queue.h"
 #include "resources.h"
 #include "sysfile.h"
+#include "tracezone.h"
 #include "ui.h"
 #include "uistatusbar.h"
 #include "util.h"
@@ -155,6 +157,7 @@ static void vice_opengl_destroy_context(video_canvas_t *canvas)
 
     pthread_mutex_destroy(&context->render_lock);
 
+    lib_free(context->frame);
     lib_free(context);
 
     canvas->renderer_context = NULL;
@@ -190,6 +193,12 @@ static void on_widget_realized(GtkWidget *widget, gpointer data)
         context->shader_builtin_interlaced  = create_shader_program("viewport.vert", "builtin-interlaced.frag");
         context->shader_bicubic             = create_shader_program("viewport.vert", "bicubic.frag");
         context->shader_bicubic_interlaced  = create_shader_program("viewport.vert", "bicubic-interlaced.frag");
+        context->shader_crt_pal             = create_shader_program("viewport.vert", "crt-pal.frag");
+
+        glGenTextures(1, &context->color_table_texture);
+        glGenTextures(1, &context->gamma_table_texture);
+        /* upload the tables with the first indexed frame */
+        context->crt_tables_changed = true;
 
         glGenBuffers(1, &context->vbo);
         glBindBuffer(GL_ARRAY_BUFFER, context->vbo);
@@ -201,6 +210,17 @@ static void on_widget_realized(GtkWidget *widget, gpointer data)
     glGenTextures(1, &context->current_frame_texture);
     glGenTextures(1, &context->previous_frame_texture);
 
+    /* the objects of a previous context went away with it */
+    context->texture_storage = !context->gl_context_is_legacy && GLEW_ARB_texture_storage;
+    context->storage_texture[0] = context->current_frame_texture;
+    context->storage_texture[1] = context->previous_frame_texture;
+    context->storage_width[0] = context->storage_width[1] = 0;
+    context->pbo_streaming = !context->gl_context_is_legacy && GLEW_ARB_buffer_storage;
+    memset(context->pbo_fence, 0, sizeof(context->pbo_fence));
+    context->pbo_size = 0;
+    context->pbo_next = 0;
+    context->frame_fence = NULL;
+
     vice_opengl_renderer_clear_current(context);
 
     /* Create an exclusive single thread 'pool' for executing render jobs */
@@ -326,6 +346,75 @@ static void vice_opengl_update_context(video_canvas_t *canvas, unsigned int widt
     CANVAS_UNLOCK();
 }
 
+/** \brief Can the CRT emulation of the next frame be done by shader_crt_pal?
+ *
+ * Only for the PAL renderers with the delay line on U and V, everything
+ * else is still rendered on the CPU.
+ */
+static bool crt_shader_usable(video_canvas_t *canvas, context_t *context)
+{
+    video_render_config_t *config = canvas->videoconfig;
+
+    return context->shader_crt_pal
+        && config->glfilter == VIDEO_GLFILTER_CRT
+        && config->filter == VIDEO_FILTER_CRT
+        && (config->rendermode == VIDEO_RENDER_PAL_NTSC_1X1
+            || config->rendermode == VIDEO_RENDER_PAL_NTSC_2X2)
+        && canvas->viewport->crt_type != VIDEO_CRT_TYPE_NTSC
+        && config->video_resources.delaylinetype == 0
+        && !config->interlaced;
+}
+
+/** \brief Take a copy of the tables for shader_crt_pal if they changed
+ *
+ * Called with the canvas lock held, the render thread uploads the copy.
+ */
+static void crt_tables_update(video_canvas_t *canvas, context_t *context)
+{
+    video_render_config_t *config = canvas->videoconfig;
+    video_render_color_tables_t *color_tab = &config->color_tables;
+    int32_t color_table[256 * 2 * 4];
+    uint32_t gamma_table[768 * 3];
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        int32_t *even = &color_table[i * 4];
+        int32_t *odd = &color_table[(256 + i) * 4];
+
+        even[0] = odd[0] = color_tab->ytableh[i];
+        even[1] = odd[1] = color_tab->ytablel[i];
+        even[2] = color_tab->cbtable[i];
+        even[3] = color_tab->crtable[i];
+        odd[2] = color_tab->cbtable_odd[i];
+        odd[3] = color_tab->crtable_odd[i];
+    }
+
+    /* the channels are where the renderers put them, each gamma table only
+       fills its own */
+    for (i = 0; i < 768; i++) {
+        gamma_table[i] = color_tab->gamma_red[i]
+                       | color_tab->gamma_grn[i]
+                       | color_tab->gamma_blu[i]
+                       | color_tab->alpha;
+    }
+    for (i = 0; i < 768 * 2; i++) {
+        gamma_table[768 + i] = color_tab->gamma_red_fac[i]
+                             | color_tab->gamma_grn_fac[i]
+                             | color_tab->gamma_blu_fac[i]
+                             | color_tab->alpha;
+    }
+
+    if (memcmp(color_table, context->crt_color_table, sizeof(color_table))
+        || memcmp(gamma_table, context->crt_gamma_table, sizeof(gamma_table))) {
+        memcpy(context->crt_color_table, color_table, sizeof(color_table));
+        memcpy(context->crt_gamma_table, gamma_table, sizeof(gamma_table));
+        context->crt_tables_changed = true;
+    }
+
+    context->crt_oddlines_offset = (int)(((float)config->video_resources.pal_oddlines_offset * (1.5f / 2000.0f) - (1.5f / 2.0f - 1.0f)) * (1 << 5));
+    context->crt_double_size = config->rendermode == VIDEO_RENDER_PAL_NTSC_2X2;
+}
+
 /** \brief It's time to draw a complete emulated frame */
 static void vice_opengl_refresh_rect(video_canvas_t *canvas,
                                      unsigned int xs, unsigned int ys,
@@ -335,6 +424,12 @@ static void vice_opengl_refresh_rect(video_canvas_t *canvas,
     context_t *context;
     backbuffer_t *backbuffer;
     int pixel_data_size_bytes;
+    unsigned int width;
+    unsigned int height;
+    bool indexed;
+    bool reset;
+    unsigned int indexed_width = 0;
+    unsigned int indexed_height = 0;
 
     CANVAS_LOCK();
 
@@ -344,26 +439,85 @@ static void vice_opengl_refresh_rect(video_canvas_t *canvas,
         return;
     }
 
+    TRACEZONE_BEGIN(TRACEZONE_RENDER_HANDOFF);
+
+    /* With the CRT shader, the palette indices are uploaded as they are */
+    indexed = crt_shader_usable(canvas, context);
+
+    width = context->emulated_width_next;
+    height = context->emulated_height_next;
+
+    if (!indexed) {
+        /*
+         * The render thread renders to the frame kept in the context, only the
+         * lines that changed since the last frame, unless the frame changed
+         * size or missed some of them.
+         */
+        if (context->frame_width != width || context->frame_height != height) {
+            context->frame_width = width;
+            context->frame_height = height;
+            context->frame_reset = true;
+        }
+    } else {
+        /* the frame misses what is only in the indexed frames */
+        context->frame_reset = true;
+    }
+
     /* Obtain an unused backbuffer to render to */
-    pixel_data_size_bytes = context->emulated_width_next * context->emulated_height_next * 4;
+    if (indexed) {
+        indexed_width = width / canvas->videoconfig->scalex;
+        indexed_height = height / canvas->videoconfig->scaley;
+        pixel_data_size_bytes = indexed_width * indexed_height;
+    } else {
+        pixel_data_size_bytes = height;
+    }
     backbuffer = render_queue_get_from_pool(context->render_queue, pixel_data_size_bytes);
 
     if (!backbuffer) {
+        /* the lines that changed in this frame never reach the frame */
+        context->frame_reset = true;
         CANVAS_UNLOCK();
+        TRACEZONE_END(TRACEZONE_RENDER_HANDOFF);
         return;
     }
 
-    backbuffer->width = context->emulated_width_next;
-    backbuffer->height = context->emulated_height_next;
+    backbuffer->width = width;
+    backbuffer->height = height;
     backbuffer->pixel_aspect_ratio = context->pixel_aspect_ratio_next;
     backbuffer->interlaced = canvas->videoconfig->interlaced;
     backbuffer->interlace_field = canvas->videoconfig->interlace_field;
+    backbuffer->indexed = indexed;
+    backbuffer->indexed_width = indexed_width;
+    backbuffer->indexed_height = indexed_height;
+    backbuffer->indexed_first_line = ys;
+    backbuffer->render_deferred = !indexed;
 
-    CANVAS_UNLOCK();
+    if (indexed) {
+        backbuffer->changed_rows = NULL;
 
-    video_canvas_render(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, backbuffer->width * 4);
+        CANVAS_UNLOCK();
+        video_canvas_render_indexed(canvas, backbuffer->pixel_data, w, h, xs, ys, xi, yi, indexed_width);
+        CANVAS_LOCK();
+
+        crt_tables_update(canvas, context);
+    } else {
+        /*
+         * Only take what the rendering needs, the CPU filters then run on the
+         * render thread of this canvas. With x128 both canvases are rendered
+         * at the same time, while the emulation goes on.
+         */
+        backbuffer->changed_rows = backbuffer->pixel_data;
+        if (!backbuffer->deferred) {
+            backbuffer->deferred = video_render_deferred_new();
+        }
+        reset = context->frame_reset;
+        context->frame_reset = false;
+
+        CANVAS_UNLOCK();
+        video_canvas_render_deferred(canvas, backbuffer->deferred, w, h, xs, ys, xi, yi, reset);
+        CANVAS_LOCK();
+    }
 
-    CANVAS_LOCK();
     if (context->render_thread) {
         render_queue_enqueue_for_display(context->render_queue, backbuffer);
         render_thread_push_job(context->render_thread, render_thread_render);
@@ -372,6 +526,8 @@ static void vice_opengl_refresh_rect(video_canvas_t *canvas,
         render_queue_return_to_pool(context->render_queue, backbuffer);
     }
     CANVAS_UNLOCK();
+
+    TRACEZONE_END(TRACEZONE_RENDER_HANDOFF);
 }
 
 
@@ -486,8 +642,121 @@ static void vice_opengl_on_ui_frame_clock(GdkFrameClock *clock, video_canvas_t *
 #endif
 }
 
+/** \brief Render the RGBA pixels of a backbuffer to the frame, on the render thread */
+static void render_deferred_frame(context_t *context, backbuffer_t *backbuffer)
+{
+    unsigned int size = backbuffer->width * backbuffer->height * 4;
+
+    if (context->frame_size < size) {
+        lib_free(context->frame);
+        context->frame = lib_malloc(size);
+        context->frame_size = size;
+    }
+
+    memset(backbuffer->changed_rows, 0, backbuffer->height);
+    video_render_deferred_run(backbuffer->deferred, context->frame, backbuffer->width * 4, backbuffer->changed_rows);
+}
+
+/** \brief Wait until the GPU has passed `*fence', then delete it */
+static void fence_wait(GLsync *fence)
+{
+    if (*fence != NULL) {
+        glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(*fence);
+        *fence = NULL;
+    }
+}
+
+/** \brief Bind `*texture' with immutable storage of the given format and size
+ *
+ * Immutable storage can't be specified again, so a frame of another size
+ * or format gets a new texture object.
+ */
+static void frame_texture_storage(context_t *context, GLuint *texture, GLenum format,
+                                  unsigned int width, unsigned int height)
+{
+    int i = (*texture == context->storage_texture[0]) ? 0 : 1;
+
+    if (context->storage_width[i] == width
+        && context->storage_height[i] == height
+        && context->storage_format[i] == format) {
+        glBindTexture(GL_TEXTURE_2D, *texture);
+        return;
+    }
+
+    glDeleteTextures(1, texture);
+    glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_2D, *texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+
+    context->storage_texture[i] = *texture;
+    context->storage_format[i] = format;
+    context->storage_width[i] = width;
+    context->storage_height[i] = height;
+}
+
+/** \brief Bind the next pixel buffer of the ring for an upload of `size' bytes
+ *
+ * \return its persistently mapped memory, or NULL to upload from client
+ *         memory instead
+ */
+static uint8_t *pbo_begin(context_t *context, unsigned int size)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    unsigned int i;
+
+    if (!context->pbo_streaming) {
+        return NULL;
+    }
+
+    if (size > context->pbo_size) {
+        /* a larger frame, replace the ring */
+        for (i = 0; i < OPENGL_PBO_RING; i++) {
+            fence_wait(&context->pbo_fence[i]);
+        }
+        if (context->pbo_size > 0) {
+            glDeleteBuffers(OPENGL_PBO_RING, context->pbo);
+        }
+        glGenBuffers(OPENGL_PBO_RING, context->pbo);
+        for (i = 0; i < OPENGL_PBO_RING; i++) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->pbo[i]);
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+            context->pbo_memory[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+            if (context->pbo_memory[i] == NULL) {
+                log_error(LOG_DEFAULT, "Cannot map the pixel buffers, uploading frames from client memory.");
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                glDeleteBuffers(OPENGL_PBO_RING, context->pbo);
+                context->pbo_size = 0;
+                context->pbo_streaming = false;
+                return NULL;
+            }
+        }
+        context->pbo_size = size;
+        context->pbo_next = 0;
+    }
+
+    i = context->pbo_next;
+    fence_wait(&context->pbo_fence[i]);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, context->pbo[i]);
+
+    return context->pbo_memory[i];
+}
+
+/** \brief Fence the uploads from the pixel buffer bound by pbo_begin() */
+static void pbo_end(context_t *context)
+{
+    context->pbo_fence[context->pbo_next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    context->pbo_next = (context->pbo_next + 1) % OPENGL_PBO_RING;
+}
+
 static void update_frame_textures(context_t *context, backbuffer_t *backbuffer)
 {
+    bool changed_rows_only;
+    const unsigned char *pixels;
+    uint8_t *staging;
+    unsigned int size;
+
     /*
      * Update the OpenGL texture with the new backbuffer bitmap
      */
@@ -500,23 +769,118 @@ static void update_frame_textures(context_t *context, backbuffer_t *backbuffer)
         context->previous_frame_height      = context->current_frame_height;
         context->current_frame_texture      = swap_texture;
         context->current_interlace_field    = backbuffer->interlace_field;
+        context->frame_texture_complete     = false;
     }
 
+    /* Only the changed rows need uploading when the texture has the previous frame */
+    changed_rows_only = backbuffer->changed_rows
+                        && context->frame_texture_complete
+                        && !context->current_frame_indexed
+                        && context->current_frame_width == backbuffer->width
+                        && context->current_frame_height == backbuffer->height;
+
     context->current_frame_width    = backbuffer->width;
     context->current_frame_height   = backbuffer->height;
     context->interlaced             = backbuffer->interlaced;
     context->pixel_aspect_ratio     = backbuffer->pixel_aspect_ratio;
+    context->current_frame_indexed  = backbuffer->indexed;
+    context->current_frame_first_line = backbuffer->indexed_first_line;
+
+    /* the RGBA pixels were rendered to the frame */
+    pixels = backbuffer->render_deferred ? context->frame : backbuffer->pixel_data;
 
+    /*
+     * With a pixel buffer the source given to glTex(Sub)Image2D is an offset
+     * into it, the copy to the GPU happens without the CPU waiting for it.
+     */
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, context->current_frame_texture);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, backbuffer->width);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, backbuffer->width, backbuffer->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, backbuffer->pixel_data);
+    if (backbuffer->indexed) {
+        /* one byte per pixel, integer textures can't be filtered */
+        size = backbuffer->indexed_width * backbuffer->indexed_height;
+        staging = pbo_begin(context, size);
+        if (staging) {
+            memcpy(staging, backbuffer->pixel_data, size);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, backbuffer->indexed_width);
+        if (context->texture_storage) {
+            frame_texture_storage(context, &context->current_frame_texture, GL_R8UI,
+                                  backbuffer->indexed_width, backbuffer->indexed_height);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, backbuffer->indexed_width, backbuffer->indexed_height,
+                            GL_RED_INTEGER, GL_UNSIGNED_BYTE, staging ? NULL : backbuffer->pixel_data);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, backbuffer->indexed_width, backbuffer->indexed_height, 0,
+                         GL_RED_INTEGER, GL_UNSIGNED_BYTE, staging ? NULL : backbuffer->pixel_data);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    } else if (changed_rows_only) {
+        unsigned int row_bytes = backbuffer->width * 4;
+        unsigned int y = 0;
+
+        staging = pbo_begin(context, row_bytes * backbuffer->height);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, backbuffer->width);
+        while (y < backbuffer->height) {
+            unsigned int first;
+
+            if (!backbuffer->changed_rows[y]) {
+                y++;
+                continue;
+            }
+            first = y;
+            while (y < backbuffer->height && backbuffer->changed_rows[y]) {
+                y++;
+            }
+            if (staging) {
+                memcpy(staging + first * row_bytes, pixels + first * row_bytes, (y - first) * row_bytes);
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first, backbuffer->width, y - first, GL_RGBA, GL_UNSIGNED_BYTE,
+                            staging ? (const void *)(uintptr_t)(first * row_bytes) : pixels + first * row_bytes);
+        }
+    } else {
+        size = backbuffer->width * backbuffer->height * 4;
+        staging = pbo_begin(context, size);
+        if (staging) {
+            memcpy(staging, pixels, size);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, backbuffer->width);
+        if (context->texture_storage) {
+            frame_texture_storage(context, &context->current_frame_texture, GL_RGBA8,
+                                  backbuffer->width, backbuffer->height);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, backbuffer->width, backbuffer->height,
+                            GL_RGBA, GL_UNSIGNED_BYTE, staging ? NULL : pixels);
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, backbuffer->width, backbuffer->height, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, staging ? NULL : pixels);
+        }
+    }
+    if (staging) {
+        pbo_end(context);
+    }
+    context->frame_texture_complete = !backbuffer->indexed && backbuffer->changed_rows != NULL;
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (backbuffer->indexed && context->crt_tables_changed) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+        glBindTexture(GL_TEXTURE_2D, context->color_table_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32I, 256, 2, 0, GL_RGBA_INTEGER, GL_INT, context->crt_color_table);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glBindTexture(GL_TEXTURE_2D, context->gamma_table_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 768, 3, 0, GL_RGBA, GL_UNSIGNED_BYTE, context->crt_gamma_table);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        context->crt_tables_changed = false;
+    }
 }
 
 static void legacy_render(video_canvas_t *canvas, float scale_x, float scale_y)
@@ -585,6 +949,60 @@ static void legacy_render(video_canvas_t *canvas, float scale_x, float scale_y)
     glDisable(GL_TEXTURE_2D);
 }
 
+static void crt_shader_render(video_canvas_t *canvas, float scale_x, float scale_y)
+{
+    /* Used for indexed frames, the CRT emulation is done by the shader */
+
+    GLuint program;
+    GLuint position_attribute;
+    GLuint tex_coord_attribute;
+
+    vice_opengl_renderer_context_t *context = (vice_opengl_renderer_context_t *)canvas->renderer_context;
+    program = context->shader_crt_pal;
+
+    glUseProgram(program);
+
+    position_attribute  = glGetAttribLocation(program, "position");
+    tex_coord_attribute = glGetAttribLocation(program, "tex");
+
+    glDisable(GL_BLEND);
+    glBindVertexArray(context->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, context->vbo);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(position_attribute,  4, GL_FLOAT, GL_FALSE, 0, 0);
+    glVertexAttribPointer(tex_coord_attribute, 2, GL_FLOAT, GL_FALSE, 0, (void*)64);
+
+    glUniform4f(glGetUniformLocation(program, "scale"), scale_x, scale_y, 1.0f, 1.0f);
+    glUniform2f(glGetUniformLocation(program, "view_size"), context->native_view_width, context->native_view_height);
+    glUniform1i(glGetUniformLocation(program, "first_line"), context->current_frame_first_line);
+    glUniform1i(glGetUniformLocation(program, "oddlines_offset"), context->crt_oddlines_offset);
+    glUniform1i(glGetUniformLocation(program, "double_size"), context->crt_double_size);
+    glUniform1i(glGetUniformLocation(program, "this_frame"), 0);
+    glUniform1i(glGetUniformLocation(program, "color_table"), 1);
+    glUniform1i(glGetUniformLocation(program, "gamma_table"), 2);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, context->current_frame_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, context->color_table_texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, context->gamma_table_texture);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glDisableVertexAttribArray(position_attribute);
+    glDisableVertexAttribArray(tex_coord_attribute);
+
+    glUseProgram(0);
+}
+
 static void modern_render(video_canvas_t *canvas, float scale_x, float scale_y)
 {
     /* Used when OpenGL 3.2+ is available */
@@ -696,6 +1114,7 @@ static void render(void *job_data, void *pool_data)
 
     if (job == render_thread_init) {
         archdep_thread_init();
+        TRACEZONE_THREAD_NAME("render");
 
 #if defined(MACOS_COMPILE)
         vice_macos_set_render_thread_priority();
@@ -715,17 +1134,30 @@ static void render(void *job_data, void *pool_data)
         return;
     }
 
+    TRACEZONE_BEGIN(TRACEZONE_RENDER);
+
     CANVAS_LOCK();
     backbuffer = render_queue_dequeue_for_display(context->render_queue);
 
     if (context->render_skip) {
         if (backbuffer) {
             render_queue_return_to_pool(context->render_queue, backbuffer);
+            /* the rows changed by the dropped frame never reach the texture */
+            context->frame_texture_complete = false;
+            context->frame_reset = true;
         }
         CANVAS_UNLOCK();
+        TRACEZONE_END(TRACEZONE_RENDER);
         return;
     }
 
+    if (backbuffer && backbuffer->render_deferred) {
+        /* the emulation thread may refresh the canvas meanwhile */
+        CANVAS_UNLOCK();
+        render_deferred_frame(context, backbuffer);
+        CANVAS_LOCK();
+    }
+
     RENDER_LOCK();
 
     vice_opengl_renderer_make_current(context);
@@ -790,6 +1222,9 @@ static void render(void *job_data, void *pool_data)
         context->cached_vsync_resource = vsync;
     }
 
+    /* At most one frame is in flight on the GPU */
+    fence_wait(&context->frame_fence);
+
     /* Begin with a cleared framebuffer */
     glClearColor(context->native_view_bg_r, context->native_view_bg_g, context->native_view_bg_b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -797,16 +1232,26 @@ static void render(void *job_data, void *pool_data)
     /* Invoke the appropriate renderer */
     if (context->gl_context_is_legacy) {
         legacy_render(canvas, scale_x, scale_y);
+    } else if (context->current_frame_indexed) {
+        crt_shader_render(canvas, scale_x, scale_y);
     } else {
         modern_render(canvas, scale_x, scale_y);
     }
 
     vice_opengl_renderer_present_backbuffer(context);
-    glFinish();
+    if (context->gl_context_is_legacy) {
+        glFinish();
+    } else {
+        /* waited for before the next frame is drawn, the uploads and layout
+           of that frame overlap with the GPU finishing this one */
+        context->frame_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
 
     vice_opengl_renderer_clear_current(context);
 
     RENDER_UNLOCK();
+
+    TRACEZONE_END(TRACEZONE_RENDER);
 }
 
 static void vice_opengl_set_palette(video_canvas_t *canvas)
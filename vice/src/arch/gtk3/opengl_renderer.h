@@ -41,6 +41,9 @@
 #include "render_thread.h"
 #include "videoarch.h"
 
+/** \brief Number of pixel buffers the frames are streamed through */
+#define OPENGL_PBO_RING 3
+
 /** \brief A renderer that uses OpenGL to render to a native child window.
  *
  * Because OpenGL + GTK3 just doesn't work that well, this.
@@ -129,6 +132,24 @@ typedef struct vice_opengl_renderer_context_s {
     /** \brief GLSL shader */
     GLuint shader_bicubic_interlaced;
 
+    /** \brief GLSL shader doing the PAL CRT emulation on palette indices */
+    GLuint shader_crt_pal;
+
+    /** \brief Luma and chroma tables of the palette, for shader_crt_pal */
+    GLuint color_table_texture;
+
+    /** \brief Gamma tables of the palette, for shader_crt_pal */
+    GLuint gamma_table_texture;
+
+    /** \brief CRT tables to upload to color_table_texture and gamma_table_texture */
+    int32_t crt_color_table[256 * 2 * 4];
+    uint32_t crt_gamma_table[768 * 3];
+    bool crt_tables_changed;
+
+    /** \brief CRT settings for shader_crt_pal */
+    int crt_oddlines_offset;
+    bool crt_double_size;
+
     /** \brief The vertex buffer object that holds our vertex data. */
     GLuint vbo;
 
@@ -142,12 +163,37 @@ typedef struct vice_opengl_renderer_context_s {
     bool interlaced;
     int current_interlace_field;
     float pixel_aspect_ratio;
+    bool current_frame_indexed;
+    int current_frame_first_line;
+
+    /** \brief True if current_frame_texture holds the last RGBA frame uploaded */
+    bool frame_texture_complete;
 
     /** \brief The texture identifier for the GPU's copy of our  machine display. */
     GLuint previous_frame_texture;
     unsigned int previous_frame_width;
     unsigned int previous_frame_height;
 
+    /** \brief Frame textures get immutable storage (GL_ARB_texture_storage),
+     *  replaced only when the size or format of the frame changes */
+    bool texture_storage;
+    GLuint storage_texture[2];
+    GLenum storage_format[2];
+    unsigned int storage_width[2];
+    unsigned int storage_height[2];
+
+    /** \brief Frames are uploaded through a ring of persistently mapped pixel
+     *  buffers (GL_ARB_buffer_storage), each reused once its fence has passed */
+    bool pbo_streaming;
+    GLuint pbo[OPENGL_PBO_RING];
+    uint8_t *pbo_memory[OPENGL_PBO_RING];
+    GLsync pbo_fence[OPENGL_PBO_RING];
+    unsigned int pbo_size;
+    unsigned int pbo_next;
+
+    /** \brief Passed when the GPU has finished the frame presented last */
+    GLsync frame_fence;
+
     /** \brief size of the next frame to be emulated */
     unsigned int emulated_width_next;
 
@@ -157,6 +203,18 @@ typedef struct vice_opengl_renderer_context_s {
     /** \brief pixel aspect ratio of the next frame to be emulated */
     float pixel_aspect_ratio_next;
 
+    /** \brief The emulated screen, only the lines that changed are rendered again.
+     *  Rendered to by the render thread. */
+    uint8_t *frame;
+    unsigned int frame_size;
+
+    /** \brief Size of the frame requested by the last backbuffer */
+    unsigned int frame_width;
+    unsigned int frame_height;
+
+    /** \brief If true, frame must be rendered completely */
+    bool frame_reset;
+
     /** \brief when the last frame was rendered */
     unsigned long last_render_time;
 
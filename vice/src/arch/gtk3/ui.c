@@ -94,6 +94,7 @@
 #include "mainlock.h"
 #include "mixerwidget.h"
 #include "monitor.h"
+#include "render_queue.h"
 #include "resources.h"
 #include "settings_keyboard.h"
 #include "settings_rom.h"
@@ -2086,6 +2087,9 @@ void ui_destroy_main_window(int index)
  */
 int ui_cmdline_options_init(void)
 {
+    if (render_queue_cmdline_options_init() < 0) {
+        return -1;
+    }
     return cmdline_register_options(cmdline_options_common);
 }
 
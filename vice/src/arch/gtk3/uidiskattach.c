@@ -530,7 +530,8 @@ static GtkWidget *create_disk_attach_dialog(gint unit, gint drive)
      * the "response" signal is emitted: a response ID */
     g_signal_connect(dialog, "response",
             G_CALLBACK(on_response), GINT_TO_POINTER(0));
-    g_signal_connect(dialog, "update-preview",
+    /* the preview is read on a worker thread, no need to stop the emulation */
+    g_signal_connect_unlocked(dialog, "update-preview",
             G_CALLBACK(on_update_preview), NULL);
     g_signal_connect_unlocked(dialog, "selection-changed",
             G_CALLBACK(on_selection_changed), NULL);
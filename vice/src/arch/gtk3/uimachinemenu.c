@@ -571,6 +571,10 @@ static ui_menu_item_t snapshot_menu[] = {
         .type     = UI_MENU_TYPE_ITEM_ACTION,
         .action   = ACTION_SNAPSHOT_QUICKSAVE
     },
+    {   .label    = "Rewind to previous state",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_SNAPSHOT_REWIND
+    },
     UI_MENU_SEPARATOR,
 
     {   .label    = "Start recording events",
@@ -589,6 +593,14 @@ static ui_menu_item_t snapshot_menu[] = {
         .type     = UI_MENU_TYPE_ITEM_ACTION,
         .action   = ACTION_HISTORY_PLAYBACK_STOP
     },
+    {   .label    = "Seek playback back",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_HISTORY_PLAYBACK_SEEK_BACK
+    },
+    {   .label    = "Seek playback forward",
+        .type     = UI_MENU_TYPE_ITEM_ACTION,
+        .action   = ACTION_HISTORY_PLAYBACK_SEEK_FORWARD
+    },
     {   .label    = "Set recording milestone",
         .type     = UI_MENU_TYPE_ITEM_ACTION,
         .action   = ACTION_HISTORY_MILESTONE_SET
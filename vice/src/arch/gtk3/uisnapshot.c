@@ -333,7 +333,7 @@ static void quicksave_snapshot_trap(uint16_t addr, void *data)
     vsync_suspend_speed_eval();
     sound_suspend();
 
-    if (machine_write_snapshot(filename, TRUE, TRUE, 0) < 0) {
+    if (machine_write_snapshot_async(filename, TRUE, TRUE) < 0) {
         snapshot_display_error();
     }
     lib_free(filename);
@@ -274,6 +274,9 @@ typedef struct ui_sb_state_s {
     /** \brief Location on the tape of datasette #1 */
     int tape_counter[TAPEPORT_MAX_PORTS];
 
+    /** \brief true if the tape control or motor status has been changed */
+    bool tape_status_updated[TAPEPORT_MAX_PORTS];
+
     /** \brief Which drives are to be displayed in the status bar.
      *
      *  This is a bitmask, with bits 0-3 representing drives 8-11,
@@ -332,6 +335,9 @@ typedef struct ui_sb_state_s {
      *  secondary fire button, tertiary fire button. */
     int current_joyports[JOYPORT_MAX_PORTS];
 
+    /** \brief true if the state of a joyport has been changed */
+    bool current_joyports_updated[JOYPORT_MAX_PORTS];
+
     /** \brief Which joystick ports are actually available.
      *
      *  This is a bitmask representing notional ports 0-4, which are
@@ -533,30 +539,6 @@ static void disk_dir_autostart_callback(const char *image,
                                         unsigned int drive);
 
 
-/** \brief  Trigger redraw of a widget on the UI thread
- *
- * \param[in,out]   user_data   widget to redraw
- *
- * \return  FALSE
- */
-static gboolean redraw_widget_on_ui_thread_impl(gpointer user_data)
-{
-    gtk_widget_queue_draw((GtkWidget *)user_data);
-
-    return FALSE;
-}
-
-/** \brief Queue a redraw of widget on the ui thread.
- *
- * It's not safe to ask a widget to redraw from the vice thread.
- *
- * \param[in,out]   widget  widget to redraw
- */
-static void redraw_widget_on_ui_thread(GtkWidget *widget)
-{
-    gdk_threads_add_timeout(0, redraw_widget_on_ui_thread_impl, (gpointer)widget);
-}
-
 /** \brief Get a locked reference to sb_state */
 static ui_sb_state_t *lock_sb_state(void)
 {
@@ -2946,24 +2928,12 @@ void ui_display_joyport(uint16_t *joyport)
 
     for (i = 0; i < JOYPORT_MAX_PORTS; ++i) {
         /* Compare the new value to the current one, set the new
-         * value, and queue a redraw if and only if there was a
+         * value, and flag a redraw if and only if there was a
          * change. And yes, the input joystick ports are 1-indexed. I
          * don't know either. */
         if (sb_state->current_joyports[i] != joyport[i+1]) {
-            int j;
             sb_state->current_joyports[i] = joyport[i+1];
-            for (j = 0; j < MAX_STATUS_BARS; ++j) {
-                if (allocated_bars[j].joysticks) {
-                    GtkWidget *grid;
-                    GtkWidget *widget;
-
-                    grid = gtk_bin_get_child(GTK_BIN(allocated_bars[j].joysticks));
-                    widget = gtk_grid_get_child_at(GTK_GRID(grid), i + 1, 0);
-                    if (widget) {
-                        redraw_widget_on_ui_thread(widget);
-                    }
-                }
-            }
+            sb_state->current_joyports_updated[i] = true;
         }
     }
 
@@ -3007,15 +2977,8 @@ void ui_display_tape_control_status(int port, int control)
     sb_state = lock_sb_state();
 
     if (control != sb_state->tape_control[port]) {
-        int i;
         sb_state->tape_control[port] = control;
-
-        for (i = 0; i < MAX_STATUS_BARS; ++i) {
-            GtkWidget *motor = tape_get_motor_widget(i, port);
-            if (motor != NULL) {
-                redraw_widget_on_ui_thread(motor);
-            }
-        }
+        sb_state->tape_status_updated[port] = true;
     }
 
     unlock_sb_state();
@@ -3052,16 +3015,8 @@ void ui_display_tape_motor_status(int port, int motor)
     sb_state = lock_sb_state();
 
     if (motor != sb_state->tape_motor_status[port]) {
-        int i;
         sb_state->tape_motor_status[port] = motor;
-
-        for (i = 0; i < MAX_STATUS_BARS; ++i) {
-            GtkWidget *widget = tape_get_motor_widget(i, port);
-
-            if (widget != NULL) {
-                redraw_widget_on_ui_thread(widget);
-            }
-        }
+        sb_state->tape_status_updated[port] = true;
     }
 
     unlock_sb_state();
@@ -3433,6 +3388,13 @@ void ui_update_statusbars(void)
     /* Reset any 'updated needed' flags */
     sb_state->drives_layout_needed = false;
 
+    for (j = 0; j < TAPEPORT_MAX_PORTS; ++j) {
+        sb_state->tape_status_updated[j] = false;
+    }
+    for (j = 0; j < JOYPORT_MAX_PORTS; ++j) {
+        sb_state->current_joyports_updated[j] = false;
+    }
+
     for (j = 0; j < NUM_DISK_UNITS; ++j) {
         sb_state->current_drive_track_str_updated[j][0] = false;
         sb_state->current_drive_track_str_updated[j][1] = false;
@@ -3488,6 +3450,14 @@ void ui_update_statusbars(void)
                 }
                 bar->displayed_tape_counter[j] = count;
             }
+
+            if (state_snapshot.tape_status_updated[j]) {
+                GtkWidget *motor = tape_get_motor_widget(i, j);
+
+                if (motor != NULL) {
+                    gtk_widget_queue_draw(motor);
+                }
+            }
         }
 
         /*
@@ -3498,6 +3468,20 @@ void ui_update_statusbars(void)
             update_joyport_layout();
         }
 
+        if (bar->joysticks != NULL) {
+            GtkWidget *grid = gtk_bin_get_child(GTK_BIN(bar->joysticks));
+
+            for (j = 0; j < JOYPORT_MAX_PORTS; ++j) {
+                if (state_snapshot.current_joyports_updated[j]) {
+                    GtkWidget *widget = gtk_grid_get_child_at(GTK_GRID(grid), j + 1, 0);
+
+                    if (widget != NULL) {
+                        gtk_widget_queue_draw(widget);
+                    }
+                }
+            }
+        }
+
         /*
          * Drive track, half track, and led
          */
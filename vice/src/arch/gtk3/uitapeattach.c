@@ -432,10 +432,11 @@ static GtkWidget *create_tape_attach_dialog(int port)
                      "response",
                      G_CALLBACK(on_response),
                      GINT_TO_POINTER(port));
-    g_signal_connect(dialog,
-                     "update-preview",
-                     G_CALLBACK(on_update_preview),
-                     NULL);
+    /* the preview is read on a worker thread, no need to stop the emulation */
+    g_signal_connect_unlocked(dialog,
+                              "update-preview",
+                              G_CALLBACK(on_update_preview),
+                              NULL);
     g_signal_connect_unlocked(dialog,
                               "selection-changed",
                               G_CALLBACK(on_selection_changed),
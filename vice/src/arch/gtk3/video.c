@@ -100,8 +100,8 @@ int ui_set_glfilter(int val, void *canvas)
     if (val < 0) {
         val = 0;
     }
-    if (val > 2) {
-        val = 2;
+    if (val > VIDEO_GLFILTER_CRT) {
+        val = VIDEO_GLFILTER_CRT;
     }
     cv->videoconfig->glfilter = val;
     return 0;
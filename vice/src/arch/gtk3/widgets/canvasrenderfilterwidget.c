@@ -53,6 +53,7 @@ static const vice_gtk3_radiogroup_entry_t filters[] = {
     { "Nearest neighbor",   VIDEO_GLFILTER_NEAREST  },
     { "Bilinear",           VIDEO_GLFILTER_BILINEAR  },
     { "Bicubic",            VIDEO_GLFILTER_BICUBIC  },
+    { "CRT shader",         VIDEO_GLFILTER_CRT  },
     { NULL,                 -1 }
 };
 
@@ -27,6 +27,7 @@
 #include "vice.h"
 
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -69,6 +70,62 @@ static GtkWidget *content_view = NULL;
 static GtkWidget *parent_dialog;
 
 
+/*
+ * Image contents are read on a worker thread, so browsing a large directory
+ * with the cursor keys doesn't block the UI (or the emulation, when a dialog
+ * takes the main lock). Only the newest request is read, requests made stale
+ * by a newer one are skipped by the worker. The contents read are cached by
+ * path, modification time and size, so going back to an image shows it at
+ * once.
+ */
+
+/** \brief  Number of image contents kept in the cache
+ */
+#define PREVIEW_CACHE_SIZE  64
+
+
+/** \brief  Request to read the contents of an image on the worker thread
+ */
+typedef struct preview_request_s {
+    gchar *path;                    /**< path to image file */
+    read_contents_func_type func;   /**< function to read the contents */
+    gint generation;                /**< value of preview_generation when made */
+    gint64 mtime;                   /**< modification time, -1 if unknown */
+    gint64 size;                    /**< file size, -1 if unknown */
+    gboolean done;                  /**< contents were read (not skipped) */
+    image_contents_t *contents;     /**< contents, NULL if unreadable */
+} preview_request_t;
+
+
+/** \brief  Cached contents of an image
+ */
+typedef struct preview_cache_entry_s {
+    gchar *path;                    /**< path to image file, NULL if unused */
+    read_contents_func_type func;   /**< function used to read the contents */
+    gint64 mtime;                   /**< modification time */
+    gint64 size;                    /**< file size */
+    guint64 last_used;              /**< value of preview_cache_clock when last used */
+    image_contents_t *contents;     /**< contents, NULL if unreadable */
+} preview_cache_entry_t;
+
+
+/** \brief  Worker thread reading image contents
+ */
+static GThreadPool *preview_pool = NULL;
+
+/** \brief  Generation of the newest request, older requests are skipped
+ */
+static gint preview_generation = 0;
+
+/** \brief  Image contents cache
+ */
+static preview_cache_entry_t preview_cache[PREVIEW_CACHE_SIZE];
+
+/** \brief  Counter for finding the least recently used cache entry
+ */
+static guint64 preview_cache_clock = 0;
+
+
 /** \brief  Handler for the "row-activated" event of the view
  *
  * This function handles auto-starting a file selected in the preview. It
@@ -123,15 +180,14 @@ static void on_row_activated(
  * '\<blocks\> "\<filename\>" \<filetype-and-flags\>' and an integer which indicates
  * the file's index in the image's "directory".
  *
- * \param[in]   path    path to image file
+ * \param[in]   contents    image contents, `NULL` if reading the image failed
  *
- * \return  model (empty if reading the image failed)
+ * \return  model
  */
-static GtkListStore *create_model(const char *path)
+static GtkListStore *create_model(image_contents_t *contents)
 {
     GtkListStore *model;
     GtkTreeIter iter;
-    image_contents_t *contents;
     image_contents_file_list_t *entry;
     char *tmp;
     char *sep;
@@ -140,21 +196,6 @@ static GtkListStore *create_model(const char *path)
     int blocks;
 
     model = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_INT);
-    if (path == NULL) {
-        return model;
-    }
-    /* don't try to read from a directory: avoid error messages from
-     * vdrive/fsimage */
-    if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
-        return model;
-    }
-
-    if (content_func == NULL) {
-        log_error(LOG_ERR, "no content-get function specified, bailing!");
-        return model;
-    }
-
-    contents = content_func(path);
     if (contents == NULL) {
         gtk_list_store_append(model, &iter);
         gtk_list_store_set(model, &iter,
@@ -218,27 +259,183 @@ static GtkListStore *create_model(const char *path)
         lib_free(tmp);
         lib_free(utf8);
     }
-    image_contents_destroy(contents);
     return model;
 }
 
 
-/** \brief  Create the view for the content widget
+/** \brief  Create an empty model for the view
  *
- * Creates a GtkTreeView to display the contents of image \a path
+ * \return  model
+ */
+static GtkListStore *create_empty_model(void)
+{
+    return gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_INT);
+}
+
+
+/** \brief  Show a model in the view
+ *
+ * \param[in]   model   model, unreferenced by this function
+ */
+static void set_model(GtkListStore *model)
+{
+    if (content_view != NULL) {
+        gtk_tree_view_set_model(GTK_TREE_VIEW(content_view), GTK_TREE_MODEL(model));
+    }
+    g_object_unref(model);
+}
+
+
+/** \brief  Look up image contents in the cache
  *
  * \param[in]   path    path to image file
+ * \param[in]   func    function to read the contents
+ * \param[in]   mtime   modification time of the file
+ * \param[in]   size    size of the file
+ *
+ * \return  cache entry or `NULL` if not found
+ */
+static preview_cache_entry_t *preview_cache_find(const char *path,
+                                                 read_contents_func_type func,
+                                                 gint64 mtime,
+                                                 gint64 size)
+{
+    int i;
+
+    for (i = 0; i < PREVIEW_CACHE_SIZE; i++) {
+        preview_cache_entry_t *entry = &preview_cache[i];
+
+        if (entry->path != NULL
+                && entry->func == func
+                && entry->mtime == mtime
+                && entry->size == size
+                && strcmp(entry->path, path) == 0) {
+            entry->last_used = ++preview_cache_clock;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+
+/** \brief  Add the contents read by a request to the cache
+ *
+ * The cache takes over the contents of the request, replacing the least
+ * recently used entry if it's full.
+ *
+ * \param[in,out]   request request read by the worker
+ *
+ * \return  cache entry
+ */
+static preview_cache_entry_t *preview_cache_add(preview_request_t *request)
+{
+    preview_cache_entry_t *entry = &preview_cache[0];
+    int i;
+
+    for (i = 0; i < PREVIEW_CACHE_SIZE; i++) {
+        if (preview_cache[i].path == NULL) {
+            entry = &preview_cache[i];
+            break;
+        }
+        if (preview_cache[i].last_used < entry->last_used) {
+            entry = &preview_cache[i];
+        }
+    }
+
+    if (entry->path != NULL) {
+        g_free(entry->path);
+        if (entry->contents != NULL) {
+            image_contents_destroy(entry->contents);
+        }
+    }
+    entry->path = g_strdup(request->path);
+    entry->func = request->func;
+    entry->mtime = request->mtime;
+    entry->size = request->size;
+    entry->last_used = ++preview_cache_clock;
+    entry->contents = request->contents;
+    request->contents = NULL;
+    return entry;
+}
+
+
+/** \brief  Show the contents read by a request, called on the UI thread
+ *
+ * \param[in]   data    request
+ *
+ * \return  G_SOURCE_REMOVE
+ */
+static gboolean preview_request_finish(gpointer data)
+{
+    preview_request_t *request = data;
+
+    if (request->done) {
+        image_contents_t *contents = request->contents;
+
+        /* cache it even when stale, the user may well come back to it */
+        if (request->mtime >= 0) {
+            contents = preview_cache_add(request)->contents;
+        }
+        if (request->generation == g_atomic_int_get(&preview_generation)) {
+            set_model(create_model(contents));
+        }
+        if (request->contents != NULL) {
+            image_contents_destroy(request->contents);
+        }
+    }
+    g_free(request->path);
+    g_free(request);
+    return G_SOURCE_REMOVE;
+}
+
+
+/** \brief  Read the contents of an image, called on the worker thread
+ *
+ * \param[in]   data        request
+ * \param[in]   user_data   unused
+ */
+static void preview_request_read(gpointer data, gpointer user_data)
+{
+    preview_request_t *request = data;
+
+    /* skip requests made stale by a newer one */
+    if (request->generation == g_atomic_int_get(&preview_generation)) {
+        request->contents = request->func(request->path);
+        request->done = TRUE;
+    }
+    g_idle_add(preview_request_finish, request);
+}
+
+
+/** \brief  Handler for the 'destroy' event of the view
+ *
+ * \param[in]   view    tree view
+ * \param[in]   data    extra event data (unused)
+ */
+static void on_view_destroy(GtkWidget *view, gpointer data)
+{
+    if (view == content_view) {
+        content_view = NULL;
+        /* a pending request has nowhere to go */
+        g_atomic_int_inc(&preview_generation);
+    }
+}
+
+
+/** \brief  Create the view for the content widget
+ *
+ * Creates a GtkTreeView to display the contents of an image, empty at first
  *
  * \return  GtkTreeView
  */
-static GtkWidget *create_view(const char *path)
+static GtkWidget *create_view(void)
 {
     GtkTreeView *view;
     GtkTreeViewColumn *column;
     GtkListStore *model;
     GtkCellRenderer *renderer;
 
-    model = create_model(path);
+    model = create_empty_model();
 
     view = GTK_TREE_VIEW(gtk_tree_view_new_with_model(GTK_TREE_MODEL(model)));
     g_object_unref(model);
@@ -280,6 +477,7 @@ static GtkWidget *create_view(const char *path)
     gtk_widget_set_vexpand(GTK_WIDGET(view), TRUE);
 
     g_signal_connect(view, "row-activated", G_CALLBACK(on_row_activated), NULL);
+    g_signal_connect_unlocked(view, "destroy", G_CALLBACK(on_view_destroy), NULL);
 
     return GTK_WIDGET(view);
 }
@@ -328,7 +526,7 @@ GtkWidget *content_preview_widget_create(
 
     /* create scrolled window to contain the GktTreeView */
     scroll = gtk_scrolled_window_new(NULL, NULL);
-    content_view = create_view(NULL);
+    content_view = create_view();
     gtk_container_add(GTK_CONTAINER(scroll), content_view);
 
     /* set scrolled window properties */
@@ -348,19 +546,61 @@ GtkWidget *content_preview_widget_create(
 
 
 /** \brief  Set image file for the widget
+ *
+ * Cached contents are shown at once, otherwise the view is cleared and the
+ * contents are shown when the worker thread has read them.
  *
  * \param[in,out]   widget  preview widget
  * \param[in]       path    path to image file
  */
 void content_preview_widget_set_image(GtkWidget *widget, const char *path)
 {
-    GtkListStore *model;
+    preview_request_t *request;
+    preview_cache_entry_t *entry;
+    GStatBuf st;
+    gint generation;
+
+    /* makes any pending request stale */
+    generation = g_atomic_int_add(&preview_generation, 1) + 1;
+
+    /* don't try to read from a directory: avoid error messages from
+     * vdrive/fsimage */
+    if (path == NULL || g_file_test(path, G_FILE_TEST_IS_DIR)) {
+        set_model(create_empty_model());
+        return;
+    }
+
+    if (content_func == NULL) {
+        log_error(LOG_ERR, "no content-get function specified, bailing!");
+        set_model(create_empty_model());
+        return;
+    }
+
+    request = g_new0(preview_request_t, 1);
+    request->path = g_strdup(path);
+    request->func = content_func;
+    request->generation = generation;
+    request->mtime = -1;
+    request->size = -1;
+    if (g_stat(path, &st) == 0) {
+        request->mtime = (gint64)st.st_mtime;
+        request->size = (gint64)st.st_size;
+
+        entry = preview_cache_find(path, content_func, request->mtime, request->size);
+        if (entry != NULL) {
+            set_model(create_model(entry->contents));
+            g_free(request->path);
+            g_free(request);
+            return;
+        }
+    }
+
+    set_model(create_empty_model());
 
-    model = create_model(path);
-    gtk_tree_view_set_model(GTK_TREE_VIEW(content_view), GTK_TREE_MODEL(model));
-    if (model != NULL) {
-        g_object_unref(model);
+    if (preview_pool == NULL) {
+        preview_pool = g_thread_pool_new(preview_request_read, NULL, 1, FALSE, NULL);
     }
+    g_thread_pool_push(preview_pool, request, NULL);
 }
 
 
@@ -61,6 +61,7 @@ static const vice_gtk3_radiogroup_entry_t autostart_modes[] = {
     { "Virtual filesystem", AUTOSTART_PRG_MODE_VFS },
     { "Inject into RAM",    AUTOSTART_PRG_MODE_INJECT },
     { "Copy to disk",       AUTOSTART_PRG_MODE_DISK },
+    { "Inject at cached READY prompt", AUTOSTART_PRG_MODE_READY },
     { NULL,                 -1 }
 };
 
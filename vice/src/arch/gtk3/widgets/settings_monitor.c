@@ -142,6 +142,7 @@ GtkWidget *settings_monitor_widget_create(GtkWidget *parent)
     GtkWidget  *scroll_label;
     GtkWidget  *scroll_info;
 #ifdef FEATURE_CPUMEMHISTORY
+    GtkWidget  *chis_enable;
     GtkWidget  *chis_lines;
     GtkWidget  *chis_label;
     GtkWidget  *chis_warning;
@@ -226,6 +227,8 @@ GtkWidget *settings_monitor_widget_create(GtkWidget *parent)
     gtk_widget_set_margin_top(scroll_info,  8);
 
 #ifdef FEATURE_CPUMEMHISTORY
+    chis_enable  = vice_gtk3_resource_check_button_new("MonitorChisEnabled",
+                                                       "Collect CPU history before the monitor is opened");
     chis_label   = gtk_label_new("CPU History (lines)");
     chis_lines   = vice_gtk3_resource_spin_int_new("MonitorChisLines",
                                                    10, INT_MAX, 1024);
@@ -315,6 +318,8 @@ GtkWidget *settings_monitor_widget_create(GtkWidget *parent)
     gtk_grid_attach(GTK_GRID(grid), scroll_info,    2, row, 1, 1);
     row++;
 #ifdef FEATURE_CPUMEMHISTORY
+    gtk_grid_attach(GTK_GRID(grid), chis_enable,    0, row, 3, 1);
+    row++;
     gtk_grid_attach(GTK_GRID(grid), chis_label,     0, row, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), chis_lines,     1, row, 1, 1);
     gtk_grid_attach(GTK_GRID(grid), chis_warning,   2, row, 1 ,1);
@@ -9,6 +9,8 @@
  * $VICERES NetworkServerPort           -vsid
  * $VICERES NetworkServerBindAddress    -vsid
  * $VICERES NetworkControl              -vsid
+ * $VICERES NetworkRollback             -vsid
+ * $VICERES NetworkUDP                  -vsid
  */
 
 /*
@@ -35,6 +37,7 @@
 
 #include <gtk/gtk.h>
 #include <errno.h>
+#include <string.h>
 
 #include "debug_gtk3.h"
 #include "lib.h"
@@ -93,9 +96,21 @@ static GtkWidget *client_address = NULL;
 /** \brief  Client and server port number */
 static GtkWidget *port_number = NULL;
 
+/** \brief  Rollback frames widget (server only) */
+static GtkWidget *rollback_frames = NULL;
+
+/** \brief  UDP transport widget (server only) */
+static GtkWidget *udp_transport = NULL;
+
 /** \brief  Netplay status widget */
 static GtkWidget *netplay_status = NULL;
 
+/** \brief  Netplay connection statistics widget */
+static GtkWidget *netplay_stats = NULL;
+
+/** \brief  Source ID of the statistics update timeout */
+static guint stats_source_id = 0;
+
 /** \brief  Network mode combo box */
 static GtkWidget *combo_netplay = NULL;
 
@@ -109,6 +124,56 @@ static gulong netplay_handler = 0;
 static int netplay_mode = -1;
 
 
+/** \brief  Update display of the netplay connection statistics
+ *
+ * \param[in]   data    extra data (unused)
+ *
+ * \return  TRUE to keep the timeout running
+ */
+static gboolean netplay_update_stats(gpointer data)
+{
+    network_status_t status;
+    char             temp[256];
+
+    network_get_status(&status);
+    if (!status.connected) {
+        gtk_label_set_text(GTK_LABEL(netplay_stats), "-");
+    } else {
+        if (status.rollback_frames > 0) {
+            g_snprintf(temp, sizeof temp, "Rollback %d frames",
+                       status.rollback_frames);
+        } else {
+            g_snprintf(temp, sizeof temp, "Delay %d frames (%u changes)",
+                       status.frame_delta, status.delta_changes);
+        }
+        g_snprintf(temp + strlen(temp), sizeof temp - strlen(temp),
+                   ", RTT %u ms (90%%: %u ms), %u stalls",
+                   status.rtt_usec / 1000, status.rtt_p90_usec / 1000,
+                   status.stalls);
+        if (status.udp) {
+            g_snprintf(temp + strlen(temp), sizeof temp - strlen(temp),
+                       ", UDP (%u resends)", status.udp_resends);
+        }
+        gtk_label_set_text(GTK_LABEL(netplay_stats), temp);
+    }
+    return TRUE;
+}
+
+
+/** \brief  Handler for the 'destroy' event of the main widget
+ *
+ * \param[in]   widget  main widget (unused)
+ * \param[in]   data    extra event data (unused)
+ */
+static void on_destroy(GtkWidget *widget, gpointer data)
+{
+    if (stats_source_id > 0) {
+        g_source_remove(stats_source_id);
+        stats_source_id = 0;
+    }
+}
+
+
 /** \brief  Update display of the netplay status
  */
 static void netplay_update_status(void)
@@ -139,6 +204,11 @@ static void netplay_update_status(void)
     /* server address can only be changed when server is selected, and we are idle */
     gtk_widget_set_sensitive(server_address,
         ((mode == NETWORK_IDLE) && server) ? TRUE : FALSE);
+    /* rollback is decided by the server when the client connects */
+    gtk_widget_set_sensitive(rollback_frames,
+        ((mode == NETWORK_IDLE) && server) ? TRUE : FALSE);
+    gtk_widget_set_sensitive(udp_transport,
+        ((mode == NETWORK_IDLE) && server) ? TRUE : FALSE);
     /* client address can only be changed when client is selected, and we are idle */
     gtk_widget_set_sensitive(client_address,
         ((mode == NETWORK_IDLE) && !server) ? TRUE : FALSE);
@@ -237,6 +307,11 @@ static void on_combo_changed(GtkComboBox *combo, gpointer user_data)
     /* server address can only be changed when server is selected, and we are idle */
     gtk_widget_set_sensitive(server_address,
         ((mode == NETWORK_IDLE) && server) ? TRUE : FALSE);
+    /* rollback is decided by the server when the client connects */
+    gtk_widget_set_sensitive(rollback_frames,
+        ((mode == NETWORK_IDLE) && server) ? TRUE : FALSE);
+    gtk_widget_set_sensitive(udp_transport,
+        ((mode == NETWORK_IDLE) && server) ? TRUE : FALSE);
     /* client address can only be changed when client is selected, and we are idle */
     gtk_widget_set_sensitive(client_address,
         ((mode == NETWORK_IDLE) && !server) ? TRUE : FALSE);
@@ -454,6 +529,25 @@ GtkWidget *settings_netplay_widget_create(GtkWidget *parent)
     gtk_grid_attach(GTK_GRID(grid), port_number, 1, row, NUM_COLS - 1, 1);
     row++;
 
+    /* Rollback widgets */
+
+    /* label */
+    label = label_helper("Rollback frames");
+    /* frames, 0 for lockstep */
+    rollback_frames = vice_gtk3_resource_spin_int_new("NetworkRollback",
+                                                      0, 15, 1);
+    gtk_widget_set_hexpand(rollback_frames, FALSE);
+    gtk_widget_set_halign(rollback_frames, GTK_ALIGN_START);
+    gtk_grid_attach(GTK_GRID(grid), label,           0, row, 1,            1);
+    gtk_grid_attach(GTK_GRID(grid), rollback_frames, 1, row, NUM_COLS - 1, 1);
+    row++;
+
+    /* UDP transport widget */
+    udp_transport = vice_gtk3_resource_check_button_new("NetworkUDP",
+            "Exchange the frames over UDP");
+    gtk_grid_attach(GTK_GRID(grid), udp_transport, 1, row, NUM_COLS - 1, 1);
+    row++;
+
     /* Network status widgets */
 
     /* label */
@@ -470,6 +564,21 @@ GtkWidget *settings_netplay_widget_create(GtkWidget *parent)
     /* update status text */
     netplay_update_status();
 
+    /* Connection statistics widgets */
+
+    /* label */
+    label = label_helper("Connection");
+    /* statistics widget, updated every second */
+    netplay_stats = gtk_label_new(NULL);
+    gtk_widget_set_halign(netplay_stats, GTK_ALIGN_START);
+    gtk_widget_set_hexpand(netplay_stats, TRUE);
+    gtk_grid_attach(GTK_GRID(grid), label,         0, row, 1,            1);
+    gtk_grid_attach(GTK_GRID(grid), netplay_stats, 1, row, NUM_COLS - 1, 1);
+    row++;
+    netplay_update_stats(NULL);
+    stats_source_id = g_timeout_add_seconds(1, netplay_update_stats, NULL);
+    g_signal_connect_unlocked(grid, "destroy", G_CALLBACK(on_destroy), NULL);
+
     row = create_controls_layout(grid, row, NUM_COLS);
 #undef NUM_COLS
     gtk_widget_show_all(grid);
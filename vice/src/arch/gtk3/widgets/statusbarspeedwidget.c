@@ -39,6 +39,7 @@
 #include "vice_gtk3.h"
 #include "basedialogs.h"
 #include "drive.h"
+#include "hosttime.h"
 #include "hotkeys.h"
 #include "keyboard.h"
 #include "lib.h"
@@ -360,6 +361,7 @@ GtkWidget *statusbar_speed_widget_create(statusbar_speed_widget_state_t *state)
     state->last_shiftlock = -1;
     state->last_mode4080 = -1;
     state->last_diagnostic_pin = -1;
+    state->last_timing_serial = 0;
 
     grid = gtk_grid_new();
     gtk_widget_set_valign(grid, GTK_ALIGN_START);
@@ -479,6 +481,8 @@ void statusbar_speed_widget_update(GtkWidget *widget,
     double vsync_metric_cpu_percent;
     double vsync_metric_emulated_fps;
     int vsync_metric_warp_enabled;
+    double vsync_metric_input_latency_ms;
+    hosttime_stats_t timing;
     tick_t now;
 
     /*
@@ -535,7 +539,7 @@ void statusbar_speed_widget_update(GtkWidget *widget,
         }
     }
 
-    vsyncarch_get_metrics(&vsync_metric_cpu_percent, &vsync_metric_emulated_fps, &vsync_metric_warp_enabled);
+    vsyncarch_get_metrics(&vsync_metric_cpu_percent, &vsync_metric_emulated_fps, &vsync_metric_warp_enabled, &vsync_metric_input_latency_ms);
 
     /*
      * Updating GTK labels is expensive and this is called each frame,
@@ -573,6 +577,30 @@ void statusbar_speed_widget_update(GtkWidget *widget,
         state->last_cpu_int = this_cpu_int;
     }
 
+    /* host time per subsystem, see the SubsystemTiming resource */
+    if (hosttime_get_stats(&timing)) {
+        if (timing.serial != state->last_timing_serial && timing.frames > 0) {
+            size_t len;
+            int i;
+
+            len = g_snprintf(buffer, sizeof(buffer), "Host time per frame:");
+            for (i = 0; i < HOSTTIME_NUM; i++) {
+                len += g_snprintf(buffer + len,
+                                  sizeof(buffer) - len,
+                                  "\n%-8s%6.2f ms",
+                                  hosttime_subsystem_name(i),
+                                  (double)timing.window_ns[i] / timing.frames / 1000000.0);
+            }
+            g_snprintf(buffer + len, sizeof(buffer) - len,
+                       "\nInput latency %6.2f ms", vsync_metric_input_latency_ms);
+            gtk_widget_set_tooltip_text(widget, buffer);
+            state->last_timing_serial = timing.serial;
+        }
+    } else if (state->last_timing_serial != 0) {
+        gtk_widget_set_tooltip_text(widget, NULL);
+        state->last_timing_serial = 0;
+    }
+
     /* Somehow the last state gets out of sync when pressing Alt+W and clicking
      * the warp led, or when pressing Alt+P and clicking the pause led, nearly
      * simultaneously, so we don't check for changes but always rerender the
@@ -48,6 +48,7 @@
 #include "autostart.h"
 #include "cmdline.h"
 #include "drive.h"
+#include "forkserver.h"
 #include "interrupt.h"
 #include "kbd.h"
 #include "lib.h"
@@ -103,6 +104,9 @@ int ui_cmdline_options_init(void)
 {
     /* printf("%s\n", __func__); */
 
+    if (forkserver_cmdline_options_init() < 0) {
+        return -1;
+    }
     return cmdline_register_options(cmdline_options_common);
 }
 
@@ -58,7 +58,7 @@ static void edit_paste_action(ui_action_map_t *self)
     text_in_petscii = lib_strdup(text);
 
     charset_petconvstring((unsigned char*)text_in_petscii, CONVERT_TO_PETSCII);
-    kbdbuf_feed(text_in_petscii);
+    kbdbuf_paste(text_in_petscii);
     lib_free(text_in_petscii);
     SDL_free(text);
 }
@@ -32,6 +32,7 @@
 
 #include "menu_common.h"
 #include "menu_snapshot.h"
+#include "rewind.h"
 #include "snapshot.h"
 #include "uiactions.h"
 #include "uimenu.h"
@@ -58,15 +59,23 @@ static void snapshot_quickload_action(ui_action_map_t *self)
  */
 static void snapshot_quicksave_action(ui_action_map_t *self)
 {
-    if (machine_write_snapshot("snapshot.vsf",
-                               menu_snapshot_get_save_roms(),
-                               menu_snapshot_get_save_disks(),
-                               0) < 0) {
+    if (machine_write_snapshot_async("snapshot.vsf",
+                                     menu_snapshot_get_save_roms(),
+                                     menu_snapshot_get_save_disks()) < 0) {
         snapshot_display_error();
     }
     ui_action_finish(self->action);
 }
 
+/** \brief  Rewind to previous rewind buffer state action
+ *
+ * \param[in]   self    action map
+ */
+static void snapshot_rewind_action(ui_action_map_t *self)
+{
+    rewind_trigger_step_back(1);
+}
+
 /** \brief  Update status of the playback menu items
  *
  * Due to the SDL UI using traps to start/stop playback/recording of items the
@@ -135,6 +144,24 @@ static void history_playback_stop_action(ui_action_map_t *self)
     ui_action_finish(self->action);
 }
 
+/** \brief  Seek history playback back action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_seek_back_action(ui_action_map_t *self)
+{
+    event_playback_seek_by(-EVENT_SEEK_STEP);
+}
+
+/** \brief  Seek history playback forward action
+ *
+ * \param[in]   self    action map
+ */
+static void history_playback_seek_forward_action(ui_action_map_t *self)
+{
+    event_playback_seek_by(EVENT_SEEK_STEP);
+}
+
 /** \brief  Start history recording action
  *
  * \param[in]   self    action map
@@ -200,6 +227,9 @@ static const ui_action_map_t snapshot_actions[] = {
         .handler = snapshot_quicksave_action,
         .blocks  = true
     },
+    {   .action  = ACTION_SNAPSHOT_REWIND,
+        .handler = snapshot_rewind_action
+    },
     {   .action  = ACTION_HISTORY_PLAYBACK_START,
         .handler = history_playback_start_action,
         .blocks  = true
@@ -208,6 +238,12 @@ static const ui_action_map_t snapshot_actions[] = {
         .handler = history_playback_stop_action,
         .blocks  = true
     },
+    {   .action  = ACTION_HISTORY_PLAYBACK_SEEK_BACK,
+        .handler = history_playback_seek_back_action
+    },
+    {   .action  = ACTION_HISTORY_PLAYBACK_SEEK_FORWARD,
+        .handler = history_playback_seek_forward_action
+    },
     {   .action  = ACTION_HISTORY_RECORD_START,
         .handler = history_record_start_action,
         .blocks  = true
@@ -1313,6 +1313,11 @@ static ui_menu_entry_t autostart_settings_menu[] = {
         .callback = radio_AutostartPrgMode_callback,
         .data     = (ui_callback_data_t)AUTOSTART_PRG_MODE_DISK
     },
+    {   .string   = "Inject at cached READY",
+        .type     = MENU_ENTRY_RESOURCE_RADIO,
+        .callback = radio_AutostartPrgMode_callback,
+        .data     = (ui_callback_data_t)AUTOSTART_PRG_MODE_READY
+    },
     SDL_MENU_ITEM_SEPARATOR,
 
     {   .string   = "Autostart disk image",
@@ -78,6 +78,7 @@ UI_MENU_DEFINE_TOGGLE(MonitorLogEnabled)
 UI_MENU_DEFINE_STRING(MonitorLogFileName)
 
 #ifdef FEATURE_CPUMEMHISTORY
+UI_MENU_DEFINE_TOGGLE(MonitorChisEnabled)
 UI_MENU_DEFINE_INT(MonitorChisLines)
 #endif
 
@@ -137,6 +138,10 @@ const ui_menu_entry_t monitor_menu[] = {
 #ifdef FEATURE_CPUMEMHISTORY
     SDL_MENU_ITEM_SEPARATOR,
     SDL_MENU_ITEM_TITLE("CPU History"),
+    {   .string   = "Collect before the monitor is opened",
+        .type     = MENU_ENTRY_RESOURCE_TOGGLE,
+        .callback = toggle_MonitorChisEnabled_callback
+    },
     {   .string   = "Number of lines",
         .type     = MENU_ENTRY_RESOURCE_INT,
         .callback = int_MonitorChisLines_callback,
@@ -124,7 +124,7 @@ static UI_MENU_CALLBACK(quickload_snapshot_callback)
 static UI_MENU_CALLBACK(quicksave_snapshot_callback)
 {
     if (activated) {
-        if (machine_write_snapshot("snapshot.vsf", save_roms, save_disks, 0) < 0) {
+        if (machine_write_snapshot_async("snapshot.vsf", save_roms, save_disks) < 0) {
             snapshot_display_error();
         }
     }
@@ -283,6 +283,11 @@ ui_menu_entry_t snapshot_menu[] = {
         .type      = MENU_ENTRY_OTHER,
         .activated = MENU_EXIT_UI_STRING
     },
+    {   .action    = ACTION_SNAPSHOT_REWIND,
+        .string    = "Rewind to previous state",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
     SDL_MENU_ITEM_SEPARATOR,
 
     {   .action    = ACTION_HISTORY_RECORD_START,
@@ -311,6 +316,16 @@ ui_menu_entry_t snapshot_menu[] = {
         .status    = MENU_STATUS_INACTIVE,
         .activated = MENU_EXIT_UI_STRING
     },
+    {   .action    = ACTION_HISTORY_PLAYBACK_SEEK_BACK,
+        .string    = "Seek playback back",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
+    {   .action    = ACTION_HISTORY_PLAYBACK_SEEK_FORWARD,
+        .string    = "Seek playback forward",
+        .type      = MENU_ENTRY_OTHER,
+        .activated = MENU_EXIT_UI_STRING
+    },
 
     {   .action    = ACTION_HISTORY_MILESTONE_SET,
         .string    = "Set recording milestone",
@@ -51,6 +51,9 @@
 #include "machine.h"
 #include "mouse.h"
 #include "mousedrv.h"
+#ifdef USE_SDL2UI
+#include "render_queue.h"
+#endif
 #include "resources.h"
 #include "types.h"
 #include "ui.h"
@@ -764,6 +767,11 @@ int ui_cmdline_options_init(void)
             return -1;
         }
     }
+#ifdef USE_SDL2UI
+    if (render_queue_cmdline_options_init() < 0) {
+        return -1;
+    }
+#endif
 
     return cmdline_register_options(cmdline_options);
 }
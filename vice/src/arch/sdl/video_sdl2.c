@@ -49,6 +49,7 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 #include "vice_sdl.h"
 
 #include "archdep.h"
@@ -64,6 +65,7 @@
 #include "mousedrv.h"
 #include "palette.h"
 #include "raster.h"
+#include "render_queue.h"
 #include "resources.h"
 #include "ui.h"
 #include "uimenu.h"
@@ -105,6 +107,29 @@ static Uint32 rmask = 0, gmask = 0, bmask = 0, amask = 0;
 static int texformat = 0;
 static int recreate_textures = 0;
 
+/* Render thread: uploads and presents the frames queued by
+   video_canvas_refresh(), so that waiting for the vertical blank doesn't
+   stall the emulation.  The renderers and textures are only used with the
+   render lock held -- it is recursive.  */
+static int sdl2_render_thread_enabled = 0;
+static int sdl2_ui_initialized = 0;
+static SDL_Thread *render_thread = NULL;
+static SDL_mutex *render_lock = NULL;
+static SDL_mutex *render_wake_lock = NULL;
+static SDL_cond *render_wake_cond = NULL;
+static int render_jobs = 0;
+static int render_thread_quit = 0;
+
+#define RENDER_LOCK()   SDL_LockMutex(render_lock)
+#define RENDER_UNLOCK() SDL_UnlockMutex(render_lock)
+
+static void render_thread_start(void);
+static void render_thread_stop(void);
+static void render_queue_flush(video_canvas_t *canvas);
+static void present_frame(video_canvas_t *canvas, const uint8_t *pixels,
+                          unsigned int width, unsigned int height, int pitch,
+                          const uint8_t *rows, int interlaced, int show);
+
 uint8_t *draw_buffer_vsid = NULL;
 /* ------------------------------------------------------------------------- */
 /* Video-related resources.  */
@@ -293,6 +318,11 @@ static void recreate_canvas_textures(video_canvas_t *canvas)
     width = surface->w;
     height = surface->h;
 
+    RENDER_LOCK();
+
+    /* The frames still queued don't fit the new textures */
+    render_queue_flush(canvas);
+
     /* This hint controls the scaling mode of textures created afterwards */
     if (canvas->videoconfig->glfilter == VIDEO_GLFILTER_BILINEAR) {
         SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
@@ -306,6 +336,7 @@ static void recreate_canvas_textures(video_canvas_t *canvas)
     canvas->texture = SDL_CreateTexture(canvas->container->renderer, texformat, SDL_TEXTUREACCESS_STREAMING, width, height);
     if (!canvas->texture) {
         log_error(sdlvideo_log, "SDL_CreateTexture() failed on recreation: %s\n", SDL_GetError());
+        RENDER_UNLOCK();
         return;
     }
 
@@ -315,8 +346,14 @@ static void recreate_canvas_textures(video_canvas_t *canvas)
     canvas->previous_frame_texture = SDL_CreateTexture(canvas->container->renderer, texformat, SDL_TEXTUREACCESS_STREAMING, width, height);
     if (!canvas->previous_frame_texture) {
         log_error(sdlvideo_log, "SDL_CreateTexture() failed on recreation: %s\n", SDL_GetError());
+        RENDER_UNLOCK();
         return;
     }
+
+    /* both textures are uploaded in turn */
+    canvas->texture_full_updates = 2;
+
+    RENDER_UNLOCK();
 }
 
 
@@ -360,6 +397,20 @@ static int set_sdl2_dual_window(int v, void *param)
     return 0;
 }
 
+static int set_sdl2_render_thread(int v, void *param)
+{
+    sdl2_render_thread_enabled = v ? 1 : 0;
+
+    if (sdl2_ui_initialized) {
+        if (sdl2_render_thread_enabled) {
+            render_thread_start();
+        } else {
+            render_thread_stop();
+        }
+    }
+    return 0;
+}
+
 /* called when <CHIP>VSync was set */
 int ui_set_vsync(int val, void *canvas)
 {
@@ -389,6 +440,8 @@ static const resource_int_t resources_int[] = {
       &sdl_bitdepth, set_sdl_bitdepth, NULL },
     { "DualWindow", 0, RES_EVENT_NO, NULL,
       &sdl2_dual_window, set_sdl2_dual_window, NULL },
+    { "SDL2RenderThread", 0, RES_EVENT_NO, NULL,
+      &sdl2_render_thread_enabled, set_sdl2_render_thread, NULL },
     /* FIXME: this is a generic (not SDL specific) resource */
     { "Window0Width", 0, RES_EVENT_NO, NULL,
       &sdl_initial_width[0], set_sdl_initial_width, (void*)0 },
@@ -473,6 +526,12 @@ static const cmdline_option_t cmdline_options[] =
     { "+dualwindow", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "DualWindow", (void *)0,
       NULL, "Disable dual window rendering"},
+    { "-sdl2renderthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SDL2RenderThread", (void *)1,
+      NULL, "Upload and present the frames in a separate thread"},
+    { "+sdl2renderthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SDL2RenderThread", (void *)0,
+      NULL, "Upload and present the frames in the emulation thread"},
     /* Note: the following options are common/the same in GTK port */
     { "-windowwidth", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "Window0Width", NULL,
@@ -531,6 +590,10 @@ int video_arch_cmdline_options_init(void)
 int video_init(void)
 {
     sdlvideo_log = log_open("SDLVideo");
+
+    render_lock = SDL_CreateMutex();
+    render_wake_lock = SDL_CreateMutex();
+    render_wake_cond = SDL_CreateCond();
     return 0;
 }
 
@@ -538,6 +601,9 @@ void video_shutdown(void)
 {
     DBG(("%s", __func__));
 
+    render_thread_stop();
+    sdl2_ui_initialized = 0;
+
     if (draw_buffer_vsid) {
         lib_free(draw_buffer_vsid);
     }
@@ -545,6 +611,121 @@ void video_shutdown(void)
     sdl_active_canvas = NULL;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Render thread */
+
+/** \brief Drop the frames queued for a canvas.
+ *
+ * Called with the render lock held, which keeps the render thread out.
+ */
+static void render_queue_flush(video_canvas_t *canvas)
+{
+    backbuffer_t *bb;
+
+    if (canvas->render_queue == NULL) {
+        return;
+    }
+    while ((bb = render_queue_dequeue_for_display(canvas->render_queue)) != NULL) {
+        render_queue_return_to_pool(canvas->render_queue, bb);
+    }
+    /* the textures miss the rows of the dropped frames */
+    canvas->texture_full_updates = 2;
+}
+
+/** \brief Upload all the queued frames, presenting the newest of each canvas. */
+static void render_thread_present_all(void)
+{
+    int i;
+
+    RENDER_LOCK();
+    for (i = 0; i < sdl_num_screens; i++) {
+        video_canvas_t *canvas = sdl_canvaslist[i];
+        backbuffer_t *bb;
+
+        if (canvas->render_queue == NULL || canvas->container == NULL) {
+            continue;
+        }
+        while ((bb = render_queue_dequeue_for_display(canvas->render_queue)) != NULL) {
+            present_frame(canvas, bb->pixel_data, bb->width, bb->height, bb->pitch,
+                          bb->changed_rows, bb->interlaced,
+                          render_queue_length(canvas->render_queue) == 0);
+            render_queue_return_to_pool(canvas->render_queue, bb);
+        }
+    }
+    RENDER_UNLOCK();
+}
+
+static int render_thread_main(void *unused)
+{
+    SDL_LockMutex(render_wake_lock);
+    while (!render_thread_quit) {
+        if (render_jobs == 0) {
+            SDL_CondWait(render_wake_cond, render_wake_lock);
+            continue;
+        }
+        render_jobs = 0;
+        SDL_UnlockMutex(render_wake_lock);
+
+        render_thread_present_all();
+
+        SDL_LockMutex(render_wake_lock);
+    }
+    SDL_UnlockMutex(render_wake_lock);
+
+    return 0;
+}
+
+static void render_thread_start(void)
+{
+    int i;
+
+    if (render_thread != NULL) {
+        return;
+    }
+
+    RENDER_LOCK();
+    for (i = 0; i < sdl_num_screens; i++) {
+        sdl_canvaslist[i]->render_queue = render_queue_create();
+    }
+    RENDER_UNLOCK();
+
+    render_thread_quit = 0;
+    render_jobs = 0;
+    render_thread = SDL_CreateThread(render_thread_main, "VICE render", NULL);
+    if (render_thread == NULL) {
+        log_error(sdlvideo_log, "SDL_CreateThread() failed: %s", SDL_GetError());
+        render_thread_stop();
+        return;
+    }
+    log_message(sdlvideo_log, "Render thread started.");
+}
+
+static void render_thread_stop(void)
+{
+    int i;
+
+    if (render_thread != NULL) {
+        SDL_LockMutex(render_wake_lock);
+        render_thread_quit = 1;
+        SDL_CondSignal(render_wake_cond);
+        SDL_UnlockMutex(render_wake_lock);
+
+        SDL_WaitThread(render_thread, NULL);
+        render_thread = NULL;
+        log_message(sdlvideo_log, "Render thread stopped.");
+    }
+
+    for (i = 0; i < sdl_num_screens; i++) {
+        video_canvas_t *canvas = sdl_canvaslist[i];
+
+        if (canvas->render_queue != NULL) {
+            render_queue_flush(canvas);
+            render_queue_destroy(canvas->render_queue);
+            canvas->render_queue = NULL;
+        }
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 /* static helper functions */
 
@@ -589,10 +770,12 @@ static void sdl_container_destroy(video_container_t* container)
         return;
     }
 
+    RENDER_LOCK();
     if (container->renderer) {
         SDL_DestroyRenderer(container->renderer);
         container->renderer = NULL;
     }
+    RENDER_UNLOCK();
 
     if (container->window) {
         SDL_DestroyWindow(container->window);
@@ -781,15 +964,227 @@ video_canvas_t *video_canvas_create(video_canvas_t *canvas, unsigned int *width,
     return canvas;
 }
 
+/** \brief Work out the rows the next texture update has to upload.
+ *
+ * The two textures are updated in turn, so the rows rendered since the
+ * previous update are missing from the texture too.
+ *
+ * \return 1 if the whole screen must be uploaded, `rows' is not set then
+ */
+static int take_upload_rows(video_canvas_t *canvas, uint8_t *rows)
+{
+    unsigned int y;
+    int full = 0;
+
+    if (canvas->texture_full_updates > 0) {
+        canvas->texture_full_updates--;
+        full = 1;
+    } else {
+        for (y = 0; y < canvas->height; y++) {
+            rows[y] = canvas->changed_rows[y] | canvas->changed_rows_previous[y];
+        }
+    }
+    memcpy(canvas->changed_rows_previous, canvas->changed_rows, canvas->height);
+    memset(canvas->changed_rows, 0, canvas->height);
+
+    return full;
+}
+
+/** \brief Copy the rows of `rect' into a streaming texture.
+ *
+ * Locking gives a pointer to the memory the renderer uploads from, so the
+ * rows are copied once, in place, instead of into an intermediate buffer.
+ * Falls back to SDL_UpdateTexture() if the texture can't be locked.
+ */
+static void upload_texture_rect(SDL_Texture *texture, const SDL_Rect *rect,
+                                const uint8_t *pixels, int pitch)
+{
+    uint8_t *dest;
+    int dest_pitch;
+    int row_bytes;
+    int y;
+
+    if (SDL_LockTexture(texture, rect, (void **)&dest, &dest_pitch) != 0) {
+        SDL_UpdateTexture(texture, rect, pixels, pitch);
+        return;
+    }
+
+    row_bytes = MIN(pitch, dest_pitch);
+    if (pitch == dest_pitch) {
+        memcpy(dest, pixels, (size_t)pitch * rect->h);
+    } else {
+        for (y = 0; y < rect->h; y++) {
+            memcpy(dest + y * dest_pitch, pixels + y * pitch, row_bytes);
+        }
+    }
+    SDL_UnlockTexture(texture);
+}
+
+/** \brief Upload a frame to the texture and, if `show' is set, present it.
+ *
+ * Called with the render lock held, from the render thread if it runs.
+ *
+ * \param[in]  pixels      the frame, the size of the texture
+ * \param[in]  width       width of the frame
+ * \param[in]  height      height of the frame
+ * \param[in]  pitch       bytes per row of `pixels'
+ * \param[in]  rows        rows to upload, NULL for all
+ * \param[in]  interlaced  render on top of the previous frame
+ * \param[in]  show        present the frame, not set if a newer one waits
+ */
+static void present_frame(video_canvas_t *canvas, const uint8_t *pixels,
+                          unsigned int width, unsigned int height, int pitch,
+                          const uint8_t *rows, int interlaced, int show)
+{
+    SDL_Texture *texture_swap;
+    SDL_RendererFlip flip = 0;
+    double angle = 0;
+
+    if (canvas->texture == NULL || canvas->previous_frame_texture == NULL) {
+        return;
+    }
+
+    /* Upload the new frame to the GPU texture, only the bands of changed rows if known */
+    if (rows == NULL) {
+        SDL_Rect rect = { 0, 0, (int)width, (int)height };
+
+        upload_texture_rect(canvas->texture, &rect, pixels, pitch);
+    } else {
+        unsigned int y = 0;
+
+        while (y < height) {
+            SDL_Rect rect;
+
+            if (!rows[y]) {
+                y++;
+                continue;
+            }
+            rect.x = 0;
+            rect.y = y;
+            rect.w = width;
+            while (y < height && rows[y]) {
+                y++;
+            }
+            rect.h = y - rect.y;
+            upload_texture_rect(canvas->texture, &rect, pixels + rect.y * pitch, pitch);
+        }
+    }
+
+    if (show) {
+        /* Render. */
+        SDL_RenderClear(canvas->container->renderer);
+
+        if (canvas->videoconfig->flipx) {
+            flip |= SDL_FLIP_HORIZONTAL;
+        }
+        if (canvas->videoconfig->flipy) {
+            flip |= SDL_FLIP_VERTICAL;
+        }
+
+        angle = canvas->videoconfig->rotate ? 90.0f : 0.0f;
+
+        if (interlaced) {
+            /*
+             * Interlaced mode: Re-render last frame to render new frame over.
+             * We don't do this if the SDL menu is showing, otherwise the first
+             * render of the menu shows the emu screen behind it!
+             */
+            SDL_SetTextureBlendMode(canvas->previous_frame_texture, SDL_BLENDMODE_NONE);
+            SDL_RenderCopyEx(canvas->container->renderer, canvas->previous_frame_texture, NULL, NULL, angle, NULL, flip);
+            SDL_SetTextureBlendMode(canvas->texture, SDL_BLENDMODE_BLEND);
+        } else {
+            SDL_SetTextureBlendMode(canvas->texture, SDL_BLENDMODE_NONE);
+        }
+
+        if (canvas->videoconfig->rotate) {
+            /* FIXME: when the output is rotated 90degrees, the texture must be scaled accordingly.
+                      somehow this doesnt work without doing fancy magic like this... */
+            int tw;
+            int th;
+            int curr_w;
+            int curr_h;
+            float scale;
+            SDL_Rect rect = {0, 0, 0, 0};
+
+            SDL_QueryTexture(canvas->texture, NULL, NULL, &tw, &th);
+            SDL_GetWindowSize(canvas->container->window, &curr_w, &curr_h);
+
+            scale = (double)curr_h / (double)tw;
+            /* scale = (double)th / (double)curr_w; */
+            /* scale /= 2.0f; */
+
+            rect.x = (tw - th) / 2 - 1;
+            rect.y = (th - (tw * scale)) / 2;
+            rect.w = th;
+            rect.h = tw * scale;
+
+            DBG(("video_canvas_refresh angle:%f scale:%f", angle, scale));
+            SDL_RenderCopyEx(canvas->container->renderer, canvas->texture, NULL, &rect, angle, NULL, flip);
+        } else {
+            SDL_RenderCopyEx(canvas->container->renderer, canvas->texture, NULL, NULL, angle, NULL, flip);
+        }
+
+        SDL_RenderPresent(canvas->container->renderer);
+    }
+
+    /* Swap the textures references so we can easily re-render this frame under the next frame. */
+    texture_swap = canvas->previous_frame_texture;
+    canvas->previous_frame_texture = canvas->texture;
+    canvas->texture = texture_swap;
+}
+
+/** \brief Copy the rows of the screen for the next texture update into a
+ *         backbuffer and queue it for the render thread.
+ *
+ * If the render thread is still busy with the frames before, this one is
+ * skipped and its rows are uploaded with the next.
+ */
+static void render_thread_submit(video_canvas_t *canvas)
+{
+    unsigned int pitch = canvas->width * canvas->screen->format->BytesPerPixel;
+    backbuffer_t *bb;
+    uint8_t *rows;
+    unsigned int y;
+
+    bb = render_queue_get_from_pool(canvas->render_queue, pitch * canvas->height + canvas->height);
+    if (bb == NULL) {
+        return;
+    }
+
+    rows = bb->pixel_data + pitch * canvas->height;
+    if (take_upload_rows(canvas, rows)) {
+        memset(rows, 1, canvas->height);
+    } else {
+        bb->changed_rows = rows;
+    }
+
+    for (y = 0; y < canvas->height; y++) {
+        if (rows[y]) {
+            memcpy(bb->pixel_data + y * pitch,
+                   (uint8_t *)canvas->screen->pixels + y * canvas->screen->pitch,
+                   pitch);
+        }
+    }
+
+    bb->width = canvas->width;
+    bb->height = canvas->height;
+    bb->pitch = pitch;
+    bb->interlaced = canvas->videoconfig->interlaced && !sdl_menu_state;
+
+    render_queue_enqueue_for_display(canvas->render_queue, bb);
+
+    SDL_LockMutex(render_wake_lock);
+    render_jobs++;
+    SDL_CondSignal(render_wake_cond);
+    SDL_UnlockMutex(render_wake_lock);
+}
+
 void video_canvas_refresh(struct video_canvas_s *canvas,
                           unsigned int xs, unsigned int ys,
                           unsigned int xi, unsigned int yi,
                           unsigned int w, unsigned int h)
 {
-    SDL_Texture *texture_swap;
     uint8_t *backup;
-    SDL_RendererFlip flip = 0;
-    double angle = 0;
 
     /* If the canvas isn't initialized, skip this */
     if ((canvas == NULL) || (canvas->screen == NULL)) {
@@ -800,16 +1195,20 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
         return;
     }
 
+    /* The overlays are drawn into the draw buffer, render every line then */
     if (sdl_vsid_state & SDL_VSID_ACTIVE) {
         sdl_vsid_draw();
+        canvas->draw_buffer->dirty_lines_valid = 0;
     }
 
     if (sdl_vkbd_state & SDL_VKBD_ACTIVE) {
         sdl_vkbd_draw();
+        canvas->draw_buffer->dirty_lines_valid = 0;
     }
 
     if (uistatusbar_state & (UISTATUSBAR_ACTIVE|UISTATUSBAR_ACTIVE_VDC)) {
         uistatusbar_draw();
+        canvas->draw_buffer->dirty_lines_valid = 0;
     }
 
     xi *= canvas->videoconfig->scalex;
@@ -841,81 +1240,36 @@ void video_canvas_refresh(struct video_canvas_s *canvas,
         canvas->draw_buffer->draw_buffer = canvas->draw_buffer_vsid->draw_buffer;
         video_canvas_render(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch);
         canvas->draw_buffer->draw_buffer = backup;
+        canvas->texture_full_updates = 2;
     } else {
-        video_canvas_render(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch);
+        /* The screen keeps its contents, only render the lines that changed */
+        video_canvas_render_changed(canvas, (uint8_t *)canvas->screen->pixels, w, h, xs, ys, xi, yi, canvas->screen->pitch, canvas->changed_rows);
     }
 
     if (recreate_textures) {
         recreate_all_textures();
         recreate_textures = 0;
         /* NOTE: The texture isn't holding the screen's values
-         *       here. We can get away with that because the call to
-         *       SDL_UpdateTexture below updates the entire canvas */
+         *       here. We can get away with that because the next
+         *       texture updates upload the entire canvas */
     }
 
-    /* Upload the new frame to the GPU texture. TODO: use SDL_LockTexture for this as the docs day it's faster. */
-    SDL_UpdateTexture(canvas->texture, NULL, canvas->screen->pixels, canvas->screen->pitch);
-
-    /* Render. */
-    SDL_RenderClear(canvas->container->renderer);
-
-    if (canvas->videoconfig->flipx) {
-        flip |= SDL_FLIP_HORIZONTAL;
-    }
-    if (canvas->videoconfig->flipy) {
-        flip |= SDL_FLIP_VERTICAL;
+    if (canvas->videoconfig->interlaced) {
+        canvas->texture_full_updates = 2;
     }
 
-    angle = canvas->videoconfig->rotate ? 90.0f : 0.0f;
-
-    if (canvas->videoconfig->interlaced && !sdl_menu_state) {
-        /*
-         * Interlaced mode: Re-render last frame to render new frame over.
-         * We don't do this if the SDL menu is showing, otherwise the first
-         * render of the menu shows the emu screen behind it!
-         */
-        SDL_SetTextureBlendMode(canvas->previous_frame_texture, SDL_BLENDMODE_NONE);
-        SDL_RenderCopyEx(canvas->container->renderer, canvas->previous_frame_texture, NULL, NULL, angle, NULL, flip);
-        SDL_SetTextureBlendMode(canvas->texture, SDL_BLENDMODE_BLEND);
+    if (canvas->render_queue) {
+        render_thread_submit(canvas);
     } else {
-        SDL_SetTextureBlendMode(canvas->texture, SDL_BLENDMODE_NONE);
-    }
-
-    if (canvas->videoconfig->rotate) {
-        /* FIXME: when the output is rotated 90degrees, the texture must be scaled accordingly.
-                  somehow this doesnt work without doing fancy magic like this... */
-        int tw;
-        int th;
-        int curr_w;
-        int curr_h;
-        float scale;
-        SDL_Rect rect = {0, 0, 0, 0};
-
-        SDL_QueryTexture(canvas->texture, NULL, NULL, &tw, &th);
-        SDL_GetWindowSize(canvas->container->window, &curr_w, &curr_h);
-
-        scale = (double)curr_h / (double)tw;
-        /* scale = (double)th / (double)curr_w; */
-        /* scale /= 2.0f; */
-
-        rect.x = (tw - th) / 2 - 1;
-        rect.y = (th - (tw * scale)) / 2;
-        rect.w = th;
-        rect.h = tw * scale;
+        int full = take_upload_rows(canvas, canvas->upload_rows);
 
-        DBG(("video_canvas_refresh angle:%f scale:%f", angle, scale));
-        SDL_RenderCopyEx(canvas->container->renderer, canvas->texture, NULL, &rect, angle, NULL, flip);
-    } else {
-        SDL_RenderCopyEx(canvas->container->renderer, canvas->texture, NULL, NULL, angle, NULL, flip);
+        RENDER_LOCK();
+        present_frame(canvas, canvas->screen->pixels, canvas->width, canvas->height,
+                      canvas->screen->pitch, full ? NULL : canvas->upload_rows,
+                      canvas->videoconfig->interlaced && !sdl_menu_state, 1);
+        RENDER_UNLOCK();
     }
 
-    SDL_RenderPresent(canvas->container->renderer);
-
-    /* Swap the textures references so we can easily re-render this frame under the next frame. */
-    texture_swap = canvas->previous_frame_texture;
-    canvas->previous_frame_texture = canvas->texture;
-    canvas->texture = texture_swap;
-
     if (canvas->container->leaving_fullscreen) {
         int curr_w, curr_h, flags;
         int last_width = canvas->container->last_width;
@@ -1005,7 +1359,9 @@ static void sdl_correct_logical_size(void)
                 corrected_height = canvas->height;
             }
             DBG(("sdl_correct_logical_size w:%d h:%d", corrected_width, corrected_height));
+            RENDER_LOCK();
             SDL_RenderSetLogicalSize(container->renderer, corrected_width, corrected_height);
+            RENDER_UNLOCK();
         }
     }
 }
@@ -1094,6 +1450,11 @@ void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas)
             SDL_FreeSurface(canvas->screen);
         }
         canvas->screen = new_screen;
+        canvas->changed_rows = lib_realloc(canvas->changed_rows, height);
+        canvas->changed_rows_previous = lib_realloc(canvas->changed_rows_previous, height);
+        canvas->upload_rows = lib_realloc(canvas->upload_rows, height);
+        memset(canvas->changed_rows, 0, height);
+        memset(canvas->changed_rows_previous, 0, height);
 
         recreate_canvas_textures(canvas);
 
@@ -1205,6 +1566,7 @@ void video_arch_canvas_init(struct video_canvas_s *canvas)
 
 #ifdef USE_SDL2UI
     canvas->container = NULL;
+    canvas->render_queue = NULL;
 #endif
 
     /*
@@ -1220,6 +1582,9 @@ void video_canvas_destroy(struct video_canvas_s *canvas)
 
     DBG(("%s: (%p, %i)", __func__, canvas, canvas->index));
 
+    render_thread_stop();
+    sdl2_ui_initialized = 0;
+
     for (i = 0; i < sdl_num_screens; ++i) {
         if (sdl_canvaslist[i] == canvas) {
 #ifdef USE_SDL2UI
@@ -1237,6 +1602,12 @@ void video_canvas_destroy(struct video_canvas_s *canvas)
 
             SDL_FreeSurface(sdl_canvaslist[i]->screen);
             sdl_canvaslist[i]->screen = NULL;
+            lib_free(sdl_canvaslist[i]->changed_rows);
+            lib_free(sdl_canvaslist[i]->changed_rows_previous);
+            lib_free(sdl_canvaslist[i]->upload_rows);
+            sdl_canvaslist[i]->changed_rows = NULL;
+            sdl_canvaslist[i]->changed_rows_previous = NULL;
+            sdl_canvaslist[i]->upload_rows = NULL;
         }
     }
 
@@ -1263,6 +1634,8 @@ void sdl2_hide_second_window(void)
         DBG(("%s active: %d, inactive: %d", __func__,
              sdl_active_canvas->index, inactive_canvas_idx));
 
+        RENDER_LOCK();
+        render_queue_flush(inactive_canvas);
         inactive_canvas->container = active_container;
 
         SDL_DestroyTexture(inactive_canvas->texture);
@@ -1271,6 +1644,7 @@ void sdl2_hide_second_window(void)
         inactive_canvas->previous_frame_texture = NULL;
 
         sdl_container_destroy(inactive_container);
+        RENDER_UNLOCK();
 
         /* Force a recretion of the textures since we have effectively changed
            our renderer, and SDL textures can't be shared between renderers. */
@@ -1302,7 +1676,10 @@ void sdl2_show_second_window(void)
         DBG(("%s active: %d, inactive: %d", __func__,
              sdl_active_canvas->index, inactive_canvas_idx));
 
+        RENDER_LOCK();
+        render_queue_flush(inactive_canvas);
         inactive_canvas->container = new_container;
+        RENDER_UNLOCK();
 
         /* Force a recretion of the textures since we have effectively changed
            our renderer, and SDL textures can't be shared between renderers. */
@@ -1377,6 +1754,11 @@ void sdl_ui_init_finalize(void)
     }
 
     mousedrv_mouse_changed();
+
+    sdl2_ui_initialized = 1;
+    if (sdl2_render_thread_enabled) {
+        render_thread_start();
+    }
 }
 
 static int last_mouse_x = -1;
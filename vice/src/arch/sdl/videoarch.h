@@ -105,6 +105,23 @@ struct video_canvas_s {
     /** \brief Last frame's texture, used for interlaced modes. */
     SDL_Texture* previous_frame_texture;
 
+    /** \brief One flag per row of the screen, set if rendered since the
+     *         texture was last updated. */
+    uint8_t *changed_rows;
+
+    /** \brief The rows of the previous texture update, which are not yet in
+     *         the texture used by the next one. */
+    uint8_t *changed_rows_previous;
+
+    /** \brief The rows to upload by the next texture update. */
+    uint8_t *upload_rows;
+
+    /** \brief Backbuffers for the render thread, NULL if it isn't running. */
+    void *render_queue;
+
+    /** \brief Number of refreshes that must still upload the whole screen. */
+    int texture_full_updates;
+
     /** \brief The SDL2 objects that this canvas can output to. */
     video_container_t* container;
 #endif
@@ -68,11 +68,13 @@
 #include "archdep_file_exists.h"
 #include "archdep_file_is_blockdev.h"
 #include "archdep_file_is_chardev.h"
+#include "archdep_file_mtime.h"
 #include "archdep_file_size.h"
 #include "archdep_filename_parameter.h"
 #include "archdep_fix_permissions.h"
 #include "archdep_fix_streams.h"
 #include "archdep_fseeko.h"
+#include "archdep_fsync.h"
 #include "archdep_ftello.h"
 #include "archdep_get_current_drive.h"
 #include "archdep_get_runtime_info.h"
@@ -66,6 +66,7 @@ static pthread_t main_thread;
 #endif /* #ifdef USE_VICE_THREAD */
 
 #include "archdep.h"
+#include "exitreport.h"
 #include "main.h"
 #include "mainlock.h"
 
@@ -186,6 +187,8 @@ void archdep_set_main_thread(void)
  */
 void archdep_vice_exit(int exit_code)
 {
+    exitreport_set_exit_code(exit_code);
+
     vice_exit_code = exit_code;
 
     if (pthread_equal(pthread_self(), main_thread)) {
@@ -209,6 +212,8 @@ void archdep_vice_exit(int exit_code)
  */
 void archdep_vice_exit(int exit_code)
 {
+    exitreport_set_exit_code(exit_code);
+
     actually_exit(exit_code);
 }
 
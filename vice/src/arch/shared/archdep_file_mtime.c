@@ -0,0 +1,54 @@
+/** \file   archdep_file_mtime.c
+ * \brief   Get the modification time of a file
+ *
+ * Used to find out if a cached result derived from a file is still valid.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+#include "archdep_defs.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "archdep_file_mtime.h"
+
+
+/** \brief  Get the time \a path was last modified
+ *
+ * \param[in]   path    pathname
+ * \param[out]  mtime   modification time
+ *
+ * \return  0 on success, -1 on failure
+ */
+int archdep_file_mtime(const char *path, time_t *mtime)
+{
+    struct stat statbuf;
+
+    if (stat(path, &statbuf) < 0) {
+        return -1;
+    }
+    *mtime = statbuf.st_mtime;
+    return 0;
+}
@@ -0,0 +1,67 @@
+/** \file   archdep_fsync.c
+ * \brief   Write a stream through to the storage device
+ *
+ * Used where a file must have reached the disk before the next step, like
+ * the journal of held back image writes.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+#include "archdep_defs.h"
+
+#include <stdio.h>
+
+#ifdef UNIX_COMPILE
+# include <unistd.h>
+#endif
+
+#ifdef WINDOWS_COMPILE
+# include <io.h>
+#endif
+
+#include "archdep_fsync.h"
+
+
+/** \brief  Flush \a stream and wait until the data is on the device
+ *
+ * \param[in]   stream  stream
+ *
+ * \return  0 on success, -1 on failure
+ */
+int archdep_fsync(FILE *stream)
+{
+    if (fflush(stream) != 0) {
+        return -1;
+    }
+#ifdef UNIX_COMPILE
+    if (fsync(fileno(stream)) != 0) {
+        return -1;
+    }
+#endif
+#ifdef WINDOWS_COMPILE
+    if (_commit(_fileno(stream)) != 0) {
+        return -1;
+    }
+#endif
+    return 0;
+}
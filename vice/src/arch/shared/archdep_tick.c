@@ -33,6 +33,7 @@
 #   include <windows.h>
 #elif defined(HAVE_NANOSLEEP)
 #   include <time.h>
+#   include <errno.h>
 #else
 #   include <unistd.h>
 #   include <errno.h>
@@ -53,6 +54,18 @@
 
 /* #define OVERSLEEP_COMPENSATION */
 
+#ifdef WINDOWS_COMPILE
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define SPIN_PAUSE() __builtin_ia32_pause()
+#else
+#define SPIN_PAUSE()
+#endif
+
 /* ------------------------------------------------------------------------- */
 
 #ifdef WINDOWS_COMPILE
@@ -67,7 +80,15 @@ void tick_init(void)
 #ifdef WINDOWS_COMPILE
     QueryPerformanceFrequency(&timer_frequency);
 
-    wait_timer = CreateWaitableTimer(NULL, TRUE, NULL);
+    wait_timer = NULL;
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0600
+    /* high resolution timers (Windows 10 1803 and later) do not depend on
+       the system timer resolution set with timeBeginPeriod() */
+    wait_timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+    if (wait_timer == NULL) {
+        wait_timer = CreateWaitableTimer(NULL, TRUE, NULL);
+    }
 
 #elif defined(MACOS_COMPILE)
     mach_timebase_info(&timebase_info);
@@ -201,6 +222,81 @@ void tick_sleep(tick_t sleep_ticks)
 #endif
 }
 
+/* Sleeping until a deadline.
+
+   The host wakes a sleeping thread up some time after the time asked for,
+   how long after depends on the OS, its timer and the load.  The sleep is
+   therefore ended early by a margin that follows how late recent wake-ups
+   were, and the rest of the time is spun away.  The margin grows at once
+   when a wake-up is later than it, and shrinks slowly.  */
+
+#define SPIN_MARGIN_MIN     (TICK_PER_SECOND / 20000)   /* 50 us */
+#define SPIN_MARGIN_MAX     (TICK_PER_SECOND / 500)     /* 2 ms */
+
+static tick_t spin_margin = TICK_PER_SECOND / 2000;
+
+/* Sleep until about `wake', which is less than a second from now.  */
+static void sleep_until_impl(tick_t wake, tick_t now)
+{
+#if defined(MACOS_COMPILE)
+    uint64_t nanos = TICK_TO_NANO(wake - now);
+
+    mach_wait_until(mach_absolute_time() + nanos * timebase_info.denom / timebase_info.numer);
+
+#elif defined(HAVE_CLOCK_NANOSLEEP) && !defined(WINDOWS_COMPILE)
+    /* The tick clock may be one clock_nanosleep() cannot wait for, so the
+       deadline is moved to CLOCK_MONOTONIC.  As an absolute time it holds
+       when the sleep is interrupted and started again.  */
+    struct timespec ts;
+    uint64_t nanos = TICK_TO_NANO(wake - now);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    nanos += ts.tv_nsec;
+    ts.tv_sec += nanos / NANO_PER_SECOND;
+    ts.tv_nsec = nanos % NANO_PER_SECOND;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        /* sleep the rest */
+    }
+
+#else
+    sleep_impl(wake - now);
+#endif
+}
+
+/* Sleep until tick `deadline', sleeping most of the time and spinning the
+   last part of it.  Returns at once if the deadline has passed.  */
+void tick_sleep_until(tick_t deadline)
+{
+    tick_t now = tick_now();
+    tick_t wake;
+    tick_t late;
+
+    if ((int32_t)(deadline - now) <= 0) {
+        return;
+    }
+
+    if (deadline - now > spin_margin) {
+        wake = deadline - spin_margin;
+        sleep_until_impl(wake, now);
+
+        now = tick_now_after(now);
+        late = (int32_t)(now - wake) > 0 ? now - wake : 0;
+        if (late > spin_margin) {
+            spin_margin = MIN(late + late / 4, SPIN_MARGIN_MAX);
+        } else {
+            spin_margin -= (spin_margin - late) / 16;
+            if (spin_margin < SPIN_MARGIN_MIN) {
+                spin_margin = SPIN_MARGIN_MIN;
+            }
+        }
+    }
+
+    while ((int32_t)(deadline - tick_now()) > 0) {
+        SPIN_PAUSE();
+    }
+}
+
 tick_t tick_now_after(tick_t previous_tick)
 {
     /*
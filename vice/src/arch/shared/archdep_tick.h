@@ -65,4 +65,8 @@ tick_t tick_now_delta(tick_t previous_tick);
 /* Sleep a number of ticks. */
 void tick_sleep(tick_t delay);
 
+/* Sleep until a tick less than a second from now, more precisely than
+   tick_sleep() at the cost of spinning for the last part of the wait. */
+void tick_sleep_until(tick_t deadline);
+
 #endif
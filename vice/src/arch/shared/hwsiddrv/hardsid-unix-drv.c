@@ -102,6 +102,13 @@ void hardsid_drv_set_device(unsigned int chipno, unsigned int device)
 {
 }
 
+void hardsid_drv_set_latency(int ms)
+{
+#ifdef HAVE_LINUX_HARDSID_H
+    hs_linux_set_latency(ms);
+#endif
+}
+
 /* ---------------------------------------------------------------------*/
 
 void hardsid_drv_state_read(int chipno, struct sid_hs_snapshot_state_s *sid_state)
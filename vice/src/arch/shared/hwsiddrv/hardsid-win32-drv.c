@@ -114,6 +114,11 @@ void hardsid_drv_set_device(unsigned int chipno, unsigned int device)
     }
 }
 
+/* The DLL of the USB boards queues the delayed writes itself.  */
+void hardsid_drv_set_latency(int ms)
+{
+}
+
 /* ---------------------------------------------------------------------*/
 
 void hardsid_drv_state_read(int chipno, struct sid_hs_snapshot_state_s *sid_state)
@@ -36,12 +36,18 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <linux/hardsid.h>
 
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+#endif
+
 #include "alarm.h"
 #include "hardsid.h"
 #include "log.h"
+#include "machine.h"
 #include "maincpu.h"
 #include "sid-resources.h"
 #include "types.h"
@@ -49,11 +55,47 @@
 /* Approx 3 PAL screen updates */
 #define HARDSID_DELAY_CYCLES 50000
 
+/* Accesses queued before they are passed to the driver.  */
+#define HARDSID_QUEUE_SIZE 4096
+
 static int hsid_fd = -1;
 static CLOCK hsid_main_clk;
 static CLOCK hsid_alarm_clk;
 static alarm_t *hsid_alarm = 0;
 
+/* With a latency set, the accesses are not written one by one but queued
+   in the packets of the driver, which carry the cycles since the previous
+   access, and written in one go once the first of them is `latency' old.
+   The board plays them with the timing they were queued with.  Where
+   threads are available a thread of its own does the writing.  */
+
+typedef struct hs_op_s {
+    int delay;          /* HSID_IOCTL_DELAY instead of a packet */
+    unsigned int value;
+} hs_op_t;
+
+static int latency_ms = 0;
+static CLOCK latency_cycles = 0;
+
+static hs_op_t queue[HARDSID_QUEUE_SIZE];
+static unsigned int queue_count = 0;
+static CLOCK queue_start_clk;
+
+/* the packets of one write() */
+static unsigned int packets[HARDSID_QUEUE_SIZE];
+
+#ifdef USE_VICE_THREAD
+static pthread_t io_thread;
+static int io_thread_running = 0;
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t io_cond = PTHREAD_COND_INITIALIZER;
+static int io_stop = 0;
+
+/* the batch handed to the thread, io_count is 0 once it is written */
+static hs_op_t io_ops[HARDSID_QUEUE_SIZE];
+static unsigned int io_count = 0;
+#endif
+
 /* FIXME: currently only 1 SID is supported */
 #define MAXSID 1
 
@@ -61,6 +103,153 @@ static int sids_found = -1;
 
 static void hardsid_alarm_handler(CLOCK offset, void *data);
 
+/* Pass `count' queued accesses to the driver, the packets between two
+   delays with one write().  */
+static void hs_write_ops(const hs_op_t *ops, unsigned int count)
+{
+    unsigned int i;
+    unsigned int n = 0;
+
+    for (i = 0; i < count; i++) {
+        if (!ops[i].delay) {
+            packets[n++] = ops[i].value;
+            continue;
+        }
+        if (n > 0) {
+            write(hsid_fd, packets, n * sizeof(packets[0]));
+            n = 0;
+        }
+        ioctl(hsid_fd, HSID_IOCTL_DELAY, ops[i].value);
+    }
+    if (n > 0) {
+        write(hsid_fd, packets, n * sizeof(packets[0]));
+    }
+}
+
+#ifdef USE_VICE_THREAD
+static void *hs_io_thread(void *arg)
+{
+    pthread_mutex_lock(&io_lock);
+    for (;;) {
+        while (io_count == 0 && !io_stop) {
+            pthread_cond_wait(&io_cond, &io_lock);
+        }
+        if (io_count == 0) {
+            break;
+        }
+        pthread_mutex_unlock(&io_lock);
+
+        hs_write_ops(io_ops, io_count);
+
+        pthread_mutex_lock(&io_lock);
+        io_count = 0;
+        pthread_cond_broadcast(&io_cond);
+    }
+    pthread_mutex_unlock(&io_lock);
+    return NULL;
+}
+
+static void hs_io_thread_stop(void)
+{
+    if (!io_thread_running) {
+        return;
+    }
+    pthread_mutex_lock(&io_lock);
+    io_stop = 1;
+    pthread_cond_broadcast(&io_cond);
+    pthread_mutex_unlock(&io_lock);
+
+    pthread_join(io_thread, NULL);
+    io_thread_running = 0;
+}
+#endif
+
+/* Write the queue, or hand it to the thread.  */
+static void hs_queue_flush(void)
+{
+    if (queue_count == 0) {
+        return;
+    }
+
+#ifdef USE_VICE_THREAD
+    if (!io_thread_running) {
+        io_stop = 0;
+        if (pthread_create(&io_thread, NULL, hs_io_thread, NULL) == 0) {
+            io_thread_running = 1;
+        } else {
+            log_error(LOG_DEFAULT, "Linux HardSID: cannot start the write thread.");
+        }
+    }
+    if (io_thread_running) {
+        pthread_mutex_lock(&io_lock);
+        while (io_count > 0) {
+            pthread_cond_wait(&io_cond, &io_lock);
+        }
+        memcpy(io_ops, queue, queue_count * sizeof(queue[0]));
+        io_count = queue_count;
+        pthread_cond_broadcast(&io_cond);
+        pthread_mutex_unlock(&io_lock);
+        queue_count = 0;
+        return;
+    }
+#endif
+
+    hs_write_ops(queue, queue_count);
+    queue_count = 0;
+}
+
+/* Write the queue and wait until the driver has all of it.  */
+static void hs_queue_sync(void)
+{
+    hs_queue_flush();
+
+#ifdef USE_VICE_THREAD
+    if (io_thread_running) {
+        pthread_mutex_lock(&io_lock);
+        while (io_count > 0) {
+            pthread_cond_wait(&io_cond, &io_lock);
+        }
+        pthread_mutex_unlock(&io_lock);
+    }
+#endif
+}
+
+static void hs_queue_add(int delay, unsigned int value)
+{
+    if (queue_count == 0) {
+        queue_start_clk = maincpu_clk;
+        if (hsid_alarm != 0 && queue_start_clk + latency_cycles < hsid_alarm_clk) {
+            alarm_set(hsid_alarm, queue_start_clk + latency_cycles);
+        }
+    }
+    queue[queue_count].delay = delay;
+    queue[queue_count].value = value;
+    queue_count++;
+
+    if (queue_count == HARDSID_QUEUE_SIZE || maincpu_clk - queue_start_clk >= latency_cycles) {
+        hs_queue_flush();
+    }
+}
+
+/* Issue a delay, queued if a latency is set.  */
+static void hs_delay(unsigned int cycles)
+{
+    if (latency_cycles > 0) {
+        hs_queue_add(1, cycles);
+    } else {
+        ioctl(hsid_fd, HSID_IOCTL_DELAY, cycles);
+    }
+}
+
+void hs_linux_set_latency(int ms)
+{
+    if (sids_found > 0) {
+        hs_queue_sync();
+    }
+    latency_ms = ms;
+    latency_cycles = (CLOCK)((double)machine_get_cycles_per_second() * ms / 1000);
+}
+
 static int hardsid_init(void)
 {
     /* Already open */
@@ -113,6 +302,7 @@ int hs_linux_open(void)
     }
     hsid_alarm = alarm_new(maincpu_alarm_context, "hardsid", hardsid_alarm_handler, 0);
     sids_found = 1;
+    hs_linux_set_latency(latency_ms);
     hardsid_reset();
     log_message(LOG_DEFAULT, "Linux HardSID: opened.");
     return 0;
@@ -120,6 +310,11 @@ int hs_linux_open(void)
 
 int hs_linux_close(void)
 {
+    hs_queue_sync();
+#ifdef USE_VICE_THREAD
+    hs_io_thread_stop();
+#endif
+
     /* Driver cleans up after itself */
     if (hsid_fd >= 0) {
         close(hsid_fd);
@@ -137,6 +332,9 @@ int hs_linux_read(uint16_t addr, int chipno)
         CLOCK cycles = maincpu_clk - hsid_main_clk - 1;
         hsid_main_clk = maincpu_clk;
 
+        /* the read cannot wait */
+        hs_queue_sync();
+
         while (cycles > 0xffff) {
             /* delay */
             ioctl(hsid_fd, HSID_IOCTL_DELAY, 0xffff);
@@ -160,12 +358,16 @@ void hs_linux_store(uint16_t addr, uint8_t val, int chipno)
 
         while (cycles > 0xffff) {
             /* delay */
-            ioctl(hsid_fd, HSID_IOCTL_DELAY, 0xffff);
+            hs_delay(0xffff);
             cycles -= 0xffff;
         }
 
         uint packet = ((cycles & 0xffff) << 16) | ((addr & 0x1f) << 8) | val;
-        write(hsid_fd, &packet, sizeof (packet));
+        if (latency_cycles > 0) {
+            hs_queue_add(0, packet);
+        } else {
+            write(hsid_fd, &packet, sizeof (packet));
+        }
     }
 }
 
@@ -176,17 +378,30 @@ unsigned int hs_linux_available(void)
 
 static void hardsid_alarm_handler(CLOCK offset, void *data)
 {
-    CLOCK cycles = (hsid_alarm_clk + offset) - hsid_main_clk;
+    CLOCK now = maincpu_clk - offset;
+    CLOCK cycles = now - hsid_main_clk;
+
+    /* also set for the deadline of the queue */
+    if (now >= hsid_alarm_clk) {
+        if (cycles < HARDSID_DELAY_CYCLES) {
+            hsid_alarm_clk = hsid_main_clk + HARDSID_DELAY_CYCLES;
+        } else {
+            uint delay = (uint) cycles;
+            hs_delay(delay);
+            hsid_main_clk   = now;
+            hsid_alarm_clk  = hsid_main_clk + HARDSID_DELAY_CYCLES;
+        }
+    }
+
+    if (queue_count > 0 && now - queue_start_clk >= latency_cycles) {
+        hs_queue_flush();
+    }
 
-    if (cycles < HARDSID_DELAY_CYCLES) {
-        hsid_alarm_clk = hsid_main_clk + HARDSID_DELAY_CYCLES;
+    if (queue_count > 0 && queue_start_clk + latency_cycles < hsid_alarm_clk) {
+        alarm_set(hsid_alarm, queue_start_clk + latency_cycles);
     } else {
-        uint delay = (uint) cycles;
-        ioctl(hsid_fd, HSID_IOCTL_DELAY, delay);
-        hsid_main_clk   = maincpu_clk - offset;
-        hsid_alarm_clk  = hsid_main_clk + HARDSID_DELAY_CYCLES;
+        alarm_set(hsid_alarm, hsid_alarm_clk);
     }
-    alarm_set(hsid_alarm, hsid_alarm_clk);
 }
 
 /* ---------------------------------------------------------------------*/
@@ -41,6 +41,7 @@ int hs_isa_close(void);
 int hs_pci_close(void);
 
 void hs_linux_reset(void);
+void hs_linux_set_latency(int ms);
 
 int hs_linux_read(uint16_t addr, int chipno);
 int hs_isa_read(uint16_t addr, int chipno);
@@ -0,0 +1,398 @@
+/** \file   rawnetarch_thread.c
+ * \brief   I/O thread and frame rings for the Unix rawnet drivers
+ *
+ * Polling the host interface from the emulation means a syscall every time
+ * the emulated driver looks at the RX status, and a 6502 TCP/IP stack does
+ * that a lot. Instead, a thread waits until the driver's descriptor is
+ * readable and lets the driver put the frames into the receive ring, so a
+ * poll is a load from memory. The same thread sends the frames queued in
+ * the transmit ring, so all frames queued while it sleeps go out in one
+ * batch behind a single wakeup, and the descriptor is only ever used by one
+ * thread.
+ *
+ * Both rings have a single producer and a single consumer, \a head is only
+ * written by the consumer and \a tail only by the producer, so neither side
+ * needs a lock.
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#ifdef HAVE_RAWNET
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib.h"
+#include "log.h"
+#include "rawnetarch.h"
+#include "rawnetarch_thread.h"
+
+/** \brief  Number of frames a ring can hold
+ *
+ * Must be a power of two.
+ */
+#define RAWNET_ARCH_RING_SIZE   64
+
+/** \brief  Timeout in milliseconds of the I/O thread's poll()
+ *
+ * Only bounds the time a lost wakeup can delay a transmit, receiving and
+ * stopping the thread do not wait for it.
+ */
+#define RAWNET_ARCH_POLL_MS     20
+
+
+/** \brief  Single producer, single consumer frame ring
+ */
+typedef struct rawnet_arch_ring_s {
+    atomic_uint head;           /**< next slot to read */
+    atomic_uint tail;           /**< next slot to fill */
+    unsigned long frames;       /**< frames queued, producer side */
+    unsigned long dropped;      /**< frames dropped on a full ring, producer side */
+    unsigned int max_depth;     /**< most frames ever queued, producer side */
+    rawnet_arch_frame_t slots[RAWNET_ARCH_RING_SIZE];   /**< frame slots */
+} rawnet_arch_ring_t;
+
+
+/** \brief  I/O thread of an active adapter
+ */
+struct rawnet_arch_thread_s {
+    const char *name;                       /**< driver name, for the log */
+    int fd;                                 /**< descriptor to wait on */
+    rawnet_arch_thread_read_t read_frames;  /**< fetches received frames */
+    rawnet_arch_thread_write_t write_frame; /**< sends a frame */
+    pthread_t thread;                       /**< the thread */
+    atomic_int stop;                        /**< set to make the thread quit */
+    int wake_pipe[2];                       /**< pipe to wake up the thread */
+    rawnet_arch_ring_t rx;                  /**< received frames */
+    rawnet_arch_ring_t tx;                  /**< frames to send */
+};
+
+
+/** \brief  Get the slot to fill next, or `NULL` if the ring is full
+ *
+ * A `NULL` result counts as a dropped frame.
+ *
+ * \param[in]   ring    ring
+ *
+ * \return  free slot, hand it over with rawnet_arch_ring_push()
+ */
+static rawnet_arch_frame_t *rawnet_arch_ring_free_slot(rawnet_arch_ring_t *ring)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) >= RAWNET_ARCH_RING_SIZE) {
+        ring->dropped++;
+        return NULL;
+    }
+    return &ring->slots[tail & (RAWNET_ARCH_RING_SIZE - 1)];
+}
+
+/** \brief  Hand the slot from rawnet_arch_ring_free_slot() to the consumer
+ *
+ * \param[in]   ring    ring
+ *
+ * \return  non-zero if the ring was empty before
+ */
+static int rawnet_arch_ring_push(rawnet_arch_ring_t *ring)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head;
+
+    /* sequentially consistent, so that either we see the consumer's last
+       pop and report the ring empty, or the consumer sees this frame */
+    atomic_store(&ring->tail, tail + 1);
+    head = atomic_load(&ring->head);
+
+    ring->frames++;
+    if (tail + 1 - head > ring->max_depth) {
+        ring->max_depth = tail + 1 - head;
+    }
+    return head == tail;
+}
+
+/** \brief  Get the oldest frame of the ring, or `NULL` if the ring is empty
+ *
+ * \param[in]   ring    ring
+ *
+ * \return  frame, release it with rawnet_arch_ring_pop()
+ */
+static rawnet_arch_frame_t *rawnet_arch_ring_peek(rawnet_arch_ring_t *ring)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+        return NULL;
+    }
+    return &ring->slots[head & (RAWNET_ARCH_RING_SIZE - 1)];
+}
+
+/** \brief  Release the frame from rawnet_arch_ring_peek()
+ *
+ * \param[in]   ring    ring
+ */
+static void rawnet_arch_ring_pop(rawnet_arch_ring_t *ring)
+{
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    atomic_store(&ring->head, head + 1);
+}
+
+
+/** \brief  Wake up the I/O thread
+ *
+ * \param[in]   thread  I/O thread
+ */
+static void rawnet_arch_thread_wakeup(rawnet_arch_thread_t *thread)
+{
+    char c = 0;
+
+    /* the pipe is non-blocking, if it is full a wakeup is pending anyway */
+    if (write(thread->wake_pipe[1], &c, 1) < 0) {
+        /* nothing to do */
+    }
+}
+
+/** \brief  Send all frames of the transmit ring
+ *
+ * \param[in]   thread  I/O thread
+ */
+static void rawnet_arch_thread_flush(rawnet_arch_thread_t *thread)
+{
+    rawnet_arch_frame_t *frame;
+
+    while ((frame = rawnet_arch_ring_peek(&thread->tx)) != NULL) {
+        thread->write_frame(frame->data, frame->len);
+        rawnet_arch_ring_pop(&thread->tx);
+    }
+}
+
+/** \brief  Main function of the I/O thread
+ *
+ * \param[in]   param   I/O thread
+ *
+ * \return  `NULL`
+ */
+static void *rawnet_arch_thread_main(void *param)
+{
+    rawnet_arch_thread_t *thread = param;
+    struct pollfd fds[2];
+    char drain[64];
+
+    fds[0].fd = thread->fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = thread->wake_pipe[0];
+    fds[1].events = POLLIN;
+
+    while (!atomic_load(&thread->stop)) {
+        rawnet_arch_thread_flush(thread);
+
+        if (poll(fds, 2, RAWNET_ARCH_POLL_MS) < 0) {
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            while (read(thread->wake_pipe[0], drain, sizeof drain) > 0) {
+                /* empty the pipe */
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            thread->read_frames(thread, thread->fd);
+        } else if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            /* stop waiting on it, or poll() would return at once forever */
+            log_message(rawnet_arch_log,
+                    "WARNING: unexpected event while polling for new %s frames",
+                    thread->name);
+            fds[0].fd = -1;
+        }
+    }
+    return NULL;
+}
+
+
+/** \brief  Start an I/O thread
+ *
+ * \param[in]   name        driver name, for the log
+ * \param[in]   fd          descriptor that is readable when frames arrive
+ * \param[in]   read_frames called on the I/O thread when \a fd is readable
+ * \param[in]   write_frame called on the I/O thread to send a frame
+ *
+ * \return  I/O thread, or `NULL` if none could be started and the driver
+ *          has to do its I/O itself
+ */
+rawnet_arch_thread_t *rawnet_arch_thread_start(const char *name, int fd,
+                                               rawnet_arch_thread_read_t read_frames,
+                                               rawnet_arch_thread_write_t write_frame)
+{
+    rawnet_arch_thread_t *thread;
+    int i;
+
+    thread = lib_calloc(1, sizeof *thread);
+    thread->name = name;
+    thread->fd = fd;
+    thread->read_frames = read_frames;
+    thread->write_frame = write_frame;
+    atomic_init(&thread->stop, 0);
+    atomic_init(&thread->rx.head, 0);
+    atomic_init(&thread->rx.tail, 0);
+    atomic_init(&thread->tx.head, 0);
+    atomic_init(&thread->tx.tail, 0);
+
+    if (pipe(thread->wake_pipe) < 0) {
+        log_message(rawnet_arch_log,
+                "WARNING: Could not create the pipe for the %s I/O thread: %s",
+                name, strerror(errno));
+        lib_free(thread);
+        return NULL;
+    }
+    for (i = 0; i < 2; i++) {
+        fcntl(thread->wake_pipe[i], F_SETFL,
+                fcntl(thread->wake_pipe[i], F_GETFL) | O_NONBLOCK);
+    }
+
+    if (pthread_create(&thread->thread, NULL, rawnet_arch_thread_main, thread) != 0) {
+        log_message(rawnet_arch_log,
+                "WARNING: Could not create the %s I/O thread.", name);
+        close(thread->wake_pipe[0]);
+        close(thread->wake_pipe[1]);
+        lib_free(thread);
+        return NULL;
+    }
+
+    return thread;
+}
+
+/** \brief  Stop an I/O thread
+ *
+ * Frames still queued for transmission are sent before the thread goes
+ * away, received frames nobody picked up are dropped. The frame counters
+ * end up in the log.
+ *
+ * \param[in]   thread  I/O thread
+ */
+void rawnet_arch_thread_stop(rawnet_arch_thread_t *thread)
+{
+    atomic_store(&thread->stop, 1);
+    rawnet_arch_thread_wakeup(thread);
+    pthread_join(thread->thread, NULL);
+
+    /* the thread may have quit with frames still queued */
+    rawnet_arch_thread_flush(thread);
+
+    log_message(rawnet_arch_log,
+            "%s: received %lu frames (%lu dropped, queue depth max %u), "
+            "sent %lu frames (%lu dropped, queue depth max %u).",
+            thread->name,
+            thread->rx.frames, thread->rx.dropped, thread->rx.max_depth,
+            thread->tx.frames, thread->tx.dropped, thread->tx.max_depth);
+
+    close(thread->wake_pipe[0]);
+    close(thread->wake_pipe[1]);
+    lib_free(thread);
+}
+
+/** \brief  Get the slot for the next received frame (I/O thread only)
+ *
+ * If the ring is full, the frame has to be dropped, like a real chip drops
+ * frames when its buffer memory is used up.
+ *
+ * \param[in]   thread  I/O thread
+ *
+ * \return  slot to fill and hand over with rawnet_arch_thread_rx_push(),
+ *          or `NULL` if the ring is full
+ */
+rawnet_arch_frame_t *rawnet_arch_thread_rx_slot(rawnet_arch_thread_t *thread)
+{
+    return rawnet_arch_ring_free_slot(&thread->rx);
+}
+
+/** \brief  Hand the slot filled by the driver to the emulation
+ *
+ * \param[in]   thread  I/O thread
+ */
+void rawnet_arch_thread_rx_push(rawnet_arch_thread_t *thread)
+{
+    rawnet_arch_ring_push(&thread->rx);
+}
+
+/** \brief  Fetch a received frame
+ *
+ * \param[in]       thread  I/O thread
+ * \param[out]      buffer  where to store the frame
+ * \param[in,out]   plen    IN: size of \a buffer, OUT: bytes copied
+ *
+ * \return  1 if a frame was fetched, 0 if there was none
+ */
+int rawnet_arch_thread_receive(rawnet_arch_thread_t *thread, uint8_t *buffer, int *plen)
+{
+    rawnet_arch_frame_t *frame = rawnet_arch_ring_peek(&thread->rx);
+
+    if (frame == NULL) {
+        return 0;
+    }
+    if (frame->len < *plen) {
+        *plen = frame->len;
+    }
+    memcpy(buffer, frame->data, *plen);
+    rawnet_arch_ring_pop(&thread->rx);
+    return 1;
+}
+
+/** \brief  Queue a frame for transmission
+ *
+ * \param[in]   thread  I/O thread
+ * \param[in]   frame   frame data
+ * \param[in]   len     length of the frame
+ */
+void rawnet_arch_thread_transmit(rawnet_arch_thread_t *thread, uint8_t *frame, int len)
+{
+    rawnet_arch_frame_t *slot;
+
+    if (len > RAWNET_ARCH_FRAME_MAX) {
+        log_message(rawnet_arch_log,
+                "WARNING! Could not send packet, %d bytes is too long!", len);
+        return;
+    }
+
+    slot = rawnet_arch_ring_free_slot(&thread->tx);
+    if (slot == NULL) {
+        log_message(rawnet_arch_log,
+                "WARNING! Could not send packet, transmit queue is full!");
+        return;
+    }
+    slot->len = len;
+    memcpy(slot->data, frame, len);
+
+    /* the thread drains the whole ring once awake, so only the first frame
+       of a batch needs to wake it */
+    if (rawnet_arch_ring_push(&thread->tx)) {
+        rawnet_arch_thread_wakeup(thread);
+    }
+}
+
+#endif /* #ifdef HAVE_RAWNET */
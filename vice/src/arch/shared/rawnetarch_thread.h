@@ -0,0 +1,66 @@
+/** \file   rawnetarch_thread.h
+ * \brief   I/O thread and frame rings for the Unix rawnet drivers
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_RAWNETARCH_THREAD_H
+#define VICE_RAWNETARCH_THREAD_H
+
+#include <stdint.h>
+
+/** \brief  Largest frame a ring slot holds
+ */
+#define RAWNET_ARCH_FRAME_MAX   1700
+
+/** \brief  A frame slot of a ring
+ */
+typedef struct rawnet_arch_frame_s {
+    int len;                                /**< length of the frame */
+    uint8_t data[RAWNET_ARCH_FRAME_MAX];    /**< frame data */
+} rawnet_arch_frame_t;
+
+typedef struct rawnet_arch_thread_s rawnet_arch_thread_t;
+
+/** \brief  Called on the I/O thread whenever \a fd is readable
+ *
+ * Should fetch the pending frames with rawnet_arch_thread_rx_slot() and
+ * rawnet_arch_thread_rx_push().
+ */
+typedef void (*rawnet_arch_thread_read_t)(rawnet_arch_thread_t *thread, int fd);
+
+/** \brief  Called on the I/O thread to send a frame
+ */
+typedef void (*rawnet_arch_thread_write_t)(uint8_t *frame, int len);
+
+rawnet_arch_thread_t *rawnet_arch_thread_start(const char *name, int fd,
+                                               rawnet_arch_thread_read_t read_frames,
+                                               rawnet_arch_thread_write_t write_frame);
+void rawnet_arch_thread_stop(rawnet_arch_thread_t *thread);
+
+rawnet_arch_frame_t *rawnet_arch_thread_rx_slot(rawnet_arch_thread_t *thread);
+void rawnet_arch_thread_rx_push(rawnet_arch_thread_t *thread);
+
+int rawnet_arch_thread_receive(rawnet_arch_thread_t *thread, uint8_t *buffer, int *plen);
+void rawnet_arch_thread_transmit(rawnet_arch_thread_t *thread, uint8_t *frame, int len);
+
+#endif
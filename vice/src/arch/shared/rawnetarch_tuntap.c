@@ -48,6 +48,7 @@
 #include "lib.h"
 #include "log.h"
 #include "rawnetarch.h"
+#include "rawnetarch_thread.h"
 #include "resources.h"
 #include "util.h"
 
@@ -62,6 +63,9 @@
 /* "Clone device" (/dev/net/tun) file descriptor */
 static int rawnet_arch_tuntap_tun_fd = -1;
 
+/* I/O thread of the open adapter, or NULL if we do the syscalls ourselves */
+static rawnet_arch_thread_t *rawnet_arch_tuntap_thread = NULL;
+
 /* Populated while enumerating network interfaces */
 struct if_nameindex *enum_interfaces = NULL;
 int enum_interfaces_idx = -1;
@@ -155,16 +159,72 @@ static void rawnet_arch_tuntap_post_reset(void)
 {
 }
 
+/** \brief  Write a frame to the TAP device
+ *
+ * \param[in]   frame   frame data
+ * \param[in]   len     length of the frame
+ */
+static void rawnet_arch_tuntap_write(uint8_t *frame, int len)
+{
+    ssize_t res = write(rawnet_arch_tuntap_tun_fd, frame, len);
+    if (res < 0) {
+        log_message(rawnet_arch_log, "ERROR transmitting frame: '%s'", strerror(errno));
+    } else if (res != len) {
+        /* We should never break a frame */
+        log_message(rawnet_arch_log,
+                "ERROR transmitting frame: only %" PRI_SSIZE_T " of %d bytes sent",
+                res, len);
+    }
+}
+
+/** \brief  Read the pending frames into the RX ring, called on the I/O thread
+ *
+ * Each read() returns a single frame, and since the descriptor is blocking,
+ * we only read again while poll() reports another frame.
+ *
+ * \param[in]   thread  I/O thread
+ * \param[in]   fd      TAP descriptor
+ */
+static void rawnet_arch_tuntap_thread_read(rawnet_arch_thread_t *thread, int fd)
+{
+    struct pollfd pfd[1] = {{fd, POLLIN, 0}};
+    uint8_t scratch[RAWNET_ARCH_FRAME_MAX];
+    rawnet_arch_frame_t *frame;
+    ssize_t len;
+
+    do {
+        /* with the ring full the frame is still read, to drop it */
+        frame = rawnet_arch_thread_rx_slot(thread);
+        len = read(fd, frame != NULL ? frame->data : scratch, RAWNET_ARCH_FRAME_MAX);
+        if (len < 0) {
+            log_message(rawnet_arch_log, "ERROR receiving frame: '%s'", strerror(errno));
+            return;
+        }
+        if (frame != NULL) {
+            frame->len = (int)len;
+            rawnet_arch_thread_rx_push(thread);
+        }
+    } while (poll(pfd, 1, 0) > 0 && (pfd[0].revents & POLLIN));
+}
+
 static int rawnet_arch_tuntap_activate(const char *interface_name)
 {
     if (!rawnet_tuntap_open_adapter(interface_name)) {
         return 0;
     }
+    /* without the thread, we poll the device ourselves */
+    rawnet_arch_tuntap_thread = rawnet_arch_thread_start("tuntap",
+            rawnet_arch_tuntap_tun_fd, rawnet_arch_tuntap_thread_read,
+            rawnet_arch_tuntap_write);
     return 1;
 }
 
 static void rawnet_arch_tuntap_deactivate(void)
 {
+    if (rawnet_arch_tuntap_thread != NULL) {
+        rawnet_arch_thread_stop(rawnet_arch_tuntap_thread);
+        rawnet_arch_tuntap_thread = NULL;
+    }
     close(rawnet_arch_tuntap_tun_fd);
     rawnet_arch_tuntap_tun_fd = -1;
 }
@@ -204,17 +264,47 @@ static void rawnet_arch_tuntap_line_ctl(int bEnableTransmitter, int bEnableRecei
 static void rawnet_arch_tuntap_transmit(int force, int onecoll, int inhibit_crc,
                                  int tx_pad_dis, int txlength, uint8_t *txframe)
 {
-    ssize_t res = write(rawnet_arch_tuntap_tun_fd, txframe, txlength);
-    if (res < 0) {
-        log_message(rawnet_arch_log, "ERROR transmitting frame: '%s'", strerror(errno));
-    } else if (res != txlength) {
-        /* We should never break a frame */
-        log_message(rawnet_arch_log,
-                "ERROR transmitting frame: only %" PRI_SSIZE_T " of %d bytes sent",
-                res, txlength);
+    if (rawnet_arch_tuntap_thread != NULL) {
+        rawnet_arch_thread_transmit(rawnet_arch_tuntap_thread, txframe, txlength);
+    } else {
+        rawnet_arch_tuntap_write(txframe, txlength);
     }
 }
 
+/** \brief  Read a frame from the TAP device if one is pending
+ *
+ * \param[out]  pbuffer     where to store the frame
+ * \param[in]   size        size of \a pbuffer
+ *
+ * \return  length of the frame, or -1 if there was none
+ */
+static ssize_t rawnet_arch_tuntap_read(uint8_t *pbuffer, int size)
+{
+    struct pollfd pfd[1] = {{rawnet_arch_tuntap_tun_fd, POLLIN, 0}};
+    ssize_t len;
+    int pollres;
+
+    pollres = poll(pfd, 1, 0);
+
+    if (pollres == 0) {
+        return -1;
+    } else if (pollres < 0) {
+        log_message(rawnet_arch_log, "ERROR polling for new frames: '%s'", strerror(errno));
+        return -1;
+    }
+
+    if ((pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+        log_message(rawnet_arch_log, "WARNING: unexpected event while polling for new frames");
+        return -1;
+    }
+
+    len = read(rawnet_arch_tuntap_tun_fd, pbuffer, size);
+    if (len == -1) {
+        log_message(rawnet_arch_log, "ERROR receiving frame: '%s'", strerror(errno));
+    }
+    return len;
+}
+
 /**
  * \brief   Check if a frame was received
  *
@@ -257,29 +347,22 @@ static int rawnet_arch_tuntap_receive(uint8_t *pbuffer, int *plen, int  *phashed
         int *phash_index, int *prx_ok, int *pcorrect_mac, int *pbroadcast,
         int *pcrc_error)
 {
-    struct pollfd pfd[1] = {{rawnet_arch_tuntap_tun_fd, POLLIN, 0}};
     ssize_t len;
-    int pollres;
 
     assert((*plen & 1) == 0);
 
-    pollres = poll(pfd, 1, 0);
-
-    if (pollres == 0) {
-        return 0;
-    } else if (pollres < 0) {
-        log_message(rawnet_arch_log, "ERROR polling for new frames: '%s'", strerror(errno));
-        return 0;
-    }
+    if (rawnet_arch_tuntap_thread != NULL) {
+        /* the I/O thread has done the receiving, just look into the ring */
+        int rlen = *plen;
 
-    if ((pfd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
-        log_message(rawnet_arch_log, "WARNING: unexpected event while polling for new frames");
-        return 0;
+        len = -1;
+        if (rawnet_arch_thread_receive(rawnet_arch_tuntap_thread, pbuffer, &rlen)) {
+            len = rlen;
+        }
+    } else {
+        len = rawnet_arch_tuntap_read(pbuffer, *plen);
     }
-
-    len = read(rawnet_arch_tuntap_tun_fd, pbuffer, *plen);
     if (len == -1) {
-        log_message(rawnet_arch_log, "ERROR receiving frame: '%s'", strerror(errno));
         return 0;
     }
 
@@ -55,6 +55,7 @@
 #include "lib.h"
 #include "log.h"
 #include "rawnetarch.h"
+#include "rawnetarch_thread.h"
 
 /*
  *  FIXME:  rename all remaining tfe_ stuff to rawnet_
@@ -111,6 +112,14 @@ static char TfeLibnetErrBuf[LIBNET_ERRBUF_SIZE];
  */
 static char rawnet_pcap_errbuf[PCAP_ERRBUF_SIZE];
 
+
+/** \brief  I/O thread of the open adapter, or `NULL` if we poll pcap ourselves
+ */
+static rawnet_arch_thread_t *rawnet_pcap_thread = NULL;
+
+static void rawnet_pcap_thread_start(void);
+static void rawnet_pcap_thread_stop_and_join(void);
+
 static int rawnet_arch_pcap_enumadapter_open(void)
 {
     if (pcap_findalldevs(&rawnet_pcap_dev_list, rawnet_pcap_errbuf) == -1) {
@@ -184,7 +193,7 @@ static int rawnet_arch_pcap_enumadapter_close(void)
 
 static int rawnet_pcap_open_adapter(const char *interface_name)
 {
-    rawnet_pcap_fp = pcap_open_live((char*)interface_name, 1700, 1, 20, rawnet_pcap_errbuf);
+    rawnet_pcap_fp = pcap_open_live((char*)interface_name, RAWNET_ARCH_FRAME_MAX, 1, 20, rawnet_pcap_errbuf);
     if ( rawnet_pcap_fp == NULL) {
         log_message(rawnet_arch_log, "ERROR opening adapter: '%s'", rawnet_pcap_errbuf);
         return 0;
@@ -235,14 +244,19 @@ static void rawnet_arch_pcap_post_reset(void)
 
 static int rawnet_arch_pcap_activate(const char *interface_name)
 {
+    rawnet_pcap_thread_stop_and_join();
+
     if (!rawnet_pcap_open_adapter(interface_name)) {
         return 0;
     }
+
+    rawnet_pcap_thread_start();
     return 1;
 }
 
 static void rawnet_arch_pcap_deactivate( void )
 {
+    rawnet_pcap_thread_stop_and_join();
 }
 
 static void rawnet_arch_pcap_set_mac( const uint8_t mac[6] )
@@ -431,6 +445,85 @@ static void rawnet_arch_transmit_pcap(int force, int onecoll, int inhibit_crc,
 #endif /* HAVE_LIBNET */
 
 
+/* ------------------------------------------------------------------------- */
+/*    I/O thread                                                             */
+
+/*
+ * With an I/O thread (see rawnetarch_thread.c) the emulation never calls
+ * into pcap, it only looks into the frame rings. If pcap cannot give us a
+ * descriptor to wait on, or the thread cannot be created, frames are
+ * received and sent directly.
+ */
+
+/** \brief  pcap callback of the I/O thread, puts a frame into the RX ring
+ *
+ * \param[in]   param       I/O thread
+ * \param[in]   header      pcap header
+ * \param[in]   pkt_data    packet data
+ */
+static void rawnet_pcap_thread_packet_handler(u_char *param,
+        const struct pcap_pkthdr *header, const u_char *pkt_data)
+{
+    rawnet_arch_thread_t *thread = (void *)param;
+    rawnet_arch_frame_t *frame = rawnet_arch_thread_rx_slot(thread);
+
+    if (frame != NULL) {
+        frame->len = header->caplen < RAWNET_ARCH_FRAME_MAX
+                   ? (int)header->caplen : RAWNET_ARCH_FRAME_MAX;
+        memcpy(frame->data, pkt_data, frame->len);
+        rawnet_arch_thread_rx_push(thread);
+    }
+}
+
+/** \brief  Fetch the pending frames, called on the I/O thread
+ *
+ * \param[in]   thread  I/O thread
+ * \param[in]   fd      pcap's selectable descriptor
+ */
+static void rawnet_pcap_thread_read(rawnet_arch_thread_t *thread, int fd)
+{
+    pcap_dispatch(rawnet_pcap_fp, -1, rawnet_pcap_thread_packet_handler,
+            (void *)thread);
+}
+
+/** \brief  Send a frame, called on the I/O thread
+ *
+ * \param[in]   frame   frame data
+ * \param[in]   len     length of the frame
+ */
+static void rawnet_pcap_thread_write(uint8_t *frame, int len)
+{
+    RAWNET_ARCH_TRANSMIT(0, 0, 0, 0, len, frame);
+}
+
+/** \brief  Start the I/O thread on the adapter just opened
+ *
+ * Leaves \a rawnet_pcap_thread `NULL` if that is not possible.
+ */
+static void rawnet_pcap_thread_start(void)
+{
+    int fd = pcap_get_selectable_fd(rawnet_pcap_fp);
+
+    if (fd < 0) {
+        log_message(rawnet_arch_log,
+                "pcap has no selectable descriptor, receiving synchronously.");
+        return;
+    }
+    rawnet_pcap_thread = rawnet_arch_thread_start("pcap", fd,
+            rawnet_pcap_thread_read, rawnet_pcap_thread_write);
+}
+
+/** \brief  Stop the I/O thread if it runs
+ */
+static void rawnet_pcap_thread_stop_and_join(void)
+{
+    if (rawnet_pcap_thread != NULL) {
+        rawnet_arch_thread_stop(rawnet_pcap_thread);
+        rawnet_pcap_thread = NULL;
+    }
+}
+
+
 /** \brief  Transmit a frame
  *
  * \param[in]   force       Delete waiting frames in transmit buffer
@@ -443,6 +536,11 @@ static void rawnet_arch_transmit_pcap(int force, int onecoll, int inhibit_crc,
 static void rawnet_arch_pcap_transmit(int force, int onecoll, int inhibit_crc,
                                int tx_pad_dis, int txlength, uint8_t *txframe)
 {
+    if (rawnet_pcap_thread != NULL) {
+        rawnet_arch_thread_transmit(rawnet_pcap_thread, txframe, txlength);
+        return;
+    }
+
     RAWNET_ARCH_TRANSMIT(force, onecoll, inhibit_crc, tx_pad_dis, txlength,
             txframe);
 }
@@ -496,7 +594,16 @@ static int rawnet_arch_pcap_receive(uint8_t *pbuffer, int *plen, int  *phashed,
 
     assert((*plen & 1) == 0);
 
-    len = rawnet_arch_pcap_receive_frame(&internal);
+    if (rawnet_pcap_thread != NULL) {
+        /* the I/O thread has done the receiving, just look into the ring */
+        len = *plen;
+        if (!rawnet_arch_thread_receive(rawnet_pcap_thread, pbuffer, &len)) {
+            len = -1;
+        }
+        internal.len = len;
+    } else {
+        len = rawnet_arch_pcap_receive_frame(&internal);
+    }
 
     if (len != -1) {
 
@@ -0,0 +1,441 @@
+/**
+ * \file render_queue.c
+ * \brief Manage a queue of rendered backbuffers to display
+ *
+ * \author David Hogan <david.q.hogan@gmail.com>
+ */
+
+/* This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+#include "render_queue.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "memusage.h"
+#include "video.h"
+#include "vsyncapi.h"
+
+/*
+ * Lock free: the emulation thread takes backbuffers from the pool and
+ * appends them to the display queue, the render thread removes them from
+ * the queue.  Either thread returns them to the pool.
+ *
+ * The display queue is a single producer, single consumer ring.  Each end
+ * is only written by its own thread and published with release semantics,
+ * the other end is read with acquire semantics.
+ *
+ * The pool is one flag per backbuffer, set while it is in the pool.  Taking
+ * a backbuffer clears its flag with a compare and swap, so the pool does
+ * not depend on which thread returns a backbuffer.
+ */
+
+typedef struct vice_render_queue_s {
+    /** All backbuffers, owned by the queue */
+    backbuffer_t *backbuffers[RENDER_QUEUE_MAX_BACKBUFFERS];
+
+    /** Nonzero while the backbuffer with the same index is unused */
+    atomic_int backbuffer_free[RENDER_QUEUE_MAX_BACKBUFFERS];
+
+    /** Holds the queue of backbuffers ready to render */
+    backbuffer_t *render_queue[RENDER_QUEUE_MAX_BACKBUFFERS];
+
+    /** Count of backbuffers ever dequeued, written by the consumer */
+    atomic_uint render_queue_head;
+
+    /** Count of backbuffers ever enqueued, written by the producer */
+    atomic_uint render_queue_tail;
+} render_queue_t;
+
+/** Bytes of pixel data held by the backbuffers of all queues */
+static size_t pixel_data_bytes = 0;
+
+static size_t render_queue_usage(void)
+{
+    return pixel_data_bytes;
+}
+
+static void free_backbuffer(backbuffer_t *backbuffer) {
+    pixel_data_bytes -= backbuffer->pixel_data_size_bytes;
+    video_render_deferred_free(backbuffer->deferred);
+    lib_free(backbuffer->pixel_data);
+    lib_free(backbuffer);
+}
+
+/****/
+
+/** \brief Allocate, initialise and return a new render queue. */
+void *render_queue_create(void)
+{
+    render_queue_t *rq;
+    backbuffer_t *bb;
+    int i;
+
+    rq = lib_calloc(1, sizeof(render_queue_t));
+
+    /* Seed the pool with the maximum number of backbuffers */
+    for (i = 0; i < RENDER_QUEUE_MAX_BACKBUFFERS; i++) {
+
+        bb = lib_malloc(sizeof(backbuffer_t));
+        bb->pixel_data = lib_malloc(0);
+        bb->pixel_data_size_bytes = 0;
+        bb->width = 0;
+        bb->height = 0;
+        bb->pitch = 0;
+        bb->pixel_aspect_ratio = 0.0f;
+        bb->deferred = NULL;
+        bb->render_deferred = false;
+
+        rq->backbuffers[i] = bb;
+        atomic_init(&rq->backbuffer_free[i], 1);
+    }
+    atomic_init(&rq->render_queue_head, 0);
+    atomic_init(&rq->render_queue_tail, 0);
+
+    memusage_register("render queue", render_queue_usage);
+
+    return rq;
+}
+
+/** \brief Destroy a render queue.
+ *
+ * Neither thread may use the queue any more, all the backbuffers are freed
+ * including any that have not been returned to the pool.
+ */
+void render_queue_destroy(void *render_queue)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+    int i;
+
+    for (i = 0; i < RENDER_QUEUE_MAX_BACKBUFFERS; i++) {
+        free_backbuffer(rq->backbuffers[i]);
+    }
+
+    lib_free(render_queue);
+}
+
+/****/
+
+/** Obtain unused backbuffer for offscreen rendering, or NULL if none available */
+backbuffer_t *render_queue_get_from_pool(void *render_queue, int pixel_data_size_bytes)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+    backbuffer_t *bb = NULL;
+    int i;
+
+    for (i = 0; i < RENDER_QUEUE_MAX_BACKBUFFERS; i++) {
+        int expected = 1;
+
+        if (atomic_compare_exchange_strong_explicit(&rq->backbuffer_free[i], &expected, 0,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            bb = rq->backbuffers[i];
+            break;
+        }
+    }
+
+    if (bb == NULL) {
+        /* no buffers available, skip this frame */
+        return NULL;
+    }
+
+    /* Make sure there's at least the requested size in bytes */
+    if (bb->pixel_data_size_bytes < pixel_data_size_bytes) {
+        lib_free(bb->pixel_data);
+        bb->pixel_data = lib_malloc(pixel_data_size_bytes);
+        pixel_data_bytes += pixel_data_size_bytes - bb->pixel_data_size_bytes;
+        bb->pixel_data_size_bytes = pixel_data_size_bytes;
+    }
+
+    bb->width = 0;
+    bb->height = 0;
+    bb->pitch = 0;
+    bb->pixel_aspect_ratio = 0.0f;
+    bb->indexed = false;
+    bb->changed_rows = NULL;
+
+    return bb;
+}
+
+/** Add backbuffer to the queue of backbuffers to be displayed */
+void render_queue_enqueue_for_display(void *render_queue, backbuffer_t *backbuffer)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+    unsigned int tail = atomic_load_explicit(&rq->render_queue_tail, memory_order_relaxed);
+
+    assert(tail - atomic_load_explicit(&rq->render_queue_head, memory_order_acquire) < RENDER_QUEUE_MAX_BACKBUFFERS);
+
+    rq->render_queue[tail % RENDER_QUEUE_MAX_BACKBUFFERS] = backbuffer;
+    atomic_store_explicit(&rq->render_queue_tail, tail + 1, memory_order_release);
+}
+
+unsigned int render_queue_length(void *render_queue)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+    unsigned int head = atomic_load_explicit(&rq->render_queue_head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&rq->render_queue_tail, memory_order_acquire);
+
+    return tail - head;
+}
+
+/** Obtain rendered backbuffer for display, or NULL if none available */
+backbuffer_t *render_queue_dequeue_for_display(void *render_queue)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+    unsigned int head = atomic_load_explicit(&rq->render_queue_head, memory_order_relaxed);
+    backbuffer_t *backbuffer;
+
+    /* Are there any available? */
+    if (head == atomic_load_explicit(&rq->render_queue_tail, memory_order_acquire)) {
+        return NULL;
+    }
+
+    backbuffer = rq->render_queue[head % RENDER_QUEUE_MAX_BACKBUFFERS];
+    atomic_store_explicit(&rq->render_queue_head, head + 1, memory_order_release);
+
+    return backbuffer;
+}
+
+void render_queue_return_to_pool(void *render_queue, backbuffer_t *backbuffer)
+{
+    render_queue_t *rq = (render_queue_t *)render_queue;
+    int i;
+
+    for (i = 0; i < RENDER_QUEUE_MAX_BACKBUFFERS; i++) {
+        if (rq->backbuffers[i] == backbuffer) {
+            assert(atomic_load_explicit(&rq->backbuffer_free[i], memory_order_relaxed) == 0);
+            atomic_store_explicit(&rq->backbuffer_free[i], 1, memory_order_release);
+            return;
+        }
+    }
+    assert(0 && "backbuffer not from this queue");
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* With -renderqueuebench <frames> the calling thread acts as the emulation
+   thread of two canvases (x128 with VIC-II and VDC), each with its own
+   queue and a render thread that displays and returns the backbuffers.
+   The producer timestamps every backbuffer it enqueues, the consumer takes
+   the difference when it dequeues it.  Neither side sleeps, they only yield
+   while the queue is empty or the pool exhausted, so the numbers are the
+   cost of the queue itself under contention.  */
+
+#define BENCH_QUEUES        2
+#define BENCH_FRAME_BYTES   (384 * 272 * 4)
+
+typedef struct bench_stats_s {
+    tick_t min;
+    tick_t max;
+    uint64_t total;
+    uint64_t count;
+} bench_stats_t;
+
+typedef struct bench_consumer_s {
+    void *render_queue;
+    unsigned long frames;
+    bench_stats_t latency;
+    bench_stats_t dequeue;
+} bench_consumer_t;
+
+static void bench_stats_add(bench_stats_t *stats, tick_t value)
+{
+    if (stats->count == 0 || value < stats->min) {
+        stats->min = value;
+    }
+    if (value > stats->max) {
+        stats->max = value;
+    }
+    stats->total += value;
+    stats->count++;
+}
+
+static void bench_stats_print(const char *name, const bench_stats_t *stats)
+{
+    double us = 1000000.0 / tick_per_second();
+
+    if (stats->count == 0) {
+        return;
+    }
+    fprintf(stdout, "RENDERQUEUEBENCH: %-8s min %8.3f avg %8.3f max %10.3f us (%"PRIu64" ops)\n",
+            name, stats->min * us, (double)stats->total / stats->count * us, stats->max * us,
+            stats->count);
+}
+
+static void *bench_consumer_main(void *arg)
+{
+    bench_consumer_t *consumer = arg;
+    unsigned long done = 0;
+
+    while (done < consumer->frames) {
+        tick_t start = tick_now();
+        backbuffer_t *bb = render_queue_dequeue_for_display(consumer->render_queue);
+        tick_t now;
+        tick_t sent;
+
+        if (bb == NULL) {
+            sched_yield();
+            continue;
+        }
+        now = tick_now();
+        bench_stats_add(&consumer->dequeue, now - start);
+
+        memcpy(&sent, bb->pixel_data, sizeof(sent));
+        bench_stats_add(&consumer->latency, now - sent);
+
+        render_queue_return_to_pool(consumer->render_queue, bb);
+        done++;
+    }
+
+    return NULL;
+}
+
+static int cmdline_renderqueuebench(const char *param, void *extra_param)
+{
+    bench_consumer_t consumers[BENCH_QUEUES];
+    pthread_t threads[BENCH_QUEUES];
+    bench_stats_t get_stats, enqueue_stats, latency, dequeue;
+    unsigned long frames, sent[BENCH_QUEUES];
+    unsigned long skipped = 0;
+    char *end;
+    tick_t start;
+    double seconds;
+    int i, busy;
+
+    frames = strtoul(param, &end, 0);
+    if (*end != 0 || frames == 0) {
+        return -1;
+    }
+
+    memset(&get_stats, 0, sizeof(get_stats));
+    memset(&enqueue_stats, 0, sizeof(enqueue_stats));
+    memset(consumers, 0, sizeof(consumers));
+
+    for (i = 0; i < BENCH_QUEUES; i++) {
+        consumers[i].render_queue = render_queue_create();
+        consumers[i].frames = frames;
+        sent[i] = 0;
+        if (pthread_create(&threads[i], NULL, bench_consumer_main, &consumers[i]) != 0) {
+            fprintf(stderr, "RENDERQUEUEBENCH: cannot create the consumer threads\n");
+            archdep_vice_exit(EXIT_FAILURE);
+        }
+    }
+
+    start = tick_now();
+    do {
+        busy = 0;
+        for (i = 0; i < BENCH_QUEUES; i++) {
+            void *rq = consumers[i].render_queue;
+            backbuffer_t *bb;
+            tick_t t0, t1, t2;
+
+            if (sent[i] == frames) {
+                continue;
+            }
+            busy = 1;
+
+            t0 = tick_now();
+            bb = render_queue_get_from_pool(rq, BENCH_FRAME_BYTES);
+            t1 = tick_now();
+            if (bb == NULL) {
+                /* the renderer has not caught up, the frame is skipped */
+                skipped++;
+                sched_yield();
+                continue;
+            }
+            bench_stats_add(&get_stats, t1 - t0);
+
+            /* touch the frame like a renderer would */
+            memset(bb->pixel_data, (int)sent[i], BENCH_FRAME_BYTES);
+            bb->width = 384;
+            bb->height = 272;
+
+            t1 = tick_now();
+            memcpy(bb->pixel_data, &t1, sizeof(t1));
+            render_queue_enqueue_for_display(rq, bb);
+            t2 = tick_now();
+            bench_stats_add(&enqueue_stats, t2 - t1);
+            sent[i]++;
+        }
+    } while (busy);
+
+    memset(&latency, 0, sizeof(latency));
+    memset(&dequeue, 0, sizeof(dequeue));
+    for (i = 0; i < BENCH_QUEUES; i++) {
+        pthread_join(threads[i], NULL);
+        render_queue_destroy(consumers[i].render_queue);
+
+        if (consumers[i].latency.count != 0) {
+            if (latency.count == 0 || consumers[i].latency.min < latency.min) {
+                latency.min = consumers[i].latency.min;
+            }
+            if (dequeue.count == 0 || consumers[i].dequeue.min < dequeue.min) {
+                dequeue.min = consumers[i].dequeue.min;
+            }
+        }
+        if (consumers[i].latency.max > latency.max) {
+            latency.max = consumers[i].latency.max;
+        }
+        if (consumers[i].dequeue.max > dequeue.max) {
+            dequeue.max = consumers[i].dequeue.max;
+        }
+        latency.total += consumers[i].latency.total;
+        latency.count += consumers[i].latency.count;
+        dequeue.total += consumers[i].dequeue.total;
+        dequeue.count += consumers[i].dequeue.count;
+    }
+    seconds = (double)tick_now_delta(start) / tick_per_second();
+    if (seconds <= 0.0) {
+        seconds = 1.0 / tick_per_second();
+    }
+
+    fprintf(stdout, "RENDERQUEUEBENCH: %lu frames on %d queues in %.3f s: %.0f frames/s, %lu pool misses\n",
+            frames, BENCH_QUEUES, seconds, (double)frames * BENCH_QUEUES / seconds, skipped);
+    bench_stats_print("get", &get_stats);
+    bench_stats_print("enqueue", &enqueue_stats);
+    bench_stats_print("dequeue", &dequeue);
+    bench_stats_print("latency", &latency);
+    fflush(stdout);
+
+    archdep_vice_exit(EXIT_SUCCESS);
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-renderqueuebench", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_renderqueuebench, NULL, NULL, NULL,
+      "<frames>", "Pass <frames> frames through two render queues, print the queue latencies, then quit" },
+    CMDLINE_LIST_END
+};
+
+int render_queue_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -38,9 +38,30 @@ typedef struct {
     unsigned int pixel_data_size_bytes;
     unsigned int width;
     unsigned int height;
+    /* bytes per row of pixel_data, 0 for width * 4 */
+    unsigned int pitch;
     float pixel_aspect_ratio;
+    /* pixel_data holds palette indices of indexed_width x indexed_height
+       draw buffer pixels rather than width x height RGBA pixels */
+    bool indexed;
+    unsigned int indexed_width;
+    unsigned int indexed_height;
+    int indexed_first_line;
+    /* one flag per row, set if it changed since the previous backbuffer;
+       NULL if all rows must be uploaded */
+    unsigned char *changed_rows;
+    /* the RGBA pixels are still to be rendered from deferred by the
+       consumer; deferred is allocated by the producer when it first
+       needs it, and freed with the backbuffer */
+    bool render_deferred;
+    struct video_render_deferred_s *deferred;
 } backbuffer_t;
 
+/* Each queue has one producer thread, which takes backbuffers from the pool
+   and enqueues them, and one consumer thread, which dequeues them.  Both may
+   return backbuffers to the pool.  Another thread may take over either role
+   as long as the hand-over is serialised, e.g. by a lock held around it.  */
+
 void *render_queue_create(void);
 void render_queue_destroy(void *render_queue);
 
@@ -50,4 +71,6 @@ unsigned int render_queue_length(void *render_queue);
 backbuffer_t *render_queue_dequeue_for_display(void *render_queue);
 void render_queue_return_to_pool(void *render_queue, backbuffer_t *backbuffer);
 
+int render_queue_cmdline_options_init(void);
+
 #endif /* #ifndef VICE_RENDER_QUEUE_H */
@@ -43,6 +43,15 @@
 #define ESTRPIPE EPIPE
 #endif
 
+/* the float based sound system plays float samples */
+#ifdef SOUND_SYSTEM_FLOAT
+#define ALSA_SAMPLE_FORMAT SND_PCM_FORMAT_FLOAT
+typedef float alsa_sample_t;
+#else
+#define ALSA_SAMPLE_FORMAT SND_PCM_FORMAT_S16
+typedef int16_t alsa_sample_t;
+#endif
+
 static snd_pcm_t *handle;
 static int alsa_bufsize;
 static int alsa_fragsize;
@@ -78,7 +87,7 @@ static int alsa_init(const char *param, int *speed, int *fragsize, int *fragnr,
         goto fail;
     }
 
-    if ((err = snd_pcm_hw_params_set_format(handle, hwparams, SND_PCM_FORMAT_S16)) < 0) {
+    if ((err = snd_pcm_hw_params_set_format(handle, hwparams, ALSA_SAMPLE_FORMAT)) < 0) {
         log_message(LOG_DEFAULT, "Sample format not available for playback: %s", snd_strerror(err));
         goto fail;
     }
@@ -163,7 +172,7 @@ static int xrun_recovery(snd_pcm_t *hnd, int err)
     return err;
 }
 
-static int alsa_write(int16_t *pbuf, size_t nr)
+static int alsa_write_samples(alsa_sample_t *pbuf, size_t nr)
 {
     int err;
 
@@ -185,6 +194,18 @@ static int alsa_write(int16_t *pbuf, size_t nr)
     return 0;
 }
 
+#ifdef SOUND_SYSTEM_FLOAT
+static int alsa_write_float(float *pbuf, size_t nr)
+{
+    return alsa_write_samples(pbuf, nr);
+}
+#else
+static int alsa_write(int16_t *pbuf, size_t nr)
+{
+    return alsa_write_samples(pbuf, nr);
+}
+#endif
+
 static int alsa_bufferspace(void)
 {
 #ifdef HAVE_SND_PCM_AVAIL
@@ -246,7 +267,11 @@ static const sound_device_t alsa_device =
 {
     "alsa",
     alsa_init,
+#ifdef SOUND_SYSTEM_FLOAT
+    NULL,
+#else
     alsa_write,
+#endif
     NULL,
     NULL,
     alsa_bufferspace,
@@ -255,7 +280,12 @@ static const sound_device_t alsa_device =
     alsa_resume,
     1,
     2,
-    true
+    true,
+#ifdef SOUND_SYSTEM_FLOAT
+    alsa_write_float
+#else
+    NULL
+#endif
 };
 
 int sound_init_alsa_device(void)
@@ -64,8 +64,17 @@ char *requested_device_name = NULL;
 static AudioDeviceID device = kAudioDeviceUnknown;
 
 
+/* the float based sound system plays float samples */
+#ifdef SOUND_SYSTEM_FLOAT
+#define COREAUDIO_FORMAT_FLAGS (kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked)
+typedef float coreaudio_sample_t;
+#else
+#define COREAUDIO_FORMAT_FLAGS kAudioFormatFlagIsSignedInteger
+typedef int16_t coreaudio_sample_t;
+#endif
+
 /* the cyclic buffer containing m fragments */
-static volatile int16_t *ringbuffer;
+static volatile coreaudio_sample_t *ringbuffer;
 
 /* the buffer used to pass non cyclic data to the driver  */
 static uint8_t *copybuffer;
@@ -119,8 +128,8 @@ static OSStatus converter_input(AudioConverterRef inAudioConverter,
     int queued_frames;
     int queued_bytes;
 
-    int16_t *source;
-    int16_t *dest;
+    coreaudio_sample_t *source;
+    coreaudio_sample_t *dest;
 
     /* ensure our copy buffer is large enough */
     if (needed_bytes > copybuffer_size_bytes) {
@@ -129,7 +138,7 @@ static OSStatus converter_input(AudioConverterRef inAudioConverter,
         copybuffer = lib_malloc(copybuffer_size_bytes);
         log_message(LOG_DEFAULT, "Copybuffer increase to %d bytes", copybuffer_size_bytes);
     }
-    dest = (int16_t *)copybuffer;
+    dest = (coreaudio_sample_t *)copybuffer;
 
     /* prepare return buffer */
     ioData->mBuffers[0].mNumberChannels = in_channels;
@@ -148,7 +157,7 @@ static OSStatus converter_input(AudioConverterRef inAudioConverter,
     /* If we don't have enough audio queued, lead with silence */
     if (needed_bytes > queued_bytes) {
         memset(dest, 0, needed_bytes - queued_bytes);
-        dest = (int16_t *)(copybuffer + needed_bytes - queued_bytes);
+        dest = (coreaudio_sample_t *)(copybuffer + needed_bytes - queued_bytes);
 
         needed_frames   -= needed_frames - queued_frames;
         needed_bytes    -= needed_bytes - queued_bytes;
@@ -162,7 +171,7 @@ static OSStatus converter_input(AudioConverterRef inAudioConverter,
 
         /* calc position in ring buffer */
         int sample_offset_in_fragment = frames_in_fragment - frames_left_in_fragment;
-        source = (int16_t *)ringbuffer + (swords_in_fragment * read_position) + (sample_offset_in_fragment * in_channels);
+        source = (coreaudio_sample_t *)ringbuffer + (swords_in_fragment * read_position) + (sample_offset_in_fragment * in_channels);
 
         if (needed_frames < frames_left_in_fragment) {
             /* The current fragement has more than enough, so it will be read from again next time. */
@@ -652,10 +661,10 @@ static int coreaudio_init(const char *param, int *speed,
 
     /* the size of a fragment in bytes and SWORDs */
     swords_in_fragment = frames_in_fragment * in_channels;
-    bytes_in_fragment = swords_in_fragment * sizeof(int16_t);
+    bytes_in_fragment = swords_in_fragment * sizeof(coreaudio_sample_t);
 
     /* the size of a sample */
-    in_frame_byte_size = sizeof(int16_t) * in_channels;
+    in_frame_byte_size = sizeof(coreaudio_sample_t) * in_channels;
 
     /* allocate sound buffers */
     ringbuffer = lib_calloc(fragment_count, bytes_in_fragment);
@@ -664,11 +673,11 @@ static int coreaudio_init(const char *param, int *speed,
     in.mChannelsPerFrame = *channels;
     in.mSampleRate = (float)*speed;
     in.mFormatID = kAudioFormatLinearPCM;
-    in.mFormatFlags = kAudioFormatFlagIsSignedInteger;
-    in.mBytesPerFrame = sizeof(int16_t) * *channels;
+    in.mFormatFlags = COREAUDIO_FORMAT_FLAGS;
+    in.mBytesPerFrame = sizeof(coreaudio_sample_t) * *channels;
     in.mBytesPerPacket = in.mBytesPerFrame;
     in.mFramesPerPacket = 1;
-    in.mBitsPerChannel = 8 * sizeof(int16_t);
+    in.mBitsPerChannel = 8 * sizeof(coreaudio_sample_t);
     in.mReserved = 0;
 
     /* setup audio device */
@@ -682,7 +691,7 @@ static int coreaudio_init(const char *param, int *speed,
     return 0;
 }
 
-static int coreaudio_write(int16_t *pbuf, size_t nr)
+static int coreaudio_write_samples(coreaudio_sample_t *pbuf, size_t nr)
 {
     int i;
     size_t count;
@@ -697,7 +706,7 @@ static int coreaudio_write(int16_t *pbuf, size_t nr)
             return 0;
         }
 
-        memcpy((int16_t *)ringbuffer + (swords_in_fragment * write_position),
+        memcpy((coreaudio_sample_t *)ringbuffer + (swords_in_fragment * write_position),
                pbuf + (i * swords_in_fragment),
                bytes_in_fragment);
 
@@ -711,6 +720,18 @@ static int coreaudio_write(int16_t *pbuf, size_t nr)
     return 0;
 }
 
+#ifdef SOUND_SYSTEM_FLOAT
+static int coreaudio_write_float(float *pbuf, size_t nr)
+{
+    return coreaudio_write_samples(pbuf, nr);
+}
+#else
+static int coreaudio_write(int16_t *pbuf, size_t nr)
+{
+    return coreaudio_write_samples(pbuf, nr);
+}
+#endif
+
 static int coreaudio_bufferspace(void)
 {
     return (fragment_count - fragments_in_queue) * frames_in_fragment;
@@ -768,7 +789,11 @@ static const sound_device_t coreaudio_device =
 {
     "coreaudio",
     coreaudio_init,
+#ifdef SOUND_SYSTEM_FLOAT
+    NULL,
+#else
     coreaudio_write,
+#endif
     NULL,
     NULL,
     coreaudio_bufferspace,
@@ -777,7 +802,12 @@ static const sound_device_t coreaudio_device =
     coreaudio_resume,
     1,
     2,
-    true
+    true,
+#ifdef SOUND_SYSTEM_FLOAT
+    coreaudio_write_float
+#else
+    NULL
+#endif
 };
 
 int sound_init_coreaudio_device(void)
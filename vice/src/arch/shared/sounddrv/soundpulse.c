@@ -36,6 +36,15 @@
 
 static pa_simple *simple = NULL;
 
+/* the float based sound system plays float samples */
+#ifdef SOUND_SYSTEM_FLOAT
+#define PULSE_SAMPLE_FORMAT PA_SAMPLE_FLOAT32NE
+#define PULSE_SAMPLE_SIZE   sizeof(float)
+#else
+#define PULSE_SAMPLE_FORMAT PA_SAMPLE_S16LE
+#define PULSE_SAMPLE_SIZE   sizeof(int16_t)
+#endif
+
 
 /* XXX: gcc's -pedantic will warn about these initializations being invalid for
  *      C90, but PulseAudio uses C99 (it uses inttypes.h), so in this case
@@ -43,7 +52,7 @@ static pa_simple *simple = NULL;
  */
 
 static pa_sample_spec ss = {
-    .format = PA_SAMPLE_S16LE,
+    .format = PULSE_SAMPLE_FORMAT,
     .rate = (uint32_t) -1,
     .channels = 0,
 };
@@ -68,8 +77,8 @@ static int pulsedrv_init(const char *param, int *speed, int *fragsize, int *frag
     ss.rate = (uint32_t)*speed;
     ss.channels = (uint8_t)*channels;
 
-    attr.fragsize = (uint32_t)(*fragsize * 2);
-    attr.tlength = (uint32_t)(*fragsize * *fragnr * 2);
+    attr.fragsize = (uint32_t)(*fragsize * PULSE_SAMPLE_SIZE);
+    attr.tlength = (uint32_t)(*fragsize * *fragnr * PULSE_SAMPLE_SIZE);
 
     simple = pa_simple_new(NULL, "VICE", PA_STREAM_PLAYBACK, NULL, "playback", &ss, NULL, &attr, &error);
     if (simple == NULL) {
@@ -80,10 +89,10 @@ static int pulsedrv_init(const char *param, int *speed, int *fragsize, int *frag
     return 0;
 }
 
-static int pulsedrv_write(int16_t *pbuf, size_t nr)
+static int pulsedrv_write_bytes(const void *pbuf, size_t nr)
 {
     int error = 0;
-    if (pa_simple_write(simple, pbuf, nr * 2, &error)) {
+    if (pa_simple_write(simple, pbuf, nr * PULSE_SAMPLE_SIZE, &error)) {
         log_error(LOG_DEFAULT, "pa_simple_write(,%d): %s", (int)nr, pa_strerror(error));
         return 1;
     }
@@ -91,6 +100,18 @@ static int pulsedrv_write(int16_t *pbuf, size_t nr)
     return 0;
 }
 
+#ifdef SOUND_SYSTEM_FLOAT
+static int pulsedrv_write_float(float *pbuf, size_t nr)
+{
+    return pulsedrv_write_bytes(pbuf, nr);
+}
+#else
+static int pulsedrv_write(int16_t *pbuf, size_t nr)
+{
+    return pulsedrv_write_bytes(pbuf, nr);
+}
+#endif
+
 static int pulsedrv_suspend(void)
 {
     int error = 0;
@@ -118,7 +139,11 @@ static const sound_device_t pulsedrv_device =
 {
     "pulse",
     pulsedrv_init,
+#ifdef SOUND_SYSTEM_FLOAT
+    NULL,
+#else
     pulsedrv_write,
+#endif
     NULL,
     NULL,
     NULL,
@@ -127,7 +152,12 @@ static const sound_device_t pulsedrv_device =
     NULL,
     1,
     2,
-    true
+    true,
+#ifdef SOUND_SYSTEM_FLOAT
+    pulsedrv_write_float
+#else
+    NULL
+#endif
 };
 
 int sound_init_pulse_device(void)
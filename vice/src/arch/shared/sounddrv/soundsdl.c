@@ -41,7 +41,18 @@
 #include "log.h"
 #include "sound.h"
 
-static int16_t *sdl_buf = NULL;
+/* the float based sound system plays float samples, SDL 1.2 has no float
+   format and gets them converted to 16 bit */
+#if defined(SOUND_SYSTEM_FLOAT) && defined(USE_SDL2UI)
+#define SDL_SOUND_FLOAT
+#define SDL_SAMPLE_FORMAT AUDIO_F32SYS
+typedef float sdl_sample_t;
+#else
+#define SDL_SAMPLE_FORMAT AUDIO_S16SYS
+typedef int16_t sdl_sample_t;
+#endif
+
+static sdl_sample_t *sdl_buf = NULL;
 static SDL_AudioSpec sdl_spec;
 static volatile int sdl_inptr = 0;
 static volatile int sdl_outptr = 0;
@@ -53,24 +64,24 @@ static void sdl_callback(void *userdata, Uint8 *stream, int len)
     int amount, total;
     total = 0;
 
-    while (total < (len / (int)sizeof(int16_t))) {
+    while (total < (len / (int)sizeof(sdl_sample_t))) {
         amount = sdl_inptr - sdl_outptr;
         if (amount <= 0) {
             amount = sdl_len - sdl_outptr;
         }
 
-        if (amount + total > (len / (int)sizeof(int16_t))) {
-            amount = len / (int)sizeof(int16_t) - total;
+        if (amount + total > (len / (int)sizeof(sdl_sample_t))) {
+            amount = len / (int)sizeof(sdl_sample_t) - total;
         }
 
         sdl_full = 0;
 
         if (!amount) {
-            memset(stream + total * (int)sizeof(int16_t), 0, (size_t)(len - total) * sizeof(int16_t));
+            memset(stream + total * (int)sizeof(sdl_sample_t), 0, (size_t)(len - total) * sizeof(sdl_sample_t));
             return;
         }
 
-        memcpy(stream + total * (int)sizeof(int16_t), sdl_buf + sdl_outptr, (size_t)amount * sizeof(int16_t));
+        memcpy(stream + total * (int)sizeof(sdl_sample_t), sdl_buf + sdl_outptr, (size_t)amount * sizeof(sdl_sample_t));
         total += amount;
         sdl_outptr += amount;
 
@@ -97,7 +108,7 @@ static int sdl_init(const char *param, int *speed,
 
     memset(&spec, 0, sizeof(spec));
     spec.freq = *speed;
-    spec.format = AUDIO_S16SYS;
+    spec.format = SDL_SAMPLE_FORMAT;
     spec.channels = (Uint8)*channels;
 #ifdef USE_SDL2UI
     spec.samples = (Uint16)(*fragsize * 2);
@@ -135,7 +146,11 @@ static int sdl_init(const char *param, int *speed,
             SDL_GetCurrentAudioDriver());
 #endif
 
+#ifdef SDL_SOUND_FLOAT
+    if (sdl_spec.format != AUDIO_F32SYS
+#else
     if ((sdl_spec.format != AUDIO_S16 && sdl_spec.format != AUDIO_S16MSB)
+#endif
             || sdl_spec.channels != *channels) {
         SDL_CloseAudio();
         log_message(LOG_DEFAULT, "SDLAudio: got invalid audio spec.");
@@ -151,7 +166,7 @@ static int sdl_init(const char *param, int *speed,
 
     sdl_len = sdl_spec.samples * nr;
     sdl_inptr = sdl_outptr = sdl_full = 0;
-    sdl_buf = lib_calloc((size_t)sdl_len, sizeof(int16_t));
+    sdl_buf = lib_calloc((size_t)sdl_len, sizeof(sdl_sample_t));
 
     if (!sdl_buf) {
         SDL_CloseAudio();
@@ -185,18 +200,11 @@ void swab(void *src, void *dst, size_t length)
 }
 #endif
 
-static int sdl_write(int16_t *pbuf, size_t nr)
+static int sdl_write_samples(sdl_sample_t *pbuf, size_t nr)
 {
     int total, amount;
     total = 0;
 
-#ifdef WORDS_BIGENDIAN
-    if (sdl_spec.format != AUDIO_S16MSB) {
-        /* Swap bytes if we're on a big-endian machine, like the Macintosh */
-        swab(pbuf, pbuf, sizeof(int16_t) * nr);
-    }
-#endif
-
     while (total < (int)nr) {
         amount = sdl_outptr - sdl_inptr;
 
@@ -213,7 +221,7 @@ static int sdl_write(int16_t *pbuf, size_t nr)
             continue;
         }
 
-        memcpy(sdl_buf + sdl_inptr, pbuf + total, (size_t)amount * sizeof(int16_t));
+        memcpy(sdl_buf + sdl_inptr, pbuf + total, (size_t)amount * sizeof(sdl_sample_t));
         sdl_inptr += amount;
         total += amount;
 
@@ -229,6 +237,25 @@ static int sdl_write(int16_t *pbuf, size_t nr)
     return 0;
 }
 
+#ifdef SDL_SOUND_FLOAT
+static int sdl_write_float(float *pbuf, size_t nr)
+{
+    return sdl_write_samples(pbuf, nr);
+}
+#else
+static int sdl_write(int16_t *pbuf, size_t nr)
+{
+#ifdef WORDS_BIGENDIAN
+    if (sdl_spec.format != AUDIO_S16MSB) {
+        /* Swap bytes if we're on a big-endian machine, like the Macintosh */
+        swab(pbuf, pbuf, sizeof(int16_t) * nr);
+    }
+#endif
+
+    return sdl_write_samples(pbuf, nr);
+}
+#endif
+
 static int sdl_bufferspace(void)
 {
     int amount;
@@ -271,7 +298,11 @@ static const sound_device_t sdl_device =
 {
     "sdl",
     sdl_init,
+#ifdef SDL_SOUND_FLOAT
+    NULL,
+#else
     sdl_write,
+#endif
     NULL,
     NULL,
     sdl_bufferspace,
@@ -280,7 +311,12 @@ static const sound_device_t sdl_device =
     sdl_resume,
     1,
     2,
-    true
+    true,
+#ifdef SDL_SOUND_FLOAT
+    sdl_write_float
+#else
+    NULL
+#endif
 };
 
 int sound_init_sdl_device(void)
@@ -236,6 +236,8 @@ enum {
     ACTION_HELP_MANUAL,
     ACTION_HISTORY_MILESTONE_RESET,
     ACTION_HISTORY_MILESTONE_SET,
+    ACTION_HISTORY_PLAYBACK_SEEK_BACK,
+    ACTION_HISTORY_PLAYBACK_SEEK_FORWARD,
     ACTION_HISTORY_PLAYBACK_START,
     ACTION_HISTORY_PLAYBACK_STOP,
     ACTION_HISTORY_RECORD_START,
@@ -286,6 +288,7 @@ enum {
     ACTION_SNAPSHOT_LOAD,
     ACTION_SNAPSHOT_QUICKLOAD,
     ACTION_SNAPSHOT_QUICKSAVE,
+    ACTION_SNAPSHOT_REWIND,
     ACTION_SNAPSHOT_SAVE,
     ACTION_SPEED_CPU_10,
     ACTION_SPEED_CPU_25,
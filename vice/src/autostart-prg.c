@@ -40,6 +40,7 @@
 #include "machine.h"
 #include "mem.h"
 #include "resources.h"
+#include "snapshot.h"
 #include "util.h"
 #include "uiapi.h"
 #include "diskimage.h"
@@ -61,6 +62,14 @@ extern log_t autostart_log;
 /* program from last injection */
 static autostart_prg_t *inject_prg;
 
+/* snapshot of the machine at the "READY." prompt after a reset, and the
+   configuration it was taken with */
+static snapshot_t *ready_snapshot = NULL;
+static uint32_t ready_config;
+
+/* configuration of the current autostart */
+static uint32_t current_config;
+
 
 static autostart_prg_t * load_prg(const char *file_name, fileio_info_t *finfo, log_t log)
 {
@@ -134,6 +143,10 @@ void autostart_prg_shutdown(void)
     if (inject_prg != NULL) {
         free_prg(inject_prg);
     }
+    if (ready_snapshot != NULL) {
+        snapshot_close(ready_snapshot);
+        ready_snapshot = NULL;
+    }
 }
 
 int autostart_prg_with_virtual_fs(int unit, int drive, const char *file_name,
@@ -197,6 +210,28 @@ int autostart_prg_with_ram_injection(const char *file_name,
     return (inject_prg == NULL) ? -1 : 0;
 }
 
+/* Load the program for an injection into the READY snapshot.  Returns 1 if
+   the snapshot for the current configuration is cached, 0 if it has to be
+   taken after a reset first, and -1 on error.  */
+int autostart_prg_with_ready_snapshot(const char *file_name,
+                                      fileio_info_t *fh,
+                                      log_t log)
+{
+    if (autostart_prg_with_ram_injection(file_name, fh, log) < 0) {
+        return -1;
+    }
+
+    current_config = resources_get_event_safe_hash();
+
+    if (ready_snapshot != NULL && ready_config != current_config) {
+        log_message(log, "Configuration changed, dropping the READY snapshot.");
+        snapshot_close(ready_snapshot);
+        ready_snapshot = NULL;
+    }
+
+    return (ready_snapshot != NULL) ? 1 : 0;
+}
+
 int autostart_prg_with_disk_image(int unit, int drive, const char *file_name,
                                   fileio_info_t *fh,
                                   log_t log,
@@ -389,3 +424,43 @@ int autostart_prg_perform_injection(log_t log)
 
     return 0;
 }
+
+/* Take the READY snapshot for the configuration of the current autostart.  */
+int autostart_prg_save_ready_snapshot(log_t log)
+{
+    if (ready_snapshot != NULL) {
+        snapshot_close(ready_snapshot);
+    }
+
+    ready_snapshot = machine_write_snapshot_mem(0, 0, 0);
+    if (ready_snapshot == NULL) {
+        log_error(log, "Cannot take the READY snapshot.");
+        return -1;
+    }
+    ready_config = current_config;
+
+    log_message(log, "READY snapshot taken.");
+    return 0;
+}
+
+int autostart_prg_restore_ready_snapshot(log_t log)
+{
+    const uint8_t *data;
+    size_t size;
+
+    if (ready_snapshot == NULL) {
+        log_error(log, "No READY snapshot to restore.");
+        return -1;
+    }
+
+    data = snapshot_mem_get_data(ready_snapshot, &size);
+    if (machine_read_snapshot_mem(data, size, 0) < 0) {
+        log_error(log, "Cannot restore the READY snapshot.");
+        snapshot_close(ready_snapshot);
+        ready_snapshot = NULL;
+        return -1;
+    }
+
+    log_message(log, "READY snapshot restored.");
+    return 0;
+}
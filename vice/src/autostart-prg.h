@@ -41,7 +41,8 @@ typedef struct autostart_prg_s autostart_prg_t;
 #define AUTOSTART_PRG_MODE_VFS      0
 #define AUTOSTART_PRG_MODE_INJECT   1
 #define AUTOSTART_PRG_MODE_DISK     2
-#define AUTOSTART_PRG_MODE_LAST     2
+#define AUTOSTART_PRG_MODE_READY    3
+#define AUTOSTART_PRG_MODE_LAST     3
 #define AUTOSTART_PRG_MODE_DEFAULT  AUTOSTART_PRG_MODE_DISK
 
 void autostart_prg_init(void);
@@ -52,6 +53,11 @@ int autostart_prg_with_ram_injection(const char *file_name, fileio_info_t *fh, l
 int autostart_prg_with_disk_image(int unit, int drive, const char *file_name, fileio_info_t *fh, log_t log,
                                   const char *image_name);
 
+int autostart_prg_with_ready_snapshot(const char *file_name, fileio_info_t *fh, log_t log);
+
 int autostart_prg_perform_injection(log_t log);
 
+int autostart_prg_save_ready_snapshot(log_t log);
+int autostart_prg_restore_ready_snapshot(log_t log);
+
 #endif
@@ -82,6 +82,7 @@
 #include "vdrive-bam.h"
 #include "vice-event.h"
 #include "vsync.h"
+#include "zfile.h"
 
 #ifdef DEBUG_AUTOSTART
 #define DBG(_x_)        log_debug _x_
@@ -112,6 +113,9 @@ static enum {
     AUTOSTART_WAITLOADING,
     AUTOSTART_WAITSEARCHINGFOR,
     AUTOSTART_INJECT,
+    AUTOSTART_SAVEREADY,
+    AUTOSTART_RESTOREREADY,
+    AUTOSTART_INJECTREADY,
     AUTOSTART_DONE
 } autostartmode = AUTOSTART_NONE;
 
@@ -532,7 +536,7 @@ static const cmdline_option_t cmdline_options[] =
       NULL, "Disable warp mode during autostart" },
     { "-autostartprgmode", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "AutostartPrgMode", NULL,
-      "<Mode>", "Set autostart mode for PRG files (0: VirtualFS, 1: Inject, 2: Disk image)" },
+      "<Mode>", "Set autostart mode for PRG files (0: VirtualFS, 1: Inject, 2: Disk image, 3: Inject at cached READY)" },
     { "-autostartprgdiskimage", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "AutostartPrgDiskImage", NULL,
       "<Name>", "Set disk image for autostart of PRG files" },
@@ -1429,6 +1433,60 @@ static void advance_inject(void)
     }
 }
 
+/* The program is injected at the "READY." prompt and started right away.  */
+static void inject_ready(void)
+{
+    if (autostart_prg_perform_injection(autostart_log) < 0) {
+        autostart_disable();
+    } else {
+        autostart_finish();
+        autostart_done(); /* -> AUTOSTART_DONE */
+    }
+}
+
+static void save_ready_trap(uint16_t unused_addr, void *unused_data)
+{
+    autostart_prg_save_ready_snapshot(autostart_log);
+    inject_ready();
+}
+
+static void restore_ready_trap(uint16_t unused_addr, void *unused_data)
+{
+    if (autostart_prg_restore_ready_snapshot(autostart_log) < 0) {
+        autostart_disable();
+    } else {
+        inject_ready();
+    }
+}
+
+/* After the first reset in this configuration, the "READY." prompt is saved
+   in a snapshot before the PRG file is injected */
+static void advance_saveready(void)
+{
+    switch (check("READY.", AUTOSTART_WAIT_BLINK)) {
+        case YES:
+            log_message(autostart_log, "Ready");
+            disable_warp_if_was_requested();
+            autostartmode = AUTOSTART_INJECTREADY;
+            interrupt_maincpu_trigger_trap(save_ready_trap, NULL);
+            break;
+        case NO:
+            disable_warp_if_was_requested();
+            autostart_disable();
+            break;
+        case NOT_YET:
+            check_rom_area();
+            break;
+    }
+}
+
+/* Instead of a reset, the saved "READY." prompt is restored */
+static void advance_restoreready(void)
+{
+    autostartmode = AUTOSTART_INJECTREADY;
+    interrupt_maincpu_trigger_trap(restore_ready_trap, NULL);
+}
+
 /* Execute the actions for the current `autostartmode', advancing to the next
    mode if necessary.  */
 void autostart_advance(void)
@@ -1479,6 +1537,12 @@ void autostart_advance(void)
         case AUTOSTART_INJECT: /* to AUTOSTART_WAITLOADREADY */
             advance_inject();
             break;
+        case AUTOSTART_SAVEREADY: /* wait for "READY.", to AUTOSTART_INJECTREADY */
+            advance_saveready();
+            break;
+        case AUTOSTART_RESTOREREADY: /* to AUTOSTART_INJECTREADY */
+            advance_restoreready();
+            break;
 
         case AUTOSTART_ERROR:
             log_message(autostart_log, "Error");
@@ -1552,6 +1616,23 @@ static void reboot_for_autostart(const char *program_name, unsigned int mode,
     }
 }
 
+/* Restore the cached "READY." prompt for autostart, instead of a reboot.  */
+static void restore_for_autostart(unsigned int runmode)
+{
+    if (!autostart_enabled) {
+        return;
+    }
+
+    log_message(autostart_log, "Restoring the READY snapshot to autostart '*'");
+
+    deallocate_program_name();
+
+    autostartmode = AUTOSTART_RESTOREREADY;
+    autostart_run_mode = runmode;
+    autostart_wait_for_reset = 0;
+    autostart_initial_delay_cycles = 0;
+}
+
 /* ------------------------------------------------------------------------- */
 
 /* Autostart snapshot file `file_name'.  */
@@ -1964,17 +2045,31 @@ int autostart_prg(const char *file_name, unsigned int runmode)
             boot_file_name = NULL;
             autostart_type = AUTOSTART_PRG_INJECT;
             break;
+        case AUTOSTART_PRG_MODE_READY:
+            log_message(autostart_log, "Loading PRG file `%s' with RAM injection at the READY prompt.", file_name);
+            result = autostart_prg_with_ready_snapshot(file_name, finfo, autostart_log);
+            mode = (result > 0) ? AUTOSTART_RESTOREREADY : AUTOSTART_SAVEREADY;
+            boot_file_name = NULL;
+            autostart_type = AUTOSTART_PRG_INJECT;
+            break;
         case AUTOSTART_PRG_MODE_DISK:
             {
             char *savedir; int n;
             log_message(autostart_log, "Loading PRG file `%s' with autostart disk image.", file_name);
             setup_for_disk(unit, drive);
-            /* create the directory where the image should be written first */
-            util_fname_split(AutostartPrgDiskImage, &savedir, NULL);
-            if ((savedir != NULL) && (*savedir != 0) && (strcmp(savedir, "."))) {
-                archdep_mkdir(savedir, ARCHDEP_MKDIR_RWXU);
+            /* build the image in memory if possible, else create the
+               directory where the image should be written first.  A
+               recorded history includes the image file, so it stays on disk
+               then.  */
+            if (event_record_active()
+                || zfile_memory_file_create(AutostartPrgDiskImage) < 0) {
+                zfile_memory_file_remove(AutostartPrgDiskImage);
+                util_fname_split(AutostartPrgDiskImage, &savedir, NULL);
+                if ((savedir != NULL) && (*savedir != 0) && (strcmp(savedir, "."))) {
+                    archdep_mkdir(savedir, ARCHDEP_MKDIR_RWXU);
+                }
+                lib_free(savedir);
             }
-            lib_free(savedir);
             result = autostart_prg_with_disk_image(unit, drive, file_name, finfo,
                                                    autostart_log, AutostartPrgDiskImage);
             mode = AUTOSTART_HASDISK;
@@ -2016,7 +2111,9 @@ int autostart_prg(const char *file_name, unsigned int runmode)
     }
 
     /* Now either proceed with disk image booting or prg injection after reset */
-    if (result >= 0) {
+    if (mode == AUTOSTART_RESTOREREADY) {
+        restore_for_autostart(runmode);
+    } else if (result >= 0) {
         reboot_for_autostart(boot_file_name, mode, runmode);
     }
 
@@ -0,0 +1,193 @@
+/*
+ * autowarp.c - Warp automatically while the machine is loading.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With `AutoWarp' set, warp mode is switched on while the machine loads:
+   while the datasette plays, while the motor of a drive is on and the CPU
+   runs a loader, or while the screen stays the same and the CPU runs a
+   loader without a drive motor (serial devices without true drive
+   emulation).  A loader is recognized by the CPU reading the serial bus
+   port over and over, as the KERNAL routines and the fast loaders do.
+
+   Disk loading stops warping as soon as the screen changes, and warps again
+   once it was still for a few frames.  Input from the user, or the user
+   switching warp off, stops warping until the loading is over.  Warp that
+   was not switched on here is never switched off here.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#include "autowarp.h"
+#include "cmdline.h"
+#include "log.h"
+#include "network.h"
+#include "resources.h"
+#include "types.h"
+#include "vsync.h"
+
+/* reads of the serial bus port in a frame that make a loader */
+#define AUTOWARP_IEC_POLLS          200
+
+/* changed lines of a shown frame that make a screen change */
+#define AUTOWARP_CHANGED_LINES      8
+
+/* shown frames without change before a drive loads with warp, and before
+   the screen counts as still without a drive motor */
+#define AUTOWARP_DISK_STILL_FRAMES  5
+#define AUTOWARP_STILL_FRAMES       25
+
+static int autowarp_enabled;
+
+static int (*tape_playing)(void) = NULL;
+static int (*disk_motor_on)(void) = NULL;
+
+/* warp was switched on here */
+static int warp_engaged = 0;
+
+/* no warp until the loading is over */
+static int held_off = 0;
+
+static unsigned int iec_polls = 0;
+static unsigned int still_frames = 0;
+static int user_input = 0;
+
+static void autowarp_set_warp(int on)
+{
+    log_message(LOG_DEFAULT, "AutoWarp: turning warp mode %s.", on ? "on" : "off");
+    vsync_set_warp_mode(on);
+    warp_engaged = on;
+}
+
+static int set_autowarp_enabled(int val, void *param)
+{
+    autowarp_enabled = val ? 1 : 0;
+
+    if (!autowarp_enabled && warp_engaged) {
+        autowarp_set_warp(0);
+    }
+    held_off = 0;
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "AutoWarp", 0, RES_EVENT_NO, NULL,
+      &autowarp_enabled, set_autowarp_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int autowarp_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-autowarp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "AutoWarp", (resource_value_t)1,
+      NULL, "Enable warp mode while loading from disk or tape" },
+    { "+autowarp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "AutoWarp", (resource_value_t)0,
+      NULL, "Do not enable warp mode while loading (default)" },
+    CMDLINE_LIST_END
+};
+
+int autowarp_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void autowarp_set_tape_detector(int (*playing)(void))
+{
+    tape_playing = playing;
+}
+
+void autowarp_set_disk_detector(int (*motor_on)(void))
+{
+    disk_motor_on = motor_on;
+}
+
+void autowarp_iec_poll(void)
+{
+    iec_polls++;
+}
+
+void autowarp_user_input(void)
+{
+    user_input = 1;
+}
+
+void autowarp_screen_update(unsigned int changed_lines)
+{
+    if (changed_lines >= AUTOWARP_CHANGED_LINES) {
+        still_frames = 0;
+    } else if (still_frames < AUTOWARP_STILL_FRAMES) {
+        still_frames++;
+    }
+}
+
+int autowarp_screen_wanted(void)
+{
+    return autowarp_enabled;
+}
+
+void autowarp_vsync_hook(void)
+{
+    int loader, tape, disk, still;
+
+    loader = iec_polls >= AUTOWARP_IEC_POLLS;
+    iec_polls = 0;
+
+    if (!autowarp_enabled || network_connected()) {
+        user_input = 0;
+        return;
+    }
+
+    tape = tape_playing != NULL && tape_playing();
+    disk = loader && disk_motor_on != NULL && disk_motor_on()
+           && still_frames >= AUTOWARP_DISK_STILL_FRAMES;
+    still = loader && still_frames >= AUTOWARP_STILL_FRAMES;
+
+    /* warp switched off by the user */
+    if (warp_engaged && !vsync_get_warp_mode()) {
+        warp_engaged = 0;
+        held_off = 1;
+    }
+
+    if (!tape && !loader) {
+        held_off = 0;
+    } else if (user_input) {
+        held_off = 1;
+    }
+    user_input = 0;
+
+    if ((tape || disk || still) && !held_off) {
+        if (!vsync_get_warp_mode()) {
+            autowarp_set_warp(1);
+        }
+    } else if (warp_engaged) {
+        autowarp_set_warp(0);
+    }
+}
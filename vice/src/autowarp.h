@@ -0,0 +1,52 @@
+/*
+ * autowarp.h - Warp automatically while the machine is loading.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_AUTOWARP_H
+#define VICE_AUTOWARP_H
+
+int autowarp_resources_init(void);
+int autowarp_cmdline_options_init(void);
+
+/* Detectors of the devices that load, set by their emulation: whether the
+   datasette plays, and whether the motor of a drive is on.  */
+void autowarp_set_tape_detector(int (*playing)(void));
+void autowarp_set_disk_detector(int (*motor_on)(void));
+
+/* The emulated CPU read the port of the serial bus.  */
+void autowarp_iec_poll(void);
+
+/* The user pressed a key or moved a joystick.  */
+void autowarp_user_input(void);
+
+/* A frame was shown, with `changed_lines' lines that differ from the frame
+   shown before.  */
+void autowarp_screen_update(unsigned int changed_lines);
+
+/* Whether autowarp is enabled and needs autowarp_screen_update(); the
+   headless UI does not look for changed lines otherwise.  */
+int autowarp_screen_wanted(void);
+
+/* Called once per emulated frame from vsync_do_vsync().  */
+void autowarp_vsync_hook(void);
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ * batch.c - Run a list of test programs in one emulator session.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The job file has one job per line:
+
+       <image> [<cycle limit> [<screenshot>]]
+
+   Fields are separated by whitespace and may be enclosed in double quotes;
+   empty lines and lines starting with `#' are ignored.  A cycle limit of 0
+   (or none) uses the value of -limitcycles.
+
+   After the first machine reset the state of the machine is kept as an
+   in-memory snapshot.  Each job restores that state with all media
+   detached, autostarts its image and runs until something asks the
+   emulator to exit (debug cartridge, cycle limit, JAM action "quit").
+   Signals and fatal errors still terminate the emulator.  The exit code
+   and the cycles used are printed to stdout and the emulator exits after
+   the last job, with a failure code if any job failed.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "attach.h"
+#include "autostart.h"
+#include "batch.h"
+#include "cartridge.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine-video.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "screenshot.h"
+#include "snapshot.h"
+#include "tape.h"
+#include "types.h"
+#include "util.h"
+
+#define BATCH_LINE_MAX  1024
+
+typedef struct batch_job_s {
+    char *image;
+    CLOCK cycles;
+    char *screenshot;
+} batch_job_t;
+
+static batch_job_t *jobs = NULL;
+static int num_jobs = 0;
+static int current_job = -1;
+static int num_failed = 0;
+
+/* Set while the job list is processed.  */
+static int batch_active = 0;
+
+/* Set while a job runs, cleared as soon as it asked to exit.  */
+static int job_running = 0;
+
+static CLOCK job_start_clk;
+static CLOCK default_cycles;
+
+/* Machine state after the first reset.  */
+static uint8_t *initial_state = NULL;
+static size_t initial_state_size = 0;
+
+static log_t batch_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+static void batch_free_jobs(void)
+{
+    int i;
+
+    for (i = 0; i < num_jobs; i++) {
+        lib_free(jobs[i].image);
+        lib_free(jobs[i].screenshot);
+    }
+    lib_free(jobs);
+    jobs = NULL;
+    num_jobs = 0;
+}
+
+/* Return a copy of the next field of `*p', or NULL at the end of the line.  */
+static char *batch_next_field(const char **p)
+{
+    const char *s = util_skip_whitespace(*p);
+    const char *start;
+    char *field;
+
+    if (*s == 0 || *s == '\n' || *s == '\r') {
+        *p = s;
+        return NULL;
+    }
+
+    if (*s == '"') {
+        start = ++s;
+        while (*s != 0 && *s != '"') {
+            s++;
+        }
+        field = lib_strdup(start);
+        field[s - start] = 0;
+        if (*s == '"') {
+            s++;
+        }
+    } else {
+        start = s;
+        while (*s != 0 && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r') {
+            s++;
+        }
+        field = lib_strdup(start);
+        field[s - start] = 0;
+    }
+
+    *p = s;
+    return field;
+}
+
+static int batch_load_jobs(const char *filename)
+{
+    FILE *fd;
+    char line[BATCH_LINE_MAX];
+    int lineno = 0;
+
+    fd = fopen(filename, MODE_READ_TEXT);
+    if (fd == NULL) {
+        log_error(batch_log, "Cannot open batch job file `%s'.", filename);
+        return -1;
+    }
+
+    batch_free_jobs();
+
+    while (fgets(line, sizeof(line), fd) != NULL) {
+        const char *p = util_skip_whitespace(line);
+        char *image, *field;
+        batch_job_t *job;
+
+        lineno++;
+
+        if (*p == '#') {
+            continue;
+        }
+        image = batch_next_field(&p);
+        if (image == NULL) {
+            continue;
+        }
+
+        jobs = lib_realloc(jobs, (num_jobs + 1) * sizeof(batch_job_t));
+        job = &jobs[num_jobs++];
+        job->image = image;
+        job->cycles = 0;
+        job->screenshot = NULL;
+
+        field = batch_next_field(&p);
+        if (field != NULL) {
+            job->cycles = (CLOCK)strtoull(field, NULL, 0);
+            lib_free(field);
+            job->screenshot = batch_next_field(&p);
+        }
+
+        field = batch_next_field(&p);
+        if (field != NULL) {
+            log_warning(batch_log, "%s:%d: ignoring extra field `%s'.", filename, lineno, field);
+            lib_free(field);
+        }
+    }
+
+    fclose(fd);
+
+    if (num_jobs == 0) {
+        log_error(batch_log, "No jobs in batch job file `%s'.", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void batch_next_trap(uint16_t addr, void *data);
+
+static void batch_finish_job(int exit_code)
+{
+    batch_job_t *job = &jobs[current_job];
+    CLOCK cycles = maincpu_clk - job_start_clk;
+
+    job_running = 0;
+    maincpu_clk_limit = 0;
+
+    if (job->screenshot != NULL) {
+        struct video_canvas_s *canvas;
+
+        /* the first canvas of x128 is the VDC, use the VIC-II one */
+        if (machine_class == VICE_MACHINE_C128) {
+            canvas = machine_video_canvas_get(1);
+        } else {
+            canvas = machine_video_canvas_get(0);
+        }
+        if (screenshot_save("PNG", job->screenshot, canvas) < 0) {
+            log_error(batch_log, "Cannot save screenshot `%s'.", job->screenshot);
+        }
+    }
+
+    fprintf(stdout, "BATCH: job %d \"%s\" exit(%d) cycles elapsed: %"PRIu64"\n",
+            current_job + 1, job->image, exit_code, (uint64_t)cycles);
+    fflush(stdout);
+
+    if (exit_code != 0) {
+        num_failed++;
+    }
+
+    interrupt_maincpu_trigger_trap(batch_next_trap, NULL);
+}
+
+static void batch_run_trap(uint16_t addr, void *data)
+{
+    batch_job_t *job = &jobs[current_job];
+    CLOCK cycles = job->cycles ? job->cycles : default_cycles;
+
+    log_message(batch_log, "Job %d/%d: %s", current_job + 1, num_jobs, job->image);
+
+    job_start_clk = maincpu_clk;
+    maincpu_clk_limit = cycles ? maincpu_clk + cycles : 0;
+    job_running = 1;
+
+    if (autostart_autodetect(job->image, NULL, 0, AUTOSTART_MODE_RUN) < 0) {
+        log_error(batch_log, "Cannot autostart `%s'.", job->image);
+        batch_finish_job(EXIT_FAILURE);
+    }
+}
+
+static void batch_next_trap(uint16_t addr, void *data)
+{
+    if (++current_job >= num_jobs) {
+        log_message(batch_log, "%d of %d jobs failed.", num_failed, num_jobs);
+        batch_active = 0;
+        archdep_vice_exit(num_failed ? EXIT_FAILURE : EXIT_SUCCESS);
+        return;
+    }
+
+    if (current_job > 0) {
+        /* Detaching may trigger a reset, which is executed right after this
+           trap; the job itself is started by the next one.  */
+        autostart_reset();
+        cartridge_detach_image(-1);
+        file_system_detach_disk_all();
+        tape_image_detach_all();
+
+        if (machine_read_snapshot_mem(initial_state, initial_state_size, 0) < 0) {
+            log_error(batch_log, "Cannot restore the initial machine state.");
+            batch_active = 0;
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+    }
+
+    interrupt_maincpu_trigger_trap(batch_run_trap, NULL);
+}
+
+static void batch_start_trap(uint16_t addr, void *data)
+{
+    snapshot_t *s;
+    const uint8_t *state;
+
+    s = machine_write_snapshot_mem(0, 0, 0);
+    if (s == NULL) {
+        log_error(batch_log, "Cannot record the initial machine state.");
+        batch_active = 0;
+        archdep_vice_exit(EXIT_FAILURE);
+        return;
+    }
+
+    state = snapshot_mem_get_data(s, &initial_state_size);
+    initial_state = lib_malloc(initial_state_size);
+    memcpy(initial_state, state, initial_state_size);
+    snapshot_close(s);
+
+    current_job = -1;
+    batch_next_trap(addr, data);
+}
+
+void batch_start(void)
+{
+    if (num_jobs == 0 || batch_active) {
+        return;
+    }
+
+    batch_active = 1;
+    num_failed = 0;
+
+    /* -limitcycles now applies to every single job.  */
+    default_cycles = maincpu_clk_limit;
+    maincpu_clk_limit = 0;
+
+    interrupt_maincpu_trigger_trap(batch_start_trap, NULL);
+}
+
+void batch_vice_exit(int exit_code)
+{
+    if (!batch_active) {
+        archdep_vice_exit(exit_code);
+        return;
+    }
+
+    if (job_running) {
+        batch_finish_job(exit_code);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_batch(const char *param, void *extra_param)
+{
+    return batch_load_jobs(param);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-batch", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_batch, NULL, NULL, NULL,
+      "<filename>", "Run the jobs listed in <filename> one after another, then quit" },
+    CMDLINE_LIST_END
+};
+
+int batch_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void batch_shutdown(void)
+{
+    batch_free_jobs();
+    lib_free(initial_state);
+    initial_state = NULL;
+    initial_state_size = 0;
+}
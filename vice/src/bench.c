@@ -0,0 +1,182 @@
+/*
+ * bench.c - Measure the emulation speed over a fixed workload.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With -benchmark <cycles> the emulator runs in warp mode from the first
+   machine reset on.  After a warmup (-benchwarmup <cycles>, by default ten
+   seconds of emulated time, long enough to boot and to type in a program
+   with -keybuf) the next <cycles> cycles are timed, one line is printed to
+   stdout and the emulator exits:
+
+       BENCH: machine=C64 workload=basic cycles=20000000 seconds=4.210
+              cycles_per_second=4750593 speed=482.1
+
+   (on one line).  `workload' is the name given with -benchname, `speed' the
+   speed in percent of the real machine.  The workload itself is whatever
+   the command line sets up; build/bench/run-bench.sh (`make bench') runs a
+   fixed set of them on each emulator.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "archdep.h"
+#include "bench.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "types.h"
+#include "vsync.h"
+
+#define BENCH_WARMUP_SECONDS    10
+#define BENCH_NAME_MAX          32
+
+static CLOCK bench_cycles = 0;
+static CLOCK bench_warmup = 0;
+static char bench_name[BENCH_NAME_MAX] = "default";
+
+static CLOCK bench_start_clk;
+static tick_t bench_start_tick;
+static int bench_timing = 0;
+
+static alarm_t *bench_alarm = NULL;
+
+static log_t bench_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+static void bench_alarm_handler(CLOCK offset, void *data)
+{
+    CLOCK cycles;
+    double seconds;
+    double cycles_per_second;
+
+    alarm_unset(bench_alarm);
+
+    if (!bench_timing) {
+        /* warmup done, start timing */
+        log_message(bench_log, "Timing %"PRIu64" cycles of workload `%s'.",
+                    (uint64_t)bench_cycles, bench_name);
+        bench_timing = 1;
+        bench_start_clk = maincpu_clk;
+        bench_start_tick = tick_now();
+        alarm_set(bench_alarm, maincpu_clk + bench_cycles);
+        return;
+    }
+
+    cycles = maincpu_clk - bench_start_clk;
+    seconds = (double)tick_now_delta(bench_start_tick) / tick_per_second();
+    if (seconds <= 0.0) {
+        seconds = 1.0 / tick_per_second();
+    }
+    cycles_per_second = (double)cycles / seconds;
+
+    fprintf(stdout, "BENCH: machine=%s workload=%s cycles=%"PRIu64" seconds=%.3f"
+            " cycles_per_second=%.0f speed=%.1f\n",
+            machine_name, bench_name, (uint64_t)cycles, seconds, cycles_per_second,
+            cycles_per_second * 100.0 / (double)machine_get_cycles_per_second());
+    fflush(stdout);
+
+    archdep_vice_exit(EXIT_SUCCESS);
+}
+
+static void bench_start_trap(uint16_t addr, void *data)
+{
+    CLOCK warmup = bench_warmup;
+
+    if (warmup == 0) {
+        warmup = (CLOCK)machine_get_cycles_per_second() * BENCH_WARMUP_SECONDS;
+    }
+
+    vsync_set_warp_mode(1);
+
+    bench_alarm = alarm_new(maincpu_alarm_context, "Bench", bench_alarm_handler, NULL);
+    alarm_set(bench_alarm, maincpu_clk + warmup);
+}
+
+void bench_start(void)
+{
+    if (bench_cycles == 0 || bench_alarm != NULL) {
+        return;
+    }
+
+    interrupt_maincpu_trigger_trap(bench_start_trap, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_get_cycles(const char *param, CLOCK *cycles)
+{
+    char *end;
+    unsigned long long value = strtoull(param, &end, 0);
+
+    if (*end != 0 || value == 0 || value > CLOCK_MAX) {
+        return -1;
+    }
+    *cycles = (CLOCK)value;
+
+    return 0;
+}
+
+static int cmdline_benchmark(const char *param, void *extra_param)
+{
+    return cmdline_get_cycles(param, &bench_cycles);
+}
+
+static int cmdline_benchwarmup(const char *param, void *extra_param)
+{
+    return cmdline_get_cycles(param, &bench_warmup);
+}
+
+static int cmdline_benchname(const char *param, void *extra_param)
+{
+    if (*param == 0 || strlen(param) >= BENCH_NAME_MAX || strchr(param, ' ') != NULL) {
+        return -1;
+    }
+    strcpy(bench_name, param);
+
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-benchmark", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_benchmark, NULL, NULL, NULL,
+      "<cycles>", "Run in warp mode, time <cycles> cycles after the warmup, print the emulated speed, then quit" },
+    { "-benchwarmup", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_benchwarmup, NULL, NULL, NULL,
+      "<cycles>", "Cycles to run before -benchmark starts timing (default: 10 seconds of emulated time)" },
+    { "-benchname", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_benchname, NULL, NULL, NULL,
+      "<name>", "Name of the workload reported by -benchmark" },
+    CMDLINE_LIST_END
+};
+
+int bench_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
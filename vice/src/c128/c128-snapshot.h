@@ -30,4 +30,7 @@
 int c128_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode);
 int c128_snapshot_read(const char *name, int event_mode);
 
+struct snapshot_s *c128_snapshot_write_mem(int save_roms, int save_disks, int event_mode);
+int c128_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode);
+
 #endif
@@ -1117,6 +1117,10 @@ int machine_cmdline_options_init(void)
         init_cmdline_options_fail("mmu");
         return -1;
     }
+    if (z80_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("z80");
+        return -1;
+    }
     if (functionrom_cmdline_options_init() < 0) {
         init_cmdline_options_fail("functionrom");
         return -1;
@@ -1525,6 +1529,24 @@ int machine_read_snapshot(const char *name, int event_mode)
     return err;
 }
 
+snapshot_t *machine_write_snapshot_mem(int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s = c128_snapshot_write_mem(save_roms, save_disks, event_mode);
+    if ((s == NULL) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_WRITE_SNAPSHOT);
+    }
+    return s;
+}
+
+int machine_read_snapshot_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    int err = c128_snapshot_read_mem(data, size, event_mode);
+    if ((err < 0) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_READ_SNAPSHOT);
+    }
+    return err;
+}
+
 /* ------------------------------------------------------------------------- */
 
 int machine_autodetect_psid(const char *name)
@@ -950,6 +950,26 @@ uint8_t mem_dma_read(uint16_t addr)
     return retval;
 }
 
+/* DMA accesses through lo_*, ram_* and top_shared_* all go to the DMA bank,
+   without the shared RAM and MMU page translation.  */
+uint8_t *mem_dma_ram_page(uint16_t addr)
+{
+    unsigned int page = addr >> 8;
+    read_func_ptr_t read_func = _mem_read_tab_ptr[page];
+    store_func_ptr_t store_func = _mem_write_tab_ptr[page];
+
+    if (page == 0) {
+        return NULL;
+    }
+    if ((read_func == ram_read && store_func == ram_store
+         && cartridge_get_id(0) != CARTRIDGE_LT_KERNAL)
+        || (read_func == lo_read && store_func == lo_store)
+        || (read_func == top_shared_read && store_func == top_shared_store)) {
+        return dma_bank + (page << 8);
+    }
+    return NULL;
+}
+
 
 /* ------------------------------------------------------------------------- */
 
@@ -1346,6 +1366,41 @@ void top_shared_store(uint16_t addr, uint8_t value)
     }
 }
 
+/* The RAM that the given read and store functions access at `page', for
+   accessing it directly, or NULL if the functions may do anything else: the
+   page is moved by the MMU, is not RAM, or a cartridge may take the access.
+   Only valid until the next change of the MMU configuration.  */
+uint8_t *c128_mem_ram_page(read_func_ptr_t read_func, store_func_ptr_t store_func,
+                           unsigned int page)
+{
+    unsigned int addr = page << 8;
+
+    if (ram_bank == NULL || in_c64_mode == 1 || page < 2 || page > 0xff
+        || page == c128_mem_mmu_page_0 || page == c128_mem_mmu_page_1) {
+        return NULL;
+    }
+
+    if (read_func == ram_read && store_func == ram_store) {
+        if (cartridge_get_id(0) == CARTRIDGE_LT_KERNAL) {
+            return NULL;
+        }
+        return ram_bank + addr;
+    }
+    if (read_func == lo_read && store_func == lo_store) {
+        if (addr + 0xff < bottom_shared_limit) {
+            return mem_ram + addr;
+        }
+        return addr >= bottom_shared_limit ? ram_bank + addr : NULL;
+    }
+    if (read_func == top_shared_read && store_func == top_shared_store) {
+        if (addr > top_shared_limit) {
+            return mem_ram + addr;
+        }
+        return addr + 0xff <= top_shared_limit ? ram_bank + addr : NULL;
+    }
+    return NULL;
+}
+
 /* ------------------------------------------------------------------------- */
 
 void colorram_store(uint16_t addr, uint8_t value)
@@ -95,6 +95,8 @@ void hi_store(uint16_t addr, uint8_t value);
 
 uint8_t top_shared_read(uint16_t addr);
 void top_shared_store(uint16_t addr, uint8_t value);
+uint8_t *c128_mem_ram_page(read_func_ptr_t read_func, store_func_ptr_t store_func,
+                           unsigned int page);
 uint8_t top_shared_peek(uint16_t addr);
 
 uint8_t editor_read(uint16_t addr);
@@ -26,10 +26,14 @@
 
 #include "vice.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "6510core.h"
 #include "alarm.h"
+#include "archdep.h"
+#include "batch.h"
+#include "cmdline.h"
 #include "daa.h"
 #include "debug.h"
 #include "interrupt.h"
@@ -37,6 +41,8 @@
 #include "maincpu.h"
 #include "monitor.h"
 #include "types.h"
+#include "viciitypes.h"
+#include "vsync.h"
 #include "z80.h"
 #include "z80mem.h"
 #include "z80regs.h"
@@ -86,9 +92,34 @@ inline static int z80mem_read_limit(int addr)
         reg_wz = addr;                                  \
     } while (0)
 
-#define LOAD(addr) ((uint32_t)(*_z80mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr)))
+/* Plain RAM is accessed directly, everything else (I/O, ROM, pages moved by
+   the MMU) through the tables.  The VIC-II still sees the value on the bus.  */
+inline static uint32_t z80_load(uint16_t addr)
+{
+    uint8_t *p = _z80mem_ram_page_tab[addr >> 8];
 
-#define STORE(addr, value) (*_z80mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value))
+    if (p != NULL) {
+        vicii.last_cpu_val = p[addr & 0xff];
+        return vicii.last_cpu_val;
+    }
+    return (*_z80mem_read_tab_ptr[addr >> 8])(addr);
+}
+
+inline static void z80_store(uint16_t addr, uint8_t value)
+{
+    uint8_t *p = _z80mem_ram_page_tab[addr >> 8];
+
+    if (p != NULL) {
+        vicii.last_cpu_val = value;
+        p[addr & 0xff] = value;
+        return;
+    }
+    (*_z80mem_write_tab_ptr[addr >> 8])(addr, value);
+}
+
+#define LOAD(addr) z80_load((uint16_t)(addr))
+
+#define STORE(addr, value) z80_store((uint16_t)(addr), (uint8_t)(value))
 
 /* undefine IN and OUT first for platforms that have them already defined as something else */
 #undef IN
@@ -146,8 +177,138 @@ void z80_resync_limits(void)
     z80_bank_limit = z80mem_read_limit(z80_reg_pc);
 }
 
+/* ------------------------------------------------------------------------- */
+
+/* With -z80bench <cycles> the Z80 runs a fixed program at $3000 instead of
+   the boot code, in warp mode and with interrupts disabled, when it starts
+   after the first reset.  After <cycles> 1MHz cycles the time taken and the
+   emulated speed are printed to stdout and the emulator exits.  The program
+   only touches $3000-$3AFF and the stack below $3F00, and mixes plain, CB,
+   DD, ED and FD prefixed instructions with calls and loops.  */
+
+#define Z80BENCH_ADDR   0x3000
+
+static const uint8_t z80bench_code[] = {
+    /* $3000 */ 0xf3,                   /*        DI                */
+    /* $3001 */ 0x31, 0x00, 0x3f,       /*        LD SP,$3F00       */
+    /* $3004 */ 0x21, 0x00, 0x38,       /* loop:  LD HL,$3800       */
+    /* $3007 */ 0x06, 0x00,             /*        LD B,$00          */
+    /* $3009 */ 0x78,                   /* inner: LD A,B            */
+    /* $300a */ 0x77,                   /*        LD (HL),A         */
+    /* $300b */ 0x86,                   /*        ADD A,(HL)        */
+    /* $300c */ 0x23,                   /*        INC HL            */
+    /* $300d */ 0xdd, 0x21, 0x00, 0x39, /*        LD IX,$3900       */
+    /* $3011 */ 0xdd, 0x77, 0x05,       /*        LD (IX+5),A       */
+    /* $3014 */ 0xfd, 0x21, 0x00, 0x3a, /*        LD IY,$3A00       */
+    /* $3018 */ 0xfd, 0x86, 0x03,       /*        ADD A,(IY+3)      */
+    /* $301b */ 0xcb, 0x27,             /*        SLA A             */
+    /* $301d */ 0xcb, 0x47,             /*        BIT 0,A           */
+    /* $301f */ 0xed, 0x44,             /*        NEG               */
+    /* $3021 */ 0xcd, 0x40, 0x30,       /*        CALL sub          */
+    /* $3024 */ 0x10, 0xe3,             /*        DJNZ inner        */
+    /* $3026 */ 0xc3, 0x04, 0x30,       /*        JP loop           */
+    /* $3029 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* $3030 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* $3038 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    /* $3040 */ 0xc5,                   /* sub:   PUSH BC           */
+    /* $3041 */ 0xe5,                   /*        PUSH HL           */
+    /* $3042 */ 0x27,                   /*        DAA               */
+    /* $3043 */ 0xe1,                   /*        POP HL            */
+    /* $3044 */ 0xc1,                   /*        POP BC            */
+    /* $3045 */ 0xc9                    /*        RET               */
+};
+
+static CLOCK z80bench_cycles = 0;
+static CLOCK z80bench_start_clk;
+static tick_t z80bench_start_tick;
+
+static alarm_t *z80bench_alarm = NULL;
+
+static void z80bench_alarm_handler(CLOCK offset, void *data)
+{
+    CLOCK cycles = maincpu_clk - z80bench_start_clk;
+    double seconds = (double)tick_now_delta(z80bench_start_tick) / tick_per_second();
+
+    alarm_unset(z80bench_alarm);
+
+    if (seconds <= 0.0) {
+        seconds = 1.0 / tick_per_second();
+    }
+
+    fprintf(stdout, "Z80BENCH: %"PRIu64" cycles in %.3f s: %.2f MHz\n",
+            (uint64_t)cycles, seconds, (double)cycles / seconds / 1000000.0);
+    fflush(stdout);
+
+    archdep_vice_exit(EXIT_SUCCESS);
+}
+
+static void z80bench_start(alarm_context_t *cpu_alarm_context)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(z80bench_code); i++) {
+        STORE(Z80BENCH_ADDR + i, z80bench_code[i]);
+    }
+    for (i = 0; i < sizeof(z80bench_code); i++) {
+        if (LOAD(Z80BENCH_ADDR + i) != z80bench_code[i]) {
+            log_error(LOG_DEFAULT, "No Z80 RAM at $%04x, cannot run the benchmark.",
+                      Z80BENCH_ADDR + i);
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+    }
+
+    z80_reg_pc = Z80BENCH_ADDR;
+    z80_resync_limits();
+
+    log_message(LOG_DEFAULT, "Running Z80 benchmark for %"PRIu64" cycles.",
+                (uint64_t)z80bench_cycles);
+
+    vsync_set_warp_mode(1);
+
+    z80bench_alarm = alarm_new(cpu_alarm_context, "Z80Bench", z80bench_alarm_handler, NULL);
+    z80bench_start_clk = maincpu_clk;
+    z80bench_start_tick = tick_now();
+    alarm_set(z80bench_alarm, maincpu_clk + z80bench_cycles);
+}
+
+static int cmdline_z80bench(const char *param, void *extra_param)
+{
+    char *end;
+    unsigned long long cycles = strtoull(param, &end, 0);
+
+    if (*end != 0 || cycles == 0) {
+        return -1;
+    }
+    z80bench_cycles = (CLOCK)cycles;
+
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-z80bench", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_z80bench, NULL, NULL, NULL,
+      "<cycles>", "Run a fixed Z80 benchmark for <cycles> cycles, print the emulated speed, then quit" },
+    CMDLINE_LIST_END
+};
+
+int z80_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
 void z80_mainloop(interrupt_cpu_status_t *cpu_int_status, alarm_context_t *cpu_alarm_context)
 {
+    /* A cartridge may have been attached or removed since the last run.  */
+    z80mem_update_ram_pages();
+
+    if (z80bench_cycles != 0 && z80bench_alarm == NULL) {
+        z80bench_start(cpu_alarm_context);
+    }
+
     /* Ensure Z80 starts on a full 1MHz cycle */
     if (z80_half_cycle) {
         CLK++;
@@ -41,6 +41,7 @@ void z80_resync_limits(void);
 void z80_reset(void);
 void z80_mainloop(struct interrupt_cpu_status_s *cpu_int_status, struct alarm_context_s *cpu_alarm_context);
 void z80_trigger_dma(void);
+int z80_cmdline_options_init(void);
 
 #ifdef Z80_4MHZ
 void z80_clock_stretch(void);
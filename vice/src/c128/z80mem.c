@@ -63,6 +63,9 @@ store_func_ptr_t *_z80mem_write_tab_ptr;
 uint8_t **_z80mem_read_base_tab_ptr;
 int *z80mem_read_limit_tab_ptr;
 
+/* Plain RAM behind the pages of the current configuration */
+uint8_t *_z80mem_ram_page_tab[0x101];
+
 int z80mem_config;
 
 #define NUM_CONFIGS 16
@@ -1049,6 +1052,18 @@ void z80mem_initialize(void)
 
 static int c64mode_bit = 0;
 
+/* Find the pages where the Z80 can access the RAM directly.  Called on
+   every change of the configuration, which all MMU writes go through.  */
+void z80mem_update_ram_pages(void)
+{
+    int i;
+
+    for (i = 0; i < 0x100; i++) {
+        _z80mem_ram_page_tab[i] = c128_mem_ram_page(_z80mem_read_tab_ptr[i], _z80mem_write_tab_ptr[i], i);
+    }
+    _z80mem_ram_page_tab[0x100] = NULL;
+}
+
 void z80mem_update_config(int config)
 {
     z80mem_config = config;
@@ -1072,6 +1087,7 @@ void z80mem_update_config(int config)
         c64mode_bit = 0;
     }
 
+    z80mem_update_ram_pages();
     z80_resync_limits();
 }
 
@@ -51,6 +51,11 @@ extern store_func_ptr_t *_z80mem_write_tab_ptr;
 extern uint8_t **_z80mem_read_base_tab_ptr;
 extern int *z80mem_read_limit_tab_ptr;
 
+/* Pointers to the plain RAM of each page, for accesses without the read
+   and write tables; NULL where the tables must be used.  */
+extern uint8_t *_z80mem_ram_page_tab[0x101];
+void z80mem_update_ram_pages(void);
+
 uint8_t bios_read(uint16_t addr);
 void bios_store(uint16_t addr, uint8_t value);
 
@@ -34,6 +34,8 @@
 #include "cmdline.h"
 #include "crt.h"
 #include "drive.h"
+#include "driverom.h"
+#include "exitreport.h"
 #include "imagecontents.h"
 #include "kbd.h"
 #include "machine.h"
@@ -104,6 +106,10 @@ void main_exit(void)
 
 }
 
+void exitreport_set_exit_code(int exit_code)
+{
+}
+
 #ifdef USE_VICE_THREAD
 bool mainlock_is_vice_thread(void)
 {
@@ -258,6 +264,11 @@ int machine_bus_lib_read_sector(unsigned int unit, unsigned int track, unsigned
     return serial_iec_lib_read_sector(unit, track, sector, buf);
 }
 
+int machine_bus_lib_read_sectors(unsigned int unit, unsigned int track, unsigned int sector, unsigned int count, uint8_t *buf)
+{
+    return serial_iec_lib_read_sectors(unit, track, sector, count, buf);
+}
+
 int machine_bus_lib_write_sector(unsigned int unit, unsigned int track, unsigned int sector, uint8_t *buf)
 {
     return serial_iec_lib_write_sector(unit, track, sector, buf);
@@ -273,6 +284,10 @@ int machine_drive_rom_check_loaded(unsigned int type)
     return 0;
 }
 
+void driverom_load_pending(unsigned int type)
+{
+}
+
 void machine_drive_flush(void)
 {
 }
@@ -89,6 +89,7 @@
 #include "lib.h"
 #include "log.h"
 #include "serial.h"
+#include "sha1.h"
 #include "tape.h"
 #include "util.h"
 #include "vdrive-bam.h"
@@ -105,6 +106,8 @@
 #include "lib/linenoise-ng/linenoise.h"
 
 #ifdef UNIX_COMPILE
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
@@ -166,6 +169,12 @@ static int drive_index = 0;
  */
 static int interactive_mode = 0;
 
+/** \brief  Flag indicating if c1541 executes commands read by `batch`
+ *
+ * Images attached in batch mode are held in memory until they are detached.
+ */
+static int batch_mode = 0;
+
 
 /*
  * forward declaration of functions
@@ -187,6 +196,7 @@ static int translate_fsimage_error(int err);
 /* command handlers */
 static int attach_cmd(int nargs, char **args);
 static int bam_cmd(int nargs, char **args);
+static int batch_cmd(int nargs, char **args);
 static int bcopy_cmd(int nargs, char **args);
 static int bfill_cmd(int nargs, char **args);
 static int block_cmd(int nargs, char **args);
@@ -198,11 +208,13 @@ static int cd_cmd(int nargs, char **args);
 static int chain_cmd(int nargs, char **args);
 static int copy_cmd(int nargs, char **args);
 static int delete_cmd(int nargs, char **args);
+static int detach_cmd(int nargs, char **args);
 static int entry_cmd(int nargs, char **args);
 static int extract_cmd(int nargs, char **args);
 static int extract_geos_cmd(int nargs, char **args);
 static int format_cmd(int nargs, char **args);
 static int help_cmd(int nargs, char **args);
+static int index_cmd(int nargs, char **args);
 static int info_cmd(int nargs, char **args);
 static int list_cmd(int nargs, char **args);
 static int name_cmd(int nargs, char **args);
@@ -285,6 +297,14 @@ const command_t command_list[] = {
       "list available\nones.",
       0, 1,
       help_cmd },
+    { "index",
+      "index <directory> <output> [<jobs>]",
+      "Write a JSON index of the disk images below <directory> to <output>:\n"
+      "the format, SHA1, directory entries and the number of sectors whose\n"
+      "BAM allocation `validate' would change.  The images are not modified.\n"
+      "With <jobs>, the images are indexed by that many processes.",
+      2, 3,
+      index_cmd },
     { "attach",
       "attach <diskimage> [<unit>]",
       "Attach <diskimage> to <unit> (default unit is 8).",
@@ -296,6 +316,14 @@ const command_t command_list[] = {
       "<track-max>",
       0, 3,
       bam_cmd },
+    { "batch",
+      "batch [<file>]",
+      "Execute the commands in <file>, one per line, or read them from the\n"
+      "standard input if no <file> or `-' is given.  `OK' or `ERROR' is printed\n"
+      "after each command.  Images attached in batch mode are held in memory\n"
+      "and only written back when they are detached.",
+      0, 1,
+      batch_cmd },
     { "bcopy",
       "bcopy <src-track> <src-sector> <dst-track> <dst-sector> [<src-unit> "
       "[<dst-unit>]]",
@@ -357,6 +385,11 @@ const command_t command_list[] = {
       "Delete the specified files.",
       1, MAXARG,
       delete_cmd },
+    { "detach",
+      "detach [<unit>]",
+      "Detach the disk image from <unit> (default is the current unit).",
+      0, 1,
+      detach_cmd },
     { "dir",
       "dir [<pattern>]",
       "List files matching <pattern> (default is all files).",
@@ -1089,6 +1122,10 @@ static int open_disk_image(vdrive_t *vdrive, const char *name,
         return -1;
     }
 
+    if (batch_mode) {
+        disk_image_buffer(image);
+    }
+
     vdrive_device_setup(vdrive, unit);
     vdrive_attach_image(image, unit, 0, vdrive);
     return 0;
@@ -1143,6 +1180,9 @@ static int open_image(int dev, char *name, int create, int disktype)
         return -1;
     }
 
+    /* write back the image attached before, it may be the one created */
+    close_disk_image(drives[dev], dev + DRIVE_UNIT_MIN);
+
     if (create) {
         if (cbmimage_create_image(name, (unsigned int)disktype) < 0) {
             printf("cannot create disk image\n");
@@ -1317,11 +1357,591 @@ static int attach_cmd(int nargs, char **args)
     } else {
         archdep_expand_path(&path, args[1]);
     }
+    close_disk_image(drives[dev], dev + DRIVE_UNIT_MIN);
     open_disk_image(drives[dev], path, (unsigned int)dev + DRIVE_UNIT_MIN);
     lib_free(path);
     return FD_OK;
 }
 
+
+/** \brief  Detach disk image from a unit
+ *
+ * Syntax: detach [\<unit>]
+ *
+ * An image held in memory in batch mode is written back.
+ *
+ * \param[in]   nargs   number of arguments
+ * \param[in]   args    argument list
+ *
+ * \return  0 on success, `FD_BADDEV` on failure
+ */
+static int detach_cmd(int nargs, char **args)
+{
+    int dev = drive_index;
+
+    if (nargs == 2) {
+        if (arg_to_int(args[1], &dev) < 0) {
+            return FD_BADDEV;
+        }
+        if (check_drive_unit(dev) != FD_OK) {
+            return FD_BADDEV;
+        }
+        dev -= DRIVE_UNIT_MIN;
+    }
+
+    close_disk_image(drives[dev], dev + DRIVE_UNIT_MIN);
+    return FD_OK;
+}
+
+
+/** \brief  Execute commands read from a file or the standard input
+ *
+ * Syntax: batch [\<file>]
+ *
+ * The images stay attached between the commands and are held in memory, so
+ * a process can apply any number of commands to them without reopening and
+ * probing the images, or writing every sector to the file.  The images are
+ * written back when they are detached, replaced, or when c1541 quits.
+ *
+ * \param[in]   nargs   number of arguments
+ * \param[in]   args    argument list
+ *
+ * \return  0 on success, `FD_NOTRD` if the file cannot be opened,
+ *          `FD_BADVAL` if called from a batch
+ */
+static int batch_cmd(int nargs, char **args)
+{
+    char *bargs[MAXARG];
+    char line[4096];
+    FILE *fp = stdin;
+    int bnargs;
+    int i;
+
+    if (batch_mode) {
+        fprintf(stderr, "batch cannot be nested\n");
+        return FD_BADVAL;
+    }
+
+    if (nargs == 2 && strcmp(args[1], "-") != 0) {
+        fp = fopen(args[1], "r");
+        if (fp == NULL) {
+            return FD_NOTRD;
+        }
+    }
+
+    batch_mode = 1;
+
+    /* hold the images attached before in memory as well */
+    for (i = 0; i < NUM_DISK_UNITS; i++) {
+        if (drives[i] != NULL && drives[i]->image != NULL) {
+            disk_image_buffer(drives[i]->image);
+        }
+    }
+
+    for (i = 0; i < MAXARG; i++) {
+        bargs[i] = NULL;
+    }
+
+    while (fgets(line, sizeof line, fp) != NULL) {
+        if (split_args(line, &bnargs, bargs) < 0) {
+            printf("ERROR\n");
+        } else if (bnargs > 0) {
+            if (lookup_and_execute_command(bnargs, bargs) < 0) {
+                printf("ERROR\n");
+            } else {
+                printf("OK\n");
+            }
+        } else {
+            continue;
+        }
+        fflush(stderr);
+        fflush(stdout);
+    }
+
+    for (i = 0; i < MAXARG; i++) {
+        lib_free(bargs[i]);
+    }
+    if (fp != stdin) {
+        fclose(fp);
+    }
+
+    batch_mode = 0;
+    return FD_OK;
+}
+
+/** \brief  Maximum number of processes used by the `index` command */
+#define INDEX_JOBS_MAX  64
+
+/** \brief  Disk image files found by the `index` command */
+static char **index_files = NULL;
+/** \brief  Number of entries in `index_files` */
+static int index_num_files = 0;
+/** \brief  Size of the `index_files` array */
+static int index_files_size = 0;
+
+
+/** \brief  Add the disk images below \a path to `index_files`
+ *
+ * \param[in]   path    host directory
+ */
+static void index_scan_dir(const char *path)
+{
+    static const char * const exts[] = {
+        "d64", "d67", "d71", "d80", "d81", "d82", "g64", "g71", "x64", NULL
+    };
+    archdep_dir_t *dir;
+    int i, e;
+
+    dir = archdep_opendir(path, ARCHDEP_OPENDIR_NO_HIDDEN_FILES);
+    if (dir == NULL) {
+        fprintf(stderr, "cannot read directory `%s'\n", path);
+        return;
+    }
+
+    for (i = 0; i < dir->file_amount; i++) {
+        char *ext = util_get_extension(dir->files[i]);
+
+        if (ext == NULL) {
+            continue;
+        }
+        for (e = 0; exts[e] != NULL; e++) {
+            if (util_strcasecmp(ext, exts[e]) == 0) {
+                break;
+            }
+        }
+        lib_free(ext);
+        if (exts[e] == NULL) {
+            continue;
+        }
+
+        if (index_num_files == index_files_size) {
+            index_files_size = index_files_size ? index_files_size * 2 : 256;
+            index_files = lib_realloc(index_files,
+                                      sizeof(char *) * (size_t)index_files_size);
+        }
+        index_files[index_num_files++] = util_join_paths(path, dir->files[i], NULL);
+    }
+
+    for (i = 0; i < dir->dir_amount; i++) {
+        const char *name = dir->dirs[i];
+        char *subdir;
+
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+        subdir = util_join_paths(path, name, NULL);
+        index_scan_dir(subdir);
+        lib_free(subdir);
+    }
+
+    archdep_closedir(dir);
+}
+
+
+/** \brief  Free the list of disk images found by the `index` command */
+static void index_free_files(void)
+{
+    int i;
+
+    for (i = 0; i < index_num_files; i++) {
+        lib_free(index_files[i]);
+    }
+    lib_free(index_files);
+    index_files = NULL;
+    index_num_files = 0;
+    index_files_size = 0;
+}
+
+
+/** \brief  Write \a s as a JSON string
+ *
+ * \param[in]   fp  output file
+ * \param[in]   s   string
+ */
+static void index_print_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+
+        if (c == '"' || c == '\\') {
+            fprintf(fp, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+
+/** \brief  Write the PETSCII string \a s as a JSON string
+ *
+ * The string ends at a shifted space (0xa0), a nul, or after \a len bytes.
+ *
+ * \param[in]   fp  output file
+ * \param[in]   s   PETSCII string
+ * \param[in]   len maximum length of \a s
+ */
+static void index_print_petscii(FILE *fp, const uint8_t *s, size_t len)
+{
+    char buf[IMAGE_CONTENTS_NAME_T64_LEN + 1];
+    size_t i;
+
+    for (i = 0; i < len && i < sizeof buf - 1; i++) {
+        if (s[i] == 0 || s[i] == 0xa0) {
+            break;
+        }
+        buf[i] = (char)charset_p_toascii(s[i], CONVERT_WITHOUT_CTRLCODES);
+    }
+    buf[i] = '\0';
+    index_print_string(fp, buf);
+}
+
+
+/** \brief  Calculate the SHA1 of a file
+ *
+ * \param[in]   path    host file
+ * \param[out]  hex     SHA1 as a string of 40 hex digits
+ * \param[out]  size    size of the file
+ *
+ * \return  0 on success, -1 if the file cannot be read
+ */
+static int index_sha1(const char *path, char *hex, long *size)
+{
+    SHA1_CTX ctx;
+    unsigned char data[0x4000];
+    unsigned char digest[20];
+    size_t len;
+    FILE *fd;
+    int i;
+
+    fd = fopen(path, MODE_READ);
+    if (fd == NULL) {
+        return -1;
+    }
+
+    *size = 0;
+    SHA1Init(&ctx);
+    while ((len = fread(data, 1, sizeof data, fd)) > 0) {
+        SHA1Update(&ctx, data, (uint32_t)len);
+        *size += (long)len;
+    }
+    if (ferror(fd)) {
+        fclose(fd);
+        return -1;
+    }
+    fclose(fd);
+    SHA1Final(digest, &ctx);
+
+    for (i = 0; i < 20; i++) {
+        sprintf(hex + i * 2, "%02x", digest[i]);
+    }
+    return 0;
+}
+
+
+/** \brief  Count the BAM errors of the image attached to \a vdrive
+ *
+ * The image is validated in memory and compared with the BAM it had before.
+ * The validated contents are discarded, so the image file is never modified.
+ *
+ * \param[in,out]   vdrive  virtual drive
+ *
+ * \return  number of sectors whose allocation is wrong, -1 if the directory
+ *          or a file chain is broken, -2 if the image cannot be held in
+ *          memory (GCR images)
+ */
+static int index_bam_errors(vdrive_t *vdrive)
+{
+    disk_image_t *image = vdrive->image;
+    uint8_t *allocated;
+    unsigned int track, sector, max_sectors = 0;
+    unsigned int read_only;
+    int errors = 0;
+    size_t i;
+
+    if (disk_image_buffer(image) < 0) {
+        return -2;
+    }
+
+    for (track = 1; track <= vdrive->num_tracks; track++) {
+        if ((unsigned int)vdrive_get_max_sectors(vdrive, track) > max_sectors) {
+            max_sectors = (unsigned int)vdrive_get_max_sectors(vdrive, track);
+        }
+    }
+    allocated = lib_calloc((size_t)(vdrive->num_tracks + 1), max_sectors);
+    for (track = 1; track <= vdrive->num_tracks; track++) {
+        for (sector = 0; sector < (unsigned int)vdrive_get_max_sectors(vdrive, track); sector++) {
+            allocated[track * max_sectors + sector] =
+                (uint8_t)(vdrive_bam_is_sector_allocated(vdrive, track, sector) != 0);
+        }
+    }
+
+    /* the writes of the validation only go to memory */
+    read_only = image->read_only;
+    image->read_only = 0;
+    vdrive->image_mode = 0;
+    if (vdrive_command_validate(vdrive) != CBMDOS_IPE_OK) {
+        errors = -1;
+    } else {
+        for (track = 1; track <= vdrive->num_tracks; track++) {
+            for (sector = 0; sector < (unsigned int)vdrive_get_max_sectors(vdrive, track); sector++) {
+                i = track * max_sectors + sector;
+                if (allocated[i] != (vdrive_bam_is_sector_allocated(vdrive, track, sector) != 0)) {
+                    errors++;
+                }
+            }
+        }
+    }
+    image->read_only = read_only;
+    vdrive->image_mode = (int)read_only;
+
+    disk_image_buffer_discard(image);
+    lib_free(allocated);
+    return errors;
+}
+
+
+/** \brief  Write the index record of one disk image
+ *
+ * \param[in]   fp      output file
+ * \param[in]   path    disk image file
+ */
+static void index_image(FILE *fp, const char *path)
+{
+    vdrive_t *vdrive;
+    image_contents_t *listing;
+    image_contents_file_list_t *element;
+    char sha1[41];
+    long size;
+    const char *type;
+    int errors;
+
+    fputs("{\"path\":", fp);
+    index_print_string(fp, path);
+
+    if (index_sha1(path, sha1, &size) < 0) {
+        fputs(",\"error\":\"cannot read file\"}\n", fp);
+        return;
+    }
+    fprintf(fp, ",\"size\":%ld,\"sha1\":\"%s\"", size, sha1);
+
+    vdrive = lib_calloc(1, sizeof *vdrive);
+    if (open_disk_image(vdrive, path, DRIVE_UNIT_MIN) < 0) {
+        lib_free(vdrive);
+        fputs(",\"error\":\"unknown image format\"}\n", fp);
+        return;
+    }
+
+    type = disk_image_type(vdrive->image);
+    fputs(",\"format\":", fp);
+    index_print_string(fp, type != NULL ? type : "");
+    fputs(",\"dos\":", fp);
+    index_print_string(fp, image_format_name(vdrive->image_format));
+
+    listing = diskcontents_block_read(vdrive, 0);
+    if (listing == NULL) {
+        fputs(",\"error\":\"cannot read directory\"", fp);
+    } else {
+        fputs(",\"name\":", fp);
+        index_print_petscii(fp, listing->name, IMAGE_CONTENTS_NAME_LEN);
+        fputs(",\"id\":", fp);
+        index_print_petscii(fp, listing->id, IMAGE_CONTENTS_ID_LEN);
+        fprintf(fp, ",\"blocks_free\":%d,\"entries\":[", listing->blocks_free);
+        for (element = listing->file_list; element != NULL; element = element->next) {
+            char *ftype = image_contents_filetype_to_string(element,
+                    IMAGE_CONTENTS_STRING_ASCII);
+
+            fputs(element == listing->file_list ? "{\"name\":" : ",{\"name\":", fp);
+            index_print_petscii(fp, element->name, IMAGE_CONTENTS_FILE_NAME_LEN);
+            /* drop the padding around the type and flags */
+            util_remove_spaces(ftype);
+            fputs(",\"type\":", fp);
+            index_print_string(fp, ftype);
+            fprintf(fp, ",\"blocks\":%u}", element->size);
+            lib_free(ftype);
+        }
+        fputc(']', fp);
+        image_contents_destroy(listing);
+    }
+
+    errors = index_bam_errors(vdrive);
+    if (errors == -2) {
+        fputs(",\"bam_errors\":null", fp);
+    } else {
+        fprintf(fp, ",\"bam_errors\":%d", errors);
+    }
+
+    close_disk_image(vdrive, DRIVE_UNIT_MIN);
+    lib_free(vdrive);
+    fputs("}\n", fp);
+}
+
+
+/** \brief  Index a range of the disk images found by the `index` command
+ *
+ * \param[in]   filename    output file, one JSON object per line
+ * \param[in]   first       first image to index
+ * \param[in]   last        image after the last one to index
+ *
+ * \return  0 on success, -1 if \a filename cannot be written
+ */
+static int index_write_part(const char *filename, int first, int last)
+{
+    FILE *fp;
+    int i;
+
+    fp = fopen(filename, MODE_WRITE_TEXT);
+    if (fp == NULL) {
+        return -1;
+    }
+    for (i = first; i < last; i++) {
+        index_image(fp, index_files[i]);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+
+/** \brief  Index the disk images in a directory tree
+ *
+ * Syntax: index \<directory> \<output> [\<jobs>]
+ *
+ * The images are split into \<jobs> consecutive ranges, each indexed by a
+ * process of its own into a part file, and the parts are then joined into
+ * a JSON array in \<output>.  Processes are used instead of threads because
+ * the vdrive code keeps state in globals.
+ *
+ * \param[in]   nargs   number of arguments
+ * \param[in]   args    argument list
+ *
+ * \return  0 on success, `FD_BADVAL` for an invalid number of jobs,
+ *          `FD_NOTRD` if no images are found, `FD_NOTWRT` if the output
+ *          cannot be written
+ */
+static int index_cmd(int nargs, char **args)
+{
+    char *parts[INDEX_JOBS_MAX];
+    char line[0x1000];
+    FILE *out;
+    int jobs = 1;
+    int job, i, n;
+    int rc = FD_OK;
+
+    if (nargs == 4) {
+        if (arg_to_int(args[3], &jobs) < 0 || jobs < 1 || jobs > INDEX_JOBS_MAX) {
+            return FD_BADVAL;
+        }
+    }
+
+    index_scan_dir(args[1]);
+    if (index_num_files == 0) {
+        fprintf(stderr, "no disk images below `%s'\n", args[1]);
+        index_free_files();
+        return FD_NOTRD;
+    }
+    if (jobs > index_num_files) {
+        jobs = index_num_files;
+    }
+
+    for (job = 0; job < jobs; job++) {
+        parts[job] = lib_msprintf("%s.%d", args[2], job);
+    }
+
+#ifdef UNIX_COMPILE
+    if (jobs > 1) {
+        pid_t pids[INDEX_JOBS_MAX];
+        int status;
+
+        /* Do not let the children inherit unwritten output.  */
+        fflush(NULL);
+
+        for (job = 0; job < jobs; job++) {
+            pids[job] = fork();
+            if (pids[job] == 0) {
+                _exit(index_write_part(parts[job],
+                                       job * index_num_files / jobs,
+                                       (job + 1) * index_num_files / jobs) < 0
+                      ? EXIT_FAILURE : EXIT_SUCCESS);
+            }
+            if (pids[job] < 0) {
+                fprintf(stderr, "cannot fork index process %d: %s\n",
+                        job, strerror(errno));
+                /* index the range in this process */
+                if (index_write_part(parts[job],
+                                     job * index_num_files / jobs,
+                                     (job + 1) * index_num_files / jobs) < 0) {
+                    rc = FD_NOTWRT;
+                }
+            }
+        }
+        for (job = 0; job < jobs; job++) {
+            if (pids[job] > 0
+                && (waitpid(pids[job], &status, 0) < 0
+                    || !WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+                rc = FD_NOTWRT;
+            }
+        }
+    } else
+#endif
+    {
+        for (job = 0; job < jobs; job++) {
+            if (index_write_part(parts[job],
+                                 job * index_num_files / jobs,
+                                 (job + 1) * index_num_files / jobs) < 0) {
+                rc = FD_NOTWRT;
+            }
+        }
+    }
+
+    out = NULL;
+    if (rc == FD_OK) {
+        out = fopen(args[2], MODE_WRITE_TEXT);
+        if (out == NULL) {
+            rc = FD_NOTWRT;
+        }
+    }
+
+    /* join the parts; a record is a line, and may be longer than `line' */
+    n = 0;
+    if (out != NULL) {
+        fputs("[\n", out);
+    }
+    for (job = 0; job < jobs; job++) {
+        FILE *part = out != NULL ? fopen(parts[job], MODE_READ_TEXT) : NULL;
+        int start = 1;
+
+        while (part != NULL && fgets(line, sizeof line, part) != NULL) {
+            if (start && n++ > 0) {
+                fputs(",\n", out);
+            }
+            i = (int)strlen(line);
+            start = i > 0 && line[i - 1] == '\n';
+            if (start) {
+                line[i - 1] = '\0';
+            }
+            fputs(line, out);
+        }
+        if (part != NULL) {
+            fclose(part);
+        }
+        archdep_remove(parts[job]);
+        lib_free(parts[job]);
+    }
+    if (out != NULL) {
+        fputs("\n]\n", out);
+        if (fclose(out) != 0) {
+            rc = FD_NOTWRT;
+        } else {
+            printf("indexed %d images into `%s'\n", n, args[2]);
+        }
+    }
+
+    index_free_files();
+    return rc;
+}
+
 /** \brief  Maximum sector numbers to print in the sector header */
 #define BAM_SECTOR_HEADER_MAX_SECTORS   256
 /** \brief  Size of a sector number header line */
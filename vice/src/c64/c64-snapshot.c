@@ -33,6 +33,7 @@
 #include "c64-memory-hacks.h"
 #include "c64.h"
 #include "c64gluelogic.h"
+#include "c64mem.h"
 #include "c64memsnapshot.h"
 #include "cia.h"
 #include "drive-snapshot.h"
@@ -59,15 +60,8 @@
 #define SNAP_MAJOR 2
 #define SNAP_MINOR 0
 
-int c64_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode)
+static int c64_snapshot_write_modules(snapshot_t *s, int save_roms, int save_disks, int event_mode)
 {
-    snapshot_t *s;
-
-    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_get_name());
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     /* Execute drive CPUs to get in sync with the main CPU.  */
@@ -89,6 +83,22 @@ int c64_snapshot_write(const char *name, int save_roms, int save_disks, int even
         || joyport_snapshot_write_module(s, JOYPORT_1) < 0
         || joyport_snapshot_write_module(s, JOYPORT_2) < 0
         || userport_snapshot_write_module(s) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int c64_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s;
+
+    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (c64_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
         snapshot_close(s);
         archdep_remove(name);
         return -1;
@@ -98,16 +108,26 @@ int c64_snapshot_write(const char *name, int save_roms, int save_disks, int even
     return 0;
 }
 
-int c64_snapshot_read(const char *name, int event_mode)
+snapshot_t *c64_snapshot_write_mem(int save_roms, int save_disks, int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
 
-    s = snapshot_open(name, &major, &minor, machine_get_name());
+    s = snapshot_create_mem(((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_get_name());
     if (s == NULL) {
-        return -1;
+        return NULL;
+    }
+
+    if (c64_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return NULL;
     }
 
+    return s;
+}
+
+/* Read the modules of an opened snapshot; `s' is closed in any case.  */
+static int c64_snapshot_read_modules(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -118,6 +138,9 @@ int c64_snapshot_read(const char *name, int event_mode)
 
     joyport_clear_devices();
 
+    /* RAM is replaced as a whole.  */
+    mem_ram_dirty_mark_all();
+
     if (maincpu_snapshot_read_module(s) < 0
         || c64_snapshot_read_module(s) < 0
         || ciacore_snapshot_read_module(machine_context.cia1, s) < 0
@@ -152,3 +175,29 @@ fail:
 
     return -1;
 }
+
+int c64_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    return c64_snapshot_read_modules(s, major, minor, event_mode);
+}
+
+int c64_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open_mem(data, size, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    return c64_snapshot_read_modules(s, major, minor, event_mode);
+}
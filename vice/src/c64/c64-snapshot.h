@@ -27,7 +27,14 @@
 #ifndef VICE_C64_SNAPSHOT_H
 #define VICE_C64_SNAPSHOT_H
 
+#include "types.h"
+
+struct snapshot_s;
+
 int c64_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode);
 int c64_snapshot_read(const char *name, int event_mode);
 
+struct snapshot_s *c64_snapshot_write_mem(int save_roms, int save_disks, int event_mode);
+int c64_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode);
+
 #endif
@@ -119,6 +119,7 @@
 #include "sid.h"
 #include "sound.h"
 #include "spaceballs.h"
+#include "statehash.h"
 #include "tape.h"
 #include "tape_diag_586220_harness.h"
 #include "tapeport.h"
@@ -210,6 +211,15 @@ static const trap_t c64_serial_traps[] = {
     { NULL, 0, 0, { 0, 0, 0 }, NULL, NULL, NULL }
 };
 
+/* LOAD byte loop: JSR $EE13 at $F4F9, then TAX, LDA $90, LSR, LSR, BCS;
+   the bytes are stored with STA ($AE),Y.  */
+static const serial_trap_load_t c64_serial_load = {
+    0xf4fb,
+    { 0x20, 0x13, 0xee, 0xaa, 0xa5, 0x90, 0x4a, 0x4a, 0xb0 },
+    0xae,
+    0x93
+};
+
 /* Tape traps.  */
 static const trap_t c64_tape_traps[] = {
     { "TapeFindHeader", 0xF72F, 0xF732, { 0x20, 0x41, 0xF8 }, tape_find_header_trap, c64memrom_trap_read, c64memrom_trap_store },
@@ -1126,6 +1136,26 @@ void machine_setup_context(void)
     machine_printer_setup_context(&machine_context);
 }
 
+/* Chip registers hashed for the desync detection: VIC-II and the CIA timers
+   and interrupt registers.  The SID is left out, its read back registers
+   depend on the sound engine.  */
+static const statehash_io_range_t c64_statehash_io[] = {
+    { 0xd000, 0xd02e },
+    { 0xdc04, 0xdc0f },
+    { 0xdd04, 0xdd0f },
+    { 0, 0 }
+};
+
+static const statehash_machine_t c64_statehash = {
+    mem_ram,
+    C64_RAM_PAGES,
+    mem_ram_dirty_track,
+    mem_ram_dirty_tracking,
+    mem_ram_dirty_get,
+    mem_ram_dirty_clear,
+    c64_statehash_io
+};
+
 /* C64-specific initialization.  */
 int machine_specific_init(void)
 {
@@ -1146,6 +1176,7 @@ int machine_specific_init(void)
     }
 
     serial_trap_init(0xa4);
+    serial_trap_load_set(&c64_serial_load);
     serial_iec_bus_init();
 
     /* Initialize RS232 handler.  */
@@ -1180,6 +1211,7 @@ int machine_specific_init(void)
     }
 
     c64_mem_init();
+    statehash_register(&c64_statehash);
 
     cia1_init(machine_context.cia1);
     cia2_init(machine_context.cia2);
@@ -1334,6 +1366,8 @@ void machine_specific_shutdown(void)
     /* close the video chip(s) */
     vicii_shutdown();
 
+    statehash_shutdown();
+
     plus60k_shutdown();
     plus256k_shutdown();
     c64_256k_shutdown();
@@ -1482,6 +1516,24 @@ int machine_read_snapshot(const char *name, int event_mode)
     return err;
 }
 
+snapshot_t *machine_write_snapshot_mem(int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s = c64_snapshot_write_mem(save_roms, save_disks, event_mode);
+    if ((s == NULL) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_WRITE_SNAPSHOT);
+    }
+    return s;
+}
+
+int machine_read_snapshot_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    int err = c64_snapshot_read_mem(data, size, event_mode);
+    if ((err < 0) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_READ_SNAPSHOT);
+    }
+    return err;
+}
+
 /* ------------------------------------------------------------------------- */
 /* FIXME: those two shouldnt be here anymore */
 int machine_autodetect_psid(const char *name)
@@ -51,6 +51,11 @@ int machine_bus_lib_read_sector(unsigned int unit, unsigned int track, unsigned
     return serial_iec_lib_read_sector(unit, track, sector, buf);
 }
 
+int machine_bus_lib_read_sectors(unsigned int unit, unsigned int track, unsigned int sector, unsigned int count, uint8_t *buf)
+{
+    return serial_iec_lib_read_sectors(unit, track, sector, count, buf);
+}
+
 int machine_bus_lib_write_sector(unsigned int unit, unsigned int track, unsigned int sector, uint8_t *buf)
 {
     return serial_iec_lib_write_sector(unit, track, sector, buf);
@@ -32,6 +32,7 @@
 
 #include <stdio.h>
 
+#include "autowarp.h"
 #include "c64fastiec.h"
 #include "c64-resources.h"
 #include "c64.h"
@@ -204,6 +205,8 @@ static uint8_t read_ciapa(cia_context_t *cia_context)
 
     value = ((cia_context->c_cia[CIA_PRA] | ~(cia_context->c_cia[CIA_DDRA])) & 0x3f);
 
+    autowarp_iec_poll();
+
     if (c64iec_active) {
         /*  Bit 7  Serial Bus Data Input
             Bit 6  Serial Bus Clock Pulse Input
@@ -247,7 +250,7 @@ static void read_ciaicr(cia_context_t *cia_context)
     if (burst_mod == BURST_MOD_CIA2) {
         drive_cpu_execute_all(maincpu_clk);
     }
-    parallel_cable_cpu_execute(DRIVE_PC_STANDARD);
+    parallel_cable_cpu_execute_read(DRIVE_PC_STANDARD);
 }
 
 static void read_sdr(cia_context_t *cia_context)
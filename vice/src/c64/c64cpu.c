@@ -138,6 +138,14 @@ static void check_and_run_alternate_cpu(void)
 
 #define CHECK_AND_RUN_ALTERNATE_CPU check_and_run_alternate_cpu();
 
+/* Chain instructions in the core without hooks, see 6510core.c.  The Z80
+   of the CP/M cartridge, the hooks and the cycle limit are checked between
+   instructions by maincpu.c, so chaining stops while any of them is in
+   use.  */
+#define CPU_BLOCK_CHAIN
+#define CPU_BLOCK_CHAIN_ALLOWED() \
+    (!MAINCPU_HOOKS_ACTIVE() && !maincpu_clk_limit && !cpmcart_cart_enabled())
+
 #define HAVE_Z80_REGS
 
 #include "../maincpu.c"
@@ -38,17 +38,50 @@
 CLOCK maincpu_clk = 0L;
 /* if != 0, exit when this many cycles have been executed */
 CLOCK maincpu_clk_limit = 0L;
+/* if != 0, return from maincpu_mainloop() at the cycle limit instead */
+int maincpu_clk_limit_return = 0;
 
 #define REWIND_FETCH_OPCODE(clock) /*clock-=2*/
 
 /* Mask: BA low */
 int maincpu_ba_low_flags = 0;
 
-#define CLK_INC()                                  \
-    interrupt_delay();                             \
-    maincpu_clk++;                                 \
-    maincpu_ba_low_flags &= ~MAINCPU_BA_LOW_VICII; \
-    maincpu_ba_low_flags |= vicii_cycle()
+/* Cycles the CPU may still run ahead of the VIC-II in this instruction,
+   and the cycles the VIC-II is behind (see vicii_cycle_quiet()).  */
+static unsigned int vicii_quiet = 0;
+static unsigned int vicii_behind = 0;
+
+/* Let the VIC-II catch up, before anything it could see or change.  */
+static void vicii_sync(void)
+{
+    vicii_quiet = 0;
+    if (vicii_behind > 0) {
+        vicii_cycle_catch_up(vicii_behind);
+        vicii_behind = 0;
+    }
+}
+
+#define CPU_CATCH_UP() vicii_sync()
+
+#define CLK_INC()                                      \
+    interrupt_delay();                                 \
+    maincpu_clk++;                                     \
+    maincpu_ba_low_flags &= ~MAINCPU_BA_LOW_VICII;     \
+    if (vicii_quiet > 0) {                             \
+        vicii_quiet--;                                 \
+        vicii_behind++;                                \
+    } else {                                           \
+        vicii_sync();                                  \
+        maincpu_ba_low_flags |= vicii_cycle();         \
+    }
+
+/* The VIC-II is caught up at the end of every instruction, so it only runs
+   behind over the opcode fetch and operand reads of one instruction.  */
+#ifdef DEBUG
+#define VICII_RUN_AHEAD()
+#else
+#define VICII_RUN_AHEAD() vicii_quiet = vicii_cycle_quiet()
+#endif
 
 
 /* Skip cycle implementation */
@@ -114,7 +147,13 @@ int maincpu_ba_low_flags = 0;
 
 /* HACK: memmap updates for the reg_pc < bank_limit case */
 #ifdef FEATURE_CPUMEMHISTORY
-#define MEMMAP_UPDATE(addr) memmap_mem_update(addr, 0, 0) /* FIXME: is this a dummy access or not? */
+/* FIXME: is this a dummy access or not? */
+#define MEMMAP_UPDATE(addr)                    \
+    do {                                       \
+        if (monitor_cpuhistory_enabled) {      \
+            memmap_mem_update(addr, 0, 0);     \
+        }                                      \
+    } while (0)
 #else
 #define MEMMAP_UPDATE(addr)
 #endif
@@ -123,6 +162,7 @@ int maincpu_ba_low_flags = 0;
 #if !defined WORDS_BIGENDIAN && defined ALLOW_UNALIGNED_ACCESS
 #define FETCH_OPCODE(o)                                        \
     do {                                                       \
+        VICII_RUN_AHEAD();                                     \
         if (((int)reg_pc) < bank_limit) {                      \
             check_ba();                                        \
             o = (*((uint32_t *)(bank_base + reg_pc)) & 0xffffff); \
@@ -151,6 +191,7 @@ int maincpu_ba_low_flags = 0;
 #else /* WORDS_BIGENDIAN || !ALLOW_UNALIGNED_ACCESS */
 #define FETCH_OPCODE(o)                                          \
     do {                                                         \
+        VICII_RUN_AHEAD();                                       \
         if (((int)reg_pc) < bank_limit) {                        \
             check_ba();                                          \
             (o).ins = *(bank_base + reg_pc);                     \
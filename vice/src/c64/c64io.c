@@ -78,6 +78,65 @@ static io_source_list_t c64io_dd00_head = { NULL, NULL, NULL };
 static io_source_list_t c64io_de00_head = { NULL, NULL, NULL };
 static io_source_list_t c64io_df00_head = { NULL, NULL, NULL };
 
+/* Dispatch maps of the I/O pages, indexed by bits 8-11 and 0-7 of the
+   address.  An entry holds the only device that reads (or stores) at that
+   address, NULL if there is none, or IO_SOURCE_CONTESTED if several devices
+   claim the address and io_read()/io_store() have to walk the list and
+   handle the collision.  Rebuilt whenever a device is (un)registered.  */
+static io_source_t io_source_contested;
+#define IO_SOURCE_CONTESTED (&io_source_contested)
+
+static io_source_t *io_read_map[0x10][0x100];
+static io_source_t *io_store_map[0x10][0x100];
+
+static void io_source_map_list(io_source_list_t *list)
+{
+    io_source_list_t *current;
+    io_source_t *device;
+    unsigned int page;
+    unsigned int addr;
+    unsigned int end;
+
+    for (current = list->next; current != NULL; current = current->next) {
+        device = current->device;
+        page = device->start_address & 0xff00;
+        end = device->end_address;
+        /* the list only sees the accesses to its own page */
+        if (end > (page | 0xff)) {
+            end = page | 0xff;
+        }
+        for (addr = device->start_address; addr <= end; addr++) {
+            io_source_t **rd = &io_read_map[(addr >> 8) & 0x0f][addr & 0xff];
+            io_source_t **st = &io_store_map[(addr >> 8) & 0x0f][addr & 0xff];
+
+            if (device->read != NULL) {
+                *rd = (*rd == NULL) ? device : IO_SOURCE_CONTESTED;
+            }
+            if (device->store != NULL) {
+                *st = (*st == NULL) ? device : IO_SOURCE_CONTESTED;
+            }
+        }
+    }
+}
+
+static void io_source_map_update(void)
+{
+    memset(io_read_map, 0, sizeof(io_read_map));
+    memset(io_store_map, 0, sizeof(io_store_map));
+
+    io_source_map_list(&c64io_d000_head);
+    io_source_map_list(&c64io_d100_head);
+    io_source_map_list(&c64io_d200_head);
+    io_source_map_list(&c64io_d300_head);
+    io_source_map_list(&c64io_d400_head);
+    io_source_map_list(&c64io_d500_head);
+    io_source_map_list(&c64io_d600_head);
+    io_source_map_list(&c64io_d700_head);
+    io_source_map_list(&c64io_dd00_head);
+    io_source_map_list(&c64io_de00_head);
+    io_source_map_list(&c64io_df00_head);
+}
+
 static void io_source_detach(io_source_detach_t *source)
 {
     switch (source->det_id) {
@@ -301,9 +360,21 @@ static inline uint8_t io_read(io_source_list_t *list, uint16_t addr)
     uint8_t retval = 0;
     uint8_t firstval = 0;
     unsigned int lowest_order = 0xffffffff;
+    io_source_t *device = io_read_map[(addr >> 8) & 0x0f][addr & 0xff];
 
     vicii_handle_pending_alarms_external(0);
 
+    /* no collision possible, skip the list */
+    if (device != IO_SOURCE_CONTESTED) {
+        if (device != NULL) {
+            retval = device->read((uint16_t)(addr & device->address_mask));
+            if (device->io_source_valid) {
+                return retval;
+            }
+        }
+        return vicii_read_phi1();
+    }
+
     while (current) {
         if (current->device->read != NULL) {
             if ((addr >= current->device->start_address) && (addr <= current->device->end_address)) {
@@ -396,9 +467,18 @@ static inline void io_store(io_source_list_t *list, uint16_t addr, uint8_t value
     uint16_t addy = 0xffff;
     io_source_list_t *current = list->next;
     void (*store)(uint16_t address, uint8_t data) = NULL;
+    io_source_t *device = io_store_map[(addr >> 8) & 0x0f][addr & 0xff];
 
     vicii_handle_pending_alarms_external_write();
 
+    /* no collision possible, skip the list */
+    if (device != IO_SOURCE_CONTESTED) {
+        if (device != NULL) {
+            device->store((uint16_t)(addr & device->address_mask), value);
+        }
+        return;
+    }
+
     while (current) {
         if (current->device->store != NULL) {
             if (addr >= current->device->start_address && addr <= current->device->end_address) {
@@ -482,6 +562,8 @@ io_source_list_t *io_source_register(io_source_t *device)
     retval->next = NULL;
     retval->device->order = order++;
 
+    io_source_map_update();
+
     return retval;
 }
 
@@ -506,6 +588,8 @@ void io_source_unregister(io_source_list_t *device)
     }
 
     lib_free(device);
+
+    io_source_map_update();
 }
 
 void cartio_shutdown(void)
@@ -49,6 +49,7 @@
 #include "cartio.h"
 #include "cartridge.h"
 #include "cia.h"
+#include "lib.h"
 #include "machine.h"
 #include "maincpu.h"
 #include "mem.h"
@@ -97,11 +98,23 @@ store_func_ptr_t *_mem_write_tab_ptr_dummy;
 static uint8_t **_mem_read_base_tab_ptr;
 static uint32_t *mem_read_limit_tab_ptr;
 
-/* Memory read and write tables.  */
-static store_func_ptr_t mem_write_tab[NUM_VBANKS][NUM_CONFIGS][0x101];
-static read_func_ptr_t mem_read_tab[NUM_CONFIGS][0x101];
-static uint8_t *mem_read_base_tab[NUM_CONFIGS][0x101];
-static uint32_t mem_read_limit_tab[NUM_CONFIGS][0x101];
+/* Memory read and write tables.  These are only allocated while
+   `mem_initialize_memory()' fills them in; most of their rows are copies of
+   each other, so afterwards each distinct row is kept once in
+   `mem_tab_pool' and the configurations that map the same share it.  This
+   keeps the rows used by programs switching configurations often in a few
+   KB of cache instead of some 400 KB.  */
+static store_func_ptr_t (*mem_write_tab)[NUM_CONFIGS][0x101] = NULL;
+static read_func_ptr_t (*mem_read_tab)[0x101] = NULL;
+static uint8_t *(*mem_read_base_tab)[0x101] = NULL;
+static uint32_t (*mem_read_limit_tab)[0x101] = NULL;
+
+/* The rows in use for each configuration.  */
+static store_func_ptr_t *mem_write_tab_row[NUM_VBANKS][NUM_CONFIGS];
+static read_func_ptr_t *mem_read_tab_row[NUM_CONFIGS];
+static uint8_t **mem_read_base_tab_row[NUM_CONFIGS];
+static uint32_t *mem_read_limit_tab_row[NUM_CONFIGS];
+static uint8_t *mem_tab_pool = NULL;
 
 static store_func_ptr_t mem_write_tab_watch[0x101];
 static read_func_ptr_t mem_read_tab_watch[0x101];
@@ -125,37 +138,66 @@ static int tape_motor_in = 0;
 */
 static int watchpoints_active = 0;
 
+/* Dirty page tracking of `mem_ram': while enabled the write table is
+   replaced by `mem_write_tab_dirty', which flags the page and passes the
+   store on to the real write table.  */
+static int dirty_tracking_active = 0;
+static uint8_t mem_ram_dirty[C64_RAM_PAGES];
+static store_func_ptr_t mem_write_tab_dirty[0x101];
+
 /* ------------------------------------------------------------------------- */
 
 static uint8_t zero_read_watch(uint16_t addr)
 {
     addr &= 0xff;
     monitor_watch_push_load_addr(addr, e_comp_space);
-    return mem_read_tab[mem_config][0](addr);
+    return mem_read_tab_row[mem_config][0](addr);
 }
 
 static void zero_store_watch(uint16_t addr, uint8_t value)
 {
     addr &= 0xff;
     monitor_watch_push_store_addr(addr, e_comp_space);
-    mem_write_tab[vbank][mem_config][0](addr, value);
+    if (dirty_tracking_active) {
+        mem_ram_dirty[0] = 1;
+    }
+    mem_write_tab_row[vbank][mem_config][0](addr, value);
 }
 
 static uint8_t read_watch(uint16_t addr)
 {
     monitor_watch_push_load_addr(addr, e_comp_space);
-    return mem_read_tab[mem_config][addr >> 8](addr);
+    return mem_read_tab_row[mem_config][addr >> 8](addr);
 }
 
 static void store_watch(uint16_t addr, uint8_t value)
 {
     monitor_watch_push_store_addr(addr, e_comp_space);
-    mem_write_tab[vbank][mem_config][addr >> 8](addr, value);
+    if (dirty_tracking_active) {
+        mem_ram_dirty[addr >> 8] = 1;
+    }
+    mem_write_tab_row[vbank][mem_config][addr >> 8](addr, value);
+}
+
+static void zero_store_dirty(uint16_t addr, uint8_t value)
+{
+    addr &= 0xff;
+    mem_ram_dirty[0] = 1;
+    mem_write_tab_row[vbank][mem_config][0](addr, value);
+}
+
+static void store_dirty(uint16_t addr, uint8_t value)
+{
+    mem_ram_dirty[addr >> 8] = 1;
+    mem_write_tab_row[vbank][mem_config][addr >> 8](addr, value);
 }
 
-/* called by mem_pla_config_changed(), mem_toggle_watchpoints() */
+/* called by mem_pla_config_changed(), mem_toggle_watchpoints(),
+   mem_ram_dirty_track() */
 static void mem_update_tab_ptrs(int flag)
 {
+    store_func_ptr_t *write_tab = dirty_tracking_active ? mem_write_tab_dirty : mem_write_tab_row[vbank][mem_config];
+
     if (flag) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
@@ -164,15 +206,15 @@ static void mem_update_tab_ptrs(int flag)
             _mem_read_tab_ptr_dummy = mem_read_tab_watch;
             _mem_write_tab_ptr_dummy = mem_write_tab_watch;
         } else {
-            _mem_read_tab_ptr_dummy = mem_read_tab[mem_config];
-            _mem_write_tab_ptr_dummy = mem_write_tab[vbank][mem_config];
+            _mem_read_tab_ptr_dummy = mem_read_tab_row[mem_config];
+            _mem_write_tab_ptr_dummy = write_tab;
         }
     } else {
         /* all watchpoints disabled */
-        _mem_read_tab_ptr = mem_read_tab[mem_config];
-        _mem_write_tab_ptr = mem_write_tab[vbank][mem_config];
-        _mem_read_tab_ptr_dummy = mem_read_tab[mem_config];
-        _mem_write_tab_ptr_dummy = mem_write_tab[vbank][mem_config];
+        _mem_read_tab_ptr = mem_read_tab_row[mem_config];
+        _mem_write_tab_ptr = write_tab;
+        _mem_read_tab_ptr_dummy = mem_read_tab_row[mem_config];
+        _mem_write_tab_ptr_dummy = write_tab;
     }
 }
 
@@ -184,6 +226,35 @@ void mem_toggle_watchpoints(int flag, void *context)
 
 /* ------------------------------------------------------------------------- */
 
+void mem_ram_dirty_track(int enable)
+{
+    dirty_tracking_active = enable ? 1 : 0;
+    mem_ram_dirty_mark_all();
+    mem_update_tab_ptrs(watchpoints_active);
+}
+
+int mem_ram_dirty_tracking(void)
+{
+    return dirty_tracking_active;
+}
+
+const uint8_t *mem_ram_dirty_get(void)
+{
+    return mem_ram_dirty;
+}
+
+void mem_ram_dirty_clear(void)
+{
+    memset(mem_ram_dirty, 0, sizeof(mem_ram_dirty));
+}
+
+void mem_ram_dirty_mark_all(void)
+{
+    memset(mem_ram_dirty, 1, sizeof(mem_ram_dirty));
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* $00/$01 unused bits emulation
 
    - There are 2 different unused bits, 1) the output bits, 2) the input bits
@@ -213,8 +284,8 @@ void mem_pla_config_changed(void)
 
     mem_update_tab_ptrs(watchpoints_active);
 
-    _mem_read_base_tab_ptr = mem_read_base_tab[mem_config];
-    mem_read_limit_tab_ptr = mem_read_limit_tab[mem_config];
+    _mem_read_base_tab_ptr = mem_read_base_tab_row[mem_config];
+    mem_read_limit_tab_ptr = mem_read_limit_tab_row[mem_config];
 
     maincpu_resync_limits();
 }
@@ -476,6 +547,18 @@ uint8_t mem_dma_read(uint16_t addr)
     return _mem_read_tab_ptr[addr >> 8](addr);
 }
 
+uint8_t *mem_dma_ram_page(uint16_t addr)
+{
+    unsigned int page = addr >> 8;
+
+    if (page == 0
+        || _mem_read_tab_ptr[page] != ram_read
+        || _mem_write_tab_ptr[page] != ram_store) {
+        return NULL;
+    }
+    return mem_ram + (page << 8);
+}
+
 /* ------------------------------------------------------------------------- */
 
 /* Generic memory access.  */
@@ -494,7 +577,7 @@ void mem_store_without_ultimax(uint16_t addr, uint8_t value)
 {
     store_func_ptr_t *write_tab_ptr;
 
-    write_tab_ptr = mem_write_tab[vbank][mem_config & 7];
+    write_tab_ptr = mem_write_tab_row[vbank][mem_config & 7];
 
     write_tab_ptr[addr >> 8](addr, value);
 }
@@ -503,7 +586,7 @@ uint8_t mem_read_without_ultimax(uint16_t addr)
 {
     read_func_ptr_t *read_tab_ptr;
 
-    read_tab_ptr = mem_read_tab[mem_config & 7];
+    read_tab_ptr = mem_read_tab_row[mem_config & 7];
 
     return read_tab_ptr[addr >> 8](addr);
 }
@@ -512,7 +595,7 @@ void mem_store_without_romlh(uint16_t addr, uint8_t value)
 {
     store_func_ptr_t *write_tab_ptr;
 
-    write_tab_ptr = mem_write_tab[vbank][0];
+    write_tab_ptr = mem_write_tab_row[vbank][0];
 
     write_tab_ptr[addr >> 8](addr, value);
 }
@@ -690,6 +773,135 @@ static void plus60k_init_config(void)
 
 /* ------------------------------------------------------------------------- */
 
+/* Allocate the tables for `mem_initialize_memory()' and use their rows
+   directly until they are compacted.  */
+static void mem_tab_alloc(void)
+{
+    int i, k;
+
+    mem_write_tab = lib_calloc(NUM_VBANKS, sizeof(*mem_write_tab));
+    mem_read_tab = lib_calloc(NUM_CONFIGS, sizeof(*mem_read_tab));
+    mem_read_base_tab = lib_calloc(NUM_CONFIGS, sizeof(*mem_read_base_tab));
+    mem_read_limit_tab = lib_calloc(NUM_CONFIGS, sizeof(*mem_read_limit_tab));
+
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        for (k = 0; k < NUM_VBANKS; k++) {
+            mem_write_tab_row[k][i] = mem_write_tab[k][i];
+        }
+        mem_read_tab_row[i] = mem_read_tab[i];
+        mem_read_base_tab_row[i] = mem_read_base_tab[i];
+        mem_read_limit_tab_row[i] = mem_read_limit_tab[i];
+    }
+}
+
+/* Find the distinct ones of the `num' rows of `size' bytes in `rows', which
+   are copied to `pool' (if not NULL) one after the other.  `index' gets the
+   copy used by each row.  Returns the number of distinct rows.  */
+static int mem_tab_dedup(uint8_t **rows, int num, size_t size, uint8_t *pool, int *index)
+{
+    int i, j, n = 0;
+
+    for (i = 0; i < num; i++) {
+        for (j = 0; j < i; j++) {
+            if (memcmp(rows[j], rows[i], size) == 0) {
+                break;
+            }
+        }
+        if (j < i) {
+            index[i] = index[j];
+        } else {
+            if (pool != NULL) {
+                memcpy(pool + n * size, rows[i], size);
+            }
+            index[i] = n++;
+        }
+    }
+    return n;
+}
+
+/* Keep one copy of each distinct row and free the tables.  */
+static void mem_tab_compact(void)
+{
+    uint8_t *rows[NUM_VBANKS * NUM_CONFIGS];
+    int index[NUM_VBANKS * NUM_CONFIGS];
+    uint8_t *write_pool, *read_pool, *base_pool, *limit_pool;
+    int num_write, num_read, num_base, num_limit;
+    int i, k;
+
+    for (k = 0; k < NUM_VBANKS; k++) {
+        for (i = 0; i < NUM_CONFIGS; i++) {
+            rows[k * NUM_CONFIGS + i] = (uint8_t *)mem_write_tab[k][i];
+        }
+    }
+    num_write = mem_tab_dedup(rows, NUM_VBANKS * NUM_CONFIGS, sizeof(mem_write_tab[0][0]), NULL, index);
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        rows[i] = (uint8_t *)mem_read_tab[i];
+    }
+    num_read = mem_tab_dedup(rows, NUM_CONFIGS, sizeof(mem_read_tab[0]), NULL, index);
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        rows[i] = (uint8_t *)mem_read_base_tab[i];
+    }
+    num_base = mem_tab_dedup(rows, NUM_CONFIGS, sizeof(mem_read_base_tab[0]), NULL, index);
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        rows[i] = (uint8_t *)mem_read_limit_tab[i];
+    }
+    num_limit = mem_tab_dedup(rows, NUM_CONFIGS, sizeof(mem_read_limit_tab[0]), NULL, index);
+
+    /* the rows are kept in one block, pointers first */
+    lib_free(mem_tab_pool);
+    mem_tab_pool = lib_malloc(num_write * sizeof(mem_write_tab[0][0])
+                              + num_read * sizeof(mem_read_tab[0])
+                              + num_base * sizeof(mem_read_base_tab[0])
+                              + num_limit * sizeof(mem_read_limit_tab[0]));
+    write_pool = mem_tab_pool;
+    read_pool = write_pool + num_write * sizeof(mem_write_tab[0][0]);
+    base_pool = read_pool + num_read * sizeof(mem_read_tab[0]);
+    limit_pool = base_pool + num_base * sizeof(mem_read_base_tab[0]);
+
+    for (k = 0; k < NUM_VBANKS; k++) {
+        for (i = 0; i < NUM_CONFIGS; i++) {
+            rows[k * NUM_CONFIGS + i] = (uint8_t *)mem_write_tab[k][i];
+        }
+    }
+    mem_tab_dedup(rows, NUM_VBANKS * NUM_CONFIGS, sizeof(mem_write_tab[0][0]), write_pool, index);
+    for (k = 0; k < NUM_VBANKS; k++) {
+        for (i = 0; i < NUM_CONFIGS; i++) {
+            mem_write_tab_row[k][i] = (store_func_ptr_t *)(write_pool + index[k * NUM_CONFIGS + i] * sizeof(mem_write_tab[0][0]));
+        }
+    }
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        rows[i] = (uint8_t *)mem_read_tab[i];
+    }
+    mem_tab_dedup(rows, NUM_CONFIGS, sizeof(mem_read_tab[0]), read_pool, index);
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        mem_read_tab_row[i] = (read_func_ptr_t *)(read_pool + index[i] * sizeof(mem_read_tab[0]));
+    }
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        rows[i] = (uint8_t *)mem_read_base_tab[i];
+    }
+    mem_tab_dedup(rows, NUM_CONFIGS, sizeof(mem_read_base_tab[0]), base_pool, index);
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        mem_read_base_tab_row[i] = (uint8_t **)(base_pool + index[i] * sizeof(mem_read_base_tab[0]));
+    }
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        rows[i] = (uint8_t *)mem_read_limit_tab[i];
+    }
+    mem_tab_dedup(rows, NUM_CONFIGS, sizeof(mem_read_limit_tab[0]), limit_pool, index);
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        mem_read_limit_tab_row[i] = (uint32_t *)(limit_pool + index[i] * sizeof(mem_read_limit_tab[0]));
+    }
+
+    lib_free(mem_write_tab);
+    lib_free(mem_read_tab);
+    lib_free(mem_read_base_tab);
+    lib_free(mem_read_limit_tab);
+    mem_write_tab = NULL;
+    mem_read_tab = NULL;
+    mem_read_base_tab = NULL;
+    mem_read_limit_tab = NULL;
+}
+
+/* These set up the tables, only while `mem_initialize_memory()' runs.  */
 void mem_set_write_hook(int config, int page, store_func_t *f)
 {
     int i;
@@ -723,6 +935,7 @@ void mem_initialize_memory(void)
     mem_color_ram_cpu = mem_color_ram;
     mem_color_ram_vicii = mem_color_ram;
 
+    mem_tab_alloc();
     mem_limit_init();
 
     /* setup watchpoint tables */
@@ -733,6 +946,12 @@ void mem_initialize_memory(void)
         mem_write_tab_watch[i] = store_watch;
     }
 
+    /* setup dirty page tracking table */
+    mem_write_tab_dirty[0] = zero_store_dirty;
+    for (i = 1; i <= 0x100; i++) {
+        mem_write_tab_dirty[i] = store_dirty;
+    }
+
     resources_get_int("BoardType", &board);
 
     /* first init everything to "nothing" */
@@ -818,10 +1037,10 @@ void mem_initialize_memory(void)
         mem_read_base_tab[i][0x100] = mem_read_base_tab[i][0];
     }
 
-    _mem_read_tab_ptr = mem_read_tab[7];
-    _mem_write_tab_ptr = mem_write_tab[vbank][7];
-    _mem_read_base_tab_ptr = mem_read_base_tab[7];
-    mem_read_limit_tab_ptr = mem_read_limit_tab[7];
+    _mem_read_tab_ptr = mem_read_tab_row[7];
+    _mem_write_tab_ptr = mem_write_tab_row[vbank][7];
+    _mem_read_base_tab_ptr = mem_read_base_tab_row[7];
+    mem_read_limit_tab_ptr = mem_read_limit_tab_row[7];
 
     vicii_set_chargen_addr_options(0x7000, 0x1000);
 
@@ -842,6 +1061,11 @@ void mem_initialize_memory(void)
     if (board == 1) {
         mem_limit_max_init();
     }
+
+    mem_tab_compact();
+    mem_update_tab_ptrs(watchpoints_active);
+    _mem_read_base_tab_ptr = mem_read_base_tab_row[mem_config];
+    mem_read_limit_tab_ptr = mem_read_limit_tab_row[mem_config];
 }
 
 void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit)
@@ -865,6 +1089,7 @@ void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit
 void mem_powerup(void)
 {
     ram_init(mem_ram, 0x10000);
+    mem_ram_dirty_mark_all();
     vicii_init_colorram(mem_color_ram);
 }
 
@@ -876,9 +1101,10 @@ void mem_set_vbank(int new_vbank)
 {
     vbank = new_vbank;
 
-    /* Do not override watchpoints on vbank switches.  */
-    if (_mem_write_tab_ptr != mem_write_tab_watch) {
-        _mem_write_tab_ptr = mem_write_tab[new_vbank][mem_config];
+    /* Do not override watchpoints or dirty tracking on vbank switches.  */
+    if (_mem_write_tab_ptr != mem_write_tab_watch
+        && _mem_write_tab_ptr != mem_write_tab_dirty) {
+        _mem_write_tab_ptr = mem_write_tab_row[new_vbank][mem_config];
     }
 
     vicii_set_vbank(new_vbank);
@@ -925,6 +1151,7 @@ void mem_set_basic_text(uint16_t start, uint16_t end)
     mem_ram[0x2c] = mem_ram[0xad] = start >> 8;
     mem_ram[0x2d] = mem_ram[0x2f] = mem_ram[0x31] = mem_ram[0xae] = end & 0xff;
     mem_ram[0x2e] = mem_ram[0x30] = mem_ram[0x32] = mem_ram[0xaf] = end >> 8;
+    mem_ram_dirty[0] = 1;
 }
 
 /* this function should always read from the screen currently used by the kernal
@@ -942,6 +1169,7 @@ void mem_inject(uint32_t addr, uint8_t value)
     /* printf("mem_inject addr: %04x  value: %02x\n", addr, value); */
     if (!memory_hacks_ram_inject(addr, value)) {
         mem_ram[addr & 0xffff] = value;
+        mem_ram_dirty[(addr & 0xffff) >> 8] = 1;
     }
 }
 
@@ -1322,6 +1550,7 @@ void mem_bank_write(int bank, uint16_t addr, uint8_t byte, void *context)
             break;
     }
     mem_ram[addr] = byte;
+    mem_ram_dirty[addr >> 8] = 1;
 }
 
 /* used by monitor if sfx off */
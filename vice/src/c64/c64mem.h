@@ -40,6 +40,9 @@
 #define C64_BASIC_ROM_SIZE   0x2000
 #define C64_CHARGEN_ROM_SIZE 0x1000
 
+/* Number of 256 byte pages in the C64 RAM.  */
+#define C64_RAM_PAGES        (C64_RAM_SIZE >> 8)
+
 int c64_mem_init_resources(void);
 int c64_mem_init_cmdline_options(void);
 
@@ -71,6 +74,23 @@ void mem_store_without_ultimax(uint16_t addr, uint8_t value);
 uint8_t mem_read_without_ultimax(uint16_t addr);
 void mem_store_without_romlh(uint16_t addr, uint8_t value);
 
+/* x64sc only: per page pointers the CPU may read directly instead of
+   calling the read function, NULL where the function must be called
+   (I/O, cartridges, watchpoints, $00/$01).  Index with the page of the
+   16-bit address.  */
+extern uint8_t **_mem_read_fast_tab_ptr;
+extern uint8_t **_mem_read_fast_tab_ptr_dummy;
+
+/* Dirty page tracking, one flag per 256 byte page of RAM.  Pages are flagged
+   by all stores going through the write tables, DMA, the monitor and
+   injection; code that writes `mem_ram' directly must flag the page itself
+   or call mem_ram_dirty_mark_all().  */
+void mem_ram_dirty_track(int enable);
+int mem_ram_dirty_tracking(void);
+const uint8_t *mem_ram_dirty_get(void);
+void mem_ram_dirty_clear(void);
+void mem_ram_dirty_mark_all(void);
+
 void store_bank_io(uint16_t addr, uint8_t byte);
 uint8_t read_bank_io(uint16_t addr);
 
@@ -99,6 +99,8 @@ read_func_ptr_t *_mem_read_tab_ptr_dummy;
 store_func_ptr_t *_mem_write_tab_ptr_dummy;
 static uint8_t **_mem_read_base_tab_ptr;
 static uint32_t *mem_read_limit_tab_ptr;
+uint8_t **_mem_read_fast_tab_ptr;
+uint8_t **_mem_read_fast_tab_ptr_dummy;
 
 /* Memory read and write tables.  */
 static store_func_ptr_t mem_write_tab[NUM_CONFIGS][0x101];
@@ -106,6 +108,12 @@ static read_func_ptr_t mem_read_tab[NUM_CONFIGS][0x101];
 static uint8_t *mem_read_base_tab[NUM_CONFIGS][0x101];
 static uint32_t mem_read_limit_tab[NUM_CONFIGS][0x101];
 
+/* Direct read pointers for the pages of each configuration that are plain
+   RAM or ROM, NULL for all others.  `mem_read_fast_tab_none' is used while
+   watchpoints are active.  */
+static uint8_t *mem_read_fast_tab[NUM_CONFIGS][0x101];
+static uint8_t *mem_read_fast_tab_none[0x101];
+
 static store_func_ptr_t mem_write_tab_watch[0x101];
 static read_func_ptr_t mem_read_tab_watch[0x101];
 
@@ -128,6 +136,13 @@ static int tape_motor_in = 0;
 */
 static int watchpoints_active = 0;
 
+/* Dirty page tracking of `mem_ram': while enabled the write table is
+   replaced by `mem_write_tab_dirty', which flags the page and passes the
+   store on to the real write table.  */
+static int dirty_tracking_active = 0;
+static uint8_t mem_ram_dirty[C64_RAM_PAGES];
+static store_func_ptr_t mem_write_tab_dirty[0x101];
+
 /* ------------------------------------------------------------------------- */
 
 static uint8_t zero_read_watch(uint16_t addr)
@@ -141,6 +156,9 @@ static void zero_store_watch(uint16_t addr, uint8_t value)
 {
     addr &= 0xff;
     monitor_watch_push_store_addr(addr, e_comp_space);
+    if (dirty_tracking_active) {
+        mem_ram_dirty[0] = 1;
+    }
     mem_write_tab[mem_config][0](addr, value);
 }
 
@@ -153,29 +171,53 @@ static uint8_t read_watch(uint16_t addr)
 static void store_watch(uint16_t addr, uint8_t value)
 {
     monitor_watch_push_store_addr(addr, e_comp_space);
+    if (dirty_tracking_active) {
+        mem_ram_dirty[addr >> 8] = 1;
+    }
     mem_write_tab[mem_config][addr >> 8](addr, value);
 }
 
-/* called by mem_pla_config_changed(), mem_toggle_watchpoints() */
+static void zero_store_dirty(uint16_t addr, uint8_t value)
+{
+    addr &= 0xff;
+    mem_ram_dirty[0] = 1;
+    mem_write_tab[mem_config][0](addr, value);
+}
+
+static void store_dirty(uint16_t addr, uint8_t value)
+{
+    mem_ram_dirty[addr >> 8] = 1;
+    mem_write_tab[mem_config][addr >> 8](addr, value);
+}
+
+/* called by mem_pla_config_changed(), mem_toggle_watchpoints(),
+   mem_ram_dirty_track() */
 static void mem_update_tab_ptrs(int flag)
 {
+    store_func_ptr_t *write_tab = dirty_tracking_active ? mem_write_tab_dirty : mem_write_tab[mem_config];
+
     if (flag) {
         _mem_read_tab_ptr = mem_read_tab_watch;
         _mem_write_tab_ptr = mem_write_tab_watch;
+        _mem_read_fast_tab_ptr = mem_read_fast_tab_none;
         if (flag > 1) {
             /* enable watchpoints on dummy accesses */
             _mem_read_tab_ptr_dummy = mem_read_tab_watch;
             _mem_write_tab_ptr_dummy = mem_write_tab_watch;
+            _mem_read_fast_tab_ptr_dummy = mem_read_fast_tab_none;
         } else {
             _mem_read_tab_ptr_dummy = mem_read_tab[mem_config];
-            _mem_write_tab_ptr_dummy = mem_write_tab[mem_config];
+            _mem_write_tab_ptr_dummy = write_tab;
+            _mem_read_fast_tab_ptr_dummy = mem_read_fast_tab[mem_config];
         }
     } else {
         /* all watchpoints disabled */
         _mem_read_tab_ptr = mem_read_tab[mem_config];
-        _mem_write_tab_ptr = mem_write_tab[mem_config];
+        _mem_write_tab_ptr = write_tab;
         _mem_read_tab_ptr_dummy = mem_read_tab[mem_config];
-        _mem_write_tab_ptr_dummy = mem_write_tab[mem_config];
+        _mem_write_tab_ptr_dummy = write_tab;
+        _mem_read_fast_tab_ptr = mem_read_fast_tab[mem_config];
+        _mem_read_fast_tab_ptr_dummy = mem_read_fast_tab[mem_config];
     }
 }
 
@@ -187,6 +229,35 @@ void mem_toggle_watchpoints(int flag, void *context)
 
 /* ------------------------------------------------------------------------- */
 
+void mem_ram_dirty_track(int enable)
+{
+    dirty_tracking_active = enable ? 1 : 0;
+    mem_ram_dirty_mark_all();
+    mem_update_tab_ptrs(watchpoints_active);
+}
+
+int mem_ram_dirty_tracking(void)
+{
+    return dirty_tracking_active;
+}
+
+const uint8_t *mem_ram_dirty_get(void)
+{
+    return mem_ram_dirty;
+}
+
+void mem_ram_dirty_clear(void)
+{
+    memset(mem_ram_dirty, 0, sizeof(mem_ram_dirty));
+}
+
+void mem_ram_dirty_mark_all(void)
+{
+    memset(mem_ram_dirty, 1, sizeof(mem_ram_dirty));
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* $00/$01 unused bits emulation
 
    - There are 2 different unused bits, 1) the output bits, 2) the input bits
@@ -468,6 +539,12 @@ uint8_t mem_dma_read(uint16_t addr)
     return _mem_read_tab_ptr[addr >> 8](addr);
 }
 
+/* DMA here runs cycle by cycle along with the VIC-II, no block copies.  */
+uint8_t *mem_dma_ram_page(uint16_t addr)
+{
+    return NULL;
+}
+
 
 /* ------------------------------------------------------------------------- */
 
@@ -670,6 +747,37 @@ void mem_read_limit_set(unsigned int base, unsigned int index, uint32_t limit)
     mem_read_limit_tab[base][index] = limit;
 }
 
+/* Find the pages whose read function only returns a byte of RAM or ROM.
+   Must be called once all read functions are in place.  */
+static void mem_read_fast_tab_init(void)
+{
+    int i, j;
+
+    for (i = 0; i < NUM_CONFIGS; i++) {
+        for (j = 0; j <= 0xff; j++) {
+            read_func_ptr_t f = mem_read_tab[i][j];
+            uint8_t *p = NULL;
+
+            if (f == ram_read) {
+                p = mem_ram;
+            } else if (j == 0 && f == zero_read
+                       && !c64_256k_enabled && !plus256k_enabled) {
+                /* $00/$01 are excluded by the CPU */
+                p = mem_ram;
+            } else if (j >= 0xa0 && j <= 0xbf && f == c64memrom_basic64_read) {
+                p = c64memrom_basic64_rom - 0xa000;
+            } else if (j >= 0xd0 && j <= 0xdf && f == chargen_read) {
+                p = mem_chargen_rom - 0xd000;
+            } else if (j >= 0xe0 && f == c64memrom_kernal64_read) {
+                /* not the trap ROM the opcode fetches see */
+                p = c64memrom_kernal64_rom - 0xe000;
+            }
+            mem_read_fast_tab[i][j] = p;
+        }
+        mem_read_fast_tab[i][0x100] = mem_read_fast_tab[i][0];
+    }
+}
+
 void mem_initialize_memory(void)
 {
     int i, j;
@@ -689,6 +797,12 @@ void mem_initialize_memory(void)
         mem_write_tab_watch[i] = store_watch;
     }
 
+    /* setup dirty page tracking table */
+    mem_write_tab_dirty[0] = zero_store_dirty;
+    for (i = 1; i <= 0x100; i++) {
+        mem_write_tab_dirty[i] = store_dirty;
+    }
+
     resources_get_int("BoardType", &board);
 
     /* first init everything to "nothing" */
@@ -776,6 +890,8 @@ void mem_initialize_memory(void)
     if (board == 1) {
         mem_limit_max_init();
     }
+
+    mem_read_fast_tab_init();
 }
 
 void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit)
@@ -799,6 +915,7 @@ void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit
 void mem_powerup(void)
 {
     ram_init(mem_ram, 0x10000);
+    mem_ram_dirty_mark_all();
 }
 
 /* ------------------------------------------------------------------------- */
@@ -852,6 +969,7 @@ void mem_set_basic_text(uint16_t start, uint16_t end)
     mem_ram[0x2c] = mem_ram[0xad] = start >> 8;
     mem_ram[0x2d] = mem_ram[0x2f] = mem_ram[0x31] = mem_ram[0xae] = end & 0xff;
     mem_ram[0x2e] = mem_ram[0x30] = mem_ram[0x32] = mem_ram[0xaf] = end >> 8;
+    mem_ram_dirty[0] = 1;
 }
 
 /* this function should always read from the screen currently used by the kernal
@@ -869,6 +987,7 @@ void mem_inject(uint32_t addr, uint8_t value)
     /* printf("mem_inject addr: %04x  value: %02x\n", addr, value); */
     if (!memory_hacks_ram_inject(addr, value)) {
         mem_ram[addr & 0xffff] = value;
+        mem_ram_dirty[(addr & 0xffff) >> 8] = 1;
     }
 }
 
@@ -1243,6 +1362,101 @@ uint8_t mem_bank_peek(int bank, uint16_t addr, void *context)
     return mem_ram[addr];
 }
 
+/* Plain memory behind `addr' in `bank' for the monitor, see
+   monitor_interface_t.  In the CPU bank the pages of RAM and the BASIC and
+   KERNAL ROMs qualify, the character ROM is left to mem_peek_with_config()
+   which does not see it at $dfff.  */
+uint8_t *mem_bank_base(int bank, uint16_t addr, unsigned int *len, void *context)
+{
+    uint8_t **tab = mem_read_fast_tab[mem_config];
+    uint8_t *base;
+    unsigned int page, end;
+
+    switch (bank) {
+        case 0: /* CPU */
+            /* the CPU port is no memory */
+            if (addr < 2) {
+                return NULL;
+            }
+            page = addr >> 8;
+            base = tab[page];
+            if (base == NULL || base == mem_chargen_rom - 0xd000) {
+                return NULL;
+            }
+            for (end = page + 1; end <= 0xff && tab[end] == base; end++) {
+            }
+            *len = (end << 8) - addr;
+            return base + addr;
+        case 2: /* rom */
+            if (addr >= 0xa000 && addr <= 0xbfff) {
+                *len = 0xc000 - addr;
+                return c64memrom_basic64_rom + (addr & 0x1fff);
+            }
+            if (addr >= 0xd000 && addr <= 0xdfff) {
+                *len = 0xe000 - addr;
+                return mem_chargen_rom + (addr & 0x0fff);
+            }
+            if (addr >= 0xe000) {
+                *len = 0x10000 - addr;
+                return c64memrom_kernal64_rom + (addr & 0x1fff);
+            }
+            *len = (addr < 0xa000 ? 0xa000 : 0xd000) - addr;
+            return mem_ram + addr;
+        case 1: /* ram */
+            *len = 0x10000 - addr;
+            return mem_ram + addr;
+    }
+    return NULL;
+}
+
+/* RAM that mem_bank_poke() would write `addr' in `bank' to, see
+   monitor_interface_t.  In the CPU bank the pages whose stores go straight
+   to RAM qualify while no watchpoints are set.  */
+uint8_t *mem_bank_write_base(int bank, uint16_t addr, unsigned int *len, void *context)
+{
+    store_func_ptr_t *tab = mem_write_tab[mem_config];
+    unsigned int page, end, max;
+
+    switch (bank) {
+        case 0: /* CPU */
+            if (addr < 2 || watchpoints_active) {
+                return NULL;
+            }
+            for (end = addr >> 8; end <= 0xff; end++) {
+                if (tab[end] != ram_store && tab[end] != ram_hi_store) {
+                    break;
+                }
+            }
+            max = (end << 8) - addr;
+            break;
+        case 2: /* rom */
+        case 3: /* io */
+            if (addr >= 0xa000 && addr <= 0xbfff) {
+                return NULL;
+            }
+            if (addr >= 0xd000) {
+                return NULL;
+            }
+            max = (addr < 0xa000 ? 0xa000 : 0xd000) - addr;
+            break;
+        case 1: /* ram */
+            max = 0x10000 - addr;
+            break;
+        default:
+            return NULL;
+    }
+    if (max == 0 || *len == 0) {
+        return NULL;
+    }
+    if (*len > max) {
+        *len = max;
+    }
+    for (page = addr >> 8; page <= ((addr + *len - 1) >> 8); page++) {
+        mem_ram_dirty[page] = 1;
+    }
+    return mem_ram + addr;
+}
+
 void mem_bank_write(int bank, uint16_t addr, uint8_t byte, void *context)
 {
     switch (bank) {
@@ -1270,6 +1484,7 @@ void mem_bank_write(int bank, uint16_t addr, uint8_t byte, void *context)
             break;
     }
     mem_ram[addr] = byte;
+    mem_ram_dirty[addr >> 8] = 1;
 }
 
 /* used by monitor if sfx off */
@@ -227,6 +227,29 @@ void parallel_cable_cpu_execute(int type)
     }
 }
 
+/* same for a read of the cable or its handshake flag, which does not need
+   the drives that cannot change the cable before now, see
+   drive_cpu_execute_one_read().  While a drive waits for the computer in a
+   loop, polling the flag or the cable doesn't run it every time.
+ */
+void parallel_cable_cpu_execute_read(int type)
+{
+    unsigned int dnr;
+    int port;
+
+    port = portmap[type];
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (unit->enable && unit->parallel_cable) {
+            if (portmap[unit->parallel_cable] == port) {
+                drive_cpu_execute_one_read(unit, maincpu_clk);
+            }
+        }
+    }
+}
+
 void parallel_cable_cpu_write(int type, uint8_t data)
 {
     int port;
@@ -243,7 +266,7 @@ uint8_t parallel_cable_cpu_read(int type, uint8_t data)
 {
     uint8_t rc;
 
-    parallel_cable_cpu_execute(type);
+    parallel_cable_cpu_execute_read(type);
 
     rc = parallel_cable_value(type);
 
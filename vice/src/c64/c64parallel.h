@@ -30,6 +30,7 @@
 #include "types.h"
 
 void parallel_cable_cpu_execute(int type);
+void parallel_cable_cpu_execute_read(int type);
 void parallel_cable_cpu_write(int type, uint8_t data);
 void parallel_cable_cpu_pulse(int type);
 uint8_t parallel_cable_cpu_read(int type, uint8_t data);
@@ -699,7 +699,8 @@ int cartridge_type_enabled(int type)
     FIXME: to simplify this function a little bit, all subfunctions should
            also return the respective CRT ID on success
 */
-static int crt_attach(const char *filename, uint8_t *rawcart)
+static int crt_attach(const char *filename, const uint8_t *data, size_t size,
+                      uint8_t *rawcart)
 {
     crt_header_t header;
     int rc = -1, new_crttype;
@@ -707,7 +708,11 @@ static int crt_attach(const char *filename, uint8_t *rawcart)
 
     DBG(("crt_attach: %s\n", filename));
 
-    fd = crt_open(filename, &header);
+    if (data != NULL) {
+        fd = crt_open_memory(data, size, &header);
+    } else {
+        fd = crt_open(filename, &header);
+    }
     if (fd == NULL) {
         return -1;
     }
@@ -1017,14 +1022,15 @@ static int crt_attach(const char *filename, uint8_t *rawcart)
 }
 
 /*
-    attach cartridge image
+    attach cartridge image, from data if not NULL
 
     type == -1  NONE
     type ==  0  CRT format
 
     returns -1 on error, 0 on success
 */
-int cartridge_attach_image(int type, const char *filename)
+static int cart_attach_image(int type, const char *filename,
+                             const uint8_t *data, size_t size)
 {
     uint8_t *rawcart;
     char *abs_filename;
@@ -1049,7 +1055,11 @@ int cartridge_attach_image(int type, const char *filename)
     }
 
     if (type == CARTRIDGE_CRT) {
-        carttype = crt_getid(abs_filename);
+        if (data != NULL) {
+            carttype = crt_getid_memory(data, size);
+        } else {
+            carttype = crt_getid(abs_filename);
+        }
         if (carttype == -1) {
             log_message(LOG_DEFAULT, "CART: '%s' is not a valid CRT file.", abs_filename);
             lib_free(abs_filename);
@@ -1087,7 +1097,7 @@ int cartridge_attach_image(int type, const char *filename)
 
     if (type == CARTRIDGE_CRT) {
         DBG(("CART: attach CRT ID: %d '%s'\n", carttype, filename));
-        cartid = crt_attach(abs_filename, rawcart);
+        cartid = crt_attach(abs_filename, data, size, rawcart);
         if (cartid == CARTRIDGE_NONE) {
             goto exiterror;
         }
@@ -1149,6 +1159,29 @@ exiterror:
     return -1;
 }
 
+int cartridge_attach_image(int type, const char *filename)
+{
+    return cart_attach_image(type, filename, NULL, 0);
+}
+
+/*
+    attach a CRT image that is already in memory, for example mapped or
+    uncompressed by a frontend. the chip packets are read from data in
+    place, without going through a (temporary) file. filename is the file
+    the image came from, it is used for messages and by cartridges that
+    write their flash or RAM back to the image.
+
+    returns -1 on error, 0 on success
+*/
+int cartridge_attach_image_from_memory(const uint8_t *data, size_t size,
+                                       const char *filename)
+{
+    if (data == NULL || filename == NULL || *filename == '\0') {
+        return -1;
+    }
+    return cart_attach_image(CARTRIDGE_CRT, filename, data, size);
+}
+
 void cart_power_off(void)
 {
     if (c64cartridge_reset) {
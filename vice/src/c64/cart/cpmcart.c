@@ -33,6 +33,7 @@
 
 #include "6510core.h"
 #include "alarm.h"
+#include "batch.h"
 #include "c64cia.h"
 #include "c64mem.h"
 #include "cartio.h"
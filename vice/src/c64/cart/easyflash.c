@@ -44,6 +44,7 @@
 #include "flash040.h"
 #include "lib.h"
 #include "log.h"
+#include "machine.h"
 #include "maincpu.h"
 #include "mem.h"
 #include "monitor.h"
@@ -69,6 +70,15 @@ static int easyflash_crt_write;
 /* optimizing crt enabled */
 static int easyflash_crt_optimize;
 
+/* seconds after the first change the image is written, 0 only on detach */
+static int easyflash_flush_delay;
+
+/* Where the ROML (0) and ROMH (1) data of the banks is in the attached
+   file, -1 if the file has none, and the size of the file.  Changed banks
+   are written into the file in place if it still has that size.  */
+static long easyflash_chip_offset[EASYFLASH_N_BANKS][2];
+static long easyflash_file_size = -1;
+
 /* backup of the registers */
 static uint8_t easyflash_register_00, easyflash_register_02;
 
@@ -321,6 +331,33 @@ static int set_easyflash_crt_optimize(int val, void *param)
     return 0;
 }
 
+static void easyflash_flush_alarm(flash040_context_t *flash040_context)
+{
+    if (easyflash_crt_write) {
+        easyflash_flush_image();
+    }
+}
+
+static void easyflash_set_flush(void)
+{
+    CLOCK delay = (CLOCK)easyflash_flush_delay * (CLOCK)machine_get_cycles_per_second();
+
+    if (easyflash_state_low != NULL) {
+        flash040core_set_flush(easyflash_state_low, easyflash_flush_alarm, delay);
+        flash040core_set_flush(easyflash_state_high, easyflash_flush_alarm, delay);
+    }
+}
+
+static int set_easyflash_flush_delay(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+    easyflash_flush_delay = val;
+    easyflash_set_flush();
+    return 0;
+}
+
 static int easyflash_write_chip_if_not_empty(FILE* fd, crt_chip_header_t *chip, uint8_t *data)
 {
     int i;
@@ -345,6 +382,8 @@ static const resource_int_t resources_int[] = {
       &easyflash_crt_write, set_easyflash_crt_write, NULL },
     { "EasyFlashOptimizeCRT", 1, RES_EVENT_STRICT, (resource_value_t)1,
       &easyflash_crt_optimize, set_easyflash_crt_optimize, NULL },
+    { "EasyFlashFlushDelay", 0, RES_EVENT_NO, NULL,
+      &easyflash_flush_delay, set_easyflash_flush_delay, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -379,6 +418,9 @@ static const cmdline_option_t cmdline_options[] =
     { "+easyflashcrtoptimize", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "EasyFlashOptimizeCRT", (resource_value_t)0,
       NULL, "Disable writing to EasyFlash .crt image" },
+    { "-easyflashflushdelay", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "EasyFlashFlushDelay", NULL,
+      "<seconds>", "Write the changed banks to the EasyFlash image <seconds> after the first change (0: only on detach)" },
     CMDLINE_LIST_END
 };
 
@@ -489,6 +531,7 @@ void easyflash_config_setup(uint8_t *rawcart)
 
     flash040core_init(easyflash_state_low, maincpu_alarm_context, FLASH040_TYPE_B, roml_banks);
     flash040core_init(easyflash_state_high, maincpu_alarm_context, FLASH040_TYPE_B, romh_banks);
+    easyflash_set_flush();
 
     for (i = 0; i < EASYFLASH_N_BANKS; i++) { /* split interleaved low and high banks */
         memcpy(easyflash_state_low->flash_data + i * 0x2000, rawcart + i * 0x4000, 0x2000);
@@ -514,6 +557,127 @@ void easyflash_config_setup(uint8_t *rawcart)
 
 /* ---------------------------------------------------------------------*/
 
+static void easyflash_clear_offsets(void)
+{
+    int bank;
+
+    for (bank = 0; bank < EASYFLASH_N_BANKS; bank++) {
+        easyflash_chip_offset[bank][0] = -1;
+        easyflash_chip_offset[bank][1] = -1;
+    }
+    easyflash_file_size = -1;
+}
+
+/* Remember where the data of a chip read from the file at `pos' is.  */
+static void easyflash_add_offset(const crt_chip_header_t *chip, long pos)
+{
+    if (chip->bank >= EASYFLASH_N_BANKS || pos < 0) {
+        return;
+    }
+    if (chip->size == 0x4000) {
+        easyflash_chip_offset[chip->bank][0] = pos;
+        easyflash_chip_offset[chip->bank][1] = pos + 0x2000;
+    } else if (chip->size == 0x2000) {
+        easyflash_chip_offset[chip->bank][(chip->start & 0x2000) ? 1 : 0] = pos;
+    }
+}
+
+static void easyflash_bin_offsets(const char *filename)
+{
+    FILE *fd;
+    int bank;
+
+    easyflash_clear_offsets();
+
+    fd = fopen(filename, MODE_READ);
+    if (fd == NULL) {
+        return;
+    }
+    /* not with a load address in front */
+    if (archdep_file_size(fd) == 0x4000 * EASYFLASH_N_BANKS) {
+        for (bank = 0; bank < EASYFLASH_N_BANKS; bank++) {
+            easyflash_chip_offset[bank][0] = bank * 0x4000;
+            easyflash_chip_offset[bank][1] = bank * 0x4000 + 0x2000;
+        }
+        easyflash_file_size = 0x4000 * EASYFLASH_N_BANKS;
+    }
+    fclose(fd);
+}
+
+static void easyflash_crt_offsets(const char *filename)
+{
+    FILE *fd;
+    crt_header_t header;
+    crt_chip_header_t chip;
+
+    easyflash_clear_offsets();
+
+    fd = crt_open(filename, &header);
+    if (fd == NULL) {
+        return;
+    }
+    while (crt_read_chip_header(&chip, fd) == 0) {
+        easyflash_add_offset(&chip, ftell(fd));
+        if (fseek(fd, (long)(chip.size + chip.skip), SEEK_CUR) != 0) {
+            break;
+        }
+    }
+    easyflash_file_size = (long)archdep_file_size(fd);
+    fclose(fd);
+}
+
+/* Write the banks in the sectors changed into the file in place.  Returns
+   -1 if the file does not have them all, then it has to be written in
+   full.  */
+static int easyflash_update_image(void)
+{
+    flash040_context_t *state[2];
+    FILE *fd;
+    int bank, half, err = 0;
+
+    state[0] = easyflash_state_low;
+    state[1] = easyflash_state_high;
+
+    if (!state[0]->flash_dirty && !state[1]->flash_dirty) {
+        return 0;
+    }
+    if (easyflash_file_size < 0) {
+        return -1;
+    }
+    for (bank = 0; bank < EASYFLASH_N_BANKS; bank++) {
+        for (half = 0; half < 2; half++) {
+            if (easyflash_chip_offset[bank][half] < 0
+                && flash040core_is_dirty(state[half], bank * 0x2000, 0x2000)) {
+                return -1;
+            }
+        }
+    }
+
+    fd = fopen(easyflash_filename, MODE_READ_WRITE);
+    if (fd == NULL) {
+        return -1;
+    }
+    if (archdep_file_size(fd) != easyflash_file_size) {
+        fclose(fd);
+        return -1;
+    }
+    for (bank = 0; bank < EASYFLASH_N_BANKS && !err; bank++) {
+        for (half = 0; half < 2 && !err; half++) {
+            if (flash040core_is_dirty(state[half], bank * 0x2000, 0x2000)) {
+                err = util_fpwrite(fd, state[half]->flash_data + bank * 0x2000, 0x2000,
+                                   easyflash_chip_offset[bank][half]);
+            }
+        }
+    }
+    if (fclose(fd) != 0 || err) {
+        return -1;
+    }
+
+    flash040core_clear_dirty(state[0]);
+    flash040core_clear_dirty(state[1]);
+    return 0;
+}
+
 static int easyflash_common_attach(const char *filename)
 {
     if (export_add(&export_res) < 0) {
@@ -537,6 +701,7 @@ int easyflash_bin_attach(const char *filename, uint8_t *rawcart)
     }
 
     easyflash_filetype = CARTRIDGE_FILETYPE_BIN;
+    easyflash_bin_offsets(filename);
     return easyflash_common_attach(filename);
 }
 
@@ -546,11 +711,13 @@ int easyflash_crt_attach(FILE *fd, uint8_t *rawcart, const char *filename)
 
     easyflash_filetype = 0;
     memset(rawcart, 0xff, 0x100000); /* empty flash */
+    easyflash_clear_offsets();
 
     while (1) {
         if (crt_read_chip_header(&chip, fd)) {
             break;
         }
+        easyflash_add_offset(&chip, ftell(fd));
 
         if (chip.size == 0x2000) {
             if (chip.bank >= EASYFLASH_N_BANKS || !(chip.start == 0x8000 || chip.start == 0xa000 || chip.start == 0xe000)) {
@@ -571,6 +738,7 @@ int easyflash_crt_attach(FILE *fd, uint8_t *rawcart, const char *filename)
         }
     }
 
+    easyflash_file_size = (long)archdep_file_size(fd);
     easyflash_filetype = CARTRIDGE_FILETYPE_CRT;
     return easyflash_common_attach(filename);
 }
@@ -596,12 +764,25 @@ void easyflash_detach(void)
 int easyflash_flush_image(void)
 {
     if (easyflash_filename != NULL) {
+        if (easyflash_update_image() == 0) {
+            return 0;
+        }
         if (easyflash_filetype == CARTRIDGE_FILETYPE_BIN) {
-            return easyflash_bin_save(easyflash_filename);
+            if (easyflash_bin_save(easyflash_filename) < 0) {
+                return -1;
+            }
+            easyflash_bin_offsets(easyflash_filename);
         } else if (easyflash_filetype == CARTRIDGE_FILETYPE_CRT) {
-            return easyflash_crt_save(easyflash_filename);
+            if (easyflash_crt_save(easyflash_filename) < 0) {
+                return -1;
+            }
+            easyflash_crt_offsets(easyflash_filename);
+        } else {
+            return -1;
         }
-        return -1;
+        flash040core_clear_dirty(easyflash_state_low);
+        flash040core_clear_dirty(easyflash_state_high);
+        return 0;
     }
     return -2;
 }
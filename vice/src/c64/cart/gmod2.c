@@ -42,6 +42,7 @@
 #include "export.h"
 #include "flash040.h"
 #include "lib.h"
+#include "machine.h"
 #include "maincpu.h"
 #include "monitor.h"
 #include "resources.h"
@@ -96,6 +97,15 @@ static flash040_context_t *flashrom_state = NULL;
 static char *gmod2_filename = NULL;
 static int gmod2_filetype = 0;
 
+/* seconds after the first change the flash is written, 0 only on detach */
+static int gmod2_flash_flush_delay = 0;
+
+/* Where the data of the banks is in the attached file, -1 if the file has
+   none, and the size of the file.  Changed banks are written into the file
+   in place if it still has that size.  */
+static long gmod2_chip_offset[64];
+static long gmod2_file_size = -1;
+
 static char *gmod2_eeprom_filename = NULL;
 static int gmod2_eeprom_rw = 0;
 
@@ -265,6 +275,117 @@ void gmod2_reset(void)
     flash040core_reset(flashrom_state);
 }
 
+static void gmod2_flush_alarm(flash040_context_t *flash040_context)
+{
+    if (gmod2_flash_write) {
+        gmod2_flush_image();
+    }
+}
+
+static void gmod2_set_flush(void)
+{
+    if (flashrom_state != NULL) {
+        flash040core_set_flush(flashrom_state, gmod2_flush_alarm,
+                               (CLOCK)gmod2_flash_flush_delay * (CLOCK)machine_get_cycles_per_second());
+    }
+}
+
+static void gmod2_clear_offsets(void)
+{
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        gmod2_chip_offset[i] = -1;
+    }
+    gmod2_file_size = -1;
+}
+
+static void gmod2_bin_offsets(const char *filename)
+{
+    FILE *fd;
+    int i;
+
+    gmod2_clear_offsets();
+
+    fd = fopen(filename, MODE_READ);
+    if (fd == NULL) {
+        return;
+    }
+    /* not with a load address in front */
+    if (archdep_file_size(fd) == GMOD2_FLASH_SIZE) {
+        for (i = 0; i < 64; i++) {
+            gmod2_chip_offset[i] = i * 0x2000;
+        }
+        gmod2_file_size = GMOD2_FLASH_SIZE;
+    }
+    fclose(fd);
+}
+
+static void gmod2_crt_offsets(const char *filename)
+{
+    FILE *fd;
+    crt_header_t header;
+    crt_chip_header_t chip;
+
+    gmod2_clear_offsets();
+
+    fd = crt_open(filename, &header);
+    if (fd == NULL) {
+        return;
+    }
+    while (crt_read_chip_header(&chip, fd) == 0) {
+        if (chip.bank < 64 && chip.size == 0x2000) {
+            gmod2_chip_offset[chip.bank] = ftell(fd);
+        }
+        if (fseek(fd, (long)(chip.size + chip.skip), SEEK_CUR) != 0) {
+            break;
+        }
+    }
+    gmod2_file_size = (long)archdep_file_size(fd);
+    fclose(fd);
+}
+
+/* Write the banks in the sectors changed into the file in place.  Returns
+   -1 if the file does not have them all, then it has to be written in
+   full.  */
+static int gmod2_update_image(void)
+{
+    FILE *fd;
+    int i, err = 0;
+
+    if (!flashrom_state->flash_dirty) {
+        return 0;
+    }
+    if (gmod2_file_size < 0) {
+        return -1;
+    }
+    for (i = 0; i < 64; i++) {
+        if (gmod2_chip_offset[i] < 0 && flash040core_is_dirty(flashrom_state, i * 0x2000, 0x2000)) {
+            return -1;
+        }
+    }
+
+    fd = fopen(gmod2_filename, MODE_READ_WRITE);
+    if (fd == NULL) {
+        return -1;
+    }
+    if (archdep_file_size(fd) != gmod2_file_size) {
+        fclose(fd);
+        return -1;
+    }
+    for (i = 0; i < 64 && !err; i++) {
+        if (flash040core_is_dirty(flashrom_state, i * 0x2000, 0x2000)) {
+            err = util_fpwrite(fd, flashrom_state->flash_data + i * 0x2000, 0x2000, gmod2_chip_offset[i]);
+        }
+    }
+    if (fclose(fd) != 0 || err) {
+        return -1;
+    }
+
+    flash040core_clear_dirty(flashrom_state);
+    return 0;
+}
+
 void gmod2_config_setup(uint8_t *rawcart)
 {
     gmod2_cmode = CMODE_8KGAME;
@@ -272,6 +393,7 @@ void gmod2_config_setup(uint8_t *rawcart)
 
     flashrom_state = lib_malloc(sizeof(flash040_context_t));
     flash040core_init(flashrom_state, maincpu_alarm_context, FLASH040_TYPE_NORMAL, roml_banks);
+    gmod2_set_flush();
     memcpy(flashrom_state->flash_data, rawcart, GMOD2_FLASH_SIZE);
 }
 
@@ -312,6 +434,17 @@ static int set_gmod2_flash_write(int val, void *param)
     return 0;
 }
 
+static int set_gmod2_flash_flush_delay(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+    gmod2_flash_flush_delay = val;
+    gmod2_set_flush();
+
+    return 0;
+}
+
 static const resource_string_t resources_string[] = {
     { "GMod2EEPROMImage", "", RES_EVENT_NO, NULL,
       &gmod2_eeprom_filename, set_gmod2_eeprom_filename, NULL },
@@ -323,6 +456,8 @@ static const resource_int_t resources_int[] = {
       &gmod2_flash_write, set_gmod2_flash_write, NULL },
     { "GMod2EEPROMRW", 1, RES_EVENT_NO, NULL,
       &gmod2_eeprom_rw, set_gmod2_eeprom_rw, NULL },
+    { "GMod2FlashFlushDelay", 0, RES_EVENT_NO, NULL,
+      &gmod2_flash_flush_delay, set_gmod2_flash_flush_delay, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -358,6 +493,9 @@ static const cmdline_option_t cmdline_options[] =
     { "+gmod2flashwrite", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "GMod2FlashWrite", (resource_value_t)0,
       NULL, "Disable saving of the GMod2 ROM at exit" },
+    { "-gmod2flashflushdelay", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "GMod2FlashFlushDelay", NULL,
+      "<seconds>", "Write the changed banks to the GMod2 image <seconds> after the first change (0: only on detach)" },
     CMDLINE_LIST_END
 };
 
@@ -391,6 +529,7 @@ int gmod2_bin_attach(const char *filename, uint8_t *rawcart)
 
     gmod2_filetype = CARTRIDGE_FILETYPE_BIN;
     gmod2_filename = lib_strdup(filename);
+    gmod2_bin_offsets(filename);
     return gmod2_common_attach();
 }
 
@@ -403,6 +542,7 @@ int gmod2_crt_attach(FILE *fd, uint8_t *rawcart, const char *filename)
 
     gmod2_filetype = 0;
     gmod2_filename = NULL;
+    gmod2_clear_offsets();
 
     for (i = 0; i <= 63; i++) {
         if (crt_read_chip_header(&chip, fd)) {
@@ -413,11 +553,13 @@ int gmod2_crt_attach(FILE *fd, uint8_t *rawcart, const char *filename)
             return -1;
         }
 
+        gmod2_chip_offset[chip.bank] = ftell(fd);
         if (crt_read_chip(rawcart, chip.bank << 13, &chip, fd)) {
             return -1;
         }
     }
 
+    gmod2_file_size = (long)archdep_file_size(fd);
     gmod2_filetype = CARTRIDGE_FILETYPE_CRT;
     gmod2_filename = lib_strdup(filename);
 
@@ -483,12 +625,24 @@ int gmod2_crt_save(const char *filename)
 
 int gmod2_flush_image(void)
 {
+    if (gmod2_filename != NULL && gmod2_update_image() == 0) {
+        return 0;
+    }
     if (gmod2_filetype == CARTRIDGE_FILETYPE_BIN) {
-        return gmod2_bin_save(gmod2_filename);
+        if (gmod2_bin_save(gmod2_filename) < 0) {
+            return -1;
+        }
+        gmod2_bin_offsets(gmod2_filename);
     } else if (gmod2_filetype == CARTRIDGE_FILETYPE_CRT) {
-        return gmod2_crt_save(gmod2_filename);
+        if (gmod2_crt_save(gmod2_filename) < 0) {
+            return -1;
+        }
+        gmod2_crt_offsets(gmod2_filename);
+    } else {
+        return -1;
     }
-    return -1;
+    flash040core_clear_dirty(flashrom_state);
+    return 0;
 }
 
 int gmod2_can_save_eeprom(void)
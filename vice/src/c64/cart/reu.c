@@ -1151,6 +1151,90 @@ inline static uint8_t read_from_reu(unsigned int reu_addr)
     return value;
 }
 
+/*! \brief find a block of the transfer that can be done in one go
+
+  On x64 and x128 nothing watches the DMA between two alarms, so a block
+  of plain host RAM can be transferred with a single copy, as long as no
+  alarm would fire before its last byte.  On x64sc and xscpu64 the VIC-II
+  is stepped with every byte and the per-byte path is always used.
+
+  \param host_addr
+    The host (computer) address of the next byte
+
+  \param reu_addr
+    The REU address of the next byte
+
+  \param host_step
+    The increment to use for the host address
+
+  \param reu_step
+    The increment to use for the REU address
+
+  \param len
+    The remaining transfer length
+
+  \param cycles
+    The number of cycles the transfer of one byte takes
+
+  \param host
+    Set to the host RAM of the block
+
+  \param reu
+    Set to the REU RAM of the block
+
+  \return
+    The length of the block, or 0 if the next byte has to go through
+    the per-byte path.
+*/
+static int reu_dma_block(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step,
+                         int len, int cycles, uint8_t **host, uint8_t **reu)
+{
+    CLOCK next_alarm;
+    unsigned int low, dram_addr;
+    uint8_t *page;
+    int n = len;
+
+    if (reu_ba.enabled || host_step != 1 || reu_step != 1) {
+        return 0;
+    }
+
+    /* byte n is done at maincpu_clk + n * cycles */
+    next_alarm = alarm_context_next_pending_clk(maincpu_alarm_context);
+    if (next_alarm <= maincpu_clk + cycles) {
+        return 0;
+    }
+    if ((next_alarm - maincpu_clk - 1) / cycles < (CLOCK)n) {
+        n = (int)((next_alarm - maincpu_clk - 1) / cycles);
+    }
+
+    page = mem_dma_ram_page(host_addr);
+    if (page == NULL) {
+        return 0;
+    }
+    if (n > 0x100 - (host_addr & 0xff)) {
+        n = 0x100 - (host_addr & 0xff);
+    }
+
+    low = reu_addr & 0x0007ffff;
+    dram_addr = reu_addr & (rec_options.dram_wrap_around - 1);
+    if (low >= rec_options.wrap_around || dram_addr >= rec_options.not_backedup_addresses) {
+        return 0;
+    }
+    if ((unsigned int)n > rec_options.wrap_around - low) {
+        n = (int)(rec_options.wrap_around - low);
+    }
+    if ((unsigned int)n > rec_options.not_backedup_addresses - dram_addr) {
+        n = (int)(rec_options.not_backedup_addresses - dram_addr);
+    }
+    if ((unsigned int)n > rec_options.dram_wrap_around - dram_addr) {
+        n = (int)(rec_options.dram_wrap_around - dram_addr);
+    }
+
+    *host = page + (host_addr & 0xff);
+    *reu = reu_ram + dram_addr;
+    return n;
+}
+
 /* ------------------------------------------------------------------------- */
 
 /*! \brief update the REU registers after a DMA operation
@@ -1243,6 +1327,9 @@ static void reu_dma_update_regs(uint16_t host_addr, unsigned int reu_addr, int l
 static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     uint8_t value;
+    uint8_t *host, *reu;
+    int n;
+
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s<= main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1251,6 +1338,16 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 1, &host, &reu);
+        if (n > 0) {
+            memcpy(reu, host, n);
+            value = reu[n - 1];
+            maincpu_clk += n;
+            host_addr = (host_addr + n) & 0xffff;
+            reu_addr = increment_reu_with_wrap_around(reu_addr + n - 1, 1);
+            len -= n;
+            continue;
+        }
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value = mem_dma_read(host_addr);
@@ -1288,6 +1385,9 @@ static void reu_dma_host_to_reu(uint16_t host_addr, unsigned int reu_addr, int h
 static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int host_step, int reu_step, int len)
 {
     uint8_t value;
+    uint8_t *host, *reu;
+    int n;
+
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "copy ext $%05X %s=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1296,6 +1396,16 @@ static void reu_dma_reu_to_host(uint16_t host_addr, unsigned int reu_addr, int h
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 1, &host, &reu);
+        if (n > 0) {
+            memcpy(host, reu, n);
+            floating_bus_value = reu[n - 1];
+            maincpu_clk += n;
+            host_addr = (host_addr + n) & 0xffff;
+            reu_addr = increment_reu_with_wrap_around(reu_addr + n - 1, 1);
+            len -= n;
+            continue;
+        }
         DEBUG_LOG(DEBUG_LEVEL_TRANSFER_LOW_LEVEL, (reu_log, "Transferring byte: %x from ext $%05X to main $%04X.", reu_ram[reu_addr % reu_size], reu_addr, host_addr));
         nonsc_reu_clk_inc_pre();
         /* after a transfer from REU to host, the last (pre)fetched value from valid
@@ -1342,6 +1452,9 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
 {
     uint8_t value_from_reu;
     uint8_t value_from_c64;
+    uint8_t *host, *reu;
+    int i, n;
+
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "swap ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1350,6 +1463,19 @@ static void reu_dma_swap(uint16_t host_addr, unsigned int reu_addr, int host_ste
     assert(len >= 1);
 
     while (len) {
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 2, &host, &reu);
+        if (n > 0) {
+            for (i = 0; i < n; i++) {
+                value_from_reu = reu[i];
+                reu[i] = host[i];
+                host[i] = value_from_reu;
+            }
+            maincpu_clk += 2 * n;
+            host_addr = (host_addr + n) & 0xffff;
+            reu_addr = increment_reu_with_wrap_around(reu_addr + n - 1, 1);
+            len -= n;
+            continue;
+        }
         value_from_reu = read_from_reu(reu_addr);
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
@@ -1397,6 +1523,9 @@ static void reu_dma_compare(uint16_t host_addr, unsigned int reu_addr, int host_
 
     uint8_t new_status_or_mask = 0;
 
+    uint8_t *host, *reu;
+    int i, n;
+
     DEBUG_LOG(DEBUG_LEVEL_TRANSFER_HIGH_LEVEL, (reu_log, "compare ext $%05X %s<=> main $%04X%s, $%04X (%d) bytes.",
                                                 reu_addr, reu_step ? "" : "(fixed) ", host_addr, host_step ? "" : " (fixed)", len, len));
 
@@ -1410,6 +1539,17 @@ static void reu_dma_compare(uint16_t host_addr, unsigned int reu_addr, int host_
     /* rec.status &= ~ (REU_REG_R_STATUS_VERIFY_ERROR | REU_REG_R_STATUS_END_OF_BLOCK); */
 
     while (len) {
+        /* the equal bytes of a block; a difference takes the per-byte path */
+        n = reu_dma_block(host_addr, reu_addr, host_step, reu_step, len, 1, &host, &reu);
+        for (i = 0; i < n && host[i] == reu[i]; i++) {
+        }
+        if (i > 0) {
+            maincpu_clk += i;
+            host_addr = (host_addr + i) & 0xffff;
+            reu_addr = increment_reu_with_wrap_around(reu_addr + i - 1, 1);
+            len -= i;
+            continue;
+        }
         nonsc_reu_clk_inc_pre();
         machine_handle_pending_alarms(0);
         value_from_reu = read_from_reu(reu_addr);
@@ -322,18 +322,22 @@ static uint8_t sfx_soundsampler_sample_read(uint16_t addr)
 
 static uint8_t sfx_soundsampler_sound_data;
 
-static void sfx_soundsampler_sound_store(uint16_t addr, uint8_t value)
-{
-    sfx_soundsampler_sound_data = value;
-    sound_store(sfx_soundsampler_sound_chip_offset, value, 0);
-}
-
 struct sfx_soundsampler_sound_s {
     uint8_t voice0;
 };
 
 static struct sfx_soundsampler_sound_s snd;
 
+static void sfx_soundsampler_sound_store(uint16_t addr, uint8_t value)
+{
+    sfx_soundsampler_sound_data = value;
+    if (sound_dac_store(&sfx_soundsampler_dac, (int)value * 128) == 0) {
+        snd.voice0 = value;
+    } else {
+        sound_store(sfx_soundsampler_sound_chip_offset, value, 0);
+    }
+}
+
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int sfx_soundsampler_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int scc, CLOCK *delta_t)
@@ -367,6 +371,7 @@ static uint8_t sfx_soundsampler_sound_machine_read(sound_t *psid, uint16_t addr)
 
 static void sfx_soundsampler_sound_reset(sound_t *psid, CLOCK cpu_clk)
 {
+    sound_dac_discard(&sfx_soundsampler_dac);
     snd.voice0 = 0;
     sfx_soundsampler_sound_data = 0;
 }
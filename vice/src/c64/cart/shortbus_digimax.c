@@ -99,8 +99,7 @@ void shortbus_digimax_sound_chip_init(void)
 
 static void shortbus_digimax_sound_store(uint16_t addr, uint8_t value)
 {
-    digimax_sound_data[addr] = value;
-    sound_store((uint16_t)(digimax_sound_chip_offset | addr), value, 0);
+    digimax_sound_dac_store(addr, value);
 }
 
 static uint8_t shortbus_digimax_sound_read(uint16_t addr)
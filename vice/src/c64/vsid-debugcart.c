@@ -27,6 +27,7 @@
 #include "vice.h"
 
 #include "archdep.h"
+#include "batch.h"
 #include "cartridge.h"
 #include "cmdline.h"
 #include "lib.h"
@@ -46,7 +47,7 @@ void debugcart_store(uint16_t addr, uint8_t value)
     if ((debugcart_enabled) && (addr == 0xd7ff)) {
         /* FIXME: perhaps print a timestamp too */
         fprintf(stdout, "DBGCART: exit(%d)\n", n);
-        archdep_vice_exit(n);
+        batch_vice_exit(n);
     }
 }
 
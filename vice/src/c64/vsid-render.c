@@ -0,0 +1,799 @@
+/*
+ * vsid-render.c - Render a list of tunes to sound files.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The render list has one entry per line:
+
+       <file> [<tune> [<seconds>]]
+
+   Fields are separated by whitespace and may be enclosed in double quotes;
+   empty lines and lines starting with `#' are ignored.  Without a tune (or
+   with tune 0) every sub tune of the file is rendered.  Without a length
+   (or with length 0) each tune plays for its length in the HVSC song length
+   database, or for the -renderlength value if it is not listed there.
+
+   Instead of a list, -render also takes a directory, which renders every
+   .sid file below it.  The output names then include the path below that
+   directory, with the directory separators replaced by `_'.
+
+   The tunes are played one after another in warp mode, with the sound
+   going only to the recording device, and each is written to
+   <directory>/<name>-<tune>.<format>.  The time each tune took to render
+   is printed to stdout, together with the tunes per minute at the end, and
+   the emulator exits after the last tune, with a failure code if a file
+   could not be played.  With -rendermanifest, every tune also gets a
+   tab separated line in the manifest:
+
+       <status> <seconds> <render time> <tune> <output> <file>
+
+   With -renderjobs N, the emulator forks N copies of itself once it is up
+   and running and the SLDB has been loaded, so the copies share it, and
+   each copy renders every Nth file of the list.  The copies report to the
+   first process through a pipe, which writes the manifest and the totals.  Forking is only available on Unix; elsewhere all tunes are
+   rendered by one process.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef UNIX_COMPILE
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "hvsc.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "mainlock.h"
+#include "psid.h"
+#include "resources.h"
+#include "sound.h"
+#include "types.h"
+#include "util.h"
+#include "vsid-render.h"
+#include "vsync.h"
+
+#define RENDER_LINE_MAX         1024
+#define RENDER_DEFAULT_SECONDS  180
+#define RENDER_JOBS_MAX         64
+
+typedef struct render_entry_s {
+    char *filename;
+    char *output;       /* output name without tune and extension */
+    int tune;
+    int seconds;
+} render_entry_t;
+
+static render_entry_t *entries = NULL;
+static int num_entries = 0;
+static int current_entry = -1;
+static int num_failed = 0;
+
+/* Set while the list is rendered.  */
+static int render_active = 0;
+
+/* Sub tunes of the current entry still to render.  */
+static int current_tune;
+static int last_tune;
+
+/* Song lengths of the current file in the HVSC database.  */
+static long *song_lengths = NULL;
+static int num_song_lengths = 0;
+
+/* Set while a tune is recorded.  */
+static int tune_running = 0;
+static CLOCK tune_start_clk;
+static tick_t tune_start_tick;
+static int tune_seconds;
+static char *tune_output = NULL;
+
+static int num_rendered = 0;
+static double total_seconds;
+static tick_t render_start_tick;
+
+static char *render_format = NULL;
+static char *render_dir = NULL;
+static int default_seconds = RENDER_DEFAULT_SECONDS;
+static int render_jobs = 1;
+static char *manifest_name = NULL;
+
+/* Manifest written by the first process.  */
+static FILE *manifest_fd = NULL;
+
+/* This process renders the entries `render_job' + n * `render_jobs'; the
+   forked ones report to the first one through `report_fd'.  */
+static int render_job = 0;
+static int report_fd = -1;
+
+static log_t render_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+static void render_free_entries(void)
+{
+    int i;
+
+    for (i = 0; i < num_entries; i++) {
+        lib_free(entries[i].filename);
+        lib_free(entries[i].output);
+    }
+    lib_free(entries);
+    entries = NULL;
+    num_entries = 0;
+}
+
+/* Return a copy of the next field of `*p', or NULL at the end of the line.  */
+static char *render_next_field(const char **p)
+{
+    const char *s = util_skip_whitespace(*p);
+    const char *start;
+    char *field;
+
+    if (*s == 0 || *s == '\n' || *s == '\r') {
+        *p = s;
+        return NULL;
+    }
+
+    if (*s == '"') {
+        start = ++s;
+        while (*s != 0 && *s != '"') {
+            s++;
+        }
+        field = lib_strdup(start);
+        field[s - start] = 0;
+        if (*s == '"') {
+            s++;
+        }
+    } else {
+        start = s;
+        while (*s != 0 && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r') {
+            s++;
+        }
+        field = lib_strdup(start);
+        field[s - start] = 0;
+    }
+
+    *p = s;
+    return field;
+}
+
+static render_entry_t *render_add_entry(char *filename, char *output)
+{
+    render_entry_t *entry;
+
+    entries = lib_realloc(entries, (num_entries + 1) * sizeof(render_entry_t));
+    entry = &entries[num_entries++];
+    entry->filename = filename;
+    entry->output = output;
+    entry->tune = 0;
+    entry->seconds = 0;
+
+    return entry;
+}
+
+/* Add the .sid files below `path', with `prefix' in front of the output
+   names.  */
+static void render_scan_dir(const char *path, const char *prefix)
+{
+    archdep_dir_t *dir;
+    int i;
+
+    dir = archdep_opendir(path, ARCHDEP_OPENDIR_NO_HIDDEN_FILES);
+    if (dir == NULL) {
+        log_warning(render_log, "Cannot read directory `%s'.", path);
+        return;
+    }
+
+    for (i = 0; i < dir->file_amount; i++) {
+        const char *name = dir->files[i];
+        char *ext = util_get_extension(name);
+        char *output;
+
+        if (ext == NULL || util_strcasecmp(ext, "sid") != 0) {
+            lib_free(ext);
+            continue;
+        }
+        lib_free(ext);
+
+        output = lib_msprintf("%s%s", prefix, name);
+        output[strlen(output) - 4] = 0;
+        render_add_entry(util_join_paths(path, name, NULL), output);
+    }
+
+    for (i = 0; i < dir->dir_amount; i++) {
+        const char *name = dir->dirs[i];
+        char *subdir, *subprefix;
+
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+        subdir = util_join_paths(path, name, NULL);
+        subprefix = lib_msprintf("%s%s_", prefix, name);
+        render_scan_dir(subdir, subprefix);
+        lib_free(subprefix);
+        lib_free(subdir);
+    }
+
+    archdep_closedir(dir);
+}
+
+static int render_load_list(const char *filename)
+{
+    FILE *fd;
+    char line[RENDER_LINE_MAX];
+    int lineno = 0;
+    unsigned int isdir;
+
+    if (archdep_stat(filename, NULL, &isdir) == 0 && isdir) {
+        render_free_entries();
+        render_scan_dir(filename, "");
+        if (num_entries == 0) {
+            log_error(render_log, "No .sid files below `%s'.", filename);
+            return -1;
+        }
+        return 0;
+    }
+
+    fd = fopen(filename, MODE_READ_TEXT);
+    if (fd == NULL) {
+        log_error(render_log, "Cannot open render list `%s'.", filename);
+        return -1;
+    }
+
+    render_free_entries();
+
+    while (fgets(line, sizeof(line), fd) != NULL) {
+        const char *p = util_skip_whitespace(line);
+        char *name, *field;
+        render_entry_t *entry;
+
+        lineno++;
+
+        if (*p == '#') {
+            continue;
+        }
+        name = render_next_field(&p);
+        if (name == NULL) {
+            continue;
+        }
+
+        entry = render_add_entry(name, NULL);
+
+        field = render_next_field(&p);
+        if (field != NULL) {
+            entry->tune = atoi(field);
+            lib_free(field);
+            field = render_next_field(&p);
+            if (field != NULL) {
+                entry->seconds = atoi(field);
+                lib_free(field);
+            }
+        }
+
+        field = render_next_field(&p);
+        if (field != NULL) {
+            log_warning(render_log, "%s:%d: ignoring extra field `%s'.", filename, lineno, field);
+            lib_free(field);
+        }
+    }
+
+    fclose(fd);
+
+    if (num_entries == 0) {
+        log_error(render_log, "No tunes in render list `%s'.", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static char *render_output_name(const render_entry_t *entry, int tune)
+{
+    char *name, *ext, *base, *path;
+
+    if (entry->output != NULL) {
+        base = lib_msprintf("%s-%02d.%s", entry->output, tune, render_format);
+    } else {
+        util_fname_split(entry->filename, NULL, &name);
+        ext = strrchr(name, '.');
+        if (ext != NULL && ext != name) {
+            *ext = 0;
+        }
+        base = lib_msprintf("%s-%02d.%s", name, tune, render_format);
+        lib_free(name);
+    }
+
+    if (render_dir == NULL || *render_dir == 0) {
+        return base;
+    }
+    path = util_join_paths(render_dir, base, NULL);
+    lib_free(base);
+
+    return path;
+}
+
+/* Count a rendered tune, or a file that failed if `output' is NULL, and
+   add it to the manifest.  */
+static void render_report(const char *filename, int tune, int seconds,
+                          double render_seconds, const char *output)
+{
+    char line[RENDER_LINE_MAX * 2];
+
+    if (output != NULL) {
+        num_rendered++;
+        total_seconds += seconds;
+    } else {
+        num_failed++;
+    }
+
+    if (report_fd < 0 && manifest_fd == NULL) {
+        return;
+    }
+
+    snprintf(line, sizeof(line), "%s\t%d\t%.2f\t%d\t%s\t%s\n",
+             output != NULL ? "ok" : "failed", seconds, render_seconds, tune,
+             output != NULL ? output : "-", filename);
+
+#ifdef UNIX_COMPILE
+    if (report_fd >= 0) {
+        /* Lines up to PIPE_BUF bytes are written in one piece.  */
+        if (write(report_fd, line, strlen(line)) < 0) {
+            log_error(render_log, "Cannot report to the first render process.");
+        }
+        return;
+    }
+#endif
+    fputs(line, manifest_fd);
+}
+
+static void render_finish_tune(void)
+{
+    double seconds = (double)tick_now_delta(tune_start_tick) / tick_per_second();
+
+    tune_running = 0;
+    resources_set_string("SoundRecordDeviceName", "");
+
+    render_report(entries[current_entry].filename, current_tune, tune_seconds,
+                  seconds, tune_output);
+    lib_free(tune_output);
+    tune_output = NULL;
+
+    fprintf(stdout, "RENDER: \"%s\" tune %d: %d s in %.2f s\n",
+            entries[current_entry].filename, current_tune, tune_seconds, seconds);
+    fflush(stdout);
+}
+
+static void render_start_tune(void)
+{
+    const render_entry_t *entry = &entries[current_entry];
+    char *output;
+
+    tune_seconds = entry->seconds;
+    if (tune_seconds <= 0 && current_tune <= num_song_lengths) {
+        tune_seconds = (int)song_lengths[current_tune - 1];
+    }
+    if (tune_seconds <= 0) {
+        tune_seconds = default_seconds;
+    }
+
+    output = render_output_name(entry, current_tune);
+    log_message(render_log, "Rendering tune %d of `%s' (%d s) to `%s'.",
+                current_tune, entry->filename, tune_seconds, output);
+
+    /* The recording device is reopened with the new file on the next
+       sound_flush(), before the reset below is executed.  */
+    resources_set_string("SoundRecordDeviceArg", output);
+    resources_set_string("SoundRecordDeviceName", render_format);
+    tune_output = output;
+
+    psid_init_driver();
+    machine_play_psid(current_tune);
+    machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
+
+    tune_start_clk = maincpu_clk;
+    tune_start_tick = tick_now();
+    tune_running = 1;
+}
+
+/* Load the next file of the list, returns -1 at the end of the list.  */
+static int render_next_entry(void)
+{
+    const render_entry_t *entry;
+    int songs, default_tune;
+
+    while (++current_entry < num_entries) {
+        if (current_entry % render_jobs != render_job) {
+            continue;
+        }
+        entry = &entries[current_entry];
+
+        if (machine_autodetect_psid(entry->filename) < 0) {
+            log_error(render_log, "Cannot load `%s'.", entry->filename);
+            render_report(entry->filename, entry->tune, 0, 0.0, NULL);
+            continue;
+        }
+
+        songs = psid_tunes(&default_tune);
+        if (entry->tune > songs) {
+            log_error(render_log, "`%s' has no tune %d.", entry->filename, entry->tune);
+            render_report(entry->filename, entry->tune, 0, 0.0, NULL);
+            continue;
+        }
+        current_tune = entry->tune ? entry->tune : 1;
+        last_tune = entry->tune ? entry->tune : songs;
+
+        lib_free(song_lengths);
+        num_song_lengths = hvsc_sldb_get_lengths(entry->filename, &song_lengths);
+        if (num_song_lengths < 0) {
+            /* not always cleared on failure */
+            song_lengths = NULL;
+            num_song_lengths = 0;
+        }
+
+        return 0;
+    }
+
+    return -1;
+}
+
+static void render_print_totals(void)
+{
+    double seconds;
+
+    seconds = (double)tick_now_delta(render_start_tick) / tick_per_second();
+    if (seconds <= 0.0) {
+        seconds = 1.0 / tick_per_second();
+    }
+    fprintf(stdout, "RENDER: %d tunes (%.0f s) in %.1f s: %.1f tunes per minute, %.1fx real time\n",
+            num_rendered, total_seconds, seconds,
+            num_rendered * 60.0 / seconds, total_seconds / seconds);
+    if (num_failed) {
+        fprintf(stdout, "RENDER: %d files could not be rendered\n", num_failed);
+    }
+    fflush(stdout);
+}
+
+static void render_close_manifest(void)
+{
+    if (manifest_fd != NULL) {
+        fclose(manifest_fd);
+        manifest_fd = NULL;
+    }
+}
+
+static void render_next(void)
+{
+
+    if (tune_running) {
+        render_finish_tune();
+        if (current_tune < last_tune) {
+            current_tune++;
+            render_start_tune();
+            return;
+        }
+    }
+
+    if (render_next_entry() == 0) {
+        render_start_tune();
+        return;
+    }
+
+    render_active = 0;
+
+#ifdef UNIX_COMPILE
+    if (report_fd >= 0) {
+        /* A forked process: finish the last file and leave without running
+           the shutdown of the first process, whose threads do not exist
+           here.  */
+        sound_close();
+        close(report_fd);
+        fflush(NULL);
+        _exit(num_failed ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+#endif
+
+    render_print_totals();
+    render_close_manifest();
+    archdep_vice_exit(num_failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+#ifdef UNIX_COMPILE
+/* Fork the other render processes, then collect their reports until they
+   are done.  Returns only in the forked processes, or if forking failed
+   before any process was started.  */
+static void render_fork_jobs(void)
+{
+    pid_t pids[RENDER_JOBS_MAX];
+    int fds[2];
+    int job, started = 0;
+    FILE *reports;
+    char line[RENDER_LINE_MAX * 2];
+
+    if (pipe(fds) < 0) {
+        log_error(render_log, "Cannot create pipe: %s.", strerror(errno));
+        render_jobs = 1;
+        return;
+    }
+
+    /* Do not let the children inherit unwritten output.  */
+    fflush(NULL);
+
+    for (job = 0; job < render_jobs; job++) {
+        pids[job] = fork();
+        if (pids[job] == 0) {
+            close(fds[0]);
+            mainlock_fork_child();
+            render_job = job;
+            report_fd = fds[1];
+            render_close_manifest();
+            return;
+        }
+        if (pids[job] < 0) {
+            log_error(render_log, "Cannot fork render process %d: %s.", job, strerror(errno));
+            break;
+        }
+        started++;
+    }
+    close(fds[1]);
+
+    if (started == 0) {
+        close(fds[0]);
+        render_jobs = 1;
+        return;
+    }
+
+    log_message(render_log, "Rendering %d files in %d processes.", num_entries, started);
+
+    /* Render processes that could not be started leave their share of the
+       list unrendered.  */
+    for (job = started; job < render_jobs; job++) {
+        int i;
+
+        for (i = job; i < num_entries; i += render_jobs) {
+            render_report(entries[i].filename, entries[i].tune, 0, 0.0, NULL);
+        }
+    }
+
+    reports = fdopen(fds[0], "r");
+    while (reports != NULL && fgets(line, sizeof(line), reports) != NULL) {
+        int seconds;
+
+        if (manifest_fd != NULL) {
+            fputs(line, manifest_fd);
+        }
+        if (strncmp(line, "ok\t", 3) == 0) {
+            num_rendered++;
+            if (sscanf(line + 3, "%d", &seconds) == 1) {
+                total_seconds += seconds;
+            }
+        } else {
+            num_failed++;
+        }
+    }
+    if (reports != NULL) {
+        fclose(reports);
+    } else {
+        close(fds[0]);
+    }
+
+    for (job = 0; job < started; job++) {
+        int status;
+
+        while (waitpid(pids[job], &status, 0) < 0) {
+            if (errno != EINTR) {
+                /* already reaped, when SIGCHLD is ignored */
+                status = 0;
+                break;
+            }
+        }
+        if (WIFSIGNALED(status)) {
+            log_error(render_log, "Render process %d was killed by signal %d.",
+                      job, WTERMSIG(status));
+            num_failed++;
+        }
+    }
+
+    render_print_totals();
+    render_close_manifest();
+    archdep_vice_exit(num_failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+#endif
+
+void vsid_render_vsync_hook(void)
+{
+    if (!render_active) {
+        if (num_entries == 0 || current_entry >= 0) {
+            return;
+        }
+
+        /* Play nothing, record everything, as fast as possible.  */
+        render_active = 1;
+        resources_set_int("Sound", 1);
+        resources_set_string("SoundDeviceName", "dummy");
+        vsync_set_warp_mode(1);
+
+        /* Look up all song lengths in one copy of the SLDB.  */
+        hvsc_sldb_load();
+
+        if (manifest_name != NULL) {
+            manifest_fd = fopen(manifest_name, MODE_WRITE_TEXT);
+            if (manifest_fd == NULL) {
+                log_error(render_log, "Cannot create manifest `%s'.", manifest_name);
+            } else {
+                fprintf(manifest_fd, "# status\tseconds\trender time\ttune\toutput\tfile\n");
+            }
+        }
+
+        render_start_tick = tick_now();
+
+        if (render_jobs > num_entries) {
+            render_jobs = num_entries;
+        }
+        if (render_jobs > 1) {
+#ifdef UNIX_COMPILE
+            /* The forked processes have no helper threads.  */
+#ifdef USE_SOUND_THREAD
+            resources_set_int("SoundThread", 0);
+#endif
+#ifdef USE_SID_THREADS
+            resources_set_int("SidThreads", 0);
+#endif
+            render_fork_jobs();
+#else
+            log_warning(render_log, "-renderjobs is not supported here, rendering in one process.");
+            render_jobs = 1;
+#endif
+        }
+
+        render_next();
+        return;
+    }
+
+    if (tune_running
+        && (double)(maincpu_clk - tune_start_clk)
+           >= (double)tune_seconds * machine_get_cycles_per_second()) {
+        render_next();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_render(const char *param, void *extra_param)
+{
+    return render_load_list(param);
+}
+
+static int cmdline_render_format(const char *param, void *extra_param)
+{
+    if (strcmp(param, "wav") != 0
+#ifdef USE_FLAC
+        && strcmp(param, "flac") != 0
+#endif
+        ) {
+        return -1;
+    }
+    util_string_set(&render_format, param);
+
+    return 0;
+}
+
+static int cmdline_render_dir(const char *param, void *extra_param)
+{
+    util_string_set(&render_dir, param);
+
+    return 0;
+}
+
+static int cmdline_render_jobs(const char *param, void *extra_param)
+{
+    int jobs = atoi(param);
+
+    if (jobs < 1 || jobs > RENDER_JOBS_MAX) {
+        return -1;
+    }
+    render_jobs = jobs;
+
+    return 0;
+}
+
+static int cmdline_render_manifest(const char *param, void *extra_param)
+{
+    util_string_set(&manifest_name, param);
+
+    return 0;
+}
+
+static int cmdline_render_length(const char *param, void *extra_param)
+{
+    int seconds = atoi(param);
+
+    if (seconds < 1) {
+        return -1;
+    }
+    default_seconds = seconds;
+
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-render", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_render, NULL, NULL, NULL,
+      "<filename>", "Render the tunes listed in <filename>, or the .sid files below a directory, to sound files as fast as possible, then quit" },
+#ifdef USE_FLAC
+    { "-renderformat", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_render_format, NULL, NULL, NULL,
+      "<format>", "Sound file format for -render (wav, flac)" },
+#else
+    { "-renderformat", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_render_format, NULL, NULL, NULL,
+      "<format>", "Sound file format for -render (wav)" },
+#endif
+    { "-renderdir", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_render_dir, NULL, NULL, NULL,
+      "<path>", "Directory for the sound files of -render" },
+    { "-renderlength", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_render_length, NULL, NULL, NULL,
+      "<seconds>", "Length of tunes rendered with -render that are not in the HVSC song length database" },
+    { "-renderjobs", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_render_jobs, NULL, NULL, NULL,
+      "<number>", "Number of processes rendering the tunes of -render (1-64)" },
+    { "-rendermanifest", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_render_manifest, NULL, NULL, NULL,
+      "<filename>", "Write the result and time of every tune rendered with -render to <filename>" },
+    CMDLINE_LIST_END
+};
+
+int vsid_render_cmdline_options_init(void)
+{
+    if (render_format == NULL) {
+        render_format = lib_strdup("wav");
+    }
+
+    return cmdline_register_options(cmdline_options);
+}
+
+void vsid_render_shutdown(void)
+{
+    render_free_entries();
+    lib_free(song_lengths);
+    song_lengths = NULL;
+    num_song_lengths = 0;
+    lib_free(render_format);
+    render_format = NULL;
+    lib_free(render_dir);
+    render_dir = NULL;
+    lib_free(manifest_name);
+    manifest_name = NULL;
+    lib_free(tune_output);
+    tune_output = NULL;
+    render_close_manifest();
+}
@@ -54,15 +54,8 @@
 #define SNAP_MAJOR 1
 #define SNAP_MINOR 1
 
-int c64_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode)
+static int c64_snapshot_write_modules(snapshot_t *s, int save_roms, int save_disks, int event_mode)
 {
-    snapshot_t *s;
-
-    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_get_name());
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     /* Execute drive CPUs to get in sync with the main CPU.  */
@@ -77,6 +70,22 @@ int c64_snapshot_write(const char *name, int save_roms, int save_disks, int even
         || c64_glue_snapshot_write_module(s) < 0
         || event_snapshot_write_module(s, event_mode) < 0
         || keyboard_snapshot_write_module(s)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int c64_snapshot_write(const char *name, int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s;
+
+    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (c64_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
         snapshot_close(s);
         archdep_remove(name);
         return -1;
@@ -86,16 +95,26 @@ int c64_snapshot_write(const char *name, int save_roms, int save_disks, int even
     return 0;
 }
 
-int c64_snapshot_read(const char *name, int event_mode)
+snapshot_t *c64_snapshot_write_mem(int save_roms, int save_disks, int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
 
-    s = snapshot_open(name, &major, &minor, machine_get_name());
+    s = snapshot_create_mem(((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)), machine_get_name());
     if (s == NULL) {
-        return -1;
+        return NULL;
     }
 
+    if (c64_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+/* Read the modules of an opened snapshot; `s' is closed in any case.  */
+static int c64_snapshot_read_modules(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -131,3 +150,29 @@ fail:
 
     return -1;
 }
+
+int c64_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    return c64_snapshot_read_modules(s, major, minor, event_mode);
+}
+
+int c64_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open_mem(data, size, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    return c64_snapshot_read_modules(s, major, minor, event_mode);
+}
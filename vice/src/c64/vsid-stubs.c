@@ -200,6 +200,11 @@ int cartridge_attach_image(int type, const char *filename)
     return -1;
 }
 
+int cartridge_attach_image_from_memory(const uint8_t *data, size_t size, const char *filename)
+{
+    return -1;
+}
+
 void cartridge_detach_image(int type)
 {
 }
@@ -626,6 +631,20 @@ image_contents_t *diskcontents_filesystem_read(const char *file_name)
     return NULL;
 }
 
+int diskcontents_resources_init(void)
+{
+    return 0;
+}
+
+int diskcontents_cmdline_options_init(void)
+{
+    return 0;
+}
+
+void diskcontents_shutdown(void)
+{
+}
+
 void image_contents_destroy(image_contents_t *contents)
 {
 }
@@ -850,6 +869,11 @@ int machine_bus_lib_read_sector(unsigned int unit, unsigned int track, unsigned
     return 0;
 }
 
+int machine_bus_lib_read_sectors(unsigned int unit, unsigned int track, unsigned int sector, unsigned int count, uint8_t *buf)
+{
+    return 0;
+}
+
 int machine_bus_lib_write_sector(unsigned int unit, unsigned int track, unsigned int sector, uint8_t *buf)
 {
     return 0;
@@ -953,6 +977,14 @@ void drive_cpu_execute_all(CLOCK clk_value)
 {
 }
 
+void drive_cpu_execute_all_read(CLOCK clk_value)
+{
+}
+
+void drive_cpu_execute_one_read(diskunit_context_t *drv, CLOCK clk_value)
+{
+}
+
 int drive_num_leds(unsigned int dnr)
 {
     return 1;
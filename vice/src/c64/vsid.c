@@ -69,6 +69,7 @@
 #include "vsid-cmdline-options.h"
 #include "vsidui.h"
 #include "vsid-debugcart.h"
+#include "vsid-render.h"
 #include "vsync.h"
 
 
@@ -167,6 +168,10 @@ int machine_cmdline_options_init(void)
         init_cmdline_options_fail("debug cart");
         return -1;
     }
+    if (vsid_render_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("vsid render");
+        return -1;
+    }
     return 0;
 }
 
@@ -296,6 +301,7 @@ void machine_specific_shutdown(void)
     sid_cmdline_options_shutdown();
 
     psid_shutdown();
+    vsid_render_shutdown();
 }
 
 void machine_handle_pending_alarms(CLOCK num_write_cycles)
@@ -338,6 +344,8 @@ static void machine_vsync_hook(void)
         time = playtime;
         vsid_ui_display_time(playtime);
     }
+
+    vsid_render_vsync_hook();
 }
 
 void machine_set_restore_key(int v)
@@ -436,6 +444,16 @@ int machine_read_snapshot(const char *name, int event_mode)
     return c64_snapshot_read(name, event_mode);
 }
 
+snapshot_t *machine_write_snapshot_mem(int save_roms, int save_disks, int event_mode)
+{
+    return c64_snapshot_write_mem(save_roms, save_disks, event_mode);
+}
+
+int machine_read_snapshot_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    return c64_snapshot_read_mem(data, size, event_mode);
+}
+
 /* ------------------------------------------------------------------------- */
 
 int machine_autodetect_psid(const char *name)
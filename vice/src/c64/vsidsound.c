@@ -63,7 +63,8 @@ static sound_chip_t sid_sound_chip = {
 #ifdef SOUND_SYSTEM_FLOAT
     sid_sound_mixing_spec,               /* stereo mixing placement specs */
 #endif
-    1                                    /* chip is always enabled */
+    1,                                   /* chip is always enabled */
+    sid_sound_machine_skip               /* sound chip skip function */
 };
 
 static uint16_t sid_sound_chip_offset = 0;
@@ -27,9 +27,16 @@
 #ifndef VICE_C64DTV_SNAPSHOT_H
 #define VICE_C64DTV_SNAPSHOT_H
 
+#include "types.h"
+
+struct snapshot_s;
+
 int c64dtv_snapshot_write(const char *name, int save_roms, int save_disks,
                           int event_mode);
 
 int c64dtv_snapshot_read(const char *name, int event_mode);
 
+struct snapshot_s *c64dtv_snapshot_write_mem(int save_roms, int save_disks, int event_mode);
+int c64dtv_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode);
+
 #endif
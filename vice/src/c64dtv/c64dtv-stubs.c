@@ -135,6 +135,11 @@ int cartridge_attach_image(int type, const char *filename)
     return -1;
 }
 
+int cartridge_attach_image_from_memory(const uint8_t *data, size_t size, const char *filename)
+{
+    return -1;
+}
+
 void cartridge_detach_image(int type)
 {
 }
@@ -219,6 +219,14 @@ static const trap_t c64_serial_traps[] = {
     }
 };
 
+/* LOAD byte loop, same KERNAL as the C64.  */
+static const serial_trap_load_t c64_serial_load = {
+    0xf4fb,
+    { 0x20, 0x13, 0xee, 0xaa, 0xa5, 0x90, 0x4a, 0x4a, 0xb0 },
+    0xae,
+    0x93
+};
+
 static log_t c64_log = LOG_ERR;
 static machine_timing_t machine_timing;
 
@@ -709,6 +717,7 @@ int machine_specific_init(void)
     }
 
     serial_trap_init(0xa4);
+    serial_trap_load_set(&c64_serial_load);
     serial_iec_bus_init();
 
     gfxoutput_init();
@@ -961,6 +970,24 @@ int machine_read_snapshot(const char *name, int event_mode)
     return err;
 }
 
+snapshot_t *machine_write_snapshot_mem(int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s = c64dtv_snapshot_write_mem(save_roms, save_disks, event_mode);
+    if ((s == NULL) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_WRITE_SNAPSHOT);
+    }
+    return s;
+}
+
+int machine_read_snapshot_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    int err = c64dtv_snapshot_read_mem(data, size, event_mode);
+    if ((err < 0) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_READ_SNAPSHOT);
+    }
+    return err;
+}
+
 /* ------------------------------------------------------------------------- */
 
 int machine_screenshot(screenshot_t *screenshot, struct video_canvas_s *canvas)
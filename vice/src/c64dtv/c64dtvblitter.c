@@ -77,12 +77,17 @@ static uint8_t srcb_data[4];
 static int srcb_data_offs;
 static uint8_t sourceA, sourceB;
 static int blitter_count;
-static enum { BLITTER_IDLE, BLITTER_READ_A, BLITTER_READ_B, BLITTER_WRITE } blitter_state;
+static enum { BLITTER_IDLE, BLITTER_READ_A, BLITTER_READ_B, BLITTER_WRITE, BLITTER_BULK } blitter_state;
 static int sourceA_line_off;
 static int sourceB_line_off;
 static int dest_line_off;
 static uint8_t lastA;
 
+/* The blitter only accesses RAM, so a blit is done in one go in its first
+   cycle, BLITTER_BULK then counts down the cycles it would have taken.  */
+static int blitter_bulk_check;
+static int blitter_bulk_cycles;
+
 
 /* resource stuff */
 static int dtvrevision;
@@ -171,6 +176,8 @@ void c64dtvblitter_reset(void)
     sourceA_line_off = 0;
     sourceB_line_off = 0;
     dest_line_off = 0;
+    blitter_bulk_check = 0;
+    blitter_bulk_cycles = 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -341,6 +348,126 @@ static inline void perform_blitter_cycle(void)
     }
 }
 
+/* Copy or fill a line of bytes at once.  This covers blits with source A
+   moving by a whole byte or standing still, source B forced to zero, no
+   shift, the destination always written and no modulo reached.  Return 0 if
+   the blit does not qualify or its source and destination overlap.  */
+static int blitter_bulk_line(void)
+{
+    int count = blitter_count;
+    int a = blit_sourceA_off >> 4;
+    int d = blit_dest_off >> 4;
+    int a_lo, a_hi, d_lo, d_hi, words, i;
+    uint8_t value;
+
+    if (!reg1b_force_sourceB_zero || reg1e_sourceA_right_shift != 0
+        || !reg1b_write_if_sourceA_zero || !reg1b_write_if_sourceA_nonzero
+        || (reg07_sourceA_step != 0 && reg07_sourceA_step != 0x10)
+        || (reg07_sourceA_step != 0 && reg1a_sourceA_direction != reg1a_dest_direction)
+        || reg17_dest_step != 0x10
+        || reg05_sourceA_line_length < count
+        || reg0d_sourceB_line_length < count
+        || reg15_dest_line_length < count) {
+        return 0;
+    }
+
+    a_lo = (reg1a_sourceA_direction > 0) ? a : a - (reg07_sourceA_step >> 4) * (count - 1);
+    a_hi = a_lo + (reg07_sourceA_step >> 4) * (count - 1);
+    d_lo = (reg1a_dest_direction > 0) ? d : d - (count - 1);
+    d_hi = d_lo + (count - 1);
+    if (a_lo < 0 || (a_lo >> 21) != (a_hi >> 21) || d_lo < 0 || (d_lo >> 21) != (d_hi >> 21)) {
+        return 0;
+    }
+    a_lo &= 0x1fffff;
+    a_hi &= 0x1fffff;
+    d_lo &= 0x1fffff;
+    d_hi &= 0x1fffff;
+
+    /* source A reads whole words, none of them may be written */
+    if (reg07_sourceA_step != 0 && !((a_hi | 3) < d_lo || (a_lo & ~3) > d_hi)) {
+        return 0;
+    }
+
+    /* the last word fetched, as stepping the blit would leave it */
+    srca_data_offs = ((reg1a_sourceA_direction > 0) ? a_hi : a_lo) & 0x1ffffc;
+    memcpy(srca_data, &mem_ram[srca_data_offs], 4);
+
+    if (reg07_sourceA_step == 0) {
+        /* source A is fetched once, the destination does not change it */
+        words = 1;
+        sourceA = mem_ram[a_lo];
+        switch (reg1e_mintermALU) {
+            case 0: value = 0x00; break;
+            case 1: value = 0xff; break;
+            case 2: case 5: value = (uint8_t)~sourceA; break;
+            default: value = sourceA; break;
+        }
+        memset(&mem_ram[d_lo], value, (size_t)count);
+        srca_fetched = (count == 1);
+    } else {
+        words = (a_hi >> 2) - (a_lo >> 2) + 1;
+        switch (reg1e_mintermALU) {
+            case 0:
+            case 1:
+                memset(&mem_ram[d_lo], (reg1e_mintermALU == 0) ? 0x00 : 0xff, (size_t)count);
+                break;
+            case 2:
+            case 5:
+                for (i = 0; i < count; i++) {
+                    mem_ram[d_lo + i] = (uint8_t)~mem_ram[a_lo + i];
+                }
+                break;
+            default:
+                memcpy(&mem_ram[d_lo], &mem_ram[a_lo], (size_t)count);
+                break;
+        }
+        a = (reg1a_sourceA_direction > 0) ? a_hi : a_lo;
+        sourceA = mem_ram[a];
+        srca_fetched = (count == 1)
+                       || ((a & ~3) != ((a - reg1a_sourceA_direction) & ~3));
+    }
+
+    sourceB = 0;
+    lastA = sourceA;
+    blit_sourceA_off += reg07_sourceA_step * reg1a_sourceA_direction * count;
+    blit_sourceB_off += reg0f_sourceB_step * reg1a_sourceB_direction * count;
+    blit_dest_off += reg17_dest_step * reg1a_dest_direction * count;
+    sourceA_line_off += count;
+    sourceB_line_off += count;
+    dest_line_off += count;
+    blitter_count = 0;
+
+    /* a cycle for every byte written plus one for every word fetched */
+    blitter_bulk_cycles = count + words;
+    return 1;
+}
+
+/* Do the whole blit at once, stepping it without the cycles in between
+   unless it is a plain line copy or fill.  */
+static void blitter_bulk(void)
+{
+    int cycles = 0;
+
+#ifdef DEBUG
+    if (blitter_log_enabled) {
+        perform_blitter_cycle();
+        return;
+    }
+#endif
+    if (blitter_count > 0 && blitter_bulk_line()) {
+        cycles = blitter_bulk_cycles;
+    } else {
+        do {
+            perform_blitter_cycle();
+            cycles++;
+        } while (blitter_state != BLITTER_IDLE);
+    }
+
+    /* this cycle is the first of the blit */
+    blitter_bulk_cycles = cycles - 1;
+    blitter_state = (blitter_bulk_cycles > 0) ? BLITTER_BULK : BLITTER_IDLE;
+}
+
 
 /* ------------------------------------------------------------------------- */
 
@@ -385,6 +512,7 @@ void c64dtvblitter_trigger_blitter(void)
         srcb_data_offs = -1;
 
         blitter_state = BLITTER_READ_A;
+        blitter_bulk_check = 1;
 
         if (GET_REG8(0x1a) & 0x80) {
             blitter_irq = 1;
@@ -530,7 +658,16 @@ void c64dtv_blitter_store(uint16_t addr, uint8_t value)
 
 void c64dtvblitter_perform_blitter(void)
 {
-    perform_blitter_cycle();
+    if (blitter_state == BLITTER_BULK) {
+        if (--blitter_bulk_cycles <= 0) {
+            blitter_state = BLITTER_IDLE;
+        }
+    } else if (blitter_bulk_check) {
+        blitter_bulk_check = 0;
+        blitter_bulk();
+    } else {
+        perform_blitter_cycle();
+    }
 
     if (blitter_state == BLITTER_IDLE) {
         c64dtv_blitter_done();
@@ -628,11 +765,12 @@ int c64dtvblitter_cmdline_options_init(void)
    DWORD | source B line off | source B line offset
    DWORD | dest line off     | destination line offset
    BYTE  | last A            | last A
+   DWORD | bulk cycles       | cycles left of a blit done at once (V0.1)
  */
 
 static const char snap_module_name[] = "C64DTVBLITTER";
 #define SNAP_MAJOR 0
-#define SNAP_MINOR 0
+#define SNAP_MINOR 1
 
 /* static log_t c64_snapshot_log = LOG_ERR; */
 
@@ -668,7 +806,8 @@ int c64dtvblitter_snapshot_write_module(snapshot_t *s)
         || SMW_DW(m, sourceA_line_off) < 0
         || SMW_DW(m, sourceB_line_off) < 0
         || SMW_DW(m, dest_line_off) < 0
-        || SMW_B(m, lastA) < 0) {
+        || SMW_B(m, lastA) < 0
+        || SMW_DW(m, blitter_bulk_cycles) < 0) {
         snapshot_module_close(m);
         return -1;
     }
@@ -721,6 +860,14 @@ int c64dtvblitter_snapshot_read_module(snapshot_t *s)
     }
 
     blitter_state = temp_blitter_state;
+    blitter_bulk_check = 0;
+    blitter_bulk_cycles = 0;
+
+    if (!snapshot_version_is_smaller(major_version, minor_version, 0, 1)) {
+        if (SMR_DW_INT(m, &blitter_bulk_cycles) < 0) {
+            goto fail;
+        }
+    }
 
     for (i = 0; i < 0x20; ++i) {
         c64dtv_blitter_store((uint16_t)i, c64dtvmem_blitter[i]);
@@ -30,6 +30,8 @@
 
 #include "vice.h"
 
+#include <string.h>
+
 #include "c64mem.h"
 #include "c64dtvmem.h"
 #include "c64dtvflash.h"
@@ -69,12 +71,17 @@ static int dma_log_enabled = 0;
 static uint8_t dma_data;
 static uint8_t dma_data_swap;
 static int dma_count;
-static enum { DMA_IDLE, DMA_READ, DMA_READ_SWAP, DMA_WRITE_SWAP, DMA_WRITE } dma_state;
+static enum { DMA_IDLE, DMA_READ, DMA_READ_SWAP, DMA_WRITE_SWAP, DMA_WRITE, DMA_BULK } dma_state;
 static int source_line_off = 0;
 static int dest_line_off = 0;
 static uint8_t source_memtype = 0x00;
 static uint8_t dest_memtype = 0x00;
 
+/* A transfer that only touches RAM is done in one go in its first cycle,
+   DMA_BULK then counts down the cycles it would have taken.  */
+static int dma_bulk_check = 0;
+static int dma_bulk_cycles = 0;
+
 #define GET_REG24(a) ((c64dtvmem_dma[a + 2] << 16) | (c64dtvmem_dma[a + 1] << 8) | c64dtvmem_dma[a])
 #define GET_REG16(a) ((c64dtvmem_dma[a + 1] << 8) | c64dtvmem_dma[a])
 #define GET_REG8(a) (c64dtvmem_dma[a])
@@ -126,6 +133,8 @@ void c64dtvdma_reset(void)
     dma_data = 0x00;
     source_line_off = 0;
     dest_line_off = 0;
+    dma_bulk_check = 0;
+    dma_bulk_cycles = 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -250,6 +259,120 @@ static inline void update_counters(void)
     }
 }
 
+/* Get the range of RAM offsets one side of the transfer touches in `count'
+   accesses moving by at most `step' each.  Return 0 if the range wraps
+   around the end of the RAM.  */
+static int dma_range(int offs, int step, int direction, int count, int *lo, int *hi)
+{
+    int64_t span = (int64_t)step * (count - 1);
+    int64_t first = (direction > 0) ? offs : offs - span;
+    int64_t last = first + span;
+
+    if (first < 0 || (first >> 21) != (last >> 21)) {
+        return 0;
+    }
+    *lo = (int)(first & 0x1fffff);
+    *hi = (int)(last & 0x1fffff);
+    return 1;
+}
+
+/* Return nonzero if all accesses of one side of the transfer go to RAM
+   (or nowhere), without flash or I/O.  */
+static int dma_side_is_ram(int offs, uint8_t memtype, int step, int modulo, int direction)
+{
+    int lo, hi;
+
+    switch (memtype) {
+        case 0x40: /* RAM */
+        case 0xc0: /* unknown */
+            return 1;
+        case 0x80: /* RAM+registers */
+            if (!dma_range(offs, (modulo > step) ? modulo : step, direction, dma_count, &lo, &hi)) {
+                return 0;
+            }
+            return (hi < 0xd000) || (lo >= 0xe000);
+        default:
+            return 0;
+    }
+}
+
+/* Do the whole transfer at once if it only touches RAM.  Linear copies and
+   fills that do not overlap are done with memcpy() and memset(), the rest
+   steps the transfer without the cycles in between.  Return 0 if the
+   transfer has to be stepped cycle by cycle.  */
+static int dma_bulk(void)
+{
+    int source_step = GET_REG16(0x06);
+    int dest_step = GET_REG16(0x08);
+    int source_modulo = GET_REG16(0x0c);
+    int dest_modulo = GET_REG16(0x0e);
+    int source_line_length = GET_REG16(0x10);
+    int dest_line_length = GET_REG16(0x12);
+    int source_modulo_enable = GET_REG8(0x1e) & 0x01;
+    int dest_modulo_enable = GET_REG8(0x1e) & 0x02;
+    int source_direction = (GET_REG8(0x1f) & 0x04) ? +1 : -1;
+    int dest_direction = (GET_REG8(0x1f) & 0x08) ? +1 : -1;
+    int swap = GET_REG8(0x1f) & 0x02;
+    int count = dma_count;
+    int source_lines = source_modulo_enable && (source_line_length < count);
+    int dest_lines = dest_modulo_enable && (dest_line_length < count);
+    int slo, shi, dlo, dhi;
+
+    if (!source_lines) {
+        source_modulo = 0;
+    }
+    if (!dest_lines) {
+        dest_modulo = 0;
+    }
+
+#ifdef DEBUG
+    if (dma_log_enabled) {
+        return 0;
+    }
+#endif
+    if (!dma_side_is_ram(dma_source_off, source_memtype, source_step, source_modulo, source_direction)
+        || !dma_side_is_ram(dma_dest_off, dest_memtype, dest_step, dest_modulo, dest_direction)) {
+        return 0;
+    }
+
+    if (!swap && !source_lines && !dest_lines
+        && source_memtype != 0xc0 && dest_memtype != 0xc0
+        && dest_step == 1 && (source_step == 0 || source_direction == dest_direction)
+        && (source_step == 0 || source_step == 1)
+        && dma_range(dma_source_off, source_step, source_direction, count, &slo, &shi)
+        && dma_range(dma_dest_off, dest_step, dest_direction, count, &dlo, &dhi)
+        && (shi < dlo || slo > dhi)) {
+        if (source_step == 0) {
+            memset(&mem_ram[dlo], mem_ram[slo], (size_t)count);
+            dma_data = mem_ram[slo];
+        } else {
+            memcpy(&mem_ram[dlo], &mem_ram[slo], (size_t)count);
+            dma_data = mem_ram[(source_direction > 0) ? shi : slo];
+        }
+        dma_source_off += source_step * source_direction * count;
+        dma_dest_off += dest_direction * count;
+        source_line_off += count;
+        dest_line_off += count;
+        dma_count = 0;
+    } else {
+        while (dma_count > 0) {
+            do_dma_read(0);
+            if (swap) {
+                do_dma_read(1);
+                do_dma_write(1);
+            }
+            do_dma_write(0);
+            update_counters();
+            dma_count--;
+        }
+    }
+
+    /* this cycle is the first of the transfer */
+    dma_bulk_cycles = count * (swap ? 4 : 2) - 1;
+    dma_state = DMA_BULK;
+    return 1;
+}
+
 static inline void perform_dma_cycle(void)
 {
     int swap = GET_REG8(0x1f) & 0x02;
@@ -262,6 +385,12 @@ static inline void perform_dma_cycle(void)
                 dma_state = DMA_IDLE;
                 break;
             }
+            if (dma_bulk_check) {
+                dma_bulk_check = 0;
+                if (dma_bulk()) {
+                    break;
+                }
+            }
             do_dma_read(0);
             if (swap) {
                 dma_state = DMA_READ_SWAP;
@@ -288,6 +417,11 @@ static inline void perform_dma_cycle(void)
                 dma_state = DMA_READ;
             }
             break;
+        case DMA_BULK:
+            if (--dma_bulk_cycles <= 0) {
+                dma_state = DMA_IDLE;
+            }
+            break;
         default:
 #ifdef DEBUG
             log_message(c64dtvdma_log, "invalid state in perform_dma_cycle()");
@@ -334,6 +468,7 @@ void c64dtvdma_trigger_dma(void)
         dest_line_off = 0;
 
         dma_state = DMA_READ;
+        dma_bulk_check = 1;
 
         if (GET_REG8(0x1f) & 0x80) {
             dma_irq = 1;
@@ -503,11 +638,12 @@ int c64dtvdma_cmdline_options_init(void)
    DWORD | dest line off   | destination line offset
    BYTE  | source mem type | source memory type
    BYTE  | dest mem type   | destination memory type
+   DWORD | bulk cycles     | cycles left of a transfer done at once (V0.1)
  */
 
 static const char snap_module_name[] = "C64DTVDMA";
 #define SNAP_MAJOR 0
-#define SNAP_MINOR 0
+#define SNAP_MINOR 1
 
 /* static log_t c64_snapshot_log = LOG_ERR; */
 
@@ -537,7 +673,8 @@ int c64dtvdma_snapshot_write_module(snapshot_t *s)
         || SMW_DW(m, source_line_off) < 0
         || SMW_DW(m, dest_line_off) < 0
         || SMW_B(m, source_memtype) < 0
-        || SMW_B(m, dest_memtype) < 0) {
+        || SMW_B(m, dest_memtype) < 0
+        || SMW_DW(m, dma_bulk_cycles) < 0) {
         snapshot_module_close(m);
         return -1;
     }
@@ -584,6 +721,14 @@ int c64dtvdma_snapshot_read_module(snapshot_t *s)
     }
 
     dma_state = temp_dma_state;
+    dma_bulk_check = 0;
+    dma_bulk_cycles = 0;
+
+    if (!snapshot_version_is_smaller(major_version, minor_version, 0, 1)) {
+        if (SMR_DW_INT(m, &dma_bulk_cycles) < 0) {
+            goto fail;
+        }
+    }
 
     return snapshot_module_close(m);
 
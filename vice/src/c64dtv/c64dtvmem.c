@@ -406,16 +406,21 @@ void mem_initialize_memory(void)
 
 void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit)
 {
-#ifdef FEATURE_CPUMEMHISTORY
-    *base = NULL;
-    *start = addr;
-    *limit = 0;
-#else
     int bank = addr >> 14;
     int paddr;
     uint8_t *p;
     uint32_t limits;
 
+#ifdef FEATURE_CPUMEMHISTORY
+    /* fetch the opcodes through mem_read() while the memmap is collected */
+    if (monitor_cpuhistory_enabled) {
+        *base = NULL;
+        *start = addr;
+        *limit = 0;
+        return;
+    }
+#endif
+
     if ((((dtv_registers[8] >> (bank * 2)) & 0x03) == 0x00)) {
         if (c64dtvflash_state) {
             *base = NULL; /* not idle */
@@ -480,7 +485,6 @@ void mem_mmu_translate(unsigned int addr, uint8_t **base, int *start, int *limit
         *limit = (addr & 0xc000) | 0x3ffd;
         *start = addr & 0xc000;
     }
-#endif
 }
 
 /* ------------------------------------------------------------------------- */
@@ -53,6 +53,10 @@ int cartridge_detect(const char *filename);
 /* attach (and enable) a cartridge by type and filename (takes crt and bin files) */
 int cartridge_attach_image(int type, const char *filename);
 
+/* attach a CRT image already in memory, filename names where it came from
+   (C64 and C128 only, the other machines return -1) */
+int cartridge_attach_image_from_memory(const uint8_t *data, size_t size, const char *filename);
+
 /* enable cartridge by type. loads default image if any.
    should be used by the UI instead of using the resources directly */
 int cartridge_enable(int type);
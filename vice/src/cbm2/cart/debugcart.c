@@ -28,9 +28,11 @@
 
 /*#include "cbm2export.h"*/
 #include "archdep.h"
+#include "batch.h"
 #include "cartio.h"
 #include "cartridge.h"
 #include "cmdline.h"
+#include "forkserver.h"
 #include "lib.h"
 #include "resources.h"
 #include "machine.h"
@@ -74,9 +76,13 @@ static io_source_list_t *debugcart_list_item = NULL;
 static void debugcart_store(uint16_t addr, uint8_t value)
 {
     int n = (int)value;
+
+    if (forkserver_debugcart_write(value)) {
+        return;
+    }
     fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %"PRIu64"\n", n, maincpu_clk);
 
-    archdep_vice_exit(n);
+    batch_vice_exit(n);
 }
 
 /* ------------------------------------------------------------------------- */
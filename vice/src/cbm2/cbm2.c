@@ -1027,6 +1027,24 @@ int machine_read_snapshot(const char *name, int event_mode)
     return err;
 }
 
+snapshot_t *machine_write_snapshot_mem(int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s = cbm2_snapshot_write_mem(save_roms, save_disks, event_mode);
+    if ((s == NULL) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_WRITE_SNAPSHOT);
+    }
+    return s;
+}
+
+int machine_read_snapshot_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    int err = cbm2_snapshot_read_mem(data, size, event_mode);
+    if ((err < 0) && (snapshot_get_error() == SNAPSHOT_NO_ERROR)) {
+        snapshot_set_error(SNAPSHOT_CANNOT_READ_SNAPSHOT);
+    }
+    return err;
+}
+
 /* ------------------------------------------------------------------------- */
 
 int machine_autodetect_psid(const char *name)
@@ -58,17 +58,8 @@
 #define SNAP_MAJOR          0
 #define SNAP_MINOR          0
 
-int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
-                        int event_mode)
+static int cbm2_snapshot_write_modules(snapshot_t *s, int save_roms, int save_disks, int event_mode)
 {
-    snapshot_t *s;
-
-    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_get_name());
-
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     if (maincpu_snapshot_write_module(s) < 0
@@ -87,6 +78,24 @@ int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
         || keyboard_snapshot_write_module(s) < 0
         || joyport_snapshot_write_module(s, JOYPORT_1) < 0
         || joyport_snapshot_write_module(s, JOYPORT_2) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
+                        int event_mode)
+{
+    snapshot_t *s;
+
+    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_get_name());
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (cbm2_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
         snapshot_close(s);
         archdep_remove(name);
         return -1;
@@ -96,17 +105,26 @@ int cbm2_snapshot_write(const char *name, int save_roms, int save_disks,
     return 0;
 }
 
-int cbm2_snapshot_read(const char *name, int event_mode)
+snapshot_t *cbm2_snapshot_write_mem(int save_roms, int save_disks, int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
-
-    s = snapshot_open(name, &major, &minor, machine_get_name());
 
+    s = snapshot_create_mem(SNAP_MAJOR, SNAP_MINOR, machine_get_name());
     if (s == NULL) {
-        return -1;
+        return NULL;
     }
 
+    if (cbm2_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+/* Read the modules of an opened snapshot; `s' is closed in any case.  */
+static int cbm2_snapshot_read_modules(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -135,6 +153,8 @@ int cbm2_snapshot_read(const char *name, int event_mode)
         goto fail;
     }
 
+    snapshot_close(s);
+
     sound_snapshot_finish();
 
     return 0;
@@ -148,3 +168,30 @@ fail:
 
     return -1;
 }
+
+int cbm2_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_get_name());
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    return cbm2_snapshot_read_modules(s, major, minor, event_mode);
+}
+
+int cbm2_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open_mem(data, size, &major, &minor, machine_get_name());
+    if (s == NULL) {
+        return -1;
+    }
+
+    return cbm2_snapshot_read_modules(s, major, minor, event_mode);
+}
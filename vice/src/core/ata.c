@@ -35,6 +35,7 @@
 #include <string.h>
 
 #include "archdep.h"
+#include "blockimage.h"
 #include "log.h"
 #include "ata.h"
 #include "snapshot.h"
@@ -78,7 +79,8 @@ struct ata_drive_s {
     uint8_t packet[12];
     int bufp;
     uint8_t *buffer;
-    FILE *file;
+    blockimage_t *image;
+    int image_sector; /* of the next sector read or written */
     char *filename;
     char *myname;
     ata_drive_geometry_t geometry;
@@ -231,7 +233,7 @@ static int seek_sector(ata_drive_t *drv)
         lba = (drv->cylinder * drv->heads + drv->head) * drv->sectors + drv->sector - 1;
     }
 
-    if (!drv->file) {
+    if (!drv->image) {
         drv->error = drv->atapi ? 0x24 : ATA_ABRT;
         return drv->error;
     }
@@ -242,9 +244,7 @@ static int seek_sector(ata_drive_t *drv)
     drv->busy |= 2;
     alarm_set(drv->head_alarm, maincpu_clk + (CLOCK)(abs(drv->pos - lba) * drv->seek_time / drv->geometry.size));
     ata_change_power_mode(drv, 0xff);
-    if (archdep_fseeko(drv->file, (off_t)lba * drv->sector_size, SEEK_SET)) {
-        drv->error = drv->atapi ? 0x54 : ATA_IDNF;
-    }
+    drv->image_sector = lba;
     drv->pos = lba;
     return drv->error;
 }
@@ -270,23 +270,19 @@ static int read_sector(ata_drive_t *drv)
         return drv->error;
     }
 
-    if (!drv->file) {
+    if (!drv->image) {
         ata_set_command_block(drv);
         drv->error = drv->atapi ? 0x24 : ATA_ABRT;
         drv->cmd = 0x00;
         return drv->error;
     }
 
-    clearerr(drv->file);
-    if (fread(drv->buffer, drv->sector_size, 1, drv->file) != 1) {
-        memset(drv->buffer, 0, drv->sector_size);
-    }
-
-    if (ferror(drv->file)) {
+    if (blockimage_read(drv->image, drv->buffer, (off_t)drv->image_sector * drv->sector_size, drv->sector_size) < 0) {
         ata_set_command_block(drv);
         drv->error = drv->atapi ? 0x54 : (ATA_UNC | ATA_ABRT);
         drv->cmd = 0x00;
     } else {
+        drv->image_sector++;
         drv->pos++;
         drv->bufp = 0;
     }
@@ -305,7 +301,7 @@ static int write_sector(ata_drive_t *drv)
         return drv->error;
     }
 
-    if (!drv->file) {
+    if (!drv->image) {
         ata_set_command_block(drv);
         drv->error = drv->atapi ? 0x24 : ATA_ABRT;
         drv->cmd = 0x00;
@@ -319,16 +315,17 @@ static int write_sector(ata_drive_t *drv)
         return drv->error;
     }
 
-    if (fwrite(drv->buffer, 1, drv->sector_size, drv->file) != (size_t)drv->sector_size) {
+    if (blockimage_write(drv->image, drv->buffer, (off_t)drv->image_sector * drv->sector_size, drv->sector_size) < 0) {
         ata_set_command_block(drv);
         drv->error = drv->atapi ? 0x54 : (ATA_UNC | ATA_ABRT);
         drv->cmd = 0x00;
     } else {
+        drv->image_sector++;
         drv->pos++;
     }
 
     if (!drv->wcache) {
-        if (fflush(drv->file)) {
+        if (blockimage_flush(drv->image)) {
             ata_set_command_block(drv);
             drv->error = drv->atapi ? 0x54 : (ATA_UNC | ATA_ABRT);
             drv->cmd = 0x00;
@@ -531,7 +528,7 @@ ata_drive_t *ata_init(int drive)
 
     drv->myname = lib_msprintf("ATA%d", drive);
     drv->log = log_open(drv->myname);
-    drv->file = NULL;
+    drv->image = NULL;
     drv->filename = NULL;
     drv->buffer = lib_malloc(2048);
     drv->slave = drive & 1;
@@ -720,8 +717,8 @@ static void ata_execute_command(ata_drive_t *drv, uint8_t value)
                 break;
             }
             debug((drv->log, "FLUSH CACHE"));
-            if (drv->file) {
-                if (fflush(drv->file)) {
+            if (drv->image) {
+                if (blockimage_flush(drv->image)) {
                     drv->error = drv->atapi ? 0x54 : (ATA_UNC | ATA_ABRT);
                 }
             }
@@ -825,8 +822,8 @@ static void ata_execute_command(ata_drive_t *drv, uint8_t value)
                 case 0x82:
                     debug((drv->log, "SET DISABLE WRITE CACHE"));
                     drv->wcache = 0;
-                    if (drv->file) {
-                        fflush(drv->file);
+                    if (drv->image) {
+                        blockimage_flush(drv->image);
                     }
                     return;
                 case 0x99:
@@ -962,7 +959,7 @@ static void atapi_packet_execute_command(ata_drive_t *drv)
                     ata_change_power_mode(drv, 0xff);
                     break;
                 case 2:
-                    if (drv->file) {
+                    if (drv->image) {
                         if (drv->locked) {
                             drv->error = 0x24;
                         } else {
@@ -972,9 +969,9 @@ static void atapi_packet_execute_command(ata_drive_t *drv)
                     }
                     break;
                 case 3:
-                    if (!drv->file) {
+                    if (!drv->image) {
                         ata_image_attach(drv, drv->filename, drv->type, drv->geometry);
-                        if (!drv->file) {
+                        if (!drv->image) {
                             drv->error = 0x24;
                         } else {
                             ata_change_power_mode(drv, 0xff);
@@ -995,7 +992,7 @@ static void atapi_packet_execute_command(ata_drive_t *drv)
             result[5] = drv->geometry.size >> 16;
             result[6] = drv->geometry.size >> 8;
             result[7] = drv->geometry.size;
-            result[8] = drv->file ? 2 : 3;
+            result[8] = drv->image ? 2 : 3;
             result[10] = drv->sector_size >> 8;
             result[11] = drv->sector_size;
 
@@ -1188,7 +1185,7 @@ void ata_register_store(ata_drive_t *drv, uint16_t addr, uint16_t value)
                                     drv->bufp = 0;
                                     return;
                                 }
-                                if (!drv->file || fflush(drv->file)) {
+                                if (!drv->image || blockimage_flush_deferred(drv->image)) {
                                     drv->error = drv->atapi ? 0x54 : (ATA_UNC | ATA_ABRT);
                                     break;
                                 }
@@ -1252,9 +1249,9 @@ void ata_register_store(ata_drive_t *drv, uint16_t addr, uint16_t value)
 
 void ata_image_attach(ata_drive_t *drv, char *filename, ata_drive_type_t type, ata_drive_geometry_t geometry)
 {
-    if (drv->file != NULL) {
-        fclose(drv->file);
-        drv->file = NULL;
+    if (drv->image != NULL) {
+        blockimage_close(drv->image);
+        drv->image = NULL;
     }
 
     if (drv->filename != filename) {
@@ -1264,11 +1261,16 @@ void ata_image_attach(ata_drive_t *drv, char *filename, ata_drive_type_t type, a
 
     if (type != ATA_DRIVE_NONE) {
         if (drv->filename && drv->filename[0]) {
+            FILE *fd = NULL;
+
             if (type != ATA_DRIVE_CD) {
-                drv->file = fopen(drv->filename, MODE_READ_WRITE);
+                fd = fopen(drv->filename, MODE_READ_WRITE);
             }
-            if (!drv->file) {
-                drv->file = fopen(drv->filename, MODE_READ);
+            if (!fd) {
+                fd = fopen(drv->filename, MODE_READ);
+            }
+            if (fd) {
+                drv->image = blockimage_open(fd);
             }
         }
 
@@ -1296,7 +1298,7 @@ void ata_image_attach(ata_drive_t *drv, char *filename, ata_drive_type_t type, a
         drv->attention = 1; /* disk change only */
     }
 
-    if (drv->file) {
+    if (drv->image) {
         if (drv->atapi) {
             log_message(drv->log, "Attached `%s' %u sectors total.",
                     drv->filename, (unsigned int)drv->geometry.size);
@@ -1316,9 +1318,11 @@ void ata_image_attach(ata_drive_t *drv, char *filename, ata_drive_type_t type, a
 
 void ata_image_detach(ata_drive_t *drv)
 {
-    if (drv->file != NULL) {
-        fclose(drv->file);
-        drv->file = NULL;
+    if (drv->image != NULL) {
+        if (blockimage_close(drv->image) < 0) {
+            log_error(drv->log, "Cannot write the changes to `%s'.", drv->filename);
+        }
+        drv->image = NULL;
         log_message(drv->log, "Detached.");
     }
     return;
@@ -1368,7 +1372,6 @@ int ata_snapshot_write_module(ata_drive_t *drv, snapshot_t *s)
     CLOCK spindle_clk = CLOCK_MAX;
     CLOCK head_clk = CLOCK_MAX;
     CLOCK standby_clk = CLOCK_MAX;
-    off_t pos = 0;
 
     m = snapshot_module_create(s, drv->myname,
                                CART_DUMP_VER_MAJOR, CART_DUMP_VER_MINOR);
@@ -1385,12 +1388,6 @@ int ata_snapshot_write_module(ata_drive_t *drv, snapshot_t *s)
     if (drv->standby) {
         standby_clk = drv->standby_alarm->context->pending_alarms[drv->standby_alarm->pending_idx].clk;
     }
-    if (drv->file) {
-        pos = archdep_ftello(drv->file);
-        if (pos < 0) {
-            pos = 0;
-        }
-    }
 
     SMW_STR(m, drv->filename);
     SMW_DW(m, drv->type);
@@ -1415,7 +1412,7 @@ int ata_snapshot_write_module(ata_drive_t *drv, snapshot_t *s)
     SMW_B(m, (uint8_t)drv->heads);
     SMW_B(m, (uint8_t)drv->sectors);
     SMW_DW(m, drv->pos);
-    SMW_DW(m, (uint32_t)(pos / drv->sector_size));
+    SMW_DW(m, (uint32_t)drv->image_sector);
     SMW_B(m, (uint8_t)drv->wcache);
     SMW_B(m, (uint8_t)drv->lookahead);
     SMW_B(m, (uint8_t)drv->busy);
@@ -1556,9 +1553,7 @@ int ata_snapshot_read_module(ata_drive_t *drv, snapshot_t *s)
         alarm_unset(drv->standby_alarm);
     }
 
-    if (drv->file) {
-        archdep_fseeko(drv->file, (off_t)pos * drv->sector_size, SEEK_SET);
-    }
+    drv->image_sector = pos;
     if (!drv->atapi) { /* atapi supports disc change events */
         drv->readonly = 1; /* make sure for ata that there's no filesystem corruption */
     }
@@ -0,0 +1,582 @@
+/*
+ * blockimage.c - Cached block access to hard disk and memory card images.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The images of the ATA drives and the SD/MMC cards are accessed through a
+   direct mapped cache of 4 KiB blocks.  For every 512 byte unit of a block
+   it is known whether it holds the contents of the file and whether it was
+   changed, so that whole sectors can be written without reading the block
+   first.
+
+   A miss during sequential reads reads the following blocks too, in one
+   go.  Changes stay in the cache; the changed units of all blocks are
+   merged into runs when they are written, which happens when a changed
+   block has to make room for another one, when the drive asks for it and
+   when the image is closed.
+
+   Built with --enable-image-writeback, every image has a thread of its own
+   that reads ahead of sequential reads and writes the changes once the
+   image was not written to for a while, so the emulation does not wait for
+   the host in these cases.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#ifdef USE_IMAGE_WRITEBACK
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#include "archdep.h"
+#include "blockimage.h"
+#include "lib.h"
+#include "log.h"
+#include "types.h"
+
+#define BLOCKIMAGE_UNIT         512
+#define BLOCKIMAGE_UNITS        8       /* per block, one bit each in the masks */
+#define BLOCKIMAGE_BLOCK_SIZE   (BLOCKIMAGE_UNIT * BLOCKIMAGE_UNITS)
+#define BLOCKIMAGE_BLOCKS       256     /* 1 MiB per image */
+#define BLOCKIMAGE_READAHEAD    16      /* blocks read at once on sequential reads */
+#define BLOCKIMAGE_IDLE_MS      500     /* the thread writes the changes after this */
+
+#define BLOCKIMAGE_ALL_UNITS    0xff
+
+typedef struct blockimage_block_s {
+    off_t base;         /* offset of the block in the file, -1 if unused */
+    uint8_t valid;      /* units holding the contents of the file */
+    uint8_t dirty;      /* units changed, but not written to the file yet */
+} blockimage_block_t;
+
+typedef struct blockimage_run_s {
+    off_t offset;
+    size_t len;
+    size_t pos;         /* of the data in io_buf */
+} blockimage_run_t;
+
+typedef struct blockimage_order_s {
+    off_t base;
+    int slot;
+} blockimage_order_t;
+
+struct blockimage_s {
+    FILE *fd;
+    off_t size;                 /* of the file, with the changes */
+    uint8_t *data;              /* BLOCKIMAGE_BLOCKS blocks */
+    uint8_t *io_buf;            /* used by whoever has the file */
+    blockimage_block_t block[BLOCKIMAGE_BLOCKS];
+    blockimage_order_t order[BLOCKIMAGE_BLOCKS];
+    blockimage_run_t run[BLOCKIMAGE_BLOCKS * BLOCKIMAGE_UNITS / 2];
+    off_t last_block;           /* read last, to detect sequential reads */
+    int error;                  /* a write failed, reported by the next flush */
+#ifdef USE_IMAGE_WRITEBACK
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    int thread_running;
+    int quit;
+    int busy;                   /* the file is used by a thread without the lock */
+    int64_t last_write;         /* ms, 0 if there is nothing to write */
+    off_t readahead_first;      /* blocks the thread is asked to read */
+    int readahead_count;
+#endif
+};
+
+#ifdef USE_IMAGE_WRITEBACK
+#define BLOCKIMAGE_LOCK(img)    pthread_mutex_lock(&(img)->lock)
+#define BLOCKIMAGE_UNLOCK(img)  pthread_mutex_unlock(&(img)->lock)
+#else
+#define BLOCKIMAGE_LOCK(img)
+#define BLOCKIMAGE_UNLOCK(img)
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+/* The file is used without holding the lock by one thread at a time, the
+   blocks are only touched with the lock held.  Both are called with the
+   lock held.  */
+static void blockimage_file_take(blockimage_t *img)
+{
+#ifdef USE_IMAGE_WRITEBACK
+    while (img->busy) {
+        pthread_cond_wait(&img->cond, &img->lock);
+    }
+    img->busy = 1;
+#endif
+}
+
+static void blockimage_file_release(blockimage_t *img)
+{
+#ifdef USE_IMAGE_WRITEBACK
+    img->busy = 0;
+    pthread_cond_broadcast(&img->cond);
+#endif
+}
+
+/* Read `count' blocks from block `first' on into io_buf, with zeros past
+   the end of the file.  Needs the file.  */
+static int blockimage_file_read(blockimage_t *img, off_t first, int count)
+{
+    size_t len = (size_t)count * BLOCKIMAGE_BLOCK_SIZE;
+    size_t got = 0;
+
+    clearerr(img->fd);
+    if (archdep_fseeko(img->fd, first * BLOCKIMAGE_BLOCK_SIZE, SEEK_SET) != 0) {
+        return -1;
+    }
+    got = fread(img->io_buf, 1, len, img->fd);
+    if (ferror(img->fd)) {
+        return -1;
+    }
+    memset(img->io_buf + got, 0, len - got);
+    return 0;
+}
+
+/* Put the blocks read by blockimage_file_read() into the cache.  Changed
+   units are kept, and so are blocks with changes or being loaded.  */
+static void blockimage_install(blockimage_t *img, off_t first, int count)
+{
+    int i, u;
+
+    for (i = 0; i < count; i++) {
+        off_t base = (first + i) * BLOCKIMAGE_BLOCK_SIZE;
+        int slot = (int)((first + i) % BLOCKIMAGE_BLOCKS);
+        blockimage_block_t *b = &img->block[slot];
+        uint8_t *src = img->io_buf + (size_t)i * BLOCKIMAGE_BLOCK_SIZE;
+        uint8_t *dst = img->data + (size_t)slot * BLOCKIMAGE_BLOCK_SIZE;
+
+        if (b->base != base) {
+            if (b->dirty || (b->base != -1 && b->valid != BLOCKIMAGE_ALL_UNITS)) {
+                continue;
+            }
+            b->base = base;
+            b->valid = 0;
+        }
+        if (b->valid == 0) {
+            memcpy(dst, src, BLOCKIMAGE_BLOCK_SIZE);
+        } else {
+            for (u = 0; u < BLOCKIMAGE_UNITS; u++) {
+                if (!(b->valid & (1 << u))) {
+                    memcpy(dst + u * BLOCKIMAGE_UNIT, src + u * BLOCKIMAGE_UNIT, BLOCKIMAGE_UNIT);
+                }
+            }
+        }
+        b->valid = BLOCKIMAGE_ALL_UNITS;
+    }
+}
+
+static int blockimage_order_cmp(const void *a, const void *b)
+{
+    off_t base_a = ((const blockimage_order_t *)a)->base;
+    off_t base_b = ((const blockimage_order_t *)b)->base;
+
+    return (base_a > base_b) - (base_a < base_b);
+}
+
+/* Write the changed units of all blocks, merged into runs.  Called with
+   the lock held, which is released while writing.  */
+static int blockimage_flush_locked(blockimage_t *img)
+{
+    int num = 0, runs = 0, err = 0;
+    int i, u;
+    size_t pos = 0;
+    off_t size;
+
+    blockimage_file_take(img);
+
+    for (i = 0; i < BLOCKIMAGE_BLOCKS; i++) {
+        if (img->block[i].dirty) {
+            img->order[num].base = img->block[i].base;
+            img->order[num].slot = i;
+            num++;
+        }
+    }
+    if (num == 0) {
+        blockimage_file_release(img);
+        return img->error ? -1 : 0;
+    }
+    qsort(img->order, (size_t)num, sizeof(blockimage_order_t), blockimage_order_cmp);
+
+    for (i = 0; i < num; i++) {
+        blockimage_block_t *b = &img->block[img->order[i].slot];
+        uint8_t *src = img->data + (size_t)img->order[i].slot * BLOCKIMAGE_BLOCK_SIZE;
+
+        for (u = 0; u < BLOCKIMAGE_UNITS; u++) {
+            off_t offset = b->base + u * BLOCKIMAGE_UNIT;
+
+            if (!(b->dirty & (1 << u))) {
+                continue;
+            }
+            if (runs == 0 || img->run[runs - 1].offset + (off_t)img->run[runs - 1].len != offset) {
+                img->run[runs].offset = offset;
+                img->run[runs].len = 0;
+                img->run[runs].pos = pos;
+                runs++;
+            }
+            memcpy(img->io_buf + pos, src + u * BLOCKIMAGE_UNIT, BLOCKIMAGE_UNIT);
+            img->run[runs - 1].len += BLOCKIMAGE_UNIT;
+            pos += BLOCKIMAGE_UNIT;
+        }
+        b->dirty = 0;
+    }
+    size = img->size;
+#ifdef USE_IMAGE_WRITEBACK
+    img->last_write = 0;
+#endif
+    BLOCKIMAGE_UNLOCK(img);
+
+    for (i = 0; i < runs && !err; i++) {
+        size_t len = img->run[i].len;
+
+        /* a unit at the end may be only partly part of the file */
+        if (img->run[i].offset + (off_t)len > size) {
+            len = (size_t)(size - img->run[i].offset);
+        }
+        if (archdep_fseeko(img->fd, img->run[i].offset, SEEK_SET) != 0
+            || fwrite(img->io_buf + img->run[i].pos, 1, len, img->fd) != len) {
+            err = 1;
+        }
+    }
+    if (fflush(img->fd) != 0) {
+        err = 1;
+    }
+
+    BLOCKIMAGE_LOCK(img);
+    blockimage_file_release(img);
+    if (err) {
+        log_error(LOG_DEFAULT, "Cannot write the changes of an image.");
+        img->error = 1;
+    }
+    return img->error ? -1 : 0;
+}
+
+/* Make the units `units' of block `bn' valid, reading `count' blocks if
+   it is a miss.  Returns with the block in its slot.  Called with the lock
+   held.  */
+static int blockimage_load(blockimage_t *img, off_t bn, uint8_t units, int count)
+{
+    off_t base = bn * BLOCKIMAGE_BLOCK_SIZE;
+    blockimage_block_t *b = &img->block[bn % BLOCKIMAGE_BLOCKS];
+    int err;
+
+    for (;;) {
+        if (b->base == base) {
+            if ((b->valid & units) == units) {
+                return 0;
+            }
+            break;
+        }
+        if (!b->dirty) {
+            b->base = base;
+            b->valid = 0;
+            if (units == 0) {
+                return 0;
+            }
+            break;
+        }
+        /* make room, the slot may have changed meanwhile */
+        if (blockimage_flush_locked(img) < 0) {
+            img->error = 0;
+            return -1;
+        }
+    }
+
+    blockimage_file_take(img);
+    if ((b->valid & units) == units) {
+        blockimage_file_release(img);
+        return 0;
+    }
+    BLOCKIMAGE_UNLOCK(img);
+    err = blockimage_file_read(img, bn, count);
+    BLOCKIMAGE_LOCK(img);
+    if (!err) {
+        blockimage_install(img, bn, count);
+    }
+    blockimage_file_release(img);
+    return err ? -1 : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef USE_IMAGE_WRITEBACK
+
+static int64_t blockimage_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Ask the thread to read the blocks after `bn' if they are not cached
+   already.  Called with the lock held.  */
+static void blockimage_readahead(blockimage_t *img, off_t bn)
+{
+    off_t next;
+
+    if (!img->thread_running) {
+        return;
+    }
+    for (next = bn + 1; next <= bn + BLOCKIMAGE_READAHEAD / 2; next++) {
+        if (img->block[next % BLOCKIMAGE_BLOCKS].base != next * BLOCKIMAGE_BLOCK_SIZE) {
+            if (img->readahead_count == 0 || img->readahead_first != next) {
+                img->readahead_first = next;
+                img->readahead_count = BLOCKIMAGE_READAHEAD;
+                pthread_cond_broadcast(&img->cond);
+            }
+            return;
+        }
+    }
+}
+
+static void *blockimage_thread(void *arg)
+{
+    blockimage_t *img = arg;
+    int64_t due;
+    struct timespec ts;
+
+    BLOCKIMAGE_LOCK(img);
+    while (!img->quit) {
+        if (img->busy) {
+            pthread_cond_wait(&img->cond, &img->lock);
+        } else if (img->readahead_count > 0) {
+            off_t first = img->readahead_first;
+            int count = img->readahead_count;
+
+            img->readahead_count = 0;
+            img->busy = 1;
+            BLOCKIMAGE_UNLOCK(img);
+            if (blockimage_file_read(img, first, count) == 0) {
+                BLOCKIMAGE_LOCK(img);
+                blockimage_install(img, first, count);
+            } else {
+                BLOCKIMAGE_LOCK(img);
+            }
+            blockimage_file_release(img);
+        } else if (img->last_write != 0) {
+            due = img->last_write + BLOCKIMAGE_IDLE_MS;
+            if (due <= blockimage_now()) {
+                blockimage_flush_locked(img);
+            } else {
+                ts.tv_sec = (time_t)(due / 1000);
+                ts.tv_nsec = (long)(due % 1000) * 1000000;
+                pthread_cond_timedwait(&img->cond, &img->lock, &ts);
+            }
+        } else {
+            pthread_cond_wait(&img->cond, &img->lock);
+        }
+    }
+    BLOCKIMAGE_UNLOCK(img);
+
+    return NULL;
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+blockimage_t *blockimage_open(FILE *fd)
+{
+    blockimage_t *img = lib_calloc(1, sizeof(blockimage_t));
+    int i;
+
+    img->fd = fd;
+    img->data = lib_malloc(BLOCKIMAGE_BLOCKS * BLOCKIMAGE_BLOCK_SIZE);
+    img->io_buf = lib_malloc(BLOCKIMAGE_BLOCKS * BLOCKIMAGE_BLOCK_SIZE);
+    for (i = 0; i < BLOCKIMAGE_BLOCKS; i++) {
+        img->block[i].base = -1;
+    }
+    img->last_block = -2;
+
+    if (archdep_fseeko(fd, 0, SEEK_END) == 0) {
+        img->size = archdep_ftello(fd);
+    }
+    if (img->size < 0) {
+        img->size = 0;
+    }
+
+#ifdef USE_IMAGE_WRITEBACK
+    pthread_mutex_init(&img->lock, NULL);
+    pthread_cond_init(&img->cond, NULL);
+    if (pthread_create(&img->thread, NULL, blockimage_thread, img) == 0) {
+        img->thread_running = 1;
+    } else {
+        log_error(LOG_DEFAULT, "Cannot create the image I/O thread.");
+    }
+#endif
+
+    return img;
+}
+
+int blockimage_close(blockimage_t *img)
+{
+    int err;
+
+#ifdef USE_IMAGE_WRITEBACK
+    if (img->thread_running) {
+        BLOCKIMAGE_LOCK(img);
+        img->quit = 1;
+        pthread_cond_broadcast(&img->cond);
+        BLOCKIMAGE_UNLOCK(img);
+        pthread_join(img->thread, NULL);
+    }
+#endif
+
+    BLOCKIMAGE_LOCK(img);
+    err = blockimage_flush_locked(img);
+    BLOCKIMAGE_UNLOCK(img);
+
+    if (fclose(img->fd) != 0) {
+        err = -1;
+    }
+#ifdef USE_IMAGE_WRITEBACK
+    pthread_cond_destroy(&img->cond);
+    pthread_mutex_destroy(&img->lock);
+#endif
+    lib_free(img->io_buf);
+    lib_free(img->data);
+    lib_free(img);
+
+    return err;
+}
+
+int blockimage_read(blockimage_t *img, uint8_t *buf, off_t offset, size_t len)
+{
+    int err = 0;
+
+    BLOCKIMAGE_LOCK(img);
+    while (len > 0 && !err) {
+        off_t bn = offset / BLOCKIMAGE_BLOCK_SIZE;
+        size_t start = (size_t)(offset % BLOCKIMAGE_BLOCK_SIZE);
+        size_t n = BLOCKIMAGE_BLOCK_SIZE - start;
+        int sequential = (bn == img->last_block || bn == img->last_block + 1);
+        uint8_t units;
+
+        if (n > len) {
+            n = len;
+        }
+        units = (uint8_t)((0xff << (start / BLOCKIMAGE_UNIT))
+                          & (0xff >> (BLOCKIMAGE_UNITS - 1 - (start + n - 1) / BLOCKIMAGE_UNIT)));
+
+        err = blockimage_load(img, bn, units, sequential ? BLOCKIMAGE_READAHEAD : 1);
+        if (!err) {
+            memcpy(buf, img->data + (size_t)(bn % BLOCKIMAGE_BLOCKS) * BLOCKIMAGE_BLOCK_SIZE + start, n);
+            img->last_block = bn;
+#ifdef USE_IMAGE_WRITEBACK
+            if (sequential) {
+                blockimage_readahead(img, bn);
+            }
+#endif
+        }
+        buf += n;
+        offset += (off_t)n;
+        len -= n;
+    }
+    BLOCKIMAGE_UNLOCK(img);
+
+    return err ? -1 : 0;
+}
+
+int blockimage_write(blockimage_t *img, const uint8_t *buf, off_t offset, size_t len)
+{
+    int err = 0;
+
+    BLOCKIMAGE_LOCK(img);
+    while (len > 0 && !err) {
+        off_t bn = offset / BLOCKIMAGE_BLOCK_SIZE;
+        size_t start = (size_t)(offset % BLOCKIMAGE_BLOCK_SIZE);
+        size_t n = BLOCKIMAGE_BLOCK_SIZE - start;
+        unsigned int first_unit, last_unit;
+        uint8_t units, partial = 0;
+        blockimage_block_t *b;
+
+        if (n > len) {
+            n = len;
+        }
+        first_unit = (unsigned int)(start / BLOCKIMAGE_UNIT);
+        last_unit = (unsigned int)((start + n - 1) / BLOCKIMAGE_UNIT);
+        units = (uint8_t)((0xff << first_unit) & (0xff >> (BLOCKIMAGE_UNITS - 1 - last_unit)));
+
+        /* units written only in part need the rest from the file */
+        if (start % BLOCKIMAGE_UNIT) {
+            partial |= (uint8_t)(1 << first_unit);
+        }
+        if ((start + n) % BLOCKIMAGE_UNIT) {
+            partial |= (uint8_t)(1 << last_unit);
+        }
+
+        err = blockimage_load(img, bn, partial, 1);
+        if (!err) {
+            b = &img->block[bn % BLOCKIMAGE_BLOCKS];
+            memcpy(img->data + (size_t)(bn % BLOCKIMAGE_BLOCKS) * BLOCKIMAGE_BLOCK_SIZE + start, buf, n);
+            b->valid |= units;
+            b->dirty |= units;
+        }
+        buf += n;
+        offset += (off_t)n;
+        len -= n;
+    }
+    if (offset > img->size) {
+        img->size = offset;
+    }
+#ifdef USE_IMAGE_WRITEBACK
+    if (img->last_write == 0) {
+        pthread_cond_broadcast(&img->cond);
+    }
+    img->last_write = blockimage_now();
+#endif
+    BLOCKIMAGE_UNLOCK(img);
+
+    return err ? -1 : 0;
+}
+
+int blockimage_flush(blockimage_t *img)
+{
+    int err;
+
+    BLOCKIMAGE_LOCK(img);
+    err = blockimage_flush_locked(img);
+    img->error = 0;
+    BLOCKIMAGE_UNLOCK(img);
+
+    return err;
+}
+
+int blockimage_flush_deferred(blockimage_t *img)
+{
+#ifdef USE_IMAGE_WRITEBACK
+    int err;
+
+    if (img->thread_running) {
+        BLOCKIMAGE_LOCK(img);
+        err = img->error ? -1 : 0;
+        img->error = 0;
+        BLOCKIMAGE_UNLOCK(img);
+        return err;
+    }
+#endif
+    return blockimage_flush(img);
+}
@@ -0,0 +1,52 @@
+/*
+ * blockimage.h - Cached block access to hard disk and memory card images.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_BLOCKIMAGE_H
+#define VICE_BLOCKIMAGE_H
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "types.h"
+
+typedef struct blockimage_s blockimage_t;
+
+/* Take over an image file opened with fopen().  */
+blockimage_t *blockimage_open(FILE *fd);
+
+/* Write the changes and close the file.  Returns -1 if a write failed.  */
+int blockimage_close(blockimage_t *img);
+
+/* Read or write `len' bytes at `offset'.  Reads past the end of the file
+   return zeros.  Return 0 on success, -1 on error.  */
+int blockimage_read(blockimage_t *img, uint8_t *buf, off_t offset, size_t len);
+int blockimage_write(blockimage_t *img, const uint8_t *buf, off_t offset, size_t len);
+
+/* Write the changes to the file now.  Returns -1 if this or an earlier
+   write failed.  */
+int blockimage_flush(blockimage_t *img);
+
+/* Same, but with the write-back thread the changes may be left to it.  */
+int blockimage_flush_deferred(blockimage_t *img);
+
+#endif
@@ -149,6 +149,19 @@ inline static void flash_add_sector_to_erase_mask(flash040_context_t *flash040_c
     flash040_context->erase_mask[sector_num >> 3] |= (uint8_t)(1 << (sector_num & 0x7));
 }
 
+static void flash_mark_dirty(flash040_context_t *flash040_context, unsigned int sector)
+{
+    if (sector < 8 * FLASH040_DIRTY_MASK_SIZE) {
+        flash040_context->dirty_mask[sector >> 3] |= (uint8_t)(1 << (sector & 7));
+    }
+    flash040_context->flash_dirty = 1;
+
+    if (flash040_context->flush_delay != 0 && !flash040_context->flush_pending) {
+        alarm_set(flash040_context->flush_alarm, maincpu_clk + flash040_context->flush_delay);
+        flash040_context->flush_pending = 1;
+    }
+}
+
 inline static void flash_erase_sector(flash040_context_t *flash040_context, unsigned int sector)
 {
     unsigned int sector_size = flash_types[flash040_context->flash_type].sector_size;
@@ -158,14 +171,14 @@ inline static void flash_erase_sector(flash040_context_t *flash040_context, unsi
 
     FLASH_DEBUG(("Erasing 0x%x - 0x%x", sector_addr, sector_addr + sector_size - 1));
     memset(&(flash040_context->flash_data[sector_addr]), 0xff, sector_size);
-    flash040_context->flash_dirty = 1;
+    flash_mark_dirty(flash040_context, sector);
 }
 
 inline static void flash_erase_chip(flash040_context_t *flash040_context)
 {
     FLASH_DEBUG(("Erasing chip"));
     memset(flash040_context->flash_data, 0xff, flash_types[flash040_context->flash_type].size);
-    flash040_context->flash_dirty = 1;
+    flash040core_set_dirty(flash040_context);
 }
 
 inline static int flash_program_byte(flash040_context_t *flash040_context, unsigned int addr, uint8_t byte)
@@ -176,7 +189,9 @@ inline static int flash_program_byte(flash040_context_t *flash040_context, unsig
     FLASH_DEBUG(("Programming 0x%05x with 0x%02x (%02x->%02x)", addr, byte, old_data, old_data & byte));
     flash040_context->program_byte = byte;
     flash040_context->flash_data[addr] = new_data;
-    flash040_context->flash_dirty = 1;
+    if (new_data != old_data) {
+        flash_mark_dirty(flash040_context, flash_addr_to_sector_number(flash040_context, addr));
+    }
 
     return (new_data == byte) ? 1 : 0;
 }
@@ -210,6 +225,24 @@ inline static int flash_erase_operation_status(flash040_context_t *flash040_cont
 
 /* -------------------------------------------------------------------------- */
 
+static void flush_alarm_handler(CLOCK offset, void *data)
+{
+    flash040_context_t *flash040_context = (flash040_context_t *)data;
+
+    alarm_unset(flash040_context->flush_alarm);
+
+    /* let an erase or program operation finish first */
+    if (flash040_context->flash_state != FLASH040_STATE_READ) {
+        alarm_set(flash040_context->flush_alarm, maincpu_clk + flash_types[flash040_context->flash_type].erase_sector_cycles);
+        return;
+    }
+
+    flash040_context->flush_pending = 0;
+    if (flash040_context->flush != NULL) {
+        flash040_context->flush(flash040_context);
+    }
+}
+
 static void erase_alarm_handler(CLOCK offset, void *data)
 {
     unsigned int i, j;
@@ -488,12 +521,62 @@ void flash040core_init(struct flash040_context_s *flash040_context,
     flash040_context->program_byte = 0;
     flash_clear_erase_mask(flash040_context);
     flash040_context->flash_dirty = 0;
+    memset(flash040_context->dirty_mask, 0, FLASH040_DIRTY_MASK_SIZE);
     flash040_context->erase_alarm = alarm_new(alarm_context, "Flash040Alarm", erase_alarm_handler, flash040_context);
+    flash040_context->flush_alarm = alarm_new(alarm_context, "Flash040FlushAlarm", flush_alarm_handler, flash040_context);
+    flash040_context->flush_delay = 0;
+    flash040_context->flush_pending = 0;
+    flash040_context->flush = NULL;
 }
 
 void flash040core_shutdown(flash040_context_t *flash040_context)
 {
     FLASH_DEBUG(("Shutdown"));
+    if (flash040_context->flush_alarm != NULL) {
+        alarm_destroy(flash040_context->flush_alarm);
+        flash040_context->flush_alarm = NULL;
+    }
+}
+
+int flash040core_is_dirty(flash040_context_t *flash040_context, unsigned int addr, unsigned int len)
+{
+    unsigned int sector = flash_addr_to_sector_number(flash040_context, addr);
+    unsigned int last = flash_addr_to_sector_number(flash040_context, addr + len - 1);
+
+    for (; sector <= last && sector < 8 * FLASH040_DIRTY_MASK_SIZE; sector++) {
+        if (flash040_context->dirty_mask[sector >> 3] & (1 << (sector & 7))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void flash040core_set_dirty(flash040_context_t *flash040_context)
+{
+    unsigned int sectors = flash_types[flash040_context->flash_type].size / flash_types[flash040_context->flash_type].sector_size;
+    unsigned int i;
+
+    for (i = 0; i < sectors; i++) {
+        flash_mark_dirty(flash040_context, i);
+    }
+}
+
+void flash040core_clear_dirty(flash040_context_t *flash040_context)
+{
+    memset(flash040_context->dirty_mask, 0, FLASH040_DIRTY_MASK_SIZE);
+    flash040_context->flash_dirty = 0;
+}
+
+void flash040core_set_flush(flash040_context_t *flash040_context,
+                            void (*flush)(flash040_context_t *flash040_context),
+                            CLOCK delay)
+{
+    flash040_context->flush = flush;
+    flash040_context->flush_delay = delay;
+    if (delay == 0 && flash040_context->flush_pending) {
+        alarm_unset(flash040_context->flush_alarm);
+        flash040_context->flush_pending = 0;
+    }
 }
 
 /* -------------------------------------------------------------------------- */
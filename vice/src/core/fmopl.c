@@ -633,6 +633,13 @@ inline static void advance(FM_OPL *OPL)
         CH = &OPL->P_CH[i / 2];
         op = &CH->SLOT[i & 1];
 
+        /* An operator of channels 0-5 that is off is not heard, and key on
+           restarts its phase, so its counter need not run.  The phases of
+           channels 6-8 are used by the rhythm sounds even while off.  */
+        if (op->state == EG_OFF && i < 6 * 2) {
+            continue;
+        }
+
         /* Phase Generator */
         if (op->vib) {
             UINT8 block;
@@ -1682,19 +1689,25 @@ int ym3812_timer_over(FM_OPL *chip, int c)
     return OPLTimerOver(chip, c);
 }
 
-/*
-** Generate samples for one of the YM3812's
-**
-** 'which' is the virtual YM3812 number
-** '*buffer' is the output buffer pointer
-** 'length' is the number of samples that should be generated
-*/
-void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
+/* A channel both of whose operators are off and whose feedback has died
+   down adds nothing to the output.  Only key on, which is a register
+   write, gets an operator out of EG_OFF, so a channel that is silent at
+   the start of a block stays silent for all of it.  */
+inline static int OPL_CH_silent(const OPL_CH *CH)
+{
+    return CH->SLOT[SLOT1].state == EG_OFF && CH->SLOT[SLOT2].state == EG_OFF
+           && CH->SLOT[SLOT1].op1_out[0] == 0 && CH->SLOT[SLOT1].op1_out[1] == 0;
+}
+
+/* Generate `length' samples, only calculating the channels that are not
+   silent.  */
+static void OPL_update(FM_OPL *OPL, OPLSAMPLE *buf, int length)
 {
-    FM_OPL *OPL = (FM_OPL *)chip;
     UINT8 rhythm = OPL->rhythm & 0x20;
-    OPLSAMPLE *buf = buffer;
-    int i;
+    OPL_CH *active[9];
+    int num_active = 0;
+    int fm_channels = rhythm ? 6 : 9;
+    int i, c;
 
     if ((void *)OPL != cur_chip) {
         cur_chip = (void *)OPL;
@@ -1704,6 +1717,13 @@ void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
         SLOT8_1 = &OPL->P_CH[8].SLOT[SLOT1];
         SLOT8_2 = &OPL->P_CH[8].SLOT[SLOT2];
     }
+
+    for (c = 0; c < fm_channels; c++) {
+        if (!OPL_CH_silent(&OPL->P_CH[c])) {
+            active[num_active++] = &OPL->P_CH[c];
+        }
+    }
+
     for (i = 0; i < length; i++) {
         int lt;
 
@@ -1712,19 +1732,12 @@ void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
         advance_lfo(OPL);
 
         /* FM part */
-        OPL_CALC_CH(&OPL->P_CH[0]);
-        OPL_CALC_CH(&OPL->P_CH[1]);
-        OPL_CALC_CH(&OPL->P_CH[2]);
-        OPL_CALC_CH(&OPL->P_CH[3]);
-        OPL_CALC_CH(&OPL->P_CH[4]);
-        OPL_CALC_CH(&OPL->P_CH[5]);
-
-        if (!rhythm) {
-            OPL_CALC_CH(&OPL->P_CH[6]);
-            OPL_CALC_CH(&OPL->P_CH[7]);
-            OPL_CALC_CH(&OPL->P_CH[8]);
-        } else {                /* Rhythm part */
-            OPL_CALC_RH(&OPL->P_CH[0], (OPL->noise_rng >> 0) & 1 );
+        for (c = 0; c < num_active; c++) {
+            OPL_CALC_CH(active[c]);
+        }
+
+        if (rhythm) {           /* Rhythm part */
+            OPL_CALC_RH(&OPL->P_CH[0], (OPL->noise_rng >> 0) & 1);
         }
 
         lt = output[0];
@@ -1741,6 +1754,18 @@ void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
     }
 }
 
+/*
+** Generate samples for one of the YM3812's
+**
+** 'which' is the virtual YM3812 number
+** '*buffer' is the output buffer pointer
+** 'length' is the number of samples that should be generated
+*/
+void ym3812_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
+{
+    OPL_update(chip, buffer, length);
+}
+
 FM_OPL *ym3526_init(UINT32 clock, UINT32 rate)
 {
     /* emulator create */
@@ -1792,54 +1817,7 @@ int ym3526_timer_over(FM_OPL *chip, int c)
 */
 void ym3526_update_one(FM_OPL *chip, OPLSAMPLE *buffer, int length)
 {
-    FM_OPL *OPL = (FM_OPL *)chip;
-    UINT8 rhythm = OPL->rhythm & 0x20;
-    OPLSAMPLE *buf = buffer;
-    int i;
-
-    if ((void *)OPL != cur_chip) {
-        cur_chip = (void *)OPL;
-        /* rhythm slots */
-        SLOT7_1 = &OPL->P_CH[7].SLOT[SLOT1];
-        SLOT7_2 = &OPL->P_CH[7].SLOT[SLOT2];
-        SLOT8_1 = &OPL->P_CH[8].SLOT[SLOT1];
-        SLOT8_2 = &OPL->P_CH[8].SLOT[SLOT2];
-    }
-    for (i = 0; i < length; i++) {
-        int lt;
-
-        output[0] = 0;
-
-        advance_lfo(OPL);
-
-        /* FM part */
-        OPL_CALC_CH(&OPL->P_CH[0]);
-        OPL_CALC_CH(&OPL->P_CH[1]);
-        OPL_CALC_CH(&OPL->P_CH[2]);
-        OPL_CALC_CH(&OPL->P_CH[3]);
-        OPL_CALC_CH(&OPL->P_CH[4]);
-        OPL_CALC_CH(&OPL->P_CH[5]);
-
-        if (!rhythm) {
-            OPL_CALC_CH(&OPL->P_CH[6]);
-            OPL_CALC_CH(&OPL->P_CH[7]);
-            OPL_CALC_CH(&OPL->P_CH[8]);
-        } else {                /* Rhythm part */
-            OPL_CALC_RH(&OPL->P_CH[0], (OPL->noise_rng >> 0) & 1);
-        }
-
-        lt = output[0];
-
-        lt >>= FINAL_SH;
-
-        /* limit check */
-        lt = limit(lt, MAXOUT, MINOUT);
-
-        /* store to sound buffer */
-        buf[i] = lt;
-
-        advance(OPL);
-    }
+    OPL_update(chip, buffer, length);
 }
 
 /* ---------------------------------------------------------------------*/
@@ -32,6 +32,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "blockimage.h"
 #include "log.h"
 #include "snapshot.h"
 #include "spi-sdcard.h"
@@ -94,11 +95,17 @@ static int mmc_card_type = CARD_TYPE_MMC;
 static int mmc_card_rw = 0;
 
 /* Image file */
-static FILE *mmc_image_file = NULL;
+static blockimage_t *mmc_image = NULL;
 
-/* Pointer inside image */
+/* Pointer inside the block written */
 static sd_addr_t mmc_image_pointer;
 
+/* Address of the block written */
+static sd_addr_t mmc_write_address;
+
+/* Bytes of the block written, passed to the image in chunks */
+static uint8_t mmc_write_buffer[0x1000];
+
 /* write sequence counter */
 static unsigned int mmc_write_sequence;
 
@@ -638,26 +645,19 @@ static void mmc_execute_cmd(void)
 #ifdef DEBUG_MMC
                     log_debug("Address: %08x", mmc_current_address_pointer);
 #endif
-                    if (fseek(mmc_image_file, mmc_current_address_pointer, SEEK_SET) != 0) {
+                    uint8_t readbuf[0x1000];    /* FIXME */
+#ifdef DEBUG_MMC
+                    log_debug("Buffering: %08x", mmc_current_address_pointer);
+#endif
+                    if (blockimage_read(mmc_image, readbuf, (off_t)mmc_current_address_pointer, mmc_block_size) < 0) {
                         mmc_card_state = MMC_CARD_DUMMY_READ;
                     } else {
-                        uint8_t readbuf[0x1000];    /* FIXME */
-#ifdef DEBUG_MMC
-                        log_debug("Buffering: %08x", mmc_current_address_pointer);
-#endif
-                        fseek(mmc_image_file, mmc_current_address_pointer, SEEK_SET);
-                        if (!feof(mmc_image_file)) {
-                            if (fread(readbuf, 1, mmc_block_size, mmc_image_file) > 0) {
-                                mmc_read_buffer_readptr = 0;
-                                mmc_read_buffer_writeptr = 0;
-                                mmc_read_buffer_set(readbuf, mmc_block_size);
+                        mmc_read_buffer_readptr = 0;
+                        mmc_read_buffer_writeptr = 0;
+                        mmc_read_buffer_set(readbuf, mmc_block_size);
 #ifdef DEBUG_MMC
-                                log_debug("Buffered: %02x %02x", readbuf[0], readbuf[1]);
+                        log_debug("Buffered: %02x %02x", readbuf[0], readbuf[1]);
 #endif
-                            } else {
-                                /* FIXME: handle error */
-                            }
-                        }
                     }
                 }
             } else {
@@ -681,6 +681,7 @@ static void mmc_execute_cmd(void)
 #endif
                 } else {
                     mmc_write_sequence = 0;
+                    mmc_write_address = mmc_current_address_pointer;
                     mmc_card_state = MMC_CARD_WRITE;
                 }
             } else {
@@ -802,13 +803,23 @@ static void mmc_write_to_mmc(uint8_t value)
             break;
         case 1:
             if (mmc_card_state == MMC_CARD_WRITE) {
-                if (fwrite(&value, 1, 1, mmc_image_file) != 1) {
-                    LOG(("could not write to mmc image file"));
-                    /* FIXME: handle error */
+                sd_addr_t fill = mmc_image_pointer % sizeof(mmc_write_buffer);
+
+                mmc_write_buffer[fill++] = value;
+                if (fill == sizeof(mmc_write_buffer) || mmc_image_pointer + 1 == mmc_block_size) {
+                    if (blockimage_write(mmc_image, mmc_write_buffer,
+                                         (off_t)(mmc_write_address + mmc_image_pointer + 1 - fill),
+                                         (size_t)fill) < 0) {
+                        LOG(("could not write to mmc image file"));
+                        /* FIXME: handle error */
+                    }
                 }
             }
             mmc_image_pointer++;
             if (mmc_image_pointer == mmc_block_size) {
+                if (mmc_card_state == MMC_CARD_WRITE && blockimage_flush_deferred(mmc_image) < 0) {
+                    LOG(("could not write to mmc image file"));
+                }
                 mmc_write_sequence++;
             }
             break;
@@ -837,6 +848,7 @@ void spi_mmc_data_write(uint8_t value)
 int mmc_open_card_image(char *name, int rw)
 {
     char *mmc_image_filename = name;
+    FILE *fd = NULL;
 
     spi_mmc_set_card_inserted(MMC_CARD_NOTINSERTED);
 
@@ -845,18 +857,18 @@ int mmc_open_card_image(char *name, int rw)
         return 1;
     }
 
-    if (mmc_image_file != NULL) {
+    if (mmc_image != NULL) {
         mmc_close_card_image();
     }
 
     if (rw) {
-        mmc_image_file = fopen(mmc_image_filename, "rb+");
+        fd = fopen(mmc_image_filename, "rb+");
     }
 
-    if (mmc_image_file == NULL) {
-        mmc_image_file = fopen(mmc_image_filename, "rb");
+    if (fd == NULL) {
+        fd = fopen(mmc_image_filename, "rb");
 
-        if (mmc_image_file == NULL) {
+        if (fd == NULL) {
             LOG(("could not open sd card image: %s", mmc_image_filename));
             return 1;
         } else {
@@ -872,6 +884,7 @@ int mmc_open_card_image(char *name, int rw)
         spi_mmc_set_card_inserted(MMC_CARD_INSERTED);
         LOG(("opened sd card image (rw): %s", mmc_image_filename));
     }
+    mmc_image = blockimage_open(fd);
     mmc_card_rw = rw;
     return 0;
 }
@@ -879,9 +892,11 @@ int mmc_open_card_image(char *name, int rw)
 void mmc_close_card_image(void)
 {
     /* unmount mmc cart image */
-    if (mmc_image_file != NULL) {
-        fclose(mmc_image_file);
-        mmc_image_file = NULL;
+    if (mmc_image != NULL) {
+        if (blockimage_close(mmc_image) < 0) {
+            LOG(("could not write to mmc image file"));
+        }
+        mmc_image = NULL;
         spi_mmc_set_card_inserted(MMC_CARD_NOTINSERTED);
     }
 }
@@ -354,10 +354,57 @@ inline static void update_via_t1_latch(via_context_t *via_context, CLOCK rclk)
     VIALOG2("tal %u (0x%04x)\n", via_context->tal, via_context->tal);
 }
 
+/*
+ * In free running mode, once VIA_IM_T1 is set and PB7 is not used, another
+ * T1 underflow changes nothing anybody can see until the next access to
+ * the timer or interrupt registers: the flag is set already, and the T1
+ * value itself is calculated from t1reload anyway.
+ * So viacore_t1_zero_alarm() does not set itself again then, but leaves
+ * t1_idle set. The underflows that have passed in the meantime are done
+ * all at once by viacore_t1_catchup(), before any such access.
+ */
+inline static bool viacore_t1_alarm_needed(via_context_t *via_context)
+{
+    return !(via_context->via[VIA_ACR] & VIA_ACR_T1_FREE_RUN)
+           || (via_context->via[VIA_ACR] & VIA_ACR_T1_PB7_USED)
+           || !(via_context->ifr & VIA_IM_T1);
+}
+
+/*
+ * Do what viacore_t1_zero_alarm() would have done for all T1 underflows
+ * before rclk, like run_pending_alarms() would have.
+ */
+inline static void viacore_t1_catchup(via_context_t *via_context, CLOCK rclk)
+{
+    if (via_context->t1_idle && rclk > via_context->t1zero) {
+        unsigned int full_cycle = via_context->tal + FULL_CYCLE_2;
+        CLOCK n = 1 + (rclk - 1 - via_context->t1zero) / full_cycle;
+
+        via_context->t1zero += n * full_cycle;
+        via_context->t1reload += n * full_cycle;
+        if (n & 1) {
+            via_context->t1_pb7 ^= 0x80;
+        }
+        via_context->ifr |= VIA_IM_T1;
+    }
+}
+
+/*
+ * Set the T1 alarm again if an access has made it matter.
+ */
+inline static void viacore_t1_wakeup(via_context_t *via_context)
+{
+    if (via_context->t1_idle && viacore_t1_alarm_needed(via_context)) {
+        via_context->t1_idle = false;
+        alarm_set(via_context->t1_zero_alarm, via_context->t1zero);
+    }
+}
+
 /* ------------------------------------------------------------------------- */
 void viacore_disable(via_context_t *via_context)
 {
     alarm_unset(via_context->t1_zero_alarm);
+    via_context->t1_idle = false;
     alarm_unset(via_context->t2_zero_alarm);
     alarm_unset(via_context->t2_underflow_alarm);
     alarm_unset(via_context->t2_shift_alarm);
@@ -406,6 +453,7 @@ void viacore_reset(via_context_t *via_context)
 
     /* disable vice interrupts */
     via_context->t1zero = 0;
+    via_context->t1_idle = false;
     via_context->t2xx00 = false;
     alarm_unset(via_context->t1_zero_alarm);
     alarm_unset(via_context->t2_zero_alarm);
@@ -654,6 +702,7 @@ void viacore_store(via_context_t *via_context, uint16_t addr, uint8_t byte)
     if (addr == VIA_PRB || (addr >= VIA_T1CL && addr <= VIA_IER)) {
         run_pending_alarms(rclk, via_context->write_offset, via_context->alarm_context);
         /* run_pending_alarms(rclk, 0, via_context->alarm_context); */
+        viacore_t1_catchup(via_context, rclk);
     }
 
     switch (addr) {
@@ -752,6 +801,7 @@ void viacore_store(via_context_t *via_context, uint16_t addr, uint8_t byte)
             via_context->t1zero   = rclk+1 + via_context->tal               ;
             VIALOG2("write VIA_T1CH: set t1_zero_alarm t1zero=%lu, t1reload %lu\n", via_context->t1zero, via_context->t1reload);
             alarm_set(via_context->t1_zero_alarm, via_context->t1zero);
+            via_context->t1_idle = false;
 
             /* set pb7 state */
             via_context->t1_pb7 = 0;
@@ -774,6 +824,7 @@ void viacore_store(via_context_t *via_context, uint16_t addr, uint8_t byte)
             /* Clear T1 interrupt */
             via_context->ifr &= ~VIA_IM_T1;
             update_myviairq_rclk(via_context, rclk);
+            viacore_t1_wakeup(via_context);
             break;
 
         case VIA_T2LL:          /* Write timer 2 low latch */
@@ -825,6 +876,7 @@ void viacore_store(via_context_t *via_context, uint16_t addr, uint8_t byte)
         case VIA_IFR:           /* 6522 Interrupt Flag Register */
             via_context->ifr &= ~byte;
             update_myviairq_rclk(via_context, rclk);
+            viacore_t1_wakeup(via_context);
 
             /* FIXME:
              * clearing any timer interrupt should set the relevant timer alarm.
@@ -974,6 +1026,7 @@ void viacore_store(via_context_t *via_context, uint16_t addr, uint8_t byte)
             }
 
             via_context->via[addr] = byte;
+            viacore_t1_wakeup(via_context);
             viacore_cache_cb12_io_status(via_context);
             (via_context->store_acr)(via_context, byte);
 
@@ -1061,6 +1114,7 @@ uint8_t viacore_read_(via_context_t *via_context, uint16_t addr)
 
     if (addr == VIA_PRB || (addr >= VIA_T1CL && addr <= VIA_IER)) {
         run_pending_alarms(rclk, 0, via_context->alarm_context);
+        viacore_t1_catchup(via_context, rclk);
     }
 
     switch (addr) {
@@ -1153,6 +1207,7 @@ uint8_t viacore_read_(via_context_t *via_context, uint16_t addr)
         case VIA_T1CL /*TIMER_AL */:    /* timer A low counter */
             via_context->ifr &= ~VIA_IM_T1;
             update_myviairq_rclk(via_context, rclk);
+            viacore_t1_wakeup(via_context);
             via_context->last_read = (uint8_t)(viacore_t1(via_context, rclk) & 0xff);
             return via_context->last_read;
 
@@ -1275,6 +1330,7 @@ uint8_t viacore_peek(via_context_t *via_context, uint16_t addr)
             return (uint8_t)((viacore_t2(via_context, *(via_context->clk_ptr)) >> 8) & 0xff);
 
         case VIA_IFR:           /* Interrupt Flag Register */
+            viacore_t1_catchup(via_context, *(via_context->clk_ptr));
             return via_context->ifr;
 
         case VIA_IER:           /* 6522 Interrupt Enable Register */
@@ -1313,7 +1369,6 @@ static void viacore_t1_zero_alarm(CLOCK offset, void *data)
         /* we want another alarm for the next T1 interrupt */
         unsigned int full_cycle = via_context->tal + FULL_CYCLE_2;
         via_context->t1zero += full_cycle;
-        alarm_set(via_context->t1_zero_alarm, via_context->t1zero);
 
         /* Let t1reload also keep up with the cpu clock;
            this should avoid `% full_cycle` case. */
@@ -1325,6 +1380,16 @@ static void viacore_t1_zero_alarm(CLOCK offset, void *data)
     via_context->t1_pb7 ^= 0x80;
     VIALOG2("viacore_t1_zero_alarm: set VIA_IM_T1\n");
     via_context->ifr |= VIA_IM_T1;
+
+    if (via_context->t1zero != 0) {
+        if (viacore_t1_alarm_needed(via_context)) {
+            alarm_set(via_context->t1_zero_alarm, via_context->t1zero);
+        } else {
+            /* nobody can tell until the next access; see viacore_t1_catchup() */
+            alarm_unset(via_context->t1_zero_alarm);
+            via_context->t1_idle = true;
+        }
+    }
     /* It takes an extra cycle after the flag before the interrupt happens */
     update_myviairq_rclk(via_context, rclk + 1);
 }
@@ -1940,6 +2005,7 @@ int viacore_snapshot_write_module(via_context_t *via_context, snapshot_t *s)
     uint8_t byte4;
 
     run_pending_alarms(rclk, 0, via_context->alarm_context);
+    viacore_t1_catchup(via_context, rclk);
 
     m = snapshot_module_create(s, via_context->my_module_name, VIA_DUMP_VER_MAJOR, VIA_DUMP_VER_MINOR);
 
@@ -2056,6 +2122,7 @@ int viacore_snapshot_read_module(via_context_t *via_context, snapshot_t *s)
     alarm_unset(via_context->phi2_sr_alarm);
 
     via_context->t1zero = 0;
+    via_context->t1_idle = false;
     via_context->t2xx00 = false;
 
     if (0
@@ -2183,6 +2250,7 @@ int viacore_snapshot_read_module(via_context_t *via_context, snapshot_t *s)
 
 int viacore_dump(via_context_t *via_context)
 {
+    viacore_t1_catchup(via_context, *(via_context->clk_ptr));
     mon_out("Port A: %02x DDR: %02x no HS: %02x\n",
             viacore_peek(via_context, VIA_PRA), viacore_peek(via_context, VIA_DDRA), viacore_peek(via_context, VIA_PRA_NHS));
     mon_out("Port B: %02x DDR: %02x\n", viacore_peek(via_context, VIA_PRB), viacore_peek(via_context, VIA_DDRB));
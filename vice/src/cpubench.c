@@ -0,0 +1,193 @@
+/*
+ * cpubench.c - Measure the speed of the main CPU emulation.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With -cpubench <cycles> a fixed 6502 program is copied to $1000 after the
+   first machine reset and run with interrupts disabled in warp mode.  After
+   <cycles> cycles the time taken and the emulated speed in MHz are printed
+   to stdout and the emulator exits.  The program only touches $1000-$1AFF
+   and $FB-$FE, which is RAM on every machine with a 6502 at $1000 (the
+   unexpanded VIC-20 included); it mixes the usual addressing modes, binary
+   and decimal arithmetic, branches, stack accesses and JSR/RTS.
+   Peripheral chips keep running, so the result is the speed of the whole
+   machine with a busy CPU, which is what the CPU core changes are measured
+   against.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alarm.h"
+#include "archdep.h"
+#include "cmdline.h"
+#include "cpubench.h"
+#include "interrupt.h"
+#include "log.h"
+#include "maincpu.h"
+#include "mem.h"
+#include "mos6510.h"
+#include "types.h"
+#include "vsync.h"
+
+#define CPUBENCH_ADDR   0x1000
+
+static const uint8_t cpubench_code[] = {
+    /* $1000 */ 0x78,                   /*        SEI               */
+    /* $1001 */ 0xd8,                   /*        CLD               */
+    /* $1002 */ 0xa9, 0x00,             /*        LDA #$00          */
+    /* $1004 */ 0x85, 0xfb,             /*        STA $FB           */
+    /* $1006 */ 0xa9, 0x18,             /*        LDA #$18          */
+    /* $1008 */ 0x85, 0xfc,             /*        STA $FC           */
+    /* $100a */ 0xa2, 0x00,             /* loop:  LDX #$00          */
+    /* $100c */ 0x8a,                   /* inner: TXA               */
+    /* $100d */ 0x9d, 0x00, 0x18,       /*        STA $1800,X       */
+    /* $1010 */ 0x7d, 0x00, 0x19,       /*        ADC $1900,X       */
+    /* $1013 */ 0x9d, 0x00, 0x19,       /*        STA $1900,X       */
+    /* $1016 */ 0xa8,                   /*        TAY               */
+    /* $1017 */ 0xb1, 0xfb,             /*        LDA ($FB),Y       */
+    /* $1019 */ 0x49, 0x5a,             /*        EOR #$5A          */
+    /* $101b */ 0x0a,                   /*        ASL A             */
+    /* $101c */ 0x91, 0xfb,             /*        STA ($FB),Y       */
+    /* $101e */ 0x20, 0x40, 0x10,       /*        JSR sub           */
+    /* $1021 */ 0xe8,                   /*        INX               */
+    /* $1022 */ 0xd0, 0xe8,             /*        BNE inner         */
+    /* $1024 */ 0xf8,                   /*        SED               */
+    /* $1025 */ 0x18,                   /*        CLC               */
+    /* $1026 */ 0xa5, 0xfd,             /*        LDA $FD           */
+    /* $1028 */ 0x69, 0x01,             /*        ADC #$01          */
+    /* $102a */ 0x85, 0xfd,             /*        STA $FD           */
+    /* $102c */ 0xd8,                   /*        CLD               */
+    /* $102d */ 0xee, 0x00, 0x1a,       /*        INC $1A00         */
+    /* $1030 */ 0x4c, 0x0a, 0x10,       /*        JMP loop          */
+    /* $1033 */ 0xea, 0xea, 0xea, 0xea, 0xea, 0xea, 0xea,
+    /* $103a */ 0xea, 0xea, 0xea, 0xea, 0xea, 0xea,
+    /* $1040 */ 0x48,                   /* sub:   PHA               */
+    /* $1041 */ 0x98,                   /*        TYA               */
+    /* $1042 */ 0x4a,                   /*        LSR A             */
+    /* $1043 */ 0x26, 0xfe,             /*        ROL $FE           */
+    /* $1045 */ 0xc9, 0x80,             /*        CMP #$80          */
+    /* $1047 */ 0x90, 0x02,             /*        BCC +2            */
+    /* $1049 */ 0xe6, 0xfe,             /*        INC $FE           */
+    /* $104b */ 0x68,                   /*        PLA               */
+    /* $104c */ 0x60                    /*        RTS               */
+};
+
+static CLOCK bench_cycles = 0;
+static CLOCK bench_start_clk;
+static tick_t bench_start_tick;
+
+static alarm_t *bench_alarm = NULL;
+
+static log_t cpubench_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+static void cpubench_alarm_handler(CLOCK offset, void *data)
+{
+    CLOCK cycles = maincpu_clk - bench_start_clk;
+    double seconds = (double)tick_now_delta(bench_start_tick) / tick_per_second();
+
+    alarm_unset(bench_alarm);
+
+    if (seconds <= 0.0) {
+        seconds = 1.0 / tick_per_second();
+    }
+
+    fprintf(stdout, "CPUBENCH: %"PRIu64" cycles in %.3f s: %.2f MHz\n",
+            (uint64_t)cycles, seconds, (double)cycles / seconds / 1000000.0);
+    fflush(stdout);
+
+    archdep_vice_exit(EXIT_SUCCESS);
+}
+
+static void cpubench_run_trap(uint16_t addr, void *data)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(cpubench_code); i++) {
+        mem_store((uint16_t)(CPUBENCH_ADDR + i), cpubench_code[i]);
+    }
+    for (i = 0; i < sizeof(cpubench_code); i++) {
+        if (mem_read((uint16_t)(CPUBENCH_ADDR + i)) != cpubench_code[i]) {
+            log_error(cpubench_log, "No RAM at $%04x, cannot run the benchmark.",
+                      CPUBENCH_ADDR + i);
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+    }
+
+    MOS6510_REGS_SET_INTERRUPT(&maincpu_regs, 1);
+    MOS6510_REGS_SET_PC(&maincpu_regs, CPUBENCH_ADDR);
+
+    log_message(cpubench_log, "Running %"PRIu64" cycles.", (uint64_t)bench_cycles);
+
+    vsync_set_warp_mode(1);
+
+    bench_alarm = alarm_new(maincpu_alarm_context, "CPUBench", cpubench_alarm_handler, NULL);
+    bench_start_clk = maincpu_clk;
+    bench_start_tick = tick_now();
+    alarm_set(bench_alarm, maincpu_clk + bench_cycles);
+}
+
+static void cpubench_start_trap(uint16_t addr, void *data)
+{
+    /* The first reset is executed right after this trap.  */
+    interrupt_maincpu_trigger_trap(cpubench_run_trap, NULL);
+}
+
+void cpubench_start(void)
+{
+    if (bench_cycles == 0 || bench_alarm != NULL) {
+        return;
+    }
+
+    interrupt_maincpu_trigger_trap(cpubench_start_trap, NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_cpubench(const char *param, void *extra_param)
+{
+    char *end;
+    unsigned long long cycles = strtoull(param, &end, 0);
+
+    if (*end != 0 || cycles == 0) {
+        return -1;
+    }
+    bench_cycles = (CLOCK)cycles;
+
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-cpubench", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_cpubench, NULL, NULL, NULL,
+      "<cycles>", "Run a fixed CPU benchmark for <cycles> cycles, print the emulated speed, then quit" },
+    CMDLINE_LIST_END
+};
+
+int cpubench_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
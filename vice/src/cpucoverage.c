@@ -0,0 +1,208 @@
+/*
+ * cpucoverage.c - Edge coverage of the main CPU for AFL style fuzzers.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Built with --enable-cpu-coverage, the main CPU cores count the edges
+   between the targets of taken branches, JMP, JSR and RTS in the shared
+   memory bitmap that AFL and AFL++ pass in the __AFL_SHM_ID environment
+   variable, the same way their compile time instrumentation does for
+   native code.
+
+   In the headless front end, -aflforkserver additionally speaks the fork
+   server protocol on file descriptors 198 and 199: the emulator starts up
+   once, and at the first machine reset forks a child for every run the
+   fuzzer asks for.  The child goes on to attach and autostart whatever
+   the command line names, typically the file the fuzzer rewrites for each
+   run.  Only the thread that runs the main CPU survives the fork, so the
+   fork server must not be combined with options that start threads of
+   their own.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef USE_CPU_COVERAGE
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "cmdline.h"
+#include "cpucoverage.h"
+#include "log.h"
+#include "types.h"
+
+#ifdef USE_CPU_COVERAGE
+
+/* File descriptors of the AFL fork server protocol: the fuzzer writes
+   4 bytes to the control pipe to request a run, the fork server answers
+   on the status pipe with the child's pid and then its wait status.  */
+#define FORKSRV_CTL_FD  198
+#define FORKSRV_ST_FD   199
+
+uint8_t *cpucoverage_map = NULL;
+unsigned int cpucoverage_prev = 0;
+
+#ifdef USE_HEADLESSUI
+static int forkserver_enabled = 0;
+#endif
+
+static log_t cpucoverage_log = LOG_DEFAULT;
+
+static void cpucoverage_attach_map(void)
+{
+    const char *id_str = getenv("__AFL_SHM_ID");
+    char *end;
+    long id;
+    void *map;
+
+    if (id_str == NULL || *id_str == '\0') {
+        return;
+    }
+    id = strtol(id_str, &end, 10);
+    if (*end != '\0' || id < 0) {
+        log_error(cpucoverage_log, "Invalid __AFL_SHM_ID `%s'.", id_str);
+        return;
+    }
+    map = shmat((int)id, NULL, 0);
+    if (map == (void *)-1) {
+        log_error(cpucoverage_log, "Cannot attach the coverage bitmap: %s.",
+                  strerror(errno));
+        return;
+    }
+    cpucoverage_map = map;
+    cpucoverage_prev = 0;
+    log_message(cpucoverage_log, "Recording edge coverage.");
+}
+
+#ifdef USE_HEADLESSUI
+static void cpucoverage_serve_forks(void)
+{
+    uint32_t word = 0;
+
+    /* Not started by a fuzzer: just run.  */
+    if (write(FORKSRV_ST_FD, &word, 4) != 4) {
+        log_warning(cpucoverage_log, "No fork server pipe, running once.");
+        return;
+    }
+    log_message(cpucoverage_log, "Serving forks.");
+
+    fflush(stdout);
+    fflush(stderr);
+
+    while (1) {
+        pid_t child;
+        int status;
+
+        if (read(FORKSRV_CTL_FD, &word, 4) != 4) {
+            /* the fuzzer is gone */
+            _exit(EXIT_SUCCESS);
+        }
+
+        child = fork();
+        if (child < 0) {
+            _exit(EXIT_FAILURE);
+        }
+        if (child == 0) {
+            close(FORKSRV_CTL_FD);
+            close(FORKSRV_ST_FD);
+            cpucoverage_prev = 0;
+            return;
+        }
+
+        word = (uint32_t)child;
+        if (write(FORKSRV_ST_FD, &word, 4) != 4) {
+            _exit(EXIT_FAILURE);
+        }
+        if (waitpid(child, &status, 0) < 0) {
+            _exit(EXIT_FAILURE);
+        }
+        word = (uint32_t)status;
+        if (write(FORKSRV_ST_FD, &word, 4) != 4) {
+            _exit(EXIT_FAILURE);
+        }
+    }
+}
+#endif
+
+void cpucoverage_start(void)
+{
+    static int started = 0;
+
+    if (started) {
+        return;
+    }
+    started = 1;
+
+    cpucoverage_log = log_open("CPUCoverage");
+    cpucoverage_attach_map();
+#ifdef USE_HEADLESSUI
+    if (forkserver_enabled) {
+        cpucoverage_serve_forks();
+    }
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef USE_HEADLESSUI
+static int cmdline_aflforkserver(const char *param, void *extra_param)
+{
+    forkserver_enabled = 1;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-aflforkserver", CALL_FUNCTION, CMDLINE_ATTRIB_NONE,
+      cmdline_aflforkserver, NULL, NULL, NULL,
+      NULL, "Start up once and fork a run for each request of an AFL style fuzzer" },
+    CMDLINE_LIST_END
+};
+#endif
+
+int cpucoverage_cmdline_options_init(void)
+{
+#ifdef USE_HEADLESSUI
+    return cmdline_register_options(cmdline_options);
+#else
+    return 0;
+#endif
+}
+
+#else
+
+void cpucoverage_start(void)
+{
+}
+
+int cpucoverage_cmdline_options_init(void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * cpucoverage.h - Edge coverage of the main CPU for AFL style fuzzers.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_CPUCOVERAGE_H
+#define VICE_CPUCOVERAGE_H
+
+#include "vice.h"
+
+#include "types.h"
+
+/* Size of the bitmap, as AFL's MAP_SIZE.  */
+#define CPUCOVERAGE_MAP_SIZE    0x10000
+
+#ifdef USE_CPU_COVERAGE
+
+/* The bitmap, or NULL when not running under a fuzzer.  */
+extern uint8_t *cpucoverage_map;
+extern unsigned int cpucoverage_prev;
+
+/* Count the edge from the previous control transfer to the one landing at
+   `addr'.  The address is scrambled with an odd multiplier, which maps the
+   64K targets one to one onto the bitmap without putting neighbours next
+   to each other; the previous location is shifted so A->B and B->A differ.
+   Used by the main CPU cores for taken branches, JMP, JSR and RTS.  */
+#define CPUCOVERAGE_EDGE(addr)                                                 \
+    do {                                                                       \
+        if (cpucoverage_map != NULL) {                                         \
+            unsigned int cpucoverage_cur =                                     \
+                ((unsigned int)(addr) * 0x9e37u + 0x79b9u) & 0xffff;           \
+            cpucoverage_map[cpucoverage_cur ^ cpucoverage_prev]++;             \
+            cpucoverage_prev = cpucoverage_cur >> 1;                           \
+        }                                                                      \
+    } while (0)
+
+#endif
+
+/* Attach the bitmap given by the fuzzer in __AFL_SHM_ID and, with
+   -aflforkserver, serve forks to it.  Called on the first machine reset,
+   before anything is attached or autostarted, so every child loads the
+   input afresh.  Only children return from here when serving forks.  */
+void cpucoverage_start(void);
+
+int cpucoverage_cmdline_options_init(void);
+
+#endif
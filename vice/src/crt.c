@@ -39,6 +39,7 @@
 #include "types.h"
 #include "c64cart.h"  /* FIXME: for C64CART_IMAGE_LIMIT */
 #include "util.h"
+#include "zfile.h"
 
 /* #define DEBUGCRT */
 
@@ -86,21 +87,14 @@ static void expected_header_error(void)
 }
 
 /*
-    Open a crt file and read header
+    Read header from an opened crt file, closes fd on fault
 
     return NULL on fault, fd otherwise
 */
-FILE *crt_open(const char *filename, crt_header_t *header)
+static FILE *crt_read_header(FILE *fd, crt_header_t *header)
 {
     uint8_t crt_header[0x40];
     uint32_t skip;
-    FILE *fd;
-
-    fd = fopen(filename, MODE_READ);
-
-    if (fd == NULL) {
-        return NULL;
-    }
 
     do {
         if (fread(crt_header, sizeof(crt_header), 1, fd) < 1) {
@@ -182,12 +176,60 @@ FILE *crt_open(const char *filename, crt_header_t *header)
     fclose(fd);
     return NULL; /* Fault */
 }
+/*
+    Open a crt file and read header
+
+    return NULL on fault, fd otherwise
+*/
+FILE *crt_open(const char *filename, crt_header_t *header)
+{
+    FILE *fd;
+
+    fd = fopen(filename, MODE_READ);
+
+    if (fd == NULL) {
+        return NULL;
+    }
+
+    return crt_read_header(fd, header);
+}
+/*
+    Open a crt image that is already in memory and read header. The data
+    is read in place, so it must stay valid until fd has been closed.
+
+    return NULL on fault, fd otherwise
+*/
+FILE *crt_open_memory(const uint8_t *data, size_t size, crt_header_t *header)
+{
+    FILE *fd;
+
+    fd = zfile_fopen_memory(data, size);
+
+    if (fd == NULL) {
+        log_error(LOG_DEFAULT, "could not open CRT image in memory.");
+        return NULL;
+    }
+
+    return crt_read_header(fd, header);
+}
+
+static int crt_header_getid(const crt_header_t *header)
+{
+    int id = header->type;
+
+    /* if we have loaded a C128 cartridge, convert the C128 crt id to something
+       else (that can coexist with C64 crt ids) */
+    if (header->machine == VICE_MACHINE_C128) {
+        id = CARTRIDGE_C128_MAKEID(id);
+    }
+
+    return id;
+}
 /*
     returns -1 on error, else a positive CRT ID
 */
 int crt_getid(const char *filename)
 {
-    int id;
     crt_header_t header;
     FILE *fd;
 
@@ -199,15 +241,25 @@ int crt_getid(const char *filename)
 
     fclose(fd);
 
-    id = header.type;
+    return crt_header_getid(&header);
+}
+/*
+    returns -1 on error, else a positive CRT ID
+*/
+int crt_getid_memory(const uint8_t *data, size_t size)
+{
+    crt_header_t header;
+    FILE *fd;
 
-    /* if we have loaded a C128 cartridge, convert the C128 crt id to something
-       else (that can coexist with C64 crt ids) */
-    if (header.machine == VICE_MACHINE_C128) {
-        id = CARTRIDGE_C128_MAKEID(id);
+    fd = crt_open_memory(data, size, &header);
+
+    if (fd == NULL) {
+        return -1;
     }
 
-    return id;
+    fclose(fd);
+
+    return crt_header_getid(&header);
 }
 
 /*
@@ -51,6 +51,11 @@ typedef struct crt_chip_header_s {
 
 FILE *crt_open(const char *filename, crt_header_t *header);
 int crt_getid(const char *filename);
+
+/* same for a crt image in memory, which must outlive the returned FILE */
+FILE *crt_open_memory(const uint8_t *data, size_t size, crt_header_t *header);
+int crt_getid_memory(const uint8_t *data, size_t size);
+
 int crt_read_chip_header(crt_chip_header_t *header, FILE *fd);
 int crt_read_chip(uint8_t *rawcart, int offset, crt_chip_header_t *chip, FILE *fd);
 int crt_write_chip(uint8_t *data, crt_chip_header_t *header, FILE *fd);
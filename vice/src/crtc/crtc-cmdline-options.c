@@ -31,6 +31,7 @@
 #include <stdio.h>
 
 #include "crtc-cmdline-options.h"
+#include "crtc-textserver.h"
 #include "crtctypes.h"
 #include "cmdline.h"
 #include "raster-cmdline-options.h"
@@ -54,5 +55,9 @@ int crtc_cmdline_options_init(void)
         return -1;
     }
 
+    if (crtc_textserver_cmdline_options_init() < 0) {
+        return -1;
+    }
+
     return cmdline_register_options(cmdline_options);
 }
@@ -33,6 +33,7 @@
 #include "crtc-draw.h"
 #include "crtc.h"
 #include "crtctypes.h"
+#include "lib.h"
 #include "raster-modes.h"
 #include "types.h"
 
@@ -158,6 +159,153 @@ static inline void DRAW(int reverse_flag, int offset, int scr_rel,
     }
 }
 
+/***************************************************************************/
+
+#if CRTC_BEAM_RACING
+/*
+ * Shadow of the text part of each raster line, as it was drawn in the
+ * previous frame.  The characters come from the prefetch, which the screen
+ * stores keep up to date, so comparing with it finds the changed cells even
+ * when the screen memory was written directly (tape loads, the monitor).
+ * Only those cells are expanded again; on an idle screen none are.
+ */
+typedef struct crtc_draw_shadow_s {
+    unsigned int frame;     /* value of shadow_frame when drawn */
+    uint8_t *p;             /* where the line was drawn */
+    uint8_t *chargen_ptr;
+    int reverse_flag;
+    int crsrrel;            /* cursor cell, or -1 */
+    int xc;
+    int xe;
+    uint8_t chars[sizeof(crtc.prefetch)];
+} crtc_draw_shadow_t;
+
+static crtc_draw_shadow_t *shadow = NULL;
+static unsigned int shadow_lines = 0;
+
+/* A shadow line is only valid if it was drawn in the previous frame: lines
+   that were blanked or skipped in between hold other pixels.  */
+static unsigned int shadow_frame = 2;
+
+static crtc_draw_shadow_t *get_shadow_line(unsigned int line)
+{
+    if (line >= shadow_lines) {
+        shadow = lib_realloc(shadow, (line + 1) * sizeof(crtc_draw_shadow_t));
+        for (; shadow_lines <= line; shadow_lines++) {
+            shadow[shadow_lines].frame = shadow_frame - 2;
+        }
+    }
+    return &shadow[line];
+}
+
+/* Draw the main part of a text line from the prefetch, but only the cells
+   that differ from what the previous frame drew there.  */
+static void draw_text_shadowed(int reverse_flag, int offset, int scr_rel,
+                               int xc, int xe)
+{
+    uint8_t *p = crtc.raster.draw_buffer_ptr + (offset & ~3);
+    uint32_t *pw = (uint32_t *)p;
+    uint8_t *chargen_ptr;
+    crtc_draw_shadow_t *s;
+    int crsrrel = -1;
+    int full, i, c, d;
+
+    chargen_ptr = crtc.chargen_base
+                  + crtc.chargen_rel
+                  + (crtc.raster.ycounter & 0x0f);
+
+    if (crtc.crsrmode && crtc.cursor_lines && crtc.crsrstate) {
+        crsrrel = (((crtc.regs[CRTC_REG_CURSORPOSH] << 8) |
+                     crtc.regs[CRTC_REG_CURSORPOSL]) & crtc.vaddr_mask_eff)
+                  - scr_rel;
+        if (crsrrel < 0 || crsrrel >= xc) {
+            crsrrel = -1;
+        }
+    }
+
+    s = get_shadow_line(crtc.raster.current_line);
+
+    full = s->frame + 1 != shadow_frame
+           || s->p != p
+           || s->chargen_ptr != chargen_ptr
+           || s->reverse_flag != reverse_flag
+           || s->xc != xc
+           || s->xe != xe;
+
+    if (!full && s->crsrrel == crsrrel
+        && memcmp(s->chars, crtc.prefetch, xc) == 0) {
+        s->frame = shadow_frame;
+        return;
+    }
+
+    for (i = 0; i < xc; i++) {
+        c = crtc.prefetch[i];
+        if (full || c != s->chars[i]
+            || (s->crsrrel != crsrrel && (i == crsrrel || i == s->crsrrel))) {
+            d = chargen_ptr[c << 4];
+            if (i == crsrrel) {
+                d ^= 0xff;
+            }
+            if (reverse_flag) {
+                d ^= 0xff;
+            }
+            pw[2 * i] = dwg_table[d >> 4];
+            pw[2 * i + 1] = dwg_table[d & 0x0f];
+        }
+    }
+
+    if (full) {
+        /* blank the rest */
+        for (; i < xe; i++) {
+            pw[2 * i] = 0;
+            pw[2 * i + 1] = 0;
+        }
+    }
+
+    memcpy(s->chars, crtc.prefetch, xc);
+    s->frame = shadow_frame;
+    s->p = p;
+    s->chargen_ptr = chargen_ptr;
+    s->reverse_flag = reverse_flag;
+    s->crsrrel = crsrrel;
+    s->xc = xc;
+    s->xe = xe;
+}
+#endif
+
+/* Draw the main part of a text line, which starts at the left edge of the
+   text area.  */
+static void draw_text(int reverse_flag, int offset)
+{
+    int xc = crtc.rl_visible * crtc.hw_cols;
+    int xe = (crtc.rl_len + 1) * crtc.hw_cols;
+
+#if CRTC_BEAM_RACING
+    /* the hires boards draw over the text themselves */
+    if (crtc.hires_draw_callback == NULL && xc <= crtc.vaddr_mask_eff + 1) {
+        draw_text_shadowed(reverse_flag, offset, crtc.screen_rel, xc, xe);
+        return;
+    }
+#endif
+    DRAW(reverse_flag, offset, crtc.screen_rel, 0, xc, xe);
+}
+
+void crtc_draw_end_of_frame(void)
+{
+#if CRTC_BEAM_RACING
+    shadow_frame++;
+#endif
+}
+
+void crtc_draw_invalidate(void)
+{
+#if CRTC_BEAM_RACING
+    shadow_frame += 2;
+#endif
+}
+
+/***************************************************************************/
+
 static void draw_standard_line(void)
 {
     int rl_pos = crtc.xoffset + crtc.hjitter;
@@ -179,12 +327,7 @@ static void draw_standard_line(void)
     }
 
     /* this is the "normal" part of the rasterline */
-    DRAW(0,
-         rl_pos,
-         crtc.screen_rel,
-         0,
-         crtc.rl_visible * crtc.hw_cols,
-         (crtc.rl_len + 1) * crtc.hw_cols);
+    draw_text(0, rl_pos);
 }
 
 static void draw_reverse_line(void)
@@ -202,12 +345,7 @@ static void draw_reverse_line(void)
     }
 
     /* this is the "normal" part of the rasterline */
-    DRAW(1,
-         rl_pos,
-         crtc.screen_rel,
-         0,
-         crtc.rl_visible * crtc.hw_cols,
-         (crtc.rl_len + 1) * crtc.hw_cols);
+    draw_text(1, rl_pos);
 }
 
 static int get_std_text(raster_cache_t *cache, unsigned int *xs,
@@ -266,3 +404,12 @@ void crtc_draw_init(void)
 
     setup_modes();
 }
+
+void crtc_draw_shutdown(void)
+{
+#if CRTC_BEAM_RACING
+    lib_free(shadow);
+    shadow = NULL;
+    shadow_lines = 0;
+#endif
+}
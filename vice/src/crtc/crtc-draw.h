@@ -35,6 +35,9 @@
 #include "types.h"
 
 void crtc_draw_init(void);
+void crtc_draw_shutdown(void);
+void crtc_draw_end_of_frame(void);
+void crtc_draw_invalidate(void);
 
 extern uint32_t dwg_table[16];
 
@@ -40,6 +40,7 @@
 
 #include "archdep.h"
 #include "crtc-resources.h"
+#include "crtc-textserver.h"
 #include "crtctypes.h"
 #include "fullscreen.h"
 #include "log.h"
@@ -108,5 +109,9 @@ int crtc_resources_init(void)
     crtc.video_chip_cap = &video_chip_cap;
     crtc_update_renderer();
 
+    if (crtc_textserver_resources_init() < 0) {
+        return -1;
+    }
+
     return resources_register_int(resources_int);
 }
@@ -0,0 +1,450 @@
+/*
+ * crtc-textserver.c - Serve the CRTC text screen over a socket.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* For running xpet and xcbm2 as back ends of business software.  While the
+   text server is enabled, nothing is drawn.  Instead, a single client that
+   connects gets the text screen as ASCII whenever it changed: a form feed
+   followed by one line per text row.  What the client sends is typed into
+   the keyboard buffer.
+
+   The emulated CPU keeps polling the keyboard while the program waits, so
+   there is no event to sleep on.  Once the screen has been unchanged for a
+   while and no input is pending, the server waits for the client instead,
+   up to the idle sleep time.  vsync then catches up with the frames that
+   were due, back to back, so the emulated time is kept, and the server
+   sleeps again once they are done.  Input wakes the server at once.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "charset.h"
+#include "cmdline.h"
+#include "crtc-textserver.h"
+#include "crtctypes.h"
+#include "kbdbuf.h"
+#include "lib.h"
+#include "log.h"
+#include "mainlock.h"
+#include "resources.h"
+#include "util.h"
+#include "vicesocket.h"
+#include "vsync.h"
+
+#ifdef HAVE_NETWORK
+
+/* Frames the screen must be unchanged before the server sleeps.  */
+#define TEXTSERVER_IDLE_FRAMES  10
+
+/* Longest sleep; vsync stops catching up after a second.  */
+#define TEXTSERVER_MAX_SLEEP    500
+
+/* Bytes of input taken per frame.  */
+#define TEXTSERVER_INPUT_SIZE   32
+
+static int textserver_enabled = 0;
+static char *textserver_address = NULL;
+static int textserver_idle_sleep = 100;
+
+static vice_network_socket_t *listen_socket = NULL;
+static vice_network_socket_t *client_socket = NULL;
+
+/* the text last sent, and the one of the current frame */
+static char *text_sent = NULL;
+static size_t text_sent_len = 0;
+static char *text = NULL;
+static size_t text_size = 0;
+
+static unsigned int unchanged_frames = 0;
+
+/* frames vsync needs to catch up with the last sleep */
+static unsigned int catch_up_frames = 0;
+
+/* the last byte received was a CR, so a following LF is dropped */
+static int input_after_cr = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static void textserver_close_client(void)
+{
+    if (client_socket != NULL) {
+        vice_network_socket_close(client_socket);
+        client_socket = NULL;
+    }
+    text_sent_len = 0;
+}
+
+static int textserver_activate(void)
+{
+    vice_network_socket_address_t *server_addr;
+
+    if (textserver_address == NULL) {
+        return -1;
+    }
+
+    server_addr = vice_network_address_generate(textserver_address, 0);
+    if (server_addr == NULL) {
+        log_error(LOG_DEFAULT, "CRTC text server: invalid address %s.", textserver_address);
+        return -1;
+    }
+
+    listen_socket = vice_network_server(server_addr);
+    vice_network_address_close(server_addr);
+
+    if (listen_socket == NULL) {
+        log_error(LOG_DEFAULT, "CRTC text server: cannot listen on %s.", textserver_address);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void textserver_deactivate(void)
+{
+    textserver_close_client();
+
+    if (listen_socket != NULL) {
+        vice_network_socket_close(listen_socket);
+        listen_socket = NULL;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Convert a screen code.  Without the lowercase character set, the codes
+   of the lowercase letters show uppercase ones and the uppercase ones show
+   graphics.  */
+static char textserver_screencode_to_ascii(uint8_t code, int lowercase)
+{
+    uint8_t c;
+
+    c = charset_p_toascii(charset_screencode_to_petscii(code), CONVERT_WITHOUT_CTRLCODES);
+
+    if (!lowercase) {
+        if (c >= 'a' && c <= 'z') {
+            c = (uint8_t)(c - 'a' + 'A');
+        } else if (c >= 'A' && c <= 'Z') {
+            c = '.';
+        }
+    }
+    return (char)c;
+}
+
+static size_t textserver_build_text(void)
+{
+    unsigned int cols, rows, row, col, start, rel;
+    int lowercase;
+    size_t len = 0;
+
+    cols = crtc.regs[CRTC_REG_HDISP] * crtc.hw_cols;
+    rows = crtc.regs[CRTC_REG_VDISP] & 0x7f;
+    if (crtc.screen_base == NULL) {
+        rows = 0;
+    }
+
+    if (text_size < 1 + rows * (cols + 1)) {
+        text_size = 1 + rows * (cols + 1);
+        text = lib_realloc(text, text_size);
+        text_sent = lib_realloc(text_sent, text_size);
+    }
+
+    start = ((crtc.regs[CRTC_REG_DISPSTARTL] | (crtc.regs[CRTC_REG_DISPSTARTH] << 8))
+             & crtc.vaddr_mask) * crtc.hw_cols;
+    lowercase = (crtc.chargen_rel & (256 << 4)) != 0;
+
+    text[len++] = '\f';
+    for (row = 0, rel = start; row < rows; row++) {
+        for (col = 0; col < cols; col++, rel++) {
+            text[len++] = textserver_screencode_to_ascii(crtc.screen_base[rel & crtc.vaddr_mask_eff],
+                                                         lowercase);
+        }
+        text[len++] = '\n';
+    }
+
+    return len;
+}
+
+static void textserver_send_screen(void)
+{
+    size_t len = textserver_build_text();
+
+    if (len == text_sent_len && memcmp(text, text_sent, len) == 0) {
+        unchanged_frames++;
+        return;
+    }
+    unchanged_frames = 0;
+
+    if (vice_network_send(client_socket, text, len, 0) != (int)len) {
+        textserver_close_client();
+        return;
+    }
+
+    memcpy(text_sent, text, len);
+    text_sent_len = len;
+}
+
+/* Type what the client sent, once the previous input was taken.  */
+static void textserver_receive_input(void)
+{
+    uint8_t buffer[TEXTSERVER_INPUT_SIZE];
+    char keys[TEXTSERVER_INPUT_SIZE + 1];
+    int count, i, n = 0;
+    int lowercase;
+    uint8_t c;
+
+    if (!kbdbuf_queue_is_empty() || vice_network_select_poll_one(client_socket) <= 0) {
+        return;
+    }
+
+    count = vice_network_receive(client_socket, buffer, sizeof(buffer), 0);
+    if (count <= 0) {
+        textserver_close_client();
+        return;
+    }
+
+    lowercase = (crtc.chargen_rel & (256 << 4)) != 0;
+
+    for (i = 0; i < count; i++) {
+        c = buffer[i];
+        if (c == '\n' && input_after_cr) {
+            input_after_cr = 0;
+            continue;
+        }
+        input_after_cr = (c == '\r');
+
+        if (c == '\r' || c == '\n') {
+            c = 0x0d;
+        } else if (c == 0x08 || c == 0x7f) {
+            c = 0x14;   /* DEL */
+        } else {
+            /* without lowercase, the unshifted letters show uppercase */
+            if (!lowercase && c >= 'A' && c <= 'Z') {
+                c = (uint8_t)(c - 'A' + 'a');
+            }
+            c = charset_p_topetscii(c);
+        }
+        keys[n++] = (char)c;
+    }
+    keys[n] = '\0';
+
+    if (n > 0) {
+        unchanged_frames = 0;
+        kbdbuf_feed(keys);
+    }
+}
+
+/* Wait for the client while the screen stays the same.  */
+static void textserver_idle(void)
+{
+    vice_network_socket_t *sockets[3];
+    int timeout;
+
+    if (catch_up_frames > 0) {
+        catch_up_frames--;
+        return;
+    }
+
+    if (textserver_idle_sleep <= 0
+        || unchanged_frames < TEXTSERVER_IDLE_FRAMES
+        || !kbdbuf_queue_is_empty()) {
+        return;
+    }
+
+    timeout = textserver_idle_sleep;
+    if (timeout > TEXTSERVER_MAX_SLEEP) {
+        timeout = TEXTSERVER_MAX_SLEEP;
+    }
+
+    sockets[0] = listen_socket;
+    sockets[1] = client_socket;
+    sockets[2] = NULL;
+
+    mainlock_yield_begin();
+    vice_network_select_multiple_timeout(sockets, (unsigned int)timeout * 1000);
+    mainlock_yield_end();
+
+    /* do not sleep again before the frames due meanwhile were emulated */
+    catch_up_frames = (unsigned int)(timeout * vsync_get_refresh_frequency() / 1000.0) + 1;
+}
+
+void crtc_textserver_end_of_frame(void)
+{
+    if (listen_socket == NULL || !crtc.initialized) {
+        return;
+    }
+
+    if (client_socket == NULL) {
+        if (vice_network_select_poll_one(listen_socket) > 0) {
+            client_socket = vice_network_accept(listen_socket);
+            text_sent_len = 0;
+            input_after_cr = 0;
+        }
+        if (client_socket == NULL) {
+            unchanged_frames = TEXTSERVER_IDLE_FRAMES;
+            textserver_idle();
+            return;
+        }
+    }
+
+    textserver_receive_input();
+    if (client_socket != NULL) {
+        textserver_send_screen();
+    }
+    textserver_idle();
+}
+
+int crtc_textserver_active(void)
+{
+    return listen_socket != NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_textserver_enabled(int val, void *param)
+{
+    val = val ? 1 : 0;
+
+    if (val && listen_socket == NULL) {
+        if (textserver_activate() < 0) {
+            return -1;
+        }
+    } else if (!val) {
+        textserver_deactivate();
+    }
+
+    textserver_enabled = val;
+    return 0;
+}
+
+static int set_textserver_address(const char *name, void *param)
+{
+    if (textserver_address != NULL && name != NULL
+        && strcmp(name, textserver_address) == 0) {
+        return 0;
+    }
+
+    textserver_deactivate();
+    util_string_set(&textserver_address, name);
+
+    if (textserver_enabled) {
+        textserver_activate();
+    }
+
+    return 0;
+}
+
+static int set_textserver_idle_sleep(int val, void *param)
+{
+    if (val < 0 || val > TEXTSERVER_MAX_SLEEP) {
+        return -1;
+    }
+
+    textserver_idle_sleep = val;
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "CrtcTextServerAddress", "ip4://127.0.0.1:6520", RES_EVENT_NO, NULL,
+      &textserver_address, set_textserver_address, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+static const resource_int_t resources_int[] = {
+    { "CrtcTextServer", 0, RES_EVENT_NO, NULL,
+      &textserver_enabled, set_textserver_enabled, NULL },
+    { "CrtcTextServerIdleSleep", 100, RES_EVENT_NO, NULL,
+      &textserver_idle_sleep, set_textserver_idle_sleep, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int crtc_textserver_resources_init(void)
+{
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-crtctextserver", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "CrtcTextServer", (resource_value_t)1,
+      NULL, "Serve the text screen over a socket instead of drawing it" },
+    { "+crtctextserver", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "CrtcTextServer", (resource_value_t)0,
+      NULL, "Draw the screen, do not serve it as text (default)" },
+    { "-crtctextserveraddress", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "CrtcTextServerAddress", NULL,
+      "<Name>", "The local address the text server should bind to" },
+    { "-crtctextserveridle", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "CrtcTextServerIdleSleep", NULL,
+      "<ms>", "Wait up to <ms> milliseconds for the client while the screen does not change (0: never)" },
+    CMDLINE_LIST_END
+};
+
+int crtc_textserver_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void crtc_textserver_shutdown(void)
+{
+    textserver_deactivate();
+
+    lib_free(textserver_address);
+    textserver_address = NULL;
+    lib_free(text);
+    text = NULL;
+    lib_free(text_sent);
+    text_sent = NULL;
+    text_size = 0;
+}
+
+#else
+
+int crtc_textserver_resources_init(void)
+{
+    return 0;
+}
+
+int crtc_textserver_cmdline_options_init(void)
+{
+    return 0;
+}
+
+void crtc_textserver_shutdown(void)
+{
+}
+
+int crtc_textserver_active(void)
+{
+    return 0;
+}
+
+void crtc_textserver_end_of_frame(void)
+{
+}
+
+#endif
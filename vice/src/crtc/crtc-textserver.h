@@ -0,0 +1,36 @@
+/*
+ * crtc-textserver.h - Serve the CRTC text screen over a socket.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_CRTC_TEXTSERVER_H
+#define VICE_CRTC_TEXTSERVER_H
+
+int crtc_textserver_resources_init(void);
+int crtc_textserver_cmdline_options_init(void);
+void crtc_textserver_shutdown(void);
+
+/* Nonzero while the text server replaces the video output.  */
+int crtc_textserver_active(void);
+
+void crtc_textserver_end_of_frame(void);
+
+#endif
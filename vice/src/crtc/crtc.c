@@ -46,6 +46,7 @@
 #include "crtc-cmdline-options.h"
 #include "crtc-color.h"
 #include "crtc-draw.h"
+#include "crtc-textserver.h"
 #include "crtc-mem.h"
 #include "crtc-resources.h"
 #include "crtc.h"
@@ -355,6 +356,7 @@ void crtc_update_window(void)
                                 - 2 * CRTC_SCREEN_BORDERWIDTH;
 
     crtc_update_renderer();
+    crtc_draw_invalidate();
 
     raster_set_geometry(&crtc.raster,
                         crtc.screen_width, crtc.screen_height - 2 * CRTC_SCREEN_BORDERHEIGHT,
@@ -556,6 +558,7 @@ struct video_canvas_s *crtc_get_canvas(void)
 void crtc_reset(void)
 {
     raster_reset(&crtc.raster);
+    crtc_draw_invalidate();
 
     alarm_set(crtc.raster_draw_alarm, CRTC_CYCLES_PER_LINE());
 
@@ -706,6 +709,12 @@ static void crtc_raster_draw_alarm_handler(CLOCK offset, void *data)
     if ((crtc.framelines - crtc.current_line) == crtc.screen_yoffset) {
         crtc.raster.current_line = 0;
         raster_canvas_handle_end_of_frame(&crtc.raster);
+        crtc_draw_end_of_frame();
+        crtc_textserver_end_of_frame();
+        if (crtc_textserver_active()) {
+            /* the screen is only served as text */
+            crtc.raster.skip_frame = 1;
+        }
         vsync_do_vsync(crtc.raster.canvas);
     }
 
@@ -1013,6 +1022,8 @@ void crtc_update_prefetch(uint16_t addr, uint8_t value)
 void crtc_shutdown(void)
 {
     raster_shutdown(&crtc.raster);
+    crtc_draw_shutdown();
+    crtc_textserver_shutdown();
 }
 
 /* ------------------------------------------------------------------- */
@@ -30,11 +30,14 @@
 
 #include "vice.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 #include "alarm.h"
 #include "autostart.h"
+#include "autowarp.h"
 #include "cmdline.h"
 #include "datasette.h"
 #include "datasette-sound.h"
@@ -66,6 +69,15 @@
 /* at least every DATASETTE_MAX_GAP cycle there should be an alarm */
 #define DATASETTE_MAX_GAP   100000
 
+/* the tape position is indexed every DATASETTE_INDEX_STEP pulses */
+#define DATASETTE_INDEX_STEP    1024
+
+/* a leader is a run of at least DATASETTE_LEADER_MIN pulses of about the
+   same length; when skipped, the loader still gets DATASETTE_LEADER_KEEP
+   pulses of it at the start and the end */
+#define DATASETTE_LEADER_MIN    4096
+#define DATASETTE_LEADER_KEEP   512
+
 
 /* Attached TAP tape image.  */
 static tap_t *current_image[TAPEPORT_MAX_PORTS];
@@ -103,6 +115,29 @@ static long datasette_cycles_per_second;
 /* Remember the reset of tape-counter.  */
 static int datasette_counter_offset[TAPEPORT_MAX_PORTS];
 
+/* Position in the TAP file and tape counter in machine-cycles/8.  */
+typedef struct datasette_mark_s {
+    int pos;
+    int cycle_counter;
+} datasette_mark_t;
+
+/* Index of the attached tape, built when attaching, and the leaders found
+   on it (pairs of marks: where the skip starts and where it lands).  */
+typedef struct datasette_index_s {
+    datasette_mark_t *marks;
+    int num_marks;
+    datasette_mark_t *leaders;
+    int num_leaders;
+} datasette_index_t;
+
+static datasette_index_t datasette_index[TAPEPORT_MAX_PORTS];
+
+/* skip the middle of leaders when playing */
+static int datasette_skip_leader;
+
+/* let the Kernal tape traps load from TAP images, see tape.c */
+int datasette_tap_traps;
+
 /* app_resource datasette */
 /* shall the datasette reset when the CPU does? */
 static int reset_datasette_with_maincpu;
@@ -143,6 +178,7 @@ static void datasette_event_record(int command);
 static void datasette_control_internal(int port, int command);
 
 static void datasette_set_motor(int port, int flag);
+static void datasette_leader_skip(int port);
 static void datasette_toggle_write_bit(int port, int write_bit);
 
 static int datasette_write_snapshot(int port, snapshot_t *s, int write_image);
@@ -249,6 +285,21 @@ static int datasette_enable(int port, int value)
     return 0;
 }
 
+static int set_datasette_skip_leader(int val, void *param)
+{
+    datasette_skip_leader = val ? 1 : 0;
+
+    return 0;
+}
+
+static int set_datasette_tap_traps(int val, void *param)
+{
+    datasette_tap_traps = val ? 1 : 0;
+    tape_traps_update();
+
+    return 0;
+}
+
 static int set_datasette_sound_emulation(int val, void *param)
 {
     datasette_sound_emulation = val ? 1 : 0;
@@ -287,6 +338,12 @@ static const resource_int_t resources_int[] = {
     { "DatasetteTapeAzimuthError", TAP_AZIMUTH_ERROR_DEFAULT, RES_EVENT_SAME, NULL,
       &datasette_tape_azimuth_error,
       set_datasette_tape_azimuth_error, NULL },
+    { "DatasetteSkipLeader", 0, RES_EVENT_STRICT, (resource_value_t)0,
+      &datasette_skip_leader,
+      set_datasette_skip_leader, NULL },
+    { "DatasetteTapTraps", 0, RES_EVENT_STRICT, (resource_value_t)0,
+      &datasette_tap_traps,
+      set_datasette_tap_traps, NULL },
     { "DatasetteSound", 0, RES_EVENT_SAME, NULL,
       &datasette_sound_emulation,
       set_datasette_sound_emulation, NULL },
@@ -332,6 +389,18 @@ static const cmdline_option_t cmdline_options[] =
     { "-dstapeerror", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "DatasetteTapeAzimuthError", NULL,
       "<value>", "Set amount of azimuth error (misalignment)" },
+    { "-dsskipleader", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteSkipLeader", (resource_value_t)1,
+      NULL, "Skip most of the leader tones when playing a tape" },
+    { "+dsskipleader", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteSkipLeader", (resource_value_t)0,
+      NULL, "Play the leader tones of a tape in full" },
+    { "-dstaptraps", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteTapTraps", (resource_value_t)1,
+      NULL, "Load the Kernal files of TAP images directly into memory" },
+    { "+dstaptraps", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DatasetteTapTraps", (resource_value_t)0,
+      NULL, "Load the files of TAP images by playing the tape" },
     { "-datasettesound", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "DatasetteSound", (resource_value_t)1,
       NULL, "Enable Datasette sound" },
@@ -814,6 +883,9 @@ static void datasette_read_bit(CLOCK offset, void *data)
         gap = datasette_long_gap_pending[port];
         datasette_long_gap_pending[port] = 0;
     } else {
+        if (datasette_skip_leader && current_image[port]->mode == DATASETTE_CONTROL_START) {
+            datasette_leader_skip(port);
+        }
         gap = datasette_read_gap(port, direction);
         if (gap) {
             datasette_long_gap_elapsed[port] = 0;
@@ -852,6 +924,21 @@ static void datasette_read_bit(CLOCK offset, void *data)
     datasette_update_ui_counter(port);
 }
 
+/* Whether a tape plays with the motor on.  */
+static int datasette_playing(void)
+{
+    int port;
+
+    for (port = 0; port < TAPEPORT_MAX_PORTS; port++) {
+        if (current_image[port] != NULL
+            && current_image[port]->mode == DATASETTE_CONTROL_START
+            && datasette_motor[port]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 void datasette_init(void)
 {
     int i;
@@ -864,6 +951,8 @@ void datasette_init(void)
                                        datasette_read_bit, vice_int_to_ptr(i));
     }
 
+    autowarp_set_tape_detector(datasette_playing);
+
     datasette_cycles_per_second = machine_get_cycles_per_second();
     if (!datasette_cycles_per_second) {
         log_error(datasette_log,
@@ -876,23 +965,214 @@ void datasette_init(void)
     }
 }
 
-void datasette_set_tape_image(int port, tap_t *image)
+static void datasette_index_free(int port)
+{
+    lib_free(datasette_index[port].marks);
+    lib_free(datasette_index[port].leaders);
+    memset(&datasette_index[port], 0, sizeof(datasette_index_t));
+}
+
+static void datasette_index_add(datasette_mark_t **marks, int *num, int *size,
+                                const datasette_mark_t *mark)
+{
+    if (*num == *size) {
+        *size = *size ? *size * 2 : 64;
+        *marks = lib_realloc(*marks, *size * sizeof(datasette_mark_t));
+    }
+    (*marks)[(*num)++] = *mark;
+}
+
+/* Walk the whole tape once: get its length for the counter, index the
+   position every DATASETTE_INDEX_STEP pulses and find the leaders.  The
+   leaders are not looked for on C16 tapes, whose half waves do not match
+   the pulses in the file.  */
+static void datasette_index_build(int port)
+{
+    datasette_index_t *index = &datasette_index[port];
+    tap_t *image = current_image[port];
+    datasette_mark_t run[DATASETTE_LEADER_KEEP];
+    datasette_mark_t mark, skip_from = { 0, 0 };
+    int marks_size = 0, leaders_size = 0;
+    int find_leaders = machine_tape_behaviour() != TAPE_BEHAVIOUR_C16;
+    int pulses, run_length = 0;
+    CLOCK gap, run_gap = 0;
+
+    datasette_index_free(port);
+    image->cycle_counter_total = 0;
+
+    for (pulses = 0; ; pulses++) {
+        mark.pos = image->current_file_seek_position;
+        mark.cycle_counter = image->cycle_counter_total;
+        if ((pulses % DATASETTE_INDEX_STEP) == 0 && !fullwave[port]) {
+            datasette_index_add(&index->marks, &index->num_marks, &marks_size, &mark);
+        }
+
+        gap = datasette_read_gap(port, 1);
+
+        if (find_leaders) {
+            if (gap && run_length > 0
+                && gap >= run_gap - run_gap / 8 && gap <= run_gap + run_gap / 8) {
+                run_length++;
+            } else {
+                if (run_length >= DATASETTE_LEADER_MIN) {
+                    datasette_index_add(&index->leaders, &index->num_leaders,
+                                        &leaders_size, &skip_from);
+                    datasette_index_add(&index->leaders, &index->num_leaders,
+                                        &leaders_size,
+                                        &run[run_length % DATASETTE_LEADER_KEEP]);
+                }
+                run_gap = gap;
+                run_length = 1;
+            }
+            run[(run_length - 1) % DATASETTE_LEADER_KEEP] = mark;
+            if (run_length == DATASETTE_LEADER_KEEP + 1) {
+                skip_from = mark;
+            }
+        }
+
+        if (!gap) {
+            break;
+        }
+        image->cycle_counter_total += gap / 8;
+    }
+    index->num_leaders /= 2;
+}
+
+/* Skip to the end of a leader when its start has been played.  */
+static void datasette_leader_skip(int port)
 {
+    datasette_index_t *index = &datasette_index[port];
+    tap_t *image = current_image[port];
+    int lo = 0, hi = index->num_leaders - 1, mid;
+    datasette_mark_t *from, *to;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        from = &index->leaders[mid * 2];
+        if (from->pos < image->current_file_seek_position) {
+            lo = mid + 1;
+        } else if (from->pos > image->current_file_seek_position) {
+            hi = mid - 1;
+        } else {
+            to = from + 1;
+            image->current_file_seek_position = to->pos;
+            image->cycle_counter += to->cycle_counter - from->cycle_counter;
+            last_tap[port] = next_tap[port] = 0;
+            return;
+        }
+    }
+}
+
+/* Move the tape to the index mark `start' and play it from there until the
+   counter or the position in the TAP file reaches the given value.  */
+static void datasette_seek_from(int port, const datasette_mark_t *start,
+                                int cycle_counter, int pos)
+{
+    tap_t *image = current_image[port];
     CLOCK gap;
 
+    image->current_file_seek_position = start->pos;
+    image->cycle_counter = start->cycle_counter;
+    last_tap[port] = next_tap[port] = 0;
+    fullwave[port] = 0;
+    while (image->cycle_counter < cycle_counter
+           && image->current_file_seek_position < pos) {
+        gap = datasette_read_gap(port, 1);
+        if (!gap) {
+            break;
+        }
+        image->cycle_counter += gap / 8;
+    }
+    last_tap[port] = next_tap[port] = 0;
+
+    datasette_long_gap_pending[port] = 0;
+    datasette_long_gap_elapsed[port] = 0;
+    datasette_last_direction[port] = 0;
+    datasette_update_ui_counter(port);
+}
+
+/* Move the tape to where the counter shows the given value, using the
+   index.  The datasette has to be stopped.  */
+int datasette_seek_counter(int port, int counter)
+{
+    datasette_index_t *index = &datasette_index[port];
+    tap_t *image = current_image[port];
+    int lo, hi, mid, target, raw;
+    datasette_mark_t start = { 0, 0 };
+    double t;
+
+    if (image == NULL || image->mode != DATASETTE_CONTROL_STOP
+        || counter < 0 || counter > 999
+        || event_playback_active() || event_record_active()
+        || network_connected()) {
+        return -1;
+    }
+
+    /* invert the counter formula, see datasette_update_ui_counter() */
+    raw = (counter + datasette_counter_offset[port]) % 1000;
+    t = (raw / DS_G + ds_c3) * (raw / DS_G + ds_c3);
+    t = (t - ds_c2) / ds_c1;
+    target = (int)ceil(t * (datasette_cycles_per_second / 8.0));
+    if (target > image->cycle_counter_total) {
+        return -1;
+    }
+
+    lo = 0;
+    hi = index->num_marks - 1;
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (index->marks[mid].cycle_counter <= target) {
+            start = index->marks[mid];
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    datasette_seek_from(port, &start, target, INT_MAX);
+
+    return 0;
+}
+
+/* Move the tape to the position `pos' in the TAP file, as the tape traps do
+   after reading a file from it.  */
+void datasette_seek_position(int port, int pos)
+{
+    datasette_index_t *index = &datasette_index[port];
+    int lo, hi, mid;
+    datasette_mark_t start = { 0, 0 };
+
+    if (current_image[port] == NULL) {
+        return;
+    }
+
+    lo = 0;
+    hi = index->num_marks - 1;
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (index->marks[mid].pos <= pos) {
+            start = index->marks[mid];
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    datasette_seek_from(port, &start, INT_MAX, pos);
+}
+
+void datasette_set_tape_image(int port, tap_t *image)
+{
     DBG(("datasette_set_tape_image (image present:%s)", image ? "yes" : "no"));
 
     current_image[port] = image;
     last_tap[port] = next_tap[port] = 0;
     datasette_internal_reset(port);
+    datasette_index_free(port);
 
     if (image != NULL) {
         /* We need the length of tape for realistic counter. */
-        current_image[port]->cycle_counter_total = 0;
-        do {
-            gap = datasette_read_gap(port, 1);
-            current_image[port]->cycle_counter_total += gap / 8;
-        } while (gap);
+        datasette_index_build(port);
         current_image[port]->current_file_seek_position = 0;
         datasette_sound_set_halfwaves(current_image[port]->version == 2);
     }
@@ -1075,6 +1355,8 @@ static void datasette_control_internal(int port, int command)
                 break;
             case DATASETTE_CONTROL_RECORD:
                 if (current_image[port]->read_only == 0) {
+                    /* the recording makes the index wrong */
+                    datasette_index_free(port);
                     current_image[port]->mode = DATASETTE_CONTROL_RECORD;
                     if (datasette_enabled[port]) {
                         tapeport_set_tape_sense(1, port);
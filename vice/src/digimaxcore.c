@@ -149,6 +149,10 @@ static uint8_t digimax_sound_machine_read(sound_t *psid, uint16_t addr)
 
 static void digimax_sound_reset(sound_t *psid, CLOCK cpu_clk)
 {
+    sound_dac_discard(&digimax_dac[0]);
+    sound_dac_discard(&digimax_dac[1]);
+    sound_dac_discard(&digimax_dac[2]);
+    sound_dac_discard(&digimax_dac[3]);
     snd.voice[0] = 0;
     snd.voice[1] = 0;
     snd.voice[2] = 0;
@@ -158,3 +162,14 @@ static void digimax_sound_reset(sound_t *psid, CLOCK cpu_clk)
     digimax_sound_data[2] = 0;
     digimax_sound_data[3] = 0;
 }
+
+/* Store `value' to DAC `addr', queued with its clock if possible.  */
+static void digimax_sound_dac_store(uint16_t addr, uint8_t value)
+{
+    digimax_sound_data[addr] = value;
+    if (sound_dac_store(&digimax_dac[addr], (int)value * 64) == 0) {
+        snd.voice[addr] = value;
+    } else {
+        sound_store((uint16_t)(digimax_sound_chip_offset | addr), value, 0);
+    }
+}
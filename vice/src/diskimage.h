@@ -82,6 +82,7 @@
 
 struct fsimage_s;
 struct rawimage_s;
+struct realimage_s;
 struct gcr_s;
 struct TP64Image;
 struct disk_track_s;
@@ -90,6 +91,7 @@ struct disk_image_s {
     union media_u {
         struct fsimage_s *fsimage;
         struct rawimage_s *rawimage;
+        struct realimage_s *realimage;
     } media;
     unsigned int read_only;
     unsigned int device; /* FS/REAL/RAW */
@@ -125,6 +127,7 @@ void disk_image_rawimage_driver_name_set(disk_image_t *image);
 
 void disk_image_name_set(disk_image_t *image, const char *name);
 const char *disk_image_name_get(const disk_image_t *image);
+const char *disk_image_type(const disk_image_t *image);
 
 disk_image_t *disk_image_create(void);
 void disk_image_destroy(disk_image_t *image);
@@ -134,6 +137,8 @@ void disk_image_media_destroy(disk_image_t *image);
 
 int disk_image_open(disk_image_t *image);
 int disk_image_close(disk_image_t *image);
+int disk_image_buffer(disk_image_t *image);
+void disk_image_buffer_discard(disk_image_t *image);
 
 int disk_image_read_sector(const disk_image_t *image, uint8_t *buf, const disk_addr_t *dadr);
 int disk_image_write_sector(disk_image_t *image, const uint8_t *buf, const disk_addr_t *dadr);
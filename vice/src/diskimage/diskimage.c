@@ -399,7 +399,7 @@ int disk_image_check_sector(const disk_image_t *image, unsigned int track,
  *
  * \return  disk image identifier (nul-terminated 3-char string)
  */
-static const char *disk_image_type(const disk_image_t *image)
+const char *disk_image_type(const disk_image_t *image)
 {
     switch (image->type) {
         case DISK_IMAGE_TYPE_D80: return "D80";
@@ -647,6 +647,23 @@ int disk_image_close(disk_image_t *image)
     return rc;
 }
 
+/* Hold the contents of the image in memory until it is closed.  */
+int disk_image_buffer(disk_image_t *image)
+{
+    if (image->device != DISK_IMAGE_DEVICE_FS) {
+        return -1;
+    }
+    return fsimage_buffer(image);
+}
+
+/* Drop the contents held in memory without writing them back.  */
+void disk_image_buffer_discard(disk_image_t *image)
+{
+    if (image->device == DISK_IMAGE_DEVICE_FS) {
+        fsimage_buffer_discard(image);
+    }
+}
+
 /*-----------------------------------------------------------------------*/
 
 int disk_image_read_sector(const disk_image_t *image, uint8_t *buf, const disk_addr_t *dadr)
@@ -46,6 +46,7 @@
 #include "types.h"
 #include "util.h"
 #include "x64.h"
+#include "zfile.h"
 #include "p64.h"
 #include "cbmdos.h"
 
@@ -612,7 +613,11 @@ int fsimage_create(const char *name, unsigned int type)
     image->type = type;
 
     fsimage->name = lib_strdup(name);
-    fsimage->fd = fopen(name, MODE_WRITE);
+    if (zfile_memory_file_exists(name)) {
+        fsimage->fd = zfile_fopen(name, MODE_WRITE);
+    } else {
+        fsimage->fd = fopen(name, MODE_WRITE);
+    }
 
     if (fsimage->fd == NULL) {
         log_error(createdisk_log, "Cannot create disk image `%s'.",
@@ -648,7 +653,7 @@ int fsimage_create(const char *name, unsigned int type)
             break;
     }
 
-    fclose(fsimage->fd);
+    zfile_fclose(fsimage->fd);
     lib_free(fsimage->name);
     lib_free(fsimage);
     lib_free(image);
@@ -52,7 +52,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
     long offset;
     uint8_t *buffer;
     fsimage_t *fsimage = image->media.fsimage;
-    fdc_err_t rf;
+    fdc_err_t rf, *errors;
 
     track = half_track / 2;
 
@@ -76,8 +76,10 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     buffer = lib_calloc(max_sector, 256);
+    errors = lib_malloc(max_sector * sizeof(fdc_err_t));
+    gcr_read_track(raw, buffer, max_sector, errors);
     for (sector = 0; sector < max_sector; sector++) {
-        rf = gcr_read_sector(raw, &buffer[sector * 256], (uint8_t)sector);
+        rf = errors[sector];
         if (rf != CBMDOS_FDC_ERR_OK) {
             log_error(fsimage_dxx_log,
                       "Could not find data sector of T:%u S:%u.",
@@ -101,6 +103,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
             }
         }
     }
+    lib_free(errors);
     offset = sectors * 256;
 
 #ifdef HAVE_X64_IMAGE
@@ -108,7 +111,7 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buffer, max_sector * 256, offset) < 0) {
+    if (fsimage_pwrite(fsimage, buffer, max_sector * 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u to disk image.",
                   track);
         lib_free(buffer);
@@ -126,10 +129,10 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
 #endif
             fsimage->error_info.dirty = 0;
             if (error_info_created) {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map,
+                res = fsimage_pwrite(fsimage, fsimage->error_info.map,
                                    fsimage->error_info.len, fsimage->error_info.len * 256);
             } else {
-                res = util_fpwrite(fsimage->fd, fsimage->error_info.map + sectors,
+                res = fsimage_pwrite(fsimage, fsimage->error_info.map + sectors,
                                    max_sector, offset);
             }
             if (res < 0) {
@@ -142,7 +145,9 @@ int fsimage_dxx_write_half_track(disk_image_t *image, unsigned int half_track,
     }
 
     /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
+    if (fsimage->buffer.data == NULL) {
+        fflush(fsimage->fd);
+    }
     return 0;
 }
 
@@ -175,7 +180,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 
     bam_id[0] = bam_id[1] = 0xa0;
     if (sectors >= 0) {
-        util_fpread(fsimage->fd, buffer, 256, sectors << 8);
+        fsimage_pread(fsimage, buffer, 256, sectors << 8);
     } else {
         return -1;
     }
@@ -243,7 +248,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 
                 buffer[BAM_ID_1571] = buffer[BAM_ID_1571 + 1] = 0xa0;
                 if (sectors >= 0) {
-                    util_fpread(fsimage->fd, buffer, 256, sectors << 8);
+                    fsimage_pread(fsimage, buffer, 256, sectors << 8);
                 }
                 header.id1 = buffer[BAM_ID_1571]; /* second side, update id and track */
                 header.id2 = buffer[BAM_ID_1571 + 1];
@@ -270,7 +275,7 @@ int fsimage_read_dxx_image(const disk_image_t *image)
 #endif
                 if (sectors >= 0) {
                     rf = CBMDOS_FDC_ERR_DRIVE;
-                    if (util_fpread(fsimage->fd, buffer, 256, offset) >= 0) {
+                    if (fsimage_pread(fsimage, buffer, 256, offset) >= 0) {
                         if (fsimage->error_info.map != NULL) {
                             rf = fsimage->error_info.map[sectors];
                         }
@@ -373,7 +378,7 @@ int fsimage_dxx_read_sector(const disk_image_t *image, uint8_t *buf, const disk_
 
     if (harderror == 0) {
         if (image->gcr == NULL) {
-            if (util_fpread(fsimage->fd, buf, 256, offset) < 0) {
+            if (fsimage_pread(fsimage, buf, 256, offset) < 0) {
                 log_error(fsimage_dxx_log,
                         "Error reading T:%u S:%u from disk image.",
                         dadr->track, dadr->sector);
@@ -450,7 +455,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         offset += X64_HEADER_LENGTH;
     }
 #endif
-    if (util_fpwrite(fsimage->fd, buf, 256, offset) < 0) {
+    if (fsimage_pwrite(fsimage, buf, 256, offset) < 0) {
         log_error(fsimage_dxx_log, "Error writing T:%u S:%u to disk image.",
                   dadr->track, dadr->sector);
         return -1;
@@ -469,7 +474,7 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
         }
 #endif
         fsimage->error_info.map[sectors] = CBMDOS_FDC_ERR_OK;
-        if (util_fpwrite(fsimage->fd, &fsimage->error_info.map[sectors], 1, offset) < 0) {
+        if (fsimage_pwrite(fsimage, &fsimage->error_info.map[sectors], 1, offset) < 0) {
             log_error(fsimage_dxx_log,
                     "Error writing T:%u S:%u error info to disk image.",
                     dadr->track, dadr->sector);
@@ -477,7 +482,9 @@ int fsimage_dxx_write_sector(disk_image_t *image, const uint8_t *buf, const disk
     }
 
     /* Make sure the stream is visible to other readers.  */
-    fflush(fsimage->fd);
+    if (fsimage->buffer.data == NULL) {
+        fflush(fsimage->fd);
+    }
     return 0;
 }
 
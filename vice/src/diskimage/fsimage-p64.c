@@ -77,6 +77,8 @@ int fsimage_read_p64_image(const disk_image_t *image)
     P64MemoryStreamWrite(&P64MemoryStreamInstance, buffer, (p64_uint32_t)lSize);
     P64MemoryStreamSeek(&P64MemoryStreamInstance, 0);
     if (P64ImageReadFromStream(P64Image, &P64MemoryStreamInstance)) {
+        /* the tracks are decoded on their first access */
+        P64ImageClearModified(P64Image);
         rc = 0;
     } else {
         rc = -1;
@@ -99,6 +101,12 @@ int fsimage_write_p64_image(const disk_image_t *image)
 
     fsimage = image->media.fsimage;
 
+    /* nothing changed since the image was read or last written */
+    if (!P64ImageModified(P64Image)) {
+        return 0;
+    }
+
+    /* only the changed tracks are encoded again */
     P64MemoryStreamCreate(&P64MemoryStreamInstance);
     P64MemoryStreamClear(&P64MemoryStreamInstance);
     if (P64ImageWriteToStream(P64Image, &P64MemoryStreamInstance)) {
@@ -107,6 +115,7 @@ int fsimage_write_p64_image(const disk_image_t *image)
             log_error(fsimage_p64_log, "Could not write P64 disk image.");
         } else {
             fflush(fsimage->fd);
+            P64ImageClearModified(P64Image);
             rc = 0;
         }
     } else {
@@ -33,6 +33,7 @@
 #include "crt.h"
 #include "diskconstants.h"
 #include "diskimage.h"
+#include "driverom.h"
 #include "gcr.h"
 #include "fsimage-gcr.h"
 #include "fsimage-p64.h"
@@ -57,8 +58,18 @@
 #define IS_D2M_LEN(x) (((x) == D2M_FILE_SIZE) || ((x) == D2M_FILE_SIZE_E))
 #define IS_D4M_LEN(x) (((x) == D4M_FILE_SIZE) || ((x) == D4M_FILE_SIZE_E))
 
+#define PROBE_HEADER_LENGTH 64
+
 static log_t disk_image_probe_log = LOG_ERR;
 
+/* What the checks need to know about the file, read once by fsimage_probe()
+   so the checks for the wrong formats do not access the file at all.  */
+static struct {
+    off_t size;
+    uint8_t header[PROBE_HEADER_LENGTH];
+    size_t header_len;
+} probe;
+
 static void disk_image_check_log(disk_image_t *image, const char *type)
 {
     fsimage_t *fsimage;
@@ -79,6 +90,24 @@ static int disk_image_check_min_block(unsigned int blk, unsigned int length)
     return 0;
 }
 
+/* Return the number of whole blocks of the image, after making sure its end
+   can be read.  The size of the file is known, so reading the last block is
+   enough to find truncated or unreadable files.  */
+static unsigned int disk_image_check_blocks(disk_image_t *image)
+{
+    uint8_t block[256];
+    size_t len;
+
+    if (probe.size <= 0) {
+        return 0;
+    }
+    len = probe.size < 256 ? (size_t)probe.size : 256;
+    if (util_fpread(image->media.fsimage->fd, block, len, (long)(probe.size - (off_t)len)) < 0) {
+        return 0;
+    }
+    return (unsigned int)(probe.size / 256);
+}
+
 
 static int disk_image_check_for_d64(disk_image_t *image)
 {
@@ -87,7 +116,7 @@ static int disk_image_check_for_d64(disk_image_t *image)
          and compare this with the size of the given image. */
 
     int checkimage_tracks, checkimage_errorinfo;
-    size_t countbytes, checkimage_blocks;
+    size_t checkimage_blocks;
     off_t checkimage_realsize;
     fsimage_t *fsimage;
 
@@ -95,7 +124,7 @@ static int disk_image_check_for_d64(disk_image_t *image)
 
     checkimage_errorinfo = 0;
 
-    checkimage_realsize = archdep_file_size(fsimage->fd);
+    checkimage_realsize = probe.size;
     checkimage_tracks = NUM_TRACKS_1541; /* start at track 35 */
     checkimage_blocks = D64_FILE_SIZE_35 / 256;
 
@@ -121,14 +150,11 @@ static int disk_image_check_for_d64(disk_image_t *image)
         }
     }
 
-    /*** test image file: read it (fgetc is pretty fast).
+    /*** test image file: read its end.
          further size checks are no longer necessary (done during detection) */
-    rewind(fsimage->fd);
-    for (countbytes = 0; countbytes < checkimage_realsize; countbytes++) {
-        if (fgetc(fsimage->fd) == EOF) {
-            log_error(disk_image_probe_log, "Cannot read D64 image.");
-            return 0;
-        }
+    if (disk_image_check_blocks(image) == 0) {
+        log_error(disk_image_probe_log, "Cannot read D64 image.");
+        return 0;
     }
 
     /*** set parameters in image structure, read error info */
@@ -153,13 +179,8 @@ static int disk_image_check_for_d64(disk_image_t *image)
 static int disk_image_check_for_d67(disk_image_t *image)
 {
     unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
 
-    if (!(IS_D67_LEN(archdep_file_size(fsimage->fd)))) {
+    if (!(IS_D67_LEN(probe.size))) {
         return 0;
     }
 
@@ -167,15 +188,7 @@ static int disk_image_check_for_d67(disk_image_t *image)
     image->tracks = NUM_TRACKS_2040;
     image->max_half_tracks = MAX_TRACKS_2040 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        /* FIXME */
-        if (++blk > (NUM_BLOCKS_2040)) {
-            log_error(disk_image_probe_log, "Disk image too large");
-            break;
-        }
-    }
+    blk = disk_image_check_blocks(image);
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_2040) < 0) {
         return 0;
@@ -196,14 +209,12 @@ static int disk_image_check_for_d67(disk_image_t *image)
 static int disk_image_check_for_d71(disk_image_t *image)
 {
     unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
     fsimage_t *fsimage;
     size_t checkimage_realsize;
     int checkimage_errorinfo;
 
     fsimage = image->media.fsimage;
-    checkimage_realsize = archdep_file_size(fsimage->fd);
+    checkimage_realsize = (size_t)probe.size;
     checkimage_errorinfo = 0;
 
     if (!(IS_D71_LEN(checkimage_realsize))) {
@@ -216,12 +227,9 @@ static int disk_image_check_for_d71(disk_image_t *image)
     image->tracks = NUM_TRACKS_1571;
     image->max_half_tracks = MAX_TRACKS_1571 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk == NUM_BLOCKS_1571) {
-            break;
-        }
+    blk = disk_image_check_blocks(image);
+    if (blk > NUM_BLOCKS_1571) {
+        blk = NUM_BLOCKS_1571;
     }
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_1571) < 0) {
@@ -244,15 +252,13 @@ static int disk_image_check_for_d81(disk_image_t *image)
 {
     unsigned int blk = 0;
     char *ext;
-    size_t len;
-    uint8_t block[256];
     fsimage_t *fsimage;
     int checkimage_errorinfo;
     unsigned int checkimage_blocks;
 
     fsimage = image->media.fsimage;
 
-    if (!(IS_D81_LEN(archdep_file_size(fsimage->fd)))) {
+    if (!(IS_D81_LEN(probe.size))) {
         return 0;
     }
 
@@ -263,14 +269,7 @@ static int disk_image_check_for_d81(disk_image_t *image)
         return 0;
     }
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > (MAX_BLOCKS_1581 + 13)) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
+    blk = disk_image_check_blocks(image);
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_1581) < 0) {
         return 0;
@@ -327,13 +326,8 @@ static int disk_image_check_for_d81(disk_image_t *image)
 static int disk_image_check_for_d80(disk_image_t *image)
 {
     unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
 
-    if (!(IS_D80_LEN(archdep_file_size(fsimage->fd)))) {
+    if (!(IS_D80_LEN(probe.size))) {
         return 0;
     }
 
@@ -341,14 +335,7 @@ static int disk_image_check_for_d80(disk_image_t *image)
     image->tracks = NUM_TRACKS_8050;
     image->max_half_tracks = MAX_TRACKS_8050 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_8050 + 6) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
+    blk = disk_image_check_blocks(image);
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_8050) < 0) {
         return 0;
@@ -369,13 +356,8 @@ static int disk_image_check_for_d80(disk_image_t *image)
 static int disk_image_check_for_d82(disk_image_t *image)
 {
     unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
 
-    if (!(IS_D82_LEN(archdep_file_size(fsimage->fd)))) {
+    if (!(IS_D82_LEN(probe.size))) {
         return 0;
     }
 
@@ -383,14 +365,7 @@ static int disk_image_check_for_d82(disk_image_t *image)
     image->tracks = NUM_TRACKS_8250;
     image->max_half_tracks = MAX_TRACKS_8250 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_8250 + 6) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
+    blk = disk_image_check_blocks(image);
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_8250) < 0) {
         return 0;
@@ -411,14 +386,9 @@ static int disk_image_check_for_d82(disk_image_t *image)
 #ifdef HAVE_X64_IMAGE
 static int disk_image_check_for_x64(disk_image_t *image)
 {
-    uint8_t header[X64_HEADER_LENGTH];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
+    const uint8_t *header = probe.header;
 
-    rewind(fsimage->fd);
-
-    if (fread(header, X64_HEADER_LENGTH, 1, fsimage->fd) < 1) {
+    if (probe.header_len < X64_HEADER_LENGTH) {
         return 0;
     }
 
@@ -451,12 +421,9 @@ static int disk_image_check_for_gcr(disk_image_t *image)
     */
     WORD max_track_length;
 #endif
-    uint8_t header[32];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
+    const uint8_t *header = probe.header;
 
-    if (util_fpread(fsimage->fd, header, sizeof (header), 0) < 0) {
+    if (probe.header_len < 32) {
         log_error(disk_image_probe_log, "Cannot read image header.");
         return 0;
     }
@@ -506,17 +473,14 @@ static int disk_image_check_for_gcr(disk_image_t *image)
 
 static int disk_image_check_for_p64(disk_image_t *image)
 {
-    uint8_t header[8];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
+    const uint8_t *header = probe.header;
 
-    if (util_fpread(fsimage->fd, header, sizeof(header), 0) < 0) {
+    if (probe.header_len < 8) {
         log_error(disk_image_probe_log, "Cannot read image header.");
         return 0;
     }
 
-    if (strncmp("P64-1541", (char*)header, 8)) {
+    if (strncmp("P64-1541", (const char *)header, 8)) {
         return 0;
     }
 
@@ -539,14 +503,12 @@ static int disk_image_check_for_d1m(disk_image_t *image)
 {
     unsigned int blk = 0;
     char *ext;
-    size_t len;
-    uint8_t block[256];
     fsimage_t *fsimage;
 
     fsimage = image->media.fsimage;
 
     /* reject files with unknown size */
-    if (!(IS_D1M_LEN(archdep_file_size(fsimage->fd)))) {
+    if (!(IS_D1M_LEN(probe.size))) {
         return 0;
     }
 
@@ -561,14 +523,7 @@ static int disk_image_check_for_d1m(disk_image_t *image)
     image->tracks = NUM_TRACKS_1000;
     image->max_half_tracks = MAX_TRACKS_1000 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_1000 + 13) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
+    blk = disk_image_check_blocks(image);
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_1000) < 0) {
         return 0;
@@ -590,13 +545,8 @@ static int disk_image_check_for_d1m(disk_image_t *image)
 static int disk_image_check_for_d2m(disk_image_t *image)
 {
     unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
 
-    if (!(IS_D2M_LEN(archdep_file_size(fsimage->fd)))) {
+    if (!(IS_D2M_LEN(probe.size))) {
         return 0;
     }
 
@@ -604,14 +554,7 @@ static int disk_image_check_for_d2m(disk_image_t *image)
     image->tracks = NUM_TRACKS_2000;
     image->max_half_tracks = MAX_TRACKS_2000 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_2000 + 26) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
+    blk = disk_image_check_blocks(image);
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_2000) < 0) {
         return 0;
@@ -633,14 +576,10 @@ static int disk_image_check_for_d2m(disk_image_t *image)
 static int disk_image_check_for_d4m(disk_image_t *image)
 {
     unsigned int blk = 0;
-    size_t len;
-    uint8_t block[256];
-    fsimage_t *fsimage;
 
-    fsimage = image->media.fsimage;
     image->tracks = NUM_TRACKS_2000;
 
-    if (!(IS_D4M_LEN(archdep_file_size(fsimage->fd)))) {
+    if (!(IS_D4M_LEN(probe.size))) {
         return 0;
     }
 
@@ -648,14 +587,7 @@ static int disk_image_check_for_d4m(disk_image_t *image)
     image->tracks = NUM_TRACKS_4000;
     image->max_half_tracks = MAX_TRACKS_4000 * 2;
 
-    rewind(fsimage->fd);
-
-    while ((len = fread(block, 1, 256, fsimage->fd)) == 256) {
-        if (++blk > NUM_BLOCKS_4000 + 51) {
-            log_error(disk_image_probe_log, "Disk image too large.");
-            break;
-        }
-    }
+    blk = disk_image_check_blocks(image);
 
     if (disk_image_check_min_block(blk, NUM_BLOCKS_4000) < 0) {
         return 0;
@@ -686,7 +618,9 @@ static int disk_image_check_for_dhd(disk_image_t *image)
     fsimage = image->media.fsimage;
     image->tracks = 65535;
 
-    blk = archdep_file_size(fsimage->fd);
+    blk = probe.size;
+
+    driverom_load_pending(DISK_IMAGE_TYPE_DHD);
 
     /* only allow blank images to be attached if the CMDHD rom is loaded */
     if (blk == 0) {
@@ -762,12 +696,8 @@ good:
 static int disk_image_check_for_d90(disk_image_t *image)
 {
     off_t blk = 0;
-    fsimage_t *fsimage;
-
-    fsimage = image->media.fsimage;
 
-    /* get file size */
-    blk = archdep_file_size(fsimage->fd);
+    blk = probe.size;
 
     /* only allow true D9090/D9060 image sizes right now */
     if (blk == D9060_FILE_SIZE) {
@@ -791,8 +721,62 @@ static int disk_image_check_for_d90(disk_image_t *image)
     return 1;
 }
 
+/* Try the check that matches the size or the header magic of the file.  The
+   checks for other formats would reject the file anyway, so this only saves
+   calling them; the extension only decides between D81 and D1M.  */
+static int disk_image_check_fast(disk_image_t *image)
+{
+    const char *magic = (const char *)probe.header;
+
+    if (IS_D81_LEN(probe.size)) {
+        return disk_image_check_for_d81(image) || disk_image_check_for_d1m(image);
+    }
+    if (IS_D67_LEN(probe.size)) {
+        return disk_image_check_for_d67(image);
+    }
+    if (IS_D71_LEN(probe.size)) {
+        return disk_image_check_for_d71(image);
+    }
+    if (IS_D80_LEN(probe.size)) {
+        return disk_image_check_for_d80(image);
+    }
+    if (IS_D82_LEN(probe.size)) {
+        return disk_image_check_for_d82(image);
+    }
+    if (IS_D2M_LEN(probe.size)) {
+        return disk_image_check_for_d2m(image);
+    }
+    if (IS_D4M_LEN(probe.size)) {
+        return disk_image_check_for_d4m(image);
+    }
+    if (probe.header_len >= 8) {
+        if (strncmp("P64-1541", magic, 8) == 0) {
+            return disk_image_check_for_p64(image);
+        }
+        if (strncmp("GCR-1541", magic, 8) == 0 || strncmp("GCR-1571", magic, 8) == 0) {
+            return disk_image_check_for_gcr(image);
+        }
+    }
+    /* the D64 sizes depend on the number of tracks; the check is cheap */
+    return disk_image_check_for_d64(image);
+}
+
 int fsimage_probe(disk_image_t *image)
 {
+    fsimage_t *fsimage;
+
+    fsimage = image->media.fsimage;
+
+    /* read the size and the header only once */
+    probe.size = archdep_file_size(fsimage->fd);
+    rewind(fsimage->fd);
+    probe.header_len = fread(probe.header, 1, PROBE_HEADER_LENGTH, fsimage->fd);
+
+    if (disk_image_check_fast(image)) {
+        return 0;
+    }
+
+    /* fall back to the full chain of checks */
     if (disk_image_check_for_d64(image)) {
         return 0;
     }
@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "archdep.h"
 #include "diskconstants.h"
@@ -131,8 +132,11 @@ int fsimage_open(disk_image_t *image)
     fsimage = image->media.fsimage;
     fsimage->error_info.map = NULL;
 
-    /* stat file to find out if it exists or if it is a directory */
-    if (archdep_stat(fsimage->name, &length, &isdir) < 0) {
+    /* stat file to find out if it exists or if it is a directory, images
+       that only exist in memory are neither */
+    if (zfile_memory_file_exists(fsimage->name)) {
+        isdir = 0;
+    } else if (archdep_stat(fsimage->name, &length, &isdir) < 0) {
         log_error(fsimage_log, "Cannot open file `%s'.", fsimage->name);
         return -1;
     }
@@ -161,7 +165,10 @@ int fsimage_open(disk_image_t *image)
         return -1;
     }
 
+    /* Serve the sector accesses from memory.  Only images are cached, the
+       probe itself reads little of the file.  */
     if (fsimage_probe(image) == 0) {
+        fsimage->fd = zfile_fcache(fsimage->fd);
         return 0;
     }
 
@@ -186,6 +193,16 @@ int fsimage_close(disk_image_t *image)
         fsimage_write_p64_image(image);
     }
 
+    if (fsimage->buffer.data != NULL) {
+        if (fsimage->buffer.dirty
+            && util_fpwrite(fsimage->fd, fsimage->buffer.data,
+                            (size_t)fsimage->buffer.size, 0) < 0) {
+            log_error(fsimage_log, "Cannot write back `%s'.", fsimage->name);
+        }
+        lib_free(fsimage->buffer.data);
+        fsimage->buffer.data = NULL;
+    }
+
     if (fsimage->error_info.map) {
         lib_free(fsimage->error_info.map);
         fsimage->error_info.map = NULL;
@@ -196,6 +213,95 @@ int fsimage_close(disk_image_t *image)
     return 0;
 }
 
+int fsimage_buffer(disk_image_t *image)
+{
+    fsimage_t *fsimage;
+    off_t size;
+    uint8_t *data;
+
+    fsimage = image->media.fsimage;
+
+    if (fsimage->fd == NULL || image->gcr != NULL) {
+        return -1;
+    }
+    if (fsimage->buffer.data != NULL) {
+        return 0;
+    }
+
+    switch (image->type) {
+        case DISK_IMAGE_TYPE_D64:
+        case DISK_IMAGE_TYPE_D67:
+        case DISK_IMAGE_TYPE_D71:
+        case DISK_IMAGE_TYPE_D81:
+        case DISK_IMAGE_TYPE_D80:
+        case DISK_IMAGE_TYPE_D82:
+#ifdef HAVE_X64_IMAGE
+        case DISK_IMAGE_TYPE_X64:
+#endif
+        case DISK_IMAGE_TYPE_D1M:
+        case DISK_IMAGE_TYPE_D2M:
+        case DISK_IMAGE_TYPE_D4M:
+        case DISK_IMAGE_TYPE_DHD:
+        case DISK_IMAGE_TYPE_D90:
+            break;
+        default:
+            return -1;
+    }
+
+    size = archdep_file_size(fsimage->fd);
+    if (size <= 0) {
+        return -1;
+    }
+
+    data = lib_malloc((size_t)size);
+    if (util_fpread(fsimage->fd, data, (size_t)size, 0) < 0) {
+        log_error(fsimage_log, "Cannot read `%s' into memory.", fsimage->name);
+        lib_free(data);
+        return -1;
+    }
+
+    fsimage->buffer.data = data;
+    fsimage->buffer.size = (long)size;
+    fsimage->buffer.dirty = 0;
+
+    return 0;
+}
+
+void fsimage_buffer_discard(disk_image_t *image)
+{
+    fsimage_t *fsimage;
+
+    fsimage = image->media.fsimage;
+
+    lib_free(fsimage->buffer.data);
+    fsimage->buffer.data = NULL;
+    fsimage->buffer.size = 0;
+    fsimage->buffer.dirty = 0;
+}
+
+/* Read from the image, from memory if it is held there.  */
+int fsimage_pread(fsimage_t *fsimage, void *buf, size_t num, long offset)
+{
+    if (fsimage->buffer.data != NULL
+        && offset >= 0 && offset + (long)num <= fsimage->buffer.size) {
+        memcpy(buf, fsimage->buffer.data + offset, num);
+        return 0;
+    }
+    return util_fpread(fsimage->fd, buf, num, offset);
+}
+
+/* Write to the image, to memory if it is held there.  */
+int fsimage_pwrite(fsimage_t *fsimage, const void *buf, size_t num, long offset)
+{
+    if (fsimage->buffer.data != NULL
+        && offset >= 0 && offset + (long)num <= fsimage->buffer.size) {
+        memcpy(fsimage->buffer.data + offset, buf, num);
+        fsimage->buffer.dirty = 1;
+        return 0;
+    }
+    return util_fpwrite(fsimage->fd, buf, num, offset);
+}
+
 /*-----------------------------------------------------------------------*/
 
 int fsimage_read_sector(const disk_image_t *image, uint8_t *buf, const disk_addr_t *dadr)
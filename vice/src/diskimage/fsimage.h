@@ -42,6 +42,12 @@ typedef struct fsimage_s {
         int dirty;
         int len;
     } error_info;
+    /* contents of the image while held in memory by fsimage_buffer() */
+    struct {
+        uint8_t *data;
+        long size;
+        int dirty;
+    } buffer;
 } fsimage_t;
 
 
@@ -61,4 +67,14 @@ int fsimage_write_sector(struct disk_image_s *image, const uint8_t *buf,
                          const struct disk_addr_s *dadr);
 off_t fsimage_size(const disk_image_t *image);
 
+/* Hold the contents of a sector based image in memory until it is closed:
+   sectors are then read from and written to memory, and the image file is
+   only written when it is closed.  Only for tools that have the image to
+   themselves, like c1541.  */
+int fsimage_buffer(struct disk_image_s *image);
+void fsimage_buffer_discard(struct disk_image_s *image);
+
+int fsimage_pread(fsimage_t *fsimage, void *buf, size_t num, long offset);
+int fsimage_pwrite(fsimage_t *fsimage, const void *buf, size_t num, long offset);
+
 #endif
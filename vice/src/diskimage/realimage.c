@@ -27,8 +27,10 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "diskimage.h"
+#include "lib.h"
 #include "log.h"
 #include "machine-bus.h"
 #include "realimage.h"
@@ -40,36 +42,99 @@ static log_t realimage_log = LOG_DEFAULT;
 
 void realimage_media_create(disk_image_t *image)
 {
+    realimage_t *realimage;
+
+    realimage = lib_calloc(1, sizeof(realimage_t));
+    realimage->unit = 8;
+
+    image->media.realimage = realimage;
 }
 
 void realimage_media_destroy(disk_image_t *image)
 {
+    lib_free(image->media.realimage);
+    image->media.realimage = NULL;
 }
 
 /*-----------------------------------------------------------------------*/
 
 int realimage_open(disk_image_t *image)
 {
+    image->media.realimage->cache_track = 0;
     return 0;
 }
 
 int realimage_close(disk_image_t *image)
 {
+    image->media.realimage->cache_track = 0;
     return 0;
 }
 
 /*-----------------------------------------------------------------------*/
 
+/* Every bus transaction with a real drive costs a full channel setup, so
+   the first access to a track fetches all of its sectors in one batch and
+   later accesses to the same track are served from memory.  */
+static int realimage_cache_track(realimage_t *realimage, unsigned int type,
+                                 unsigned int track)
+{
+    unsigned int sectors;
+
+    sectors = disk_image_sector_per_track(type, track);
+
+    if (sectors == 0 || sectors > REALIMAGE_TRACK_CACHE_SECTORS) {
+        return -1;
+    }
+
+    realimage->cache_track = 0;
+
+    if (machine_bus_lib_read_sectors(realimage->unit, track, 0, sectors,
+                                     realimage->cache) != 0) {
+        return -1;
+    }
+
+    realimage->cache_track = track;
+    realimage->cache_sectors = sectors;
+
+    return 0;
+}
+
 int realimage_read_sector(const disk_image_t *image, uint8_t *buf,
                           const disk_addr_t *dadr)
 {
-    return machine_bus_lib_read_sector(8, dadr->track, dadr->sector, buf);
+    realimage_t *realimage = image->media.realimage;
+
+    if (realimage->cache_track != dadr->track) {
+        if (realimage_cache_track(realimage, image->type, dadr->track) < 0) {
+            return machine_bus_lib_read_sector(realimage->unit, dadr->track,
+                                               dadr->sector, buf);
+        }
+    }
+
+    if (dadr->sector >= realimage->cache_sectors) {
+        return -1;
+    }
+
+    memcpy(buf, &realimage->cache[dadr->sector * 256], 256);
+
+    return 0;
 }
 
 int realimage_write_sector(disk_image_t *image, const uint8_t *buf,
                            const disk_addr_t *dadr)
 {
-    return 0;
+    realimage_t *realimage = image->media.realimage;
+    uint8_t data[256];
+
+    if (realimage->cache_track == dadr->track
+        && dadr->sector < realimage->cache_sectors) {
+        memcpy(&realimage->cache[dadr->sector * 256], buf, 256);
+    }
+
+    memcpy(data, buf, 256);
+
+    return machine_bus_lib_write_sector(realimage->unit, dadr->track,
+                                        dadr->sector, data);
 }
 
 /*-----------------------------------------------------------------------*/
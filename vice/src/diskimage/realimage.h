@@ -32,9 +32,15 @@
 struct disk_image_s;
 struct disk_addr_s;
 
+#define REALIMAGE_TRACK_CACHE_SECTORS 64
+
 typedef struct realimage_s {
     unsigned int unit;
     unsigned int drivetype;
+    /* Last track read from the drive, 0 when the cache is empty.  */
+    unsigned int cache_track;
+    unsigned int cache_sectors;
+    uint8_t cache[REALIMAGE_TRACK_CACHE_SECTORS * 256];
 } realimage_t;
 
 
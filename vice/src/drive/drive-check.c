@@ -28,6 +28,7 @@
 
 #include "drive-check.h"
 #include "drive.h"
+#include "driverom.h"
 #include "drivetypes.h"
 #include "iecdrive.h"
 #include "machine.h"
@@ -179,6 +180,7 @@ int drive_check_type(unsigned int drive_type, unsigned int dnr)
         return 0;
     }
 
+    driverom_load_pending(drive_type);
     if (machine_drive_rom_check_loaded(drive_type) < 0) {
         return 0;
     }
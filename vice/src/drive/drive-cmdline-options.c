@@ -34,6 +34,7 @@
 #include "cmdline.h"
 #include "drive-cmdline-options.h"
 #include "drive.h"
+#include "drivethread.h"
 #include "lib.h"
 #include "machine.h"
 #include "machine-drive.h"
@@ -214,6 +215,11 @@ int drive_cmdline_options_init(void)
     if (cmdline_register_options(cmdline_options) < 0) {
         return -1;
     }
+#ifdef USE_DRIVE_THREADS
+    if (drive_thread_cmdline_options_init() < 0) {
+        return -1;
+    }
+#endif
 
     return machine_drive_cmdline_options_init();
 }
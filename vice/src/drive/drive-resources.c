@@ -37,6 +37,7 @@
 #include "drivecpu.h"
 #include "drivecpu65c02.h"
 #include "driverom.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "ds1216e.h"
 #include "iecbus.h"
@@ -474,6 +475,11 @@ int drive_resources_init(void)
     if (resources_register_int(resources_int) < 0) {
         return -1;
     }
+#ifdef USE_DRIVE_THREADS
+    if (drive_thread_resources_init() < 0) {
+        return -1;
+    }
+#endif
     /* make sure machine_drive_resources_init() is called last here, as that
        will also initialize the default drive type and if it fails to do that
        because other drive related resources are not initialized yet then we
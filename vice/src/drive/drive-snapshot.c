@@ -31,9 +31,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "archdep.h"
 #include "attach.h"
+#include "crc32.h"
 #include "diskconstants.h"
 #include "diskimage.h"
 #include "drive-snapshot.h"
@@ -76,6 +78,8 @@ static int drive_snapshot_write_p64image_module(snapshot_t *s,
 static int drive_snapshot_read_image_module(snapshot_t *s, unsigned int dnr);
 static int drive_snapshot_read_gcrimage_module(snapshot_t *s, unsigned int dnr);
 static int drive_snapshot_read_p64image_module(snapshot_t *s, unsigned int dnr);
+static int drive_snapshot_write_gcrref_module(snapshot_t *s, unsigned int dnr);
+static int drive_snapshot_read_gcrref_module(snapshot_t *s, unsigned int dnr);
 
 /*
 This is the format of the DRIVE snapshot module.
@@ -267,7 +271,13 @@ int drive_snapshot_write_module(snapshot_t *s, int save_disks, int save_roms)
                 for (dnr = 0; dnr < has_drives[unr]; dnr++) {
                     drive = diskunit_context[unr]->drives[dnr];
                     DBG(("drive image unit %i drive %i\n", unr + 8, dnr));
-                    if (drive->GCR_image_loaded > 0) {
+                    if (save_disks == SNAPSHOT_DISKS_REFERENCE) {
+                        /* other images are left out, like without save_disks */
+                        DBG(("gcr image reference unit %i drive %i\n", unr + 8, dnr));
+                        if (drive_snapshot_write_gcrref_module(s, unr) < 0) {
+                            return -1;
+                        }
+                    } else if (drive->GCR_image_loaded > 0) {
                         DBG(("gcr image unit %i drive %i\n", unr + 8, dnr));
                         if (drive_snapshot_write_gcrimage_module(s, unr) < 0) {
                             return -1;
@@ -516,6 +526,7 @@ int drive_snapshot_read_module(snapshot_t *s)
                 DBG(("drive image unit %i drive %i\n", unr + 8, dnr));
                 if (drive_snapshot_read_image_module(s, unr) < 0
                     || drive_snapshot_read_gcrimage_module(s, unr) < 0
+                    || drive_snapshot_read_gcrref_module(s, unr) < 0
                     || drive_snapshot_read_p64image_module(s, unr) < 0) {
                     return -1;
                 }
@@ -932,6 +943,7 @@ static int drive_snapshot_read_gcrimage_module(snapshot_t *s, unsigned int dnr)
     }
     snapshot_module_close(m);
 
+    drive_gcr_base_reset(drive);
     drive->GCR_image_loaded = 1;
     drive->complicated_image_loaded = 1; /* TODO: verify if it's really like this */
     drive->image = NULL;
@@ -939,6 +951,206 @@ static int drive_snapshot_read_gcrimage_module(snapshot_t *s, unsigned int dnr)
     return 0;
 }
 
+/* -------------------------------------------------------------------- */
+/* read/write GCR disk image reference snapshot module */
+
+/*
+ * Instead of the whole GCR image, this module names the attached image file
+ * and holds only the half tracks written since it was attached:
+ *
+ * STRING Filename      name of the attached image file
+ * DWORD  CRC           CRC32 of the image file when it was attached
+ * DWORD  HalfTracks    number of half tracks
+ * for every half track:
+ * DWORD  Size          size of the half track, 0 if unchanged since attach
+ * BYTE   Data[Size]    half track data
+ *
+ * The unchanged half tracks are taken from the tracks kept in the drive when
+ * they were first written, or from the image file itself, when its CRC still
+ * matches.  Only meant for snapshots restored in the same session, like the
+ * rewind buffer, event keyframes and netplay rollback states.
+ */
+
+#define GCRREF_SNAP_MAJOR 1
+#define GCRREF_SNAP_MINOR 0
+
+static const char *drive_snapshot_gcrref_name(drive_t *drive)
+{
+    if (drive->GCR_image_loaded == 0 || drive->image == NULL
+        || drive->image->device != DISK_IMAGE_DEVICE_FS) {
+        return NULL;
+    }
+    return disk_image_fsimage_name_get(drive->image);
+}
+
+static int drive_snapshot_write_gcrref_module(snapshot_t *s, unsigned int dnr)
+{
+    char snap_module_name[10];
+    snapshot_module_t *m;
+    disk_track_t *track;
+    const char *filename;
+    unsigned int i;
+    drive_t *drive;
+    uint32_t num_half_tracks, track_size;
+
+    drive = diskunit_context[dnr]->drives[0];
+
+    filename = drive_snapshot_gcrref_name(drive);
+    if (filename == NULL) {
+        return 0;
+    }
+
+    sprintf(snap_module_name, "GCRREF%u", dnr);
+
+    m = snapshot_module_create(s, snap_module_name, GCRREF_SNAP_MAJOR,
+                               GCRREF_SNAP_MINOR);
+    if (m == NULL) {
+        return -1;
+    }
+
+    num_half_tracks = MAX_GCR_TRACKS;
+
+    if (0
+        || SMW_STR(m, filename) < 0
+        || SMW_DW(m, drive->GCR_base_crc) < 0
+        || SMW_DW(m, num_half_tracks) < 0) {
+        snapshot_module_close(m);
+        return -1;
+    }
+
+    for (i = 0; i < num_half_tracks; i++) {
+        track = &drive->gcr->tracks[i];
+        track_size = (drive->gcr_base->tracks[i].data && track->data) ? track->size : 0;
+        if (0
+            || SMW_DW(m, track_size) < 0
+            || (track_size && SMW_BA(m, track->data, track_size) < 0)
+            ) {
+            break;
+        }
+    }
+
+    if (snapshot_module_close(m) < 0 || (i != num_half_tracks)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int drive_snapshot_read_gcrref_module(snapshot_t *s, unsigned int dnr)
+{
+    uint8_t major_version, minor_version;
+    snapshot_module_t *m;
+    char snap_module_name[10];
+    disk_track_t *track, *base;
+    const char *attached;
+    char *filename = NULL;
+    unsigned int i;
+    drive_t *drive;
+    uint32_t crc, num_half_tracks, track_size;
+    int changed;
+
+    drive = diskunit_context[dnr]->drives[0];
+    sprintf(snap_module_name, "GCRREF%u", dnr);
+
+    m = snapshot_module_open(s, snap_module_name,
+                             &major_version, &minor_version);
+    if (m == NULL) {
+        return 0;
+    }
+
+    /* reject snapshot modules newer than what we can handle (this VICE is too old) */
+    if (snapshot_version_is_bigger(major_version, minor_version, GCRREF_SNAP_MAJOR, GCRREF_SNAP_MINOR)) {
+        snapshot_set_error(SNAPSHOT_MODULE_HIGHER_VERSION);
+        snapshot_module_close(m);
+        return -1;
+    }
+
+    /* reject snapshot modules older than what we can handle (the snapshot is too old) */
+    if (snapshot_version_is_smaller(major_version, minor_version, GCRREF_SNAP_MAJOR, GCRREF_SNAP_MINOR)) {
+        snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
+        snapshot_module_close(m);
+        return -1;
+    }
+
+    if (0
+        || SMR_STR(m, &filename) < 0
+        || SMR_DW(m, &crc) < 0
+        || SMR_DW(m, &num_half_tracks) < 0
+        || num_half_tracks > MAX_GCR_TRACKS) {
+        lib_free(filename);
+        snapshot_module_close(m);
+        return -1;
+    }
+
+    /* attach the image again unless it is still attached; without it the
+       disk is left as it is, as if the snapshot did not include disks */
+    attached = drive_snapshot_gcrref_name(drive);
+    if (attached == NULL || strcmp(attached, filename) != 0
+        || drive->GCR_base_crc != crc) {
+        if (crc32_file(filename) != crc
+            || file_system_attach_disk(dnr + 8, 0, filename) < 0
+            || drive->GCR_base_crc != crc) {
+            log_warning(drive_snapshot_log,
+                        "Disk image `%s' of the snapshot has changed or is missing, disk not restored.",
+                        filename);
+            lib_free(filename);
+            snapshot_module_close(m);
+            return 0;
+        }
+    }
+    lib_free(filename);
+
+    for (i = 0; i < num_half_tracks; i++) {
+        if (SMR_DW(m, &track_size) < 0
+            || track_size > NUM_MAX_MEM_BYTES_TRACK) {
+            snapshot_module_close(m);
+            return -1;
+        }
+
+        track = &drive->gcr->tracks[i];
+        base = &drive->gcr_base->tracks[i];
+        changed = 0;
+
+        if (track_size) {
+            /* written since attach, take the track from the snapshot */
+            drive_gcr_base_keep(drive, i);
+            if (track->data == NULL) {
+                track->data = lib_calloc(1, track_size);
+            } else if (track->size != (int)track_size) {
+                track->data = lib_realloc(track->data, track_size);
+            }
+            track->size = track_size;
+            if (SMR_BA(m, track->data, track_size) < 0) {
+                snapshot_module_close(m);
+                return -1;
+            }
+            changed = 1;
+        } else if (base->data != NULL) {
+            /* written after the snapshot was taken, back to the original */
+            if (track->data == NULL || track->size != base->size
+                || memcmp(track->data, base->data, base->size) != 0) {
+                track->data = lib_realloc(track->data, base->size);
+                track->size = base->size;
+                memcpy(track->data, base->data, base->size);
+                changed = 1;
+            }
+        }
+
+        /* keep the image file in step, like drive_gcr_data_writeback() */
+        if (changed
+            && ((drive->image->type == DISK_IMAGE_TYPE_G64)
+                || (drive->image->type == DISK_IMAGE_TYPE_G71)
+                || (i + 2 <= drive->image->max_half_tracks))) {
+            disk_image_write_half_track(drive->image, i + 2, track);
+        }
+    }
+    snapshot_module_close(m);
+
+    drive_set_half_track(drive->current_half_track, drive->side, drive);
+
+    return 0;
+}
+
 /* -------------------------------------------------------------------- */
 /* read/write P64 disk image snapshot module */
 
@@ -1432,64 +1432,90 @@ static int motorvol[NUM_DISK_UNITS];
 static int cycles_per_sec = 1000000;
 static int sample_rate = 22050;
 
+/* The samples are 44100Hz, these move a unit to the next one, switching
+   to the next fragment at the end of one.  */
+static inline const signed char *drive_sound_next_motor(const signed char *p)
+{
+    p++;
+    if (p == &spinup[sizeof(spinup)] || p == &hum[sizeof(hum)]) {
+        return hum;
+    }
+    if (p == &spindown[sizeof(spindown)] || p == nosound + 1) {
+        return nosound;
+    }
+    return p;
+}
+
+static inline const signed char *drive_sound_next_step(const signed char *p)
+{
+    p++;
+    if (p == &stepping[sizeof(stepping)] || p == &stepping2[sizeof(stepping2)]
+        || p == &bump[sizeof(bump)] || p == nosound + 1) {
+        return nosound;
+    }
+    return p;
+}
+
+/* Whether all units are silent, and the sound chip can be switched off.  */
+static int drive_sound_silent(void)
+{
+    int j;
+
+    for (j = 0; j < NUM_DISK_UNITS; j++) {
+        if (motor[j] != nosound || step[j] != nosound) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * The buffer is mixed one unit at a time, so silent units cost nothing,
+ * and a unit stops as soon as both of its sounds have ended. A unit only
+ * changes sound between two calls, as the drive code calls sound_store()
+ * first, so every unit can run through the whole buffer on its own.
+ */
+
 /* resources */
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int drive_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int scc, CLOCK *delta_t)
 {
-    int i, j, nos = 0;
+    int i, j;
     static int div = 0;
     float m, s;
 
     for (i = 0; i < nr; i++) {
         pbuf[i] = 0.0;
+    }
+
+    for (j = 0; j < NUM_DISK_UNITS; j++) {
+        const signed char *mp = motor[j];
+        const signed char *sp = step[j];
+        int mgain = motorvol[j] * drive_sound_emulation_volume;
+        int sgain = stepvol[j] * drive_sound_emulation_volume;
+        int d = div;
 
-        for (j = 0; j < NUM_DISK_UNITS; j++) {
-            m = ((((*motor[j]) * motorvol[j]) * drive_sound_emulation_volume) >> 8) / 32767.0;
-            s = ((((*step[j]) * stepvol[j]) * drive_sound_emulation_volume) >> 8) / 32767.0;
+        for (i = 0; i < nr && (mp != nosound || sp != nosound); i++) {
+            m = (((*mp) * mgain) >> 8) / 32767.0;
+            s = (((*sp) * sgain) >> 8) / 32767.0;
 
             pbuf[i] += m;
             pbuf[i] += s;
-        }
-        div += 44100;
-        while (div >= sample_rate) {
-            div -= sample_rate;
-            nos = 1;
-            for (j = 0; j < NUM_DISK_UNITS; j++) {
-                motor[j]++;
-                if (motor[j] == &spinup[sizeof(spinup)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &hum[sizeof(hum)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &spindown[sizeof(spindown)]) {
-                    motor[j] = nosound;
-                }
-                if (motor[j] == nosound + 1) {
-                    motor[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-                step[j]++;
-                if (step[j] == &stepping[sizeof(stepping)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &stepping2[sizeof(stepping2)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &bump[sizeof(bump)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == nosound + 1) {
-                    step[j] = nosound;
-                } else {
-                    nos = 0;
-                }
+
+            d += 44100;
+            while (d >= sample_rate) {
+                d -= sample_rate;
+                mp = drive_sound_next_motor(mp);
+                sp = drive_sound_next_step(sp);
             }
         }
+        motor[j] = mp;
+        step[j] = sp;
     }
-    if (nos) {
+    div = (int)((div + (int64_t)nr * 44100) % sample_rate);
+
+    if (drive_sound_silent()) {
         drive_sound.chip_enabled = 0;
     }
     return nr;
@@ -1497,67 +1523,50 @@ static int drive_sound_machine_calculate_samples(sound_t **psid, float *pbuf, in
 #else
 static int drive_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
-    int i, j, nos = 0;
+    int i, j;
     static int div = 0;
     int m, s;
 
-    for (i = 0; i < nr; i++) {
-        for (j = 0; j < NUM_DISK_UNITS; j++) {
-            m = (((*motor[j]) * motorvol[j]) * drive_sound_emulation_volume) >> 8;
-            s = (((*step[j]) * stepvol[j]) * drive_sound_emulation_volume) >> 8;
-            switch (soc) {
-                default:
-                case SOUND_OUTPUT_MONO:
-                    pbuf[i] = sound_audio_mix(pbuf[i], m);
-                    pbuf[i] = sound_audio_mix(pbuf[i], s);
-                    break;
-                case SOUND_OUTPUT_STEREO:
-                    pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], m);
-                    pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], s);
-                    pbuf[i * 2 + 1] = sound_audio_mix(pbuf[i * 2 + 1], m);
-                    pbuf[i * 2 + 1] = sound_audio_mix(pbuf[i * 2 + 1], s);
-                    break;
-            }
-        }
-        div += 44100;
-        while (div >= sample_rate) {
-            div -= sample_rate;
-            nos = 1;
-            for (j = 0; j < NUM_DISK_UNITS; j++) {
-                motor[j]++;
-                if (motor[j] == &spinup[sizeof(spinup)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &hum[sizeof(hum)]) {
-                    motor[j] = hum;
-                }
-                if (motor[j] == &spindown[sizeof(spindown)]) {
-                    motor[j] = nosound;
-                }
-                if (motor[j] == nosound + 1) {
-                    motor[j] = nosound;
-                } else {
-                    nos = 0;
-                }
-                step[j]++;
-                if (step[j] == &stepping[sizeof(stepping)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &stepping2[sizeof(stepping2)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == &bump[sizeof(bump)]) {
-                    step[j] = nosound;
-                }
-                if (step[j] == nosound + 1) {
-                    step[j] = nosound;
-                } else {
-                    nos = 0;
+    for (j = 0; j < NUM_DISK_UNITS; j++) {
+        const signed char *mp = motor[j];
+        const signed char *sp = step[j];
+        int mgain = motorvol[j] * drive_sound_emulation_volume;
+        int sgain = stepvol[j] * drive_sound_emulation_volume;
+        int d = div;
+
+        for (i = 0; i < nr && (mp != nosound || sp != nosound); i++) {
+            m = ((*mp) * mgain) >> 8;
+            s = ((*sp) * sgain) >> 8;
+            /* mixing in 0 changes nothing */
+            if (m | s) {
+                switch (soc) {
+                    default:
+                    case SOUND_OUTPUT_MONO:
+                        pbuf[i] = sound_audio_mix(pbuf[i], m);
+                        pbuf[i] = sound_audio_mix(pbuf[i], s);
+                        break;
+                    case SOUND_OUTPUT_STEREO:
+                        pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], m);
+                        pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], s);
+                        pbuf[i * 2 + 1] = sound_audio_mix(pbuf[i * 2 + 1], m);
+                        pbuf[i * 2 + 1] = sound_audio_mix(pbuf[i * 2 + 1], s);
+                        break;
                 }
             }
+
+            d += 44100;
+            while (d >= sample_rate) {
+                d -= sample_rate;
+                mp = drive_sound_next_motor(mp);
+                sp = drive_sound_next_step(sp);
+            }
         }
+        motor[j] = mp;
+        step[j] = sp;
     }
-    if (nos) {
+    div = (int)((div + (int64_t)nr * 44100) % sample_rate);
+
+    if (drive_sound_silent()) {
         drive_sound.chip_enabled = 0;
     }
     return nr;
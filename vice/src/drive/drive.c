@@ -48,6 +48,7 @@
 
 #include "attach.h"
 #include "archdep.h"
+#include "autowarp.h"
 #include "diskconstants.h"
 #include "diskimage.h"
 #include "drive-check.h"
@@ -56,9 +57,11 @@
 #include "drivecpu65c02.h"
 #include "driveimage.h"
 #include "drivesync.h"
+#include "drivethread.h"
 #include "driverom.h"
 #include "drivetypes.h"
 #include "gcr.h"
+#include "hosttime.h"
 #include "iecbus.h"
 #include "iecdrive.h"
 #include "lib.h"
@@ -66,9 +69,11 @@
 #include "machine-drive.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "memusage.h"
 #include "resources.h"
 #include "rotation.h"
 #include "sound.h"
+#include "tracezone.h"
 #include "types.h"
 #include "uiapi.h"
 #include "ds1216e.h"
@@ -159,6 +164,56 @@ void drive_set_last_read(unsigned int track, unsigned int sector, uint8_t *buffe
 
 /* Initialize the hardware-level drive emulation (should be called at least
    once before anything else).  Return 0 on success, -1 on error.  */
+/* Whether the motor of a drive with true drive emulation is on.  */
+static int drive_motor_on(void)
+{
+    unsigned int unit, d;
+
+    for (unit = 0; unit < NUM_DISK_UNITS; unit++) {
+        diskunit_context_t *diskunit = diskunit_context[unit];
+
+        if (diskunit == NULL || !diskunit->enable) {
+            continue;
+        }
+        for (d = 0; d < NUM_DRIVES; d++) {
+            if (diskunit->drives[d] != NULL
+                && (diskunit->drives[d]->byte_ready_active & BRA_MOTOR_ON)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* The disk unit contexts and the GCR tracks of the attached images, for the
+   memory report.  */
+static size_t drive_usage(void)
+{
+    size_t bytes = 0;
+    unsigned int unit, d, i;
+
+    for (unit = 0; unit < NUM_DISK_UNITS; unit++) {
+        diskunit_context_t *diskunit = diskunit_context[unit];
+
+        bytes += sizeof(diskunit_context_t);
+        for (d = 0; d < NUM_DRIVES; d++) {
+            drive_t *drive = diskunit->drives[d];
+
+            bytes += sizeof(drive_t);
+            if (drive->gcr == NULL) {
+                continue;
+            }
+            bytes += sizeof(gcr_t);
+            for (i = 0; i < MAX_GCR_TRACKS; i++) {
+                if (drive->gcr->tracks[i].data != NULL) {
+                    bytes += drive->gcr->tracks[i].size;
+                }
+            }
+        }
+    }
+    return bytes;
+}
+
 int drive_init(void)
 {
     unsigned int unit;
@@ -174,6 +229,7 @@ int drive_init(void)
     drive_image_init();
 
     drive_log = log_open("Drive");
+    memusage_register("drives", drive_usage);
 
     for (unit = 0; unit < NUM_DISK_UNITS; unit++) {
         diskunit_context_t *diskunit =  diskunit_context[unit];
@@ -195,6 +251,8 @@ int drive_init(void)
 
     }
 
+    autowarp_set_disk_detector(drive_motor_on);
+
     driverom_load_images();
     /* Do not error out if _SOME_ images are not found, ie. FD2K/4K, CMDHD */
 #if 0
@@ -231,6 +289,7 @@ int drive_init(void)
             drive = diskunit->drives[d];
 
             drive->gcr = gcr_create_image();
+            drive->gcr_base = gcr_create_image();
             drive->p64 = lib_calloc(1, sizeof(TP64Image));
             P64ImageCreate(drive->p64);
             drive->byte_ready_level = 1;
@@ -301,6 +360,10 @@ void drive_shutdown(void)
         return;
     }
 
+#ifdef USE_DRIVE_THREADS
+    drive_thread_shutdown();
+#endif
+
     for (unr = 0; unr < NUM_DISK_UNITS; unr++) {
         diskunit_context_t *unit = diskunit_context[unr];
 
@@ -322,6 +385,11 @@ void drive_shutdown(void)
             if (drive->gcr) {
                 gcr_destroy_image(drive->gcr);
             }
+            if (drive->gcr_base) {
+                drive_gcr_base_reset(drive);
+                gcr_destroy_image(drive->gcr_base);
+                drive->gcr_base = NULL;
+            }
             if (drive->p64) {
                 P64ImageDestroy(drive->p64);
                 lib_free(drive->p64);
@@ -406,6 +474,7 @@ int drive_set_disk_drive_type(unsigned int type, struct diskunit_context_s *drv)
 
     dnr = drv->mynumber;
 
+    driverom_load_pending(type);
     if (machine_drive_rom_check_loaded(type) < 0) {
         return -1;
     }
@@ -866,6 +935,51 @@ void drive_gcr_data_writeback_all(void)
     }
 }
 
+/* Keep a copy of GCR track `half_track' (counted from 0) as it was when the
+   image was attached; call before it is changed.  */
+void drive_gcr_base_keep(drive_t *drive, unsigned int half_track)
+{
+    disk_track_t *track, *base;
+
+    track = &drive->gcr->tracks[half_track];
+    base = &drive->gcr_base->tracks[half_track];
+
+    if (base->data != NULL || track->data == NULL) {
+        return;
+    }
+
+    base->data = lib_malloc(track->size);
+    base->size = track->size;
+    memcpy(base->data, track->data, track->size);
+}
+
+/* Same for the track under the head, on the first write after the track was
+   written back.  */
+void drive_gcr_base_keep_current(drive_t *drive)
+{
+    int tmp;
+
+    /* FIXME: why would the offset be different for D71 and G71? */
+    tmp = (drive->image && drive->image->type == DISK_IMAGE_TYPE_G71) ? DRIVE_HALFTRACKS_1571 : 70;
+
+    drive_gcr_base_keep(drive, drive->current_half_track - 2 + (drive->side * tmp));
+}
+
+/* Forget the kept tracks, the attached image changed.  */
+void drive_gcr_base_reset(drive_t *drive)
+{
+    unsigned int i;
+
+    for (i = 0; i < MAX_GCR_TRACKS; i++) {
+        if (drive->gcr_base->tracks[i].data) {
+            lib_free(drive->gcr_base->tracks[i].data);
+            drive->gcr_base->tracks[i].data = NULL;
+            drive->gcr_base->tracks[i].size = 0;
+        }
+    }
+    drive->GCR_base_crc = 0;
+}
+
 /* ------------------------------------------------------------------------- */
 
 static void drive_led_update(diskunit_context_t *unit, drive_t *drive, int base)
@@ -992,6 +1106,17 @@ void drive_cpu_execute_one(diskunit_context_t *drv, CLOCK clk_value)
 void drive_cpu_execute_all(CLOCK clk_value)
 {
     unsigned int dnr;
+    int hosttime_previous = HOSTTIME_ENTER(HOSTTIME_DRIVE);
+
+    TRACEZONE_BEGIN(TRACEZONE_DRIVE);
+
+#ifdef USE_DRIVE_THREADS
+    if (drive_thread_execute_all(clk_value) == 0) {
+        TRACEZONE_END(TRACEZONE_DRIVE);
+        HOSTTIME_LEAVE(hosttime_previous);
+        return;
+    }
+#endif
 
     for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
         diskunit_context_t *unit = diskunit_context[dnr];
@@ -1000,6 +1125,44 @@ void drive_cpu_execute_all(CLOCK clk_value)
             drive_cpu_execute_one(unit, clk_value);
         }
     }
+
+    TRACEZONE_END(TRACEZONE_DRIVE);
+    HOSTTIME_LEAVE(hosttime_previous);
+}
+
+/* Catch the drives up for a read of the serial bus by the machine at
+   `clk_value'.  If none of them can change its bus outputs before then (see
+   drivecpu_quiet_clk()), the bus already has the value the read would see,
+   and the drives stay behind until the next write to the bus or vsync.
+   This saves running the drives on every poll of the bus while they wait
+   in a loop of their own.  */
+void drive_cpu_execute_all_read(CLOCK clk_value)
+{
+    unsigned int dnr;
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (unit->enable
+            && (unit->type == DRIVE_TYPE_2000 || unit->type == DRIVE_TYPE_4000
+                || unit->type == DRIVE_TYPE_CMDHD
+                || clk_value > drivecpu_quiet_clk(unit))) {
+            drive_cpu_execute_all(clk_value);
+            return;
+        }
+    }
+}
+
+/* Catch one drive up for a read of its parallel cable (or the handshake
+   flag of the cable) by the machine at `clk_value', unless it cannot change
+   the cable before then, see drive_cpu_execute_all_read().  */
+void drive_cpu_execute_one_read(diskunit_context_t *drv, CLOCK clk_value)
+{
+    if (drv->type == DRIVE_TYPE_2000 || drv->type == DRIVE_TYPE_4000
+        || drv->type == DRIVE_TYPE_CMDHD
+        || clk_value > drivecpu_quiet_clk(drv)) {
+        drive_cpu_execute_one(drv, clk_value);
+    }
 }
 
 void drive_cpu_set_overflow(diskunit_context_t *drv)
@@ -262,6 +262,13 @@ typedef struct drive_s {
     /* Flag: does the current track need to be written out to disk?  */
     int GCR_dirty_track;
 
+    /* Tracks as they were when the image was attached, copied before the
+       first write to each of them.  */
+    struct gcr_s *gcr_base;
+
+    /* CRC32 of the image file when it was attached.  */
+    uint32_t GCR_base_crc;
+
     /* GCR value being written to the disk.  */
     uint8_t GCR_write_value;
 
@@ -394,6 +401,8 @@ void drive_reset(void);
 void drive_shutdown(void);
 void drive_cpu_execute_one(struct diskunit_context_s *drv, CLOCK clk_value);
 void drive_cpu_execute_all(CLOCK clk_value);
+void drive_cpu_execute_all_read(CLOCK clk_value);
+void drive_cpu_execute_one_read(struct diskunit_context_s *drv, CLOCK clk_value);
 void drive_cpu_set_overflow(struct diskunit_context_s *drv);
 void drive_vsync_hook(void);
 int drive_get_disk_drive_type(int dnr);
@@ -401,6 +410,9 @@ void drive_enable_update_ui(struct diskunit_context_s *drv);
 void drive_update_ui_status(void);
 void drive_gcr_data_writeback(struct drive_s *drive);
 void drive_gcr_data_writeback_all(void);
+void drive_gcr_base_keep(struct drive_s *drive, unsigned int half_track);
+void drive_gcr_base_keep_current(struct drive_s *drive);
+void drive_gcr_base_reset(struct drive_s *drive);
 void drive_set_active_led_color(unsigned int type, unsigned int dnr);
 int drive_set_disk_drive_type(unsigned int drive_type,
                               struct diskunit_context_s *drv);
@@ -124,6 +124,7 @@ void drivecpu_setup_context(struct diskunit_context_s *drv, int i)
     if (i) {
         drv->cpu->alarm_context = alarm_context_new(drv->cpu->identification_string);
     }
+    drv->cpu->alarm_context->event_clk = &cpu->int_status->next_event_clk;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -132,15 +133,15 @@ void drivecpu_setup_context(struct diskunit_context_s *drv, int i)
 #define LOAD_ZERO(a)      (*drv->cpud->read_func_ptr[0])(drv, (uint16_t)(a))
 #define LOAD_ADDR(a)      (LOAD((a)) | (LOAD((a) + 1) << 8))
 #define LOAD_ZERO_ADDR(a) (LOAD_ZERO((a)) | (LOAD_ZERO((a) + 1) << 8))
-#define STORE(a, b)       (*drv->cpud->store_func_ptr[(a) >> 8])(drv, (uint16_t)(a), (uint8_t)(b))
-#define STORE_ZERO(a, b)  (*drv->cpud->store_func_ptr[0])(drv, (uint16_t)(a), (uint8_t)(b))
+#define STORE(a, b)       (cpu->idle_stores++, (*drv->cpud->store_func_ptr[(a) >> 8])(drv, (uint16_t)(a), (uint8_t)(b)))
+#define STORE_ZERO(a, b)  (cpu->idle_stores++, (*drv->cpud->store_func_ptr[0])(drv, (uint16_t)(a), (uint8_t)(b)))
 
 #define LOAD_DUMMY(a)           (*drv->cpud->read_func_ptr_dummy[(a) >> 8])(drv, (uint16_t)(a))
 #define LOAD_ZERO_DUMMY(a)      (*drv->cpud->read_func_ptr_dummy[0])(drv, (uint16_t)(a))
 #define LOAD_ADDR_DUMMY(a)      (LOAD_DUMMY((a)) | (LOAD_DUMMY((a) + 1) << 8))
 #define LOAD_ZERO_ADDR_DUMMY(a) (LOAD_ZERO_DUMMY((a)) | (LOAD_ZERO_DUMMY((a) + 1) << 8))
-#define STORE_DUMMY(a, b)       (*drv->cpud->store_func_ptr_dummy[(a) >> 8])(drv, (uint16_t)(a), (uint8_t)(b))
-#define STORE_ZERO_DUMMY(a, b)  (*drv->cpud->store_func_ptr_dummy[0])(drv, (uint16_t)(a), (uint8_t)(b))
+#define STORE_DUMMY(a, b)       (cpu->idle_stores++, (*drv->cpud->store_func_ptr_dummy[(a) >> 8])(drv, (uint16_t)(a), (uint8_t)(b)))
+#define STORE_ZERO_DUMMY(a, b)  (cpu->idle_stores++, (*drv->cpud->store_func_ptr_dummy[0])(drv, (uint16_t)(a), (uint8_t)(b)))
 
 #define JUMP(addr)                                                         \
     do {                                                                   \
@@ -208,6 +209,9 @@ void drivecpu_reset(diskunit_context_t *drv)
 
     /* FIXME -- ugly, should be changed in interrupt.h */
     interrupt_trigger_reset(drv->cpu->int_status, *(drv->clk_ptr));
+
+    drv->cpu->idle.period = 0;
+    drv->cpu->idle.clk = 0;
 }
 
 /* called by drive_cpu_trigger_reset() */
@@ -289,6 +293,120 @@ inline static uint32_t drive_trap_handler(diskunit_context_t *drv)
     return (uint32_t)-1;
 }
 
+/* Conditions for skipping idle loops of the drive.  */
+static int drivecpu_idle_allowed(diskunit_context_t *drv)
+{
+    return drv->idling_method == DRIVE_IDLE_TRAP_IDLE
+           && (drv->type == DRIVE_TYPE_1540
+               || drv->type == DRIVE_TYPE_1541
+               || drv->type == DRIVE_TYPE_1541II)
+           && !(drv->drives[0]->byte_ready_active & BRA_MOTOR_ON)
+           && drv->parallel_cable != DRIVE_PC_DD3
+           && !drv->profdos && !drv->supercard && !drv->stardos
+           && drv->cpu->int_status->global_pending_int == IK_NONE;
+}
+
+/* Generic idle loop detection, used with DRIVE_IDLE_TRAP_IDLE in addition to
+   the trap on the DOS idle loop.  Called after every read of the IEC bus
+   port of 1540/1541 drives, and with a parallel cable on VIA1 also after
+   the reads of the cable and its handshake flag that don't signal the
+   computer (see via1d1541_read()).
+
+   If the CPU is at the same place with the same registers and reads the
+   same value as last time, and did no store and no other I/O read since,
+   then the code between the two reads depends on nothing that can change
+   before the next alarm fires or the computer touches the bus, and the
+   latter can only happen after this drivecpu_execute() call has returned.
+   Once the same loop period has been seen twice, whole iterations up to
+   the next alarm are skipped by advancing the clock.  With the motor off
+   no disk rotation has to be emulated in between.  */
+void drivecpu_idle_check(diskunit_context_t *drv, uint8_t value)
+{
+    drivecpu_context_t *cpu = drv->cpu;
+    drivecpu_idle_t *idle = &cpu->idle;
+    mos6510_regs_t *regs = &cpu->cpu_regs;
+    CLOCK clk = *(drv->clk_ptr);
+
+    if (!drivecpu_idle_allowed(drv)) {
+        idle->period = 0;
+        return;
+    }
+
+    if (clk > idle->clk
+        && value == idle->value
+        && cpu->idle_stores == idle->stores
+        && cpu->idle_io_reads == idle->io_reads + 1
+        && regs->pc == idle->regs.pc
+        && regs->a == idle->regs.a
+        && regs->x == idle->regs.x
+        && regs->y == idle->regs.y
+        && regs->sp == idle->regs.sp
+        && regs->p == idle->regs.p
+        && regs->n == idle->regs.n
+        && regs->z == idle->regs.z) {
+        CLOCK period = clk - idle->clk;
+
+        if (period == idle->period) {
+            CLOCK next_clk;
+
+            next_clk = alarm_context_next_pending_clk(cpu->alarm_context);
+            if (next_clk > cpu->stop_clk) {
+                next_clk = cpu->stop_clk;
+            }
+
+            /* Stay one iteration before the alarm, so it is dispatched
+               at the exact cycle.  */
+            if (next_clk > clk + 2 * period) {
+                clk += ((next_clk - clk) / period - 1) * period;
+                *(drv->clk_ptr) = clk;
+            }
+        }
+        idle->period = period;
+    } else {
+        idle->period = 0;
+    }
+
+    idle->clk = clk;
+    idle->value = value;
+    idle->regs = *regs;
+    idle->stores = cpu->idle_stores;
+    idle->io_reads = cpu->idle_io_reads;
+}
+
+/* Return the machine clock up to which the drive cannot change its outputs
+   to the bus, or the clock it has been run to if that is not known.
+
+   This holds while the drive sits in an idle loop that has been confirmed by
+   drivecpu_idle_check() and has not done anything else since: the loop then
+   repeats until the next alarm fires, and with the motor off no byte ready
+   is pending either.  A write of the computer to the bus catches the drive
+   up first, so it cannot break the loop behind our back.  */
+CLOCK drivecpu_quiet_clk(diskunit_context_t *drv)
+{
+    drivecpu_context_t *cpu = drv->cpu;
+    drivecpu_idle_t *idle = &cpu->idle;
+    CLOCK next_clk;
+    uint64_t ahead;
+
+    if (idle->period == 0
+        || !drivecpu_idle_allowed(drv)
+        || cpu->idle_stores != idle->stores
+        || cpu->idle_io_reads != idle->io_reads
+        || drv->cpud->sync_factor == 0) {
+        return cpu->last_clk;
+    }
+
+    next_clk = alarm_context_next_pending_clk(cpu->alarm_context);
+    if (next_clk <= cpu->stop_clk) {
+        return cpu->last_clk;
+    }
+
+    /* Machine cycles until the drive clock would reach the alarm, see the
+       conversion in drivecpu_execute().  */
+    ahead = ((uint64_t)(next_clk - cpu->stop_clk) << 16) - cpu->cycle_accum;
+    return cpu->last_clk + (CLOCK)((ahead - 1) / (uint64_t)drv->cpud->sync_factor);
+}
+
 static void drive_generic_dma(void)
 {
     /* Generic DMA hosts can be implemented here.
@@ -404,6 +522,8 @@ void drivecpu_execute(diskunit_context_t *drv, CLOCK clk_value)
 
 #define ALARM_CONTEXT (cpu->alarm_context)
 
+#define CPU_EVENT_CLK
+
 #define JAM() drivecpu_jam(drv)
 
 #define ROM_TRAP_ALLOWED() 1
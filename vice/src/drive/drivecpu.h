@@ -54,6 +54,8 @@ void drivecpu_trigger_reset(unsigned int dnr);
 void drivecpu_set_overflow(struct diskunit_context_s *drv);
 
 void drivecpu_execute(struct diskunit_context_s *drv, CLOCK clk_value);
+void drivecpu_idle_check(struct diskunit_context_s *drv, uint8_t value);
+CLOCK drivecpu_quiet_clk(struct diskunit_context_s *drv);
 int drivecpu_snapshot_write_module(struct diskunit_context_s *drv,
                                    struct snapshot_s *s);
 int drivecpu_snapshot_read_module(struct diskunit_context_s *drv,
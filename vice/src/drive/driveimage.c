@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "crc32.h"
 #include "diskconstants.h"
 #include "diskimage.h"
 #include "drive.h"
@@ -213,11 +214,16 @@ int drive_image_attach(disk_image_t *image, unsigned int unit, unsigned int drv)
         drive->image = NULL;
         return -1;
     }
+    drive_gcr_base_reset(drive);
     if (drive->image->type == DISK_IMAGE_TYPE_P64) {
         drive->P64_image_loaded = 1;
         drive->P64_dirty = 0;
     } else {
         drive->GCR_image_loaded = 1;
+        /* lets reference-only snapshots find this image again */
+        if (drive->image->device == DISK_IMAGE_DEVICE_FS) {
+            drive->GCR_base_crc = crc32_file(disk_image_fsimage_name_get(drive->image));
+        }
     }
     drive->complicated_image_loaded = ((drive->image->type == DISK_IMAGE_TYPE_P64)
                                        || (drive->image->type == DISK_IMAGE_TYPE_G64)
@@ -275,6 +281,7 @@ int drive_image_detach(disk_image_t *image, unsigned int unit, unsigned int drv)
             drive->gcr->tracks[i].size = 0;
         }
     }
+    drive_gcr_base_reset(drive);
     drive->detach_clk = diskunit_clk[dnr];
     drive->GCR_image_loaded = 0;
     drive->P64_image_loaded = 0;
@@ -73,6 +73,58 @@ static log_t driverom_log;
 /* If nonzero, we are far enough in init that we can load ROMs.  */
 static int drive_rom_load_ok = 0;
 
+/* The ROM of a drive type that no unit uses is not loaded right away, the
+   arguments of driverom_load() are kept here instead and the ROM is loaded
+   by driverom_load_pending() once the type is checked or selected.  This
+   keeps the startup from reading the ROMs of all drive types.  */
+typedef struct driverom_pending_s {
+    unsigned int type;
+    const char *resource_name;
+    uint8_t *drive_rom;
+    unsigned int *loaded;
+    int min;
+    int max;
+    const char *name;
+    unsigned int *size;
+} driverom_pending_t;
+
+#define DRIVEROM_PENDING_MAX    32
+
+static driverom_pending_t driverom_pending[DRIVEROM_PENDING_MAX];
+static int driverom_num_pending = 0;
+
+/* Set while driverom_load_pending() loads a deferred ROM.  */
+static int driverom_loading_pending = 0;
+
+static driverom_pending_t *driverom_find_pending(unsigned int type)
+{
+    int i;
+
+    for (i = 0; i < driverom_num_pending; i++) {
+        if (driverom_pending[i].type == type) {
+            return &driverom_pending[i];
+        }
+    }
+    return NULL;
+}
+
+static void driverom_remove_pending(driverom_pending_t *p)
+{
+    *p = driverom_pending[--driverom_num_pending];
+}
+
+static int driverom_type_in_use(unsigned int type)
+{
+    unsigned int dnr;
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        if (diskunit_context[dnr]->type == type) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 
 int driverom_load(const char *resource_name, uint8_t *drive_rom, unsigned
                   int *loaded, int min, int max, const char *name,
@@ -81,6 +133,7 @@ int driverom_load(const char *resource_name, uint8_t *drive_rom, unsigned
     const char *rom_name = NULL;
     int filesize;
     unsigned int dnr;
+    driverom_pending_t *p;
 
     DBG(("driverom_load res:%s loaded:%u min:%d max:%d name:%s type:%u size:%u\n",
        resource_name, *loaded, min, max, name, type, size ? *size : 0));
@@ -89,6 +142,27 @@ int driverom_load(const char *resource_name, uint8_t *drive_rom, unsigned
         return 0;
     }
 
+    p = driverom_find_pending(type);
+    if (!driverom_loading_pending && !driverom_type_in_use(type)) {
+        if (p == NULL && driverom_num_pending < DRIVEROM_PENDING_MAX) {
+            p = &driverom_pending[driverom_num_pending++];
+        }
+        if (p != NULL) {
+            DBG(("driverom_load deferring %s\n", name));
+            p->type = type;
+            p->resource_name = resource_name;
+            p->drive_rom = drive_rom;
+            p->loaded = loaded;
+            p->min = min;
+            p->max = max;
+            p->name = name;
+            p->size = size;
+            return 0;
+        }
+    } else if (p != NULL) {
+        driverom_remove_pending(p);
+    }
+
     resources_get_string(resource_name, &rom_name);
 
     DBG(("driverom_load rom_name: %s\n", rom_name));
@@ -140,6 +214,25 @@ int driverom_load(const char *resource_name, uint8_t *drive_rom, unsigned
     return 0;
 }
 
+/* Load the ROM of the given drive type if its loading was deferred.  */
+void driverom_load_pending(unsigned int type)
+{
+    driverom_pending_t *p = driverom_find_pending(type);
+    driverom_pending_t args;
+
+    if (p == NULL) {
+        return;
+    }
+    args = *p;
+    driverom_remove_pending(p);
+
+    DBG(("driverom_load_pending %s\n", args.name));
+    driverom_loading_pending = 1;
+    driverom_load(args.resource_name, args.drive_rom, args.loaded, args.min,
+                  args.max, args.name, args.type, args.size);
+    driverom_loading_pending = 0;
+}
+
 int driverom_load_images(void)
 {
     drive_rom_load_ok = 1;
@@ -0,0 +1,294 @@
+/*
+ * drivethread.c - Run the drive CPUs on worker threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The drive CPUs already run lazily: they only catch up with the main CPU
+   when the machine touches the bus (drive_cpu_execute_all()) and once per
+   frame.  With `DriveThreads' enabled and at least two IEC drives active,
+   each catch-up is split across threads: the first drive runs on the
+   emulation thread, every other one on its own worker, and the caller
+   waits until all of them reached the target clock.  The machine is
+   therefore never more than one sync point ahead of any drive, exactly as
+   in sequential mode.
+
+   Between two sync points the drives see each other's bus writes in host
+   time order rather than in cycle order, so the result is not repeatable.
+   The mode is off by default and must stay off for event recording and
+   netplay.  Drive accesses to the bus state go through
+   drive_thread_bus_lock().  */
+
+#include "vice.h"
+
+#ifdef USE_DRIVE_THREADS
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "cmdline.h"
+#include "drive.h"
+#include "drivetypes.h"
+#include "drivethread.h"
+#include "interrupt.h"
+#include "log.h"
+#include "monitor.h"
+#include "resources.h"
+#include "tracezone.h"
+#include "types.h"
+
+typedef struct drive_worker_s {
+    pthread_t thread;
+    pthread_cond_t wakeup;
+    diskunit_context_t *unit;
+    CLOCK target_clk;
+    int pending;
+} drive_worker_t;
+
+static drive_worker_t workers[NUM_DISK_UNITS];
+static int workers_started = 0;
+static int workers_quit = 0;
+
+/* Number of workers that have not yet reached their target clock.  */
+static int workers_busy = 0;
+
+/* Protects the worker fields above.  */
+static pthread_mutex_t work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+
+static pthread_mutex_t bus_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Set while drives run in parallel; only changed by the emulation thread
+   while no worker is busy.  */
+static int threads_active = 0;
+
+static int drive_threads_enabled = 0;
+
+static log_t drive_thread_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+static void *drive_worker_main(void *arg)
+{
+    drive_worker_t *worker = arg;
+
+    TRACEZONE_THREAD_NAME("drive");
+
+    pthread_mutex_lock(&work_mutex);
+    for (;;) {
+        while (!worker->pending && !workers_quit) {
+            pthread_cond_wait(&worker->wakeup, &work_mutex);
+        }
+        if (workers_quit) {
+            break;
+        }
+        worker->pending = 0;
+        pthread_mutex_unlock(&work_mutex);
+
+        TRACEZONE_BEGIN(TRACEZONE_DRIVE);
+        drive_cpu_execute_one(worker->unit, worker->target_clk);
+        TRACEZONE_END(TRACEZONE_DRIVE);
+
+        pthread_mutex_lock(&work_mutex);
+        if (--workers_busy == 0) {
+            pthread_cond_signal(&work_done);
+        }
+    }
+    pthread_mutex_unlock(&work_mutex);
+
+    return NULL;
+}
+
+static int drive_workers_start(void)
+{
+    unsigned int dnr;
+
+    workers_quit = 0;
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        drive_worker_t *worker = &workers[dnr];
+
+        worker->pending = 0;
+        pthread_cond_init(&worker->wakeup, NULL);
+        if (pthread_create(&worker->thread, NULL, drive_worker_main, worker) != 0) {
+            log_error(drive_thread_log, "Cannot create drive thread.");
+            pthread_cond_destroy(&worker->wakeup);
+            while (dnr-- > 0) {
+                /* stop the ones already running */
+                pthread_mutex_lock(&work_mutex);
+                workers_quit = 1;
+                pthread_cond_signal(&workers[dnr].wakeup);
+                pthread_mutex_unlock(&work_mutex);
+                pthread_join(workers[dnr].thread, NULL);
+                pthread_cond_destroy(&workers[dnr].wakeup);
+            }
+            return -1;
+        }
+    }
+
+    workers_started = 1;
+    return 0;
+}
+
+static void drive_workers_stop(void)
+{
+    unsigned int dnr;
+
+    if (!workers_started) {
+        return;
+    }
+
+    pthread_mutex_lock(&work_mutex);
+    workers_quit = 1;
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        pthread_cond_signal(&workers[dnr].wakeup);
+    }
+    pthread_mutex_unlock(&work_mutex);
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        pthread_join(workers[dnr].thread, NULL);
+        pthread_cond_destroy(&workers[dnr].wakeup);
+    }
+
+    workers_started = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int drive_thread_execute_all(CLOCK clk_value)
+{
+    diskunit_context_t *units[NUM_DISK_UNITS];
+    unsigned int dnr, num_units = 0;
+
+    if (!drive_threads_enabled || monitor_is_inside_monitor()
+        || monitor_cpuhistory_trace_active()) {
+        return -1;
+    }
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (!unit->enable) {
+            continue;
+        }
+        /* IEEE-488 and TCBM drives talk to the machine through paths that
+           are not locked; drives stopping in the monitor must run on the
+           emulation thread.  */
+        if (!drive_check_iec(unit->type)
+            || (unit->cpu->int_status->global_pending_int & IK_MONITOR)) {
+            return -1;
+        }
+        units[num_units++] = unit;
+    }
+
+    if (num_units < 2) {
+        return -1;
+    }
+
+    if (!workers_started && drive_workers_start() < 0) {
+        drive_threads_enabled = 0;
+        return -1;
+    }
+
+    pthread_mutex_lock(&work_mutex);
+    threads_active = 1;
+    for (dnr = 1; dnr < num_units; dnr++) {
+        drive_worker_t *worker = &workers[units[dnr]->mynumber];
+
+        worker->unit = units[dnr];
+        worker->target_clk = clk_value;
+        worker->pending = 1;
+        workers_busy++;
+        pthread_cond_signal(&worker->wakeup);
+    }
+    pthread_mutex_unlock(&work_mutex);
+
+    drive_cpu_execute_one(units[0], clk_value);
+
+    pthread_mutex_lock(&work_mutex);
+    while (workers_busy > 0) {
+        pthread_cond_wait(&work_done, &work_mutex);
+    }
+    threads_active = 0;
+    pthread_mutex_unlock(&work_mutex);
+
+    return 0;
+}
+
+void drive_thread_bus_lock(void)
+{
+    if (threads_active) {
+        pthread_mutex_lock(&bus_mutex);
+    }
+}
+
+void drive_thread_bus_unlock(void)
+{
+    if (threads_active) {
+        pthread_mutex_unlock(&bus_mutex);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_drive_threads(int val, void *param)
+{
+    drive_threads_enabled = val ? 1 : 0;
+
+    if (!drive_threads_enabled) {
+        drive_workers_stop();
+    }
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "DriveThreads", 0, RES_EVENT_NO, NULL,
+      &drive_threads_enabled, set_drive_threads, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int drive_thread_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-drivethreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveThreads", (void *)1,
+      NULL, "Run true drive emulation of multiple drives on worker threads (not deterministic)" },
+    { "+drivethreads", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "DriveThreads", (void *)0,
+      NULL, "Run all drives on the emulation thread" },
+    CMDLINE_LIST_END
+};
+
+int drive_thread_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+void drive_thread_shutdown(void)
+{
+    drive_workers_stop();
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * drivethread.h - Run the drive CPUs on worker threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_DRIVETHREAD_H
+#define VICE_DRIVETHREAD_H
+
+#include "types.h"
+
+#ifdef USE_DRIVE_THREADS
+
+int drive_thread_resources_init(void);
+int drive_thread_cmdline_options_init(void);
+void drive_thread_shutdown(void);
+
+/* Bring all enabled drives up to `clk_value' in parallel.  Returns -1 if
+   the drives must be run one after another instead.  */
+int drive_thread_execute_all(CLOCK clk_value);
+
+/* Serialize accesses of the drives to the state they share with the
+   machine (IEC bus, parallel cable).  No-ops unless workers are running.  */
+void drive_thread_bus_lock(void);
+void drive_thread_bus_unlock(void);
+
+#define DRIVE_BUS_LOCK()    drive_thread_bus_lock()
+#define DRIVE_BUS_UNLOCK()  drive_thread_bus_unlock()
+
+#else
+
+#define DRIVE_BUS_LOCK()
+#define DRIVE_BUS_UNLOCK()
+
+#endif
+
+#endif
@@ -52,6 +52,24 @@ typedef drive_store_func_t *drive_store_func_ptr_t;
 typedef uint8_t drive_peek_func_t (struct diskunit_context_s *, uint16_t);
 typedef drive_peek_func_t *drive_peek_func_ptr_t;
 
+/*
+ *  State of the generic idle loop detection, see drivecpu_idle_check().
+ */
+
+typedef struct drivecpu_idle_s {
+    /* Clock, value and registers at the last read of the bus port.  */
+    CLOCK clk;
+    uint8_t value;
+    mos6510_regs_t regs;
+
+    /* Values of `idle_stores' and `idle_io_reads' at that time.  */
+    unsigned int stores;
+    unsigned int io_reads;
+
+    /* Cycles between the last two matching reads, 0 if unknown.  */
+    CLOCK period;
+} drivecpu_idle_t;
+
 /*
  *  The private CPU data.
  */
@@ -99,6 +117,11 @@ typedef struct drivecpu_context_s {
 
     uint8_t *pageone;        /* init to NULL */
 
+    /* Number of stores and of I/O chip reads, for the idle loop detection.  */
+    unsigned int idle_stores;
+    unsigned int idle_io_reads;
+    drivecpu_idle_t idle;
+
     int monspace;         /* init to e_disk[89]_space */
 
     char *snap_module_name;
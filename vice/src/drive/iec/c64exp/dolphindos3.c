@@ -41,6 +41,7 @@
 #include "dolphindos3.h"
 #include "drive.h"
 #include "drivemem.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "iecdrive.h"
 #include "log.h"
@@ -54,7 +55,9 @@ static mc6821_state my6821[NUM_DISK_UNITS];
 static void dd3_set_pa(mc6821_state *ctx)
 {
     unsigned int dnr = (unsigned int)(((diskunit_context_t *)(ctx->p))->mynumber);
+    DRIVE_BUS_LOCK();
     parallel_cable_drive_write(DRIVE_PC_DD3, ctx->dataA, PARALLEL_WRITE, dnr);
+    DRIVE_BUS_UNLOCK();
     /* DBG(("DD3 (%d) 6821 PA WR %02x\n", dnr, ctx->dataA)); */
 }
 
@@ -64,6 +67,7 @@ static uint8_t dd3_get_pa(mc6821_state *ctx)
     uint8_t data;
     int hs = 0;
 
+    DRIVE_BUS_LOCK();
     /* output all pins that are in input mode as 1 first */
     parallel_cable_drive_write(DRIVE_PC_DD3, (uint8_t)((~ctx->ddrA) | ctx->dataA), PARALLEL_WRITE, dnr);
 
@@ -74,6 +78,7 @@ static uint8_t dd3_get_pa(mc6821_state *ctx)
     }
 
     data = parallel_cable_drive_read(DRIVE_PC_DD3, hs);
+    DRIVE_BUS_UNLOCK();
 
     DBG(("DD3 6821 PA RD %02x CTRLA %02x CA2 %02x\n", data, ctx->ctrlA, ctx->CA2));
     return data;
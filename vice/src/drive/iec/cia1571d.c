@@ -31,6 +31,7 @@
 
 #include "cia.h"
 #include "ciad.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "iecdrive.h"
 #include "interrupt.h"
@@ -193,7 +194,9 @@ static void pulse_ciapc(cia_context_t *cia_context, CLOCK rclk)
     ciap = (drivecia1571_context_t *)(cia_context->prv);
 
     if (ciap->diskunit->parallel_cable == DRIVE_PC_STANDARD) {
+        DRIVE_BUS_LOCK();
         parallel_cable_drive_write(DRIVE_PC_STANDARD, 0, PARALLEL_HS, ciap->number);
+        DRIVE_BUS_UNLOCK();
     }
 }
 
@@ -223,7 +226,9 @@ static void store_ciapb(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
     ciap = (drivecia1571_context_t *)(cia_context->prv);
 
     if (ciap->diskunit->parallel_cable == DRIVE_PC_STANDARD) {
+        DRIVE_BUS_LOCK();
         parallel_cable_drive_write(DRIVE_PC_STANDARD, byte, PARALLEL_WRITE, ciap->number);
+        DRIVE_BUS_UNLOCK();
     }
 }
 
@@ -241,7 +246,9 @@ static uint8_t read_ciapb(cia_context_t *cia_context)
     ciap = (drivecia1571_context_t *)(cia_context->prv);
 
     if (ciap->diskunit->parallel_cable == DRIVE_PC_STANDARD) {
+        DRIVE_BUS_LOCK();
         byte = parallel_cable_drive_read(ciap->diskunit->parallel_cable, 1);
+        DRIVE_BUS_UNLOCK();
     }
 
     return (uint8_t)((byte & ~(cia_context->c_cia[CIA_DDRB]))
@@ -262,7 +269,9 @@ static void store_sdr(cia_context_t *cia_context, uint8_t byte)
 
     cia1571p = (drivecia1571_context_t *)(cia_context->prv);
 
+    DRIVE_BUS_LOCK();
     iec_fast_drive_write((uint8_t)byte, cia1571p->number);
+    DRIVE_BUS_UNLOCK();
 }
 
 void cia1571_init(diskunit_context_t *ctxptr)
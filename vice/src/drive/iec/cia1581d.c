@@ -34,6 +34,7 @@
 #include "debug.h"
 #include "drive.h"
 #include "drivetypes.h"
+#include "drivethread.h"
 #include "iecbus.h"
 #include "iecdrive.h"
 #include "interrupt.h"
@@ -151,6 +152,7 @@ static void store_ciapb(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
     if (byte != cia_context->old_pb) {
+        DRIVE_BUS_LOCK();
         if (cia1581p->iecbus != NULL) {
             uint8_t *drive_bus, *drive_data;
             unsigned int unit;
@@ -179,6 +181,7 @@ static void store_ciapb(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
         }
 
         iec_fast_drive_direction(byte & 0x20, cia1581p->number);
+        DRIVE_BUS_UNLOCK();
     }
 }
 
@@ -204,22 +207,27 @@ static uint8_t read_ciapa(cia_context_t *cia_context)
 static uint8_t read_ciapb(cia_context_t *cia_context)
 {
     drivecia1581_context_t *cia1581p;
+    uint8_t byte;
 
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
+    DRIVE_BUS_LOCK();
     if (cia1581p->iecbus != NULL) {
         uint8_t *drive_port;
 
         drive_port = &(cia1581p->iecbus->drv_port);
 
-        return (uint8_t)((((cia_context->c_cia[CIA_PRB] & 0x1a)
+        byte = (uint8_t)((((cia_context->c_cia[CIA_PRB] & 0x1a)
                         | (*drive_port)) ^ 0x85)
                 | (cia1581p->drive->read_only ? 0 : 0x40));
     } else {
-        return (uint8_t)((((cia_context->c_cia[CIA_PRB] & 0x1a)
+        byte = (uint8_t)((((cia_context->c_cia[CIA_PRB] & 0x1a)
                         | iec_drive_read(cia1581p->number)) ^ 0x85)
                 | (cia1581p->drive->read_only ? 0 : 0x40));
     }
+    DRIVE_BUS_UNLOCK();
+
+    return byte;
 }
 
 static void read_ciaicr(cia_context_t *cia_context)
@@ -236,7 +244,9 @@ static void store_sdr(cia_context_t *cia_context, uint8_t byte)
 
     cia1581p = (drivecia1581_context_t *)(cia_context->prv);
 
+    DRIVE_BUS_LOCK();
     iec_fast_drive_write(byte, cia1581p->number);
+    DRIVE_BUS_UNLOCK();
 }
 
 void cia1581_init(diskunit_context_t *ctxptr)
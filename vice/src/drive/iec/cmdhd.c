@@ -40,7 +40,9 @@
 #include "diskimage.h"
 #include "debug.h"
 #include "drive.h"
+#include "drivemem.h"
 #include "drivesync.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "iecbus.h"
 #include "iecdrive.h"
@@ -211,6 +213,32 @@ static void drive_store_ram(diskunit_context_t *drv, uint16_t address, uint8_t v
     drv->drive_ram[address] = value;
 }
 
+/* Give the CPU direct pointers for fetching code from the RAM and ROM
+   areas, so instructions there don't go through cmdhd_read() byte by byte.
+   Data accesses still do.  Must be called whenever port C of the 8255
+   changes the mapping.  */
+void cmdhd_update_fetch_map(diskunit_context_t *drv)
+{
+    drivecpud_context_t *cpud = drv->cpud;
+    uint8_t pc;
+
+    if (cpud == NULL || drv->type != DRIVE_TYPE_CMDHD) {
+        return;
+    }
+    pc = drv->cmdhd->i8255a_o[2];
+
+    drivemem_set_func(cpud, 0x40, 0x80, cmdhd_read, cmdhd_store, NULL,
+                      &drv->drive_ram[(pc & 2) ? 0x4000 : 0xc000], 0x40007ffd);
+    drivemem_set_func(cpud, 0x90, 0xc0, cmdhd_read, cmdhd_store, NULL,
+                      &drv->drive_ram[0x9000], 0x9000bffd);
+    drivemem_set_func(cpud, 0xc0, 0x100, cmdhd_read, cmdhd_store, NULL,
+                      (pc & 1) ? drv->rom : &drv->drive_ram[0xc000], 0xc000fffd);
+
+    /* the CPU may have cached a pointer to the old mapping */
+    drv->cpu->d_bank_start = 0;
+    drv->cpu->d_bank_limit = 0;
+}
+
 static void reset_alarm_handler(CLOCK offset, void *data)
 {
     cmdhd_context_t *hd = (cmdhd_context_t *)data;
@@ -514,6 +542,7 @@ static void set_pc(struct _i8255a_state *ctx, uint8_t byte, int8_t reg)
     int mynumber = hd->mycontext->mynumber;
 
     hd->i8255a_o[2] = byte;
+    cmdhd_update_fetch_map(hd->mycontext);
     scsi->atn = ((hd->i8255a_o[2] & 4)!=0);
     scsi->rst = ((hd->i8255a_o[2] & 8)!=0);
     scsi->bsyi = ((hd->i8255a_o[2] & 16)!=0);
@@ -884,6 +913,7 @@ static uint8_t read_prb10(via_context_t *via_context)
 
     viap = (drivevia_context_t *)(via_context->prv);
 
+    DRIVE_BUS_LOCK();
     if (iecbus != NULL) {
         byte = (((via_context->via[VIA_PRB] & 0x1a)
                  | iecbus->drv_port) ^ 0x85);
@@ -891,6 +921,7 @@ static uint8_t read_prb10(via_context_t *via_context)
         byte = (((via_context->via[VIA_PRB] & 0x1a)
                  | iec_drive_read(viap->number)) ^ 0x85);
     }
+    DRIVE_BUS_UNLOCK();
 
     DEBUG_IEC_DRV_READ(byte);
 
@@ -909,6 +940,7 @@ static void store_prb10(via_context_t *via_context, uint8_t byte, uint8_t oldpb,
     if (byte != oldpb) {
         DEBUG_IEC_DRV_WRITE(byte);
 
+        DRIVE_BUS_LOCK();
         if (iecbus != NULL) {
             uint8_t *drive_data, *drive_bus;
             unsigned int unit;
@@ -937,6 +969,7 @@ static void store_prb10(via_context_t *via_context, uint8_t byte, uint8_t oldpb,
         }
 
         iec_fast_drive_direction(byte & 0x20, viap->number);
+        DRIVE_BUS_UNLOCK();
     }
 }
 
@@ -976,7 +1009,9 @@ static void store_sr10(via_context_t *via_context, uint8_t byte)
 
     viap = (drivevia_context_t *)(via_context->prv);
 
+    DRIVE_BUS_LOCK();
     iec_fast_drive_write(byte, viap->number);
+    DRIVE_BUS_UNLOCK();
 }
 
 static void store_t2l(via_context_t *via_context, uint8_t byte)
@@ -1602,6 +1637,8 @@ int cmdhd_snapshot_read_module(cmdhd_context_t *drv, struct snapshot_s *s)
         return -1;
     }
 
+    cmdhd_update_fetch_map(drv->mycontext);
+
     if (snapshot_module_close(m) < 0) {
         return -1;
     }
@@ -75,6 +75,7 @@ void cmdhd_store(struct diskunit_context_s *ctxptr, uint16_t addr, uint8_t byte)
 uint8_t cmdhd_read(struct diskunit_context_s *ctxptr, uint16_t addr);
 uint8_t cmdhd_peek(struct diskunit_context_s *ctxptr, uint16_t addr);
 int cmdhd_dump(diskunit_context_t *ctxptr, uint16_t addr);
+void cmdhd_update_fetch_map(struct diskunit_context_s *ctxptr);
 int cmdhd_attach_image(disk_image_t *image, unsigned int unit);
 int cmdhd_detach_image(disk_image_t *image, unsigned int unit);
 int cmdhd_update_maxsize(unsigned int size, unsigned int unit);
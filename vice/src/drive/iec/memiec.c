@@ -230,6 +230,8 @@ void memiec_init(struct diskunit_context_s *drv, unsigned int type)
         /* CMDHD uses a lot of weird registers to mamage the memory above 0x4000
         so the granularity here doesn't work. We just group it all together */
         drivemem_set_func(cpud, 0x40, 0x100, cmdhd_read, cmdhd_store, NULL, NULL, 0x0000fffd);
+        cmdhd_update_fetch_map(drv);
+        break;
     default:
         return;
     }
@@ -33,7 +33,9 @@
 
 #include "debug.h"
 #include "drive.h"
+#include "drivecpu.h"
 #include "drivesync.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "glue1571.h"
 #include "iecbus.h"
@@ -65,9 +67,39 @@ void via1d1541_store(diskunit_context_t *ctxptr, uint16_t addr, uint8_t data)
     viacore_store(ctxptr->via1d1541, addr, data);
 }
 
+/* Reads a loop waiting for the computer polls, see drivecpu_idle_check().
+   With a parallel cable these are also the cable and its handshake flag
+   (CB1 in the IFR), which only change when the computer accesses the cable
+   and catches the drive up first.  A read of port A in handshake mode
+   signals the computer, so a loop doing that is never idle.  */
+static int via1d1541_idle_read(diskunit_context_t *ctxptr, uint16_t addr)
+{
+    switch (addr & 0xf) {
+        case VIA_PRB:
+            return 1;
+        case VIA_IFR:
+        case VIA_PRA_NHS:
+            return ctxptr->parallel_cable != DRIVE_PC_NONE;
+        case VIA_PRA:
+            return ctxptr->parallel_cable != DRIVE_PC_NONE
+                   && (ctxptr->via1d1541->via[VIA_PCR] & 0xe) != 0xa;
+        default:
+            return 0;
+    }
+}
+
 uint8_t via1d1541_read(diskunit_context_t *ctxptr, uint16_t addr)
 {
-    return ctxptr->cpu->cpu_last_data = viacore_read(ctxptr->via1d1541, addr);
+    uint8_t value = viacore_read(ctxptr->via1d1541, addr);
+
+    ctxptr->cpu->cpu_last_data = value;
+    ctxptr->cpu->idle_io_reads++;
+
+    if (via1d1541_idle_read(ctxptr, addr)) {
+        drivecpu_idle_check(ctxptr, value);
+    }
+
+    return value;
 }
 
 uint8_t via1d1541_peek(diskunit_context_t *ctxptr, uint16_t addr)
@@ -130,8 +162,10 @@ static void undump_pra(via_context_t *via_context, uint8_t byte)
                 if (dc->type == DRIVE_TYPE_1540
                     || dc->type == DRIVE_TYPE_1541
                     || dc->type == DRIVE_TYPE_1541II) {
+                    DRIVE_BUS_LOCK();
                     parallel_cable_drive_write(dc->parallel_cable, byte,
                                                PARALLEL_WRITE, via1p->number);
+                    DRIVE_BUS_UNLOCK();
                 }
                 break;
         }
@@ -158,7 +192,9 @@ static void store_pra(via_context_t *via_context, uint8_t byte, uint8_t oldpa_va
             glue1571_side_set((byte >> 2) & 1, via1p->drive);
         }
         if ((oldpa_value ^ byte) & 0x02) {
+            DRIVE_BUS_LOCK();
             iec_fast_drive_direction(byte & 2, via1p->number);
+            DRIVE_BUS_UNLOCK();
         }
     } else {
         switch (dc->parallel_cable) {
@@ -168,10 +204,12 @@ static void store_pra(via_context_t *via_context, uint8_t byte, uint8_t oldpa_va
                 if (dc->type == DRIVE_TYPE_1540
                     || dc->type == DRIVE_TYPE_1541
                     || dc->type == DRIVE_TYPE_1541II) {
+                    DRIVE_BUS_LOCK();
                     parallel_cable_drive_write(dc->parallel_cable, byte,
                                                (((addr == VIA_PRA) && ((via_context->via[VIA_PCR]
                                                                         & 0xe) == 0xa)) ? PARALLEL_WRITE_HS : PARALLEL_WRITE),
                                                via1p->number);
+                    DRIVE_BUS_UNLOCK();
                 }
                 break;
         }
@@ -219,6 +257,7 @@ static void store_prb(via_context_t *via_context, uint8_t byte, uint8_t p_oldpb,
     if (byte != p_oldpb) {
         DEBUG_IEC_DRV_WRITE(byte);
 
+        DRIVE_BUS_LOCK();
         if (iecbus != NULL) {
             uint8_t *drive_data, *drive_bus;
             unsigned int unit;
@@ -245,6 +284,7 @@ static void store_prb(via_context_t *via_context, uint8_t byte, uint8_t p_oldpb,
             iec_drive_write((uint8_t)(~byte), via1p->number);
             DEBUG_IEC_BUS_WRITE(~byte);
         }
+        DRIVE_BUS_UNLOCK();
     }
 }
 
@@ -309,8 +349,10 @@ static uint8_t read_pra(via_context_t *via_context, uint16_t addr)
         case DRIVE_PC_STANDARD:
         case DRIVE_PC_21SEC_BACKUP:
         case DRIVE_PC_FORMEL64:
+            DRIVE_BUS_LOCK();
             byte = parallel_cable_drive_read(via1p->diskunit->parallel_cable,
                                              (((addr == VIA_PRA) && (via_context->via[VIA_PCR] & 0xe) == 0xa)) ? 1 : 0);
+            DRIVE_BUS_UNLOCK();
             break;
         default:
             byte = ((via_context->via[VIA_PRA] & via_context->via[VIA_DDRA])
@@ -332,6 +374,7 @@ static uint8_t read_prb(via_context_t *via_context)
     /* 0 for drive0, 0x20 for drive 1 */
     orval = (via1p->number << 5);
 
+    DRIVE_BUS_LOCK();
     if (iecbus != NULL) {
         byte = (((via_context->via[VIA_PRB] & 0x1a)
                  | iecbus->drv_port) ^ 0x85) | orval;
@@ -339,6 +382,7 @@ static uint8_t read_prb(via_context_t *via_context)
         byte = (((via_context->via[VIA_PRB] & 0x1a)
                  | iec_drive_read(via1p->number)) ^ 0x85) | orval;
     }
+    DRIVE_BUS_UNLOCK();
 
     DEBUG_IEC_DRV_READ(byte);
 
@@ -37,6 +37,7 @@
 #include "debug.h"
 #include "drive.h"
 #include "drivesync.h"
+#include "drivethread.h"
 #include "drivetypes.h"
 #include "iecbus.h"
 #include "iecdrive.h"
@@ -144,6 +145,7 @@ static void store_pra(via_context_t *via_context, uint8_t byte, uint8_t oldpa,
     if (byte != oldpa) {
         DEBUG_IEC_DRV_WRITE(byte);
 
+        DRIVE_BUS_LOCK();
         if (iecbus != NULL) {
             uint8_t *drive_data, *drive_bus;
             unsigned int unit;
@@ -172,6 +174,7 @@ static void store_pra(via_context_t *via_context, uint8_t byte, uint8_t oldpa,
         }
 
         iec_fast_drive_direction(byte & 0x20, viap->number);
+        DRIVE_BUS_UNLOCK();
     }
 }
 
@@ -219,7 +222,9 @@ static void store_sr(via_context_t *via_context, uint8_t byte)
 
     viap = (drivevia_context_t *)(via_context->prv);
 
+    DRIVE_BUS_LOCK();
     iec_fast_drive_write((uint8_t)(~byte), viap->number);
+    DRIVE_BUS_UNLOCK();
 }
 
 static void store_t2l(via_context_t *via_context, uint8_t byte)
@@ -237,6 +242,7 @@ static uint8_t read_pra(via_context_t *via_context, uint16_t addr)
 
     viap = (drivevia_context_t *)(via_context->prv);
 
+    DRIVE_BUS_LOCK();
     if (iecbus != NULL) {
         byte = (((via_context->via[VIA_PRA] & 0x1a)
                  | iecbus->drv_port) ^ 0x85);
@@ -244,6 +250,7 @@ static uint8_t read_pra(via_context_t *via_context, uint16_t addr)
         byte = (((via_context->via[VIA_PRA] & 0x1a)
                  | iec_drive_read(viap->number)) ^ 0x85);
     }
+    DRIVE_BUS_UNLOCK();
 
     DEBUG_IEC_DRV_READ(byte);
 
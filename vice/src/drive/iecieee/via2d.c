@@ -137,6 +137,7 @@ void via2d_store(diskunit_context_t *ctxptr, uint16_t addr, uint8_t data)
 
 uint8_t via2d_read(diskunit_context_t *ctxptr, uint16_t addr)
 {
+    ctxptr->cpu->idle_io_reads++;
     return ctxptr->cpu->cpu_last_data = viacore_read(ctxptr->via2, addr);
 }
 
@@ -245,6 +245,9 @@ inline static void write_next_bit(drive_t *dptr, int value)
     if (dptr->GCR_track_start_ptr == NULL) {
         return;
     }
+    if (!dptr->GCR_dirty_track) {
+        drive_gcr_base_keep_current(dptr);
+    }
     dptr->GCR_dirty_track = 1;
     if (value) {
         dptr->GCR_track_start_ptr[byte_offset] |= 1 << bit;
@@ -642,9 +645,23 @@ static void rotation_1541_p64(drive_t *dptr, CLOCK ref_cycles)
 
     P64PulseStream = &dptr->p64->PulseStreams[dptr->side][dptr->current_half_track];
 
-    /* Reset if out of head position bounds */
-    if ((P64PulseStream->UsedLast >= 0) &&
+    /* tracks are decoded when the head reaches them first */
+    if (P64PulseStream->EncodedPending) {
+        P64PulseStreamDecode(P64PulseStream);
+    }
+
+    if ((P64PulseStream->CurrentIndex >= 0) &&
+        (P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Position > rptr->PulseHeadPosition) &&
+        ((P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous < 0) ||
+         (P64PulseStream->Pulses[P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Previous].Position <= rptr->PulseHeadPosition))) {
+        /* still on the next pulse after the head, the common case */
+    } else if (dptr->read_write_mode) {
+        /* binary search on the sorted pulses after a head step or a jump;
+           not while writing, which keeps changing the pulses */
+        P64PulseStream->CurrentIndex = P64PulseStreamFindPulse(P64PulseStream, rptr->PulseHeadPosition + 1);
+    } else if ((P64PulseStream->UsedLast >= 0) &&
         (P64PulseStream->Pulses[P64PulseStream->UsedLast].Position <= rptr->PulseHeadPosition)) {
+        /* Reset if out of head position bounds */
         P64PulseStream->CurrentIndex = -1;
     } else {
         if (P64PulseStream->CurrentIndex < 0) {
@@ -781,11 +798,7 @@ static void rotation_1541_p64(drive_t *dptr, CLOCK ref_cycles)
                 if (rptr->PulseHeadPosition >= P64PulseSamplesPerRotation) {
                     rptr->PulseHeadPosition -= P64PulseSamplesPerRotation;
 
-                    P64PulseStream->CurrentIndex = P64PulseStream->UsedFirst;
-                    while ((P64PulseStream->CurrentIndex >= 0) &&
-                           (P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Position < rptr->PulseHeadPosition)) {
-                        P64PulseStream->CurrentIndex = P64PulseStream->Pulses[P64PulseStream->CurrentIndex].Next;
-                    }
+                    P64PulseStream->CurrentIndex = P64PulseStreamFindPulse(P64PulseStream, rptr->PulseHeadPosition);
                     DeltaPositionToNextPulse = rotation_p64_get_delta(dptr);
                 }
 
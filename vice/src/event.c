@@ -49,9 +49,12 @@
 #include "log.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "memusage.h"
 #include "network.h"
 #include "resources.h"
+#include "sha1.h"
 #include "snapshot.h"
+#include "statehash.h"
 #include "tape.h"
 #include "tapeport.h"
 #include "types.h"
@@ -59,6 +62,7 @@
 #include "util.h"
 #include "version.h"
 #include "vice-event.h"
+#include "vsync.h"
 
 #ifdef EVENT_DEBUG
 #define DBG(x)  log_debug x
@@ -77,10 +81,87 @@
  */
 #define CRC32_SIZE  (sizeof(uint32_t))
 
+/* Images included in a recording (EventImageInclude) are known by the
+   SHA-1 hash of their contents.  Only the first attach of an image carries
+   it, a later attach of the same contents (a disk swapped back in, or the
+   same image under another name) has the hash instead of the image and
+   EVENT_ATTACH_HASH set in the read-only byte.  */
+#define EVENT_IMAGE_HASH_SIZE   20
+#define EVENT_ATTACH_HASH       0x80
+
+/* Event list nodes and small event data are recycled rather than freed:
+   netplay clears and refills the event list of every frame, and the free
+   lists keep that off the heap.  Data of up to EVENT_DATA_BLOCK bytes is
+   always allocated as a block of that size, so the data of a node must
+   come from event_data_new() and go back with event_data_free().  */
+#define EVENT_DATA_BLOCK    64
+
+static event_list_t *free_nodes = NULL;
+static void *free_data_blocks = NULL;
+
+static event_list_t *event_node_new(void)
+{
+    event_list_t *node = free_nodes;
+
+    if (node == NULL) {
+        return lib_calloc(1, sizeof(event_list_t));
+    }
+    free_nodes = node->next;
+    memset(node, 0, sizeof(event_list_t));
+    return node;
+}
+
+static void *event_data_new(size_t size)
+{
+    void *data;
+
+    if (size > EVENT_DATA_BLOCK) {
+        return lib_malloc(size);
+    }
+    if (free_data_blocks == NULL) {
+        return lib_malloc(EVENT_DATA_BLOCK);
+    }
+    data = free_data_blocks;
+    free_data_blocks = *(void **)data;
+    return data;
+}
+
+static void event_data_free(void *data, size_t size)
+{
+    if (data == NULL) {
+        return;
+    }
+    if (size > EVENT_DATA_BLOCK) {
+        lib_free(data);
+        return;
+    }
+    *(void **)data = free_data_blocks;
+    free_data_blocks = data;
+}
+
+static void event_pools_free(void)
+{
+    void *block;
+
+    while (free_nodes != NULL) {
+        event_list_t *node = free_nodes;
+
+        free_nodes = node->next;
+        lib_free(node);
+    }
+    while (free_data_blocks != NULL) {
+        block = free_data_blocks;
+        free_data_blocks = *(void **)block;
+        lib_free(block);
+    }
+}
+
 
 struct event_image_list_s {
     char *orig_filename;
     char *mapped_filename;
+    int hashed;                             /* known by hash, not by name */
+    uint8_t hash[EVENT_IMAGE_HASH_SIZE];    /* SHA-1 of an included image */
     struct event_image_list_s *next;
 };
 typedef struct event_image_list_s event_image_list_t;
@@ -109,6 +190,35 @@ static char *event_snapshot_path_str = NULL;
 static int event_start_mode;
 static int event_image_include;
 
+/* the first timestamp of a recording has no sync test, it can come before
+   the reset of the start */
+static int record_sync_skip;
+
+/* sync test expected by the playback, and whether a divergence was
+   reported already */
+static uint32_t playback_sync_regs[STATEHASH_SYNC_WORDS];
+static int playback_sync_reported;
+
+/* Keyframes of the recording: the machine state every
+   `EventKeyframeInterval' seconds, marked in the event list by an
+   EVENT_KEYFRAME event with the number of the keyframe.  A seek restores
+   the newest keyframe before the target and plays the rest in warp mode.  */
+typedef struct event_keyframe_s {
+    unsigned int timestamp;
+    uint8_t *data;
+    size_t size;
+} event_keyframe_t;
+
+static event_keyframe_t *keyframes = NULL;
+static unsigned int keyframe_count = 0;
+static unsigned int keyframe_alloc = 0;
+static int event_keyframe_interval;
+
+/* second a seek is heading for in warp mode, and the warp mode before */
+static int seek_active = 0;
+static unsigned int seek_target;
+static int seek_warp_saved;
+
 static char *event_snapshot_path(const char *snapshot_file)
 {
     lib_free(event_snapshot_path_str);
@@ -119,6 +229,7 @@ static char *event_snapshot_path(const char *snapshot_file)
 
 
 /* searches for a filename in the image list    */
+/* (leaving out the images known by hash)       */
 /* returns 0 if found                           */
 /* returns 1 and appends it if not found        */
 static int event_image_append(const char *filename, char **mapped_name, int append)
@@ -126,7 +237,8 @@ static int event_image_append(const char *filename, char **mapped_name, int appe
     event_image_list_t *event_image_list_ptr = event_image_list_base;
 
     while (event_image_list_ptr->next != NULL) {
-        if (strcmp(filename, event_image_list_ptr->next->orig_filename) == 0) {
+        if (!event_image_list_ptr->next->hashed
+            && strcmp(filename, event_image_list_ptr->next->orig_filename) == 0) {
             if (mapped_name != NULL) {
                 if (append == 0) {
                     if (event_image_list_ptr->next->mapped_filename != NULL) {
@@ -135,6 +247,7 @@ static int event_image_append(const char *filename, char **mapped_name, int appe
                         return 1;
                     }
                 } else {
+                    lib_free(event_image_list_ptr->next->mapped_filename);
                     event_image_list_ptr->next->mapped_filename = lib_strdup(*mapped_name);
                 }
             }
@@ -156,6 +269,81 @@ static int event_image_append(const char *filename, char **mapped_name, int appe
     return 1;
 }
 
+/* searches for an included image by the SHA-1 hash of its contents */
+/* returns NULL if not found                                          */
+static event_image_list_t *event_image_find_hash(const uint8_t *hash)
+{
+    event_image_list_t *event_image_list_ptr = event_image_list_base->next;
+
+    while (event_image_list_ptr != NULL) {
+        if (event_image_list_ptr->hashed
+            && memcmp(event_image_list_ptr->hash, hash, EVENT_IMAGE_HASH_SIZE) == 0) {
+            break;
+        }
+        event_image_list_ptr = event_image_list_ptr->next;
+    }
+
+    return event_image_list_ptr;
+}
+
+/* appends an included image with SHA-1 hash `hash' unless it is known */
+/* already, `mapped_name' (may be NULL) is the file it was written to  */
+static void event_image_append_hash(const char *filename, const uint8_t *hash,
+                                    const char *mapped_name)
+{
+    event_image_list_t *event_image_list_ptr = event_image_find_hash(hash);
+
+    if (event_image_list_ptr != NULL) {
+        if (event_image_list_ptr->mapped_filename == NULL && mapped_name != NULL) {
+            event_image_list_ptr->mapped_filename = lib_strdup(mapped_name);
+        }
+        return;
+    }
+
+    event_image_list_ptr = event_image_list_base;
+    while (event_image_list_ptr->next != NULL) {
+        event_image_list_ptr = event_image_list_ptr->next;
+    }
+
+    event_image_list_ptr->next = lib_calloc(1, sizeof(event_image_list_t));
+
+    event_image_list_ptr = event_image_list_ptr->next;
+    event_image_list_ptr->next = NULL;
+    event_image_list_ptr->orig_filename = lib_strdup(filename);
+    event_image_list_ptr->mapped_filename = mapped_name != NULL ? lib_strdup(mapped_name) : NULL;
+    event_image_list_ptr->hashed = 1;
+    memcpy(event_image_list_ptr->hash, hash, EVENT_IMAGE_HASH_SIZE);
+}
+
+/* reads the image `filename' for including it in the recording */
+/* returns NULL if it cannot be read                            */
+static uint8_t *event_image_load(const char *filename, size_t *len)
+{
+    FILE *fd;
+    off_t file_len;
+    uint8_t *image = NULL;
+
+    fd = fopen(filename, MODE_READ);
+    if (fd == NULL) {
+        log_error(event_log, "Cannot open image file %s", filename);
+        return NULL;
+    }
+
+    file_len = archdep_file_size(fd);
+    if (file_len >= 0) {
+        image = lib_malloc(file_len > 0 ? (size_t)file_len : 1);
+        if (file_len > 0 && fread(image, (size_t)file_len, 1, fd) != 1) {
+            log_error(event_log, "Cannot load image file %s", filename);
+            lib_free(image);
+            image = NULL;
+        }
+        *len = (size_t)file_len;
+    }
+    fclose(fd);
+
+    return image;
+}
+
 
 void event_record_attach_in_list(event_list_state_t *list, unsigned int unit,
                                  unsigned int drive,
@@ -167,46 +355,51 @@ void event_record_attach_in_list(event_list_state_t *list, unsigned int unit,
 
     list->current->type = EVENT_ATTACHIMAGE;
     list->current->clk = maincpu_clk;
-    list->current->next = lib_calloc(1, sizeof(event_list_t));
+    list->current->next = event_node_new();
 
     util_fname_split(filename, &strdir, &strfile);
 
     if (event_image_include) {
-        size = (unsigned int)strlen(filename) + 3;
-    } else {
-        size = (unsigned int)strlen(strfile) + CRC32_SIZE + 4;
-    }
-
-    event_data = lib_malloc(size);
-    event_data[0] = unit;
-    event_data[1] = drive;
-    event_data[2] = read_only;
-
-    if (event_image_include) {
-        strcpy(&event_data[3], filename);
-        if (event_image_append(filename, NULL, 0) == 1) {
-            FILE *fd;
-            off_t file_len = 0;
-
-            fd = fopen(filename, MODE_READ);
-
-            if (fd != NULL) {
-                file_len = archdep_file_size(fd);
-                if (file_len >= 0) {
-                    event_data = lib_realloc(event_data, size + (unsigned int)file_len);
-                    if (fread(&event_data[size], (size_t)file_len, 1, fd) != 1) {
-                        log_error(event_log, "Cannot load image file %s", filename);
-                    }
-                    fclose(fd);
-                }
+        uint8_t hash[EVENT_IMAGE_HASH_SIZE];
+        uint8_t *image;
+        size_t image_len = 0;
+        unsigned int head = (unsigned int)strlen(filename) + 4;
+
+        image = event_image_load(filename, &image_len);
+        if (image == NULL) {
+            /* playback will not find it either */
+            size = head;
+            event_data = event_data_new(size);
+            event_data[2] = read_only;
+        } else {
+            SHA1(hash, image, (uint32_t)image_len);
+            if (event_image_find_hash(hash) != NULL) {
+                /* included already, refer to it */
+                size = head + EVENT_IMAGE_HASH_SIZE;
+                event_data = event_data_new(size);
+                event_data[2] = read_only | EVENT_ATTACH_HASH;
+                memcpy(&event_data[head], hash, EVENT_IMAGE_HASH_SIZE);
             } else {
-                log_error(event_log, "Cannot open image file %s", filename);
+                size = head + (unsigned int)image_len;
+                event_data = event_data_new(size);
+                event_data[2] = read_only;
+                memcpy(&event_data[head], image, image_len);
+                event_image_append_hash(filename, hash, NULL);
             }
-            size += (unsigned int)file_len;
+            lib_free(image);
         }
+        event_data[0] = unit;
+        event_data[1] = drive;
+        strcpy(&event_data[3], filename);
     } else {
         uint32_t crc = crc32_file(filename);
 
+        size = (unsigned int)strlen(strfile) + CRC32_SIZE + 4;
+        event_data = event_data_new(size);
+        event_data[0] = unit;
+        event_data[1] = drive;
+        event_data[2] = read_only;
+
         strcpy(&event_data[3], "");
 
         /* store crc32 in little-endian format */
@@ -243,12 +436,31 @@ static void event_playback_attach_image(void *data, unsigned int size)
 
     uint8_t crc_file[CRC32_SIZE];   /* CRC32 little endian value of file */
     uint8_t crc_snap[CRC32_SIZE];   /* CRC32 of file in the snapshot */
+    uint8_t hash[EVENT_IMAGE_HASH_SIZE];
 
     unit = (unsigned int)((char*)data)[0];
     drive = (unsigned int)((char*)data)[1];
-    read_only = (unsigned int)((char*)data)[2];
+    read_only = (unsigned int)((uint8_t *)data)[2];
     orig_filename = &((char*)data)[3];
 
+    if (*orig_filename != 0 && (read_only & EVENT_ATTACH_HASH)) {
+        /* image included by an earlier attach */
+        event_image_list_t *image;
+
+        read_only &= ~EVENT_ATTACH_HASH;
+        if (size != strlen(orig_filename) + 4 + EVENT_IMAGE_HASH_SIZE) {
+            ui_error("Invalid image attach for %s", orig_filename);
+            return;
+        }
+        image = event_image_find_hash((uint8_t *)data + strlen(orig_filename) + 4);
+        if (image == NULL || image->mapped_filename == NULL) {
+            ui_error("Cannot find mapped name for %s", orig_filename);
+            return;
+        }
+        filename = lib_strdup(image->mapped_filename);
+        goto attach;
+    }
+
     if (*orig_filename == 0) {
         /* no image attached */
         orig_filename = (char *) data + 4 + CRC32_SIZE;
@@ -306,6 +518,8 @@ static void event_playback_attach_image(void *data, unsigned int size)
 
             fclose(fd);
             event_image_append(orig_filename, &filename, 1);
+            SHA1(hash, (uint8_t *)data + strlen(orig_filename) + 4, (uint32_t)file_len);
+            event_image_append_hash(orig_filename, hash, filename);
         } else {
             if (event_image_append(orig_filename, &filename, 0) != 0) {
                 ui_error("Cannot find mapped name for %s", orig_filename);
@@ -313,6 +527,7 @@ static void event_playback_attach_image(void *data, unsigned int size)
             }
         }
     }
+attach:
     /* now filename holds the name to attach    */
     /* FIXME: read_only isn't handled for tape  */
     if (unit == 1 || unit == 2) {
@@ -350,8 +565,9 @@ void event_record_in_list(event_list_state_t *list, unsigned int type,
         case EVENT_ATTACHIMAGE:         /* fall through */
         case EVENT_INITIAL:             /* fall through */
         case EVENT_SYNC_TEST:           /* fall through */
+        case EVENT_KEYFRAME:            /* fall through */
         case EVENT_RESOURCE:
-            event_data = lib_malloc(size);
+            event_data = event_data_new(size);
             memcpy(event_data, data, size);
             break;
         case EVENT_LIST_END:            /* fall through */
@@ -367,7 +583,7 @@ void event_record_in_list(event_list_state_t *list, unsigned int type,
         list->current->clk = maincpu_clk;
         list->current->size = size;
         list->current->data = event_data;
-        list->current->next = lib_calloc(1, sizeof(event_list_t));
+        list->current->next = event_node_new();
         list->current = list->current->next;
         list->current->type = EVENT_LIST_END;
     } else {
@@ -384,6 +600,154 @@ void event_record(unsigned int type, void *data, unsigned int size)
 }
 
 
+/* The state hash is kept while recording and playing back.  */
+static void event_statehash_enable(int enable)
+{
+    static int enabled = 0;
+
+    if (enable != enabled) {
+        statehash_enable(enable);
+        enabled = enable;
+    }
+}
+
+/* Record a sync test (registers and state hash) with every timestamp, the
+   playback compares it at the same clock.  */
+static void event_record_sync_test_trap(uint16_t addr, void *data)
+{
+    uint32_t regs[STATEHASH_SYNC_WORDS];
+    uint8_t regbuf[STATEHASH_SYNC_WORDS * 4];
+    int i;
+
+    if (record_active == 0) {
+        return;
+    }
+
+    statehash_sync_test(regs);
+    for (i = 0; i < STATEHASH_SYNC_WORDS; i++) {
+        util_dword_to_le_buf(&regbuf[i * 4], regs[i]);
+    }
+    event_record(EVENT_SYNC_TEST, (void *)regbuf, sizeof(regbuf));
+}
+
+static void event_playback_sync_test_trap(uint16_t addr, void *data)
+{
+    uint32_t regs[STATEHASH_SYNC_WORDS];
+
+    if (playback_active == 0 || playback_sync_reported) {
+        return;
+    }
+
+    statehash_sync_test(regs);
+    if (memcmp(regs, playback_sync_regs, sizeof(regs)) != 0) {
+        log_error(event_log, "Playback out of sync at %u seconds (clock %"PRIu64").",
+                  current_timestamp, (uint64_t)maincpu_clk);
+        ui_error("Event playback out of sync at %u seconds.", current_timestamp);
+        playback_sync_reported = 1;
+    }
+}
+
+static void event_playback_sync_test(void *data, unsigned int size)
+{
+    int i;
+
+    if (size != STATEHASH_SYNC_WORDS * 4) {
+        return;
+    }
+
+    for (i = 0; i < STATEHASH_SYNC_WORDS; i++) {
+        playback_sync_regs[i] = util_le_buf_to_dword((uint8_t *)data + i * 4);
+    }
+    interrupt_maincpu_trigger_trap(event_playback_sync_test_trap, (void *)0);
+}
+
+/* the keyframes of the recording, for the memory report */
+static size_t keyframes_usage(void)
+{
+    size_t bytes = keyframe_alloc * sizeof(event_keyframe_t);
+    unsigned int i;
+
+    for (i = 0; i < keyframe_count; i++) {
+        bytes += keyframes[i].size;
+    }
+    return bytes;
+}
+
+static void keyframe_append(unsigned int timestamp, uint8_t *data, size_t size)
+{
+    memusage_register("event keyframes", keyframes_usage);
+
+    if (keyframe_count == keyframe_alloc) {
+        keyframe_alloc = keyframe_alloc ? keyframe_alloc * 2 : 64;
+        keyframes = lib_realloc(keyframes, keyframe_alloc * sizeof(event_keyframe_t));
+    }
+    keyframes[keyframe_count].timestamp = timestamp;
+    keyframes[keyframe_count].data = data;
+    keyframes[keyframe_count].size = size;
+    keyframe_count++;
+}
+
+/* Drop the keyframes after the first `count'.  */
+static void keyframes_truncate(unsigned int count)
+{
+    while (keyframe_count > count) {
+        keyframe_count--;
+        lib_free(keyframes[keyframe_count].data);
+    }
+}
+
+/* Drop the keyframes whose marker is no longer in the event list.  */
+static void keyframes_truncate_to_list(void)
+{
+    event_list_t *curr;
+    unsigned int count = 0, n;
+
+    for (curr = event_list->base; curr != NULL && curr->type != EVENT_LIST_END; curr = curr->next) {
+        if (curr->type == EVENT_KEYFRAME && curr->size == 4) {
+            n = (unsigned int)util_le_buf_to_dword(curr->data) + 1;
+            if (n > count) {
+                count = n;
+            }
+        }
+    }
+    keyframes_truncate(count);
+}
+
+static void event_record_keyframe_trap(uint16_t addr, void *data)
+{
+    snapshot_t *s;
+    const uint8_t *state;
+    uint8_t *copy;
+    size_t size;
+    uint8_t buf[4];
+
+    if (record_active == 0) {
+        return;
+    }
+
+    s = machine_write_snapshot_mem(0, SNAPSHOT_DISKS_REFERENCE, 0);
+    if (s == NULL) {
+        log_error(event_log, "Cannot save the keyframe at %u seconds.", vice_ptr_to_uint(data));
+        return;
+    }
+    state = snapshot_mem_get_data(s, &size);
+    copy = lib_malloc(size);
+    memcpy(copy, state, size);
+    snapshot_close(s);
+
+    keyframe_append(vice_ptr_to_uint(data), copy, size);
+    util_dword_to_le_buf(buf, (uint32_t)(keyframe_count - 1));
+    event_record(EVENT_KEYFRAME, (void *)buf, sizeof(buf));
+}
+
+static void event_seek_end(void)
+{
+    if (seek_active) {
+        seek_active = 0;
+        vsync_set_warp_mode(seek_warp_saved);
+    }
+}
+
 static void next_alarm_set(void)
 {
     CLOCK new_value;
@@ -403,9 +767,21 @@ static void event_alarm_handler(CLOCK offset, void *data)
 
     /* when recording set a timestamp */
     if (record_active) {
+        unsigned int timestamp = current_timestamp;
+
         ui_display_event_time(current_timestamp++, 0);
         next_timestamp_clk = next_timestamp_clk + (CLOCK)machine_get_cycles_per_second();
         alarm_set(event_alarm, next_timestamp_clk);
+        if (record_sync_skip) {
+            record_sync_skip = 0;
+        } else {
+            interrupt_maincpu_trigger_trap(event_record_sync_test_trap, (void *)0);
+            if (event_keyframe_interval > 0
+                && timestamp % (unsigned int)event_keyframe_interval == 0) {
+                interrupt_maincpu_trigger_trap(event_record_keyframe_trap,
+                                               vice_uint_to_ptr(timestamp));
+            }
+        }
         return;
     }
 
@@ -452,6 +828,15 @@ static void event_alarm_handler(CLOCK offset, void *data)
             break;
         case EVENT_TIMESTAMP:
             ui_display_event_time(current_timestamp++, playback_time);
+            if (seek_active && current_timestamp > seek_target) {
+                event_seek_end();
+            }
+            break;
+        case EVENT_KEYFRAME:
+            break;
+        case EVENT_SYNC_TEST:
+            event_playback_sync_test(event_list->current->data,
+                                     event_list->current->size);
             break;
         case EVENT_LIST_END:
             event_playback_stop();
@@ -538,7 +923,7 @@ void event_playback_event_list(event_list_state_t *list)
 void event_register_event_list(event_list_state_t *list)
 {
     DBG(("event_register_event_list %p", list));
-    list->base = lib_calloc(1, sizeof(event_list_t));
+    list->base = event_node_new();
     list->current = list->base;
 }
 
@@ -564,8 +949,9 @@ static void cut_list(event_list_t *cut_base)
 
     while (c1 != NULL) {
         c2 = c1->next;
-        lib_free(c1->data);
-        lib_free(c1);
+        event_data_free(c1->data, c1->size);
+        c1->next = free_nodes;
+        free_nodes = c1;
         c1 = c2;
     }
 }
@@ -600,6 +986,7 @@ static void destroy_list(void)
     event_clear_list(event_list);
     lib_free(event_list);
     event_destroy_image_list();
+    keyframes_truncate(0);
 }
 
 static void warp_end_list(void)
@@ -610,7 +997,18 @@ static void warp_end_list(void)
 
     while (curr->type != EVENT_LIST_END) {
         if (curr->type == EVENT_ATTACHIMAGE) {
-            event_image_append(&((char*)curr->data)[3], NULL, 0);
+            const char *orig_filename = &((char*)curr->data)[3];
+            size_t head = strlen(orig_filename) + 4;
+
+            event_image_append(orig_filename, NULL, 0);
+            if (*orig_filename != 0 && head < curr->size
+                && !(((uint8_t *)curr->data)[2] & EVENT_ATTACH_HASH)) {
+                /* later attaches of the image recorded can refer to it */
+                uint8_t hash[EVENT_IMAGE_HASH_SIZE];
+
+                SHA1(hash, (uint8_t *)curr->data + head, (uint32_t)(curr->size - head));
+                event_image_append_hash(orig_filename, hash, NULL);
+            }
         }
 
         curr = curr->next;
@@ -626,16 +1024,17 @@ static void event_write_version(void)
     uint8_t *new_data;
     uint8_t *data;
     unsigned int ver_idx;
+    unsigned int old_size;
 
     if (event_list->base->type != EVENT_INITIAL) {
         /* EVENT_INITIAL is missing (bug in 1.14.xx); fix it */
         event_list_t *new_event;
 
-        new_event = lib_calloc(1, sizeof(event_list_t));
+        new_event = event_node_new();
         new_event->clk = event_list->base->clk;
         new_event->size = (unsigned int)strlen(event_start_snapshot) + 2;
         new_event->type = EVENT_INITIAL;
-        data = lib_malloc(new_event->size);
+        data = event_data_new(new_event->size);
         data[0] = EVENT_START_MODE_FILE_SAVE;
         strcpy((char *)&data[1], event_start_snapshot);
         new_event->data = data;
@@ -644,6 +1043,7 @@ static void event_write_version(void)
     }
 
     data = event_list->base->data;
+    old_size = event_list->base->size;
 
     ver_idx = 1;
     if (data[0] == EVENT_START_MODE_FILE_SAVE) {
@@ -651,14 +1051,14 @@ static void event_write_version(void)
     }
 
     event_list->base->size = ver_idx + (unsigned int)strlen(VERSION) + 1;
-    new_data = lib_malloc(event_list->base->size);
+    new_data = event_data_new(event_list->base->size);
 
     memcpy(new_data, data, ver_idx);
 
     strcpy((char *)&new_data[ver_idx], VERSION);
 
     event_list->base->data = new_data;
-    lib_free(data);
+    event_data_free(data, old_size);
 }
 
 static void event_initial_write(void)
@@ -733,6 +1133,7 @@ static void event_record_start_trap(uint16_t addr, void *data)
             cut_list(event_list->current->next);
             event_list->current->next = NULL;
             event_list->current->type = EVENT_LIST_END;
+            keyframes_truncate_to_list();
             event_destroy_image_list();
             event_write_version();
             record_active = 1;
@@ -752,6 +1153,8 @@ static void event_record_start_trap(uint16_t addr, void *data)
     alarm_set(event_alarm, next_timestamp_clk);
 
     record_active = 1;
+    record_sync_skip = 1;
+    event_statehash_enable(1);
     ui_display_recording(1);
 }
 
@@ -800,6 +1203,7 @@ int event_record_stop(void)
     ui_display_recording(0);
 
     alarm_unset(event_alarm);
+    event_statehash_enable(0);
 
     return 0;
 }
@@ -909,6 +1313,8 @@ static void event_playback_start_trap(uint16_t addr, void *unused)
 
     playback_active = 1;
     current_timestamp = 0;
+    playback_sync_reported = 0;
+    event_statehash_enable(1);
 
     ui_display_playback(1, event_version);
 
@@ -938,6 +1344,8 @@ int event_playback_stop(void)
     playback_active = 0;
 
     alarm_unset(event_alarm);
+    event_statehash_enable(0);
+    event_seek_end();
 
     ui_display_playback(0, NULL);
 
@@ -948,6 +1356,114 @@ int event_playback_stop(void)
     return 0;
 }
 
+/* Continue the playback at second `target': restore the newest keyframe
+   before it, unless the playback is between that keyframe and the target
+   already, and play the rest in warp mode.  The input state is not part of
+   the machine state, the newest keyboard and joystick events before the
+   keyframe are played again.  */
+static void event_playback_seek_trap(uint16_t addr, void *data)
+{
+    unsigned int target = vice_ptr_to_uint(data);
+    event_list_t *curr, *marker = NULL;
+    void *keyboard_data = NULL, *joystick_data = NULL;
+    unsigned int timestamps = 0, i;
+    int keyframe = -1;
+
+    if (playback_active == 0) {
+        return;
+    }
+
+    for (i = 0; i < keyframe_count && keyframes[i].timestamp <= target; i++) {
+        keyframe = (int)i;
+    }
+
+    if (target >= current_timestamp
+        && (keyframe < 0 || keyframes[keyframe].timestamp < current_timestamp)) {
+        /* ahead of the current position, nothing to restore */
+    } else if (keyframe < 0) {
+        /* before the first keyframe, start over */
+        event_seek_end();
+        event_playback_start_trap(addr, NULL);
+        if (playback_active == 0) {
+            return;
+        }
+    } else {
+        for (curr = event_list->base; curr->type != EVENT_LIST_END; curr = curr->next) {
+            if (curr->type == EVENT_KEYFRAME && curr->size == 4
+                && util_le_buf_to_dword(curr->data) == (uint32_t)keyframe) {
+                marker = curr;
+                break;
+            }
+            switch (curr->type) {
+                case EVENT_TIMESTAMP:
+                    timestamps++;
+                    break;
+                case EVENT_KEYBOARD_MATRIX:
+                    keyboard_data = curr->data;
+                    break;
+                case EVENT_JOYSTICK_VALUE:
+                    joystick_data = curr->data;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        if (marker == NULL
+            || machine_read_snapshot_mem(keyframes[keyframe].data,
+                                         keyframes[keyframe].size, 0) < 0) {
+            ui_error("Cannot seek the event playback to %u seconds.", target);
+            return;
+        }
+
+        if (keyboard_data != NULL) {
+            keyboard_event_playback(0, keyboard_data);
+        }
+        if (joystick_data != NULL) {
+            joystick_event_playback(0, joystick_data);
+        }
+
+        playback_reset_ack = 0;
+        current_timestamp = timestamps;
+        event_list->current = marker;
+        next_current_list();
+        next_alarm_set();
+    }
+
+    if (current_timestamp <= target) {
+        if (!seek_active) {
+            seek_warp_saved = vsync_get_warp_mode();
+        }
+        seek_active = 1;
+        seek_target = target;
+        vsync_set_warp_mode(1);
+    } else {
+        event_seek_end();
+    }
+}
+
+int event_playback_seek(unsigned int seconds)
+{
+    if (playback_active == 0) {
+        return -1;
+    }
+
+    if (seconds > playback_time) {
+        seconds = playback_time;
+    }
+
+    interrupt_maincpu_trigger_trap(event_playback_seek_trap, vice_uint_to_ptr(seconds));
+
+    return 0;
+}
+
+int event_playback_seek_by(int seconds)
+{
+    int target = (int)current_timestamp + seconds;
+
+    return event_playback_seek(target > 0 ? (unsigned int)target : 0);
+}
+
 static void event_record_set_milestone_trap(uint16_t addr, void *data)
 {
     if (machine_write_snapshot(event_snapshot_path(event_end_snapshot), 1, 1, 1) < 0) {
@@ -1025,32 +1541,186 @@ int event_playback_active(void)
 
 /*-----------------------------------------------------------------------*/
 
-int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
+/* Since version 1.0 the EVENT module stores the events as one byte array:
+   for every event the type (shifted left by one, bit 0 set if the data is
+   stored as a delta), the clock difference to the previous event (zigzag
+   encoded, as a reset restarts the clock), the size and the data, all
+   numbers as little endian base 128 varints.  The data of an event is
+   stored as a delta if the previous event of the same type had the same
+   size: runs of (equal bytes, different bytes, the different bytes XORed
+   with the previous data).  Keyboard and joystick events mostly change a
+   single byte, so an event usually takes a few bytes.  Since version 1.1
+   an image attach can refer to an image included before by its hash
+   (EVENT_ATTACH_HASH).  */
+
+#define EVENT_MODULE_MAJOR  1
+#define EVENT_MODULE_MINOR  1
+
+/* Event types whose data can be stored as a delta.  */
+#define EVENT_DELTA_TYPES   32
+
+typedef struct event_buf_s {
+    uint8_t *data;
+    size_t len;
+    size_t alloc;
+} event_buf_t;
+
+static void event_buf_put_bytes(event_buf_t *buf, const uint8_t *src, size_t n)
 {
-    snapshot_module_t *m;
-    uint8_t major_version, minor_version;
-    event_list_t *curr;
-    unsigned int num_of_timestamps;
+    if (buf->len + n > buf->alloc) {
+        while (buf->len + n > buf->alloc) {
+            buf->alloc *= 2;
+        }
+        buf->data = lib_realloc(buf->data, buf->alloc);
+    }
+    memcpy(buf->data + buf->len, src, n);
+    buf->len += n;
+}
 
-    if (event_mode == 0) {
-        return 0;
+static void event_buf_put_varint(event_buf_t *buf, uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t n = 0;
+
+    do {
+        bytes[n] = (uint8_t)(value & 0x7f);
+        value >>= 7;
+        if (value != 0) {
+            bytes[n] |= 0x80;
+        }
+        n++;
+    } while (value != 0);
+
+    event_buf_put_bytes(buf, bytes, n);
+}
+
+static int event_get_varint(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    int shift = 0;
+
+    *value = 0;
+    while (*p < end && shift < 64) {
+        uint8_t byte = *(*p)++;
+
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return 0;
+        }
+        shift += 7;
     }
+    return -1;
+}
 
-    m = snapshot_module_open(s, "EVENT", &major_version, &minor_version);
+/* Append the runs of `data' differing from `prev' to `buf', returns the
+   number of bytes appended.  */
+static size_t event_put_delta(event_buf_t *buf, const uint8_t *data,
+                              const uint8_t *prev, unsigned int size)
+{
+    size_t start_len = buf->len;
+    unsigned int pos = 0, equal, differ, i;
+    uint8_t xor_byte;
+
+    while (pos < size) {
+        equal = 0;
+        while (pos + equal < size && data[pos + equal] == prev[pos + equal]) {
+            equal++;
+        }
+        differ = 0;
+        while (pos + equal + differ < size
+               && (data[pos + equal + differ] != prev[pos + equal + differ]
+                   || (pos + equal + differ + 1 < size
+                       && data[pos + equal + differ + 1] != prev[pos + equal + differ + 1]))) {
+            differ++;
+        }
+        event_buf_put_varint(buf, equal);
+        event_buf_put_varint(buf, differ);
+        for (i = pos + equal; i < pos + equal + differ; i++) {
+            xor_byte = data[i] ^ prev[i];
+            event_buf_put_bytes(buf, &xor_byte, 1);
+        }
+        pos += equal + differ;
+    }
 
-    /* This module is not mandatory.  */
-    if (m == NULL) {
-        return 0;
+    return buf->len - start_len;
+}
+
+static int event_get_delta(const uint8_t **p, const uint8_t *end, uint8_t *data,
+                           const uint8_t *prev, unsigned int size)
+{
+    uint64_t equal, differ;
+    unsigned int pos = 0, i;
+
+    memcpy(data, prev, size);
+    while (pos < size) {
+        if (event_get_varint(p, end, &equal) < 0
+            || event_get_varint(p, end, &differ) < 0
+            || equal + differ > size - pos
+            || differ > (uint64_t)(end - *p)) {
+            return -1;
+        }
+        pos += (unsigned int)equal;
+        for (i = 0; i < differ; i++) {
+            data[pos++] ^= *(*p)++;
+        }
     }
+    return 0;
+}
 
-    destroy_list();
-    create_list();
+/* Append an event read from a history to the list at `*curr', with the
+   timestamps of each second before it.  Returns 1 at the end of the list.  */
+static int event_read_append(event_list_t **curr, unsigned int type, CLOCK clk,
+                             unsigned int size, uint8_t *data,
+                             unsigned int *num_of_timestamps)
+{
+    event_list_t *c = *curr;
 
-    curr = event_list->base;
-    num_of_timestamps = 0;
-    playback_time = 0;
-    next_timestamp_clk = CLOCK_MAX;
+    if (next_timestamp_clk == CLOCK_MAX) { /* if EVENT_INITIAL is missing */
+        next_timestamp_clk = clk;
+    }
+
+    if (type == EVENT_INITIAL) {
+        if (data[0] == EVENT_START_MODE_RESET) {
+            next_timestamp_clk = 0;
+        } else {
+            next_timestamp_clk = clk;
+        }
+    } else {
+        /* insert timestamps each second */
+        while (next_timestamp_clk < clk)
+        {
+            c->type = EVENT_TIMESTAMP;
+            c->clk = next_timestamp_clk;
+            c->size = 0;
+            c->next = event_node_new();
+            c = c->next;
+            next_timestamp_clk += machine_get_cycles_per_second();
+            (*num_of_timestamps)++;
+        }
+    }
 
+    c->type = type;
+    c->clk = clk;
+    c->size = size;
+    c->data = (size > 0 ? data : NULL);
+
+    if (type == EVENT_LIST_END) {
+        *curr = c;
+        return 1;
+    }
+
+    if (type == EVENT_RESETCPU) {
+        next_timestamp_clk -= clk;
+    }
+
+    c->next = event_node_new();
+    *curr = c->next;
+    return 0;
+}
+
+/* Read the events of a version 0.x EVENT module.  */
+static int event_read_events_v0(snapshot_module_t *m, event_list_t *curr,
+                                unsigned int *num_of_timestamps)
+{
     while (1) {
         unsigned int type, size;
         CLOCK clk;
@@ -1062,114 +1732,297 @@ int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
         */
         do {
             if (SMR_DW_UINT(m, &(type)) < 0) {
-                snapshot_module_close(m);
                 return -1;
             }
 
             if (SMR_CLOCK(m, &(clk)) < 0) {
-                snapshot_module_close(m);
                 return -1;
             }
 
             if (SMR_DW_UINT(m, &(size)) < 0) {
-                snapshot_module_close(m);
                 return -1;
             }
         } while (type == EVENT_TIMESTAMP);
 
         if (size > 0) {
-            data = lib_malloc(size);
+            data = event_data_new(size);
             if (SMR_BA(m, data, size) < 0) {
-                snapshot_module_close(m);
+                event_data_free(data, size);
                 return -1;
             }
         }
 
-        if (next_timestamp_clk == CLOCK_MAX) { /* if EVENT_INITIAL is missing */
-            next_timestamp_clk = clk;
+        if (event_read_append(&curr, type, clk, size, data, num_of_timestamps)) {
+            return 0;
         }
+    }
+}
 
-        if (type == EVENT_INITIAL) {
-            if (data[0] == EVENT_START_MODE_RESET) {
-                next_timestamp_clk = 0;
-            } else {
-                next_timestamp_clk = clk;
+/* Read the compact events of a version 1.x EVENT module.  */
+static int event_read_events(snapshot_module_t *m, event_list_t *curr,
+                             unsigned int *num_of_timestamps)
+{
+    const uint8_t *last_data[EVENT_DELTA_TYPES];
+    unsigned int last_size[EVENT_DELTA_TYPES];
+    const uint8_t *p, *end;
+    uint8_t *buf;
+    uint32_t len;
+    uint64_t head, delta, size;
+    unsigned int type;
+    CLOCK clk = 0;
+    uint8_t *data;
+    int ret = -1;
+
+    if (SMR_DW(m, &len) < 0 || len == 0) {
+        return -1;
+    }
+    buf = lib_malloc(len);
+    if (SMR_BA(m, buf, len) < 0) {
+        lib_free(buf);
+        return -1;
+    }
+
+    memset(last_data, 0, sizeof(last_data));
+    memset(last_size, 0, sizeof(last_size));
+    p = buf;
+    end = buf + len;
+
+    while (1) {
+        if (event_get_varint(&p, end, &head) < 0
+            || event_get_varint(&p, end, &delta) < 0
+            || event_get_varint(&p, end, &size) < 0
+            || size > len) {
+            break;
+        }
+        type = (unsigned int)(head >> 1);
+        clk += (CLOCK)((delta >> 1) ^ (~(delta & 1) + 1));
+
+        data = size > 0 ? event_data_new((size_t)size) : NULL;
+        if (head & 1) {
+            if (type >= EVENT_DELTA_TYPES || last_data[type] == NULL
+                || last_size[type] != size
+                || event_get_delta(&p, end, data, last_data[type], (unsigned int)size) < 0) {
+                event_data_free(data, (size_t)size);
+                break;
             }
-        } else {
-            /* insert timestamps each second */
-            while (next_timestamp_clk < clk)
-            {
-                curr->type = EVENT_TIMESTAMP;
-                curr->clk = next_timestamp_clk;
-                curr->size = 0;
-                curr->next = lib_calloc(1, sizeof(event_list_t));
-                curr = curr->next;
-                next_timestamp_clk += machine_get_cycles_per_second();
-                num_of_timestamps++;
+        } else if (size > 0) {
+            if (size > (uint64_t)(end - p)) {
+                event_data_free(data, (size_t)size);
+                break;
             }
+            memcpy(data, p, (size_t)size);
+            p += size;
         }
 
-        curr->type = type;
-        curr->clk = clk;
-        curr->size = size;
-        curr->data = (size > 0 ? data : NULL);
+        if (type < EVENT_DELTA_TYPES && size > 0) {
+            last_data[type] = data;
+            last_size[type] = (unsigned int)size;
+        }
 
-        if (type == EVENT_LIST_END) {
+        if (event_read_append(&curr, type, clk, (unsigned int)size, data, num_of_timestamps)) {
+            ret = 0;
             break;
         }
+    }
+
+    lib_free(buf);
+    return ret;
+}
+
+static int event_read_keyframes(snapshot_t *s)
+{
+    snapshot_module_t *m;
+    uint8_t major_version, minor_version;
+    unsigned int count, i, timestamp, size;
+    uint8_t *data;
+
+    m = snapshot_module_open(s, "EVENTKEYFRAMES", &major_version, &minor_version);
+
+    /* This module is not mandatory.  */
+    if (m == NULL) {
+        return 0;
+    }
+
+    if (SMR_DW_UINT(m, &count) < 0) {
+        snapshot_module_close(m);
+        return -1;
+    }
 
-        if (type == EVENT_RESETCPU) {
-            next_timestamp_clk -= clk;
+    for (i = 0; i < count; i++) {
+        if (SMR_DW_UINT(m, &timestamp) < 0
+            || SMR_DW_UINT(m, &size) < 0) {
+            snapshot_module_close(m);
+            return -1;
         }
+        data = lib_malloc(size);
+        if (SMR_BA(m, data, size) < 0) {
+            lib_free(data);
+            snapshot_module_close(m);
+            return -1;
+        }
+        keyframe_append(timestamp, data, size);
+    }
 
-        curr->next = lib_calloc(1, sizeof(event_list_t));
-        curr = curr->next;
+    snapshot_module_close(m);
+
+    return 0;
+}
+
+int event_snapshot_read_module(struct snapshot_s *s, int event_mode)
+{
+    snapshot_module_t *m;
+    uint8_t major_version, minor_version;
+    unsigned int num_of_timestamps;
+    int ret;
+
+    if (event_mode == 0) {
+        return 0;
+    }
+
+    m = snapshot_module_open(s, "EVENT", &major_version, &minor_version);
+
+    /* This module is not mandatory.  */
+    if (m == NULL) {
+        return 0;
+    }
+
+    destroy_list();
+    create_list();
+
+    num_of_timestamps = 0;
+    playback_time = 0;
+    next_timestamp_clk = CLOCK_MAX;
+
+    if (major_version >= 1) {
+        ret = event_read_events(m, event_list->base, &num_of_timestamps);
+    } else {
+        ret = event_read_events_v0(m, event_list->base, &num_of_timestamps);
+    }
+
+    snapshot_module_close(m);
+
+    if (ret < 0) {
+        return -1;
     }
 
     if (num_of_timestamps > 0) {
         playback_time = num_of_timestamps - 1;
     }
 
-    snapshot_module_close(m);
+    return event_read_keyframes(s);
+}
 
-    return 0;
+static int event_write_keyframes(snapshot_t *s)
+{
+    snapshot_module_t *m;
+    unsigned int i;
+
+    if (keyframe_count == 0) {
+        return 0;
+    }
+
+    m = snapshot_module_create(s, "EVENTKEYFRAMES", 0, 0);
+
+    if (m == NULL) {
+        return -1;
+    }
+
+    if (SMW_DW(m, (uint32_t)keyframe_count) < 0) {
+        snapshot_module_close(m);
+        return -1;
+    }
+
+    for (i = 0; i < keyframe_count; i++) {
+        if (0
+            || SMW_DW(m, (uint32_t)keyframes[i].timestamp) < 0
+            || SMW_DW(m, (uint32_t)keyframes[i].size) < 0
+            || SMW_BA(m, keyframes[i].data, (unsigned int)keyframes[i].size) < 0) {
+            snapshot_module_close(m);
+            return -1;
+        }
+    }
+
+    return snapshot_module_close(m);
 }
 
 int event_snapshot_write_module(struct snapshot_s *s, int event_mode)
 {
     snapshot_module_t *m;
     event_list_t *curr;
+    event_buf_t buf;
+    const uint8_t *last_data[EVENT_DELTA_TYPES];
+    unsigned int last_size[EVENT_DELTA_TYPES];
+    CLOCK prev_clk = 0;
+    int64_t delta;
+    size_t head_pos, delta_len;
+    int ret;
 
     if (event_mode == 0) {
         return 0;
     }
 
-    m = snapshot_module_create(s, "EVENT", 0, 1);
+    m = snapshot_module_create(s, "EVENT", EVENT_MODULE_MAJOR, EVENT_MODULE_MINOR);
 
     if (m == NULL) {
         return -1;
     }
 
-    curr = event_list->base;
+    buf.alloc = 1024;
+    buf.len = 0;
+    buf.data = lib_malloc(buf.alloc);
+    memset(last_data, 0, sizeof(last_data));
+    memset(last_size, 0, sizeof(last_size));
 
-    while (curr != NULL) {
-        if (curr->type != EVENT_TIMESTAMP
-            && (0
-                || SMW_DW(m, (uint32_t)curr->type) < 0
-                || SMW_CLOCK(m, curr->clk) < 0
-                || SMW_DW(m, (uint32_t)curr->size) < 0
-                || SMW_BA(m, curr->data, curr->size) < 0)) {
-            snapshot_module_close(m);
-            return -1;
+    for (curr = event_list->base; curr != NULL; curr = curr->next) {
+        if (curr->type == EVENT_TIMESTAMP) {
+            continue;
         }
-        curr = curr->next;
+
+        head_pos = buf.len;
+        event_buf_put_varint(&buf, (uint64_t)curr->type << 1);
+        delta = (int64_t)(curr->clk - prev_clk);
+        event_buf_put_varint(&buf, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+        event_buf_put_varint(&buf, curr->size);
+        prev_clk = curr->clk;
+
+        if (curr->size == 0) {
+            continue;
+        }
+
+        if (curr->type < EVENT_DELTA_TYPES
+            && last_data[curr->type] != NULL
+            && last_size[curr->type] == curr->size) {
+            size_t data_pos = buf.len;
+
+            delta_len = event_put_delta(&buf, curr->data, last_data[curr->type], curr->size);
+            if (delta_len < curr->size) {
+                buf.data[head_pos] |= 1;
+            } else {
+                buf.len = data_pos;
+                event_buf_put_bytes(&buf, curr->data, curr->size);
+            }
+        } else {
+            event_buf_put_bytes(&buf, curr->data, curr->size);
+        }
+
+        if (curr->type < EVENT_DELTA_TYPES) {
+            last_data[curr->type] = curr->data;
+            last_size[curr->type] = curr->size;
+        }
+    }
+
+    ret = 0;
+    if (SMW_DW(m, (uint32_t)buf.len) < 0
+        || SMW_BA(m, buf.data, (unsigned int)buf.len) < 0) {
+        ret = -1;
     }
+    lib_free(buf.data);
 
-    if (snapshot_module_close(m) < 0) {
+    if (snapshot_module_close(m) < 0 || ret < 0) {
         return -1;
     }
 
-    return 0;
+    return event_write_keyframes(s);
 }
 
 /*-----------------------------------------------------------------------*/
@@ -1231,6 +2084,17 @@ static int set_event_image_include(int enable, void *param)
     return 0;
 }
 
+static int set_event_keyframe_interval(int val, void *param)
+{
+    if (val < 0 || val > 3600) {
+        return -1;
+    }
+
+    event_keyframe_interval = val;
+
+    return 0;
+}
+
 static const resource_string_t resources_string[] = {
     { "EventSnapshotDir",
       ARCHDEP_FSDEVICE_DEFAULT_DIR ARCHDEP_DIR_SEP_STR, RES_EVENT_NO, NULL,
@@ -1247,6 +2111,8 @@ static const resource_int_t resources_int[] = {
       &event_start_mode, set_event_start_mode, NULL },
     { "EventImageInclude", 1, RES_EVENT_NO, NULL,
       &event_image_include, set_event_image_include, NULL },
+    { "EventKeyframeInterval", 30, RES_EVENT_NO, NULL,
+      &event_keyframe_interval, set_event_keyframe_interval, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -1267,6 +2133,10 @@ void event_shutdown(void)
     lib_free(event_snapshot_path_str);
     event_snapshot_path_str = NULL;
     destroy_list();
+    event_pools_free();
+    lib_free(keyframes);
+    keyframes = NULL;
+    keyframe_alloc = 0;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -1299,6 +2169,9 @@ static const cmdline_option_t cmdline_options[] =
     { "+eventimageinc", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "EventImageInclude", (resource_value_t)0,
       NULL, "Disable including disk images" },
+    { "-eventkeyframes", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "EventKeyframeInterval", NULL,
+      "<seconds>", "Save a keyframe for seeking the playback every <seconds> seconds of a recording (0: none)" },
     CMDLINE_LIST_END
 };
 
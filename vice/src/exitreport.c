@@ -0,0 +1,244 @@
+/*
+ * exitreport.c - Report cycle, frame and alarm counts at exit.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+/* With -exitreport <file> a JSON object is written to <file> (or to stdout
+   if <file> is `-') when the emulator exits, e.g. after a test program
+   wrote its result to the debug cartridge, or the -limitcycles limit was
+   reached:
+
+       {
+         "machine": "C64",
+         "exit_code": 0,
+         "cycles": 2584391,
+         "host_seconds": 0.412,
+         "frames_emulated": 131,
+         "frames_rendered": 12,
+         "alarm_dispatches": 48213,
+         "alarm_contexts": [
+           {
+             "name": "MainCPU",
+             "dispatches": 47112,
+             "alarms": [
+               { "name": "VicIIRaster", "dispatches": 40961 },
+               ...
+             ]
+           },
+           ...
+         ]
+       }
+
+   `cycles' is the main CPU clock, `host_seconds' the time since the first
+   reset.  The contexts are the main CPU and the enabled drives; alarms that
+   never fired are left out.  Everything but `host_seconds' only depends on
+   the emulation, so a test corpus can be checked for both results and
+   performance from the same run.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "archdep.h"
+#include "cmdline.h"
+#include "drive.h"
+#include "drivetypes.h"
+#include "exitreport.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "types.h"
+#include "util.h"
+#include "vsync.h"
+
+static char *report_filename = NULL;
+static int report_exit_code = 0;
+static tick_t report_start_tick;
+static int report_started = 0;
+
+/* ------------------------------------------------------------------------- */
+
+void exitreport_start(void)
+{
+    if (!report_started) {
+        report_start_tick = tick_now();
+        report_started = 1;
+    }
+}
+
+void exitreport_set_exit_code(int exit_code)
+{
+    report_exit_code = exit_code;
+}
+
+static void exitreport_print_string(FILE *fp, const char *s)
+{
+    fputc('"', fp);
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+
+        if (c == '"' || c == '\\') {
+            fprintf(fp, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(fp, "\\u%04x", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static unsigned long exitreport_context_dispatches(alarm_context_t *context)
+{
+    alarm_t *alarm;
+    unsigned long dispatches = 0;
+
+    for (alarm = context->alarms; alarm != NULL; alarm = alarm->next) {
+        dispatches += alarm->dispatched;
+    }
+    return dispatches;
+}
+
+static void exitreport_print_context(FILE *fp, alarm_context_t *context, int first)
+{
+    alarm_t *alarm;
+    int first_alarm = 1;
+
+    fprintf(fp, "%s\n    {\n      \"name\": ", first ? "" : ",");
+    exitreport_print_string(fp, context->name);
+    fprintf(fp, ",\n      \"dispatches\": %lu,\n      \"alarms\": [",
+            exitreport_context_dispatches(context));
+
+    for (alarm = context->alarms; alarm != NULL; alarm = alarm->next) {
+        if (alarm->dispatched == 0) {
+            continue;
+        }
+        fprintf(fp, "%s\n        { \"name\": ", first_alarm ? "" : ",");
+        exitreport_print_string(fp, alarm->name);
+        fprintf(fp, ", \"dispatches\": %lu }", alarm->dispatched);
+        first_alarm = 0;
+    }
+    fprintf(fp, "%s]\n    }", first_alarm ? "" : "\n      ");
+}
+
+/* the alarm contexts to report: the main CPU and the enabled drives */
+static int exitreport_get_contexts(alarm_context_t **contexts)
+{
+    int num = 0;
+    int dnr;
+
+    contexts[num++] = maincpu_alarm_context;
+
+    for (dnr = 0; dnr < NUM_DISK_UNITS; dnr++) {
+        diskunit_context_t *unit = diskunit_context[dnr];
+
+        if (unit != NULL && unit->enable && unit->cpu != NULL
+            && unit->cpu->alarm_context != NULL) {
+            contexts[num++] = unit->cpu->alarm_context;
+        }
+    }
+    return num;
+}
+
+void exitreport_write(void)
+{
+    FILE *fp;
+    alarm_context_t *contexts[1 + NUM_DISK_UNITS];
+    unsigned long frames_emulated;
+    unsigned long frames_rendered;
+    unsigned long dispatches = 0;
+    double seconds = 0.0;
+    int num;
+    int i;
+
+    if (report_filename == NULL) {
+        return;
+    }
+
+    if (strcmp(report_filename, "-") == 0) {
+        fp = stdout;
+    } else {
+        fp = fopen(report_filename, MODE_WRITE_TEXT);
+        if (fp == NULL) {
+            log_error(LOG_DEFAULT, "Cannot write exit report `%s'.", report_filename);
+            return;
+        }
+    }
+
+    if (report_started) {
+        seconds = (double)tick_now_delta(report_start_tick) / tick_per_second();
+    }
+    vsync_get_frame_counts(&frames_emulated, &frames_rendered);
+
+    num = exitreport_get_contexts(contexts);
+    for (i = 0; i < num; i++) {
+        dispatches += exitreport_context_dispatches(contexts[i]);
+    }
+
+    fprintf(fp, "{\n  \"machine\": ");
+    exitreport_print_string(fp, machine_name);
+    fprintf(fp, ",\n  \"exit_code\": %d,\n", report_exit_code);
+    fprintf(fp, "  \"cycles\": %"PRIu64",\n", (uint64_t)maincpu_clk);
+    fprintf(fp, "  \"host_seconds\": %.3f,\n", seconds);
+    fprintf(fp, "  \"frames_emulated\": %lu,\n", frames_emulated);
+    fprintf(fp, "  \"frames_rendered\": %lu,\n", frames_rendered);
+    fprintf(fp, "  \"alarm_dispatches\": %lu,\n", dispatches);
+    fprintf(fp, "  \"alarm_contexts\": [");
+    for (i = 0; i < num; i++) {
+        exitreport_print_context(fp, contexts[i], i == 0);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+
+    if (fp == stdout) {
+        fflush(stdout);
+    } else {
+        fclose(fp);
+    }
+}
+
+void exitreport_shutdown(void)
+{
+    lib_free(report_filename);
+    report_filename = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_exitreport(const char *param, void *extra_param)
+{
+    util_string_set(&report_filename, param);
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-exitreport", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_exitreport, NULL, NULL, NULL,
+      "<filename>", "Write the exit code, cycle, frame and alarm counts as JSON to <filename> (`-' for stdout) at exit" },
+    CMDLINE_LIST_END
+};
+
+int exitreport_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
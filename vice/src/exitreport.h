@@ -0,0 +1,41 @@
+/*
+ * exitreport.h - Report cycle, frame and alarm counts at exit.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_EXITREPORT_H
+#define VICE_EXITREPORT_H
+
+int exitreport_cmdline_options_init(void);
+void exitreport_shutdown(void);
+
+/* Start the host timer.  Called once the machine has been reset for the
+   first time.  */
+void exitreport_start(void);
+
+/* Called by archdep_vice_exit() with the exit code the report shows.  */
+void exitreport_set_exit_code(int exit_code);
+
+/* Write the report, if one was requested with -exitreport.  Called by
+   machine_shutdown() while the machine still exists.  */
+void exitreport_write(void);
+
+#endif
@@ -67,6 +67,7 @@ enum flash040_state_s {
 typedef enum flash040_state_s flash040_state_t;
 
 #define FLASH040_ERASE_MASK_SIZE 8
+#define FLASH040_DIRTY_MASK_SIZE 16
 
 typedef struct flash040_context_s {
     uint8_t *flash_data;
@@ -81,6 +82,15 @@ typedef struct flash040_context_s {
 
     uint8_t last_read;
     struct alarm_s *erase_alarm;
+
+    /* sectors changed since flash040core_clear_dirty() */
+    uint8_t dirty_mask[FLASH040_DIRTY_MASK_SIZE];
+
+    /* called `flush_delay' cycles after the first change, if set */
+    struct alarm_s *flush_alarm;
+    CLOCK flush_delay;
+    int flush_pending;
+    void (*flush)(struct flash040_context_s *flash040_context);
 } flash040_context_t;
 
 struct alarm_context_s;
@@ -98,6 +108,18 @@ uint8_t flash040core_read(struct flash040_context_s *flash040_context,
 uint8_t flash040core_peek(struct flash040_context_s *flash040_context,
                           unsigned int addr);
 
+/* Whether a sector holding a byte of addr..addr+len-1 was changed.  */
+int flash040core_is_dirty(struct flash040_context_s *flash040_context,
+                          unsigned int addr, unsigned int len);
+void flash040core_set_dirty(struct flash040_context_s *flash040_context);
+void flash040core_clear_dirty(struct flash040_context_s *flash040_context);
+
+/* Have `flush' called `delay' cycles after the first change of the
+   contents, once no operation is in progress.  0 turns it off.  */
+void flash040core_set_flush(struct flash040_context_s *flash040_context,
+                            void (*flush)(struct flash040_context_s *flash040_context),
+                            CLOCK delay);
+
 struct snapshot_s;
 
 int flash040core_snapshot_write_module(struct snapshot_s *s,
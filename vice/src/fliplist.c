@@ -46,6 +46,7 @@
 #include "log.h"
 #include "resources.h"
 #include "util.h"
+#include "zfile.h"
 
 #ifdef DEBUG_FLIPLIST
 #define DBG(x)  log_debug   x
@@ -75,6 +76,7 @@ static const char flip_file_petscii[9] = { 0x23, 0x50, 0x45, 0x54, 0x53, 0x43, 0
 #define buffer_size 1024
 
 static void show_fliplist(unsigned int unit);
+static void prefetch_neighbours(unsigned int unit);
 
 static char *fliplist_file_name = NULL;
 
@@ -217,6 +219,7 @@ bool fliplist_add_image(unsigned int unit)
         n->prev = n;
     }
     show_fliplist(unit);
+    prefetch_neighbours(unit);
     return true;
 }
 
@@ -304,6 +307,7 @@ bool fliplist_attach_head(unsigned int unit, int direction)
         /* shouldn't happen, so ignore it */
         return false;   /* handle it anyway */
     }
+    prefetch_neighbours(unit);
     return true;
 }
 
@@ -641,6 +645,8 @@ int fliplist_load_list(unsigned int unit, const char *filename, int autoattach)
 
         if (autoattach) {
             fliplist_attach_head(unit, 1);
+        } else {
+            prefetch_neighbours(unit);
         }
 
         return 0;
@@ -651,6 +657,23 @@ int fliplist_load_list(unsigned int unit, const char *filename, int autoattach)
 
 /* ------------------------------------------------------------------------- */
 
+/* Read the images a flip would attach next ahead, so that flipping does not
+   wait for them to be read and uncompressed.  */
+static void prefetch_neighbours(unsigned int unit)
+{
+    fliplist_t head = fliplist[unit - 8];
+
+    if (head == NULL) {
+        return;
+    }
+    if (head->next != head) {
+        zfile_prefetch(head->next->image);
+    }
+    if (head->prev != head && head->prev != head->next) {
+        zfile_prefetch(head->prev->image);
+    }
+}
+
 static void show_fliplist(unsigned int unit)
 {
     fliplist_t it = fliplist[unit - 8];
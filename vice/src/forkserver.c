@@ -0,0 +1,353 @@
+/*
+ * forkserver.c - Run many test cases from one common starting point.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With -forkserver <file> in the headless front end, the emulator runs the
+   common part of a set of tests once: booting, loading the program and
+   getting to its menu, until the program writes the marker value
+   (-forkservermarker) to the debug cartridge.  From there every line of
+   <file> is a test case: it is typed in through the keyboard buffer, with
+   the escapes of -keybuf, and the case ends when the program writes its
+   result to the debug cartridge.
+
+   On Unix the emulator forks a child for each case, which starts from a
+   copy-on-write image of the machine at the marker and exits with the
+   result, while the parent reads the next line.  Elsewhere the machine
+   state at the marker is kept as an in-memory snapshot and restored
+   before each case; attached disk images are not part of it.
+
+   The lines are read with read() rather than stdio, so a child never
+   disturbs the parent's position in the file.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+
+#ifdef UNIX_COMPILE
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#ifdef WINDOWS_COMPILE
+#include <io.h>
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "forkserver.h"
+#include "interrupt.h"
+#include "kbdbuf.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "maincpu.h"
+#include "snapshot.h"
+#include "types.h"
+#include "util.h"
+
+static char *control_name = NULL;
+static int control_fd = -1;
+static int marker = 0xfe;
+
+/* Bytes read from the control file but not yet returned as a line.  */
+static char *pending = NULL;
+static size_t pending_len = 0;
+static size_t pending_size = 0;
+
+static int marker_reached = 0;
+static int case_num = 0;
+static int cases_failed = 0;
+
+#ifndef UNIX_COMPILE
+static snapshot_t *prefix_state = NULL;
+static int case_running = 0;
+#endif
+
+static log_t forkserver_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+/* Return the next line of the control file without its line end, or NULL
+   at the end of the file.  */
+static char *forkserver_read_case(void)
+{
+    while (1) {
+        char *nl = pending_len > 0 ? memchr(pending, '\n', pending_len) : NULL;
+        char *line;
+        size_t len;
+        int got;
+
+        if (nl != NULL || (pending_len > 0 && control_fd < 0)) {
+            len = nl != NULL ? (size_t)(nl - pending) : pending_len;
+            line = lib_malloc(len + 1);
+            memcpy(line, pending, len);
+            line[len] = '\0';
+            if (len > 0 && line[len - 1] == '\r') {
+                line[len - 1] = '\0';
+            }
+            if (nl != NULL) {
+                len++;
+            }
+            pending_len -= len;
+            memmove(pending, pending + len, pending_len);
+            return line;
+        }
+        if (control_fd < 0) {
+            return NULL;
+        }
+
+        if (pending_size - pending_len < 4096) {
+            pending_size = pending_size * 2 + 4096;
+            pending = lib_realloc(pending, pending_size);
+        }
+        got = (int)read(control_fd, pending + pending_len, 4096);
+        if (got <= 0) {
+            if (control_fd != 0) {
+                close(control_fd);
+            }
+            control_fd = -1;
+        } else {
+            pending_len += (size_t)got;
+        }
+    }
+}
+
+static void forkserver_report(int status)
+{
+    fprintf(stdout, "FORKSERVER: case %d: exit %d\n", case_num, status);
+    fflush(stdout);
+    if (status != 0) {
+        cases_failed++;
+    }
+}
+
+static void forkserver_finish(void)
+{
+    fprintf(stdout, "FORKSERVER: %d cases, %d failed\n", case_num, cases_failed);
+    fflush(stdout);
+    archdep_vice_exit(cases_failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static void forkserver_start_case(const char *line)
+{
+    kbdbuf_abort();
+    if (*line != '\0' && kbdbuf_feed_string(line) < 0) {
+        log_error(forkserver_log, "Case %d does not fit the keyboard buffer.", case_num);
+    }
+}
+
+#ifdef UNIX_COMPILE
+
+/* Fork a child per case and wait for it.  Only the children return.  */
+static void forkserver_serve(void)
+{
+    char *line;
+
+    while ((line = forkserver_read_case()) != NULL) {
+        pid_t child;
+        int status;
+
+        case_num++;
+
+        /* Do not let the children inherit unwritten output.  */
+        fflush(NULL);
+
+        child = fork();
+        if (child < 0) {
+            log_error(forkserver_log, "Cannot fork case %d.", case_num);
+            lib_free(line);
+            cases_failed++;
+            break;
+        }
+        if (child == 0) {
+            if (control_fd > 0) {
+                close(control_fd);
+            }
+            control_fd = -1;
+            forkserver_start_case(line);
+            lib_free(line);
+            return;
+        }
+        lib_free(line);
+
+        if (waitpid(child, &status, 0) < 0) {
+            forkserver_report(-1);
+        } else if (WIFEXITED(status)) {
+            forkserver_report(WEXITSTATUS(status));
+        } else {
+            forkserver_report(128 + WTERMSIG(status));
+        }
+    }
+    forkserver_finish();
+}
+
+#else
+
+static void forkserver_next_case(void)
+{
+    char *line = forkserver_read_case();
+
+    if (line == NULL) {
+        forkserver_finish();
+        return;
+    }
+    case_num++;
+    forkserver_start_case(line);
+    lib_free(line);
+    case_running = 1;
+}
+
+static void forkserver_restore_trap(uint16_t addr, void *data)
+{
+    const uint8_t *state;
+    size_t size;
+
+    state = snapshot_mem_get_data(prefix_state, &size);
+    if (machine_read_snapshot_mem(state, size, 0) < 0) {
+        log_error(forkserver_log, "Cannot restore the state at the marker.");
+        archdep_vice_exit(EXIT_FAILURE);
+        return;
+    }
+    forkserver_next_case();
+}
+
+#endif
+
+static void forkserver_marker_trap(uint16_t addr, void *data)
+{
+    forkserver_log = log_open("ForkServer");
+    log_message(forkserver_log, "Reached the marker at cycle %"PRIu64".",
+                (uint64_t)maincpu_clk);
+
+#ifdef UNIX_COMPILE
+    forkserver_serve();
+#else
+    prefix_state = machine_write_snapshot_mem(0, 0, 0);
+    if (prefix_state == NULL) {
+        log_error(forkserver_log, "Cannot save the state at the marker.");
+        archdep_vice_exit(EXIT_FAILURE);
+        return;
+    }
+    forkserver_next_case();
+#endif
+}
+
+int forkserver_debugcart_write(uint8_t value)
+{
+    if (control_name == NULL) {
+        return 0;
+    }
+
+    if (!marker_reached) {
+        if (value != marker) {
+            return 0;
+        }
+        marker_reached = 1;
+        interrupt_maincpu_trigger_trap(forkserver_marker_trap, NULL);
+        return 1;
+    }
+    if (value == marker) {
+        return 1;
+    }
+#ifndef UNIX_COMPILE
+    if (case_running) {
+        case_running = 0;
+        forkserver_report(value);
+        interrupt_maincpu_trigger_trap(forkserver_restore_trap, NULL);
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+void forkserver_shutdown(void)
+{
+    if (control_fd > 0) {
+        close(control_fd);
+    }
+    control_fd = -1;
+    lib_free(control_name);
+    control_name = NULL;
+    lib_free(pending);
+    pending = NULL;
+    pending_len = 0;
+    pending_size = 0;
+#ifndef UNIX_COMPILE
+    if (prefix_state != NULL) {
+        snapshot_close(prefix_state);
+        prefix_state = NULL;
+    }
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_forkserver(const char *param, void *extra_param)
+{
+    int fd;
+
+    if (strcmp(param, "-") == 0) {
+        fd = 0;
+    } else {
+        fd = open(param, O_RDONLY);
+        if (fd < 0) {
+            return -1;
+        }
+    }
+    if (control_fd > 0) {
+        close(control_fd);
+    }
+    control_fd = fd;
+    util_string_set(&control_name, param);
+    return 0;
+}
+
+static int cmdline_forkservermarker(const char *param, void *extra_param)
+{
+    char *end;
+    long value = strtol(param, &end, 0);
+
+    if (*end != '\0' || value < 0 || value > 255) {
+        return -1;
+    }
+    marker = (int)value;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-forkserver", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_forkserver, NULL, NULL, NULL,
+      "<file>", "Once the marker is written to the debug cartridge, run each line of <file> (- for stdin) as a test case typed in from there" },
+    { "-forkservermarker", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_forkservermarker, NULL, NULL, NULL,
+      "<value>", "Value written to the debug cartridge where the test cases start (default 254)" },
+    CMDLINE_LIST_END
+};
+
+int forkserver_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
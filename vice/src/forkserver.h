@@ -0,0 +1,39 @@
+/*
+ * forkserver.h - Run many test cases from one common starting point.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_FORKSERVER_H
+#define VICE_FORKSERVER_H
+
+#include "types.h"
+
+/* Called by the debug cartridges for every value written.  Returns 1 if
+   the fork server took the write (the marker, or the end of a test case
+   when cases are run one after the other), 0 if the emulator should exit
+   with `value' as usual.  */
+int forkserver_debugcart_write(uint8_t value);
+
+/* The options are only offered by the headless front end.  */
+int forkserver_cmdline_options_init(void);
+void forkserver_shutdown(void);
+
+#endif
@@ -0,0 +1,558 @@
+/*
+ * framestats.c - Distribution of the host time per emulated frame.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The host time from one emulated frame to the next goes into a histogram
+   of 0.1 ms buckets, so the monitor command `framestats' and -perfreport
+   can show the median, the 95th and 99th percentile and the longest
+   frame.  The averages of the speed display hide the single late frames
+   that make the sound drop out and the picture stutter.
+
+   With `PerfCounters' enabled on Linux the hardware counters for
+   instructions, cache misses and branch misses of the emulation thread
+   are read once per frame as well, for the average and the highest count
+   per frame.
+
+   With the UI on a thread of its own, the contention statistics of the
+   mainlock are shown as well: how long the UI thread waited for it and
+   how long it kept the emulation stopped while holding it.
+
+   Configured with --enable-alloc-stats, the call sites allocating the most
+   since the first frame (or the last reset) are listed too, so
+   allocations in the steady state of the emulation can be found.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "framestats.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "mainlock.h"
+#include "monitor.h"
+#include "resources.h"
+#include "types.h"
+#include "util.h"
+
+#define FRAMESTATS_BUCKET_NS    100000
+#define FRAMESTATS_ALLOC_SITES  10
+#define FRAMESTATS_BUCKETS      2500    /* up to 250 ms, longer frames only
+                                           count for the maximum */
+
+typedef enum framestats_counter_e {
+    FRAMESTATS_INSTRUCTIONS,
+    FRAMESTATS_CACHE_MISSES,
+    FRAMESTATS_BRANCH_MISSES,
+    FRAMESTATS_NUM_COUNTERS
+} framestats_counter_t;
+
+static const char * const counter_names[FRAMESTATS_NUM_COUNTERS] = {
+    "instructions", "cache_misses", "branch_misses"
+};
+
+static uint32_t histogram[FRAMESTATS_BUCKETS + 1];
+static unsigned long frames;
+static uint64_t total_ns;
+static uint64_t max_ns;
+
+/* How far from their deadlines the sleeps of the frame pacing woke up.  */
+static unsigned long sleeps;
+static uint64_t sleep_error_total_ns;   /* absolute */
+static int64_t sleep_late_total_ns;     /* signed, early is negative */
+static uint64_t sleep_late_max_ns;
+
+static int perf_counters_enabled = 0;
+static unsigned long counter_frames;
+static uint64_t counter_total[FRAMESTATS_NUM_COUNTERS];
+static uint64_t counter_max[FRAMESTATS_NUM_COUNTERS];
+
+static char *report_filename = NULL;
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+
+static int perf_fd[FRAMESTATS_NUM_COUNTERS] = { -1, -1, -1 };
+static int perf_failed = 0;
+static uint64_t perf_last[FRAMESTATS_NUM_COUNTERS];
+
+static void perf_close(void)
+{
+    int i;
+
+    for (i = 0; i < FRAMESTATS_NUM_COUNTERS; i++) {
+        if (perf_fd[i] >= 0) {
+            close(perf_fd[i]);
+            perf_fd[i] = -1;
+        }
+    }
+}
+
+/* The counters follow the calling thread, so this runs on the emulation
+   thread, from the first frame after they were enabled.  */
+static int perf_open(void)
+{
+    static const uint64_t configs[FRAMESTATS_NUM_COUNTERS] = {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    struct perf_event_attr attr;
+    int i;
+
+    for (i = 0; i < FRAMESTATS_NUM_COUNTERS; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = (i == 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        perf_fd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+                                  i == 0 ? -1 : perf_fd[0], 0);
+        if (perf_fd[i] < 0) {
+            log_warning(LOG_DEFAULT, "Cannot open the %s perf counter, see /proc/sys/kernel/perf_event_paranoid.",
+                        counter_names[i]);
+            perf_close();
+            return -1;
+        }
+    }
+
+    ioctl(perf_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    memset(perf_last, 0, sizeof(perf_last));
+    return 0;
+}
+
+/* Add the counts since the last call to the totals, one read for all.  */
+static void perf_sample(int count)
+{
+    struct {
+        uint64_t nr;
+        uint64_t values[FRAMESTATS_NUM_COUNTERS];
+    } data;
+    int i;
+
+    if (perf_fd[0] < 0) {
+        if (perf_failed || perf_open() < 0) {
+            perf_failed = 1;
+            return;
+        }
+        count = 0;
+    }
+
+    if (read(perf_fd[0], &data, sizeof(data)) != (ssize_t)sizeof(data)) {
+        return;
+    }
+
+    if (count) {
+        for (i = 0; i < FRAMESTATS_NUM_COUNTERS; i++) {
+            uint64_t delta = data.values[i] - perf_last[i];
+
+            counter_total[i] += delta;
+            if (delta > counter_max[i]) {
+                counter_max[i] = delta;
+            }
+        }
+        counter_frames++;
+    }
+    memcpy(perf_last, data.values, sizeof(perf_last));
+}
+
+#else
+
+static void perf_close(void)
+{
+}
+
+static void perf_sample(int count)
+{
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+void framestats_frame_end(uint64_t frame_ns, int resumed)
+{
+    if (perf_counters_enabled) {
+        perf_sample(!resumed);
+    }
+
+    if (resumed) {
+        return;
+    }
+
+#ifdef LIB_ALLOC_STATS
+    /* leave out the allocations made while starting up */
+    if (frames == 0) {
+        lib_alloc_stats_reset();
+    }
+#endif
+
+    if (frame_ns / FRAMESTATS_BUCKET_NS < FRAMESTATS_BUCKETS) {
+        histogram[frame_ns / FRAMESTATS_BUCKET_NS]++;
+    } else {
+        histogram[FRAMESTATS_BUCKETS]++;
+    }
+    frames++;
+    total_ns += frame_ns;
+    if (frame_ns > max_ns) {
+        max_ns = frame_ns;
+    }
+}
+
+void framestats_sleep_end(int64_t error_ns)
+{
+    sleeps++;
+    sleep_error_total_ns += error_ns < 0 ? (uint64_t)-error_ns : (uint64_t)error_ns;
+    sleep_late_total_ns += error_ns;
+    if (error_ns > 0 && (uint64_t)error_ns > sleep_late_max_ns) {
+        sleep_late_max_ns = (uint64_t)error_ns;
+    }
+}
+
+void framestats_reset(void)
+{
+    memset(histogram, 0, sizeof(histogram));
+    frames = 0;
+    total_ns = 0;
+    max_ns = 0;
+
+    sleeps = 0;
+    sleep_error_total_ns = 0;
+    sleep_late_total_ns = 0;
+    sleep_late_max_ns = 0;
+
+    counter_frames = 0;
+    memset(counter_total, 0, sizeof(counter_total));
+    memset(counter_max, 0, sizeof(counter_max));
+
+#ifdef USE_VICE_THREAD
+    mainlock_reset_stats();
+#endif
+#ifdef LIB_ALLOC_STATS
+    lib_alloc_stats_reset();
+#endif
+}
+
+/* The upper end of the bucket holding the frame below which `percent' of
+   the frames are, in milliseconds.  */
+static double framestats_percentile(double percent)
+{
+    unsigned long rank = (unsigned long)(frames * percent / 100.0);
+    unsigned long seen = 0;
+    int i;
+
+    if (frames == 0) {
+        return 0.0;
+    }
+    if (rank >= frames) {
+        rank = frames - 1;
+    }
+    for (i = 0; i < FRAMESTATS_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen > rank) {
+            return (double)(i + 1) * FRAMESTATS_BUCKET_NS / 1000000.0;
+        }
+    }
+    return (double)max_ns / 1000000.0;
+}
+
+#ifdef USE_VICE_THREAD
+static const unsigned int mainlock_limits[MAINLOCK_HISTOGRAM_BUCKETS - 1] = MAINLOCK_HISTOGRAM_LIMITS;
+
+static void mainlock_histogram_show(const char *name, const unsigned long *histogram)
+{
+    int i;
+
+    mon_out("  %s", name);
+    for (i = 0; i < MAINLOCK_HISTOGRAM_BUCKETS - 1; i++) {
+        mon_out(" <%.1fms:%lu", mainlock_limits[i] / 1000.0, histogram[i]);
+    }
+    mon_out(" longer:%lu\n", histogram[i]);
+}
+
+static void mainlock_monitor_show(void)
+{
+    mainlock_stats_t stats;
+
+    mainlock_get_stats(&stats);
+    mon_out("Mainlock: %lu UI obtains, %lu yields, %lu handed to the UI\n",
+            stats.obtains, stats.yields, stats.handoffs);
+    if (stats.obtains == 0) {
+        return;
+    }
+    mon_out("  UI wait mean %.2f ms, max %.2f ms; held mean %.2f ms, max %.2f ms\n",
+            (double)stats.wait_us_total / stats.obtains / 1000.0, stats.wait_us_max / 1000.0,
+            (double)stats.hold_us_total / stats.obtains / 1000.0, stats.hold_us_max / 1000.0);
+    mainlock_histogram_show("wait", stats.wait_histogram);
+    mainlock_histogram_show("held", stats.hold_histogram);
+}
+
+static void mainlock_report_histogram(FILE *fp, const char *name, uint64_t total,
+                                      uint64_t max, unsigned long obtains,
+                                      const unsigned long *histogram)
+{
+    int i;
+
+    fprintf(fp, "    \"%s_us\": { \"mean\": %"PRIu64", \"max\": %"PRIu64", \"histogram\": [",
+            name, obtains > 0 ? total / obtains : 0, max);
+    for (i = 0; i < MAINLOCK_HISTOGRAM_BUCKETS; i++) {
+        fprintf(fp, "%s%lu", i == 0 ? "" : ", ", histogram[i]);
+    }
+    fprintf(fp, "] }");
+}
+
+static void mainlock_report_write(FILE *fp)
+{
+    mainlock_stats_t stats;
+    int i;
+
+    mainlock_get_stats(&stats);
+    fprintf(fp, ",\n  \"mainlock\": {\n    \"obtains\": %lu, \"yields\": %lu, \"handoffs\": %lu,\n",
+            stats.obtains, stats.yields, stats.handoffs);
+    fprintf(fp, "    \"histogram_limits_us\": [");
+    for (i = 0; i < MAINLOCK_HISTOGRAM_BUCKETS - 1; i++) {
+        fprintf(fp, "%s%u", i == 0 ? "" : ", ", mainlock_limits[i]);
+    }
+    fprintf(fp, "],\n");
+    mainlock_report_histogram(fp, "wait", stats.wait_us_total, stats.wait_us_max,
+                              stats.obtains, stats.wait_histogram);
+    fprintf(fp, ",\n");
+    mainlock_report_histogram(fp, "hold", stats.hold_us_total, stats.hold_us_max,
+                              stats.obtains, stats.hold_histogram);
+    fprintf(fp, "\n  }");
+}
+#endif
+
+#ifdef LIB_ALLOC_STATS
+static void alloc_monitor_show(void)
+{
+    lib_alloc_site_t sites[FRAMESTATS_ALLOC_SITES];
+    unsigned long total;
+    double seconds = (double)total_ns / 1000000000.0;
+    int count, i;
+
+    count = lib_alloc_stats_get(sites, FRAMESTATS_ALLOC_SITES, &total);
+    if (seconds <= 0.0) {
+        mon_out("Allocations: %lu\n", total);
+        return;
+    }
+    mon_out("Allocations: %.1f per second\n", total / seconds);
+    for (i = 0; i < count; i++) {
+        mon_out("  %s:%u %.1f per second, %.0f bytes per second\n",
+                sites[i].name, sites[i].line, sites[i].calls / seconds,
+                sites[i].bytes / seconds);
+    }
+}
+
+static void alloc_report_write(FILE *fp)
+{
+    lib_alloc_site_t sites[FRAMESTATS_ALLOC_SITES];
+    unsigned long total;
+    double seconds = (double)total_ns / 1000000000.0;
+    int count, i;
+
+    count = lib_alloc_stats_get(sites, FRAMESTATS_ALLOC_SITES, &total);
+    if (seconds <= 0.0) {
+        seconds = 1.0;
+    }
+    fprintf(fp, ",\n  \"allocations\": {\n    \"total\": %lu, \"per_second\": %.1f,\n    \"sites\": [",
+            total, total / seconds);
+    for (i = 0; i < count; i++) {
+        fprintf(fp, "%s\n      { \"site\": \"%s:%u\", \"calls\": %lu, \"per_second\": %.1f, \"bytes\": %"PRIu64" }",
+                i == 0 ? "" : ",", sites[i].name, sites[i].line, sites[i].calls,
+                sites[i].calls / seconds, sites[i].bytes);
+    }
+    fprintf(fp, "\n    ]\n  }");
+}
+#endif
+
+void framestats_monitor_show(void)
+{
+    int i;
+
+    mon_out("Host time per frame over %lu frames:\n", frames);
+    if (frames > 0) {
+        mon_out("  mean %.2f ms, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.2f ms\n",
+                (double)total_ns / frames / 1000000.0,
+                framestats_percentile(50.0), framestats_percentile(95.0),
+                framestats_percentile(99.0), (double)max_ns / 1000000.0);
+    }
+    if (sleeps > 0) {
+        mon_out("Pacing error over %lu sleeps: mean %.1f us, bias %+.1f us, latest wake-up %.1f us late\n",
+                sleeps, (double)sleep_error_total_ns / sleeps / 1000.0,
+                (double)sleep_late_total_ns / sleeps / 1000.0, sleep_late_max_ns / 1000.0);
+    }
+
+#ifdef USE_VICE_THREAD
+    mainlock_monitor_show();
+#endif
+#ifdef LIB_ALLOC_STATS
+    alloc_monitor_show();
+#endif
+
+    if (!perf_counters_enabled) {
+        return;
+    }
+    if (counter_frames == 0) {
+        mon_out("No perf counters have been read.\n");
+        return;
+    }
+    mon_out("Perf counters per frame over %lu frames:\n", counter_frames);
+    for (i = 0; i < FRAMESTATS_NUM_COUNTERS; i++) {
+        mon_out("  %-14s mean %"PRIu64", max %"PRIu64"\n", counter_names[i],
+                counter_total[i] / counter_frames, counter_max[i]);
+    }
+}
+
+void framestats_report_write(void)
+{
+    FILE *fp;
+    int i;
+
+    if (report_filename == NULL) {
+        return;
+    }
+
+    if (strcmp(report_filename, "-") == 0) {
+        fp = stdout;
+    } else {
+        fp = fopen(report_filename, MODE_WRITE_TEXT);
+        if (fp == NULL) {
+            log_error(LOG_DEFAULT, "Cannot write performance report `%s'.", report_filename);
+            return;
+        }
+    }
+
+    fprintf(fp, "{\n  \"machine\": \"%s\",\n", machine_name);
+    fprintf(fp, "  \"frames\": %lu,\n", frames);
+    fprintf(fp, "  \"frame_ms\": { \"mean\": %.3f, \"p50\": %.1f, \"p95\": %.1f, \"p99\": %.1f, \"max\": %.3f }",
+            frames > 0 ? (double)total_ns / frames / 1000000.0 : 0.0,
+            framestats_percentile(50.0), framestats_percentile(95.0),
+            framestats_percentile(99.0), (double)max_ns / 1000000.0);
+    fprintf(fp, ",\n  \"pacing_us\": { \"sleeps\": %lu, \"mean_error\": %.1f, \"bias\": %.1f, \"max_late\": %.1f }",
+            sleeps, sleeps > 0 ? (double)sleep_error_total_ns / sleeps / 1000.0 : 0.0,
+            sleeps > 0 ? (double)sleep_late_total_ns / sleeps / 1000.0 : 0.0,
+            sleep_late_max_ns / 1000.0);
+    if (counter_frames > 0) {
+        fprintf(fp, ",\n  \"counter_frames\": %lu,\n  \"counters\": {", counter_frames);
+        for (i = 0; i < FRAMESTATS_NUM_COUNTERS; i++) {
+            fprintf(fp, "%s\n    \"%s\": { \"mean\": %"PRIu64", \"max\": %"PRIu64" }",
+                    i == 0 ? "" : ",", counter_names[i],
+                    counter_total[i] / counter_frames, counter_max[i]);
+        }
+        fprintf(fp, "\n  }");
+    }
+#ifdef USE_VICE_THREAD
+    mainlock_report_write(fp);
+#endif
+#ifdef LIB_ALLOC_STATS
+    alloc_report_write(fp);
+#endif
+    fprintf(fp, "\n}\n");
+
+    if (fp == stdout) {
+        fflush(stdout);
+    } else {
+        fclose(fp);
+    }
+}
+
+void framestats_shutdown(void)
+{
+    perf_close();
+    lib_free(report_filename);
+    report_filename = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_perf_counters(int val, void *param)
+{
+#ifdef HAVE_LINUX_PERF_EVENT_H
+    val = val ? 1 : 0;
+
+    if (!val) {
+        perf_close();
+    }
+    perf_failed = 0;
+    perf_counters_enabled = val;
+    return 0;
+#else
+    if (val) {
+        log_warning(LOG_DEFAULT, "Perf counters are only supported on Linux.");
+    }
+    perf_counters_enabled = 0;
+    return 0;
+#endif
+}
+
+static const resource_int_t resources_int[] = {
+    { "PerfCounters", 0, RES_EVENT_NO, NULL,
+      &perf_counters_enabled, set_perf_counters, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int framestats_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static int cmdline_perfreport(const char *param, void *extra_param)
+{
+    util_string_set(&report_filename, param);
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-perfreport", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_perfreport, NULL, NULL, NULL,
+      "<filename>", "Write the host time per frame percentiles (and perf counters) as JSON to <filename> (`-' for stdout) at exit" },
+    { "-perfcounters", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "PerfCounters", (void *)1,
+      NULL, "Read the instruction, cache miss and branch miss counters of the host CPU every frame (Linux only)" },
+    { "+perfcounters", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "PerfCounters", (void *)0,
+      NULL, "Do not read the host CPU perf counters" },
+    CMDLINE_LIST_END
+};
+
+int framestats_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,50 @@
+/*
+ * framestats.h - Distribution of the host time per emulated frame.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_FRAMESTATS_H
+#define VICE_FRAMESTATS_H
+
+#include "types.h"
+
+/* Called by vsync_do_vsync() with the host time since the previous frame.
+   `resumed' is set for the first frame after a pause or a sync reset,
+   which is not counted.  */
+void framestats_frame_end(uint64_t frame_ns, int resumed);
+
+/* Called by the frame pacing of vsync.c with how late (or, if negative,
+   early) it woke up from a sleep until a deadline.  */
+void framestats_sleep_end(int64_t error_ns);
+
+/* The `framestats' monitor command.  */
+void framestats_monitor_show(void);
+void framestats_reset(void);
+
+/* Write the report, if one was requested with -perfreport.  Called by
+   machine_shutdown().  */
+void framestats_report_write(void);
+
+int framestats_resources_init(void);
+int framestats_cmdline_options_init(void);
+void framestats_shutdown(void);
+
+#endif
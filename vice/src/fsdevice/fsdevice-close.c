@@ -39,6 +39,7 @@
 #include "cbmdos.h"
 #include "fileio.h"
 #include "fsdevice-close.h"
+#include "fsdevice-dircache.h"
 #include "fsdevice-read.h"
 #include "fsdevicetypes.h"
 #include "archdep.h"
@@ -57,6 +58,12 @@ int fsdevice_close(vdrive_t *vdrive, unsigned int secondary)
         return FLOPPY_COMMAND_OK;
     }
 
+    /* the listing changes with the file written */
+    if (bufinfo->mode == Write || bufinfo->mode == Append
+        || bufinfo->mode == Relative) {
+        fsdevice_dircache_invalidate(vdrive->unit);
+    }
+
     switch (bufinfo->mode) {
         case Relative:
             fsdevice_relative_pad_record(bufinfo);
@@ -76,12 +83,12 @@ int fsdevice_close(vdrive_t *vdrive, unsigned int secondary)
             }
             break;
         case Directory:
-            if (bufinfo->host_dir == NULL) {
+            if (bufinfo->dircache == NULL) {
                 return FLOPPY_ERROR;
             }
 
-            archdep_closedir(bufinfo->host_dir);
-            bufinfo->host_dir = NULL;
+            fsdevice_dircache_release(bufinfo->dircache);
+            bufinfo->dircache = NULL;
             break;
     }
 
@@ -0,0 +1,173 @@
+/*
+ * fsdevice-dircache.c - File system device, directory cache.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Listing a host directory opens every file in it to get its CBM name and
+   type (P00 headers), and stats it for the size and access rights.  On a
+   network share with many files that takes seconds, so the result is kept
+   per unit and used again while the modification time of the directory is
+   the same.
+
+   The time has a resolution of one second: a snapshot taken in the same
+   second the directory was changed might miss the change, so it is only
+   used again once the directory is older than the snapshot.  Changes made
+   through the device itself (writes, scratch, rename) drop the snapshot
+   right away.  A file changing its size without the directory changing
+   (written to in place from the host) is only noticed with the next change
+   of the directory.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "fileio.h"
+#include "fsdevicetypes.h"
+#include "lib.h"
+#include "util.h"
+
+#include "fsdevice-dircache.h"
+
+static fsdevice_dircache_t *dircache[FSDEVICE_DEVICE_MAX];
+
+static void dircache_free(fsdevice_dircache_t *cache)
+{
+    int i;
+
+    for (i = 0; i < cache->count; i++) {
+        lib_free(cache->entries[i].direntry);
+        lib_free(cache->entries[i].name);
+    }
+    lib_free(cache->entries);
+    lib_free(cache->path);
+    lib_free(cache);
+}
+
+static fsdevice_dircache_t *dircache_read(const char *path, unsigned int format,
+                                          time_t mtime)
+{
+    fsdevice_dircache_t *cache;
+    fsdevice_dircache_entry_t *entry;
+    archdep_dir_t *host_dir;
+    fileio_info_t *finfo;
+    const char *direntry;
+    char *buf;
+    int size;
+
+    host_dir = archdep_opendir(path, ARCHDEP_OPENDIR_ALL_FILES);
+    if (host_dir == NULL) {
+        return NULL;
+    }
+
+    cache = lib_calloc(1, sizeof(fsdevice_dircache_t));
+    cache->path = lib_strdup(path);
+    cache->format = format;
+    cache->mtime = mtime;
+    cache->taken = time(NULL);
+    cache->refs = 1;
+
+    size = archdep_readdir_num_entries(host_dir);
+    if (size > 0) {
+        cache->entries = lib_malloc(size * sizeof(fsdevice_dircache_entry_t));
+    }
+
+    while ((direntry = archdep_readdir(host_dir)) != NULL) {
+        finfo = fileio_open(direntry, path, format,
+                            FILEIO_COMMAND_STAT | FILEIO_COMMAND_FSNAME,
+                            FILEIO_TYPE_PRG, NULL);
+        if (finfo == NULL) {
+            continue;
+        }
+
+        entry = &cache->entries[cache->count++];
+        entry->direntry = lib_strdup(direntry);
+        entry->name = (uint8_t *)lib_strdup((char *)finfo->name);
+        entry->type = finfo->type;
+        fileio_close(finfo);
+
+        buf = util_concat(path, ARCHDEP_DIR_SEP_STR, direntry, NULL);
+        entry->filelen = 0;
+        entry->isdir = 0;
+        entry->statrc = archdep_stat(buf, &entry->filelen, &entry->isdir);
+        entry->readonly = archdep_access(buf, ARCHDEP_ACCESS_W_OK) != 0;
+        lib_free(buf);
+    }
+
+    archdep_closedir(host_dir);
+
+    return cache;
+}
+
+/* Get the snapshot of a directory, or NULL if it cannot be read.  The
+   caller releases it when done.  */
+fsdevice_dircache_t *fsdevice_dircache_get(unsigned int unit, const char *path,
+                                           unsigned int format)
+{
+    fsdevice_dircache_t *cache;
+    time_t mtime;
+
+    if (archdep_file_mtime(path, &mtime) < 0) {
+        return NULL;
+    }
+
+    cache = dircache[unit - 8];
+    if (cache != NULL
+        && cache->format == format
+        && cache->mtime == mtime
+        && mtime < cache->taken
+        && strcmp(cache->path, path) == 0) {
+        cache->refs++;
+        return cache;
+    }
+
+    fsdevice_dircache_invalidate(unit);
+
+    cache = dircache_read(path, format, mtime);
+    if (cache != NULL) {
+        cache->refs++;
+        dircache[unit - 8] = cache;
+    }
+    return cache;
+}
+
+void fsdevice_dircache_release(fsdevice_dircache_t *cache)
+{
+    if (cache != NULL && --cache->refs == 0) {
+        dircache_free(cache);
+    }
+}
+
+void fsdevice_dircache_invalidate(unsigned int unit)
+{
+    fsdevice_dircache_release(dircache[unit - 8]);
+    dircache[unit - 8] = NULL;
+}
+
+void fsdevice_dircache_shutdown(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < FSDEVICE_DEVICE_MAX; i++) {
+        fsdevice_dircache_invalidate(i + 8);
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * fsdevice-dircache.h - File system device, directory cache.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_FSDEVICE_DIRCACHE_H
+#define VICE_FSDEVICE_DIRCACHE_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include "types.h"
+
+/* A host file as shown in the directory listing.  */
+typedef struct fsdevice_dircache_entry_s {
+    char *direntry;         /* host name */
+    uint8_t *name;          /* CBM name */
+    unsigned int type;
+    size_t filelen;
+    unsigned int isdir;
+    int statrc;
+    int readonly;
+} fsdevice_dircache_entry_t;
+
+/* Snapshot of a host directory.  It is shared by the directory channels
+   that read it and never changes; a changed directory gets a new one.  */
+typedef struct fsdevice_dircache_s {
+    char *path;
+    unsigned int format;
+    time_t mtime;
+    time_t taken;
+    int refs;
+    int count;
+    fsdevice_dircache_entry_t *entries;
+} fsdevice_dircache_t;
+
+fsdevice_dircache_t *fsdevice_dircache_get(unsigned int unit, const char *path,
+                                           unsigned int format);
+void fsdevice_dircache_release(fsdevice_dircache_t *cache);
+void fsdevice_dircache_invalidate(unsigned int unit);
+void fsdevice_dircache_shutdown(void);
+
+#endif
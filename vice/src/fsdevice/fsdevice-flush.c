@@ -46,6 +46,7 @@
 #include "cbmdos.h"
 #include "charset.h"
 #include "fileio.h"
+#include "fsdevice-dircache.h"
 #include "fsdevice-flush.h"
 #include "fsdevice-filename.h"
 #include "fsdevice-read.h"
@@ -655,6 +656,9 @@ void fsdevice_flush(vdrive_t *vdrive, unsigned int secondary)
         goto leave;
     }
 
+    /* scratch, rename, copy, md, rd... change the directory */
+    fsdevice_dircache_invalidate(vdrive->unit);
+
     /* FIXME: Use `vdrive_command_parse()'! */
     /* remove trailing cr */
     while (fsdevice_dev[dnr].cptr
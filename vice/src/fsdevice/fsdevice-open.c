@@ -45,6 +45,7 @@
 #include "cbmdos.h"
 #include "charset.h"
 #include "fileio.h"
+#include "fsdevice-dircache.h"
 #include "fsdevice-filename.h"
 #include "fsdevice-read.h"
 #include "fsdevice-resources.h"
@@ -105,7 +106,8 @@ static int fsdevice_open_directory(vdrive_t *vdrive, unsigned int secondary,
                                    bufinfo_t *bufinfo,
                                    cbmdos_cmd_parse_t *cmd_parse, char *rname)
 {
-    archdep_dir_t *host_dir;
+    fsdevice_dircache_t *dircache;
+    unsigned int format = 0;
     char *mask;
     uint8_t *p;
     int i;
@@ -137,16 +139,23 @@ static int fsdevice_open_directory(vdrive_t *vdrive, unsigned int secondary,
         }
     }
 
+    if (fsdevice_convert_p00_enabled[(vdrive->unit) - 8]) {
+        format |= FILEIO_FORMAT_P00;
+    }
+    if (!fsdevice_hide_cbm_files_enabled[vdrive->unit - 8]) {
+        format |= FILEIO_FORMAT_RAW;
+    }
+
     /* trying to open */
-    host_dir = archdep_opendir((char *)(cmd_parse->parsecmd), ARCHDEP_OPENDIR_ALL_FILES);
-    if (host_dir == NULL) {
+    dircache = fsdevice_dircache_get(vdrive->unit, cmd_parse->parsecmd, format);
+    if (dircache == NULL) {
         for (p = (uint8_t *)(cmd_parse->parsecmd); *p; p++) {
             if (isupper((unsigned char)*p)) {
                 *p = tolower((unsigned char)*p);
             }
         }
-        host_dir = archdep_opendir((char *)(cmd_parse->parsecmd), ARCHDEP_OPENDIR_ALL_FILES);
-        if (host_dir == NULL) {
+        dircache = fsdevice_dircache_get(vdrive->unit, cmd_parse->parsecmd, format);
+        if (dircache == NULL) {
             fsdevice_error(vdrive, CBMDOS_IPE_NOT_FOUND);
             return FLOPPY_ERROR;
         }
@@ -204,7 +213,8 @@ static int fsdevice_open_directory(vdrive_t *vdrive, unsigned int secondary,
     bufinfo[secondary].buflen = (int)(p - bufinfo[secondary].name);
     bufinfo[secondary].bufp = bufinfo[secondary].name;
     bufinfo[secondary].mode = Directory;
-    bufinfo[secondary].host_dir = host_dir;
+    bufinfo[secondary].dircache = dircache;
+    bufinfo[secondary].dirpos = 0;
     bufinfo[secondary].eof = 0;
 
     return FLOPPY_COMMAND_OK;
@@ -317,6 +327,8 @@ static int fsdevice_open_file(vdrive_t *vdrive, unsigned int secondary,
     /* Prepare for buffered reads */
     bufinfo[secondary].isbuffered = 0;
     bufinfo[secondary].iseof = 0;
+    bufinfo[secondary].readahead_pos = 0;
+    bufinfo[secondary].readahead_len = 0;
     if (tape_image_open(tape) < 0) {
         lib_free(tape->name);
         tape->name = NULL;
@@ -41,6 +41,7 @@
 #include "archdep.h"
 #include "cbmdos.h"
 #include "fileio.h"
+#include "fsdevice-dircache.h"
 #include "fsdevice-filename.h"
 #include "fsdevice-resources.h"
 #include "fsdevicetypes.h"
@@ -61,6 +62,26 @@
 # define DBG(x)
 #endif
 
+/* Read the next byte of a host file, the file is read in blocks of
+   FSDEVICE_READAHEAD bytes.  */
+static unsigned int command_read_byte(bufinfo_t *bufinfo, uint8_t *data)
+{
+    if (bufinfo->readahead_pos >= bufinfo->readahead_len) {
+        if (bufinfo->readahead == NULL) {
+            bufinfo->readahead = lib_malloc(FSDEVICE_READAHEAD);
+        }
+        bufinfo->readahead_pos = 0;
+        bufinfo->readahead_len = fileio_read(bufinfo->fileio_info,
+                                             bufinfo->readahead,
+                                             FSDEVICE_READAHEAD);
+        if (bufinfo->readahead_len == 0) {
+            return 0;
+        }
+    }
+    *data = bufinfo->readahead[bufinfo->readahead_pos++];
+    return 1;
+}
+
 static int command_read(bufinfo_t *bufinfo, uint8_t *data)
 {
     if (bufinfo->tape->name) {
@@ -120,7 +141,7 @@ static int command_read(bufinfo_t *bufinfo, uint8_t *data)
             }
             /* If this is our first read, read in first byte */
             if (!bufinfo->isbuffered) {
-                bufinfo->iseof = !fileio_read(bufinfo->fileio_info, &(bufinfo->buffered), 1);
+                bufinfo->iseof = !command_read_byte(bufinfo, &(bufinfo->buffered));
                 /* We shouldn't get an EOF at this point */
                 /* Check for errors */
                 if (fileio_ferror(bufinfo->fileio_info)) {
@@ -130,7 +151,7 @@ static int command_read(bufinfo_t *bufinfo, uint8_t *data)
             /* Place it in the output field */
             *data = bufinfo->buffered;
             /* Read the next buffer; if nothing read, set EOF signal */
-            bufinfo->iseof = !fileio_read(bufinfo->fileio_info, &(bufinfo->buffered), 1);
+            bufinfo->iseof = !command_read_byte(bufinfo, &(bufinfo->buffered));
             /* Check for errors */
             if (fileio_ferror(bufinfo->fileio_info)) {
                 return SERIAL_ERROR;
@@ -380,24 +401,13 @@ static int relative_read(vdrive_t *vdrive, bufinfo_t *bufinfo, uint8_t *data)
 static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
                                   uint8_t *data, unsigned int secondary)
 {
-    int i, l, f, statrc;
+    int i, l, f;
     unsigned long blocks;
-    const char *direntry;
-    size_t filelen;
-    unsigned int isdir;
-    fileio_info_t *finfo = NULL;
-    unsigned int format = 0;
-    char buf[ARCHDEP_PATH_MAX];
+    const fsdevice_dircache_entry_t *entry = NULL;
+    uint8_t name[ARCHDEP_PATH_MAX];
 
     bufinfo->bufp = bufinfo->name;
 
-    if (fsdevice_convert_p00_enabled[(vdrive->unit) - 8]) {
-        format |= FILEIO_FORMAT_P00;
-    }
-    if (!fsdevice_hide_cbm_files_enabled[vdrive->unit - 8]) {
-        format |= FILEIO_FORMAT_RAW;
-    }
-
     /*
      * Find the next directory entry and return it as a CBM
      * directory line.
@@ -408,23 +418,12 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
     f = 1;
     do {
         uint8_t *p;
-        finfo = NULL;
-
-        direntry = archdep_readdir(bufinfo->host_dir);
 
-        if (direntry == NULL) {
+        if (bufinfo->dirpos >= bufinfo->dircache->count) {
+            entry = NULL;
             break;
         }
-
-        finfo = fileio_open(direntry, bufinfo->dir, format,
-                            FILEIO_COMMAND_STAT | FILEIO_COMMAND_FSNAME,
-                            FILEIO_TYPE_PRG, NULL);
-
-        if (finfo == NULL) {
-            continue;
-        }
-
-        bufinfo->type = finfo->type;
+        entry = &bufinfo->dircache->entries[bufinfo->dirpos++];
 
         if (bufinfo->dirmask[0] == '\0') {
             break;
@@ -432,7 +431,7 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
 
         l = (int)strlen(bufinfo->dirmask);
 
-        for (p = finfo->name, i = 0;
+        for (p = entry->name, i = 0;
              *p && bufinfo->dirmask[i] && i < l; i++) {
             if (bufinfo->dirmask[i] == '?') {
                 p++;
@@ -455,38 +454,32 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
                 break;
             }
         }
-        if (f > 0) {
-            fileio_close(finfo);
-        }
     } while (f);
 
-    if (direntry != NULL) {
+    if (entry != NULL) {
         uint8_t *p = bufinfo->name;
         int splatfile = 0;
         int protectfile = 0;
 
-        strcpy(buf, bufinfo->dir);
-        strcat(buf, ARCHDEP_DIR_SEP_STR);
-        strcat(buf, direntry);
+        bufinfo->type = entry->type;
 
         /* Line link, Length and spaces */
 
         *p++ = 1;
         *p++ = 1;
 
-        statrc = archdep_stat(buf, &filelen, &isdir);
-        if (statrc != 0) {
+        if (entry->statrc != 0) {
             /* this file can't be opened */
             splatfile = 1;
             protectfile = 1;
         }
 
-        if (archdep_access(buf, ARCHDEP_ACCESS_W_OK)) {
+        if (entry->readonly) {
             /* this file is read only */
             protectfile = 1;
         }
 
-        blocks = (filelen + 253) / 254;
+        blocks = (entry->filelen + 253) / 254;
         if (blocks > 0xffff) {
             blocks = 0xffff; /* Limit file size to 16 bits.  */
             /* this file is too large, guard it against opening */
@@ -512,9 +505,10 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
 
         *p++ = '"';
 
-        fsdevice_limit_namelength(vdrive, finfo->name);
+        strcpy((char *)name, (char *)entry->name);
+        fsdevice_limit_namelength(vdrive, name);
 
-        for (i = 0; finfo->name[i] && (*p = finfo->name[i]); ++i, ++p) {
+        for (i = 0; name[i] && (*p = name[i]); ++i, ++p) {
         }
 
         *p++ = '"';
@@ -522,7 +516,7 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
             *p++ = ' ';
         }
 
-        if (isdir != 0) {
+        if (entry->isdir != 0) {
             *p++ = ' '; /* normal file */
             *p++ = 'D';
             *p++ = 'I';
@@ -597,17 +591,13 @@ static void command_directory_get(vdrive_t *vdrive, bufinfo_t *bufinfo,
         bufinfo->buflen = 32;
         bufinfo->eof++;
     }
-
-    if (finfo != NULL) {
-        fileio_close(finfo);
-    }
 }
 
 
 static int command_directory(vdrive_t *vdrive, bufinfo_t *bufinfo,
                              uint8_t *data, unsigned int secondary)
 {
-    if (bufinfo->host_dir == NULL) {
+    if (bufinfo->dircache == NULL) {
         return FLOPPY_ERROR;
     }
 
@@ -46,6 +46,7 @@
 #include "cbmdos.h"
 #include "fileio.h"
 #include "fsdevice-close.h"
+#include "fsdevice-dircache.h"
 #include "fsdevice-flush.h"
 #include "fsdevice-open.h"
 #include "fsdevice-read.h"
@@ -232,6 +233,8 @@ void fsdevice_shutdown(void)
 {
     unsigned int i, j;
 
+    fsdevice_dircache_shutdown();
+
     for (i = 0; i < FSDEVICE_DEVICE_MAX; i++) {
         bufinfo_t *bufinfo;
 
@@ -242,6 +245,7 @@ void fsdevice_shutdown(void)
             lib_free(bufinfo[j].dir);
             lib_free(bufinfo[j].name);
             lib_free(bufinfo[j].dirmask);
+            lib_free(bufinfo[j].readahead);
         }
 
         lib_free(fsdevice_dev[i].errorl);
@@ -28,7 +28,6 @@
 #define VICE_FSDEVICETYPES_H
 
 #include "types.h"
-#include "archdep_dir.h"
 
 #define FSDEVICE_BUFFER_MAX 16
 #define FSDEVICE_DEVICE_MAX 4
@@ -36,16 +35,21 @@
 #define FSDEVICE_TRACK_MAX   80
 #define FSDEVICE_SECTOR_MAX  32
 
+/* bytes read ahead from host files */
+#define FSDEVICE_READAHEAD   4096
+
 enum fsmode {
     Write, Read, Append, Directory, Relative
 };
 
 struct fileio_info_s;
+struct fsdevice_dircache_s;
 struct tape_image_s;
 
 struct bufinfo_s {
     struct fileio_info_s *fileio_info;
-    archdep_dir_t *host_dir;
+    struct fsdevice_dircache_s *dircache;
+    int dirpos;     /* next entry of the directory listing */
     struct tape_image_s *tape;
     enum fsmode mode;
     char *dir;
@@ -57,6 +61,9 @@ struct bufinfo_s {
     uint8_t buffered;  /* Buffered Byte: Added to buffer reads to remove buffering from iec code */
     int isbuffered; /* TRUE is a byte exists in the buffer above */
     int iseof;      /* TRUE if an EOF is detected on a buffered read */
+    uint8_t *readahead; /* host file data not yet read from the channel */
+    unsigned int readahead_pos;
+    unsigned int readahead_len;
     char *dirmask;
                     /* REL file support */
     int reclen;
@@ -260,17 +260,39 @@ static int gcr_find_sector_header(const disk_track_t *raw, uint8_t sector)
     return -CBMDOS_FDC_ERR_HEADER;
 }
 
-fdc_err_t gcr_read_sector(const disk_track_t *raw, uint8_t *data, uint8_t sector)
+/* Find the header of every sector in a single pass over the track; after
+   this `index[sector]' is what gcr_find_sector_header() returns for it.  */
+static void gcr_index_sector_headers(const disk_track_t *raw, int *index)
 {
-    uint8_t buffer[260];
-    uint8_t b;
-    int i, p;
+    uint8_t header[4];
+    int i, p, p2;
 
-    p = gcr_find_sector_header(raw, sector);
+    p = gcr_find_sync(raw, 0, raw->size * 8);
+    for (i = 0; i < 256; i++) {
+        index[i] = (p < 0) ? p : -CBMDOS_FDC_ERR_HEADER;
+    }
     if (p < 0) {
-        return -p;
+        return;
     }
 
+    p2 = p;
+    do {
+        gcr_decode_block(raw, p, header, 1);
+
+        if (header[0] == 0x08 && index[header[2]] < 0) {
+            index[header[2]] = p;
+        }
+        p = gcr_find_sync(raw, p, raw->size * 8);
+    } while (p != p2);
+}
+
+/* Decode the data block following the sector header at `p'.  */
+static fdc_err_t gcr_read_sector_data(const disk_track_t *raw, int p, uint8_t *data)
+{
+    uint8_t buffer[260];
+    uint8_t b;
+    int i;
+
     p = gcr_find_sync(raw, p, 500 * 8);
     if (p < 0) {
         return -p;
@@ -291,6 +313,35 @@ fdc_err_t gcr_read_sector(const disk_track_t *raw, uint8_t *data, uint8_t sector
     return b ? CBMDOS_FDC_ERR_DCHECK : CBMDOS_FDC_ERR_OK;
 }
 
+fdc_err_t gcr_read_sector(const disk_track_t *raw, uint8_t *data, uint8_t sector)
+{
+    int p;
+
+    p = gcr_find_sector_header(raw, sector);
+    if (p < 0) {
+        return -p;
+    }
+
+    return gcr_read_sector_data(raw, p, data);
+}
+
+void gcr_read_track(const disk_track_t *raw, uint8_t *data, unsigned int sectors,
+                    fdc_err_t *errors)
+{
+    int index[256];
+    unsigned int sector;
+
+    gcr_index_sector_headers(raw, index);
+
+    for (sector = 0; sector < sectors && sector < 256; sector++) {
+        if (index[sector] < 0) {
+            errors[sector] = -index[sector];
+        } else {
+            errors[sector] = gcr_read_sector_data(raw, index[sector], &data[sector * 256]);
+        }
+    }
+}
+
 fdc_err_t gcr_write_sector(disk_track_t *raw, const uint8_t *data, uint8_t sector)
 {
     uint8_t buffer[260], *offset, *buf;
@@ -65,6 +65,10 @@ typedef struct gcr_header_s {
 void gcr_convert_sector_to_GCR(const uint8_t *buffer, uint8_t *ptr, const gcr_header_t *header,
                                int gap, int sync, enum fdc_err_e error_code);
 enum fdc_err_e gcr_read_sector(const disk_track_t *raw, uint8_t *data, uint8_t sector);
+/* Same as gcr_read_sector() for sectors 0 to `sectors' - 1, decoding the
+   whole track in one pass.  */
+void gcr_read_track(const disk_track_t *raw, uint8_t *data, unsigned int sectors,
+                    enum fdc_err_e *errors);
 enum fdc_err_e gcr_write_sector(disk_track_t *raw, const uint8_t *data, uint8_t sector);
 
 gcr_t *gcr_create_image(void);
@@ -33,6 +33,7 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -177,6 +178,41 @@ static int audio_codec;
 static int video_codec;
 static int video_halve_framerate;
 
+/* encoder thread */
+
+/* Frames and audio buffers are copied into a bounded queue on the emulation
+   thread and encoded and written by the encoder thread in the same order.
+   When the queue is full the emulation thread waits.  */
+#define FFMPEGDRV_QUEUE_SIZE    16
+
+#define FFMPEGDRV_JOB_VIDEO     0
+#define FFMPEGDRV_JOB_AUDIO     1
+
+typedef struct ffmpegdrv_job_s {
+    int type;
+    int64_t pts;
+    uint8_t *data;              /* palette indices or S16 samples */
+    size_t data_size;
+    uint8_t palette[256 * 3];   /* RGB, video only */
+} ffmpegdrv_job_t;
+
+static ffmpegdrv_job_t queue[FFMPEGDRV_QUEUE_SIZE];
+static unsigned int queue_head;     /* next job to encode */
+static unsigned int queue_tail;     /* next free slot */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_not_full = PTHREAD_COND_INITIALIZER;
+static pthread_t encoder_thread;
+static int encoder_running;
+static int encoder_stop;
+static int encoder_error;
+
+/* backpressure statistics, logged when the recording stops */
+static unsigned long queue_jobs;
+static unsigned long queue_stalls;
+static unsigned int queue_max_depth;
+static tick_t queue_stall_ticks;
+
 static int ffmpegdrv_init_file(void);
 
 static int set_container_format(const char *val, void *param)
@@ -523,8 +559,8 @@ static int ffmpegmovie_init_audio(int speed, int channels, soundmovie_buffer_t *
     return 0;
 }
 
-/* triggered by soundffmpegaudio->write */
-static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
+/* encode one buffer of S16 samples, on the encoder thread while recording */
+static int ffmpegdrv_encode_audio(const int16_t *samples, int64_t pts)
 {
     int got_packet;
     int dst_nb_samples;
@@ -534,8 +570,9 @@ static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
     int ret;
 
     if (audio_st.st) {
-        audio_st.frame->pts = audio_st.next_pts;
-        audio_st.next_pts += audio_in->size;
+        const uint8_t *in[1] = { (const uint8_t *)samples };
+
+        audio_st.frame->pts = pts;
 
         VICE_P_AV_INIT_PACKET(&pkt);
         c = audio_st.st->codec;
@@ -561,9 +598,9 @@ static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
 
             /* convert to destination format */
 #ifndef HAVE_FFMPEG_AVRESAMPLE
-            ret = VICE_P_SWR_CONVERT(swr_ctx, audio_st.frame->data, dst_nb_samples, (const uint8_t **)frame->data, frame->nb_samples);
+            ret = VICE_P_SWR_CONVERT(swr_ctx, audio_st.frame->data, dst_nb_samples, in, frame->nb_samples);
 #else
-            ret = VICE_P_AVRESAMPLE_CONVERT(avr_ctx, audio_st.frame->data, 0, dst_nb_samples, (const uint8_t **)frame->data, 0, frame->nb_samples);
+            ret = VICE_P_AVRESAMPLE_CONVERT(avr_ctx, audio_st.frame->data, 0, dst_nb_samples, in, 0, frame->nb_samples);
 #endif
             if (ret < 0) {
                 log_debug("ffmpegdrv_encode_audio: Error while converting audio frame");
@@ -583,6 +620,33 @@ static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
         }
     }
 
+    return 0;
+}
+
+static ffmpegdrv_job_t *ffmpegdrv_job_get(int type, size_t data_size);
+static void ffmpegdrv_job_put(void);
+
+/* triggered by soundffmpegaudio->write */
+static int ffmpegmovie_encode_audio(soundmovie_buffer_t *audio_in)
+{
+    size_t size = (size_t)audio_in->size * sizeof(int16_t);
+    ffmpegdrv_job_t *job;
+    int64_t pts;
+
+    if (audio_st.st) {
+        pts = audio_st.next_pts;
+        audio_st.next_pts += audio_in->size;
+
+        if (encoder_running) {
+            job = ffmpegdrv_job_get(FFMPEGDRV_JOB_AUDIO, size);
+            memcpy(job->data, audio_in->buffer, size);
+            job->pts = pts;
+            ffmpegdrv_job_put();
+        } else {
+            ffmpegdrv_encode_audio(audio_in->buffer, pts);
+        }
+    }
+
     audio_in->used = 0;
     return 0;
 }
@@ -602,29 +666,49 @@ static soundmovie_funcs_t ffmpegdrv_soundmovie_funcs = {
 /*-----------------------*/
 /* video stream encoding */
 /*-----------------------*/
-static int ffmpegdrv_fill_rgb_image(screenshot_t *screenshot, AVFrame *pic)
+/* copy the palette indices of the video area and the palette into `job' */
+static void ffmpegdrv_copy_frame(screenshot_t *screenshot, ffmpegdrv_job_t *job)
 {
-    int x, y;
+    unsigned int i;
+    int y;
     int dx, dy;
-    int colnum;
     int bufferoffset;
     int x_dim = screenshot->width;
     int y_dim = screenshot->height;
-    int pix = 0;
     /* center the screenshot in the video */
     dx = (video_width - x_dim) / 2;
     dy = (video_height - y_dim) / 2;
     bufferoffset = screenshot->x_offset + (dx < 0 ? -dx : 0)
         + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
 
+    for (y = 0; y < video_height; y++) {
+        memcpy(job->data + y * video_width, screenshot->draw_buffer + bufferoffset, video_width);
+        bufferoffset += screenshot->draw_buffer_line_size;
+    }
+
+    memset(job->palette, 0, sizeof(job->palette));
+    for (i = 0; i < screenshot->palette->num_entries && i < 256; i++) {
+        job->palette[i * 3] = screenshot->palette->entries[i].red;
+        job->palette[i * 3 + 1] = screenshot->palette->entries[i].green;
+        job->palette[i * 3 + 2] = screenshot->palette->entries[i].blue;
+    }
+}
+
+static int ffmpegdrv_fill_rgb_image(const ffmpegdrv_job_t *job, AVFrame *pic)
+{
+    int x, y;
+    int colnum;
+    int pix = 0;
+    const uint8_t *src = job->data;
+
     for (y = 0; y < video_height; y++) {
         for (x = 0; x < video_width; x++) {
-            colnum = screenshot->draw_buffer[bufferoffset + x];
-            pic->data[0][pix + 3*x] = screenshot->palette->entries[colnum].red;
-            pic->data[0][pix + 3*x + 1] = screenshot->palette->entries[colnum].green;
-            pic->data[0][pix + 3*x + 2] = screenshot->palette->entries[colnum].blue;
+            colnum = src[x];
+            pic->data[0][pix + 3*x] = job->palette[colnum * 3];
+            pic->data[0][pix + 3*x + 1] = job->palette[colnum * 3 + 1];
+            pic->data[0][pix + 3*x + 2] = job->palette[colnum * 3 + 2];
         }
-        bufferoffset += screenshot->draw_buffer_line_size;
+        src += video_width;
         pix += pic->linesize[0];
     }
 
@@ -843,6 +927,8 @@ static int ffmpegdrv_init_file(void)
 
     file_init_done = 1;
 
+    ffmpegdrv_start_encoder();
+
     return 0;
 }
 
@@ -901,6 +987,8 @@ static int ffmpegdrv_close(screenshot_t *screenshot)
 {
     unsigned int i;
 
+    ffmpegdrv_stop_encoder();
+
     /* write the trailer, if any */
     if (file_init_done) {
         VICE_P_AV_WRITE_TRAILER(ffmpegdrv_oc);
@@ -934,11 +1022,142 @@ static int ffmpegdrv_close(screenshot_t *screenshot)
     return 0;
 }
 
+static int ffmpegdrv_encode_video(const ffmpegdrv_job_t *job);
+
+/*-----------------------*/
+/* encoder thread        */
+/*-----------------------*/
+
+/* Return the free slot at the end of the queue, with room for `data_size'
+   bytes, waiting for the encoder thread if the queue is full.  */
+static ffmpegdrv_job_t *ffmpegdrv_job_get(int type, size_t data_size)
+{
+    ffmpegdrv_job_t *job;
+
+    pthread_mutex_lock(&queue_lock);
+    if (queue_tail - queue_head == FFMPEGDRV_QUEUE_SIZE) {
+        tick_t start = tick_now();
+
+        queue_stalls++;
+        while (queue_tail - queue_head == FFMPEGDRV_QUEUE_SIZE) {
+            pthread_cond_wait(&queue_not_full, &queue_lock);
+        }
+        queue_stall_ticks += tick_now_delta(start);
+    }
+    job = &queue[queue_tail % FFMPEGDRV_QUEUE_SIZE];
+    pthread_mutex_unlock(&queue_lock);
+
+    /* the slot is not touched by the encoder thread until it is put */
+    if (job->data_size < data_size) {
+        lib_free(job->data);
+        job->data = lib_malloc(data_size);
+        job->data_size = data_size;
+    }
+    job->type = type;
+
+    return job;
+}
+
+/* Hand the slot returned by ffmpegdrv_job_get() to the encoder thread.  */
+static void ffmpegdrv_job_put(void)
+{
+    unsigned int depth;
+
+    pthread_mutex_lock(&queue_lock);
+    queue_tail++;
+    depth = queue_tail - queue_head;
+    if (depth > queue_max_depth) {
+        queue_max_depth = depth;
+    }
+    queue_jobs++;
+    pthread_cond_signal(&queue_not_empty);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+static void *ffmpegdrv_encoder_thread(void *unused)
+{
+    ffmpegdrv_job_t *job;
+    int ret;
+
+    pthread_mutex_lock(&queue_lock);
+    for (;;) {
+        while (queue_head == queue_tail && !encoder_stop) {
+            pthread_cond_wait(&queue_not_empty, &queue_lock);
+        }
+        if (queue_head == queue_tail) {
+            /* stopped and drained */
+            break;
+        }
+        job = &queue[queue_head % FFMPEGDRV_QUEUE_SIZE];
+        pthread_mutex_unlock(&queue_lock);
+
+        if (job->type == FFMPEGDRV_JOB_VIDEO) {
+            ret = ffmpegdrv_encode_video(job);
+        } else {
+            ret = ffmpegdrv_encode_audio((const int16_t *)job->data, job->pts);
+        }
+
+        pthread_mutex_lock(&queue_lock);
+        if (ret < 0) {
+            encoder_error = 1;
+        }
+        queue_head++;
+        pthread_cond_signal(&queue_not_full);
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    return NULL;
+}
+
+static void ffmpegdrv_start_encoder(void)
+{
+    queue_head = 0;
+    queue_tail = 0;
+    queue_jobs = 0;
+    queue_stalls = 0;
+    queue_max_depth = 0;
+    queue_stall_ticks = 0;
+    encoder_stop = 0;
+    encoder_error = 0;
+
+    if (pthread_create(&encoder_thread, NULL, ffmpegdrv_encoder_thread, NULL) != 0) {
+        log_warning(LOG_DEFAULT, "ffmpegdrv: Cannot create the encoder thread, encoding on the emulation thread");
+        return;
+    }
+    encoder_running = 1;
+}
+
+/* Encode what is still queued, then stop the encoder thread.  */
+static void ffmpegdrv_stop_encoder(void)
+{
+    int i;
+
+    if (encoder_running) {
+        pthread_mutex_lock(&queue_lock);
+        encoder_stop = 1;
+        pthread_cond_signal(&queue_not_empty);
+        pthread_mutex_unlock(&queue_lock);
+
+        pthread_join(encoder_thread, NULL);
+        encoder_running = 0;
+
+        log_message(LOG_DEFAULT, "ffmpegdrv: %lu frames and sound buffers encoded, queue depth max %u of %d, "
+                    "emulation waited %lu times for %.1f ms",
+                    queue_jobs, queue_max_depth, FFMPEGDRV_QUEUE_SIZE, queue_stalls,
+                    (double)queue_stall_ticks * 1000.0 / tick_per_second());
+    }
+
+    for (i = 0; i < FFMPEGDRV_QUEUE_SIZE; i++) {
+        lib_free(queue[i].data);
+        queue[i].data = NULL;
+        queue[i].data_size = 0;
+    }
+}
+
 /* triggered by screenshot_record */
 static int ffmpegdrv_record(screenshot_t *screenshot)
 {
-    AVCodecContext *c;
-    int ret;
+    ffmpegdrv_job_t *job;
 
     if (audio_init_done && video_init_done && !file_init_done) {
         ffmpegdrv_init_file();
@@ -959,10 +1178,32 @@ static int ffmpegdrv_record(screenshot_t *screenshot)
         return 0;
     }
 
+    if (encoder_error) {
+        return -1;
+    }
+
+    job = ffmpegdrv_job_get(FFMPEGDRV_JOB_VIDEO, (size_t)video_width * video_height);
+    ffmpegdrv_copy_frame(screenshot, job);
+    job->pts = video_st.next_pts++;
+
+    if (encoder_running) {
+        ffmpegdrv_job_put();
+        return 0;
+    }
+
+    return ffmpegdrv_encode_video(job);
+}
+
+/* encode one frame, on the encoder thread while recording */
+static int ffmpegdrv_encode_video(const ffmpegdrv_job_t *job)
+{
+    AVCodecContext *c;
+    int ret;
+
     c = video_st.st->codec;
 
     if (c->pix_fmt != VICE_AV_PIX_FMT_RGB24) {
-        ffmpegdrv_fill_rgb_image(screenshot, video_st.tmp_frame);
+        ffmpegdrv_fill_rgb_image(job, video_st.tmp_frame);
 
         if (sws_ctx != NULL) {
             VICE_P_SWS_SCALE(sws_ctx,
@@ -971,10 +1212,10 @@ static int ffmpegdrv_record(screenshot_t *screenshot)
                 video_st.frame->data, video_st.frame->linesize);
         }
     } else {
-        ffmpegdrv_fill_rgb_image(screenshot, video_st.frame);
+        ffmpegdrv_fill_rgb_image(job, video_st.frame);
     }
 
-    video_st.frame->pts = video_st.next_pts++;
+    video_st.frame->pts = job->pts;
 
 #ifdef AVFMT_RAWPICTURE
     if (ffmpegdrv_oc->oformat->flags & AVFMT_RAWPICTURE) {
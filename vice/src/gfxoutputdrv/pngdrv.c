@@ -37,6 +37,7 @@
 #include "archdep.h"
 #include "gfxoutput.h"
 #include "lib.h"
+#include "palette.h"
 #include "pngdrv.h"
 #include "screenshot.h"
 #include "types.h"
@@ -50,10 +51,49 @@ typedef struct gfxoutputdrv_data_s {
     png_infop info_ptr;
     uint8_t *data;
     unsigned int line;
+    int indexed;    /* writing palette indices rather than RGBA */
 } gfxoutputdrv_data_t;
 
 static gfxoutputdrv_t png_drv;
 
+/* Write the palette indices of the draw buffer as they are, with the
+   smallest bit depth that holds them, if the palette fits into a PNG one. */
+static void pngdrv_set_indexed(screenshot_t *screenshot, gfxoutputdrv_data_t *sdata)
+{
+    png_color colors[256];
+    unsigned int num_entries = screenshot->palette->num_entries;
+    unsigned int i;
+    int depth;
+
+    for (i = 0; i < num_entries; i++) {
+        colors[i].red = screenshot->palette->entries[i].red;
+        colors[i].green = screenshot->palette->entries[i].green;
+        colors[i].blue = screenshot->palette->entries[i].blue;
+    }
+
+    if (num_entries <= 2) {
+        depth = 1;
+    } else if (num_entries <= 4) {
+        depth = 2;
+    } else if (num_entries <= 16) {
+        depth = 4;
+    } else {
+        depth = 8;
+    }
+
+    png_set_IHDR(sdata->png_ptr, sdata->info_ptr, screenshot->width, screenshot->height,
+                 depth, PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_set_PLTE(sdata->png_ptr, sdata->info_ptr, colors, (int)num_entries);
+
+    png_write_info(sdata->png_ptr, sdata->info_ptr);
+
+    if (depth < 8) {
+        /* rows have one index per byte */
+        png_set_packing(sdata->png_ptr);
+    }
+}
+
 static int pngdrv_open(screenshot_t *screenshot, const char *filename)
 {
     gfxoutputdrv_data_t *sdata;
@@ -105,6 +145,14 @@ static int pngdrv_open(screenshot_t *screenshot, const char *filename)
     png_init_io(sdata->png_ptr, sdata->fd);
     png_set_compression_level(sdata->png_ptr, Z_BEST_COMPRESSION);
 
+    sdata->indexed = screenshot->palette != NULL
+                     && screenshot->palette->num_entries > 0
+                     && screenshot->palette->num_entries <= 256;
+    if (sdata->indexed) {
+        pngdrv_set_indexed(screenshot, sdata);
+        return 0;
+    }
+
     png_set_IHDR(sdata->png_ptr, sdata->info_ptr, screenshot->width, screenshot->height,
                  8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
                  PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
@@ -124,6 +172,12 @@ static int pngdrv_write(screenshot_t *screenshot)
 
     sdata = screenshot->gfxoutputdrv_data;
 
+    if (sdata->indexed) {
+        png_write_row(sdata->png_ptr,
+                      (png_bytep)(screenshot->line_indices)(screenshot, sdata->data, sdata->line));
+        return 0;
+    }
+
     (screenshot->convert_line)(screenshot, sdata->data, sdata->line,
                                SCREENSHOT_MODE_RGB32);
     png_write_row(sdata->png_ptr, (png_bytep)(sdata->data));
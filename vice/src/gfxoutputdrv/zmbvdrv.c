@@ -30,8 +30,12 @@
 
 #include "vice.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include "archdep.h"
 #include "cmdline.h"
@@ -76,6 +80,9 @@
 /* each KEYFRAME_INTERVAL frame will be key one */
 #define KEYFRAME_INTERVAL  (300)
 
+/* captured frames and sound chunks waiting for the encoder thread */
+#define JOB_SLOTS   4
+
 /******************************************************************************/
 
 static int frameno = 0;
@@ -85,9 +92,44 @@ static zmvb_init_flags_t iflg = ZMBV_INIT_FLAG_NONE;
 static int complevel = -1;  /* compression level, -1 means default */
 static int no_zlib = 0;
 
-static uint8_t cur_pal[PALETTE_SIZE];
+/*
+ * The frames and the sound are encoded and written to the file by an encoder
+ * thread, in the order they were captured.  The emulation (and the sound
+ * system for the audio) only copies them into one of JOB_SLOTS slots and
+ * waits for a free slot if the encoder falls behind, so nothing is dropped.
+ * The encoder thread searches the blocks of a delta frame together with
+ * helper threads (see zmbv_encode_set_threads()), the file is the same as
+ * when encoding on one thread.
+ */
 
-static int16_t cur_audio[MAX_AUDIO_BUFFER_SIZE];
+typedef enum {
+    JOB_VIDEO,
+    JOB_AUDIO
+} zmbvdrv_job_type_t;
+
+typedef struct zmbvdrv_job_s {
+    zmbvdrv_job_type_t type;
+    int frameno;
+    int flags;                                  /* ZMBV_PREP_FLAG_* */
+    uint8_t *screen;                            /* video_width * video_height */
+    uint8_t pal[PALETTE_SIZE];
+    int16_t audio[MAX_AUDIO_BUFFER_SIZE];
+    int audio_bytes;
+} zmbvdrv_job_t;
+
+static zmbvdrv_job_t jobs[JOB_SLOTS];
+static int job_first = 0;       /* oldest queued job */
+static int job_count = 0;       /* queued jobs */
+
+static pthread_t encoder_thread;
+static int encoder_running = 0;
+static int encoder_quit = 0;
+static int encoder_failed = 0;
+
+/* Protect the job queue and the encoder flags.  */
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done_cond = PTHREAD_COND_INITIALIZER;
 
 static zmbv_avi_t zavi;
 static zmbv_codec_t zcodec;
@@ -99,8 +141,6 @@ static void *video_work_buffer = NULL;
 static int video_codec;
 static int audio_codec;
 
-static uint8_t *cur_screen = NULL;
-
 /* general */
 static int file_init_done = 1;
 
@@ -254,6 +294,169 @@ static int zmbvdrv_cmdline_options_init(void)
 
 /*---------------------------------------------------------------------*/
 
+/*----------------*/
+/* encoder thread */
+/*----------------*/
+
+/* encode and write one queued frame or sound chunk, called by the encoder thread */
+static int zmbvdrv_encode_job(zmbvdrv_job_t *job)
+{
+    int32_t written;
+    int y;
+
+    if (job->type == JOB_AUDIO) {
+        if (zmbv_avi_write_chunk_audio(zavi, job->audio, job->audio_bytes) < 0) {
+            LOG(("FATAL: can't write audio frame for screen #%d", job->frameno));
+            return -1;
+        }
+        return 0;
+    }
+
+    if (zmbv_encode_prepare_frame(zcodec, job->flags, fmt, job->pal, video_work_buffer, work_buffer_size) < 0) {
+        LOG(("FATAL: can't prepare frame for screen #%d\n", job->frameno));
+        return -1;
+    }
+    for (y = 0; y < video_height; ++y) {
+        if (zmbv_encode_line(zcodec, job->screen + (y * video_width)) < 0) {
+            LOG(("FATAL: can't encode line #%d for screen #%d\n", y, job->frameno));
+            return -1;
+        }
+    }
+    written = zmvb_encode_finish_frame(zcodec);
+    if (written < 0) {
+        LOG(("FATAL: can't finish frame for screen #%d\n", job->frameno));
+        return -1;
+    }
+    /* write avi chunk */
+    if (zmbv_avi_write_chunk_video(zavi, video_work_buffer, written) < 0) {
+        LOG(("FATAL: can't write compressed frame for screen #%d\n", job->frameno));
+        return -1;
+    }
+    return 0;
+}
+
+static void *zmbvdrv_encoder_main(void *unused)
+{
+    zmbvdrv_job_t *job;
+    int failed;
+
+    for (;;) {
+        pthread_mutex_lock(&job_lock);
+        while (job_count == 0 && !encoder_quit) {
+            pthread_cond_wait(&job_queued_cond, &job_lock);
+        }
+        if (job_count == 0) {
+            /* quit only once everything queued has been written */
+            pthread_mutex_unlock(&job_lock);
+            break;
+        }
+        job = &jobs[job_first];
+        failed = encoder_failed;
+        pthread_mutex_unlock(&job_lock);
+
+        /* the slot stays ours until it is released below */
+        if (!failed && zmbvdrv_encode_job(job) < 0) {
+            failed = 1;
+        }
+
+        pthread_mutex_lock(&job_lock);
+        encoder_failed = failed;
+        job_first = (job_first + 1) % JOB_SLOTS;
+        job_count--;
+        pthread_cond_broadcast(&job_done_cond);
+        pthread_mutex_unlock(&job_lock);
+    }
+
+    return NULL;
+}
+
+/* number of threads searching the blocks of a frame, the encoder thread included */
+static int zmbvdrv_search_threads(void)
+{
+    int threads = 1;
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* leave one core to the emulation */
+    if (cpus > 2) {
+        threads = (int)(cpus - 1);
+    }
+#endif
+    if (threads > ZMBV_MAX_THREADS) {
+        threads = ZMBV_MAX_THREADS;
+    }
+    return threads;
+}
+
+/* called by zmbvdrv_save */
+static int zmbvdrv_encoder_start(void)
+{
+    int threads = zmbvdrv_search_threads();
+
+    if (zmbv_encode_set_threads(zcodec, threads) < 0) {
+        /* not fatal, the frames are searched by the encoder thread alone */
+        log_warning(LOG_DEFAULT, "zmbvdrv: Cannot start %d search threads", threads);
+        threads = 1;
+    }
+
+    job_first = 0;
+    job_count = 0;
+    encoder_quit = 0;
+    encoder_failed = 0;
+
+    if (pthread_create(&encoder_thread, NULL, zmbvdrv_encoder_main, NULL) != 0) {
+        log_error(LOG_DEFAULT, "zmbvdrv: Cannot start encoder thread");
+        return -1;
+    }
+    encoder_running = 1;
+    LOG(("zmbvdrv_encoder_start: encoding with %d search threads", threads));
+    return 0;
+}
+
+/* called by zmbvdrv_close, writes out all queued jobs before returning */
+static void zmbvdrv_encoder_stop(void)
+{
+    if (!encoder_running) {
+        return;
+    }
+    pthread_mutex_lock(&job_lock);
+    encoder_quit = 1;
+    pthread_cond_signal(&job_queued_cond);
+    pthread_mutex_unlock(&job_lock);
+
+    pthread_join(encoder_thread, NULL);
+    encoder_running = 0;
+}
+
+/*
+ * Reserve the next free job slot, waiting for the encoder thread if all are
+ * queued.  Returns with job_lock held (to be released by zmbvdrv_job_end()),
+ * since frames and sound chunks may be queued by different threads, or NULL
+ * if the encoder is not running or failed.
+ */
+static zmbvdrv_job_t *zmbvdrv_job_begin(void)
+{
+    pthread_mutex_lock(&job_lock);
+    while (encoder_running && !encoder_failed && job_count == JOB_SLOTS) {
+        pthread_cond_wait(&job_done_cond, &job_lock);
+    }
+    if (!encoder_running || encoder_failed) {
+        pthread_mutex_unlock(&job_lock);
+        return NULL;
+    }
+    return &jobs[(job_first + job_count) % JOB_SLOTS];
+}
+
+/* queue (or drop, if queue is 0) the slot returned by zmbvdrv_job_begin() */
+static void zmbvdrv_job_end(int queue)
+{
+    if (queue) {
+        job_count++;
+        pthread_cond_signal(&job_queued_cond);
+    }
+    pthread_mutex_unlock(&job_lock);
+}
+
 /*-----------------------*/
 /* audio stream encoding */
 /*-----------------------*/
@@ -320,43 +523,46 @@ static int zmbv_soundmovie_init(int speed, int channels, soundmovie_buffer_t **
 /* triggered by soundffmpegaudio->write */
 static int zmbv_soundmovie_encode(soundmovie_buffer_t *audio_in)
 {
+    zmbvdrv_job_t *job;
     int ret = 0;
 
     LOGFRAMES(("zmbv_soundmovie_encode(size:%d used:%d channels:%d)",
                audio_in->size, audio_in->used, audio_channels));
 
+    job = zmbvdrv_job_begin();
+    if (job == NULL) {
+        audio_in->used = 0;
+        return -1;
+    }
+    job->type = JOB_AUDIO;
+    job->frameno = frameno;
+    job->audio_bytes = 0;
+
     /* FIXME: we might have an endianess problem here, we might have to swap lo/hi on BE machines */
     if (audio_channels == 1) {
         int i, o;
 #if 1
         /* convert mono -> stereo */
-        for (i = o = 0; i < audio_in->used; i++, o+=2) {
-            cur_audio[o] = audio_in->buffer[i];
-            cur_audio[o+1] = audio_in->buffer[i];
-        }
-        /* write avi chunks */
-        if (zmbv_avi_write_chunk_audio(zavi, &cur_audio[0], audio_in->used * 4) < 0) {
-            LOG(("FATAL: can't write audio frame for screen #%d", frameno));
-            ret = -1;
+        for (i = o = 0; i < audio_in->used && o + 1 < MAX_AUDIO_BUFFER_SIZE; i++, o+=2) {
+            job->audio[o] = audio_in->buffer[i];
+            job->audio[o+1] = audio_in->buffer[i];
         }
+        job->audio_bytes = o * 2;
 #else
         /* FIXME: we should write the mono stream into the avi instead */
 #endif
     } else if (audio_channels == 2) {
-        int i, o;
-        for (i = o = 0; i < audio_in->used; i+=2, o+=2) {
-            cur_audio[o] = audio_in->buffer[i];
-            cur_audio[o+1] = audio_in->buffer[i+1];
-        }
-        /* write avi chunks */
-        if (zmbv_avi_write_chunk_audio(zavi, &audio_in->buffer[0], audio_in->used * 2) < 0) {
-            LOG(("FATAL: can't write audio frame for screen #%d", frameno));
-            ret = -1;
+        int i;
+        for (i = 0; i < audio_in->used && i < MAX_AUDIO_BUFFER_SIZE; i++) {
+            job->audio[i] = audio_in->buffer[i];
         }
+        job->audio_bytes = i * 2;
     } else {
         ret = -1;
     }
 
+    zmbvdrv_job_end(ret == 0);
+
     audio_in->used = 0;
     return ret;
 }
@@ -379,7 +585,7 @@ static soundmovie_funcs_t zmbvdrv_soundmovie_funcs = {
 /*-----------------------*/
 /* video stream encoding */
 /*-----------------------*/
-static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
+static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot, uint8_t *cur_screen, uint8_t *cur_pal)
 {
     int x, y;
     int dx, dy;
@@ -397,7 +603,9 @@ static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
     bufferoffset = screenshot->x_offset + (dx < 0 ? -dx : 0)
         + (screenshot->y_offset + (dy < 0 ? -dy : 0)) * screenshot->draw_buffer_line_size;
 
-    for (x = 0; x < PALETTE_NUM_COLORS; x++) {
+    /* the draw buffer holds palette indices, the frame is stored as is */
+    memset(cur_pal, 0, PALETTE_SIZE);
+    for (x = 0; x < PALETTE_NUM_COLORS && x < (int)screenshot->palette->num_entries; x++) {
         cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 0] = screenshot->palette->entries[x].red;
         cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 1] = screenshot->palette->entries[x].green;
         cur_pal[(x * (PALETTE_COLORS_BPP / 8)) + 2] = screenshot->palette->entries[x].blue;
@@ -405,9 +613,7 @@ static int zmbvdrv_fill_rgb_image(screenshot_t *screenshot)
 
     LOGFRAMES(("zmbvdrv_fill_rgb_image video_width/height: %dx%d\n", video_width, video_height));
     for (y = 0; y < video_height; y++) {
-        for (x = 0; x < video_width; x++) {
-            cur_screen[(y * video_width) + x] = screenshot->draw_buffer[bufferoffset + x];
-        }
+        memcpy(cur_screen + (y * video_width), screenshot->draw_buffer + bufferoffset, video_width);
         bufferoffset += screenshot->draw_buffer_line_size;
     }
     LOGFRAMES(("zmbvdrv_fill_rgb_image done\n"));
@@ -425,25 +631,33 @@ static uint8_t *zmbvdrv_alloc_picture(int width, int height)
 /* called by zmbvdrv_init_file() */
 static int zmbvdrv_open_video(int width, int height)
 {
+    int i;
+
     LOG(("zmbvdrv_open_video width:%d height:%d", width, height));
     /* MOVE? open the codec */
-    video_is_open = 1;
     /* FIXME: allocate the encoded raw picture */
-    cur_screen = zmbvdrv_alloc_picture(width, height);
-    if (cur_screen == NULL) {
-        return -1;
+    for (i = 0; i < JOB_SLOTS; i++) {
+        jobs[i].screen = zmbvdrv_alloc_picture(width, height);
+        if (jobs[i].screen == NULL) {
+            return -1;
+        }
     }
+    video_is_open = 1;
     return 0;
 }
 
 /* called by zmbvdrv_close() */
 static void zmbvdrv_close_video(void)
 {
+    int i;
+
     LOG(("zmbvdrv_close_video"));
     video_is_open = 0;
-    if (cur_screen != NULL) {
-        lib_free (cur_screen);
-        cur_screen = NULL;
+    for (i = 0; i < JOB_SLOTS; i++) {
+        if (jobs[i].screen != NULL) {
+            lib_free(jobs[i].screen);
+            jobs[i].screen = NULL;
+        }
     }
 }
 /* called by zmbvdrv_save */
@@ -541,6 +755,12 @@ static int zmbvdrv_save(screenshot_t *screenshot, const char *filename)
 
     frameno = 0;
 
+    if (zmbvdrv_encoder_start() < 0) {
+        free(video_work_buffer);
+        video_work_buffer = NULL;
+        return -1;
+    }
+
     soundmovie_start(&zmbvdrv_soundmovie_funcs);
 
     return 0;
@@ -553,6 +773,9 @@ static int zmbvdrv_close(screenshot_t *screenshot)
 
     soundmovie_stop();
 
+    /* wait until everything captured is in the file */
+    zmbvdrv_encoder_stop();
+
     zmbvdrv_close_video();
     zmbvdrv_close_audio();
 
@@ -576,49 +799,33 @@ static int zmbvdrv_close(screenshot_t *screenshot)
 /* triggered by screenshot_record, periodically called to output video data stream */
 static int zmbvdrv_record(screenshot_t *screenshot)
 {
-    int ret = -1;
-    int32_t written;
-    int flags;
+    zmbvdrv_job_t *job;
 
     if (audio_init_done && video_init_done && !file_init_done) {
         zmbvdrv_init_file();
     }
 
-    zmbvdrv_fill_rgb_image(screenshot);
+    if (!video_is_open) {
+        return 0;
+    }
 
-    flags = ((frameno % KEYFRAME_INTERVAL == 0) ? ZMBV_PREP_FLAG_KEYFRAME : ZMBV_PREP_FLAG_NONE);
+    /* waits for the encoder thread if it is JOB_SLOTS frames behind */
+    job = zmbvdrv_job_begin();
+    if (job == NULL) {
+        log_debug("Error while writing video frame");
+        return -1;
+    }
+
+    job->type = JOB_VIDEO;
+    job->flags = ((frameno % KEYFRAME_INTERVAL == 0) ? ZMBV_PREP_FLAG_KEYFRAME : ZMBV_PREP_FLAG_NONE);
+    zmbvdrv_fill_rgb_image(screenshot, job->screen, job->pal);
 
     frameno++;
+    job->frameno = frameno;
 
     LOGFRAMES(("zmbvdrv_record: frame %d\n", frameno));
 
-    /* encode video frame */
-    if (zmbv_encode_prepare_frame(zcodec, flags, fmt, cur_pal, video_work_buffer, work_buffer_size) < 0) {
-        LOG(("FATAL: can't prepare frame for screen #%d\n", frameno));
-        goto quit;
-    }
-    for (int y = 0; y < video_height; ++y) {
-        if (zmbv_encode_line(zcodec, cur_screen+(y*video_width)) < 0) {
-            LOG(("FATAL: can't encode line #%d for screen #%d\n", y, frameno));
-            goto quit;
-        }
-    }
-    written = zmvb_encode_finish_frame(zcodec);
-    if (written < 0) {
-        LOG(("FATAL: can't finish frame for screen #%d\n", frameno));
-        goto quit;
-    }
-    /* write avi chunk */
-    if (zmbv_avi_write_chunk_video(zavi, video_work_buffer, written) < 0) {
-        LOG(("FATAL: can't write compressed frame for screen #%d\n", frameno));
-        goto quit;
-    }
-    ret = 0;
-quit:
-    if (ret < 0) {
-        log_debug("Error while writing video frame");
-        return -1;
-    }
+    zmbvdrv_job_end(1);
 
     return 0;
 }
@@ -42,6 +42,7 @@ int hardsid_read(uint16_t addr, int chipno);
 void hardsid_store(uint16_t addr, uint8_t val, int chipno);
 void hardsid_set_machine_parameter(long cycles_per_sec);
 void hardsid_set_device(unsigned int chipno, unsigned int device);
+void hardsid_set_latency(int ms);
 
 int hardsid_drv_open(void);
 int hardsid_drv_close(void);
@@ -50,6 +51,7 @@ int hardsid_drv_read(uint16_t addr, int chipno);
 void hardsid_drv_store(uint16_t addr, uint8_t val, int chipno);
 int hardsid_drv_available(void);
 void hardsid_drv_set_device(unsigned int chipno, unsigned int device);
+void hardsid_drv_set_latency(int ms);
 
 void hardsid_state_read(int chipno, struct sid_hs_snapshot_state_s *sid_state);
 void hardsid_state_write(int chipno, struct sid_hs_snapshot_state_s *sid_state);
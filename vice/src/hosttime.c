@@ -0,0 +1,225 @@
+/*
+ * hosttime.c - Host time spent per emulator subsystem.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With `SubsystemTiming' enabled, the host time of the emulation thread is
+   charged to whichever subsystem is currently running; time that is not
+   inside one of the instrumented calls goes to the CPU.  The counts are
+   published once per frame and, summed up, once per second of host time.
+
+   On x86 the time stamp counter is read, which costs a few dozen cycles;
+   the counts are converted to nanoseconds with the rate measured against
+   tick_now() over the previous window.  Elsewhere tick_now() is used
+   directly.  */
+
+#include "vice.h"
+
+#include <string.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "hosttime.h"
+#include "resources.h"
+#include "types.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+typedef uint64_t hosttime_count_t;
+#define HOSTTIME_COUNT()    ((hosttime_count_t)__builtin_ia32_rdtsc())
+#else
+typedef tick_t hosttime_count_t;
+#define HOSTTIME_COUNT()    tick_now()
+#endif
+
+#ifdef USE_VICE_THREAD
+#   include <pthread.h>
+static pthread_mutex_t hosttime_lock = PTHREAD_MUTEX_INITIALIZER;
+#   define STATS_LOCK() pthread_mutex_lock(&hosttime_lock)
+#   define STATS_UNLOCK() pthread_mutex_unlock(&hosttime_lock)
+#else
+#   define STATS_LOCK()
+#   define STATS_UNLOCK()
+#endif
+
+int hosttime_enabled = 0;
+
+static hosttime_subsystem_t current = HOSTTIME_CPU;
+static hosttime_count_t last_count;
+
+static uint64_t frame_count[HOSTTIME_NUM];
+static uint64_t window_count[HOSTTIME_NUM];
+static unsigned int window_frames;
+static hosttime_count_t window_start_count;
+static tick_t window_start_tick;
+
+/* Measured over the previous window, 0 until the first one is complete.  */
+static double ns_per_count = 0.0;
+
+/* Protected by STATS_LOCK().  */
+static hosttime_stats_t stats;
+
+static const char * const subsystem_names[HOSTTIME_NUM] = {
+    "cpu", "drive", "sound", "raster", "refresh", "sync"
+};
+
+/* ------------------------------------------------------------------------- */
+
+static void hosttime_charge(void)
+{
+    hosttime_count_t now = HOSTTIME_COUNT();
+
+    frame_count[current] += (hosttime_count_t)(now - last_count);
+    last_count = now;
+}
+
+int hosttime_enter(hosttime_subsystem_t subsystem)
+{
+    int previous = (int)current;
+
+    hosttime_charge();
+    current = subsystem;
+    return previous;
+}
+
+void hosttime_leave(int previous)
+{
+    hosttime_charge();
+    current = (hosttime_subsystem_t)previous;
+}
+
+static void hosttime_reset(void)
+{
+    current = HOSTTIME_CPU;
+    last_count = HOSTTIME_COUNT();
+    window_start_count = last_count;
+    window_start_tick = tick_now();
+    window_frames = 0;
+    ns_per_count = 0.0;
+    memset(frame_count, 0, sizeof(frame_count));
+    memset(window_count, 0, sizeof(window_count));
+
+    STATS_LOCK();
+    memset(stats.window_ns, 0, sizeof(stats.window_ns));
+    memset(stats.frame_ns, 0, sizeof(stats.frame_ns));
+    stats.frames = 0;
+    stats.serial++;
+    STATS_UNLOCK();
+}
+
+void hosttime_frame_end(void)
+{
+    tick_t elapsed;
+    int i;
+
+    if (!hosttime_enabled) {
+        return;
+    }
+
+    hosttime_charge();
+
+    for (i = 0; i < HOSTTIME_NUM; i++) {
+        window_count[i] += frame_count[i];
+    }
+    window_frames++;
+
+    STATS_LOCK();
+
+    elapsed = tick_now_delta(window_start_tick);
+    if (elapsed >= tick_per_second()) {
+        hosttime_count_t counted = (hosttime_count_t)(last_count - window_start_count);
+
+        if (counted != 0) {
+            ns_per_count = (double)TICK_TO_NANO(elapsed) / (double)counted;
+        }
+        for (i = 0; i < HOSTTIME_NUM; i++) {
+            stats.window_ns[i] = (uint64_t)(window_count[i] * ns_per_count);
+            window_count[i] = 0;
+        }
+        stats.frames = window_frames;
+        stats.serial++;
+
+        window_frames = 0;
+        window_start_count = last_count;
+        window_start_tick += elapsed;
+    }
+
+    for (i = 0; i < HOSTTIME_NUM; i++) {
+        stats.frame_ns[i] = (uint64_t)(frame_count[i] * ns_per_count);
+        frame_count[i] = 0;
+    }
+
+    STATS_UNLOCK();
+}
+
+int hosttime_get_stats(hosttime_stats_t *s)
+{
+    STATS_LOCK();
+    *s = stats;
+    STATS_UNLOCK();
+
+    return hosttime_enabled;
+}
+
+const char *hosttime_subsystem_name(hosttime_subsystem_t subsystem)
+{
+    return subsystem_names[subsystem];
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_subsystem_timing(int val, void *param)
+{
+    val = val ? 1 : 0;
+
+    if (val && !hosttime_enabled) {
+        hosttime_reset();
+    }
+    hosttime_enabled = val;
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "SubsystemTiming", 0, RES_EVENT_NO, NULL,
+      &hosttime_enabled, set_subsystem_timing, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int hosttime_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-subsystemtiming", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SubsystemTiming", (void *)1,
+      NULL, "Measure the host time spent in the CPU, drives, sound, video and sync" },
+    { "+subsystemtiming", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SubsystemTiming", (void *)0,
+      NULL, "Do not measure the host time per subsystem" },
+    CMDLINE_LIST_END
+};
+
+int hosttime_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,70 @@
+/*
+ * hosttime.h - Host time spent per emulator subsystem.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_HOSTTIME_H
+#define VICE_HOSTTIME_H
+
+#include "types.h"
+
+/* The order is part of the binary monitor protocol.  */
+typedef enum hosttime_subsystem_e {
+    HOSTTIME_CPU,       /* main CPU, chips and everything not listed below */
+    HOSTTIME_DRIVE,     /* drive_cpu_execute_all() */
+    HOSTTIME_SOUND,     /* sound_run_sound() */
+    HOSTTIME_RASTER,    /* raster_line_emulate() */
+    HOSTTIME_REFRESH,   /* raster_canvas_handle_end_of_frame() */
+    HOSTTIME_SYNC,      /* vsync, including waiting for the host */
+    HOSTTIME_NUM
+} hosttime_subsystem_t;
+
+typedef struct hosttime_stats_s {
+    unsigned int serial;                /* incremented for every new window */
+    unsigned int frames;                /* frames in the last window */
+    uint64_t window_ns[HOSTTIME_NUM];   /* host time in the last window */
+    uint64_t frame_ns[HOSTTIME_NUM];    /* host time in the last frame */
+} hosttime_stats_t;
+
+extern int hosttime_enabled;
+
+/* Charge the host time from now on to `subsystem', until the matching
+   HOSTTIME_LEAVE().  Calls nest and must only be made on the emulation
+   thread.  */
+#define HOSTTIME_ENTER(subsystem) \
+    (hosttime_enabled ? hosttime_enter(subsystem) : -1)
+#define HOSTTIME_LEAVE(previous) \
+    do { if ((previous) >= 0) { hosttime_leave(previous); } } while (0)
+
+int hosttime_enter(hosttime_subsystem_t subsystem);
+void hosttime_leave(int previous);
+
+/* Called at the end of every emulated frame.  */
+void hosttime_frame_end(void);
+
+/* Copy the last published counters; returns 0 if they are disabled.  */
+int hosttime_get_stats(hosttime_stats_t *stats);
+const char *hosttime_subsystem_name(hosttime_subsystem_t subsystem);
+
+int hosttime_resources_init(void);
+int hosttime_cmdline_options_init(void);
+
+#endif
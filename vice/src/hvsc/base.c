@@ -861,3 +861,100 @@ bool hvsc_md5_digest(const char *psid, char *digest)
 
     return true;
 }
+
+
+/** \brief  Hash \a len bytes of string \a s (FNV-1a)
+ *
+ * \param[in]   s   string
+ * \param[in]   len number of bytes to hash
+ *
+ * \return  hash
+ */
+uint32_t hvsc_hash(const char *s, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    size_t   i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+/** \brief  Initialize hash \a table for up to \a count entries
+ *
+ * \param[out]  table   hash table
+ * \param[in]   count   number of entries
+ */
+void hvsc_hash_table_init(hvsc_hash_table_t *table, size_t count)
+{
+    size_t size = 16;
+
+    /* keep it at most half full */
+    while (size < count * 2) {
+        size *= 2;
+    }
+    table->slots = hvsc_calloc(size, sizeof *(table->slots));
+    table->mask = size - 1;
+}
+
+
+/** \brief  Free the memory used by hash \a table
+ *
+ * \param[in,out]   table   hash table
+ */
+void hvsc_hash_table_free(hvsc_hash_table_t *table)
+{
+    hvsc_free(table->slots);
+    table->slots = NULL;
+    table->mask = 0;
+}
+
+
+/** \brief  Add array \a index with \a hash to hash \a table
+ *
+ * \param[in,out]   table   hash table
+ * \param[in]       hash    hash of the key of the entry
+ * \param[in]       index   index of the entry in its array
+ */
+void hvsc_hash_table_add(hvsc_hash_table_t *table, uint32_t hash, size_t index)
+{
+    size_t i = hash & table->mask;
+
+    while (table->slots[i] != 0) {
+        i = (i + 1) & table->mask;
+    }
+    table->slots[i] = (uint32_t)(index + 1);
+}
+
+
+/** \brief  Find the entry for \a key in hash \a table
+ *
+ * The entries added first are found first.
+ *
+ * \param[in]   table   hash table
+ * \param[in]   hash    hash of \a key
+ * \param[in]   match   function checking whether the entry at an index has
+ *                      \a key
+ * \param[in]   key     key
+ *
+ * \return  index of the entry or -1 when not found
+ */
+long hvsc_hash_table_find(const hvsc_hash_table_t *table, uint32_t hash,
+                          bool (*match)(size_t index, const void *key),
+                          const void *key)
+{
+    size_t i;
+
+    if (table->slots == NULL) {
+        return -1;
+    }
+    for (i = hash & table->mask; table->slots[i] != 0; i = (i + 1) & table->mask) {
+        if (match(table->slots[i] - 1, key)) {
+            return (long)(table->slots[i] - 1);
+        }
+    }
+    return -1;
+}
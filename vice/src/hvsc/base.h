@@ -65,6 +65,14 @@
 #endif
 
 
+/** \brief  Hash table of indexes into an array (open addressing)
+ */
+typedef struct hvsc_hash_table_s {
+    uint32_t *slots;    /**< index + 1 of the entries, 0 for an empty slot */
+    size_t    mask;     /**< number of slots - 1 */
+} hvsc_hash_table_t;
+
+
 extern char *hvsc_root_path;
 extern char *hvsc_sldb_path;
 extern char *hvsc_stil_path;
@@ -101,4 +109,13 @@ void        hvsc_get_longword_be(uint32_t *dest, const uint8_t *src);
 
 bool        hvsc_md5_digest(const char *psid, char *digest);
 
+uint32_t    hvsc_hash(const char *s, size_t len);
+void        hvsc_hash_table_init(hvsc_hash_table_t *table, size_t count);
+void        hvsc_hash_table_free(hvsc_hash_table_t *table);
+void        hvsc_hash_table_add(hvsc_hash_table_t *table, uint32_t hash,
+                                size_t index);
+long        hvsc_hash_table_find(const hvsc_hash_table_t *table, uint32_t hash,
+                                 bool (*match)(size_t index, const void *key),
+                                 const void *key);
+
 #endif
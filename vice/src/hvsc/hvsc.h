@@ -326,6 +326,8 @@ char *      hvsc_sldb_get_entry_txt   (const char *psid);
 int         hvsc_sldb_get_lengths     (const char *psid, long **lengths);
 int         hvsc_sldb_get_lengths_md5 (const char *digest, long **lengths);
 char *      hvsc_sldb_get_path_for_md5(const char *digest);
+bool        hvsc_sldb_load            (void);
+void        hvsc_sldb_unload          (void);
 
 /*
  * stil.c stuff
@@ -338,6 +340,7 @@ bool        hvsc_stil_read_entry (hvsc_stil_t *handle);
 void        hvsc_stil_dump_entry (hvsc_stil_t *handle);
 void        hvsc_stil_parse_entry(hvsc_stil_t *handle);
 void        hvsc_stil_dump       (hvsc_stil_t *handle);
+void        hvsc_stil_unload     (void);
 
 /* XXX: needs much better name
  *
@@ -73,6 +73,10 @@ bool hvsc_init(const char *path)
 {
     hvsc_errno = 0;
 
+    /* a loaded SLDB and STIL index belong to the previous path */
+    hvsc_sldb_unload();
+    hvsc_stil_unload();
+
     if (path == NULL || *path == '\0') {
         path = getenv("HVSC_BASE");
     }
@@ -97,6 +101,8 @@ bool hvsc_init(const char *path)
  */
 void hvsc_exit(void)
 {
+    hvsc_sldb_unload();
+    hvsc_stil_unload();
     hvsc_free_paths();
 }
 
@@ -91,6 +91,212 @@ static bool create_md5_hash(const char *psid, unsigned char *digest)
 #endif
 
 
+/** \brief  SLDB entry in the copy of the SLDB loaded with hvsc_sldb_load()
+ */
+typedef struct sldb_index_s {
+    const char *entry;  /**< "<md5>=<lengths>" line */
+    const char *path;   /**< path in the "; <path>" line above it, or `NULL` */
+} sldb_index_t;
+
+
+/** \brief  Contents of the SLDB, split into lines
+ */
+static char *sldb_data = NULL;
+
+/** \brief  Entries of the SLDB, in the order of the file
+ */
+static sldb_index_t *sldb_index = NULL;
+
+/** \brief  Number of entries in \a sldb_index
+ */
+static size_t sldb_index_count = 0;
+
+/** \brief  Entries of \a sldb_index by md5 digest
+ */
+static hvsc_hash_table_t sldb_md5_table;
+
+/** \brief  Entries of \a sldb_index by HVSC path
+ */
+static hvsc_hash_table_t sldb_path_table;
+
+/** \brief  Loading the SLDB on the first lookup failed, don't try again
+ */
+static bool sldb_load_failed = false;
+
+
+/** \brief  Check whether SLDB index entry \a index has md5 digest \a key
+ *
+ * \param[in]   index   index in \a sldb_index
+ * \param[in]   key     string representation of the MD5 digest (32 bytes)
+ *
+ * \return  bool
+ */
+static bool sldb_match_md5(size_t index, const void *key)
+{
+    return memcmp(sldb_index[index].entry, key, HVSC_DIGEST_SIZE * 2) == 0;
+}
+
+
+/** \brief  Check whether SLDB index entry \a index has HVSC path \a key
+ *
+ * \param[in]   index   index in \a sldb_index
+ * \param[in]   key     relative path in the HVSC
+ *
+ * \return  bool
+ */
+static bool sldb_match_path(size_t index, const void *key)
+{
+    return sldb_index[index].path != NULL
+           && strcmp(sldb_index[index].path, key) == 0;
+}
+
+
+/** \brief  Look up md5 \a digest in the loaded SLDB
+ *
+ * \param[in]   digest  string representation of the MD5 digest (32 bytes)
+ *
+ * \return  index entry or `NULL` when not found
+ */
+static const sldb_index_t *sldb_index_find(const char *digest)
+{
+    long i = hvsc_hash_table_find(&sldb_md5_table,
+                                  hvsc_hash(digest, HVSC_DIGEST_SIZE * 2),
+                                  sldb_match_md5, digest);
+
+    return i >= 0 ? &sldb_index[i] : NULL;
+}
+
+
+/** \brief  Look up HVSC \a path in the loaded SLDB
+ *
+ * \param[in]   path    relative path in the HVSC
+ *
+ * \return  index entry or `NULL` when not found
+ */
+static const sldb_index_t *sldb_index_find_path(const char *path)
+{
+    long i = hvsc_hash_table_find(&sldb_path_table,
+                                  hvsc_hash(path, strlen(path)),
+                                  sldb_match_path, path);
+
+    return i >= 0 ? &sldb_index[i] : NULL;
+}
+
+
+/** \brief  Load the SLDB for the lookups unless that was done or failed
+ *
+ * \return  `true` if the SLDB is loaded
+ */
+static bool sldb_load_on_demand(void)
+{
+    if (sldb_data == NULL && !sldb_load_failed) {
+        sldb_load_failed = !hvsc_sldb_load();
+    }
+    return sldb_data != NULL;
+}
+
+
+/** \brief  Load the SLDB into memory
+ *
+ * Reads the SLDB once and indexes it by md5 digest and by path, so the
+ * lookups of the functions below no longer scan the file.  They call this
+ * on their first use; the data is never written after loading, so processes
+ * forked after calling this can share it.
+ *
+ * \return  `true` on success
+ */
+bool hvsc_sldb_load(void)
+{
+    uint8_t *data;
+    char    *line;
+    char    *prev = NULL;
+    long     size;
+    size_t   count = 0;
+    size_t   alloc = 4096;
+
+    hvsc_sldb_unload();
+
+    if (hvsc_sldb_path == NULL) {
+        hvsc_errno = HVSC_ERR_INVALID;
+        return false;
+    }
+    size = hvsc_read_file(&data, hvsc_sldb_path);
+    if (size < 0) {
+        return false;
+    }
+    sldb_data = hvsc_realloc(data, (size_t)size + 1);
+    sldb_data[size] = '\0';
+    sldb_index = hvsc_malloc(alloc * sizeof *sldb_index);
+
+    line = sldb_data;
+    while (*line != '\0') {
+        char   *eol = strchr(line, '\n');
+        char   *next = eol != NULL ? eol + 1 : line + strlen(line);
+        size_t  len;
+
+        /* split the lines, stripping Windows CRs */
+        if (eol != NULL) {
+            *eol = '\0';
+        }
+        len = strlen(line);
+        if (len > 0 && line[len - 1] == '\r') {
+            line[--len] = '\0';
+        }
+
+        if (len > HVSC_DIGEST_SIZE * 2
+                && isxdigit((unsigned char)*line)
+                && line[HVSC_DIGEST_SIZE * 2] == '=') {
+            if (count == alloc) {
+                alloc *= 2;
+                sldb_index = hvsc_realloc(sldb_index, alloc * sizeof *sldb_index);
+            }
+            sldb_index[count].entry = line;
+            sldb_index[count].path = (prev != NULL && prev[0] == ';' && prev[1] != '\0')
+                                     ? prev + 2 : NULL;
+            count++;
+        }
+        prev = line;
+        line = next;
+    }
+
+    sldb_index_count = count;
+
+    hvsc_hash_table_init(&sldb_md5_table, count);
+    hvsc_hash_table_init(&sldb_path_table, count);
+    for (count = 0; count < sldb_index_count; count++) {
+        const sldb_index_t *index = &sldb_index[count];
+
+        hvsc_hash_table_add(&sldb_md5_table,
+                            hvsc_hash(index->entry, HVSC_DIGEST_SIZE * 2),
+                            count);
+        if (index->path != NULL) {
+            hvsc_hash_table_add(&sldb_path_table,
+                                hvsc_hash(index->path, strlen(index->path)),
+                                count);
+        }
+    }
+#ifndef HVSC_STANDALONE
+    log_message(LOG_DEFAULT, "VSID: Loaded %lu SLDB entries.", (unsigned long)sldb_index_count);
+#endif
+    return true;
+}
+
+
+/** \brief  Free the copy of the SLDB loaded with hvsc_sldb_load()
+ */
+void hvsc_sldb_unload(void)
+{
+    hvsc_hash_table_free(&sldb_md5_table);
+    hvsc_hash_table_free(&sldb_path_table);
+    hvsc_free(sldb_index);
+    hvsc_free(sldb_data);
+    sldb_index = NULL;
+    sldb_data = NULL;
+    sldb_index_count = 0;
+    sldb_load_failed = false;
+}
+
+
 /** \brief  Find SLDB entry by \a digest
  *
  * The \a digest has to be in the same string form as the SLDB. So 32 bytes
@@ -105,6 +311,12 @@ static char *find_sldb_entry_md5(const char *digest)
     hvsc_text_file_t  handle;
     const char       *line;
 
+    if (sldb_load_on_demand()) {
+        const sldb_index_t *index = sldb_index_find(digest);
+
+        return index != NULL ? hvsc_strdup(index->entry) : NULL;
+    }
+
     if (!hvsc_text_file_open(hvsc_sldb_path, &handle)) {
         return NULL;
     }
@@ -144,6 +356,12 @@ static char *find_sldb_entry_txt(const char *path)
     size_t            plen;
     const char       *line;
 
+    if (sldb_load_on_demand()) {
+        const sldb_index_t *index = sldb_index_find_path(path);
+
+        return index != NULL ? hvsc_strdup(index->entry) : NULL;
+    }
+
 #ifndef HVSC_STANDALONE
     log_message(LOG_DEFAULT, "VSID: Opening '%s'.", hvsc_sldb_path);
 #endif
@@ -374,6 +592,13 @@ char *hvsc_sldb_get_path_for_md5(const char *digest)
     int              lineno = 1;
 #endif
 
+    if (sldb_load_on_demand()) {
+        const sldb_index_t *index = sldb_index_find(digest);
+
+        return index != NULL && index->path != NULL
+               ? hvsc_strdup(index->path) : NULL;
+    }
+
     if (hvsc_text_file_open(hvsc_sldb_path, &handle)) {
         const char *line;
 
@@ -46,6 +46,31 @@
 #include "stil.h"
 
 
+/** \brief  Location of a STIL entry in STIL.txt
+ */
+typedef struct stil_index_s {
+    const char *path;   /**< path line of the entry, in \a stil_data */
+    long        offset; /**< file offset of the line following the path */
+    long        lineno; /**< line number of the path line */
+} stil_index_t;
+
+
+/** \brief  Contents of STIL.txt, the path lines terminated in place
+ */
+static uint8_t *stil_data = NULL;
+
+/** \brief  Entries of the STIL, in the order of the file
+ */
+static stil_index_t *stil_index = NULL;
+
+/** \brief  Entries of \a stil_index by path
+ */
+static hvsc_hash_table_t stil_path_table;
+
+/** \brief  Indexing the STIL failed, scan the file instead
+ */
+static bool stil_index_failed = false;
+
 
 /*
  * Forward declarations
@@ -424,6 +449,174 @@ static void stil_handle_add_block(hvsc_stil_t *handle, hvsc_stil_block_t *block)
 }
 
 
+/** \brief  Check whether STIL index entry \a index has path \a key
+ *
+ * \param[in]   index   index in \a stil_index
+ * \param[in]   key     relative path in the HVSC
+ *
+ * \return  bool
+ */
+static bool stil_match_path(size_t index, const void *key)
+{
+    return strcmp(stil_index[index].path, key) == 0;
+}
+
+
+/** \brief  Read STIL.txt once and index its entries by path
+ *
+ * Looking up an entry otherwise means reading the STIL line by line up to
+ * the entry, for each tune played.  The index only holds file offsets, the
+ * entry itself is still read through the handle's file pointer.
+ *
+ * \return  `true` if the index is available
+ */
+static bool stil_index_load(void)
+{
+    long    size;
+    long    pos;
+    long    lineno;
+    size_t  count;
+    size_t  max;
+
+    if (stil_data != NULL) {
+        return true;
+    }
+    if (stil_index_failed) {
+        return false;
+    }
+
+    size = hvsc_read_file(&stil_data, hvsc_stil_path);
+    if (size < 0) {
+        stil_data = NULL;
+        stil_index_failed = true;
+        return false;
+    }
+
+    max = 1024;
+    stil_index = hvsc_malloc(max * sizeof *stil_index);
+    count = 0;
+    lineno = 0;
+    pos = 0;
+    while (pos < size) {
+        char *line = (char *)stil_data + pos;
+        char *end = memchr(line, '\n', (size_t)(size - pos));
+        long next = end != NULL ? (long)(end - (char *)stil_data) + 1 : size;
+
+        lineno++;
+        if (*line == '/' && end != NULL) {
+            /* terminate the path in place, dropping a Windows CR */
+            if (end > line && end[-1] == '\r') {
+                end--;
+            }
+            *end = '\0';
+            if (count == max) {
+                max *= 2;
+                stil_index = hvsc_realloc(stil_index, max * sizeof *stil_index);
+            }
+            stil_index[count].path = line;
+            stil_index[count].offset = next;
+            stil_index[count].lineno = lineno;
+            count++;
+        }
+        pos = next;
+    }
+
+    hvsc_hash_table_init(&stil_path_table, count);
+    for (max = 0; max < count; max++) {
+        hvsc_hash_table_add(&stil_path_table,
+                            hvsc_hash(stil_index[max].path,
+                                      strlen(stil_index[max].path)),
+                            max);
+    }
+#ifndef HVSC_STANDALONE
+    log_message(LOG_DEFAULT, "VSID: Indexed %lu STIL entries.", (unsigned long)count);
+#endif
+    return true;
+}
+
+
+/** \brief  Free the STIL index
+ *
+ * Called when the HVSC root changes and on exit; the next lookup indexes
+ * the STIL again.
+ */
+void hvsc_stil_unload(void)
+{
+    hvsc_hash_table_free(&stil_path_table);
+    hvsc_free(stil_index);
+    hvsc_free(stil_data);
+    stil_index = NULL;
+    stil_data = NULL;
+    stil_index_failed = false;
+}
+
+
+/** \brief  Position the STIL file of \a handle after the entry's path line
+ *
+ * Uses the index when available, otherwise scans the file.  Closes \a handle
+ * when the entry isn't found.
+ *
+ * \param[in,out]   handle  STIL handle with psid_path set
+ *
+ * \return  bool
+ */
+static bool stil_find_entry(hvsc_stil_t *handle)
+{
+    const char *line;
+
+    if (stil_index_load()) {
+        long i = hvsc_hash_table_find(&stil_path_table,
+                                      hvsc_hash(handle->psid_path,
+                                                strlen(handle->psid_path)),
+                                      stil_match_path, handle->psid_path);
+
+        if (i < 0) {
+            hvsc_errno = HVSC_ERR_NOT_FOUND;
+#ifndef HVSC_STANDALONE
+            log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
+#endif
+            hvsc_stil_close(handle);
+            return false;
+        }
+        if (fseek(handle->stil.fp, stil_index[i].offset, SEEK_SET) != 0) {
+            hvsc_errno = HVSC_ERR_IO;
+            hvsc_stil_close(handle);
+            return false;
+        }
+        handle->stil.lineno = stil_index[i].lineno;
+#ifndef HVSC_STANDALONE
+        log_message(LOG_DEFAULT, "VSID: Found '%s' at line %ld.",
+                stil_index[i].path, handle->stil.lineno);
+#endif
+        return true;
+    }
+
+    while (true) {
+        line = hvsc_text_file_read(&(handle->stil));
+        if (line == NULL) {
+            if (feof(handle->stil.fp)) {
+                /* EOF, so simply not found */
+                hvsc_errno = HVSC_ERR_NOT_FOUND;
+#ifndef HVSC_STANDALONE
+                log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
+#endif
+            }
+            hvsc_stil_close(handle);
+            /* I/O error is already set */
+            return false;
+        }
+
+        if (strcmp(line, handle->psid_path) == 0) {
+#ifndef HVSC_STANDALONE
+            log_message(LOG_DEFAULT,
+                    "VSID: Found '%s' at line %ld.", line, handle->stil.lineno);
+#endif
+            return true;
+        }
+    }
+}
+
+
 /** \brief  Open STIL and look for PSID file \a psid
  *
  * \param[in]   psid    path to PSID file
@@ -433,8 +626,6 @@ static void stil_handle_add_block(hvsc_stil_t *handle, hvsc_stil_block_t *block)
  */
 bool hvsc_stil_open(const char *psid, hvsc_stil_t *handle)
 {
-    const char *line;
-
     stil_init_handle(handle);
     handle->entry_buffer = hvsc_malloc(HVSC_STIL_BUFFER_INIT *
                                        sizeof *(handle->entry_buffer));
@@ -486,29 +677,7 @@ bool hvsc_stil_open(const char *psid, hvsc_stil_t *handle)
     hvsc_dbg("stripped path is '%s'\n", handle->psid_path);
 
     /* find the entry */
-    while (true) {
-        line = hvsc_text_file_read(&(handle->stil));
-        if (line == NULL) {
-            if (feof(handle->stil.fp)) {
-                /* EOF, so simply not found */
-                hvsc_errno = HVSC_ERR_NOT_FOUND;
-#ifndef HVSC_STANDALONE
-                log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
-#endif
-            }
-            hvsc_stil_close(handle);
-            /* I/O error is already set */
-            return false;
-        }
-
-        if (strcmp(line, handle->psid_path) == 0) {
-#ifndef HVSC_STANDALONE
-            log_message(LOG_DEFAULT,
-                    "VSID: Found '%s' at line %ld.", line, handle->stil.lineno);
-#endif
-            return true;
-        }
-    }
+    return stil_find_entry(handle);
 }
 
 
@@ -542,29 +711,7 @@ bool hvsc_stil_open_md5(const char *digest, hvsc_stil_t *handle)
     }
 
     /* look up entry */
-    while (true) {
-        const char *line = hvsc_text_file_read(&(handle->stil));
-
-        if (line == NULL) {
-            if (feof(handle->stil.fp)) {
-                /* EOF, OK */
-                hvsc_errno = HVSC_ERR_NOT_FOUND;
-#ifndef HVSC_STANDALONE
-                log_message(LOG_DEFAULT, "VSID: No STIL entry found.");
-#endif
-            }
-            hvsc_stil_close(handle);
-            return false;
-        }
-
-        if (strcmp(line, handle->psid_path) == 0) {
-#ifndef HVSC_STANDALONE
-            log_message(LOG_DEFAULT,
-                    "VSID: Found '%s' at line %ld.", line, handle->stil.lineno);
-#endif
-            return true;
-        }
-    }
+    return stil_find_entry(handle);
 }
 
 
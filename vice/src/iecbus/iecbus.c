@@ -62,6 +62,10 @@ iecbus_t iecbus;
 
 static unsigned int iecbus_device[IECBUS_NUM];
 
+/* Non-zero if a serial IEC device is on the bus, which does not let the drives
+   fall behind the machine.  */
+static int iecbus_iecdevice_present = 0;
+
 static uint8_t iec_old_atn = 0x10;
 
 
@@ -226,7 +230,7 @@ static void iecbus_cpu_write_conf0(uint8_t data, CLOCK clock)
 /* Only the first disk unit (drive 8) is enabled.  */
 static uint8_t iecbus_cpu_read_conf1(CLOCK clock)
 {
-    drive_cpu_execute_all(clock);
+    drive_cpu_execute_all_read(clock);
 
     DEBUG_IEC_CPU_READ(iecbus.cpu_port);
 
@@ -289,7 +293,7 @@ static void iecbus_cpu_write_conf1(uint8_t data, CLOCK clock)
 /* Only the second disk unit (drive 9) is enabled.  */
 static uint8_t iecbus_cpu_read_conf2(CLOCK clock)
 {
-    drive_cpu_execute_all(clock);
+    drive_cpu_execute_all_read(clock);
 
     DEBUG_IEC_CPU_READ(iecbus.cpu_port);
 
@@ -352,7 +356,11 @@ static void iecbus_cpu_write_conf2(uint8_t data, CLOCK clock)
 
 static uint8_t iecbus_cpu_read_conf3(CLOCK clock)
 {
-    drive_cpu_execute_all(clock);
+    if (iecbus_iecdevice_present) {
+        drive_cpu_execute_all(clock);
+    } else {
+        drive_cpu_execute_all_read(clock);
+    }
     serial_iec_device_exec(clock);
 
     DEBUG_IEC_CPU_READ(iecbus.cpu_port);
@@ -432,6 +440,14 @@ static void iecbus_cpu_write_conf3(uint8_t data, CLOCK clock)
 static void calculate_callback_index(void)
 {
     unsigned int callback_index;
+    unsigned int i;
+
+    iecbus_iecdevice_present = 0;
+    for (i = 0; i < IECBUS_NUM; i++) {
+        if (iecbus_device[i] == IECBUS_DEVICE_IECDEVICE) {
+            iecbus_iecdevice_present = 1;
+        }
+    }
 
     callback_index = (iecbus_device[8] << 0)
                      | (iecbus_device[9] << 2)
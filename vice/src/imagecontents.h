@@ -85,6 +85,7 @@ typedef struct image_contents_screencode_s image_contents_screencode_t;
 
 void image_contents_destroy(image_contents_t *contents);
 image_contents_t *image_contents_new(void);
+image_contents_t *image_contents_dup(const image_contents_t *contents);
 
 image_contents_screencode_t *image_contents_to_screencode (image_contents_t *contents);
 void image_contents_screencode_destroy(image_contents_screencode_t *c);
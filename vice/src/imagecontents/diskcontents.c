@@ -26,23 +26,323 @@
  *
  */
 
+/* The directories read by diskcontents_filesystem_read() for the previews of
+   the file choosers and for autostart are kept in a cache, so looking at the
+   same images again does not attach and read them again.  The entries are
+   keyed by the path, and are only used while the size and the modification
+   time of the file are the same.  Files that are no disk images are cached
+   too, so the callers trying tape images next do not probe them again.
+
+   With DiskContentsCache set to 2 the cache is saved in the user cache
+   directory when the emulator quits, and loaded when it is used first.  */
+
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
+#include "archdep.h"
+#include "cmdline.h"
 #include "diskcontents-block.h"
 #include "diskcontents-iec.h"
 #include "diskcontents.h"
 #include "imagecontents.h"
 #include "lib.h"
+#include "log.h"
 #include "machine-bus.h"
 #include "machine.h"
+#include "resources.h"
 #include "serial.h"
 #include "attach.h"
+#include "util.h"
 #include "vdrive.h"
 #include "vdrive-internal.h"
 
-image_contents_t *diskcontents_filesystem_read(const char *file_name)
+#define DISKCONTENTS_CACHE_ENTRIES  256
+
+#define DISKCONTENTS_CACHE_NAME     "diskcontents.cache"
+#define DISKCONTENTS_CACHE_MAGIC    "VICEDCC1"
+
+typedef struct diskcontents_cache_entry_s {
+    char *path;                 /* NULL for an unused entry */
+    time_t mtime;
+    size_t size;
+    image_contents_t *contents; /* NULL if the file is no disk image */
+    unsigned int used;          /* when the entry was used last */
+} diskcontents_cache_entry_t;
+
+static diskcontents_cache_entry_t cache[DISKCONTENTS_CACHE_ENTRIES];
+static unsigned int cache_clock = 0;
+static int cache_loaded = 0;
+static int cache_changed = 0;
+
+static int cache_mode;
+
+static void diskcontents_cache_clear(void)
+{
+    int i;
+
+    for (i = 0; i < DISKCONTENTS_CACHE_ENTRIES; i++) {
+        lib_free(cache[i].path);
+        if (cache[i].contents != NULL) {
+            image_contents_destroy(cache[i].contents);
+        }
+        memset(&cache[i], 0, sizeof cache[i]);
+    }
+}
+
+static int set_cache_mode(int val, void *param)
+{
+    if (val < DISKCONTENTS_CACHE_OFF || val > DISKCONTENTS_CACHE_FILE) {
+        return -1;
+    }
+    cache_mode = val;
+    if (cache_mode == DISKCONTENTS_CACHE_OFF) {
+        diskcontents_cache_clear();
+    }
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "DiskContentsCache", DISKCONTENTS_CACHE_MEMORY, RES_EVENT_NO, NULL,
+      &cache_mode, set_cache_mode, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int diskcontents_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-diskcontentscache", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "DiskContentsCache", NULL,
+      "<Mode>", "Cache the directories of previewed disk images: (0: off, 1: in memory, 2: also in the user cache directory)" },
+    CMDLINE_LIST_END
+};
+
+int diskcontents_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static diskcontents_cache_entry_t *diskcontents_cache_insert(const char *path,
+                                                            time_t mtime,
+                                                            size_t size)
+{
+    diskcontents_cache_entry_t *entry = &cache[0];
+    int i;
+
+    /* reuse the entry of the path, or an unused one, or the least recently
+       used one */
+    for (i = 0; i < DISKCONTENTS_CACHE_ENTRIES; i++) {
+        if (cache[i].path == NULL || strcmp(cache[i].path, path) == 0) {
+            entry = &cache[i];
+            break;
+        }
+        if (cache[i].used < entry->used) {
+            entry = &cache[i];
+        }
+    }
+
+    if (entry->path == NULL || strcmp(entry->path, path) != 0) {
+        lib_free(entry->path);
+        entry->path = lib_strdup(path);
+    }
+    if (entry->contents != NULL) {
+        image_contents_destroy(entry->contents);
+        entry->contents = NULL;
+    }
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->used = ++cache_clock;
+    return entry;
+}
+
+static char *diskcontents_cache_file_name(void)
+{
+    return util_join_paths(archdep_user_cache_path(), DISKCONTENTS_CACHE_NAME, NULL);
+}
+
+static int read_dword(FILE *fd, uint32_t *value)
+{
+    uint8_t buf[4];
+
+    if (fread(buf, 4, 1, fd) != 1) {
+        return -1;
+    }
+    *value = util_le_buf_to_dword(buf);
+    return 0;
+}
+
+static void write_dword(FILE *fd, uint32_t value)
+{
+    uint8_t buf[4];
+
+    util_dword_to_le_buf(buf, value);
+    fwrite(buf, 4, 1, fd);
+}
+
+/* Read one entry of the cache file, returns -1 at its end or when it is
+   broken.  */
+static int diskcontents_cache_read_entry(FILE *fd)
+{
+    diskcontents_cache_entry_t *entry;
+    image_contents_t *contents = NULL;
+    image_contents_file_list_t *last = NULL;
+    uint32_t len, mtime_lo, mtime_hi, size, present, files, value;
+    char *path;
+
+    if (read_dword(fd, &len) < 0 || len == 0 || len > 4096) {
+        return -1;
+    }
+    path = lib_malloc(len + 1);
+    if (fread(path, len, 1, fd) != 1
+        || read_dword(fd, &mtime_lo) < 0 || read_dword(fd, &mtime_hi) < 0
+        || read_dword(fd, &size) < 0 || read_dword(fd, &present) < 0) {
+        lib_free(path);
+        return -1;
+    }
+    path[len] = '\0';
+
+    if (present) {
+        contents = image_contents_new();
+        if (fread(contents->name, sizeof contents->name, 1, fd) != 1
+            || fread(contents->id, sizeof contents->id, 1, fd) != 1
+            || read_dword(fd, &value) < 0) {
+            goto fail;
+        }
+        contents->blocks_free = (int)value;
+        if (read_dword(fd, &value) < 0 || read_dword(fd, &files) < 0) {
+            goto fail;
+        }
+        contents->partition = (int)value;
+        contents->name[sizeof contents->name - 1] = 0;
+        contents->id[sizeof contents->id - 1] = 0;
+
+        while (files-- > 0) {
+            image_contents_file_list_t *node = lib_calloc(1, sizeof(image_contents_file_list_t));
+
+            node->prev = last;
+            if (last == NULL) {
+                contents->file_list = node;
+            } else {
+                last->next = node;
+            }
+            last = node;
+            if (fread(node->name, sizeof node->name, 1, fd) != 1
+                || fread(node->type, sizeof node->type, 1, fd) != 1
+                || read_dword(fd, &value) < 0) {
+                goto fail;
+            }
+            node->name[sizeof node->name - 1] = 0;
+            node->type[sizeof node->type - 1] = 0;
+            node->size = value;
+        }
+    }
+
+    entry = diskcontents_cache_insert(path,
+            (time_t)(((uint64_t)mtime_hi << 32) | mtime_lo), size);
+    entry->contents = contents;
+    lib_free(path);
+    return 0;
+
+fail:
+    image_contents_destroy(contents);
+    lib_free(path);
+    return -1;
+}
+
+static void diskcontents_cache_load(void)
+{
+    char magic[sizeof DISKCONTENTS_CACHE_MAGIC - 1];
+    char *name;
+    FILE *fd;
+
+    cache_loaded = 1;
+
+    name = diskcontents_cache_file_name();
+    fd = fopen(name, MODE_READ);
+    lib_free(name);
+    if (fd == NULL) {
+        return;
+    }
+    if (fread(magic, sizeof magic, 1, fd) == 1
+        && memcmp(magic, DISKCONTENTS_CACHE_MAGIC, sizeof magic) == 0) {
+        while (diskcontents_cache_read_entry(fd) == 0) {
+        }
+    }
+    fclose(fd);
+    cache_changed = 0;
+}
+
+static void diskcontents_cache_save(void)
+{
+    image_contents_file_list_t *node;
+    image_contents_t *contents;
+    char *name;
+    FILE *fd;
+    uint32_t files;
+    int i;
+
+    name = diskcontents_cache_file_name();
+    fd = fopen(name, MODE_WRITE);
+    if (fd == NULL) {
+        log_error(LOG_DEFAULT, "Cannot write disk contents cache `%s'.", name);
+        lib_free(name);
+        return;
+    }
+    lib_free(name);
+
+    fwrite(DISKCONTENTS_CACHE_MAGIC, sizeof DISKCONTENTS_CACHE_MAGIC - 1, 1, fd);
+    for (i = 0; i < DISKCONTENTS_CACHE_ENTRIES; i++) {
+        if (cache[i].path == NULL) {
+            continue;
+        }
+        contents = cache[i].contents;
+        write_dword(fd, (uint32_t)strlen(cache[i].path));
+        fwrite(cache[i].path, strlen(cache[i].path), 1, fd);
+        write_dword(fd, (uint32_t)((uint64_t)cache[i].mtime & 0xffffffff));
+        write_dword(fd, (uint32_t)((uint64_t)cache[i].mtime >> 32));
+        write_dword(fd, (uint32_t)cache[i].size);
+        write_dword(fd, contents != NULL);
+        if (contents == NULL) {
+            continue;
+        }
+        fwrite(contents->name, sizeof contents->name, 1, fd);
+        fwrite(contents->id, sizeof contents->id, 1, fd);
+        write_dword(fd, (uint32_t)contents->blocks_free);
+        write_dword(fd, (uint32_t)contents->partition);
+        files = 0;
+        for (node = contents->file_list; node != NULL; node = node->next) {
+            files++;
+        }
+        write_dword(fd, files);
+        for (node = contents->file_list; node != NULL; node = node->next) {
+            fwrite(node->name, sizeof node->name, 1, fd);
+            fwrite(node->type, sizeof node->type, 1, fd);
+            write_dword(fd, node->size);
+        }
+    }
+    fclose(fd);
+    cache_changed = 0;
+}
+
+void diskcontents_shutdown(void)
+{
+    if (cache_mode == DISKCONTENTS_CACHE_FILE && cache_changed) {
+        diskcontents_cache_save();
+    }
+    diskcontents_cache_clear();
+}
+
+/* ------------------------------------------------------------------------- */
+
+static image_contents_t *diskcontents_filesystem_read_image(const char *file_name)
 {
     vdrive_t *vdrive;
     image_contents_t *contents = NULL;
@@ -56,3 +356,38 @@ image_contents_t *diskcontents_filesystem_read(const char *file_name)
 
     return contents;
 }
+
+image_contents_t *diskcontents_filesystem_read(const char *file_name)
+{
+    diskcontents_cache_entry_t *entry;
+    image_contents_t *contents;
+    time_t mtime;
+    size_t size;
+    int i;
+
+    if (cache_mode == DISKCONTENTS_CACHE_OFF
+        || archdep_stat(file_name, &size, NULL) < 0
+        || archdep_file_mtime(file_name, &mtime) < 0) {
+        return diskcontents_filesystem_read_image(file_name);
+    }
+
+    if (cache_mode == DISKCONTENTS_CACHE_FILE && !cache_loaded) {
+        diskcontents_cache_load();
+    }
+
+    for (i = 0; i < DISKCONTENTS_CACHE_ENTRIES; i++) {
+        entry = &cache[i];
+        if (entry->path != NULL && entry->mtime == mtime && entry->size == size
+            && strcmp(entry->path, file_name) == 0) {
+            entry->used = ++cache_clock;
+            return entry->contents != NULL ? image_contents_dup(entry->contents) : NULL;
+        }
+    }
+
+    contents = diskcontents_filesystem_read_image(file_name);
+    entry = diskcontents_cache_insert(file_name, mtime, size);
+    entry->contents = contents != NULL ? image_contents_dup(contents) : NULL;
+    cache_changed = 1;
+
+    return contents;
+}
@@ -29,6 +29,15 @@
 
 struct image_contents_s;
 
+/* Values of the DiskContentsCache resource.  */
+#define DISKCONTENTS_CACHE_OFF      0
+#define DISKCONTENTS_CACHE_MEMORY   1
+#define DISKCONTENTS_CACHE_FILE     2
+
+int diskcontents_resources_init(void);
+int diskcontents_cmdline_options_init(void);
+void diskcontents_shutdown(void);
+
 struct image_contents_s *diskcontents_read(const char *file_name,
                                            unsigned int unit, unsigned int drive);
 struct image_contents_s *diskcontents_filesystem_read(const char *file_name);
@@ -87,6 +87,39 @@ void image_contents_destroy(image_contents_t *contents)
 }
 
 
+/** \brief  Create a copy of \a contents
+ *
+ * \param[in]   contents    image contents object
+ *
+ * \return  image contents object, free with image_contents_destroy()
+ */
+image_contents_t *image_contents_dup(const image_contents_t *contents)
+{
+    image_contents_t *copy;
+    image_contents_file_list_t *node;
+    image_contents_file_list_t *last = NULL;
+
+    copy = lib_malloc(sizeof(image_contents_t));
+    *copy = *contents;
+    copy->file_list = NULL;
+
+    for (node = contents->file_list; node != NULL; node = node->next) {
+        image_contents_file_list_t *entry = lib_malloc(sizeof(image_contents_file_list_t));
+
+        *entry = *node;
+        entry->prev = last;
+        entry->next = NULL;
+        if (last == NULL) {
+            copy->file_list = entry;
+        } else {
+            last->next = entry;
+        }
+        last = entry;
+    }
+    return copy;
+}
+
+
 /** \brief  Free memory used by image contents as a list of screen codes
  *
  * \param[in,out]   c   screencode contents object
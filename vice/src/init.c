@@ -29,10 +29,19 @@
 
 #include "archdep.h"
 #include "attach.h"
+#include "autowarp.h"
+#include "batch.h"
+#include "bench.h"
+#include "cpubench.h"
+#include "cpucoverage.h"
 #include "cmdline.h"
 #include "console.h"
 #include "debug.h"
+#include "diskcontents.h"
 #include "drive.h"
+#include "exitreport.h"
+#include "framestats.h"
+#include "hosttime.h"
 #include "initcmdline.h"
 #include "keyboard.h"
 #include "log.h"
@@ -40,22 +49,29 @@
 #include "machine-video.h"
 #include "machine.h"
 #include "maincpu.h"
+#include "memusage.h"
 #include "monitor.h"
 #ifdef HAVE_NETWORK
 #include "monitor_binary.h"
 #include "monitor_network.h"
+#include "monitor_shm.h"
 #endif
 #include "palette.h"
 #include "ram.h"
 #include "resources.h"
+#include "rewind.h"
+#include "runahead.h"
 #include "romset.h"
 #include "screenshot.h"
 #include "signals.h"
+#include "starttrace.h"
 #include "sysfile.h"
+#include "tracezone.h"
 #include "uiapi.h"
 #include "vdrive.h"
 #include "video.h"
 #include "vsync.h"
+#include "zfile.h"
 
 #include "init.h"
 
@@ -116,6 +132,38 @@ int init_resources(void)
         init_resource_fail("vsync");
         return -1;
     }
+    if (hosttime_resources_init() < 0) {
+        init_resource_fail("hosttime");
+        return -1;
+    }
+    if (framestats_resources_init() < 0) {
+        init_resource_fail("framestats");
+        return -1;
+    }
+    if (memusage_resources_init() < 0) {
+        init_resource_fail("memusage");
+        return -1;
+    }
+    if (rewind_resources_init() < 0) {
+        init_resource_fail("rewind");
+        return -1;
+    }
+    if (runahead_resources_init() < 0) {
+        init_resource_fail("runahead");
+        return -1;
+    }
+    if (autowarp_resources_init() < 0) {
+        init_resource_fail("autowarp");
+        return -1;
+    }
+    if (diskcontents_resources_init() < 0) {
+        init_resource_fail("diskcontents");
+        return -1;
+    }
+    if (zfile_resources_init() < 0) {
+        init_resource_fail("zfile");
+        return -1;
+    }
     if (sound_resources_init() < 0) {
         init_resource_fail("sound");
         return -1;
@@ -140,6 +188,10 @@ int init_resources(void)
         init_resource_fail("monitor");
         return -1;
     }
+    if (monitor_shm_resources_init() < 0) {
+        init_resource_fail("MONITOR_SHM");
+        return -1;
+    }
 #ifdef HAVE_NETWORK
     if (monitor_network_resources_init() < 0) {
         init_resource_fail("MONITOR_NETWORK");
@@ -199,6 +251,66 @@ int init_cmdline_options(void)
         init_cmdline_options_fail("vsync");
         return -1;
     }
+    if (hosttime_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("hosttime");
+        return -1;
+    }
+    if (framestats_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("framestats");
+        return -1;
+    }
+    if (memusage_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("memusage");
+        return -1;
+    }
+    if (rewind_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("rewind");
+        return -1;
+    }
+    if (runahead_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("runahead");
+        return -1;
+    }
+    if (autowarp_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("autowarp");
+        return -1;
+    }
+    if (diskcontents_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("diskcontents");
+        return -1;
+    }
+    if (zfile_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("zfile");
+        return -1;
+    }
+    if (batch_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("batch");
+        return -1;
+    }
+    if (exitreport_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("exitreport");
+        return -1;
+    }
+    if (tracezone_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("tracezone");
+        return -1;
+    }
+    if (bench_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("bench");
+        return -1;
+    }
+    if (cpubench_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("cpubench");
+        return -1;
+    }
+    if (cpucoverage_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("cpucoverage");
+        return -1;
+    }
+    if (starttrace_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("starttrace");
+        return -1;
+    }
     if (sound_cmdline_options_init() < 0) {
         init_cmdline_options_fail("sound");
         return -1;
@@ -222,6 +334,10 @@ int init_cmdline_options(void)
             return -1;
         }
     }
+    if (monitor_shm_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("MONITOR_SHM");
+        return -1;
+    }
 #ifdef HAVE_NETWORK
     if (monitor_network_cmdline_options_init() < 0) {
         init_cmdline_options_fail("MONITOR_NETWORK");
@@ -288,12 +404,14 @@ int init_main(void)
 
     machine_bus_init();
     machine_maincpu_init();
+    starttrace_mark("romset, palette, screenshot, cpu init");
 
     /* Machine-specific initialization.  */
     if (machine_init() < 0) {
         log_error(LOG_DEFAULT, "Machine initialization failed.");
         return -1;
     }
+    starttrace_mark("machine init");
 
     /* FIXME: what's about uimon_init??? */
     /* the monitor console MUST be available, because of for example cpujam,
@@ -309,10 +427,12 @@ int init_main(void)
     if (machine_class != VICE_MACHINE_VSID) {
         vdrive_init();
     }
+    starttrace_mark("console, keyboard, vdrive init");
 
     ui_init_finalize();
 
     main_init_hack();
+    starttrace_mark("UI init finalize");
 
     init_done = 1;
 
@@ -37,10 +37,14 @@
 #include "archdep.h"
 #include "attach.h"
 #include "autostart.h"
+#include "batch.h"
+#include "bench.h"
+#include "cpubench.h"
 #include "cartridge.h"
 #include "cmdline.h"
 #include "console.h"
 #include "drive.h"
+#include "exitreport.h"
 #include "fliplist.h"
 #include "fsdevice.h"
 #include "gfxoutput.h"
@@ -54,6 +58,7 @@
 #include "monitor.h"
 #include "monitor_binary.h"
 #include "monitor_network.h"
+#include "monitor_shm.h"
 #include "network.h"
 #include "printer.h"
 #include "resources.h"
@@ -617,4 +622,10 @@ void initcmdline_check_attach(void)
     }
 
     cmdline_free_autostart_string();
+
+    exitreport_start();
+    batch_start();
+    bench_start();
+    cpubench_start();
+    monitor_shm_start();
 }
@@ -284,6 +284,7 @@ void interrupt_fixup_int_clk(interrupt_cpu_status_t *cs, CLOCK cpu_clk,
 void interrupt_trigger_dma(interrupt_cpu_status_t *cs, CLOCK cpu_clk)
 {
     cs->global_pending_int = (enum cpu_int)(cs->global_pending_int | IK_DMA);
+    cs->next_event_clk = 0;
 }
 
 void interrupt_ack_dma(interrupt_cpu_status_t *cs)
@@ -301,6 +302,7 @@ void interrupt_trigger_reset(interrupt_cpu_status_t *cs, CLOCK cpu_clk)
     }
 
     cs->global_pending_int |= IK_RESET;
+    cs->next_event_clk = 0;
 }
 
 /* Acknowledge a RESET condition, by removing it.  */
@@ -338,6 +340,7 @@ void interrupt_maincpu_trigger_trap(void (*trap_func)(uint16_t, void *data),
     }
 
     cs->global_pending_int |= IK_TRAP;
+    cs->next_event_clk = 0;
 
     cs->trap_func[this_trap_index] = trap_func;
     cs->trap_data[this_trap_index] = data;
@@ -370,6 +373,7 @@ void interrupt_do_trap(interrupt_cpu_status_t *cs, uint16_t address)
 void interrupt_monitor_trap_on(interrupt_cpu_status_t *cs)
 {
     cs->global_pending_int |= IK_MONITOR;
+    cs->next_event_clk = 0;
 }
 
 void interrupt_monitor_trap_off(interrupt_cpu_status_t *cs)
@@ -427,6 +431,7 @@ int interrupt_read_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m)
 
     cs->global_pending_int = IK_NONE;
     cs->nirq = cs->nnmi = cs->reset = cs->trap = 0;
+    cs->next_event_clk = 0;
 
     if (0
         || SMR_CLOCK(m, &cs->irq_clk) < 0
@@ -456,6 +461,7 @@ int interrupt_read_new_snapshot(interrupt_cpu_status_t *cs, snapshot_module_t *m
         || SMR_DW_UINT(m, &cs->global_pending_int) < 0) {
         return -1;
     }
+    cs->next_event_clk = 0;
 
     return 0;
 }
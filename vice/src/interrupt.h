@@ -122,6 +122,13 @@ struct interrupt_cpu_status_s {
 
     unsigned int global_pending_int;
 
+    /* Clock tick before which the CPU need not look at global_pending_int
+       nor dispatch alarms: at most the clock of the next pending alarm,
+       and 0 while anything is pending.  Setting an interrupt, trap, DMA,
+       RESET or monitor request and setting an alarm only ever lower it,
+       the CPU core computes it again after handling them.  */
+    CLOCK next_event_clk;
+
     void (*nmi_trap_func)(void);
 
     void (*reset_trap_func)(void);
@@ -150,6 +157,7 @@ inline static void interrupt_set_irq(interrupt_cpu_status_t *cs,
         if (!(cs->pending_int[int_num] & IK_IRQ)) {
             cs->nirq++;
             cs->global_pending_int = (cs->global_pending_int | (unsigned int)(IK_IRQ | IK_IRQPEND));
+            cs->next_event_clk = 0;
             cs->pending_int[int_num] = (cs->pending_int[int_num] | (unsigned int)IK_IRQ);
 
             cs->irq_pending_clk = CLOCK_MAX;
@@ -201,6 +209,7 @@ inline static void interrupt_set_nmi(interrupt_cpu_status_t *cs,
         if (!(cs->pending_int[int_num] & IK_NMI)) {
             if (cs->nnmi == 0 && !(cs->global_pending_int & IK_NMI)) {
                 cs->global_pending_int = (cs->global_pending_int | IK_NMI);
+                cs->next_event_clk = 0;
 
 #ifdef DEBUG
                 if (debug.maincpu_traceflg) {
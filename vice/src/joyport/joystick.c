@@ -36,8 +36,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+#endif
+
 #include "archdep.h"
 #include "alarm.h"
+#include "autowarp.h"
 #include "cmdline.h"
 #include "keyboard.h"
 #include "joyport.h"
@@ -56,6 +61,7 @@
 #include "userport_joystick.h"
 #include "util.h"
 #include "vice-event.h"
+#include "vsync.h"
 
 /* Control port <--> Joystick connections:
 
@@ -272,9 +278,20 @@ static void joystick_handle_hooks(unsigned int joyport)
     }
 }
 
+/* Set while the events of the polling thread are applied: they are latched
+   at once, their cycle has been chosen already.  */
+static int joystick_latch_at_once = 0;
+
 static void joystick_process_latch(void)
 {
-    CLOCK delay = lib_unsigned_rand(1, (unsigned int)machine_get_cycles_per_frame());
+    CLOCK delay;
+
+    if (joystick_latch_at_once && !network_connected()) {
+        joystick_latch_handler(0, NULL);
+        return;
+    }
+
+    delay = lib_unsigned_rand(1, (unsigned int)machine_get_cycles_per_frame());
 
     if (network_connected()) {
         network_event_record(EVENT_JOYSTICK_DELAY, (void *)&delay, sizeof(delay));
@@ -289,6 +306,15 @@ uint8_t joystick_get_axis_value(unsigned int port, unsigned int pot)
     return joystick_axis_value[port][pot];
 }
 
+void joystick_relatch(void)
+{
+    if (joystick_alarm != NULL) {
+        alarm_unset(joystick_alarm);
+        alarm_context_update_next_pending(joystick_alarm->context);
+    }
+    joystick_latch_matrix(0);
+}
+
 void joystick_set_value_absolute(unsigned int joyport, uint16_t value)
 {
     if (event_playback_active()) {
@@ -296,6 +322,9 @@ void joystick_set_value_absolute(unsigned int joyport, uint16_t value)
     }
 
     if (latch_joystick_value.values[joyport] != value) {
+        if (value & ~latch_joystick_value.values[joyport]) {
+            autowarp_user_input();
+        }
         latch_joystick_value.values[joyport] = value;
         latch_joystick_value.last_used_joyport = joyport;
         joystick_process_latch();
@@ -310,6 +339,8 @@ void joystick_set_value_or(unsigned int joyport, uint16_t value)
         return;
     }
 
+    autowarp_user_input();
+
     latch_joystick_value.values[joyport] |= value;
 
     if (!joystick_opposite_enable) {
@@ -2019,6 +2050,30 @@ static const resource_int_t joyopposite_resources_int[] = {
     RESOURCE_INT_LIST_END
 };
 
+#ifdef USE_VICE_THREAD
+static int joystick_poll_thread_enabled = 0;
+
+static alarm_t *joystick_input_alarm = NULL;
+
+static void poll_thread_join(void);
+static void joystick_input_alarm_handler(CLOCK offset, void *data);
+
+static int set_joystick_poll_thread(int val, void *param)
+{
+    joystick_poll_thread_enabled = val ? 1 : 0;
+    if (!joystick_poll_thread_enabled) {
+        poll_thread_join();
+    }
+    return 0;
+}
+
+static const resource_int_t joythread_resources_int[] = {
+    { "JoyPollThread", 0, RES_EVENT_NO, NULL,
+      &joystick_poll_thread_enabled, set_joystick_poll_thread, NULL },
+    RESOURCE_INT_LIST_END
+};
+#endif
+
 static resource_int_t joy1_resources_int[] = {
     { "JoyDevice1", JOYDEV_NONE, RES_EVENT_NO, NULL,
       &joystick_port_map[JOYPORT_1], set_joystick_device, (void *)JOYPORT_1 },
@@ -2173,6 +2228,11 @@ int joystick_resources_init(void)
     if (resources_register_int(joyopposite_resources_int) < 0) {
         return -1;
     }
+#ifdef USE_VICE_THREAD
+    if (resources_register_int(joythread_resources_int) < 0) {
+        return -1;
+    }
+#endif
 
 #ifdef JOYDEV_DEFAULT
     switch (machine_class) {
@@ -2284,6 +2344,14 @@ static const cmdline_option_t cmdline_options[] = {
     { "+joyopposite", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "JoyOpposite", (resource_value_t)0,
       NULL, "Disable opposite joystick directions" },
+#ifdef USE_VICE_THREAD
+    { "-joypollthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "JoyPollThread", (resource_value_t)1,
+      NULL, "Poll the host joysticks on a thread of their own every millisecond" },
+    { "+joypollthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "JoyPollThread", (resource_value_t)0,
+      NULL, "Poll the host joysticks with the emulation" },
+#endif
 #ifdef COMMON_JOYKEYS
     { "-keyset", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "KeySetEnable", (resource_value_t)1,
@@ -2690,6 +2758,10 @@ int joystick_init(void)
 {
     joystick_alarm = alarm_new(maincpu_alarm_context, "Joystick",
                                joystick_latch_handler, NULL);
+#ifdef USE_VICE_THREAD
+    joystick_input_alarm = alarm_new(maincpu_alarm_context, "JoystickInput",
+                                     joystick_input_alarm_handler, NULL);
+#endif
 
 #ifdef COMMON_JOYKEYS
     kbd_initialize_numpad_joykeys(joykeys[0]);
@@ -3050,10 +3122,243 @@ static void joy_perform_event(joystick_mapping_t *event, int joyport, int value)
 }
 
 
+/*--------------------------------------------------------------------------*/
+
+/* Polling the host joysticks on a thread of their own (JoyPollThread).
+
+   The thread polls the drivers every millisecond and queues the events they
+   report with the host tick they were seen at.  When the emulation polls
+   the input it takes them out of the queue and applies each at the CPU
+   cycle that is due one sync interval after the event was seen, instead of
+   at a random point of the next frame.  That keeps the time between the
+   events and shortens the delay until the emulated machine sees them.  */
+
+#ifdef USE_VICE_THREAD
+
+#define INPUT_QUEUE_SIZE    256
+
+/* Delay from the host seeing an event to the emulated machine seeing it,
+   the interval at which vsync_do_end_of_line() polls the input.  */
+#define INPUT_LATENCY_MS    2
+
+#if defined(__GNUC__)
+#define JOYSTICK_THREAD_LOCAL   __thread
+#else
+#define JOYSTICK_THREAD_LOCAL   _Thread_local
+#endif
+
+enum {
+    INPUT_AXIS,
+    INPUT_BUTTON,
+    INPUT_HAT
+};
+
+typedef struct joystick_queued_input_s {
+    tick_t tick;        /* when the polling thread saw it */
+    CLOCK clk;          /* when to apply it */
+    uint8_t type;
+    uint8_t joynum;
+    uint8_t index;
+    uint8_t value;
+} joystick_queued_input_t;
+
+static pthread_t poll_thread;
+static int poll_thread_running = 0;
+static int poll_thread_stop = 0;
+static JOYSTICK_THREAD_LOCAL int on_poll_thread = 0;
+
+/* Filled by the polling thread, emptied by the emulation.  Events arriving
+   while it is full (the emulation is paused) are dropped.  */
+static pthread_mutex_t input_lock = PTHREAD_MUTEX_INITIALIZER;
+static joystick_queued_input_t input_queue[INPUT_QUEUE_SIZE];
+static unsigned int input_head = 0;
+static unsigned int input_count = 0;
+
+/* Taken out of the queue and waiting for their cycle.  */
+static joystick_queued_input_t input_pending[INPUT_QUEUE_SIZE];
+static unsigned int pending_head = 0;
+static unsigned int pending_count = 0;
+
+static void *poll_thread_main(void *arg)
+{
+    tick_t interval = tick_per_second() / 1000;
+    int stop = 0;
+    int i;
+
+    on_poll_thread = 1;
+
+    while (!stop) {
+        for (i = 0; i < num_joystick_devices; i++) {
+            joystick_devices[i].driver->poll(i, joystick_devices[i].priv);
+        }
+        tick_sleep(interval);
+
+        pthread_mutex_lock(&input_lock);
+        stop = poll_thread_stop;
+        pthread_mutex_unlock(&input_lock);
+    }
+    return NULL;
+}
+
+static void poll_thread_start(void)
+{
+    if (poll_thread_running || num_joystick_devices == 0) {
+        return;
+    }
+
+    poll_thread_stop = 0;
+    if (pthread_create(&poll_thread, NULL, poll_thread_main, NULL) != 0) {
+        log_error(joy_log, "Cannot start the joystick polling thread.");
+        joystick_poll_thread_enabled = 0;
+        return;
+    }
+    poll_thread_running = 1;
+}
+
+static void poll_thread_join(void)
+{
+    if (!poll_thread_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&input_lock);
+    poll_thread_stop = 1;
+    pthread_mutex_unlock(&input_lock);
+
+    pthread_join(poll_thread, NULL);
+    poll_thread_running = 0;
+}
+
+/* Queue an event if a driver reports it on the polling thread.  Returns 1
+   if the event was queued (or dropped), 0 if it is to be applied now.  */
+static int joystick_queue_input(int type, uint8_t joynum, uint8_t index, uint8_t value)
+{
+    joystick_queued_input_t *input;
+
+    if (!on_poll_thread) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&input_lock);
+    if (input_count < INPUT_QUEUE_SIZE) {
+        input = &input_queue[(input_head + input_count) % INPUT_QUEUE_SIZE];
+        input->tick = tick_now();
+        input->type = (uint8_t)type;
+        input->joynum = joynum;
+        input->index = index;
+        input->value = value;
+        input_count++;
+    }
+    pthread_mutex_unlock(&input_lock);
+
+    return 1;
+}
+
+static void joystick_apply_input(const joystick_queued_input_t *input)
+{
+    joystick_latch_at_once = 1;
+
+    switch (input->type) {
+        case INPUT_AXIS:
+            joy_axis_event(input->joynum, input->index, (joystick_axis_value_t)input->value);
+            break;
+        case INPUT_BUTTON:
+            joy_button_event(input->joynum, input->index, input->value);
+            break;
+        case INPUT_HAT:
+            joy_hat_event(input->joynum, input->index, input->value);
+            break;
+        default:
+            break;
+    }
+
+    joystick_latch_at_once = 0;
+}
+
+/* Apply the pending events whose cycle has come and wait for the next.  */
+static void joystick_apply_pending(void)
+{
+    CLOCK latest = maincpu_clk + (CLOCK)(machine_get_cycles_per_second() / 1000 * INPUT_LATENCY_MS);
+
+    while (pending_count > 0) {
+        joystick_queued_input_t *input = &input_pending[pending_head];
+
+        /* a cycle further away is left from before a snapshot was loaded */
+        if (input->clk > maincpu_clk && input->clk <= latest) {
+            alarm_set(joystick_input_alarm, input->clk);
+            return;
+        }
+        pending_head = (pending_head + 1) % INPUT_QUEUE_SIZE;
+        pending_count--;
+        joystick_apply_input(input);
+    }
+    alarm_unset(joystick_input_alarm);
+}
+
+static void joystick_input_alarm_handler(CLOCK offset, void *data)
+{
+    alarm_unset(joystick_input_alarm);
+    joystick_apply_pending();
+}
+
+/* Take the events out of the queue and schedule them.  */
+static void joystick_take_input(void)
+{
+    tick_t latency = tick_per_second() / 1000 * INPUT_LATENCY_MS;
+    CLOCK latest = maincpu_clk + (CLOCK)(machine_get_cycles_per_second() / 1000 * INPUT_LATENCY_MS);
+    CLOCK clk;
+
+    pthread_mutex_lock(&input_lock);
+    while (input_count > 0 && pending_count < INPUT_QUEUE_SIZE) {
+        joystick_queued_input_t *input = &input_pending[(pending_head + pending_count) % INPUT_QUEUE_SIZE];
+
+        *input = input_queue[input_head];
+        input_head = (input_head + 1) % INPUT_QUEUE_SIZE;
+        input_count--;
+
+        /* not before now, not later than the latency, and in order */
+        clk = vsync_clk_at_tick(input->tick + latency);
+        if (clk < maincpu_clk) {
+            clk = maincpu_clk;
+        } else if (clk > latest) {
+            clk = latest;
+        }
+        if (pending_count > 0) {
+            CLOCK previous = input_pending[(pending_head + pending_count - 1) % INPUT_QUEUE_SIZE].clk;
+
+            if (clk < previous) {
+                clk = previous;
+            }
+        }
+        input->clk = clk;
+        pending_count++;
+    }
+    pthread_mutex_unlock(&input_lock);
+
+    joystick_apply_pending();
+}
+
+#else
+
+static void poll_thread_join(void)
+{
+}
+
+#define joystick_queue_input(type, joynum, index, value) 0
+
+#endif
+
 void joy_axis_event(uint8_t joynum, uint8_t axis, joystick_axis_value_t value)
 {
-    joystick_axis_value_t prev = joystick_devices[joynum].axis_mapping[axis].prev;
-    int joyport = joystick_devices[joynum].joyport;
+    joystick_axis_value_t prev;
+    int joyport;
+
+    if (joystick_queue_input(INPUT_AXIS, joynum, axis, (uint8_t)value)) {
+        return;
+    }
+
+    prev = joystick_devices[joynum].axis_mapping[axis].prev;
+    joyport = joystick_devices[joynum].joyport;
 
     if (value == prev) {
         return;
@@ -3083,6 +3388,10 @@ void joy_axis_event(uint8_t joynum, uint8_t axis, joystick_axis_value_t value)
 void joy_button_event(uint8_t joynum, uint8_t button, uint8_t value)
 {
     int pressed = value ? 1 : 0;
+
+    if (joystick_queue_input(INPUT_BUTTON, joynum, button, value)) {
+        return;
+    }
 #if 0
     int num_buttons = joystick_devices[joynum].num_buttons;
     int joy_pin = joystick_devices[joynum].button_mapping[button].value.joy_pin;
@@ -3110,6 +3419,10 @@ void joy_hat_event(uint8_t joynum, uint8_t hat, uint8_t value)
     uint8_t prev;
     int joyport;
 
+    if (joystick_queue_input(INPUT_HAT, joynum, hat, value)) {
+        return;
+    }
+
     prev = joystick_devices[joynum].hat_mapping[hat].prev;
     if (value == prev) {
         return;
@@ -3257,6 +3570,17 @@ const char *joystick_ui_get_next_device_name(int *id)
 void joystick(void)
 {
     int i;
+
+#ifdef USE_VICE_THREAD
+    if (joystick_poll_thread_enabled) {
+        poll_thread_start();
+    }
+    joystick_take_input();
+    if (poll_thread_running) {
+        return;
+    }
+#endif
+
     for (i = 0; i < num_joystick_devices; i++) {
         joystick_devices[i].driver->poll(i, joystick_devices[i].priv);
     }
@@ -3266,6 +3590,8 @@ void joystick_close(void)
 {
     int i;
 
+    poll_thread_join();
+
     for (i = 0; i < num_joystick_devices; i++) {
         joystick_devices[i].driver->close(joystick_devices[i].priv);
         lib_free(joystick_devices[i].axis_mapping);
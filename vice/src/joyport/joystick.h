@@ -48,6 +48,8 @@ void joystick_set_axis_value(unsigned int index, unsigned int axis, uint8_t valu
 uint8_t joystick_get_axis_value(unsigned int port, unsigned int pot);
 
 void joystick_set_value_absolute(unsigned int joyport, uint16_t value);
+/* Apply the host joystick state right away, e.g. after restoring a snapshot. */
+void joystick_relatch(void);
 void joystick_set_value_or(unsigned int joyport, uint16_t value);
 void joystick_set_value_and(unsigned int joyport, uint16_t value);
 void joystick_clear(unsigned int joyport);
@@ -49,6 +49,7 @@
 #include "mem.h"
 #include "resources.h"
 #include "types.h"
+#include "vsync.h"
 
 #ifdef DEBUG_KBDBUF
 #define DBG(x)  log_debug x
@@ -57,7 +58,11 @@
 #endif
 
 /* Maximum number of characters we can queue.  */
-#define QUEUE_SIZE      16384
+#define QUEUE_SIZE      65536
+
+/* Bounds of the interval at which a fast paste refills the buffer.  */
+#define PASTE_POLL_MIN  500
+#define PASTE_POLL_MAX  20000
 
 /* First location of the buffer.  */
 static int buffer_location;
@@ -101,6 +106,19 @@ static bool kbdbuf_init_cmdline_fed = false;
 
 CLOCK kbdbuf_flush_alarm_time = 0;
 
+/* Paste long texts in warp mode, refilling the buffer as soon as it is
+   empty instead of once per frame.  */
+static int KbdbufFastPaste = 1;
+
+static alarm_t *kbdbuf_paste_alarm = NULL;
+
+/* Cycles between the refills of a fast paste.  */
+static CLOCK paste_poll_cycles = PASTE_POLL_MIN;
+
+/* Flag: a fast paste is running; warp mode state before it started.  */
+static int paste_active = 0;
+static int paste_orig_warp_mode = 0;
+
 /* ------------------------------------------------------------------------- */
 
 /*! \internal \brief set additional keybuf delay. 0 means default. (none) */
@@ -113,10 +131,18 @@ static int set_kbdbuf_delay(int val, void *param)
     return 0;
 }
 
+static int set_kbdbuf_fast_paste(int val, void *param)
+{
+    KbdbufFastPaste = val ? 1 : 0;
+    return 0;
+}
+
 /*! \brief integer resources used by keybuf */
 static const resource_int_t resources_int[] = {
     { "KbdbufDelay", 0, RES_EVENT_NO, (resource_value_t)0,
       &KbdbufDelay, set_kbdbuf_delay, NULL },
+    { "KbdbufFastPaste", 1, RES_EVENT_NO, NULL,
+      &KbdbufFastPaste, set_kbdbuf_fast_paste, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -210,6 +236,12 @@ static const cmdline_option_t cmdline_options[] =
     { "-keybuf-delay", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "KbdbufDelay", NULL,
       "<value>", "Set additional keyboard buffer delay (0: use default)" },
+    { "-keybuf-fastpaste", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "KbdbufFastPaste", (resource_value_t)1,
+      NULL, "Paste long texts in warp mode" },
+    { "+keybuf-fastpaste", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "KbdbufFastPaste", (resource_value_t)0,
+      NULL, "Paste long texts at the normal speed" },
     CMDLINE_LIST_END
 };
 
@@ -294,6 +326,61 @@ static void kbdbuf_flush_alarm_triggered(CLOCK offset, void *data)
     removefromqueue();
 }
 
+static void paste_stop(void)
+{
+    if (!paste_active) {
+        return;
+    }
+    DBG(("kbdbuf: fast paste done"));
+    alarm_unset(kbdbuf_paste_alarm);
+    paste_active = 0;
+    if (!paste_orig_warp_mode) {
+        vsync_set_warp_mode(0);
+    }
+}
+
+/* Refill the buffer of a fast paste.  The editor takes the keys out of the
+   buffer as fast as it handles them, except when a line is entered, so the
+   interval shrinks while the buffer is found empty and grows while it is
+   not.  */
+static void kbdbuf_paste_alarm_triggered(CLOCK offset, void *data)
+{
+    if (kbdbuf_is_empty()) {
+        paste_poll_cycles /= 2;
+        if (paste_poll_cycles < PASTE_POLL_MIN) {
+            paste_poll_cycles = PASTE_POLL_MIN;
+        }
+    } else {
+        paste_poll_cycles *= 2;
+        if (paste_poll_cycles > PASTE_POLL_MAX) {
+            paste_poll_cycles = PASTE_POLL_MAX;
+        }
+    }
+
+    kbdbuf_flush();
+
+    if (num_pending == 0 || !kbd_buf_enabled) {
+        paste_stop();
+        return;
+    }
+    alarm_set(kbdbuf_paste_alarm, maincpu_clk + paste_poll_cycles);
+}
+
+static void paste_start(void)
+{
+    if (paste_active || kbdbuf_paste_alarm == NULL) {
+        return;
+    }
+    DBG(("kbdbuf: fast paste of %d characters", num_pending));
+    paste_active = 1;
+    paste_orig_warp_mode = vsync_get_warp_mode();
+    if (!paste_orig_warp_mode) {
+        vsync_set_warp_mode(1);
+    }
+    paste_poll_cycles = PASTE_POLL_MIN;
+    alarm_set(kbdbuf_paste_alarm, maincpu_clk + paste_poll_cycles);
+}
+
 void kbdbuf_reset(int location, int plocation, int size, CLOCK mincycles)
 {
     buffer_location = location;
@@ -316,6 +403,7 @@ void kbdbuf_abort(void)
        option (else we cancel just that during the initial reset) */
     if (kbd_buf_cmdline == false) {
         num_pending = 0;
+        paste_stop();
     }
 }
 
@@ -328,6 +416,9 @@ void kbdbuf_init(int location, int plocation, int size, CLOCK mincycles)
         mincycles += KbdbufDelay;
     }
     kbdbuf_flush_alarm = alarm_new(maincpu_alarm_context, "Keybuf", kbdbuf_flush_alarm_triggered, NULL);
+    if (kbdbuf_paste_alarm == NULL) {
+        kbdbuf_paste_alarm = alarm_new(maincpu_alarm_context, "KeybufPaste", kbdbuf_paste_alarm_triggered, NULL);
+    }
     kbdbuf_reset(location, plocation, size, mincycles);
     /* printf("kbdbuf_init cmdline_get_autostart_mode(): %d\n", cmdline_get_autostart_mode()); */
     /* inject string given to -keybuf option on commandline into keyboard buffer,
@@ -358,6 +449,19 @@ int kbdbuf_feed(const char *string)
     return string_to_queue(string);
 }
 
+/* used by the "paste" UI actions: texts longer than the buffer are pasted
+   in warp mode if KbdbufFastPaste is set */
+int kbdbuf_paste(const char *string)
+{
+    if (kbdbuf_feed(string) < 0) {
+        return -1;
+    }
+    if (KbdbufFastPaste && num_pending > 0) {
+        paste_start();
+    }
+    return 0;
+}
+
 /* used by autostart to feed "RUN" */
 int kbdbuf_feed_runcmd(const char *string)
 {
@@ -37,6 +37,7 @@ void kbdbuf_shutdown(void);
 void kbdbuf_abort(void);
 void kbdbuf_reset(int location, int plocation, int buffer_size, CLOCK mincycles);
 int kbdbuf_feed(const char *s);
+int kbdbuf_paste(const char *string);
 int kbdbuf_feed_runcmd(const char *string);
 int kbdbuf_feed_string(const char *string);
 void kbdbuf_feed_cmdline(void);
@@ -49,6 +49,7 @@
 
 #include "alarm.h"
 #include "archdep.h"
+#include "autowarp.h"
 #include "cmdline.h"
 #include "joystick.h"
 #include "kbd.h"
@@ -768,6 +769,10 @@ void keyboard_key_pressed(signed long key, int mod)
         return;
     }
 
+    keymap_load_pending();
+
+    autowarp_user_input();
+
     /* RESTORE, extra custom keys */
     if (keyboard_custom_key_func_by_keysym((int)key, 1)) {
         return;
@@ -819,6 +824,8 @@ void keyboard_key_released(signed long key, int mod)
         return;
     }
 
+    keymap_load_pending();
+
     /* RESTORE, extra custom keys */
     if (keyboard_custom_key_func_by_keysym((int)key, 0)) {
         return;
@@ -890,6 +897,8 @@ void keyboard_set_keyarr_any(int row, int col, int value)
     DBGKEY(("keyboard_set_keyarr_any val:%3d row:%d col:%d\n", value, row, col));
 
     if (row < 0) {
+        keymap_load_pending();
+
         /* handle special negative row values */
         if ((row == KBD_ROW_RESTORE_1) && (col == KBD_COL_RESTORE_1)) {
             sym = key_ctrl_restore1;
@@ -1058,6 +1067,7 @@ void keyboard_set_shiftlock(int state)
     /* only alter the shift lock state when a caps lock key was defined in the
        host keymap. if shift lock is mapped to a regular key we don't have to
        do anything and leave the state alone */
+    keymap_load_pending();
     if (keyconvmap_has_caps_lock) {
         keyboard_shiftlock = state;
         keyboard_latch_modifier_states();
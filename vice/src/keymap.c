@@ -126,6 +126,9 @@ int key_flags_caps = 0;   /* default is locked! */
 /* Is the resource code ready to load the keymap?  */
 static int load_keymap_ok = 0;
 
+/* Set by keymap_init(), the keymap is loaded when it is first needed.  */
+static int keymap_pending = 0;
+
 static int machine_keyboard_mapping = 0;
 static int machine_keyboard_type = 0;
 
@@ -787,6 +790,8 @@ static int keyboard_keymap_load(const char *filename)
 
 void keyboard_set_map_any(signed long sym, int row, int col, int shift)
 {
+    keymap_load_pending();
+
     if (row >= 0) {
         keyboard_parse_set_pos_row(sym, row, col, shift);
     } else {
@@ -796,6 +801,8 @@ void keyboard_set_map_any(signed long sym, int row, int col, int shift)
 
 void keyboard_set_unmap_any(signed long sym)
 {
+    keymap_load_pending();
+
     keyboard_keysym_undef(sym);
 }
 
@@ -808,6 +815,8 @@ int keyboard_keymap_dump(const char *filename)
         return -1;
     }
 
+    keymap_load_pending();
+
     fp = fopen(filename, MODE_WRITE_TEXT);
 
     if (fp == NULL) {
@@ -1064,6 +1073,7 @@ static int load_keymap_file(int val)
         }
 
         DBG(("load_keymap_file(%d) calls keyboard_keymap_load(%s)\n", val, name));
+        keymap_pending = 0;
         if (keyboard_keymap_load(name) >= 0) {
 
         } else {
@@ -1610,10 +1620,23 @@ int keymap_cmdline_options_init(void)
 
 /*--------------------------------------------------------------------------*/
 
+/* The keymap is not parsed here, but on the first key event (or when a
+   key is remapped or the keymap dumped), so starting up without using the
+   keyboard, as in batch runs, does not read it at all.  Changing a keymap
+   resource later loads it right away.  */
 void keymap_init(void)
 {
     if (machine_class != VICE_MACHINE_VSID) {
         load_keymap_ok = 1;
+        keymap_pending = 1;
+    }
+}
+
+/* Load the keymap if keymap_init() deferred it.  */
+void keymap_load_pending(void)
+{
+    if (keymap_pending) {
+        keymap_pending = 0;
         keyboard_set_keymap_index(machine_keymap_index, NULL);
     }
 }
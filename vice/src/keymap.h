@@ -171,6 +171,7 @@ extern signed long key_joy_keypad[KBD_JOY_KEYPAD_ROWS][KBD_JOY_KEYPAD_COLS]; /*F
 /*****************************************************************************/
 
 void keymap_init(void);
+void keymap_load_pending(void);
 void keymap_shutdown(void);
 
 int keymap_cmdline_options_init(void);
@@ -748,6 +748,141 @@ char *lib_msprintf(const char *fmt, ...)
 
 /*----------------------------------------------------------------------------*/
 
+#ifdef LIB_ALLOC_STATS
+/* Configured with --enable-alloc-stats, every allocation made through the
+   macros of lib.h is counted for its file and line.  The sites go into an
+   open addressing table keyed on the __FILE__ pointer and the line; a
+   reset only clears the counts, so the sites found stay in place.  */
+
+#define LIB_ALLOC_SITES 4096    /* power of two */
+
+static lib_alloc_site_t alloc_sites[LIB_ALLOC_SITES];
+
+#ifdef USE_VICE_THREAD
+#include <pthread.h>
+static pthread_mutex_t alloc_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LIB_ALLOC_STATS_LOCK() pthread_mutex_lock(&alloc_stats_lock)
+#define LIB_ALLOC_STATS_UNLOCK() pthread_mutex_unlock(&alloc_stats_lock)
+#else
+#define LIB_ALLOC_STATS_LOCK()
+#define LIB_ALLOC_STATS_UNLOCK()
+#endif
+
+static void lib_alloc_count(const char *name, unsigned int line, size_t size)
+{
+    unsigned int i, n;
+    lib_alloc_site_t *site;
+
+    i = (unsigned int)(((uintptr_t)name >> 3) * 31 + line) & (LIB_ALLOC_SITES - 1);
+
+    LIB_ALLOC_STATS_LOCK();
+    for (n = 0; n < LIB_ALLOC_SITES; n++) {
+        site = &alloc_sites[i];
+        if (site->name == NULL) {
+            site->name = name;
+            site->line = line;
+        }
+        if (site->name == name && site->line == line) {
+            site->calls++;
+            site->bytes += size;
+            break;
+        }
+        i = (i + 1) & (LIB_ALLOC_SITES - 1);
+    }
+    LIB_ALLOC_STATS_UNLOCK();
+}
+
+int lib_alloc_stats_get(lib_alloc_site_t *sites, int max, unsigned long *total)
+{
+    int i, j, count = 0;
+
+    *total = 0;
+
+    LIB_ALLOC_STATS_LOCK();
+    for (i = 0; i < LIB_ALLOC_SITES; i++) {
+        const lib_alloc_site_t *site = &alloc_sites[i];
+
+        if (site->calls == 0) {
+            continue;
+        }
+        *total += site->calls;
+
+        /* insert into the sorted list of the busiest sites */
+        for (j = count; j > 0 && sites[j - 1].calls < site->calls; j--) {
+            if (j < max) {
+                sites[j] = sites[j - 1];
+            }
+        }
+        if (j < max) {
+            sites[j] = *site;
+            if (count < max) {
+                count++;
+            }
+        }
+    }
+    LIB_ALLOC_STATS_UNLOCK();
+
+    return count;
+}
+
+void lib_alloc_stats_reset(void)
+{
+    int i;
+
+    LIB_ALLOC_STATS_LOCK();
+    for (i = 0; i < LIB_ALLOC_SITES; i++) {
+        alloc_sites[i].calls = 0;
+        alloc_sites[i].bytes = 0;
+    }
+    LIB_ALLOC_STATS_UNLOCK();
+}
+
+void *lib_malloc_counted(size_t size, const char *name, unsigned int line)
+{
+    lib_alloc_count(name, line, size);
+    return lib_malloc(size);
+}
+
+void *lib_calloc_counted(size_t nmemb, size_t size, const char *name, unsigned int line)
+{
+    lib_alloc_count(name, line, nmemb * size);
+    return lib_calloc(nmemb, size);
+}
+
+void *lib_realloc_counted(void *p, size_t size, const char *name, unsigned int line)
+{
+    lib_alloc_count(name, line, size);
+    return lib_realloc(p, size);
+}
+
+char *lib_strdup_counted(const char *str, const char *name, unsigned int line)
+{
+    lib_alloc_count(name, line, str != NULL ? strlen(str) + 1 : 0);
+    return lib_strdup(str);
+}
+
+char *lib_mvsprintf_counted(const char *name, unsigned int line, const char *fmt, va_list args)
+{
+    char *p = lib_mvsprintf(fmt, args);
+
+    lib_alloc_count(name, line, p != NULL ? strlen(p) + 1 : 0);
+    return p;
+}
+
+char *lib_msprintf_counted(const char *name, unsigned int line, const char *fmt, ...)
+{
+    va_list args;
+    char *p;
+
+    va_start(args, fmt);
+    p = lib_mvsprintf_counted(name, line, fmt, args);
+    va_end(args);
+
+    return p;
+}
+
+#endif
+
 #ifdef LIB_DEBUG_PINPOINT
 void *lib_malloc_pinpoint(size_t size, const char *name, unsigned int line)
 {
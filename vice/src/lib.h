@@ -41,6 +41,11 @@
 #define LIB_DEBUG_PINPOINT
 #endif
 
+#if defined(USE_ALLOC_STATS) && !defined(LIB_DEBUG_PINPOINT)
+/* count the allocations per call site, see lib_alloc_stats_get() */
+#define LIB_ALLOC_STATS
+#endif
+
 void lib_init(void);
 
 unsigned int lib_unsigned_rand(unsigned int min, unsigned int max);
@@ -71,8 +76,35 @@ char *lib_strdup_pinpoint(const char *str, const char *name, unsigned int line);
 
 #endif /* !COMPILING_LIB_DOT_C */
 
+#elif defined(LIB_ALLOC_STATS)
+
+void *lib_malloc_counted(size_t size, const char *name, unsigned int line);
+void *lib_calloc_counted(size_t nmemb, size_t size, const char *name, unsigned int line);
+void *lib_realloc_counted(void *p, size_t size, const char *name, unsigned int line);
+char *lib_strdup_counted(const char *str, const char *name, unsigned int line);
+char *lib_msprintf_counted(const char *name, unsigned int line, const char *fmt, ...) VICE_ATTR_PRINTF3;
+char *lib_mvsprintf_counted(const char *name, unsigned int line, const char *fmt, va_list args);
+
+void *lib_malloc(size_t size);
+void *lib_calloc(size_t nmemb, size_t size);
+void *lib_realloc(void *p, size_t size);
+void lib_free(void *ptr);
+
+char *lib_strdup(const char *str);
+
+#ifndef COMPILING_LIB_DOT_C
+
+#define lib_malloc(x) lib_malloc_counted(x, __FILE__, __LINE__)
+#define lib_calloc(x, y) lib_calloc_counted(x, y, __FILE__, __LINE__)
+#define lib_realloc(x, y) lib_realloc_counted(x, y, __FILE__, __LINE__)
+#define lib_strdup(x) lib_strdup_counted(x, __FILE__, __LINE__)
+#define lib_msprintf(...) lib_msprintf_counted(__FILE__, __LINE__, __VA_ARGS__)
+#define lib_mvsprintf(x, y) lib_mvsprintf_counted(__FILE__, __LINE__, x, y)
+
+#endif /* !COMPILING_LIB_DOT_C */
+
 #else
-/* !defined LIB_DEBUG_PINPOINT */
+/* !defined LIB_DEBUG_PINPOINT && !defined LIB_ALLOC_STATS */
 
 void *lib_malloc(size_t size);
 void *lib_calloc(size_t nmemb, size_t size);
@@ -83,6 +115,21 @@ char *lib_strdup(const char *str);
 
 #endif /* LIB_DEBUG_PINPOINT */
 
+#ifdef LIB_ALLOC_STATS
+typedef struct lib_alloc_site_s {
+    const char *name;       /* source file */
+    unsigned int line;
+    unsigned long calls;
+    uint64_t bytes;
+} lib_alloc_site_t;
+
+/* Copy up to `max' call sites with the most allocations since the last
+   reset into `sites', the most frequent first, and return how many were
+   copied.  The number of allocations of all sites goes into *total.  */
+int lib_alloc_stats_get(lib_alloc_site_t *sites, int max, unsigned long *total);
+void lib_alloc_stats_reset(void);
+#endif
+
 char *lib_strdup_trimmed(char *str);
 
 void lib_debug_set_output(int state);
@@ -19,6 +19,7 @@
 #include "zmbv.h"
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -111,6 +112,21 @@ typedef struct {
 } zmbv_codec_vector_t;
 
 
+/* result of the motion search for one block */
+typedef struct {
+  int8_t vx, vy;
+  uint8_t changed;
+} zmbv_block_match_t;
+
+
+/* thread searching a slice of the blocks */
+typedef struct {
+  struct zmbv_codec_s *zc;
+  int index;
+  pthread_t thread;
+} zmbv_search_helper_t;
+
+
 typedef struct ATTR_PACKED {
   uint8_t high_version;
   uint8_t low_version;
@@ -153,6 +169,18 @@ struct zmbv_codec_s {
 
   int blockcount;
   zmbv_frame_block_t *blocks;
+  zmbv_block_match_t *matches;
+
+  /* the motion search of a delta frame is split into slices of blocks,
+     one for the calling thread and one for each helper */
+  int threads;
+  zmbv_search_helper_t *helpers;
+  pthread_mutex_t search_lock;
+  pthread_cond_t search_start_cond;
+  pthread_cond_t search_done_cond;
+  unsigned int search_generation;
+  int search_pending;
+  int search_quit;
 
   int workUsed, workPos;
 
@@ -221,12 +249,9 @@ static inline void zmbv_add_xor_block_##_pxsize (zmbv_codec_t zc, int vx, int vy
 }
 
 
-#define ZMBV_ADD_XOR_FRAME_TPL(_pxtype,_pxsize) \
-static inline void zmbv_add_xor_frame_##_pxsize (zmbv_codec_t zc) { \
-  int8_t *vectors = (int8_t *)&zc->work[zc->workUsed]; \
-  /* align the following xor data on 4 byte boundary */ \
-  zc->workUsed = (zc->workUsed+zc->blockcount*2+3)&~3; \
-  for (int b = 0; b < zc->blockcount; ++b) { \
+#define ZMBV_SEARCH_BLOCKS_TPL(_pxtype,_pxsize) \
+static void zmbv_search_blocks_##_pxsize (zmbv_codec_t zc, int first, int last) { \
+  for (int b = first; b < last; ++b) { \
     zmbv_frame_block_t *block = &zc->blocks[b]; \
     int bestvx = 0; \
     int bestvy = 0; \
@@ -247,11 +272,28 @@ static inline void zmbv_add_xor_frame_##_pxsize (zmbv_codec_t zc) { \
         } \
       } \
     } \
+    zc->matches[b].vx = bestvx; \
+    zc->matches[b].vy = bestvy; \
+    zc->matches[b].changed = (bestchange != 0); \
+  } \
+}
+
+
+/* the blocks must have been searched before, the output only depends on the
+   search results and is the same for any number of threads */
+#define ZMBV_ADD_XOR_FRAME_TPL(_pxtype,_pxsize) \
+static inline void zmbv_add_xor_frame_##_pxsize (zmbv_codec_t zc) { \
+  int8_t *vectors = (int8_t *)&zc->work[zc->workUsed]; \
+  /* align the following xor data on 4 byte boundary */ \
+  zc->workUsed = (zc->workUsed+zc->blockcount*2+3)&~3; \
+  for (int b = 0; b < zc->blockcount; ++b) { \
+    int bestvx = zc->matches[b].vx; \
+    int bestvy = zc->matches[b].vy; \
     vectors[b*2+0] = (bestvx << 1); \
     vectors[b*2+1] = (bestvy << 1); \
-    if (bestchange) { \
+    if (zc->matches[b].changed) { \
       vectors[b*2+0] |= 1; \
-      zmbv_add_xor_block_##_pxsize(zc, bestvx, bestvy, block); \
+      zmbv_add_xor_block_##_pxsize(zc, bestvx, bestvy, &zc->blocks[b]); \
     } \
   } \
 }
@@ -269,11 +311,122 @@ ZMBV_ADD_XOR_BLOCK_TPL(uint8_t,  8)
 ZMBV_ADD_XOR_BLOCK_TPL(uint16_t,16)
 ZMBV_ADD_XOR_BLOCK_TPL(uint32_t,32)
 
+ZMBV_SEARCH_BLOCKS_TPL(uint8_t,  8)
+ZMBV_SEARCH_BLOCKS_TPL(uint16_t,16)
+ZMBV_SEARCH_BLOCKS_TPL(uint32_t,32)
+
 ZMBV_ADD_XOR_FRAME_TPL(uint8_t,  8)
 ZMBV_ADD_XOR_FRAME_TPL(uint16_t,16)
 ZMBV_ADD_XOR_FRAME_TPL(uint32_t,32)
 
 
+/******************************************************************************/
+/* search the slice `index' of `zc->threads' slices of the blocks */
+static void zmbv_search_slice (zmbv_codec_t zc, int index) {
+  int first = (int)((long long)zc->blockcount*index/zc->threads);
+  int last = (int)((long long)zc->blockcount*(index+1)/zc->threads);
+  switch (zc->format) {
+    case ZMBV_FORMAT_8BPP: zmbv_search_blocks_8(zc, first, last); break;
+    case ZMBV_FORMAT_15BPP: case ZMBV_FORMAT_16BPP: zmbv_search_blocks_16(zc, first, last); break;
+    case ZMBV_FORMAT_32BPP: zmbv_search_blocks_32(zc, first, last); break;
+    default: break;
+  }
+}
+
+
+static void *zmbv_search_thread (void *arg) {
+  zmbv_search_helper_t *helper = (zmbv_search_helper_t *)arg;
+  zmbv_codec_t zc = helper->zc;
+  unsigned int generation = 0;
+
+  pthread_mutex_lock(&zc->search_lock);
+  for (;;) {
+    while (zc->search_generation == generation && !zc->search_quit) {
+      pthread_cond_wait(&zc->search_start_cond, &zc->search_lock);
+    }
+    if (zc->search_quit) break;
+    generation = zc->search_generation;
+    pthread_mutex_unlock(&zc->search_lock);
+
+    zmbv_search_slice(zc, helper->index);
+
+    pthread_mutex_lock(&zc->search_lock);
+    if (--zc->search_pending == 0) pthread_cond_signal(&zc->search_done_cond);
+  }
+  pthread_mutex_unlock(&zc->search_lock);
+  return NULL;
+}
+
+
+/* search all blocks, using the helpers for all slices but the first */
+static void zmbv_search_frame (zmbv_codec_t zc) {
+  if (zc->helpers == NULL) {
+    zmbv_search_slice(zc, 0);
+    return;
+  }
+  pthread_mutex_lock(&zc->search_lock);
+  zc->search_pending = zc->threads-1;
+  ++zc->search_generation;
+  pthread_cond_broadcast(&zc->search_start_cond);
+  pthread_mutex_unlock(&zc->search_lock);
+
+  zmbv_search_slice(zc, 0);
+
+  pthread_mutex_lock(&zc->search_lock);
+  while (zc->search_pending > 0) {
+    pthread_cond_wait(&zc->search_done_cond, &zc->search_lock);
+  }
+  pthread_mutex_unlock(&zc->search_lock);
+}
+
+
+static void zmbv_stop_helpers (zmbv_codec_t zc) {
+  if (zc->helpers != NULL) {
+    pthread_mutex_lock(&zc->search_lock);
+    zc->search_quit = 1;
+    pthread_cond_broadcast(&zc->search_start_cond);
+    pthread_mutex_unlock(&zc->search_lock);
+    for (int i = 1; i < zc->threads; ++i) pthread_join(zc->helpers[i].thread, NULL);
+    free(zc->helpers);
+    zc->helpers = NULL;
+    pthread_cond_destroy(&zc->search_done_cond);
+    pthread_cond_destroy(&zc->search_start_cond);
+    pthread_mutex_destroy(&zc->search_lock);
+  }
+  zc->threads = 1;
+}
+
+
+int zmbv_encode_set_threads (zmbv_codec_t zc, int threads) {
+  if (zc == NULL) return -1;
+  zmbv_stop_helpers(zc);
+  if (threads > ZMBV_MAX_THREADS) threads = ZMBV_MAX_THREADS;
+  if (threads <= 1) return 0;
+
+  zc->helpers = calloc(threads, sizeof(zmbv_search_helper_t));
+  if (zc->helpers == NULL) return -1;
+  pthread_mutex_init(&zc->search_lock, NULL);
+  pthread_cond_init(&zc->search_start_cond, NULL);
+  pthread_cond_init(&zc->search_done_cond, NULL);
+  zc->search_generation = 0;
+  zc->search_pending = 0;
+  zc->search_quit = 0;
+
+  for (int i = 1; i < threads; ++i) {
+    zc->helpers[i].zc = zc;
+    zc->helpers[i].index = i;
+    if (pthread_create(&zc->helpers[i].thread, NULL, zmbv_search_thread, &zc->helpers[i]) != 0) {
+      /* run with the helpers started so far */
+      threads = i;
+      break;
+    }
+  }
+  zc->threads = threads;
+  if (threads <= 1) zmbv_stop_helpers(zc);
+  return 0;
+}
+
+
 /* decoder templates */
 #ifdef ZMBV_INCLUDE_DECODER
 
@@ -365,6 +518,7 @@ zmbv_codec_t zmbv_codec_new (zmvb_init_flags_t flags, int complevel) {
     zc->zstream_inited = 0;
     */
     memset(zc, 0, sizeof(*zc));
+    zc->threads = 1;
     zc->init_flags = flags;
     if (complevel < 0) complevel = 4;
     else if (complevel > 9) complevel = 9;
@@ -379,10 +533,12 @@ zmbv_codec_t zmbv_codec_new (zmvb_init_flags_t flags, int complevel) {
 static void zmbv_free_buffers (zmbv_codec_t zc) {
   if (zc != NULL) {
     if (zc->blocks != NULL) free(zc->blocks);
+    if (zc->matches != NULL) free(zc->matches);
     if (zc->buf1 != NULL) free(zc->buf1);
     if (zc->buf2 != NULL) free(zc->buf2);
     if (zc->work != NULL) free(zc->work);
     zc->blocks = NULL;
+    zc->matches = NULL;
     zc->buf1 = NULL;
     zc->buf2 = NULL;
     zc->work = NULL;
@@ -403,6 +559,7 @@ static void zmbv_zlib_deinit (zmbv_codec_t zc) {
 
 void zmbv_codec_free (zmbv_codec_t zc) {
   if (zc != NULL) {
+    zmbv_stop_helpers(zc);
     zmbv_zlib_deinit(zc);
     zmbv_free_buffers(zc);
     free(zc);
@@ -451,7 +608,8 @@ static int zmbv_setup_buffers (zmbv_codec_t zc, zmbv_format_t format, int blockw
 
     zc->blockcount = yblocks*xblocks;
     zc->blocks = malloc(sizeof(zmbv_frame_block_t)*zc->blockcount);
-    if (zc->blocks == NULL) { zmbv_free_buffers(zc); return -1; }
+    zc->matches = malloc(sizeof(zmbv_block_match_t)*zc->blockcount);
+    if (zc->blocks == NULL || zc->matches == NULL) { zmbv_free_buffers(zc); return -1; }
 
     i = 0;
     for (int y = 0; y < yblocks; ++y) {
@@ -614,6 +772,7 @@ int zmvb_encode_finish_frame (zmbv_codec_t zc) {
       }
     } else {
       /* add the delta frame data */
+      zmbv_search_frame(zc);
       switch (zc->format) {
         case ZMBV_FORMAT_8BPP: zmbv_add_xor_frame_8(zc); break;
         case ZMBV_FORMAT_15BPP: case ZMBV_FORMAT_16BPP: zmbv_add_xor_frame_16(zc); break;
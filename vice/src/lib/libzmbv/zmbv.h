@@ -83,6 +83,15 @@ static inline int zmbv_encode_line (zmbv_codec_t zc, const void *line_data) { re
 /* return # of bytes written in outbuf or <0 on error; NEVER returns 0 */
 extern int zmvb_encode_finish_frame (zmbv_codec_t zc);
 
+/* most threads the motion search of a delta frame may use */
+#define ZMBV_MAX_THREADS  (16)
+
+/* search the blocks of a delta frame with `threads' threads: the one calling
+   zmvb_encode_finish_frame() and threads-1 started here; the encoded frames
+   do not change. 1 (the default) searches on the calling thread only */
+/* return <0 on error; 0 on ok */
+extern int zmbv_encode_set_threads (zmbv_codec_t zc, int threads);
+
 
 #ifdef ZMBV_INCLUDE_DECODER
 /* return <0 on error; 0 on ok */
@@ -407,6 +407,17 @@ void P64PulseStreamCreate(PP64PulseStream Instance) {
     Instance->CurrentIndex = -1;
 }
 
+/* Forget the encoded track, the pulses are about to change */
+static void P64PulseStreamModify(PP64PulseStream Instance) {
+    P64PulseStreamDecode(Instance);
+    if(Instance->Encoded) {
+        p64_free(Instance->Encoded);
+        Instance->Encoded = 0;
+        Instance->EncodedSize = 0;
+    }
+    Instance->Modified = 1;
+}
+
 void P64PulseStreamDestroy(PP64PulseStream Instance) {
     P64PulseStreamClear(Instance);
     memset(Instance, 0, sizeof(TP64PulseStream));
@@ -416,6 +427,19 @@ void P64PulseStreamClear(PP64PulseStream Instance) {
     if(Instance->Pulses) {
         p64_free(Instance->Pulses);
     }
+    if(Instance->Encoded) {
+        p64_free(Instance->Encoded);
+    }
+    if(Instance->Sorted) {
+        p64_free(Instance->Sorted);
+    }
+    Instance->Sorted = 0;
+    Instance->SortedAllocated = 0;
+    Instance->SortedCount = 0;
+    Instance->SortedValid = 0;
+    Instance->Encoded = 0;
+    Instance->EncodedSize = 0;
+    Instance->EncodedPending = 0;
     Instance->Pulses = 0;
     Instance->PulsesAllocated = 0;
     Instance->PulsesCount = 0;
@@ -454,6 +478,7 @@ p64_int32_t P64PulseStreamAllocatePulse(PP64PulseStream Instance) {
 }
 
 void P64PulseStreamFreePulse(PP64PulseStream Instance, p64_int32_t Index) {
+    Instance->SortedValid = 0;
     if(Instance->CurrentIndex == Index) {
         Instance->CurrentIndex = Instance->Pulses[Index].Next;
     }
@@ -472,8 +497,9 @@ void P64PulseStreamFreePulse(PP64PulseStream Instance, p64_int32_t Index) {
     Instance->FreeList = Index;
 }
 
-void P64PulseStreamAddPulse(PP64PulseStream Instance, p64_uint32_t Position, p64_uint32_t Strength) {
+static void P64PulseStreamInsertPulse(PP64PulseStream Instance, p64_uint32_t Position, p64_uint32_t Strength) {
     p64_int32_t Current, Index;
+    Instance->SortedValid = 0;
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -517,9 +543,15 @@ void P64PulseStreamAddPulse(PP64PulseStream Instance, p64_uint32_t Position, p64
     Instance->CurrentIndex = Index;
 }
 
+void P64PulseStreamAddPulse(PP64PulseStream Instance, p64_uint32_t Position, p64_uint32_t Strength) {
+    P64PulseStreamModify(Instance);
+    P64PulseStreamInsertPulse(Instance, Position, Strength);
+}
+
 void P64PulseStreamRemovePulses(PP64PulseStream Instance, p64_uint32_t Position, p64_uint32_t Count) {
     p64_uint32_t ToDo;
     p64_int32_t Current, Next;
+    P64PulseStreamModify(Instance);
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -544,6 +576,7 @@ void P64PulseStreamRemovePulses(PP64PulseStream Instance, p64_uint32_t Position,
 
 void P64PulseStreamRemovePulse(PP64PulseStream Instance, p64_uint32_t Position) {
     p64_int32_t Current;
+    P64PulseStreamModify(Instance);
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -561,6 +594,7 @@ void P64PulseStreamRemovePulse(PP64PulseStream Instance, p64_uint32_t Position)
 
 p64_uint32_t P64PulseStreamDeltaPositionToNextPulse(PP64PulseStream Instance, p64_uint32_t Position) {
     p64_int32_t Current;
+    P64PulseStreamDecode(Instance);
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -585,6 +619,7 @@ p64_uint32_t P64PulseStreamDeltaPositionToNextPulse(PP64PulseStream Instance, p6
 
 p64_uint32_t P64PulseStreamGetNextPulse(PP64PulseStream Instance, p64_uint32_t Position) {
     p64_int32_t Current;
+    P64PulseStreamDecode(Instance);
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -607,8 +642,57 @@ p64_uint32_t P64PulseStreamGetNextPulse(PP64PulseStream Instance, p64_uint32_t P
     }
 }
 
+static void P64PulseStreamSort(PP64PulseStream Instance) {
+    p64_int32_t Current;
+    p64_uint32_t Count;
+    Count = 0;
+    Current = Instance->UsedFirst;
+    while(Current >= 0) {
+        Count++;
+        Current = Instance->Pulses[Current].Next;
+    }
+    if(Count > Instance->SortedAllocated) {
+        if(Instance->Sorted) {
+            p64_free(Instance->Sorted);
+        }
+        Instance->SortedAllocated = Count;
+        Instance->Sorted = p64_malloc(Count * sizeof(p64_int32_t));
+    }
+    Count = 0;
+    Current = Instance->UsedFirst;
+    while(Current >= 0) {
+        Instance->Sorted[Count++] = Current;
+        Current = Instance->Pulses[Current].Next;
+    }
+    Instance->SortedCount = Count;
+    Instance->SortedValid = 1;
+}
+
+/* Find the first pulse at or after Position without wrapping around, or -1;
+   a binary search over the pulses in position order instead of a walk along
+   the pulse list from the current or the first pulse */
+p64_int32_t P64PulseStreamFindPulse(PP64PulseStream Instance, p64_uint32_t Position) {
+    p64_uint32_t Low, High, Middle;
+    P64PulseStreamDecode(Instance);
+    if(!Instance->SortedValid) {
+        P64PulseStreamSort(Instance);
+    }
+    Low = 0;
+    High = Instance->SortedCount;
+    while(Low < High) {
+        Middle = Low + ((High - Low) >> 1);
+        if(Instance->Pulses[Instance->Sorted[Middle]].Position < Position) {
+            Low = Middle + 1;
+        } else {
+            High = Middle;
+        }
+    }
+    return (Low < Instance->SortedCount) ? Instance->Sorted[Low] : -1;
+}
+
 p64_uint32_t P64PulseStreamGetPulseCount(PP64PulseStream Instance) {
     p64_int32_t Current, Count = 0;
+    P64PulseStreamDecode(Instance);
     Current = Instance->CurrentIndex;
     while(Current >= 0) {
         Count++;
@@ -619,6 +703,7 @@ p64_uint32_t P64PulseStreamGetPulseCount(PP64PulseStream Instance) {
 
 p64_uint32_t P64PulseStreamGetPulse(PP64PulseStream Instance, p64_uint32_t Position) {
     p64_int32_t Current;
+    P64PulseStreamDecode(Instance);
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -647,6 +732,7 @@ void P64PulseStreamSetPulse(PP64PulseStream Instance, p64_uint32_t Position, p64
 
 void P64PulseStreamSeek(PP64PulseStream Instance, p64_uint32_t Position) {
     p64_int32_t Current;
+    P64PulseStreamDecode(Instance);
     while(Position >= P64PulseSamplesPerRotation) {
         Position -= P64PulseSamplesPerRotation;
     }
@@ -663,6 +749,7 @@ void P64PulseStreamSeek(PP64PulseStream Instance, p64_uint32_t Position) {
 void P64PulseStreamConvertFromGCR(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len) {
     p64_uint32_t PositionHi, PositionLo, IncrementHi, IncrementLo, BitStreamPosition;
     P64PulseStreamClear(Instance);
+    Instance->Modified = 1;
     if(Len) {
         IncrementHi = P64PulseSamplesPerRotation / Len;
         IncrementLo = P64PulseSamplesPerRotation % Len;
@@ -670,7 +757,7 @@ void P64PulseStreamConvertFromGCR(PP64PulseStream Instance, p64_uint8_t* Bytes,
         PositionLo = (P64PulseSamplesPerRotation >> 1) % Len;
         for(BitStreamPosition = 0; BitStreamPosition < Len; BitStreamPosition++) {
             if(((p64_uint8_t)(Bytes[BitStreamPosition >> 3])) & (1 << ((~BitStreamPosition) & 7))) {
-                P64PulseStreamAddPulse(Instance, PositionHi, 0xffffffffUL);
+                P64PulseStreamInsertPulse(Instance, PositionHi, 0xffffffffUL);
             }
             PositionHi += IncrementHi;
             PositionLo += IncrementLo;
@@ -686,6 +773,7 @@ void P64PulseStreamConvertFromGCR(PP64PulseStream Instance, p64_uint8_t* Bytes,
 void P64PulseStreamConvertToGCR(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len) {
     p64_uint32_t Range, PositionHi, PositionLo, IncrementHi, IncrementLo, BitStreamPosition;
     p64_int32_t Current;
+    P64PulseStreamDecode(Instance);
     if(Len) {
         memset(Bytes, 0, (Len + 7) >> 3);
         Range = P64PulseSamplesPerRotation;
@@ -724,6 +812,7 @@ void P64PulseStreamConvertToGCR(PP64PulseStream Instance, p64_uint8_t* Bytes, p6
 p64_uint32_t P64PulseStreamConvertToGCRWithLogic(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len, p64_uint32_t SpeedZone) {
     p64_uint32_t Position, LastPosition, Delta, DelayCounter, FlipFlop, LastFlipFlop, Clock, Counter, BitStreamPosition;
     p64_int32_t Current;
+    P64PulseStreamDecode(Instance);
     if(Len) {
         memset(Bytes, 0, (Len + 7) >> 3);
         LastPosition = 0;
@@ -856,7 +945,7 @@ p64_uint32_t P64PulseStreamReadFromStream(PP64PulseStream Instance, PP64MemorySt
                         Strength += result;
                     }
 
-                    P64PulseStreamAddPulse(Instance, Position, Strength);
+                    P64PulseStreamInsertPulse(Instance, Position, Strength);
 
                     Count++;
                 }
@@ -888,6 +977,11 @@ p64_uint32_t P64PulseStreamWriteToStream(PP64PulseStream Instance, PP64MemoryStr
     p64_int32_t Index, Current;
     p64_uint32_t ProbabilityCount, LastPosition, PreviousDeltaPosition, DeltaPosition, LastStrength, CountPulses, Size;
 
+    /* unchanged tracks are written as they were read */
+    if(Instance->Encoded) {
+        return P64MemoryStreamWrite(Stream, Instance->Encoded, Instance->EncodedSize) == Instance->EncodedSize;
+    }
+
     ProbabilityCount = 0;
     for(Index = 0; Index < ProbabilityModelCount; Index++) {
         RangeCoderProbabilityOffsets[Index] = ProbabilityCount;
@@ -981,6 +1075,46 @@ p64_uint32_t P64PulseStreamWriteToStream(PP64PulseStream Instance, PP64MemoryStr
     return 0;
 }
 
+/* Keep the encoded track of an image, to be decoded on the first access */
+static p64_uint32_t P64PulseStreamSetEncoded(PP64PulseStream Instance, PP64MemoryStream Stream) {
+    p64_uint32_t CountPulses, Size;
+
+    P64PulseStreamClear(Instance);
+    if(P64MemoryStreamReadDWord(Stream, &CountPulses)) {
+        if(P64MemoryStreamReadDWord(Stream, &Size)) {
+            if(!Size) {
+                return CountPulses ? 0 : 1;
+            }
+            if((Stream->Size - Stream->Position) >= Size) {
+                Instance->EncodedSize = Size + 8;
+                Instance->Encoded = p64_malloc(Instance->EncodedSize);
+                memcpy(Instance->Encoded, Stream->Data, Instance->EncodedSize);
+                Instance->EncodedPending = 1;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+void P64PulseStreamDecode(PP64PulseStream Instance) {
+    TP64MemoryStream Stream;
+
+    if(Instance->EncodedPending) {
+        Instance->EncodedPending = 0;
+        Stream.Data = Instance->Encoded;
+        Stream.Allocated = Instance->EncodedSize;
+        Stream.Size = Instance->EncodedSize;
+        Stream.Position = 0;
+        if(!P64PulseStreamReadFromStream(Instance, &Stream)) {
+            /* the checksum of the chunk was right; should it still be
+               broken, the track is empty */
+            P64PulseStreamClear(Instance);
+            Instance->Modified = 1;
+        }
+    }
+}
+
 void P64ImageCreate(PP64Image Instance) {
     p64_int32_t HalfTrack, side;
     memset(Instance, 0, sizeof(TP64Image));
@@ -1021,6 +1155,11 @@ p64_uint32_t P64ImageReadFromStream(PP64Image Instance, PP64MemoryStream Stream)
 
     OK = 0;
     P64ImageClear(Instance);
+    for(side=0; side<2; side++) {
+        for(HalfTrack = 0; HalfTrack <= P64LastHalfTrack; HalfTrack++) {
+            Instance->PulseStreams[side][HalfTrack].Modified = 1;
+        }
+    }
     if(P64MemoryStreamSeek(Stream, 0) == 0) {
         if(P64MemoryStreamRead(Stream, (void*)&HeaderSignature, sizeof(TP64HeaderSignature)) == sizeof(TP64HeaderSignature)) {
             if((HeaderSignature[0] == 'P') && (HeaderSignature[1] == '6') && (HeaderSignature[2] == '4') && (HeaderSignature[3] == '-') && (HeaderSignature[4] == '1') && (HeaderSignature[5] == '5') && (HeaderSignature[6] == '4') && (HeaderSignature[7] == '1')) {
@@ -1057,7 +1196,7 @@ p64_uint32_t P64ImageReadFromStream(PP64Image Instance, PP64MemoryStream Stream)
                                                                                 if((ChunkSignature[0] == 'H') && (ChunkSignature[1] == 'T') && (ChunkSignature[2] == 'P') && (((ChunkSignature[3] & 127) >= P64FirstHalfTrack) && ((ChunkSignature[3] & 127) <= P64LastHalfTrack))) {
                                                                                     HalfTrack = ChunkSignature[3] & 127;
                                                                                     side = !!(ChunkSignature[3] & 128);
-                                                                                    OK = P64PulseStreamReadFromStream(&Instance->PulseStreams[side][HalfTrack], &ChunkMemoryStream);
+                                                                                    OK = P64PulseStreamSetEncoded(&Instance->PulseStreams[side][HalfTrack], &ChunkMemoryStream);
                                                                                 } else {
                                                                                     OK = 1;
                                                                                 }
@@ -1209,3 +1348,24 @@ p64_uint32_t P64ImageWriteToStream(PP64Image Instance, PP64MemoryStream Stream)
 
     return result;
 }
+
+p64_uint32_t P64ImageModified(PP64Image Instance) {
+    p64_int32_t HalfTrack, side;
+    for(side=0; side<2; side++) {
+        for(HalfTrack = 0; HalfTrack <= P64LastHalfTrack; HalfTrack++) {
+            if(Instance->PulseStreams[side][HalfTrack].Modified) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+void P64ImageClearModified(PP64Image Instance) {
+    p64_int32_t HalfTrack, side;
+    for(side=0; side<2; side++) {
+        for(HalfTrack = 0; HalfTrack <= P64LastHalfTrack; HalfTrack++) {
+            Instance->PulseStreams[side][HalfTrack].Modified = 0;
+        }
+    }
+}
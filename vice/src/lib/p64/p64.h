@@ -107,6 +107,19 @@ typedef struct {
 	p64_int32_t UsedLast;
 	p64_int32_t FreeList;
 	p64_int32_t CurrentIndex;
+	/* the track as read from the image ("HTP" chunk contents), while the
+	   pulses are the same; decoded on the first access */
+	p64_uint8_t* Encoded;
+	p64_uint32_t EncodedSize;
+	p64_uint32_t EncodedPending;
+	/* changed since P64ImageClearModified() */
+	p64_uint32_t Modified;
+	/* used pulses in position order, rebuilt on demand after the pulses
+	   change, for binary searches by position */
+	p64_int32_t* Sorted;
+	p64_uint32_t SortedAllocated;
+	p64_uint32_t SortedCount;
+	p64_uint32_t SortedValid;
 } TP64PulseStream;
 
 typedef TP64PulseStream* PP64PulseStream;
@@ -168,11 +181,15 @@ void P64PulseStreamConvertToGCR(PP64PulseStream Instance, p64_uint8_t* Bytes, p6
 p64_uint32_t P64PulseStreamConvertToGCRWithLogic(PP64PulseStream Instance, p64_uint8_t* Bytes, p64_uint32_t Len, p64_uint32_t SpeedZone);
 p64_uint32_t P64PulseStreamReadFromStream(PP64PulseStream Instance, PP64MemoryStream Stream);
 p64_uint32_t P64PulseStreamWriteToStream(PP64PulseStream Instance, PP64MemoryStream Stream);
+void P64PulseStreamDecode(PP64PulseStream Instance);
+p64_int32_t P64PulseStreamFindPulse(PP64PulseStream Instance, p64_uint32_t Position);
 
 void P64ImageCreate(PP64Image Instance);
 void P64ImageDestroy(PP64Image Instance);
 void P64ImageClear(PP64Image Instance);
 p64_uint32_t P64ImageReadFromStream(PP64Image Instance, PP64MemoryStream Stream);
 p64_uint32_t P64ImageWriteToStream(PP64Image Instance, PP64MemoryStream Stream);
+p64_uint32_t P64ImageModified(PP64Image Instance);
+void P64ImageClearModified(PP64Image Instance);
 
 #endif
@@ -0,0 +1,234 @@
+/*
+ * libvice.c - Run the emulator as a library, stepped by its caller.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The library is the headless x64sc with main.c built to return from
+   main_program() instead of entering the main loop (configure
+   --enable-libvice).  The caller runs the main loop in slices: a step sets
+   maincpu_clk_limit, and with maincpu_clk_limit_return the loop returns
+   there, with the registers exported, instead of exiting.  The next step
+   continues from these registers.  vsync does neither sleep nor skip
+   frames meanwhile, the caller decides how fast the emulation runs.
+
+   Anything that exits the emulator (debug cartridge, JAM action "quit",
+   the monitor) still exits the calling process.  */
+
+#include "vice.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "c64mem.h"
+#include "joystick.h"
+#include "keyboard.h"
+#include "lib.h"
+#include "libvice.h"
+#include "machine-video.h"
+#include "machine.h"
+#include "main.h"
+#include "maincpu.h"
+#include "mem.h"
+#include "resources.h"
+#include "snapshot.h"
+#include "types.h"
+#include "util.h"
+#include "video.h"
+#include "videoarch.h"
+#include "vsync.h"
+
+static int libvice_running = 0;
+
+/* The strings of the command line, main_program() keeps some of them.  */
+static char **libvice_args = NULL;
+static int libvice_num_args = 0;
+
+static void libvice_run_until(CLOCK limit)
+{
+    maincpu_clk_limit = limit;
+    maincpu_mainloop();
+}
+
+int libvice_init(const char *machine, int argc, char **argv)
+{
+    char **args;
+    int i, n, result;
+    int sound = 0;
+
+    if (libvice_running || util_strcasecmp(machine, machine_name) != 0) {
+        return -1;
+    }
+
+    /* Hand main_program() a copy of the command line with the program name
+       in front, and sound turned off unless asked for: it would pace the
+       emulation.  main_program() rearranges its argv.  */
+    libvice_args = lib_malloc((argc + 2) * sizeof(char *));
+    n = 0;
+    libvice_args[n++] = lib_strdup("libvice");
+    for (i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-sound") == 0) {
+            sound = 1;
+        }
+        libvice_args[n++] = lib_strdup(argv[i]);
+    }
+    if (!sound) {
+        libvice_args[n++] = lib_strdup("+sound");
+    }
+    libvice_num_args = n;
+
+    args = lib_malloc((n + 1) * sizeof(char *));
+    memcpy(args, libvice_args, n * sizeof(char *));
+    args[n] = NULL;
+
+    result = main_program(n, args);
+    lib_free(args);
+
+    if (result != 0) {
+        return -1;
+    }
+
+    vsync_set_stepped(true);
+    maincpu_clk_limit_return = 1;
+    libvice_running = 1;
+
+    /* The first call resets the machine, from then on the registers are
+       continued from the last step.  */
+    libvice_run_until(maincpu_clk + 1);
+    return 0;
+}
+
+void libvice_shutdown(void)
+{
+    int i;
+
+    if (libvice_running) {
+        libvice_running = 0;
+        main_exit();
+    }
+    for (i = 0; i < libvice_num_args; i++) {
+        lib_free(libvice_args[i]);
+    }
+    lib_free(libvice_args);
+    libvice_args = NULL;
+    libvice_num_args = 0;
+}
+
+int libvice_set_resource(const char *name, const char *value)
+{
+    return resources_set_value_string(name, value);
+}
+
+uint64_t libvice_step_cycles(uint64_t cycles)
+{
+    CLOCK start = maincpu_clk;
+
+    if (cycles > 0) {
+        libvice_run_until(maincpu_clk + (CLOCK)cycles - 1);
+    }
+    return (uint64_t)(maincpu_clk - start);
+}
+
+static void libvice_frame_end(void *param)
+{
+    /* return after the next instruction */
+    maincpu_clk_limit = maincpu_clk;
+}
+
+uint64_t libvice_step_frame(void)
+{
+    CLOCK start = maincpu_clk;
+
+    vsync_on_vsync_do(libvice_frame_end, NULL);
+    libvice_run_until(0);
+    return (uint64_t)(maincpu_clk - start);
+}
+
+uint64_t libvice_clock(void)
+{
+    return (uint64_t)maincpu_clk;
+}
+
+/* ------------------------------------------------------------------------- */
+
+uint8_t *libvice_ram(size_t *size)
+{
+    *size = C64_RAM_SIZE;
+    return mem_ram;
+}
+
+uint8_t *libvice_color_ram(size_t *size)
+{
+    *size = 0x400;
+    return mem_color_ram_cpu;
+}
+
+const uint8_t *libvice_framebuffer(unsigned int *width, unsigned int *height,
+                                   unsigned int *pitch)
+{
+    video_canvas_t *canvas = machine_video_canvas_get(0);
+
+    if (canvas == NULL || canvas->draw_buffer == NULL) {
+        return NULL;
+    }
+    *width = canvas->draw_buffer->draw_buffer_width;
+    *height = canvas->draw_buffer->draw_buffer_height;
+    *pitch = canvas->draw_buffer->draw_buffer_pitch;
+    return canvas->draw_buffer->draw_buffer;
+}
+
+void libvice_set_key(int row, int column, int pressed)
+{
+    keyboard_set_keyarr(row, column, pressed ? 1 : 0);
+}
+
+void libvice_set_joystick(unsigned int port, uint16_t value)
+{
+    joystick_set_value_absolute(port, value);
+}
+
+/* ------------------------------------------------------------------------- */
+
+uint8_t *libvice_snapshot_save(size_t *size)
+{
+    snapshot_t *s;
+    const uint8_t *state;
+    uint8_t *data;
+
+    s = machine_write_snapshot_mem(0, 0, 0);
+    if (s == NULL) {
+        return NULL;
+    }
+    state = snapshot_mem_get_data(s, size);
+    data = lib_malloc(*size);
+    memcpy(data, state, *size);
+    snapshot_close(s);
+    return data;
+}
+
+int libvice_snapshot_restore(const uint8_t *data, size_t size)
+{
+    return machine_read_snapshot_mem(data, size, 0);
+}
+
+void libvice_snapshot_free(uint8_t *data)
+{
+    lib_free(data);
+}
@@ -0,0 +1,86 @@
+/*
+ * libvice.h - Run the emulator as a library, stepped by its caller.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_LIBVICE_H
+#define VICE_LIBVICE_H
+
+/* This header is installed with libvice-x64sc.so and does not depend on
+   any other VICE header.  All functions must be called from the thread
+   that called libvice_init().  */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start the emulator for `machine' (as in "C64", the library only has the
+   one it was built for) with the command line options in argv[0] to
+   argv[argc - 1], e.g. "-default" and the resources as "-<name> <value>".
+   Sound is off unless the options turn it on.  Returns 0 on success.  */
+int libvice_init(const char *machine, int argc, char **argv);
+void libvice_shutdown(void);
+
+/* Set a resource, with the value converted from a string.  */
+int libvice_set_resource(const char *name, const char *value);
+
+/* Run at least `cycles' CPU cycles, up to the end of the instruction that
+   passes them.  Returns the number of cycles that were run.  */
+uint64_t libvice_step_cycles(uint64_t cycles);
+
+/* Run until the video chip finished the current frame.  Returns the
+   number of cycles that were run.  */
+uint64_t libvice_step_frame(void);
+
+uint64_t libvice_clock(void);
+
+/* Pointers into the emulated machine.  They stay valid while the library
+   is running; writes to the RAM are seen by the emulation at once.  */
+uint8_t *libvice_ram(size_t *size);
+uint8_t *libvice_color_ram(size_t *size);
+
+/* The last frame, one byte per pixel with the index into the palette of
+   the video chip.  The buffer may change with every step.  */
+const uint8_t *libvice_framebuffer(unsigned int *width, unsigned int *height,
+                                   unsigned int *pitch);
+
+/* Press (1) or release (0) the key at `row' and `column' of the keyboard
+   matrix.  */
+void libvice_set_key(int row, int column, int pressed);
+
+/* Set the state of the joystick in `port' (0 for control port 1): bits 0
+   to 4 are up, down, left, right and fire, 1 is pressed.  */
+void libvice_set_joystick(unsigned int port, uint16_t value);
+
+/* Save the machine state to memory.  The data is freed with
+   libvice_snapshot_free().  */
+uint8_t *libvice_snapshot_save(size_t *size);
+int libvice_snapshot_restore(const uint8_t *data, size_t size);
+void libvice_snapshot_free(uint8_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
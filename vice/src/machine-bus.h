@@ -37,6 +37,7 @@ void machine_bus_init_machine(void);
 
 int machine_bus_lib_directory(unsigned int unit, const char *pattern, uint8_t **buf);
 int machine_bus_lib_read_sector(unsigned int unit, unsigned int track, unsigned int sector, uint8_t *buf);
+int machine_bus_lib_read_sectors(unsigned int unit, unsigned int track, unsigned int sector, unsigned int count, uint8_t *buf);
 int machine_bus_lib_write_sector(unsigned int unit, unsigned int track, unsigned int sector, uint8_t *buf);
 
 unsigned int machine_bus_device_type_get(unsigned int unit);
@@ -26,6 +26,7 @@
 
 #include "vice.h"
 
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,12 +36,18 @@
 #include "archdep.h"
 #include "attach.h"
 #include "autostart.h"
+#include "batch.h"
 #include "cmdline.h"
 #include "console.h"
+#include "cpucoverage.h"
+#include "diskcontents.h"
 #include "diskimage.h"
 #include "drive.h"
 #include "vice-event.h"
+#include "exitreport.h"
+#include "framestats.h"
 #include "fliplist.h"
+#include "forkserver.h"
 #include "fsdevice.h"
 #include "gfxoutput.h"
 #include "initcmdline.h"
@@ -54,19 +61,25 @@
 #include "machine.h"
 #include "maincpu.h"
 #include "mem.h"
+#include "memusage.h"
 #include "monitor.h"
 #include "monitor_network.h"
 #include "monitor_binary.h"
+#include "monitor_shm.h"
 #include "network.h"
 #include "palette.h"
 #include "printer.h"
 #include "profiler.h"
 #include "resources.h"
+#include "rewind.h"
+#include "runahead.h"
 #include "romset.h"
 #include "screenshot.h"
+#include "snapshot.h"
 #include "sound.h"
 #include "sysfile.h"
 #include "tape.h"
+#include "tracezone.h"
 #include "traps.h"
 #include "types.h"
 #include "uiapi.h"
@@ -97,6 +110,8 @@ static int jam_action = MACHINE_JAM_ACTION_DIALOG;
 int machine_keymap_index;
 static char *ExitScreenshotName = NULL;
 static char *ExitScreenshotName1 = NULL;
+static char *ExitScreenshotHashName = NULL;
+static int snapshot_compress = 0;
 static bool is_first_reset = true;
 
 /* NOTE: this function is very similar to drive_jam - in case the behavior
@@ -142,7 +157,7 @@ unsigned int machine_jam(const char *format, ...)
             ret = ui_jam_dialog("%s", jam_reason);
         }
     } else if (jam_action == MACHINE_JAM_ACTION_QUIT) {
-        archdep_vice_exit(EXIT_SUCCESS);
+        batch_vice_exit(EXIT_SUCCESS);
     } else {
         int actions[4] = {
             -1, UI_JAM_MONITOR, UI_JAM_RESET_CPU, UI_JAM_POWER_CYCLE
@@ -249,6 +264,7 @@ void machine_reset(void)
     /* If this is the first machine reset, kick off any requested autostart */
     if (is_first_reset) {
         is_first_reset = false;
+        cpucoverage_start();
         initcmdline_check_attach();
     }
 }
@@ -275,6 +291,19 @@ int machine_init(void)
     return machine_specific_init();
 }
 
+/* Write a snapshot like `machine_write_snapshot()', but only take it in
+   memory here and leave compressing and writing it to the background.  */
+int machine_write_snapshot_async(const char *name, int save_roms, int save_disks)
+{
+    snapshot_t *s;
+
+    s = machine_write_snapshot_mem(save_roms, save_disks, 0);
+    if (s == NULL) {
+        return -1;
+    }
+    return snapshot_mem_save_async(s, name, snapshot_compress);
+}
+
 void machine_maincpu_shutdown(void)
 {
     if (maincpu_alarm_context != NULL) {
@@ -290,10 +319,60 @@ void machine_maincpu_shutdown(void)
     }
 }
 
+/* Compare the hash of the screen with the one in ExitScreenshotHashName,
+   or store it there if the file does not exist yet.  Return 1 if the hash
+   matches the reference.  */
+static int screenshot_hash_at_exit(struct video_canvas_s *canvas)
+{
+    uint64_t hash, reference;
+    FILE *f;
+
+    if (screenshot_hash(canvas, &hash) < 0) {
+        return 0;
+    }
+
+    f = fopen(ExitScreenshotHashName, MODE_READ_TEXT);
+    if (f != NULL) {
+        int valid = fscanf(f, "%" SCNx64, &reference) == 1;
+
+        fclose(f);
+        if (!valid) {
+            log_error(LOG_DEFAULT, "Invalid screen hash in `%s'.", ExitScreenshotHashName);
+            fprintf(stdout, "SCREENHASH: %016" PRIx64 " invalid reference\n", hash);
+            return 0;
+        }
+        if (hash == reference) {
+            fprintf(stdout, "SCREENHASH: %016" PRIx64 " matches reference\n", hash);
+            return 1;
+        }
+        fprintf(stdout, "SCREENHASH: %016" PRIx64 " differs from reference %016" PRIx64 "\n",
+                hash, reference);
+        return 0;
+    }
+
+    f = fopen(ExitScreenshotHashName, MODE_WRITE_TEXT);
+    if (f == NULL) {
+        log_error(LOG_DEFAULT, "Cannot write screen hash to `%s'.", ExitScreenshotHashName);
+        fprintf(stdout, "SCREENHASH: %016" PRIx64 "\n", hash);
+        return 0;
+    }
+    fprintf(f, "%016" PRIx64 "\n", hash);
+    fclose(f);
+    fprintf(stdout, "SCREENHASH: %016" PRIx64 " saved as reference\n", hash);
+    return 1;
+}
+
 static void screenshot_at_exit(void)
 {
     struct video_canvas_s *canvas;
 
+    if ((ExitScreenshotHashName != NULL) && (ExitScreenshotHashName[0] != 0)) {
+        /* the screenshot is only saved when the screen is not as expected */
+        if (screenshot_hash_at_exit(machine_video_canvas_get(0))) {
+            return;
+        }
+    }
+
     if ((ExitScreenshotName != NULL) && (ExitScreenshotName[0] != 0)) {
         /* FIXME: this always uses the first canvas, for x128 this is the VDC */
         canvas = machine_video_canvas_get(0);
@@ -339,12 +418,21 @@ void machine_shutdown(void)
     screenshot_at_exit();
     screenshot_shutdown();
 
+    exitreport_write();
+    framestats_report_write();
+    memusage_report_write();
+    tracezone_write();
+
     file_system_detach_disk_shutdown();
 
+    snapshot_shutdown();
+
     machine_specific_shutdown();
 
     autostart_shutdown();
 
+    diskcontents_shutdown();
+
     joystick_close();
 #ifdef MAC_JOYSTICK
     joy_hidlib_exit();
@@ -408,6 +496,14 @@ void machine_shutdown(void)
     machine_common_resources_shutdown();
 
     vsync_shutdown();
+    rewind_shutdown();
+    runahead_shutdown();
+    batch_shutdown();
+    exitreport_shutdown();
+    framestats_shutdown();
+    memusage_shutdown();
+    tracezone_shutdown();
+    forkserver_shutdown();
 
     joystick_resources_shutdown();
     sysfile_resources_shutdown();
@@ -420,6 +516,7 @@ void machine_shutdown(void)
     monitor_network_resources_shutdown();
     monitor_binary_resources_shutdown();
 #endif
+    monitor_shm_resources_shutdown();
     monitor_resources_shutdown();
 
     archdep_shutdown();
@@ -465,9 +562,25 @@ static int set_exit_screenshot_name1(const char *val, void *param)
     return 0;
 }
 
+static int set_exit_screenshot_hash_name(const char *val, void *param)
+{
+    util_string_set(&ExitScreenshotHashName, val);
+
+    return 0;
+}
+
+static int set_snapshot_compress(int val, void *param)
+{
+    snapshot_compress = val ? 1 : 0;
+
+    return 0;
+}
+
 static resource_string_t resources_string[] = {
     { "ExitScreenshotName", "", RES_EVENT_NO, NULL,
       &ExitScreenshotName, set_exit_screenshot_name, NULL },
+    { "ExitScreenshotHashName", "", RES_EVENT_NO, NULL,
+      &ExitScreenshotHashName, set_exit_screenshot_hash_name, NULL },
     RESOURCE_STRING_LIST_END
 };
 
@@ -480,6 +593,8 @@ static resource_string_t resources_string_c128[] = {
 static const resource_int_t resources_int[] = {
     { "JAMAction", MACHINE_JAM_ACTION_CONTINUE, RES_EVENT_SAME, NULL,
       &jam_action, set_jam_action, NULL },
+    { "SnapshotCompress", 0, RES_EVENT_NO, NULL,
+      &snapshot_compress, set_snapshot_compress, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -502,6 +617,7 @@ void machine_common_resources_shutdown(void)
 {
     lib_free(ExitScreenshotName);
     lib_free(ExitScreenshotName1);
+    lib_free(ExitScreenshotHashName);
 }
 
 static const cmdline_option_t cmdline_options_c128[] =
@@ -515,6 +631,15 @@ static const cmdline_option_t cmdline_options_c128[] =
     { "-exitscreenshotvicii", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "ExitScreenshotName1", NULL,
       "<Name>", "Set name of screenshot to save when emulator exits." },
+    { "-exitscreenshothash", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "ExitScreenshotHashName", NULL,
+      "<Name>", "Compare a hash of the screen with the one in this file when emulator exits, save the screenshot only if they differ." },
+    { "-snapshotcompress", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SnapshotCompress", (resource_value_t)1,
+      NULL, "Compress quick snapshots with gzip" },
+    { "+snapshotcompress", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SnapshotCompress", (resource_value_t)0,
+      NULL, "Do not compress quick snapshots" },
     CMDLINE_LIST_END
 };
 
@@ -526,6 +651,15 @@ static const cmdline_option_t cmdline_options[] =
     { "-exitscreenshot", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "ExitScreenshotName", NULL,
       "<Name>", "Set name of screenshot to save when emulator exits." },
+    { "-exitscreenshothash", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "ExitScreenshotHashName", NULL,
+      "<Name>", "Compare a hash of the screen with the one in this file when emulator exits, save the screenshot only if they differ." },
+    { "-snapshotcompress", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SnapshotCompress", (resource_value_t)1,
+      NULL, "Compress quick snapshots with gzip" },
+    { "+snapshotcompress", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SnapshotCompress", (resource_value_t)0,
+      NULL, "Do not compress quick snapshots" },
     CMDLINE_LIST_END
 };
 
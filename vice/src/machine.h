@@ -31,6 +31,8 @@
 #include "types.h"
 #include <stdbool.h>
 
+struct snapshot_s;
+
 /* The following stuff must be defined once per every emulated CBM machine.  */
 
 /* Name of the machine.  */
@@ -146,6 +148,16 @@ int machine_write_snapshot(const char *name, int save_roms, int save_disks, int
 /* Read a snapshot.  */
 int machine_read_snapshot(const char *name, int even_mode);
 
+/* Write a snapshot to a memory buffer, the returned snapshot must be closed
+   with `snapshot_close()' by the caller.  */
+struct snapshot_s *machine_write_snapshot_mem(int save_roms, int save_disks, int event_mode);
+
+/* Read a snapshot from a memory buffer.  */
+int machine_read_snapshot_mem(const uint8_t *data, size_t size, int event_mode);
+
+/* Write a snapshot, with the file written in the background.  */
+int machine_write_snapshot_async(const char *name, int save_roms, int save_disks);
+
 /* handle pending interrupts - needed by libsid.a.  */
 void machine_handle_pending_alarms(CLOCK num_write_cycles);
 
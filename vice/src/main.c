@@ -59,6 +59,7 @@
 #include "main.h"
 #include "mainlock.h"
 #include "resources.h"
+#include "starttrace.h"
 #include "sysfile.h"
 #include "types.h"
 #include "uiapi.h"
@@ -256,6 +257,8 @@ int main_program(int argc, char **argv)
     }
 
     tick_init();
+    starttrace_mark("start");
+
     maincpu_early_init();
     machine_setup_context();
     drive_setup_context();
@@ -263,10 +266,14 @@ int main_program(int argc, char **argv)
 
     /* Initialize system file locator.  */
     sysfile_init(machine_name);
+    starttrace_mark("early machine setup");
 
     /* generic init, first resources, then cmdline options that use them */
-    if ((init_resources() < 0) ||
-        (init_cmdline_options() < 0)) {
+    if (init_resources() < 0) {
+        return -1;
+    }
+    starttrace_mark("resources init");
+    if (init_cmdline_options() < 0) {
         return -1;
     }
 
@@ -282,6 +289,7 @@ int main_program(int argc, char **argv)
         archdep_startup_log_error("Cannot set defaults.\n");
         return -1;
     }
+    starttrace_mark("command line options init, defaults");
 
     /* Initialize the UI actions system, this needs to happen before the UI
      * init so the UI code can register handlers */
@@ -301,6 +309,7 @@ int main_program(int argc, char **argv)
     if (!console_mode) {
         ui_init_with_args(&argc, argv);
     }
+    starttrace_mark("UI actions, hotkeys, UI init with args");
 
     if ((!help_requested) && (loadconfig)) {
         /* Load the user's default configuration file.  */
@@ -314,6 +323,7 @@ int main_program(int argc, char **argv)
             }
         }
     }
+    starttrace_mark("load config file");
 
     if (log_init() < 0) {
         const char *logfile = NULL;
@@ -334,6 +344,7 @@ int main_program(int argc, char **argv)
     if (initcmdline_check_args(argc, argv) < 0) {
         return -1;
     }
+    starttrace_mark("log init, parse command line");
 
     /* Initialize the user interface, 2nd part. */
     DBG(("main:uidata_init(argc:%d)\n", argc));
@@ -341,6 +352,7 @@ int main_program(int argc, char **argv)
         archdep_startup_log_error("Cannot initialize the UI.\n");
         return -1;
     }
+    starttrace_mark("UI init");
 
     program_name = archdep_program_name();
 
@@ -410,6 +422,7 @@ int main_program(int argc, char **argv)
     if (/*!console_mode && */video_init() < 0) {
         return -1;
     }
+    starttrace_mark("video init");
 
     if (initcmdline_check_psid() < 0) {
         return -1;
@@ -428,6 +441,10 @@ int main_program(int argc, char **argv)
 
     pthread_mutex_unlock(&init_lock);
 
+#elif defined(USE_LIBVICE)
+
+    /* the embedding program runs the main loop through libvice.c */
+
 #else /* #ifdef USE_VICE_THREAD */
 
     main_loop_forever();
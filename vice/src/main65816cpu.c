@@ -34,6 +34,7 @@
 #include "alarm.h"
 #include "archdep.h"
 #include "autostart.h"
+#include "batch.h"
 #include "debug.h"
 #include "interrupt.h"
 #include "log.h"
@@ -42,6 +43,7 @@
 #include "mem.h"
 #include "monitor.h"
 #include "snapshot.h"
+#include "tracezone.h"
 #include "traps.h"
 #include "types.h"
 #include "wdc65816.h"
@@ -171,6 +173,8 @@ monitor_interface_t *maincpu_monitor_interface_get(void)
     maincpu_monitor_interface->mem_bank_peek = mem_bank_peek;
     maincpu_monitor_interface->mem_bank_write = mem_bank_write;
     maincpu_monitor_interface->mem_bank_poke = mem_bank_poke;
+    maincpu_monitor_interface->mem_bank_base = mem_bank_base;
+    maincpu_monitor_interface->mem_bank_write_base = mem_bank_write_base;
 
     maincpu_monitor_interface->mem_ioreg_list_get = mem_ioreg_list_get;
 
@@ -292,6 +296,8 @@ void maincpu_mainloop(void)
 
     machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
 
+    TRACEZONE_BEGIN(TRACEZONE_MAINCPU);
+
     while (1) {
 
 #define CLK maincpu_clk
@@ -354,7 +360,7 @@ void maincpu_mainloop(void)
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(EXIT_FAILURE);
+            batch_vice_exit(EXIT_FAILURE);
         }
 
         autostart_advance();
@@ -34,11 +34,14 @@
 #include "alarm.h"
 #include "archdep.h"
 #include "autostart.h"
+#include "batch.h"
+#include "c64mem.h"
 
 #ifdef FEATURE_CPUMEMHISTORY
 #include "c64pla.h"
 #endif
 
+#include "cpucoverage.h"
 #include "debug.h"
 #include "interrupt.h"
 #include "machine.h"
@@ -50,6 +53,7 @@
 #include "mos6510.h"
 #include "reu.h"
 #include "snapshot.h"
+#include "tracezone.h"
 #include "traps.h"
 #include "types.h"
 
@@ -90,9 +94,17 @@ static int reu_dma_triggered = 0;
 
 int check_ba_low = 0;
 
+/* Bring the chips the CPU runs ahead of up to date, before anything that
+   could see or change their state: alarms, stolen cycles, writes, reads
+   that are not plain RAM or ROM, and the end of an instruction.  */
+#ifndef CPU_CATCH_UP
+#define CPU_CATCH_UP() ((void)0)
+#endif
+
 inline static void interrupt_delay(void)
 {
     while (maincpu_clk >= alarm_context_next_pending_clk(maincpu_alarm_context)) {
+        CPU_CATCH_UP();
         alarm_context_dispatch(maincpu_alarm_context, maincpu_clk);
     }
 
@@ -110,6 +122,8 @@ static void maincpu_steal_cycles(void)
     interrupt_cpu_status_t *cs = maincpu_int_status;
     uint8_t opcode;
 
+    CPU_CATCH_UP();
+
     if (maincpu_ba_low_flags & MAINCPU_BA_LOW_VICII) {
         vicii_steal_cycles();
         maincpu_ba_low_flags &= ~MAINCPU_BA_LOW_VICII;
@@ -203,6 +217,37 @@ inline static void check_ba(void)
     }
 }
 
+/* Plain RAM and ROM pages are read directly, everything else through the
+   read functions.  The table is looked up after check_ba(), which may run
+   alarms that change the memory configuration.  */
+inline static uint8_t mem_read_check_ba(unsigned int addr)
+{
+    uint16_t a = (uint16_t)addr;
+    uint8_t *p;
+
+    check_ba();
+    p = _mem_read_fast_tab_ptr[a >> 8];
+    if (p != NULL && a > 1) {
+        return p[a];
+    }
+    CPU_CATCH_UP();
+    return (*_mem_read_tab_ptr[(addr) >> 8])(a);
+}
+
+inline static uint8_t mem_read_check_ba_dummy(unsigned int addr)
+{
+    uint16_t a = (uint16_t)addr;
+    uint8_t *p;
+
+    check_ba();
+    p = _mem_read_fast_tab_ptr_dummy[a >> 8];
+    if (p != NULL && a > 1) {
+        return p[a];
+    }
+    CPU_CATCH_UP();
+    return (*(_mem_read_tab_ptr_dummy[(addr) >> 8]))(a);
+}
+
 #ifdef FEATURE_CPUMEMHISTORY
 
 /* FIXME do proper ROM/RAM/IO tests */
@@ -254,29 +299,45 @@ inline static void memmap_mem_update(unsigned int addr, int write, int dummy)
     monitor_memmap_store(addr, type);
 }
 
-static void memmap_mem_store(unsigned int addr, unsigned int value)
+/* The accesses below fall back to the plain ones while the monitor does not
+   collect the memmap.  */
+inline static void memmap_mem_store(unsigned int addr, unsigned int value)
 {
-    memmap_mem_update(addr, 1, 0);
+    CPU_CATCH_UP();
+    if (monitor_cpuhistory_enabled) {
+        memmap_mem_update(addr, 1, 0);
+    }
     (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value));
 }
 
-static void memmap_mem_store_dummy(unsigned int addr, unsigned int value)
+inline static void memmap_mem_store_dummy(unsigned int addr, unsigned int value)
 {
-    memmap_mem_update(addr, 1, 1);
+    CPU_CATCH_UP();
+    if (monitor_cpuhistory_enabled) {
+        memmap_mem_update(addr, 1, 1);
+    }
     (*_mem_write_tab_ptr_dummy[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value));
 }
 
 /* read byte, check BA and mark as read */
-static uint8_t memmap_mem_read(unsigned int addr)
+inline static uint8_t memmap_mem_read(unsigned int addr)
 {
+    if (!monitor_cpuhistory_enabled) {
+        return mem_read_check_ba(addr);
+    }
     check_ba();
+    CPU_CATCH_UP();
     memmap_mem_update(addr, 0, 0);
     return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
 }
 
-static uint8_t memmap_mem_read_dummy(unsigned int addr)
+inline static uint8_t memmap_mem_read_dummy(unsigned int addr)
 {
+    if (!monitor_cpuhistory_enabled) {
+        return mem_read_check_ba_dummy(addr);
+    }
     check_ba();
+    CPU_CATCH_UP();
     memmap_mem_update(addr, 0, 1);
     return (*(_mem_read_tab_ptr_dummy[(addr) >> 8]))((uint16_t)(addr));
 }
@@ -352,20 +413,9 @@ static uint8_t memmap_mem_read_dummy(unsigned int addr)
 
 #endif /* FEATURE_CPUMEMHISTORY */
 
-inline static uint8_t mem_read_check_ba(unsigned int addr)
-{
-    check_ba();
-    return (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr));
-}
-
-inline static uint8_t mem_read_check_ba_dummy(unsigned int addr)
-{
-    check_ba();
-    return (*(_mem_read_tab_ptr_dummy[(addr) >> 8]))((uint16_t)(addr));
-}
-
 #ifndef STORE
 #define STORE(addr, value) \
+    CPU_CATCH_UP(); \
     if (reu_dma_triggered == 0) { \
         (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value)); \
         if (addr == 0xff00) { \
@@ -377,6 +427,7 @@ inline static uint8_t mem_read_check_ba_dummy(unsigned int addr)
 
 #ifndef STORE_DUMMY
 #define STORE_DUMMY(addr, value) \
+    CPU_CATCH_UP(); \
     (*_mem_write_tab_ptr_dummy[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value)); \
     if (addr == 0xff00) { \
         reu_dma_triggered = reu_dma(-1); \
@@ -409,12 +460,12 @@ inline static uint8_t mem_read_check_ba_dummy(unsigned int addr)
 
 #ifndef STORE_ZERO
 #define STORE_ZERO(addr, value) \
-    (*_mem_write_tab_ptr[0])((uint16_t)(addr), (uint8_t)(value))
+    (CPU_CATCH_UP(), (*_mem_write_tab_ptr[0])((uint16_t)(addr), (uint8_t)(value)))
 #endif
 
 #ifndef STORE_ZERO_DUMMY
 #define STORE_ZERO_DUMMY(addr, value) \
-    (*_mem_write_tab_ptr_dummy[0])((uint16_t)(addr), (uint8_t)(value))
+    (CPU_CATCH_UP(), (*_mem_write_tab_ptr_dummy[0])((uint16_t)(addr), (uint8_t)(value)))
 #endif
 
 #ifndef LOAD_ZERO
@@ -430,7 +481,7 @@ inline static uint8_t mem_read_check_ba_dummy(unsigned int addr)
 /* Route stack operations through read/write handlers */
 
 #ifndef PUSH
-#define PUSH(val) (*_mem_write_tab_ptr[0x01])((uint16_t)(0x100 + (reg_sp--)), (uint8_t)(val))
+#define PUSH(val) (CPU_CATCH_UP(), (*_mem_write_tab_ptr[0x01])((uint16_t)(0x100 + (reg_sp--)), (uint8_t)(val)))
 #endif
 
 #ifndef PULL
@@ -537,6 +588,8 @@ monitor_interface_t *maincpu_monitor_interface_get(void)
     maincpu_monitor_interface->mem_peek_with_config = mem_peek_with_config;
     maincpu_monitor_interface->mem_bank_write = mem_bank_write;
     maincpu_monitor_interface->mem_bank_poke = mem_bank_poke;
+    maincpu_monitor_interface->mem_bank_base = mem_bank_base;
+    maincpu_monitor_interface->mem_bank_write_base = mem_bank_write_base;
 
     maincpu_monitor_interface->mem_ioreg_list_get = mem_ioreg_list_get;
 
@@ -661,6 +714,10 @@ static uint8_t *bank_base = NULL;
 static int bank_start = 0;
 static int bank_limit = 0;
 
+/* Set when maincpu_mainloop() returned at the cycle limit, the next call
+   continues from the exported registers.  */
+static bool mainloop_resume = false;
+
 void maincpu_resync_limits(void)
 {
     if (bank_base_ready) {
@@ -692,7 +749,22 @@ void maincpu_mainloop(void)
      */
     bank_base_ready = true;
 
-    machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
+    if (mainloop_resume) {
+        mainloop_resume = false;
+        reg_a = maincpu_regs.a;
+        reg_x = maincpu_regs.x;
+        reg_y = maincpu_regs.y;
+        reg_sp = maincpu_regs.sp;
+        reg_p = maincpu_regs.p;
+        flag_n = maincpu_regs.n;
+        flag_z = maincpu_regs.z;
+        bank_start = bank_limit = 0;
+        JUMP(maincpu_regs.pc);
+    } else {
+        machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
+    }
+
+    TRACEZONE_BEGIN(TRACEZONE_MAINCPU);
 
     while (1) {
 #define CLK maincpu_clk
@@ -711,12 +783,13 @@ void maincpu_mainloop(void)
 
 #define TRAP(addr) maincpu_int_status->trap_func(addr);
 
-#define ROM_TRAP_HANDLER() traps_handler()
+#define ROM_TRAP_HANDLER() (CPU_CATCH_UP(), traps_handler())
 
 #define JAM()                                                         \
     do {                                                              \
         unsigned int tmp;                                             \
                                                                       \
+        CPU_CATCH_UP();                                               \
         EXPORT_REGISTERS();                                           \
         tmp = machine_jam("   " CPU_STR ": JAM at $%04X   ", reg_pc); \
         switch (tmp) {                                                \
@@ -744,11 +817,20 @@ void maincpu_mainloop(void)
 
 #include "6510dtvcore.c"
 
+        CPU_CATCH_UP();
+
         maincpu_int_status->num_dma_per_opcode = 0;
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
+            if (maincpu_clk_limit_return) {
+                maincpu_clk_limit = 0;
+                EXPORT_REGISTERS();
+                mainloop_resume = true;
+                TRACEZONE_END(TRACEZONE_MAINCPU);
+                return;
+            }
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(EXIT_FAILURE);
+            batch_vice_exit(EXIT_FAILURE);
         }
 
         autostart_advance();
@@ -34,6 +34,8 @@
 #include "alarm.h"
 #include "archdep.h"
 #include "autostart.h"
+#include "batch.h"
+#include "cpucoverage.h"
 #include "debug.h"
 #include "interrupt.h"
 #include "log.h"
@@ -48,7 +50,9 @@
 #include "mos6510.h"
 #endif
 #include "h6809regs.h"
+#include "profiler.h"
 #include "snapshot.h"
+#include "tracezone.h"
 #include "traps.h"
 #include "types.h"
 
@@ -93,45 +97,55 @@
  * src/cbm2/cbm2cpu.c, src/c64/vsidcpu.c, src/c64/c64cpu.c, src/pet/petcpu.c,
  * src/c64dtv/c64dtvcpu.c */
 
-/* map access functions to memmap hooks */
+/* map access functions to memmap hooks, in the copy of the core with hooks
+   and only while the monitor collects the memmap, see CPU_HISTORY_ACTIVE()
+   in 6510core.c.  */
 #ifndef STORE
-#define STORE(addr, value) \
-    memmap_mem_store(addr, value)
+#define STORE(addr, value)                                                          \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_store(addr, value)                           \
+                          : (*_mem_write_tab_ptr[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value)))
 #endif
 
 #ifndef LOAD
-#define LOAD(addr) \
-    memmap_mem_read(addr)
+#define LOAD(addr)                                       \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_read(addr)        \
+                          : (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr)))
 #endif
 
 #ifndef STORE_ZERO
-#define STORE_ZERO(addr, value) \
-    memmap_mem_store((addr) & 0xff, value)
+#define STORE_ZERO(addr, value)                                                  \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_store((addr) & 0xff, value)               \
+                          : (*_mem_write_tab_ptr[0])((uint16_t)(addr), (uint8_t)(value)))
 #endif
 
 #ifndef LOAD_ZERO
-#define LOAD_ZERO(addr) \
-    memmap_mem_read((addr) & 0xff)
+#define LOAD_ZERO(addr)                                        \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_read((addr) & 0xff)     \
+                          : (*_mem_read_tab_ptr[0])((uint16_t)(addr)))
 #endif
 
 #ifndef STORE_DUMMY
-#define STORE_DUMMY(addr, value) \
-    memmap_mem_store_dummy(addr, value)
+#define STORE_DUMMY(addr, value)                                                          \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_store_dummy(addr, value)                           \
+                          : (*_mem_write_tab_ptr_dummy[(addr) >> 8])((uint16_t)(addr), (uint8_t)(value)))
 #endif
 
 #ifndef LOAD_DUMMY
-#define LOAD_DUMMY(addr) \
-    memmap_mem_read_dummy(addr)
+#define LOAD_DUMMY(addr)                                             \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_read_dummy(addr)              \
+                          : (*_mem_read_tab_ptr_dummy[(addr) >> 8])((uint16_t)(addr)))
 #endif
 
 #ifndef STORE_ZERO_DUMMY
-#define STORE_ZERO_DUMMY(addr, value) \
-    memmap_mem_store_dummy((addr) & 0xff, value)
+#define STORE_ZERO_DUMMY(addr, value)                                                  \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_store_dummy((addr) & 0xff, value)               \
+                          : (*_mem_write_tab_ptr_dummy[0])((uint16_t)(addr), (uint8_t)(value)))
 #endif
 
 #ifndef LOAD_ZERO_DUMMY
-#define LOAD_ZERO_DUMMY(addr) \
-    memmap_mem_read_dummy((addr) & 0xff)
+#define LOAD_ZERO_DUMMY(addr)                                        \
+    (CPU_HISTORY_ACTIVE() ? memmap_mem_read_dummy((addr) & 0xff)     \
+                          : (*_mem_read_tab_ptr_dummy[0])((uint16_t)(addr)))
 #endif
 
 #endif /* C64DTV */
@@ -241,6 +255,8 @@ monitor_interface_t *maincpu_monitor_interface = NULL;
 CLOCK maincpu_clk = 0L;
 /* if != 0, exit when this many cycles have been executed */
 CLOCK maincpu_clk_limit = 0L;
+/* if != 0, return from maincpu_mainloop() at the cycle limit instead */
+int maincpu_clk_limit_return = 0;
 
 /* This is flag is set to 1 each time a Read-Modify-Write instructions that
    accesses memory is executed.  We can emulate the RMW behaviour of the 6510
@@ -352,6 +368,7 @@ void maincpu_early_init(void)
 void maincpu_init(void)
 {
     interrupt_cpu_status_init(maincpu_int_status, &last_opcode_info);
+    maincpu_alarm_context->event_clk = &maincpu_int_status->next_event_clk;
 
     /* cpu specifix additional init routine */
     CPU_ADDITIONAL_INIT();
@@ -456,6 +473,10 @@ static uint8_t *bank_base = NULL;
 static int bank_start = 0;
 static int bank_limit = 0;
 
+/* Set when maincpu_mainloop() returned at the cycle limit, the next call
+   continues from the exported registers.  */
+static bool mainloop_resume = false;
+
 void maincpu_resync_limits(void)
 {
     if (bank_base_ready) {
@@ -463,6 +484,20 @@ void maincpu_resync_limits(void)
     }
 }
 
+#ifdef FEATURE_CPUMEMHISTORY
+#define MAINCPU_HISTORY_ACTIVE() monitor_cpuhistory_enabled
+#else
+#define MAINCPU_HISTORY_ACTIVE() 0
+#endif
+
+#ifdef DEBUG
+#define MAINCPU_HOOKS_ACTIVE() \
+    (monitor_mask[e_comp_space] || maincpu_profiling || debug.maincpu_traceflg || MAINCPU_HISTORY_ACTIVE())
+#else
+#define MAINCPU_HOOKS_ACTIVE() \
+    (monitor_mask[e_comp_space] || maincpu_profiling || MAINCPU_HISTORY_ACTIVE())
+#endif
+
 void maincpu_mainloop(void)
 {
 #define ORIGIN_MEMSPACE (e_comp_space)
@@ -511,6 +546,9 @@ void maincpu_mainloop(void)
 #ifndef NEED_REG_PC
     unsigned int reg_pc;
 #endif
+    /* shared by both copies of the core */
+    static int cpu_is_jammed = 0;
+#define CPU_IS_JAMMED_DECLARED
 
     /*
      * Enable maincpu_resync_limits functionality .. in the old code
@@ -519,7 +557,45 @@ void maincpu_mainloop(void)
      */
     bank_base_ready = true;
 
-    machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
+    if (mainloop_resume) {
+        mainloop_resume = false;
+#ifndef C64DTV
+        reg_a = maincpu_regs.a;
+        reg_x = maincpu_regs.x;
+        reg_y = maincpu_regs.y;
+#else
+        dtv_registers[0] = maincpu_regs.a;
+        dtv_registers[2] = maincpu_regs.x;
+        dtv_registers[1] = maincpu_regs.y;
+        dtv_registers[3] = maincpu_regs.r3;
+        dtv_registers[4] = maincpu_regs.r4;
+        dtv_registers[5] = maincpu_regs.r5;
+        dtv_registers[6] = maincpu_regs.r6;
+        dtv_registers[7] = maincpu_regs.r7;
+        dtv_registers[8] = maincpu_regs.r8;
+        dtv_registers[9] = maincpu_regs.r9;
+        dtv_registers[10] = maincpu_regs.r10;
+        dtv_registers[11] = maincpu_regs.r11;
+        dtv_registers[12] = maincpu_regs.r12;
+        dtv_registers[13] = maincpu_regs.r13;
+        dtv_registers[14] = maincpu_regs.r14;
+        dtv_registers[15] = maincpu_regs.r15;
+        reg_a_write_idx = maincpu_regs.acm >> 4;
+        reg_a_read_idx = maincpu_regs.acm & 0xf;
+        reg_y_idx = maincpu_regs.yxm >> 4;
+        reg_x_idx = maincpu_regs.yxm & 0xf;
+#endif
+        reg_sp = maincpu_regs.sp;
+        reg_p = maincpu_regs.p;
+        flag_n = maincpu_regs.n;
+        flag_z = maincpu_regs.z;
+        bank_start = bank_limit = 0;
+        JUMP(maincpu_regs.pc);
+    } else {
+        machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
+    }
+
+    TRACEZONE_BEGIN(TRACEZONE_MAINCPU);
 
     while (1) {
 #define CLK maincpu_clk
@@ -532,6 +608,8 @@ void maincpu_mainloop(void)
 
 #define ALARM_CONTEXT maincpu_alarm_context
 
+#define CPU_EVENT_CLK
+
 #define CHECK_PENDING_ALARM() (clk >= next_alarm_clk(maincpu_int_status))
 
 #define CHECK_PENDING_INTERRUPT() check_pending_interrupt(maincpu_int_status)
@@ -569,13 +647,36 @@ void maincpu_mainloop(void)
 
 #define GLOBAL_REGS maincpu_regs
 
+        /* Run the copy of the core without monitor, profiler and trace
+           hooks unless one of them is in use.  */
+        if (MAINCPU_HOOKS_ACTIVE()) {
+#define CPU_SWITCH_DISPATCH
 #include "6510core.c"
+#undef CPU_SWITCH_DISPATCH
+        } else {
+#undef CPU_HOOKS
+#define CPU_HOOKS 0
+#undef TRAP_SKIPPED_LABEL
+#define TRAP_SKIPPED_LABEL trap_skipped_nohooks
+#include "6510core.c"
+#undef CPU_HOOKS
+#define CPU_HOOKS 1
+#undef TRAP_SKIPPED_LABEL
+#define TRAP_SKIPPED_LABEL trap_skipped
+        }
 
         maincpu_int_status->num_dma_per_opcode = 0;
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
+            if (maincpu_clk_limit_return) {
+                maincpu_clk_limit = 0;
+                EXPORT_REGISTERS();
+                mainloop_resume = true;
+                TRACEZONE_END(TRACEZONE_MAINCPU);
+                return;
+            }
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(1);
+            batch_vice_exit(1);
         }
 
         autostart_advance();
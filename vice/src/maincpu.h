@@ -59,6 +59,12 @@ extern int maincpu_rmw_flag;
 extern CLOCK maincpu_clk;
 extern CLOCK maincpu_clk_limit;
 
+/* If nonzero, maincpu_mainloop() returns once maincpu_clk_limit is passed,
+   with the registers exported, and the next call continues from there
+   rather than resetting the machine.  Only the 6510 main loops of x64sc
+   (mainc64cpu.c) and of maincpu.c support this.  */
+extern int maincpu_clk_limit_return;
+
 /* 8502 cycle stretch indicator */
 extern int maincpu_stretch;
 
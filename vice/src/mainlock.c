@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 #include <pthread.h>
 
@@ -46,6 +47,7 @@
 #include "log.h"
 #include "machine.h"
 #include "mainlock.h"
+#include "tracezone.h"
 #include "vsyncapi.h"
 
 /* This is lock coordinates access to VICE data structures */
@@ -63,6 +65,30 @@ static pthread_t        vice_thread;
 static bool             vice_thread_keepalive  = true;
 static bool             vice_thread_is_running = false;
 
+/* Contention statistics, protected by stats_lock */
+static pthread_mutex_t  stats_lock       = PTHREAD_MUTEX_INITIALIZER;
+static mainlock_stats_t stats;
+static const uint64_t   histogram_limits[MAINLOCK_HISTOGRAM_BUCKETS - 1] = MAINLOCK_HISTOGRAM_LIMITS;
+
+/* When the UI thread got the mainlock, only used by the UI thread */
+static tick_t           ui_obtained_tick;
+
+static void stats_add(unsigned long *histogram, uint64_t *total, uint64_t *max, uint64_t us)
+{
+    int i;
+
+    for (i = 0; i < MAINLOCK_HISTOGRAM_BUCKETS - 1; i++) {
+        if (us < histogram_limits[i]) {
+            break;
+        }
+    }
+    histogram[i]++;
+    *total += us;
+    if (us > *max) {
+        *max = us;
+    }
+}
+
 void mainlock_init(void)
 {
 }
@@ -75,6 +101,8 @@ void mainlock_set_vice_thread(void)
     vice_thread_is_running = true;
     pthread_mutex_unlock(&internal_lock);
 
+    TRACEZONE_THREAD_NAME("vice");
+
     /* The vice thread owns this lock except when explicitly releasing it */
     pthread_mutex_lock(&main_lock);
 }
@@ -145,6 +173,23 @@ void mainlock_initiate_shutdown(void)
 }
 
 
+/** \brief Reset the lock state in a process forked by the vice thread
+ *
+ * Only the vice thread exists in the child, so nothing can be waiting for
+ * the mainlock, and the internal lock may have been held by the UI thread
+ * at the time of the fork.
+ */
+void mainlock_fork_child(void)
+{
+    pthread_mutex_init(&internal_lock, NULL);
+    pthread_mutex_init(&stats_lock, NULL);
+    pthread_cond_init(&ui_waiting_cond, NULL);
+    pthread_cond_init(&ui_has_lock_cond, NULL);
+    ui_is_waiting = false;
+    main_lock_obtain_depth = 0;
+}
+
+
 /** \brief Yield the mainlock and attempt to regain it immediately
  */
 void mainlock_yield(void)
@@ -158,8 +203,12 @@ void mainlock_yield(void)
  */
 void mainlock_yield_begin(void)
 {
+    bool handoff;
+
     mainlock_assert_is_vice_thread();
 
+    TRACEZONE_BEGIN(TRACEZONE_YIELD);
+
     pthread_mutex_unlock(&main_lock);
 
     /*
@@ -169,6 +218,7 @@ void mainlock_yield_begin(void)
      */
 
     pthread_mutex_lock(&internal_lock);
+    handoff = ui_is_waiting;
     if (ui_is_waiting) {
         /* Wake up the UI thread */
         pthread_cond_signal(&ui_waiting_cond);
@@ -176,6 +226,13 @@ void mainlock_yield_begin(void)
         pthread_cond_wait(&ui_has_lock_cond, &internal_lock);
     }
     pthread_mutex_unlock(&internal_lock);
+
+    pthread_mutex_lock(&stats_lock);
+    stats.yields++;
+    if (handoff) {
+        stats.handoffs++;
+    }
+    pthread_mutex_unlock(&stats_lock);
 }
 
 
@@ -185,6 +242,8 @@ void mainlock_yield_end(void)
 {
     pthread_mutex_lock(&main_lock);
 
+    TRACEZONE_END(TRACEZONE_YIELD);
+
     /* After the UI *might* have had the lock, check if we should exit. */
     consider_exit();
 }
@@ -194,7 +253,20 @@ void mainlock_yield_end(void)
 void mainlock_yield_and_sleep(tick_t ticks)
 {
     mainlock_yield_begin();
+    TRACEZONE_BEGIN(TRACEZONE_SLEEP);
     tick_sleep(ticks);
+    TRACEZONE_END(TRACEZONE_SLEEP);
+    mainlock_yield_end();
+}
+
+/** \brief Release the mainlock and sleep until a tick, see tick_sleep_until()
+ */
+void mainlock_yield_and_sleep_until(tick_t deadline)
+{
+    mainlock_yield_begin();
+    TRACEZONE_BEGIN(TRACEZONE_SLEEP);
+    tick_sleep_until(deadline);
+    TRACEZONE_END(TRACEZONE_SLEEP);
     mainlock_yield_end();
 }
 
@@ -202,6 +274,8 @@ void mainlock_yield_and_sleep(tick_t ticks)
 
 void mainlock_obtain(void)
 {
+    tick_t wait_start;
+
 #ifdef DEBUG
     if (pthread_equal(pthread_self(), vice_thread)) {
         /*
@@ -229,6 +303,10 @@ void mainlock_obtain(void)
         return;
     }
 
+    TRACEZONE_BEGIN(TRACEZONE_MAINLOCK_WAIT);
+
+    wait_start = tick_now();
+
     pthread_mutex_lock(&internal_lock);
 
     if (vice_thread_is_running) {
@@ -243,6 +321,16 @@ void mainlock_obtain(void)
     /* Get the main lock */
     pthread_mutex_lock(&main_lock);
 
+    TRACEZONE_END(TRACEZONE_MAINLOCK_WAIT);
+    TRACEZONE_BEGIN(TRACEZONE_UI);
+
+    ui_obtained_tick = tick_now();
+    pthread_mutex_lock(&stats_lock);
+    stats.obtains++;
+    stats_add(stats.wait_histogram, &stats.wait_us_total, &stats.wait_us_max,
+              TICK_TO_MICRO(ui_obtained_tick - wait_start));
+    pthread_mutex_unlock(&stats_lock);
+
     /* Let the VICE thread know we have the mainlock now */
     pthread_cond_signal(&ui_has_lock_cond);
 }
@@ -266,7 +354,36 @@ void mainlock_release(void)
 
     pthread_mutex_unlock(&main_lock);
 
-    main_lock_obtain_depth--;
+    if (--main_lock_obtain_depth == 0) {
+        TRACEZONE_END(TRACEZONE_UI);
+
+        pthread_mutex_lock(&stats_lock);
+        stats_add(stats.hold_histogram, &stats.hold_us_total, &stats.hold_us_max,
+                  TICK_TO_MICRO(tick_now() - ui_obtained_tick));
+        pthread_mutex_unlock(&stats_lock);
+    }
+}
+
+
+/** \brief Copy the contention statistics
+ *
+ * \param[out]  stats_return    statistics since startup or the last reset
+ */
+void mainlock_get_stats(mainlock_stats_t *stats_return)
+{
+    pthread_mutex_lock(&stats_lock);
+    *stats_return = stats;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+
+/** \brief Clear the contention statistics
+ */
+void mainlock_reset_stats(void)
+{
+    pthread_mutex_lock(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&stats_lock);
 }
 
 #endif /* #ifdef USE_VICE_THREAD */
@@ -38,12 +38,33 @@
 #include <stdbool.h>
 #include <assert.h>
 
+#include "types.h"
+
+/* Upper ends of the histogram buckets in microseconds, the last bucket
+   takes everything longer.  */
+#define MAINLOCK_HISTOGRAM_BUCKETS 8
+#define MAINLOCK_HISTOGRAM_LIMITS { 100, 500, 1000, 2000, 5000, 10000, 20000 }
+
+typedef struct mainlock_stats_s {
+    unsigned long obtains;      /* outermost mainlock_obtain() calls */
+    uint64_t wait_us_total;     /* UI thread waiting for the mainlock */
+    uint64_t wait_us_max;
+    uint64_t hold_us_total;     /* UI thread holding it, the emulation stops */
+    uint64_t hold_us_max;
+    unsigned long wait_histogram[MAINLOCK_HISTOGRAM_BUCKETS];
+    unsigned long hold_histogram[MAINLOCK_HISTOGRAM_BUCKETS];
+    unsigned long yields;       /* mainlock_yield_begin() calls */
+    unsigned long handoffs;     /* ... that found the UI thread waiting */
+} mainlock_stats_t;
+
 void mainlock_init(void);
 void mainlock_set_vice_thread(void);
 void mainlock_initiate_shutdown(void);
+void mainlock_fork_child(void);
 
 void mainlock_yield(void);
 void mainlock_yield_and_sleep(tick_t ticks);
+void mainlock_yield_and_sleep_until(tick_t deadline);
 void mainlock_yield_begin(void);
 void mainlock_yield_end(void);
 
@@ -52,15 +73,20 @@ void mainlock_release(void);
 
 bool mainlock_is_vice_thread(void);
 
+void mainlock_get_stats(mainlock_stats_t *stats);
+void mainlock_reset_stats(void);
+
 #define mainlock_assert_is_not_vice_thread() assert(!mainlock_is_vice_thread())
 #define mainlock_assert_is_vice_thread() assert(mainlock_is_vice_thread())
 
 #else
 
+#define mainlock_fork_child()
 #define mainlock_yield()
 #define mainlock_yield_begin()
 #define mainlock_yield_end()
 #define mainlock_yield_and_sleep(ticks) tick_sleep(ticks)
+#define mainlock_yield_and_sleep_until(deadline) tick_sleep_until(deadline)
 
 #define mainlock_obtain()
 #define mainlock_release()
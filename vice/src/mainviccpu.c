@@ -34,6 +34,7 @@
 #include "alarm.h"
 #include "archdep.h"
 #include "autostart.h"
+#include "batch.h"
 #include "debug.h"
 #include "interrupt.h"
 #include "machine.h"
@@ -42,6 +43,7 @@
 #include "monitor.h"
 #include "mos6510.h"
 #include "snapshot.h"
+#include "tracezone.h"
 #include "traps.h"
 #include "types.h"
 
@@ -85,6 +87,10 @@ inline static void memmap_mem_update(unsigned int addr, int write, int dummy)
     unsigned int type = MEMMAP_RAM_R;
     unsigned int a_m = addr >> 8;
 
+    if (!monitor_cpuhistory_enabled) {
+        return;
+    }
+
     if (((a_m >= 0x90) && (a_m <= 0x93)) ||
         ((a_m >= 0x98) && (a_m <= 0x9f))) {
         /* FIXME: IO2 or IO3 could be RAM */
@@ -521,6 +527,8 @@ void maincpu_mainloop(void)
 
     machine_trigger_reset(MACHINE_RESET_MODE_RESET_CPU);
 
+    TRACEZONE_BEGIN(TRACEZONE_MAINCPU);
+
     while (1) {
 #define CLK maincpu_clk
 #define RMW_FLAG maincpu_rmw_flag
@@ -575,7 +583,7 @@ void maincpu_mainloop(void)
 
         if (maincpu_clk_limit && (maincpu_clk > maincpu_clk_limit)) {
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(EXIT_FAILURE);
+            batch_vice_exit(EXIT_FAILURE);
         }
 
         autostart_advance();
@@ -83,6 +83,12 @@ extern store_func_t mem_store;
 extern read_func_t mem_dma_read;
 extern store_func_t mem_dma_store;
 
+/* The RAM that mem_dma_read() and mem_dma_store() access in the page of
+   `addr', for DMA engines that copy whole blocks, or NULL if the page may
+   be anything else (I/O, ROM, watchpoints, video bank hooks...).  Only
+   valid until the next memory configuration change.  */
+uint8_t *mem_dma_ram_page(uint16_t addr);
+
 /* ------------------------------------------------------------------------- */
 
 /* Memory access functions for the monitor.  */
@@ -102,6 +108,12 @@ uint8_t mem_bank_peek(int bank, uint16_t addr, void *context);
 void mem_bank_write(int bank, uint16_t addr, uint8_t byte, void *context);
 void mem_bank_poke(int bank, uint16_t addr, uint8_t byte, void *context);
 
+/* Direct pointers to plain memory of a bank for bulk monitor reads and
+   writes, with the number of bytes that follow in *len; only provided by
+   x64sc and xscpu64.  */
+uint8_t *mem_bank_base(int bank, uint16_t addr, unsigned int *len, void *context);
+uint8_t *mem_bank_write_base(int bank, uint16_t addr, unsigned int *len, void *context);
+
 uint8_t mem_peek_with_config(int config, uint16_t addr, void *context);
 int mem_get_current_bank_config(void);
 
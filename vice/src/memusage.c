@@ -0,0 +1,204 @@
+/*
+ * memusage.c - Memory used by the emulator, by subsystem.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The subsystems holding the larger buffers (draw buffers, the render
+   queue, sound, the FIR tables of reSID, the drives, the CPU history of the
+   monitor, the event keyframes) register a function returning how many
+   bytes they currently hold, so the monitor command `memreport' and
+   -memreport can show where the memory of an instance goes.  The machine
+   state itself (RAM, ROMs, chip registers) is measured as the size of an
+   in-memory snapshot with ROMs, which is close to what the memory tables of
+   the machine take without breaking them out by machine.
+
+   `LowMemory' is meant for running many instances side by side: the copy
+   of the draw buffer for finding the changed lines and the CPU history of
+   the monitor are not allocated then.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "memusage.h"
+#include "monitor.h"
+#include "resources.h"
+#include "snapshot.h"
+#include "util.h"
+
+#define MEMUSAGE_MAX_ENTRIES    16
+
+typedef struct memusage_entry_s {
+    const char *name;
+    memusage_func_t func;
+} memusage_entry_t;
+
+static memusage_entry_t entries[MEMUSAGE_MAX_ENTRIES];
+static int num_entries = 0;
+
+static int low_memory = 0;
+static char *report_filename = NULL;
+
+void memusage_register(const char *name, memusage_func_t func)
+{
+    int i;
+
+    for (i = 0; i < num_entries; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return;
+        }
+    }
+    if (num_entries == MEMUSAGE_MAX_ENTRIES) {
+        log_warning(LOG_DEFAULT, "Too many subsystems for the memory report, `%s' is not counted.", name);
+        return;
+    }
+    entries[num_entries].name = name;
+    entries[num_entries].func = func;
+    num_entries++;
+}
+
+int memusage_low_memory(void)
+{
+    return low_memory;
+}
+
+static size_t machine_state_size(void)
+{
+    snapshot_t *s;
+    size_t size = 0;
+
+    s = machine_write_snapshot_mem(1, 0, 0);
+    if (s != NULL) {
+        snapshot_mem_get_data(s, &size);
+        snapshot_close(s);
+    }
+    return size;
+}
+
+void memusage_monitor_show(void)
+{
+    size_t size, total;
+    int i;
+
+    total = size = machine_state_size();
+    mon_out("  %-20s %10lu bytes\n", "machine state", (unsigned long)size);
+    for (i = 0; i < num_entries; i++) {
+        size = entries[i].func();
+        total += size;
+        mon_out("  %-20s %10lu bytes\n", entries[i].name, (unsigned long)size);
+    }
+    mon_out("  %-20s %10lu bytes%s\n", "total", (unsigned long)total,
+            low_memory ? " (low memory profile)" : "");
+}
+
+void memusage_report_write(void)
+{
+    FILE *fp;
+    size_t size, total;
+    int i;
+
+    if (report_filename == NULL) {
+        return;
+    }
+
+    if (strcmp(report_filename, "-") == 0) {
+        fp = stdout;
+    } else {
+        fp = fopen(report_filename, MODE_WRITE_TEXT);
+        if (fp == NULL) {
+            log_error(LOG_DEFAULT, "Cannot write memory report `%s'.", report_filename);
+            return;
+        }
+    }
+
+    total = size = machine_state_size();
+    fprintf(fp, "{\n  \"machine\": \"%s\",\n  \"low_memory\": %s,\n  \"bytes\": {\n",
+            machine_name, low_memory ? "true" : "false");
+    fprintf(fp, "    \"machine state\": %lu", (unsigned long)size);
+    for (i = 0; i < num_entries; i++) {
+        size = entries[i].func();
+        total += size;
+        fprintf(fp, ",\n    \"%s\": %lu", entries[i].name, (unsigned long)size);
+    }
+    fprintf(fp, "\n  },\n  \"total\": %lu\n}\n", (unsigned long)total);
+
+    if (fp == stdout) {
+        fflush(stdout);
+    } else {
+        fclose(fp);
+    }
+}
+
+void memusage_shutdown(void)
+{
+    lib_free(report_filename);
+    report_filename = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_low_memory(int val, void *param)
+{
+    low_memory = val ? 1 : 0;
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "LowMemory", 0, RES_EVENT_NO, NULL,
+      &low_memory, set_low_memory, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int memusage_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static int cmdline_memreport(const char *param, void *extra_param)
+{
+    util_string_set(&report_filename, param);
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-memreport", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_memreport, NULL, NULL, NULL,
+      "<filename>", "Write the memory used by each subsystem as JSON to <filename> (`-' for stdout) at exit" },
+    { "-lowmemory", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "LowMemory", (void *)1,
+      NULL, "Do not allocate the optional caches and history buffers" },
+    { "+lowmemory", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "LowMemory", (void *)0,
+      NULL, "Allocate the optional caches and history buffers" },
+    CMDLINE_LIST_END
+};
+
+int memusage_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
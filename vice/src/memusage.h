@@ -0,0 +1,51 @@
+/*
+ * memusage.h - Memory used by the emulator, by subsystem.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MEMUSAGE_H
+#define VICE_MEMUSAGE_H
+
+#include <stddef.h>
+
+/* Returns the number of bytes the subsystem currently holds.  */
+typedef size_t (*memusage_func_t)(void);
+
+/* Add a subsystem to the report.  Registering the same name again is
+   ignored, so this can be called from code that runs more than once.  */
+void memusage_register(const char *name, memusage_func_t func);
+
+/* Nonzero if `LowMemory' is set: optional caches and history buffers are
+   not allocated.  */
+int memusage_low_memory(void);
+
+/* The `memreport' monitor command.  */
+void memusage_monitor_show(void);
+
+/* Write the report, if one was requested with -memreport.  Called by
+   machine_shutdown().  */
+void memusage_report_write(void);
+
+int memusage_resources_init(void);
+int memusage_cmdline_options_init(void);
+void memusage_shutdown(void);
+
+#endif
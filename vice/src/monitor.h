@@ -144,6 +144,20 @@ struct monitor_interface_s {
     void (*mem_bank_write)(int bank, uint16_t addr, uint8_t byte, void *context);
     void (*mem_bank_poke)(int bank, uint16_t addr, uint8_t byte, void *context);
 
+    /* Optional.  Returns a pointer to `addr' in `bank' if it is plain memory
+     * that can be read without side effects, with the number of bytes that
+     * follow in the same memory in `*len', or NULL if the bytes must be
+     * peeked one by one.
+     */
+    uint8_t *(*mem_bank_base)(int bank, uint16_t addr, unsigned int *len, void *context);
+
+    /* Optional.  Returns a pointer to `addr' in `bank' if poking the bytes
+     * there only changes that memory, or NULL if they must be poked one by
+     * one.  `*len' holds the number of bytes to poke and is lowered to the
+     * number of bytes that may be written through the pointer.
+     */
+    uint8_t *(*mem_bank_write_base)(int bank, uint16_t addr, unsigned int *len, void *context);
+
     struct mem_ioreg_list_s *(*mem_ioreg_list_get)(void *context);
 
     /* Pointer to a function to disable/enable watchpoint checking.  */
@@ -244,10 +258,12 @@ typedef struct monitor_cartridge_commands_s monitor_cartridge_commands_t;
 extern monitor_cartridge_commands_t mon_cart_cmd;
 
 /* CPU history/memmap prototypes */
+extern int monitor_cpuhistory_enabled;  /* non-zero while collected */
 void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op, unsigned int p1, unsigned int p2,
                               uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
                               uint8_t reg_sp, unsigned int reg_st, MEMSPACE origin);
 void monitor_cpuhistory_fix_p2(unsigned int p2);
+int monitor_cpuhistory_trace_active(void);
 void monitor_memmap_store(unsigned int addr, unsigned int type);
 
 /* memmap defines */
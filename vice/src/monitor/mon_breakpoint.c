@@ -60,6 +60,18 @@ static checkpoint_list_t *breakpoints[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_load[NUM_MEMSPACES];
 static checkpoint_list_t *watchpoints_store[NUM_MEMSPACES];
 
+/* Addresses covered by the checkpoints of one of the lists above, so that
+   the CPU can tell in constant time that nothing is armed at an address.
+   Pages without checkpoints have no bitmap.  Rebuilt whenever a list
+   changes; disabled checkpoints are included.  */
+typedef struct checkpoint_map_s {
+    uint8_t *page[0x100];
+} checkpoint_map_t;
+
+static checkpoint_map_t breakpoints_map[NUM_MEMSPACES];
+static checkpoint_map_t watchpoints_load_map[NUM_MEMSPACES];
+static checkpoint_map_t watchpoints_store_map[NUM_MEMSPACES];
+
 
 void mon_breakpoint_init(void)
 {
@@ -148,8 +160,57 @@ mon_checkpoint_t *mon_breakpoint_find_checkpoint(int brknum)
     return NULL;
 }
 
+static void checkpoint_map_set(checkpoint_map_t *map, unsigned int addr)
+{
+    uint8_t **bits = &map->page[(addr >> 8) & 0xff];
+
+    if (*bits == NULL) {
+        *bits = lib_calloc(0x100 / 8, 1);
+    }
+    (*bits)[(addr & 0xff) >> 3] |= 1 << (addr & 7);
+}
+
+static void checkpoint_map_build(checkpoint_map_t *map, checkpoint_list_t *head)
+{
+    unsigned int i;
+
+    for (i = 0; i < 0x100; i++) {
+        lib_free(map->page[i]);
+        map->page[i] = NULL;
+    }
+
+    for (; head; head = head->next) {
+        mon_checkpoint_t *cp = head->checkpt;
+        unsigned int addr = addr_location(cp->start_addr);
+        unsigned int end = addr;
+
+        if (mon_is_valid_addr(cp->end_addr)) {
+            end = addr_location(cp->end_addr);
+        }
+        /* ranges may wrap around $ffff */
+        for (;;) {
+            checkpoint_map_set(map, addr);
+            if (addr == end) {
+                break;
+            }
+            addr = (addr + 1) & 0xffff;
+        }
+    }
+}
+
+static bool checkpoint_map_test(const checkpoint_map_t *map, unsigned int addr)
+{
+    const uint8_t *bits = map->page[(addr >> 8) & 0xff];
+
+    return bits != NULL && (bits[(addr & 0xff) >> 3] & (1 << (addr & 7))) != 0;
+}
+
 static void update_checkpoint_state(MEMSPACE mem)
 {
+    checkpoint_map_build(&breakpoints_map[mem], breakpoints[mem]);
+    checkpoint_map_build(&watchpoints_load_map[mem], watchpoints_load[mem]);
+    checkpoint_map_build(&watchpoints_store_map[mem], watchpoints_store[mem]);
+
     /* calls mem_toggle_watchpoints() */
     if (watchpoints_load[mem] != NULL ||
         watchpoints_store[mem] != NULL) {
@@ -206,6 +267,7 @@ static void remove_checkpoint(mon_checkpoint_t *cp)
     mem = addr_memspace(cp->start_addr);
 
     mon_delete_conditional(cp->condition);
+    mon_delete_cond_program(cp->condition_program);
     lib_free(cp->command);
     cp->command = NULL;
 
@@ -369,7 +431,10 @@ void mon_breakpoint_set_checkpoint_condition(int cp_num,
         if (!cp) {
             mon_out("#%d not a valid checkpoint\n", cp_num);
         } else {
+            mon_delete_conditional(cp->condition);
+            mon_delete_cond_program(cp->condition_program);
             cp->condition = cnode;
+            cp->condition_program = mon_compile_conditional(cnode);
 
             mon_out("Setting checkpoint %d condition to: ", cp_num);
             mon_print_conditional(cnode);
@@ -449,6 +514,7 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
     checkpoint_list_t *ptr;
     mon_checkpoint_t *cp;
     checkpoint_list_t *list;
+    const checkpoint_map_t *map;
     monitor_cpu_type_t *monitor_cpu, *searchcpu;
     bool must_stop = FALSE;
     MON_ADDR instpc, searchpc;
@@ -457,8 +523,36 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
     const char *op_str;
     const char *action_str;
     supported_cpu_type_list_t *cpulist;
-    int monbank = mon_interfaces[mem]->current_bank;
+    int monbank;
+
+    switch (op) {
+        case e_load:
+            list = watchpoints_load[mem];
+            map = &watchpoints_load_map[mem];
+            op_str = "load";
+            is_loadstore = 1;
+            break;
 
+        case e_store:
+            list = watchpoints_store[mem];
+            map = &watchpoints_store_map[mem];
+            op_str = "store";
+            is_loadstore = 1;
+            break;
+
+        default: /* e_exec */
+            list = breakpoints[mem];
+            map = &breakpoints_map[mem];
+            op_str = "exec";
+            break;
+    }
+
+    /* the common case: no checkpoint covers this address */
+    if (!checkpoint_map_test(map, addr)) {
+        return FALSE;
+    }
+
+    monbank = mon_interfaces[mem]->current_bank;
     monitor_cpu = monitor_cpu_for_memspace[mem];
     instpc = new_addr(mem, (monitor_cpu->mon_register_get_val)(mem, e_PC));
     loadstorepc = new_addr(mem, lastpc);
@@ -492,25 +586,6 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
         }
     }
 
-    switch (op) {
-        case e_load:
-            list = watchpoints_load[mem];
-            op_str = "load";
-            is_loadstore = 1;
-            break;
-
-        case e_store:
-            list = watchpoints_store[mem];
-            op_str = "store";
-            is_loadstore = 1;
-            break;
-
-        default: /* e_exec */
-            list = breakpoints[mem];
-            op_str = "exec";
-            break;
-    }
-
     ptr = search_checkpoint_list(list, addr);
 
     while (ptr && mon_is_in_range(ptr->checkpt->start_addr, ptr->checkpt->end_addr, addr)) {
@@ -518,7 +593,11 @@ bool mon_breakpoint_check_checkpoint(MEMSPACE mem, unsigned int addr, unsigned i
         ptr = ptr->next;
         if (cp && cp->enabled == e_ON) {
             /* If condition test fails, skip this checkpoint */
-            if (cp->condition) {
+            if (cp->condition_program) {
+                if (!mon_evaluate_cond_program(cp->condition_program)) {
+                    continue;
+                }
+            } else if (cp->condition) {
                 if (!mon_evaluate_conditional(cp->condition)) {
                     continue;
                 }
@@ -638,6 +717,7 @@ int breakpoint_add_checkpoint(MON_ADDR start_addr, MON_ADDR end_addr,
     new_cp->hit_count = 0;
     new_cp->ignore_count = 0;
     new_cp->condition = NULL;
+    new_cp->condition_program = NULL;
     new_cp->command = NULL;
     new_cp->check_load = memory_op & e_load;
     new_cp->check_store = memory_op & e_store;
@@ -720,6 +800,7 @@ void mon_breakpoint_unset(MON_ADDR address)
         /* there's a breakpoint, so remove it */
         remove_checkpoint_from_list( &all_checkpoints, ptr->checkpt );
         remove_checkpoint_from_list( &breakpoints[mem], ptr->checkpt );
+        update_checkpoint_state(mem);
     }
 }
 
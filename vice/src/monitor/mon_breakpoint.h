@@ -42,6 +42,7 @@ struct mon_checkpoint_s {
     int hit_count;
     int ignore_count;
     cond_node_t *condition;
+    cond_program_t *condition_program;
     char *command;
     bool stop;
     bool enabled;
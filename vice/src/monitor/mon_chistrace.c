@@ -0,0 +1,457 @@
+/*
+ * mon_chistrace.c - Record the cpu history to a compressed trace file.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Every instruction that goes into the cpu history is also encoded into
+   the current block of the trace.  Full blocks are handed to a writer
+   thread, which compresses and writes them.  When the writer falls behind
+   by more than CHISTRACE_QUEUE blocks the emulation waits for it, so no
+   record is ever dropped.
+
+   The record of an instruction is only encoded when the next one arrives,
+   since the JSR of some cores fixes its second operand afterwards.  The
+   format is described in mon_chistrace.h, tools/chistrace decodes it.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "lib.h"
+#include "log.h"
+#include "mon_chistrace.h"
+#include "mon_memmap.h"
+#include "monitor.h"
+#include "montypes.h"
+#include "types.h"
+
+int mon_chistrace_enabled = 0;
+
+#ifdef FEATURE_CPUMEMHISTORY
+
+#include <pthread.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#define CHISTRACE_BLOCK_SIZE    (1024 * 1024)
+#define CHISTRACE_RECORD_MAX    32
+#define CHISTRACE_QUEUE         4
+#define CHISTRACE_ORIGINS       8
+
+typedef struct chistrace_block_s {
+    uint8_t *data;
+    size_t size;
+    unsigned int records;
+} chistrace_block_t;
+
+typedef struct chistrace_state_s {
+    CLOCK cycle;
+    unsigned int pc;
+    uint8_t reg_a;
+    uint8_t reg_x;
+    uint8_t reg_y;
+    uint8_t reg_sp;
+    uint8_t reg_st;
+} chistrace_state_t;
+
+typedef struct chistrace_record_s {
+    CLOCK cycle;
+    unsigned int addr;
+    uint8_t op;
+    uint8_t p1;
+    uint8_t p2;
+    uint8_t reg_a;
+    uint8_t reg_x;
+    uint8_t reg_y;
+    uint8_t reg_sp;
+    uint8_t reg_st;
+    unsigned int origin;
+} chistrace_record_t;
+
+static log_t chistrace_log = LOG_ERR;
+
+static FILE *chistrace_fp = NULL;
+static char *chistrace_filename = NULL;
+
+/* Blocks head .. head + count - 1 are queued for the writer, the one after
+   them is filled by the emulation.  */
+static chistrace_block_t blocks[CHISTRACE_QUEUE + 1];
+static int queue_head = 0;
+static int queue_count = 0;
+static int queue_quit = 0;
+static int write_failed = 0;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_not_empty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t queue_not_full = PTHREAD_COND_INITIALIZER;
+static pthread_t writer_thread;
+
+static chistrace_block_t *fill_block = NULL;
+static chistrace_state_t state[CHISTRACE_ORIGINS];
+static chistrace_record_t pending;
+static int have_pending = 0;
+
+static uint64_t total_records = 0;
+static uint64_t total_raw = 0;
+static uint64_t total_stored = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static void put_dword(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static int write_block(chistrace_block_t *block, uint8_t *out, size_t out_size)
+{
+    uint8_t header[CHISTRACE_BLOCK_HEADER];
+    const uint8_t *stored = block->data;
+    size_t stored_size = block->size;
+    int method = CHISTRACE_METHOD_STORED;
+
+#ifdef HAVE_ZLIB
+    uLongf len = (uLongf)out_size;
+
+    if (compress2(out, &len, block->data, (uLong)block->size, Z_BEST_SPEED) == Z_OK
+        && len < block->size) {
+        stored = out;
+        stored_size = len;
+        method = CHISTRACE_METHOD_ZLIB;
+    }
+#endif
+
+    put_dword(header, (uint32_t)block->size);
+    put_dword(header + 4, (uint32_t)stored_size);
+    put_dword(header + 8, block->records);
+    header[12] = (uint8_t)method;
+
+    if (fwrite(header, 1, sizeof(header), chistrace_fp) != sizeof(header)
+        || fwrite(stored, 1, stored_size, chistrace_fp) != stored_size) {
+        return -1;
+    }
+    total_stored += sizeof(header) + stored_size;
+    return 0;
+}
+
+static void *writer_main(void *arg)
+{
+    chistrace_block_t *block;
+    uint8_t *out;
+    size_t out_size = CHISTRACE_BLOCK_SIZE + CHISTRACE_BLOCK_SIZE / 100 + 1024;
+    int failed;
+
+    out = lib_malloc(out_size);
+
+    pthread_mutex_lock(&queue_lock);
+    while (1) {
+        while (queue_count == 0 && !queue_quit) {
+            pthread_cond_wait(&queue_not_empty, &queue_lock);
+        }
+        if (queue_count == 0) {
+            break;
+        }
+        block = &blocks[queue_head];
+        failed = write_failed;
+        pthread_mutex_unlock(&queue_lock);
+
+        if (!failed && write_block(block, out, out_size) < 0) {
+            log_error(chistrace_log, "Cannot write the cpu history trace `%s'.",
+                      chistrace_filename);
+            failed = 1;
+        }
+
+        pthread_mutex_lock(&queue_lock);
+        write_failed = failed;
+        queue_head = (queue_head + 1) % (CHISTRACE_QUEUE + 1);
+        queue_count--;
+        pthread_cond_signal(&queue_not_full);
+    }
+    pthread_mutex_unlock(&queue_lock);
+
+    lib_free(out);
+    return NULL;
+}
+
+/* Hand the filled block to the writer and get the next one to fill.  */
+static void submit_block(void)
+{
+    if (fill_block->records == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    queue_count++;
+    pthread_cond_signal(&queue_not_empty);
+    while (queue_count > CHISTRACE_QUEUE) {
+        pthread_cond_wait(&queue_not_full, &queue_lock);
+    }
+    fill_block = &blocks[(queue_head + queue_count) % (CHISTRACE_QUEUE + 1)];
+    pthread_mutex_unlock(&queue_lock);
+
+    fill_block->size = 0;
+    fill_block->records = 0;
+    memset(state, 0, sizeof(state));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static uint8_t *put_varint(uint8_t *p, int64_t value)
+{
+    uint64_t v = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static void encode_pending(void)
+{
+    chistrace_state_t *s = &state[pending.origin];
+    uint8_t *start, *p;
+    uint8_t flags = (uint8_t)pending.origin;
+
+    if (fill_block->size > CHISTRACE_BLOCK_SIZE - CHISTRACE_RECORD_MAX) {
+        submit_block();
+    }
+
+    start = fill_block->data + fill_block->size;
+    p = start + 1;
+    p = put_varint(p, (int64_t)(pending.cycle - s->cycle));
+    p = put_varint(p, (int64_t)pending.addr - (int64_t)s->pc);
+    *p++ = pending.op;
+    *p++ = pending.p1;
+    *p++ = pending.p2;
+    if (pending.reg_a != s->reg_a) {
+        flags |= CHISTRACE_FLAG_A;
+        *p++ = pending.reg_a;
+    }
+    if (pending.reg_x != s->reg_x) {
+        flags |= CHISTRACE_FLAG_X;
+        *p++ = pending.reg_x;
+    }
+    if (pending.reg_y != s->reg_y) {
+        flags |= CHISTRACE_FLAG_Y;
+        *p++ = pending.reg_y;
+    }
+    if (pending.reg_sp != s->reg_sp) {
+        flags |= CHISTRACE_FLAG_SP;
+        *p++ = pending.reg_sp;
+    }
+    if (pending.reg_st != s->reg_st) {
+        flags |= CHISTRACE_FLAG_ST;
+        *p++ = pending.reg_st;
+    }
+    *start = flags;
+
+    s->cycle = pending.cycle;
+    s->pc = pending.addr;
+    s->reg_a = pending.reg_a;
+    s->reg_x = pending.reg_x;
+    s->reg_y = pending.reg_y;
+    s->reg_sp = pending.reg_sp;
+    s->reg_st = pending.reg_st;
+
+    fill_block->size += (size_t)(p - start);
+    fill_block->records++;
+    total_records++;
+    total_raw += (uint64_t)(p - start);
+}
+
+void mon_chistrace_store(CLOCK cycle, unsigned int addr, unsigned int op,
+                         unsigned int p1, unsigned int p2,
+                         uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                         uint8_t reg_sp, unsigned int reg_st, MEMSPACE origin)
+{
+    if (have_pending) {
+        encode_pending();
+    }
+    pending.cycle = cycle;
+    pending.addr = addr & 0xffff;
+    pending.op = (uint8_t)op;
+    pending.p1 = (uint8_t)p1;
+    pending.p2 = (uint8_t)p2;
+    pending.reg_a = reg_a;
+    pending.reg_x = reg_x;
+    pending.reg_y = reg_y;
+    pending.reg_sp = reg_sp;
+    pending.reg_st = (uint8_t)reg_st;
+    pending.origin = (unsigned int)origin & (CHISTRACE_ORIGINS - 1);
+    have_pending = 1;
+}
+
+void mon_chistrace_fix_p2(unsigned int p2)
+{
+    pending.p2 = (uint8_t)p2;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int mon_chistrace_start(const char *filename)
+{
+    int i;
+
+    mon_chistrace_stop();
+
+    if (chistrace_log == LOG_ERR) {
+        chistrace_log = log_open("CPUHistoryTrace");
+    }
+
+    chistrace_fp = fopen(filename, MODE_WRITE);
+    if (chistrace_fp == NULL) {
+        log_error(chistrace_log, "Cannot open `%s' for writing.", filename);
+        return -1;
+    }
+    if (fwrite(CHISTRACE_MAGIC, 1, CHISTRACE_MAGIC_LEN, chistrace_fp) != CHISTRACE_MAGIC_LEN
+        || fputc(CHISTRACE_VERSION, chistrace_fp) == EOF) {
+        log_error(chistrace_log, "Cannot write to `%s'.", filename);
+        fclose(chistrace_fp);
+        chistrace_fp = NULL;
+        return -1;
+    }
+
+    for (i = 0; i < CHISTRACE_QUEUE + 1; i++) {
+        blocks[i].data = lib_malloc(CHISTRACE_BLOCK_SIZE);
+        blocks[i].size = 0;
+        blocks[i].records = 0;
+    }
+    queue_head = 0;
+    queue_count = 0;
+    queue_quit = 0;
+    write_failed = 0;
+    fill_block = &blocks[0];
+    memset(state, 0, sizeof(state));
+    have_pending = 0;
+    total_records = 0;
+    total_raw = 0;
+    total_stored = CHISTRACE_MAGIC_LEN + 1;
+    chistrace_filename = lib_strdup(filename);
+
+    if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) {
+        log_error(chistrace_log, "Cannot start the writer thread.");
+        for (i = 0; i < CHISTRACE_QUEUE + 1; i++) {
+            lib_free(blocks[i].data);
+            blocks[i].data = NULL;
+        }
+        fclose(chistrace_fp);
+        chistrace_fp = NULL;
+        lib_free(chistrace_filename);
+        chistrace_filename = NULL;
+        return -1;
+    }
+
+    mon_chistrace_enabled = 1;
+    mon_cpuhistory_enable(MON_CPUHISTORY_TRACE, 1);
+    log_message(chistrace_log, "Recording the cpu history to `%s'.", filename);
+    return 0;
+}
+
+void mon_chistrace_stop(void)
+{
+    int i;
+
+    if (!mon_chistrace_enabled) {
+        return;
+    }
+    mon_chistrace_enabled = 0;
+    mon_cpuhistory_enable(MON_CPUHISTORY_TRACE, 0);
+
+    if (have_pending) {
+        encode_pending();
+        have_pending = 0;
+    }
+    submit_block();
+
+    pthread_mutex_lock(&queue_lock);
+    queue_quit = 1;
+    pthread_cond_signal(&queue_not_empty);
+    pthread_mutex_unlock(&queue_lock);
+    pthread_join(writer_thread, NULL);
+
+    if (fclose(chistrace_fp) != 0) {
+        write_failed = 1;
+    }
+    chistrace_fp = NULL;
+    log_message(chistrace_log, "Recorded %"PRIu64" instructions to `%s'%s.",
+                total_records, chistrace_filename,
+                write_failed ? ", with write errors" : "");
+
+    for (i = 0; i < CHISTRACE_QUEUE + 1; i++) {
+        lib_free(blocks[i].data);
+        blocks[i].data = NULL;
+    }
+    fill_block = NULL;
+    lib_free(chistrace_filename);
+    chistrace_filename = NULL;
+}
+
+void mon_chistrace_status(void)
+{
+    if (!mon_chistrace_enabled) {
+        mon_out("No cpu history trace is recorded.\n");
+        return;
+    }
+    /* total_stored is updated by the writer, it is only informative here */
+    mon_out("Recording the cpu history to `%s'.\n", chistrace_filename);
+    mon_out("%"PRIu64" instructions, %"PRIu64" bytes encoded, %"PRIu64" bytes written%s.\n",
+            total_records, total_raw, total_stored,
+            write_failed ? ", write errors" : "");
+}
+
+#else /* !FEATURE_CPUMEMHISTORY */
+
+int mon_chistrace_start(const char *filename)
+{
+    mon_out("Disabled. configure with --enable-cpuhistory and recompile.\n");
+    return -1;
+}
+
+void mon_chistrace_stop(void)
+{
+}
+
+void mon_chistrace_status(void)
+{
+    mon_out("Disabled. configure with --enable-cpuhistory and recompile.\n");
+}
+
+void mon_chistrace_store(CLOCK cycle, unsigned int addr, unsigned int op,
+                         unsigned int p1, unsigned int p2,
+                         uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                         uint8_t reg_sp, unsigned int reg_st, MEMSPACE origin)
+{
+}
+
+void mon_chistrace_fix_p2(unsigned int p2)
+{
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ * mon_chistrace.h - Record the cpu history to a compressed trace file.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MON_CHISTRACE_H
+#define VICE_MON_CHISTRACE_H
+
+#include "montypes.h"
+#include "types.h"
+
+/* Trace file format, all numbers little endian:
+
+   header  8 BYTES "VICECHT" 0x1a, BYTE version (1)
+   blocks  DWORD raw size, DWORD stored size, DWORD record count,
+           BYTE method (0 = stored, 1 = zlib), then the stored bytes
+
+   Every block starts from a zeroed delta state, so it can be decoded on
+   its own, and a file cut short is readable up to its last full block.
+   A record is:
+
+   BYTE    origin memspace (bits 0-2) and flags for the registers that
+           follow (bits 3-7: A, X, Y, SP, ST)
+   VARINT  cycle minus the cycle of the last record of the memspace
+   VARINT  PC minus the PC of the last record of the memspace
+   BYTE    opcode, operand 1, operand 2
+   BYTE    A, X, Y, SP and ST if flagged, in that order; a register is
+           flagged when it differs from the last record of the memspace
+
+   VARINTs are zigzag encoded signed numbers, 7 bits per byte, low bits
+   first, with bit 7 set on all bytes but the last.  */
+
+#define CHISTRACE_MAGIC         "VICECHT\x1a"
+#define CHISTRACE_MAGIC_LEN     8
+#define CHISTRACE_VERSION       1
+#define CHISTRACE_BLOCK_HEADER  13
+
+#define CHISTRACE_METHOD_STORED 0
+#define CHISTRACE_METHOD_ZLIB   1
+
+#define CHISTRACE_FLAG_A        0x08
+#define CHISTRACE_FLAG_X        0x10
+#define CHISTRACE_FLAG_Y        0x20
+#define CHISTRACE_FLAG_SP       0x40
+#define CHISTRACE_FLAG_ST       0x80
+
+/* Set while a trace is recorded.  */
+extern int mon_chistrace_enabled;
+
+int mon_chistrace_start(const char *filename);
+void mon_chistrace_stop(void);
+void mon_chistrace_status(void);
+
+void mon_chistrace_store(CLOCK cycle, unsigned int addr, unsigned int op,
+                         unsigned int p1, unsigned int p2,
+                         uint8_t reg_a, uint8_t reg_x, uint8_t reg_y,
+                         uint8_t reg_sp, unsigned int reg_st, MEMSPACE origin);
+void mon_chistrace_fix_p2(unsigned int p2);
+
+#endif
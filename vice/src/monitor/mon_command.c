@@ -175,6 +175,13 @@ static const mon_cmds_t mon_cmd_array[] = {
       FILENAME_ARG
     },
 
+    { "rewind", "",
+      "[<steps>]",
+      "Restore the machine state recorded <steps> intervals ago (default 1)"
+      " from the rewind buffer. Requires RewindInterval to be set.",
+      NO_FILENAME_ARG
+    },
+
     { "bank", "",
       "[<memspace>] [bankname]",
       "If bankname is not given, print the possible banks for the memspace.\n"
@@ -207,6 +214,14 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "chistrace", "",
+      "[\"<filename>\"|off]",
+      "Record the cpu history of all devices to a compressed trace file,"
+      " until turned off.  The tool chistrace decodes and filters the file."
+      " Without argument, show whether a trace is being recorded.",
+      NO_FILENAME_ARG
+    },
+
     { "registers", "r",
       "[<reg_name> = <number> [, <reg_name> = <number>]*]",
       "Assign respective registers (use FL for status flags).  With no"
@@ -220,6 +235,20 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "framestats", "fst",
+      NULL,
+      "Print the median, 95th and 99th percentile and maximum of the host time per frame,"
+      " and the perf counters per frame if PerfCounters is enabled. 'reset' clears them.",
+      NO_FILENAME_ARG
+    },
+
+    { "memreport", "mrep",
+      NULL,
+      "Print how many bytes the machine state, the draw buffers, sound, the drives and"
+      " the other larger buffers of the emulator take.",
+      NO_FILENAME_ARG
+    },
+
     { "goto", "g",
       "<address>",
       "Change the PC to ADDRESS and continue execution",
@@ -254,6 +283,7 @@ static const mon_cmds_t mon_cmd_array[] = {
       "Main CPU profiling functions. Commands:\n"
       "prof on - Start profiling and flush old profiling data.\n"
       "prof off - Stop profiling.\n"
+      "prof sample [<cycles=1000>] - Start sampling the PC every 'cycles' cycles instead (much faster, flushes old data).\n"
       "prof flat [<num=20>] - Show flat summary of 'num' top functions sorted by self time.\n"
       "prof graph [<ctx>] [depth <d>] Show callgraph up to 'd' levels deep. If 'ctx' is given, zoom on that subtree.\n"
       "prof func <function> - Show aggregate statistics for a function including callers and callees.\n"
@@ -261,7 +291,9 @@ static const mon_cmds_t mon_cmd_array[] = {
       "prof context <ctx> - Detailed context information including "
       " per-instruction profiling for function"
       " in a call graph context.\n"
-      "prof clear <function> - Clears all profiling stats for function.\n",
+      "prof clear <function> - Clears all profiling stats for function.\n"
+      "prof folded \"<file>\" - Write cycles per call stack in the folded format of flamegraph.pl.\n"
+      "prof pprof \"<file>\" - Write samples and cycles per instruction and call stack as a pprof profile.\n",
       NO_FILENAME_ARG
     },
 
@@ -787,6 +819,14 @@ static const mon_cmds_t mon_cmd_array[] = {
       NO_FILENAME_ARG
     },
 
+    { "tapecount", "",
+      "[<Counter>]",
+      "Wind the stopped datasette to where the counter shows <Counter>"
+      " (write +123 for decimal), using the index built when the tape was"
+      " attached. When no counter is given, show the current counter.",
+      NO_FILENAME_ARG
+    },
+
     { "", "",
       "",
       "Command file commands:",
@@ -37,6 +37,7 @@
 
 #include "asm.h"
 #include "console.h"
+#include "lib.h"
 #include "log.h"
 #include "mon_disassemble.h"
 #include "mon_util.h"
@@ -1480,6 +1481,81 @@ static const char *mon_disassemble_to_string_internal(MEMSPACE memspace,
 #undef p3
 #undef p4
 
+/*
+ * Cache of decoded instructions for the D command, the register dump of
+ * single stepping and the binary monitor, which decode the same code over
+ * and over.  Entries are keyed by memspace, bank (or mem_config) and
+ * address, and are only used while the instruction bytes read back the
+ * same and no label was added or removed.  This way any write to the code,
+ * in RAM, drive memory or I/O alike, invalidates the entry without hooks
+ * in the memory code of the machines.
+ */
+#define DIS_CACHE_SIZE      4096
+#define DIS_CACHE_TEXT_LEN  64
+
+/* bank key of the mem_config based disassembly */
+#define DIS_CACHE_MEMCONFIG(c)  (-1 - (c))
+
+typedef struct dis_cache_entry_s {
+    monitor_cpu_type_t *cpu_type;   /* NULL for an unused entry */
+    MEMSPACE mem;
+    int bank;
+    uint16_t loc;
+    uint8_t opc[5];
+    unsigned int symbol_serial;
+    unsigned int opc_size;
+    char text[DIS_CACHE_TEXT_LEN];
+} dis_cache_entry_t;
+
+static dis_cache_entry_t *dis_cache = NULL;
+
+static const char *mon_disassemble_cached(MEMSPACE mem, int bank, uint16_t loc,
+                                          uint8_t opc[5], unsigned *opc_size)
+{
+    monitor_cpu_type_t *mon_cpu_type = monitor_cpu_for_memspace[mem];
+    dis_cache_entry_t *entry;
+    const char *dis_inst;
+    size_t len;
+
+    if (dis_cache == NULL) {
+        dis_cache = lib_calloc(DIS_CACHE_SIZE, sizeof(dis_cache_entry_t));
+    }
+
+    entry = &dis_cache[(loc ^ ((unsigned int)mem << 9) ^ ((unsigned int)bank << 5)) & (DIS_CACHE_SIZE - 1)];
+
+    if (entry->cpu_type == mon_cpu_type
+        && entry->mem == mem
+        && entry->bank == bank
+        && entry->loc == loc
+        && entry->symbol_serial == mon_symbol_table_serial
+        && memcmp(entry->opc, opc, sizeof(entry->opc)) == 0) {
+        *opc_size = entry->opc_size;
+        return entry->text;
+    }
+
+    dis_inst = mon_disassemble_to_string_internal(mem, loc, opc, 1, opc_size, mon_cpu_type);
+
+    len = strlen(dis_inst);
+    if (len < DIS_CACHE_TEXT_LEN) {
+        entry->cpu_type = mon_cpu_type;
+        entry->mem = mem;
+        entry->bank = bank;
+        entry->loc = loc;
+        memcpy(entry->opc, opc, sizeof(entry->opc));
+        entry->symbol_serial = mon_symbol_table_serial;
+        entry->opc_size = *opc_size;
+        memcpy(entry->text, dis_inst, len + 1);
+    }
+
+    return dis_inst;
+}
+
+void mon_disassemble_cache_shutdown(void)
+{
+    lib_free(dis_cache);
+    dis_cache = NULL;
+}
+
 /*
  * Disassemble an instruction based on the current mem_config (implies bank
  * "cpu" but possibly differently configured).
@@ -1490,7 +1566,6 @@ static const char* mon_disassemble_instr_memconfig_internal(unsigned *opc_size,
     uint8_t opc[5];
     MEMSPACE mem;
     uint16_t loc;
-    int hex_mode = 1;
     const char *dis_inst;
     int mem_config;
 
@@ -1504,13 +1579,29 @@ static const char* mon_disassemble_instr_memconfig_internal(unsigned *opc_size,
     opc[3] = mon_get_mem_val_nosfx(mem, mem_config, (uint16_t)(loc + 3));
     opc[4] = mon_get_mem_val_nosfx(mem, mem_config, (uint16_t)(loc + 4));
 
-    dis_inst = mon_disassemble_to_string_internal(mem, loc, opc, hex_mode, opc_size, monitor_cpu_for_memspace[mem]);
+    dis_inst = mon_disassemble_cached(mem, DIS_CACHE_MEMCONFIG(mem_config), loc, opc, opc_size);
 
     sprintf(buff, ".%s:%04x  %s", mon_memspace_string[mem], loc, dis_inst);
 
     return buff;
 }
 
+/*
+ * Disassemble an instruction of the given bank.  opc receives the 5 bytes
+ * at the address, of which the first opc_size are the instruction.
+ */
+const char *mon_disassemble_instr_bank(MEMSPACE mem, int bank, uint16_t loc,
+                                       uint8_t opc[5], unsigned *opc_size)
+{
+    opc[0] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 0));
+    opc[1] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 1));
+    opc[2] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 2));
+    opc[3] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 3));
+    opc[4] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 4));
+
+    return mon_disassemble_cached(mem, bank, loc, opc, opc_size);
+}
+
 /*
  * Disassemble an instruction based on the currently set bank.
  */
@@ -1520,21 +1611,12 @@ static const char* mon_disassemble_instr_bank_internal(unsigned *opc_size, MON_A
     uint8_t opc[5];
     MEMSPACE mem;
     uint16_t loc;
-    int hex_mode = 1;
     const char *dis_inst;
-    int bank;
 
     mem = addr_memspace(addr);
     loc = addr_location(addr);
-    bank = mon_interfaces[mem]->current_bank;
-
-    opc[0] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 0));
-    opc[1] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 1));
-    opc[2] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 2));
-    opc[3] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 3));
-    opc[4] = mon_get_mem_val_ex_nosfx(mem, bank, (uint16_t)(loc + 4));
 
-    dis_inst = mon_disassemble_to_string_internal(mem, loc, opc, hex_mode, opc_size, monitor_cpu_for_memspace[mem]);
+    dis_inst = mon_disassemble_instr_bank(mem, mon_interfaces[mem]->current_bank, loc, opc, opc_size);
 
     sprintf(buff, ".%s:%04x  %s", mon_memspace_string[mem], loc, dis_inst);
 
@@ -36,8 +36,17 @@ const char *mon_disassemble_to_string_ex(MEMSPACE, unsigned int addr, unsigned i
                                          unsigned int p1, unsigned int p2, unsigned int p3,
                                          int hex_mode, unsigned *len);
 
+/* The text of a disassembled instruction starts with its bytes in a column
+   of this width.  */
+#define MON_DISASSEMBLE_BYTES_LEN   12
+
+const char *mon_disassemble_instr_bank(MEMSPACE mem, int bank, uint16_t loc,
+                                       uint8_t opc[5], unsigned *opc_size);
+
 void mon_disassemble_with_regdump(MEMSPACE mem, unsigned int addr);
 
 void mon_disassemble_lines(MON_ADDR start_addr, MON_ADDR end_addr);
 
+void mon_disassemble_cache_shutdown(void);
+
 #endif
@@ -54,6 +54,9 @@
 
 #define ADDR_LIMIT(x) ((uint16_t)(addr_mask(x)))
 
+/* Files are moved up to the end of the 64KiB address space at a time */
+#define MON_FILE_BLOCK_SIZE 0x10000
+
 #define curbank (mon_interfaces[mem]->current_bank)
 
 static FILE *fp;
@@ -154,6 +157,43 @@ static int mon_file_write(uint8_t data, unsigned int secondary, int device)
     return 0;
 }
 
+/* Read up to `len' bytes, returns the number of bytes read, 0 at the end of
+   the file.  */
+static unsigned int mon_file_read_block(uint8_t *data, unsigned int len,
+                                        unsigned int secondary, int device)
+{
+    unsigned int count = 0;
+
+    if (fp) {
+        count = (unsigned int)fread((char *)data, 1, len, fp);
+    } else if (device >= 8) {
+        /* Return EOF if we hit a CBM EOF on the last read. */
+        if (mon_file_read_eof[device - 8][secondary]) {
+            return 0;
+        }
+        /* Set next EOF based on CBM EOF. */
+        count = len;
+        mon_file_read_eof[device - 8][secondary] =
+            vdrive_iec_read_block(vdrive, data, &count, secondary);
+    }
+    return count;
+}
+
+static int mon_file_write_block(const uint8_t *data, unsigned int len,
+                                unsigned int secondary, int device)
+{
+    if (fp) {
+        if (fwrite((const char *)data, 1, len, fp) < len) {
+            return -1;
+        }
+    } else if (device >= 8) {
+        if (vdrive_iec_write_block(vdrive, data, len, secondary) != SERIAL_OK) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 static int mon_file_close(unsigned int secondary, int device)
 {
     if (fp) {
@@ -174,6 +214,7 @@ void mon_file_load(const char *filename, int device, MON_ADDR start_addr,
 {
     uint16_t adr, load_addr = 0;
     uint8_t b1 = 0, b2 = 0;
+    uint8_t *buf;
     int ch = 0;
     MEMSPACE mem;
     int origbank = 0;
@@ -215,20 +256,23 @@ void mon_file_load(const char *filename, int device, MON_ADDR start_addr,
         origbank = curbank;
     }
 
+    buf = lib_malloc(MON_FILE_BLOCK_SIZE);
+
+    /* read up to the end of the address space at a time */
     do {
-        /* initialize to avoid false positive with clang static initializer
-         * about using a garbage load_byte in the memset() call
-         */
-        uint8_t load_byte = 0;
+        unsigned int addr = ADDR_LIMIT(adr + ch);
+        unsigned int len;
 
-        if (mon_file_read(&load_byte, 0, device) < 0) {
+        len = mon_file_read_block(buf, MON_FILE_BLOCK_SIZE - addr, 0, device);
+        if (len == 0) {
             break;
         }
-        mon_set_mem_val(mem, ADDR_LIMIT(adr + ch), load_byte);
+        mon_set_mem_block(mem, (uint16_t)addr, (uint16_t)(addr + len - 1), buf);
+        ch += (int)len;
 
         /* Hack to be able to read large .prgs for x64dtv */
         if ((machine_class == VICE_MACHINE_C64DTV) &&
-            (ADDR_LIMIT(adr + ch) == 0xffff) &&
+            (addr + len == MON_FILE_BLOCK_SIZE) &&
             ((curbank >= mem_bank_from_name("ram00")) && (curbank <= mem_bank_from_name("ram1f")))) {
             curbank++;
             if (curbank > mem_bank_from_name("ram1f")) {
@@ -236,9 +280,10 @@ void mon_file_load(const char *filename, int device, MON_ADDR start_addr,
             }
             mon_out("Crossing 64KiB boundary.\n");
         }
-        ch++;
     } while (1);
 
+    lib_free(buf);
+
     if (machine_class == VICE_MACHINE_C64DTV) {
         curbank = origbank;
     }
@@ -262,7 +307,7 @@ void mon_file_save(const char *filename, int device, MON_ADDR start_addr,
 {
     uint16_t adr, end;
     long len;
-    int ch = 0;
+    uint8_t *buf;
     MEMSPACE mem;
 
     len = mon_evaluate_address_range(&start_addr, &end_addr, TRUE, -1);
@@ -295,17 +340,15 @@ void mon_file_save(const char *filename, int device, MON_ADDR start_addr,
         }
     }
 
-    do {
-        unsigned char save_byte;
-
-        save_byte = mon_get_mem_val(mem, (uint16_t)(adr + ch));
-        if (mon_file_write(save_byte, 1, device) < 0) {
-            mon_out("Saving for `%s' failed.\n", filename);
-            mon_file_close(1, device);
-            return;
-        }
-        ch++;
-    } while ((adr + ch) <= end);
+    buf = lib_malloc((size_t)(end - adr) + 1);
+    mon_get_mem_block(mem, adr, end, buf);
+    if (mon_file_write_block(buf, (unsigned int)(end - adr) + 1, 1, device) < 0) {
+        mon_out("Saving for `%s' failed.\n", filename);
+        lib_free(buf);
+        mon_file_close(1, device);
+        return;
+    }
+    lib_free(buf);
 
     mon_out("Saving file `%s' from $%04x to $%04x\n",
             filename, addr_location(start_addr), addr_location(end_addr));
@@ -318,6 +361,7 @@ void mon_file_verify(const char *filename, int device, MON_ADDR start_addr, bool
 {
     uint16_t adr, load_addr = 0;
     uint8_t b1 = 0, b2 = 0;
+    uint8_t *buf;
     int ch = 0;
     MEMSPACE mem;
     int origbank = 0;
@@ -357,30 +401,35 @@ void mon_file_verify(const char *filename, int device, MON_ADDR start_addr, bool
         origbank = curbank;
     }
 
+    buf = lib_malloc(MON_FILE_BLOCK_SIZE * 2);
+
+    /* compare up to the end of the address space at a time */
     do {
-        /* initialize to avoid false positive with clang static initializer
-         * about using a garbage load_byte in the if() below
-         */
-        uint8_t load_byte = 0;
-        uint8_t mem_byte;
+        unsigned int addr = ADDR_LIMIT(adr + ch);
+        unsigned int len, i;
+        uint8_t *mem_buf = buf + MON_FILE_BLOCK_SIZE;
 
-        if (mon_file_read(&load_byte, 0, device) < 0) {
+        len = mon_file_read_block(buf, MON_FILE_BLOCK_SIZE - addr, 0, device);
+        if (len == 0) {
             break;
         }
-        mem_byte = mon_get_mem_val(mem, ADDR_LIMIT(adr + ch));
-        if (load_byte != mem_byte) {
-            if (diffcount == 0) {
-                mon_out("\naddr:mem file\n");
+        mon_get_mem_block(mem, (uint16_t)addr, (uint16_t)(addr + len - 1), mem_buf);
+        for (i = 0; i < len; i++) {
+            if (buf[i] != mem_buf[i]) {
+                if (diffcount == 0) {
+                    mon_out("\naddr:mem file\n");
+                }
+                mon_out("%04x: ", addr + i);
+                mon_out("%02x %02x", mem_buf[i], buf[i]);
+                mon_out("\n");
+                diffcount++;
             }
-            mon_out("%04x: ", ADDR_LIMIT(adr + ch));
-            mon_out("%02x %02x", mem_byte, load_byte);
-            mon_out("\n");
-            diffcount++;
         }
+        ch += (int)len;
 
         /* Hack to be able to read large .prgs for x64dtv */
         if ((machine_class == VICE_MACHINE_C64DTV) &&
-            (ADDR_LIMIT(adr + ch) == 0xffff) &&
+            (addr + len == MON_FILE_BLOCK_SIZE) &&
             ((curbank >= mem_bank_from_name("ram00")) && (curbank <= mem_bank_from_name("ram1f")))) {
             curbank++;
             if (curbank > mem_bank_from_name("ram1f")) {
@@ -388,9 +437,10 @@ void mon_file_verify(const char *filename, int device, MON_ADDR start_addr, bool
             }
             mon_out("Crossing 64KiB boundary.\n");
         }
-        ch++;
     } while (1);
 
+    lib_free(buf);
+
     if (machine_class == VICE_MACHINE_C64DTV) {
         curbank = origbank;
     }
@@ -38,6 +38,8 @@
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
+#include "memusage.h"
+#include "mon_chistrace.h"
 #include "mon_disassemble.h"
 #include "mon_memmap.h"
 #include "monitor.h"
@@ -50,6 +52,21 @@
 
 uint8_t memmap_state = 0;
 
+/* One MON_CPUHISTORY_* bit for each reason the cpu history and memmap are
+   collected, the CPU cores skip the hooks while it is 0.  */
+int monitor_cpuhistory_enabled = 0;
+
+void mon_cpuhistory_enable(int reason, int enable)
+{
+#ifdef FEATURE_CPUMEMHISTORY
+    if (enable) {
+        monitor_cpuhistory_enabled |= reason;
+    } else {
+        monitor_cpuhistory_enabled &= ~reason;
+    }
+#endif
+}
+
 #ifdef FEATURE_CPUMEMHISTORY
 
 /* Defines */
@@ -89,22 +106,19 @@ static int cpuhistory_buffer_lines = 0;     /* actual size of the cyclic buffer
 static int cpuhistory_show_lines = 0;       /* number of lines to show in the monitor */
 static int cpuhistory_i = 0;
 
+/* memmap variables */
+static MEMMAP_ELEM *mon_memmap = NULL;
+static int mon_memmap_size;
+static int mon_memmap_picx;
+static int mon_memmap_picy;
+static unsigned int mon_memmap_mask;
 
-/** \brief  (re)allocate the buffer used for the cpu history info
- *
- * \param[in]   lines   new number of lines of the cpu history info
- */
-int monitor_cpuhistory_allocate(int lines)
-{
-    uint32_t i;
-
-    if (lines <= 0) {
-        fprintf(stderr, "%s(): illegal cpuhistory line count: %d\n",
-                __func__, lines);
-        return -1;
-    }
 
-    cpuhistory_show_lines = lines;
+/* (re)allocate the cyclic buffer for `cpuhistory_show_lines' lines */
+static void cpuhistory_resize(void)
+{
+    int lines = cpuhistory_show_lines;
+    int i;
 
     /* HACK HACK HACK
        since all CPUs are sharing one cyclic buffer for the history, we must make
@@ -142,6 +156,36 @@ int monitor_cpuhistory_allocate(int lines)
 
     cpuhistory_buffer_lines = lines;
     cpuhistory_i = 0;
+}
+
+/* the CPU history and the memory map, for the memory report */
+static size_t cpuhistory_usage(void)
+{
+    return (size_t)cpuhistory_buffer_lines * sizeof(cpuhistory_t)
+           + (size_t)mon_memmap_size * sizeof(MEMMAP_ELEM);
+}
+
+/** \brief  (re)allocate the buffer used for the cpu history info
+ *
+ * The buffer is allocated when the first instruction is stored, and never
+ * with `LowMemory' set.
+ *
+ * \param[in]   lines   new number of lines of the cpu history info
+ */
+int monitor_cpuhistory_allocate(int lines)
+{
+    if (lines <= 0) {
+        fprintf(stderr, "%s(): illegal cpuhistory line count: %d\n",
+                __func__, lines);
+        return -1;
+    }
+
+    cpuhistory_show_lines = lines;
+    memusage_register("monitor history", cpuhistory_usage);
+
+    if (cpuhistory != NULL) {
+        cpuhistory_resize();
+    }
     return 0;
 }
 
@@ -155,10 +199,17 @@ void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op,
                               unsigned int reg_st,
                               MEMSPACE origin)
 {
-    if (machine_is_jammed()) {
+    if (!monitor_cpuhistory_enabled || machine_is_jammed()) {
         return;
     }
 
+    if (cpuhistory == NULL) {
+        if (memusage_low_memory()) {
+            goto trace;
+        }
+        cpuhistory_resize();
+    }
+
     ++cpuhistory_i;
     if (cpuhistory_i == cpuhistory_buffer_lines) {
         cpuhistory_i = 0;
@@ -174,11 +225,27 @@ void monitor_cpuhistory_store(CLOCK cycle, unsigned int addr, unsigned int op,
     cpuhistory[cpuhistory_i].reg_sp = reg_sp;
     cpuhistory[cpuhistory_i].reg_st = reg_st;
     cpuhistory[cpuhistory_i].origin = origin;
+
+trace:
+    if (mon_chistrace_enabled) {
+        mon_chistrace_store(cycle, addr, op, p1, p2, reg_a, reg_x, reg_y, reg_sp, reg_st, origin);
+    }
 }
 
 void monitor_cpuhistory_fix_p2(unsigned int p2)
 {
-    cpuhistory[cpuhistory_i].p2 = p2;
+    if (cpuhistory != NULL) {
+        cpuhistory[cpuhistory_i].p2 = p2;
+    }
+
+    if (mon_chistrace_enabled) {
+        mon_chistrace_fix_p2(p2);
+    }
+}
+
+int monitor_cpuhistory_trace_active(void)
+{
+    return mon_chistrace_enabled;
 }
 
 void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filter3,
@@ -203,6 +270,13 @@ void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filt
         filter1 = default_memspace;
     }
 
+    if (cpuhistory == NULL) {
+        if (memusage_low_memory()) {
+            mon_out("No CPU history is kept with LowMemory set.\n");
+        }
+        return;
+    }
+
     /* determine the actual maximum records to go through */
     if (count < 1) {
         count = cpuhistory_show_lines;
@@ -283,13 +357,6 @@ void mon_cpuhistory(int count, MEMSPACE filter1, MEMSPACE filter2, MEMSPACE filt
 }
 
 
-/* memmap variables */
-static MEMMAP_ELEM *mon_memmap = NULL;
-static int mon_memmap_size;
-static int mon_memmap_picx;
-static int mon_memmap_picy;
-static unsigned int mon_memmap_mask;
-
 /* mmzap */
 void mon_memmap_zap(void)
 {
@@ -361,7 +428,7 @@ void monitor_memmap_store(unsigned int addr, unsigned int type)
     }
 #endif
 
-    if (memmap_state & MEMMAP_STATE_IN_MONITOR) {
+    if (!monitor_cpuhistory_enabled || (memmap_state & MEMMAP_STATE_IN_MONITOR)) {
         return;
     }
 #if 0 /* FIXME: why would we do this? */
@@ -452,11 +519,14 @@ void mon_memmap_init(void)
 
 void mon_memmap_shutdown(void)
 {
+    mon_chistrace_stop();
     lib_free(mon_memmap);
     mon_memmap = NULL;
     if (cpuhistory != NULL) {
         lib_free(cpuhistory);
+        cpuhistory = NULL;
     }
+    cpuhistory_buffer_lines = 0;
 }
 
 
@@ -497,4 +567,9 @@ void mon_memmap_shutdown(void)
 {
 }
 
+int monitor_cpuhistory_trace_active(void)
+{
+    return 0;
+}
+
 #endif
@@ -30,6 +30,13 @@
 #include "montypes.h"
 #include "types.h"
 
+/* Reasons for collecting the cpu history and memmap */
+#define MON_CPUHISTORY_RESOURCE 0x01    /* MonitorChisEnabled is set */
+#define MON_CPUHISTORY_MONITOR  0x02    /* the monitor has been opened */
+#define MON_CPUHISTORY_TRACE    0x04    /* a chistrace file is recorded */
+
+void mon_cpuhistory_enable(int reason, int enable);
+
 void mon_memmap_init(void);
 void mon_memmap_shutdown(void);
 
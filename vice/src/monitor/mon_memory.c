@@ -83,7 +83,7 @@ void mon_memory_compare(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest)
 {
     uint16_t start;
     MEMSPACE src_mem, dest_mem;
-    uint8_t byte1, byte2;
+    uint8_t *src_buf, *dest_buf;
     long i;
     unsigned int dst;
     long len;
@@ -100,15 +100,25 @@ void mon_memory_compare(MON_ADDR start_addr, MON_ADDR end_addr, MON_ADDR dest)
     dst = addr_location(dest);
     dest_mem = addr_memspace(dest);
 
-    for (i = 0; i < len; i++) {
-        byte1 = mon_get_mem_val(src_mem, (uint16_t)ADDR_LIMIT(start + i));
-        byte2 = mon_get_mem_val(dest_mem, (uint16_t)ADDR_LIMIT(dst + i));
+    if (len == 0) {
+        return;
+    }
 
-        if (byte1 != byte2) {
+    /* read both ranges in one go, plain memory is copied as a whole */
+    src_buf = lib_malloc(len);
+    dest_buf = lib_malloc(len);
+    mon_get_mem_block(src_mem, start, (uint16_t)(len - 1), src_buf);
+    mon_get_mem_block(dest_mem, (uint16_t)dst, (uint16_t)(len - 1), dest_buf);
+
+    for (i = 0; i < len; i++) {
+        if (src_buf[i] != dest_buf[i]) {
             mon_out("$%04x $%04x: %02x %02x\n",
-                    ADDR_LIMIT(start + i), ADDR_LIMIT(dst + i), byte1, byte2);
+                    ADDR_LIMIT(start + i), ADDR_LIMIT(dst + i), src_buf[i], dest_buf[i]);
         }
     }
+
+    lib_free(src_buf);
+    lib_free(dest_buf);
 }
 
 void mon_memory_fill(MON_ADDR start_addr, MON_ADDR end_addr,
@@ -153,9 +163,10 @@ void mon_memory_hunt(MON_ADDR start_addr, MON_ADDR end_addr,
                      unsigned char *data)
 {
     uint8_t *buf;
-    uint16_t start, next_read;
+    const uint8_t *p, *last;
+    uint16_t start;
     MEMSPACE mem;
-    long i;
+    unsigned int anchor;
     long len;
 
     len = mon_evaluate_address_range(&start_addr, &end_addr, TRUE, -1);
@@ -166,33 +177,37 @@ void mon_memory_hunt(MON_ADDR start_addr, MON_ADDR end_addr,
     mem = addr_memspace(start_addr);
     start = addr_location(start_addr);
 
-    buf = lib_malloc(data_buf_len);
+    /* read the whole range in one go, plain memory is copied as a whole */
+    buf = lib_malloc(len);
+    mon_get_mem_block(mem, start, (uint16_t)(len - 1), buf);
 
-    /* Fill buffer */
-    for (i = 0; i < data_buf_len; i++) {
-        buf[i] = mon_get_mem_val(mem, (uint16_t)ADDR_LIMIT(start + i));
+    /* look for the first byte without wildcard bits, the rest is only
+       compared where it matches */
+    for (anchor = 0; anchor < data_buf_len; anchor++) {
+        if (data_mask_buf[anchor] == 0xff) {
+            break;
+        }
     }
 
-    /* Do compares */
-    next_read = start + (uint16_t)data_buf_len;
-
-    for (i = 0; i <= (len - data_buf_len); i++, next_read++) {
-        int not_found = 0;
+    last = buf + len - data_buf_len;
+    for (p = buf; p <= last; p++) {
         unsigned int j;
-        for (j = 0; j < data_buf_len; j++) {
-            if ((buf[j] & data_mask_buf[j]) != data_buf[j]) {
-                not_found = 1;
+
+        if (anchor < data_buf_len) {
+            p = memchr(p + anchor, data_buf[anchor], (size_t)(last - p) + 1);
+            if (p == NULL) {
                 break;
             }
+            p -= anchor;
         }
-        if (!not_found) {
-            mon_out("%04x\n", ADDR_LIMIT(start + i));
+        for (j = 0; j < data_buf_len; j++) {
+            if ((p[j] & data_mask_buf[j]) != data_buf[j]) {
+                break;
+            }
         }
-
-        if (data_buf_len > 1) {
-            memmove(&(buf[0]), &(buf[1]), data_buf_len - 1);
+        if (j == data_buf_len) {
+            mon_out("%04x\n", ADDR_LIMIT(start + (p - buf)));
         }
-        buf[data_buf_len - 1] = mon_get_mem_val(mem, next_read);
     }
 
     mon_clear_buffer();
@@ -50,10 +50,13 @@ char *alloca();
 #include "asm.h"
 #include "console.h"
 #include "drive.h"
+#include "framestats.h"
 #include "interrupt.h"
 #include "lib.h"
 #include "machine.h"
+#include "memusage.h"
 #include "mon_breakpoint.h"
+#include "mon_chistrace.h"
 #include "mon_command.h"
 #include "mon_disassemble.h"
 #include "mon_drive.h"
@@ -141,7 +144,7 @@ void set_yydebug(int val);
 %token CMD_LOAD CMD_BASICLOAD CMD_SAVE CMD_VERIFY CMD_BVERIFY CMD_IGNORE CMD_HUNT CMD_FILL CMD_MOVE
 %token CMD_GOTO CMD_REGISTERS CMD_READSPACE CMD_WRITESPACE CMD_RADIX
 %token CMD_MEM_DISPLAY CMD_BREAK CMD_TRACE CMD_IO CMD_BRMON CMD_COMPARE
-%token CMD_DUMP CMD_UNDUMP CMD_EXIT CMD_DELETE CMD_CONDITION CMD_COMMAND
+%token CMD_DUMP CMD_UNDUMP CMD_REWIND CMD_EXIT CMD_DELETE CMD_CONDITION CMD_COMMAND
 %token CMD_ASSEMBLE CMD_DISASSEMBLE CMD_NEXT CMD_STEP CMD_PRINT CMD_DEVICE
 %token CMD_HELP CMD_WATCH CMD_DISK CMD_QUIT CMD_CHDIR CMD_BANK
 %token CMD_LOAD_LABELS CMD_SAVE_LABELS CMD_ADD_LABEL CMD_DEL_LABEL CMD_SHOW_LABELS CMD_CLEAR_LABELS
@@ -150,12 +153,12 @@ void set_yydebug(int val);
 %token CMD_BLOAD CMD_BSAVE CMD_SCREEN CMD_UNTIL CMD_CPU CMD_YYDEBUG
 %token CMD_BACKTRACE CMD_SCREENSHOT CMD_PWD CMD_DIR CMD_MKDIR CMD_RMDIR
 %token CMD_RESOURCE_GET CMD_RESOURCE_SET CMD_LOAD_RESOURCES CMD_SAVE_RESOURCES
-%token CMD_ATTACH CMD_DETACH CMD_MON_RESET CMD_TAPECTRL CMD_TAPEOFFS CMD_CARTFREEZE CMD_UPDB CMD_JPDB
-%token CMD_CPUHISTORY CMD_MEMMAPZAP CMD_MEMMAPSHOW CMD_MEMMAPSAVE
-%token CMD_COMMENT CMD_LIST CMD_STOPWATCH RESET
+%token CMD_ATTACH CMD_DETACH CMD_MON_RESET CMD_TAPECTRL CMD_TAPEOFFS CMD_TAPECOUNT CMD_CARTFREEZE CMD_UPDB CMD_JPDB
+%token CMD_CPUHISTORY CMD_CPUHISTORY_TRACE CMD_MEMMAPZAP CMD_MEMMAPSHOW CMD_MEMMAPSAVE
+%token CMD_COMMENT CMD_LIST CMD_STOPWATCH CMD_FRAMESTATS CMD_MEMREPORT RESET
 %token CMD_EXPORT CMD_AUTOSTART CMD_AUTOLOAD CMD_MAINCPU_TRACE
 %token CMD_WARP
-%token CMD_PROFILE FLAT GRAPH FUNC DEPTH DISASS PROFILE_CONTEXT CLEAR
+%token CMD_PROFILE FLAT GRAPH FUNC DEPTH DISASS PROFILE_CONTEXT CLEAR SAMPLE FOLDED PPROF
 %token<str> CMD_LABEL_ASGN
 %token<i> L_PAREN R_PAREN ARG_IMMEDIATE REG_A REG_X REG_Y COMMA INST_SEP
 %token<i> L_BRACKET R_BRACKET LESS_THAN REG_U REG_S REG_PC REG_PCR
@@ -259,12 +262,31 @@ machine_state_rules: CMD_BANK end_cmd
                      { mon_cpuhistory($3, $5, $7, $9, $11, e_invalid_space); }
                    | CMD_CPUHISTORY opt_sep d_number opt_sep memspace opt_sep memspace opt_sep memspace opt_sep memspace opt_sep memspace end_cmd
                      { mon_cpuhistory($3, $5, $7, $9, $11, $13); }
+                   | CMD_CPUHISTORY_TRACE end_cmd
+                     { mon_chistrace_status(); }
+                   | CMD_CPUHISTORY_TRACE STRING end_cmd
+                     { if (mon_chistrace_start($2) < 0) {
+                           mon_out("Cannot record the cpu history to `%s'.\n", $2);
+                       } else {
+                           mon_chistrace_status();
+                       }
+                       lib_free($2); }
+                   | CMD_CPUHISTORY_TRACE TOGGLE end_cmd
+                     { if ($2 == e_OFF) {
+                           mon_chistrace_stop();
+                       } else {
+                           mon_chistrace_status();
+                       } }
                    | CMD_RETURN end_cmd
                      { mon_instruction_return(); }
                    | CMD_DUMP filename end_cmd
                      { mon_write_snapshot($2,0,0,0); /* FIXME */ }
                    | CMD_UNDUMP filename end_cmd
                      { mon_read_snapshot($2, 0); }
+                   | CMD_REWIND end_cmd
+                     { mon_rewind(1); }
+                   | CMD_REWIND opt_sep expression end_cmd
+                     { mon_rewind($3); }
                    | CMD_STEP end_cmd
                      { mon_instructions_step(-1); }
                    | CMD_STEP opt_sep expression end_cmd
@@ -305,15 +327,9 @@ register_mod: CMD_REGISTERS end_cmd
             ;
 
 symbol_table_rules: CMD_LOAD_LABELS memspace opt_sep filename end_cmd
-                    {
-                        /* What about the memspace? */
-                        mon_playback_commands($4,true);
-                    }
+                    { mon_load_symbols($2, $4); }
                   | CMD_LOAD_LABELS filename end_cmd
-                    {
-                        /* What about the memspace? */
-                        mon_playback_commands($2,true);
-                    }
+                    { mon_load_symbols(e_default_space, $2); }
                   | CMD_SAVE_LABELS memspace opt_sep filename end_cmd
                     { mon_save_symbols($2, $4); }
                   | CMD_SAVE_LABELS filename end_cmd
@@ -591,6 +607,10 @@ monitor_misc_rules: CMD_DISK rest_of_line end_cmd
                     { mon_tape_offs(TAPEPORT_PORT_1, -1); }  /* FIXME: hardcoded to port 1 for now */
                   | CMD_TAPEOFFS opt_sep expression end_cmd
                     { mon_tape_offs(TAPEPORT_PORT_1, $3); }  /* FIXME: hardcoded to port 1 for now */
+                  | CMD_TAPECOUNT end_cmd
+                    { mon_tape_count(TAPEPORT_PORT_1, -1); }  /* FIXME: hardcoded to port 1 for now */
+                  | CMD_TAPECOUNT opt_sep expression end_cmd
+                    { mon_tape_count(TAPEPORT_PORT_1, $3); }  /* FIXME: hardcoded to port 1 for now */
                   | CMD_CARTFREEZE end_cmd
                     { mon_cart_freeze(); }
                   | CMD_UPDB number end_cmd
@@ -603,10 +623,18 @@ monitor_misc_rules: CMD_DISK rest_of_line end_cmd
                      { mon_stopwatch_reset(); }
                   | CMD_STOPWATCH end_cmd
                      { mon_stopwatch_show("Stopwatch: ", "\n"); }
+                  | CMD_FRAMESTATS RESET end_cmd
+                     { framestats_reset(); }
+                  | CMD_FRAMESTATS end_cmd
+                     { framestats_monitor_show(); }
+                  | CMD_MEMREPORT end_cmd
+                     { memusage_monitor_show(); }
                   | CMD_PROFILE TOGGLE end_cmd
                      { mon_profile_action($2); }
                   | CMD_PROFILE end_cmd
                      { mon_profile(); }
+                  | CMD_PROFILE SAMPLE opt_d_number end_cmd
+                     { mon_profile_sample($3); }
                   | CMD_PROFILE FLAT opt_d_number end_cmd
                      { mon_profile_flat($3); }
                   | CMD_PROFILE GRAPH opt_context_num end_cmd
@@ -621,6 +649,10 @@ monitor_misc_rules: CMD_DISK rest_of_line end_cmd
                      { mon_profile_clear($3); }
                   | CMD_PROFILE PROFILE_CONTEXT d_number end_cmd
                      { mon_profile_disass_context($3); }
+                  | CMD_PROFILE FOLDED STRING end_cmd
+                     { mon_profile_export(PROFILE_EXPORT_FOLDED, $3); lib_free($3); }
+                  | CMD_PROFILE PPROF STRING end_cmd
+                     { mon_profile_export(PROFILE_EXPORT_PPROF, $3); lib_free($3); }
                   ;
 
 disk_rules: CMD_LOAD filename device_num opt_address end_cmd
@@ -35,6 +35,7 @@
 #include "mon_profile.h"
 #include "profiler.h"
 #include "profiler_data.h"
+#include "util.h"
 
 const int min_label_width = 15;
 static void print_disass_context(profiling_context_t *context, bool print_subcontexts);
@@ -58,6 +59,9 @@ void mon_profile(void)
 {
     if (maincpu_profiling) {
         mon_out("Profiling running.\n");
+    } else if (profile_sample_interval()) {
+        mon_out("Sampling profiler running, one sample every %u cycles.\n",
+                profile_sample_interval());
     } else if (!root_context) {
         mon_out("Profiling not started.\n");
     } else {
@@ -70,7 +74,7 @@ void mon_profile_action(ACTION action)
 {
     switch(action) {
     case e_OFF: {
-        if (maincpu_profiling) {
+        if (maincpu_profiling || profile_sample_interval()) {
             profile_stop();
             mon_out("Profiling stopped.\n");
         } else {
@@ -79,8 +83,10 @@ void mon_profile_action(ACTION action)
         return;
     }
     case e_ON: {
+        bool running = maincpu_profiling || profile_sample_interval();
+
         profile_start();
-        if (maincpu_profiling) {
+        if (running) {
             mon_out("Profiling restarted.\n");
         } else {
             mon_out("Profiling started.\n");
@@ -88,7 +94,7 @@ void mon_profile_action(ACTION action)
         return;
     }
     case e_TOGGLE: {
-        if (maincpu_profiling) {
+        if (maincpu_profiling || profile_sample_interval()) {
             mon_profile_action(e_OFF);
         } else {
             mon_profile_action(e_ON);
@@ -98,6 +104,15 @@ void mon_profile_action(ACTION action)
     }
 }
 
+void mon_profile_sample(int interval)
+{
+    if (interval <= 0) {
+        interval = 1000;
+    }
+    profile_start_sampling((unsigned int)interval);
+    mon_out("Sampling profiler started, one sample every %d cycles.\n", interval);
+}
+
 static bool init_profiling_data(void) {
     if (!root_context) {
         mon_out("No profiling data available. Start profiling with \"prof on\".\n");
@@ -1139,3 +1154,397 @@ void mon_profile_clear(MON_ADDR function)
     clear_recursively(root_context, addr);
 }
 
+/* ------------------------------------------------------------------------- */
+
+/* Export to other tools.  Frames are named like in the reports: the label
+ * or address of the function, prefixed by the interrupt for interrupt
+ * handlers, and followed by the memory configuration in braces. */
+
+static profiling_counter_t context_self_cycles(profiling_context_t *context) {
+    profiling_counter_t cycles = 0;
+    int i, j;
+
+    for (i = 0; i < 256; i++) {
+        if (context->page[i]) {
+            for (j = 0; j < 256; j++) {
+                cycles += context->page[i]->data[j].num_cycles;
+            }
+        }
+    }
+    return cycles;
+}
+
+static const char *interrupt_name(uint16_t src) {
+    switch(src) {
+    case 0xfffa: return "NMI";
+    case 0xfffc: return "RST";
+    case 0xfffe: return "IRQ";
+    default:     return NULL;
+    }
+}
+
+static char *function_name(uint16_t dst) {
+    char *name = mon_symbol_table_lookup_name(default_memspace, dst);
+
+    return name ? lib_strdup(name) : lib_msprintf("%04x", dst);
+}
+
+static char *frame_name(profiling_context_t *context, uint16_t memory_config) {
+    const char *irq = interrupt_name(context->pc_src);
+    char *name, *frame;
+
+    if (context->parent == NULL) {
+        return lib_msprintf("ROOT {%u}", memory_config);
+    }
+    name = function_name(context->pc_dst);
+    frame = lib_msprintf("%s%s%s {%u}", irq ? irq : "", irq ? " " : "",
+                         name, memory_config);
+    lib_free(name);
+    return frame;
+}
+
+static void export_folded_context(FILE *fp, profiling_context_t *context, const char *stack) {
+    profiling_context_t *c;
+    char *frame;
+    char *path;
+
+    for (c = context; c; c = c->next_mem_config) {
+        profiling_counter_t cycles = context_self_cycles(c);
+
+        if (cycles) {
+            frame = frame_name(context, c->memory_bank_config);
+            fprintf(fp, "%s%s%s %u\n", stack ? stack : "", stack ? ";" : "",
+                    frame, cycles);
+            lib_free(frame);
+        }
+    }
+
+    if (!context->child) {
+        return;
+    }
+
+    frame = frame_name(context, context->memory_bank_config);
+    path = stack ? util_concat(stack, ";", frame, NULL) : lib_strdup(frame);
+    lib_free(frame);
+
+    c = context->child;
+    do {
+        export_folded_context(fp, c, path);
+        c = c->next;
+    } while (c != context->child);
+
+    lib_free(path);
+}
+
+/* Minimal protobuf writer for the pprof profile.proto format.  */
+
+typedef struct pb_buf_s {
+    uint8_t *data;
+    size_t len;
+    size_t size;
+} pb_buf_t;
+
+static void pb_put(pb_buf_t *b, const void *p, size_t n) {
+    if (b->len + n > b->size) {
+        while (b->len + n > b->size) {
+            b->size = b->size ? b->size * 2 : 256;
+        }
+        b->data = lib_realloc(b->data, b->size);
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void pb_varint(pb_buf_t *b, uint64_t v) {
+    uint8_t out[10];
+    size_t n = 0;
+
+    do {
+        out[n] = v & 0x7f;
+        v >>= 7;
+        if (v) {
+            out[n] |= 0x80;
+        }
+        n++;
+    } while (v);
+    pb_put(b, out, n);
+}
+
+static void pb_field_varint(pb_buf_t *b, int field, uint64_t v) {
+    pb_varint(b, (uint64_t)field << 3);
+    pb_varint(b, v);
+}
+
+static void pb_field_bytes(pb_buf_t *b, int field, const void *p, size_t n) {
+    pb_varint(b, ((uint64_t)field << 3) | 2);
+    pb_varint(b, n);
+    pb_put(b, p, n);
+}
+
+/* append `msg' as field `field' of `b' and empty it for reuse */
+static void pb_field_msg(pb_buf_t *b, int field, pb_buf_t *msg) {
+    pb_field_bytes(b, field, msg->data, msg->len);
+    msg->len = 0;
+}
+
+/* function keys: callee address, or one of these */
+#define PPROF_FUNC_ROOT    0x10000
+#define PPROF_FUNC_NMI      0x10001
+#define PPROF_FUNC_RST      0x10002
+#define PPROF_FUNC_IRQ      0x10003
+#define PPROF_NUM_FUNCS     0x10004
+
+typedef struct pprof_export_s {
+    pb_buf_t out;           /* Profile message (samples so far) */
+    pb_buf_t msg;           /* scratch for submessages */
+    pb_buf_t sub;           /* scratch for nested submessages */
+    char **strings;
+    int num_strings;
+    int strings_size;
+    int *func_ids;          /* indexed by function key, 0 = none yet */
+    int num_funcs;
+    uint64_t *loc_keys;     /* open addressing, 0 = free */
+    int *loc_ids;
+    int loc_size;
+    int num_locs;
+    uint64_t *stack;        /* location ids of the current sample */
+    int stack_size;
+} pprof_export_t;
+
+static int pprof_string(pprof_export_t *e, char *s) {
+    if (e->num_strings == e->strings_size) {
+        e->strings_size = e->strings_size ? e->strings_size * 2 : 64;
+        e->strings = lib_realloc(e->strings, e->strings_size * sizeof(char *));
+    }
+    e->strings[e->num_strings] = s;
+    return e->num_strings++;
+}
+
+static int pprof_function(pprof_export_t *e, int key) {
+    if (!e->func_ids[key]) {
+        e->func_ids[key] = ++e->num_funcs;
+    }
+    return e->func_ids[key];
+}
+
+static void pprof_grow_locations(pprof_export_t *e);
+
+/* location of `address' in the function with key `func' */
+static int pprof_location(pprof_export_t *e, int func, uint16_t address) {
+    uint64_t key = ((uint64_t)func << 16 | address) + 1;
+    int i;
+
+    if (e->num_locs * 2 >= e->loc_size) {
+        pprof_grow_locations(e);
+    }
+
+    i = (int)((key * 0x9e3779b97f4a7c15ULL) >> 40) & (e->loc_size - 1);
+    while (e->loc_keys[i] && e->loc_keys[i] != key) {
+        i = (i + 1) & (e->loc_size - 1);
+    }
+    if (!e->loc_keys[i]) {
+        e->loc_keys[i] = key;
+        e->loc_ids[i] = ++e->num_locs;
+    }
+    return e->loc_ids[i];
+}
+
+static void pprof_grow_locations(pprof_export_t *e) {
+    uint64_t *keys = e->loc_keys;
+    int *ids = e->loc_ids;
+    int size = e->loc_size;
+    int i;
+
+    e->loc_size = size ? size * 2 : 4096;
+    e->loc_keys = lib_calloc(e->loc_size, sizeof(uint64_t));
+    e->loc_ids = lib_calloc(e->loc_size, sizeof(int));
+
+    for (i = 0; i < size; i++) {
+        if (keys[i]) {
+            int j = (int)((keys[i] * 0x9e3779b97f4a7c15ULL) >> 40) & (e->loc_size - 1);
+
+            while (e->loc_keys[j]) {
+                j = (j + 1) & (e->loc_size - 1);
+            }
+            e->loc_keys[j] = keys[i];
+            e->loc_ids[j] = ids[i];
+        }
+    }
+    lib_free(keys);
+    lib_free(ids);
+}
+
+static int context_function(profiling_context_t *context) {
+    return context->parent ? context->pc_dst : PPROF_FUNC_ROOT;
+}
+
+/* locations of the callers of `context', innermost first.  An interrupt
+ * handler is shown as called from its vector, which in turn is called from
+ * the entry of the interrupted function. */
+static int pprof_caller_stack(pprof_export_t *e, profiling_context_t *context, uint64_t *stack) {
+    int n = 0;
+
+    for (; context->parent; context = context->parent) {
+        uint16_t src = context->pc_src;
+        int parent_func = context_function(context->parent);
+
+        if (is_interrupt(src)) {
+            stack[n++] = pprof_location(e, PPROF_FUNC_NMI + (src - 0xfffa) / 2, src);
+            stack[n++] = pprof_location(e, parent_func, context->parent->pc_dst);
+        } else {
+            stack[n++] = pprof_location(e, parent_func, (uint16_t)(src - 2));
+        }
+    }
+    return n;
+}
+
+static void pprof_export_context(pprof_export_t *e, profiling_context_t *context, int depth) {
+    profiling_context_t *c;
+    int num_callers;
+    int func = context_function(context);
+    int i, j, k;
+
+    if (2 * depth + 1 > e->stack_size) {
+        e->stack_size = (2 * depth + 1) * 2;
+        e->stack = lib_realloc(e->stack, e->stack_size * sizeof(uint64_t));
+    }
+    num_callers = pprof_caller_stack(e, context, e->stack + 1);
+
+    for (c = context; c; c = c->next_mem_config) {
+        for (i = 0; i < 256; i++) {
+            if (!c->page[i]) {
+                continue;
+            }
+            for (j = 0; j < 256; j++) {
+                profiling_data_t *data = &c->page[i]->data[j];
+
+                if (data->num_samples == 0 && data->num_cycles == 0) {
+                    continue;
+                }
+                e->stack[0] = pprof_location(e, func, (uint16_t)(i << 8 | j));
+
+                for (k = 0; k <= num_callers; k++) {
+                    pb_varint(&e->sub, e->stack[k]);
+                }
+                pb_field_msg(&e->msg, 1, &e->sub);              /* location_id */
+                pb_varint(&e->sub, data->num_samples);
+                pb_varint(&e->sub, data->num_cycles);
+                pb_field_msg(&e->msg, 2, &e->sub);              /* value */
+                pb_field_varint(&e->sub, 1, 1);                 /* label.key */
+                pb_field_varint(&e->sub, 3, c->memory_bank_config); /* label.num */
+                pb_field_msg(&e->msg, 3, &e->sub);              /* label */
+                pb_field_msg(&e->out, 2, &e->msg);              /* sample */
+            }
+        }
+    }
+
+    if (context->child) {
+        c = context->child;
+        do {
+            pprof_export_context(e, c, depth + 1);
+            c = c->next;
+        } while (c != context->child);
+    }
+}
+
+static void pprof_value_type(pprof_export_t *e, int field, int type, int unit) {
+    pb_field_varint(&e->msg, 1, type);
+    pb_field_varint(&e->msg, 2, unit);
+    pb_field_msg(&e->out, field, &e->msg);
+}
+
+static void export_pprof(FILE *fp) {
+    pprof_export_t e;
+    int s_samples, s_cycles, s_count;
+    int key, i;
+
+    memset(&e, 0, sizeof(e));
+    e.func_ids = lib_calloc(PPROF_NUM_FUNCS, sizeof(int));
+
+    pprof_string(&e, lib_strdup(""));
+    pprof_string(&e, lib_strdup("memory config"));  /* must be index 1 */
+    s_samples = pprof_string(&e, lib_strdup("samples"));
+    s_cycles = pprof_string(&e, lib_strdup("cycles"));
+    s_count = pprof_string(&e, lib_strdup("count"));
+
+    pprof_value_type(&e, 1, s_samples, s_count);    /* sample_type */
+    pprof_value_type(&e, 1, s_cycles, s_count);
+    pprof_value_type(&e, 11, s_cycles, s_count);    /* period_type */
+    pb_field_varint(&e.out, 12, profile_sample_interval() ? profile_sample_interval() : 1);
+
+    pprof_export_context(&e, root_context, 0);
+
+    /* locations */
+    for (i = 0; i < e.loc_size; i++) {
+        if (e.loc_keys[i]) {
+            uint64_t loc = e.loc_keys[i] - 1;
+
+            pb_field_varint(&e.msg, 1, e.loc_ids[i]);                  /* id */
+            pb_field_varint(&e.msg, 3, loc & 0xffff);                  /* address */
+            pb_field_varint(&e.sub, 1, pprof_function(&e, (int)(loc >> 16))); /* line.function_id */
+            pb_field_msg(&e.msg, 4, &e.sub);                           /* line */
+            pb_field_msg(&e.out, 4, &e.msg);
+        }
+    }
+
+    /* functions; the names are added to the string table here */
+    for (key = 0; key < PPROF_NUM_FUNCS; key++) {
+        if (e.func_ids[key]) {
+            char *name;
+            int s;
+
+            switch (key) {
+            case PPROF_FUNC_ROOT: name = lib_strdup("ROOT"); break;
+            case PPROF_FUNC_NMI:   name = lib_strdup("NMI"); break;
+            case PPROF_FUNC_RST:   name = lib_strdup("RST"); break;
+            case PPROF_FUNC_IRQ:   name = lib_strdup("IRQ"); break;
+            default:               name = function_name((uint16_t)key); break;
+            }
+            s = pprof_string(&e, name);
+            pb_field_varint(&e.msg, 1, e.func_ids[key]);    /* id */
+            pb_field_varint(&e.msg, 2, s);                  /* name */
+            pb_field_varint(&e.msg, 3, s);                  /* system_name */
+            pb_field_msg(&e.out, 5, &e.msg);
+        }
+    }
+
+    for (i = 0; i < e.num_strings; i++) {
+        pb_field_bytes(&e.out, 6, e.strings[i], strlen(e.strings[i]));
+        lib_free(e.strings[i]);
+    }
+
+    if (fwrite(e.out.data, 1, e.out.len, fp) != e.out.len) {
+        mon_out("Write error.\n");
+    }
+
+    lib_free(e.strings);
+    lib_free(e.func_ids);
+    lib_free(e.loc_keys);
+    lib_free(e.loc_ids);
+    lib_free(e.stack);
+    lib_free(e.out.data);
+    lib_free(e.msg.data);
+    lib_free(e.sub.data);
+}
+
+void mon_profile_export(int format, const char *filename)
+{
+    FILE *fp;
+
+    if (!init_profiling_data()) return;
+
+    fp = fopen(filename, MODE_WRITE);
+    if (fp == NULL) {
+        mon_out("Saving for `%s' failed.\n", filename);
+        return;
+    }
+
+    if (format == PROFILE_EXPORT_PPROF) {
+        export_pprof(fp);
+    } else {
+        export_folded_context(fp, root_context, NULL);
+    }
+
+    fclose(fp);
+    mon_out("Profile written to `%s'.\n", filename);
+}
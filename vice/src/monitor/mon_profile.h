@@ -28,14 +28,21 @@
 #define VICE_MON_PROFILE_H
 #include "montypes.h"
 
+enum {
+    PROFILE_EXPORT_FOLDED,  /* folded stacks, as read by flamegraph.pl */
+    PROFILE_EXPORT_PPROF    /* uncompressed pprof profile.proto */
+};
+
 /* monitor commands */
 void mon_profile(void);
 void mon_profile_action(ACTION action); /* on|off|toggle */
+void mon_profile_sample(int interval);
 void mon_profile_flat(int num);
 void mon_profile_graph(int context_id, int depth);
 void mon_profile_func(MON_ADDR function);
 void mon_profile_disass(MON_ADDR function);
 void mon_profile_clear(MON_ADDR function);
 void mon_profile_disass_context(int context_id);
+void mon_profile_export(int format, const char *filename);
 
 #endif /* VICE_MON_PROFILE_H */
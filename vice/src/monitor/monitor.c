@@ -63,6 +63,7 @@
 #include "machine-video.h"
 #include "mem.h"
 #include "mon_breakpoint.h"
+#include "mon_chistrace.h"
 #include "mon_disassemble.h"
 #include "mon_memmap.h"
 #include "mon_memory.h"
@@ -74,15 +75,19 @@
 #include "monitor.h"
 #include "monitor_network.h"
 #include "monitor_binary.h"
+#include "monitor_shm.h"
 #include "montypes.h"
+#include "mos6510.h"
 
 #include "userport_io_sim.h"
 #include "joyport_io_sim.h"
 #include "joyport.h"
 
 #include "resources.h"
+#include "rewind.h"
 #include "screenshot.h"
 #include "sysfile.h"
+#include "tap.h"
 #include "tape.h"
 #include "traps.h"
 #include "types.h"
@@ -116,8 +121,9 @@ static int init_break_address = -1;
 
 #define MAX_LABEL_LEN 255
 #define MAX_MEMSPACE_NAME_LEN 10
-#define HASH_ARRAY_SIZE 256
-#define HASH_ADDR(x) ((x) % 0xff)
+#define HASH_ARRAY_SIZE 1024
+#define HASH_ADDR(x) ((x) & (HASH_ARRAY_SIZE - 1))
+#define NAME_HASH_MIN_SIZE 256
 #define OP_JSR 0x20
 #define OP_RTI 0x40
 #define OP_RTS 0x60
@@ -140,12 +146,18 @@ struct symbol_entry {
     uint16_t addr;
     char *name;
     struct symbol_entry *next;
+    struct symbol_entry *prev;      /* name list only */
+    struct symbol_entry *name_next; /* name hash chain, name list entries only */
 };
 typedef struct symbol_entry symbol_entry_t;
 
 struct symbol_table {
     symbol_entry_t *name_list;
     symbol_entry_t *addr_hash_table[HASH_ARRAY_SIZE];
+    /* Index of the name list entries by name, grown as labels are added */
+    symbol_entry_t **name_hash_table;
+    unsigned int name_hash_size;
+    unsigned int name_count;
 };
 typedef struct symbol_table symbol_table_t;
 
@@ -170,6 +182,7 @@ int sidefx = 0;
 int break_on_dummy_access = 0;
 RADIXTYPE default_radix;
 MEMSPACE default_memspace = e_comp_space;
+unsigned int mon_symbol_table_serial = 0;
 static bool inside_monitor = false;
 static bool should_pause_on_exit_mon = false;
 static bool pause_on_exit_mon = false;
@@ -395,8 +408,11 @@ void monitor_vsync_hook(void)
 #ifdef HAVE_NETWORK
     /* check if someone wants to connect remotely to the monitor */
     monitor_check_remote();
+    monitor_binary_vsync_hook();
     monitor_check_binary();
 #endif
+
+    monitor_shm_vsync_hook();
 }
 
 /* Some local helper functions */
@@ -907,10 +923,35 @@ uint8_t mon_get_mem_val_nosfx(MEMSPACE mem, uint16_t mem_config, uint16_t mem_ad
     return mon_get_mem_val_ex_nosfx(mem, mon_interfaces[mem]->current_bank, mem_addr);
 }
 
+/* Read `end' + 1 bytes from `start' on.  Plain memory is copied in one go
+   when the memspace can tell where it is, everything else is read byte by
+   byte.  */
 void mon_get_mem_block_ex(MEMSPACE mem, int bank, uint16_t start, uint16_t end, uint8_t *data)
 {
-    int i;
-    for (i = 0; i <= end; i++) {
+    monitor_interface_t *mi = mon_interfaces[mem];
+    unsigned int count = (unsigned int)end + 1;
+    unsigned int i = 0;
+
+    if ((sidefx == 0) && (mi->mem_bank_base != NULL) && (monitor_diskspace_dnr(mem) < 0)) {
+        while (i < count) {
+            unsigned int len;
+            uint8_t *p = mi->mem_bank_base(bank, (uint16_t)(start + i), &len, mi->context);
+
+            if (p == NULL) {
+                data[i] = mon_get_mem_val_ex(mem, bank, (uint16_t)(start + i));
+                i++;
+                continue;
+            }
+            if (len > count - i) {
+                len = count - i;
+            }
+            memcpy(data + i, p, len);
+            i += len;
+        }
+        return;
+    }
+
+    for (; i < count; i++) {
         data[i] = mon_get_mem_val_ex(mem, bank, (uint16_t)(start + i));
     }
 }
@@ -977,6 +1018,43 @@ void mon_set_mem_val_ex(MEMSPACE mem, int bank, uint16_t mem_addr, uint8_t val)
     }
 }
 
+/* Set `mem_start' to `mem_end' (inclusive) of the current bank to `data',
+   like mon_set_mem_val() for each byte.  Runs of plain memory are copied at
+   once when the memspace offers them.  */
+void mon_set_mem_block(MEMSPACE mem, uint16_t mem_start, uint16_t mem_end, const uint8_t *data)
+{
+    monitor_interface_t *mi = mon_interfaces[mem];
+    int bank = mi->current_bank;
+    unsigned int count = (unsigned int)mem_end - mem_start + 1;
+    unsigned int i = 0;
+
+    if (monitor_diskspace_dnr(mem) >= 0) {
+        if (!check_drive_emu_level_ok(monitor_diskspace_dnr(mem) + 8)) {
+            return;
+        }
+    }
+
+    if ((sidefx == 0) && (mi->mem_bank_write_base != NULL) && (monitor_diskspace_dnr(mem) < 0)) {
+        while (i < count) {
+            unsigned int len = count - i;
+            uint8_t *p = mi->mem_bank_write_base(bank, (uint16_t)(mem_start + i), &len, mi->context);
+
+            if (p == NULL) {
+                mon_set_mem_val(mem, (uint16_t)(mem_start + i), data[i]);
+                i++;
+                continue;
+            }
+            memcpy(p, data + i, len);
+            i += len;
+        }
+        return;
+    }
+
+    for (; i < count; i++) {
+        mon_set_mem_val(mem, (uint16_t)(mem_start + i), data[i]);
+    }
+}
+
 /* exit monitor  */
 void mon_jump(MON_ADDR addr)
 {
@@ -1353,6 +1431,24 @@ void mon_tape_offs(int port, int offset)
     }
 }
 
+void mon_tape_count(int port, int counter)
+{
+    tape_image_t *tape_image = tape_image_dev[port];
+
+    if (tape_image && tape_image->data && tape_image->type == TAPE_TYPE_TAP) {
+        if (counter < 0) {
+            mon_out("Current tape counter is: %03d\n",
+                    ((tap_t *)tape_image->data)->counter);
+        } else if (datasette_seek_counter(port, counter) < 0) {
+            mon_out("Cannot wind the tape to %03d.\n", counter);
+        } else {
+            mon_out("Tape wound to counter %03d.\n", counter);
+        }
+    } else {
+        mon_out("No tap file attached.\n");
+    }
+}
+
 void mon_cart_freeze(void)
 {
     if (mon_cart_cmd.cartridge_trigger_freeze != NULL) {
@@ -1586,6 +1682,9 @@ void monitor_init(monitor_interface_t *maincpu_interface_init,
         for (j = 0; j < HASH_ARRAY_SIZE; j++) {
             monitor_labels[i].addr_hash_table[j] = NULL;
         }
+        monitor_labels[i].name_hash_table = NULL;
+        monitor_labels[i].name_hash_size = 0;
+        monitor_labels[i].name_count = 0;
     }
 
     default_memspace = e_comp_space;
@@ -1657,6 +1756,7 @@ void monitor_shutdown(void)
     }
 
     mon_memmap_shutdown();
+    mon_disassemble_cache_shutdown();
 
     while (playback_fp_stack_size) {
         playback_end_file();
@@ -1755,6 +1855,14 @@ static int set_monitor_log_enabled(int val, void *param)
 }
 
 #ifdef FEATURE_CPUMEMHISTORY
+static int monitorchisenabled = 0;
+static int set_monitor_chis_enabled(int val, void *param)
+{
+    monitorchisenabled = val ? 1 : 0;
+    mon_cpuhistory_enable(MON_CPUHISTORY_RESOURCE, monitorchisenabled);
+    return 0;
+}
+
 static int monitorchislines = 0;
 static int set_monitor_chis_lines(int val, void *param)
 {
@@ -1765,6 +1873,11 @@ static int set_monitor_chis_lines(int val, void *param)
     monitorchislines = val;
     return monitor_cpuhistory_allocate(val);
 }
+
+static int monitor_set_chistrace_file(const char *param, void *extra_param)
+{
+    return mon_chistrace_start(param) < 0 ? -1 : 0;
+}
 #endif
 
 static int monitorscrollbacklines = 0;
@@ -1794,6 +1907,8 @@ static const resource_int_t resources_int[] = {
     { "MonitorLogEnabled", 0, RES_EVENT_NO, NULL,
       &monitorlogenabled, set_monitor_log_enabled, NULL },
 #ifdef FEATURE_CPUMEMHISTORY
+    { "MonitorChisEnabled", 0, RES_EVENT_NO, NULL,
+      &monitorchisenabled, set_monitor_chis_enabled, NULL },
     { "MonitorChisLines", 8192, RES_EVENT_NO, NULL,
       &monitorchislines, set_monitor_chis_lines, NULL },
 #endif
@@ -1855,9 +1970,18 @@ static const cmdline_option_t cmdline_options[] =
       NULL, NULL, "MonitorScrollbackLines", NULL,
       "<value>", "Set number of lines to keep in the monitor scrollback buffer" },
 #ifdef FEATURE_CPUMEMHISTORY
+    { "-monchis", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorChisEnabled", (resource_value_t)1,
+      NULL, "Collect the cpu history and memmap from startup" },
+    { "+monchis", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MonitorChisEnabled", (resource_value_t)0,
+      NULL, "Collect the cpu history and memmap only once the monitor was opened" },
     { "-monchislines", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "MonitorChisLines", NULL,
       "<value>", "Set number of lines to keep in the cpu history" },
+    { "-chistrace", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      monitor_set_chistrace_file, NULL, NULL, NULL,
+      "<Name>", "Record the cpu history to a compressed trace file" },
 #endif
     CMDLINE_LIST_END
 };
@@ -2323,6 +2447,8 @@ static void free_symbol_table(MEMSPACE mem)
         sym_ptr = sym_ptr->next;
         lib_free(temp);
     }
+    monitor_labels[mem].name_list = NULL;
+    mon_symbol_table_serial++;
 
     /* Remove address hash table */
     for (i = 0; i < HASH_ARRAY_SIZE; i++) {
@@ -2333,6 +2459,156 @@ static void free_symbol_table(MEMSPACE mem)
             sym_ptr = sym_ptr->next;
             lib_free(temp);
         }
+        monitor_labels[mem].addr_hash_table[i] = NULL;
+    }
+
+    /* Remove name index */
+    lib_free(monitor_labels[mem].name_hash_table);
+    monitor_labels[mem].name_hash_table = NULL;
+    monitor_labels[mem].name_hash_size = 0;
+    monitor_labels[mem].name_count = 0;
+}
+
+static unsigned int name_hash(const char *name)
+{
+    unsigned int hash = 2166136261U;
+
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619U;
+    }
+    return hash;
+}
+
+/* find the name list entry of a label, or NULL */
+static symbol_entry_t *name_lookup(MEMSPACE mem, const char *name)
+{
+    symbol_table_t *table = &monitor_labels[mem];
+    symbol_entry_t *sym_ptr;
+
+    if (table->name_hash_table == NULL) {
+        return NULL;
+    }
+
+    sym_ptr = table->name_hash_table[name_hash(name) & (table->name_hash_size - 1)];
+    while (sym_ptr) {
+        if (strcmp(sym_ptr->name, name) == 0) {
+            return sym_ptr;
+        }
+        sym_ptr = sym_ptr->name_next;
+    }
+    return NULL;
+}
+
+/* double the name index once it holds as many labels as it has buckets */
+static void name_hash_grow(MEMSPACE mem)
+{
+    symbol_table_t *table = &monitor_labels[mem];
+    symbol_entry_t *sym_ptr;
+    unsigned int bucket;
+
+    if (table->name_count < table->name_hash_size) {
+        return;
+    }
+
+    table->name_hash_size = table->name_hash_size ? table->name_hash_size * 2 : NAME_HASH_MIN_SIZE;
+    lib_free(table->name_hash_table);
+    table->name_hash_table = lib_calloc(table->name_hash_size, sizeof(symbol_entry_t *));
+
+    for (sym_ptr = table->name_list; sym_ptr; sym_ptr = sym_ptr->next) {
+        bucket = name_hash(sym_ptr->name) & (table->name_hash_size - 1);
+        sym_ptr->name_next = table->name_hash_table[bucket];
+        table->name_hash_table[bucket] = sym_ptr;
+    }
+}
+
+/* add a label without checking for duplicates, the table takes over name */
+static void add_symbol(MEMSPACE mem, uint16_t loc, char *name)
+{
+    symbol_table_t *table = &monitor_labels[mem];
+    symbol_entry_t *sym_ptr;
+    unsigned int bucket;
+
+    mon_symbol_table_serial++;
+
+    /* Add name to name list */
+    sym_ptr = lib_malloc(sizeof(symbol_entry_t));
+    sym_ptr->name = name;
+    sym_ptr->addr = loc;
+
+    sym_ptr->prev = NULL;
+    sym_ptr->next = table->name_list;
+    if (table->name_list) {
+        table->name_list->prev = sym_ptr;
+    }
+    table->name_list = sym_ptr;
+
+    /* Add name to name index */
+    table->name_count++;
+    bucket = name_hash(name) & (table->name_hash_size - 1);
+    if (table->name_hash_table) {
+        sym_ptr->name_next = table->name_hash_table[bucket];
+        table->name_hash_table[bucket] = sym_ptr;
+    }
+    /* rehashing also adds the new entry */
+    name_hash_grow(mem);
+
+    /* Add address to hash table */
+    sym_ptr = lib_malloc(sizeof(symbol_entry_t));
+    sym_ptr->name = name;
+    sym_ptr->addr = loc;
+    sym_ptr->prev = NULL;
+    sym_ptr->name_next = NULL;
+
+    sym_ptr->next = table->addr_hash_table[HASH_ADDR(loc)];
+    table->addr_hash_table[HASH_ADDR(loc)] = sym_ptr;
+}
+
+/* remove a label given its name list entry */
+static void remove_symbol(MEMSPACE mem, symbol_entry_t *entry)
+{
+    symbol_table_t *table = &monitor_labels[mem];
+    symbol_entry_t *sym_ptr, *prev_ptr;
+    symbol_entry_t **link;
+    uint16_t addr = entry->addr;
+    char *name = entry->name;
+
+    mon_symbol_table_serial++;
+
+    /* Remove entry in name index */
+    link = &table->name_hash_table[name_hash(name) & (table->name_hash_size - 1)];
+    while (*link != entry) {
+        link = &(*link)->name_next;
+    }
+    *link = entry->name_next;
+    table->name_count--;
+
+    /* Remove entry in name list, name memory is freed below. */
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        table->name_list = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    lib_free(entry);
+
+    /* Remove entry in address hash table */
+    sym_ptr = table->addr_hash_table[HASH_ADDR(addr)];
+    prev_ptr = NULL;
+    while (sym_ptr) {
+        if (sym_ptr->name == name) {
+            lib_free(sym_ptr->name);
+            if (prev_ptr) {
+                prev_ptr->next = sym_ptr->next;
+            } else {
+                table->addr_hash_table[HASH_ADDR(addr)] = sym_ptr->next;
+            }
+            lib_free(sym_ptr);
+            return;
+        }
+        prev_ptr = sym_ptr;
+        sym_ptr = sym_ptr->next;
     }
 }
 
@@ -2370,12 +2646,9 @@ int mon_symbol_table_lookup_addr(MEMSPACE mem, char *name)
         return mon_register_name_to_value(mem, &name[1]);
     }
 
-    sym_ptr = monitor_labels[mem].name_list;
-    while (sym_ptr) {
-        if (strcmp(sym_ptr->name, name) == 0) {
-            return sym_ptr->addr;
-        }
-        sym_ptr = sym_ptr->next;
+    sym_ptr = name_lookup(mem, name);
+    if (sym_ptr) {
+        return sym_ptr->addr;
     }
 
     return -1;
@@ -2392,7 +2665,7 @@ char * mon_prepend_dot_to_name(char *name)
 
 void mon_add_name_to_symbol_table(MON_ADDR addr, char *name)
 {
-    symbol_entry_t *sym_ptr;
+    symbol_entry_t *old_entry;
     char *old_name;
     int old_addr;
     MEMSPACE mem = addr_memspace(addr);
@@ -2411,39 +2684,25 @@ void mon_add_name_to_symbol_table(MON_ADDR addr, char *name)
     }
 
     old_name = mon_symbol_table_lookup_name(mem, loc);
-    old_addr = mon_symbol_table_lookup_addr(mem, name);
+    old_entry = name_lookup(mem, name);
+    old_addr = old_entry ? old_entry->addr : -1;
     if ((old_name && (MON_ADDR)addr_location(old_addr) != addr) && (!silent)) {
         mon_out("Warning: label(s) for address $%04x already exist.\n", loc);
     }
-    if (old_addr >= 0) {
+    if (old_entry) {
         if ((old_addr != loc) && (!silent)) {
             mon_out("Changing address of label %s from $%04x to $%04x\n",
                     name, (unsigned int)old_addr, loc);
         }
-        mon_remove_name_from_symbol_table(mem, name);
+        remove_symbol(mem, old_entry);
     }
 
-    /* Add name to name list */
-    sym_ptr = lib_malloc(sizeof(symbol_entry_t));
-    sym_ptr->name = name;
-    sym_ptr->addr = loc;
-
-    sym_ptr->next = monitor_labels[mem].name_list;
-    monitor_labels[mem].name_list = sym_ptr;
-
-    /* Add address to hash table */
-    sym_ptr = lib_malloc(sizeof(symbol_entry_t));
-    sym_ptr->name = name;
-    sym_ptr->addr = addr;
-
-    sym_ptr->next = monitor_labels[mem].addr_hash_table[HASH_ADDR(loc)];
-    monitor_labels[mem].addr_hash_table[HASH_ADDR(loc)] = sym_ptr;
+    add_symbol(mem, loc, name);
 }
 
 void mon_remove_name_from_symbol_table(MEMSPACE mem, char *name)
 {
-    int addr;
-    symbol_entry_t *sym_ptr, *prev_ptr;
+    symbol_entry_t *sym_ptr;
 
     if (mem == e_default_space) {
         mem = default_memspace;
@@ -2455,47 +2714,12 @@ void mon_remove_name_from_symbol_table(MEMSPACE mem, char *name)
         return;
     }
 
-    if ((addr = mon_symbol_table_lookup_addr(mem, name)) < 0) {
+    if ((sym_ptr = name_lookup(mem, name)) == NULL) {
         mon_out("Symbol %s not found.\n", name);
         return;
     }
 
-    /* Remove entry in name list */
-    sym_ptr = monitor_labels[mem].name_list;
-    prev_ptr = NULL;
-    while (sym_ptr) {
-        if (strcmp(sym_ptr->name, name) == 0) {
-            /* Name memory is freed below. */
-            addr = sym_ptr->addr;
-            if (prev_ptr) {
-                prev_ptr->next = sym_ptr->next;
-            } else {
-                monitor_labels[mem].name_list = sym_ptr->next;
-            }
-            lib_free(sym_ptr);
-            break;
-        }
-        prev_ptr = sym_ptr;
-        sym_ptr = sym_ptr->next;
-    }
-
-    /* Remove entry in address hash table */
-    sym_ptr = monitor_labels[mem].addr_hash_table[HASH_ADDR(addr)];
-    prev_ptr = NULL;
-    while (sym_ptr) {
-        if ((addr == sym_ptr->addr) && !strcmp(sym_ptr->name, name)) {
-            lib_free(sym_ptr->name);
-            if (prev_ptr) {
-                prev_ptr->next = sym_ptr->next;
-            } else {
-                monitor_labels[mem].addr_hash_table[HASH_ADDR(addr)] = sym_ptr->next;
-            }
-            lib_free(sym_ptr);
-            return;
-        }
-        prev_ptr = sym_ptr;
-        sym_ptr = sym_ptr->next;
-    }
+    remove_symbol(mem, sym_ptr);
 }
 
 void mon_print_symbol_table(MEMSPACE mem)
@@ -2515,18 +2739,175 @@ void mon_print_symbol_table(MEMSPACE mem)
 
 void mon_clear_symbol_table(MEMSPACE mem)
 {
+    if (mem == e_default_space) {
+        mem = default_memspace;
+    }
+
+    free_symbol_table(mem);
+}
+
+/* Parse one line of a label file if it is a plain add_label command:
+   "al [<memspace>:]<hex address> <label>".  Returns 1 for such a line,
+   0 for an empty line and -1 for anything else.  */
+static int parse_label_line(char *line, MEMSPACE *mem, uint16_t *loc, char **name)
+{
+    char *p = line, *end;
+    unsigned long value;
+    static const char * const prefixes[] = { "c:", "8:", "9:", "10:", "11:" };
     int i;
 
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p == '\0') {
+        return 0;
+    }
+
+    if (strncmp(p, "al", 2) == 0) {
+        p += 2;
+    } else if (strncmp(p, "add_label", 9) == 0) {
+        p += 9;
+    } else {
+        return -1;
+    }
+    if (!isspace((unsigned char)*p)) {
+        return -1;
+    }
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+
+    for (i = 0; i < 5; i++) {
+        size_t len = strlen(prefixes[i]);
+
+        if (strncasecmp(p, prefixes[i], len) == 0) {
+            *mem = e_comp_space + i;
+            p += len;
+            break;
+        }
+    }
+
+    if (*p == '$') {
+        p++;
+    }
+    if (!isxdigit((unsigned char)*p)) {
+        return -1;
+    }
+    value = strtoul(p, &end, 16);
+    *loc = (uint16_t)value;
+    p = end;
+
+    while (isspace((unsigned char)*p) || *p == ',') {
+        p++;
+    }
+
+    /* same as the LABEL token of the lexer */
+    if (p[0] != '.' || !(isalpha((unsigned char)p[1]) || strchr("_@?:", p[1]))
+        || p[1] == '\0') {
+        return -1;
+    }
+    *name = p;
+    for (p += 2; isalnum((unsigned char)*p) || (*p && strchr("_@?:.", *p)); p++) {
+    }
+    end = p;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p != '\0') {
+        return -1;
+    }
+    *end = '\0';
+    return 1;
+}
+
+/* Load a label file.  When it only holds add_label commands, as written by
+   save_labels and cross assemblers, the labels are added directly with one
+   index lookup each; anything else is played back as monitor commands.  */
+void mon_load_symbols(MEMSPACE mem, const char *filename)
+{
+    FILE *fp;
+    char line[MAX_LABEL_LEN + 64];
+    struct {
+        MEMSPACE mem;
+        uint16_t loc;
+        char *name;
+    } *labels = NULL;
+    int count = 0, size = 0, added = 0, i, result = 0;
+    symbol_entry_t *old_entry;
+
     if (mem == e_default_space) {
         mem = default_memspace;
     }
 
-    free_symbol_table(mem);
-    monitor_labels[mem].name_list = NULL;
+    fp = fopen(filename, MODE_READ_TEXT);
+    if (fp == NULL) {
+        fp = sysfile_open(filename, NULL, NULL, MODE_READ_TEXT);
+    }
+    if (fp == NULL) {
+        mon_out("Cannot open '%s'.\n", filename);
+        return;
+    }
 
-    for (i = 0; i < HASH_ARRAY_SIZE; i++) {
-        monitor_labels[mem].addr_hash_table[i] = NULL;
+    /* with another radix the addresses would be read differently */
+    if (default_radix != e_hexadecimal) {
+        result = -1;
+    }
+
+    while (result >= 0 && fgets(line, sizeof(line), fp) != NULL) {
+        MEMSPACE line_mem = mem;
+        uint16_t loc;
+        char *name;
+
+        if (strchr(line, '\n') == NULL && !feof(fp)) {
+            result = -1;
+            break;
+        }
+        result = parse_label_line(line, &line_mem, &loc, &name);
+        if (result > 0) {
+            if (count == size) {
+                size = size ? size * 2 : 1024;
+                labels = lib_realloc(labels, (size_t)size * sizeof(*labels));
+            }
+            labels[count].mem = line_mem;
+            labels[count].loc = loc;
+            labels[count].name = lib_strdup(name);
+            count++;
+        }
     }
+    fclose(fp);
+
+    if (result < 0) {
+        for (i = 0; i < count; i++) {
+            lib_free(labels[i].name);
+        }
+        lib_free(labels);
+        mon_playback_commands(filename, true);
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        MEMSPACE label_mem = labels[i].mem;
+        char *name = labels[i].name;
+
+        if ((name[0] == '.') && mon_register_name_valid(label_mem, &name[1])) {
+            mon_out("Error: %s is a reserved label.\n", name);
+            lib_free(name);
+            continue;
+        }
+        old_entry = name_lookup(label_mem, name);
+        if (old_entry) {
+            if (old_entry->addr == labels[i].loc) {
+                lib_free(name);
+                continue;
+            }
+            remove_symbol(label_mem, old_entry);
+        }
+        add_symbol(label_mem, labels[i].loc, name);
+        added++;
+    }
+    lib_free(labels);
+
+    log_message(LOG_DEFAULT, "Loaded %d labels from `%s'.", added, filename);
 }
 
 
@@ -2759,6 +3140,308 @@ void mon_delete_conditional(cond_node_t *cnode)
 }
 
 
+/* Conditions are compiled into a program for a small stack machine when
+   they are set, so checking them at every hit of a checkpoint does not walk
+   the tree, and registers of a 6502 main cpu are read without calling
+   through the monitor cpu type.  */
+
+#define COND_STACK_MAX  32
+
+enum cond_op_e {
+    COND_OP_CONST,      /* push value */
+    COND_OP_REG,        /* push register value of memspace mem */
+    COND_OP_6502_A,     /* push a main cpu register, read directly if */
+    COND_OP_6502_X,     /* it is a 6502, else like COND_OP_REG */
+    COND_OP_6502_Y,
+    COND_OP_6502_SP,
+    COND_OP_6502_PC,
+    COND_OP_6502_FLAGS,
+    COND_OP_RASTERLINE,
+    COND_OP_CYCLE,
+    COND_OP_MEM,        /* push byte at address value of bank */
+    COND_OP_MEM_STACK,  /* replace address on the stack by its byte */
+    COND_OP_BINARY      /* replace the top two values by operation */
+};
+
+typedef struct cond_insn_s {
+    uint8_t op;
+    uint8_t operation;
+    uint8_t mem;
+    int value;
+    int banknum;
+} cond_insn_t;
+
+struct cond_program_s {
+    int length;
+    cond_insn_t *insn;
+};
+
+static int cond_program_size(cond_node_t *cnode, int *depth)
+{
+    int size1, size2, depth1 = 0, depth2 = 0;
+
+    if (cnode->operation != e_INV) {
+        if (!(cnode->child1 && cnode->child2)) {
+            return -1;
+        }
+        size1 = cond_program_size(cnode->child1, &depth1);
+        size2 = cond_program_size(cnode->child2, &depth2);
+        if (size1 < 0 || size2 < 0) {
+            return -1;
+        }
+        /* the first value waits on the stack while the second is computed */
+        *depth = (depth1 > depth2 + 1) ? depth1 : depth2 + 1;
+        return size1 + size2 + 1;
+    }
+
+    if (!cnode->is_reg && cnode->banknum >= 0 && cnode->child1 != NULL) {
+        size1 = cond_program_size(cnode->child1, depth);
+        return (size1 < 0) ? -1 : size1 + 1;
+    }
+
+    *depth = 1;
+    return 1;
+}
+
+static cond_insn_t *cond_program_emit(cond_node_t *cnode, cond_insn_t *insn)
+{
+    MEMSPACE mem;
+
+    if (cnode->operation != e_INV) {
+        insn = cond_program_emit(cnode->child1, insn);
+        insn = cond_program_emit(cnode->child2, insn);
+        insn->op = COND_OP_BINARY;
+        insn->operation = (uint8_t)cnode->operation;
+        return insn + 1;
+    }
+
+    insn->value = cnode->value;
+    insn->banknum = cnode->banknum;
+    insn->mem = e_comp_space;
+
+    if (cnode->is_reg) {
+        mem = reg_memspace(cnode->reg_num);
+        insn->mem = (uint8_t)mem;
+        insn->value = reg_regid(cnode->reg_num);
+        insn->op = COND_OP_REG;
+        switch (reg_regid(cnode->reg_num)) {
+            case e_Rasterline:
+                insn->op = COND_OP_RASTERLINE;
+                break;
+            case e_Cycle:
+                insn->op = COND_OP_CYCLE;
+                break;
+            case e_A:
+                insn->op = (mem == e_comp_space) ? COND_OP_6502_A : COND_OP_REG;
+                break;
+            case e_X:
+                insn->op = (mem == e_comp_space) ? COND_OP_6502_X : COND_OP_REG;
+                break;
+            case e_Y:
+                insn->op = (mem == e_comp_space) ? COND_OP_6502_Y : COND_OP_REG;
+                break;
+            case e_SP:
+                insn->op = (mem == e_comp_space) ? COND_OP_6502_SP : COND_OP_REG;
+                break;
+            case e_PC:
+                insn->op = (mem == e_comp_space) ? COND_OP_6502_PC : COND_OP_REG;
+                break;
+            case e_FLAGS:
+                insn->op = (mem == e_comp_space) ? COND_OP_6502_FLAGS : COND_OP_REG;
+                break;
+            default:
+                break;
+        }
+    } else if (cnode->banknum >= 0) {
+        if (cnode->child1 != NULL) {
+            insn = cond_program_emit(cnode->child1, insn);
+            insn->op = COND_OP_MEM_STACK;
+            insn->banknum = cnode->banknum;
+            insn->mem = e_comp_space;
+        } else {
+            insn->op = COND_OP_MEM;
+            insn->value = addr_location(cnode->value);
+        }
+    } else {
+        insn->op = COND_OP_CONST;
+    }
+    return insn + 1;
+}
+
+/* Returns NULL when the condition cannot be compiled, it must then be
+   evaluated with mon_evaluate_conditional().  */
+cond_program_t *mon_compile_conditional(cond_node_t *cnode)
+{
+    cond_program_t *program;
+    int size, depth = 0;
+
+    size = cond_program_size(cnode, &depth);
+    if (size < 0 || depth > COND_STACK_MAX) {
+        return NULL;
+    }
+
+    program = lib_malloc(sizeof(cond_program_t));
+    program->insn = lib_malloc((size_t)size * sizeof(cond_insn_t));
+    program->length = size;
+    cond_program_emit(cnode, program->insn);
+
+    return program;
+}
+
+static int cond_peek(int banknum, uint16_t addr)
+{
+    uint8_t byte1;
+    int old_sidefx = sidefx; /*we need to store current value*/
+    sidefx = 0; /*make sure we peek when doing the break point, otherwise weird stuff will happen*/
+
+    byte1 = mon_get_mem_val_ex(e_comp_space, banknum, addr);
+
+    sidefx = old_sidefx; /*restore value*/
+    return byte1;
+}
+
+int mon_evaluate_cond_program(const cond_program_t *program)
+{
+    int stack[COND_STACK_MAX];
+    int sp = 0;
+    const cond_insn_t *insn = program->insn;
+    const cond_insn_t *end = insn + program->length;
+    mos6510_regs_t *regs;
+    unsigned int line, cycle;
+    int half_cycle;
+    int value_1, value_2;
+
+    for (; insn < end; insn++) {
+        switch (insn->op) {
+            case COND_OP_CONST:
+                stack[sp++] = insn->value;
+                break;
+            case COND_OP_6502_A:
+            case COND_OP_6502_X:
+            case COND_OP_6502_Y:
+            case COND_OP_6502_SP:
+            case COND_OP_6502_PC:
+            case COND_OP_6502_FLAGS:
+                if (monitor_cpu_for_memspace[e_comp_space]->cpu_type == CPU_6502) {
+                    regs = mon_interfaces[e_comp_space]->cpu_regs;
+                    switch (insn->op) {
+                        case COND_OP_6502_A:
+                            stack[sp++] = MOS6510_REGS_GET_A(regs);
+                            break;
+                        case COND_OP_6502_X:
+                            stack[sp++] = MOS6510_REGS_GET_X(regs);
+                            break;
+                        case COND_OP_6502_Y:
+                            stack[sp++] = MOS6510_REGS_GET_Y(regs);
+                            break;
+                        case COND_OP_6502_SP:
+                            stack[sp++] = MOS6510_REGS_GET_SP(regs);
+                            break;
+                        case COND_OP_6502_PC:
+                            stack[sp++] = (int)MOS6510_REGS_GET_PC(regs);
+                            break;
+                        default:
+                            stack[sp++] = MOS6510_REGS_GET_FLAGS(regs)
+                                          | MOS6510_REGS_GET_SIGN(regs)
+                                          | (MOS6510_REGS_GET_ZERO(regs) << 1);
+                            break;
+                    }
+                    break;
+                }
+                /* fall through */
+            case COND_OP_REG:
+                stack[sp++] = (int)(monitor_cpu_for_memspace[insn->mem]->mon_register_get_val)
+                                  (insn->mem, insn->value);
+                break;
+            case COND_OP_RASTERLINE:
+                mon_interfaces[e_comp_space]->get_line_cycle(&line, &cycle, &half_cycle);
+                stack[sp++] = (int)line;
+                break;
+            case COND_OP_CYCLE:
+                mon_interfaces[e_comp_space]->get_line_cycle(&line, &cycle, &half_cycle);
+                stack[sp++] = (int)cycle;
+                break;
+            case COND_OP_MEM:
+                stack[sp++] = cond_peek(insn->banknum, (uint16_t)insn->value);
+                break;
+            case COND_OP_MEM_STACK:
+                stack[sp - 1] = cond_peek(insn->banknum, (uint16_t)stack[sp - 1]);
+                break;
+            case COND_OP_BINARY:
+                value_2 = stack[--sp];
+                value_1 = stack[sp - 1];
+                switch (insn->operation) {
+                    case e_EQU:
+                        stack[sp - 1] = (value_1 == value_2);
+                        break;
+                    case e_NEQ:
+                        stack[sp - 1] = (value_1 != value_2);
+                        break;
+                    case e_GT:
+                        stack[sp - 1] = (value_1 > value_2);
+                        break;
+                    case e_LT:
+                        stack[sp - 1] = (value_1 < value_2);
+                        break;
+                    case e_GTE:
+                        stack[sp - 1] = (value_1 >= value_2);
+                        break;
+                    case e_LTE:
+                        stack[sp - 1] = (value_1 <= value_2);
+                        break;
+                    case e_LOGICAL_AND:
+                        stack[sp - 1] = (value_1 && value_2);
+                        break;
+                    case e_LOGICAL_OR:
+                        stack[sp - 1] = (value_1 || value_2);
+                        break;
+                    case e_ADD:
+                        stack[sp - 1] = (value_1 + value_2);
+                        break;
+                    case e_SUB:
+                        stack[sp - 1] = (value_1 - value_2);
+                        break;
+                    case e_MUL:
+                        stack[sp - 1] = (value_1 * value_2);
+                        break;
+                    case e_DIV:
+                        if (value_2 == 0) {
+                            log_error(LOG_ERR, "Division by zero in conditional\n");
+                            stack[sp - 1] = 0;
+                        } else {
+                            stack[sp - 1] = (value_1 / value_2);
+                        }
+                        break;
+                    case e_BINARY_AND:
+                        stack[sp - 1] = (value_1 & value_2);
+                        break;
+                    case e_BINARY_OR:
+                        stack[sp - 1] = (value_1 | value_2);
+                        break;
+                    default:
+                        log_error(LOG_ERR, "Unexpected conditional operator: %d\n",
+                                  insn->operation);
+                        stack[sp - 1] = 0;
+                        break;
+                }
+                break;
+        }
+    }
+
+    return stack[0];
+}
+
+void mon_delete_cond_program(cond_program_t *program)
+{
+    if (!program) {
+        return;
+    }
+
+    lib_free(program->insn);
+    lib_free(program);
+}
+
+
 /* *** SNAPSHOTS *** */
 
 
@@ -2779,6 +3462,26 @@ int mon_read_snapshot(const char *name, int even_mode)
     return ret;
 }
 
+int mon_rewind(int steps)
+{
+    int ret;
+
+    if (rewind_get_depth() == 0) {
+        mon_out("No rewind states recorded.\n");
+        return -1;
+    }
+
+    ret = rewind_step_back(steps);
+    if (ret < 0) {
+        mon_out("Cannot rewind %d steps, %d states available.\n", steps, rewind_get_depth());
+    }
+
+    /* Reset the current address */
+    dot_addr[e_comp_space] = new_addr(e_comp_space, ((uint16_t)((monitor_cpu_for_memspace[e_comp_space]->mon_register_get_val)(e_comp_space, e_PC))));
+
+    return ret;
+}
+
 
 /* *** WATCHPOINTS *** */
 
@@ -3060,6 +3763,8 @@ static void monitor_open(void)
 
 #ifdef FEATURE_CPUMEMHISTORY
     memmap_state |= MEMMAP_STATE_IN_MONITOR;
+    /* collect the cpu history from now on, for the next time */
+    mon_cpuhistory_enable(MON_CPUHISTORY_MONITOR, 1);
 #endif
     inside_monitor = true;
     vsync_suspend_speed_eval();
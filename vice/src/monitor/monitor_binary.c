@@ -34,6 +34,7 @@
 #include "archdep_defs.h"
 #include "cmdline.h"
 #include "drive.h"
+#include "hosttime.h"
 #include "interrupt.h"
 #include "lib.h"
 #include "log.h"
@@ -47,10 +48,12 @@
 #include "vicesocket.h"
 #include "machine.h"
 #include "screenshot.h"
+#include "sound.h"
 #include "machine-video.h"
 #include "palette.h"
 
 #include "mon_breakpoint.h"
+#include "mon_disassemble.h"
 #include "mon_file.h"
 #include "mon_register.h"
 
@@ -75,6 +78,7 @@ enum t_binary_command {
 
     e_MON_CMD_MEM_GET = 0x01,
     e_MON_CMD_MEM_SET = 0x02,
+    e_MON_CMD_DISASSEMBLE_GET = 0x03,
 
     e_MON_CMD_CHECKPOINT_GET = 0x11,
     e_MON_CMD_CHECKPOINT_SET = 0x12,
@@ -102,6 +106,11 @@ enum t_binary_command {
     e_MON_CMD_REGISTERS_AVAILABLE = 0x83,
     e_MON_CMD_DISPLAY_GET = 0x84,
     e_MON_CMD_VICE_INFO = 0x85,
+    e_MON_CMD_SUBSYSTEM_TIMING_GET = 0x86,
+    e_MON_CMD_BATCH_GET = 0x87,
+    e_MON_CMD_BATCH_SUBSCRIBE = 0x88,
+    e_MON_CMD_DISPLAY_STREAM = 0x89,
+    e_MON_CMD_SOUND_STATUS_GET = 0x8a,
 
     e_MON_CMD_PALETTE_GET = 0x91,
 
@@ -120,6 +129,7 @@ enum t_binary_response {
     e_MON_RESPONSE_INVALID = 0x00,
     e_MON_RESPONSE_MEM_GET = 0x01,
     e_MON_RESPONSE_MEM_SET = 0x02,
+    e_MON_RESPONSE_DISASSEMBLE_GET = 0x03,
 
     e_MON_RESPONSE_CHECKPOINT_INFO = 0x11,
 
@@ -150,6 +160,11 @@ enum t_binary_response {
     e_MON_RESPONSE_REGISTERS_AVAILABLE = 0x83,
     e_MON_RESPONSE_DISPLAY_GET = 0x84,
     e_MON_RESPONSE_VICE_INFO = 0x85,
+    e_MON_RESPONSE_SUBSYSTEM_TIMING_GET = 0x86,
+    e_MON_RESPONSE_BATCH_GET = 0x87,
+    e_MON_RESPONSE_BATCH_SUBSCRIBE = 0x88,
+    e_MON_RESPONSE_DISPLAY_STREAM = 0x89,
+    e_MON_RESPONSE_SOUND_STATUS_GET = 0x8a,
 
     e_MON_RESPONSE_PALETTE_GET = 0x91,
 
@@ -196,6 +211,78 @@ struct binary_command_s {
 };
 typedef struct binary_command_s binary_command_t;
 
+struct batch_range_s {
+    MEMSPACE memspace;
+    uint8_t requested_memspace;
+    int banknum;
+    uint16_t startaddress;
+    uint16_t endaddress;
+};
+typedef struct batch_range_s batch_range_t;
+
+/* memory ranges and register sets of a batch get or subscribe command */
+struct batch_request_s {
+    bool sidefx;
+    unsigned int range_count;
+    batch_range_t *ranges;
+    unsigned int register_set_count;
+    uint8_t *register_sets;
+};
+typedef struct batch_request_s batch_request_t;
+
+/* sent at every vsync while the machine runs, NULL if none */
+static batch_request_t *batch_subscription = NULL;
+
+struct display_stream_s {
+    bool use_vic;
+    uint8_t format;
+    bool changed_only;
+    unsigned int interval;      /* send every interval'th frame */
+    unsigned int skipped;
+    uint32_t frame;             /* vsyncs since the stream started */
+    unsigned int width;         /* geometry of last_frame */
+    unsigned int height;
+    uint8_t *last_frame;        /* lines as last sent, only if changed_only */
+    unsigned char *response;    /* kept for the next frame */
+};
+typedef struct display_stream_s display_stream_t;
+
+/* frames sent at every vsync while the machine runs, NULL if none */
+static display_stream_t *display_stream = NULL;
+
+static void display_stream_free(void)
+{
+    if (display_stream) {
+        lib_free(display_stream->last_frame);
+        lib_free(display_stream->response);
+        lib_free(display_stream);
+        display_stream = NULL;
+    }
+}
+
+/* Responses are built in one buffer that only grows, so a debugger polling
+   memory, registers or the screen every frame does not allocate.  */
+static unsigned char *response_buffer = NULL;
+static uint32_t response_buffer_size = 0;
+
+static unsigned char *response_buffer_get(uint32_t size)
+{
+    if (size > response_buffer_size) {
+        response_buffer = lib_realloc(response_buffer, size);
+        response_buffer_size = size;
+    }
+    return response_buffer;
+}
+
+static void batch_request_free(batch_request_t *batch)
+{
+    if (batch) {
+        lib_free(batch->ranges);
+        lib_free(batch->register_sets);
+        lib_free(batch);
+    }
+}
+
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
 {
     int error = 0;
@@ -217,6 +304,15 @@ static void monitor_binary_quit(void)
 {
     vice_network_socket_close(connected_socket);
     connected_socket = NULL;
+
+    batch_request_free(batch_subscription);
+    batch_subscription = NULL;
+
+    display_stream_free();
+
+    lib_free(response_buffer);
+    response_buffer = NULL;
+    response_buffer_size = 0;
 }
 
 int monitor_binary_receive(unsigned char *buffer, size_t buffer_length)
@@ -272,6 +368,7 @@ void monitor_check_binary(void)
     }
 }
 
+
 #define ASC_STX 0x02
 
 #define MON_BINARY_API_VERSION 0x02
@@ -426,7 +523,7 @@ static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE
     }
 
     response_size += count * (item_size + 1);
-    response = lib_malloc(response_size);
+    response = response_buffer_get(response_size);
     response_cursor = response;
 
     regs_cursor = regs;
@@ -448,8 +545,6 @@ static void monitor_binary_response_register_info(uint32_t request_id, MEMSPACE
     }
 
     monitor_binary_response(response_size, e_MON_RESPONSE_REGISTER_INFO, e_MON_ERR_OK, request_id, response);
-
-    lib_free(response);
 }
 
 /*! \internal \brief called when the monitor is opened */
@@ -1191,10 +1286,57 @@ static void monitor_binary_screenshot_line_data(screenshot_t *screenshot, uint8_
     );
 }
 
+/*! \internal \brief Take a screenshot of the VIC(-II) or the VDC for the display commands */
+static int display_screenshot(screenshot_t *screenshot, bool use_vic)
+{
+    struct video_canvas_s *canvas;
+
+    if (machine_class == VICE_MACHINE_C128 && use_vic) {
+        canvas = machine_video_canvas_get(1);
+    } else {
+        canvas = machine_video_canvas_get(0);
+    }
+
+    if (machine_screenshot(screenshot, canvas) < 0) {
+        return -1;
+    }
+
+    screenshot->width = screenshot->max_width & ~3;
+    screenshot->height = screenshot->last_displayed_line - screenshot->first_displayed_line + 1;
+    screenshot->y_offset = screenshot->first_displayed_line;
+    screenshot->convert_line = monitor_binary_screenshot_line_data;
+
+    return 0;
+}
+
+/*! \internal \brief Write the display geometry as in MON_RESPONSE_DISPLAY_GET and return pointer to byte after */
+static unsigned char *write_display_info(screenshot_t *screenshot, uint8_t depth, unsigned char *output)
+{
+    /* Length of fields before display buffer */
+    output = write_uint32(13, output);
+
+    /* Full width of buffer */
+    output = write_uint16(screenshot->debug_width, output);
+    /* Full height of buffer */
+    output = write_uint16(screenshot->debug_height, output);
+    /* X offset of the inner part of the screen */
+    output = write_uint16(screenshot->debug_offset_x, output);
+    /* Y offset of the inner part of the screen */
+    output = write_uint16(screenshot->debug_offset_y, output);
+    /* Width of the inner part of the screen */
+    output = write_uint16(screenshot->inner_width, output);
+    /* Height of the inner part of the screen */
+    output = write_uint16(screenshot->inner_height, output);
+    /* Bits per pixel of image */
+    *output = depth;
+    output++;
+
+    return output;
+}
+
 static void monitor_binary_process_display_get(binary_command_t *command)
 {
     screenshot_t screenshot;
-    struct video_canvas_s *canvas;
     unsigned char *response, *response_cursor;
     uint32_t response_length, buffer_length;
     unsigned int i;
@@ -1221,58 +1363,142 @@ static void monitor_binary_process_display_get(binary_command_t *command)
         return;
     }
 
-    if (machine_class == VICE_MACHINE_C128 && use_vic) {
-        canvas = machine_video_canvas_get(1);
-    } else {
-        canvas = machine_video_canvas_get(0);
-    }
-
-    if(machine_screenshot(&screenshot, canvas) < 0) {
+    if(display_screenshot(&screenshot, use_vic) < 0) {
         monitor_binary_error(e_MON_ERR_CMD_FAILURE, command->request_id);
         return;
     }
 
-    screenshot.width = screenshot.max_width & ~3;
-    screenshot.height = screenshot.last_displayed_line - screenshot.first_displayed_line + 1;
-    screenshot.y_offset = screenshot.first_displayed_line;
-
     buffer_length = screenshot.debug_width * screenshot.debug_height * depth / 8;
     response_length = 4 + info_length + buffer_length;
-    response = lib_malloc(response_length);
+    response = response_buffer_get(response_length);
     response_cursor = response;
 
-    /* Length of fields before display buffer */
-    response_cursor = write_uint32(info_length, response_cursor);
-
-    /* Full width of buffer */
-    response_cursor = write_uint16(screenshot.debug_width, response_cursor);
-    /* Full height of buffer */
-    response_cursor = write_uint16(screenshot.debug_height, response_cursor);
-    /* X offset of the inner part of the screen */
-    response_cursor = write_uint16(screenshot.debug_offset_x, response_cursor);
-    /* Y offset of the inner part of the screen */
-    response_cursor = write_uint16(screenshot.debug_offset_y, response_cursor);
-    /* Width of the inner part of the screen */
-    response_cursor = write_uint16(screenshot.inner_width, response_cursor);
-    /* Height of the inner part of the screen */
-    response_cursor = write_uint16(screenshot.inner_height, response_cursor);
-    /* Bits per pixel of image */
-    *response_cursor = depth;
-    response_cursor++;
+    response_cursor = write_display_info(&screenshot, depth, response_cursor);
 
     /* Length of display buffer */
     response_cursor = write_uint32(buffer_length, response_cursor);
 
     /* Buffer Data in requested format */
-    screenshot.convert_line = monitor_binary_screenshot_line_data;
     for(i = 0; i < screenshot.debug_height; i++) {
         screenshot.convert_line(&screenshot, response_cursor, i, format);
         response_cursor += screenshot.debug_width * depth / 8;
     }
 
     monitor_binary_response(response_length, e_MON_RESPONSE_DISPLAY_GET, e_MON_ERR_OK, command->request_id, response);
+}
 
-    lib_free(response);
+/*! \internal \brief Send the display stream, if one was requested, called at every vsync
+
+    The lines are converted straight into the response buffer, which is kept
+    between frames like the copy of the last frame used to find the lines
+    that changed. */
+static void display_stream_send(void)
+{
+    display_stream_t *stream = display_stream;
+    screenshot_t screenshot;
+    unsigned char *response_cursor, *count_cursor;
+    uint32_t line_size, max_size;
+    uint16_t line_count = 0;
+    unsigned int i;
+    uint8_t depth = 8;
+
+    stream->frame++;
+    if (++stream->skipped < stream->interval) {
+        return;
+    }
+    stream->skipped = 0;
+
+    if (display_screenshot(&screenshot, stream->use_vic) < 0) {
+        return;
+    }
+
+    line_size = screenshot.debug_width * depth / 8;
+
+    if (screenshot.debug_width != stream->width || screenshot.debug_height != stream->height) {
+        /* geometry changed, send every line of this frame */
+        stream->width = screenshot.debug_width;
+        stream->height = screenshot.debug_height;
+        lib_free(stream->last_frame);
+        stream->last_frame = NULL;
+        lib_free(stream->response);
+        stream->response = NULL;
+    }
+
+    max_size = 4 + 4 + 13 + 2 + stream->height * (2 + line_size);
+    if (stream->response == NULL) {
+        stream->response = lib_malloc(max_size);
+    }
+
+    response_cursor = write_uint32(stream->frame, stream->response);
+    response_cursor = write_display_info(&screenshot, depth, response_cursor);
+    count_cursor = response_cursor;
+    response_cursor += 2;
+
+    for (i = 0; i < stream->height; i++) {
+        unsigned char *line = response_cursor + 2;
+
+        screenshot.convert_line(&screenshot, line, i, stream->format);
+
+        if (stream->last_frame != NULL) {
+            uint8_t *last_line = stream->last_frame + i * line_size;
+
+            if (memcmp(last_line, line, line_size) == 0) {
+                continue;
+            }
+            memcpy(last_line, line, line_size);
+        }
+
+        response_cursor = write_uint16(i, response_cursor);
+        response_cursor += line_size;
+        line_count++;
+    }
+
+    if (stream->last_frame == NULL && stream->changed_only) {
+        /* everything was sent, remember it */
+        stream->last_frame = lib_malloc(stream->height * line_size);
+        response_cursor = count_cursor + 2;
+        for (i = 0; i < stream->height; i++) {
+            memcpy(stream->last_frame + i * line_size, response_cursor + 2, line_size);
+            response_cursor += 2 + line_size;
+        }
+    }
+
+    if (line_count == 0) {
+        return;
+    }
+
+    write_uint16(line_count, count_cursor);
+
+    monitor_binary_response((uint32_t)(response_cursor - stream->response), e_MON_RESPONSE_DISPLAY_STREAM, e_MON_ERR_OK, MON_EVENT_ID, stream->response);
+}
+
+static void monitor_binary_process_display_stream(binary_command_t *command)
+{
+    unsigned char *body = command->body;
+
+    if (command->length < 4) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    if (body[1] != e_DISPLAY_GET_MODE_INDEXED8) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        return;
+    }
+
+    display_stream_free();
+
+    /* an interval of 0 stops the stream */
+    if (body[3] > 0) {
+        display_stream = lib_calloc(1, sizeof(display_stream_t));
+        display_stream->use_vic = !!body[0];
+        display_stream->format = body[1];
+        display_stream->changed_only = body[2] & 0x01;
+        display_stream->interval = body[3];
+        display_stream->skipped = body[3] - 1;  /* send the next frame */
+    }
+
+    monitor_binary_response(0, e_MON_RESPONSE_DISPLAY_STREAM, e_MON_ERR_OK, command->request_id, NULL);
 }
 
 static void monitor_binary_process_palette_get(binary_command_t *command)
@@ -1403,6 +1629,275 @@ static void monitor_binary_process_vice_info(binary_command_t *command)
     monitor_binary_response(sizeof(response), e_MON_RESPONSE_VICE_INFO, e_MON_ERR_OK, command->request_id, response);
 }
 
+static void monitor_binary_process_subsystem_timing_get(binary_command_t *command)
+{
+    unsigned char response[6 + HOSTTIME_NUM * (18 + 255)];
+    unsigned char *response_cursor = response;
+    hosttime_stats_t stats;
+    int i;
+
+    *response_cursor = hosttime_get_stats(&stats) ? 1 : 0;
+    ++response_cursor;
+
+    *response_cursor = HOSTTIME_NUM;
+    ++response_cursor;
+
+    response_cursor = write_uint32(stats.frames, response_cursor);
+
+    for (i = 0; i < HOSTTIME_NUM; i++) {
+        const char *name = hosttime_subsystem_name(i);
+        uint8_t name_length = (uint8_t)strlen(name);
+
+        *response_cursor = 17 + name_length;
+        ++response_cursor;
+
+        response_cursor = write_uint32((uint32_t)stats.window_ns[i], response_cursor);
+        response_cursor = write_uint32((uint32_t)(stats.window_ns[i] >> 32), response_cursor);
+        response_cursor = write_uint32((uint32_t)stats.frame_ns[i], response_cursor);
+        response_cursor = write_uint32((uint32_t)(stats.frame_ns[i] >> 32), response_cursor);
+
+        response_cursor = write_string(name_length, (unsigned char *)name, response_cursor);
+    }
+
+    monitor_binary_response((uint32_t)(response_cursor - response), e_MON_RESPONSE_SUBSYSTEM_TIMING_GET, e_MON_ERR_OK, command->request_id, response);
+}
+
+static void monitor_binary_process_sound_status_get(binary_command_t *command)
+{
+    unsigned char response[22];
+    unsigned char *response_cursor = response;
+    sound_status_t status;
+
+    sound_get_status(&status);
+
+    *response_cursor = (status.open ? 0x01 : 0) | (status.adaptive ? 0x02 : 0);
+    ++response_cursor;
+
+    *response_cursor = (uint8_t)status.fill_percent;
+    ++response_cursor;
+
+    response_cursor = write_uint32((uint32_t)status.sample_rate, response_cursor);
+    response_cursor = write_uint32(status.buffer_usec, response_cursor);
+    response_cursor = write_uint32(status.latency_usec, response_cursor);
+    response_cursor = write_uint32(status.underruns, response_cursor);
+    response_cursor = write_uint32(status.overruns, response_cursor);
+
+    monitor_binary_response((uint32_t)(response_cursor - response), e_MON_RESPONSE_SOUND_STATUS_GET, e_MON_ERR_OK, command->request_id, response);
+}
+
+/*! \internal \brief Write the registers of memspace in the format of
+    MON_RESPONSE_REGISTER_INFO and return pointer to byte after
+
+    Writes nothing and returns NULL if output is NULL, use this to get the size. */
+static unsigned char *write_register_info(MEMSPACE memspace, unsigned char *output, uint32_t *size)
+{
+    mon_reg_list_t *regs;
+    mon_reg_list_t *regs_cursor;
+    uint16_t count = 0;
+
+    regs = mon_register_list_get(memspace);
+
+    for (regs_cursor = regs; regs_cursor->name; regs_cursor++) {
+        if (!ignore_fake_register(regs_cursor)) {
+            ++count;
+        }
+    }
+
+    *size = 2 + count * 4;
+
+    if (output != NULL) {
+        output = write_uint16(count, output);
+
+        for (regs_cursor = regs; regs_cursor->name; regs_cursor++) {
+            if (ignore_fake_register(regs_cursor)) {
+                continue;
+            }
+
+            *output = 3;
+            ++output;
+
+            *output = regs_cursor->id;
+            ++output;
+
+            output = write_uint16((uint16_t)regs_cursor->val, output);
+        }
+    }
+
+    lib_free(regs);
+
+    return output;
+}
+
+/*! \internal \brief Parse the body of a batch command
+
+    Sends the error response and returns NULL if the body is invalid. */
+static batch_request_t *batch_request_parse(binary_command_t *command)
+{
+    const uint32_t range_size = 7;
+    unsigned char *body = command->body;
+    batch_request_t *batch;
+    uint32_t header_size;
+    unsigned int i;
+
+    if (command->length < 3) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return NULL;
+    }
+
+    header_size = 2 + body[1] * range_size + 1;
+    if (command->length < header_size
+        || command->length < header_size + body[header_size - 1]) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return NULL;
+    }
+
+    batch = lib_calloc(1, sizeof(batch_request_t));
+    batch->sidefx = !!body[0];
+    batch->range_count = body[1];
+    batch->ranges = lib_calloc(batch->range_count + 1, sizeof(batch_range_t));
+    batch->register_set_count = body[header_size - 1];
+    batch->register_sets = lib_calloc(batch->register_set_count + 1, 1);
+
+    for (i = 0; i < batch->range_count; i++) {
+        unsigned char *item = &body[2 + i * range_size];
+        batch_range_t *range = &batch->ranges[i];
+
+        range->startaddress = little_endian_to_uint16(&item[0]);
+        range->endaddress = little_endian_to_uint16(&item[2]);
+        range->requested_memspace = item[4];
+        range->memspace = get_requested_memspace(item[4]);
+        range->banknum = little_endian_to_uint16(&item[5]);
+
+        if (range->memspace == e_invalid_space) {
+            monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary batch: Unknown memspace %u", item[4]);
+            batch_request_free(batch);
+            return NULL;
+        }
+
+        if (range->startaddress > range->endaddress
+            || mon_banknum_validate(range->memspace, range->banknum) == 0) {
+            monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary batch: invalid range %04x - %04x bank %d",
+                        range->startaddress, range->endaddress, range->banknum);
+            batch_request_free(batch);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < batch->register_set_count; i++) {
+        batch->register_sets[i] = body[header_size + i];
+
+        if (get_requested_memspace(batch->register_sets[i]) == e_invalid_space) {
+            monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+            log_message(LOG_DEFAULT, "monitor binary batch: Unknown memspace %u", batch->register_sets[i]);
+            batch_request_free(batch);
+            return NULL;
+        }
+    }
+
+    return batch;
+}
+
+static void monitor_binary_response_batch(uint32_t request_id, BINARY_RESPONSE response_type, batch_request_t *batch)
+{
+    unsigned char *response;
+    unsigned char *response_cursor;
+    uint32_t response_size = 2;
+    uint32_t size;
+    int old_sidefx = sidefx;
+    unsigned int i;
+
+    for (i = 0; i < batch->range_count; i++) {
+        response_size += 5 + batch->ranges[i].endaddress - batch->ranges[i].startaddress + 1;
+    }
+    for (i = 0; i < batch->register_set_count; i++) {
+        write_register_info(get_requested_memspace(batch->register_sets[i]), NULL, &size);
+        response_size += 1 + size;
+    }
+
+    response = response_buffer_get(response_size);
+    response_cursor = response;
+
+    *response_cursor = (uint8_t)batch->range_count;
+    ++response_cursor;
+
+    sidefx = batch->sidefx;
+    for (i = 0; i < batch->range_count; i++) {
+        batch_range_t *range = &batch->ranges[i];
+
+        *response_cursor = range->requested_memspace;
+        ++response_cursor;
+
+        response_cursor = write_uint16(range->startaddress, response_cursor);
+        response_cursor = write_uint16(range->endaddress, response_cursor);
+
+        mon_get_mem_block_ex(range->memspace, range->banknum, range->startaddress,
+                             range->endaddress - range->startaddress, response_cursor);
+        response_cursor += range->endaddress - range->startaddress + 1;
+    }
+    sidefx = old_sidefx;
+
+    *response_cursor = (uint8_t)batch->register_set_count;
+    ++response_cursor;
+
+    for (i = 0; i < batch->register_set_count; i++) {
+        *response_cursor = batch->register_sets[i];
+        ++response_cursor;
+
+        response_cursor = write_register_info(get_requested_memspace(batch->register_sets[i]), response_cursor, &size);
+    }
+
+    monitor_binary_response(response_size, response_type, e_MON_ERR_OK, request_id, response);
+}
+
+static void monitor_binary_process_batch_get(binary_command_t *command)
+{
+    batch_request_t *batch = batch_request_parse(command);
+
+    if (batch) {
+        monitor_binary_response_batch(command->request_id, e_MON_RESPONSE_BATCH_GET, batch);
+        batch_request_free(batch);
+    }
+}
+
+static void monitor_binary_process_batch_subscribe(binary_command_t *command)
+{
+    batch_request_t *batch = batch_request_parse(command);
+
+    if (!batch) {
+        return;
+    }
+
+    batch_request_free(batch_subscription);
+    batch_subscription = NULL;
+
+    /* an empty request ends the subscription */
+    if (batch->range_count > 0 || batch->register_set_count > 0) {
+        batch_subscription = batch;
+    }
+
+    monitor_binary_response_batch(command->request_id, e_MON_RESPONSE_BATCH_SUBSCRIBE, batch);
+
+    if (batch_subscription != batch) {
+        batch_request_free(batch);
+    }
+}
+
+/*! \brief Send the subscribed memory ranges, registers and display, called at every vsync */
+void monitor_binary_vsync_hook(void)
+{
+    if (connected_socket == NULL) {
+        return;
+    }
+    if (batch_subscription != NULL) {
+        monitor_binary_response_batch(MON_EVENT_ID, e_MON_RESPONSE_BATCH_SUBSCRIBE, batch_subscription);
+    }
+    if (display_stream != NULL) {
+        display_stream_send();
+    }
+}
+
 static void monitor_binary_process_mem_get(binary_command_t *command)
 {
     unsigned char *response;
@@ -1455,7 +1950,7 @@ static void monitor_binary_process_mem_get(binary_command_t *command)
 
     response_size += length;
 
-    response = lib_malloc(response_size);
+    response = response_buffer_get(response_size);
     response_cursor = response;
 
     response_cursor = write_uint16(length, response_cursor);
@@ -1467,6 +1962,113 @@ static void monitor_binary_process_mem_get(binary_command_t *command)
     response_cursor += length;
 
     monitor_binary_response(response_size, e_MON_RESPONSE_MEM_GET, e_MON_ERR_OK, command->request_id, response);
+}
+
+static void monitor_binary_process_disassemble_get(binary_command_t *command)
+{
+    unsigned char *response;
+    unsigned char *response_cursor;
+    uint32_t response_size = 4;
+    uint32_t response_max;
+    uint32_t count = 0;
+    MEMSPACE memspace;
+
+    unsigned char *body = command->body;
+
+    uint16_t startaddress;
+    uint16_t endaddress;
+    uint8_t requested_memspace;
+    uint16_t requested_banknum;
+    uint32_t addr;
+
+    if (command->length < 7) {
+        monitor_binary_error(e_MON_ERR_CMD_INVALID_LENGTH, command->request_id);
+        return;
+    }
+
+    startaddress = little_endian_to_uint16(&body[0]);
+    endaddress = little_endian_to_uint16(&body[2]);
+    requested_memspace = body[4];
+    requested_banknum = little_endian_to_uint16(&body[5]);
+
+    if (startaddress > endaddress) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary disassemble: wrong start and/or end address %04x - %04x",
+                    startaddress, endaddress);
+        return;
+    }
+
+    memspace = get_requested_memspace(requested_memspace);
+
+    if (memspace == e_invalid_space) {
+        monitor_binary_error(e_MON_ERR_INVALID_MEMSPACE, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary disassemble: Unknown memspace %u", requested_memspace);
+        return;
+    }
+
+    if (mon_banknum_validate(memspace, requested_banknum) == 0) {
+        monitor_binary_error(e_MON_ERR_INVALID_PARAMETER, command->request_id);
+        log_message(LOG_DEFAULT, "monitor binary disassemble: Unknown bank %u", requested_banknum);
+        return;
+    }
+
+    response_max = 4096;
+    response = lib_malloc(response_max);
+
+    /* instructions starting in the range, the last one may run past its end */
+    for (addr = startaddress; addr <= endaddress; ) {
+        uint8_t opc[5];
+        unsigned opc_size;
+        const char *text, *label;
+        size_t text_len, label_len;
+        uint32_t entry_size;
+
+        text = mon_disassemble_instr_bank(memspace, requested_banknum, (uint16_t)addr, opc, &opc_size);
+        if (opc_size < 1 || opc_size > 5) {
+            opc_size = 1;
+        }
+        if (strlen(text) > MON_DISASSEMBLE_BYTES_LEN) {
+            text += MON_DISASSEMBLE_BYTES_LEN;
+        }
+        text_len = strlen(text);
+        if (text_len > 255) {
+            text_len = 255;
+        }
+        label = mon_symbol_table_lookup_name(memspace, (uint16_t)addr);
+        label_len = label ? strlen(label) : 0;
+        if (label_len > 255) {
+            label_len = 255;
+        }
+
+        entry_size = 2 + 1 + opc_size + 1 + (uint32_t)label_len + 1 + (uint32_t)text_len;
+        if (response_size + 1 + entry_size > response_max) {
+            response_max *= 2;
+            response = lib_realloc(response, response_max);
+        }
+        response_cursor = response + response_size;
+
+        *response_cursor++ = (uint8_t)entry_size;
+        response_cursor = write_uint16((uint16_t)addr, response_cursor);
+        *response_cursor++ = (uint8_t)opc_size;
+        memcpy(response_cursor, opc, opc_size);
+        response_cursor += opc_size;
+        *response_cursor++ = (uint8_t)label_len;
+        if (label_len) {
+            memcpy(response_cursor, label, label_len);
+            response_cursor += label_len;
+        }
+        *response_cursor++ = (uint8_t)text_len;
+        memcpy(response_cursor, text, text_len);
+        response_cursor += text_len;
+
+        response_size = (uint32_t)(response_cursor - response);
+        count++;
+        addr += opc_size;
+    }
+
+    write_uint32(count, response);
+
+    monitor_binary_response(response_size, e_MON_RESPONSE_DISASSEMBLE_GET, e_MON_ERR_OK, command->request_id, response);
 
     lib_free(response);
 }
@@ -1560,6 +2162,8 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
         monitor_binary_process_mem_get(&command);
     } else if (command_type == e_MON_CMD_MEM_SET) {
         monitor_binary_process_mem_set(&command);
+    } else if (command_type == e_MON_CMD_DISASSEMBLE_GET) {
+        monitor_binary_process_disassemble_get(&command);
 
     } else if (command_type == e_MON_CMD_CHECKPOINT_GET) {
         monitor_binary_process_checkpoint_get(&command);
@@ -1614,6 +2218,16 @@ static void monitor_binary_process_command(unsigned char * pbuffer)
         monitor_binary_process_display_get(&command);
     } else if (command_type == e_MON_CMD_VICE_INFO) {
         monitor_binary_process_vice_info(&command);
+    } else if (command_type == e_MON_CMD_SUBSYSTEM_TIMING_GET) {
+        monitor_binary_process_subsystem_timing_get(&command);
+    } else if (command_type == e_MON_CMD_BATCH_GET) {
+        monitor_binary_process_batch_get(&command);
+    } else if (command_type == e_MON_CMD_BATCH_SUBSCRIBE) {
+        monitor_binary_process_batch_subscribe(&command);
+    } else if (command_type == e_MON_CMD_DISPLAY_STREAM) {
+        monitor_binary_process_display_stream(&command);
+    } else if (command_type == e_MON_CMD_SOUND_STATUS_GET) {
+        monitor_binary_process_sound_status_get(&command);
 
     } else if (command_type == e_MON_CMD_EXIT) {
         monitor_binary_process_exit(&command);
@@ -1919,6 +2533,10 @@ void monitor_check_binary(void)
 {
 }
 
+void monitor_binary_vsync_hook(void)
+{
+}
+
 int monitor_binary_transmit(const unsigned char *buffer, size_t buffer_length)
 {
     return 0;
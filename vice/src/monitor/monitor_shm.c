@@ -0,0 +1,465 @@
+/*
+ * monitor_shm.c - Shared memory control interface for external programs.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With `SharedMemoryControl' enabled a monitor_shm_t is mapped under the
+   name given by `SharedMemoryControlName' (POSIX shared memory object
+   "/<name>", a named file mapping on Windows).  After the first reset the
+   emulator blocks in a CPU trap until the client posts a command.
+   MONITOR_SHM_CMD_RUN applies the inputs with the same operations the
+   binary monitor uses, runs the requested number of cycles and blocks
+   again once the registers, the clock and the requested part of the memory
+   have been copied into the mapping.  This avoids a network round trip per
+   step.
+
+   A blocked emulator spins on `request' for a millisecond, then polls it
+   while letting the UI run.  MONITOR_SHM_CMD_DETACH lets the machine run
+   freely; the next request is then picked up at the following vsync.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WINDOWS_COMPILE
+#   include <windows.h>
+#elif defined(HAVE_SHM_OPEN)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include "alarm.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "mainlock.h"
+#include "maincpu.h"
+#include "mon_register.h"
+#include "monitor.h"
+#include "monitor_shm.h"
+#include "montypes.h"
+#include "resources.h"
+#include "types.h"
+#include "util.h"
+
+/* Fields shared with the client are read and written through this.  */
+#define SHM_FIELD(field)    (((volatile monitor_shm_t *)shm)->field)
+
+#ifdef __GNUC__
+#define SHM_BARRIER()       __sync_synchronize()
+#else
+#define SHM_BARRIER()
+#endif
+
+enum {
+    SHM_DETACHED,       /* machine runs freely */
+    SHM_BLOCKED,        /* trap pending or waiting for the client */
+    SHM_RUNNING         /* running the cycles of a command */
+};
+
+static int shm_enabled = 0;
+static char *shm_name = NULL;
+
+static monitor_shm_t *shm = NULL;
+static int shm_state = SHM_DETACHED;
+
+/* request being processed, `done' is set to it when finished */
+static uint32_t shm_current = 0;
+
+/* set once the machine has been reset for the first time */
+static int shm_started = 0;
+
+static alarm_t *shm_alarm = NULL;
+
+#ifdef WINDOWS_COMPILE
+static HANDLE shm_handle = NULL;
+#elif defined(HAVE_SHM_OPEN)
+static char *shm_path = NULL;
+#endif
+
+static log_t shm_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+static void *shm_map(void)
+{
+#ifdef WINDOWS_COMPILE
+    void *mapping;
+
+    shm_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                    0, sizeof(monitor_shm_t), shm_name);
+    if (shm_handle == NULL) {
+        return NULL;
+    }
+    mapping = MapViewOfFile(shm_handle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(monitor_shm_t));
+    if (mapping == NULL) {
+        CloseHandle(shm_handle);
+        shm_handle = NULL;
+    }
+    return mapping;
+#elif defined(HAVE_SHM_OPEN)
+    void *mapping;
+    int fd;
+
+    shm_path = util_concat("/", shm_name, NULL);
+    fd = shm_open(shm_path, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        lib_free(shm_path);
+        shm_path = NULL;
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(monitor_shm_t)) < 0) {
+        mapping = MAP_FAILED;
+    } else {
+        mapping = mmap(NULL, sizeof(monitor_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(shm_path);
+        lib_free(shm_path);
+        shm_path = NULL;
+        return NULL;
+    }
+    return mapping;
+#else
+    return NULL;
+#endif
+}
+
+static void shm_unmap(void)
+{
+#ifdef WINDOWS_COMPILE
+    UnmapViewOfFile(shm);
+    CloseHandle(shm_handle);
+    shm_handle = NULL;
+#elif defined(HAVE_SHM_OPEN)
+    munmap(shm, sizeof(monitor_shm_t));
+    shm_unlink(shm_path);
+    lib_free(shm_path);
+    shm_path = NULL;
+#endif
+}
+
+static int shm_open_mapping(void)
+{
+    if (shm_name == NULL || *shm_name == 0) {
+        log_error(shm_log, "No shared memory name given.");
+        return -1;
+    }
+
+    shm = shm_map();
+    if (shm == NULL) {
+        log_error(shm_log, "Cannot create shared memory `%s'.", shm_name);
+        return -1;
+    }
+
+    memset(shm, 0, sizeof(monitor_shm_t));
+    shm->version = MONITOR_SHM_VERSION;
+    shm->size = sizeof(monitor_shm_t);
+    shm->ram_end = 0xffff;
+    shm_current = 0;
+    SHM_BARRIER();
+    SHM_FIELD(magic) = MONITOR_SHM_MAGIC;
+
+    log_message(shm_log, "Shared memory control on `%s'.", shm_name);
+    return 0;
+}
+
+static void shm_close_mapping(void)
+{
+    if (shm == NULL) {
+        return;
+    }
+
+    SHM_FIELD(magic) = 0;
+    shm_unmap();
+    shm = NULL;
+
+    if (shm_alarm != NULL) {
+        alarm_unset(shm_alarm);
+    }
+    shm_state = SHM_DETACHED;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void shm_export(void)
+{
+    mon_reg_list_t *regs, *reg;
+    unsigned int count = 0;
+    unsigned int addr;
+    int bank = (int)shm->ram_bank;
+
+    regs = mon_register_list_get(e_comp_space);
+    for (reg = regs; reg->name != NULL && count < MONITOR_SHM_REGISTERS; reg++) {
+        if (reg->flags & MON_REGISTER_IS_FLAGS) {
+            continue;
+        }
+        shm->registers[count].id = (uint16_t)reg->id;
+        shm->registers[count].size = (uint16_t)reg->size;
+        shm->registers[count].value = reg->val;
+        count++;
+    }
+    lib_free(regs);
+    shm->register_count = (uint16_t)count;
+
+    for (addr = shm->ram_start; addr <= shm->ram_end && addr <= 0xffff; addr++) {
+        shm->ram[addr] = mon_get_mem_val_ex_nosfx(e_comp_space, bank, (uint16_t)addr);
+    }
+
+    shm->clock = (uint64_t)maincpu_clk;
+}
+
+static uint32_t shm_apply_inputs(void)
+{
+    uint32_t error = MONITOR_SHM_ERR_OK;
+    unsigned int i, count;
+    int bank = (int)shm->ram_bank;
+
+    for (i = 0; i < MONITOR_SHM_JOYPORTS; i++) {
+        if ((shm->joyport_set & (1 << i))
+            && mon_joyport_set_output((int)i, shm->joyport[i]) != e_IO_SIM_RESULT_OK) {
+            error = MONITOR_SHM_ERR_INVALID_PARAM;
+        }
+    }
+
+    if ((shm->flags & MONITOR_SHM_FLAG_USERPORT)
+        && mon_userport_set_output(shm->userport) != e_IO_SIM_RESULT_OK) {
+        error = MONITOR_SHM_ERR_INVALID_PARAM;
+    }
+
+    count = shm->poke_count < MONITOR_SHM_POKES ? shm->poke_count : MONITOR_SHM_POKES;
+    for (i = 0; i < count; i++) {
+        mon_set_mem_val_ex(e_comp_space, bank, shm->poke[i].addr, shm->poke[i].value);
+    }
+
+    count = shm->register_set_count < MONITOR_SHM_REGISTERS ? shm->register_set_count : MONITOR_SHM_REGISTERS;
+    for (i = 0; i < count; i++) {
+        monitor_shm_register_t *reg = &shm->register_set[i];
+
+        if (!mon_register_valid(e_comp_space, reg->id)) {
+            error = MONITOR_SHM_ERR_INVALID_PARAM;
+            continue;
+        }
+        monitor_cpu_for_memspace[e_comp_space]->mon_register_set_val(e_comp_space, reg_regid(reg->id), (uint16_t)reg->value);
+    }
+
+    return error;
+}
+
+/* Publish the state after the current request.  */
+static void shm_finish(void)
+{
+    shm_export();
+    SHM_BARRIER();
+    SHM_FIELD(done) = shm_current;
+}
+
+/* Wait for the next request.  Returns 0 if the mapping went away
+   meanwhile.  */
+static int shm_wait_request(void)
+{
+    tick_t start = tick_now();
+
+    while (shm != NULL && SHM_FIELD(request) == shm_current) {
+        if (tick_now_delta(start) > tick_per_second() / 1000) {
+            mainlock_yield_and_sleep(tick_per_second() / 10000);
+        }
+    }
+    if (shm == NULL) {
+        return 0;
+    }
+    SHM_BARRIER();
+    shm_current = SHM_FIELD(request);
+
+    return 1;
+}
+
+static void shm_trap(uint16_t addr, void *data)
+{
+    shm_finish();
+
+    while (shm_wait_request()) {
+        switch (shm->command) {
+            case MONITOR_SHM_CMD_RUN:
+                shm->error = shm_apply_inputs();
+                if (shm->cycles > 0) {
+                    shm_state = SHM_RUNNING;
+                    alarm_set(shm_alarm, maincpu_clk + (CLOCK)shm->cycles);
+                    return;
+                }
+                break;
+            case MONITOR_SHM_CMD_DETACH:
+                shm->error = MONITOR_SHM_ERR_OK;
+                shm_finish();
+                shm_state = SHM_DETACHED;
+                return;
+            default:
+                shm->error = MONITOR_SHM_ERR_INVALID_COMMAND;
+                break;
+        }
+        shm_finish();
+    }
+
+    shm_state = SHM_DETACHED;
+}
+
+static void shm_alarm_handler(CLOCK offset, void *data)
+{
+    alarm_unset(shm_alarm);
+
+    /* the registers can only be accessed from a trap */
+    interrupt_maincpu_trigger_trap(shm_trap, NULL);
+}
+
+static void shm_block(void (*trap)(uint16_t, void *))
+{
+    if (shm_alarm == NULL) {
+        shm_alarm = alarm_new(maincpu_alarm_context, "MonitorShm", shm_alarm_handler, NULL);
+    }
+
+    shm_state = SHM_BLOCKED;
+    interrupt_maincpu_trigger_trap(trap, NULL);
+}
+
+static void shm_start_trap(uint16_t addr, void *data)
+{
+    /* The first reset is executed right after this trap.  */
+    if (shm != NULL && shm_state == SHM_BLOCKED) {
+        interrupt_maincpu_trigger_trap(shm_trap, NULL);
+    }
+}
+
+void monitor_shm_start(void)
+{
+    shm_started = 1;
+
+    if (shm != NULL) {
+        shm_block(shm_start_trap);
+    }
+}
+
+void monitor_shm_vsync_hook(void)
+{
+    if (shm != NULL && shm_state == SHM_DETACHED && SHM_FIELD(request) != shm_current) {
+        shm_block(shm_trap);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_shm_enabled(int value, void *param)
+{
+    int val = value ? 1 : 0;
+
+    if (val == shm_enabled) {
+        return 0;
+    }
+
+    if (val) {
+        if (shm_open_mapping() < 0) {
+            return -1;
+        }
+        if (shm_started) {
+            shm_block(shm_trap);
+        }
+    } else {
+        shm_close_mapping();
+    }
+
+    shm_enabled = val;
+    return 0;
+}
+
+static int set_shm_name(const char *name, void *param)
+{
+    if (shm_name != NULL && name != NULL && strcmp(name, shm_name) == 0) {
+        return 0;
+    }
+
+    util_string_set(&shm_name, name);
+
+    if (shm_enabled) {
+        shm_close_mapping();
+        if (shm_open_mapping() < 0) {
+            shm_enabled = 0;
+            return -1;
+        }
+        if (shm_started) {
+            shm_block(shm_trap);
+        }
+    }
+
+    return 0;
+}
+
+static const resource_string_t resources_string[] = {
+    { "SharedMemoryControlName", "vice", RES_EVENT_NO, NULL,
+      &shm_name, set_shm_name, NULL },
+    RESOURCE_STRING_LIST_END
+};
+
+static const resource_int_t resources_int[] = {
+    { "SharedMemoryControl", 0, RES_EVENT_NO, NULL,
+      &shm_enabled, set_shm_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int monitor_shm_resources_init(void)
+{
+    shm_log = log_open("MonitorShm");
+
+    if (resources_register_string(resources_string) < 0) {
+        return -1;
+    }
+
+    return resources_register_int(resources_int);
+}
+
+void monitor_shm_resources_shutdown(void)
+{
+    shm_close_mapping();
+    lib_free(shm_name);
+    shm_name = NULL;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-shmcontrol", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SharedMemoryControl", (resource_value_t)1,
+      NULL, "Enable the shared memory control interface" },
+    { "+shmcontrol", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SharedMemoryControl", (resource_value_t)0,
+      NULL, "Disable the shared memory control interface" },
+    { "-shmcontrolname", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SharedMemoryControlName", NULL,
+      "<Name>", "The name of the shared memory used for the control interface" },
+    CMDLINE_LIST_END
+};
+
+int monitor_shm_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
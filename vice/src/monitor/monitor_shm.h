@@ -0,0 +1,120 @@
+/*
+ * monitor_shm.h - Shared memory control interface for external programs.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MONITOR_SHM_H
+#define VICE_MONITOR_SHM_H
+
+#include <stdint.h>
+
+/* The layout of the mapping is part of the interface, clients can include
+   this header.  All values are in host byte order.  */
+
+#define MONITOR_SHM_MAGIC       0x45434956  /* "VICE" */
+#define MONITOR_SHM_VERSION     1
+
+#define MONITOR_SHM_JOYPORTS    5
+#define MONITOR_SHM_REGISTERS   32
+#define MONITOR_SHM_POKES       256
+
+/* commands */
+#define MONITOR_SHM_CMD_RUN     0   /* apply the inputs, run `cycles' cycles, then block */
+#define MONITOR_SHM_CMD_DETACH  1   /* let the emulator run freely until the next request */
+
+/* results */
+#define MONITOR_SHM_ERR_OK              0
+#define MONITOR_SHM_ERR_INVALID_COMMAND 1
+#define MONITOR_SHM_ERR_INVALID_PARAM   2   /* a port, register or range was invalid */
+
+/* flags */
+#define MONITOR_SHM_FLAG_USERPORT   0x01    /* set the userport output lines */
+
+typedef struct monitor_shm_register_s {
+    uint16_t id;                /* as in MON_CMD_REGISTERS_AVAILABLE */
+    uint16_t size;              /* in bits */
+    uint32_t value;
+} monitor_shm_register_t;
+
+typedef struct monitor_shm_poke_s {
+    uint16_t addr;
+    uint8_t value;
+    uint8_t unused;
+} monitor_shm_poke_t;
+
+typedef struct monitor_shm_s {
+    /* written by VICE when the mapping is created, `magic' last */
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              /* of the whole mapping */
+
+    /* The client fills in the command, then increments `request'.  VICE
+       sets `done' to `request' once the command finished and the state
+       below has been updated.  */
+    uint32_t request;
+    uint32_t done;
+
+    uint32_t command;           /* MONITOR_SHM_CMD_* */
+    uint32_t error;             /* MONITOR_SHM_ERR_*, result of the last command */
+    uint32_t flags;             /* MONITOR_SHM_FLAG_* */
+
+    uint64_t cycles;            /* cycles to run */
+    uint64_t clock;             /* main CPU clock after the command */
+
+    /* inputs, applied before running */
+    uint16_t joyport[MONITOR_SHM_JOYPORTS];
+    uint16_t joyport_set;       /* bit n set: write joyport[n] */
+    uint16_t userport;
+    uint16_t poke_count;
+    uint16_t register_set_count;
+    uint16_t register_count;    /* number of valid entries in registers[] */
+
+    /* main CPU memory copied into ram[] after the command, inclusive, bank
+       as in MON_CMD_MEMORY_GET.  Keep the range small, every byte is read
+       through the monitor.  */
+    uint32_t ram_start;
+    uint32_t ram_end;
+    uint32_t ram_bank;
+    uint32_t unused;
+
+    monitor_shm_poke_t poke[MONITOR_SHM_POKES];
+    monitor_shm_register_t register_set[MONITOR_SHM_REGISTERS];
+    monitor_shm_register_t registers[MONITOR_SHM_REGISTERS];
+
+    uint8_t ram[0x10000];
+} monitor_shm_t;
+
+#ifdef VICE_VICE_H
+
+int monitor_shm_resources_init(void);
+void monitor_shm_resources_shutdown(void);
+int monitor_shm_cmdline_options_init(void);
+
+/* Start blocking for the client, if enabled.  Called once the machine has
+   been reset for the first time.  */
+void monitor_shm_start(void);
+
+/* Pick up requests posted while the machine runs freely.  */
+void monitor_shm_vsync_hook(void);
+
+#endif
+
+#endif
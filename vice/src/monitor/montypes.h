@@ -176,6 +176,9 @@ struct cond_node_s {
 };
 typedef struct cond_node_s cond_node_t;
 
+/* A condition compiled by mon_compile_conditional() */
+typedef struct cond_program_s cond_program_t;
+
 typedef void monitor_toggle_func_t(int value);
 
 /* Defines */
@@ -241,6 +244,8 @@ extern int exit_mon;
 
 extern RADIXTYPE default_radix;
 extern MEMSPACE default_memspace;
+/* Changed whenever a label is added or removed */
+extern unsigned int mon_symbol_table_serial;
 extern bool asm_mode;
 extern MON_ADDR asm_mode_addr;
 extern struct monitor_cpu_type_s *monitor_cpu_for_memspace[NUM_MEMSPACES];
@@ -272,6 +277,7 @@ void mon_make_dir(const char *path);
 void mon_remove_dir(const char *path);
 void mon_tape_ctrl(int port, int command);
 void mon_tape_offs(int port, int offset);
+void mon_tape_count(int port, int counter);
 void mon_display_screen(long addr);
 void mon_instructions_step(int count);
 void mon_instructions_next(int count);
@@ -291,6 +297,7 @@ int mon_banknum_from_bank(MEMSPACE mem, const char *bankname);
 void mon_display_io_regs(MON_ADDR addr);
 void mon_evaluate_default_addr(MON_ADDR *a);
 void mon_set_mem_val(MEMSPACE mem, uint16_t mem_addr, uint8_t val);
+void mon_set_mem_block(MEMSPACE mem, uint16_t mem_start, uint16_t mem_end, const uint8_t *data);
 void mon_set_mem_val_ex(MEMSPACE mem, int bank, uint16_t mem_addr, uint8_t val);
 bool mon_inc_addr_location(MON_ADDR *a, unsigned inc);
 void mon_start_assemble_mode(MON_ADDR addr, char *asm_line);
@@ -300,8 +307,12 @@ bool check_drive_emu_level_ok(int drive_num);
 void mon_print_conditional(cond_node_t *cnode);
 void mon_delete_conditional(cond_node_t *cnode);
 int mon_evaluate_conditional(cond_node_t *cnode);
+cond_program_t *mon_compile_conditional(cond_node_t *cnode);
+int mon_evaluate_cond_program(const cond_program_t *program);
+void mon_delete_cond_program(cond_program_t *program);
 int mon_write_snapshot(const char* name, int save_roms, int save_disks, int even_mode);
 int mon_read_snapshot(const char* name, int even_mode);
+int mon_rewind(int steps);
 bool mon_is_valid_addr(MON_ADDR a);
 bool mon_is_in_range(MON_ADDR start_addr, MON_ADDR end_addr, unsigned loc);
 void mon_print_bin(int val, char on, char off);
@@ -41,6 +41,10 @@
 #include <strings.h>
 #endif
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #include "archdep.h"
 #include "cmdline.h"
 #include "interrupt.h"
@@ -51,6 +55,10 @@
 #include "mos6510.h"
 #include "network.h"
 #include "resources.h"
+#include "sha1.h"
+#include "snapshot.h"
+#include "sound.h"
+#include "statehash.h"
 #include "types.h"
 #include "uiapi.h"
 #include "util.h"
@@ -86,11 +94,180 @@ static int res_server_port;
 static int frame_delta;
 static int network_control;
 
-static int frame_buffer_full;
-static int current_frame, frame_to_play;
+static int current_frame;
 static event_list_state_t *frame_event_list = NULL;
+static int frame_list_size;
 static char *snapshotfilename;
 
+/* Lockstep mode: the local input of frame `n' is played together with the
+   remote input of frame `n' at the end of frame `n + frame_delta - 1'.  The
+   frames are numbered from the connection on, their local and remote event
+   lists are kept in rings.  The remote side can be up to `frame_delta'
+   frames ahead, hence twice the maximum delta.  */
+
+#define NETWORK_MAX_FRAME_DELTA 60
+#define NETWORK_FRAME_RING      128
+#define LOCKSTEP_SLOT(f)        ((f) & (NETWORK_FRAME_RING - 1))
+
+/* frame being recorded, next frame to play, remote frames received */
+static int lockstep_frame;
+static int lockstep_played;
+static int lockstep_received;
+static event_list_state_t *lockstep_remote[NETWORK_FRAME_RING];
+
+/* Every event buffer sent ends with a timing trailer: its send time, the
+   send time of the newest remote buffer received and how long ago that one
+   arrived.  So each side gets a round trip time sample per frame without
+   extra packets.  In lockstep mode the server adapts `frame_delta' to the
+   round trip times of the last seconds: up as soon as the 90th percentile
+   needs more, down by one frame after a while of needing less.  The change
+   is announced in the trailer too and takes effect `frame_delta' frames
+   later on both sides, when the client has read it for sure.  */
+
+#define NETWORK_TIMING_SIZE         (5 * 4)
+#define NETWORK_TIMING_NO_ECHO      0xffffffffU
+#define NETWORK_RTT_SAMPLES         64
+#define NETWORK_DELTA_CALM_SECONDS  2
+
+static tick_t remote_stamp;
+static tick_t remote_stamp_arrival;
+static int remote_stamp_valid;
+
+/* echoes of buffers sent before this time are void, as one side was
+   suspended meanwhile */
+static tick_t timing_valid_from;
+
+static tick_t rtt_samples[NETWORK_RTT_SAMPLES];
+static unsigned int rtt_count;
+
+/* pending change of `frame_delta' (frame 0 if none), and the frames the
+   delta has been more than needed */
+static int delta_change_frame;
+static int delta_change_value;
+static int delta_calm_frames;
+
+static unsigned int network_stalls;
+static unsigned int delta_changes;
+
+/* Rollback mode (`NetworkRollback' set to N on the server): instead of
+   delaying the input of both sides by the measured frame delta, the input
+   is applied at the end of the frame it was made in, and the remote input
+   of the frames not received yet is predicted to stay as it was (no
+   events).  The ends of frames are numbered from the connection on; the
+   state before applying the input of each of the last frames is kept in
+   memory.  When the real remote event list of an already emulated frame
+   contains events, the state of that frame is restored and the frames up to
+   the current one are emulated again with the real input, without pacing,
+   display or sound.  A side gets at most N frames ahead of the last remote
+   frame it received, then it waits for the remote side as in lockstep mode.
+
+   Frame `f' uses the entry `ROLLBACK_SLOT(f)' of the rings, also of
+   `frame_event_list' for the local event lists.  The sync test compares the
+   CPU registers at the newest frame whose state is final on both sides.  */
+
+#define NETWORK_ROLLBACK_MAX_FRAMES 15
+
+/* more than twice the maximum, as the remote side can be ahead as well */
+#define NETWORK_ROLLBACK_RING       32
+#define ROLLBACK_SLOT(f)            ((f) & (NETWORK_ROLLBACK_RING - 1))
+
+typedef struct rollback_slot_s {
+    /* state before applying the input of frame `state_frame' */
+    snapshot_t *state;
+    int state_frame;
+
+    /* real remote input of frame `remote_frame' */
+    event_list_state_t *remote;
+    int remote_frame;
+
+    /* sync test (registers and state hash) of frame `sync_frame' */
+    uint32_t sync_regs[STATEHASH_SYNC_WORDS];
+    int sync_frame;
+} rollback_slot_t;
+
+static rollback_slot_t rollback_ring[NETWORK_ROLLBACK_RING];
+
+/* `NetworkRollback' resource, and the window used by the connection (0 for
+   lockstep mode) */
+static int network_rollback;
+static int rollback_frames;
+
+/* frames ended in real time, frame the emulation is at, remote frames
+   received */
+static int rollback_sent;
+static int rollback_frame;
+static int rollback_received;
+
+/* frame to restore by the next trap, 0 if none */
+static int rollback_restore_frame;
+static int rollback_trap_pending;
+static int rollback_restoring;
+static int rollback_resimulating;
+
+/* newest frame whose state is final, newest sync test sent, and the sync
+   test of the remote side not compared yet (frame 0 if none) */
+static int rollback_exact;
+static int rollback_sync_sent;
+static int remote_sync_frame;
+static uint32_t remote_sync_regs[STATEHASH_SYNC_WORDS];
+
+static unsigned long rollback_count;
+static unsigned long rollback_frames_resimulated;
+
+/* UDP transport (`NetworkUDP' set on the server): once connected, the
+   messages of the frames (event buffers, and the empty suspend messages)
+   are exchanged over UDP, as a single lost TCP segment holds back all data
+   sent after it until it is retransmitted.  The messages are numbered.
+   Every datagram carries all messages the remote side has not acknowledged
+   yet, as many as fit, and the number of remote messages received in order
+   as acknowledgement.  So the datagram of the next frame repairs a lost one
+   on its own, and a side waiting for the remote side sends its datagram
+   again every few milliseconds.  Messages too big for a datagram go over
+   the TCP connection, with a placeholder in the datagram.  The TCP
+   connection stays open and tells when the remote side disconnects.  */
+
+#define NETWORK_UDP_MAGIC       0x50445556U     /* "VUDP" */
+#define NETWORK_UDP_HELLO       0x4f4c4548U     /* "HELO" */
+#define NETWORK_UDP_HEADER_SIZE (4 * 4)
+#define NETWORK_UDP_PACKET_SIZE 1400
+#define NETWORK_UDP_MAX_MESSAGE 1024
+#define NETWORK_UDP_VIA_TCP     0xffffffffU
+#define NETWORK_UDP_QUEUE       256
+#define NETWORK_UDP_SLOT(n)     ((n) & (NETWORK_UDP_QUEUE - 1))
+#define NETWORK_UDP_RESEND_USEC 10000
+#define NETWORK_UDP_HELLO_USEC  100000
+#define NETWORK_UDP_HELLO_TRIES 50
+
+typedef struct udp_message_s {
+    uint8_t *buf;
+    unsigned int len;   /* NETWORK_UDP_VIA_TCP for a placeholder */
+} udp_message_t;
+
+static int network_udp;
+static vice_network_socket_t *udp_socket = NULL;
+
+/* messages sent but not acknowledged, from `udp_acked' up to `udp_sent' */
+static udp_message_t udp_send_queue[NETWORK_UDP_QUEUE];
+static unsigned int udp_sent;
+static unsigned int udp_acked;
+
+/* messages received in order but not read, from `udp_read' up to
+   `udp_received' */
+static udp_message_t udp_recv_queue[NETWORK_UDP_QUEUE];
+static unsigned int udp_received;
+static unsigned int udp_read;
+
+static unsigned int udp_resends;
+
+/* Buffers kept from frame to frame, so a running netplay session does not
+   allocate: the event buffer sent last, the TCP message received last and
+   one event list state taken back from a played frame.  */
+static uint8_t *frame_send_buf = NULL;
+static unsigned int frame_send_alloc = 0;
+static uint8_t *tcp_recv_buf = NULL;
+static unsigned int tcp_recv_alloc = 0;
+static event_list_state_t *spare_event_list = NULL;
+
 static int set_server_name(const char *val, void *param)
 {
     util_string_set(&server_name, val);
@@ -116,6 +293,24 @@ static int set_server_port(int val, void *param)
     return 0;
 }
 
+static int set_network_rollback(int val, void *param)
+{
+    if (val < 0 || val > NETWORK_ROLLBACK_MAX_FRAMES) {
+        return -1;
+    }
+
+    network_rollback = val;
+
+    return 0;
+}
+
+static int set_network_udp(int val, void *param)
+{
+    network_udp = val ? 1 : 0;
+
+    return 0;
+}
+
 static int set_network_control(int val, void *param)
 {
     network_control = val;
@@ -141,6 +336,10 @@ static const resource_int_t resources_int[] = {
       &res_server_port, set_server_port, NULL },
     { "NetworkControl", NETWORK_CONTROL_DEFAULT, RES_EVENT_SAME, NULL,
       &network_control, set_network_control, NULL },
+    { "NetworkRollback", 0, RES_EVENT_NO, NULL,
+      &network_rollback, set_network_rollback, NULL },
+    { "NetworkUDP", 0, RES_EVENT_NO, NULL,
+      &network_udp, set_network_udp, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -225,6 +424,15 @@ static const cmdline_option_t cmdline_options[] =
     { "-netplayctrl", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
       network_control_cmd, NULL, NULL, NULL,
       "<key,joy1,joy2,dev,rsrc>", "Set the netplay control elements (keyboard, joystick1, joystick2, devices and resources), each item takes a value (0: None, 1: Server, 2: Client, 3: Both)" },
+    { "-netplayrollback", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "NetworkRollback", NULL,
+      "<frames>", "Let the server predict the remote input and roll back up to <frames> frames instead of delaying the input (0: disable, max 15)" },
+    { "-netplayudp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NetworkUDP", (void *)1,
+      NULL, "Let the server exchange the netplay frames over UDP" },
+    { "+netplayudp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "NetworkUDP", (void *)0,
+      NULL, "Let the server exchange the netplay frames over TCP" },
     CMDLINE_LIST_END
 };
 
@@ -236,29 +444,59 @@ int network_cmdline_options_init(void)
 
 /*---------------------------------------------------------------------*/
 
+/* Free an event list made by network_create_event_list().  */
+static void network_free_event_list(event_list_state_t *list)
+{
+    event_clear_list(list);
+    if (spare_event_list == NULL) {
+        spare_event_list = list;
+    } else {
+        lib_free(list);
+    }
+}
+
 static void network_free_frame_event_list(void)
 {
     int i;
     DBG(("network_free_frame_event_list"));
     if (frame_event_list != NULL) {
-        for (i = 0; i < frame_delta; i++) {
+        for (i = 0; i < frame_list_size; i++) {
             event_clear_list(&(frame_event_list[i]));
         }
         lib_free(frame_event_list);
         frame_event_list = NULL;
     }
+    for (i = 0; i < NETWORK_FRAME_RING; i++) {
+        if (lockstep_remote[i] != NULL) {
+            network_free_event_list(lockstep_remote[i]);
+            lockstep_remote[i] = NULL;
+        }
+    }
     event_destroy_image_list();
 }
 
+/* Keep the dirty page tracking for the state hash enabled while connected.  */
+static void network_statehash_enable(int enable)
+{
+    static int enabled = 0;
+
+    if (enable != enabled) {
+        statehash_enable(enable);
+        enabled = enable;
+    }
+}
+
 static void network_event_record_sync_test(uint16_t addr, void *data)
 {
-    uint8_t regbuf[5 * 4];
+    uint32_t regs[STATEHASH_SYNC_WORDS];
+    uint8_t regbuf[STATEHASH_SYNC_WORDS * 4];
+    int i;
+
     DBGT(("network_event_record_sync_test"));
-    util_dword_to_le_buf(&regbuf[0 * 4], (uint32_t)(maincpu_get_pc()));
-    util_dword_to_le_buf(&regbuf[1 * 4], (uint32_t)(maincpu_get_a()));
-    util_dword_to_le_buf(&regbuf[2 * 4], (uint32_t)(maincpu_get_x()));
-    util_dword_to_le_buf(&regbuf[3 * 4], (uint32_t)(maincpu_get_y()));
-    util_dword_to_le_buf(&regbuf[4 * 4], (uint32_t)(maincpu_get_sp()));
+    statehash_sync_test(regs);
+    for (i = 0; i < STATEHASH_SYNC_WORDS; i++) {
+        util_dword_to_le_buf(&regbuf[i * 4], regs[i]);
+    }
 
     network_event_record(EVENT_SYNC_TEST, (void *)regbuf, sizeof(regbuf));
 }
@@ -266,33 +504,284 @@ static void network_event_record_sync_test(uint16_t addr, void *data)
 static void network_init_frame_event_list(void)
 {
     DBG(("network_init_frame_event_list"));
-    frame_event_list = lib_malloc(sizeof(event_list_state_t) * frame_delta);
-    memset(frame_event_list, 0, sizeof(event_list_state_t) * frame_delta);
-    current_frame = 0;
-    frame_buffer_full = 0;
-    event_register_event_list(&(frame_event_list[0]));
+    frame_list_size = NETWORK_FRAME_RING;
+    frame_event_list = lib_calloc(NETWORK_FRAME_RING, sizeof(event_list_state_t));
+    lockstep_frame = 0;
+    lockstep_played = 0;
+    lockstep_received = 0;
+    current_frame = LOCKSTEP_SLOT(0);
+    event_register_event_list(&(frame_event_list[current_frame]));
     event_init_image_list();
+    network_statehash_enable(1);
     interrupt_maincpu_trigger_trap(network_event_record_sync_test, (void *)0);
 }
 
 static void network_prepare_next_frame(void)
 {
     DBGT(("network_prepare_next_frame"));
-    current_frame = (current_frame + 1) % frame_delta;
-    frame_to_play = (current_frame + 1) % frame_delta;
+    current_frame = LOCKSTEP_SLOT(++lockstep_frame);
     event_clear_list(&(frame_event_list[current_frame]));
     event_register_event_list(&(frame_event_list[current_frame]));
     interrupt_maincpu_trigger_trap(network_event_record_sync_test, (void *)0);
 }
 
+/*---------- Image and snapshot transfer ------------------------------*/
+
+/* The snapshot sent on connect and the images attached during the session
+   are compressed.  Both sides keep the images that went over the connection
+   by their SHA-1 hash, so an image the remote side has already got, like a
+   disk attached again after a disk swap, is only sent as its hash.  Attach
+   events with an image travel with a type of their own and are turned back
+   into EVENT_ATTACHIMAGE when they arrive.  */
+
+#define NETWORK_EVENT_ATTACHIMAGE_PACKED    0x100
+#define NETWORK_HASH_SIZE                   20
+#define NETWORK_PACK_HEADER_SIZE            (2 * 4)
+#define NETWORK_MAX_PACKED                  8   /* per event buffer */
+
+typedef struct network_image_s {
+    uint8_t hash[NETWORK_HASH_SIZE];
+    uint8_t *data;
+    size_t size;
+    struct network_image_s *next;
+} network_image_t;
+
+static network_image_t *network_images = NULL;
+
+static network_image_t *network_image_find(const uint8_t *hash)
+{
+    network_image_t *image;
+
+    for (image = network_images; image != NULL; image = image->next) {
+        if (memcmp(image->hash, hash, NETWORK_HASH_SIZE) == 0) {
+            break;
+        }
+    }
+    return image;
+}
+
+static void network_image_add(const uint8_t *hash, const uint8_t *data, size_t size)
+{
+    network_image_t *image;
+
+    if (network_image_find(hash) != NULL) {
+        return;
+    }
+    image = lib_malloc(sizeof(network_image_t));
+    memcpy(image->hash, hash, NETWORK_HASH_SIZE);
+    image->data = lib_malloc(size);
+    memcpy(image->data, data, size);
+    image->size = size;
+    image->next = network_images;
+    network_images = image;
+}
+
+static void network_images_free(void)
+{
+    while (network_images != NULL) {
+        network_image_t *next = network_images->next;
+
+        lib_free(network_images->data);
+        lib_free(network_images);
+        network_images = next;
+    }
+}
+
+/* Put `len' bytes at `data' into a new buffer `*packed', compressed if that
+   makes them smaller, after a header with both sizes.  Returns the size of
+   the buffer.  */
+static unsigned int network_pack(const uint8_t *data, unsigned int len, uint8_t **packed)
+{
+    unsigned int packed_len = len;
+    uint8_t *buf;
+#ifdef HAVE_ZLIB
+    uLongf zlen = compressBound(len);
+
+    buf = lib_malloc(NETWORK_PACK_HEADER_SIZE + zlen);
+    if (compress2(buf + NETWORK_PACK_HEADER_SIZE, &zlen, data, len, Z_BEST_SPEED) == Z_OK
+        && zlen < len) {
+        packed_len = (unsigned int)zlen;
+    } else {
+        memcpy(buf + NETWORK_PACK_HEADER_SIZE, data, len);
+    }
+#else
+    buf = lib_malloc(NETWORK_PACK_HEADER_SIZE + len);
+    memcpy(buf + NETWORK_PACK_HEADER_SIZE, data, len);
+#endif
+
+    util_dword_to_le_buf(&buf[0], len);
+    util_dword_to_le_buf(&buf[4], packed_len);
+    *packed = buf;
+
+    return NETWORK_PACK_HEADER_SIZE + packed_len;
+}
+
+/* Undo network_pack() on the `size' bytes at `packed'.  Returns a new buffer
+   with the data, NULL if `packed' is not valid.  */
+static uint8_t *network_unpack(const uint8_t *packed, unsigned int size, unsigned int *len)
+{
+    unsigned int raw_len, packed_len;
+    uint8_t *data;
+
+    if (size < NETWORK_PACK_HEADER_SIZE) {
+        return NULL;
+    }
+    raw_len = util_le_buf_to_dword((uint8_t *)&packed[0]);
+    packed_len = util_le_buf_to_dword((uint8_t *)&packed[4]);
+    if (packed_len > size - NETWORK_PACK_HEADER_SIZE) {
+        return NULL;
+    }
+
+    data = lib_malloc(raw_len > 0 ? raw_len : 1);
+    if (packed_len == raw_len) {
+        /* stored as it is */
+        memcpy(data, packed + NETWORK_PACK_HEADER_SIZE, raw_len);
+    } else {
+#ifdef HAVE_ZLIB
+        uLongf zlen = raw_len;
+
+        if (uncompress(data, &zlen, packed + NETWORK_PACK_HEADER_SIZE, packed_len) != Z_OK
+            || zlen != raw_len) {
+            lib_free(data);
+            return NULL;
+        }
+#else
+        log_error(LOG_DEFAULT, "Cannot uncompress netplay data without zlib.");
+        lib_free(data);
+        return NULL;
+#endif
+    }
+
+    *len = raw_len;
+    return data;
+}
+
+/* Length of the unit, drive, read-only and file name part of the data of an
+   attach event, 0 if there is no file name.  */
+static unsigned int network_attach_head_size(const uint8_t *data, unsigned int size)
+{
+    const uint8_t *end;
+
+    if (size < 4 || data[3] == 0) {
+        return 0;
+    }
+    end = memchr(data + 3, 0, size - 3);
+    if (end == NULL) {
+        return 0;
+    }
+    return (unsigned int)(end - data) + 1;
+}
+
+/* Make the data of an attach event with an image that is sent to the remote
+   side, in `*packed'.  Returns its size, 0 if the event stays as it is.  */
+static unsigned int network_pack_attach_image(const event_list_t *event, uint8_t **packed)
+{
+    const uint8_t *data = event->data;
+    unsigned int head, image_size, blob_size = 0;
+    uint8_t hash[NETWORK_HASH_SIZE];
+    uint8_t *blob = NULL;
+    uint8_t *buf;
+
+    if (event->type != EVENT_ATTACHIMAGE) {
+        return 0;
+    }
+    head = network_attach_head_size(data, event->size);
+    if (head == 0 || head >= event->size) {
+        return 0;
+    }
+    image_size = event->size - head;
+
+    SHA1(hash, data + head, image_size);
+    if (network_image_find(hash) == NULL) {
+        blob_size = network_pack(data + head, image_size, &blob);
+        network_image_add(hash, data + head, image_size);
+    }
+
+    buf = lib_malloc(head + NETWORK_HASH_SIZE + blob_size);
+    memcpy(buf, data, head);
+    memcpy(buf + head, hash, NETWORK_HASH_SIZE);
+    if (blob != NULL) {
+        memcpy(buf + head + NETWORK_HASH_SIZE, blob, blob_size);
+        lib_free(blob);
+    }
+    *packed = buf;
+
+    return head + NETWORK_HASH_SIZE + blob_size;
+}
+
+/* Turn the data of a packed attach event from the remote side back into
+   that of an EVENT_ATTACHIMAGE, in `*data'.  Returns its size, 0 if the
+   event is not valid.  */
+static unsigned int network_unpack_attach_image(const uint8_t *packed, unsigned int size,
+                                                uint8_t **data)
+{
+    unsigned int head, image_size = 0;
+    const uint8_t *hash;
+    const uint8_t *image = NULL;
+    uint8_t *unpacked = NULL;
+    uint8_t check[NETWORK_HASH_SIZE];
+    network_image_t *known;
+
+    head = network_attach_head_size(packed, size);
+    if (head == 0 || size < head + NETWORK_HASH_SIZE) {
+        log_error(LOG_DEFAULT, "Invalid image attach from the remote side.");
+        return 0;
+    }
+    hash = packed + head;
+
+    if (size == head + NETWORK_HASH_SIZE) {
+        known = network_image_find(hash);
+        if (known != NULL) {
+            image = known->data;
+            image_size = (unsigned int)known->size;
+        } else {
+            log_error(LOG_DEFAULT, "The remote side attached an unknown image.");
+        }
+    } else {
+        unpacked = network_unpack(hash + NETWORK_HASH_SIZE,
+                                  size - head - NETWORK_HASH_SIZE, &image_size);
+        if (unpacked != NULL) {
+            SHA1(check, unpacked, image_size);
+        }
+        if (unpacked != NULL && memcmp(check, hash, NETWORK_HASH_SIZE) == 0) {
+            network_image_add(hash, unpacked, image_size);
+            image = unpacked;
+        } else {
+            log_error(LOG_DEFAULT, "Image from the remote side is damaged.");
+            image_size = 0;
+        }
+    }
+
+    /* without the image the attach fails on playback, like with a missing
+       file */
+    *data = lib_malloc(head + image_size);
+    memcpy(*data, packed, head);
+    if (image != NULL) {
+        memcpy(*data + head, image, image_size);
+    }
+    lib_free(unpacked);
+
+    return head + image_size;
+}
+
+/* Create the buffer sent for the event list, with `trailer_size' bytes
+   reserved at its end.  If `buf_alloc' is not NULL, *buf is a buffer of
+   that size, which is only reallocated when it is too small.  */
 static unsigned int network_create_event_buffer(uint8_t **buf,
-                                                event_list_state_t *list)
+                                                unsigned int *buf_alloc,
+                                                event_list_state_t *list,
+                                                unsigned int trailer_size)
 {
     int size;
     uint8_t *bufptr;
     event_list_t *current_event, *last_event;
     int data_len = 0;
     int num_of_events;
+    uint8_t *packed[NETWORK_MAX_PACKED];
+    unsigned int packed_size[NETWORK_MAX_PACKED];
+    const event_list_t *packed_event[NETWORK_MAX_PACKED];
+    int num_packed = 0;
+    int i;
 
     DBGT(("network_create_event_buffer"));
 
@@ -300,33 +789,63 @@ static unsigned int network_create_event_buffer(uint8_t **buf,
         return 0;
     }
 
-    /* calculate the buffer length */
+    /* calculate the buffer length, images are packed on the way */
     num_of_events = 0;
     current_event = list->base;
     do {
         num_of_events++;
-        data_len += current_event->size;
+        if (current_event->type == EVENT_ATTACHIMAGE && num_packed < NETWORK_MAX_PACKED) {
+            packed_size[num_packed] = network_pack_attach_image(current_event, &packed[num_packed]);
+            if (packed_size[num_packed] > 0) {
+                data_len += packed_size[num_packed];
+                packed_event[num_packed++] = current_event;
+            } else {
+                data_len += current_event->size;
+            }
+        } else {
+            data_len += current_event->size;
+        }
         last_event = current_event;
         current_event = current_event->next;
     } while (last_event->type != EVENT_LIST_END);
 
-    size = num_of_events * 3 * sizeof(uint32_t) + data_len;
+    size = num_of_events * 3 * sizeof(uint32_t) + data_len + trailer_size;
 
-    *buf = lib_malloc(size);
+    if (buf_alloc == NULL) {
+        *buf = lib_malloc(size);
+    } else if ((unsigned int)size > *buf_alloc) {
+        *buf = lib_realloc(*buf, size);
+        *buf_alloc = size;
+    }
 
     /* fill the buffer with the events */
     current_event = list->base;
     bufptr = *buf;
+    i = 0;
     do {
-        util_dword_to_le_buf(&bufptr[0], (uint32_t)(current_event->type));
+        unsigned int type = current_event->type;
+        unsigned int event_size = current_event->size;
+        const void *data = current_event->data;
+
+        if (type == EVENT_ATTACHIMAGE && i < num_packed && packed_event[i] == current_event) {
+            type = NETWORK_EVENT_ATTACHIMAGE_PACKED;
+            event_size = packed_size[i];
+            data = packed[i];
+            i++;
+        }
+        util_dword_to_le_buf(&bufptr[0], (uint32_t)type);
         util_dword_to_le_buf(&bufptr[4], (uint32_t)(current_event->clk));
-        util_dword_to_le_buf(&bufptr[8], (uint32_t)(current_event->size));
-        memcpy(&bufptr[12], current_event->data, current_event->size);
-        bufptr += 12 + current_event->size;
+        util_dword_to_le_buf(&bufptr[8], (uint32_t)event_size);
+        memcpy(&bufptr[12], data, event_size);
+        bufptr += 12 + event_size;
         last_event = current_event;
         current_event = current_event->next;
     } while (last_event->type != EVENT_LIST_END);
 
+    for (i = 0; i < num_packed; i++) {
+        lib_free(packed[i]);
+    }
+
     return size;
 }
 
@@ -339,7 +858,12 @@ static event_list_state_t *network_create_event_list(uint8_t *remote_event_buffe
 
     DBGT(("network_create_event_list entry: %p", bufptr));
 
-    list = lib_malloc(sizeof(event_list_state_t));
+    if (spare_event_list != NULL) {
+        list = spare_event_list;
+        spare_event_list = NULL;
+    } else {
+        list = lib_malloc(sizeof(event_list_state_t));
+    }
     event_register_event_list(list);
 
     if (bufptr == NULL) {
@@ -353,6 +877,16 @@ static event_list_state_t *network_create_event_list(uint8_t *remote_event_buffe
             size = util_le_buf_to_dword(&bufptr[8]);
             data = &bufptr[12];
             bufptr += 12 + size;
+            if (type == NETWORK_EVENT_ATTACHIMAGE_PACKED) {
+                uint8_t *image_data;
+                unsigned int image_size = network_unpack_attach_image(data, size, &image_data);
+
+                if (image_size > 0) {
+                    event_record_in_list(list, EVENT_ATTACHIMAGE, image_data, image_size);
+                    lib_free(image_data);
+                }
+                continue;
+            }
             event_record_in_list(list, type, data, size);
         } while (type != EVENT_LIST_END);
     }
@@ -373,36 +907,562 @@ static int network_recv_buffer(vice_network_socket_t * s, uint8_t *buf, int len)
         if (t < 0) {
             return t;
         }
+        if (t == 0) {
+            /* connection closed */
+            return -1;
+        }
 
         received_total += t;
         buf += t;
     }
-    return 0;
+    return 0;
+}
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+static int network_send_buffer(vice_network_socket_t * s, const uint8_t *buf, int len)
+{
+    int t;
+    int sent_total = 0;
+
+    DBGT(("network_send_buffer len: %d", len));
+    while (sent_total < len) {
+        t = vice_network_send(s, buf, len - sent_total, SEND_FLAGS);
+
+        if (t < 0) {
+            return t;
+        }
+
+        sent_total += t;
+        buf += t;
+    }
+    return 0;
+}
+
+/*---------- Transport ------------------------------------------------*/
+
+static void network_udp_free(void)
+{
+    int i;
+
+    if (udp_socket != NULL) {
+        vice_network_socket_close(udp_socket);
+        udp_socket = NULL;
+    }
+    for (i = 0; i < NETWORK_UDP_QUEUE; i++) {
+        lib_free(udp_send_queue[i].buf);
+        lib_free(udp_recv_queue[i].buf);
+    }
+    memset(udp_send_queue, 0, sizeof(udp_send_queue));
+    memset(udp_recv_queue, 0, sizeof(udp_recv_queue));
+    udp_sent = 0;
+    udp_acked = 0;
+    udp_received = 0;
+    udp_read = 0;
+    udp_resends = 0;
+}
+
+/* Send the messages the remote side has not acknowledged yet.  */
+static void network_udp_transmit(void)
+{
+    uint8_t packet[NETWORK_UDP_PACKET_SIZE];
+    unsigned int n, len, size = NETWORK_UDP_HEADER_SIZE;
+    udp_message_t *msg;
+
+    for (n = udp_acked; n != udp_sent; n++) {
+        msg = &udp_send_queue[NETWORK_UDP_SLOT(n)];
+        len = (msg->len == NETWORK_UDP_VIA_TCP) ? 0 : msg->len;
+        if (size + 4 + len > NETWORK_UDP_PACKET_SIZE) {
+            break;
+        }
+        util_dword_to_le_buf(&packet[size], msg->len);
+        if (len > 0) {
+            memcpy(&packet[size + 4], msg->buf, len);
+        }
+        size += 4 + len;
+    }
+
+    util_dword_to_le_buf(&packet[0 * 4], NETWORK_UDP_MAGIC);
+    util_dword_to_le_buf(&packet[1 * 4], udp_received);
+    util_dword_to_le_buf(&packet[2 * 4], udp_acked);
+    util_dword_to_le_buf(&packet[3 * 4], n - udp_acked);
+
+    /* a failure is like a lost datagram */
+    vice_network_send(udp_socket, packet, size, SEND_FLAGS);
+}
+
+/* Take in the datagrams that arrived.  */
+static void network_udp_process(void)
+{
+    uint8_t packet[NETWORK_UDP_PACKET_SIZE];
+    unsigned int ack, seq, count, len, i;
+    int size, pos;
+    udp_message_t *msg;
+
+    while (vice_network_select_poll_one(udp_socket) > 0) {
+        size = vice_network_receive(udp_socket, packet, sizeof(packet), 0);
+        if (size < 0) {
+            break;
+        }
+        if (size < NETWORK_UDP_HEADER_SIZE
+            || util_le_buf_to_dword(&packet[0 * 4]) != NETWORK_UDP_MAGIC) {
+            continue;
+        }
+        ack = util_le_buf_to_dword(&packet[1 * 4]);
+        seq = util_le_buf_to_dword(&packet[2 * 4]);
+        count = util_le_buf_to_dword(&packet[3 * 4]);
+
+        /* drop what the remote side has received, the slots keep their
+           buffers for the next messages */
+        if ((int)(udp_sent - ack) >= 0 && (int)(ack - udp_acked) > 0) {
+            udp_acked = ack;
+        }
+
+        /* keep the next messages in order, the others are repeats */
+        pos = NETWORK_UDP_HEADER_SIZE;
+        for (i = 0; i < count && pos + 4 <= size; i++, seq++) {
+            len = util_le_buf_to_dword(&packet[pos]);
+            if (len != NETWORK_UDP_VIA_TCP
+                && (len > (unsigned int)(size - pos - 4) || len > NETWORK_UDP_MAX_MESSAGE)) {
+                break;
+            }
+            if (seq == udp_received && udp_received - udp_read < NETWORK_UDP_QUEUE) {
+                msg = &udp_recv_queue[NETWORK_UDP_SLOT(udp_received)];
+                msg->len = len;
+                if (len != NETWORK_UDP_VIA_TCP && len > 0) {
+                    if (msg->buf == NULL) {
+                        msg->buf = lib_malloc(NETWORK_UDP_MAX_MESSAGE);
+                    }
+                    memcpy(msg->buf, &packet[pos + 4], len);
+                }
+                udp_received++;
+            }
+            pos += 4 + ((len == NETWORK_UDP_VIA_TCP) ? 0 : (int)len);
+        }
+    }
+}
+
+/* Wait a bit for datagrams, sending ours again when none comes.  Returns -1
+   when the remote side closed the TCP connection.  */
+static int network_udp_wait(void)
+{
+    vice_network_socket_t *sockets[3];
+    int tcp_data;
+
+    /* the TCP connection only gets readable for big messages, or when
+       closed */
+    tcp_data = vice_network_select_poll_stream(network_socket);
+    if (tcp_data < 0) {
+        return -1;
+    }
+
+    sockets[0] = udp_socket;
+    sockets[1] = tcp_data ? NULL : network_socket;
+    sockets[2] = NULL;
+    if (vice_network_select_multiple_timeout(sockets, NETWORK_UDP_RESEND_USEC) <= 0) {
+        network_udp_transmit();
+        udp_resends++;
+    } else {
+        network_udp_process();
+    }
+    return 0;
+}
+
+/* Set up the UDP transport after the delay test, on both sides.  The
+   client sends hello datagrams until the server answers; then both tell
+   the other over TCP whether they got a datagram through, and UDP is only
+   used if both did.  */
+static int network_udp_connect(void)
+{
+    vice_network_socket_address_t *address;
+    vice_network_socket_t *sockets[2];
+    uint8_t packet[NETWORK_UDP_HEADER_SIZE];
+    uint8_t ok = 0, remote_ok = 0;
+    tick_t start;
+    int i;
+
+    network_udp_free();
+
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        address = vice_network_address_generate(server_bind_address, server_port);
+        if (address != NULL) {
+            udp_socket = vice_network_datagram(address, NULL);
+            vice_network_address_close(address);
+        }
+        if (udp_socket != NULL) {
+            /* the first hello connects the socket to the client */
+            sockets[0] = udp_socket;
+            sockets[1] = NULL;
+            if (vice_network_select_multiple_timeout(sockets,
+                    NETWORK_UDP_HELLO_USEC * NETWORK_UDP_HELLO_TRIES) > 0
+                && vice_network_datagram_accept(udp_socket, packet, sizeof(packet)) == 4
+                && util_le_buf_to_dword(packet) == NETWORK_UDP_HELLO) {
+                /* answer a few times, datagrams get lost */
+                for (i = 0; i < 3; i++) {
+                    vice_network_send(udp_socket, packet, 4, SEND_FLAGS);
+                }
+                ok = 1;
+            }
+        }
+    } else {
+        address = vice_network_address_generate(server_name, server_port);
+        if (address != NULL) {
+            udp_socket = vice_network_datagram(NULL, address);
+            vice_network_address_close(address);
+        }
+        if (udp_socket != NULL) {
+            sockets[0] = udp_socket;
+            sockets[1] = NULL;
+            for (i = 0; i < NETWORK_UDP_HELLO_TRIES && !ok; i++) {
+                util_dword_to_le_buf(packet, NETWORK_UDP_HELLO);
+                vice_network_send(udp_socket, packet, 4, SEND_FLAGS);
+                /* a refusal, until the server is there, wakes up early */
+                start = tick_now();
+                while (!ok && TICK_TO_MICRO(tick_now_delta(start)) < NETWORK_UDP_HELLO_USEC) {
+                    if (vice_network_select_multiple_timeout(sockets, NETWORK_UDP_HELLO_USEC / 10) > 0
+                        && vice_network_receive(udp_socket, packet, sizeof(packet), 0) == 4
+                        && util_le_buf_to_dword(packet) == NETWORK_UDP_HELLO) {
+                        ok = 1;
+                    }
+                }
+            }
+            /* drop the other answers */
+            while (vice_network_select_poll_one(udp_socket) > 0
+                   && vice_network_receive(udp_socket, packet, sizeof(packet), 0) >= 0) {
+            }
+        }
+    }
+
+    if (network_send_buffer(network_socket, &ok, sizeof(ok)) < 0
+        || network_recv_buffer(network_socket, &remote_ok, sizeof(remote_ok)) < 0
+        || !ok || !remote_ok) {
+        log_message(LOG_DEFAULT, "netplay could not exchange datagrams, using TCP.");
+        network_udp_free();
+        return -1;
+    }
+    return 0;
+}
+
+static int network_recv_tcp_message(uint8_t **buf, unsigned int *len)
+{
+    uint8_t len4[4];
+
+    *buf = NULL;
+    if (network_recv_buffer(network_socket, len4, 4) < 0) {
+        return -1;
+    }
+    *len = (unsigned int)util_le_buf4_to_int(len4);
+    if (*len > 0) {
+        if (*len > tcp_recv_alloc) {
+            tcp_recv_buf = lib_realloc(tcp_recv_buf, *len);
+            tcp_recv_alloc = *len;
+        }
+        *buf = tcp_recv_buf;
+        if (network_recv_buffer(network_socket, *buf, (int)*len) < 0) {
+            *buf = NULL;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int network_send_tcp_message(const uint8_t *buf, unsigned int len)
+{
+    uint8_t len4[4];
+
+    util_int_to_le_buf4(len4, (int)len);
+    if (network_send_buffer(network_socket, len4, 4) < 0) {
+        return -1;
+    }
+    if (len > 0 && network_send_buffer(network_socket, buf, (int)len) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Send the message of a frame, an event buffer or an empty suspend
+   message.  */
+static int network_send_message(const uint8_t *buf, unsigned int len)
+{
+    udp_message_t *msg;
+
+    if (udp_socket == NULL) {
+        return network_send_tcp_message(buf, len);
+    }
+
+    while (udp_sent - udp_acked >= NETWORK_UDP_QUEUE) {
+        if (network_udp_wait() < 0) {
+            return -1;
+        }
+    }
+
+    msg = &udp_send_queue[NETWORK_UDP_SLOT(udp_sent)];
+    if (len > NETWORK_UDP_MAX_MESSAGE) {
+        if (network_send_tcp_message(buf, len) < 0) {
+            return -1;
+        }
+        msg->len = NETWORK_UDP_VIA_TCP;
+    } else {
+        msg->len = len;
+        if (len > 0) {
+            if (msg->buf == NULL) {
+                msg->buf = lib_malloc(NETWORK_UDP_MAX_MESSAGE);
+            }
+            memcpy(msg->buf, buf, len);
+        }
+    }
+    udp_sent++;
+
+    network_udp_transmit();
+    return 0;
+}
+
+/* Receive the next message of the remote side, waiting for it.  The buffer
+   is NULL for a suspend message; it belongs to the transport and is only
+   valid until the next message is received.  */
+static int network_recv_message(uint8_t **buf, unsigned int *len)
+{
+    udp_message_t *msg;
+
+    if (udp_socket == NULL) {
+        return network_recv_tcp_message(buf, len);
+    }
+
+    network_udp_process();
+    while (udp_read == udp_received) {
+        if (network_udp_wait() < 0) {
+            return -1;
+        }
+    }
+
+    msg = &udp_recv_queue[NETWORK_UDP_SLOT(udp_read)];
+    udp_read++;
+    if (msg->len == NETWORK_UDP_VIA_TCP) {
+        return network_recv_tcp_message(buf, len);
+    }
+    *buf = msg->len > 0 ? msg->buf : NULL;
+    *len = msg->len;
+    return 0;
+}
+
+/* Is a message of the remote side there to be received?  */
+static int network_message_pending(void)
+{
+    if (udp_socket == NULL) {
+        return vice_network_select_poll_one(network_socket) > 0;
+    }
+
+    network_udp_process();
+    return udp_read != udp_received;
+}
+
+/*---------- Timing ---------------------------------------------------*/
+
+static void network_timing_reset(void)
+{
+    remote_stamp_valid = 0;
+    timing_valid_from = tick_now();
+    rtt_count = 0;
+    delta_change_frame = 0;
+    delta_calm_frames = 0;
+    network_stalls = 0;
+    delta_changes = 0;
+}
+
+static void network_timing_write(uint8_t *trailer)
+{
+    tick_t now = tick_now();
+    int server = (network_mode == NETWORK_SERVER_CONNECTED);
+
+    util_dword_to_le_buf(&trailer[0 * 4], (uint32_t)now);
+    util_dword_to_le_buf(&trailer[1 * 4], (uint32_t)remote_stamp);
+    util_dword_to_le_buf(&trailer[2 * 4], remote_stamp_valid
+                         ? (uint32_t)(now - remote_stamp_arrival)
+                         : NETWORK_TIMING_NO_ECHO);
+    util_dword_to_le_buf(&trailer[3 * 4], server ? (uint32_t)delta_change_frame : 0);
+    util_dword_to_le_buf(&trailer[4 * 4], server ? (uint32_t)delta_change_value : 0);
+}
+
+static void network_timing_read(uint8_t *trailer)
+{
+    tick_t now = tick_now();
+    tick_t echo, rtt;
+    uint32_t hold;
+    int change_frame, change_value;
+
+    remote_stamp = (tick_t)util_le_buf_to_dword(&trailer[0 * 4]);
+    remote_stamp_arrival = now;
+    remote_stamp_valid = 1;
+
+    echo = (tick_t)util_le_buf_to_dword(&trailer[1 * 4]);
+    hold = util_le_buf_to_dword(&trailer[2 * 4]);
+    if (hold != NETWORK_TIMING_NO_ECHO && (int32_t)(echo - timing_valid_from) >= 0) {
+        rtt = now - echo;
+        rtt_samples[rtt_count % NETWORK_RTT_SAMPLES] = rtt > hold ? rtt - hold : 0;
+        rtt_count++;
+    }
+
+    /* a change announced by the server, ignoring repeats of one that
+       took effect already */
+    change_frame = (int)util_le_buf_to_dword(&trailer[3 * 4]);
+    change_value = (int)util_le_buf_to_dword(&trailer[4 * 4]);
+    if (network_mode == NETWORK_CLIENT && rollback_frames == 0
+        && change_frame > lockstep_frame
+        && change_value >= 2 && change_value <= NETWORK_MAX_FRAME_DELTA) {
+        delta_change_frame = change_frame;
+        delta_change_value = change_value;
+    }
+}
+
+static int network_tick_compare(const void *a, const void *b)
+{
+    tick_t ta = *(const tick_t *)a;
+    tick_t tb = *(const tick_t *)b;
+
+    return (ta > tb) - (ta < tb);
+}
+
+/* Round trip time below which `percent' % of the last samples are, 0 if
+   there are no samples.  */
+static tick_t network_rtt_percentile(int percent)
+{
+    tick_t sorted[NETWORK_RTT_SAMPLES];
+    unsigned int n = rtt_count < NETWORK_RTT_SAMPLES ? rtt_count : NETWORK_RTT_SAMPLES;
+
+    if (n == 0) {
+        return 0;
+    }
+    memcpy(sorted, rtt_samples, n * sizeof(tick_t));
+    qsort(sorted, n, sizeof(tick_t), network_tick_compare);
+
+    return sorted[(n - 1) * percent / 100];
+}
+
+/* Frame delta that hides the round trip time `rtt'.  */
+static int network_frames_for_rtt(tick_t rtt)
+{
+    int frames = 2 + (int)(vsync_get_refresh_frequency() * rtt
+                           / (double)tick_per_second());
+
+    return frames < NETWORK_MAX_FRAME_DELTA ? frames : NETWORK_MAX_FRAME_DELTA;
+}
+
+/* Receive the next remote event list.  Returns 1 with the list, 0 for a
+   suspend message of the remote side, or -1 when disconnected.  */
+static int network_recv_event_list(event_list_state_t **list)
+{
+    uint8_t *remote_event_buf;
+    unsigned int recv_len;
+
+    if (network_recv_message(&remote_event_buf, &recv_len) < 0) {
+        ui_display_statustext("Remote host disconnected.", true);
+        network_disconnect();
+        return -1;
+    }
+
+    if (recv_len == 0) {
+        if (suspended == 0) {
+            /* remote host suspended emulation */
+            ui_display_statustext("Remote host suspending...", false);
+            suspended = 1;
+            vsync_suspend_speed_eval();
+        }
+        return 0;
+    }
+
+    if (suspended == 1) {
+        ui_display_statustext("", false);
+        suspended = 0;
+        timing_valid_from = tick_now();
+    }
+
+    if (recv_len >= 3 * sizeof(uint32_t) + NETWORK_TIMING_SIZE) {
+        network_timing_read(&remote_event_buf[recv_len - NETWORK_TIMING_SIZE]);
+    }
+    *list = network_create_event_list(remote_event_buf);
+
+    return 1;
+}
+
+void network_get_status(network_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+
+    if (!network_connected()) {
+        return;
+    }
+
+    status->connected = 1;
+    status->rollback_frames = rollback_frames;
+    status->frame_delta = rollback_frames > 0 ? 0 : frame_delta;
+    if (rtt_count > 0) {
+        status->rtt_usec = (unsigned int)((double)rtt_samples[(rtt_count - 1) % NETWORK_RTT_SAMPLES]
+                                          * 1000000.0 / tick_per_second());
+        status->rtt_p90_usec = (unsigned int)((double)network_rtt_percentile(90)
+                                              * 1000000.0 / tick_per_second());
+    }
+    status->stalls = network_stalls;
+    status->delta_changes = delta_changes;
+    status->udp = (udp_socket != NULL);
+    status->udp_resends = udp_resends;
 }
 
-#ifdef MSG_NOSIGNAL
-#define SEND_FLAGS MSG_NOSIGNAL
-#else
-#define SEND_FLAGS 0
-#endif
+/*---------- Rollback -------------------------------------------------*/
 
-static int network_send_buffer(vice_network_socket_t * s, const uint8_t *buf, int len)
+static void network_rollback_free(void)
 {
-    int t;
-    int sent_total = 0;
+    int i;
 
-    DBGT(("network_send_buffer len: %d", len));
-    while (sent_total < len) {
-        t = vice_network_send(s, buf, len - sent_total, SEND_FLAGS);
+    if (rollback_resimulating) {
+        sound_runahead_end(0);
+        rollback_resimulating = 0;
+    }
 
-        if (t < 0) {
-            return t;
+    for (i = 0; i < NETWORK_ROLLBACK_RING; i++) {
+        if (rollback_ring[i].state != NULL) {
+            snapshot_close(rollback_ring[i].state);
+        }
+        if (rollback_ring[i].remote != NULL) {
+            network_free_event_list(rollback_ring[i].remote);
         }
+    }
+    memset(rollback_ring, 0, sizeof(rollback_ring));
 
-        sent_total += t;
-        buf += t;
+    if (rollback_frames > 0) {
+        log_message(LOG_DEFAULT, "netplay rolled back %lu times, %lu frames emulated again.",
+                    rollback_count, rollback_frames_resimulated);
     }
-    return 0;
+    rollback_frames = 0;
+}
+
+static void network_rollback_init(int frames)
+{
+    DBG(("network_rollback_init frames: %d", frames));
+
+    network_rollback_free();
+
+    rollback_frames = frames;
+    rollback_sent = 0;
+    rollback_frame = 0;
+    rollback_received = 0;
+    rollback_restore_frame = 0;
+    rollback_exact = 0;
+    rollback_sync_sent = 0;
+    remote_sync_frame = 0;
+    rollback_count = 0;
+    rollback_frames_resimulated = 0;
+
+    /* the local event lists of the frames, recording frame 1 */
+    frame_list_size = NETWORK_ROLLBACK_RING;
+    frame_event_list = lib_calloc(NETWORK_ROLLBACK_RING, sizeof(event_list_state_t));
+    current_frame = ROLLBACK_SLOT(1);
+    event_register_event_list(&(frame_event_list[current_frame]));
+    event_init_image_list();
+    network_statehash_enable(1);
 }
 
 #define NUM_OF_TESTPACKETS 50
@@ -416,6 +1476,8 @@ static int network_test_delay(void)
 {
     int i, j, ret = -1;
     uint8_t new_frame_delta = 5; /* default to use on error */
+    uint8_t new_rollback = 0;
+    uint8_t new_udp = 0;
     unsigned char *buf;
     testpacket pkt;
 
@@ -456,12 +1518,25 @@ static int network_test_delay(void)
 
         /* calculate delay with 90% of packets beeing fast enough */
         /* FIXME: This needs some further investigation */
-        new_frame_delta = 5 + (uint8_t)(vsync_get_refresh_frequency()
-                                     * packet_delay[(int)(0.1 * NUM_OF_TESTPACKETS)]
-                                     / (float)tick_per_second());
+        new_frame_delta = (uint8_t)network_frames_for_rtt(
+                              packet_delay[(int)(0.1 * NUM_OF_TESTPACKETS)]) + 3;
+        if (new_frame_delta > NETWORK_MAX_FRAME_DELTA) {
+            new_frame_delta = NETWORK_MAX_FRAME_DELTA;
+        }
         if (network_send_buffer(network_socket, &new_frame_delta, sizeof(new_frame_delta)) < 0) {
             goto exiterror;
         }
+        /* the server decides about rollback */
+        new_rollback = (uint8_t)network_rollback;
+        if (network_send_buffer(network_socket, &new_rollback, sizeof(new_rollback)) < 0) {
+            new_rollback = 0;
+            goto exiterror;
+        }
+        /* and about the transport */
+        new_udp = (uint8_t)network_udp;
+        if (network_send_buffer(network_socket, &new_udp, sizeof(new_udp)) < 0) {
+            goto exiterror;
+        }
     } else {
         DBG(("network_test_delay (client)"));
         /* network_mode == NETWORK_CLIENT */
@@ -472,16 +1547,42 @@ static int network_test_delay(void)
                 goto exiterror;
             }
         }
-        network_recv_buffer(network_socket, &new_frame_delta,
-                            sizeof(new_frame_delta));
+        if (network_recv_buffer(network_socket, &new_frame_delta,
+                                sizeof(new_frame_delta)) < 0
+            || new_frame_delta < 2 || new_frame_delta > NETWORK_MAX_FRAME_DELTA) {
+            new_frame_delta = 5;
+        }
+        if (network_recv_buffer(network_socket, &new_rollback,
+                                sizeof(new_rollback)) < 0
+            || new_rollback > NETWORK_ROLLBACK_MAX_FRAMES) {
+            new_rollback = 0;
+        }
+        if (network_recv_buffer(network_socket, &new_udp, sizeof(new_udp)) < 0) {
+            new_udp = 0;
+        }
+    }
+    if (new_udp) {
+        network_udp_connect();
     }
     ret = 0;
 exiterror:
     network_free_frame_event_list();
+    network_timing_reset();
     frame_delta = new_frame_delta;
-    network_init_frame_event_list();
-    sprintf(st, "Using %d frames delay.", frame_delta);
-    log_debug("netplay connected with %d frames delta.", frame_delta);
+    if (new_rollback > 0) {
+        network_rollback_init(new_rollback);
+        sprintf(st, "Using rollback over up to %d frames.", rollback_frames);
+        log_debug("netplay connected with rollback over up to %d frames (%d frames delta measured).",
+                  rollback_frames, frame_delta);
+    } else {
+        network_init_frame_event_list();
+        sprintf(st, "Using %d frames delay.", frame_delta);
+        log_debug("netplay connected with %d frames delta.", frame_delta);
+    }
+    if (udp_socket != NULL) {
+        strcat(st, " Frames over UDP.");
+        log_debug("netplay exchanges the frames over UDP.");
+    }
     ui_display_statustext(st, true);
     return ret;
 }
@@ -490,8 +1591,9 @@ exiterror:
 static void network_server_connect_trap(uint16_t addr, void *data)
 {
     FILE *f;
-    uint8_t *buf;
+    uint8_t *buf, *packed;
     off_t buf_size;
+    unsigned int packed_size;
     uint8_t send_size4[4];
     int i;
     event_list_state_t settings_list;
@@ -517,13 +1619,19 @@ static void network_server_connect_trap(uint16_t addr, void *data)
         }
         fclose(f);
 
+        /* a new session, the client has none of the images */
+        network_images_free();
+
+        packed_size = network_pack(buf, (unsigned int)buf_size, &packed);
+        lib_free(buf);
+
         ui_display_statustext("Sending snapshot to client...", false);
-        util_int_to_le_buf4(send_size4, (int)buf_size);
+        util_int_to_le_buf4(send_size4, (int)packed_size);
         if ((i = network_send_buffer(network_socket, send_size4, 4)) < 0) {
         } else {
-            i = network_send_buffer(network_socket, buf, (int)buf_size);
+            i = network_send_buffer(network_socket, packed, (int)packed_size);
         }
-        lib_free(buf);
+        lib_free(packed);
         if (i < 0) {
             ui_error("Cannot send snapshot to client");
             ui_display_statustext("", false);
@@ -537,7 +1645,7 @@ static void network_server_connect_trap(uint16_t addr, void *data)
         event_register_event_list(&settings_list);
         resources_get_event_safe_list(&settings_list);
 
-        buf_size = (size_t)network_create_event_buffer(&buf, &(settings_list));
+        buf_size = (size_t)network_create_event_buffer(&buf, NULL, &(settings_list), 0);
         util_int_to_le_buf4(send_size4, (int)buf_size);
 
         if ((i = network_send_buffer(network_socket, send_size4, 4) < 0)) {
@@ -600,8 +1708,7 @@ static void network_client_connect_trap(uint16_t addr, void *data)
 
     event_playback_event_list(settings_list);
 
-    event_clear_list(settings_list);
-    lib_free(settings_list);
+    network_free_event_list(settings_list);
 
     /* read the snapshot */
     if (machine_read_snapshot(snapshotfilename, 0) != 0) {
@@ -760,9 +1867,10 @@ int network_connect_client(void)
 {
     vice_network_socket_address_t * server_addr;
     FILE *f;
-    uint8_t *buf;
+    uint8_t *buf, *packed;
     uint8_t recv_buf4[4];
-    size_t buf_size;
+    size_t packed_size;
+    unsigned int buf_size;
 
     DBG(("network_connect_client (network_mode is: %u)", network_mode));
 
@@ -803,15 +1911,29 @@ int network_connect_client(void)
         return -1;
     }
 
-    buf_size = (size_t)util_le_buf4_to_int(recv_buf4);
-    buf = lib_malloc(buf_size);
+    packed_size = (size_t)util_le_buf4_to_int(recv_buf4);
+    packed = lib_malloc(packed_size);
 
-    if (network_recv_buffer(network_socket, buf, (int)buf_size) < 0) {
+    if (network_recv_buffer(network_socket, packed, (int)packed_size) < 0) {
+        lib_free(packed);
+        lib_free(snapshotfilename);
+        vice_network_socket_close(network_socket);
+        return -1;
+    }
+
+    buf = network_unpack(packed, (unsigned int)packed_size, &buf_size);
+    lib_free(packed);
+    if (buf == NULL) {
+        ui_error("Invalid snapshot from server");
+        fclose(f);
         lib_free(snapshotfilename);
         vice_network_socket_close(network_socket);
         return -1;
     }
 
+    /* a new session, the server has none of the images */
+    network_images_free();
+
     if (fwrite(buf, 1, buf_size, f) == 0) {
         log_debug("network_connect_client write failed.");
     }
@@ -827,6 +1949,9 @@ int network_connect_client(void)
 void network_disconnect(void)
 {
     DBG(("network_disconnect (network_mode was:%u)", network_mode));
+    network_rollback_free();
+    network_statehash_enable(0);
+    network_udp_free();
     vice_network_socket_close(network_socket);
     if (network_mode == NETWORK_SERVER_CONNECTED) {
         network_mode = NETWORK_SERVER;
@@ -839,13 +1964,11 @@ void network_disconnect(void)
 
 void network_suspend(void)
 {
-    int dummy_buf_len = 0;
-
     if (!network_connected() || suspended == 1) {
         return;
     }
 
-    network_send_buffer(network_socket, (uint8_t *)&dummy_buf_len, sizeof(unsigned int));
+    network_send_message(NULL, 0);
 
     suspended = 1;
 }
@@ -856,117 +1979,179 @@ long t1, t2, t3, t4;
 
 static void network_hook_connected_send(void)
 {
-    uint8_t *local_event_buf = NULL;
+    uint8_t *local_event_buf;
     unsigned int send_len;
-    uint8_t send_len4[4];
 
     DBGT(("network_hook_connected_send"));
 
     /* create and send current event buffer */
     network_event_record(EVENT_LIST_END, NULL, 0);
-    send_len = network_create_event_buffer(&local_event_buf, &(frame_event_list[current_frame]));
+    send_len = network_create_event_buffer(&frame_send_buf, &frame_send_alloc,
+                                           &(frame_event_list[current_frame]),
+                                           NETWORK_TIMING_SIZE);
+    local_event_buf = frame_send_buf;
+    network_timing_write(&local_event_buf[send_len - NETWORK_TIMING_SIZE]);
 
 #ifdef NETWORK_TRAFFIC_DEBUG
     t1 = tick_now();
 #endif
 
-    util_int_to_le_buf4(send_len4, (int)send_len);
-    if (network_send_buffer(network_socket, send_len4, 4) < 0) {
-        ui_display_statustext("Remote host disconnected.", true);
-        network_disconnect();
-    } else if (network_send_buffer(network_socket, local_event_buf, send_len) < 0) {
+    if (network_send_message(local_event_buf, send_len) < 0) {
         ui_display_statustext("Remote host disconnected.", true);
         network_disconnect();
     }
 #ifdef NETWORK_TRAFFIC_DEBUG
     t2 = tick_now_after(t1);
 #endif
+}
+
+/* Adapt `frame_delta' to the round trip times measured (server).  */
+static void network_lockstep_adapt(void)
+{
+    int target, new_delta = frame_delta;
+
+    if (network_mode != NETWORK_SERVER_CONNECTED || delta_change_frame != 0
+        || rtt_count < NETWORK_RTT_SAMPLES / 4) {
+        return;
+    }
+
+    target = network_frames_for_rtt(network_rtt_percentile(90));
+    if (target > frame_delta) {
+        new_delta = target;
+        delta_calm_frames = 0;
+    } else if (target < frame_delta) {
+        if (++delta_calm_frames >= NETWORK_DELTA_CALM_SECONDS
+                                   * vsync_get_refresh_frequency()) {
+            new_delta = frame_delta - 1;
+            delta_calm_frames = 0;
+        }
+    } else {
+        delta_calm_frames = 0;
+    }
+
+    if (new_delta != frame_delta) {
+        DBG(("network_lockstep_adapt frame %d: delta %d -> %d",
+             lockstep_frame, frame_delta, new_delta));
+        delta_change_frame = lockstep_frame + frame_delta;
+        delta_change_value = new_delta;
+    }
+}
+
+static void network_lockstep_apply_change(void)
+{
+    char st[256];
+
+    if (delta_change_frame == 0 || lockstep_frame < delta_change_frame) {
+        return;
+    }
+
+    frame_delta = delta_change_value;
+    delta_change_frame = 0;
+    delta_changes++;
+
+    sprintf(st, "Using %d frames delay.", frame_delta);
+    ui_display_statustext(st, true);
+    log_debug("netplay frame delta changed to %d at frame %d.",
+              frame_delta, lockstep_frame);
+}
+
+/* Read the remote event lists that arrived already, so that their round
+   trip times are measured when they come in, not when they are played.  */
+static int network_lockstep_drain(void)
+{
+    event_list_state_t *remote_event_list;
+    int ret;
 
-    lib_free(local_event_buf);
+    while (lockstep_received - lockstep_played < NETWORK_FRAME_RING
+           && network_message_pending()) {
+        ret = network_recv_event_list(&remote_event_list);
+        if (ret < 0) {
+            return -1;
+        }
+        if (ret > 0) {
+            lockstep_remote[LOCKSTEP_SLOT(lockstep_received)] = remote_event_list;
+            lockstep_received++;
+        }
+    }
+    return 0;
 }
 
 static void network_hook_connected_receive(void)
 {
-    uint8_t *remote_event_buf = NULL;
-    unsigned int recv_len;
-    uint8_t recv_len4[4];
     event_list_state_t *remote_event_list;
     event_list_state_t *client_event_list, *server_event_list;
+    int slot, ret;
 
     DBGT(("network_hook_connected_receive"));
 
+    if (suspended == 1) {
+        /* resumed, the buffers read late give no round trip times */
+        timing_valid_from = tick_now();
+    }
     suspended = 0;
 
-    if (current_frame == frame_delta - 1) {
-        frame_buffer_full = 1;
+    network_lockstep_apply_change();
+
+    if (network_lockstep_drain() < 0) {
+        return;
     }
 
-    if (frame_buffer_full) {
-        do {
-            if (network_recv_buffer(network_socket, recv_len4, 4) < 0) {
-                ui_display_statustext("Remote host disconnected.", true);
-                network_disconnect();
+    /* play the frames that are `frame_delta' - 1 frames old, after a
+       change of the delta none or several at once */
+    while (lockstep_played <= lockstep_frame - frame_delta + 1) {
+        if (lockstep_received <= lockstep_played) {
+            network_stalls++;
+        }
+        while (lockstep_received <= lockstep_played) {
+            ret = network_recv_event_list(&remote_event_list);
+            if (ret < 0) {
                 return;
             }
-
-            recv_len = util_le_buf4_to_int(recv_len4);
-            if (recv_len == 0 && suspended == 0) {
-                /* remote host suspended emulation */
-                ui_display_statustext("Remote host suspending...", false);
-                suspended = 1;
-                vsync_suspend_speed_eval();
+            if (ret > 0) {
+                lockstep_remote[LOCKSTEP_SLOT(lockstep_received)] = remote_event_list;
+                lockstep_received++;
             }
-        } while (recv_len == 0);
-
-        if (suspended == 1) {
-            ui_display_statustext("", false);
-        }
-
-        remote_event_buf = lib_malloc(recv_len);
-
-        if (network_recv_buffer(network_socket, remote_event_buf,
-                                recv_len) < 0) {
-            lib_free(remote_event_buf);
-            return;
         }
 
 #ifdef NETWORK_TRAFFIC_DEBUG
         t3 = tick_now_after(t2);
 #endif
 
-        remote_event_list = network_create_event_list(remote_event_buf);
-        lib_free(remote_event_buf);
+        slot = LOCKSTEP_SLOT(lockstep_played);
+        remote_event_list = lockstep_remote[slot];
+        lockstep_remote[slot] = NULL;
 
         if (network_mode == NETWORK_SERVER_CONNECTED) {
             client_event_list = remote_event_list;
-            server_event_list = &(frame_event_list[frame_to_play]);
+            server_event_list = &(frame_event_list[slot]);
         } else {
             server_event_list = remote_event_list;
-            client_event_list = &(frame_event_list[frame_to_play]);
+            client_event_list = &(frame_event_list[slot]);
         }
 
-        /* test for sync */
+        /* test for sync: registers and state hash at the start of the
+           frame */
         if (client_event_list->base->type == EVENT_SYNC_TEST
-            && server_event_list->base->type == EVENT_SYNC_TEST) {
-            int i;
-
-            for (i = 0; i < 5; i++) {
-                if (((uint32_t *)client_event_list->base->data)[i]
-                    != ((uint32_t *)server_event_list->base->data)[i]) {
-                    ui_error("Network out of sync - disconnecting.");
-                    network_disconnect();
-                    /* shouldn't happen but resyncing would be nicer */
-                    break;
-                }
-            }
+            && server_event_list->base->type == EVENT_SYNC_TEST
+            && (client_event_list->base->size != server_event_list->base->size
+                || memcmp(client_event_list->base->data, server_event_list->base->data,
+                          client_event_list->base->size) != 0)) {
+            log_error(LOG_DEFAULT, "netplay out of sync at frame %d.", lockstep_played);
+            ui_error("Network out of sync at frame %d - disconnecting.", lockstep_played);
+            network_disconnect();
+            /* shouldn't happen but resyncing would be nicer */
         }
 
         /* replay the event_lists; server first, then client */
         event_playback_event_list(server_event_list);
         event_playback_event_list(client_event_list);
 
-        event_clear_list(remote_event_list);
-        lib_free(remote_event_list);
+        network_free_event_list(remote_event_list);
+        lockstep_played++;
+
+        if (!network_connected()) {
+            return;
+        }
     }
     network_prepare_next_frame();
 #ifdef NETWORK_TRAFFIC_DEBUG
@@ -974,6 +2159,298 @@ static void network_hook_connected_receive(void)
 #endif
 }
 
+/* Does the event list contain input, anything but the sync test?  */
+static int network_rollback_has_input(event_list_state_t *list)
+{
+    event_list_t *current;
+
+    for (current = list->base; current->type != EVENT_LIST_END; current = current->next) {
+        if (current->type != EVENT_SYNC_TEST) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Remember the sync test in a remote event list for comparing it later.  */
+static void network_rollback_remote_sync(event_list_state_t *list)
+{
+    event_list_t *current;
+    int i;
+
+    for (current = list->base; current->type != EVENT_LIST_END; current = current->next) {
+        if (current->type == EVENT_SYNC_TEST
+            && current->size == (1 + STATEHASH_SYNC_WORDS) * sizeof(uint32_t)) {
+            remote_sync_frame = (int)util_le_buf_to_dword(current->data);
+            for (i = 0; i < STATEHASH_SYNC_WORDS; i++) {
+                remote_sync_regs[i] = util_le_buf_to_dword((uint8_t *)current->data + (i + 1) * 4);
+            }
+        }
+    }
+}
+
+/* Compare the remote sync test once the state of its frame is final here as
+   well.  */
+static void network_rollback_check_sync(void)
+{
+    rollback_slot_t *slot;
+
+    if (remote_sync_frame <= 0 || remote_sync_frame > rollback_exact) {
+        return;
+    }
+
+    slot = &(rollback_ring[ROLLBACK_SLOT(remote_sync_frame)]);
+    if (slot->sync_frame == remote_sync_frame
+        && memcmp(slot->sync_regs, remote_sync_regs, sizeof(remote_sync_regs)) != 0) {
+        log_error(LOG_DEFAULT, "netplay out of sync at frame %d.", remote_sync_frame);
+        ui_error("Network out of sync at frame %d - disconnecting.", remote_sync_frame);
+        network_disconnect();
+    }
+    remote_sync_frame = 0;
+}
+
+/* Add the sync test of the newest final frame to the local event list.  */
+static void network_rollback_record_sync(void)
+{
+    rollback_slot_t *slot;
+    uint8_t regbuf[(1 + STATEHASH_SYNC_WORDS) * 4];
+    int i;
+
+    if (rollback_exact <= rollback_sync_sent) {
+        return;
+    }
+
+    slot = &(rollback_ring[ROLLBACK_SLOT(rollback_exact)]);
+    if (slot->sync_frame != rollback_exact) {
+        return;
+    }
+
+    util_dword_to_le_buf(&regbuf[0], (uint32_t)rollback_exact);
+    for (i = 0; i < STATEHASH_SYNC_WORDS; i++) {
+        util_dword_to_le_buf(&regbuf[(i + 1) * 4], slot->sync_regs[i]);
+    }
+    network_event_record(EVENT_SYNC_TEST, (void *)regbuf, sizeof(regbuf));
+    rollback_sync_sent = rollback_exact;
+}
+
+/* Play the input of `frame', server first, then client.  The remote input
+   not received yet is predicted to be unchanged.  */
+static void network_rollback_play_frame(int frame)
+{
+    rollback_slot_t *slot = &(rollback_ring[ROLLBACK_SLOT(frame)]);
+    event_list_state_t *local_list = &(frame_event_list[ROLLBACK_SLOT(frame)]);
+    event_list_state_t *remote_list = NULL;
+
+    if (slot->remote != NULL && slot->remote_frame == frame) {
+        remote_list = slot->remote;
+    }
+
+    if (network_mode == NETWORK_SERVER_CONNECTED) {
+        event_playback_event_list(local_list);
+        if (remote_list != NULL) {
+            event_playback_event_list(remote_list);
+        }
+    } else {
+        if (remote_list != NULL) {
+            event_playback_event_list(remote_list);
+        }
+        event_playback_event_list(local_list);
+    }
+}
+
+/* Triggers at the end of each frame in rollback mode: restores the state of
+   a mispredicted frame or saves the state of the next frame, then plays the
+   input of the frame.  */
+static void network_rollback_trap(uint16_t addr, void *data)
+{
+    rollback_slot_t *slot;
+    const uint8_t *state;
+    size_t size;
+    int frame;
+    int ret;
+
+    rollback_trap_pending = 0;
+
+    if (!network_connected() || rollback_frames == 0) {
+        return;
+    }
+
+    if (rollback_restore_frame > 0) {
+        frame = rollback_restore_frame;
+        rollback_restore_frame = 0;
+        slot = &(rollback_ring[ROLLBACK_SLOT(frame)]);
+        DBG(("network_rollback_trap: back to frame %d of %d", frame, rollback_sent));
+
+        if (slot->state == NULL || slot->state_frame != frame) {
+            ui_error("Network rollback state lost - disconnecting.");
+            network_disconnect();
+            return;
+        }
+
+        /* the samples of the frames emulated again were played already */
+        if (!rollback_resimulating) {
+            sound_runahead_begin();
+            rollback_resimulating = 1;
+        }
+
+        state = snapshot_mem_get_data(slot->state, &size);
+        rollback_restoring = 1;
+        ret = machine_read_snapshot_mem(state, size, 0);
+        rollback_restoring = 0;
+
+        if (ret < 0) {
+            ui_error("Cannot restore the network rollback state - disconnecting.");
+            network_disconnect();
+            return;
+        }
+
+        rollback_count++;
+        rollback_frames_resimulated += (unsigned long)(rollback_sent - frame);
+    } else {
+        frame = rollback_frame + 1;
+        slot = &(rollback_ring[ROLLBACK_SLOT(frame)]);
+
+        if (slot->state != NULL) {
+            snapshot_close(slot->state);
+        }
+        slot->state = machine_write_snapshot_mem(0, SNAPSHOT_DISKS_REFERENCE, 0);
+        slot->state_frame = frame;
+
+        if (slot->state == NULL) {
+            ui_error("Cannot save the network rollback state - disconnecting.");
+            network_disconnect();
+            return;
+        }
+    }
+
+    /* before the input, which can reset the CPU */
+    statehash_sync_test(slot->sync_regs);
+    slot->sync_frame = frame;
+
+    network_rollback_play_frame(frame);
+
+    /* all the input before this frame is real */
+    if (frame <= rollback_received + 1 && frame > rollback_exact) {
+        rollback_exact = frame;
+    }
+
+    rollback_frame = frame;
+
+    if (rollback_resimulating && rollback_frame == rollback_sent) {
+        rollback_resimulating = 0;
+        sound_runahead_end(0);
+    }
+}
+
+static void network_rollback_trigger(void)
+{
+    if (!rollback_trap_pending) {
+        rollback_trap_pending = 1;
+        interrupt_maincpu_trigger_trap(network_rollback_trap, (void *)0);
+    }
+}
+
+/* Receive the remote frames that arrived, waiting for them while `frame' is
+   more than the rollback window ahead.  A remote frame emulated already with
+   a wrong prediction makes the next trap restore it.  */
+static int network_rollback_receive(int frame)
+{
+    event_list_state_t *remote_event_list;
+    rollback_slot_t *slot;
+    int remote_frame, ret;
+
+    if (frame - rollback_received > rollback_frames
+        && !network_message_pending()) {
+        network_stalls++;
+    }
+
+    while (frame - rollback_received > rollback_frames
+           || network_message_pending()) {
+        ret = network_recv_event_list(&remote_event_list);
+        if (ret < 0) {
+            return -1;
+        }
+        if (ret == 0) {
+            continue;
+        }
+
+        remote_frame = ++rollback_received;
+        slot = &(rollback_ring[ROLLBACK_SLOT(remote_frame)]);
+        if (slot->remote != NULL) {
+            network_free_event_list(slot->remote);
+        }
+        slot->remote = remote_event_list;
+        slot->remote_frame = remote_frame;
+
+        network_rollback_remote_sync(remote_event_list);
+
+        if (remote_frame <= rollback_frame
+            && network_rollback_has_input(remote_event_list)
+            && (rollback_restore_frame == 0 || remote_frame < rollback_restore_frame)) {
+            rollback_restore_frame = remote_frame;
+        }
+    }
+
+    return 0;
+}
+
+static void network_hook_rollback(void)
+{
+    int frame;
+
+    if (rollback_frame < rollback_sent) {
+        /* end of a frame emulated again */
+        network_rollback_trigger();
+        return;
+    }
+
+    suspended = 0;
+    frame = ++rollback_sent;
+
+    /* send the local input of the frame */
+    network_rollback_record_sync();
+    network_hook_connected_send();
+    if (!network_connected()) {
+        return;
+    }
+
+    /* record the next frame */
+    current_frame = ROLLBACK_SLOT(frame + 1);
+    event_clear_list(&(frame_event_list[current_frame]));
+    event_register_event_list(&(frame_event_list[current_frame]));
+
+    if (network_rollback_receive(frame) < 0) {
+        return;
+    }
+
+    /* the states up to a mispredicted frame, or up to the received input,
+       are final */
+    if (rollback_restore_frame > 0) {
+        if (rollback_restore_frame > rollback_exact) {
+            rollback_exact = rollback_restore_frame;
+        }
+    } else if (rollback_exact < rollback_frame && rollback_exact < rollback_received + 1) {
+        rollback_exact = rollback_frame < rollback_received + 1 ? rollback_frame : rollback_received + 1;
+    }
+
+    network_rollback_check_sync();
+    if (!network_connected()) {
+        return;
+    }
+
+    network_rollback_trigger();
+}
+
+bool network_rollback_in_progress(void)
+{
+    return rollback_resimulating != 0;
+}
+
+bool network_rollback_restoring(void)
+{
+    return rollback_restoring != 0;
+}
+
 void network_hook(void)
 {
     if (network_mode == NETWORK_IDLE) {
@@ -991,8 +2468,14 @@ void network_hook(void)
         }
     }
 
-    if (network_connected()) {
+    if (network_connected() && rollback_frames > 0) {
+        network_hook_rollback();
+    } else if (network_connected()) {
+        network_lockstep_adapt();
         network_hook_connected_send();
+        if (!network_connected()) {
+            return;
+        }
         network_hook_connected_receive();
         DBGT(("network_hook timing: %5ld %5ld %5ld; total: %5ld",
                   t2 - t1, t3 - t2, t4 - t3, t4 - t1));
@@ -1006,12 +2489,23 @@ void network_shutdown(void)
     }
 
     network_free_frame_event_list();
+    network_images_free();
+    lib_free(frame_send_buf);
+    frame_send_buf = NULL;
+    frame_send_alloc = 0;
+    lib_free(tcp_recv_buf);
+    tcp_recv_buf = NULL;
+    tcp_recv_alloc = 0;
+    lib_free(spare_event_list);
+    spare_event_list = NULL;
     lib_free(server_name);
     lib_free(server_bind_address);
 }
 
 #else
 
+#include <string.h>
+
 #include "network.h"
 
 int network_resources_init(void)
@@ -1065,4 +2559,19 @@ int network_get_mode(void)
 {
     return NETWORK_IDLE;
 }
+
+bool network_rollback_in_progress(void)
+{
+    return false;
+}
+
+bool network_rollback_restoring(void)
+{
+    return false;
+}
+
+void network_get_status(network_status_t *status)
+{
+    memset(status, 0, sizeof(*status));
+}
 #endif
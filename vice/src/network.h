@@ -27,6 +27,8 @@
 #ifndef VICE_NETWORK_H
 #define VICE_NETWORK_H
 
+#include <stdbool.h>
+
 typedef enum {
     NETWORK_IDLE,
     NETWORK_SERVER,
@@ -63,6 +65,28 @@ void network_hook(void);
 void network_event_record(unsigned int type, void *data, unsigned int size);
 void network_attach_image(unsigned int unit, const char *filename);
 
+/* True while the frames after a rolled back one are emulated again: nothing
+   but the emulation itself must happen, no pacing, display or sound.  */
+bool network_rollback_in_progress(void);
+
+/* True while the state of a rolled back frame is being restored.  */
+bool network_rollback_restoring(void);
+
+/* Connection statistics, see network_get_status().  */
+typedef struct network_status_s {
+    int connected;              /* a client is connected, or connected to */
+    int rollback_frames;        /* rollback window, 0 in lockstep mode */
+    int frame_delta;            /* input delay in frames (lockstep mode) */
+    unsigned int rtt_usec;      /* last round trip time measured */
+    unsigned int rtt_p90_usec;  /* 90th percentile of the last round trips */
+    unsigned int stalls;        /* frames that waited for the remote side */
+    unsigned int delta_changes; /* times the input delay was adapted */
+    int udp;                    /* frames are exchanged over UDP */
+    unsigned int udp_resends;   /* datagrams sent again while waiting */
+} network_status_t;
+
+void network_get_status(network_status_t *status);
+
 void network_shutdown(void);
 
 #endif
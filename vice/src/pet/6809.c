@@ -26,12 +26,16 @@
 
 #include "6809.h"
 #include "alarm.h"
+#include "archdep_exit.h"
+#include "cmdline.h"
 #include "h6809regs.h"
 #include "interrupt.h"
+#include "log.h"
 #include "monitor.h"
 #include "petmem.h"
 #include "snapshot.h"
 #include "machine.h"
+#include "vsync.h"
 
 static void request_nmi(unsigned int source);
 static void req_irq(unsigned int source);
@@ -2741,6 +2745,127 @@ static void st32(uint32_t arg, int CLK6809, int CLK6309)
 
 #endif
 
+/* ------------------------------------------------------------------------- */
+
+/* With -6809bench <cycles> the 6809 runs a fixed program at $3000 instead of
+   the Waterloo ROMs, in warp mode and with interrupts masked, when it starts
+   after the first reset.  After <cycles> cycles the time taken and the
+   emulated speed are printed to stdout and the emulator exits.  The program
+   only touches $3000-$39FF, the stack below $3F00 and the direct page at
+   $3800, and mixes direct, extended, indexed, prefixed and stack
+   instructions with a subroutine call.  */
+
+#define H6809BENCH_ADDR 0x3000
+
+static const uint8_t h6809bench_code[] = {
+    /* $3000 */ 0x1a, 0x50,             /*        ORCC #$50         */
+    /* $3002 */ 0x10, 0xce, 0x3f, 0x00, /*        LDS #$3F00        */
+    /* $3006 */ 0x86, 0x38,             /*        LDA #$38          */
+    /* $3008 */ 0x1f, 0x8b,             /*        TFR A,DP          */
+    /* $300a */ 0x8e, 0x38, 0x00,       /* loop:  LDX #$3800        */
+    /* $300d */ 0x10, 0x8e, 0x39, 0x00, /*        LDY #$3900        */
+    /* $3011 */ 0xc6, 0x00,             /*        LDB #$00          */
+    /* $3013 */ 0xe7, 0x80,             /* inner: STB ,X+           */
+    /* $3015 */ 0xeb, 0xa4,             /*        ADDB ,Y           */
+    /* $3017 */ 0xa7, 0x25,             /*        STA 5,Y           */
+    /* $3019 */ 0xd7, 0x10,             /*        STB <$10          */
+    /* $301b */ 0x96, 0x10,             /*        LDA <$10          */
+    /* $301d */ 0x10, 0x83, 0x12, 0x34, /*        CMPD #$1234       */
+    /* $3021 */ 0x34, 0x06,             /*        PSHS D            */
+    /* $3023 */ 0x8d, 0x1b,             /*        BSR sub           */
+    /* $3025 */ 0x35, 0x06,             /*        PULS D            */
+    /* $3027 */ 0x8c, 0x39, 0x00,       /*        CMPX #$3900       */
+    /* $302a */ 0x26, 0xe7,             /*        BNE inner         */
+    /* $302c */ 0x7e, 0x30, 0x0a,       /*        JMP loop          */
+    /* $302f */ 0x12,
+    /* $3030 */ 0x12, 0x12, 0x12, 0x12, 0x12, 0x12, 0x12, 0x12,
+    /* $3038 */ 0x12, 0x12, 0x12, 0x12, 0x12, 0x12, 0x12, 0x12,
+    /* $3040 */ 0x3d,                   /* sub:   MUL               */
+    /* $3041 */ 0x1f, 0x89,             /*        TFR A,B           */
+    /* $3043 */ 0x39                    /*        RTS               */
+};
+
+static CLOCK h6809bench_cycles = 0;
+static CLOCK h6809bench_start_clk;
+static tick_t h6809bench_start_tick;
+
+static alarm_t *h6809bench_alarm = NULL;
+
+static void h6809bench_alarm_handler(CLOCK offset, void *data)
+{
+    CLOCK cycles = CLK - h6809bench_start_clk;
+    double seconds = (double)tick_now_delta(h6809bench_start_tick) / tick_per_second();
+
+    alarm_unset(h6809bench_alarm);
+
+    if (seconds <= 0.0) {
+        seconds = 1.0 / tick_per_second();
+    }
+
+    fprintf(stdout, "6809BENCH: %"PRIu64" cycles in %.3f s: %.2f MHz\n",
+            (uint64_t)cycles, seconds, (double)cycles / seconds / 1000000.0);
+    fflush(stdout);
+
+    archdep_vice_exit(EXIT_SUCCESS);
+}
+
+static void h6809bench_start(alarm_context_t *cpu_alarm_context)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(h6809bench_code); i++) {
+        write8(H6809BENCH_ADDR + i, h6809bench_code[i]);
+    }
+    for (i = 0; i < sizeof(h6809bench_code); i++) {
+        if (read8(H6809BENCH_ADDR + i) != h6809bench_code[i]) {
+            log_error(LOG_DEFAULT, "No 6809 RAM at $%04x, cannot run the benchmark.",
+                      H6809BENCH_ADDR + i);
+            archdep_vice_exit(EXIT_FAILURE);
+            return;
+        }
+    }
+
+    PC = H6809BENCH_ADDR;
+
+    log_message(LOG_DEFAULT, "Running 6809 benchmark for %"PRIu64" cycles.",
+                (uint64_t)h6809bench_cycles);
+
+    vsync_set_warp_mode(1);
+
+    h6809bench_alarm = alarm_new(cpu_alarm_context, "6809Bench", h6809bench_alarm_handler, NULL);
+    h6809bench_start_clk = CLK;
+    h6809bench_start_tick = tick_now();
+    alarm_set(h6809bench_alarm, CLK + h6809bench_cycles);
+}
+
+static int cmdline_6809bench(const char *param, void *extra_param)
+{
+    char *end;
+    unsigned long long cycles = strtoull(param, &end, 0);
+
+    if (*end != 0 || cycles == 0) {
+        return -1;
+    }
+    h6809bench_cycles = (CLOCK)cycles;
+
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-6809bench", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_6809bench, NULL, NULL, NULL,
+      "<cycles>", "Run a fixed 6809 benchmark for <cycles> cycles, print the emulated speed, then quit" },
+    CMDLINE_LIST_END
+};
+
+int cpu6809_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* Execute 6809 code for a certain number of cycles. */
 void h6809_mainloop (struct interrupt_cpu_status_s *maincpu_intstatus, alarm_context_t *maincpu_alarm_context)
 {
@@ -2750,6 +2875,10 @@ void h6809_mainloop (struct interrupt_cpu_status_s *maincpu_intstatus, alarm_con
     uint8_t post_byte;
 #endif
 
+    if (h6809bench_cycles != 0 && h6809bench_alarm == NULL) {
+        h6809bench_start(maincpu_alarm_context);
+    }
+
     do {
 #ifndef CYCLE_EXACT_ALARM
         while (CLK >= alarm_context_next_pending_clk(ALARM_CONTEXT)) {
@@ -73,12 +73,12 @@ typedef unsigned int absolute_address_t;
 #define C_FLAG 0x01
 
 /* Primitive read/write macros */
-#define read8(addr)      mem6809_read((addr))
-#define write8(addr, val) mem6809_store((addr), (val))
+#define read8(addr)      mem6809_read_direct((uint16_t)(addr))
+#define write8(addr, val) mem6809_store_direct((uint16_t)(addr), (uint8_t)(val))
 
 
 /* 16-bit versions */
-#define read16(addr)       mem6809_read16((addr))
+#define read16(addr)       mem6809_read16_direct((uint16_t)(addr))
 #define write16(addr, val)                   \
     do {                                     \
         write8((addr) + 1, (val) & 0xFF);    \
@@ -107,6 +107,7 @@ typedef unsigned int absolute_address_t;
 /* 6809.c */
 void h6809_mainloop(struct interrupt_cpu_status_s *, struct alarm_context_s *);
 void cpu6809_reset(void);
+int cpu6809_cmdline_options_init(void);
 
 struct snapshot_s;
 
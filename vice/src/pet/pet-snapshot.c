@@ -60,18 +60,8 @@
 #define SNAP_MAJOR 1
 #define SNAP_MINOR 0
 
-int pet_snapshot_write(const char *name, int save_roms, int save_disks,
-                       int event_mode)
+static int pet_snapshot_write_modules(snapshot_t *s, int save_roms, int save_disks, int event_mode)
 {
-    snapshot_t *s;
-    int ef = 0;
-
-    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_name);
-
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     if (maincpu_snapshot_write_module(s) < 0
@@ -88,13 +78,30 @@ int pet_snapshot_write(const char *name, int save_roms, int save_disks,
         || tapeport_snapshot_write_module(s, save_disks) < 0
         || keyboard_snapshot_write_module(s) < 0
         || userport_snapshot_write_module(s) < 0) {
-        ef = -1;
+        return -1;
+    }
+
+    if (petres.model.superpet) {
+        return acia1_snapshot_write_module(s);
     }
 
-    if ((!ef) && petres.model.superpet) {
-        ef = acia1_snapshot_write_module(s);
+    return 0;
+}
+
+int pet_snapshot_write(const char *name, int save_roms, int save_disks,
+                       int event_mode)
+{
+    snapshot_t *s;
+    int ef;
+
+    s = snapshot_create(name, SNAP_MAJOR, SNAP_MINOR, machine_name);
+
+    if (s == NULL) {
+        return -1;
     }
 
+    ef = pet_snapshot_write_modules(s, save_roms, save_disks, event_mode);
+
     snapshot_close(s);
 
     if (ef) {
@@ -104,18 +111,29 @@ int pet_snapshot_write(const char *name, int save_roms, int save_disks,
     return ef;
 }
 
-int pet_snapshot_read(const char *name, int event_mode)
+snapshot_t *pet_snapshot_write_mem(int save_roms, int save_disks, int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
-    int ef = 0;
 
-    s = snapshot_open(name, &major, &minor, machine_name);
+    s = snapshot_create_mem(SNAP_MAJOR, SNAP_MINOR, machine_name);
 
     if (s == NULL) {
-        return -1;
+        return NULL;
     }
 
+    if (pet_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+/* Read the modules of an opened snapshot; `s' is closed in any case.  */
+static int pet_snapshot_read_modules(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
+    int ef = 0;
+
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -154,3 +172,31 @@ int pet_snapshot_read(const char *name, int event_mode)
 
     return ef;
 }
+
+int pet_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_name);
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    return pet_snapshot_read_modules(s, major, minor, event_mode);
+}
+
+int pet_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open_mem(data, size, &major, &minor, machine_name);
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    return pet_snapshot_read_modules(s, major, minor, event_mode);
+}
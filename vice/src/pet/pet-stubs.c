@@ -42,6 +42,11 @@ int cartridge_attach_image(int type, const char *name)
     return -1;
 }
 
+int cartridge_attach_image_from_memory(const uint8_t *data, size_t size, const char *filename)
+{
+    return -1;
+}
+
 void cartridge_detach_image(int type)
 {
 }
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "6809.h"
 #include "attach.h"
 #include "autostart.h"
 #include "bbrtc.h"
@@ -512,6 +513,10 @@ int machine_cmdline_options_init(void)
         init_cmdline_options_fail("pet");
         return -1;
     }
+    if (cpu6809_cmdline_options_init() < 0) {
+        init_cmdline_options_fail("6809");
+        return -1;
+    }
     if (cartio_cmdline_options_init() < 0) {
         init_cmdline_options_fail("cartio");
         return -1;
@@ -974,6 +979,16 @@ int machine_read_snapshot(const char *name, int event_mode)
     return pet_snapshot_read(name, event_mode);
 }
 
+snapshot_t *machine_write_snapshot_mem(int save_roms, int save_disks, int event_mode)
+{
+    return pet_snapshot_write_mem(save_roms, save_disks, event_mode);
+}
+
+int machine_read_snapshot_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    return pet_snapshot_read_mem(data, size, event_mode);
+}
+
 
 /* ------------------------------------------------------------------------- */
 
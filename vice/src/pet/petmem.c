@@ -65,6 +65,7 @@
 
 static uint8_t mem_read_patchbuf(uint16_t addr);
 static void mem_initialize_memory_6809_flat(void);
+static void mem6809_update_pages(void);
 
 uint8_t petmem_2001_buf_ef[256];
 
@@ -139,9 +140,13 @@ static int mem6809_read_limit_tab[0x101];
 read_func_ptr_t *_mem6809_read_tab_ptr;
 store_func_ptr_t *_mem6809_write_tab_ptr;
 
+/* Plain memory behind the pages of the current 6809 configuration */
+uint8_t *_mem6809_read_page_tab[0x101];
+uint8_t *_mem6809_write_page_tab[0x101];
+
 static log_t pet_mem_log = LOG_ERR;
 
-static uint8_t last_access = 0;
+uint8_t petmem_last_access = 0;
 
 /* Current watchpoint state.
           0 = no watchpoints
@@ -154,50 +159,50 @@ static int watchpoints_active = 0;
 
 uint8_t zero_read(uint16_t addr)
 {
-    last_access = mem_ram[addr & 0xff];
-    return last_access;
+    petmem_last_access = mem_ram[addr & 0xff];
+    return petmem_last_access;
 }
 
 void zero_store(uint16_t addr, uint8_t value)
 {
     mem_ram[addr & 0xff] = value;
-    last_access = value;
+    petmem_last_access = value;
 }
 
 static uint8_t ram_read(uint16_t addr)
 {
-    last_access = mem_ram[addr];
-    return last_access;
+    petmem_last_access = mem_ram[addr];
+    return petmem_last_access;
 }
 
 static void ram_store(uint16_t addr, uint8_t value)
 {
     mem_ram[addr] = value;
-    last_access = value;
+    petmem_last_access = value;
 }
 
 static uint8_t read_ext8(uint16_t addr)
 {
-    last_access = mem_ram[addr + bank8offset];
-    return last_access;
+    petmem_last_access = mem_ram[addr + bank8offset];
+    return petmem_last_access;
 }
 
 static void store_ext8(uint16_t addr, uint8_t value)
 {
     mem_ram[addr + bank8offset] = value;
-    last_access = value;
+    petmem_last_access = value;
 }
 
 static uint8_t read_extC(uint16_t addr)
 {
-    last_access = mem_ram[addr + bankCoffset];
-    return last_access;
+    petmem_last_access = mem_ram[addr + bankCoffset];
+    return petmem_last_access;
 }
 
 static void store_extC(uint16_t addr, uint8_t value)
 {
     mem_ram[addr + bankCoffset] = value;
-    last_access = value;
+    petmem_last_access = value;
 }
 
 /*
@@ -207,15 +212,15 @@ static void store_extC(uint16_t addr, uint8_t value)
  */
 static uint8_t read_vmem(uint16_t addr)
 {
-    last_access = mem_ram[0x8000 + (addr & 0x3fff)];
-    return last_access;
+    petmem_last_access = mem_ram[0x8000 + (addr & 0x3fff)];
+    return petmem_last_access;
 }
 
 static void store_vmem(uint16_t addr, uint8_t value)
 {
     addr &= 0x3fff;
     mem_ram[0x8000 + addr] = value;
-    last_access = value;
+    petmem_last_access = value;
 #if CRTC_BEAM_RACING
     crtc_update_prefetch(addr, value);
 #endif
@@ -231,15 +236,15 @@ static void store_vmem(uint16_t addr, uint8_t value)
  */
 static uint8_t read_vmirror(uint16_t addr)
 {
-    last_access = mem_ram[0x8000 + (addr & 0x0bff)];   /* 0x3FF + 0x800 */
-    return last_access;
+    petmem_last_access = mem_ram[0x8000 + (addr & 0x0bff)];   /* 0x3FF + 0x800 */
+    return petmem_last_access;
 }
 
 static void store_vmirror(uint16_t addr, uint8_t value)
 {
     addr &= 0x0bff;
     mem_ram[0x8000 + addr] = value;
-    last_access = value;
+    petmem_last_access = value;
 #if CRTC_BEAM_RACING
     if (addr < 0x0400) {
         crtc_update_prefetch(addr, value);
@@ -253,15 +258,15 @@ static void store_vmirror(uint16_t addr, uint8_t value)
  */
 static uint8_t read_vmirror_2001(uint16_t addr)
 {
-    last_access = mem_ram[0x8000 + (addr & 0x03ff)];
-    return last_access;
+    petmem_last_access = mem_ram[0x8000 + (addr & 0x03ff)];
+    return petmem_last_access;
 }
 
 static void store_vmirror_2001(uint16_t addr, uint8_t value)
 {
     addr &= 0x03ff;
     mem_ram[0x8000 + addr] = value;
-    last_access = value;
+    petmem_last_access = value;
 #if CRTC_BEAM_RACING
     crtc_update_prefetch(addr, value);
 #endif
@@ -269,35 +274,35 @@ static void store_vmirror_2001(uint16_t addr, uint8_t value)
 
 uint8_t rom_read(uint16_t addr)
 {
-    last_access = mem_rom[addr & 0x7fff];
-    return last_access;
+    petmem_last_access = mem_rom[addr & 0x7fff];
+    return petmem_last_access;
 }
 
 void rom_store(uint16_t addr, uint8_t value)
 {
     mem_rom[addr & 0x7fff] = value;
-    last_access = value;
+    petmem_last_access = value;
 }
 
 #define ROM6809_BASE    0xA000
 
 static uint8_t rom6809_read(uint16_t addr)
 {
-    last_access = mem_6809rom[addr - ROM6809_BASE];
-    return last_access;
+    petmem_last_access = mem_6809rom[addr - ROM6809_BASE];
+    return petmem_last_access;
 }
 
 #if 0
 static void rom6809_store(uint16_t addr, uint8_t value)
 {
     mem_6809rom[addr - ROM6809_BASE] = value;
-    last_access = value;
+    petmem_last_access = value;
 }
 #endif
 
 uint8_t read_unused(uint16_t addr)
 {
-    return last_access;
+    return petmem_last_access;
 }
 
 static uint8_t read_io_88_8f(uint16_t addr)
@@ -321,7 +326,7 @@ static uint8_t read_io_88_8f(uint16_t addr)
             return petio_8f00_read(addr);
     }
 
-    return last_access;
+    return petmem_last_access;
 }
 
 static uint8_t read_io_e9_ef(uint16_t addr)
@@ -343,13 +348,13 @@ static uint8_t read_io_e9_ef(uint16_t addr)
             return petio_ef00_read(addr);
     }
 
-    return last_access;
+    return petmem_last_access;
 }
 
 static uint8_t mem_read_patchbuf(uint16_t addr)
 {
-    last_access = petmem_2001_buf_ef[addr & 0xff];
-    return last_access;
+    petmem_last_access = petmem_2001_buf_ef[addr & 0xff];
+    return petmem_last_access;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -446,8 +451,8 @@ static void reset6702(void)
 
 static inline uint8_t read6702(void)
 {
-    last_access = dongle6702.val;
-    return last_access;
+    petmem_last_access = dongle6702.val;
+    return petmem_last_access;
 }
 
 /*
@@ -506,7 +511,7 @@ static inline uint8_t read6702(void)
  */
 static inline void write6702(uint8_t input)
 {
-    last_access = input;
+    petmem_last_access = input;
 
     if ((input & 1) == dongle6702.wantodd) {
         if (dongle6702.wantodd) {
@@ -578,6 +583,7 @@ static int efe0_dump(void)
 void set_spet_bank(int banknr)
 {
     spet_bank_ptr = &mem_ram[EXT_RAM + (banknr << 12)];
+    mem6809_update_pages();
 }
 
 void petmem_reset(void)
@@ -601,6 +607,7 @@ static void superpet_mem_powerup(void)
 /* Those two are not reset by a soft reset (/RES), only by power down */
     spet_diag = 0;
     spet_ramwp = 0;     /* should look at hardware switch */
+    mem6809_update_pages();
 }
 
 int petmem_superpet_diag(void)
@@ -611,29 +618,29 @@ int petmem_superpet_diag(void)
 static uint8_t read_super_io(uint16_t addr)
 {
     if (addr >= 0xeff4) {       /* unused / readonly */
-        return last_access;
+        return petmem_last_access;
     } else if (addr >= 0xeff0) {       /* ACIA */
-        last_access = acia1_read((uint16_t)(addr & 0x03));
+        petmem_last_access = acia1_read((uint16_t)(addr & 0x03));
     } else if ((addr & 0x0010) == 0) {
         /* Dongle E F xxx0 xxxx, see zimmers.net,
          * schematics/computers/pet/SuperPET/324055.gif.
          * Typical address is $EFE0, possibly EFE0...3.
          */
         if (addr >= 0xefe0 && addr < 0xefe4) {
-            last_access = read6702();
+            petmem_last_access = read6702();
 #if DEBUG_DONGLE
-            log_message(pet_mem_log, "*** DONGLE %04x -> 0x%02X %3d", addr, last_access, last_access);
+            log_message(pet_mem_log, "*** DONGLE %04x -> 0x%02X %3d", addr, petmem_last_access, petmem_last_access);
 #endif /* DEBUG_DONGLE */
         } else {
-            last_access = 0xff;
+            petmem_last_access = 0xff;
         }
     }
-    return last_access;   /* fallback */
+    return petmem_last_access;   /* fallback */
 }
 
 static void store_super_io(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
 
     if (addr >= 0xeffe) {       /* RAM/ROM switch */
         spet_ramen = !(value & 1);
@@ -691,21 +698,24 @@ static void store_super_io(uint16_t addr, uint8_t value)
             write6702(value);
         }
     }
+
+    /* RAM enable and write protection decide what $9000 maps to */
+    mem6809_update_pages();
 }
 
 static uint8_t read_super_9(uint16_t addr)
 {
     if (spet_ramen) {
-        last_access = spet_bank_ptr[addr & 0x0fff];
+        petmem_last_access = spet_bank_ptr[addr & 0x0fff];
     } else {
-        last_access = rom_read(addr);
+        petmem_last_access = rom_read(addr);
     }
-    return last_access;
+    return petmem_last_access;
 }
 
 static void store_super_9(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
 
     if (spet_ramen && !spet_ramwp) {
         spet_bank_ptr[addr & 0x0fff] = value;
@@ -714,13 +724,13 @@ static void store_super_9(uint16_t addr, uint8_t value)
 
 static uint8_t read_super_flat(uint16_t addr)
 {
-    last_access = (mem_ram + EXT_RAM)[addr];
-    return last_access;
+    petmem_last_access = (mem_ram + EXT_RAM)[addr];
+    return petmem_last_access;
 }
 
 static void store_super_flat(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
     (mem_ram + EXT_RAM)[addr] = value;
 }
 
@@ -832,7 +842,7 @@ uint32_t mem6809_read32(uint16_t addr)
 
 static void store_io_e8(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
 
     if (addr & 0x10) {
         pia1_store(addr, value);
@@ -864,20 +874,20 @@ static uint8_t read_io_e8(uint16_t addr)
 
     switch (addr & 0xf0) {
         case 0x10:              /* PIA1 */
-            last_access = pia1_read(addr);
+            petmem_last_access = pia1_read(addr);
             break;
         case 0x20:              /* PIA2 */
-            last_access = pia2_read(addr);
+            petmem_last_access = pia2_read(addr);
             break;
         case 0x40:
-            last_access = via_read(addr); /* VIA */
+            petmem_last_access = via_read(addr); /* VIA */
             break;
         case 0x80:              /* CRTC */
             if (petres.model.crtc) {
-                last_access = crtc_read(addr);
+                petmem_last_access = crtc_read(addr);
             } /* fall through */
         case 0x00:
-            return last_access;
+            return petmem_last_access;
         default:                /* 0x30, 0x50, 0x60, 0x70, 0x90-0xf0 */
             if (addr & 0x10) {
                 v1 = pia1_read(addr);
@@ -898,14 +908,14 @@ static uint8_t read_io_e8(uint16_t addr)
             if ((addr & 0x80) && petres.model.crtc) {
                 v4 = crtc_read(addr);
             }
-            last_access = v1 & v2 & v3 & v4;
+            petmem_last_access = v1 & v2 & v3 & v4;
     }
-    return last_access;
+    return petmem_last_access;
 }
 
 static void store_void(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
 }
 
 /*
@@ -915,12 +925,12 @@ static void store_void(uint16_t addr, uint8_t value)
  */
 static void store_dummy(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
 }
 
 static void store_io_88_8f(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
 
     switch (addr & 0xff00) {
         case 0x8800:
@@ -952,7 +962,7 @@ static void store_io_88_8f(uint16_t addr, uint8_t value)
 
 static void store_io_e9_ef(uint16_t addr, uint8_t value)
 {
-    last_access = value;
+    petmem_last_access = value;
 
     switch (addr & 0xff00) {
         case 0xe900:
@@ -1213,6 +1223,7 @@ void mem_toggle_watchpoints(int flag, void *context)
 
     mem_update_tab_ptrs(flag);
     watchpoints_active = flag;
+    mem6809_update_pages();
 }
 
 /*
@@ -1267,7 +1278,7 @@ static void store_8x96(uint16_t addr, uint8_t value)
     uint8_t changed;
     int l, protected;
 
-    last_access = value;
+    petmem_last_access = value;
 
     if (store_ff) {
         store_ff(addr, value);
@@ -1455,6 +1466,51 @@ void petmem_set_vidmem(void)
 
 /* ------------------------------------------------------------------------- */
 
+/* Find the pages where the 6809 can access RAM or ROM directly.  Called on
+   every change of the 6809 tables, of the $9000 bank and its RAM enable and
+   write protection, and of the watchpoint state.  While watchpoints are
+   active all accesses go through the tables.  */
+static void mem6809_update_pages(void)
+{
+    int i;
+
+    for (i = 0; i < 0x100; i++) {
+        read_func_ptr_t rf = _mem6809_read_tab[i];
+        store_func_ptr_t sf = _mem6809_write_tab[i];
+        uint8_t *rp = NULL;
+        uint8_t *wp = NULL;
+
+        if (!watchpoints_active) {
+            if (rf == ram_read) {
+                rp = mem_ram + (i << 8);
+            } else if (rf == zero_read) {
+                rp = mem_ram;
+            } else if (rf == rom6809_read) {
+                rp = mem_6809rom + (i << 8) - ROM6809_BASE;
+            } else if (rf == read_super_flat) {
+                rp = mem_ram + EXT_RAM + (i << 8);
+            } else if (rf == read_super_9 && spet_ramen) {
+                rp = spet_bank_ptr + ((i << 8) & 0x0fff);
+            }
+
+            if (sf == ram_store) {
+                wp = mem_ram + (i << 8);
+            } else if (sf == zero_store) {
+                wp = mem_ram;
+            } else if (sf == store_super_flat) {
+                wp = mem_ram + EXT_RAM + (i << 8);
+            } else if (sf == store_super_9 && spet_ramen && !spet_ramwp) {
+                wp = spet_bank_ptr + ((i << 8) & 0x0fff);
+            }
+        }
+
+        _mem6809_read_page_tab[i] = rp;
+        _mem6809_write_page_tab[i] = wp;
+    }
+    _mem6809_read_page_tab[0x100] = NULL;
+    _mem6809_write_page_tab[0x100] = NULL;
+}
+
 static void mem_initialize_memory_6809_banked(void)
 {
     int i;
@@ -1496,6 +1552,7 @@ static void mem_initialize_memory_6809_banked(void)
     _mem6809_read_base_tab[0x100] = _mem6809_read_base_tab[0];
     mem6809_read_limit_tab[0x100] = -1;
 
+    mem6809_update_pages();
     /* maincpu_resync_limits(); notyet: 6809 doesn't use bank_base yet. */
 }
 
@@ -1514,6 +1571,8 @@ static void mem_initialize_memory_6809_flat(void)
 
     _mem6809_read_base_tab[0x100] = _mem6809_read_base_tab[0];
     mem6809_read_limit_tab[0x100] = -1;
+
+    mem6809_update_pages();
     /* maincpu_resync_limits(); notyet: 6809 doesn't use bank_base yet. */
 }
 
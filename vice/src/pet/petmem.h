@@ -92,6 +92,42 @@ extern store_func_t mem6809_store;
 void mem6809_store16(uint16_t addr, uint16_t value);
 uint16_t mem6809_read16(uint16_t addr);
 
+/* Pointers to the plain memory of each 6809 page, for accesses without the
+   read and write tables; NULL where the tables must be used.  */
+extern uint8_t *_mem6809_read_page_tab[0x101];
+extern uint8_t *_mem6809_write_page_tab[0x101];
+extern uint8_t petmem_last_access;
+
+inline static uint8_t mem6809_read_direct(uint16_t addr)
+{
+    uint8_t *p = _mem6809_read_page_tab[addr >> 8];
+
+    if (p != NULL) {
+        petmem_last_access = p[addr & 0xff];
+        return petmem_last_access;
+    }
+    return mem6809_read(addr);
+}
+
+inline static void mem6809_store_direct(uint16_t addr, uint8_t value)
+{
+    uint8_t *p = _mem6809_write_page_tab[addr >> 8];
+
+    if (p != NULL) {
+        petmem_last_access = value;
+        p[addr & 0xff] = value;
+        return;
+    }
+    mem6809_store(addr, value);
+}
+
+inline static uint16_t mem6809_read16_direct(uint16_t addr)
+{
+    uint16_t val = mem6809_read_direct(addr) << 8;
+
+    return val | mem6809_read_direct((uint16_t)(addr + 1));
+}
+
 #ifdef H6309
 void mem6809_store32(uint16_t addr, uint32_t value);
 uint32_t mem6809_read32(uint16_t addr);
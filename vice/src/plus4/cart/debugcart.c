@@ -27,10 +27,12 @@
 #include "vice.h"
 
 #include "archdep.h"
+#include "batch.h"
 #include "cartio.h"
 #include "cartridge.h"
 #include "cmdline.h"
 #include "export.h"
+#include "forkserver.h"
 #include "lib.h"
 #include "resources.h"
 #include "machine.h"
@@ -74,8 +76,12 @@ static const export_resource_t export_res = {
 static void debugcart_store(uint16_t addr, uint8_t value)
 {
     int n = (int)value;
+
+    if (forkserver_debugcart_write(value)) {
+        return;
+    }
     fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %"PRIu64"\n", n, maincpu_clk);
-    archdep_vice_exit(n);
+    batch_vice_exit(n);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -277,6 +277,7 @@ static void digiblaster_sound_machine_store(sound_t *psid, uint16_t addr, uint8_
 
 static void digiblaster_sound_reset(sound_t *psid, CLOCK cpu_clk)
 {
+    sound_dac_discard(&digiblaster_dac);
     snd.voice0 = 0;
     digiblaster_sound_data = 0;
 }
@@ -287,7 +288,11 @@ static void digiblaster_store(uint16_t addr, uint8_t value)
 {
     if ((addr & 1) == 0) {
         digiblaster_sound_data = value;
-        sound_store(digiblaster_sound_chip_offset, value, 0);
+        if (sound_dac_store(&digiblaster_dac, (int)value * 128) == 0) {
+            snd.voice0 = value;
+        } else {
+            sound_store(digiblaster_sound_chip_offset, value, 0);
+        }
     }
 }
 
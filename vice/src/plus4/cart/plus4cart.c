@@ -779,6 +779,12 @@ exiterror:
     return -1;
 }
 
+/* CRT images in memory are only supported by the C64 and C128 so far */
+int cartridge_attach_image_from_memory(const uint8_t *data, size_t size, const char *filename)
+{
+    return -1;
+}
+
 /* FIXME: todo */
 void cartridge_trigger_freeze(void)
 {
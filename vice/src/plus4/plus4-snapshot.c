@@ -61,17 +61,8 @@
 #define SNAP_MAJOR 2
 #define SNAP_MINOR 0
 
-int plus4_snapshot_write(const char *name, int save_roms, int save_disks,
-                         int event_mode)
+static int plus4_snapshot_write_modules(snapshot_t *s, int save_roms, int save_disks, int event_mode)
 {
-    snapshot_t *s;
-
-    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)),
-                        machine_name);
-    if (s == NULL) {
-        return -1;
-    }
-
     sound_snapshot_prepare();
 
     /* Execute drive CPUs to get in sync with the main CPU.  */
@@ -88,27 +79,55 @@ int plus4_snapshot_write(const char *name, int save_roms, int save_disks,
         || joyport_snapshot_write_module(s, JOYPORT_1) < 0
         || joyport_snapshot_write_module(s, JOYPORT_2) < 0
         || userport_snapshot_write_module(s) < 0) {
-        snapshot_close(s);
-        archdep_remove(name);
         DBG(("error writing snapshot modules.\n"));
         return -1;
     }
     DBG(("all snapshots written.\n"));
-    snapshot_close(s);
     return 0;
 }
 
-int plus4_snapshot_read(const char *name, int event_mode)
+int plus4_snapshot_write(const char *name, int save_roms, int save_disks,
+                         int event_mode)
 {
     snapshot_t *s;
-    uint8_t minor, major;
-
-    s = snapshot_open(name, &major, &minor, machine_name);
 
+    s = snapshot_create(name, ((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)),
+                        machine_name);
     if (s == NULL) {
         return -1;
     }
 
+    if (plus4_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        archdep_remove(name);
+        return -1;
+    }
+
+    snapshot_close(s);
+    return 0;
+}
+
+snapshot_t *plus4_snapshot_write_mem(int save_roms, int save_disks, int event_mode)
+{
+    snapshot_t *s;
+
+    s = snapshot_create_mem(((uint8_t)(SNAP_MAJOR)), ((uint8_t)(SNAP_MINOR)),
+                        machine_name);
+    if (s == NULL) {
+        return NULL;
+    }
+
+    if (plus4_snapshot_write_modules(s, save_roms, save_disks, event_mode) < 0) {
+        snapshot_close(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+/* Read the modules of an opened snapshot; `s' is closed in any case.  */
+static int plus4_snapshot_read_modules(snapshot_t *s, uint8_t major, uint8_t minor, int event_mode)
+{
     if (!snapshot_version_is_equal(major, minor, SNAP_MAJOR, SNAP_MINOR)) {
         log_error(LOG_DEFAULT, "Snapshot version (%d.%d) not valid: expecting %d.%d.", major, minor, SNAP_MAJOR, SNAP_MINOR);
         snapshot_set_error(SNAPSHOT_MODULE_INCOMPATIBLE);
@@ -150,3 +169,30 @@ fail:
     DBG(("error loading snapshot modules.\n"));
     return -1;
 }
+
+int plus4_snapshot_read(const char *name, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open(name, &major, &minor, machine_name);
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    return plus4_snapshot_read_modules(s, major, minor, event_mode);
+}
+
+int plus4_snapshot_read_mem(const uint8_t *data, size_t size, int event_mode)
+{
+    snapshot_t *s;
+    uint8_t minor, major;
+
+    s = snapshot_open_mem(data, size, &major, &minor, machine_name);
+    if (s == NULL) {
+        return -1;
+    }
+
+    return plus4_snapshot_read_modules(s, major, minor, event_mode);
+}
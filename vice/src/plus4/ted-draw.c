@@ -180,8 +180,8 @@ inline static int cache_data_fill_text(uint8_t *dest,
 
 /*-----------------------------------------------------------------------*/
 
-/* FIXME: in the cache, we store the foreground bitmap values for the
-   characters, but we do not use them when drawing and this is slow!  */
+/* The cached draw functions take everything from the cache, which holds
+   the same data as the TED buffers for the columns that are drawn.  */
 
 /* Standard text mode.  */
 
@@ -467,14 +467,42 @@ static void draw_hires_bitmap(void)
     ted.raster.idle_background_color = ted.vbuf[TED_SCREEN_TEXTCOLS - 1] & 0x7f;
 }
 
+inline static void _draw_hires_bitmap_cached(uint8_t *p, unsigned int xs,
+                                             unsigned int xe,
+                                             raster_cache_t *cache)
+{
+    uint8_t *foreground_data, *vbuf_hi, *vbuf_lo, *cbuf;
+    unsigned int i;
+    uint32_t *ptr;
+
+    foreground_data = cache->foreground_data;
+    vbuf_hi = cache->color_data_1;
+    vbuf_lo = cache->background_data;
+    cbuf = cache->color_data_2;
+
+    for (i = xs; i <= xe; i++) {
+        int d;
+
+        ptr = hr_table
+              + ((cbuf[i] & 0x07) << 15) + (vbuf_hi[i] << 11)
+              + ((cbuf[i] & 0x70) << 4) + (vbuf_lo[i] << 4);
+
+        d = foreground_data[i];
+        *((uint32_t *)p + i * 2) = *(ptr + (d >> 4));
+        *((uint32_t *)p + i * 2 + 1) = *(ptr + (d & 0xf));
+    }
+}
+
 static void draw_hires_bitmap_cached(raster_cache_t *cache, unsigned int xs,
                                      unsigned int xe)
 {
-    ALIGN_DRAW_FUNC(_draw_hires_bitmap, xs, xe);
+    ALIGN_DRAW_FUNC_CACHE(_draw_hires_bitmap_cached, xs, xe, cache);
 
     /* Overscan color in HIRES is determined by last char of previous line */
     if (xe == TED_SCREEN_TEXTCOLS - 1) {
-        ted.raster.idle_background_color = ted.vbuf[TED_SCREEN_TEXTCOLS - 1] & 0x7f;
+        ted.raster.idle_background_color =
+            ((cache->color_data_1[TED_SCREEN_TEXTCOLS - 1] << 4)
+             | cache->background_data[TED_SCREEN_TEXTCOLS - 1]) & 0x7f;
     }
 }
 
@@ -491,21 +519,31 @@ static void draw_hires_bitmap_foreground(unsigned int start_char,
 static int get_mc_text(raster_cache_t *cache, unsigned int *xs,
                        unsigned int *xe, int rr)
 {
+    uint8_t vbuf[TED_SCREEN_TEXTCOLS];
+    uint8_t mask = ted.reverse_mode ? 0xff : 0x7f;
+    unsigned int i;
     int r;
 
     if (ted.raster.background_color != cache->background_data[0]
         || cache->color_data_1[0] != ted.ext_background_color[0]
         || cache->color_data_1[1] != ted.ext_background_color[1]
+        || cache->color_data_1[2] != mask
         || cache->chargen_ptr != ted.chargen_ptr) {
         cache->background_data[0] = ted.raster.background_color;
         cache->color_data_1[0] = ted.ext_background_color[0];
         cache->color_data_1[1] = ted.ext_background_color[1];
+        cache->color_data_1[2] = mask;
         cache->chargen_ptr = ted.chargen_ptr;
         rr = 1;
     }
 
+    /* without reverse mode, bit 7 of the character code is ignored */
+    for (i = 0; i < TED_SCREEN_TEXTCOLS; i++) {
+        vbuf[i] = ted.vbuf[i] & mask;
+    }
+
     r = raster_cache_data_fill_text(cache->foreground_data,
-                                    ted.vbuf,
+                                    vbuf,
                                     ted.chargen_ptr + ted.raster.ycounter,
                                     TED_SCREEN_TEXTCOLS,
                                     xs, xe,
@@ -554,10 +592,41 @@ static void draw_mc_text(void)
     ALIGN_DRAW_FUNC(_draw_mc_text, 0, TED_SCREEN_TEXTCOLS - 1);
 }
 
+inline static void _draw_mc_text_cached(uint8_t *p, unsigned int xs,
+                                        unsigned int xe,
+                                        raster_cache_t *cache)
+{
+    uint8_t c[12];
+    uint8_t *foreground_data, *color_data;
+    uint16_t *ptmp;
+    unsigned int i, d;
+
+    foreground_data = cache->foreground_data;
+    color_data = cache->color_data_3;
+
+    c[1] = c[0] = cache->background_data[0];
+    c[3] = c[2] = cache->color_data_1[0];
+    c[5] = c[4] = cache->color_data_1[1];
+    c[11] = c[8] = cache->background_data[0];
+
+    ptmp = (uint16_t *)(p + xs * 8);
+    for (i = xs; i <= xe; i++) {
+        d = foreground_data[i] | ((color_data[i] & 0x8) << 5);
+
+        c[10] = c[9] = c[7] = c[6] = color_data[i] & 0x77;
+
+        ptmp[0] = ((uint16_t *)c)[mc_table[d]];
+        ptmp[1] = ((uint16_t *)c)[mc_table[0x200 + d]];
+        ptmp[2] = ((uint16_t *)c)[mc_table[0x400 + d]];
+        ptmp[3] = ((uint16_t *)c)[mc_table[0x600 + d]];
+        ptmp += 4;
+    }
+}
+
 static void draw_mc_text_cached(raster_cache_t *cache, unsigned int xs,
                                 unsigned int xe)
 {
-    ALIGN_DRAW_FUNC(_draw_mc_text, xs, xe);
+    ALIGN_DRAW_FUNC_CACHE(_draw_mc_text_cached, xs, xe, cache);
 }
 
 /* FIXME: aligned/unaligned versions.  */
@@ -704,10 +773,42 @@ static void draw_mc_bitmap(void)
     ALIGN_DRAW_FUNC(_draw_mc_bitmap, 0, TED_SCREEN_TEXTCOLS - 1);
 }
 
+inline static void _draw_mc_bitmap_cached(uint8_t *p, unsigned int xs,
+                                          unsigned int xe,
+                                          raster_cache_t *cache)
+{
+    uint8_t *foreground_data, *vbuf, *cbuf, *ptmp;
+    uint8_t c[4];
+    unsigned int i;
+
+    foreground_data = cache->foreground_data;
+    vbuf = cache->color_data_1;
+    cbuf = cache->color_data_2;
+
+    c[0] = cache->background_data[0];
+    c[3] = cache->color_data_3[0];
+
+    ptmp = p + xs * 8;
+    for (i = xs; i <= xe; i++) {
+        unsigned int d;
+
+        d = foreground_data[i];
+
+        c[1] = (vbuf[i] >> 4) + ((cbuf[i] & 0x07) << 4);
+        c[2] = (vbuf[i] & 0x0f) + (cbuf[i] & 0x70);
+
+        ptmp[1] = ptmp[0] = c[mc_table[0x100 + d]];
+        ptmp[3] = ptmp[2] = c[mc_table[0x300 + d]];
+        ptmp[5] = ptmp[4] = c[mc_table[0x500 + d]];
+        ptmp[7] = ptmp[6] = c[mc_table[0x700 + d]];
+        ptmp += 8;
+    }
+}
+
 static void draw_mc_bitmap_cached(raster_cache_t *cache, unsigned int xs,
                                   unsigned int xe)
 {
-    ALIGN_DRAW_FUNC(_draw_mc_bitmap, xs, xe);
+    ALIGN_DRAW_FUNC_CACHE(_draw_mc_bitmap_cached, xs, xe, cache);
 }
 
 static void draw_mc_bitmap_foreground(unsigned int start_char,
@@ -804,10 +905,35 @@ static void draw_ext_text(void)
     ALIGN_DRAW_FUNC(_draw_ext_text, 0, TED_SCREEN_TEXTCOLS - 1);
 }
 
+inline static void _draw_ext_text_cached(uint8_t *p, unsigned int xs,
+                                         unsigned int xe,
+                                         raster_cache_t *cache)
+{
+    uint8_t *foreground_data, *bg_data, *color_data;
+    unsigned int i;
+
+    foreground_data = cache->foreground_data;
+    bg_data = cache->color_data_3;
+    color_data = cache->color_data_1;
+
+    for (i = xs; i <= xe; i++) {
+        uint32_t *ptr;
+        int d;
+
+        /* color_data_2 holds the background and the three extended colors */
+        ptr = hr_table + ((color_data[i] & 0x7f) << 11)
+              + (cache->color_data_2[bg_data[i]] << 4);
+        d = foreground_data[i];
+
+        *((uint32_t *)p + 2 * i) = *(ptr + (d >> 4));
+        *((uint32_t *)p + 2 * i + 1) = *(ptr + (d & 0xf));
+    }
+}
+
 static void draw_ext_text_cached(raster_cache_t *cache, unsigned int xs,
                                  unsigned int xe)
 {
-    ALIGN_DRAW_FUNC(_draw_ext_text, xs, xe);
+    ALIGN_DRAW_FUNC_CACHE(_draw_ext_text_cached, xs, xe, cache);
 }
 
 /* FIXME: This is *slow* and might not be 100% correct.  */
@@ -191,102 +191,158 @@ static const int16_t volume_tab[16] = {
     0x3fff, 0x3fff, 0x3fff, 0x3fff, 0x3fff, 0x3fff, 0x3fff, 0x3fff
 };
 
+static void ted_sound_noise_shift(void)
+{
+    snd.noise_shift_register
+        = (snd.noise_shift_register << 1) +
+          ( 1 ^ ((snd.noise_shift_register >> 7) & 1) ^
+            ((snd.noise_shift_register >> 5) & 1) ^
+            ((snd.noise_shift_register >> 4) & 1) ^
+            ((snd.noise_shift_register >> 1) & 1));
+}
+
+/* Advance the voices by `ticks' 8 cycle units.  */
+static void ted_sound_advance(uint32_t ticks)
+{
+    uint32_t j;
+
+    if (snd.voice0_accu <= ticks) {
+        uint32_t delay = ticks - snd.voice0_accu;
+        snd.voice0_sign ^= 1;
+        snd.voice0_accu = 1023 - snd.voice0_reload;
+        if (snd.voice0_accu == 0) {
+            snd.voice0_accu = 1024;
+        }
+        if (delay >= snd.voice0_accu) {
+            snd.voice0_sign = ((delay / snd.voice0_accu)
+                               & 1) ? snd.voice0_sign ^ 1
+                              : snd.voice0_sign;
+            snd.voice0_accu = snd.voice0_accu - (delay % snd.voice0_accu);
+        } else {
+            snd.voice0_accu -= delay;
+        }
+    } else {
+        snd.voice0_accu -= ticks;
+    }
+
+    if (snd.voice1_accu <= ticks) {
+        uint32_t delay = ticks - snd.voice1_accu;
+        snd.voice1_sign ^= 1;
+        ted_sound_noise_shift();
+        snd.voice1_accu = 1023 - snd.voice1_reload;
+        if (snd.voice1_accu == 0) {
+            snd.voice1_accu = 1024;
+        }
+        if (delay >= snd.voice1_accu) {
+            snd.voice1_sign = ((delay / snd.voice1_accu)
+                               & 1) ? snd.voice1_sign ^ 1
+                              : snd.voice1_sign;
+            for (j = 0; j < delay / snd.voice1_accu; j++) {
+                ted_sound_noise_shift();
+            }
+            snd.voice1_accu = snd.voice1_accu - (delay % snd.voice1_accu);
+        } else {
+            snd.voice1_accu -= delay;
+        }
+    } else {
+        snd.voice1_accu -= ticks;
+    }
+}
+
+static int16_t ted_sound_level(void)
+{
+    int16_t volume = 0;
+
+    if (snd.voice0_output_enabled && snd.voice0_sign) {
+        volume += snd.volume;
+    }
+    if (snd.voice1_output_enabled && !snd.noise && snd.voice1_sign) {
+        volume += snd.volume;
+    }
+    if (snd.voice1_output_enabled && snd.noise && (!(snd.noise_shift_register & 1))) {
+        volume += snd.volume;
+    }
+    return volume;
+}
+
+/* Move the sample position on by up to `nr' samples, as long as neither
+   voice toggles, so the output level stays the same.  Returns the number
+   of samples; if less than `nr', the next sample toggles a voice and has
+   to be stepped by ted_sound_step().  */
+static int ted_sound_run(int nr)
+{
+    uint32_t position = snd.sample_position_integer;
+    uint32_t remainder = snd.sample_position_remainder;
+    uint32_t limit = (snd.voice0_accu < snd.voice1_accu) ? snd.voice0_accu : snd.voice1_accu;
+    uint32_t ticks = 0;
+    int n = 0;
+
+    while (n < nr) {
+        uint32_t r = remainder + snd.sample_length_remainder;
+        uint32_t p = position + snd.sample_length_integer;
+
+        if (r >= snd.speed) {
+            r -= snd.speed;
+            p++;
+        }
+        if (ticks + (p >> 3) >= limit) {
+            break;
+        }
+        ticks += p >> 3;
+        position = p & 7;
+        remainder = r;
+        n++;
+    }
+
+    snd.sample_position_integer = position;
+    snd.sample_position_remainder = remainder;
+    snd.voice0_accu -= ticks;
+    snd.voice1_accu -= ticks;
+
+    return n;
+}
+
+/* Step a single sample, which may toggle the voices.  */
+static void ted_sound_step(void)
+{
+    snd.sample_position_remainder += snd.sample_length_remainder;
+    if (snd.sample_position_remainder >= snd.speed) {
+        snd.sample_position_remainder -= snd.speed;
+        snd.sample_position_integer++;
+    }
+    snd.sample_position_integer += snd.sample_length_integer;
+    if (snd.sample_position_integer >= 8) {
+        /* Advance state engine */
+        ted_sound_advance(snd.sample_position_integer >> 3);
+    }
+    snd.sample_position_integer = snd.sample_position_integer & 7;
+}
+
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int ted_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int scc, CLOCK *delta_t)
 {
     int i;
-    int j;
-    int16_t volume;
+    int n;
     float sample;
 
     if (snd.digital) {
+        sample = (snd.volume * (snd.voice0_output_enabled + snd.voice1_output_enabled)) / 32767.0;
         for (i = 0; i < nr; i++) {
-            sample = (snd.volume * (snd.voice0_output_enabled + snd.voice1_output_enabled)) / 32767.0;
             pbuf[i] = sample;
         }
     } else {
-        for (i = 0; i < nr; i++) {
-            snd.sample_position_remainder += snd.sample_length_remainder;
-            if (snd.sample_position_remainder >= snd.speed) {
-                snd.sample_position_remainder -= snd.speed;
-                snd.sample_position_integer++;
+        i = 0;
+        while (i < nr) {
+            n = ted_sound_run(nr - i);
+            sample = ted_sound_level() / 32767.0;
+            while (n-- > 0) {
+                pbuf[i++] = sample;
             }
-            snd.sample_position_integer += snd.sample_length_integer;
-            if (snd.sample_position_integer >= 8) {
-                /* Advance state engine */
-                uint32_t ticks = snd.sample_position_integer >> 3;
-                if (snd.voice0_accu <= ticks) {
-                    uint32_t delay = ticks - snd.voice0_accu;
-                    snd.voice0_sign ^= 1;
-                    snd.voice0_accu = 1023 - snd.voice0_reload;
-                    if (snd.voice0_accu == 0) {
-                        snd.voice0_accu = 1024;
-                    }
-                    if (delay >= snd.voice0_accu) {
-                        snd.voice0_sign = ((delay / snd.voice0_accu)
-                                           & 1) ? snd.voice0_sign ^ 1
-                                          : snd.voice0_sign;
-                        snd.voice0_accu = snd.voice0_accu - (delay % snd.voice0_accu);
-                    } else {
-                        snd.voice0_accu -= delay;
-                    }
-                } else {
-                    snd.voice0_accu -= ticks;
-                }
-
-                if (snd.voice1_accu <= ticks) {
-                    uint32_t delay = ticks - snd.voice1_accu;
-                    snd.voice1_sign ^= 1;
-                    snd.noise_shift_register
-                        = (snd.noise_shift_register << 1) +
-                          ( 1 ^ ((snd.noise_shift_register >> 7) & 1) ^
-                            ((snd.noise_shift_register >> 5) & 1) ^
-                            ((snd.noise_shift_register >> 4) & 1) ^
-                            ((snd.noise_shift_register >> 1) & 1));
-                    snd.voice1_accu = 1023 - snd.voice1_reload;
-                    if (snd.voice1_accu == 0) {
-                        snd.voice1_accu = 1024;
-                    }
-                    if (delay >= snd.voice1_accu) {
-                        snd.voice1_sign = ((delay / snd.voice1_accu)
-                                           & 1) ? snd.voice1_sign ^ 1
-                                          : snd.voice1_sign;
-                        for (j = 0; j < (int)(delay / snd.voice1_accu);
-                             j++) {
-                            snd.noise_shift_register
-                                = (snd.noise_shift_register << 1) +
-                                  ( 1 ^ ((snd.noise_shift_register >> 7) & 1) ^
-                                    ((snd.noise_shift_register >> 5) & 1) ^
-                                    ((snd.noise_shift_register >> 4) & 1) ^
-                                    ((snd.noise_shift_register >> 1) & 1));
-                        }
-                        snd.voice1_accu = snd.voice1_accu - (delay % snd.voice1_accu);
-                    } else {
-                        snd.voice1_accu -= delay;
-                    }
-                } else {
-                    snd.voice1_accu -= ticks;
-                }
+            if (i < nr) {
+                ted_sound_step();
+                pbuf[i++] = ted_sound_level() / 32767.0;
             }
-            snd.sample_position_integer = snd.sample_position_integer & 7;
-
-            volume = 0;
-
-            if (snd.voice0_output_enabled && snd.voice0_sign) {
-                volume += snd.volume;
-            }
-            if (snd.voice1_output_enabled && !snd.noise && snd.voice1_sign) {
-                volume += snd.volume;
-            }
-            if (snd.voice1_output_enabled && snd.noise && (!(snd.noise_shift_register & 1))) {
-                volume += snd.volume;
-            }
-
-
-            sample = volume / 32767.0;
-
-            pbuf[i] = sample;
         }
     }
     return nr;
@@ -295,97 +351,37 @@ static int ted_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int
 static int ted_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
     int i;
-    int j;
+    int n;
     int16_t volume;
 
     if (snd.digital) {
+        volume = snd.volume * (snd.voice0_output_enabled + snd.voice1_output_enabled);
         for (i = 0; i < nr; i++) {
-            pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], (snd.volume * (snd.voice0_output_enabled + snd.voice1_output_enabled)));
+            pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], volume);
             if (soc == SOUND_OUTPUT_STEREO) {
-                pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], (snd.volume * (snd.voice0_output_enabled + snd.voice1_output_enabled)));
+                pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], volume);
             }
         }
     } else {
-        for (i = 0; i < nr; i++) {
-            snd.sample_position_remainder += snd.sample_length_remainder;
-            if (snd.sample_position_remainder >= snd.speed) {
-                snd.sample_position_remainder -= snd.speed;
-                snd.sample_position_integer++;
-            }
-            snd.sample_position_integer += snd.sample_length_integer;
-            if (snd.sample_position_integer >= 8) {
-                /* Advance state engine */
-                uint32_t ticks = snd.sample_position_integer >> 3;
-                if (snd.voice0_accu <= ticks) {
-                    uint32_t delay = ticks - snd.voice0_accu;
-                    snd.voice0_sign ^= 1;
-                    snd.voice0_accu = 1023 - snd.voice0_reload;
-                    if (snd.voice0_accu == 0) {
-                        snd.voice0_accu = 1024;
-                    }
-                    if (delay >= snd.voice0_accu) {
-                        snd.voice0_sign = ((delay / snd.voice0_accu)
-                                           & 1) ? snd.voice0_sign ^ 1
-                                          : snd.voice0_sign;
-                        snd.voice0_accu = snd.voice0_accu - (delay % snd.voice0_accu);
-                    } else {
-                        snd.voice0_accu -= delay;
-                    }
-                } else {
-                    snd.voice0_accu -= ticks;
+        i = 0;
+        while (i < nr) {
+            n = ted_sound_run(nr - i);
+            volume = ted_sound_level();
+            while (n-- > 0) {
+                pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], volume);
+                if (soc == SOUND_OUTPUT_STEREO) {
+                    pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], volume);
                 }
-
-                if (snd.voice1_accu <= ticks) {
-                    uint32_t delay = ticks - snd.voice1_accu;
-                    snd.voice1_sign ^= 1;
-                    snd.noise_shift_register
-                        = (snd.noise_shift_register << 1) +
-                          ( 1 ^ ((snd.noise_shift_register >> 7) & 1) ^
-                            ((snd.noise_shift_register >> 5) & 1) ^
-                            ((snd.noise_shift_register >> 4) & 1) ^
-                            ((snd.noise_shift_register >> 1) & 1));
-                    snd.voice1_accu = 1023 - snd.voice1_reload;
-                    if (snd.voice1_accu == 0) {
-                        snd.voice1_accu = 1024;
-                    }
-                    if (delay >= snd.voice1_accu) {
-                        snd.voice1_sign = ((delay / snd.voice1_accu)
-                                           & 1) ? snd.voice1_sign ^ 1
-                                          : snd.voice1_sign;
-                        for (j = 0; j < (int)(delay / snd.voice1_accu);
-                             j++) {
-                            snd.noise_shift_register
-                                = (snd.noise_shift_register << 1) +
-                                  ( 1 ^ ((snd.noise_shift_register >> 7) & 1) ^
-                                    ((snd.noise_shift_register >> 5) & 1) ^
-                                    ((snd.noise_shift_register >> 4) & 1) ^
-                                    ((snd.noise_shift_register >> 1) & 1));
-                        }
-                        snd.voice1_accu = snd.voice1_accu - (delay % snd.voice1_accu);
-                    } else {
-                        snd.voice1_accu -= delay;
-                    }
-                } else {
-                    snd.voice1_accu -= ticks;
-                }
-            }
-            snd.sample_position_integer = snd.sample_position_integer & 7;
-
-            volume = 0;
-
-            if (snd.voice0_output_enabled && snd.voice0_sign) {
-                volume += snd.volume;
-            }
-            if (snd.voice1_output_enabled && !snd.noise && snd.voice1_sign) {
-                volume += snd.volume;
+                i++;
             }
-            if (snd.voice1_output_enabled && snd.noise && (!(snd.noise_shift_register & 1))) {
-                volume += snd.volume;
-            }
-
-            pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], volume);
-            if (soc == SOUND_OUTPUT_STEREO) {
-                pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], volume);
+            if (i < nr) {
+                ted_sound_step();
+                volume = ted_sound_level();
+                pbuf[i * soc] = sound_audio_mix(pbuf[i * soc], volume);
+                if (soc == SOUND_OUTPUT_STEREO) {
+                    pbuf[(i * soc) + 1] = sound_audio_mix(pbuf[(i * soc) + 1], volume);
+                }
+                i++;
             }
         }
     }
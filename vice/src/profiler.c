@@ -31,7 +31,9 @@
 #include <stddef.h>
 #include <string.h>
 
+#include "alarm.h"
 #include "lib.h"
+#include "maincpu.h"
 #include "mem.h"
 #include "profiler.h"
 #include "profiler_data.h"
@@ -54,6 +56,10 @@ unsigned callstack_size = 0;
 bool     context_dirty = true;
 bool     maincpu_profiling = false;
 
+/* sampling mode: cycles between two samples, 0 if not sampling */
+static unsigned int sample_interval = 0;
+static alarm_t *sample_alarm = NULL;
+
 /* (fragile) flags if the current command is a JSR/INT or RTS/RTI */
 bool     entered_context = false;
 bool     exited_context = false;
@@ -296,18 +302,71 @@ void profile_rtx(uint8_t sp)
     exited_context = true;
 }
 
-void profile_start(void)
+static void profile_sample_stop(void)
+{
+    if (sample_alarm) {
+        alarm_unset(sample_alarm);
+    }
+    sample_interval = 0;
+}
+
+static void profile_reset_data(void)
 {
     if (root_context) free_profiling_context(root_context);
     root_context    = alloc_profiling_context();
     num_context_ids = 0;
     current_context = root_context;
-    maincpu_profiling = true;
     entered_context = false;
     exited_context  = false;
     context_dirty   = true;
 }
 
+void profile_start(void)
+{
+    profile_sample_stop();
+    profile_reset_data();
+    maincpu_profiling = true;
+}
+
+/* Attribute the whole interval to the last instruction started and to the
+ * context of the current callstack.  The callstack is maintained by the CPU
+ * even without instruction profiling; entries/exits are not counted. */
+static void profile_sample_alarm_handler(CLOCK offset, void *data)
+{
+    uint16_t pc = (uint16_t)last_opcode_addr;
+    profiling_data_t *sample;
+
+    alarm_set(sample_alarm, maincpu_clk - offset + sample_interval);
+
+    initialize_context();
+    sample = &profiling_get_page(current_context, pc >> 8)->data[pc & 0xff];
+    sample->num_cycles += sample_interval;
+    sample->num_samples++;
+}
+
+void profile_start_sampling(unsigned int interval)
+{
+    if (interval == 0) {
+        interval = 1;
+    }
+
+    profile_sample_stop();
+    profile_reset_data();
+    maincpu_profiling = false;
+
+    if (!sample_alarm) {
+        sample_alarm = alarm_new(maincpu_alarm_context, "ProfileSample",
+                                 profile_sample_alarm_handler, NULL);
+    }
+    sample_interval = interval;
+    alarm_set(sample_alarm, maincpu_clk + interval);
+}
+
+unsigned int profile_sample_interval(void)
+{
+    return sample_interval;
+}
+
 void compute_aggregate_stats(profiling_context_t *context) {
     profiling_context_t *c;
     profiling_counter_t total_child_cycles        = 0;
@@ -359,6 +418,8 @@ void compute_aggregate_stats(profiling_context_t *context) {
 void profile_stop(void)
 {
     maincpu_profiling = false;
+    profile_sample_stop();
+    context_dirty = true;
 }
 
 static void profile_reset(void) {
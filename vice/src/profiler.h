@@ -34,6 +34,13 @@ extern bool maincpu_profiling;
 /* resets sample statistics and starts profiling sample collection */
 void profile_start(void);
 
+/* resets sample statistics and starts sampling the PC every `interval'
+ * cycles instead of profiling every instruction */
+void profile_start_sampling(unsigned int interval);
+
+/* returns the sampling interval, or 0 if the sampling profiler is off */
+unsigned int profile_sample_interval(void);
+
 /* stops profiling and writes profiling log to disk */
 void profile_stop(void);
 
@@ -28,9 +28,12 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "videoarch.h"
 
+#include "autowarp.h"
+#include "hosttime.h"
 #include "lib.h"
 #include "machine.h"
 #include "raster-canvas.h"
@@ -105,12 +108,49 @@ inline static void refresh_canvas(raster_t *raster)
     update_area->is_null = 1;
 }
 
-void raster_canvas_handle_end_of_frame(raster_t *raster)
+/* Flag the lines of the draw buffer that changed since the last refresh, so
+   the renderers can skip the others.  */
+static void update_dirty_lines(raster_t *raster)
 {
-    if (video_disabled_mode) {
+    draw_buffer_t *draw_buffer = raster->canvas->draw_buffer;
+    unsigned int width = draw_buffer->draw_buffer_width;
+    unsigned int height = draw_buffer->draw_buffer_height;
+    unsigned int y;
+    unsigned int changed = 0;
+
+    if (draw_buffer->dirty_lines == NULL) {
         return;
     }
 
+    if (draw_buffer->dirty_lines_reset || raster->canvas->videoconfig->interlaced) {
+        memcpy(draw_buffer->draw_buffer_previous, draw_buffer->draw_buffer, width * height);
+        memset(draw_buffer->dirty_lines, 1, height);
+        draw_buffer->dirty_lines_reset = 0;
+        changed = height;
+    } else {
+        for (y = 0; y < height; y++) {
+            const uint8_t *line = draw_buffer->draw_buffer + y * width;
+            uint8_t *previous = draw_buffer->draw_buffer_previous + y * width;
+
+            if (memcmp(line, previous, width) != 0) {
+                memcpy(previous, line, width);
+                draw_buffer->dirty_lines[y] = 1;
+                changed++;
+            } else {
+                draw_buffer->dirty_lines[y] = 0;
+            }
+        }
+    }
+
+    draw_buffer->dirty_lines_valid = 1;
+
+    autowarp_screen_update(changed);
+}
+
+static void show_frame(raster_t *raster)
+{
+    int hosttime_previous;
+
     if (vsync_should_skip_frame(raster->canvas)) {
         return;
     }
@@ -119,11 +159,28 @@ void raster_canvas_handle_end_of_frame(raster_t *raster)
         return;
     }
 
+    hosttime_previous = HOSTTIME_ENTER(HOSTTIME_REFRESH);
+
+#if defined(USE_HEADLESSUI)
+    /* Nothing is displayed and screenshots are taken from the draw buffer,
+       the changed lines are only looked for when autowarp needs them.  */
+    if (autowarp_screen_wanted()) {
+        update_dirty_lines(raster);
+    }
+    raster->update_area->is_null = 1;
+#else
+    update_dirty_lines(raster);
+
     if (raster->dont_cache) {
         video_canvas_refresh_all(raster->canvas);
     } else {
         refresh_canvas(raster);
     }
+#endif
+
+    raster->canvas->draw_buffer->dirty_lines_valid = 0;
+
+    HOSTTIME_LEAVE(hosttime_previous);
 
     if (raster->canvas->videoconfig->interlaced) {
         /* swap the draw buffer pointers */
@@ -133,6 +190,24 @@ void raster_canvas_handle_end_of_frame(raster_t *raster)
     }
 }
 
+void raster_canvas_handle_end_of_frame(raster_t *raster)
+{
+    if (raster->sprite_collision_frames > 0) {
+        raster->sprite_collision_frames--;
+    }
+
+    if (video_disabled_mode) {
+        return;
+    }
+
+    /* A frame that was not drawn is not shown either, the next one is drawn
+       unless it will be skipped as well.  */
+    if (!raster->skip_frame) {
+        show_frame(raster);
+    }
+    raster->skip_frame = vsync_should_skip_drawing(raster->canvas);
+}
+
 void raster_canvas_init(raster_t *raster)
 {
     raster->update_area = lib_malloc(sizeof(raster_canvas_area_t));
@@ -28,7 +28,10 @@
 #ifndef VICE_RASTER_CHANGES_H
 #define VICE_RASTER_CHANGES_H
 
+#include <string.h>
+
 #include "raster.h"
+#include "types.h"
 #include "viewport.h"
 
 /* This should be a lot more than what is actually needed.  */
@@ -60,23 +63,27 @@ union raster_changes_action_value_s {
 };
 typedef union raster_changes_action_value_s raster_changes_action_value_t;
 
+/* Pointer to where the value is stored and new value to assign.  */
 struct raster_changes_action_s {
-    /* "Where" the change happens (eg. character position for foreground
-       changes, pixel position for other changes).  */
-    int where;
-
-    /* Data type for changed value.  */
-    raster_changes_type_t type;
-
-    /* Pointer to where the value is stored and new value to assign.  */
     raster_changes_action_value_t value;
 };
 typedef struct raster_changes_action_s raster_changes_action_t;
 
+/* The lists are allocated once with room for RASTER_CHANGES_MAX changes
+   and emptied after every line.  The positions and types are kept apart
+   from the values, so the draw loops scanning for the next change only
+   touch the packed `where' array.  */
 struct raster_changes_s {
     /* Total number of changes. */
     unsigned int count;
 
+    /* "Where" the changes happen (eg. character position for foreground
+       changes, pixel position for other changes).  */
+    int where[RASTER_CHANGES_MAX];
+
+    /* Data type for changed values.  */
+    uint8_t type[RASTER_CHANGES_MAX];
+
     /* List of changes to be applied in order.  */
     raster_changes_action_t actions[RASTER_CHANGES_MAX];
 };
@@ -106,7 +113,7 @@ inline static void raster_changes_apply(raster_changes_t *changes,
 
     action = changes->actions + idx;
 
-    switch (changes->actions[idx].type) {
+    switch (changes->type[idx]) {
         case RASTER_CHANGES_TYPE_INT:
             *action->value.integer.oldp = action->value.integer.newone;
             break;
@@ -135,7 +142,8 @@ inline static void raster_changes_apply_all(raster_changes_t *changes)
     raster_changes_remove_all(changes);
 }
 
-/* Add an int change.  */
+/* Add an int change.  If the list is full, the change is applied right
+   away rather than lost.  */
 inline static void raster_changes_add_int(raster_changes_t *changes,
                                           const int where,
                                           int *ptr,
@@ -143,10 +151,15 @@ inline static void raster_changes_add_int(raster_changes_t *changes,
 {
     raster_changes_action_t *action;
 
+    if (changes->count >= RASTER_CHANGES_MAX) {
+        *ptr = new_value;
+        return;
+    }
+
+    changes->where[changes->count] = where;
+    changes->type[changes->count] = RASTER_CHANGES_TYPE_INT;
     action = changes->actions + changes->count++;
 
-    action->where = where;
-    action->type = RASTER_CHANGES_TYPE_INT;
     action->value.integer.oldp = ptr;
     action->value.integer.newone = new_value;
 }
@@ -158,20 +171,29 @@ inline static void raster_changes_add_sorted_int(raster_changes_t *changes,
                                                  const int new_value)
 {
     raster_changes_action_t *action;
-    int j, i = (int)changes->count - 1;
+    unsigned int i = changes->count;
+
+    if (changes->count >= RASTER_CHANGES_MAX) {
+        *ptr = new_value;
+        return;
+    }
 
-    while (i >= 0 && changes->actions[i].where > where) {
+    while (i > 0 && changes->where[i - 1] > where) {
         i--;
     }
-    for (j = (int)changes->count - 1; j > i; j--) {
-        changes->actions[j + 1] = changes->actions[j];
+    if (i < changes->count) {
+        unsigned int n = changes->count - i;
+
+        memmove(changes->where + i + 1, changes->where + i, n * sizeof(changes->where[0]));
+        memmove(changes->type + i + 1, changes->type + i, n * sizeof(changes->type[0]));
+        memmove(changes->actions + i + 1, changes->actions + i, n * sizeof(changes->actions[0]));
     }
 
     changes->count++;
-    action = changes->actions + 1 + i;
+    changes->where[i] = where;
+    changes->type[i] = RASTER_CHANGES_TYPE_INT;
+    action = changes->actions + i;
 
-    action->where = where;
-    action->type = RASTER_CHANGES_TYPE_INT;
     action->value.integer.oldp = ptr;
     action->value.integer.newone = new_value;
 }
@@ -184,10 +206,15 @@ inline static void raster_changes_add_ptr(raster_changes_t *changes,
 {
     raster_changes_action_t *action;
 
+    if (changes->count >= RASTER_CHANGES_MAX) {
+        *ptr = new_value;
+        return;
+    }
+
+    changes->where[changes->count] = where;
+    changes->type[changes->count] = RASTER_CHANGES_TYPE_PTR;
     action = changes->actions + changes->count++;
 
-    action->where = where;
-    action->type = RASTER_CHANGES_TYPE_PTR;
     action->value.ptr.oldp = ptr;
     action->value.ptr.newone = new_value;
 }
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "hosttime.h"
 #include "raster-cache.h"
 #include "raster-canvas.h"
 #include "raster-changes.h"
@@ -145,7 +146,7 @@ static void handle_blank_line(raster_t *raster)
             for (xs = i = 0; i < border_changes->count; i++) {
                 unsigned int xe;
 
-                xe = border_changes->actions[i].where;
+                xe = border_changes->where[i];
 
                 if (xs < xe) {
                     raster_line_draw_blank(raster, xs, xe);
@@ -464,7 +465,7 @@ static void handle_visible_line_with_changes(raster_t *raster)
 
     /* Draw the background.  */
     for (xs = i = 0; i < changes->background->count; i++) {
-        int xe = changes->background->actions[i].where;
+        int xe = changes->background->where[i];
 
         if (xs < xe) {
             raster_modes_draw_background(raster->modes,
@@ -487,7 +488,7 @@ static void handle_visible_line_with_changes(raster_t *raster)
 
     /* Draw the foreground graphics.  */
     for (xs = i = 0; i < changes->foreground->count; i++) {
-        int xe = changes->foreground->actions[i].where;
+        int xe = changes->foreground->where[i];
 
         if (xs < xe) {
             raster_modes_draw_foreground(raster->modes,
@@ -521,7 +522,7 @@ static void handle_visible_line_with_changes(raster_t *raster)
 #else
     xs = 0;
     for (i = 0; i < changes->sprites->count; i++) {
-        int xe = changes->sprites->actions[i].where;
+        int xe = changes->sprites->where[i];
 
         if (xe >= (int)geometry->screen_size.width) {
             xe = geometry->screen_size.width - 1;
@@ -541,7 +542,7 @@ static void handle_visible_line_with_changes(raster_t *raster)
        considering border changes */
     if (raster->can_disable_border && ((raster->blank_this_line || raster->blank_enabled) && !raster->open_left_border)) {
         for (xs = i = 0; i < changes->border->count; i++) {
-            int xe = changes->border->actions[i].where;
+            int xe = changes->border->where[i];
 
             if (xs < xe) {
                 if (!raster->border_disable) {
@@ -561,9 +562,9 @@ static void handle_visible_line_with_changes(raster_t *raster)
         xstop = raster->display_xstart - 1;
         if (!raster->open_left_border) {
             for (xs = i = 0;
-                 (i < changes->border->count && changes->border->actions[i].where <= xstop);
+                 (i < changes->border->count && changes->border->where[i] <= xstop);
                  i++) {
-                int xe = changes->border->actions[i].where;
+                int xe = changes->border->where[i];
 
                 if (xs < xe) {
                     if (!raster->border_disable) {
@@ -578,7 +579,7 @@ static void handle_visible_line_with_changes(raster_t *raster)
             }
         } else {
             for (i = 0;
-                 (i < changes->border->count && changes->border->actions[i].where <= xstop);
+                 (i < changes->border->count && changes->border->where[i] <= xstop);
                  i++) {
                 raster_changes_apply(changes->border, i);
             }
@@ -587,14 +588,14 @@ static void handle_visible_line_with_changes(raster_t *raster)
         /* Draw right border.  */
         if (!raster->open_right_border) {
             for (;
-                 (i < changes->border->count && (changes->border->actions[i].where <= raster->display_xstop));
+                 (i < changes->border->count && (changes->border->where[i] <= raster->display_xstop));
                  i++) {
                 raster_changes_apply(changes->border, i);
             }
             for (xs = raster->display_xstop;
                  i < changes->border->count;
                  i++) {
-                int xe = changes->border->actions[i].where;
+                int xe = changes->border->where[i];
 
                 if (xs < xe) {
                     if (!raster->border_disable) {
@@ -648,8 +649,20 @@ inline static void handle_visible_line(raster_t *raster)
     }
 }
 
+/* Lines of a frame that is not shown are only drawn when they can have
+   sprite collisions the program uses.  */
+inline static int skip_line(raster_t *raster)
+{
+    return raster->skip_frame
+           && (raster->sprite_collision_frames == 0
+               || raster->sprite_status == NULL
+               || raster->sprite_status->dma_msk == 0);
+}
+
 void raster_line_emulate(raster_t *raster)
 {
+    int hosttime_previous = HOSTTIME_ENTER(HOSTTIME_RASTER);
+
     raster_draw_buffer_ptr_update(raster);
 
     /* Emulate the vertical blank flip-flops.  (Well, sort of.)  */
@@ -660,12 +673,12 @@ void raster_line_emulate(raster_t *raster)
         raster->blank_enabled = 1;
     }
 
-    if ((raster->current_line >= raster->geometry->first_displayed_line
-         && raster->current_line <= raster->geometry->last_displayed_line)
-        /* handle the case when lines 0+ are displayed in the lower border */
-        || (raster->current_line <= raster->geometry->last_displayed_line - raster->geometry->screen_size.height
-            && raster->geometry->screen_size.height <= raster->geometry->last_displayed_line)
-        ) {
+    if (((raster->current_line >= raster->geometry->first_displayed_line
+          && raster->current_line <= raster->geometry->last_displayed_line)
+         /* handle the case when lines 0+ are displayed in the lower border */
+         || (raster->current_line <= raster->geometry->last_displayed_line - raster->geometry->screen_size.height
+             && raster->geometry->screen_size.height <= raster->geometry->last_displayed_line))
+        && !skip_line(raster)) {
         /* handle lines with no border or with changes that may affect
            the border as visible lines */
         if (raster->can_disable_border && (raster->border_disable || raster->changes->have_on_this_line)) {
@@ -696,7 +709,9 @@ void raster_line_emulate(raster_t *raster)
                *raster->draw_buffer_ptr, 4);
 #endif
     } else {
-        update_sprite_collisions(raster);
+        if (!raster->skip_frame || raster->sprite_collision_frames > 0) {
+            update_sprite_collisions(raster);
+        }
 
         if (raster->changes->have_on_this_line) {
             raster_changes_apply_all(raster->changes->background);
@@ -735,4 +750,6 @@ void raster_line_emulate(raster_t *raster)
     }
 
     raster->blank_this_line = 0;
+
+    HOSTTIME_LEAVE(hosttime_previous);
 }
@@ -40,6 +40,7 @@
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
+#include "memusage.h"
 #include "raster-cache.h"
 #include "raster-canvas.h"
 #include "raster-changes.h"
@@ -55,6 +56,14 @@
 #include "viewport.h"
 
 
+/* bytes held by the draw buffers of all canvases, for the memory report */
+static size_t draw_buffer_bytes = 0;
+
+static size_t raster_draw_buffer_usage(void)
+{
+    return draw_buffer_bytes;
+}
+
 static int raster_calc_frame_buffer_width(raster_t *raster)
 {
     return raster->geometry->screen_size.width
@@ -99,8 +108,22 @@ static int raster_draw_buffer_alloc(video_canvas_t *canvas,
 
         canvas->draw_buffer->draw_buffer_padded_allocations[1] = lib_calloc(1, padded_size);
         canvas->draw_buffer->draw_buffer_non_padded[1] = canvas->draw_buffer->draw_buffer_padded_allocations[1] + unpadded_offset;
+        canvas->draw_buffer->draw_buffer_bytes += padded_size;
+    }
+    canvas->draw_buffer->draw_buffer_bytes += padded_size;
+
+    /* for finding the lines that changed from one refresh to the next,
+       without them the renderer compares line hashes instead */
+    if (!memusage_low_memory()) {
+        canvas->draw_buffer->draw_buffer_previous = lib_calloc(1, fb_width * fb_height);
+        canvas->draw_buffer->dirty_lines = lib_malloc(fb_height);
+        canvas->draw_buffer->dirty_lines_reset = 1;
+        canvas->draw_buffer->draw_buffer_bytes += fb_width * fb_height + fb_height;
     }
 
+    draw_buffer_bytes += canvas->draw_buffer->draw_buffer_bytes;
+    memusage_register("draw buffers", raster_draw_buffer_usage);
+
     *fb_pitch = fb_width;
     return 0;
 }
@@ -109,10 +132,17 @@ static void raster_draw_buffer_free(video_canvas_t *canvas)
 {
     lib_free(canvas->draw_buffer->draw_buffer_padded_allocations[0]);
     lib_free(canvas->draw_buffer->draw_buffer_padded_allocations[1]);
+    lib_free(canvas->draw_buffer->draw_buffer_previous);
+    lib_free(canvas->draw_buffer->dirty_lines);
 
     canvas->draw_buffer->draw_buffer_padded_allocations[0] = NULL;
     canvas->draw_buffer->draw_buffer_padded_allocations[1] = NULL;
     canvas->draw_buffer->draw_buffer = NULL;
+    canvas->draw_buffer->draw_buffer_previous = NULL;
+    canvas->draw_buffer->dirty_lines = NULL;
+
+    draw_buffer_bytes -= canvas->draw_buffer->draw_buffer_bytes;
+    canvas->draw_buffer->draw_buffer_bytes = 0;
 }
 
 static void raster_draw_buffer_clear(video_canvas_t *canvas, uint8_t value,
@@ -185,8 +215,8 @@ static int realize_canvas(raster_t *raster)
             return -1;
         }
 
-        /* Ensure that this canvas is ready to screenshot immediately */
-        video_color_update_palette(new_canvas);
+        /* The palette is calculated (and an external one loaded) when the
+           first frame is rendered or a screenshot is taken.  */
 
         raster->canvas = new_canvas;
 
@@ -300,6 +330,8 @@ void raster_reset(raster_t *raster)
     raster->changes->have_on_this_line = 0;
 
     raster->current_line = 0;
+    raster->skip_frame = 0;
+    raster->sprite_collision_frames = 0;
 
     raster->xsmooth = raster->ysmooth = 0;
     raster->sprite_xsmooth = 0;
@@ -521,6 +553,11 @@ void raster_set_canvas_refresh(raster_t *raster, int enable)
 
 void raster_screenshot(raster_t *raster, screenshot_t *screenshot)
 {
+    /* a screenshot may be taken before the first frame was rendered */
+    if (!video_disabled_mode && !raster->canvas->videoconfig->color_tables.updated) {
+        video_color_update_palette(raster->canvas);
+    }
+
     screenshot->palette = raster->canvas->palette;
     screenshot->max_width = raster->geometry->screen_size.width;
     screenshot->max_height = raster->geometry->screen_size.height;
@@ -173,6 +173,16 @@ struct raster_s {
        filled with zeroes.  */
     uint8_t zero_gfx_msk[RASTER_GFX_MSK_SIZE];
 
+    /* Flag: the current frame is not shown, so its lines are not drawn.
+       Only the changes are applied, and the sprite collisions computed
+       while `sprite_collision_frames' is not 0.  */
+    int skip_frame;
+
+    /* Number of frames the sprite collisions are still computed in frames
+       that are not drawn.  The chip sets it while the program uses the
+       collisions.  */
+    unsigned int sprite_collision_frames;
+
     int (*line_changes)(struct raster_s *, unsigned int *, unsigned int *);
     void (*draw_sprites_when_cache_enabled)(struct raster_s *,
                                             struct raster_cache_s *);
@@ -0,0 +1,167 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#include "convolve.h"
+
+#if defined(RESID_CONVOLVE_AVX2)
+#include <immintrin.h>
+#elif defined(RESID_CONVOLVE_SSE2)
+#include <emmintrin.h>
+#endif
+#ifdef RESID_CONVOLVE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace reSID
+{
+
+convolve_func_t convolve = convolve_c;
+
+int convolve_c(const short* a, const short* b, int n)
+{
+  int out = 0;
+  for (int i = 0; i < n; i++) {
+    out += a[i]*b[i];
+  }
+  return out;
+}
+
+// The SIMD kernels add up the 32 bit products in 32 bit lanes, which wraps
+// exactly like the int sum of the C version; the only pair sum pmaddwd can
+// overflow, -32768*-32768 twice, wraps to the same value as well.
+
+#ifdef RESID_CONVOLVE_SSE2
+int convolve_sse2(const short* a, const short* b, int n)
+{
+  __m128i acc0 = _mm_setzero_si128();
+  __m128i acc1 = _mm_setzero_si128();
+  int i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m128i a0 = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i a1 = _mm_loadu_si128((const __m128i*)(a + i + 8));
+    __m128i b0 = _mm_loadu_si128((const __m128i*)(b + i));
+    __m128i b1 = _mm_loadu_si128((const __m128i*)(b + i + 8));
+    acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(a0, b0));
+    acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(a1, b1));
+  }
+  acc0 = _mm_add_epi32(acc0, acc1);
+  acc0 = _mm_add_epi32(acc0, _mm_shuffle_epi32(acc0, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc0 = _mm_add_epi32(acc0, _mm_shuffle_epi32(acc0, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  int out = _mm_cvtsi128_si32(acc0);
+  for (; i < n; i++) {
+    out += a[i]*b[i];
+  }
+  return out;
+}
+#endif
+
+#ifdef RESID_CONVOLVE_AVX2
+__attribute__((target("avx2")))
+int convolve_avx2(const short* a, const short* b, int n)
+{
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  int i = 0;
+
+  for (; i + 32 <= n; i += 32) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(a + i + 16));
+    __m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i));
+    __m256i b1 = _mm256_loadu_si256((const __m256i*)(b + i + 16));
+    acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(a0, b0));
+    acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(a1, b1));
+  }
+  if (i + 16 <= n) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i b0 = _mm256_loadu_si256((const __m256i*)(b + i));
+    acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(a0, b0));
+    i += 16;
+  }
+  acc0 = _mm256_add_epi32(acc0, acc1);
+
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc0),
+                              _mm256_extracti128_si256(acc0, 1));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  int out = _mm_cvtsi128_si32(sum);
+  for (; i < n; i++) {
+    out += a[i]*b[i];
+  }
+  return out;
+}
+#endif
+
+#ifdef RESID_CONVOLVE_NEON
+int convolve_neon(const short* a, const short* b, int n)
+{
+  int32x4_t acc0 = vdupq_n_s32(0);
+  int32x4_t acc1 = vdupq_n_s32(0);
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t a0 = vld1q_s16(a + i);
+    int16x8_t b0 = vld1q_s16(b + i);
+    acc0 = vmlal_s16(acc0, vget_low_s16(a0), vget_low_s16(b0));
+    acc1 = vmlal_s16(acc1, vget_high_s16(a0), vget_high_s16(b0));
+  }
+  acc0 = vaddq_s32(acc0, acc1);
+
+  int32x2_t sum = vadd_s32(vget_low_s32(acc0), vget_high_s32(acc0));
+  sum = vpadd_s32(sum, sum);
+
+  int out = vget_lane_s32(sum, 0);
+  for (; i < n; i++) {
+    out += a[i]*b[i];
+  }
+  return out;
+}
+#endif
+
+const char* convolve_init()
+{
+  static const char* name = 0;
+
+  if (name) {
+    return name;
+  }
+  name = "C";
+
+#ifdef RESID_CONVOLVE_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    convolve = convolve_avx2;
+    name = "AVX2";
+    return name;
+  }
+#endif
+#ifdef RESID_CONVOLVE_SSE2
+  convolve = convolve_sse2;
+  name = "SSE2";
+#endif
+#ifdef RESID_CONVOLVE_NEON
+  convolve = convolve_neon;
+  name = "NEON";
+#endif
+
+  return name;
+}
+
+} // namespace reSID
@@ -0,0 +1,61 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#ifndef RESID_CONVOLVE_H
+#define RESID_CONVOLVE_H
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RESID_CONVOLVE_SSE2
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define RESID_CONVOLVE_AVX2
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESID_CONVOLVE_NEON
+#endif
+
+namespace reSID
+{
+
+// Convolution of n samples with n filter taps, sum(a[i]*b[i]) in 32 bit
+// int arithmetic.  All kernels give exactly the same result as the C
+// version; they are fastest when n is a multiple of 16.
+typedef int (*convolve_func_t)(const short* a, const short* b, int n);
+
+int convolve_c(const short* a, const short* b, int n);
+#ifdef RESID_CONVOLVE_SSE2
+int convolve_sse2(const short* a, const short* b, int n);
+#endif
+#ifdef RESID_CONVOLVE_AVX2
+int convolve_avx2(const short* a, const short* b, int n);
+#endif
+#ifdef RESID_CONVOLVE_NEON
+int convolve_neon(const short* a, const short* b, int n);
+#endif
+
+// The kernel used by the resampling, chosen by convolve_init().
+extern convolve_func_t convolve;
+
+// Pick the kernel for the features of the host CPU.  Returns its name.
+const char* convolve_init();
+
+} // namespace reSID
+
+#endif // not RESID_CONVOLVE_H
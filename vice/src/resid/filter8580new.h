@@ -644,6 +644,10 @@ protected:
   // Common parameters.
   static model_filter_t model_filter[2];
 
+  // The tables above are computed once, or read from the table cache.
+  static unsigned int class_table_key();
+  void compute_class_tables();
+
 friend class SID;
 };
 
@@ -25,7 +25,9 @@
 #endif
 
 #include "sid.h"
+#include "convolve.h"
 #include <cmath>
+#include <cstring>
 
 #include <iostream>
 #include <fstream>
@@ -50,6 +52,77 @@ inline short clip(int input)
     return (short)input;
 }
 
+// ----------------------------------------------------------------------------
+// FIR tables, shared by all SIDs resampling with the same parameters, e.g.
+// the chips of a multi SID setup.  SIDs must only be set up from one
+// thread at a time.
+// ----------------------------------------------------------------------------
+struct FirTable
+{
+  FirTable* next;
+  int refs;
+
+  int N;
+  int RES;
+  double beta;
+  double f_cycles_per_sample;
+  double filter_scale;
+
+  short* buffer;
+  short* fir;
+  int stride;
+};
+
+static FirTable* fir_tables = 0;
+
+// Bytes of the sample rings of all SIDs.
+static size_t sample_ring_bytes = 0;
+
+static FirTable* fir_table_find(int N, int RES, double beta,
+                                double f_cycles_per_sample, double filter_scale)
+{
+  for (FirTable* t = fir_tables; t; t = t->next) {
+    if (t->N == N && t->RES == RES && t->beta == beta
+        && t->f_cycles_per_sample == f_cycles_per_sample
+        && t->filter_scale == filter_scale)
+    {
+      return t;
+    }
+  }
+  return 0;
+}
+
+static void fir_table_release(FirTable* table)
+{
+  if (!table || --table->refs > 0) {
+    return;
+  }
+
+  for (FirTable** t = &fir_tables; *t; t = &(*t)->next) {
+    if (*t == table) {
+      *t = table->next;
+      break;
+    }
+  }
+  delete[] table->buffer;
+  delete table;
+}
+
+// ----------------------------------------------------------------------------
+// Bytes held by the FIR tables, which are shared by all SIDs resampling
+// with the same parameters, and by the sample rings.
+// ----------------------------------------------------------------------------
+size_t SID::resampling_bytes()
+{
+  size_t bytes = sample_ring_bytes;
+
+  for (FirTable* t = fir_tables; t; t = t->next) {
+    bytes += (size_t(t->stride)*t->RES + FIR_ALIGN)*sizeof(short);
+  }
+  return bytes;
+}
+
+
 // ----------------------------------------------------------------------------
 // Constructor.
 // ----------------------------------------------------------------------------
@@ -58,17 +131,18 @@ SID::SID()
   // Initialize pointers.
   sample = 0;
   fir = 0;
+  fir_stride = 0;
   fir_N = 0;
   fir_RES = 0;
-  fir_beta = 0;
-  fir_f_cycles_per_sample = 0;
-  fir_filter_scale = 0;
+  fir_table = 0;
 
   sid_model = MOS6581;
   voice[0].set_sync_source(&voice[2]);
   voice[1].set_sync_source(&voice[0]);
   voice[2].set_sync_source(&voice[1]);
 
+  convolve_init();
+
   set_sampling_parameters(985248, SAMPLE_FAST, 44100);
 
   bus_value = 0;
@@ -86,8 +160,11 @@ SID::SID()
 // ----------------------------------------------------------------------------
 SID::~SID()
 {
+  if (sample) {
+    sample_ring_bytes -= (RINGSIZE*2 + FIR_ALIGN)*sizeof(short);
+  }
   delete[] sample;
-  delete[] fir;
+  fir_table_release(fir_table);
 }
 
 
@@ -616,19 +693,25 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   // FIR initialization is only necessary for resampling.
   if (method != SAMPLE_RESAMPLE && method != SAMPLE_RESAMPLE_FASTMEM)
   {
+    if (sample) {
+      sample_ring_bytes -= (RINGSIZE*2 + FIR_ALIGN)*sizeof(short);
+    }
     delete[] sample;
-    delete[] fir;
+    fir_table_release(fir_table);
     sample = 0;
     fir = 0;
+    fir_table = 0;
     return true;
   }
 
-  // Allocate sample buffer.
+  // Allocate sample buffer, the convolution may read up to FIR_ALIGN
+  // samples past the ring for the zero padding taps of the FIR tables.
   if (!sample) {
-    sample = new short[RINGSIZE*2];
+    sample = new short[RINGSIZE*2 + FIR_ALIGN];
+    sample_ring_bytes += (RINGSIZE*2 + FIR_ALIGN)*sizeof(short);
   }
   // Clear sample buffer.
-  for (int j = 0; j < RINGSIZE*2; j++) {
+  for (int j = 0; j < RINGSIZE*2 + FIR_ALIGN; j++) {
     sample[j] = 0;
   }
   sample_index = 0;
@@ -673,36 +756,55 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
   /* Determine if we need to recalculate table, or whether we can reuse earlier cached copy.
    * This pays off on slow hardware such as current Android devices.
    */
-  if (fir && fir_RES_new == fir_RES && fir_N_new == fir_N && beta == fir_beta && f_cycles_per_sample == fir_f_cycles_per_sample && fir_filter_scale == filter_scale) {
-      return true;
-  }
-  fir_RES = fir_RES_new;
-  fir_N = fir_N_new;
-  fir_beta = beta;
-  fir_f_cycles_per_sample = f_cycles_per_sample;
-  fir_filter_scale = filter_scale;
-
-  // Allocate memory for FIR tables.
-  delete[] fir;
-  fir = new short[fir_N*fir_RES];
-
-  // Calculate fir_RES FIR tables for linear interpolation.
-  for (int i = 0; i < fir_RES; i++) {
-    int fir_offset = i*fir_N + fir_N/2;
-    double j_offset = double(i)/fir_RES;
-    // Calculate FIR table. This is the sinc function, weighted by the
-    // Kaiser window.
-    for (int j = -fir_N/2; j <= fir_N/2; j++) {
-      double jx = j - j_offset;
-      double wt = wc*jx/f_cycles_per_sample;
-      double temp = jx/(fir_N/2);
-      double Kaiser = fabs(temp) <= 1 ? I0(beta*sqrt(1 - temp*temp))/I0beta : 0;
-      double sincwt = fabs(wt) >= 1e-6 ? sin(wt)/wt : 1;
-      double val = (1 << FIR_SHIFT)*filter_scale*f_samples_per_cycle*wc/pi*sincwt*Kaiser;
-      fir[fir_offset + j] = (short)round(val);
+  FirTable* table = fir_table_find(fir_N_new, fir_RES_new, beta, f_cycles_per_sample, filter_scale);
+
+  if (table) {
+    table->refs++;
+  } else {
+    table = new FirTable;
+    table->refs = 1;
+    table->N = fir_N_new;
+    table->RES = fir_RES_new;
+    table->beta = beta;
+    table->f_cycles_per_sample = f_cycles_per_sample;
+    table->filter_scale = filter_scale;
+
+    // Allocate memory for FIR tables, each padded to a whole number of
+    // cache lines.
+    table->stride = (fir_N_new + FIR_ALIGN - 1) & ~(FIR_ALIGN - 1);
+    table->buffer = new short[table->stride*fir_RES_new + FIR_ALIGN];
+    table->fir = (short*)(((size_t)table->buffer + FIR_ALIGN*sizeof(short) - 1) & ~(FIR_ALIGN*sizeof(short) - 1));
+    memset(table->fir, 0, table->stride*fir_RES_new*sizeof(short));
+
+    // Calculate fir_RES FIR tables for linear interpolation.
+    for (int i = 0; i < fir_RES_new; i++) {
+      int fir_offset = i*table->stride + fir_N_new/2;
+      double j_offset = double(i)/fir_RES_new;
+      // Calculate FIR table. This is the sinc function, weighted by the
+      // Kaiser window.
+      for (int j = -fir_N_new/2; j <= fir_N_new/2; j++) {
+        double jx = j - j_offset;
+        double wt = wc*jx/f_cycles_per_sample;
+        double temp = jx/(fir_N_new/2);
+        double Kaiser = fabs(temp) <= 1 ? I0(beta*sqrt(1 - temp*temp))/I0beta : 0;
+        double sincwt = fabs(wt) >= 1e-6 ? sin(wt)/wt : 1;
+        double val = (1 << FIR_SHIFT)*filter_scale*f_samples_per_cycle*wc/pi*sincwt*Kaiser;
+        table->fir[fir_offset + j] = (short)round(val);
+      }
     }
+
+    table->next = fir_tables;
+    fir_tables = table;
   }
 
+  // Release the old table after taking the new one, which may be the same.
+  fir_table_release(fir_table);
+  fir_table = table;
+  fir = table->fir;
+  fir_N = table->N;
+  fir_RES = table->RES;
+  fir_stride = table->stride;
+
   return true;
 }
 
@@ -986,14 +1088,11 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
 
     int fir_offset = sample_offset*fir_RES >> FIXP_SHIFT;
     int fir_offset_rmd = sample_offset*fir_RES & FIXP_MASK;
-    short* fir_start = fir + fir_offset*fir_N;
+    short* fir_start = fir + fir_offset*fir_stride;
     short* sample_start = sample + sample_index - fir_N - 1 + RINGSIZE;
 
     // Convolution with filter impulse response.
-    int v1 = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v1 += sample_start[j]*fir_start[j];
-    }
+    int v1 = convolve(sample_start, fir_start, fir_stride);
 
     // Use next FIR table, wrap around to first FIR table using
     // next sample.
@@ -1001,13 +1100,10 @@ int SID::clock_resample(cycle_count& delta_t, short* buf, int n, int interleave)
       fir_offset = 0;
       ++sample_start;
     }
-    fir_start = fir + fir_offset*fir_N;
+    fir_start = fir + fir_offset*fir_stride;
 
     // Convolution with filter impulse response.
-    int v2 = 0;
-    for (int k = 0; k < fir_N; k++) {
-      v2 += sample_start[k]*fir_start[k];
-    }
+    int v2 = convolve(sample_start, fir_start, fir_stride);
 
     // Linear interpolation.
     // fir_offset_rmd is equal for all samples, it can thus be factorized out:
@@ -1052,14 +1148,11 @@ int SID::clock_resample_fastmem(cycle_count& delta_t, short* buf, int n, int int
     sample_offset = next_sample_offset & FIXP_MASK;
 
     int fir_offset = sample_offset*fir_RES >> FIXP_SHIFT;
-    short* fir_start = fir + fir_offset*fir_N;
+    short* fir_start = fir + fir_offset*fir_stride;
     short* sample_start = sample + sample_index - fir_N + RINGSIZE;
 
     // Convolution with filter impulse response.
-    int v = 0;
-    for (int j = 0; j < fir_N; j++) {
-      v += sample_start[j]*fir_start[j];
-    }
+    int v = convolve(sample_start, fir_start, fir_stride);
 
     v >>= FIR_SHIFT;
 
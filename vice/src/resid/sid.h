@@ -22,6 +22,8 @@
 #ifndef RESID_SID_H
 #define RESID_SID_H
 
+#include <stddef.h>
+
 #include "resid-config.h"
 #include "voice.h"
 #if NEW_8580_FILTER
@@ -35,6 +37,8 @@
 namespace reSID
 {
 
+struct FirTable;
+
 class SID
 {
 public:
@@ -103,12 +107,16 @@ public:
 
   void debugoutput(void);
 
+  // Memory used for resampling by all SIDs.
+  static size_t resampling_bytes();
+
  protected:
   static double I0(double x);
   int clock_fast(cycle_count& delta_t, short* buf, int n, int interleave);
   int clock_interpolate(cycle_count& delta_t, short* buf, int n, int interleave);
   int clock_resample(cycle_count& delta_t, short* buf, int n, int interleave);
   int clock_resample_fastmem(cycle_count& delta_t, short* buf, int n, int interleave);
+  void clock_voices();
   void write();
 
   chip_model sid_model;
@@ -142,6 +150,7 @@ public:
     FIR_RES = 285,
     FIR_RES_FASTMEM = 51473,
     FIR_SHIFT = 15,
+    FIR_ALIGN = 32,
 
     RINGSIZE = 1 << 14,
     RINGMASK = RINGSIZE - 1,
@@ -159,15 +168,17 @@ public:
   short sample_prev, sample_now;
   int fir_N;
   int fir_RES;
-  double fir_beta;
-  double fir_f_cycles_per_sample;
-  double fir_filter_scale;
 
   // Ring buffer with overflow for contiguous storage of RINGSIZE samples.
   short* sample;
 
-  // FIR_RES filter tables (FIR_N*FIR_RES).
+  // FIR_RES filter tables (fir_stride*FIR_RES).  Each table is padded with
+  // zero taps to fir_stride and starts on a cache line, for the SIMD
+  // convolution kernels.  The tables are shared by all SIDs resampling
+  // with the same parameters.
   short* fir;
+  int fir_stride;
+  FirTable* fir_table;
 
   bool raw_debug_output; // FIXME: should be private?
 };
@@ -191,6 +202,94 @@ int SID::output()
 }
 
 
+// ----------------------------------------------------------------------------
+// SID clocking of the voices as lanes - 1 cycle.
+// The rate counters and accumulators of the three voices are stepped
+// together in small arrays. A voice which has more to do on this cycle than
+// counting (envelope pipelines, rate period reached, test bit) is clocked on
+// its own instead, and hard sync is resolved for all voices at once from the
+// MSB bit masks. The result is identical to clocking the voices one at a time.
+// ----------------------------------------------------------------------------
+RESID_INLINE
+void SID::clock_voices()
+{
+  int i;
+
+  // Amplitude modulators.
+  reg16 rate_counter[3];
+  int envelope_busy = 0;
+  for (i = 0; i < 3; i++) {
+    EnvelopeGenerator& envelope = voice[i].envelope;
+    rate_counter[i] = envelope.rate_counter;
+    envelope_busy |= ((envelope.state_pipeline | envelope.envelope_pipeline
+                       | envelope.exponential_pipeline
+                       | envelope.reset_rate_counter
+                       | (rate_counter[i] == envelope.rate_period)) != 0) << i;
+  }
+  for (i = 0; i < 3; i++) {
+    // Count up; 0x7fff wraps around to 1, see EnvelopeGenerator::clock().
+    reg16 rate_counter_next = rate_counter[i] + 1;
+    rate_counter[i] = (rate_counter_next + (rate_counter_next >> 15)) & 0x7fff;
+  }
+  for (i = 0; i < 3; i++) {
+    EnvelopeGenerator& envelope = voice[i].envelope;
+    if (likely(!(envelope_busy & (1 << i)))) {
+      envelope.env3 = envelope.envelope_counter;
+      envelope.rate_counter = rate_counter[i];
+    }
+    else {
+      envelope.clock();
+    }
+  }
+
+  // Oscillators.
+  reg24 accumulator[3];
+  reg24 accumulator_bits_set[3];
+  for (i = 0; i < 3; i++) {
+    WaveformGenerator& wave = voice[i].wave;
+    reg24 accumulator_next = (wave.accumulator + wave.freq) & 0xffffff;
+    accumulator_bits_set[i] = ~wave.accumulator & accumulator_next;
+    accumulator[i] = accumulator_next;
+  }
+
+  int msb_rising = 0;
+  int sync = 0;
+  for (i = 0; i < 3; i++) {
+    WaveformGenerator& wave = voice[i].wave;
+    if (unlikely(wave.test)) {
+      wave.clock();
+    }
+    else {
+      wave.accumulator = accumulator[i];
+      wave.msb_rising = (accumulator_bits_set[i] & 0x800000) ? true : false;
+
+      if (unlikely(accumulator_bits_set[i] & 0x080000)) {
+        wave.shift_pipeline = 2;
+      }
+      else if (unlikely(wave.shift_pipeline) && !--wave.shift_pipeline) {
+        wave.clock_shift_register();
+      }
+    }
+    msb_rising |= wave.msb_rising << i;
+    sync |= (wave.sync != 0) << i;
+  }
+
+  // Synchronize oscillators. Voice i is the sync source of voice i + 1, and
+  // does not sync it when voice i is itself synced on the same cycle, see
+  // WaveformGenerator::synchronize().
+  int source_msb_rising = ((msb_rising << 1) | (msb_rising >> 2)) & 0x7;
+  int syncing = msb_rising & ~(sync & source_msb_rising);
+  int synced = ((syncing << 1) | (syncing >> 2)) & sync;
+  if (unlikely(synced)) {
+    for (i = 0; i < 3; i++) {
+      if (synced & (1 << i)) {
+        voice[i].wave.accumulator = 0;
+      }
+    }
+  }
+}
+
+
 // ----------------------------------------------------------------------------
 // SID clocking - 1 cycle.
 // ----------------------------------------------------------------------------
@@ -199,6 +298,10 @@ void SID::clock()
 {
   int i;
 
+#if RESID_VOICE_LANES
+  // Clock amplitude modulators and oscillators, synchronize oscillators.
+  clock_voices();
+#else
   // Clock amplitude modulators.
   for (i = 0; i < 3; i++) {
     voice[i].envelope.clock();
@@ -213,6 +316,7 @@ void SID::clock()
   for (i = 0; i < 3; i++) {
     voice[i].wave.synchronize();
   }
+#endif
 
   // Calculate waveform output.
   for (i = 0; i < 3; i++) {
@@ -0,0 +1,143 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#include "tablecache.h"
+#include "siddefs.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace reSID
+{
+
+static const char table_cache_magic[8] = { 'r', 'e', 'S', 'I', 'D', 't', 'b', '1' };
+
+static char* table_cache_file = 0;
+
+void table_cache_set_file(const char* filename)
+{
+  delete[] table_cache_file;
+  table_cache_file = 0;
+
+  if (filename) {
+    table_cache_file = new char[strlen(filename) + 1];
+    strcpy(table_cache_file, filename);
+  }
+}
+
+// 32 bit FNV-1a.
+unsigned int table_cache_hash(unsigned int hash, const void* data, size_t size)
+{
+  const unsigned char* p = (const unsigned char*)data;
+
+  if (hash == 0) {
+    hash = 2166136261u;
+  }
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ p[i])*16777619u;
+  }
+  return hash;
+}
+
+// The key of the file also covers the reSID version and the block sizes.
+static unsigned int table_cache_key(unsigned int key, const table_cache_block_t* blocks, int n)
+{
+  key = table_cache_hash(key, resid_version_string, strlen(resid_version_string));
+  for (int i = 0; i < n; i++) {
+    key = table_cache_hash(key, &blocks[i].size, sizeof(blocks[i].size));
+  }
+  return key;
+}
+
+bool table_cache_read(unsigned int key, table_cache_block_t* blocks, int n)
+{
+  char magic[sizeof(table_cache_magic)];
+  unsigned int file_key, file_hash, hash = 0;
+  bool ok = false;
+  FILE* f;
+
+  if (!table_cache_file || !(f = fopen(table_cache_file, "rb"))) {
+    return false;
+  }
+
+  key = table_cache_key(key, blocks, n);
+  if (fread(magic, sizeof(magic), 1, f) == 1
+      && memcmp(magic, table_cache_magic, sizeof(magic)) == 0
+      && fread(&file_key, sizeof(file_key), 1, f) == 1
+      && file_key == key
+      && fread(&file_hash, sizeof(file_hash), 1, f) == 1)
+  {
+    int i;
+    for (i = 0; i < n; i++) {
+      if (fread(blocks[i].data, blocks[i].size, 1, f) != 1) {
+        break;
+      }
+      hash = table_cache_hash(hash, blocks[i].data, blocks[i].size);
+    }
+    // A truncated or damaged file is computed again.
+    ok = i == n && hash == file_hash && fgetc(f) == EOF;
+  }
+
+  fclose(f);
+  return ok;
+}
+
+void table_cache_write(unsigned int key, const table_cache_block_t* blocks, int n)
+{
+  unsigned int hash = 0;
+  bool ok;
+  char* tmp;
+  FILE* f;
+
+  if (!table_cache_file) {
+    return;
+  }
+
+  key = table_cache_key(key, blocks, n);
+  for (int i = 0; i < n; i++) {
+    hash = table_cache_hash(hash, blocks[i].data, blocks[i].size);
+  }
+
+  // Write to a temporary file first, so another process never reads a
+  // partly written cache.
+  tmp = new char[strlen(table_cache_file) + 5];
+  strcpy(tmp, table_cache_file);
+  strcat(tmp, ".tmp");
+
+  if (!(f = fopen(tmp, "wb"))) {
+    delete[] tmp;
+    return;
+  }
+  ok = fwrite(table_cache_magic, sizeof(table_cache_magic), 1, f) == 1
+    && fwrite(&key, sizeof(key), 1, f) == 1
+    && fwrite(&hash, sizeof(hash), 1, f) == 1;
+  for (int i = 0; ok && i < n; i++) {
+    ok = fwrite(blocks[i].data, blocks[i].size, 1, f) == 1;
+  }
+  ok = fclose(f) == 0 && ok;
+
+  if (ok) {
+    remove(table_cache_file);
+    ok = rename(tmp, table_cache_file) == 0;
+  }
+  if (!ok) {
+    remove(tmp);
+  }
+  delete[] tmp;
+}
+
+} // namespace reSID
@@ -0,0 +1,53 @@
+//  ---------------------------------------------------------------------------
+//  This file is part of reSID, a MOS6581 SID emulator engine.
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//  ---------------------------------------------------------------------------
+
+#ifndef RESID_TABLECACHE_H
+#define RESID_TABLECACHE_H
+
+#include <stddef.h>
+
+namespace reSID
+{
+
+// The filter lookup tables take a long time to compute, so they can be
+// saved to a file and read back by the next process.  The file is only
+// used when its key matches, which covers the reSID version, the layout of
+// the tables and a hash of the parameters they are computed from.
+
+typedef struct {
+  void* data;
+  size_t size;
+} table_cache_block_t;
+
+// Set the file the tables are cached in, 0 to compute them every time.
+// Must be set before the first SID is created.
+void table_cache_set_file(const char* filename);
+
+// Hash `size' bytes at `data' into `hash', start with hash 0.
+unsigned int table_cache_hash(unsigned int hash, const void* data, size_t size);
+
+// Fill the blocks from the cache file.  Returns false if there is no cache
+// file with this key.
+bool table_cache_read(unsigned int key, table_cache_block_t* blocks, int n);
+
+// Save the blocks to the cache file, if one is set.
+void table_cache_write(unsigned int key, const table_cache_block_t* blocks, int n);
+
+} // namespace reSID
+
+#endif // not RESID_TABLECACHE_H
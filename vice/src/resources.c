@@ -1057,6 +1057,41 @@ void resources_get_event_safe_list(event_list_state_t *list)
     event_record_in_list(list, EVENT_LIST_END, NULL, 0);
 }
 
+/* get a hash of the values of the event relevant resources (tagged with
+   RES_EVENT_SAME or RES_EVENT_STRICT), which make up the configuration of
+   the machine */
+uint32_t resources_get_event_safe_hash(void)
+{
+    unsigned int i;
+    uint32_t hash = 2166136261u;
+    const char *str;
+    int value;
+
+    for (i = 0; i < num_resources; i++) {
+        if (resources[i].event_relevant != RES_EVENT_SAME
+            && resources[i].event_relevant != RES_EVENT_STRICT) {
+            continue;
+        }
+        for (str = resources[i].name; *str; str++) {
+            hash = (hash ^ (uint8_t)*str) * 16777619u;
+        }
+        switch (resources[i].type) {
+            case RES_INTEGER:
+                value = *(int *)resources[i].value_ptr;
+                hash = (hash ^ (uint32_t)value) * 16777619u;
+                break;
+            case RES_STRING:
+                str = *(char **)resources[i].value_ptr;
+                while (str != NULL && *str) {
+                    hash = (hash ^ (uint8_t)*str++) * 16777619u;
+                }
+                break;
+        }
+        hash = (hash ^ 0xff) * 16777619u;
+    }
+    return hash;
+}
+
 int resources_toggle(const char *name, int *new_value_return)
 {
     resource_ram_t *r = lookup(name);
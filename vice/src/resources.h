@@ -31,6 +31,8 @@
 #include <stdio.h>
 #include <stdbool.h>
 
+#include "types.h"
+
 typedef enum resource_type_s {
     RES_INTEGER,
     RES_STRING
@@ -186,6 +188,7 @@ int resources_set_default_string(const char *name, char *value);
 
 int resources_set_event_safe(void);
 void resources_get_event_safe_list(struct event_list_state_s *list);
+uint32_t resources_get_event_safe_hash(void);
 
 /* Register a callback for a resource; use name=NULL to register a callback for all.
    Resource-specific callbacks are always called with a valid resource name as parameter.
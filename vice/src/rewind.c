@@ -0,0 +1,447 @@
+/*
+ * rewind.c - Rewind buffer of periodic in-memory snapshots.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Every `RewindInterval' frames an in-memory snapshot of the machine is
+   taken.  Only the newest state is kept in full; each older state is stored
+   as a reverse delta against the state recorded after it, so stepping back
+   walks the ring from the newest entry towards the oldest one.  When the
+   total size exceeds `RewindBufferSize' KiB the oldest deltas are dropped.
+
+   A delta is a 32-bit size of the state it rebuilds, followed by records
+   of (32-bit skip, 32-bit length, `length' literal bytes): `skip' bytes are
+   copied from the newer state at the same offset, then the literal bytes
+   follow.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cmdline.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "resources.h"
+#include "rewind.h"
+#include "snapshot.h"
+#include "types.h"
+
+/* Minimum number of equal bytes that ends a literal run.  */
+#define REWIND_MIN_MATCH        8
+
+#define REWIND_INITIAL_ENTRIES  16
+
+typedef struct rewind_delta_s {
+    uint8_t *data;
+    size_t size;
+} rewind_delta_t;
+
+/* Ring of reverse deltas, oldest first.  */
+static rewind_delta_t *ring = NULL;
+static int ring_first = 0;
+static int ring_count = 0;
+static int ring_size = 0;
+
+/* The newest recorded state, kept in full.  */
+static uint8_t *current_state = NULL;
+static size_t current_state_size = 0;
+
+/* Total memory used by `current_state' and all deltas.  */
+static size_t used_bytes = 0;
+
+static int frame_counter = 0;
+static int capture_pending = 0;
+
+static log_t rewind_log = LOG_DEFAULT;
+
+/* Resources.  */
+static int rewind_interval = 0;
+static int rewind_buffer_size = 16384;
+
+/* ------------------------------------------------------------------------- */
+
+static void rewind_trim(void);
+
+static int set_rewind_interval(int val, void *param)
+{
+    if (val < 0) {
+        return -1;
+    }
+
+    rewind_interval = val;
+    frame_counter = 0;
+
+    if (rewind_interval == 0) {
+        rewind_reset();
+    }
+
+    return 0;
+}
+
+static int set_rewind_buffer_size(int val, void *param)
+{
+    if (val < 64) {
+        return -1;
+    }
+
+    rewind_buffer_size = val;
+    rewind_trim();
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "RewindInterval", 0, RES_EVENT_NO, NULL,
+      &rewind_interval, set_rewind_interval, NULL },
+    { "RewindBufferSize", 16384, RES_EVENT_NO, NULL,
+      &rewind_buffer_size, set_rewind_buffer_size, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int rewind_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-rewindinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindInterval", NULL,
+      "<frames>", "Record a rewind state every <frames> frames (0: disable)" },
+    { "-rewindbuffersize", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RewindBufferSize", NULL,
+      "<KiB>", "Set the memory budget of the rewind buffer" },
+    CMDLINE_LIST_END
+};
+
+int rewind_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void delta_put_dword(uint8_t **buf, size_t *len, size_t *alloc, uint32_t val)
+{
+    if (*len + 4 > *alloc) {
+        *alloc *= 2;
+        *buf = lib_realloc(*buf, *alloc);
+    }
+    memcpy(*buf + *len, &val, 4);
+    *len += 4;
+}
+
+static void delta_put_bytes(uint8_t **buf, size_t *len, size_t *alloc, const uint8_t *src, size_t n)
+{
+    if (*len + n > *alloc) {
+        while (*len + n > *alloc) {
+            *alloc *= 2;
+        }
+        *buf = lib_realloc(*buf, *alloc);
+    }
+    memcpy(*buf + *len, src, n);
+    *len += n;
+}
+
+/* Encode `target' as a delta against `base'.  */
+static uint8_t *delta_encode(const uint8_t *target, size_t target_size,
+                             const uint8_t *base, size_t base_size,
+                             size_t *delta_size)
+{
+    size_t alloc = 1024;
+    size_t len = 0;
+    size_t i = 0;
+    uint8_t *buf = lib_malloc(alloc);
+
+    delta_put_dword(&buf, &len, &alloc, (uint32_t)target_size);
+
+    while (i < target_size) {
+        size_t skip_start = i;
+        size_t lit_start;
+
+        while (i < target_size && i < base_size && target[i] == base[i]) {
+            i++;
+        }
+        lit_start = i;
+
+        while (i < target_size) {
+            if (i + REWIND_MIN_MATCH <= target_size
+                && i + REWIND_MIN_MATCH <= base_size
+                && memcmp(target + i, base + i, REWIND_MIN_MATCH) == 0) {
+                break;
+            }
+            i++;
+        }
+
+        delta_put_dword(&buf, &len, &alloc, (uint32_t)(lit_start - skip_start));
+        delta_put_dword(&buf, &len, &alloc, (uint32_t)(i - lit_start));
+        delta_put_bytes(&buf, &len, &alloc, target + lit_start, i - lit_start);
+    }
+
+    *delta_size = len;
+    return lib_realloc(buf, len);
+}
+
+/* Rebuild the state described by `delta' from `base'.  */
+static uint8_t *delta_decode(const uint8_t *delta, size_t delta_size,
+                             const uint8_t *base, size_t base_size,
+                             size_t *target_size)
+{
+    uint32_t size, skip, len;
+    size_t pos = 0;
+    const uint8_t *p = delta;
+    const uint8_t *end = delta + delta_size;
+    uint8_t *target;
+
+    memcpy(&size, p, 4);
+    p += 4;
+    target = lib_malloc(size);
+
+    while (pos < size && p + 8 <= end) {
+        memcpy(&skip, p, 4);
+        memcpy(&len, p + 4, 4);
+        p += 8;
+
+        if (pos + skip + len > size || pos + skip > base_size || p + len > end) {
+            lib_free(target);
+            return NULL;
+        }
+        memcpy(target + pos, base + pos, skip);
+        pos += skip;
+        memcpy(target + pos, p, len);
+        pos += len;
+        p += len;
+    }
+
+    if (pos != size) {
+        lib_free(target);
+        return NULL;
+    }
+
+    *target_size = size;
+    return target;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static rewind_delta_t *ring_entry(int n)
+{
+    return &ring[(ring_first + n) % ring_size];
+}
+
+static void ring_push(uint8_t *data, size_t size)
+{
+    rewind_delta_t *entry;
+
+    if (ring_count == ring_size) {
+        int new_size = ring_size ? ring_size * 2 : REWIND_INITIAL_ENTRIES;
+        rewind_delta_t *new_ring = lib_malloc(new_size * sizeof(rewind_delta_t));
+        int i;
+
+        for (i = 0; i < ring_count; i++) {
+            new_ring[i] = *ring_entry(i);
+        }
+        lib_free(ring);
+        ring = new_ring;
+        ring_size = new_size;
+        ring_first = 0;
+    }
+
+    entry = ring_entry(ring_count);
+    entry->data = data;
+    entry->size = size;
+    ring_count++;
+    used_bytes += size;
+}
+
+static void ring_drop_oldest(void)
+{
+    rewind_delta_t *entry = ring_entry(0);
+
+    used_bytes -= entry->size;
+    lib_free(entry->data);
+    entry->data = NULL;
+    ring_first = (ring_first + 1) % ring_size;
+    ring_count--;
+}
+
+static void ring_drop_newest(void)
+{
+    rewind_delta_t *entry = ring_entry(ring_count - 1);
+
+    used_bytes -= entry->size;
+    lib_free(entry->data);
+    entry->data = NULL;
+    ring_count--;
+}
+
+static void rewind_trim(void)
+{
+    size_t budget = (size_t)rewind_buffer_size * 1024;
+
+    while (ring_count > 0 && used_bytes > budget) {
+        ring_drop_oldest();
+    }
+}
+
+static void set_current_state(uint8_t *data, size_t size)
+{
+    used_bytes -= current_state_size;
+    lib_free(current_state);
+    current_state = data;
+    current_state_size = size;
+    used_bytes += size;
+}
+
+void rewind_reset(void)
+{
+    while (ring_count > 0) {
+        ring_drop_oldest();
+    }
+    set_current_state(NULL, 0);
+    frame_counter = 0;
+}
+
+int rewind_get_depth(void)
+{
+    return current_state ? ring_count + 1 : 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void rewind_capture(void)
+{
+    snapshot_t *s;
+    const uint8_t *data;
+    uint8_t *copy;
+    size_t size;
+
+    s = machine_write_snapshot_mem(0, SNAPSHOT_DISKS_REFERENCE, 0);
+    if (s == NULL) {
+        log_error(rewind_log, "Cannot record rewind state.");
+        return;
+    }
+
+    data = snapshot_mem_get_data(s, &size);
+
+    if (current_state != NULL) {
+        uint8_t *delta;
+        size_t delta_size;
+
+        delta = delta_encode(current_state, current_state_size, data, size, &delta_size);
+        ring_push(delta, delta_size);
+    }
+
+    copy = lib_malloc(size);
+    memcpy(copy, data, size);
+    snapshot_close(s);
+
+    set_current_state(copy, size);
+    rewind_trim();
+}
+
+static void rewind_capture_trap(uint16_t addr, void *data)
+{
+    capture_pending = 0;
+
+    if (rewind_interval > 0) {
+        rewind_capture();
+    }
+}
+
+void rewind_vsync_hook(void)
+{
+    if (rewind_interval <= 0 || machine_class == VICE_MACHINE_VSID) {
+        return;
+    }
+
+    if (++frame_counter < rewind_interval || capture_pending) {
+        return;
+    }
+
+    frame_counter = 0;
+    capture_pending = 1;
+    interrupt_maincpu_trigger_trap(rewind_capture_trap, NULL);
+}
+
+int rewind_step_back(int steps)
+{
+    uint8_t *state;
+    size_t state_size;
+
+    if (steps < 1) {
+        steps = 1;
+    }
+
+    if (steps > rewind_get_depth()) {
+        log_error(rewind_log, "Cannot step back %d states, only %d recorded.",
+                  steps, rewind_get_depth());
+        return -1;
+    }
+
+    /* Walk back from the newest state, consuming one delta per step.  */
+    while (--steps > 0) {
+        rewind_delta_t *entry = ring_entry(ring_count - 1);
+
+        state = delta_decode(entry->data, entry->size,
+                             current_state, current_state_size, &state_size);
+        if (state == NULL) {
+            log_error(rewind_log, "Corrupt rewind buffer.");
+            rewind_reset();
+            return -1;
+        }
+        ring_drop_newest();
+        set_current_state(state, state_size);
+    }
+
+    frame_counter = 0;
+
+    if (machine_read_snapshot_mem(current_state, current_state_size, 0) < 0) {
+        log_error(rewind_log, "Cannot restore rewind state.");
+        rewind_reset();
+        return -1;
+    }
+
+    return 0;
+}
+
+static void rewind_step_back_trap(uint16_t addr, void *data)
+{
+    rewind_step_back(vice_ptr_to_int(data));
+}
+
+void rewind_trigger_step_back(int steps)
+{
+    interrupt_maincpu_trigger_trap(rewind_step_back_trap, vice_int_to_ptr(steps));
+}
+
+void rewind_shutdown(void)
+{
+    rewind_reset();
+    lib_free(ring);
+    ring = NULL;
+    ring_size = 0;
+    ring_first = 0;
+}
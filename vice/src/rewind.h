@@ -0,0 +1,49 @@
+/*
+ * rewind.h - Rewind buffer of periodic in-memory snapshots.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_REWIND_H
+#define VICE_REWIND_H
+
+int rewind_resources_init(void);
+int rewind_cmdline_options_init(void);
+void rewind_shutdown(void);
+
+/* Called once per emulated frame from vsync_do_vsync().  */
+void rewind_vsync_hook(void);
+
+/* Drop all recorded states.  */
+void rewind_reset(void);
+
+/* Number of states that can currently be stepped back to.  */
+int rewind_get_depth(void);
+
+/* Restore the state recorded `steps' intervals ago; must be called from
+   the emulation thread at an instruction boundary (e.g. the monitor or a
+   CPU trap).  Returns 0 on success, -1 on error.  */
+int rewind_step_back(int steps);
+
+/* Same as rewind_step_back(), but can be called from anywhere; the
+   restore happens asynchronously in a CPU trap.  */
+void rewind_trigger_step_back(int steps);
+
+#endif
@@ -33,6 +33,12 @@
  *
  * I/O is done to a socket.  If the socket isnt connected, no data
  * is read and written data is discarded.
+ *
+ * Each open connection gets a reader and a writer thread, which move
+ * the data between the socket and two byte rings in chunks.  Sending and
+ * receiving a byte from the emulation then only touches the rings, instead
+ * of doing a select() and a one byte recv() or send() on every character.
+ * If the threads cannot be started, the socket is accessed directly.
  */
 
 #undef DEBUG
@@ -43,6 +49,7 @@
 #ifdef HAVE_RS232NET
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -87,6 +94,39 @@ int rs232net_cmdline_options_init(void)
 
 /* ------------------------------------------------------------------------- */
 
+/* Size of the receive and transmit rings, must be a power of two */
+#define RS232NET_RING_SIZE      4096
+
+/* Timeout of the reader thread's select(), bounds the time closing a
+   connection waits for the reader thread to notice */
+#define RS232NET_POLL_USEC      50000
+
+/* Bytes moved from or to the socket with one recv() or send() */
+#define RS232NET_CHUNK_SIZE     1024
+
+/* byte ring, protected by the lock of the connection */
+typedef struct rs232net_ring_s {
+    unsigned int head;  /*!< next byte to read */
+    unsigned int tail;  /*!< next byte to write */
+    uint8_t data[RS232NET_RING_SIZE];
+} rs232net_ring_t;
+
+/* state shared with the I/O threads of a connection */
+typedef struct rs232net_io_s {
+    vice_network_socket_t *sock;    /*!< the socket of the connection */
+    pthread_t reader;           /*!< moves data from the socket to rx */
+    pthread_t writer;           /*!< moves data from tx to the socket */
+    pthread_mutex_t lock;       /*!< protects everything below */
+    pthread_cond_t rx_space;    /*!< signalled when rx is no longer full */
+    pthread_cond_t tx_data;     /*!< signalled when tx is no longer empty */
+    int stop;                   /*!< 1 to make the threads exit */
+    int error;                  /*!< 1 once a thread saw an error or EOF */
+    int errorcode;              /*!< error code of that error, 0 for EOF */
+    unsigned long dropped;      /*!< bytes dropped on a full tx ring */
+    rs232net_ring_t rx;         /*!< received bytes */
+    rs232net_ring_t tx;         /*!< bytes to send */
+} rs232net_io_t;
+
 typedef struct rs232net {
     int inuse; /*!< 0 if the connection has not been opened, 1 otherwise. */
     vice_network_socket_t * fd; /*!< the vice_network_socket_t for the connection.
@@ -98,6 +138,8 @@ typedef struct rs232net {
     int dcd_in;   /*!< ip232 status of DCD line */
     int ri_in;    /*!< ip232 status of RI line */
     int dtr_out;  /*!< ip232 status of DTR line */
+    rs232net_io_t *io; /*!< I/O threads of the connection, or NULL if the
+                            socket is accessed directly */
 } rs232net_t;
 
 /* C99 standard guarantees all members of an object of static storage are
@@ -111,6 +153,178 @@ static log_t rs232net_log = LOG_ERR;
 void rs232net_close(int fd);
 static int _rs232net_putc(int fd, uint8_t b);
 
+static unsigned int rs232net_ring_used(const rs232net_ring_t *ring)
+{
+    return ring->tail - ring->head;
+}
+
+static unsigned int rs232net_ring_free(const rs232net_ring_t *ring)
+{
+    return RS232NET_RING_SIZE - rs232net_ring_used(ring);
+}
+
+/* report an error or EOF seen by an I/O thread, called with the lock held */
+static void rs232net_io_error(rs232net_io_t *io, int errorcode)
+{
+    if (!io->error) {
+        io->error = 1;
+        io->errorcode = errorcode;
+    }
+    io->stop = 1;
+    pthread_cond_broadcast(&io->rx_space);
+    pthread_cond_broadcast(&io->tx_data);
+}
+
+static void *rs232net_reader(void *arg)
+{
+    rs232net_io_t *io = arg;
+    vice_network_socket_t *sockets[2] = { io->sock, NULL };
+    uint8_t buf[RS232NET_CHUNK_SIZE];
+
+    pthread_mutex_lock(&io->lock);
+    while (!io->stop) {
+        unsigned int space;
+        unsigned int i;
+        int n;
+
+        space = rs232net_ring_free(&io->rx);
+        if (space == 0) {
+            pthread_cond_wait(&io->rx_space, &io->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&io->lock);
+
+        n = vice_network_select_multiple_timeout(sockets, RS232NET_POLL_USEC);
+        if (n > 0) {
+            n = vice_network_receive(sockets[0], buf,
+                                     space < sizeof buf ? space : sizeof buf, 0);
+        } else if (n == 0) {
+            pthread_mutex_lock(&io->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&io->lock);
+        if (n <= 0) {
+            rs232net_io_error(io, n < 0 ? vice_network_get_errorcode() : 0);
+            break;
+        }
+        for (i = 0; i < (unsigned int)n; i++) {
+            io->rx.data[io->rx.tail++ & (RS232NET_RING_SIZE - 1)] = buf[i];
+        }
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    return NULL;
+}
+
+static void *rs232net_writer(void *arg)
+{
+    rs232net_io_t *io = arg;
+    uint8_t buf[RS232NET_CHUNK_SIZE];
+
+    pthread_mutex_lock(&io->lock);
+    while (!io->error) {
+        unsigned int len;
+        unsigned int done;
+
+        len = rs232net_ring_used(&io->tx);
+        if (len == 0) {
+            /* only exit once everything queued before the stop is sent */
+            if (io->stop) {
+                break;
+            }
+            pthread_cond_wait(&io->tx_data, &io->lock);
+            continue;
+        }
+        if (len > sizeof buf) {
+            len = sizeof buf;
+        }
+        for (done = 0; done < len; done++) {
+            buf[done] = io->tx.data[io->tx.head++ & (RS232NET_RING_SIZE - 1)];
+        }
+        pthread_mutex_unlock(&io->lock);
+
+        for (done = 0; done < len; ) {
+            int n = vice_network_send(io->sock, buf + done, len - done, 0);
+            if (n <= 0) {
+                break;
+            }
+            done += (unsigned int)n;
+        }
+
+        pthread_mutex_lock(&io->lock);
+        if (done < len) {
+            rs232net_io_error(io, vice_network_get_errorcode());
+        }
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    return NULL;
+}
+
+/* start the I/O threads of a connection, returns NULL on failure */
+static rs232net_io_t *rs232net_io_start(vice_network_socket_t *sock)
+{
+    rs232net_io_t *io = lib_calloc(1, sizeof *io);
+
+    io->sock = sock;
+    pthread_mutex_init(&io->lock, NULL);
+    pthread_cond_init(&io->rx_space, NULL);
+    pthread_cond_init(&io->tx_data, NULL);
+
+    if (pthread_create(&io->reader, NULL, rs232net_reader, io) != 0) {
+        goto fail;
+    }
+    if (pthread_create(&io->writer, NULL, rs232net_writer, io) != 0) {
+        pthread_mutex_lock(&io->lock);
+        io->stop = 1;
+        pthread_mutex_unlock(&io->lock);
+        pthread_join(io->reader, NULL);
+        goto fail;
+    }
+    return io;
+
+fail:
+    log_warning(rs232net_log, "Cannot start I/O threads, accessing the socket directly.");
+    pthread_cond_destroy(&io->tx_data);
+    pthread_cond_destroy(&io->rx_space);
+    pthread_mutex_destroy(&io->lock);
+    lib_free(io);
+    return NULL;
+}
+
+/* stop the I/O threads of a connection, sending what is still queued */
+static void rs232net_io_stop(rs232net_io_t *io)
+{
+    pthread_mutex_lock(&io->lock);
+    io->stop = 1;
+    pthread_cond_broadcast(&io->rx_space);
+    pthread_cond_broadcast(&io->tx_data);
+    pthread_mutex_unlock(&io->lock);
+
+    pthread_join(io->writer, NULL);
+    pthread_join(io->reader, NULL);
+
+    if (io->dropped) {
+        log_warning(rs232net_log, "%lu bytes dropped on a full transmit buffer.", io->dropped);
+    }
+
+    pthread_cond_destroy(&io->tx_data);
+    pthread_cond_destroy(&io->rx_space);
+    pthread_mutex_destroy(&io->lock);
+    lib_free(io);
+}
+
+/* log the error an I/O thread saw, called with the lock held */
+static void rs232net_io_log_error(rs232net_io_t *io)
+{
+    if (io->errorcode) {
+        log_error(rs232net_log, "Error on connection: %d.", io->errorcode);
+    } else {
+        log_error(rs232net_log, "EOF");
+    }
+}
+
 /* initializes all RS232 stuff */
 void rs232net_init(void)
 {
@@ -167,6 +381,7 @@ int rs232net_open(int device)
 
         fds[i].inuse = 1;
         fds[i].useip232 = rs232_useip232[device];
+        fds[i].io = rs232net_io_start(fds[i].fd);
 
         index = i;
 
@@ -181,6 +396,10 @@ int rs232net_open(int device)
 
 static void rs232net_closesocket(int index)
 {
+    if (fds[index].io) {
+        rs232net_io_stop(fds[index].io);
+        fds[index].io = NULL;
+    }
     vice_network_socket_close(fds[index].fd);
     fds[index].fd = 0;
 }
@@ -234,6 +453,28 @@ static int _rs232net_putc(int fd, uint8_t b)
     /* for the beginning... */
     DEBUG_LOG_MESSAGE((rs232net_log, "Output 0x%02x '%c'.", b, isgraph((unsigned char)b) ? b : '.'));
 
+    if (fds[fd].io) {
+        rs232net_io_t *io = fds[fd].io;
+
+        pthread_mutex_lock(&io->lock);
+        if (io->error) {
+            rs232net_io_log_error(io);
+            pthread_mutex_unlock(&io->lock);
+            rs232net_closesocket(fd);
+            return -1;
+        }
+        if (rs232net_ring_free(&io->tx) == 0) {
+            io->dropped++;
+        } else {
+            if (rs232net_ring_used(&io->tx) == 0) {
+                pthread_cond_signal(&io->tx_data);
+            }
+            io->tx.data[io->tx.tail++ & (RS232NET_RING_SIZE - 1)] = b;
+        }
+        pthread_mutex_unlock(&io->lock);
+        return 0;
+    }
+
     n = vice_network_send(fds[fd].fd, &b, 1, 0);
     if (n < 0) {
         log_error(rs232net_log, "Error writing: %d.", vice_network_get_errorcode());
@@ -270,6 +511,30 @@ static int _rs232net_getc(int fd, uint8_t * b)
             break;
         }
 
+        if (fds[fd].io) {
+            rs232net_io_t *io = fds[fd].io;
+
+            pthread_mutex_lock(&io->lock);
+            if (rs232net_ring_used(&io->rx) > 0) {
+                if (rs232net_ring_free(&io->rx) == 0) {
+                    pthread_cond_signal(&io->rx_space);
+                }
+                *b = io->rx.data[io->rx.head++ & (RS232NET_RING_SIZE - 1)];
+                no_of_read_byte = 1;
+                DEBUG_LOG_MESSAGE((rs232net_log, "Input 0x%02x '%c'.", *b, isgraph((unsigned char)*b) ? *b : '.'));
+            } else if (io->error) {
+                /* only report the error once all received data is read */
+                rs232net_io_log_error(io);
+                no_of_read_byte = -1;
+            }
+            pthread_mutex_unlock(&io->lock);
+
+            if (no_of_read_byte < 0) {
+                rs232net_closesocket(fd);
+            }
+            break;
+        }
+
         ret = vice_network_select_poll_one(fds[fd].fd);
 
         if (ret > 0) {
@@ -0,0 +1,242 @@
+/*
+ * runahead.c - Run-ahead to hide the input latency of the emulated programs.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With `RunAhead' set to N, every real frame is followed by N frames
+   emulated ahead of it: at the end of the real frame the machine state is
+   saved in memory, N frames are emulated as fast as possible with the
+   current input, the last one is displayed and the saved state is restored
+   again.  The real frames are paced and heard but not displayed, the
+   frames ahead are displayed (only the last) but not heard.  Many programs
+   act on the input one or two frames after reading it; with enough frames
+   ahead the effect is shown in the frame after the input changed.
+
+   The input state is not taken from the saved state when it is restored,
+   so input arriving while running ahead is kept.  Anything else that
+   changes the state from the outside while running ahead (reset, snapshot,
+   rewind, ...) goes through vsync_suspend_speed_eval(), which cancels the
+   run-ahead; the emulation then simply continues from the state ahead.
+   Run-ahead is off while warp, autostart, event recording or playback and
+   network play are active.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "autostart.h"
+#include "cmdline.h"
+#include "interrupt.h"
+#include "joystick.h"
+#include "keyboard.h"
+#include "log.h"
+#include "machine.h"
+#include "network.h"
+#include "resources.h"
+#include "runahead.h"
+#include "snapshot.h"
+#include "sound.h"
+#include "types.h"
+#include "vice-event.h"
+#include "vsync.h"
+
+#define RUNAHEAD_MAX_FRAMES 8
+
+/* The machine state at the end of the last real frame, NULL while no frames
+   ahead are emulated.  */
+static snapshot_t *saved_state = NULL;
+
+/* Frames ahead still to be emulated.  */
+static int frames_left = 0;
+
+static int save_pending = 0;
+static int restore_pending = 0;
+static int restoring = 0;
+
+static log_t runahead_log = LOG_DEFAULT;
+
+/* `RunAhead' resource.  */
+static int runahead_frames = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static int set_runahead_frames(int val, void *param)
+{
+    if (val < 0 || val > RUNAHEAD_MAX_FRAMES) {
+        return -1;
+    }
+
+    runahead_frames = val;
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "RunAhead", 0, RES_EVENT_NO, NULL,
+      &runahead_frames, set_runahead_frames, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int runahead_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-runahead", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RunAhead", NULL,
+      "<frames>", "Display the frame <frames> frames ahead of the emulation (0: disable, max 8)" },
+    CMDLINE_LIST_END
+};
+
+int runahead_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static bool runahead_enabled(void)
+{
+    return runahead_frames > 0
+           && machine_class != VICE_MACHINE_VSID
+           && !vsync_get_warp_mode()
+           && !network_connected()
+           && !event_record_active()
+           && !event_playback_active()
+           && !autostart_in_progress();
+}
+
+static void runahead_drop_state(void)
+{
+    snapshot_close(saved_state);
+    saved_state = NULL;
+    frames_left = 0;
+}
+
+static void runahead_save_trap(uint16_t addr, void *data)
+{
+    save_pending = 0;
+
+    if (saved_state != NULL || !runahead_enabled()) {
+        return;
+    }
+
+    saved_state = machine_write_snapshot_mem(0, 0, 0);
+    if (saved_state == NULL) {
+        log_error(runahead_log, "Cannot save the state, run-ahead disabled.");
+        runahead_frames = 0;
+        return;
+    }
+
+    sound_runahead_begin();
+    frames_left = runahead_frames;
+}
+
+static void runahead_restore_trap(uint16_t addr, void *data)
+{
+    int keys[KBD_ROWS];
+    int rev_keys[KBD_COLS];
+    const uint8_t *state;
+    size_t size;
+    int ret;
+
+    restore_pending = 0;
+
+    if (saved_state == NULL) {
+        /* cancelled */
+        return;
+    }
+
+    memcpy(keys, keyarr, sizeof(keys));
+    memcpy(rev_keys, rev_keyarr, sizeof(rev_keys));
+
+    state = snapshot_mem_get_data(saved_state, &size);
+
+    restoring = 1;
+    ret = machine_read_snapshot_mem(state, size, 0);
+    restoring = 0;
+
+    sound_runahead_end(ret == 0);
+    runahead_drop_state();
+
+    memcpy(keyarr, keys, sizeof(keys));
+    memcpy(rev_keyarr, rev_keys, sizeof(rev_keys));
+    joystick_relatch();
+
+    if (ret < 0) {
+        log_error(runahead_log, "Cannot restore the state, run-ahead disabled.");
+        runahead_frames = 0;
+    }
+}
+
+void runahead_vsync_hook(void)
+{
+    if (saved_state != NULL) {
+        if (frames_left > 0 && --frames_left == 0 && !restore_pending) {
+            restore_pending = 1;
+            interrupt_maincpu_trigger_trap(runahead_restore_trap, NULL);
+        }
+        return;
+    }
+
+    if (!save_pending && runahead_enabled()) {
+        save_pending = 1;
+        interrupt_maincpu_trigger_trap(runahead_save_trap, NULL);
+    }
+}
+
+bool runahead_in_progress(void)
+{
+    return saved_state != NULL;
+}
+
+bool runahead_should_skip_frame(void)
+{
+    if (saved_state != NULL) {
+        return frames_left != 1;
+    }
+
+    return runahead_enabled();
+}
+
+bool runahead_restoring(void)
+{
+    return restoring != 0;
+}
+
+void runahead_cancel(void)
+{
+    if (restoring || saved_state == NULL) {
+        return;
+    }
+
+    sound_runahead_end(0);
+    runahead_drop_state();
+}
+
+void runahead_shutdown(void)
+{
+    runahead_cancel();
+}
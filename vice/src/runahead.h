@@ -0,0 +1,50 @@
+/*
+ * runahead.h - Run-ahead to hide the input latency of the emulated programs.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_RUNAHEAD_H
+#define VICE_RUNAHEAD_H
+
+#include <stdbool.h>
+
+int runahead_resources_init(void);
+int runahead_cmdline_options_init(void);
+void runahead_shutdown(void);
+
+/* Called once per emulated frame from vsync_do_vsync().  */
+void runahead_vsync_hook(void);
+
+/* True while the frames ahead of the real state are emulated: nothing but
+   the emulation itself must happen, no pacing, sound or metrics.  */
+bool runahead_in_progress(void);
+
+/* True if the video output of the frame that just ended is to be skipped.  */
+bool runahead_should_skip_frame(void);
+
+/* True while the saved state is being restored.  */
+bool runahead_restoring(void);
+
+/* Drop the saved state and continue from the current one, because it was
+   changed from the outside (reset, snapshot, rewind, ...).  */
+void runahead_cancel(void);
+
+#endif
@@ -334,29 +334,60 @@ void scpu64_clock_read_ioram(void) /* scpu64 v1 $d200-$d3ff one extra 20 Mhz cyc
 /* SCPU64 needs external reg_pc */
 #define NEED_REG_PC
 
-#define STORE(addr, value) \
-    do { \
-        uint32_t tmpx1 = (addr); \
-        uint8_t tmpx2 = (value); \
-        if (tmpx1 & ~0xffff) { \
-            mem_store2(tmpx1, tmpx2); \
-        } else { \
-            (*_mem_write_tab_ptr[tmpx1 >> 8])((uint16_t)tmpx1, tmpx2); \
-        } \
-    } while (0)
-
-#define LOAD(addr) \
-    (((addr) & ~0xffff)?mem_read2(addr):(*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)(addr)))
-
-#define STORE_LONG(addr, value) store_long((uint32_t)(addr), (uint8_t)(value))
+/* Plain SRAM in banks 0 and 1 and the linearly mapped SIMM are accessed
+   directly, everything else through the memory tables, mem_read2() and
+   mem_store2().  In fast mode ram_read() and ram_store() do nothing but
+   access mem_sram, their BA checks only matter at 1MHz.  */
+static inline uint8_t scpu64_load(uint32_t addr)
+{
+    if (addr & ~0xffff) {
+        if (addr >= 0x20000) {
+            if (addr < mem_simm_fast_limit) {
+                scpu64_clock_read_stretch_simm(addr);
+                return mem_simm_ram[addr & mem_simm_ram_mask];
+            }
+        } else if (addr & 0xfffe) {
+            return mem_sram[addr];
+        }
+        return mem_read2(addr);
+    }
+    if (scpu64_fastmode && _mem_read_tab_ptr[addr >> 8] == ram_read) {
+        return mem_sram[addr];
+    }
+    return (*_mem_read_tab_ptr[addr >> 8])((uint16_t)addr);
+}
 
-static inline void store_long(uint32_t addr, uint8_t value)
+static inline void scpu64_store(uint32_t addr, uint8_t value)
 {
     if (addr & ~0xffff) {
+        if (addr >= 0x20000) {
+            if (addr < mem_simm_fast_limit) {
+                mem_simm_ram[addr & mem_simm_ram_mask] = value;
+                scpu64_clock_write_stretch_simm(addr);
+                return;
+            }
+        } else if ((addr & 0xfffe) && addr < 0x1e000) {
+            /* the trap RAM mirror starts at $1E000 */
+            mem_sram[addr] = value;
+            return;
+        }
         mem_store2(addr, value);
+    } else if (scpu64_fastmode && _mem_write_tab_ptr[addr >> 8] == ram_store) {
+        mem_sram[addr] = value;
     } else {
         (*_mem_write_tab_ptr[addr >> 8])((uint16_t)addr, value);
     }
+}
+
+#define STORE(addr, value) scpu64_store((uint32_t)(addr), (uint8_t)(value))
+
+#define LOAD(addr) scpu64_load((uint32_t)(addr))
+
+#define STORE_LONG(addr, value) store_long((uint32_t)(addr), (uint8_t)(value))
+
+static inline void store_long(uint32_t addr, uint8_t value)
+{
+    scpu64_store(addr, value);
     scpu64_clock_inc(1);
 }
 
@@ -364,13 +395,8 @@ static inline void store_long(uint32_t addr, uint8_t value)
 
 static inline uint8_t load_long(uint32_t addr)
 {
-    uint8_t tmp;
+    uint8_t tmp = scpu64_load(addr);
 
-    if ((addr) & ~0xffff) {
-        tmp = mem_read2(addr);
-    } else {
-        tmp = (*_mem_read_tab_ptr[(addr) >> 8])((uint16_t)addr);
-    }
     scpu64_clock_inc(0);
     return tmp;
 }
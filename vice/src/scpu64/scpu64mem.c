@@ -94,6 +94,7 @@ static int mem_simm_page_size;
 static int mem_conf_page_size;
 static int mem_conf_size;
 unsigned int mem_simm_ram_mask = 0;
+unsigned int mem_simm_fast_limit = 0;
 uint8_t mem_tooslow[1];
 static int traps_pending;
 
@@ -456,6 +457,12 @@ uint8_t mem_dma_read(uint16_t addr)
     return retval;
 }
 
+/* DMA here runs cycle by cycle along with the VIC-II, no block copies.  */
+uint8_t *mem_dma_ram_page(uint16_t addr)
+{
+    return NULL;
+}
+
 
 /* ------------------------------------------------------------------------- */
 
@@ -1473,6 +1480,18 @@ void mem_set_mirroring(int new_mirroring)
     }
 }
 
+/* The SIMM below this address is mapped linearly (the SIMM and the
+   configured page sizes match), so the CPU can access it without going
+   through mem_read2() and mem_store2().  0 if there is no such SIMM.  */
+static void mem_simm_update_fast_limit(void)
+{
+    if (mem_simm_ram_mask && mem_simm_page_size == mem_conf_page_size) {
+        mem_simm_fast_limit = mem_conf_size < 0xf60000 ? (unsigned int)mem_conf_size : 0xf60000;
+    } else {
+        mem_simm_fast_limit = 0;
+    }
+}
+
 void mem_set_simm(int config)
 {
     switch (config & 7) {
@@ -1498,6 +1517,7 @@ void mem_set_simm(int config)
         break;
     }
     scpu64_set_simm_row_size(mem_conf_page_size);
+    mem_simm_update_fast_limit();
 }
 
 void scpu64_hardware_reset(void)
@@ -2015,6 +2035,54 @@ uint8_t mem_bank_peek(int bank, uint16_t addr, void *context)
     return mem_bank_read(bank, addr, context);
 }
 
+/* Plain memory behind `addr' in `bank' for the monitor, see
+   monitor_interface_t.  Only the banks of the static RAM, the SIMM and the
+   ROM qualify.  */
+uint8_t *mem_bank_base(int bank, uint16_t addr, unsigned int *len, void *context)
+{
+    unsigned int addr2, end;
+
+    if ((bank >= 5) && (bank <= 6)) {
+        *len = 0x10000 - addr;
+        return mem_sram + ((bank - 5) << 16) + addr; /* ram00..01 */
+    }
+    if ((bank >= 7) && (bank <= 252)) {
+        addr2 = addr + ((bank - ((bank >= 251) ? 251 : 5)) << 16);
+        if (mem_simm_page_size != mem_conf_page_size || !mem_simm_ram_mask
+            || addr2 >= (unsigned int)mem_conf_size || addr2 > mem_simm_ram_mask) {
+            return NULL;
+        }
+        end = (addr2 | 0xffff) + 1;
+        if (end > (unsigned int)mem_conf_size) {
+            end = mem_conf_size;
+        }
+        if (end > mem_simm_ram_mask + 1) {
+            end = mem_simm_ram_mask + 1;
+        }
+        *len = end - addr2;
+        return mem_simm_ram + addr2; /* ram02..f6 */
+    }
+    if ((bank >= 253) && (bank <= 260)) {
+        addr2 = (((bank - 253) << 16) + addr) & (SCPU64_SCPU64_ROM_MAXSIZE - 1);
+        *len = 0x10000 - addr;
+        return scpu64rom_scpu64_rom + addr2; /* romf8..ff */
+    }
+    return NULL;
+}
+
+/* Memory that mem_bank_poke() would write `addr' in `bank' to, see
+   monitor_interface_t.  The same banks as for mem_bank_base() qualify.  */
+uint8_t *mem_bank_write_base(int bank, uint16_t addr, unsigned int *len, void *context)
+{
+    unsigned int max;
+    uint8_t *p = mem_bank_base(bank, addr, &max, context);
+
+    if (p != NULL && *len > max) {
+        *len = max;
+    }
+    return p;
+}
+
 int mem_get_current_bank_config(void) {
     return 0; /* TODO: not implemented yet */
 }
@@ -2150,6 +2218,7 @@ void mem_set_simm_size(int val)
             mem_simm_page_size = 11 + 2;  /* 4,3 */
             break;
     }
+    mem_simm_update_fast_limit();
     maincpu_resync_limits();
 }
 
@@ -52,7 +52,9 @@ extern int mem_reg_bootmap;            /* boot map */
 extern int mem_reg_simm;               /* simm configuration */
 extern int mem_pport;                  /* processor "port" */
 
+extern uint8_t *mem_simm_ram;
 extern unsigned int mem_simm_ram_mask;
+extern unsigned int mem_simm_fast_limit;
 
 int c64_mem_init_resources(void);
 int c64_mem_init_cmdline_options(void);
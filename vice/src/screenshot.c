@@ -138,6 +138,21 @@ static void screenshot_line_data(screenshot_t *screenshot, uint8_t *data,
     }
 }
 
+static const uint8_t *screenshot_line_indices(screenshot_t *screenshot, uint8_t *data,
+                                              unsigned int line)
+{
+    if (screenshot->size_width == 1 && line < screenshot->height) {
+        /* The color map is always the identity, see screenshot_save_core().  */
+        return BUFFER_LINE_START(screenshot,
+                                 (line + screenshot->y_offset)
+                                 * screenshot->size_height)
+               + screenshot->x_offset;
+    }
+
+    screenshot_line_data(screenshot, data, line, SCREENSHOT_MODE_PALETTE);
+    return data;
+}
+
 /*-----------------------------------------------------------------------*/
 static int screenshot_save_core(screenshot_t *screenshot, gfxoutputdrv_t *drv,
                                 const char *filename)
@@ -155,6 +170,7 @@ static int screenshot_save_core(screenshot_t *screenshot, gfxoutputdrv_t *drv,
     }
 
     screenshot->convert_line = screenshot_line_data;
+    screenshot->line_indices = screenshot_line_indices;
 
     if (drv != NULL) {
         if (drv->save_native != NULL) {
@@ -227,6 +243,57 @@ int screenshot_save(const char *drvname, const char *filename,
     return result;
 }
 
+/** \brief  Hash the visible area of \a canvas
+ *
+ * The hash is taken over the palette indices, so it does not change with
+ * the palette or the video renderer, and covers the same area a screenshot
+ * would show.
+ *
+ * \param[in]   canvas  video canvas
+ * \param[out]  hash    64-bit FNV-1a hash of the visible area
+ *
+ * \return  0 on success, -1 on failure
+ */
+int screenshot_hash(struct video_canvas_s *canvas, uint64_t *hash)
+{
+    screenshot_t screenshot;
+    uint8_t *data;
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+    unsigned int line, i;
+
+    if (machine_screenshot(&screenshot, canvas) < 0) {
+        log_error(screenshot_log, "Retrieving screen geometry failed.");
+        return -1;
+    }
+
+    screenshot.width = screenshot.max_width & ~3;
+    screenshot.height = screenshot.last_displayed_line - screenshot.first_displayed_line + 1;
+    screenshot.y_offset = screenshot.first_displayed_line;
+    screenshot.color_map = lib_calloc(1, 256);
+    for (i = 0; i < screenshot.palette->num_entries; i++) {
+        screenshot.color_map[i] = i;
+    }
+
+    /* the size is part of the hash, so a blank screen of another size
+       does not match */
+    h = (h ^ screenshot.width) * UINT64_C(0x100000001b3);
+    h = (h ^ screenshot.height) * UINT64_C(0x100000001b3);
+
+    data = lib_malloc(screenshot.width);
+    for (line = 0; line < screenshot.height; line++) {
+        const uint8_t *indices = screenshot_line_indices(&screenshot, data, line);
+
+        for (i = 0; i < screenshot.width; i++) {
+            h = (h ^ indices[i]) * UINT64_C(0x100000001b3);
+        }
+    }
+    lib_free(data);
+    lib_free(screenshot.color_map);
+
+    *hash = h;
+    return 0;
+}
+
 #ifdef FEATURE_CPUMEMHISTORY
 int memmap_screenshot_save(const char *drvname, const char *filename, int x_size, int y_size, uint8_t *gfx, uint8_t *palette)
 {
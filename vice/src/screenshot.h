@@ -101,6 +101,11 @@ typedef struct screenshot_s {
     void (*convert_line)(struct screenshot_s *screenshot, uint8_t *data,
                          unsigned int line, unsigned int mode);
 
+    /* Palette indices of a line, `width' bytes.  Points straight into the
+       draw buffer if possible, otherwise the line is converted into `data'.  */
+    const uint8_t *(*line_indices)(struct screenshot_s *screenshot, uint8_t *data,
+                                   unsigned int line);
+
     /* Pointer for graphics outout driver internal data.  */
     struct gfxoutputdrv_data_s *gfxoutputdrv_data;
 
@@ -137,6 +142,7 @@ typedef struct screenshot_s {
 int screenshot_init(void);
 void screenshot_shutdown(void);
 int screenshot_save(const char *drvname, const char *filename, struct video_canvas_s *canvas);
+int screenshot_hash(struct video_canvas_s *canvas, uint64_t *hash);
 int screenshot_record(void);
 void screenshot_stop_recording(void);
 int screenshot_is_recording(void);
@@ -82,7 +82,18 @@ void serial_shutdown(void);
 int serial_install_traps(void);
 int serial_remove_traps(void);
 
+/* The byte loop of the KERNAL LOAD routine: the address its call of the
+   receive routine pushes on the stack, the code from that call on, the
+   zero page pointer the bytes are stored through and the verify flag.  */
+typedef struct serial_trap_load_s {
+    uint16_t ret_addr;
+    uint8_t check[9];
+    uint16_t ptr;
+    uint16_t verify;
+} serial_trap_load_t;
+
 void serial_trap_init(uint16_t tmpin);
+void serial_trap_load_set(const serial_trap_load_t *load);
 int serial_trap_attention(void);
 int serial_trap_send(void);
 int serial_trap_receive(void);
@@ -97,6 +108,7 @@ void serial_realdevice_disable(void);
 
 int serial_iec_lib_directory(unsigned int unit, const char *pattern, uint8_t **buf);
 int serial_iec_lib_read_sector(unsigned int unit, unsigned int track, unsigned int sector, uint8_t *buf);
+int serial_iec_lib_read_sectors(unsigned int unit, unsigned int track, unsigned int sector, unsigned int count, uint8_t *buf);
 int serial_iec_lib_write_sector(unsigned int unit, unsigned int track, unsigned int sector, uint8_t *buf);
 
 serial_t *serial_device_get(unsigned int unit);
@@ -83,6 +83,40 @@ int serial_iec_lib_read_sector(unsigned int unit, unsigned int track,
     return 0;
 }
 
+/* Read `count' consecutive sectors of one track into `buf', keeping the
+   buffer and command channels open for the whole run instead of reopening
+   them for every block.  */
+int serial_iec_lib_read_sectors(unsigned int unit, unsigned int track,
+                                unsigned int sector, unsigned int count,
+                                uint8_t *buf)
+{
+    char *command;
+    unsigned int i, n;
+    size_t len;
+
+    serial_iec_open(unit, 2, "#", (unsigned int)strlen("#"));
+    serial_iec_open(unit, 15, NULL, 0);
+
+    for (n = 0; n < count; n++) {
+        command = lib_msprintf("U1 2 0 %u %u", track, sector + n);
+        len = strlen(command);
+        for (i = 0; i < len; i++) {
+            serial_iec_write(unit, 15, (uint8_t)command[i]);
+        }
+        serial_iec_write(unit, 15, 0x0d);
+        lib_free(command);
+
+        for (i = 0; i < 256; i++) {
+            serial_iec_read(unit, 2, &buf[n * 256 + i]);
+        }
+    }
+
+    serial_iec_close(unit, 15);
+    serial_iec_close(unit, 2);
+
+    return 0;
+}
+
 int serial_iec_lib_write_sector(unsigned int unit, unsigned int track,
                                 unsigned int sector, uint8_t *buf)
 {
@@ -80,6 +80,9 @@ static uint8_t TrapSecondary;
 
 static int ActiveDevice = -1;
 
+/* Byte loop of the KERNAL LOAD, NULL if the machine has none set.  */
+static const serial_trap_load_t *load_loop = NULL;
+
 /* Function to call when EOF happens in `serialreceivebyte()'.  */
 static void (*eof_callback_func)(void);
 
@@ -236,6 +239,53 @@ int serial_trap_send(void)
     return 1;
 }
 
+/* Check if the receive routine was called by the byte loop of LOAD.  */
+static int serial_trap_load_caller(void)
+{
+    uint8_t sp;
+    uint16_t ret;
+    int i;
+
+    if (load_loop == NULL || mem_read(load_loop->verify) != 0) {
+        return 0;
+    }
+
+    sp = maincpu_get_sp();
+    ret = mem_read((uint16_t)(0x100 + (uint8_t)(sp + 1)))
+          | (mem_read((uint16_t)(0x100 + (uint8_t)(sp + 2))) << 8);
+    if (ret != load_loop->ret_addr) {
+        return 0;
+    }
+
+    for (i = 0; i < (int)sizeof(load_loop->check); i++) {
+        if (mem_read((uint16_t)(ret - 2 + i)) != load_loop->check[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Store the bytes of a LOAD to the memory in one go, like the KERNAL loop
+   would do.  The byte with EOI or a timeout is left to the KERNAL, so it
+   ends the load (or retries) the usual way.  */
+static uint8_t serial_trap_load_bulk(uint8_t data)
+{
+    uint16_t addr;
+    unsigned int count;
+
+    addr = mem_read(load_loop->ptr) | (mem_read((uint16_t)(load_loop->ptr + 1)) << 8);
+
+    for (count = 0; count < 0x10000 && !(serial_get_st() & 0x42); count++) {
+        mem_store(addr++, data);
+        data = serial_iec_bus_read(TrapDevice, TrapSecondary, serial_set_st);
+    }
+
+    mem_store(load_loop->ptr, (uint8_t)(addr & 0xff));
+    mem_store((uint16_t)(load_loop->ptr + 1), (uint8_t)(addr >> 8));
+
+    return data;
+}
+
 /* Receive one byte from the serial bus.  */
 int serial_trap_receive(void)
 {
@@ -257,6 +307,10 @@ int serial_trap_receive(void)
     }
     data = serial_iec_bus_read(TrapDevice, TrapSecondary, serial_set_st);
 
+    if (!(serial_get_st() & 0x42) && serial_trap_load_caller()) {
+        data = serial_trap_load_bulk(data);
+    }
+
     mem_store(tmp_in, data);
 
     /* If at EOF, call specified callback function.  */
@@ -313,6 +367,11 @@ void serial_trap_init(uint16_t tmpin)
     tmp_in = tmpin;
 }
 
+void serial_trap_load_set(const serial_trap_load_t *load)
+{
+    load_loop = load;
+}
+
 /* FIXME: bad name, this function is basically the main/top entry point for
           doing a IEC reset that distributes to all drives. It does however NOT
           reset the true-drive emulated drive CPUs (that is done in drive_reset)
@@ -50,6 +50,15 @@
 
 #include "fixpoint.h"
 
+/* vector unit used for mixing the voices */
+#if defined(__SSE2__) || defined(_M_X64)
+#define FASTSID_MIX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FASTSID_MIX_NEON
+#include <arm_neon.h>
+#endif
+
 #ifndef TRUE
 #define TRUE 1
 #endif
@@ -775,94 +784,176 @@ static float fastsid_calculate_single_sample(sound_t *psid, int i)
     return tmp_out / 32767.0;
 }
 #else
-static int16_t fastsid_calculate_single_sample(sound_t *psid, int i)
+/* number of samples the voices are clocked, filtered and mixed at a time */
+#define FASTSID_BLOCK 256
+
+/* Clock the voices for `n' samples, storing their outputs in `o0'-`o2'.
+   Hard sync and ring modulation tie the voices together within a sample,
+   so this part runs one sample at a time.  */
+static void fastsid_clock_voices(sound_t *psid, uint32_t *o0, uint32_t *o1,
+                                 uint32_t *o2, int n)
 {
-    uint32_t o0, o1, o2;
-    int dosync1, dosync2;
-    voice_t *v0, *v1, *v2;
+    int i, dosync1, dosync2;
+    voice_t *v0 = &psid->v[0];
+    voice_t *v1 = &psid->v[1];
+    voice_t *v2 = &psid->v[2];
+
+    for (i = 0; i < n; i++) {
+        /* addfptrs, noise & hard sync test */
+        dosync1 = 0;
+        if ((v0->f += v0->fs) < v0->fs) {
+            v0->rv = NSHIFT(v0->rv, 16);
+            if (v1->sync) {
+                dosync1 = 1;
+            }
+        }
+        dosync2 = 0;
+        if ((v1->f += v1->fs) < v1->fs) {
+            v1->rv = NSHIFT(v1->rv, 16);
+            if (v2->sync) {
+                dosync2 = 1;
+            }
+        }
+        if ((v2->f += v2->fs) < v2->fs) {
+            v2->rv = NSHIFT(v2->rv, 16);
+            if (v0->sync) {
+                /* hard sync */
+                v0->rv = NSHIFT(v0->rv, v0->f >> 28);
+                v0->f = 0;
+            }
+        }
 
-    setup_sid(psid);
-    v0 = &psid->v[0];
-    setup_voice(v0);
-    v1 = &psid->v[1];
-    setup_voice(v1);
-    v2 = &psid->v[2];
-    setup_voice(v2);
+        /* hard sync */
+        if (dosync2) {
+            v2->rv = NSHIFT(v2->rv, v2->f >> 28);
+            v2->f = 0;
+        }
+        if (dosync1) {
+            v1->rv = NSHIFT(v1->rv, v1->f >> 28);
+            v1->f = 0;
+        }
 
-    /* addfptrs, noise & hard sync test */
-    dosync1 = 0;
-    if ((v0->f += v0->fs) < v0->fs) {
-        v0->rv = NSHIFT(v0->rv, 16);
-        if (v1->sync) {
-            dosync1 = 1;
+        /* do adsr */
+        if ((v0->adsr += v0->adsrs) + 0x80000000 < v0->adsrz + 0x80000000) {
+            trigger_adsr(v0);
         }
-    }
-    dosync2 = 0;
-    if ((v1->f += v1->fs) < v1->fs) {
-        v1->rv = NSHIFT(v1->rv, 16);
-        if (v2->sync) {
-            dosync2 = 1;
+        if ((v1->adsr += v1->adsrs) + 0x80000000 < v1->adsrz + 0x80000000) {
+            trigger_adsr(v1);
         }
-    }
-    if ((v2->f += v2->fs) < v2->fs) {
-        v2->rv = NSHIFT(v2->rv, 16);
-        if (v0->sync) {
-            /* hard sync */
-            v0->rv = NSHIFT(v0->rv, v0->f >> 28);
-            v0->f = 0;
+        if ((v2->adsr += v2->adsrs) + 0x80000000 < v2->adsrz + 0x80000000) {
+            trigger_adsr(v2);
         }
-    }
 
-    /* hard sync */
-    if (dosync2) {
-        v2->rv = NSHIFT(v2->rv, v2->f >> 28);
-        v2->f = 0;
-    }
-    if (dosync1) {
-        v1->rv = NSHIFT(v1->rv, v1->f >> 28);
-        v1->f = 0;
+        /* oscillators */
+        o0[i] = v0->adsr >> 16;
+        o1[i] = v1->adsr >> 16;
+        o2[i] = v2->adsr >> 16;
+        if (o0[i]) {
+            o0[i] *= doosc(v0);
+        }
+        if (o1[i]) {
+            o1[i] *= doosc(v1);
+        }
+        if (psid->has3 && o2[i]) {
+            o2[i] *= doosc(v2);
+        } else {
+            o2[i] = 0;
+        }
     }
+}
 
-    /* do adsr */
-    if ((v0->adsr += v0->adsrs) + 0x80000000 < v0->adsrz + 0x80000000) {
-        trigger_adsr(v0);
-    }
-    if ((v1->adsr += v1->adsrs) + 0x80000000 < v1->adsrz + 0x80000000) {
-        trigger_adsr(v1);
-    }
-    if ((v2->adsr += v2->adsrs) + 0x80000000 < v2->adsrz + 0x80000000) {
-        trigger_adsr(v2);
-    }
+/* Pass `n' outputs of voice `pv' through the filter.  The filter state of
+   a voice depends only on its own output, so each voice is done on its own
+   for the whole block.  */
+static void fastsid_filter_voice(voice_t *pv, uint32_t *o, int n)
+{
+    int i;
 
-    /* oscillators */
-    o0 = v0->adsr >> 16;
-    o1 = v1->adsr >> 16;
-    o2 = v2->adsr >> 16;
-    if (o0) {
-        o0 *= doosc(v0);
+    for (i = 0; i < n; i++) {
+        pv->filtIO = ampMod1x8[(o[i] >> 22)];
+        dofilter(pv);
+        o[i] = ((uint32_t)(pv->filtIO) + 0x80) << (7 + 15);
     }
-    if (o1) {
-        o1 *= doosc(v1);
+}
+
+/* Mix `n' samples of the three voices at volume `vol' into `out'.  The sum
+   wraps around in 32 bits and the result is truncated to 16 bits like the
+   scalar code does, so all versions give the same samples.  */
+static void fastsid_mix(const uint32_t *o0, const uint32_t *o1,
+                        const uint32_t *o2, int16_t *out, int n, int vol)
+{
+    int i = 0;
+
+#if defined(FASTSID_MIX_SSE2)
+    const __m128i bias = _mm_set1_epi32(0x600);
+    const __m128i volume = _mm_set1_epi16((short)vol);
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(o0 + i)),
+                                                _mm_loadu_si128((const __m128i *)(o1 + i))),
+                                  _mm_loadu_si128((const __m128i *)(o2 + i)));
+        __m128i b = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i *)(o0 + i + 4)),
+                                                _mm_loadu_si128((const __m128i *)(o1 + i + 4))),
+                                  _mm_loadu_si128((const __m128i *)(o2 + i + 4)));
+
+        /* -0x600..0x9ff, so packing does not saturate */
+        a = _mm_sub_epi32(_mm_srli_epi32(a, 20), bias);
+        b = _mm_sub_epi32(_mm_srli_epi32(b, 20), bias);
+        _mm_storeu_si128((__m128i *)(out + i),
+                         _mm_mullo_epi16(_mm_packs_epi32(a, b), volume));
     }
-    if (psid->has3 && o2) {
-        o2 *= doosc(v2);
-    } else {
-        o2 = 0;
+#elif defined(FASTSID_MIX_NEON)
+    const int32x4_t bias = vdupq_n_s32(0x600);
+
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t sum = vaddq_u32(vaddq_u32(vld1q_u32(o0 + i), vld1q_u32(o1 + i)),
+                                   vld1q_u32(o2 + i));
+        int32x4_t sample = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(sum, 20)), bias);
+
+        vst1_s16(out + i, vmovn_s32(vmulq_n_s32(sample, vol)));
     }
-    /* sample */
-    if (psid->emulatefilter) {
-        v0->filtIO = ampMod1x8[(o0 >> 22)];
-        dofilter(v0);
-        o0 = ((uint32_t)(v0->filtIO) + 0x80) << (7 + 15);
-        v1->filtIO = ampMod1x8[(o1 >> 22)];
-        dofilter(v1);
-        o1 = ((uint32_t)(v1->filtIO) + 0x80) << (7 + 15);
-        v2->filtIO = ampMod1x8[(o2 >> 22)];
-        dofilter(v2);
-        o2 = ((uint32_t)(v2->filtIO) + 0x80) << (7 + 15);
+#endif
+    for (; i < n; i++) {
+        out[i] = (int16_t)(((int32_t)((o0[i] + o1[i] + o2[i]) >> 20) - 0x600) * vol);
     }
+}
+
+/* Calculate `nr' samples into every `interleave'th element of `pbuf'.  */
+static void fastsid_calculate_block(sound_t *psid, int16_t *pbuf, int nr, int interleave)
+{
+    uint32_t o0[FASTSID_BLOCK], o1[FASTSID_BLOCK], o2[FASTSID_BLOCK];
+    int16_t mixed[FASTSID_BLOCK];
+    int i, n;
+
+    /* registers only change between calls, so the SID and voices need no
+       updating within the block */
+    setup_sid(psid);
+    setup_voice(&psid->v[0]);
+    setup_voice(&psid->v[1]);
+    setup_voice(&psid->v[2]);
+
+    while (nr > 0) {
+        n = nr < FASTSID_BLOCK ? nr : FASTSID_BLOCK;
+
+        fastsid_clock_voices(psid, o0, o1, o2, n);
+        if (psid->emulatefilter) {
+            fastsid_filter_voice(&psid->v[0], o0, n);
+            fastsid_filter_voice(&psid->v[1], o1, n);
+            fastsid_filter_voice(&psid->v[2], o2, n);
+        }
+
+        if (interleave == 1) {
+            fastsid_mix(o0, o1, o2, pbuf, n, psid->vol);
+        } else {
+            fastsid_mix(o0, o1, o2, mixed, n, psid->vol);
+            for (i = 0; i < n; i++) {
+                pbuf[i * interleave] = mixed[i];
+            }
+        }
 
-    return (int16_t)(((int32_t)((o0 + o1 + o2) >> 20) - 0x600) * psid->vol);
+        pbuf += n * interleave;
+        nr -= n;
+    }
 }
 #endif
 
@@ -887,19 +978,14 @@ static int fastsid_calculate_samples(sound_t *psid, float *pbuf, int nr, CLOCK *
 #else
 static int fastsid_calculate_samples(sound_t *psid, int16_t *pbuf, int nr, int interleave, CLOCK *delta_t)
 {
-    int i;
     int16_t *tmp_buf;
 
     if (psid->factor == 1000) {
-        for (i = 0; i < nr; i++) {
-            pbuf[i * interleave] = fastsid_calculate_single_sample(psid, i);
-        }
+        fastsid_calculate_block(psid, pbuf, nr, interleave);
         return nr;
     }
     tmp_buf = getbuf(2 * nr * psid->factor / 1000);
-    for (i = 0; i < (nr * psid->factor / 1000); i++) {
-        tmp_buf[i * interleave] = fastsid_calculate_single_sample(psid, i);
-    }
+    fastsid_calculate_block(psid, tmp_buf, nr * psid->factor / 1000, interleave);
     memcpy(pbuf, tmp_buf, 2 * nr);
     return nr;
 }
@@ -1212,7 +1298,8 @@ sid_engine_t fastsid_hooks =
     fastsid_calculate_samples,
     fastsid_dump_state,
     fastsid_resid_state_read,
-    fastsid_resid_state_write
+    fastsid_resid_state_write,
+    NULL
 };
 
 /* ---------------------------------------------------------------------*/
@@ -52,6 +52,7 @@
 #define hardsid_drv_read(addr, chipno)  (printf("hardsid_drv_read addr:%02x chip:%d\n", addr, chipno), 1)
 #define hardsid_drv_store(addr, val, chipno) printf("hardsid_drv_store addr:%02x val:%02x chip:%d\n", addr, val, chipno)
 #define hardsid_drv_set_device(chipno, device) printf("hardsid_drv_set_device chip:%02x device:%u\n", chipno, device)
+#define hardsid_drv_set_latency(ms) printf("hardsid_drv_set_latency ms:%d\n", ms)
 #define hardsid_drv_state_read(chipno, sid_state) printf("hardsid_drv_state_read chip:%d sid_state:%p\n", chipno, sid_state)
 #define hardsid_drv_state_write(chipno, sid_state) printf("hardsid_drv_state_write chip:%d sid_state:%p\n", chipno, sid_state)
 
@@ -142,6 +143,12 @@ void hardsid_set_device(unsigned int chipno, unsigned int device)
     }
 }
 
+/* Queue the writes for up to `ms' milliseconds where the driver can.  */
+void hardsid_set_latency(int ms)
+{
+    hardsid_drv_set_latency(ms);
+}
+
 /* ---------------------------------------------------------------------*/
 
 void hardsid_state_read(int chipno, struct sid_hs_snapshot_state_s *sid_state)
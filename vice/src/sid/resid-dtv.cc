@@ -187,6 +187,18 @@ static void resid_reset(sound_t *psid, CLOCK cpu_clk)
     psid->sid->reset();
 }
 
+/* Clock the chip without sampling: the voices, and with them what the
+   registers read back, end up exactly as with sampling.  */
+static void resid_skip(sound_t *psid, CLOCK delta_t)
+{
+    while (delta_t > 0) {
+        int cycles = delta_t > 0x10000 ? 0x10000 : (int)delta_t;
+
+        psid->sid->clock(cycles);
+        delta_t -= cycles;
+    }
+}
+
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int resid_calculate_samples(sound_t *psid, float *pbuf, int nr, CLOCK *delta_t)
@@ -330,7 +342,8 @@ sid_engine_t resid_hooks =
     resid_calculate_samples,
     resid_dump_state,
     resid_state_read,
-    resid_state_write
+    resid_state_write,
+    resid_skip
 };
 
 } // extern "C"
@@ -35,19 +35,25 @@
 
 extern "C" {
 
+#include <stdio.h>
 #include <string.h>
 
 #include "sid/sid.h" /* sid_engine_t */
+#include "archdep.h"
 #include "lib.h"
 #include "log.h"
+#include "memusage.h"
 #include "resid.h"
 #include "resources.h"
 #include "sid-snapshot.h"
 #include "types.h"
+#include "util.h"
 
 } // extern "C"
 
 #include "resid/sid.h"
+#include "resid/convolve.h"
+#include "resid/tablecache.h"
 /* resid-dtv/ is used for DTVSID, but the API is the same */
 
 using namespace reSID;
@@ -61,26 +67,49 @@ struct sound_s
 
     /* resid sid implementation */
     reSID::SID *sid;
+
+    /* temporary buffer, one per chip so chips can be rendered on different
+       threads */
+    short *buf;
+    int blen;
 };
 
 typedef struct sound_s sound_t;
 
 /* manage temporary buffers. if the requested size is smaller or equal to the
  * size of the already allocated buffer, reuse it.  */
-static short *buf = NULL;
-
-static int blen = 0;
-
-static short *getbuf(int len)
+static short *getbuf(sound_t *psid, int len)
 {
-    if ((buf == NULL) || (blen < len)) {
-        if (buf) {
-            lib_free(buf);
+    if ((psid->buf == NULL) || (psid->blen < len)) {
+        if (psid->buf) {
+            lib_free(psid->buf);
         }
-        blen = len;
-        buf = (short *)lib_calloc(len, 1);
+        psid->blen = len;
+        psid->buf = (short *)lib_calloc(len, 1);
+    }
+    return psid->buf;
+}
+
+/* The filter tables are computed when the first SID is created, and then
+   kept in the user cache directory to speed up the next start.  */
+static void resid_set_table_cache(void)
+{
+    int enabled;
+    char *path;
+
+    if (resources_get_int("SidResidTableCache", &enabled) < 0 || !enabled) {
+        reSID::table_cache_set_file(NULL);
+        return;
     }
-    return buf;
+
+    path = util_join_paths(archdep_user_cache_path(), "resid-tables.bin", NULL);
+    reSID::table_cache_set_file(path);
+    lib_free(path);
+}
+
+static size_t resid_usage(void)
+{
+    return reSID::SID::resampling_bytes();
 }
 
 static sound_t *resid_open(uint8_t *sidstate)
@@ -88,8 +117,13 @@ static sound_t *resid_open(uint8_t *sidstate)
     sound_t *psid;
     int i;
 
+    resid_set_table_cache();
+    memusage_register("reSID resampling", resid_usage);
+
     psid = new sound_t;
     psid->sid = new reSID::SID;
+    psid->buf = NULL;
+    psid->blen = 0;
 
     for (i = 0x00; i <= 0x18; i++) {
         psid->sid->write(i, sidstate[i]);
@@ -226,10 +260,12 @@ static int resid_init(sound_t *psid, int speed, int cycles_per_sec, int factor)
 
     psid->sid->enable_raw_debug_output(rawoutput);
 
-    log_message(LOG_DEFAULT, "reSID: %s, filter %s, sampling rate %dHz - %s%s",
+    log_message(LOG_DEFAULT, "reSID: %s, filter %s, sampling rate %dHz - %s%s%s%s",
                 model_text,
                 filters_enabled ? "on" : "off",
                 speed, method_text,
+                method == SAMPLE_RESAMPLE || method == SAMPLE_RESAMPLE_FASTMEM ? ", " : "",
+                method == SAMPLE_RESAMPLE || method == SAMPLE_RESAMPLE_FASTMEM ? convolve_init() : "",
                 rawoutput ? ", raw debug output enabled": "");
 
     return 1;
@@ -237,13 +273,12 @@ static int resid_init(sound_t *psid, int speed, int cycles_per_sec, int factor)
 
 static void resid_close(sound_t *psid)
 {
+    if (psid->buf) {
+        lib_free(psid->buf);
+    }
+
     delete psid->sid;
     delete psid;
-
-    if (buf) {
-        lib_free(buf);
-        buf = NULL;
-    }
 }
 
 static uint8_t resid_read(sound_t *psid, uint16_t addr)
@@ -261,6 +296,18 @@ static void resid_reset(sound_t *psid, CLOCK cpu_clk)
     psid->sid->reset();
 }
 
+/* Clock the chip without sampling: the voices, and with them what the
+   registers read back, end up exactly as with sampling.  */
+static void resid_skip(sound_t *psid, CLOCK delta_t)
+{
+    while (delta_t > 0) {
+        int cycles = delta_t > 0x10000 ? 0x10000 : (int)delta_t;
+
+        psid->sid->clock(cycles);
+        delta_t -= cycles;
+    }
+}
+
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int resid_calculate_samples(sound_t *psid, float *pbuf, int nr, CLOCK *delta_t)
@@ -274,7 +321,7 @@ static int resid_calculate_samples(sound_t *psid, float *pbuf, int nr, CLOCK *de
     /* Tried not to mess with resid during 64-bit conversion. clock(...) wants to modify *delta_t ... */
 
     if (psid->factor == 1000) {
-        tmp_buf = getbuf(2 * nr);
+        tmp_buf = getbuf(psid, 2 * nr);
         retval = psid->sid->clock(int_delta_t, tmp_buf, nr, 0);
         (*delta_t) += int_delta_t - int_delta_t_original;
         for (i = 0; i < nr; i++) {
@@ -283,7 +330,7 @@ static int resid_calculate_samples(sound_t *psid, float *pbuf, int nr, CLOCK *de
         return retval;
     }
 
-    tmp_buf = getbuf(2 * nr * psid->factor / 1000);
+    tmp_buf = getbuf(psid, 2 * nr * psid->factor / 1000);
     retval = psid->sid->clock(int_delta_t, tmp_buf, nr * psid->factor / 1000, 0) * 1000 / psid->factor;
     (*delta_t) += int_delta_t - int_delta_t_original;
     for (i = 0; i < nr; i++) {
@@ -308,7 +355,7 @@ static int resid_calculate_samples(sound_t *psid, short *pbuf, int nr, int inter
         return retval;
     }
 
-    tmp_buf = getbuf(2 * nr * psid->factor / 1000);
+    tmp_buf = getbuf(psid, 2 * nr * psid->factor / 1000);
     retval = psid->sid->clock(int_delta_t, tmp_buf, nr * psid->factor / 1000, interleave) * 1000 / psid->factor;
     (*delta_t) += int_delta_t - int_delta_t_original;
     memcpy(pbuf, tmp_buf, 2 * nr);
@@ -433,6 +480,145 @@ static void resid_state_write(sound_t *psid, sid_snapshot_state_t *sid_state)
     psid->sid->write_state((const reSID::SID::State)state);
 }
 
+/* -residbench: resample the same register writes with every convolution
+   kernel the host CPU supports, time it and check that the sound is
+   exactly the same as with the C kernel.  */
+
+#define RESIDBENCH_CLOCK    985248
+#define RESIDBENCH_RATE     44100
+#define RESIDBENCH_PASSBAND (RESIDBENCH_RATE * 0.45)
+#define RESIDBENCH_FPS      50
+
+typedef struct resid_bench_kernel_s {
+    const char *name;
+    convolve_func_t func;
+} resid_bench_kernel_t;
+
+static double resid_bench_run(sampling_method method, convolve_func_t func,
+                              short *out, int samples)
+{
+    reSID::SID *sid = new reSID::SID;
+    convolve_func_t selected = convolve;
+    cycle_count delta_t;
+    tick_t start;
+    double seconds;
+    int frame, pos = 0, i;
+
+    sid->set_chip_model(MOS6581);
+    sid->set_sampling_parameters(RESIDBENCH_CLOCK, method, RESIDBENCH_RATE,
+                                 RESIDBENCH_PASSBAND);
+
+    /* noise, pulse and sawtooth at full volume, the noise through the
+       resonant low pass filter */
+    for (i = 0; i < 3; i++) {
+        sid->write(i * 7 + 2, 0x00);
+        sid->write(i * 7 + 3, 0x08);
+        sid->write(i * 7 + 5, 0x00);
+        sid->write(i * 7 + 6, 0xf0);
+    }
+    sid->write(0x04, 0x81);
+    sid->write(0x0b, 0x41);
+    sid->write(0x12, 0x21);
+    sid->write(0x17, 0xf1);
+    sid->write(0x18, 0x1f);
+
+    convolve = func;
+    start = tick_now();
+
+    for (frame = 0; pos < samples; frame++) {
+        /* sweep the frequencies and the cutoff once per frame */
+        for (i = 0; i < 3; i++) {
+            int freq = (frame * 397 + i * 1231) & 0xffff;
+
+            sid->write(i * 7 + 0, freq & 0xff);
+            sid->write(i * 7 + 1, freq >> 8);
+        }
+        sid->write(0x15, frame & 7);
+        sid->write(0x16, (frame * 3) & 0xff);
+
+        delta_t = RESIDBENCH_CLOCK / RESIDBENCH_FPS;
+        while (delta_t > 0 && pos < samples) {
+            pos += sid->clock(delta_t, out + pos, samples - pos);
+        }
+    }
+
+    seconds = (double)tick_now_delta(start) / tick_per_second();
+    convolve = selected;
+    delete sid;
+
+    return seconds > 0.0 ? seconds : 1.0 / tick_per_second();
+}
+
+int resid_benchmark(int seconds)
+{
+    static const struct {
+        sampling_method method;
+        const char *name;
+    } methods[] = {
+        { SAMPLE_RESAMPLE, "resampling" },
+        { SAMPLE_RESAMPLE_FASTMEM, "fast resampling" }
+    };
+    resid_bench_kernel_t kernels[4];
+    short *reference, *out;
+    int samples = seconds * RESIDBENCH_RATE;
+    int num_kernels = 0;
+    int result = 0;
+    int m, k, i;
+
+    kernels[num_kernels].name = "C";
+    kernels[num_kernels++].func = convolve_c;
+#ifdef RESID_CONVOLVE_SSE2
+    kernels[num_kernels].name = "SSE2";
+    kernels[num_kernels++].func = convolve_sse2;
+#endif
+#ifdef RESID_CONVOLVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels[num_kernels].name = "AVX2";
+        kernels[num_kernels++].func = convolve_avx2;
+    }
+#endif
+#ifdef RESID_CONVOLVE_NEON
+    kernels[num_kernels].name = "NEON";
+    kernels[num_kernels++].func = convolve_neon;
+#endif
+
+    reference = (short *)lib_malloc(samples * sizeof(short));
+    out = (short *)lib_malloc(samples * sizeof(short));
+
+    for (m = 0; m < (int)(sizeof(methods) / sizeof(methods[0])); m++) {
+        double reference_seconds = resid_bench_run(methods[m].method, convolve_c,
+                                                   reference, samples);
+
+        fprintf(stdout, "RESIDBENCH: %s, %d samples, %s: %.3f s\n",
+                methods[m].name, samples, kernels[0].name, reference_seconds);
+
+        for (k = 1; k < num_kernels; k++) {
+            double kernel_seconds = resid_bench_run(methods[m].method, kernels[k].func,
+                                                    out, samples);
+
+            for (i = 0; i < samples && out[i] == reference[i]; i++) {
+            }
+            fprintf(stdout, "RESIDBENCH: %s, %d samples, %s: %.3f s, %.2fx",
+                    methods[m].name, samples, kernels[k].name, kernel_seconds,
+                    reference_seconds / kernel_seconds);
+            if (i < samples) {
+                fprintf(stdout, ", differs from C at sample %d (%d != %d)\n",
+                        i, out[i], reference[i]);
+                result = -1;
+            } else {
+                fprintf(stdout, ", identical to C\n");
+            }
+        }
+    }
+    fflush(stdout);
+
+    lib_free(reference);
+    lib_free(out);
+
+    return result;
+}
+
 sid_engine_t resid_hooks =
 {
     resid_open,
@@ -444,7 +630,8 @@ sid_engine_t resid_hooks =
     resid_calculate_samples,
     resid_dump_state,
     resid_state_read,
-    resid_state_write
+    resid_state_write,
+    resid_skip
 };
 
 } // extern "C"
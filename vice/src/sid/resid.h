@@ -31,4 +31,8 @@
 
 extern sid_engine_t resid_hooks;
 
+/* Run the -residbench benchmark on `seconds' of sound, returns -1 if a
+   convolution kernel does not give the same sound as the C version.  */
+int resid_benchmark(int seconds);
+
 #endif
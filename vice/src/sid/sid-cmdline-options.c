@@ -33,6 +33,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "archdep.h"
 #include "cmdline.h"
 #include "hardsid.h"
 #include "lib.h"
@@ -41,6 +42,8 @@
 #include "sid.h"
 #include "sid-cmdline-options.h"
 #include "sid-resources.h"
+#include "sidqueue.h"
+#include "sidrecord.h"
 #include "util.h"
 
 #ifdef HAVE_CATWEASELMKIII
@@ -55,6 +58,10 @@
 #include "parsid.h"
 #endif
 
+#ifdef HAVE_RESID
+#include "resid.h"
+#endif
+
 static char *sid2_address_range = NULL;
 static char *sid3_address_range = NULL;
 static char *sid4_address_range = NULL;
@@ -171,6 +178,17 @@ static cmdline_option_t siddtvengine_cmdline_options[] =
     CMDLINE_LIST_END
 };
 
+static int residbench(const char *param, void *extra_param)
+{
+    int seconds = atoi(param);
+
+    if (seconds < 1) {
+        return -1;
+    }
+    archdep_vice_exit(resid_benchmark(seconds) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+    return 0;
+}
+
 static const cmdline_option_t resid_cmdline_options[] =
 {
     { "-residsamp", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
@@ -198,6 +216,13 @@ static const cmdline_option_t resid_cmdline_options[] =
       NULL, NULL, "SidResidEnableRawOutput", (void *)1, NULL, "Enable writing raw reSID output to resid.raw, 16bit little endian data (WARNING: 1MiB per second)." },
     { "+residrawoutput", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "SidResidEnableRawOutput", (void *)0, NULL, "Disable writing raw reSID output to resid.raw." },
+    { "-residtablecache", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidResidTableCache", (void *)1, NULL, "Keep the reSID filter tables in the user cache directory to speed up starting." },
+    { "+residtablecache", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidResidTableCache", (void *)0, NULL, "Compute the reSID filter tables on every start." },
+    { "-residbench", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      residbench, NULL, NULL, NULL,
+      "<seconds>", "Resample <seconds> of sound with each reSID convolution kernel, check them against the C version and quit" },
     CMDLINE_LIST_END
 };
 #endif
@@ -211,6 +236,9 @@ static const cmdline_option_t hardsid_cmdline_options[] =
     { "-hardsidright", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "SidHardSIDRight", NULL,
       "<device>", "Set the HardSID device for the right SID output" },
+    { "-hardsidlatency", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SidHardSIDLatency", NULL,
+      "<0-100>", "Queue the HardSID writes for up to <0-100> milliseconds and write them in batches (0: write each access at once)" },
     CMDLINE_LIST_END
 };
 #endif
@@ -413,6 +441,12 @@ int sid_cmdline_options_init(int sid_type)
     }
 #endif
 
+#ifndef SOUND_SYSTEM_FLOAT
+    if (sid_queue_cmdline_options_init() < 0) {
+        return -1;
+    }
+#endif
+
 #ifdef HAVE_HARDSID
     if (hardsid_available()) {
         if (cmdline_register_options(hardsid_cmdline_options) < 0) {
@@ -449,11 +483,15 @@ int sid_cmdline_options_init(int sid_type)
             return -1;
         }
     }
+    if (sidrecord_cmdline_options_init() < 0) {
+        return -1;
+    }
     return cmdline_register_options(common_cmdline_options);
 }
 
 void sid_cmdline_options_shutdown(void)
 {
+    sidrecord_shutdown();
     if (sid_return) {
         lib_free(sid_return);
         sid_return = NULL;
@@ -41,6 +41,7 @@
 #include "resources.h"
 #include "sid-resources.h"
 #include "sid.h"
+#include "sidqueue.h"
 #include "sound.h"
 #include "types.h"
 
@@ -62,6 +63,7 @@ static int sid_resid_8580_passband;
 static int sid_resid_8580_gain;
 static int sid_resid_8580_filter_bias;
 static int sid_resid_enable_raw_output;
+static int sid_resid_table_cache;
 #endif
 int sid_stereo = 0;
 int checking_sid_stereo;
@@ -83,6 +85,7 @@ static int sid_engine;
 #ifdef HAVE_HARDSID
 static int sid_hardsid_main;
 static int sid_hardsid_right;
+static int sid_hardsid_latency;
 #endif
 
 static int set_sid_engine(int set_engine, void *param)
@@ -152,6 +155,14 @@ static int set_sid_resid_enable_raw_output(int val, void *param)
 
     return 0;
 }
+
+static int set_sid_resid_table_cache(int val, void *param)
+{
+    /* used when the next SID is created */
+    sid_resid_table_cache = val ? 1 : 0;
+
+    return 0;
+}
 #endif
 
 static int set_sid_stereo(int val, void *param)
@@ -352,6 +363,17 @@ static int set_sid_hardsid_right(int val, void *param)
 
     return 0;
 }
+
+static int set_sid_hardsid_latency(int val, void *param)
+{
+    if (val < 0 || val > 100) {
+        return -1;
+    }
+    sid_hardsid_latency = val;
+    hardsid_set_latency(sid_hardsid_latency);
+
+    return 0;
+}
 #endif
 
 #ifdef HAVE_RESID
@@ -396,6 +418,8 @@ static const resource_int_t resid_resources_int[] = {
       &sid_resid_8580_gain, set_sid_resid_8580_gain, NULL },
     { "SidResid8580FilterBias", RESID_8580_FILTER_BIAS_DEFAULT, RES_EVENT_NO, NULL,
       &sid_resid_8580_filter_bias, set_sid_resid_8580_filter_bias, NULL },
+    { "SidResidTableCache", 1, RES_EVENT_NO, NULL,
+      &sid_resid_table_cache, set_sid_resid_table_cache, NULL },
     RESOURCE_INT_LIST_END
 };
 #endif
@@ -425,6 +449,8 @@ static const resource_int_t hardsid_resources_int[] = {
       &sid_hardsid_main, set_sid_hardsid_main, NULL },
     { "SidHardSIDRight", 1, RES_EVENT_NO, NULL,
       &sid_hardsid_right, set_sid_hardsid_right, NULL },
+    { "SidHardSIDLatency", 0, RES_EVENT_NO, NULL,
+      &sid_hardsid_latency, set_sid_hardsid_latency, NULL },
     RESOURCE_INT_LIST_END
 };
 #endif
@@ -482,6 +508,12 @@ int sid_resources_init(void)
         return -1;
     }
 
+#ifndef SOUND_SYSTEM_FLOAT
+    if (sid_queue_resources_init() < 0) {
+        return -1;
+    }
+#endif
+
     return sid_common_resources_init();
 }
 
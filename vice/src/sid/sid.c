@@ -47,6 +47,8 @@
 #include "sid-resources.h"
 #include "sid-snapshot.h"
 #include "sid.h"
+#include "sidqueue.h"
+#include "sidrecord.h"
 #include "sound.h"
 #include "types.h"
 
@@ -106,7 +108,8 @@ sid_engine_t fakesid_hooks =
     fakesid_calculate_samples,
     fakesid_dump_state,
     fakesid_resid_state_read,
-    fakesid_resid_state_write
+    fakesid_resid_state_write,
+    NULL
 };
 
 struct sound_s {};
@@ -251,10 +254,16 @@ static void sid_store_chip(uint16_t addr, uint8_t byte, int chipno)
 
     if (maincpu_rmw_flag) {
         maincpu_clk--;
+        if (sidrecord_enabled) {
+            sidrecord_store(maincpu_clk, chipno, addr, lastsidread);
+        }
         sid_store_func(addr, lastsidread, chipno);
         maincpu_clk++;
     }
 
+    if (sidrecord_enabled) {
+        sidrecord_store(maincpu_clk, chipno, addr, byte);
+    }
     sid_store_func(addr, byte, chipno);
 }
 
@@ -519,6 +528,10 @@ sound_t *sid_sound_machine_open(int chipno)
         return NULL;
     }
 
+#ifndef SOUND_SYSTEM_FLOAT
+    /* the chips start from the register data, which has all stores */
+    sid_queue_discard();
+#endif
     return sid_engine.open(siddata[chipno]);
 }
 
@@ -578,6 +591,9 @@ int sid_sound_machine_init(sound_t *psid, int speed, int cycles_per_sec)
 
 void sid_sound_machine_close(sound_t *psid)
 {
+#ifndef SOUND_SYSTEM_FLOAT
+    sid_queue_close();
+#endif
     sid_engine.close(psid);
 #ifndef SOUND_SYSTEM_FLOAT
     /* free the temp. buffers */
@@ -631,6 +647,9 @@ void sid_sound_machine_store(sound_t *psid, uint16_t addr, uint8_t byte)
 
 void sid_sound_machine_reset(sound_t *psid, CLOCK cpu_clk)
 {
+#ifndef SOUND_SYSTEM_FLOAT
+    sid_queue_discard();
+#endif
     sid_engine.reset(psid, cpu_clk);
 }
 
@@ -641,7 +660,18 @@ int sid_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int
     return sid_engine.calculate_samples(psid[scc], pbuf, nr, delta_t);
 }
 #else
-int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
+/* set while the chips of a block were already rendered by sid_queue_render() */
+static int sid_prerendered = 0;
+
+static int sid_calculate_chip(sound_t **psid, int chipno, int16_t *pbuf, int nr, int interleave, CLOCK *delta_t)
+{
+    if (sid_prerendered) {
+        return sid_queue_samples(chipno, pbuf, nr, interleave, delta_t);
+    }
+    return sid_engine.calculate_samples(psid[chipno], pbuf, nr, interleave, delta_t);
+}
+
+static int sid_sound_machine_mix_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
     int i;
     int16_t *tmp_buf1;
@@ -655,12 +685,12 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     CLOCK tmp_delta_t = *delta_t;
 
     if (soc == SOUND_OUTPUT_MONO && scc == SOUND_1_DEVICE) {
-        return sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        return sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
     }
     if (soc == SOUND_OUTPUT_MONO && scc == SOUND_2_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
         }
@@ -669,10 +699,10 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     if (soc == SOUND_OUTPUT_MONO && scc == SOUND_3_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -683,12 +713,12 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -701,14 +731,14 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
         tmp_buf4 = getbuf4(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -723,16 +753,16 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf3 = getbuf3(2 * nr);
         tmp_buf4 = getbuf4(2 * nr);
         tmp_buf5 = getbuf5(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 5, tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -749,18 +779,18 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf4 = getbuf4(2 * nr);
         tmp_buf5 = getbuf5(2 * nr);
         tmp_buf6 = getbuf6(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 5, tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf6, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 6, tmp_buf6, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -779,20 +809,20 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf5 = getbuf5(2 * nr);
         tmp_buf6 = getbuf6(2 * nr);
         tmp_buf7 = getbuf7(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[0], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf4, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 5, tmp_buf5, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf6, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 6, tmp_buf6, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[7], tmp_buf7, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 7, tmp_buf7, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf, nr, SOUND_OUTPUT_MONO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf1[i]);
             pbuf[i] = sound_audio_mix(pbuf[i], tmp_buf2[i]);
@@ -805,23 +835,23 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         return tmp_nr;
     }
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_1_DEVICE) {
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[(i * 2) + 1] = pbuf[i * 2];
         }
         return tmp_nr;
     }
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_2_DEVICES) {
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
         return tmp_nr;
     }
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_3_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf1, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i]);
             pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[i]);
@@ -829,12 +859,12 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     }
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_4_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[(i * 2) + 1] = sound_audio_mix(pbuf[(i * 2) + 1], tmp_buf1[(i * 2) + 1]);
@@ -843,14 +873,14 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_5_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf2, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i]);
@@ -861,16 +891,16 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     if (soc == SOUND_OUTPUT_STEREO && scc == SOUND_6_DEVICES) {
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 5, tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
@@ -882,18 +912,18 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 5, tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 6, tmp_buf3, nr, SOUND_OUTPUT_MONO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
@@ -907,20 +937,20 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
         tmp_buf1 = getbuf1(2 * nr);
         tmp_buf2 = getbuf2(2 * nr);
         tmp_buf3 = getbuf3(2 * nr);
-        tmp_nr = sid_engine.calculate_samples(psid[2], tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 2, tmp_buf1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[3], tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 3, tmp_buf1 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[4], tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 4, tmp_buf2, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[5], tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 5, tmp_buf2 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[6], tmp_buf3, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 6, tmp_buf3, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[7], tmp_buf3 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 7, tmp_buf3 + 1, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
         tmp_delta_t = *delta_t;
-        tmp_nr = sid_engine.calculate_samples(psid[0], pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
-        tmp_nr = sid_engine.calculate_samples(psid[1], pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
+        tmp_nr = sid_calculate_chip(psid, 0, pbuf, nr, SOUND_OUTPUT_STEREO, &tmp_delta_t);
+        tmp_nr = sid_calculate_chip(psid, 1, pbuf + 1, nr, SOUND_OUTPUT_STEREO, delta_t);
         for (i = 0; i < tmp_nr; i++) {
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf1[i * 2]);
             pbuf[i * 2] = sound_audio_mix(pbuf[i * 2], tmp_buf2[i * 2]);
@@ -932,8 +962,42 @@ int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, i
     }
     return tmp_nr;
 }
+
+int sid_sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
+{
+    int ret;
+
+    if (sid_queue_render(&sid_engine, psid, scc, nr, *delta_t) == 0) {
+        sid_prerendered = 1;
+        ret = sid_sound_machine_mix_samples(psid, pbuf, nr, soc, scc, delta_t);
+        sid_prerendered = 0;
+        return ret;
+    }
+    return sid_sound_machine_mix_samples(psid, pbuf, nr, soc, scc, delta_t);
+}
 #endif
 
+/* Advance the first `scc' chips by `delta_t' cycles without rendering
+   samples.  Returns -1 if they must be rendered instead, because the engine
+   cannot skip or stores are still queued for rendering.  */
+int sid_sound_machine_skip(sound_t **psid, int scc, CLOCK delta_t)
+{
+    int c;
+
+    if (sid_engine.skip == NULL) {
+        return -1;
+    }
+#ifndef SOUND_SYSTEM_FLOAT
+    if (sid_queue_pending()) {
+        return -1;
+    }
+#endif
+    for (c = 0; c < scc; c++) {
+        sid_engine.skip(psid[c], delta_t);
+    }
+    return 0;
+}
+
 char *sid_sound_machine_dump_state(sound_t *psid)
 {
     return sid_engine.dump_state(psid);
@@ -976,6 +1040,15 @@ int sid_sound_machine_channels(void)
     return channels + 1;
 }
 
+#ifndef SOUND_SYSTEM_FLOAT
+static void sid_store_queued(uint16_t addr, uint8_t val, int chipno)
+{
+    if (sid_queue_store(addr, val, chipno) < 0) {
+        sound_store(addr, val, chipno);
+    }
+}
+#endif
+
 static void set_sound_func(void)
 {
     if (sid_enable) {
@@ -987,7 +1060,11 @@ static void set_sound_func(void)
 #ifdef HAVE_RESID
         if (sid_engine_type == SID_ENGINE_RESID) {
             sid_read_func = sound_read;
+#ifndef SOUND_SYSTEM_FLOAT
+            sid_store_func = sid_store_queued;
+#else
             sid_store_func = sound_store;
+#endif
             sid_dump_func = sound_dump;
         }
 #endif
@@ -1092,6 +1169,9 @@ void sid_state_write(unsigned int channel, sid_snapshot_state_t *sid_state)
             fprintf(stderr, "%s:%d:%s(): sound_get_psid() returned NULL\n",
                     __FILE__, __LINE__, __func__);
         } else {
+#ifndef SOUND_SYSTEM_FLOAT
+            sid_queue_discard();
+#endif
             sid_engine.state_write(psid, sid_state);
         }
     }
@@ -216,6 +216,8 @@ struct sid_engine_s {
     char *(*dump_state)(struct sound_s *psid);
     void (*state_read)(struct sound_s *psid, struct sid_snapshot_state_s *sid_state);
     void (*state_write)(struct sound_s *psid, struct sid_snapshot_state_s *sid_state);
+    /* advance the chip without rendering samples, NULL if not supported */
+    void (*skip)(struct sound_s *psid, CLOCK delta_t);
 };
 typedef struct sid_engine_s sid_engine_t;
 
@@ -236,6 +238,7 @@ void sid_sound_machine_reset(sound_t *psid, CLOCK cpu_clk);
 char *sid_sound_machine_dump_state(sound_t *psid);
 int sid_sound_machine_cycle_based(void);
 int sid_sound_machine_channels(void);
+int sid_sound_machine_skip(sound_t **psid, int sound_chip_channels, CLOCK delta_t);
 void sid_sound_machine_enable(int enable);
 sid_engine_model_t **sid_get_engine_model_list(void);
 int sid_set_engine_model(int engine, int model);
@@ -0,0 +1,328 @@
+/*
+ * sidqueue.c - Queue SID stores and render them once per block.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Normally every store to a SID first brings the chips up to the current
+   clock with sound_run_sound(), so tunes playing samples through the
+   volume register render the sound in thousands of tiny blocks per frame.
+   With `SidWriteQueue' set (or `SidThreads', which needs the queue) and a
+   cycle based engine, stores are instead queued per chip with their clock,
+   and the chips are only rendered when the sound code runs anyway: once
+   per sound_flush(), and before a SID register is read.  Each chip is then
+   rendered in one go into a private buffer, writing its queued stores at
+   exactly the cycle they happened, and the mixing in
+   sid_sound_machine_calculate_samples() stays the same.
+
+   The sound is exactly the same as without the queue, since the engines
+   do not depend on how a stretch of cycles is split into calls.  */
+
+#include "vice.h"
+
+#include <stdlib.h>
+
+#include "cmdline.h"
+#include "lib.h"
+#include "maincpu.h"
+#include "resources.h"
+#include "sid.h"
+#include "sidqueue.h"
+#include "sidthread.h"
+#include "sound.h"
+#include "types.h"
+
+#ifndef SOUND_SYSTEM_FLOAT
+
+typedef struct sid_store_s {
+    CLOCK clk;
+    uint8_t addr;
+    uint8_t val;
+} sid_store_t;
+
+typedef struct sid_store_list_s {
+    sid_store_t *stores;
+    int num_stores;
+    int max_stores;
+} sid_store_list_t;
+
+typedef struct sid_chip_queue_s {
+    /* stores queued since the last render, in clock order */
+    sid_store_list_t lists[2];
+
+    /* the samples of the last render */
+    int16_t *buf;
+    int size;
+    int count;
+    CLOCK delta_left;
+} sid_chip_queue_t;
+
+static sid_chip_queue_t chips[SOUND_SIDS_MAX];
+
+/* Stores are queued to one list and rendered from the other while a
+   block is rendered on the sound thread, otherwise both are the same.  */
+static int store_list = 0;
+static int render_list = 0;
+
+/* the clock the block of the sound thread ends at */
+static CLOCK handoff_clk;
+
+/* number of queued stores of all chips, for each list */
+static int queued[2] = { 0, 0 };
+
+/* the block being rendered */
+static const sid_engine_t *render_engine;
+static sound_t **render_psid;
+static int render_nr;
+static CLOCK render_start_clk;
+static CLOCK render_end_clk;
+
+static int sid_write_queue = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static int sid_queue_enabled(void)
+{
+#ifdef USE_SID_THREADS
+    if (sid_thread_count() > 0) {
+        return 1;
+    }
+#endif
+#ifdef USE_SOUND_THREAD
+    if (sound_thread_enabled()) {
+        return 1;
+    }
+#endif
+    return sid_write_queue;
+}
+
+static void sid_chip_run(sid_chip_queue_t *chip, sound_t *psid, CLOCK delta_t)
+{
+    if (delta_t > 0 && chip->count < render_nr) {
+        chip->count += render_engine->calculate_samples(psid, chip->buf + chip->count,
+                                                        render_nr - chip->count,
+                                                        SOUND_OUTPUT_MONO, &delta_t);
+    }
+    /* what is left did not fit into the sound buffer */
+    chip->delta_left += delta_t;
+}
+
+static void sid_chip_render(int chipno)
+{
+    sid_chip_queue_t *chip = &chips[chipno];
+    sid_store_list_t *list = &chip->lists[render_list];
+    sound_t *psid = render_psid[chipno];
+    CLOCK clk = render_start_clk;
+    int i;
+
+    chip->count = 0;
+    chip->delta_left = 0;
+
+    for (i = 0; i < list->num_stores; i++) {
+        /* stores from before the block were already rendered over */
+        if (list->stores[i].clk > clk) {
+            sid_chip_run(chip, psid, list->stores[i].clk - clk);
+            clk = list->stores[i].clk;
+        }
+        render_engine->store(psid, list->stores[i].addr, list->stores[i].val);
+    }
+    sid_chip_run(chip, psid, render_end_clk - clk);
+
+    list->num_stores = 0;
+}
+
+static void sid_queue_clear(int l)
+{
+    int c;
+
+    for (c = 0; c < SOUND_SIDS_MAX; c++) {
+        chips[c].lists[l].num_stores = 0;
+    }
+    queued[l] = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int sid_queue_store(uint16_t addr, uint8_t val, int chipno)
+{
+    sid_store_list_t *list = &chips[chipno].lists[store_list];
+
+    if (!sid_queue_enabled() || !sound_can_buffer_store(chipno)) {
+        return -1;
+    }
+
+    if (list->num_stores == list->max_stores) {
+        list->max_stores = list->max_stores ? list->max_stores * 2 : 256;
+        list->stores = lib_realloc(list->stores, list->max_stores * sizeof(sid_store_t));
+    }
+    list->stores[list->num_stores].clk = maincpu_clk;
+    list->stores[list->num_stores].addr = (uint8_t)addr;
+    list->stores[list->num_stores].val = val;
+    list->num_stores++;
+    queued[store_list]++;
+
+    return 0;
+}
+
+int sid_queue_pending(void)
+{
+    return queued[0] > 0 || queued[1] > 0;
+}
+
+void sid_queue_discard(void)
+{
+    sid_queue_clear(0);
+    sid_queue_clear(1);
+}
+
+void sid_queue_handoff_begin(void)
+{
+    render_list = store_list;
+    store_list ^= 1;
+    handoff_clk = maincpu_clk;
+}
+
+void sid_queue_handoff_end(void)
+{
+    render_list = store_list;
+}
+
+int sid_queue_render(const sid_engine_t *engine, sound_t **psid, int scc, int nr, CLOCK delta_t)
+{
+    int c;
+
+    /* render queued stores even if the queue was just switched off */
+    if (queued[render_list] == 0 && !sid_queue_enabled()) {
+        return -1;
+    }
+
+    render_engine = engine;
+    render_psid = psid;
+    render_nr = nr;
+    render_end_clk = (render_list != store_list) ? handoff_clk : maincpu_clk;
+    render_start_clk = render_end_clk - delta_t;
+
+    for (c = 0; c < scc; c++) {
+        if (chips[c].size < nr) {
+            lib_free(chips[c].buf);
+            chips[c].buf = lib_malloc(nr * sizeof(int16_t));
+            chips[c].size = nr;
+        }
+    }
+
+#ifdef USE_SID_THREADS
+    sid_thread_run(scc, sid_chip_render);
+#else
+    for (c = 0; c < scc; c++) {
+        sid_chip_render(c);
+    }
+#endif
+
+    /* stores to chips beyond `scc' are never rendered */
+    sid_queue_clear(render_list);
+
+    return 0;
+}
+
+int sid_queue_samples(int chipno, int16_t *pbuf, int nr, int interleave, CLOCK *delta_t)
+{
+    const sid_chip_queue_t *chip = &chips[chipno];
+    int i;
+
+    if (nr > chip->count) {
+        nr = chip->count;
+    }
+    for (i = 0; i < nr; i++) {
+        pbuf[i * interleave] = chip->buf[i];
+    }
+    *delta_t = chip->delta_left;
+
+    return nr;
+}
+
+void sid_queue_close(void)
+{
+    int c, l;
+
+#ifdef USE_SID_THREADS
+    sid_thread_stop();
+#endif
+    sid_queue_discard();
+
+    for (c = 0; c < SOUND_SIDS_MAX; c++) {
+        for (l = 0; l < 2; l++) {
+            lib_free(chips[c].lists[l].stores);
+            chips[c].lists[l].stores = NULL;
+            chips[c].lists[l].max_stores = 0;
+        }
+        lib_free(chips[c].buf);
+        chips[c].buf = NULL;
+        chips[c].size = 0;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_sid_write_queue(int val, void *param)
+{
+    /* stores already queued are still written by the next render */
+    sid_write_queue = val ? 1 : 0;
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "SidWriteQueue", 0, RES_EVENT_NO, NULL,
+      &sid_write_queue, set_sid_write_queue, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int sid_queue_resources_init(void)
+{
+#ifdef USE_SID_THREADS
+    if (sid_thread_resources_init() < 0) {
+        return -1;
+    }
+#endif
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-sidwritequeue", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidWriteQueue", (void *)1,
+      NULL, "Queue SID stores and render each chip once per sound block" },
+    { "+sidwritequeue", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SidWriteQueue", (void *)0,
+      NULL, "Render the SIDs up to every store" },
+    CMDLINE_LIST_END
+};
+
+int sid_queue_cmdline_options_init(void)
+{
+#ifdef USE_SID_THREADS
+    if (sid_thread_cmdline_options_init() < 0) {
+        return -1;
+    }
+#endif
+    return cmdline_register_options(cmdline_options);
+}
+
+#endif
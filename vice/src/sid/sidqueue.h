@@ -0,0 +1,73 @@
+/*
+ * sidqueue.h - Queue SID stores and render them once per block.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SIDQUEUE_H
+#define VICE_SIDQUEUE_H
+
+#include "sound.h"
+#include "types.h"
+
+#ifndef SOUND_SYSTEM_FLOAT
+
+struct sid_engine_s;
+struct sound_s;
+
+int sid_queue_resources_init(void);
+int sid_queue_cmdline_options_init(void);
+
+/* Drop the queued stores and free the render buffers, when the sound
+   device is closed.  */
+void sid_queue_close(void);
+
+/* Queue a store to SID `chipno' at the current clock, to be written while
+   the chip is rendered.  Returns -1 if the store must go to sound_store()
+   right away.  */
+int sid_queue_store(uint16_t addr, uint8_t val, int chipno);
+
+/* Whether stores are queued that were not rendered yet.  */
+int sid_queue_pending(void);
+
+/* Drop the queued stores, after the chips were reset or restored.  */
+void sid_queue_discard(void);
+
+/* While the sound thread renders the stores queued so far, queue new ones
+   separately; sid_queue_handoff_end() is called when it is done.  */
+void sid_queue_handoff_begin(void);
+void sid_queue_handoff_end(void);
+
+/* Render the last `delta_t' cycles of the first `scc' chips, each into its
+   own buffer of at most `nr' samples, writing the queued stores at their
+   clock.  Returns -1 if the chips should be rendered by the caller
+   instead.  */
+int sid_queue_render(const struct sid_engine_s *engine, struct sound_s **psid,
+                     int scc, int nr, CLOCK delta_t);
+
+/* Copy up to `nr' samples rendered for `chipno' to every `interleave'th
+   element of `pbuf'.  Like the engine calculate_samples() function,
+   returns the number of samples and leaves the cycles that did not fit in
+   `delta_t'.  */
+int sid_queue_samples(int chipno, int16_t *pbuf, int nr, int interleave, CLOCK *delta_t);
+
+#endif
+
+#endif
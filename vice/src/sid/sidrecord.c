@@ -0,0 +1,151 @@
+/*
+ * sidrecord.c - Record the SID register writes to a file.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With -sidrecord <file> every write that reaches a SID engine is appended
+   to <file>, with the cycle it happened at, in the format described in
+   sidrecord.h.  The file is opened on the first write, when the machine
+   and its clock rate are known.  Unlike the `dump' sound device this does
+   not depend on the sound output being enabled, so vsid -sounddev dummy
+   -warp records a tune in much less than its playing time.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "machine.h"
+#include "resources.h"
+#include "sidrecord.h"
+#include "types.h"
+#include "util.h"
+
+int sidrecord_enabled = 0;
+
+static char *record_filename = NULL;
+static FILE *record_fp = NULL;
+static CLOCK record_last_clk;
+
+/* ------------------------------------------------------------------------- */
+
+static void sidrecord_put_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static int sidrecord_open(CLOCK clk)
+{
+    uint8_t header[SIDRECORD_HEADER_SIZE];
+    int model = 0;
+
+    record_fp = fopen(record_filename, MODE_WRITE);
+    if (record_fp == NULL) {
+        log_error(LOG_DEFAULT, "Cannot write SID recording `%s'.", record_filename);
+        return -1;
+    }
+
+    resources_get_int("SidModel", &model);
+
+    memcpy(header, SIDRECORD_MAGIC, SIDRECORD_MAGIC_LEN);
+    header[8] = SIDRECORD_VERSION;
+    header[9] = (uint8_t)model;
+    header[10] = 0;
+    header[11] = 0;
+    sidrecord_put_le32(header + 12, (uint32_t)machine_get_cycles_per_second());
+
+    if (fwrite(header, 1, sizeof(header), record_fp) != sizeof(header)) {
+        log_error(LOG_DEFAULT, "Cannot write SID recording `%s'.", record_filename);
+        fclose(record_fp);
+        record_fp = NULL;
+        return -1;
+    }
+
+    record_last_clk = clk;
+    log_message(LOG_DEFAULT, "Recording SID writes to `%s'.", record_filename);
+    return 0;
+}
+
+void sidrecord_store(CLOCK clk, int chipno, uint16_t addr, uint8_t byte)
+{
+    uint8_t buf[16];
+    CLOCK delta;
+    int len = 0;
+
+    if (record_fp == NULL && sidrecord_open(clk) < 0) {
+        sidrecord_enabled = 0;
+        return;
+    }
+
+    /* the clock only goes back when a snapshot is loaded */
+    delta = clk > record_last_clk ? clk - record_last_clk : 0;
+    record_last_clk = clk;
+
+    while (delta >= 0x80) {
+        buf[len++] = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+    buf[len++] = (uint8_t)delta;
+    buf[len++] = (uint8_t)((chipno << 5) | (addr & 0x1f));
+    buf[len++] = byte;
+
+    fwrite(buf, 1, len, record_fp);
+}
+
+void sidrecord_shutdown(void)
+{
+    if (record_fp != NULL) {
+        fclose(record_fp);
+        record_fp = NULL;
+    }
+    sidrecord_enabled = 0;
+    lib_free(record_filename);
+    record_filename = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_sidrecord(const char *param, void *extra_param)
+{
+    util_string_set(&record_filename, param);
+    sidrecord_enabled = 1;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-sidrecord", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_sidrecord, NULL, NULL, NULL,
+      "<filename>", "Record the SID register writes with their cycles to <filename>, for tools/sidreplay" },
+    CMDLINE_LIST_END
+};
+
+int sidrecord_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
@@ -0,0 +1,60 @@
+/*
+ * sidrecord.h - Record the SID register writes to a file.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SIDRECORD_H
+#define VICE_SIDRECORD_H
+
+#include "types.h"
+
+/* The file starts with a 16 byte header:
+
+       0   "VICESIDR"
+       8   version (1)
+       9   SidModel of the first SID
+      10   0, 0
+      12   cycles per second, 32 bit little endian
+
+   followed by one record per write:
+
+           cycles since the previous write, 7 bits per byte starting with
+           the lowest, bit 7 set on all but the last byte
+           chip number << 5 | register
+           value
+
+   so a write costs three bytes unless the writes are more than 127
+   cycles apart.  tools/sidreplay reads it.  */
+
+#define SIDRECORD_MAGIC         "VICESIDR"
+#define SIDRECORD_MAGIC_LEN     8
+#define SIDRECORD_VERSION       1
+#define SIDRECORD_HEADER_SIZE   16
+
+/* Set while a recording is running, checked by sid_store_chip() before
+   calling sidrecord_store().  */
+extern int sidrecord_enabled;
+
+int sidrecord_cmdline_options_init(void);
+void sidrecord_store(CLOCK clk, int chipno, uint16_t addr, uint8_t byte);
+void sidrecord_shutdown(void);
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * sidthread.c - Render multiple SIDs on worker threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* With two or more SIDs and the stores queued by sidqueue.c, every chip
+   renders a block on its own, so the chips can run in parallel: the first
+   on the emulation thread, the others on the workers started here.  */
+
+#include "vice.h"
+
+#ifdef USE_SID_THREADS
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "cmdline.h"
+#include "log.h"
+#include "resources.h"
+#include "sid.h"
+#include "sidthread.h"
+#include "types.h"
+
+/* the block being rendered */
+static void (*work_func)(int);
+static int work_num;
+
+static pthread_t workers[SOUND_SIDS_MAX - 1];
+static int num_workers = 0;
+static int workers_quit = 0;
+
+/* Bumped for every block, the workers then take chips until none is
+   left.  */
+static unsigned int work_generation = 0;
+static int next_chip;
+static int chips_left;
+
+/* Protects the work fields above.  */
+static pthread_mutex_t work_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t work_done = PTHREAD_COND_INITIALIZER;
+
+static int sid_threads = 0;
+
+static log_t sid_thread_log = LOG_DEFAULT;
+
+/* ------------------------------------------------------------------------- */
+
+/* Render chips until none is left, called with `work_mutex' held.  */
+static void sid_chips_render_locked(void)
+{
+    while (next_chip < work_num) {
+        int chipno = next_chip++;
+
+        pthread_mutex_unlock(&work_mutex);
+        work_func(chipno);
+        pthread_mutex_lock(&work_mutex);
+
+        if (--chips_left == 0) {
+            pthread_cond_signal(&work_done);
+        }
+    }
+}
+
+static void *sid_worker_main(void *arg)
+{
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&work_mutex);
+    for (;;) {
+        while (work_generation == seen && !workers_quit) {
+            pthread_cond_wait(&work_start, &work_mutex);
+        }
+        if (workers_quit) {
+            break;
+        }
+        seen = work_generation;
+        sid_chips_render_locked();
+    }
+    pthread_mutex_unlock(&work_mutex);
+
+    return NULL;
+}
+
+static void sid_workers_stop(void)
+{
+    int i;
+
+    if (num_workers == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&work_mutex);
+    workers_quit = 1;
+    pthread_cond_broadcast(&work_start);
+    pthread_mutex_unlock(&work_mutex);
+
+    for (i = 0; i < num_workers; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    num_workers = 0;
+}
+
+static void sid_workers_start(void)
+{
+    workers_quit = 0;
+
+    while (num_workers < sid_threads) {
+        if (pthread_create(&workers[num_workers], NULL, sid_worker_main, NULL) != 0) {
+            log_error(sid_thread_log, "Cannot create SID thread.");
+            break;
+        }
+        num_workers++;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+int sid_thread_count(void)
+{
+    return sid_threads;
+}
+
+void sid_thread_run(int num, void (*func)(int))
+{
+    int c;
+
+    if (sid_threads == 0 || num < 2) {
+        for (c = 0; c < num; c++) {
+            func(c);
+        }
+        return;
+    }
+
+    if (num_workers == 0) {
+        sid_workers_start();
+    }
+
+    pthread_mutex_lock(&work_mutex);
+    work_func = func;
+    work_num = num;
+    next_chip = 0;
+    chips_left = num;
+    if (num_workers > 0) {
+        work_generation++;
+        pthread_cond_broadcast(&work_start);
+    }
+    sid_chips_render_locked();
+    while (chips_left > 0) {
+        pthread_cond_wait(&work_done, &work_mutex);
+    }
+    pthread_mutex_unlock(&work_mutex);
+}
+
+void sid_thread_stop(void)
+{
+    sid_workers_stop();
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int set_sid_threads(int val, void *param)
+{
+    if (val < 0 || val > SOUND_SIDS_MAX - 1) {
+        return -1;
+    }
+
+    if (val != sid_threads) {
+        sid_workers_stop();
+        sid_threads = val;
+    }
+
+    return 0;
+}
+
+static const resource_int_t resources_int[] = {
+    { "SidThreads", 0, RES_EVENT_NO, NULL,
+      &sid_threads, set_sid_threads, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+int sid_thread_resources_init(void)
+{
+    return resources_register_int(resources_int);
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-sidthreads", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SidThreads", NULL,
+      "<number>", "Render multiple SIDs on this many worker threads (0: render them one after another)" },
+    CMDLINE_LIST_END
+};
+
+int sid_thread_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * sidthread.h - Render multiple SIDs on worker threads.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_SIDTHREAD_H
+#define VICE_SIDTHREAD_H
+
+#include "types.h"
+
+#ifdef USE_SID_THREADS
+
+int sid_thread_resources_init(void);
+int sid_thread_cmdline_options_init(void);
+
+/* The number of worker threads set with `SidThreads'.  */
+int sid_thread_count(void);
+
+/* Call `func' for each chip number below `num', on the calling thread and
+   the workers, and return when all calls are done.  The workers are
+   started by the first call.  */
+void sid_thread_run(int num, void (*func)(int));
+
+/* Stop the workers, when the sound device is closed.  */
+void sid_thread_stop(void);
+
+#endif
+
+#endif
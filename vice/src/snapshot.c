@@ -33,6 +33,14 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef USE_IMAGE_WRITEBACK
+#include <pthread.h>
+#endif
+
 #include "archdep.h"
 #include "lib.h"
 #include "log.h"
@@ -68,8 +76,8 @@ static const char snapshot_version_magic_string[] = "VICE Version\032";
 #define SNAPSHOT_VERSION_MAGIC_LEN      13
 
 struct snapshot_module_s {
-    /* File descriptor.  */
-    FILE *file;
+    /* Snapshot this module belongs to.  */
+    snapshot_t *snapshot;
 
     /* Flag: are we writing it?  */
     int write_mode;
@@ -84,23 +92,133 @@ struct snapshot_module_s {
     long size_offset;
 };
 
+/* Size of a module header: name, major and minor version, size.  */
+#define SNAPSHOT_MODULE_HEADER_LEN  (SNAPSHOT_MODULE_NAME_LEN + 2 + 4)
+
+/* A module found in a snapshot that is read.  */
+typedef struct snapshot_module_entry_s {
+    /* Name, padded with zeroes after the first one.  */
+    char name[SNAPSHOT_MODULE_NAME_LEN];
+
+    uint8_t major_version;
+    uint8_t minor_version;
+
+    /* Size of the module, including the header.  */
+    uint32_t size;
+
+    /* Offset of the module in the file.  */
+    long offset;
+} snapshot_module_entry_t;
+
 struct snapshot_s {
-    /* File descriptor.  */
+    /* File descriptor, NULL if the snapshot lives in memory.  */
     FILE *file;
 
+    /* Memory buffer, only used if `file' is NULL.  */
+    uint8_t *data;
+
+    /* Number of valid bytes in the memory buffer.  */
+    size_t data_size;
+
+    /* Allocated size of the memory buffer.  */
+    size_t data_alloc;
+
+    /* Flag: is the memory buffer ours to free?  */
+    int owns_data;
+
+    /* Current read/write position.  */
+    size_t pos;
+
     /* Offset of the first module.  */
     long first_module_offset;
 
+    /* Modules of a snapshot that is read, in file order, and a hash table
+       of their indices + 1 (0 is an empty slot) by name.  */
+    snapshot_module_entry_t *modules;
+    int num_modules;
+    int *module_hash;
+    unsigned int module_hash_mask;
+
     /* Flag: are we writing it?  */
     int write_mode;
 };
 
+/* Initial size of the buffer of a memory snapshot.  Grows as needed.  */
+#define SNAPSHOT_MEM_INITIAL_SIZE   0x10000
+
 /* ------------------------------------------------------------------------- */
 
-static int snapshot_write_byte(FILE *f, uint8_t data)
+/* Low level I/O: these are the only functions that know about the backing
+   store of a snapshot (stdio file or memory buffer).  */
+
+static int snapshot_io_write(snapshot_t *s, const uint8_t *data, size_t num)
+{
+    if (s->file != NULL) {
+        if (fwrite(data, num, 1, s->file) < 1) {
+            return -1;
+        }
+    } else {
+        if (s->pos + num > s->data_alloc) {
+            size_t new_alloc = s->data_alloc ? s->data_alloc : SNAPSHOT_MEM_INITIAL_SIZE;
+
+            while (s->pos + num > new_alloc) {
+                new_alloc *= 2;
+            }
+            s->data = lib_realloc(s->data, new_alloc);
+            s->data_alloc = new_alloc;
+        }
+        memcpy(s->data + s->pos, data, num);
+        if (s->pos + num > s->data_size) {
+            s->data_size = s->pos + num;
+        }
+    }
+    s->pos += num;
+    return 0;
+}
+
+static int snapshot_io_read(snapshot_t *s, uint8_t *data, size_t num)
 {
-    current_fpos = ftell(f);
-    if (fputc(data, f) == EOF) {
+    if (s->file != NULL) {
+        if (fread(data, num, 1, s->file) < 1) {
+            return -1;
+        }
+    } else {
+        if (s->pos + num > s->data_size) {
+            return -1;
+        }
+        memcpy(data, s->data + s->pos, num);
+    }
+    s->pos += num;
+    return 0;
+}
+
+static int snapshot_io_seek(snapshot_t *s, long offset)
+{
+    if (offset < 0) {
+        return -1;
+    }
+    if (s->file != NULL) {
+        if (fseek(s->file, offset, SEEK_SET) < 0) {
+            return -1;
+        }
+    } else if ((size_t)offset > s->data_size) {
+        return -1;
+    }
+    s->pos = (size_t)offset;
+    return 0;
+}
+
+static long snapshot_io_tell(snapshot_t *s)
+{
+    return (long)s->pos;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int snapshot_write_byte(snapshot_t *s, uint8_t data)
+{
+    current_fpos = s->pos;
+    if (snapshot_io_write(s, &data, 1) < 0) {
         snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
@@ -108,66 +226,72 @@ static int snapshot_write_byte(FILE *f, uint8_t data)
     return 0;
 }
 
-static int snapshot_write_word(FILE *f, uint16_t data)
+static int snapshot_write_word(snapshot_t *s, uint16_t data)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_byte(f, (uint8_t)(data & 0xff)) < 0
-        || snapshot_write_byte(f, (uint8_t)(data >> 8)) < 0) {
+    uint8_t buf[2];
+
+    current_fpos = s->pos;
+    buf[0] = (uint8_t)(data & 0xff);
+    buf[1] = (uint8_t)(data >> 8);
+    if (snapshot_io_write(s, buf, sizeof buf) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
 
     return 0;
 }
 
-static int snapshot_write_dword(FILE *f, uint32_t data)
+static int snapshot_write_dword(snapshot_t *s, uint32_t data)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_word(f, (uint16_t)(data & 0xffff)) < 0
-        || snapshot_write_word(f, (uint16_t)(data >> 16)) < 0) {
+    uint8_t buf[4];
+
+    current_fpos = s->pos;
+    buf[0] = (uint8_t)(data & 0xff);
+    buf[1] = (uint8_t)((data >> 8) & 0xff);
+    buf[2] = (uint8_t)((data >> 16) & 0xff);
+    buf[3] = (uint8_t)(data >> 24);
+    if (snapshot_io_write(s, buf, sizeof buf) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
         return -1;
     }
 
     return 0;
 }
 
-static int snapshot_write_qword(FILE *f, uint64_t data)
+static int snapshot_write_qword(snapshot_t *s, uint64_t data)
 {
-    current_fpos = ftell(f);
-    if (snapshot_write_dword(f, (uint32_t)(data & 0xffffffff)) < 0
-        || snapshot_write_dword(f, (uint32_t)(data >> 32)) < 0) {
+    current_fpos = s->pos;
+    if (snapshot_write_dword(s, (uint32_t)(data & 0xffffffff)) < 0
+        || snapshot_write_dword(s, (uint32_t)(data >> 32)) < 0) {
         return -1;
     }
 
     return 0;
 }
 
-static int snapshot_write_double(FILE *f, double data)
+static int snapshot_write_double(snapshot_t *s, double data)
 {
-    uint8_t *byte_data = (uint8_t *)&data;
-    int i;
-
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        if (snapshot_write_byte(f, byte_data[i]) < 0) {
-            return -1;
-        }
+    current_fpos = s->pos;
+    if (snapshot_io_write(s, (const uint8_t *)&data, sizeof(double)) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        return -1;
     }
     return 0;
 }
 
-static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char,
+static int snapshot_write_padded_string(snapshot_t *s, const char *str, uint8_t pad_char,
                                         int len)
 {
     int i, found_zero;
     uint8_t c;
 
-    current_fpos = ftell(f);
+    current_fpos = s->pos;
     for (i = found_zero = 0; i < len; i++) {
-        if (!found_zero && s[i] == 0) {
+        if (!found_zero && str[i] == 0) {
             found_zero = 1;
         }
-        c = found_zero ? (uint8_t)pad_char : (uint8_t) s[i];
-        if (snapshot_write_byte(f, c) < 0) {
+        c = found_zero ? (uint8_t)pad_char : (uint8_t) str[i];
+        if (snapshot_write_byte(s, c) < 0) {
             return -1;
         }
     }
@@ -175,10 +299,10 @@ static int snapshot_write_padded_string(FILE *f, const char *s, uint8_t pad_char
     return 0;
 }
 
-static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int num)
+static int snapshot_write_byte_array(snapshot_t *s, const uint8_t *data, unsigned int num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fwrite(data, (size_t)num, 1, f) < 1) {
+    current_fpos = s->pos;
+    if (num > 0 && snapshot_io_write(s, data, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_WRITE_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -186,13 +310,13 @@ static int snapshot_write_byte_array(FILE *f, const uint8_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int num)
+static int snapshot_write_word_array(snapshot_t *s, const uint16_t *data, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = s->pos;
     for (i = 0; i < num; i++) {
-        if (snapshot_write_word(f, data[i]) < 0) {
+        if (snapshot_write_word(s, data[i]) < 0) {
             return -1;
         }
     }
@@ -200,13 +324,13 @@ static int snapshot_write_word_array(FILE *f, const uint16_t *data, unsigned int
     return 0;
 }
 
-static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned int num)
+static int snapshot_write_dword_array(snapshot_t *s, const uint32_t *data, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = s->pos;
     for (i = 0; i < num; i++) {
-        if (snapshot_write_dword(f, data[i]) < 0) {
+        if (snapshot_write_dword(s, data[i]) < 0) {
             return -1;
         }
     }
@@ -215,72 +339,72 @@ static int snapshot_write_dword_array(FILE *f, const uint32_t *data, unsigned in
 }
 
 
-static int snapshot_write_string(FILE *f, const char *s)
+static int snapshot_write_string(snapshot_t *s, const char *str)
 {
-    size_t len, i;
+    size_t len;
 
-    len = s ? (strlen(s) + 1) : 0;      /* length includes nullbyte */
+    len = str ? (strlen(str) + 1) : 0;      /* length includes nullbyte */
 
-    current_fpos = ftell(f);
-    if (snapshot_write_word(f, (uint16_t)len) < 0) {
+    current_fpos = s->pos;
+    if (snapshot_write_word(s, (uint16_t)len) < 0) {
         return -1;
     }
 
-    for (i = 0; i < len; i++) {
-        if (snapshot_write_byte(f, s[i]) < 0) {
-            return -1;
-        }
+    if (len > 0 && snapshot_io_write(s, (const uint8_t *)str, len) < 0) {
+        snapshot_error = SNAPSHOT_WRITE_EOF_ERROR;
+        return -1;
     }
 
     return (int)(len + sizeof(uint16_t));
 }
 
-static int snapshot_read_byte(FILE *f, uint8_t *b_return)
+static int snapshot_read_byte(snapshot_t *s, uint8_t *b_return)
 {
-    int c;
-
-    current_fpos = ftell(f);
-    c = fgetc(f);
-    if (c == EOF) {
+    current_fpos = s->pos;
+    if (snapshot_io_read(s, b_return, 1) < 0) {
         snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
-    *b_return = (uint8_t)c;
     return 0;
 }
 
-static int snapshot_read_word(FILE *f, uint16_t *w_return)
+static int snapshot_read_word(snapshot_t *s, uint16_t *w_return)
 {
-    uint8_t lo, hi;
+    uint8_t buf[2];
 
-    current_fpos = ftell(f);
-    if (snapshot_read_byte(f, &lo) < 0 || snapshot_read_byte(f, &hi) < 0) {
+    current_fpos = s->pos;
+    if (snapshot_io_read(s, buf, sizeof buf) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
 
-    *w_return = lo | (hi << 8);
+    *w_return = buf[0] | (buf[1] << 8);
     return 0;
 }
 
-static int snapshot_read_dword(FILE *f, uint32_t *dw_return)
+static int snapshot_read_dword(snapshot_t *s, uint32_t *dw_return)
 {
-    uint16_t lo, hi;
+    uint8_t buf[4];
 
-    current_fpos = ftell(f);
-    if (snapshot_read_word(f, &lo) < 0 || snapshot_read_word(f, &hi) < 0) {
+    current_fpos = s->pos;
+    if (snapshot_io_read(s, buf, sizeof buf) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
         return -1;
     }
 
-    *dw_return = lo | (hi << 16);
+    *dw_return = (uint32_t)buf[0]
+                 | ((uint32_t)buf[1] << 8)
+                 | ((uint32_t)buf[2] << 16)
+                 | ((uint32_t)buf[3] << 24);
     return 0;
 }
 
-static int snapshot_read_qword(FILE *f, uint64_t *qw_return)
+static int snapshot_read_qword(snapshot_t *s, uint64_t *qw_return)
 {
     uint32_t lo, hi;
 
-    current_fpos = ftell(f);
-    if (snapshot_read_dword(f, &lo) < 0 || snapshot_read_dword(f, &hi) < 0) {
+    current_fpos = s->pos;
+    if (snapshot_read_dword(s, &lo) < 0 || snapshot_read_dword(s, &hi) < 0) {
         return -1;
     }
 
@@ -288,30 +412,23 @@ static int snapshot_read_qword(FILE *f, uint64_t *qw_return)
     return 0;
 }
 
-static int snapshot_read_double(FILE *f, double *d_return)
+static int snapshot_read_double(snapshot_t *s, double *d_return)
 {
-    int i;
-    int c;
     double val;
-    uint8_t *byte_val = (uint8_t *)&val;
 
-    current_fpos = ftell(f);
-    for (i = 0; i < sizeof(double); i++) {
-        c = fgetc(f);
-        if (c == EOF) {
-            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
-            return -1;
-        }
-        byte_val[i] = (uint8_t)c;
+    current_fpos = s->pos;
+    if (snapshot_io_read(s, (uint8_t *)&val, sizeof(double)) < 0) {
+        snapshot_error = SNAPSHOT_READ_EOF_ERROR;
+        return -1;
     }
     *d_return = val;
     return 0;
 }
 
-static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num)
+static int snapshot_read_byte_array(snapshot_t *s, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(f);
-    if (num > 0 && fread(b_return, (size_t)num, 1, f) < 1) {
+    current_fpos = s->pos;
+    if (num > 0 && snapshot_io_read(s, b_return, (size_t)num) < 0) {
         snapshot_error = SNAPSHOT_READ_BYTE_ARRAY_ERROR;
         return -1;
     }
@@ -319,13 +436,13 @@ static int snapshot_read_byte_array(FILE *f, uint8_t *b_return, unsigned int num
     return 0;
 }
 
-static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int num)
+static int snapshot_read_word_array(snapshot_t *s, uint16_t *w_return, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = s->pos;
     for (i = 0; i < num; i++) {
-        if (snapshot_read_word(f, w_return + i) < 0) {
+        if (snapshot_read_word(s, w_return + i) < 0) {
             return -1;
         }
     }
@@ -333,13 +450,13 @@ static int snapshot_read_word_array(FILE *f, uint16_t *w_return, unsigned int nu
     return 0;
 }
 
-static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int num)
+static int snapshot_read_dword_array(snapshot_t *s, uint32_t *dw_return, unsigned int num)
 {
     unsigned int i;
 
-    current_fpos = ftell(f);
+    current_fpos = s->pos;
     for (i = 0; i < num; i++) {
-        if (snapshot_read_dword(f, dw_return + i) < 0) {
+        if (snapshot_read_dword(s, dw_return + i) < 0) {
             return -1;
         }
     }
@@ -347,18 +464,18 @@ static int snapshot_read_dword_array(FILE *f, uint32_t *dw_return, unsigned int
     return 0;
 }
 
-static int snapshot_read_string(FILE *f, char **s)
+static int snapshot_read_string(snapshot_t *s, char **str)
 {
-    int i, len;
+    int len;
     uint16_t w;
     char *p = NULL;
 
     /* first free the previous string */
-    lib_free(*s);
-    *s = NULL;      /* don't leave a bogus pointer */
+    lib_free(*str);
+    *str = NULL;      /* don't leave a bogus pointer */
 
-    current_fpos = ftell(f);
-    if (snapshot_read_word(f, &w) < 0) {
+    current_fpos = s->pos;
+    if (snapshot_read_word(s, &w) < 0) {
         return -1;
     }
 
@@ -366,13 +483,12 @@ static int snapshot_read_string(FILE *f, char **s)
 
     if (len) {
         p = lib_malloc(len);
-        *s = p;
+        *str = p;
 
-        for (i = 0; i < len; i++) {
-            if (snapshot_read_byte(f, (uint8_t *)(p + i)) < 0) {
-                p[0] = 0;
-                return -1;
-            }
+        if (snapshot_io_read(s, (uint8_t *)p, (size_t)len) < 0) {
+            snapshot_error = SNAPSHOT_READ_EOF_ERROR;
+            p[0] = 0;
+            return -1;
         }
         p[len - 1] = 0;   /* just to be save */
     }
@@ -383,7 +499,7 @@ static int snapshot_read_string(FILE *f, char **s)
 
 int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 {
-    if (snapshot_write_byte(m->file, b) < 0) {
+    if (snapshot_write_byte(m->snapshot, b) < 0) {
         return -1;
     }
 
@@ -393,7 +509,7 @@ int snapshot_module_write_byte(snapshot_module_t *m, uint8_t b)
 
 int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 {
-    if (snapshot_write_word(m->file, w) < 0) {
+    if (snapshot_write_word(m->snapshot, w) < 0) {
         return -1;
     }
 
@@ -403,7 +519,7 @@ int snapshot_module_write_word(snapshot_module_t *m, uint16_t w)
 
 int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 {
-    if (snapshot_write_dword(m->file, dw) < 0) {
+    if (snapshot_write_dword(m->snapshot, dw) < 0) {
         return -1;
     }
 
@@ -413,7 +529,7 @@ int snapshot_module_write_dword(snapshot_module_t *m, uint32_t dw)
 
 int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 {
-    if (snapshot_write_qword(m->file, qw) < 0) {
+    if (snapshot_write_qword(m->snapshot, qw) < 0) {
         return -1;
     }
 
@@ -423,7 +539,7 @@ int snapshot_module_write_qword(snapshot_module_t *m, uint64_t qw)
 
 int snapshot_module_write_double(snapshot_module_t *m, double db)
 {
-    if (snapshot_write_double(m->file, db) < 0) {
+    if (snapshot_write_double(m->snapshot, db) < 0) {
         return -1;
     }
 
@@ -433,7 +549,7 @@ int snapshot_module_write_double(snapshot_module_t *m, double db)
 
 int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uint8_t pad_char, int len)
 {
-    if (snapshot_write_padded_string(m->file, s, (uint8_t)pad_char, len) < 0) {
+    if (snapshot_write_padded_string(m->snapshot, s, (uint8_t)pad_char, len) < 0) {
         return -1;
     }
 
@@ -443,7 +559,7 @@ int snapshot_module_write_padded_string(snapshot_module_t *m, const char *s, uin
 
 int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, unsigned int num)
 {
-    if (snapshot_write_byte_array(m->file, b, num) < 0) {
+    if (snapshot_write_byte_array(m->snapshot, b, num) < 0) {
         return -1;
     }
 
@@ -453,7 +569,7 @@ int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *b, uns
 
 int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, unsigned int num)
 {
-    if (snapshot_write_word_array(m->file, w, num) < 0) {
+    if (snapshot_write_word_array(m->snapshot, w, num) < 0) {
         return -1;
     }
 
@@ -463,7 +579,7 @@ int snapshot_module_write_word_array(snapshot_module_t *m, const uint16_t *w, un
 
 int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw, unsigned int num)
 {
-    if (snapshot_write_dword_array(m->file, dw, num) < 0) {
+    if (snapshot_write_dword_array(m->snapshot, dw, num) < 0) {
         return -1;
     }
 
@@ -474,7 +590,7 @@ int snapshot_module_write_dword_array(snapshot_module_t *m, const uint32_t *dw,
 int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 {
     int len;
-    len = snapshot_write_string(m->file, s);
+    len = snapshot_write_string(m->snapshot, s);
     if (len < 0) {
         snapshot_error = SNAPSHOT_ILLEGAL_STRING_LENGTH_ERROR;
         return -1;
@@ -488,100 +604,100 @@ int snapshot_module_write_string(snapshot_module_t *m, const char *s)
 
 int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint8_t) > m->offset + m->size) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if (snapshot_io_tell(m->snapshot) + sizeof(uint8_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte(m->file, b_return);
+    return snapshot_read_byte(m->snapshot, b_return);
 }
 
 int snapshot_module_read_word(snapshot_module_t *m, uint16_t *w_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if (snapshot_io_tell(m->snapshot) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word(m->file, w_return);
+    return snapshot_read_word(m->snapshot, w_return);
 }
 
 int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint32_t) > m->offset + m->size) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if (snapshot_io_tell(m->snapshot) + sizeof(uint32_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword(m->file, dw_return);
+    return snapshot_read_dword(m->snapshot, dw_return);
 }
 
 int snapshot_module_read_qword(snapshot_module_t *m, uint64_t *qw_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint64_t) > m->offset + m->size) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if (snapshot_io_tell(m->snapshot) + sizeof(uint64_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_qword(m->file, qw_return);
+    return snapshot_read_qword(m->snapshot, qw_return);
 }
 
 int snapshot_module_read_double(snapshot_module_t *m, double *db_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(double) > m->offset + m->size) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if (snapshot_io_tell(m->snapshot) + sizeof(double) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_double(m->file, db_return);
+    return snapshot_read_double(m->snapshot, db_return);
 }
 
 int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num) > (long)(m->offset + m->size)) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if ((long)(snapshot_io_tell(m->snapshot) + num) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_byte_array(m->file, b_return, num);
+    return snapshot_read_byte_array(m->snapshot, b_return, num);
 }
 
 int snapshot_module_read_word_array(snapshot_module_t *m, uint16_t *w_return, unsigned int num)
 {
-    if ((long)(ftell(m->file) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
+    if ((long)(snapshot_io_tell(m->snapshot) + num * sizeof(uint16_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_word_array(m->file, w_return, num);
+    return snapshot_read_word_array(m->snapshot, w_return, num);
 }
 
 int snapshot_module_read_dword_array(snapshot_module_t *m, uint32_t *dw_return, unsigned int num)
 {
-    current_fpos = ftell(m->file);
-    if ((long)(ftell(m->file) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if ((long)(snapshot_io_tell(m->snapshot) + num * sizeof(uint32_t)) > (long)(m->offset + m->size)) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_dword_array(m->file, dw_return, num);
+    return snapshot_read_dword_array(m->snapshot, dw_return, num);
 }
 
 int snapshot_module_read_string(snapshot_module_t *m, char **charp_return)
 {
-    current_fpos = ftell(m->file);
-    if (ftell(m->file) + sizeof(uint16_t) > m->offset + m->size) {
+    current_fpos = snapshot_io_tell(m->snapshot);
+    if (snapshot_io_tell(m->snapshot) + sizeof(uint16_t) > m->offset + m->size) {
         snapshot_error = SNAPSHOT_READ_OUT_OF_BOUNDS_ERROR;
         return -1;
     }
 
-    return snapshot_read_string(m->file, charp_return);
+    return snapshot_read_string(m->snapshot, charp_return);
 }
 
 int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
@@ -681,8 +797,8 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     current_module = (char *)name;
 
     m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->offset = ftell(s->file);
+    m->snapshot = s;
+    m->offset = snapshot_io_tell(s);
     if (m->offset == -1) {
         snapshot_error = SNAPSHOT_ILLEGAL_OFFSET_ERROR;
         lib_free(m);
@@ -690,86 +806,157 @@ snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8
     }
     m->write_mode = 1;
 
-    if (snapshot_write_padded_string(s->file, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
-        || snapshot_write_byte(s->file, major_version) < 0
-        || snapshot_write_byte(s->file, minor_version) < 0
-        || snapshot_write_dword(s->file, 0) < 0) {
+    if (snapshot_write_padded_string(s, name, (uint8_t)0, SNAPSHOT_MODULE_NAME_LEN) < 0
+        || snapshot_write_byte(s, major_version) < 0
+        || snapshot_write_byte(s, minor_version) < 0
+        || snapshot_write_dword(s, 0) < 0) {
+        lib_free(m);
         return NULL;
     }
 
-    m->size = (uint32_t)(ftell(s->file) - m->offset);
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
+    m->size = (uint32_t)(snapshot_io_tell(s) - m->offset);
+    m->size_offset = snapshot_io_tell(s) - sizeof(uint32_t);
 
     return m;
 }
 
-snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t *major_version_return, uint8_t *minor_version_return)
+static unsigned int snapshot_module_hash(const char *key)
 {
-    snapshot_module_t *m;
-    char n[SNAPSHOT_MODULE_NAME_LEN];
-    unsigned int name_len = (unsigned int)strlen(name);
+    uint32_t h = 2166136261u;
+    int i;
 
-    current_module = (char *)name;
+    for (i = 0; i < SNAPSHOT_MODULE_NAME_LEN; i++) {
+        h = (h ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return (unsigned int)h;
+}
 
-    if (fseek(s->file, s->first_module_offset, SEEK_SET) < 0) {
-        snapshot_error = SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR;
-        DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
-        return NULL;
+/* Find the slot of the module named `key' in the hash table, or the empty
+   slot it would go to.  */
+static int *snapshot_module_slot(snapshot_t *s, const char *key)
+{
+    unsigned int i = snapshot_module_hash(key) & s->module_hash_mask;
+
+    while (s->module_hash[i] != 0
+           && memcmp(s->modules[s->module_hash[i] - 1].name, key, SNAPSHOT_MODULE_NAME_LEN) != 0) {
+        i = (i + 1) & s->module_hash_mask;
     }
+    return &s->module_hash[i];
+}
 
-    m = lib_malloc(sizeof(snapshot_module_t));
-    m->file = s->file;
-    m->write_mode = 0;
+/* Read the headers of all modules once, so that opening a module does not
+   have to search the file for it.  The list ends at the first header that
+   cannot be read; if a name occurs more than once, the first one is used,
+   like a search from the start would.  */
+static void snapshot_index_modules(snapshot_t *s)
+{
+    int num_alloc = 0;
+    unsigned int hash_size;
+    long offset = s->first_module_offset;
+    int error = snapshot_error;
+    int i;
 
-    m->offset = s->first_module_offset;
+    while (snapshot_io_seek(s, offset) == 0) {
+        snapshot_module_entry_t *e;
+        uint8_t *p;
 
-    DBG(("snapshot_module_open name: '%s'\n", name));
+        if (s->num_modules == num_alloc) {
+            num_alloc = num_alloc ? num_alloc * 2 : 32;
+            s->modules = lib_realloc(s->modules, num_alloc * sizeof(snapshot_module_entry_t));
+        }
+        e = &s->modules[s->num_modules];
 
-    /* Search for the module name.  This is quite inefficient, but I don't
-       think we care.  */
-    while (1) {
-        if (snapshot_read_byte_array(s->file, (uint8_t *)n,
-                                     SNAPSHOT_MODULE_NAME_LEN) < 0
-            || snapshot_read_byte(s->file, major_version_return) < 0
-            || snapshot_read_byte(s->file, minor_version_return) < 0
-            || snapshot_read_dword(s->file, &m->size)) {
-            snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
-            goto fail;
+        if (snapshot_read_byte_array(s, (uint8_t *)e->name, SNAPSHOT_MODULE_NAME_LEN) < 0
+            || snapshot_read_byte(s, &e->major_version) < 0
+            || snapshot_read_byte(s, &e->minor_version) < 0
+            || snapshot_read_dword(s, &e->size) < 0) {
+            break;
+        }
+        p = memchr(e->name, 0, SNAPSHOT_MODULE_NAME_LEN);
+        if (p != NULL) {
+            memset(p, 0, SNAPSHOT_MODULE_NAME_LEN - (p - (uint8_t *)e->name));
         }
+        e->offset = offset;
+        s->num_modules++;
 
-        /* Found?  */
-        if (memcmp(n, name, name_len) == 0
-            && (name_len == SNAPSHOT_MODULE_NAME_LEN || n[name_len] == 0)) {
+        if (e->size < SNAPSHOT_MODULE_HEADER_LEN) {
+            /* broken, the next module cannot be found */
             break;
         }
+        offset += e->size;
+    }
 
-        m->offset += m->size;
-        if (fseek(s->file, m->offset, SEEK_SET) < 0) {
-            snapshot_error = SNAPSHOT_MODULE_NOT_FOUND_ERROR;
-            goto fail;
+    for (hash_size = 64; hash_size < (unsigned int)s->num_modules * 2; hash_size *= 2) {
+    }
+    s->module_hash = lib_calloc(hash_size, sizeof(int));
+    s->module_hash_mask = hash_size - 1;
+
+    for (i = 0; i < s->num_modules; i++) {
+        int *slot = snapshot_module_slot(s, s->modules[i].name);
+
+        if (*slot == 0) {
+            *slot = i + 1;
         }
     }
 
-    m->size_offset = ftell(s->file) - sizeof(uint32_t);
-#if 0
-    /* HACK: if any of the errors *this* function can produce is still pending
-             in snapshot_error, clear it out - else we might fail for no reason
-             eg when trying to open the C64ROM module, which isnt strictly
-             required to exist in the snapshot */
-    if ((snapshot_error == SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR) ||
-        (snapshot_error == SNAPSHOT_MODULE_HEADER_READ_ERROR) ||
-        (snapshot_error == SNAPSHOT_MODULE_NOT_FOUND_ERROR)) {
-        snapshot_error = SNAPSHOT_NO_ERROR;
+    /* running into the end is not an error */
+    snapshot_error = error;
+    snapshot_io_seek(s, s->first_module_offset);
+}
+
+snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t *major_version_return, uint8_t *minor_version_return)
+{
+    snapshot_module_t *m;
+    snapshot_module_entry_t *e;
+    char key[SNAPSHOT_MODULE_NAME_LEN];
+    size_t name_len = strlen(name);
+    int index;
+
+    current_module = (char *)name;
+
+    DBG(("snapshot_module_open name: '%s'\n", name));
+
+    if (s->module_hash == NULL) {
+        snapshot_error = SNAPSHOT_FIRST_MODULE_NOT_FOUND_ERROR;
+        DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
+        return NULL;
     }
-#endif
+
+    /* pad the name with zeroes, like the names in the index */
+    if (name_len <= SNAPSHOT_MODULE_NAME_LEN) {
+        memset(key, 0, SNAPSHOT_MODULE_NAME_LEN);
+        memcpy(key, name, name_len);
+        index = *snapshot_module_slot(s, key);
+    } else {
+        index = 0;
+    }
+    if (index == 0) {
+        snapshot_error = SNAPSHOT_MODULE_NOT_FOUND_ERROR;
+        snapshot_io_seek(s, s->first_module_offset);
+        DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
+        return NULL;
+    }
+    e = &s->modules[index - 1];
+
+    if (snapshot_io_seek(s, e->offset + SNAPSHOT_MODULE_HEADER_LEN) < 0) {
+        snapshot_error = SNAPSHOT_MODULE_HEADER_READ_ERROR;
+        snapshot_io_seek(s, s->first_module_offset);
+        DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
+        return NULL;
+    }
+
+    m = lib_malloc(sizeof(snapshot_module_t));
+    m->snapshot = s;
+    m->write_mode = 0;
+    m->offset = e->offset;
+    m->size = e->size;
+    m->size_offset = e->offset + SNAPSHOT_MODULE_HEADER_LEN - sizeof(uint32_t);
+
+    *major_version_return = e->major_version;
+    *minor_version_return = e->minor_version;
+
     DBG(("snapshot_module_open name: '%s', version %u.%u found\n", name, *major_version_return, *minor_version_return));
     return m;
-
-fail:
-    fseek(s->file, s->first_module_offset, SEEK_SET);
-    lib_free(m);
-    DBG(("snapshot_module_open error: name: '%s' NOT found\n", name));
-    return NULL;
 }
 
 int snapshot_module_close(snapshot_module_t *m)
@@ -777,15 +964,15 @@ int snapshot_module_close(snapshot_module_t *m)
     DBG(("snapshot_module_close name: '%s'\n", current_module));
     /* Backpatch module size if writing.  */
     if (m->write_mode
-        && (fseek(m->file, m->size_offset, SEEK_SET) < 0
-            || snapshot_write_dword(m->file, m->size) < 0)) {
+        && (snapshot_io_seek(m->snapshot, m->size_offset) < 0
+            || snapshot_write_dword(m->snapshot, m->size) < 0)) {
         snapshot_error = SNAPSHOT_MODULE_CLOSE_ERROR;
         DBG(("snapshot_module_close error\n"));
         return -1;
     }
 
     /* Skip module.  */
-    if (fseek(m->file, m->offset + m->size, SEEK_SET) < 0) {
+    if (snapshot_io_seek(m->snapshot, m->offset + m->size) < 0) {
         snapshot_error = SNAPSHOT_MODULE_SKIP_ERROR;
         DBG(("snapshot_module_close error\n"));
         return -1;
@@ -798,111 +985,149 @@ int snapshot_module_close(snapshot_module_t *m)
 
 /* ------------------------------------------------------------------------- */
 
-snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
+static snapshot_t *snapshot_new(FILE *f, int write_mode)
 {
-    FILE *f;
     snapshot_t *s;
-    unsigned char viceversion[4] = { VERSION_RC_NUMBER };
 
-    current_filename = (char *)filename;
+    s = lib_calloc(1, sizeof(snapshot_t));
+    s->file = f;
+    s->write_mode = write_mode;
 
-    f = fopen(filename, MODE_WRITE);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
-        return NULL;
+    return s;
+}
+
+static void snapshot_free(snapshot_t *s)
+{
+    if (s->owns_data) {
+        lib_free(s->data);
     }
+    lib_free(s->modules);
+    lib_free(s->module_hash);
+    lib_free(s);
+}
+
+static int snapshot_write_header(snapshot_t *s, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
+{
+    unsigned char viceversion[4] = { VERSION_RC_NUMBER };
 
     /* Magic string.  */
-    if (snapshot_write_padded_string(f, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_magic_string, (uint8_t)0, SNAPSHOT_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Version number.  */
-    if (snapshot_write_byte(f, major_version) < 0
-        || snapshot_write_byte(f, minor_version) < 0) {
+    if (snapshot_write_byte(s, major_version) < 0
+        || snapshot_write_byte(s, minor_version) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Machine.  */
-    if (snapshot_write_padded_string(f, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_machine_name, (uint8_t)0, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MACHINE_NAME_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* VICE version and revision */
-    if (snapshot_write_padded_string(f, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
+    if (snapshot_write_padded_string(s, snapshot_version_magic_string, (uint8_t)0, SNAPSHOT_VERSION_MAGIC_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_WRITE_MAGIC_STRING_ERROR;
-        goto fail;
+        return -1;
     }
 
-    if (snapshot_write_byte(f, viceversion[0]) < 0
-        || snapshot_write_byte(f, viceversion[1]) < 0
-        || snapshot_write_byte(f, viceversion[2]) < 0
-        || snapshot_write_byte(f, viceversion[3]) < 0
+    if (snapshot_write_byte(s, viceversion[0]) < 0
+        || snapshot_write_byte(s, viceversion[1]) < 0
+        || snapshot_write_byte(s, viceversion[2]) < 0
+        || snapshot_write_byte(s, viceversion[3]) < 0
 #ifdef USE_SVN_REVISION
-        || snapshot_write_dword(f, VICE_SVN_REV_NUMBER) < 0) {
+        || snapshot_write_dword(s, VICE_SVN_REV_NUMBER) < 0) {
 #else
-        || snapshot_write_dword(f, 0) < 0) {
+        || snapshot_write_dword(s, 0) < 0) {
 #endif
         snapshot_error = SNAPSHOT_CANNOT_WRITE_VERSION_ERROR;
-        goto fail;
+        return -1;
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 1;
+    s->first_module_offset = snapshot_io_tell(s);
+
+    return 0;
+}
+
+snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
+{
+    FILE *f;
+    snapshot_t *s;
+
+    current_filename = (char *)filename;
+
+    snapshot_save_wait();
+
+    f = fopen(filename, MODE_WRITE);
+    if (f == NULL) {
+        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+        return NULL;
+    }
+
+    s = snapshot_new(f, 1);
+
+    if (snapshot_write_header(s, major_version, minor_version, snapshot_machine_name) < 0) {
+        snapshot_free(s);
+        fclose(f);
+        archdep_remove(filename);
+        return NULL;
+    }
 
     return s;
+}
 
-fail:
-    fclose(f);
-    archdep_remove(filename);
-    return NULL;
+/* Create a snapshot that is written to a memory buffer instead of a file.
+   The buffer can be retrieved with `snapshot_mem_get_data()' or written to
+   disk with `snapshot_mem_save()' before calling `snapshot_close()'.  */
+snapshot_t *snapshot_create_mem(uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name)
+{
+    snapshot_t *s;
+
+    current_filename = (char *)"(memory)";
+
+    s = snapshot_new(NULL, 1);
+    s->owns_data = 1;
+
+    if (snapshot_write_header(s, major_version, minor_version, snapshot_machine_name) < 0) {
+        snapshot_free(s);
+        return NULL;
+    }
+
+    return s;
 }
 
 /* informal only, used by the error message created below */
 static unsigned char snapshot_viceversion[4];
 static uint32_t snapshot_vicerevision;
 
-snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+static int snapshot_read_header(snapshot_t *s, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
 {
-    FILE *f;
     char magic[SNAPSHOT_MAGIC_LEN];
-    snapshot_t *s = NULL;
     int machine_name_len;
-    size_t offs;
-
-    current_machine_name = (char *)snapshot_machine_name;
-    current_filename = (char *)filename;
-    current_module = NULL;
-
-    f = zfile_fopen(filename, MODE_READ);
-    if (f == NULL) {
-        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
-        return NULL;
-    }
+    long offs;
 
     /* Magic string.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
+    if (snapshot_read_byte_array(s, (uint8_t *)magic, SNAPSHOT_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_magic_string, SNAPSHOT_MAGIC_LEN) != 0) {
         snapshot_error = SNAPSHOT_MAGIC_STRING_MISMATCH_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Version number.  */
-    if (snapshot_read_byte(f, major_version_return) < 0
-        || snapshot_read_byte(f, minor_version_return) < 0) {
+    if (snapshot_read_byte(s, major_version_return) < 0
+        || snapshot_read_byte(s, minor_version_return) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Machine.  */
-    if (snapshot_read_byte_array(f, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
+    if (snapshot_read_byte_array(s, (uint8_t *)read_name, SNAPSHOT_MACHINE_NAME_LEN) < 0) {
         snapshot_error = SNAPSHOT_CANNOT_READ_MACHINE_NAME_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* Check machine name.  */
@@ -911,68 +1136,439 @@ snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, u
         || (machine_name_len != SNAPSHOT_MODULE_NAME_LEN
             && read_name[machine_name_len] != 0)) {
         snapshot_error = SNAPSHOT_MACHINE_MISMATCH_ERROR;
-        goto fail;
+        return -1;
     }
 
     /* VICE version and revision */
     memset(snapshot_viceversion, 0, 4);
     snapshot_vicerevision = 0;
-    offs = ftell(f);
+    offs = snapshot_io_tell(s);
 
-    if (snapshot_read_byte_array(f, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
+    if (snapshot_read_byte_array(s, (uint8_t *)magic, SNAPSHOT_VERSION_MAGIC_LEN) < 0
         || memcmp(magic, snapshot_version_magic_string, SNAPSHOT_VERSION_MAGIC_LEN) != 0) {
         /* old snapshots do not contain VICE version */
-        fseek(f, offs, SEEK_SET);
+        snapshot_io_seek(s, offs);
         log_warning(LOG_DEFAULT, "attempting to load pre 2.4.30 snapshot");
     } else {
         /* actually read the version */
-        if (snapshot_read_byte(f, &snapshot_viceversion[0]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[1]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[2]) < 0
-            || snapshot_read_byte(f, &snapshot_viceversion[3]) < 0
-            || snapshot_read_dword(f, &snapshot_vicerevision) < 0) {
+        if (snapshot_read_byte(s, &snapshot_viceversion[0]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[1]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[2]) < 0
+            || snapshot_read_byte(s, &snapshot_viceversion[3]) < 0
+            || snapshot_read_dword(s, &snapshot_vicerevision) < 0) {
             snapshot_error = SNAPSHOT_CANNOT_READ_VERSION_ERROR;
-            goto fail;
+            return -1;
         }
     }
 
-    s = lib_malloc(sizeof(snapshot_t));
-    s->file = f;
-    s->first_module_offset = ftell(f);
-    s->write_mode = 0;
+    s->first_module_offset = snapshot_io_tell(s);
+    snapshot_index_modules(s);
+
+    return 0;
+}
+
+#ifdef HAVE_ZLIB
+/* If the file of `s' is compressed with gzip (see `snapshot_mem_save_async()'),
+   uncompress it into memory and read it from there.  */
+static int snapshot_gunzip(snapshot_t *s)
+{
+    uint8_t in[0x4000];
+    z_stream z;
+    size_t len;
+    int ret = Z_OK;
+
+    len = fread(in, 1, sizeof(in), s->file);
+    if (len < 2 || in[0] != 0x1f || in[1] != 0x8b) {
+        rewind(s->file);
+        return 0;
+    }
+
+    memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK) {
+        zfile_fclose(s->file);
+        s->file = NULL;
+        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+        return -1;
+    }
+
+    s->data_alloc = SNAPSHOT_MEM_INITIAL_SIZE;
+    s->data = lib_malloc(s->data_alloc);
+    s->owns_data = 1;
+
+    do {
+        z.next_in = in;
+        z.avail_in = (uInt)len;
+        do {
+            if (s->data_size == s->data_alloc) {
+                s->data_alloc *= 2;
+                s->data = lib_realloc(s->data, s->data_alloc);
+            }
+            z.next_out = s->data + s->data_size;
+            z.avail_out = (uInt)(s->data_alloc - s->data_size);
+            ret = inflate(&z, Z_NO_FLUSH);
+            s->data_size = s->data_alloc - z.avail_out;
+        } while (ret == Z_OK && (z.avail_in > 0 || z.avail_out == 0));
+        if (ret != Z_OK) {
+            break;
+        }
+        len = fread(in, 1, sizeof(in), s->file);
+    } while (len > 0);
+    inflateEnd(&z);
+
+    zfile_fclose(s->file);
+    s->file = NULL;
+
+    if (ret != Z_STREAM_END) {
+        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+{
+    FILE *f;
+    snapshot_t *s = NULL;
+
+    current_machine_name = (char *)snapshot_machine_name;
+    current_filename = (char *)filename;
+    current_module = NULL;
+
+    snapshot_save_wait();
+
+    f = zfile_fopen(filename, MODE_READ);
+    if (f == NULL) {
+        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+        return NULL;
+    }
+
+    s = snapshot_new(f, 0);
+#ifdef HAVE_ZLIB
+    if (snapshot_gunzip(s) < 0) {
+        snapshot_free(s);
+        return NULL;
+    }
+#endif
+
+    if (snapshot_read_header(s, major_version_return, minor_version_return, snapshot_machine_name) < 0) {
+        if (s->file != NULL) {
+            zfile_fclose(f);
+        }
+        snapshot_free(s);
+        return NULL;
+    }
 
     vsync_suspend_speed_eval();
     return s;
+}
 
-fail:
-    fclose(f);
-    return NULL;
+/* Open a snapshot that lives in memory, for instance one created with
+   `snapshot_create_mem()'.  The data is not copied, so it must stay valid
+   until `snapshot_close()' is called.  */
+snapshot_t *snapshot_open_mem(const uint8_t *data, size_t size, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name)
+{
+    snapshot_t *s;
+
+    current_machine_name = (char *)snapshot_machine_name;
+    current_filename = (char *)"(memory)";
+    current_module = NULL;
+
+    if (data == NULL) {
+        snapshot_error = SNAPSHOT_CANNOT_OPEN_FOR_READ_ERROR;
+        return NULL;
+    }
+
+    s = snapshot_new(NULL, 0);
+    s->data = (uint8_t *)data;
+    s->data_size = size;
+    s->data_alloc = size;
+
+    if (snapshot_read_header(s, major_version_return, minor_version_return, snapshot_machine_name) < 0) {
+        snapshot_free(s);
+        return NULL;
+    }
+
+    vsync_suspend_speed_eval();
+    return s;
 }
 
 int snapshot_close(snapshot_t *s)
 {
-    int retval;
+    int retval = 0;
 
-    if (!s->write_mode) {
+    if (s->file == NULL) {
+        /* memory snapshot, nothing to flush */
+    } else if (!s->write_mode) {
         if (zfile_fclose(s->file) == EOF) {
             snapshot_error = SNAPSHOT_READ_CLOSE_EOF_ERROR;
             retval = -1;
-        } else {
-            retval = 0;
         }
     } else {
         if (fclose(s->file) == EOF) {
             snapshot_error = SNAPSHOT_WRITE_CLOSE_EOF_ERROR;
             retval = -1;
-        } else {
-            retval = 0;
         }
     }
 
-    lib_free(s);
+    snapshot_free(s);
+    return retval;
+}
+
+/* Return the buffer of a memory snapshot and store its size in `size'.
+   Returns NULL for file based snapshots.  */
+const uint8_t *snapshot_mem_get_data(snapshot_t *s, size_t *size)
+{
+    if (s->file != NULL) {
+        *size = 0;
+        return NULL;
+    }
+    *size = s->data_size;
+    return s->data;
+}
+
+/* Write the buffer of a memory snapshot to `filename'.  */
+int snapshot_mem_save(snapshot_t *s, const char *filename)
+{
+    FILE *f;
+
+    current_filename = (char *)filename;
+
+    if (s->file != NULL) {
+        snapshot_error = SNAPSHOT_CANNOT_WRITE_SNAPSHOT;
+        return -1;
+    }
+
+    snapshot_save_wait();
+
+    f = fopen(filename, MODE_WRITE);
+    if (f == NULL) {
+        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+        return -1;
+    }
+
+    if (s->data_size > 0 && fwrite(s->data, s->data_size, 1, f) < 1) {
+        snapshot_error = SNAPSHOT_WRITE_BYTE_ARRAY_ERROR;
+        fclose(f);
+        archdep_remove(filename);
+        return -1;
+    }
+
+    if (fclose(f) == EOF) {
+        snapshot_error = SNAPSHOT_WRITE_CLOSE_EOF_ERROR;
+        archdep_remove(filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* Saving snapshots in the background.
+
+   `snapshot_mem_save_async()' takes over a memory snapshot and leaves
+   compressing and writing it to a thread, so the emulation goes on right
+   after the (fast) serialization.  Later snapshot file operations wait for
+   the pending saves first, so they see the files complete.  Built without
+   threads, the snapshot is written right away.  */
+
+typedef struct snapshot_save_job_s {
+    uint8_t *data;
+    size_t size;
+    char *filename;
+    int compress;
+    struct snapshot_save_job_s *next;
+} snapshot_save_job_t;
+
+static int snapshot_save_job_write(snapshot_save_job_t *job)
+{
+    FILE *f;
+    int retval = 0;
+
+#ifdef HAVE_ZLIB
+    if (job->compress) {
+        gzFile gz;
+        size_t pos = 0;
+
+        /* fastest level: most of a snapshot is RAM, which compresses well
+           enough, and the point is to be done quickly */
+        gz = gzopen(job->filename, MODE_WRITE "1");
+        if (gz == NULL) {
+            return -1;
+        }
+        while (pos < job->size && retval == 0) {
+            unsigned int len = job->size - pos > 0x10000 ? 0x10000 : (unsigned int)(job->size - pos);
+
+            if (gzwrite(gz, job->data + pos, len) != (int)len) {
+                retval = -1;
+            }
+            pos += len;
+        }
+        if (gzclose(gz) != Z_OK) {
+            retval = -1;
+        }
+        if (retval < 0) {
+            archdep_remove(job->filename);
+        }
+        return retval;
+    }
+#endif
+
+    f = fopen(job->filename, MODE_WRITE);
+    if (f == NULL) {
+        return -1;
+    }
+    if (job->size > 0 && fwrite(job->data, job->size, 1, f) < 1) {
+        retval = -1;
+    }
+    if (fclose(f) == EOF) {
+        retval = -1;
+    }
+    if (retval < 0) {
+        archdep_remove(job->filename);
+    }
     return retval;
 }
 
+static void snapshot_save_job_free(snapshot_save_job_t *job)
+{
+    lib_free(job->data);
+    lib_free(job->filename);
+    lib_free(job);
+}
+
+#ifdef USE_IMAGE_WRITEBACK
+
+static pthread_mutex_t save_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t save_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t save_thread;
+static int save_thread_running = 0;
+static int save_thread_quit = 0;
+static snapshot_save_job_t *save_queue = NULL;
+static snapshot_save_job_t *save_queue_last = NULL;
+static int save_busy = 0;
+
+static void *snapshot_save_thread(void *unused)
+{
+    snapshot_save_job_t *job;
+
+    pthread_mutex_lock(&save_lock);
+    for (;;) {
+        while (save_queue == NULL && !save_thread_quit) {
+            pthread_cond_wait(&save_cond, &save_lock);
+        }
+        if (save_queue == NULL) {
+            break;
+        }
+        job = save_queue;
+        save_queue = job->next;
+        if (save_queue == NULL) {
+            save_queue_last = NULL;
+        }
+        save_busy = 1;
+        pthread_mutex_unlock(&save_lock);
+
+        if (snapshot_save_job_write(job) < 0) {
+            log_error(LOG_DEFAULT, "Cannot write snapshot `%s'.", job->filename);
+        }
+        snapshot_save_job_free(job);
+
+        pthread_mutex_lock(&save_lock);
+        save_busy = 0;
+        pthread_cond_broadcast(&save_cond);
+    }
+    pthread_mutex_unlock(&save_lock);
+
+    return NULL;
+}
+
+#endif
+
+/* Write memory snapshot `s' to `filename', compressed with gzip if
+   `compress' is set and zlib is available, and close it.  The file is
+   written in the background; a failure to write it is only logged.  */
+int snapshot_mem_save_async(snapshot_t *s, const char *filename, int compress)
+{
+    snapshot_save_job_t *job;
+
+    current_filename = (char *)filename;
+
+    if (s->file != NULL || !s->owns_data) {
+        snapshot_error = SNAPSHOT_CANNOT_WRITE_SNAPSHOT;
+        snapshot_close(s);
+        return -1;
+    }
+
+    job = lib_calloc(1, sizeof(snapshot_save_job_t));
+    job->data = s->data;
+    job->size = s->data_size;
+    job->filename = lib_strdup(filename);
+    job->compress = compress;
+    s->data = NULL;
+    snapshot_free(s);
+
+#ifdef USE_IMAGE_WRITEBACK
+    pthread_mutex_lock(&save_lock);
+    if (!save_thread_running) {
+        save_thread_quit = 0;
+        if (pthread_create(&save_thread, NULL, snapshot_save_thread, NULL) == 0) {
+            save_thread_running = 1;
+        }
+    }
+    if (save_thread_running) {
+        if (save_queue_last != NULL) {
+            save_queue_last->next = job;
+        } else {
+            save_queue = job;
+        }
+        save_queue_last = job;
+        pthread_cond_broadcast(&save_cond);
+        pthread_mutex_unlock(&save_lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&save_lock);
+#endif
+
+    if (snapshot_save_job_write(job) < 0) {
+        snapshot_error = SNAPSHOT_CANNOT_CREATE_SNAPSHOT_ERROR;
+        snapshot_save_job_free(job);
+        return -1;
+    }
+    snapshot_save_job_free(job);
+    return 0;
+}
+
+/* Wait until the snapshots saved in the background are written.  */
+void snapshot_save_wait(void)
+{
+#ifdef USE_IMAGE_WRITEBACK
+    pthread_mutex_lock(&save_lock);
+    while (save_queue != NULL || save_busy) {
+        pthread_cond_wait(&save_cond, &save_lock);
+    }
+    pthread_mutex_unlock(&save_lock);
+#endif
+}
+
+void snapshot_shutdown(void)
+{
+#ifdef USE_IMAGE_WRITEBACK
+    pthread_mutex_lock(&save_lock);
+    if (!save_thread_running) {
+        pthread_mutex_unlock(&save_lock);
+        return;
+    }
+    save_thread_quit = 1;
+    pthread_cond_broadcast(&save_cond);
+    pthread_mutex_unlock(&save_lock);
+
+    /* the thread writes what is queued before it quits */
+    pthread_join(save_thread, NULL);
+    save_thread_running = 0;
+#endif
+}
+
 static void display_error_with_vice_version(char *text, char *filename)
 {
     char *vmessage = lib_malloc(0x100);
@@ -65,6 +65,14 @@
 #define SNAPSHOT_ATA_IMAGE_FILENAME_MISMATCH     29
 #define SNAPSHOT_VICII_MODEL_MISMATCH            30
 
+/* Values for the `save_disks' argument of machine_write_snapshot() and
+   machine_write_snapshot_mem().  */
+#define SNAPSHOT_DISKS_NONE         0
+#define SNAPSHOT_DISKS_FULL         1
+/* Only name the attached GCR disk images and store the tracks written
+   since they were attached, for snapshots restored in the same session.  */
+#define SNAPSHOT_DISKS_REFERENCE    2
+
 typedef struct snapshot_module_s snapshot_module_t;
 typedef struct snapshot_s snapshot_t;
 
@@ -136,6 +144,14 @@ snapshot_t *snapshot_create(const char *filename, uint8_t major_version, uint8_t
 snapshot_t *snapshot_open(const char *filename, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name);
 int snapshot_close(snapshot_t *s);
 
+snapshot_t *snapshot_create_mem(uint8_t major_version, uint8_t minor_version, const char *snapshot_machine_name);
+snapshot_t *snapshot_open_mem(const uint8_t *data, size_t size, uint8_t *major_version_return, uint8_t *minor_version_return, const char *snapshot_machine_name);
+const uint8_t *snapshot_mem_get_data(snapshot_t *s, size_t *size);
+int snapshot_mem_save(snapshot_t *s, const char *filename);
+int snapshot_mem_save_async(snapshot_t *s, const char *filename, int compress);
+void snapshot_save_wait(void);
+void snapshot_shutdown(void);
+
 void snapshot_set_error(int error);
 int snapshot_get_error(void);
 
@@ -524,6 +524,112 @@ vice_network_socket_t * vice_network_client(const vice_network_socket_address_t
     return sockfd == INVALID_SOCKET ? NULL : vice_network_alloc_new_socket(sockfd);
 }
 
+/*! \brief Open a datagram socket
+
+  \param local_address
+     The address to bind the socket to, or NULL to use any.
+
+  \param remote_address
+     The address to connect the socket to, or NULL to connect it
+     later with vice_network_datagram_accept().
+
+  \return
+     0 on error;
+     else, a handle to the socket on success.
+
+  \remark
+     At least one of the addresses must be given, the first one
+     given determines the type of socket (IPv4, IPv6, ...)
+*/
+vice_network_socket_t * vice_network_datagram(const vice_network_socket_address_t * local_address,
+                                              const vice_network_socket_address_t * remote_address)
+{
+#if defined(SO_REUSEADDR)
+    const int so_setting = 1;
+#endif
+    const vice_network_socket_address_t * address = local_address ? local_address : remote_address;
+    int sockfd = INVALID_SOCKET;
+    int error = 1;
+
+    assert(address != NULL);
+
+    do {
+        if (socket_init() < 0) {
+            break;
+        }
+
+        sockfd = (int)socket(address->domain, SOCK_DGRAM, 0);
+
+        if (sockfd == INVALID_SOCKET) {
+            break;
+        }
+
+        if (local_address) {
+#if defined(SO_REUSEADDR)
+            setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (const void*)&so_setting, sizeof(so_setting));
+#endif
+            if (bind(sockfd, &local_address->address.generic, local_address->len) < 0) {
+                log_error(LOG_DEFAULT,
+                    "vice_network_datagram(): bind() failed: %s",
+                    strerror(errno));
+                break;
+            }
+        }
+
+        if (remote_address) {
+            if (connect(sockfd, &remote_address->address.generic, remote_address->len) < 0) {
+                break;
+            }
+        }
+        error = 0;
+    } while (0);
+
+    if (error) {
+        if (sockfd != INVALID_SOCKET) {
+            closesocket(sockfd);
+        }
+        sockfd = INVALID_SOCKET;
+    }
+
+    return sockfd == INVALID_SOCKET ? NULL : vice_network_alloc_new_socket(sockfd);
+}
+
+/*! \brief Connect a datagram socket to the sender of a datagram
+
+  This function receives the next datagram on a socket that has been
+  opened by vice_network_datagram() without a remote address, and
+  connects the socket to its sender.
+
+  \param sockfd
+     The datagram socket
+
+  \param buffer
+     Pointer to the buffer which will hold the received datagram
+
+  \param buffer_length
+     The length of the buffer pointed to by buffer.
+
+  \return
+     the number of bytes received, or -1 in case of an error.
+*/
+int vice_network_datagram_accept(vice_network_socket_t * sockfd, void * buffer, size_t buffer_length)
+{
+    int ret;
+
+    initialize_socket_address(&sockfd->address);
+
+    signals_pipe_set();
+    ret = (int)recvfrom(sockfd->sockfd, buffer, buffer_length, 0,
+                        &sockfd->address.address.generic, &sockfd->address.len);
+    signals_pipe_unset();
+
+    if (ret >= 0
+        && connect(sockfd->sockfd, &sockfd->address.address.generic, sockfd->address.len) < 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
 /*! \internal \brief Generate an IPv4 socket address
 
   Initialises a socket address with an IPv4 address.
@@ -1074,10 +1180,37 @@ int vice_network_select_poll_one(vice_network_socket_t * readsockfd)
     return select( readsockfd->sockfd + 1, &fdsockset, NULL, NULL, &timeout);
 }
 
+/*! \brief Check if a connected socket has incoming data or got closed
+
+  This function is like vice_network_select_poll_one(), but it also tells
+  if the other side closed a connection opened by vice_network_client() or
+  vice_network_accept(). It does not block.
+
+  \param readsockfd
+     The connected socket to test
+
+  \return
+     1 if the specified socket has data; 0 if it does not contain
+     any data, and -1 if the connection was closed or in case of an error.
+*/
+int vice_network_select_poll_stream(vice_network_socket_t * readsockfd)
+{
+    char peek;
+    int ret = vice_network_select_poll_one(readsockfd);
+
+    if (ret > 0) {
+        signals_pipe_set();
+        ret = (int)recv(readsockfd->sockfd, &peek, 1, MSG_PEEK);
+        signals_pipe_unset();
+        ret = ret > 0 ? 1 : -1;
+    }
+    return ret;
+}
+
 /*! \brief Monitor multiple sockets
 
   This function blocks for many different connections and returns when any
-  has data.
+  has data, or after a quarter of a second.
 
   \param readsockfd
      NULL terminated list of sockets to monitor
@@ -1087,10 +1220,34 @@ int vice_network_select_poll_one(vice_network_socket_t * readsockfd)
      any data, and -1 in case of an error.
 */
 int vice_network_select_multiple(vice_network_socket_t ** readsockfd)
+{
+    return vice_network_select_multiple_timeout(readsockfd, 250000);
+}
+
+/*! \brief Monitor multiple sockets with a timeout
+
+  This function blocks for many different connections and returns when any
+  has data, or when the timeout has passed.
+
+  \param readsockfd
+     NULL terminated list of sockets to monitor
+
+  \param timeout_usec
+     The maximum time to block, in microseconds
+
+  \return
+     the number of sockets that have data; 0 if none does,
+     and -1 in case of an error.
+*/
+int vice_network_select_multiple_timeout(vice_network_socket_t ** readsockfd,
+                                         unsigned int timeout_usec)
 {
     fd_set fdsockset;
     SOCKET max_sockfd = INVALID_SOCKET;
-    TIMEVAL time = {0, 250000};
+    TIMEVAL time;
+
+    time.tv_sec = timeout_usec / 1000000;
+    time.tv_usec = timeout_usec % 1000000;
 
     FD_ZERO(&fdsockset);
     while(*readsockfd != NULL) {
@@ -44,14 +44,17 @@
 #include "cmdline.h"
 #include "debug.h"
 #include "fixpoint.h"
+#include "hosttime.h"
 #include "lib.h"
 #include "log.h"
 #include "machine.h"
 #include "maincpu.h"
 #include "mainlock.h"
+#include "memusage.h"
 #include "monitor.h"
 #include "resources.h"
 #include "sound.h"
+#include "tracezone.h"
 #include "types.h"
 #include "uiapi.h"
 #include "util.h"
@@ -59,10 +62,32 @@
 #include "math.h"
 #include "ui.h"
 
+#ifdef USE_SOUND_THREAD
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "sid/sidqueue.h"
+#endif
+
+#ifdef SOUND_SYSTEM_FLOAT
+/* vector unit used for mixing the chip streams */
+#if defined(__SSE2__) || defined(_M_X64)
+#define SOUND_MIX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOUND_MIX_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 
 static log_t sound_log = LOG_ERR;
 
 static void sounddev_close(const sound_device_t **dev);
+#ifdef USE_SOUND_THREAD
+static void sound_thread_wait(void);
+static void sound_thread_stop(void);
+#endif
 
 /* ------------------------------------------------------------------------- */
 
@@ -166,6 +191,14 @@ uint16_t sound_chip_register(sound_chip_t *chip)
 
 /* ------------------------------------------------------------------------- */
 
+/* The float based sound system mixes and plays float samples (-1.0 .. 1.0)
+   to keep the resolution of the engines up to the device.  */
+#ifdef SOUND_SYSTEM_FLOAT
+typedef float sound_sample_t;
+#else
+typedef int16_t sound_sample_t;
+#endif
+
 typedef struct {
     /* Number of sound output channels */
     int sound_output_channels;
@@ -195,7 +228,7 @@ typedef struct {
     CLOCK lastclk;
 
     /* sample buffer */
-    int16_t *buffer;
+    sound_sample_t *buffer;
 
     /* sample buffer pointer */
     int bufptr;
@@ -217,7 +250,7 @@ typedef struct {
 
     /* is the device suspended? */
     int issuspended;
-    int16_t lastsample[SOUND_OUTPUT_CHANNELS_MAX];
+    sound_sample_t lastsample[SOUND_OUTPUT_CHANNELS_MAX];
 } snddata_t;
 
 static snddata_t snddata;
@@ -262,6 +295,13 @@ static void sound_machine_close(sound_t *psid)
 #ifdef SOUND_SYSTEM_FLOAT
 static float *sound_buffer[SOUND_CHIPS_MAX][SOUND_CHIP_CHANNELS_MAX];
 
+/* sum of the chip streams per output channel */
+static float *mix_buffer[SOUND_OUTPUT_CHANNELS_MAX];
+
+/* size of each of the buffers above and the bytes allocated for them */
+static int sound_buffer_size = 0;
+static size_t sound_buffer_bytes = 0;
+
 static void free_sound_buffers(void)
 {
     int i, j;
@@ -275,16 +315,127 @@ static void free_sound_buffers(void)
             }
         }
     }
+    for (i = 0; i < SOUND_OUTPUT_CHANNELS_MAX; i++) {
+        if (mix_buffer[i]) {
+            lib_free(mix_buffer[i]);
+            mix_buffer[i] = NULL;
+        }
+    }
+    sound_buffer_bytes = 0;
 }
 
 static void malloc_sound_buffers(int size)
 {
-    int i, j;
+    int i;
 
-    /* allocate all possibly needed buffers */
-    for (i = 0; i < SOUND_CHIPS_MAX; i++) {
-        for (j = 0; j < SOUND_CHIP_CHANNELS_MAX; j++) {
-            sound_buffer[i][j] = lib_malloc(size);
+    /* the buffers of the chip streams are allocated by chip_buffer() when
+       a chip first renders, most of the SOUND_CHIPS_MAX never do */
+    sound_buffer_size = size;
+    for (i = 0; i < SOUND_OUTPUT_CHANNELS_MAX; i++) {
+        mix_buffer[i] = lib_malloc(size);
+    }
+    sound_buffer_bytes = (size_t)size * SOUND_OUTPUT_CHANNELS_MAX;
+}
+
+/* Buffer for the stream of channel `k' of chip `i'.  */
+static float *chip_buffer(int i, int k)
+{
+    if (sound_buffer[i][k] == NULL) {
+        sound_buffer[i][k] = lib_malloc(sound_buffer_size);
+        sound_buffer_bytes += sound_buffer_size;
+    }
+    return sound_buffer[i][k];
+}
+
+/* Add `nr' samples of `src' at `volume' percent to `dst'.  */
+static void sound_mix_add(float *dst, const float *src, int volume, int nr)
+{
+    const float gain = (float)volume / 100.0f;
+    int j = 0;
+
+    if (!volume) {
+        return;
+    }
+
+#if defined(SOUND_MIX_SSE2)
+    {
+        const __m128 g = _mm_set1_ps(gain);
+
+        for (; j + 4 <= nr; j += 4) {
+            _mm_storeu_ps(dst + j, _mm_add_ps(_mm_loadu_ps(dst + j),
+                                              _mm_mul_ps(_mm_loadu_ps(src + j), g)));
+        }
+    }
+#elif defined(SOUND_MIX_NEON)
+    {
+        const float32x4_t g = vdupq_n_f32(gain);
+
+        for (; j + 4 <= nr; j += 4) {
+            vst1q_f32(dst + j, vmlaq_f32(vld1q_f32(dst + j), vld1q_f32(src + j), g));
+        }
+    }
+#endif
+    for (; j < nr; j++) {
+        dst[j] += src[j] * gain;
+    }
+}
+
+/* Clip `nr' samples of the mixed channels to -1.0 .. 1.0 and interleave
+   them into `pbuf'.  */
+static void sound_mix_output(float *pbuf, int nr, int soc)
+{
+    int j = 0;
+    int c;
+    float sample;
+
+#if defined(SOUND_MIX_SSE2)
+    {
+        const __m128 lo = _mm_set1_ps(-1.0f);
+        const __m128 hi = _mm_set1_ps(1.0f);
+        __m128 l, r;
+
+        if (soc == SOUND_OUTPUT_MONO) {
+            for (; j + 4 <= nr; j += 4) {
+                l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix_buffer[0] + j), lo), hi);
+                _mm_storeu_ps(pbuf + j, l);
+            }
+        } else {
+            for (; j + 4 <= nr; j += 4) {
+                l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix_buffer[0] + j), lo), hi);
+                r = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix_buffer[1] + j), lo), hi);
+                _mm_storeu_ps(pbuf + j * 2, _mm_unpacklo_ps(l, r));
+                _mm_storeu_ps(pbuf + j * 2 + 4, _mm_unpackhi_ps(l, r));
+            }
+        }
+    }
+#elif defined(SOUND_MIX_NEON)
+    {
+        const float32x4_t lo = vdupq_n_f32(-1.0f);
+        const float32x4_t hi = vdupq_n_f32(1.0f);
+        float32x4x2_t lr;
+
+        if (soc == SOUND_OUTPUT_MONO) {
+            for (; j + 4 <= nr; j += 4) {
+                vst1q_f32(pbuf + j, vminq_f32(vmaxq_f32(vld1q_f32(mix_buffer[0] + j), lo), hi));
+            }
+        } else {
+            for (; j + 4 <= nr; j += 4) {
+                lr.val[0] = vminq_f32(vmaxq_f32(vld1q_f32(mix_buffer[0] + j), lo), hi);
+                lr.val[1] = vminq_f32(vmaxq_f32(vld1q_f32(mix_buffer[1] + j), lo), hi);
+                vst2q_f32(pbuf + j * 2, lr);
+            }
+        }
+    }
+#endif
+    for (; j < nr; j++) {
+        for (c = 0; c < soc; c++) {
+            sample = mix_buffer[c][j];
+            if (sample < -1.0f) {
+                sample = -1.0f;
+            } else if (sample > 1.0f) {
+                sample = 1.0f;
+            }
+            pbuf[j * soc + c] = sample;
         }
     }
 }
@@ -298,15 +449,15 @@ static void malloc_sound_buffers(int size)
     a quick bandaid the memset was added below. This should be really cleaned
     up someday.
 */
-static int sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
+static int sound_machine_calculate_samples(sound_t **psid, sound_sample_t *pbuf, int nr, int soc, int scc, CLOCK *delta_t)
 {
 /* FIXME: fix mono stream to stereo mixing next */
 #ifdef SOUND_SYSTEM_FLOAT
-    int i, j, k;
+    int i, k, c;
     int temp;
+    int volume;
     int primary_sound_rendered = 0;
     int sound_channels[SOUND_CHIPS_MAX];
-    float *addition_buffer = NULL;
     CLOCK initial_delta_t = *delta_t;
     CLOCK delta_t_for_other_chips;
 
@@ -321,7 +472,7 @@ static int sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr
 
     /* do special treatment of first sound device in case it is cycle based */
     if (sound_calls[0]->cycle_based() || (!sound_calls[0]->cycle_based() && sound_calls[0]->chip_enabled)) {
-        temp = sound_calls[0]->calculate_samples(psid, sound_buffer[0][0], nr, 0, delta_t);
+        temp = sound_calls[0]->calculate_samples(psid, chip_buffer(0, 0), nr, 0, delta_t);
         primary_sound_rendered = 1;
     } else {
         temp = nr;
@@ -332,7 +483,7 @@ static int sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr
         if (sound_channels[0] > 1) {
             for (k = 1; k < sound_channels[0]; k++) {
                 delta_t_for_other_chips = initial_delta_t;
-                sound_calls[0]->calculate_samples(psid, sound_buffer[0][k], nr, k, &delta_t_for_other_chips);
+                sound_calls[0]->calculate_samples(psid, chip_buffer(0, k), nr, k, &delta_t_for_other_chips);
             }
         }
     }
@@ -341,99 +492,33 @@ static int sound_machine_calculate_samples(sound_t **psid, int16_t *pbuf, int nr
     for (i = 1; i < (offset >> 5); i++) {
         if (sound_calls[i]->chip_enabled) {
             delta_t_for_other_chips = initial_delta_t;
-            sound_calls[i]->calculate_samples(psid, sound_buffer[i][0], temp, 0, &delta_t_for_other_chips);
+            sound_calls[i]->calculate_samples(psid, chip_buffer(i, 0), temp, 0, &delta_t_for_other_chips);
         }
     }
 
-    /* allocate buffer to hold added samples */
-    addition_buffer = lib_malloc(snddata.bufsize * soc * sizeof(float));
-
-    if (soc == SOUND_OUTPUT_MONO) {
-
-        /* Add all samples together for enabled sound devices and output in mono */
-        for (j = 0; j < temp; j++) {
-            addition_buffer[j] = 0.0;
-            for (i = 0; i < (offset >> 5); i++) {
-                if (sound_calls[i]->chip_enabled) {
-                    addition_buffer[j] += sound_buffer[i][0][j];
-                    if (sound_channels[i] > 1) {
-                        for (k = 1; k < sound_channels[i]; k++) {
-                            addition_buffer[j] += sound_buffer[i][k][j];
-                        }
-                    }
-                }
-            }
-        }
-    } else {
-
-        /* Add all samples together for enabled sound devices and output in stereo */
-        for (j = 0; j < temp; j++) {
-
-            /* left first */
-            addition_buffer[j * soc] = 0.0;
-            for (i = 0; i < (offset >> 5); i++) {
-                if (sound_calls[i]->chip_enabled) {
-                    if (sound_calls[i]->sound_chip_channel_mixing[0].left_channel_volume) {
-                        if (sound_calls[i]->sound_chip_channel_mixing[0].left_channel_volume == 100) {
-                            addition_buffer[j * soc] += sound_buffer[i][0][j];
-                        } else {
-                            addition_buffer[j * soc] += (sound_buffer[i][0][j] * sound_calls[i]->sound_chip_channel_mixing[0].left_channel_volume / 100.0);
-                        }
-                    }
-                    if (sound_channels[i] > 1) {
-                        for (k = 1; k < sound_channels[i]; k++) {
-                            if (sound_calls[i]->sound_chip_channel_mixing[k].left_channel_volume == 100) {
-                                addition_buffer[j * soc] += sound_buffer[i][k][j];
-                            } else {
-                                addition_buffer[j * soc] += (sound_buffer[i][k][j] * sound_calls[i]->sound_chip_channel_mixing[k].left_channel_volume / 100.0);
-                            }
-                        }
-                    }
-                }
+    /* Add the streams of the enabled sound devices per output channel, in
+       mono without the stereo placement */
+    for (c = 0; c < soc; c++) {
+        memset(mix_buffer[c], 0, temp * sizeof(float));
+        for (i = 0; i < (offset >> 5); i++) {
+            if (!sound_calls[i]->chip_enabled) {
+                continue;
             }
-
-            /* now right */
-            addition_buffer[(j * soc) + 1] = 0.0;
-            for (i = 0; i < (offset >> 5); i++) {
-                if (sound_calls[i]->chip_enabled) {
-                    if (sound_calls[i]->sound_chip_channel_mixing[0].right_channel_volume) {
-                        if (sound_calls[i]->sound_chip_channel_mixing[0].right_channel_volume == 100) {
-                            addition_buffer[(j * soc) + 1] += sound_buffer[i][0][j];
-                        } else {
-                            addition_buffer[(j * soc) + 1] += (sound_buffer[i][0][j] * sound_calls[i]->sound_chip_channel_mixing[0].right_channel_volume / 100.0);
-                        }
-                    }
-                    if (sound_channels[i] > 1) {
-                        for (k = 1; k < sound_channels[i]; k++) {
-                            if (sound_calls[i]->sound_chip_channel_mixing[k].right_channel_volume == 100) {
-                                addition_buffer[(j * soc) + 1] += sound_buffer[i][k][j];
-                            } else {
-                                addition_buffer[(j * soc) + 1] += (sound_buffer[i][k][j] * sound_calls[i]->sound_chip_channel_mixing[k].right_channel_volume / 100.0);
-                            }
-                        }
-                    }
+            for (k = 0; k < sound_channels[i]; k++) {
+                if (soc == SOUND_OUTPUT_MONO) {
+                    volume = 100;
+                } else if (c == 0) {
+                    volume = sound_calls[i]->sound_chip_channel_mixing[k].left_channel_volume;
+                } else {
+                    volume = sound_calls[i]->sound_chip_channel_mixing[k].right_channel_volume;
                 }
+                sound_mix_add(mix_buffer[c], chip_buffer(i, k), volume, temp);
             }
-
-        }
-    }
-
-    /* clip the addition buffer if needed */
-    for (j = 0; j < (temp * soc); j++) {
-        if (addition_buffer[j] < -1.0) {
-            addition_buffer[j] = -1.0;
-        } else if (addition_buffer[j] > 1.0) {
-            addition_buffer[j] = 1.0;
         }
     }
 
-    /* convert floats to int16_t for output */
-    for (j = 0; j < (temp * soc); j++) {
-        pbuf[j] = (int16_t)(addition_buffer[j] * 32767.0);
-    }
-
-    /* free addition buffer */
-    lib_free(addition_buffer);
+    /* clip and interleave straight into the output buffer */
+    sound_mix_output(pbuf, temp, soc);
 
     return temp;
 #else
@@ -485,6 +570,26 @@ static void sound_machine_reset(sound_t *psid, CLOCK cpu_clk)
     }
 }
 
+/* Advance all enabled chips without rendering samples.  Returns -1 if
+   they must be rendered instead, before any chip was advanced.  Only the
+   first chip, the SID, can fail after the check.  */
+static int sound_machine_skip(sound_t **psid, int scc, CLOCK delta_t)
+{
+    int i;
+
+    for (i = 0; i < (offset >> 5); i++) {
+        if (sound_calls[i]->chip_enabled && sound_calls[i]->skip == NULL) {
+            return -1;
+        }
+    }
+    for (i = 0; i < (offset >> 5); i++) {
+        if (sound_calls[i]->chip_enabled && sound_calls[i]->skip(psid, scc, delta_t) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
 static int sound_machine_cycle_based(void)
 {
     int i;
@@ -531,6 +636,12 @@ static int volume;
 static int amp;
 static int fragment_size;
 static int output_option;
+#ifdef USE_SOUND_THREAD
+static int use_sound_thread;
+static int use_record_thread;
+#endif
+static int buffer_adaptive;            /* app_resources.soundBufferAdaptive */
+static int warp_skip;                  /* skip the synthesis in warp mode */
 
 /* divisors for fragment size calculation */
 static const int fragment_divisor[] = {
@@ -553,6 +664,36 @@ int sound_state_changed;
 int sound_playdev_reopen;
 int sid_state_changed;
 
+/* With `SoundBufferAdaptive' set, the device buffer is grown when the
+   device runs dry and shrunk again after a while without underruns, see
+   sound_adapt_buffer().  Sizes are in msec, as for `SoundBufferSize'.  */
+#define SOUND_ADAPT_MIN_BUFFER_SIZE     20
+
+/* seconds of sound in one measuring window */
+#define SOUND_ADAPT_WINDOW              2
+
+/* windows without underruns before shrinking, doubled after every
+   underrun up to the maximum, so a size that does not work is not retried
+   too often */
+#define SOUND_ADAPT_SHRINK_WINDOWS      5
+#define SOUND_ADAPT_SHRINK_WINDOWS_MAX  60
+
+/* current size in adaptive mode, 0 until the device is first opened */
+static int adaptive_buffer_size = 0;
+static int adapt_shrink_windows = SOUND_ADAPT_SHRINK_WINDOWS;
+static int adapt_quiet_windows = 0;
+
+/* device statistics, measured by sound_write_fragments() */
+static unsigned int stat_underruns = 0;
+static unsigned int stat_overruns = 0;
+static int stat_fill = 0;
+static int window_underruns = 0;
+static int window_overruns = 0;
+static int window_samples = 0;
+
+/* set when the device was (re)started, so it is empty on purpose */
+static int stat_restart = 1;
+
 /* Sample based or cycle based sound engine. */
 static int cycle_based = 0;
 
@@ -646,10 +787,28 @@ static int set_buffer_size(int val, void *param)
         }
     }
 
+    /* the adaptive size starts over from the new size */
+    adaptive_buffer_size = 0;
+
     sound_playdev_reopen = TRUE;
     return 0;
 }
 
+static int set_buffer_adaptive(int val, void *param)
+{
+    val = val ? 1 : 0;
+
+    if (buffer_adaptive != val) {
+        buffer_adaptive = val;
+        if (adaptive_buffer_size > 0) {
+            /* go back to the configured size */
+            adaptive_buffer_size = 0;
+            sound_playdev_reopen = TRUE;
+        }
+    }
+    return 0;
+}
+
 static int set_fragment_size(int val, void *param)
 {
     if (val < SOUND_FRAGMENT_VERY_SMALL) {
@@ -662,6 +821,34 @@ static int set_fragment_size(int val, void *param)
     return 0;
 }
 
+#ifdef USE_SOUND_THREAD
+static int set_sound_thread(int val, void *param)
+{
+    use_sound_thread = val ? 1 : 0;
+
+    if (!use_sound_thread) {
+        sound_thread_stop();
+    }
+
+    return 0;
+}
+
+/* Takes effect when the next recording starts.  */
+static int set_record_thread(int val, void *param)
+{
+    use_record_thread = val ? 1 : 0;
+
+    return 0;
+}
+#endif
+
+static int set_warp_skip(int val, void *param)
+{
+    warp_skip = val ? 1 : 0;
+
+    return 0;
+}
+
 static int set_volume(int val, void *param)
 {
     volume = val;
@@ -703,10 +890,20 @@ static const resource_int_t resources_int[] = {
       (void *)&buffer_size, set_buffer_size, NULL },
     { "SoundFragmentSize", SOUND_FRAGMENT_SIZE, RES_EVENT_NO, NULL,
       (void *)&fragment_size, set_fragment_size, NULL },
+    { "SoundBufferAdaptive", 0, RES_EVENT_NO, NULL,
+      (void *)&buffer_adaptive, set_buffer_adaptive, NULL },
     { "SoundVolume", MASTER_VOLUME_DEFAULT, RES_EVENT_NO, NULL,
       (void *)&volume, set_volume, NULL },
     { "SoundOutput", ARCHDEP_SOUND_OUTPUT_MODE, RES_EVENT_NO, NULL,
       (void *)&output_option, set_output_option, NULL },
+    { "SoundWarpSkip", 0, RES_EVENT_NO, NULL,
+      (void *)&warp_skip, set_warp_skip, NULL },
+#ifdef USE_SOUND_THREAD
+    { "SoundThread", 0, RES_EVENT_NO, NULL,
+      (void *)&use_sound_thread, set_sound_thread, NULL },
+    { "SoundRecordThread", 1, RES_EVENT_NO, NULL,
+      (void *)&use_record_thread, set_record_thread, NULL },
+#endif
     RESOURCE_INT_LIST_END
 };
 
@@ -756,12 +953,38 @@ static const cmdline_option_t cmdline_options[] =
     { "-soundfragsize", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "SoundFragmentSize", NULL,
       "<value>", "Set sound fragment size (0: very small, 1: small, 2: medium, 3: large, 4: very large)" },
+    { "-soundbufadaptive", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundBufferAdaptive", (resource_value_t)1,
+      NULL, "Grow and shrink the sound buffer with the underruns of the device" },
+    { "+soundbufadaptive", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundBufferAdaptive", (resource_value_t)0,
+      NULL, "Always use the sound buffer size set with -soundbufsize" },
     { "-soundoutput", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "SoundOutput", NULL,
       "<output mode>", "Sound output mode: (0: system decides mono/stereo, 1: always mono, 2: always stereo)" },
     { "-soundvolume", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "SoundVolume", NULL,
       "<Volume>", "Specify the sound volume (0..100)" },
+    { "-soundwarpskip", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundWarpSkip", (resource_value_t)1,
+      NULL, "Do not synthesize the sound in warp mode, only what the chip registers read back" },
+    { "+soundwarpskip", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundWarpSkip", (resource_value_t)0,
+      NULL, "Synthesize the sound in warp mode as well (default)" },
+#ifdef USE_SOUND_THREAD
+    { "-soundthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundThread", (resource_value_t)1,
+      NULL, "Render and play the sound on a separate thread" },
+    { "+soundthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundThread", (resource_value_t)0,
+      NULL, "Render and play the sound on the emulation thread" },
+    { "-soundrecordthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundRecordThread", (resource_value_t)1,
+      NULL, "Encode sound recordings on a separate thread (default)" },
+    { "+soundrecordthread", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "SoundRecordThread", (resource_value_t)0,
+      NULL, "Encode sound recordings on the emulation thread" },
+#endif
     CMDLINE_LIST_END
 };
 
@@ -886,6 +1109,14 @@ static double speed_percent;
 /* Flag: Is warp mode enabled?  */
 static int warp_mode_enabled;
 
+/* Run-ahead: buffer position and clocks when the machine state was saved,
+   samples generated after it are discarded.  `runahead_bufptr' is -1 while
+   no run-ahead frames are emulated.  */
+static int runahead_bufptr = -1;
+static soundclk_t runahead_fclk;
+static CLOCK runahead_wclk;
+static CLOCK runahead_lastclk;
+
 /* device registration code */
 #define MAX_SOUND_DEVICES 24
 
@@ -943,10 +1174,87 @@ static int sound_error_log_only(const char *msg)
 }
 #endif
 
-static int16_t *temp_buffer = NULL;
+static sound_sample_t *temp_buffer = NULL;
 static int temp_buffer_size = 0;
 
-static int16_t *realloc_buffer(int size)
+#ifdef SOUND_SYSTEM_FLOAT
+/* 16 bit copy of the samples for devices without write_float() */
+static int16_t *convert_buffer = NULL;
+static size_t convert_buffer_size = 0;
+#endif
+
+/* Can the sound system write samples to `dev'?  */
+static int sound_device_can_write(const sound_device_t *dev)
+{
+#ifdef SOUND_SYSTEM_FLOAT
+    return dev->write != NULL || dev->write_float != NULL;
+#else
+    return dev->write != NULL;
+#endif
+}
+
+#ifdef SOUND_SYSTEM_FLOAT
+/* Write `nr' samples (of all channels) to `dev', in its own format,
+   converting them in `*conv' (of `*conv_size' samples) if needed.  */
+static int sound_device_write_conv(const sound_device_t *dev, sound_sample_t *pbuf, size_t nr,
+                                   int16_t **conv, size_t *conv_size)
+{
+    int16_t *convert_buffer;
+    size_t i = 0;
+
+    if (dev->write_float) {
+        return dev->write_float(pbuf, nr);
+    }
+
+    if (*conv_size < nr) {
+        *conv = lib_realloc(*conv, nr * sizeof(int16_t));
+        *conv_size = nr;
+    }
+    convert_buffer = *conv;
+
+    /* the samples are clipped already */
+#if defined(SOUND_MIX_SSE2)
+    {
+        const __m128 scale = _mm_set1_ps(32767.0f);
+        __m128i lo, hi;
+
+        for (; i + 8 <= nr; i += 8) {
+            lo = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(pbuf + i), scale));
+            hi = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(pbuf + i + 4), scale));
+            _mm_storeu_si128((__m128i *)(convert_buffer + i), _mm_packs_epi32(lo, hi));
+        }
+    }
+#elif defined(SOUND_MIX_NEON)
+    {
+        const float32x4_t scale = vdupq_n_f32(32767.0f);
+        int32x4_t lo, hi;
+
+        for (; i + 8 <= nr; i += 8) {
+            lo = vcvtq_s32_f32(vmulq_f32(vld1q_f32(pbuf + i), scale));
+            hi = vcvtq_s32_f32(vmulq_f32(vld1q_f32(pbuf + i + 4), scale));
+            vst1q_s16(convert_buffer + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+        }
+    }
+#endif
+    for (; i < nr; i++) {
+        convert_buffer[i] = (int16_t)(pbuf[i] * 32767.0f);
+    }
+
+    return dev->write(convert_buffer, nr);
+}
+#endif
+
+/* Write `nr' samples (of all channels) to `dev', in its own format.  */
+static int sound_device_write(const sound_device_t *dev, sound_sample_t *pbuf, size_t nr)
+{
+#ifdef SOUND_SYSTEM_FLOAT
+    return sound_device_write_conv(dev, pbuf, nr, &convert_buffer, &convert_buffer_size);
+#else
+    return dev->write(pbuf, nr);
+#endif
+}
+
+static sound_sample_t *realloc_buffer(int size)
 {
     if (temp_buffer_size < size) {
         temp_buffer = lib_realloc(temp_buffer, size);
@@ -960,6 +1268,243 @@ static int16_t *realloc_buffer(int size)
     return temp_buffer;
 }
 
+#ifdef USE_SOUND_THREAD
+/* With `SoundRecordThread' set, the samples for the recording device go
+   into a ring and a recording thread hands them to the device, so the
+   encoders (MP3, FLAC, Ogg Vorbis) run next to the emulation.  The ring has
+   a single producer (the emulation thread, or the sound thread while it
+   owns the devices) and a single consumer, `head' is only written by the
+   recording thread and `tail' only by the producer, so neither side needs a
+   lock; the mutex and the conditions are only used to sleep.
+
+   Nothing is dropped: if the ring is full the producer waits for the
+   recording thread, as it would have waited for the device.  The waits are
+   counted and logged with the other figures when the recording stops.  */
+
+/* Seconds of sound the ring holds.  */
+#define SOUND_RECORD_RING_SECONDS   2
+
+static struct {
+    const sound_device_t *dev;
+    pthread_t thread;
+    int running;
+    int channels;
+
+    sound_sample_t *ring;
+    size_t size;                /* samples (of all channels), power of two */
+    atomic_size_t head;         /* next sample to write to the device */
+    atomic_size_t tail;         /* next sample to fill */
+    atomic_int failed;          /* the device returned an error */
+    int quit;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t data_cond;   /* signalled when samples were added */
+    pthread_cond_t space_cond;  /* signalled when samples were written */
+
+#ifdef SOUND_SYSTEM_FLOAT
+    int16_t *convert_buffer;    /* recording thread's 16 bit copy */
+    size_t convert_buffer_size;
+#endif
+
+    /* producer side statistics */
+    uint64_t samples;
+    unsigned long waits;
+    size_t max_fill;
+} record_thread = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .data_cond = PTHREAD_COND_INITIALIZER,
+    .space_cond = PTHREAD_COND_INITIALIZER
+};
+
+static void *sound_record_thread_main(void *arg)
+{
+    size_t head, tail, nr;
+
+    TRACEZONE_THREAD_NAME("sound record");
+
+    for (;;) {
+        head = atomic_load_explicit(&record_thread.head, memory_order_relaxed);
+        tail = atomic_load_explicit(&record_thread.tail, memory_order_acquire);
+
+        if (head == tail) {
+            pthread_mutex_lock(&record_thread.mutex);
+            while (atomic_load(&record_thread.tail) == head && !record_thread.quit) {
+                pthread_cond_wait(&record_thread.data_cond, &record_thread.mutex);
+            }
+            if (atomic_load(&record_thread.tail) == head && record_thread.quit) {
+                pthread_mutex_unlock(&record_thread.mutex);
+                break;
+            }
+            pthread_mutex_unlock(&record_thread.mutex);
+            continue;
+        }
+
+        /* up to the end of the ring, the size is a multiple of the
+           channels, so only whole frames are written */
+        nr = tail - head;
+        if (nr > record_thread.size - (head & (record_thread.size - 1))) {
+            nr = record_thread.size - (head & (record_thread.size - 1));
+        }
+
+        if (!atomic_load(&record_thread.failed)) {
+            sound_sample_t *p = record_thread.ring + (head & (record_thread.size - 1));
+            int ret;
+
+#ifdef SOUND_SYSTEM_FLOAT
+            ret = sound_device_write_conv(record_thread.dev, p, nr,
+                                          &record_thread.convert_buffer,
+                                          &record_thread.convert_buffer_size);
+#else
+            ret = record_thread.dev->write(p, nr);
+#endif
+            if (ret) {
+                atomic_store(&record_thread.failed, 1);
+            }
+        }
+
+        atomic_store(&record_thread.head, head + nr);
+
+        pthread_mutex_lock(&record_thread.mutex);
+        pthread_cond_signal(&record_thread.space_cond);
+        pthread_mutex_unlock(&record_thread.mutex);
+    }
+
+    return NULL;
+}
+
+/* Start writing to the recording device `dev' through the recording
+   thread.  Returns -1 if the samples must be written directly.  */
+static int sound_record_thread_start(const sound_device_t *dev, int channels)
+{
+    size_t size = 1;
+
+    if (!use_record_thread || !sound_device_can_write(dev)) {
+        return -1;
+    }
+
+    while (size < (size_t)sample_rate * channels * SOUND_RECORD_RING_SECONDS) {
+        size <<= 1;
+    }
+    if (size % channels) {
+        return -1;
+    }
+
+    record_thread.ring = lib_malloc(size * sizeof(sound_sample_t));
+    record_thread.size = size;
+    record_thread.channels = channels;
+    record_thread.dev = dev;
+    record_thread.quit = 0;
+    record_thread.samples = 0;
+    record_thread.waits = 0;
+    record_thread.max_fill = 0;
+    atomic_init(&record_thread.head, 0);
+    atomic_init(&record_thread.tail, 0);
+    atomic_init(&record_thread.failed, 0);
+
+    if (pthread_create(&record_thread.thread, NULL, sound_record_thread_main, NULL) != 0) {
+        log_error(sound_log, "Cannot create sound recording thread.");
+        lib_free(record_thread.ring);
+        record_thread.ring = NULL;
+        record_thread.dev = NULL;
+        return -1;
+    }
+    record_thread.running = 1;
+
+    return 0;
+}
+
+/* Let the recording thread write everything queued and stop it.  */
+static void sound_record_thread_stop(void)
+{
+    if (!record_thread.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&record_thread.mutex);
+    record_thread.quit = 1;
+    pthread_cond_signal(&record_thread.data_cond);
+    pthread_mutex_unlock(&record_thread.mutex);
+
+    pthread_join(record_thread.thread, NULL);
+    record_thread.running = 0;
+
+    log_message(sound_log, "Recording thread: %"PRIu64" samples, %lu waits for the device, ring at most %u%% full.",
+                record_thread.samples / record_thread.channels, record_thread.waits,
+                (unsigned int)(record_thread.max_fill * 100 / record_thread.size));
+
+    lib_free(record_thread.ring);
+    record_thread.ring = NULL;
+    record_thread.dev = NULL;
+#ifdef SOUND_SYSTEM_FLOAT
+    lib_free(record_thread.convert_buffer);
+    record_thread.convert_buffer = NULL;
+    record_thread.convert_buffer_size = 0;
+#endif
+}
+
+/* Queue `nr' samples (of all channels) for the recording thread, waiting
+   while the ring is full.  */
+static int sound_record_thread_write(sound_sample_t *pbuf, size_t nr)
+{
+    size_t head, tail, n, pos;
+
+    while (nr > 0) {
+        if (atomic_load(&record_thread.failed)) {
+            return -1;
+        }
+
+        tail = atomic_load_explicit(&record_thread.tail, memory_order_relaxed);
+        head = atomic_load_explicit(&record_thread.head, memory_order_acquire);
+
+        if (tail - head == record_thread.size) {
+            record_thread.waits++;
+            pthread_mutex_lock(&record_thread.mutex);
+            while (atomic_load(&record_thread.head) == head) {
+                pthread_cond_wait(&record_thread.space_cond, &record_thread.mutex);
+            }
+            pthread_mutex_unlock(&record_thread.mutex);
+            continue;
+        }
+
+        pos = tail & (record_thread.size - 1);
+        n = record_thread.size - (tail - head);
+        if (n > nr) {
+            n = nr;
+        }
+        if (n > record_thread.size - pos) {
+            n = record_thread.size - pos;
+        }
+        memcpy(record_thread.ring + pos, pbuf, n * sizeof(sound_sample_t));
+
+        atomic_store_explicit(&record_thread.tail, tail + n, memory_order_release);
+
+        pthread_mutex_lock(&record_thread.mutex);
+        pthread_cond_signal(&record_thread.data_cond);
+        pthread_mutex_unlock(&record_thread.mutex);
+
+        if (tail + n - head > record_thread.max_fill) {
+            record_thread.max_fill = tail + n - head;
+        }
+        record_thread.samples += n;
+        pbuf += n;
+        nr -= n;
+    }
+
+    return 0;
+}
+#endif
+
+/* Write `nr' samples (of all channels) to the recording device.  */
+static int sound_record_write(sound_sample_t *pbuf, size_t nr)
+{
+#ifdef USE_SOUND_THREAD
+    if (record_thread.running) {
+        return sound_record_thread_write(pbuf, nr);
+    }
+#endif
+    return sound_device_write(snddata.recdev, pbuf, nr);
+}
+
 /* Fill buffer with last sample.
  rise  < 0 : attenuation
  rise == 0 : constant value
@@ -968,10 +1513,10 @@ static int16_t *realloc_buffer(int size)
 static void fill_buffer(int size, int rise)
 {
     int c, i;
-    int16_t *p;
+    sound_sample_t *p;
     double factor;
 
-    p = realloc_buffer(size * sizeof(int16_t) * snddata.sound_output_channels);
+    p = realloc_buffer(size * sizeof(sound_sample_t) * snddata.sound_output_channels);
     if (!p) {
         return;
     }
@@ -988,11 +1533,11 @@ static void fill_buffer(int size, int rise)
                 }
             }
 
-            p[i * snddata.sound_output_channels + c] = (int16_t)(snddata.lastsample[c] * factor);
+            p[i * snddata.sound_output_channels + c] = (sound_sample_t)(snddata.lastsample[c] * factor);
         }
     }
 
-    i = snddata.playdev->write(p, size * snddata.sound_output_channels);
+    i = sound_device_write(snddata.playdev, p, size * snddata.sound_output_channels);
     if (i) {
         sound_error("write to sound device failed.");
     }
@@ -1065,14 +1610,31 @@ static void sid_close(void)
 
 sound_t *sound_get_psid(unsigned int channel)
 {
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
     return snddata.psid[channel];
 }
 
-/* open sound device */
-int sound_open(void)
+/* bytes of the output buffer and the mixing buffers, for the memory report */
+static size_t sound_usage(void)
 {
-    int c, i, j;
-    int channels_cap;
+    size_t bytes = 0;
+
+    if (snddata.buffer != NULL) {
+        bytes = (size_t)snddata.bufsize * snddata.sound_output_channels * sizeof(sound_sample_t);
+    }
+#ifdef SOUND_SYSTEM_FLOAT
+    bytes += sound_buffer_bytes;
+#endif
+    return bytes;
+}
+
+/* open sound device */
+int sound_open(void)
+{
+    int c, i, j;
+    int channels_cap;
     int channels;
     const sound_device_t *pdev, *rdev;
     char *playname, *recname;
@@ -1120,8 +1682,16 @@ int sound_open(void)
     }
 
     /* Calculate buffer size in seconds. */
-    bufsize = ((buffer_size < 1 || buffer_size > 1000)
-               ? SOUND_SAMPLE_BUFFER_SIZE : buffer_size) / 1000.0;
+    if (buffer_adaptive) {
+        if (adaptive_buffer_size <= 0) {
+            adaptive_buffer_size = (buffer_size < 1 || buffer_size > 1000)
+                                   ? SOUND_SAMPLE_BUFFER_SIZE : buffer_size;
+        }
+        bufsize = adaptive_buffer_size / 1000.0;
+    } else {
+        bufsize = ((buffer_size < 1 || buffer_size > 1000)
+                   ? SOUND_SAMPLE_BUFFER_SIZE : buffer_size) / 1000.0;
+    }
     speed = (sample_rate < 8000 || sample_rate > 96000)
             ? SOUND_SAMPLE_RATE : sample_rate;
 
@@ -1199,10 +1769,11 @@ int sound_open(void)
             free_sound_buffers();
 #endif
         }
-        snddata.buffer = lib_malloc(snddata.bufsize * snddata.sound_output_channels * sizeof(int16_t));
+        snddata.buffer = lib_malloc(snddata.bufsize * snddata.sound_output_channels * sizeof(sound_sample_t));
 #ifdef SOUND_SYSTEM_FLOAT
         malloc_sound_buffers(snddata.bufsize * snddata.sound_output_channels * sizeof(float));
 #endif
+        memusage_register("sound", sound_usage);
         snddata.issuspended = 0;
 
         for (c = 0; c < snddata.sound_output_channels; c++) {
@@ -1218,6 +1789,12 @@ int sound_open(void)
                     snddata.sound_output_channels > 1 ? ", stereo" : "");
         sample_rate = speed;
 
+        window_underruns = 0;
+        window_overruns = 0;
+        window_samples = 0;
+        stat_fill = 0;
+        stat_restart = 1;
+
         if (sid_open() != 0 || sid_init() != 0) {
             return 1;
         }
@@ -1286,6 +1863,11 @@ int sound_open(void)
             } else {
                 snddata.recdev = rdev;
                 log_message(sound_log, "Opened recording device device `%s'", rdev->name);
+#ifdef USE_SOUND_THREAD
+                if (sound_record_thread_start(rdev, channels_cap) == 0) {
+                    log_message(sound_log, "Encoding the recording on a separate thread.");
+                }
+#endif
             }
         }
     }
@@ -1295,6 +1877,11 @@ int sound_open(void)
 static void sounddev_close(const sound_device_t **dev)
 {
     if (*dev) {
+#ifdef USE_SOUND_THREAD
+        if (*dev == record_thread.dev) {
+            sound_record_thread_stop();
+        }
+#endif
         log_message(sound_log, "Closing device `%s'", (*dev)->name);
         if ((*dev)->close) {
             (*dev)->close();
@@ -1306,6 +1893,9 @@ static void sounddev_close(const sound_device_t **dev)
 /* close sid */
 void sound_close(void)
 {
+#ifdef USE_SOUND_THREAD
+    sound_thread_stop();
+#endif
     sounddev_close(&snddata.playdev);
     sounddev_close(&snddata.recdev);
     sid_close();
@@ -1327,23 +1917,84 @@ void sound_close(void)
         temp_buffer = NULL;
         temp_buffer_size = 0;
     }
+#ifdef SOUND_SYSTEM_FLOAT
+    if (convert_buffer) {
+        lib_free(convert_buffer);
+        convert_buffer = NULL;
+        convert_buffer_size = 0;
+    }
+#endif
 
     /* Closing the sound device might take some time, and displaying
        UI dialogs certainly does. */
     vsync_suspend_speed_eval();
 }
 
-/* run sid */
-static int sound_run_sound(void)
+/* Render the cycle based engines for `delta_t' cycles to `bufferptr'.  */
+static int sound_calculate_cycle_based(sound_sample_t *bufferptr, CLOCK delta_t)
 {
 #if 1
     static int overflow_warning_count = 0;
 #endif
+    int nr;
+
+    nr = sound_machine_calculate_samples(snddata.psid,
+                                         bufferptr,
+                                         snddata.bufsize - snddata.bufptr,
+                                         snddata.sound_output_channels,
+                                         snddata.sound_chip_channels,
+                                         &delta_t);
+    if (delta_t && !archdep_is_exiting()) {
+#if 0
+        sound_error_log_only("Sound buffer overflow (cycle based)");
+        return -1;
+#else
+        if (overflow_warning_count < 25) {
+            log_warning(sound_log, "%s", "Sound buffer overflow (cycle based)");
+            overflow_warning_count++;
+        } else {
+            if (overflow_warning_count == 25) {
+                log_warning(sound_log, "Buffer overflow warning repeated 25 times, will now be ignored");
+                overflow_warning_count++;
+            }
+        }
+#endif
+    }
+    return nr;
+}
+
+static void sound_apply_volume(sound_sample_t *bufferptr, int nr)
+{
+    int i;
+
+    if (amp < 4096) {
+        if (amp) {
+            for (i = 0; i < (nr * snddata.sound_output_channels); i++) {
+                bufferptr[i] = bufferptr[i] * amp / 4096;
+            }
+        } else {
+            memset(bufferptr, 0, nr * snddata.sound_output_channels * sizeof(sound_sample_t));
+        }
+    }
+}
+
+/* In warp mode with `SoundWarpSkip' set nothing is played or recorded, so
+   the chips are only advanced to the current clock on each run, without
+   sampling.  Runs happen before every read and store, so what the
+   registers read back is the same; a last run when warp ends brings the
+   chips up to date before the sound is rendered again.  */
+static int sound_skip_active(void)
+{
+    return warp_skip && warp_mode_enabled && snddata.recdev == NULL && cycle_based;
+}
 
+/* run sid */
+static int sound_do_run_sound(void)
+{
     int nr = 0;
     int i;
     CLOCK delta_t = 0;
-    int16_t *bufferptr;
+    sound_sample_t *bufferptr;
 
     if (!playback_enabled) {
         return 1;
@@ -1356,32 +2007,17 @@ static int sound_run_sound(void)
         }
     }
 
+    bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+
+    if (sound_skip_active()
+        && sound_machine_skip(snddata.psid, snddata.sound_chip_channels, maincpu_clk - snddata.lastclk) == 0) {
+        snddata.lastclk = maincpu_clk;
+        return 0;
+    }
+
     /* Handling of cycle based sound engines. */
     if (cycle_based) {
-        delta_t = maincpu_clk - snddata.lastclk;
-        bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
-        nr = sound_machine_calculate_samples(snddata.psid,
-                                             bufferptr,
-                                             snddata.bufsize - snddata.bufptr,
-                                             snddata.sound_output_channels,
-                                             snddata.sound_chip_channels,
-                                             &delta_t);
-        if (delta_t && !archdep_is_exiting()) {
-#if 0
-            sound_error_log_only("Sound buffer overflow (cycle based)");
-            return -1;
-#else
-            if (overflow_warning_count < 25) {
-                log_warning(sound_log, "%s", "Sound buffer overflow (cycle based)");
-                overflow_warning_count++;
-            } else {
-                if (overflow_warning_count == 25) {
-                    log_warning(sound_log, "Buffer overflow warning repeated 25 times, will now be ignored");
-                    overflow_warning_count++;
-                }
-            }
-#endif
-        }
+        nr = sound_calculate_cycle_based(bufferptr, maincpu_clk - snddata.lastclk);
      } else {
          /* Handling of sample based sound engines. */
          nr = (int)((SOUNDCLK_CONSTANT(maincpu_clk) - snddata.fclk)
@@ -1392,7 +2028,6 @@ static int sound_run_sound(void)
          if (nr > snddata.bufsize - snddata.bufptr) {
              nr = snddata.bufsize - snddata.bufptr;
          }
-         bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
          sound_machine_calculate_samples(snddata.psid,
                                          bufferptr,
                                          nr,
@@ -1402,15 +2037,7 @@ static int sound_run_sound(void)
          snddata.fclk += nr * snddata.clkstep;
      }
 
-     if (amp < 4096) {
-         if (amp) {
-             for (i = 0; i < (nr * snddata.sound_output_channels); i++) {
-                 bufferptr[i] = bufferptr[i] * amp / 4096;
-             }
-         } else {
-             memset(bufferptr, 0, nr * snddata.sound_output_channels * sizeof(int16_t));
-         }
-     }
+    sound_apply_volume(bufferptr, nr);
 
     snddata.bufptr += nr;
     snddata.lastclk = maincpu_clk;
@@ -1418,11 +2045,29 @@ static int sound_run_sound(void)
     return 0;
 }
 
+static int sound_run_sound(void)
+{
+    int hosttime_previous;
+    int ret;
+
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
+    hosttime_previous = HOSTTIME_ENTER(HOSTTIME_SOUND);
+    ret = sound_do_run_sound();
+
+    HOSTTIME_LEAVE(hosttime_previous);
+    return ret;
+}
+
 /* reset sid */
 void sound_reset(void)
 {
     int c;
 
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
     snddata.fclk = SOUNDCLK_CONSTANT(maincpu_clk);
     snddata.wclk = maincpu_clk;
     snddata.lastclk = maincpu_clk;
@@ -1434,10 +2079,367 @@ void sound_reset(void)
     }
 }
 
+/* Write the whole fragments in the buffer to the device, blocking until at
+   least one fragment is written.  `vice_thread' is zero when called by the
+   sound thread, which must not touch the mainlock.  */
+static int sound_write_fragments(int vice_thread)
+{
+    int c, i, nr, space, first;
+
+    /* Calculate the number of samples to flush - whole fragments. */
+    nr = snddata.bufptr - snddata.bufptr % snddata.fragsize;
+    if (!nr) {
+        return 0;
+    }
+
+    /* In warp mode nothing is played, but a recording gets everything.  */
+    if (warp_mode_enabled && snddata.recdev) {
+        if (sound_record_write(snddata.buffer, nr * snddata.sound_output_channels)) {
+            return -1;
+        }
+    }
+
+    /*
+     * At this point we have to block until we have written at least one fragment.
+     *
+     * The 'push against the audio device' sync method depends on this.
+     */
+
+    for (first = 1; !warp_mode_enabled; first = 0) {
+
+        if (snddata.playdev->bufferspace) {
+            space = snddata.playdev->bufferspace();
+            if (first && !stat_restart) {
+                /* The device played everything it had: the gap was heard.
+                   Without room for a fragment the emulation is ahead of
+                   the device.  */
+                if (space >= snddata.bufsize) {
+                    stat_underruns++;
+                    window_underruns++;
+                } else if (space < snddata.fragsize) {
+                    stat_overruns++;
+                    window_overruns++;
+                }
+            }
+            stat_fill = snddata.bufsize - space;
+        } else {
+            /* We are using a blocking driver like simple pulse - write everything we have. */
+            space = nr;
+        }
+
+        space -= space % snddata.fragsize;
+
+        if (space) {
+            if (nr > space) {
+                /* Write as much as we can */
+                nr = space;
+            }
+
+            if (vice_thread) {
+                mainlock_yield_begin();
+            }
+
+            /* Flush buffer, all channels are already mixed into it. */
+            if (sound_device_write(snddata.playdev, snddata.buffer, nr * snddata.sound_output_channels)) {
+                if (vice_thread) {
+                    mainlock_yield_end();
+                }
+                return -1;
+            }
+
+            if (snddata.recdev) {
+                if (sound_record_write(snddata.buffer, nr * snddata.sound_output_channels)) {
+                    if (vice_thread) {
+                        mainlock_yield_end();
+                    }
+                    return -1;
+                }
+            }
+
+            /* Successful write to audio device, exit loop. */
+            if (vice_thread) {
+                mainlock_yield_end();
+            }
+            stat_fill += nr;
+            window_samples += nr;
+            stat_restart = 0;
+            break;
+        }
+
+        /* We can't write yet, try again after a minimal sleep. */
+        if (vice_thread) {
+            mainlock_yield_and_sleep(tick_per_second() / 1000);
+        } else {
+            tick_sleep(tick_per_second() / 1000);
+        }
+    }
+
+    snddata.bufptr -= nr;
+
+    /*
+     * Move any incomplete fragments back to the start of the sample buffer
+     */
+
+    for (c = 0; c < snddata.sound_output_channels; c++) {
+        snddata.lastsample[c] = snddata.buffer[(nr - 1) * snddata.sound_output_channels + c];
+        for (i = 0; i < snddata.bufptr; i++) {
+            snddata.buffer[i * snddata.sound_output_channels + c] =
+                snddata.buffer[(i + nr) * snddata.sound_output_channels + c];
+        }
+    }
+
+    return 0;
+}
+
+#ifdef USE_SOUND_THREAD
+/* With `SoundThread' set, sound_flush() hands the block since the last
+   flush over to the sound thread, which renders, mixes and plays it while
+   the emulation goes on with the next frame.  The SID stores of the frame
+   are queued with their clock (see sid/sidqueue.c), so the sound thread
+   owns the engines, the sample buffer and the devices until the block is
+   done; everything else on the emulation side that touches them first
+   waits for it with sound_thread_wait().  The device still paces the
+   emulation, one frame later: the next sound_flush() waits until the
+   previous block was written.  The sound thread never takes the mainlock.
+
+   Anything the sound thread cannot do on its own (opening or closing
+   devices, dump and flush devices, recording without the recording thread,
+   warp, run-ahead, other sound chips than the first) makes sound_flush()
+   do the block itself as before.  */
+
+static pthread_t sound_thread_id;
+static int sound_thread_running = 0;
+
+/* set on the emulation side between handing a block over and waiting for
+   it */
+static int sound_thread_pending = 0;
+
+/* set if the sound thread could not write to the device */
+static int sound_thread_failed = 0;
+
+/* cycles of the handed over block */
+static CLOCK sound_thread_delta_t;
+
+/* Protect the fields below.  */
+static pthread_mutex_t sound_thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sound_thread_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t sound_thread_done_cond = PTHREAD_COND_INITIALIZER;
+static int sound_thread_start = 0;
+static int sound_thread_done = 0;
+static int sound_thread_quit = 0;
+
+static void sound_thread_play_block(void)
+{
+    sound_sample_t *bufferptr;
+    int nr;
+
+    bufferptr = snddata.buffer + snddata.bufptr * snddata.sound_output_channels;
+    nr = sound_calculate_cycle_based(bufferptr, sound_thread_delta_t);
+    sound_apply_volume(bufferptr, nr);
+    snddata.bufptr += nr;
+
+    if (sound_write_fragments(0) < 0) {
+        sound_thread_failed = 1;
+    }
+}
+
+static void *sound_thread_main(void *arg)
+{
+    TRACEZONE_THREAD_NAME("sound");
+
+    pthread_mutex_lock(&sound_thread_mutex);
+    for (;;) {
+        while (!sound_thread_start && !sound_thread_quit) {
+            pthread_cond_wait(&sound_thread_start_cond, &sound_thread_mutex);
+        }
+        if (sound_thread_quit) {
+            break;
+        }
+        sound_thread_start = 0;
+        pthread_mutex_unlock(&sound_thread_mutex);
+
+        TRACEZONE_BEGIN(TRACEZONE_SOUND);
+        sound_thread_play_block();
+        TRACEZONE_END(TRACEZONE_SOUND);
+
+        pthread_mutex_lock(&sound_thread_mutex);
+        sound_thread_done = 1;
+        pthread_cond_signal(&sound_thread_done_cond);
+    }
+    pthread_mutex_unlock(&sound_thread_mutex);
+
+    return NULL;
+}
+
+/* Wait until the sound thread is done with the block handed over.  */
+static void sound_thread_wait(void)
+{
+    if (!sound_thread_pending) {
+        return;
+    }
+
+    pthread_mutex_lock(&sound_thread_mutex);
+    while (!sound_thread_done) {
+        pthread_cond_wait(&sound_thread_done_cond, &sound_thread_mutex);
+    }
+    sound_thread_done = 0;
+    pthread_mutex_unlock(&sound_thread_mutex);
+
+    sound_thread_pending = 0;
+    sid_queue_handoff_end();
+}
+
+static void sound_thread_stop(void)
+{
+    if (!sound_thread_running) {
+        return;
+    }
+
+    sound_thread_wait();
+
+    pthread_mutex_lock(&sound_thread_mutex);
+    sound_thread_quit = 1;
+    pthread_cond_signal(&sound_thread_start_cond);
+    pthread_mutex_unlock(&sound_thread_mutex);
+
+    pthread_join(sound_thread_id, NULL);
+    sound_thread_running = 0;
+    sound_thread_quit = 0;
+}
+
+/* Hand the block up to the current clock over to the sound thread, if it
+   can play it on its own.  Returns -1 if the caller must do it.  */
+static int sound_thread_hand_over(void)
+{
+    int i;
+
+    if (!use_sound_thread
+        || !sdev_open
+        || snddata.playdev == NULL
+        || !sound_device_can_write(snddata.playdev)
+        || snddata.playdev->dump != NULL
+        || snddata.playdev->flush != NULL
+        || (snddata.recdev != NULL && !record_thread.running)
+        || snddata.issuspended
+        || !cycle_based
+        || sid_state_changed
+        || warp_mode_enabled
+        || runahead_bufptr >= 0) {
+        return -1;
+    }
+    for (i = 1; i < (offset >> 5); i++) {
+        if (sound_calls[i]->chip_enabled) {
+            return -1;
+        }
+    }
+
+    if (!sound_thread_running) {
+        if (pthread_create(&sound_thread_id, NULL, sound_thread_main, NULL) != 0) {
+            log_error(sound_log, "Cannot create sound thread.");
+            use_sound_thread = 0;
+            return -1;
+        }
+        sound_thread_running = 1;
+    }
+
+    sound_thread_delta_t = maincpu_clk - snddata.lastclk;
+    snddata.lastclk = maincpu_clk;
+    sid_queue_handoff_begin();
+    sound_thread_pending = 1;
+
+    pthread_mutex_lock(&sound_thread_mutex);
+    sound_thread_start = 1;
+    pthread_cond_signal(&sound_thread_start_cond);
+    pthread_mutex_unlock(&sound_thread_mutex);
+
+    return 0;
+}
+
+int sound_thread_enabled(void)
+{
+    return use_sound_thread;
+}
+#endif
+
 /* flush all generated samples from buffer to sounddevice. */
+/* Decide on a new device buffer size from the statistics of the last
+   window, in adaptive mode.  Growing needs a single underrun; shrinking
+   needs a number of windows without underruns in which the device was
+   full at times, as otherwise the emulation only just keeps up.  */
+static void sound_adapt_buffer(void)
+{
+    int size = adaptive_buffer_size;
+
+    if (!buffer_adaptive
+        || !sdev_open
+        || snddata.playdev == NULL
+        || snddata.playdev->bufferspace == NULL
+        || snddata.issuspended
+        || window_samples < sample_rate * SOUND_ADAPT_WINDOW) {
+        return;
+    }
+
+    if (window_underruns > 0) {
+        size += size / 2;
+        if (size > SOUND_SAMPLE_MAX_BUFFER_SIZE) {
+            size = SOUND_SAMPLE_MAX_BUFFER_SIZE;
+        }
+        adapt_quiet_windows = 0;
+        adapt_shrink_windows *= 2;
+        if (adapt_shrink_windows > SOUND_ADAPT_SHRINK_WINDOWS_MAX) {
+            adapt_shrink_windows = SOUND_ADAPT_SHRINK_WINDOWS_MAX;
+        }
+    } else if (window_overruns > 0
+               && ++adapt_quiet_windows >= adapt_shrink_windows) {
+        size -= size / 4;
+        if (size < SOUND_ADAPT_MIN_BUFFER_SIZE) {
+            size = SOUND_ADAPT_MIN_BUFFER_SIZE;
+        }
+        adapt_quiet_windows = 0;
+    }
+
+    window_underruns = 0;
+    window_overruns = 0;
+    window_samples = 0;
+
+    if (size != adaptive_buffer_size) {
+        log_message(sound_log, "Adaptive buffer: %s buffer from %dms to %dms.",
+                    size > adaptive_buffer_size ? "growing" : "shrinking",
+                    adaptive_buffer_size, size);
+        adaptive_buffer_size = size;
+        sound_playdev_reopen = TRUE;
+    }
+}
+
+/* Fill in the current device statistics.  */
+void sound_get_status(sound_status_t *status)
+{
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
+    memset(status, 0, sizeof(*status));
+
+    status->adaptive = buffer_adaptive;
+    status->underruns = stat_underruns;
+    status->overruns = stat_overruns;
+
+    if (!sdev_open || snddata.playdev == NULL || sample_rate <= 0) {
+        return;
+    }
+    status->open = 1;
+    status->sample_rate = sample_rate;
+    status->buffer_usec = (unsigned int)((double)snddata.bufsize * 1000000.0 / sample_rate);
+    if (snddata.playdev->bufferspace != NULL) {
+        int fill = stat_fill < 0 ? 0 : (stat_fill > snddata.bufsize ? snddata.bufsize : stat_fill);
+
+        status->latency_usec = (unsigned int)((double)fill * 1000000.0 / sample_rate);
+        status->fill_percent = fill * 100 / snddata.bufsize;
+    }
+}
+
 bool sound_flush(void)
 {
-    int c, i, nr, space;
+    int i;
     char *state;
 
     /*
@@ -1458,6 +2460,16 @@ bool sound_flush(void)
     }
 #endif
 
+#ifdef USE_SOUND_THREAD
+    /* the previous block must be played before anything can change */
+    sound_thread_wait();
+    if (sound_thread_failed) {
+        sound_thread_failed = 0;
+        sound_error("write to sound device failed.");
+        goto done;
+    }
+#endif
+
     if (!playback_enabled) {
         if (sdev_open) {
             sound_close();
@@ -1465,6 +2477,8 @@ bool sound_flush(void)
         goto done;
     }
 
+    sound_adapt_buffer();
+
     if (sound_state_changed) {
         if (sdev_open) {
             sound_close();
@@ -1479,6 +2493,12 @@ bool sound_flush(void)
         sound_playdev_reopen = FALSE;
     }
 
+#ifdef USE_SOUND_THREAD
+    if (sound_thread_hand_over() == 0) {
+        goto done;
+    }
+#endif
+
     if (sound_run_sound()) {
         goto done;
     }
@@ -1494,6 +2514,10 @@ bool sound_flush(void)
         snddata.bufptr = 0;
         goto done;
     }
+    if (runahead_bufptr >= 0) {
+        snddata.bufptr = runahead_bufptr;
+        goto done;
+    }
     sound_resume();
 
     if (snddata.playdev->flush) {
@@ -1506,77 +2530,11 @@ bool sound_flush(void)
         }
     }
 
-    /* Calculate the number of samples to flush - whole fragments. */
-    nr = snddata.bufptr - snddata.bufptr % snddata.fragsize;
-    if (!nr) {
+    if (sound_write_fragments(1) < 0) {
+        sound_error("write to sound device failed.");
         goto done;
     }
 
-    /*
-     * At this point we have to block until we have written at least one fragment.
-     *
-     * The 'push against the audio device' sync method depends on this.
-     */
-
-    while (!warp_mode_enabled) {
-
-        if (snddata.playdev->bufferspace) {
-            space = snddata.playdev->bufferspace();
-        } else {
-            /* We are using a blocking driver like simple pulse - write everything we have. */
-            space = nr;
-        }
-
-        space -= space % snddata.fragsize;
-
-        if (space) {
-            if (nr > space) {
-                /* Write as much as we can */
-                nr = space;
-            }
-
-            mainlock_yield_begin();
-
-            /* Flush buffer, all channels are already mixed into it. */
-            if (snddata.playdev->write(snddata.buffer, nr * snddata.sound_output_channels)) {
-                sound_error("write to sound device failed.");
-
-                mainlock_yield_end();
-                goto done;
-            }
-
-            if (snddata.recdev) {
-                if (snddata.recdev->write(snddata.buffer, nr * snddata.sound_output_channels)) {
-                    sound_error("write to sound device failed.");
-
-                    mainlock_yield_end();
-                    goto done;
-                }
-            }
-
-            /* Successful write to audio device, exit loop. */
-            mainlock_yield_end();
-            break;
-        }
-
-        /* We can't write yet, try again after a minimal sleep. */
-        mainlock_yield_and_sleep(tick_per_second() / 1000);
-    }
-
-    snddata.bufptr -= nr;
-
-    /*
-     * Move any incomplete fragments back to the start of the sample buffer
-     */
-
-    for (c = 0; c < snddata.sound_output_channels; c++) {
-        snddata.lastsample[c] = snddata.buffer[(nr - 1) * snddata.sound_output_channels + c];
-        for (i = 0; i < snddata.bufptr; i++) {
-            snddata.buffer[i * snddata.sound_output_channels + c] =
-                snddata.buffer[(i + nr) * snddata.sound_output_channels + c];
-        }
-    }
-
 done:
 
     /*
@@ -1590,11 +2548,14 @@ done:
 /* suspend sid (eg. before pause) */
 void sound_suspend(void)
 {
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
     if (!snddata.playdev) {
         return;
     }
 
-    if (snddata.playdev->write && !snddata.issuspended
+    if (sound_device_can_write(snddata.playdev) && !snddata.issuspended
         && snddata.playdev->need_attenuation) {
         /* fill buffer, but avoid overwriting */
         if (!snddata.playdev->bufferspace
@@ -1620,18 +2581,22 @@ void sound_suspend(void)
 /* resume sid */
 void sound_resume(void)
 {
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
     if (!snddata.playdev) {
         return;
     }
 
     if (snddata.issuspended) {
+        stat_restart = 1;
         if (snddata.playdev->resume) {
             snddata.issuspended = snddata.playdev->resume();
         } else {
             snddata.issuspended = 0;
         }
 
-        if (snddata.playdev->write && !snddata.issuspended
+        if (sound_device_can_write(snddata.playdev) && !snddata.issuspended
             && snddata.playdev->need_attenuation) {
             fill_buffer(snddata.fragsize, 1);
         }
@@ -1688,6 +2653,9 @@ long sound_sample_position(void)
 
 int sound_dump(int chipno)
 {
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
     if (chipno >= snddata.sound_chip_channels) {
         return -1;
     }
@@ -1708,6 +2676,20 @@ int sound_read(uint16_t addr, int chipno)
     return sound_machine_read(snddata.psid[chipno], addr);
 }
 
+/* A store to SID `chipno' may be written by the chip's engine at its clock
+   during the next sound_run_sound() instead of right away, if nothing
+   needs to see it before: the sound device is open, does not dump the
+   stores, and the chips are rendered cycle based.  */
+int sound_can_buffer_store(int chipno)
+{
+    return playback_enabled
+           && snddata.playdev != NULL
+           && snddata.playdev->dump == NULL
+           && cycle_based
+           && !sound_skip_active()
+           && chipno < snddata.sound_chip_channels;
+}
+
 void sound_store(uint16_t addr, uint8_t val, int chipno)
 {
     int i;
@@ -1758,6 +2740,11 @@ void sound_set_relative_speed(int value)
 
 void sound_set_warp_mode(int value)
 {
+    /* bring the chips up to date in the old mode */
+    if (snddata.playdev != NULL) {
+        sound_run_sound();
+    }
+
     warp_mode_enabled = value;
 
     if (value) {
@@ -1767,6 +2754,34 @@ void sound_set_warp_mode(int value)
     }
 }
 
+void sound_runahead_begin(void)
+{
+    sound_run_sound();
+
+    runahead_bufptr = snddata.bufptr;
+    runahead_fclk = snddata.fclk;
+    runahead_wclk = snddata.wclk;
+    runahead_lastclk = snddata.lastclk;
+}
+
+void sound_runahead_end(int rollback)
+{
+    if (runahead_bufptr < 0) {
+        return;
+    }
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
+
+    if (rollback) {
+        snddata.bufptr = runahead_bufptr;
+        snddata.fclk = runahead_fclk;
+        snddata.wclk = runahead_wclk;
+        snddata.lastclk = runahead_lastclk;
+    }
+    runahead_bufptr = -1;
+}
+
 void sound_snapshot_prepare(void)
 {
     /* Update lastclk.  */
@@ -1775,6 +2790,9 @@ void sound_snapshot_prepare(void)
 
 void sound_snapshot_finish(void)
 {
+#ifdef USE_SOUND_THREAD
+    sound_thread_wait();
+#endif
     snddata.lastclk = maincpu_clk;
 }
 
@@ -1784,62 +2802,130 @@ void sound_dac_init(sound_dac_t *dac, int speed)
     dac->alpha = (float)(0.0318309886 / (0.0318309886 + 1.0 / (float)speed));
     dac->value = 0;
     dac->output = 0.0;
+    dac->queued = 0;
+}
+
+/* Sample playback writes the DAC thousands of times per frame; rendering
+   up to every store would run all the chips in tiny pieces.  While the
+   stores need nobody to see them before the next run, they are queued
+   with their clock instead and placed at their sample when the block is
+   calculated.  */
+int sound_dac_store(sound_dac_t *dac, int value)
+{
+    if (!playback_enabled
+        || snddata.playdev == NULL
+        || snddata.playdev->dump != NULL
+        || sound_skip_active()
+#ifdef USE_SOUND_THREAD
+        || sound_thread_pending
+#endif
+        || dac->queued >= SOUND_DAC_QUEUE_SIZE) {
+        return -1;
+    }
+
+    dac->queue_clk[dac->queued] = maincpu_clk;
+    dac->queue_value[dac->queued] = value;
+    dac->queued++;
+
+    return 0;
+}
+
+void sound_dac_discard(sound_dac_t *dac)
+{
+    dac->queued = 0;
+}
+
+/* Sample of the `nr' calculated since the last run that queued store `i'
+   of `dac' falls on.  */
+static int sound_dac_queue_sample(sound_dac_t *dac, int i, int nr)
+{
+    CLOCK cycles = maincpu_clk - snddata.lastclk;
+    CLOCK clk = dac->queue_clk[i];
+    int sample;
+
+    if (clk <= snddata.lastclk || cycles == 0) {
+        return 0;
+    }
+    sample = (int)(((clk - snddata.lastclk) * (CLOCK)nr) / cycles);
+
+    return (sample < nr) ? sample : nr - 1;
 }
 
 /* FIXME: this should use bandlimited step synthesis. Sadly, VICE does not
  * have an easy-to-use infrastructure for blep generation. We should write
  * this code. */
 #ifdef SOUND_SYSTEM_FLOAT
-/* FIXME */
-int sound_dac_calculate_samples(sound_dac_t *dac, float *pbuf, int value, int nr)
+/* Calculate samples `from' up to `to' while the DAC holds `value'.  */
+static void sound_dac_run(sound_dac_t *dac, float *pbuf, int value, int from, int to)
 {
     int i;
-    int off = 0;
-    float sample;
 
     /* A simple high pass digital filter is employed here to get rid of the DC offset,
        which would cause distortion when mixed with other signal. This filter is formed
        on the actual hardware by the combination of output decoupling capacitor and load
        resistance.
     */
-    if (nr) {
+    if (from < to) {
         dac->output = dac->alpha * (dac->output + (float)(value - dac->value));
         dac->value = value;
 
         if (!(int)dac->output) {
-            return nr;
+            return;
         }
 
-        sample = (int)dac->output / 32767.0;
-
-        pbuf[off] = sample;
-        off ++;
+        pbuf[from] = (int)dac->output / 32767.0;
     }
 
-    for (i = 1; i < nr; i++) {
+    for (i = from + 1; i < to; i++) {
         dac->output *= dac->alpha;
-        sample = (int)dac->output / 32767.0;
-        pbuf[off] = sample;
-        off ++;
+        pbuf[i] = (int)dac->output / 32767.0;
+    }
+}
+
+int sound_dac_calculate_samples(sound_dac_t *dac, float *pbuf, int value, int nr)
+{
+    int i = 0;
+    int k = 0;
+    int next;
+    int run_value = dac->queued ? dac->value : value;
+
+    while (i < nr) {
+        /* the samples up to the next queued store hold the same value */
+        next = nr;
+        while (k < dac->queued) {
+            int sample = sound_dac_queue_sample(dac, k, nr);
+
+            if (sample > i) {
+                next = sample;
+                break;
+            }
+            run_value = dac->queue_value[k++];
+        }
+        sound_dac_run(dac, pbuf, run_value, i, next);
+        i = next;
+    }
+    if (nr) {
+        dac->queued = 0;
     }
     return nr;
 }
 #else
-int sound_dac_calculate_samples(sound_dac_t *dac, int16_t *pbuf, int value, int nr, int soc, int cs)
+/* Mix samples `from' up to `to' while the DAC holds `value'.  */
+static void sound_dac_run(sound_dac_t *dac, int16_t *pbuf, int value, int from, int to, int soc, int cs)
 {
     int i, sample;
-    int off = 0;
+    int off = from * soc;
     /* A simple high pass digital filter is employed here to get rid of the DC offset,
        which would cause distortion when mixed with other signal. This filter is formed
        on the actual hardware by the combination of output decoupling capacitor and load
        resistance.
     */
-    if (nr) {
+    if (from < to) {
         dac->output = dac->alpha * (dac->output + (float)(value - dac->value));
         dac->value = value;
         sample = (int)dac->output;
         if (!sample) {
-            return nr;
+            return;
         }
         if (cs == SOUND_CHANNEL_1 || cs == SOUND_CHANNELS_1_AND_2) {
             pbuf[off] = sound_audio_mix(pbuf[off], sample);
@@ -1850,7 +2936,7 @@ int sound_dac_calculate_samples(sound_dac_t *dac, int16_t *pbuf, int value, int
         off += soc;
     }
 
-    for (i = 1; i < nr; i++) {
+    for (i = from + 1; i < to; i++) {
         dac->output *= dac->alpha;
         sample = (int)dac->output;
         if (cs == SOUND_CHANNEL_1 || cs == SOUND_CHANNELS_1_AND_2) {
@@ -1861,6 +2947,33 @@ int sound_dac_calculate_samples(sound_dac_t *dac, int16_t *pbuf, int value, int
         }
         off += soc;
     }
+}
+
+int sound_dac_calculate_samples(sound_dac_t *dac, int16_t *pbuf, int value, int nr, int soc, int cs)
+{
+    int i = 0;
+    int k = 0;
+    int next;
+    int run_value = dac->queued ? dac->value : value;
+
+    while (i < nr) {
+        /* the samples up to the next queued store hold the same value */
+        next = nr;
+        while (k < dac->queued) {
+            int sample = sound_dac_queue_sample(dac, k, nr);
+
+            if (sample > i) {
+                next = sample;
+                break;
+            }
+            run_value = dac->queue_value[k++];
+        }
+        sound_dac_run(dac, pbuf, run_value, i, next, soc, cs);
+        i = next;
+    }
+    if (nr) {
+        dac->queued = 0;
+    }
     return nr;
 }
 #endif
@@ -206,6 +206,10 @@ typedef struct sound_device_s {
     int max_channels;
     /* Can this device be relied on as the emulator timing source */
     bool is_timing_source;
+    /* send number of float samples (-1.0 .. 1.0) to the soundcard, used
+       instead of write() by the float based sound system. Devices without
+       it get the mix converted to 16 bit */
+    int (*write_float)(float *pbuf, size_t nr);
 } sound_device_t;
 
 typedef struct sound_register_devices_s {
@@ -246,6 +250,20 @@ static inline int16_t sound_audio_mix(int ch1, int ch2)
 
 sound_desc_t *sound_get_valid_devices(int type, int sort);
 
+/* Playback device statistics, see sound_get_status().  */
+typedef struct sound_status_s {
+    int open;                   /* a playback device is open */
+    int adaptive;               /* `SoundBufferAdaptive' is set */
+    int sample_rate;            /* sample rate of the device */
+    unsigned int buffer_usec;   /* size of the device buffer */
+    unsigned int latency_usec;  /* sound in the device after the last write */
+    int fill_percent;           /* `latency_usec' relative to `buffer_usec' */
+    unsigned int underruns;     /* times the device ran dry */
+    unsigned int overruns;      /* times the device had no room for a fragment */
+} sound_status_t;
+
+void sound_get_status(sound_status_t *status);
+
 /* external functions for vice */
 void sound_init(unsigned int clock_rate, unsigned int ticks_per_frame);
 void sound_reset(void);
@@ -260,6 +278,12 @@ void sound_set_machine_parameter(long clock_rate, long ticks_per_frame);
 void sound_snapshot_prepare(void);
 void sound_snapshot_finish(void);
 
+/* Discard the samples generated from now on, until sound_runahead_end().
+   With `rollback' the machine was restored to the state it had when
+   sound_runahead_begin() was called.  */
+void sound_runahead_begin(void);
+void sound_runahead_end(int rollback);
+
 int sound_resources_init(void);
 void sound_resources_shutdown(void);
 int sound_cmdline_options_init(void);
@@ -293,6 +317,10 @@ int sound_register_device(const sound_device_t *pdevice);
 /* other internal functions used around sound -code */
 int sound_read(uint16_t addr, int chipno);
 void sound_store(uint16_t addr, uint8_t val, int chipno);
+int sound_can_buffer_store(int chipno);
+#ifdef USE_SOUND_THREAD
+int sound_thread_enabled(void);
+#endif
 long sound_sample_position(void);
 int sound_dump(int chipno);
 
@@ -362,18 +390,38 @@ typedef struct sound_chip_s {
     /* sound chip enabled flag */
     int chip_enabled;
 
+    /* sound chip skip function, advances the chip without rendering samples
+       and returns -1 if it cannot; NULL if it never can */
+    int (*skip)(sound_t **psid, int sound_chip_channels, CLOCK delta_t);
+
 } sound_chip_t;
 
 uint16_t sound_chip_register(sound_chip_t *chip);
 
+/* stores queued per DAC between two runs of the sound engine */
+#define SOUND_DAC_QUEUE_SIZE 1024
+
 typedef struct sound_dac_s {
     float output;
     float alpha;
     int value;
+
+    /* stores queued by sound_dac_store() with their clock */
+    int queued;
+    CLOCK queue_clk[SOUND_DAC_QUEUE_SIZE];
+    int queue_value[SOUND_DAC_QUEUE_SIZE];
 } sound_dac_t;
 
 void sound_dac_init(sound_dac_t *dac, int speed);
 
+/* Queue a store of `value' to `dac' at the current clock, to be written at
+   its sample while the block is calculated.  Returns -1 if the store must
+   go through sound_store() right away.  */
+int sound_dac_store(sound_dac_t *dac, int value);
+
+/* Drop the queued stores, after the device was reset.  */
+void sound_dac_discard(sound_dac_t *dac);
+
 #ifdef SOUND_SYSTEM_FLOAT
 int sound_dac_calculate_samples(sound_dac_t *dac, float *pbuf, int value, int nr);
 #else
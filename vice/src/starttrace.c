@@ -0,0 +1,115 @@
+/*
+ * starttrace.c - Log a timeline of the emulator startup.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The startup code calls starttrace_mark() at the end of each phase.  The
+   marks are kept in a small table, since most of them happen before the
+   command line is parsed and the log is opened, and are logged when the
+   first frame has been emulated, each with the time since the first mark
+   and the time spent in the phase.  */
+
+#include "vice.h"
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "log.h"
+#include "starttrace.h"
+
+#define STARTTRACE_MAX  64
+
+typedef struct starttrace_mark_s {
+    const char *name;
+    tick_t tick;
+} starttrace_mark_t;
+
+static starttrace_mark_t marks[STARTTRACE_MAX];
+static int num_marks = 0;
+
+static int starttrace_enabled = 0;
+static int starttrace_done = 0;
+
+void starttrace_mark(const char *name)
+{
+    if (starttrace_done || num_marks == STARTTRACE_MAX) {
+        return;
+    }
+    marks[num_marks].name = name;
+    marks[num_marks].tick = tick_now();
+    num_marks++;
+}
+
+static void starttrace_report(void)
+{
+    log_t starttrace_log;
+    int i;
+
+    if (num_marks == 0) {
+        return;
+    }
+
+    starttrace_log = log_open("StartTrace");
+
+    log_message(starttrace_log, "    total      phase");
+    for (i = 0; i < num_marks; i++) {
+        tick_t total = marks[i].tick - marks[0].tick;
+        tick_t phase = i > 0 ? marks[i].tick - marks[i - 1].tick : 0;
+
+        log_message(starttrace_log, "%9.3f %10.3f ms  %s",
+                    (double)TICK_TO_MICRO(total) / 1000.0,
+                    (double)TICK_TO_MICRO(phase) / 1000.0,
+                    marks[i].name);
+    }
+}
+
+void starttrace_frame(void)
+{
+    if (starttrace_done) {
+        return;
+    }
+    starttrace_mark("first frame");
+    starttrace_done = 1;
+
+    if (starttrace_enabled) {
+        starttrace_report();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_starttrace(const char *param, void *extra_param)
+{
+    starttrace_enabled = 1;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-starttrace", CALL_FUNCTION, CMDLINE_ATTRIB_NONE,
+      cmdline_starttrace, NULL, NULL, NULL,
+      NULL, "Log how long each startup phase took once the first frame has been emulated" },
+    CMDLINE_LIST_END
+};
+
+int starttrace_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
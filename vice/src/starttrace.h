@@ -0,0 +1,37 @@
+/*
+ * starttrace.h - Log a timeline of the emulator startup.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_STARTTRACE_H
+#define VICE_STARTTRACE_H
+
+int starttrace_cmdline_options_init(void);
+
+/* Record that the startup phase `name' has just ended.  `name' must be a
+   string constant.  Marks are always recorded, they are only logged when
+   -starttrace was given.  */
+void starttrace_mark(const char *name);
+
+/* Called for every frame; the first one ends the timeline and logs it.  */
+void starttrace_frame(void);
+
+#endif
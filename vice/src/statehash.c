@@ -0,0 +1,196 @@
+/*
+ * statehash.c - Incremental hash of the machine state for desync detection.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The hash of the RAM is the sum of the hashes of its 256 byte pages, each
+   seeded with the page number.  Only the pages flagged dirty since the last
+   hash are hashed again: their old hash is subtracted from the sum and the
+   new one added.  A restored snapshot flags all pages, and while the
+   tracking is off (no user enabled it) all pages are hashed every time.
+
+   The RAM hash is then mixed with the CPU registers, the CPU clock and the
+   peeked chip registers.  The bytes are combined in little endian order, so
+   the hash is the same on all hosts.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib.h"
+#include "maincpu.h"
+#include "mem.h"
+#include "statehash.h"
+#include "types.h"
+
+#define STATEHASH_PAGE_SIZE 256
+#define STATEHASH_MUL       UINT64_C(0x9e3779b97f4a7c15)
+
+static statehash_machine_t statehash_machine;
+static int statehash_registered = 0;
+static int statehash_io_bank = -1;
+
+/* hash of every page, and their sum */
+static uint64_t *page_hash = NULL;
+static uint64_t ram_hash = 0;
+static int page_hash_valid = 0;
+
+static int statehash_users = 0;
+
+static uint64_t statehash_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= UINT64_C(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= UINT64_C(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t statehash_add(uint64_t h, uint64_t value)
+{
+    h ^= value;
+    h *= STATEHASH_MUL;
+    return h ^ (h >> 29);
+}
+
+static uint64_t statehash_page(const uint8_t *data, unsigned int page)
+{
+    uint64_t h = STATEHASH_MUL * (page + 1);
+    uint64_t word;
+    int i;
+
+    for (i = 0; i < STATEHASH_PAGE_SIZE; i += 8) {
+        word = (uint64_t)data[i]
+               | ((uint64_t)data[i + 1] << 8)
+               | ((uint64_t)data[i + 2] << 16)
+               | ((uint64_t)data[i + 3] << 24)
+               | ((uint64_t)data[i + 4] << 32)
+               | ((uint64_t)data[i + 5] << 40)
+               | ((uint64_t)data[i + 6] << 48)
+               | ((uint64_t)data[i + 7] << 56);
+        h = statehash_add(h, word);
+    }
+    return statehash_mix(h);
+}
+
+static void statehash_update_ram(void)
+{
+    const uint8_t *dirty = NULL;
+    unsigned int page;
+    uint64_t h;
+
+    if (statehash_machine.dirty_tracking() && page_hash_valid) {
+        dirty = statehash_machine.dirty_get();
+    }
+
+    for (page = 0; page < statehash_machine.pages; page++) {
+        if (dirty == NULL || dirty[page]) {
+            h = statehash_page(statehash_machine.ram + page * STATEHASH_PAGE_SIZE, page);
+            ram_hash += h - page_hash[page];
+            page_hash[page] = h;
+        }
+    }
+    statehash_machine.dirty_clear();
+    page_hash_valid = 1;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void statehash_register(const statehash_machine_t *machine)
+{
+    statehash_shutdown();
+
+    statehash_machine = *machine;
+    statehash_registered = 1;
+    page_hash = lib_calloc(machine->pages, sizeof(uint64_t));
+    ram_hash = 0;
+    page_hash_valid = 0;
+    statehash_io_bank = mem_bank_from_name("io");
+}
+
+void statehash_shutdown(void)
+{
+    if (statehash_registered && statehash_users > 0) {
+        statehash_machine.dirty_track(0);
+    }
+    statehash_registered = 0;
+    statehash_users = 0;
+    lib_free(page_hash);
+    page_hash = NULL;
+}
+
+void statehash_enable(int enable)
+{
+    if (enable) {
+        if (statehash_users++ == 0 && statehash_registered) {
+            statehash_machine.dirty_track(1);
+            page_hash_valid = 0;
+        }
+    } else if (statehash_users > 0) {
+        if (--statehash_users == 0 && statehash_registered) {
+            statehash_machine.dirty_track(0);
+        }
+    }
+}
+
+uint64_t statehash_get(void)
+{
+    const statehash_io_range_t *io;
+    unsigned int addr;
+    uint64_t h = 0;
+
+    if (statehash_registered) {
+        statehash_update_ram();
+        h = ram_hash;
+
+        if (statehash_machine.io != NULL && statehash_io_bank >= 0) {
+            for (io = statehash_machine.io; io->end != 0; io++) {
+                for (addr = io->start; addr <= io->end; addr++) {
+                    h = statehash_add(h, mem_bank_peek(statehash_io_bank, (uint16_t)addr, NULL));
+                }
+            }
+        }
+    }
+
+    h = statehash_add(h, maincpu_get_pc());
+    h = statehash_add(h, maincpu_get_a() | (maincpu_get_x() << 8)
+                         | (maincpu_get_y() << 16) | (maincpu_get_sp() << 24));
+    h = statehash_add(h, (uint64_t)maincpu_clk);
+
+    return statehash_mix(h);
+}
+
+/* Fill the words of a sync test with the current state.  */
+void statehash_sync_test(uint32_t *words)
+{
+    uint64_t h = statehash_get();
+
+    words[0] = (uint32_t)maincpu_get_pc();
+    words[1] = (uint32_t)maincpu_get_a();
+    words[2] = (uint32_t)maincpu_get_x();
+    words[3] = (uint32_t)maincpu_get_y();
+    words[4] = (uint32_t)maincpu_get_sp();
+    words[5] = (uint32_t)h;
+    words[6] = (uint32_t)(h >> 32);
+}
@@ -0,0 +1,62 @@
+/*
+ * statehash.h - Incremental hash of the machine state for desync detection.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_STATEHASH_H
+#define VICE_STATEHASH_H
+
+#include "types.h"
+
+/* Range of I/O registers whose peeked values are part of the hash.  */
+typedef struct statehash_io_range_s {
+    uint16_t start;
+    uint16_t end;
+} statehash_io_range_t;
+
+/* What a machine provides for hashing: its RAM with the dirty page tracking,
+   and the I/O ranges of the chips, terminated by a range with `end' 0.
+   Without a registration only the CPU registers and clock are hashed.  */
+typedef struct statehash_machine_s {
+    const uint8_t *ram;
+    unsigned int pages;
+    void (*dirty_track)(int enable);
+    int (*dirty_tracking)(void);
+    const uint8_t *(*dirty_get)(void);
+    void (*dirty_clear)(void);
+    const statehash_io_range_t *io;
+} statehash_machine_t;
+
+/* Words of the sync test: PC, A, X, Y, SP and the state hash (low, high).  */
+#define STATEHASH_SYNC_WORDS    7
+
+void statehash_register(const statehash_machine_t *machine);
+void statehash_shutdown(void);
+
+/* Users (netplay, event recording and playback) enable the dirty page
+   tracking while they need hashes.  The hash consumes the dirty flags, so
+   no other user of them can be active at the same time.  */
+void statehash_enable(int enable);
+
+uint64_t statehash_get(void);
+void statehash_sync_test(uint32_t *words);
+
+#endif
@@ -30,6 +30,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef WINDOWS_COMPILE
+#   include <windows.h>
+#elif defined(HAVE_MMAP)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
 #include "archdep.h"
 #include "cmdline.h"
 #include "findpath.h"
@@ -52,6 +61,9 @@
 static char *default_path = NULL;
 static char *system_path = NULL;
 static char *expanded_system_path = NULL;
+static char *bundle_name = NULL;
+
+static void sysfile_bundle_close(void);
 
 static int set_system_path(const char *val, void *param)
 {
@@ -118,9 +130,21 @@ const char *get_system_path(void)
     return expanded_system_path;
 }
 
+static int set_bundle_name(const char *val, void *param)
+{
+    if (util_string_set(&bundle_name, val)) {
+        return 0;
+    }
+    /* the new bundle is opened by the next sysfile_load() */
+    sysfile_bundle_close();
+    return 0;
+}
+
 static const resource_string_t resources_string[] = {
     { "Directory", "$$", RES_EVENT_NO, NULL,
       &system_path, set_system_path, NULL },
+    { "SystemFileBundle", SYSFILE_BUNDLE_DEFAULT_NAME, RES_EVENT_NO, NULL,
+      &bundle_name, set_bundle_name, NULL },
     RESOURCE_STRING_LIST_END
 };
 
@@ -131,6 +155,9 @@ static const cmdline_option_t cmdline_options[] =
     { "-directory", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, "Directory", NULL,
       "<Path>", "Define search path to locate system files" },
+    { "-sysfilebundle", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "SystemFileBundle", NULL,
+      "<Name>", "Specify the system file bundle searched before the system path (relative names are relative to the program directory, \"\" disables it)" },
     CMDLINE_LIST_END
 };
 
@@ -148,6 +175,7 @@ int sysfile_init(const char *emu_id)
 
 void sysfile_shutdown(void)
 {
+    sysfile_bundle_close();
     lib_free(default_path);
     lib_free(expanded_system_path);
 }
@@ -160,6 +188,7 @@ int sysfile_resources_init(void)
 void sysfile_resources_shutdown(void)
 {
     lib_free(system_path);
+    lib_free(bundle_name);
 }
 
 int sysfile_cmdline_options_init(void)
@@ -237,10 +266,326 @@ int sysfile_locate(const char *name, const char *subpath, char **complete_path_r
 
 /* ------------------------------------------------------------------------- */
 
+/* The system file bundle holds the files of the data directory in a single
+   file, so loading the ROMs at startup does not search the system path for
+   each of them.  It is mapped into memory by the first sysfile_load() and
+   searched before the system path; names with a directory part always
+   come from the file system.  */
+
+typedef struct bundle_entry_s {
+    const char *name;       /* not terminated */
+    unsigned int name_len;
+    const uint8_t *data;
+    unsigned int size;
+} bundle_entry_t;
+
+static uint8_t *bundle_data = NULL;
+static size_t bundle_size = 0;
+static char *bundle_path = NULL;
+static bundle_entry_t *bundle_entries = NULL;
+static unsigned int bundle_num_entries = 0;
+
+/* Nonzero once opening the bundle was attempted.  */
+static int bundle_tried = 0;
+
+#ifdef WINDOWS_COMPILE
+static HANDLE bundle_mapping = NULL;
+#endif
+
+static uint8_t *bundle_map(const char *path, size_t *size_return)
+{
+#ifdef WINDOWS_COMPILE
+    HANDLE file;
+    LARGE_INTEGER size;
+    void *view;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0
+        || size.QuadPart > 0x7fffffff) {
+        CloseHandle(file);
+        return NULL;
+    }
+    bundle_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (bundle_mapping == NULL) {
+        return NULL;
+    }
+    view = MapViewOfFile(bundle_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(bundle_mapping);
+        bundle_mapping = NULL;
+        return NULL;
+    }
+    *size_return = (size_t)size.QuadPart;
+    return view;
+#elif defined(HAVE_MMAP)
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    *size_return = (size_t)st.st_size;
+    return map;
+#else
+    FILE *f;
+    off_t size;
+    uint8_t *data;
+
+    f = fopen(path, MODE_READ);
+    if (f == NULL) {
+        return NULL;
+    }
+    size = archdep_file_size(f);
+    if (size <= 0) {
+        fclose(f);
+        return NULL;
+    }
+    data = lib_malloc((size_t)size);
+    if (fread(data, 1, (size_t)size, f) != (size_t)size) {
+        lib_free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size_return = (size_t)size;
+    return data;
+#endif
+}
+
+static void bundle_unmap(void)
+{
+#ifdef WINDOWS_COMPILE
+    UnmapViewOfFile(bundle_data);
+    CloseHandle(bundle_mapping);
+    bundle_mapping = NULL;
+#elif defined(HAVE_MMAP)
+    munmap(bundle_data, bundle_size);
+#else
+    lib_free(bundle_data);
+#endif
+}
+
+static void sysfile_bundle_close(void)
+{
+    if (bundle_data != NULL) {
+        bundle_unmap();
+        bundle_data = NULL;
+        bundle_size = 0;
+    }
+    lib_free(bundle_entries);
+    bundle_entries = NULL;
+    bundle_num_entries = 0;
+    lib_free(bundle_path);
+    bundle_path = NULL;
+    bundle_tried = 0;
+}
+
+static unsigned int bundle_get_dword(const uint8_t *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8)
+           | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/* Compare an index name with `key', in the order of strcmp().  */
+static int bundle_compare(const bundle_entry_t *e, const char *key, size_t key_len)
+{
+    size_t len = e->name_len < key_len ? e->name_len : key_len;
+    int res = memcmp(e->name, key, len);
+
+    if (res != 0) {
+        return res;
+    }
+    if (e->name_len == key_len) {
+        return 0;
+    }
+    return e->name_len < key_len ? -1 : 1;
+}
+
+static void sysfile_bundle_open(void)
+{
+    const uint8_t *p, *end;
+    unsigned int count, i;
+
+    bundle_tried = 1;
+
+    if (bundle_name == NULL || *bundle_name == '\0') {
+        return;
+    }
+
+    if (archdep_path_is_relative(bundle_name)) {
+        bundle_path = util_join_paths(archdep_boot_path(), bundle_name, NULL);
+    } else {
+        bundle_path = lib_strdup(bundle_name);
+    }
+
+    /* the bundle is optional, a missing one is not an error */
+    bundle_data = bundle_map(bundle_path, &bundle_size);
+    if (bundle_data == NULL) {
+        DBG(("sysfile_bundle_open: no bundle at '%s'\n", bundle_path));
+        return;
+    }
+
+    if (bundle_size < SYSFILE_BUNDLE_HEADER_LEN
+        || memcmp(bundle_data, SYSFILE_BUNDLE_MAGIC, SYSFILE_BUNDLE_MAGIC_LEN) != 0
+        || bundle_get_dword(bundle_data + SYSFILE_BUNDLE_MAGIC_LEN) != SYSFILE_BUNDLE_VERSION) {
+        log_error(LOG_DEFAULT, "`%s' is not a system file bundle.", bundle_path);
+        goto fail;
+    }
+
+    count = bundle_get_dword(bundle_data + SYSFILE_BUNDLE_MAGIC_LEN + 4);
+    p = bundle_data + SYSFILE_BUNDLE_HEADER_LEN;
+    end = bundle_data + bundle_size;
+    if (count > (size_t)(end - p) / SYSFILE_BUNDLE_ENTRY_LEN) {
+        goto corrupt;
+    }
+
+    bundle_entries = lib_malloc(count * sizeof(bundle_entry_t));
+    for (i = 0; i < count; i++) {
+        bundle_entry_t *e = &bundle_entries[i];
+        unsigned int offset;
+
+        if ((size_t)(end - p) < SYSFILE_BUNDLE_ENTRY_LEN) {
+            goto corrupt;
+        }
+        offset = bundle_get_dword(p);
+        e->size = bundle_get_dword(p + 4);
+        e->name_len = (unsigned int)p[8] | ((unsigned int)p[9] << 8);
+        p += SYSFILE_BUNDLE_ENTRY_LEN;
+
+        if ((size_t)(end - p) < e->name_len
+            || offset > bundle_size || e->size > bundle_size - offset) {
+            goto corrupt;
+        }
+        e->name = (const char *)p;
+        e->data = bundle_data + offset;
+        p += e->name_len;
+
+        /* the lookup is a binary search */
+        if (i > 0 && bundle_compare(&bundle_entries[i - 1], e->name, e->name_len) >= 0) {
+            goto corrupt;
+        }
+    }
+    bundle_num_entries = count;
+
+    log_message(LOG_DEFAULT, "Using system file bundle `%s' (%u files).",
+                bundle_path, count);
+    return;
+
+corrupt:
+    log_error(LOG_DEFAULT, "System file bundle `%s' is corrupt.", bundle_path);
+fail:
+    sysfile_bundle_close();
+    bundle_tried = 1;
+}
+
+static const bundle_entry_t *sysfile_bundle_find(const char *name, const char *subpath)
+{
+    char *key;
+    size_t key_len;
+    unsigned int lo, hi;
+    const bundle_entry_t *found = NULL;
+
+    if (!bundle_tried) {
+        sysfile_bundle_open();
+    }
+    if (bundle_num_entries == 0
+        || strchr(name, '/') != NULL || strchr(name, '\\') != NULL) {
+        return NULL;
+    }
+
+    if (subpath != NULL) {
+        key = util_concat(subpath, "/", name, NULL);
+    } else {
+        key = lib_strdup(name);
+    }
+    key_len = strlen(key);
+
+    lo = 0;
+    hi = bundle_num_entries;
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        int res = bundle_compare(&bundle_entries[mid], key, key_len);
+
+        if (res == 0) {
+            found = &bundle_entries[mid];
+            break;
+        }
+        if (res < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    lib_free(key);
+    return found;
+}
+
+/* As sysfile_load(), for a file found in the bundle.  */
+static int sysfile_load_bundle_entry(const bundle_entry_t *e, uint8_t *dest,
+                                     int minsize, int maxsize)
+{
+    const uint8_t *src = e->data;
+    size_t rsize = e->size;
+    int load_at_end;
+
+    log_message(LOG_DEFAULT, "Loading system file `%.*s' from `%s'.",
+                (int)e->name_len, e->name, bundle_path);
+
+    if (minsize < 0) {
+        minsize = -minsize;
+        load_at_end = 0;
+    } else {
+        load_at_end = 1;
+    }
+
+    if (rsize < ((size_t)minsize)) {
+        log_error(LOG_DEFAULT, "ROM %.*s: short file.", (int)e->name_len, e->name);
+        return -1;
+    }
+    if (rsize == ((size_t)maxsize + 2)) {
+        log_warning(LOG_DEFAULT,
+                    "ROM `%.*s': two bytes too large - removing assumed "
+                    "start address.", (int)e->name_len, e->name);
+        src += 2;
+        rsize -= 2;
+    }
+    if (load_at_end && rsize < ((size_t)maxsize)) {
+        dest += maxsize - rsize;
+    } else if (rsize > ((size_t)maxsize)) {
+        log_warning(LOG_DEFAULT,
+                    "ROM `%.*s': long file (%"PRI_SIZE_T"), discarding end (%"PRI_SIZE_T" bytes).",
+                    (int)e->name_len, e->name, rsize, rsize - maxsize);
+        rsize = maxsize;
+    }
+    memcpy(dest, src, rsize);
+
+    return (int)rsize;
+}
+
+/* ------------------------------------------------------------------------- */
+
 /*
  * If minsize >= 0, and the file is smaller than maxsize, load the data
  * into the end of the memory range.
  * If minsize < 0, load it at the start.
+ * The system file bundle is searched before the system path.
  */
 int sysfile_load(const char *name, const char *subpath, uint8_t *dest, int minsize, int maxsize)
 {
@@ -249,6 +594,14 @@ int sysfile_load(const char *name, const char *subpath, uint8_t *dest, int minsi
     off_t tmpsize;
     char *complete_path = NULL;
     int load_at_end;
+    const bundle_entry_t *entry;
+
+    if (name != NULL && *name != '\0') {
+        entry = sysfile_bundle_find(name, subpath);
+        if (entry != NULL) {
+            return sysfile_load_bundle_entry(entry, dest, minsize, maxsize);
+        }
+    }
 
     fp = sysfile_open(name, subpath, &complete_path, MODE_READ);
 
@@ -31,6 +31,25 @@
 
 #include "types.h"
 
+/* System file bundle, all numbers little endian:
+
+   header  8 BYTES "VICESYS" 0x1a, DWORD version (1), DWORD entry count
+   index   per entry DWORD data offset, DWORD size, WORD name length and
+           the name, "<subpath>/<file name>" as given to sysfile_load()
+           (e.g. "DRIVES/dos1541-325302-01+901229-05.bin"), sorted as by
+           strcmp()
+   data    the file contents, at the offsets given in the index
+
+   Keep in sync with src/tools/sysbundle/sysbundle.c.  */
+
+#define SYSFILE_BUNDLE_MAGIC            "VICESYS\x1a"
+#define SYSFILE_BUNDLE_MAGIC_LEN        8
+#define SYSFILE_BUNDLE_VERSION          1
+#define SYSFILE_BUNDLE_HEADER_LEN       16
+#define SYSFILE_BUNDLE_ENTRY_LEN        10
+
+#define SYSFILE_BUNDLE_DEFAULT_NAME     "sysfiles.vbd"
+
 int sysfile_init(const char *emu_id);
 void sysfile_shutdown(void);
 int sysfile_resources_init(void);
@@ -51,6 +51,9 @@
 #define TAP_HDR_VIDEO_NTSCOLD   2
 #define TAP_HDR_VIDEO_PALN      3
 
+/* Size of the data in a CBM header block.  */
+#define TAP_HEADER_DATA_LEN     192
+
 struct tape_init_s;
 struct tape_file_record_s;
 
@@ -96,6 +99,9 @@ typedef struct tap_s {
     /* Pointer to the current file record.  */
     struct tape_file_record_s *tap_file_record;
 
+    /* Data of the current file's CBM header block.  */
+    uint8_t header_data[TAP_HEADER_DATA_LEN];
+
     /* Tape counter in machine-cycles/8 for even looong tapes */
     int cycle_counter;
 
@@ -125,6 +131,7 @@ int tap_seek_to_file(tap_t *tap, unsigned int file_number);
 int tap_seek_to_offset(tap_t *tap, unsigned long offset);
 unsigned long tap_get_offset(tap_t *tap);
 int tap_seek_to_next_file(tap_t *tap, unsigned int allow_rewind);
+int tap_read_file_at(tap_t *tap, int pos);
 void tap_get_header(tap_t *tap, uint8_t *name);
 struct tape_file_record_s *tap_get_current_file_record(tap_t *tap);
 
@@ -236,6 +236,8 @@ tap_t *tap_open(const char *name, unsigned int *read_only)
         *read_only = 0;
     }
 
+    fd = zfile_fcache(fd);
+
     new = tap_new();
 
     if (tap_header_read(new, fd) < 0) {
@@ -801,6 +803,7 @@ static int tap_cbm_read_header(tap_t *tap)
     uint8_t buffer[255];
 
     /* read header data */
+    memset(buffer, 0, sizeof(buffer));
     ret = tap_cbm_read_block(tap, buffer, machine_tape_behaviour() == TAPE_BEHAVIOUR_C16 ? 193 : 255);
     if (ret < 0) {
         return ret;
@@ -817,6 +820,7 @@ static int tap_cbm_read_header(tap_t *tap)
     tap->tap_file_record->start_addr = (uint16_t)(buffer[1] + buffer[2] * 256);
     tap->tap_file_record->end_addr = (uint16_t)(buffer[3] + buffer[4] * 256);
     memcpy(tap->tap_file_record->name, buffer + 5, 16);
+    memcpy(tap->header_data, buffer, TAP_HEADER_DATA_LEN);
 
     return 0;
 }
@@ -1470,17 +1474,11 @@ static int tap_find_header(tap_t *tap)
 }
 
 
-static int tap_read_file(tap_t *tap)
+/* Decode the file at the current position in the TAP file, which is left
+   behind it.  */
+static int tap_decode_file(tap_t *tap)
 {
     int ret;
-    long fpos;
-
-#if TAP_DEBUG > 0
-    log_debug("\nTAP_READ_FILE(START)\n");
-#endif
-
-    /* store current position in TAP file */
-    fpos = ftell(tap->fd);
 
     /* clear old file data */
     tap->current_file_size = 0;
@@ -1505,6 +1503,23 @@ static int tap_read_file(tap_t *tap)
         tap->current_file_data = NULL;
     }
 
+    return ret;
+}
+
+static int tap_read_file(tap_t *tap)
+{
+    int ret;
+    long fpos;
+
+#if TAP_DEBUG > 0
+    log_debug("\nTAP_READ_FILE(START)\n");
+#endif
+
+    /* store current position in TAP file */
+    fpos = ftell(tap->fd);
+
+    ret = tap_decode_file(tap);
+
     /* go back to previous position in TAP file */
     fseek(tap->fd, fpos, SEEK_SET);
 
@@ -1612,6 +1627,29 @@ int tap_seek_to_next_file(tap_t *tap, unsigned int allow_rewind)
     return 0;
 }
 
+/* Decode the next file behind the tape position `pos' for the tape traps,
+   without moving the tape.  Returns the position behind the file, or -1 at
+   the end of the tape.  If the file could not be read, its data is NULL.  */
+int tap_read_file_at(tap_t *tap, int pos)
+{
+    int seek_position = tap->current_file_seek_position;
+    int end = -1;
+
+    tap->current_file_size = 0;
+    lib_free(tap->current_file_data);
+    tap->current_file_data = NULL;
+
+    fseek(tap->fd, tap->offset + pos, SEEK_SET);
+    if (tap_find_header(tap) >= 0) {
+        tap_decode_file(tap);
+        tap->current_file_data_pos = 0;
+        end = (int)(ftell(tap->fd) - tap->offset);
+    }
+
+    tap->current_file_seek_position = seek_position;
+    return end;
+}
+
 /* used by virtual devices */
 int tap_read(tap_t *tap, uint8_t *buf, size_t size)
 {
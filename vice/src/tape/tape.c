@@ -79,6 +79,9 @@ static int tape_is_initialized = 0;
 /* Tape traps to be installed.  */
 static const trap_t *tape_traps;
 
+/* Flag: are the tape traps installed?  */
+static int tape_traps_installed = 0;
+
 /* Logging goes here.  */
 static log_t tape_log = LOG_ERR;
 
@@ -98,10 +101,11 @@ void tape_traps_install(void)
 {
     const trap_t *p;
 
-    if (tape_traps != NULL) {
+    if (tape_traps != NULL && !tape_traps_installed) {
         for (p = tape_traps; p->func != NULL; p++) {
             traps_add(p);
         }
+        tape_traps_installed = 1;
     }
 }
 
@@ -109,13 +113,30 @@ void tape_traps_deinstall(void)
 {
     const trap_t *p;
 
-    if (tape_traps != NULL) {
+    if (tape_traps != NULL && tape_traps_installed) {
         for (p = tape_traps; p->func != NULL; p++) {
             traps_remove(p);
         }
+        tape_traps_installed = 0;
     }
 }
 
+/* The traps are removed while a TAP image is attached, so the Kernal plays
+   it, unless they are told to load the files from the TAP image in unit 1.  */
+void tape_traps_update(void)
+{
+    int i;
+
+    for (i = 0; i < TAPEPORT_MAX_PORTS; i++) {
+        if (tape_image_dev[i] != NULL && tape_tap_attached(i)
+            && !(i == TAPEPORT_PORT_1 && datasette_tap_traps)) {
+            tape_traps_deinstall();
+            return;
+        }
+    }
+    tape_traps_install();
+}
+
 static void tape_init_vars(const tape_init_t *init)
 {
     /* Set addresses of tape routine variables.  */
@@ -171,7 +192,7 @@ int tape_reinit(const tape_init_t *init)
     tape_traps = NULL;
 
     tape_init_vars(init);
-    tape_traps_install();
+    tape_traps_update();
 
     return 0;
 }
@@ -228,6 +249,35 @@ static int default_tape_header_type(void)
     return machine_tape_type_default();
 }
 
+/* Decode the next Kernal program file on the TAP image in unit 1 and move
+   the tape behind it, so a loader started from it plays on from there.  The
+   file data is left for the receive trap.  */
+static tape_file_record_t *tape_find_tap_file(void)
+{
+    tap_t *tap = (tap_t *)tape_image_dev[TAPEPORT_PORT_1]->data;
+    tape_file_record_t *rec;
+    int pos, next;
+
+    pos = tap->current_file_seek_position;
+    while (1) {
+        next = tap_read_file_at(tap, pos);
+        if (next <= pos) {
+            return NULL;
+        }
+        pos = next;
+
+        rec = tap_get_current_file_record(tap);
+        if (tap->current_file_data != NULL
+            && rec->encoding == TAPE_ENCODING_CBM
+            && (rec->type == TAPE_CAS_TYPE_BAS || rec->type == TAPE_CAS_TYPE_PRG)) {
+            break;
+        }
+    }
+
+    datasette_seek_position(TAPEPORT_PORT_1, pos);
+    return rec;
+}
+
 /* Find the next Tape Header and load it onto the Tape Buffer.  */
 int tape_find_header_trap(void)
 {
@@ -236,7 +286,18 @@ int tape_find_header_trap(void)
 
     cassette_buffer = mem_ram + (mem_read(buffer_pointer_addr) | (mem_read((uint16_t)(buffer_pointer_addr + 1)) << 8));
 
-    if (tape_image_dev[TAPEPORT_PORT_1]->name == NULL
+    if (tape_image_dev[TAPEPORT_PORT_1]->name != NULL
+        && tape_image_dev[TAPEPORT_PORT_1]->type == TAPE_TYPE_TAP) {
+        tape_file_record_t *rec = tape_find_tap_file();
+
+        err = (rec == NULL);
+        if (!err) {
+            /* the rest of the header often holds loader code */
+            memcpy(cassette_buffer,
+                   ((tap_t *)tape_image_dev[TAPEPORT_PORT_1]->data)->header_data,
+                   TAP_HEADER_DATA_LEN);
+        }
+    } else if (tape_image_dev[TAPEPORT_PORT_1]->name == NULL
         || tape_image_dev[TAPEPORT_PORT_1]->type != TAPE_TYPE_T64) {
         err = 1;
     } else {
@@ -303,7 +364,18 @@ int tape_find_header_trap_plus4(void)
 
     cassette_buffer = mem_ram + buffer_pointer_addr;
 
-    if (tape_image_dev[TAPEPORT_PORT_1]->name == NULL
+    if (tape_image_dev[TAPEPORT_PORT_1]->name != NULL
+        && tape_image_dev[TAPEPORT_PORT_1]->type == TAPE_TYPE_TAP) {
+        tape_file_record_t *rec = tape_find_tap_file();
+
+        err = (rec == NULL);
+        if (!err) {
+            uint8_t *header = ((tap_t *)tape_image_dev[TAPEPORT_PORT_1]->data)->header_data;
+
+            mem_store(0xF8, header[CAS_TYPE_OFFSET]);
+            memcpy(cassette_buffer, header + 1, TAP_HEADER_DATA_LEN - 1);
+        }
+    } else if (tape_image_dev[TAPEPORT_PORT_1]->name == NULL
         || tape_image_dev[TAPEPORT_PORT_1]->type != TAPE_TYPE_T64) {
         err = 1;
     } else {
@@ -386,7 +458,11 @@ int tape_receive_trap(void)
                 int amount;
 
                 len = (int)(end - start);
-                amount = t64_read((t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data, mem_ram + (int)start, len);
+                if (tape_image_dev[TAPEPORT_PORT_1]->type == TAPE_TYPE_TAP) {
+                    amount = tap_read((tap_t *)tape_image_dev[TAPEPORT_PORT_1]->data, mem_ram + (int)start, len);
+                } else {
+                    amount = t64_read((t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data, mem_ram + (int)start, len);
+                }
                 if (amount == len) {
                     st = 0x40;  /* EOF */
                 } else {
@@ -422,6 +498,7 @@ int tape_receive_trap_plus4(void)
 {
     uint16_t start, end, len;
     uint8_t st;
+    int amount;
 
     start = (mem_read(stal_addr) | (mem_read((uint16_t)(stal_addr + 1)) << 8));
     end = (mem_read(eal_addr) | (mem_read((uint16_t)(eal_addr + 1)) << 8));
@@ -429,8 +506,14 @@ int tape_receive_trap_plus4(void)
     /* Read block.  */
     len = end - start;
 
-    if (t64_read((t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data,
-                 mem_ram + (int) start, (int)len) == (int) len) {
+    if (tape_image_dev[TAPEPORT_PORT_1]->type == TAPE_TYPE_TAP) {
+        amount = tap_read((tap_t *)tape_image_dev[TAPEPORT_PORT_1]->data,
+                          mem_ram + (int) start, (int)len);
+    } else {
+        amount = t64_read((t64_t *)tape_image_dev[TAPEPORT_PORT_1]->data,
+                          mem_ram + (int) start, (int)len);
+    }
+    if (amount == (int) len) {
         st = 0x40;      /* EOF */
     } else {
         st = 0x10;
@@ -494,8 +577,6 @@ int tape_image_detach_internal(unsigned int unit)
             log_message(tape_log,
                         "Detaching TAP image `%s'.", tape_image_dev[unit - 1]->name);
             datasette_set_tape_image(unit - 1, NULL);
-
-            tape_traps_install();
             break;
         default:
             log_error(tape_log, "Unknown tape type %u.",
@@ -503,6 +584,7 @@ int tape_image_detach_internal(unsigned int unit)
     }
 
     retval = tape_image_close(tape_image_dev[unit - 1]);
+    tape_traps_update();
 
     ui_display_tape_current_image(unit - 1, "");
 
@@ -591,7 +673,7 @@ static int tape_image_attach_internal(unsigned int unit, const char *name)
             log_message(tape_log, "TAP image version: %i, system: %i.",
                         ((tap_t *)tape_image_dev[unit - 1]->data)->version,
                         ((tap_t *)tape_image_dev[unit - 1]->data)->system);
-            tape_traps_deinstall();
+            tape_traps_update();
             break;
         default:
             log_error(tape_log, "Unknown tape type %u.",
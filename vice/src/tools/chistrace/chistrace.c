@@ -0,0 +1,584 @@
+/*
+ * chistrace.c - Decode and search cpu history trace files.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The monitor command `chistrace' and the -chistrace option record the
+   cpu history to a file, this tool prints it in the format of the `chis'
+   command, optionally limited to a memspace, a cycle or PC range, or the
+   lines containing a string.  */
+
+#include "vice.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef main
+#  if main == SDL_main
+#    undef main
+#  endif
+#endif
+
+/* Keep in sync with src/monitor/mon_chistrace.h.  */
+#define CHISTRACE_MAGIC         "VICECHT\x1a"
+#define CHISTRACE_MAGIC_LEN     8
+#define CHISTRACE_VERSION       1
+#define CHISTRACE_BLOCK_HEADER  13
+
+#define CHISTRACE_METHOD_STORED 0
+#define CHISTRACE_METHOD_ZLIB   1
+
+#define CHISTRACE_FLAG_A        0x08
+#define CHISTRACE_FLAG_X        0x10
+#define CHISTRACE_FLAG_Y        0x20
+#define CHISTRACE_FLAG_SP       0x40
+#define CHISTRACE_FLAG_ST       0x80
+
+#define CHISTRACE_ORIGINS       8
+
+/* ------------------------------------------------------------------------- */
+
+enum {
+    M_IMP, M_ACC, M_IMM, M_ZP, M_ZPX, M_ZPY, M_ABS, M_ABX, M_ABY,
+    M_IND, M_INX, M_INY, M_REL
+};
+
+typedef struct opcode_s {
+    const char *mnemonic;
+    int mode;
+} opcode_t;
+
+/* The NMOS 6502 opcodes as named by the monitor (monitor/asm6502.c).  */
+static const opcode_t opcodes[256] = {
+    /* 00 */ { "BRK",  M_IMP },   { "ORA",  M_INX },   { "JAM",  M_IMP },   { "SLO",  M_INX },
+    /* 04 */ { "NOOP", M_ZP },    { "ORA",  M_ZP },    { "ASL",  M_ZP },    { "SLO",  M_ZP },
+    /* 08 */ { "PHP",  M_IMP },   { "ORA",  M_IMM },   { "ASL",  M_ACC },   { "ANC",  M_IMM },
+    /* 0c */ { "NOOP", M_ABS },   { "ORA",  M_ABS },   { "ASL",  M_ABS },   { "SLO",  M_ABS },
+
+    /* 10 */ { "BPL",  M_REL },   { "ORA",  M_INY },   { "JAM",  M_IMP },   { "SLO",  M_INY },
+    /* 14 */ { "NOOP", M_ZPX },   { "ORA",  M_ZPX },   { "ASL",  M_ZPX },   { "SLO",  M_ZPX },
+    /* 18 */ { "CLC",  M_IMP },   { "ORA",  M_ABY },   { "NOOP", M_IMP },   { "SLO",  M_ABY },
+    /* 1c */ { "NOOP", M_ABX },   { "ORA",  M_ABX },   { "ASL",  M_ABX },   { "SLO",  M_ABX },
+
+    /* 20 */ { "JSR",  M_ABS },   { "AND",  M_INX },   { "JAM",  M_IMP },   { "RLA",  M_INX },
+    /* 24 */ { "BIT",  M_ZP },    { "AND",  M_ZP },    { "ROL",  M_ZP },    { "RLA",  M_ZP },
+    /* 28 */ { "PLP",  M_IMP },   { "AND",  M_IMM },   { "ROL",  M_ACC },   { "ANC",  M_IMM },
+    /* 2c */ { "BIT",  M_ABS },   { "AND",  M_ABS },   { "ROL",  M_ABS },   { "RLA",  M_ABS },
+
+    /* 30 */ { "BMI",  M_REL },   { "AND",  M_INY },   { "JAM",  M_IMP },   { "RLA",  M_INY },
+    /* 34 */ { "NOOP", M_ZPX },   { "AND",  M_ZPX },   { "ROL",  M_ZPX },   { "RLA",  M_ZPX },
+    /* 38 */ { "SEC",  M_IMP },   { "AND",  M_ABY },   { "NOOP", M_IMP },   { "RLA",  M_ABY },
+    /* 3c */ { "NOOP", M_ABX },   { "AND",  M_ABX },   { "ROL",  M_ABX },   { "RLA",  M_ABX },
+
+    /* 40 */ { "RTI",  M_IMP },   { "EOR",  M_INX },   { "JAM",  M_IMP },   { "SRE",  M_INX },
+    /* 44 */ { "NOOP", M_ZP },    { "EOR",  M_ZP },    { "LSR",  M_ZP },    { "SRE",  M_ZP },
+    /* 48 */ { "PHA",  M_IMP },   { "EOR",  M_IMM },   { "LSR",  M_ACC },   { "ASR",  M_IMM },
+    /* 4c */ { "JMP",  M_ABS },   { "EOR",  M_ABS },   { "LSR",  M_ABS },   { "SRE",  M_ABS },
+
+    /* 50 */ { "BVC",  M_REL },   { "EOR",  M_INY },   { "JAM",  M_IMP },   { "SRE",  M_INY },
+    /* 54 */ { "NOOP", M_ZPX },   { "EOR",  M_ZPX },   { "LSR",  M_ZPX },   { "SRE",  M_ZPX },
+    /* 58 */ { "CLI",  M_IMP },   { "EOR",  M_ABY },   { "NOOP", M_IMP },   { "SRE",  M_ABY },
+    /* 5c */ { "NOOP", M_ABX },   { "EOR",  M_ABX },   { "LSR",  M_ABX },   { "SRE",  M_ABX },
+
+    /* 60 */ { "RTS",  M_IMP },   { "ADC",  M_INX },   { "JAM",  M_IMP },   { "RRA",  M_INX },
+    /* 64 */ { "NOOP", M_ZP },    { "ADC",  M_ZP },    { "ROR",  M_ZP },    { "RRA",  M_ZP },
+    /* 68 */ { "PLA",  M_IMP },   { "ADC",  M_IMM },   { "ROR",  M_ACC },   { "ARR",  M_IMM },
+    /* 6c */ { "JMP",  M_IND },   { "ADC",  M_ABS },   { "ROR",  M_ABS },   { "RRA",  M_ABS },
+
+    /* 70 */ { "BVS",  M_REL },   { "ADC",  M_INY },   { "JAM",  M_IMP },   { "RRA",  M_INY },
+    /* 74 */ { "NOOP", M_ZPX },   { "ADC",  M_ZPX },   { "ROR",  M_ZPX },   { "RRA",  M_ZPX },
+    /* 78 */ { "SEI",  M_IMP },   { "ADC",  M_ABY },   { "NOOP", M_IMP },   { "RRA",  M_ABY },
+    /* 7c */ { "NOOP", M_ABX },   { "ADC",  M_ABX },   { "ROR",  M_ABX },   { "RRA",  M_ABX },
+
+    /* 80 */ { "NOOP", M_IMM },   { "STA",  M_INX },   { "NOOP", M_IMM },   { "SAX",  M_INX },
+    /* 84 */ { "STY",  M_ZP },    { "STA",  M_ZP },    { "STX",  M_ZP },    { "SAX",  M_ZP },
+    /* 88 */ { "DEY",  M_IMP },   { "NOOP", M_IMM },   { "TXA",  M_IMP },   { "ANE",  M_IMM },
+    /* 8c */ { "STY",  M_ABS },   { "STA",  M_ABS },   { "STX",  M_ABS },   { "SAX",  M_ABS },
+
+    /* 90 */ { "BCC",  M_REL },   { "STA",  M_INY },   { "JAM",  M_IMP },   { "SHA",  M_INY },
+    /* 94 */ { "STY",  M_ZPX },   { "STA",  M_ZPX },   { "STX",  M_ZPY },   { "SAX",  M_ZPY },
+    /* 98 */ { "TYA",  M_IMP },   { "STA",  M_ABY },   { "TXS",  M_IMP },   { "SHS",  M_ABY },
+    /* 9c */ { "SHY",  M_ABX },   { "STA",  M_ABX },   { "SHX",  M_ABY },   { "SHA",  M_ABY },
+
+    /* a0 */ { "LDY",  M_IMM },   { "LDA",  M_INX },   { "LDX",  M_IMM },   { "LAX",  M_INX },
+    /* a4 */ { "LDY",  M_ZP },    { "LDA",  M_ZP },    { "LDX",  M_ZP },    { "LAX",  M_ZP },
+    /* a8 */ { "TAY",  M_IMP },   { "LDA",  M_IMM },   { "TAX",  M_IMP },   { "LXA",  M_IMM },
+    /* ac */ { "LDY",  M_ABS },   { "LDA",  M_ABS },   { "LDX",  M_ABS },   { "LAX",  M_ABS },
+
+    /* b0 */ { "BCS",  M_REL },   { "LDA",  M_INY },   { "JAM",  M_IMP },   { "LAX",  M_INY },
+    /* b4 */ { "LDY",  M_ZPX },   { "LDA",  M_ZPX },   { "LDX",  M_ZPY },   { "LAX",  M_ZPY },
+    /* b8 */ { "CLV",  M_IMP },   { "LDA",  M_ABY },   { "TSX",  M_IMP },   { "LAS",  M_ABY },
+    /* bc */ { "LDY",  M_ABX },   { "LDA",  M_ABX },   { "LDX",  M_ABY },   { "LAX",  M_ABY },
+
+    /* c0 */ { "CPY",  M_IMM },   { "CMP",  M_INX },   { "NOOP", M_IMM },   { "DCP",  M_INX },
+    /* c4 */ { "CPY",  M_ZP },    { "CMP",  M_ZP },    { "DEC",  M_ZP },    { "DCP",  M_ZP },
+    /* c8 */ { "INY",  M_IMP },   { "CMP",  M_IMM },   { "DEX",  M_IMP },   { "SBX",  M_IMM },
+    /* cc */ { "CPY",  M_ABS },   { "CMP",  M_ABS },   { "DEC",  M_ABS },   { "DCP",  M_ABS },
+
+    /* d0 */ { "BNE",  M_REL },   { "CMP",  M_INY },   { "JAM",  M_IMP },   { "DCP",  M_INY },
+    /* d4 */ { "NOOP", M_ZPX },   { "CMP",  M_ZPX },   { "DEC",  M_ZPX },   { "DCP",  M_ZPX },
+    /* d8 */ { "CLD",  M_IMP },   { "CMP",  M_ABY },   { "NOOP", M_IMP },   { "DCP",  M_ABY },
+    /* dc */ { "NOOP", M_ABX },   { "CMP",  M_ABX },   { "DEC",  M_ABX },   { "DCP",  M_ABX },
+
+    /* e0 */ { "CPX",  M_IMM },   { "SBC",  M_INX },   { "NOOP", M_IMM },   { "ISB",  M_INX },
+    /* e4 */ { "CPX",  M_ZP },    { "SBC",  M_ZP },    { "INC",  M_ZP },    { "ISB",  M_ZP },
+    /* e8 */ { "INX",  M_IMP },   { "SBC",  M_IMM },   { "NOP",  M_IMP },   { "USBC", M_IMM },
+    /* ec */ { "CPX",  M_ABS },   { "SBC",  M_ABS },   { "INC",  M_ABS },   { "ISB",  M_ABS },
+
+    /* f0 */ { "BEQ",  M_REL },   { "SBC",  M_INY },   { "JAM",  M_IMP },   { "ISB",  M_INY },
+    /* f4 */ { "NOOP", M_ZPX },   { "SBC",  M_ZPX },   { "INC",  M_ZPX },   { "ISB",  M_ZPX },
+    /* f8 */ { "SED",  M_IMP },   { "SBC",  M_ABY },   { "NOOP", M_IMP },   { "ISB",  M_ABY },
+    /* fc */ { "NOOP", M_ABX },   { "SBC",  M_ABX },   { "INC",  M_ABX },   { "ISB",  M_ABX }
+};
+
+static const char * const memspace_string[CHISTRACE_ORIGINS] = {
+    "default", "C", "8", "9", "10", "11", "?", "?"
+};
+
+typedef struct state_s {
+    uint64_t cycle;
+    unsigned int pc;
+    uint8_t reg_a;
+    uint8_t reg_x;
+    uint8_t reg_y;
+    uint8_t reg_sp;
+    uint8_t reg_st;
+} state_t;
+
+/* Filters from the command line.  */
+static int filter_origin = -1;
+static uint64_t cycle_from = 0;
+static uint64_t cycle_to = UINT64_MAX;
+static unsigned int pc_from = 0;
+static unsigned int pc_to = 0xffff;
+static const char *grep_string = NULL;
+static int stats_only = 0;
+
+static uint64_t total_records = 0;
+static uint64_t total_shown = 0;
+static uint64_t total_raw = 0;
+static uint64_t total_stored = 0;
+static unsigned int total_blocks = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static uint32_t get_dword(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+           | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end,
+                                 int64_t *value)
+{
+    uint64_t v = 0;
+    int shift = 0;
+
+    while (p < end && shift < 64) {
+        v |= (uint64_t)(*p & 0x7f) << shift;
+        if (!(*p++ & 0x80)) {
+            *value = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+static void disassemble(char *buf, unsigned int pc, uint8_t op, uint8_t p1,
+                        uint8_t p2)
+{
+    const opcode_t *o = &opcodes[op];
+    unsigned int word = p1 | (p2 << 8);
+    int n;
+
+    switch (o->mode) {
+        case M_IMP:
+        case M_ACC:
+            n = sprintf(buf, "%02X          ", op);
+            break;
+        case M_ABS:
+        case M_ABX:
+        case M_ABY:
+        case M_IND:
+            n = sprintf(buf, "%02X %02X %02X    ", op, p1, p2);
+            break;
+        default:
+            n = sprintf(buf, "%02X %02X       ", op, p1);
+            break;
+    }
+    buf += n;
+
+    switch (o->mode) {
+        case M_IMP:
+            sprintf(buf, "%s", o->mnemonic);
+            break;
+        case M_ACC:
+            sprintf(buf, "%s A", o->mnemonic);
+            break;
+        case M_IMM:
+            sprintf(buf, "%s #$%02X", o->mnemonic, p1);
+            break;
+        case M_ZP:
+            sprintf(buf, "%s $%02X", o->mnemonic, p1);
+            break;
+        case M_ZPX:
+            sprintf(buf, "%s $%02X,X", o->mnemonic, p1);
+            break;
+        case M_ZPY:
+            sprintf(buf, "%s $%02X,Y", o->mnemonic, p1);
+            break;
+        case M_ABS:
+            sprintf(buf, "%s $%04X", o->mnemonic, word);
+            break;
+        case M_ABX:
+            sprintf(buf, "%s $%04X,X", o->mnemonic, word);
+            break;
+        case M_ABY:
+            sprintf(buf, "%s $%04X,Y", o->mnemonic, word);
+            break;
+        case M_IND:
+            sprintf(buf, "%s ($%04X)", o->mnemonic, word);
+            break;
+        case M_INX:
+            sprintf(buf, "%s ($%02X,X)", o->mnemonic, p1);
+            break;
+        case M_INY:
+            sprintf(buf, "%s ($%02X),Y", o->mnemonic, p1);
+            break;
+        case M_REL:
+            sprintf(buf, "%s $%04X", o->mnemonic,
+                    (pc + 2 + (unsigned int)(int8_t)p1) & 0xffff);
+            break;
+    }
+}
+
+static void print_record(unsigned int origin, const state_t *s, uint8_t op,
+                         uint8_t p1, uint8_t p2)
+{
+    char dis[32];
+    char line[128];
+
+    if ((filter_origin >= 0 && (unsigned int)filter_origin != origin)
+        || s->cycle < cycle_from || s->cycle > cycle_to
+        || s->pc < pc_from || s->pc > pc_to) {
+        return;
+    }
+
+    disassemble(dis, s->pc, op, p1, p2);
+    sprintf(line, ".%.4s:%04x  %-26s A:%02x X:%02x Y:%02x SP:%02x %c%c-%c%c%c%c%c %12"PRIu64,
+            memspace_string[origin], s->pc, dis,
+            s->reg_a, s->reg_x, s->reg_y, s->reg_sp,
+            (s->reg_st & (1 << 7)) ? 'N' : '.',
+            (s->reg_st & (1 << 6)) ? 'V' : '.',
+            (s->reg_st & (1 << 4)) ? 'B' : '.',
+            (s->reg_st & (1 << 3)) ? 'D' : '.',
+            (s->reg_st & (1 << 2)) ? 'I' : '.',
+            (s->reg_st & (1 << 1)) ? 'Z' : '.',
+            (s->reg_st & (1 << 0)) ? 'C' : '.',
+            s->cycle);
+
+    if (grep_string != NULL && strstr(line, grep_string) == NULL) {
+        return;
+    }
+
+    total_shown++;
+    if (!stats_only) {
+        puts(line);
+    }
+}
+
+/* Decode the records of one block, return -1 if it is damaged.  */
+static int decode_block(const uint8_t *p, size_t size, uint32_t records)
+{
+    state_t state[CHISTRACE_ORIGINS];
+    const uint8_t *end = p + size;
+    uint32_t i;
+
+    memset(state, 0, sizeof(state));
+
+    for (i = 0; i < records; i++) {
+        state_t *s;
+        int64_t delta;
+        uint8_t flags, op, p1, p2;
+
+        if (p >= end) {
+            return -1;
+        }
+        flags = *p++;
+        s = &state[flags & (CHISTRACE_ORIGINS - 1)];
+
+        if ((p = get_varint(p, end, &delta)) == NULL) {
+            return -1;
+        }
+        s->cycle += (uint64_t)delta;
+        if ((p = get_varint(p, end, &delta)) == NULL) {
+            return -1;
+        }
+        s->pc = (unsigned int)((int64_t)s->pc + delta) & 0xffff;
+
+        if (end - p < 3) {
+            return -1;
+        }
+        op = *p++;
+        p1 = *p++;
+        p2 = *p++;
+
+        if (flags & CHISTRACE_FLAG_A) {
+            if (p >= end) {
+                return -1;
+            }
+            s->reg_a = *p++;
+        }
+        if (flags & CHISTRACE_FLAG_X) {
+            if (p >= end) {
+                return -1;
+            }
+            s->reg_x = *p++;
+        }
+        if (flags & CHISTRACE_FLAG_Y) {
+            if (p >= end) {
+                return -1;
+            }
+            s->reg_y = *p++;
+        }
+        if (flags & CHISTRACE_FLAG_SP) {
+            if (p >= end) {
+                return -1;
+            }
+            s->reg_sp = *p++;
+        }
+        if (flags & CHISTRACE_FLAG_ST) {
+            if (p >= end) {
+                return -1;
+            }
+            s->reg_st = *p++;
+        }
+
+        total_records++;
+        print_record(flags & (CHISTRACE_ORIGINS - 1), s, op, p1, p2);
+    }
+    return 0;
+}
+
+static int decode_file(const char *filename)
+{
+    FILE *fp;
+    uint8_t magic[CHISTRACE_MAGIC_LEN + 1];
+    uint8_t header[CHISTRACE_BLOCK_HEADER];
+    uint8_t *stored = NULL, *raw = NULL;
+    int result = 0;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "chistrace: cannot open `%s'.\n", filename);
+        return -1;
+    }
+
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic)
+        || memcmp(magic, CHISTRACE_MAGIC, CHISTRACE_MAGIC_LEN) != 0) {
+        fprintf(stderr, "chistrace: `%s' is not a cpu history trace.\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    if (magic[CHISTRACE_MAGIC_LEN] != CHISTRACE_VERSION) {
+        fprintf(stderr, "chistrace: `%s' has unknown version %d.\n",
+                filename, magic[CHISTRACE_MAGIC_LEN]);
+        fclose(fp);
+        return -1;
+    }
+
+    /* A trace cut short (the emulator did not exit cleanly) ends with a
+       partial block, which is quietly ignored.  */
+    while (fread(header, 1, sizeof(header), fp) == sizeof(header)) {
+        uint32_t raw_size = get_dword(header);
+        uint32_t stored_size = get_dword(header + 4);
+        uint32_t records = get_dword(header + 8);
+        const uint8_t *data;
+
+        stored = realloc(stored, stored_size ? stored_size : 1);
+        if (stored == NULL) {
+            fprintf(stderr, "chistrace: out of memory.\n");
+            result = -1;
+            break;
+        }
+        if (fread(stored, 1, stored_size, fp) != stored_size) {
+            break;
+        }
+
+        if (header[12] == CHISTRACE_METHOD_STORED && stored_size == raw_size) {
+            data = stored;
+#ifdef HAVE_ZLIB
+        } else if (header[12] == CHISTRACE_METHOD_ZLIB) {
+            uLongf len = raw_size;
+
+            raw = realloc(raw, raw_size ? raw_size : 1);
+            if (raw == NULL) {
+                fprintf(stderr, "chistrace: out of memory.\n");
+                result = -1;
+                break;
+            }
+            if (uncompress(raw, &len, stored, stored_size) != Z_OK
+                || len != raw_size) {
+                fprintf(stderr, "chistrace: damaged block %u.\n", total_blocks);
+                result = -1;
+                break;
+            }
+            data = raw;
+#endif
+        } else {
+            fprintf(stderr, "chistrace: cannot decode block %u (method %d).\n",
+                    total_blocks, header[12]);
+            result = -1;
+            break;
+        }
+
+        if (decode_block(data, raw_size, records) < 0) {
+            fprintf(stderr, "chistrace: damaged block %u.\n", total_blocks);
+            result = -1;
+            break;
+        }
+        total_blocks++;
+        total_raw += raw_size;
+        total_stored += CHISTRACE_BLOCK_HEADER + stored_size;
+    }
+
+    free(stored);
+    free(raw);
+    fclose(fp);
+    return result;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int parse_range(const char *arg, int base, uint64_t *from, uint64_t *to)
+{
+    char *end;
+
+    *from = strtoull(arg, &end, base);
+    if (end == arg) {
+        return -1;
+    }
+    if (*end == '\0') {
+        *to = *from;
+        return 0;
+    }
+    if (*end != '-') {
+        return -1;
+    }
+    arg = end + 1;
+    if (*arg == '\0') {
+        return 0;
+    }
+    *to = strtoull(arg, &end, base);
+    if (end == arg || *end != '\0' || *to < *from) {
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *progname)
+{
+    printf("Usage: %s [options] <trace file>\n"
+           "\n"
+           "  -m <memspace>   only show the cpu of memspace C, 8, 9, 10 or 11\n"
+           "  -c <from-to>    only show the cycles from-to (decimal, either may be left out)\n"
+           "  -p <from-to>    only show the PCs from-to (hex)\n"
+           "  -g <string>     only show the lines containing string\n"
+           "  -s              print statistics instead of the lines\n",
+           progname);
+}
+
+int main(int argc, char **argv)
+{
+    const char *progname = argv[0];
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "-s")) {
+            stats_only = 1;
+            continue;
+        }
+        if (i + 1 == argc) {
+            break;
+        }
+        if (!strcmp(argv[i], "-m")) {
+            int m;
+
+            for (m = 1; m < 6; m++) {
+                if (!strcmp(argv[i + 1], memspace_string[m])) {
+                    break;
+                }
+            }
+            if (m == 6) {
+                fprintf(stderr, "chistrace: unknown memspace `%s'.\n", argv[i + 1]);
+                return EXIT_FAILURE;
+            }
+            filter_origin = m;
+            i++;
+        } else if (!strcmp(argv[i], "-c")) {
+            uint64_t to = UINT64_MAX;
+
+            if (parse_range(argv[++i], 10, &cycle_from, &to) < 0) {
+                fprintf(stderr, "chistrace: bad cycle range `%s'.\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            cycle_to = to;
+        } else if (!strcmp(argv[i], "-p")) {
+            uint64_t from, to = 0xffff;
+
+            if (parse_range(argv[++i], 16, &from, &to) < 0 || to > 0xffff) {
+                fprintf(stderr, "chistrace: bad PC range `%s'.\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            pc_from = (unsigned int)from;
+            pc_to = (unsigned int)to;
+        } else if (!strcmp(argv[i], "-g")) {
+            grep_string = argv[++i];
+        } else {
+            break;
+        }
+    }
+
+    if (i != argc - 1) {
+        usage(progname);
+        return EXIT_FAILURE;
+    }
+
+    if (decode_file(argv[i]) < 0 && total_blocks == 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (stats_only) {
+        printf("%u blocks, %"PRIu64" instructions, %"PRIu64" matching\n"
+               "%"PRIu64" bytes of records, %"PRIu64" bytes in the file\n",
+               total_blocks, total_records, total_shown, total_raw,
+               total_stored + CHISTRACE_MAGIC_LEN + 1);
+    }
+    return EXIT_SUCCESS;
+}
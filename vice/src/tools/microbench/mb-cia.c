@@ -0,0 +1,183 @@
+/*
+ * mb-cia.c - Benchmark the CIA core timers.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Timer A runs continuously and underflows every 100 cycles, timer B
+   counts its underflows and the TOD clock runs.  A fake CPU steps four
+   cycles per instruction, dispatches the alarms like the CPU cores do,
+   acknowledges every interrupt by reading the ICR and polls the timers
+   now and then.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "cia.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "microbench.h"
+#include "types.h"
+
+#define MB_CIA_CYCLES_PER_SEC   985248
+#define MB_CIA_POWER_FREQ       50
+#define MB_CIA_TA_LATCH         100
+#define MB_CIA_TB_LATCH         10
+
+static CLOCK mb_clk;
+static int mb_rmw_flag;
+static int mb_irq;
+static alarm_context_t *mb_alarm_context;
+static interrupt_cpu_status_t *mb_int_status;
+static cia_context_t *mb_cia;
+
+static void mb_cia_set_int_clk(cia_context_t *cia_context, int value, CLOCK clk)
+{
+    mb_irq = value;
+}
+
+static void mb_cia_restore_int(cia_context_t *cia_context, int value)
+{
+    mb_irq = value;
+}
+
+static void mb_cia_store_port(cia_context_t *cia_context, CLOCK rclk, uint8_t byte)
+{
+}
+
+static uint8_t mb_cia_read_port(cia_context_t *cia_context)
+{
+    return 0xff;
+}
+
+static void mb_cia_store_sdr(cia_context_t *cia_context, uint8_t byte)
+{
+}
+
+static void mb_cia_nothing(cia_context_t *cia_context)
+{
+}
+
+static void mb_cia_pulse_ciapc(cia_context_t *cia_context, CLOCK rclk)
+{
+}
+
+static int mb_cia_setup(const char *filename)
+{
+    cia_context_t *cia;
+
+    if (filename != NULL) {
+        fprintf(stderr, "microbench: cia does not take a recording.\n");
+        return -1;
+    }
+
+    /* past the reset sequence, stores look one cycle back */
+    mb_clk = 7;
+    mb_rmw_flag = 0;
+    mb_irq = 0;
+    mb_alarm_context = alarm_context_new("MicrobenchCIA");
+    mb_int_status = lib_calloc(1, sizeof(interrupt_cpu_status_t));
+
+    cia = lib_calloc(1, sizeof(cia_context_t));
+    cia->rmw_flag = &mb_rmw_flag;
+    cia->clk_ptr = &mb_clk;
+    cia->power_freq = MB_CIA_POWER_FREQ;
+    cia->ticks_per_sec = MB_CIA_CYCLES_PER_SEC;
+    cia->todticks = MB_CIA_CYCLES_PER_SEC / MB_CIA_POWER_FREQ;
+    ciacore_setup_context(cia);
+    cia->model = CIA_MODEL_6526;
+    cia->irq_line = IK_IRQ;
+    cia->myname = lib_msprintf("CIA");
+
+    cia->undump_ciapa = mb_cia_store_port;
+    cia->undump_ciapb = mb_cia_store_port;
+    cia->store_ciapa = mb_cia_store_port;
+    cia->store_ciapb = mb_cia_store_port;
+    cia->store_sdr = mb_cia_store_sdr;
+    cia->read_ciapa = mb_cia_read_port;
+    cia->read_ciapb = mb_cia_read_port;
+    cia->read_ciaicr = mb_cia_nothing;
+    cia->read_sdr = mb_cia_nothing;
+    cia->cia_set_int_clk = mb_cia_set_int_clk;
+    cia->cia_restore_int = mb_cia_restore_int;
+    cia->do_reset_cia = mb_cia_nothing;
+    cia->pulse_ciapc = mb_cia_pulse_ciapc;
+
+    ciacore_init(cia, mb_alarm_context, mb_int_status);
+    ciacore_reset(cia);
+    mb_cia = cia;
+
+    ciacore_store(cia, CIA_TAL, MB_CIA_TA_LATCH & 0xff);
+    ciacore_store(cia, CIA_TAH, MB_CIA_TA_LATCH >> 8);
+    ciacore_store(cia, CIA_TBL, MB_CIA_TB_LATCH & 0xff);
+    ciacore_store(cia, CIA_TBH, MB_CIA_TB_LATCH >> 8);
+    ciacore_store(cia, CIA_TOD_HR, 0x01);
+    ciacore_store(cia, CIA_TOD_TEN, 0x00);
+    ciacore_store(cia, CIA_ICR, CIA_IM_SET | CIA_IM_TA | CIA_IM_TB);
+    ciacore_store(cia, CIA_CRB, CIA_CRB_INMODE_TA | CIA_CR_FORCE_LOAD | CIA_CR_START);
+    ciacore_store(cia, CIA_CRA, CIA_CRA_TODIN_50HZ | CIA_CR_FORCE_LOAD | CIA_CR_START);
+
+    return 0;
+}
+
+static uint64_t mb_cia_run(uint64_t cycles)
+{
+    CLOCK stop_clk = mb_clk + cycles;
+    unsigned int sum = 0;
+    unsigned int n = 0;
+
+    while (mb_clk < stop_clk) {
+        mb_clk += 4;
+        while (mb_clk >= alarm_context_next_pending_clk(mb_alarm_context)) {
+            alarm_context_dispatch(mb_alarm_context, mb_clk);
+        }
+
+        if (mb_irq) {
+            /* the IRQ sequence, then the handler reads the ICR */
+            mb_clk += 7;
+            sum += ciacore_read(mb_cia, CIA_ICR);
+        } else if ((++n & 15) == 0) {
+            sum += ciacore_read(mb_cia, CIA_TAL);
+            sum += ciacore_read(mb_cia, CIA_TBL);
+            sum += ciacore_read(mb_cia, CIA_TOD_TEN);
+        }
+    }
+
+    microbench_sink = sum;
+    return mb_clk;
+}
+
+static void mb_cia_shutdown(void)
+{
+    ciacore_shutdown(mb_cia);
+    alarm_context_destroy(mb_alarm_context);
+    lib_free(mb_int_status);
+}
+
+const microbench_t microbench_cia = {
+    "cia",
+    "CIA timer A, timer B and TOD with interrupts",
+    mb_cia_setup,
+    mb_cia_run,
+    mb_cia_shutdown
+};
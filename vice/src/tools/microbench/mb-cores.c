@@ -0,0 +1,36 @@
+/*
+ * mb-cores.c - The emulator sources under test.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The cores are built from their sources here instead of being taken from
+   the emulator libraries, so they get the flags the tool is built with
+   (CFLAGS="..." make -C src/tools/microbench) and no more of the emulator
+   than they need.  The 6510 core is included by mb-cpu.c.  */
+
+#include "vice.h"
+
+#include "alarm.c"
+#include "core/ciacore.c"
+#include "core/ciatimer.c"
+#include "drive/rotation.c"
+#include "viciisc/vicii-chip-model.c"
+#include "viciisc/vicii-draw-cycle.c"
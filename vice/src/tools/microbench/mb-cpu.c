@@ -0,0 +1,264 @@
+/*
+ * mb-cpu.c - Benchmark the 6510 core on a flat RAM bus.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* 6510core.c is included the way drivecpu.c does it, as that needs the
+   fewest hooks into the rest of the emulator, but every memory access goes
+   straight to a 64k array instead of through the read/store tables.  The
+   opcode emulation is the same as in the main CPU.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "6510core.h"
+#include "alarm.h"
+#include "debug.h"
+#include "interrupt.h"
+#include "lib.h"
+#include "microbench.h"
+#include "monitor.h"
+#include "mos6510.h"
+#include "traps.h"
+#include "types.h"
+
+#define DRIVE_CPU
+
+/* The history would need the monitor.  */
+#undef FEATURE_CPUMEMHISTORY
+
+#define MB_CPU_START    0x0200
+
+/* A copy loop with some arithmetic, an indirect indexed read and a
+   subroutine doing shifts, which together touch most addressing modes.  */
+static const uint8_t mb_cpu_program[] = {
+    0xa2, 0x00,             /* $0200  LDX #$00     */
+    0xbd, 0x00, 0x10,       /* $0202  LDA $1000,X  */
+    0x49, 0x55,             /* $0205  EOR #$55     */
+    0x9d, 0x00, 0x20,       /* $0207  STA $2000,X  */
+    0x71, 0x10,             /* $020a  ADC ($10),Y  */
+    0xe8,                   /* $020c  INX          */
+    0xd0, 0xf3,             /* $020d  BNE $0202    */
+    0x20, 0x17, 0x02,       /* $020f  JSR $0217    */
+    0xe6, 0x20,             /* $0212  INC $20      */
+    0x4c, 0x00, 0x02,       /* $0214  JMP $0200    */
+    0xa0, 0x08,             /* $0217  LDY #$08     */
+    0x06, 0x21,             /* $0219  ASL $21      */
+    0x2a,                   /* $021b  ROL A        */
+    0x88,                   /* $021c  DEY          */
+    0xd0, 0xfa,             /* $021d  BNE $0219    */
+    0x60                    /* $021f  RTS          */
+};
+
+/* The opcode fetch reads up to four bytes at once.  */
+static uint8_t mb_ram[0x10000 + 4];
+
+static mos6510_regs_t mb_regs;
+static CLOCK mb_clk;
+static int mb_rmw_flag;
+static unsigned int mb_last_opcode_info;
+static unsigned int mb_last_opcode_addr;
+static unsigned int mb_start;
+static int mb_bank_start;
+static int mb_bank_limit;
+static uint8_t *mb_bank_base;
+static alarm_context_t *mb_alarm_context;
+static interrupt_cpu_status_t *mb_int_status;
+
+/* Load a .prg file and start it at its load address.  */
+static int mb_cpu_load(const char *filename)
+{
+    FILE *f;
+    uint8_t addr[2];
+    size_t len;
+
+    f = fopen(filename, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "microbench: cannot open `%s'.\n", filename);
+        return -1;
+    }
+    if (fread(addr, 1, 2, f) != 2) {
+        fclose(f);
+        fprintf(stderr, "microbench: `%s' is not a .prg file.\n", filename);
+        return -1;
+    }
+    mb_start = addr[0] | (addr[1] << 8);
+    len = fread(mb_ram + mb_start, 1, 0x10000 - mb_start, f);
+    fclose(f);
+
+    return len > 0 ? 0 : -1;
+}
+
+/* A function, so the dummy reads are not statements without effect.  */
+inline static uint8_t mb_cpu_load_byte(uint16_t addr)
+{
+    return mb_ram[addr];
+}
+
+static int mb_cpu_setup(const char *filename)
+{
+    unsigned int i;
+
+    for (i = 0; i < 0x10000; i++) {
+        mb_ram[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    mb_ram[0x10] = 0x00;
+    mb_ram[0x11] = 0x30;
+
+    if (filename != NULL) {
+        if (mb_cpu_load(filename) < 0) {
+            return -1;
+        }
+    } else {
+        mb_start = MB_CPU_START;
+        memcpy(mb_ram + mb_start, mb_cpu_program, sizeof(mb_cpu_program));
+    }
+
+    /* a JAM or BRK starts over */
+    for (i = 0xfffa; i < 0x10000; i += 2) {
+        mb_ram[i] = mb_start & 0xff;
+        mb_ram[i + 1] = mb_start >> 8;
+    }
+
+    memset(&mb_regs, 0, sizeof(mb_regs));
+    mb_regs.pc = mb_start;
+    mb_regs.sp = 0xff;
+    mb_regs.p = P_INTERRUPT;
+    mb_clk = 0;
+    mb_rmw_flag = 0;
+    mb_last_opcode_info = 0;
+    mb_last_opcode_addr = 0;
+    mb_bank_base = mb_ram;
+    mb_bank_start = 0;
+    mb_bank_limit = 0xfffd;
+
+    mb_alarm_context = alarm_context_new("MicrobenchCPU");
+    mb_int_status = lib_calloc(1, sizeof(interrupt_cpu_status_t));
+    mb_int_status->last_opcode_info_ptr = &mb_last_opcode_info;
+    mb_int_status->global_pending_int = IK_NONE;
+    mb_alarm_context->event_clk = &mb_int_status->next_event_clk;
+
+    return 0;
+}
+
+static void mb_cpu_jam(void)
+{
+    mb_regs.pc = mb_start;
+}
+
+static void mb_cpu_reset(void)
+{
+    mb_int_status->global_pending_int = IK_NONE;
+    mb_int_status->next_event_clk = 0;
+}
+
+static uint64_t mb_cpu_run(uint64_t cycles)
+{
+    CLOCK stop_clk = mb_clk + cycles;
+
+#define reg_a   (mb_regs.a)
+#define reg_x   (mb_regs.x)
+#define reg_y   (mb_regs.y)
+#define reg_pc  (mb_regs.pc)
+#define reg_sp  (mb_regs.sp)
+#define reg_p   (mb_regs.p)
+#define flag_z  (mb_regs.z)
+#define flag_n  (mb_regs.n)
+#define ORIGIN_MEMSPACE  e_comp_space
+
+#define LOAD(a)           mb_cpu_load_byte((uint16_t)(a))
+#define LOAD_ZERO(a)      mb_cpu_load_byte((uint8_t)(a))
+#define LOAD_ADDR(a)      (LOAD((a)) | (LOAD((a) + 1) << 8))
+#define LOAD_ZERO_ADDR(a) (LOAD_ZERO((a)) | (LOAD_ZERO((a) + 1) << 8))
+#define STORE(a, b)       (mb_ram[(uint16_t)(a)] = (uint8_t)(b))
+#define STORE_ZERO(a, b)  (mb_ram[(uint8_t)(a)] = (uint8_t)(b))
+
+#define LOAD_DUMMY(a)           LOAD(a)
+#define LOAD_ZERO_DUMMY(a)      LOAD_ZERO(a)
+#define LOAD_ADDR_DUMMY(a)      LOAD_ADDR(a)
+#define LOAD_ZERO_ADDR_DUMMY(a) LOAD_ZERO_ADDR(a)
+#define STORE_DUMMY(a, b)       STORE(a, b)
+#define STORE_ZERO_DUMMY(a, b)  STORE_ZERO(a, b)
+
+#define JUMP(addr) (reg_pc = (unsigned int)((addr) & 0xffff))
+
+#define CLK mb_clk
+#define RMW_FLAG mb_rmw_flag
+#define PAGE_ONE (mb_ram + 0x100)
+#define LAST_OPCODE_INFO mb_last_opcode_info
+#define LAST_OPCODE_ADDR mb_last_opcode_addr
+#define TRACEFLG 0
+
+#define CPU_INT_STATUS mb_int_status
+
+#define ALARM_CONTEXT mb_alarm_context
+
+#define CPU_EVENT_CLK
+
+#define JAM() mb_cpu_jam()
+
+#define ROM_TRAP_ALLOWED() 0
+
+#define ROM_TRAP_HANDLER() ((uint32_t)-1)
+
+#define CALLER e_comp_space
+
+#define DMA_FUNC
+
+#define DMA_ON_RESET
+
+/* There is no disk, so the SO line never changes.  */
+#define drivecpu_byte_ready_egde_clear()
+#define drivecpu_rotate()
+#define drivecpu_byte_ready() 0
+
+#define interrupt_check_irq_delay(cs, cpu_clk) 1
+#define interrupt_check_nmi_delay(cs, cpu_clk) 1
+
+#define cpu_reset() mb_cpu_reset()
+#define bank_limit mb_bank_limit
+#define bank_start mb_bank_start
+#define bank_base mb_bank_base
+
+    while (mb_clk < stop_clk) {
+#include "6510core.c"
+    }
+
+    microbench_sink = reg_a ^ reg_x ^ reg_y ^ mb_ram[0x20];
+    return mb_clk;
+}
+
+static void mb_cpu_shutdown(void)
+{
+    alarm_context_destroy(mb_alarm_context);
+    lib_free(mb_int_status);
+}
+
+const microbench_t microbench_cpu = {
+    "cpu",
+    "6510 core on a flat RAM bus, -f runs a .prg",
+    mb_cpu_setup,
+    mb_cpu_run,
+    mb_cpu_shutdown
+};
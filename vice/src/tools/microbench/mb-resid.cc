@@ -0,0 +1,202 @@
+/*
+ * mb-resid.cc - Benchmark reSID on a stream of register writes.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* A 6581 resamples to 44100 Hz the way the sound code uses it.  The writes
+   come from a recording made with the `dump' sound device (lines of
+   "cycles-since-last-write register value", see -soundrecdev dump and
+   -soundrecarg <file>) or, without -f, from a built in frame by frame
+   sweep of the three voices and the filter.  The stream is replayed in a
+   loop.  */
+
+#include "vice.h"
+
+#ifdef HAVE_RESID
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "microbench.h"
+
+#include "resid/sid.h"
+
+using namespace reSID;
+
+#define MB_RESID_CLOCK      985248
+#define MB_RESID_RATE       44100
+#define MB_RESID_PASSBAND   (MB_RESID_RATE * 0.45)
+#define MB_RESID_FPS        50
+#define MB_RESID_FRAMES     500
+#define MB_RESID_BUFFER     4096
+
+typedef struct mb_resid_write_s {
+    unsigned int delta;
+    uint8_t reg;
+    uint8_t value;
+} mb_resid_write_t;
+
+static mb_resid_write_t *mb_writes;
+static size_t mb_num_writes;
+static size_t mb_max_writes;
+static SID *mb_sid;
+static short mb_buffer[MB_RESID_BUFFER];
+
+static void mb_resid_add(unsigned int delta, unsigned int reg, unsigned int value)
+{
+    if (mb_num_writes == mb_max_writes) {
+        mb_max_writes = mb_max_writes ? mb_max_writes * 2 : 1024;
+        mb_writes = (mb_resid_write_t *)realloc(mb_writes, mb_max_writes * sizeof(mb_resid_write_t));
+        if (mb_writes == NULL) {
+            fprintf(stderr, "microbench: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    mb_writes[mb_num_writes].delta = delta;
+    mb_writes[mb_num_writes].reg = (uint8_t)(reg & 0x1f);
+    mb_writes[mb_num_writes].value = (uint8_t)value;
+    mb_num_writes++;
+}
+
+/* The dump device also writes the chip state on flushes, only the lines
+   with three numbers are writes.  */
+static int mb_resid_load(const char *filename)
+{
+    FILE *f;
+    char line[256];
+    unsigned int delta, reg, value;
+
+    f = fopen(filename, "r");
+    if (f == NULL) {
+        fprintf(stderr, "microbench: cannot open `%s'.\n", filename);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%u %u %u", &delta, &reg, &value) == 3) {
+            mb_resid_add(delta, reg, value);
+        }
+    }
+    fclose(f);
+
+    if (mb_num_writes == 0) {
+        fprintf(stderr, "microbench: no register writes in `%s'.\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+/* The same noise, pulse and sawtooth sweep as -residbench.  */
+static void mb_resid_generate(void)
+{
+    int frame, i;
+
+    for (i = 0; i < 3; i++) {
+        mb_resid_add(0, i * 7 + 2, 0x00);
+        mb_resid_add(0, i * 7 + 3, 0x08);
+        mb_resid_add(0, i * 7 + 5, 0x00);
+        mb_resid_add(0, i * 7 + 6, 0xf0);
+    }
+    mb_resid_add(0, 0x04, 0x81);
+    mb_resid_add(0, 0x0b, 0x41);
+    mb_resid_add(0, 0x12, 0x21);
+    mb_resid_add(0, 0x17, 0xf1);
+    mb_resid_add(0, 0x18, 0x1f);
+
+    for (frame = 0; frame < MB_RESID_FRAMES; frame++) {
+        for (i = 0; i < 3; i++) {
+            int freq = (frame * 397 + i * 1231) & 0xffff;
+
+            mb_resid_add(i == 0 ? MB_RESID_CLOCK / MB_RESID_FPS : 10, i * 7 + 0, freq & 0xff);
+            mb_resid_add(10, i * 7 + 1, freq >> 8);
+        }
+        mb_resid_add(10, 0x15, frame & 7);
+        mb_resid_add(10, 0x16, (frame * 3) & 0xff);
+    }
+}
+
+static int mb_resid_setup(const char *filename)
+{
+    mb_num_writes = 0;
+    if (filename != NULL) {
+        if (mb_resid_load(filename) < 0) {
+            return -1;
+        }
+    } else {
+        mb_resid_generate();
+    }
+
+    mb_sid = new SID;
+    mb_sid->set_chip_model(MOS6581);
+    mb_sid->set_sampling_parameters(MB_RESID_CLOCK, SAMPLE_RESAMPLE, MB_RESID_RATE,
+                                    MB_RESID_PASSBAND);
+    return 0;
+}
+
+static uint64_t mb_resid_run(uint64_t cycles)
+{
+    uint64_t done = 0;
+    unsigned int sum = 0;
+    size_t i = 0;
+
+    while (done < cycles) {
+        const mb_resid_write_t *w = &mb_writes[i];
+        cycle_count delta_t = (cycle_count)w->delta;
+
+        done += w->delta;
+        while (delta_t > 0) {
+            int n = mb_sid->clock(delta_t, mb_buffer, MB_RESID_BUFFER);
+
+            if (n > 0) {
+                sum += (unsigned int)mb_buffer[n - 1];
+            }
+        }
+        mb_sid->write(w->reg, w->value);
+
+        if (++i == mb_num_writes) {
+            i = 0;
+            /* a recording without any delays would never get anywhere */
+            if (done == 0) {
+                break;
+            }
+        }
+    }
+
+    microbench_sink = sum;
+    return done;
+}
+
+static void mb_resid_shutdown(void)
+{
+    delete mb_sid;
+    free(mb_writes);
+    mb_writes = NULL;
+    mb_max_writes = 0;
+}
+
+extern "C" const microbench_t microbench_resid = {
+    "resid",
+    "reSID 6581 with resampling, -f replays a `dump' sound device file",
+    mb_resid_setup,
+    mb_resid_run,
+    mb_resid_shutdown
+};
+
+#endif
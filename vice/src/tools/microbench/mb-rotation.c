@@ -0,0 +1,198 @@
+/*
+ * mb-rotation.c - Benchmark the 1541 GCR disk rotation.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The disk spins under the head with the read circuit simulation that is
+   used for .g64 images, while a fake drive CPU polls for the next byte
+   every three cycles the way a `BVC *' loop does and reads it.  The track
+   holds 21 formatted sectors of GCR encoded data, -f reads a raw GCR
+   track instead.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "drive.h"
+#include "drivetypes.h"
+#include "lib.h"
+#include "microbench.h"
+#include "rotation.h"
+#include "types.h"
+
+#define MB_ROTATION_TRACK_SIZE  7692
+#define MB_ROTATION_SECTORS     21
+#define MB_ROTATION_RPM         30000
+
+/* The drive emulation keeps the units here, rotation.c looks them up.  */
+diskunit_context_t *diskunit_context[NUM_DISK_UNITS];
+
+static const uint8_t mb_gcr_nybble[16] = {
+    0x0a, 0x0b, 0x12, 0x13, 0x0e, 0x0f, 0x16, 0x17,
+    0x09, 0x19, 0x1a, 0x1b, 0x0d, 0x1d, 0x1e, 0x15
+};
+
+static CLOCK mb_clk;
+static uint8_t mb_track[MB_ROTATION_TRACK_SIZE];
+static unsigned int mb_track_size;
+static diskunit_context_t *mb_unit;
+static drive_t *mb_drive;
+
+/* Encode 4 bytes into 5 GCR bytes.  */
+static void mb_gcr_encode(uint8_t *dest, const uint8_t *src)
+{
+    uint64_t bits = 0;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        bits = (bits << 10) | (mb_gcr_nybble[src[i] >> 4] << 5) | mb_gcr_nybble[src[i] & 15];
+    }
+    for (i = 4; i >= 0; i--) {
+        dest[i] = (uint8_t)bits;
+        bits >>= 8;
+    }
+}
+
+static unsigned int mb_fill(unsigned int pos, uint8_t value, unsigned int count)
+{
+    memset(mb_track + pos, value, count);
+    return pos + count;
+}
+
+/* Sync, header, gap, sync, 325 bytes of encoded data and gap per sector,
+   the rest of the track is gap.  */
+static void mb_format_track(void)
+{
+    unsigned int pos = 0;
+    int sector, i;
+
+    for (sector = 0; sector < MB_ROTATION_SECTORS; sector++) {
+        uint8_t raw[4];
+
+        pos = mb_fill(pos, 0xff, 5);
+        raw[0] = 0x08;
+        raw[1] = (uint8_t)(sector ^ 18);
+        raw[2] = (uint8_t)sector;
+        raw[3] = 18;
+        mb_gcr_encode(mb_track + pos, raw);
+        raw[0] = raw[1] = 0x30;
+        raw[2] = raw[3] = 0x0f;
+        mb_gcr_encode(mb_track + pos + 5, raw);
+        pos = mb_fill(pos + 10, 0x55, 9);
+
+        pos = mb_fill(pos, 0xff, 5);
+        for (i = 0; i < 65; i++) {
+            raw[0] = (uint8_t)(i == 0 ? 0x07 : sector * 31 + i * 4);
+            raw[1] = (uint8_t)(sector * 31 + i * 4 + 1);
+            raw[2] = (uint8_t)(sector * 31 + i * 4 + 2);
+            raw[3] = (uint8_t)(sector * 31 + i * 4 + 3);
+            mb_gcr_encode(mb_track + pos, raw);
+            pos += 5;
+        }
+        pos = mb_fill(pos, 0x55, 8);
+    }
+    mb_fill(pos, 0x55, MB_ROTATION_TRACK_SIZE - pos);
+    mb_track_size = MB_ROTATION_TRACK_SIZE;
+}
+
+static int mb_rotation_load(const char *filename)
+{
+    FILE *f;
+
+    f = fopen(filename, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "microbench: cannot open `%s'.\n", filename);
+        return -1;
+    }
+    mb_track_size = (unsigned int)fread(mb_track, 1, sizeof(mb_track), f);
+    fclose(f);
+
+    return mb_track_size > 0 ? 0 : -1;
+}
+
+static int mb_rotation_setup(const char *filename)
+{
+    if (filename != NULL) {
+        if (mb_rotation_load(filename) < 0) {
+            return -1;
+        }
+    } else {
+        mb_format_track();
+    }
+
+    mb_clk = 0;
+    mb_unit = lib_calloc(1, sizeof(diskunit_context_t));
+    mb_drive = lib_calloc(1, sizeof(drive_t));
+    mb_unit->mynumber = 0;
+    mb_unit->clk_ptr = &mb_clk;
+    mb_unit->drives[0] = mb_drive;
+    diskunit_context[0] = mb_unit;
+
+    mb_drive->diskunit = mb_unit;
+    mb_drive->GCR_image_loaded = 1;
+    mb_drive->complicated_image_loaded = 1;
+    mb_drive->GCR_track_start_ptr = mb_track;
+    mb_drive->GCR_current_track_size = mb_track_size;
+    mb_drive->read_write_mode = 1;
+    mb_drive->byte_ready_active = BRA_MOTOR_ON | BRA_BYTE_READY;
+    mb_drive->rpm = MB_ROTATION_RPM;
+
+    rotation_init(0, 0);
+    rotation_reset(mb_drive);
+
+    return 0;
+}
+
+static uint64_t mb_rotation_run(uint64_t cycles)
+{
+    CLOCK stop_clk = mb_clk + cycles;
+    unsigned int sum = 0;
+
+    while (mb_clk < stop_clk) {
+        mb_clk += 3;
+        rotation_rotate_disk(mb_drive);
+        if (mb_drive->byte_ready_edge) {
+            mb_drive->byte_ready_edge = 0;
+            mb_clk += 4;
+            rotation_byte_read(mb_drive);
+            sum += mb_drive->GCR_read + rotation_sync_found(mb_drive);
+        }
+    }
+
+    microbench_sink = sum;
+    return mb_clk;
+}
+
+static void mb_rotation_shutdown(void)
+{
+    diskunit_context[0] = NULL;
+    lib_free(mb_drive);
+    lib_free(mb_unit);
+}
+
+const microbench_t microbench_rotation = {
+    "rotation",
+    "1541 GCR read circuit, -f reads a raw GCR track",
+    mb_rotation_setup,
+    mb_rotation_run,
+    mb_rotation_shutdown
+};
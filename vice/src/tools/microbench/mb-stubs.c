@@ -0,0 +1,347 @@
+/*
+ * mb-stubs.c - dummies for the parts of the emulator the cores call.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* None of these run while a benchmark is timed, except for the memory
+   functions.  Errors go to stderr, everything else the cores log is
+   dropped.  */
+
+#include "vice.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interrupt.h"
+#include "lib.h"
+#include "log.h"
+#include "monitor.h"
+#include "snapshot.h"
+#include "tracezone.h"
+#include "types.h"
+
+/* ------------------------------------------------------------------------- */
+/* lib.c */
+
+static void *mb_alloc_check(void *p)
+{
+    if (p == NULL) {
+        fprintf(stderr, "microbench: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void *lib_malloc_pinpoint(size_t size, const char *name, unsigned int line)
+#elif defined(LIB_ALLOC_STATS)
+void *lib_malloc_counted(size_t size, const char *name, unsigned int line)
+#else
+void *lib_malloc(size_t size)
+#endif
+{
+    return mb_alloc_check(malloc(size ? size : 1));
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void *lib_calloc_pinpoint(size_t nmemb, size_t size, const char *name, unsigned int line)
+#elif defined(LIB_ALLOC_STATS)
+void *lib_calloc_counted(size_t nmemb, size_t size, const char *name, unsigned int line)
+#else
+void *lib_calloc(size_t nmemb, size_t size)
+#endif
+{
+    return mb_alloc_check(calloc(nmemb ? nmemb : 1, size ? size : 1));
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void *lib_realloc_pinpoint(void *p, size_t size, const char *name, unsigned int line)
+#elif defined(LIB_ALLOC_STATS)
+void *lib_realloc_counted(void *p, size_t size, const char *name, unsigned int line)
+#else
+void *lib_realloc(void *p, size_t size)
+#endif
+{
+    return mb_alloc_check(realloc(p, size ? size : 1));
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void lib_free_pinpoint(void *p, const char *name, unsigned int line)
+#else
+void lib_free(void *p)
+#endif
+{
+    free(p);
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+char *lib_strdup_pinpoint(const char *str, const char *name, unsigned int line)
+#elif defined(LIB_ALLOC_STATS)
+char *lib_strdup_counted(const char *str, const char *name, unsigned int line)
+#else
+char *lib_strdup(const char *str)
+#endif
+{
+    size_t len = strlen(str) + 1;
+
+    return memcpy(mb_alloc_check(malloc(len)), str, len);
+}
+
+#ifdef LIB_ALLOC_STATS
+char *lib_msprintf_counted(const char *name, unsigned int line, const char *fmt, ...)
+#else
+char *lib_msprintf(const char *fmt, ...)
+#endif
+{
+    va_list args;
+    char *p;
+    int len;
+
+    va_start(args, fmt);
+    len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    p = mb_alloc_check(malloc((size_t)len + 1));
+    va_start(args, fmt);
+    vsnprintf(p, (size_t)len + 1, fmt, args);
+    va_end(args);
+    return p;
+}
+
+/* The same numbers on every run.  */
+unsigned int lib_unsigned_rand(unsigned int min, unsigned int max)
+{
+    static uint32_t state = 0x1234abcd;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return min + (unsigned int)(((uint64_t)state * ((uint64_t)(max - min) + 1)) >> 32);
+}
+
+/* ------------------------------------------------------------------------- */
+/* log.c */
+
+log_t log_open(const char *id)
+{
+    return LOG_DEFAULT;
+}
+
+int log_message(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+int log_warning(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+int log_error(log_t log, const char *format, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "microbench: ");
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    return 0;
+}
+
+int log_debug(const char *format, ...)
+{
+    return 0;
+}
+
+int log_verbose(const char *format, ...)
+{
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* monitor */
+
+unsigned monitor_mask[NUM_MEMSPACES];
+
+int mon_out(const char *format, ...)
+{
+    return 0;
+}
+
+void monitor_startup(MEMSPACE mem)
+{
+}
+
+int monitor_force_import(MEMSPACE mem)
+{
+    return 0;
+}
+
+void monitor_check_icount(uint16_t a)
+{
+}
+
+void monitor_check_icount_interrupt(void)
+{
+}
+
+void monitor_check_watchpoints(unsigned int lastpc, unsigned int pc)
+{
+}
+
+int monitor_check_breakpoints(MEMSPACE mem, uint16_t addr)
+{
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* tracezone.c, the alarm dispatch zones are never recorded */
+
+#ifdef USE_TRACE_ZONES
+int tracezone_enabled = 0;
+
+void tracezone_begin(int zone)
+{
+}
+
+void tracezone_end(int zone)
+{
+}
+
+int tracezone_register(const char *name)
+{
+    return 0;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* interrupt.c */
+
+unsigned int interrupt_cpu_status_int_new(interrupt_cpu_status_t *cs, const char *name)
+{
+    return 0;
+}
+
+void interrupt_ack_dma(interrupt_cpu_status_t *cs)
+{
+    cs->global_pending_int &= ~IK_DMA;
+}
+
+void interrupt_ack_reset(interrupt_cpu_status_t *cs)
+{
+    cs->global_pending_int &= ~IK_RESET;
+}
+
+void interrupt_do_trap(interrupt_cpu_status_t *cs, uint16_t address)
+{
+    cs->global_pending_int &= ~IK_TRAP;
+}
+
+/* ------------------------------------------------------------------------- */
+/* snapshot.c, the drivers never save or load a snapshot */
+
+snapshot_module_t *snapshot_module_create(snapshot_t *s, const char *name, uint8_t major_version, uint8_t minor_version)
+{
+    return NULL;
+}
+
+snapshot_module_t *snapshot_module_open(snapshot_t *s, const char *name, uint8_t *major_version_return, uint8_t *minor_version_return)
+{
+    return NULL;
+}
+
+int snapshot_module_close(snapshot_module_t *m)
+{
+    return -1;
+}
+
+int snapshot_module_write_byte(snapshot_module_t *m, uint8_t data)
+{
+    return -1;
+}
+
+int snapshot_module_write_word(snapshot_module_t *m, uint16_t data)
+{
+    return -1;
+}
+
+int snapshot_module_write_dword(snapshot_module_t *m, uint32_t data)
+{
+    return -1;
+}
+
+int snapshot_module_write_qword(snapshot_module_t *m, uint64_t data)
+{
+    return -1;
+}
+
+int snapshot_module_write_double(snapshot_module_t *m, double db)
+{
+    return -1;
+}
+
+int snapshot_module_write_byte_array(snapshot_module_t *m, const uint8_t *data, unsigned int num)
+{
+    return -1;
+}
+
+int snapshot_module_read_byte(snapshot_module_t *m, uint8_t *b_return)
+{
+    return -1;
+}
+
+int snapshot_module_read_word(snapshot_module_t *m, uint16_t *w_return)
+{
+    return -1;
+}
+
+int snapshot_module_read_dword(snapshot_module_t *m, uint32_t *dw_return)
+{
+    return -1;
+}
+
+int snapshot_module_read_qword(snapshot_module_t *m, uint64_t *qw_return)
+{
+    return -1;
+}
+
+int snapshot_module_read_byte_array(snapshot_module_t *m, uint8_t *b_return, unsigned int num)
+{
+    return -1;
+}
+
+int snapshot_module_read_byte_into_int(snapshot_module_t *m, int *value_return)
+{
+    return -1;
+}
+
+int snapshot_module_read_dword_into_int(snapshot_module_t *m, int *value_return)
+{
+    return -1;
+}
+
+int snapshot_module_read_dword_into_uint(snapshot_module_t *m, unsigned int *value_return)
+{
+    return -1;
+}
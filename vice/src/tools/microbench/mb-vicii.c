@@ -0,0 +1,213 @@
+/*
+ * mb-vicii.c - Benchmark the cycle based VIC-II drawing.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Only viciisc/vicii-draw-cycle.c is timed.  The setup records what the
+   fetch and border logic of a PAL 6569 hand to it during a frame of a
+   text screen with a sprite, and the run replays that recording cycle by
+   cycle, the way vicii_cycle() calls vicii_draw_cycle().  */
+
+#include "vice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lib.h"
+#include "microbench.h"
+#include "types.h"
+#include "vicii.h"
+#include "viciisc/vicii-chip-model.h"
+#include "viciisc/vicii-draw-cycle.h"
+#include "viciisc/vicii-resources.h"
+#include "viciisc/viciitypes.h"
+
+#define MB_VICII_LINES          312
+#define MB_VICII_CYCLES         63
+#define MB_VICII_SPRITE_X       100
+#define MB_VICII_SPRITE_FIRST   100
+#define MB_VICII_SPRITE_LAST    120
+
+#define MB_VICII_VBORDER        0x01
+#define MB_VICII_MAIN_BORDER    0x02
+#define MB_VICII_IDLE           0x04
+
+/* What one cycle hands to the drawing.  */
+typedef struct mb_vicii_cycle_s {
+    uint8_t gbuf;
+    uint8_t flags;
+} mb_vicii_cycle_t;
+
+/* The VIC-II emulation keeps its state here, the drawing uses it.  */
+vicii_t vicii;
+vicii_resources_t vicii_resources;
+
+static uint8_t mb_charset[0x800];
+static uint8_t mb_screen[VICII_SCREEN_TEXTCOLS * 25];
+static uint8_t mb_colors[VICII_SCREEN_TEXTCOLS * 25];
+static mb_vicii_cycle_t *mb_frame;
+
+/* called by vicii_chip_model_init() */
+int vicii_color_update_palette(struct video_canvas_s *canvas)
+{
+    return 0;
+}
+
+static int mb_vicii_display_line(unsigned int line)
+{
+    return line >= VICII_25ROW_START_LINE && line < VICII_25ROW_STOP_LINE;
+}
+
+/* Run the fetch and border logic over one frame and keep what the drawing
+   gets to see.  */
+static void mb_vicii_record(void)
+{
+    unsigned int line, cycle;
+    int set_vborder = 1;
+    int vborder = 1;
+    int main_border = 1;
+
+    for (line = 0; line < MB_VICII_LINES; line++) {
+        int display = mb_vicii_display_line(line);
+        unsigned int row = (line - VICII_25ROW_START_LINE) >> 3;
+        unsigned int rc = (line - VICII_25ROW_START_LINE) & 7;
+        int vmli = 0;
+
+        if (line == VICII_25ROW_START_LINE) {
+            set_vborder = vborder = 0;
+        }
+        for (cycle = 0; cycle < MB_VICII_CYCLES; cycle++) {
+            unsigned int flags = vicii.cycle_table[cycle];
+            mb_vicii_cycle_t *c = &mb_frame[line * MB_VICII_CYCLES + cycle];
+
+            if (cycle_is_check_border_l(flags, 1)) {
+                if (line == VICII_25ROW_STOP_LINE) {
+                    set_vborder = 1;
+                }
+                vborder = set_vborder;
+                if (vborder == 0) {
+                    main_border = 0;
+                }
+            }
+            if (cycle_is_check_border_r(flags, 1)) {
+                main_border = 1;
+            }
+
+            c->gbuf = 0;
+            if (cycle_is_fetch_g(flags) && display && vmli < VICII_SCREEN_TEXTCOLS) {
+                c->gbuf = mb_charset[(mb_screen[row * VICII_SCREEN_TEXTCOLS + vmli] << 3) | rc];
+                vmli++;
+            }
+            c->flags = (vborder ? MB_VICII_VBORDER : 0)
+                       | (main_border ? MB_VICII_MAIN_BORDER : 0)
+                       | (display ? 0 : MB_VICII_IDLE);
+        }
+    }
+}
+
+static int mb_vicii_setup(const char *filename)
+{
+    int i;
+
+    if (filename != NULL) {
+        fprintf(stderr, "microbench: vicii does not take a recording.\n");
+        return -1;
+    }
+
+    for (i = 0; i < (int)sizeof(mb_charset); i++) {
+        mb_charset[i] = (uint8_t)((i * 37) ^ (i >> 3));
+    }
+    for (i = 0; i < (int)sizeof(mb_screen); i++) {
+        mb_screen[i] = (uint8_t)(i * 7);
+        mb_colors[i] = (uint8_t)(i % 15 + 1);
+    }
+
+    memset(&vicii, 0, sizeof(vicii));
+    vicii_resources.model = VICII_MODEL_6569;
+    vicii_chip_model_init();
+    vicii_draw_cycle_init();
+
+    vicii.regs[0x11] = 0x1b;
+    vicii.regs[0x15] = 0x01;
+    vicii.regs[0x16] = 0xc8;
+    vicii.regs[0x20] = 0x0e;
+    vicii.regs[0x21] = 0x06;
+    vicii.regs[0x27] = 0x01;
+    for (i = 0; i < VICII_NUM_SPRITES; i++) {
+        vicii.sprite[i].x = MB_VICII_SPRITE_X + i * 24;
+        vicii.sprite[i].data = 0xf0f0f0;
+    }
+
+    mb_frame = lib_malloc(MB_VICII_LINES * MB_VICII_CYCLES * sizeof(mb_vicii_cycle_t));
+    mb_vicii_record();
+
+    return 0;
+}
+
+static uint64_t mb_vicii_run(uint64_t cycles)
+{
+    uint64_t done = 0;
+    unsigned int line, cycle;
+
+    while (done < cycles) {
+        for (line = 0; line < MB_VICII_LINES; line++) {
+            unsigned int row = (line - VICII_25ROW_START_LINE) >> 3;
+
+            if (mb_vicii_display_line(line)) {
+                memcpy(vicii.vbuf, mb_screen + row * VICII_SCREEN_TEXTCOLS, VICII_SCREEN_TEXTCOLS);
+                memcpy(vicii.cbuf, mb_colors + row * VICII_SCREEN_TEXTCOLS, VICII_SCREEN_TEXTCOLS);
+            }
+            vicii.raster_line = line;
+            vicii.sprite_display_bits = (line >= MB_VICII_SPRITE_FIRST
+                                         && line <= MB_VICII_SPRITE_LAST) ? 0x01 : 0x00;
+
+            for (cycle = 0; cycle < MB_VICII_CYCLES; cycle++) {
+                const mb_vicii_cycle_t *c = &mb_frame[line * MB_VICII_CYCLES + cycle];
+
+                vicii.raster_cycle = cycle;
+                vicii.cycle_flags = vicii.cycle_table[cycle];
+                vicii.gbuf = c->gbuf;
+                vicii.vborder = c->flags & MB_VICII_VBORDER;
+                vicii.main_border = c->flags & MB_VICII_MAIN_BORDER;
+                vicii.idle_state = c->flags & MB_VICII_IDLE;
+                vicii_draw_cycle();
+            }
+            microbench_sink += vicii.dbuf[vicii.dbuf_offset / 2];
+        }
+        done += MB_VICII_LINES * MB_VICII_CYCLES;
+    }
+
+    return done;
+}
+
+static void mb_vicii_shutdown(void)
+{
+    vicii_draw_cycle_shutdown();
+    lib_free(mb_frame);
+}
+
+const microbench_t microbench_vicii = {
+    "vicii",
+    "VIC-II drawing of a recorded PAL frame",
+    mb_vicii_setup,
+    mb_vicii_run,
+    mb_vicii_shutdown
+};
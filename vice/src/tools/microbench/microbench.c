@@ -0,0 +1,190 @@
+/*
+ * microbench.c - Benchmark single chip cores outside of the emulators.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Each driver links one core (the 6510, the CIA, the 1541 GCR rotation,
+   the VIC-II drawing and reSID) with just enough of a fake machine around
+   it to keep it busy, and prints the host time per emulated cycle.  With
+   the noise of a full emulator gone, this is meant to compare compiler
+   flags, SIMD variants and data layout changes.  */
+
+#include "vice.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "microbench.h"
+
+#ifdef main
+#  if main == SDL_main
+#    undef main
+#  endif
+#endif
+
+#define MICROBENCH_CYCLES   10000000
+#define MICROBENCH_REPEATS  3
+
+static const microbench_t * const drivers[] = {
+    &microbench_cpu,
+    &microbench_cia,
+    &microbench_rotation,
+    &microbench_vicii,
+#ifdef HAVE_RESID
+    &microbench_resid,
+#endif
+    NULL
+};
+
+volatile unsigned int microbench_sink;
+
+/* Run a driver `repeats' times and report the fastest run, the others
+   mostly measure the host getting in the way.  */
+static int run_driver(const microbench_t *mb, uint64_t cycles, int repeats,
+                      const char *filename)
+{
+    double best = 0.0;
+    uint64_t done = 0;
+    int i;
+
+    for (i = 0; i < repeats; i++) {
+        clock_t start;
+        double seconds;
+        uint64_t n;
+
+        if (mb->setup(filename) < 0) {
+            fprintf(stderr, "microbench: %s: setup failed.\n", mb->name);
+            return -1;
+        }
+        start = clock();
+        n = mb->run(cycles);
+        seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        mb->shutdown();
+
+        if (i == 0 || seconds * done < best * n) {
+            best = seconds;
+            done = n;
+        }
+    }
+
+    if (done == 0) {
+        fprintf(stderr, "microbench: %s: no cycles emulated.\n", mb->name);
+        return -1;
+    }
+
+    printf("MICROBENCH: core=%s cycles=%"PRIu64" seconds=%.3f ns_per_cycle=%.3f\n",
+           mb->name, done, best, best * 1e9 / (double)done);
+    fflush(stdout);
+    return 0;
+}
+
+static const microbench_t *find_driver(const char *name)
+{
+    int i;
+
+    for (i = 0; drivers[i] != NULL; i++) {
+        if (!strcmp(drivers[i]->name, name)) {
+            return drivers[i];
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char *progname)
+{
+    int i;
+
+    printf("Usage: %s [options] [core...]\n"
+           "\n"
+           "  -c <cycles>     emulate this many cycles per run (default %d)\n"
+           "  -r <repeats>    report the fastest of this many runs (default %d)\n"
+           "  -f <file>       feed the core a recording instead of the built in one\n"
+           "\n"
+           "Cores (all if none is given):\n",
+           progname, MICROBENCH_CYCLES, MICROBENCH_REPEATS);
+    for (i = 0; drivers[i] != NULL; i++) {
+        printf("  %-16s%s\n", drivers[i]->name, drivers[i]->description);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *progname = argv[0];
+    const char *filename = NULL;
+    uint64_t cycles = MICROBENCH_CYCLES;
+    int repeats = MICROBENCH_REPEATS;
+    int result = EXIT_SUCCESS;
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (i + 1 == argc) {
+            usage(progname);
+            return EXIT_FAILURE;
+        }
+        if (!strcmp(argv[i], "-c")) {
+            cycles = strtoull(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-r")) {
+            repeats = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-f")) {
+            filename = argv[++i];
+        } else {
+            usage(progname);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cycles == 0 || repeats < 1) {
+        usage(progname);
+        return EXIT_FAILURE;
+    }
+
+    if (i == argc) {
+        int d;
+
+        if (filename != NULL) {
+            fprintf(stderr, "microbench: -f needs a single core.\n");
+            return EXIT_FAILURE;
+        }
+        for (d = 0; drivers[d] != NULL; d++) {
+            if (run_driver(drivers[d], cycles, repeats, NULL) < 0) {
+                result = EXIT_FAILURE;
+            }
+        }
+        return result;
+    }
+
+    for (; i < argc; i++) {
+        const microbench_t *mb = find_driver(argv[i]);
+
+        if (mb == NULL) {
+            fprintf(stderr, "microbench: unknown core `%s'.\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        if (run_driver(mb, cycles, repeats, filename) < 0) {
+            result = EXIT_FAILURE;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,60 @@
+/*
+ * microbench.h - Benchmark single chip cores outside of the emulators.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_MICROBENCH_H
+#define VICE_MICROBENCH_H
+
+#include <stdint.h>
+
+/* A driver runs one core on a synthetic or recorded input.  setup() is
+   called before every timed run with the file given by -f (or NULL) and
+   returns nonzero on failure, run() emulates at least the given number
+   of cycles and returns how many it did.  */
+typedef struct microbench_s {
+    const char *name;
+    const char *description;
+    int (*setup)(const char *filename);
+    uint64_t (*run)(uint64_t cycles);
+    void (*shutdown)(void);
+} microbench_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const microbench_t microbench_cpu;
+extern const microbench_t microbench_cia;
+extern const microbench_t microbench_rotation;
+extern const microbench_t microbench_vicii;
+#ifdef HAVE_RESID
+extern const microbench_t microbench_resid;
+#endif
+
+/* Keeps the compiler from dropping results that are never looked at.  */
+extern volatile unsigned int microbench_sink;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * sidreplay-stubs.c - What the SID engines need from the emulator.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include "vice.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "archdep.h"
+#include "lib.h"
+#include "log.h"
+#include "resources.h"
+#include "sid.h"
+#include "sidreplay.h"
+#include "sound.h"
+#include "types.h"
+#include "util.h"
+
+int sidreplay_model = SID_MODEL_6581;
+int sidreplay_sampling = SID_RESID_SAMPLING_RESAMPLING;
+
+/* fastsid reads the third oscillator with these, a recording has no reads */
+CLOCK maincpu_clk = 0;
+
+long sound_sample_position(void)
+{
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* resources.c */
+
+/* The defaults of sid-resources.c, with the model and the reSID sampling
+   method from the command line, and without the reSID table cache.  */
+int resources_get_int(const char *name, int *value_return)
+{
+    static const struct {
+        const char *name;
+        int value;
+    } values[] = {
+        { "SidFilters", 1 },
+        { "SidResidEnableRawOutput", 0 },
+        { "SidResidPassband", RESID_6581_PASSBAND_DEFAULT },
+        { "SidResidGain", RESID_6581_FILTER_GAIN_DEFAULT },
+        { "SidResidFilterBias", RESID_6581_FILTER_BIAS_DEFAULT },
+        { "SidResid8580Passband", RESID_8580_PASSBAND_DEFAULT },
+        { "SidResid8580Gain", RESID_8580_FILTER_GAIN_DEFAULT },
+        { "SidResid8580FilterBias", RESID_8580_FILTER_BIAS_DEFAULT },
+        { "SidResidTableCache", 0 },
+        { NULL, 0 }
+    };
+    int i;
+
+    if (strcmp(name, "SidModel") == 0) {
+        *value_return = sidreplay_model;
+        return 0;
+    }
+    if (strcmp(name, "SidResidSampling") == 0) {
+        *value_return = sidreplay_sampling;
+        return 0;
+    }
+    for (i = 0; values[i].name != NULL; i++) {
+        if (strcmp(name, values[i].name) == 0) {
+            *value_return = values[i].value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* lib.c */
+
+static void *sidreplay_alloc_check(void *p)
+{
+    if (p == NULL) {
+        fprintf(stderr, "sidreplay: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void *lib_malloc_pinpoint(size_t size, const char *name, unsigned int line)
+#elif defined(LIB_ALLOC_STATS)
+void *lib_malloc_counted(size_t size, const char *name, unsigned int line)
+#else
+void *lib_malloc(size_t size)
+#endif
+{
+    return sidreplay_alloc_check(malloc(size ? size : 1));
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void *lib_calloc_pinpoint(size_t nmemb, size_t size, const char *name, unsigned int line)
+#elif defined(LIB_ALLOC_STATS)
+void *lib_calloc_counted(size_t nmemb, size_t size, const char *name, unsigned int line)
+#else
+void *lib_calloc(size_t nmemb, size_t size)
+#endif
+{
+    return sidreplay_alloc_check(calloc(nmemb ? nmemb : 1, size ? size : 1));
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+void lib_free_pinpoint(void *p, const char *name, unsigned int line)
+#else
+void lib_free(void *p)
+#endif
+{
+    free(p);
+}
+
+#ifdef LIB_DEBUG_PINPOINT
+char *lib_strdup_pinpoint(const char *str, const char *name, unsigned int line)
+#elif defined(LIB_ALLOC_STATS)
+char *lib_strdup_counted(const char *str, const char *name, unsigned int line)
+#else
+char *lib_strdup(const char *str)
+#endif
+{
+    return sidreplay_alloc_check(strdup(str));
+}
+
+/* ------------------------------------------------------------------------- */
+/* log.c */
+
+int log_message(log_t log, const char *format, ...)
+{
+    return 0;
+}
+
+int log_warning(log_t log, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    fprintf(stderr, "sidreplay: ");
+    vfprintf(stderr, format, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* -residbench and the table cache, neither of which the replay uses */
+
+tick_t tick_per_second(void)
+{
+    return CLOCKS_PER_SEC;
+}
+
+tick_t tick_now(void)
+{
+    return (tick_t)clock();
+}
+
+tick_t tick_now_delta(tick_t previous_tick)
+{
+    return (tick_t)clock() - previous_tick;
+}
+
+const char *archdep_user_cache_path(void)
+{
+    return ".";
+}
+
+char *util_join_paths(const char *path, ...)
+{
+    return lib_strdup(path);
+}
@@ -0,0 +1,373 @@
+/*
+ * sidreplay.c - Replay a SID recording through a SID engine.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Feeds the register writes of a -sidrecord file to fastsid or reSID as
+   fast as the engine goes, the way the sound code does, and prints the
+   speed.  The engines are the ones in src/sid/libsid.a, so a build can
+   write its samples with -o and another build of the same engine can
+   compare its own against them with -d:
+
+       sidreplay -e resid -o before.raw tune.sidrec
+       (change reSID, rebuild)
+       sidreplay -e resid -d before.raw tune.sidrec
+
+   The samples are signed 16 bit in host byte order, one channel per SID.  */
+
+#include "vice.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lib.h"
+#include "sid.h"
+#include "sidrecord.h"
+#include "sidreplay.h"
+#include "sound.h"
+#include "types.h"
+
+#ifdef HAVE_FASTSID
+#include "fastsid.h"
+#endif
+#ifdef HAVE_RESID
+#include "resid.h"
+#endif
+
+#ifdef main
+#  if main == SDL_main
+#    undef main
+#  endif
+#endif
+
+#define SIDREPLAY_RATE      44100
+#define SIDREPLAY_BUFFER    4096
+
+typedef struct sidreplay_engine_s {
+    const char *name;
+    sid_engine_t *hooks;
+    int cycle_based;
+} sidreplay_engine_t;
+
+static const sidreplay_engine_t engines[] = {
+#ifdef HAVE_RESID
+    { "resid", &resid_hooks, 1 },
+#endif
+#ifdef HAVE_FASTSID
+    { "fastsid", &fastsid_hooks, 0 },
+#endif
+    { NULL, NULL, 0 }
+};
+
+/* The recording, without the header.  */
+static uint8_t *rec_data;
+static size_t rec_size;
+static unsigned int rec_cycles_per_sec;
+static int rec_chips;
+
+static const sidreplay_engine_t *engine;
+static sound_t *psid[SOUND_SIDS_MAX];
+static int16_t buffer[SIDREPLAY_BUFFER * SOUND_SIDS_MAX];
+static double clkstep;
+static double fclk;
+
+static FILE *out_fp;
+static FILE *diff_fp;
+static uint64_t samples;
+static uint64_t diff_first = UINT64_MAX;
+static uint64_t diff_count;
+
+/* ------------------------------------------------------------------------- */
+
+static void usage(const char *progname)
+{
+    int i;
+
+    printf("Usage: %s [options] file\n\n", progname);
+    printf("  -e <engine>     the SID engine:");
+    for (i = 0; engines[i].name != NULL; i++) {
+        printf(" %s%s", engines[i].name, i == 0 ? " (default)" : "");
+    }
+    printf("\n");
+    printf("  -m <model>      6581 or 8580 (default from the recording)\n");
+    printf("  -s <rate>       sample rate (default %d)\n", SIDREPLAY_RATE);
+    printf("  -x <method>     reSID sampling, 0 fast, 1 interpolating, 2 resampling\n");
+    printf("                  (default), 3 fast resampling\n");
+    printf("  -o <file>       write the samples to <file>\n");
+    printf("  -d <file>       compare the samples with <file> written by -o\n");
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+           | ((uint32_t)p[3] << 24);
+}
+
+/* Read the recording, and find the number of chips and the model.  */
+static int load_recording(const char *filename, int *model)
+{
+    FILE *f;
+    uint8_t header[SIDRECORD_HEADER_SIZE];
+    long size;
+    size_t pos;
+
+    f = fopen(filename, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "sidreplay: cannot open `%s'.\n", filename);
+        return -1;
+    }
+    if (fread(header, 1, sizeof(header), f) != sizeof(header)
+        || memcmp(header, SIDRECORD_MAGIC, SIDRECORD_MAGIC_LEN) != 0
+        || header[8] != SIDRECORD_VERSION) {
+        fprintf(stderr, "sidreplay: `%s' is not a SID recording.\n", filename);
+        fclose(f);
+        return -1;
+    }
+    *model = header[9];
+    rec_cycles_per_sec = get_le32(header + 12);
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f) - SIDRECORD_HEADER_SIZE;
+    fseek(f, SIDRECORD_HEADER_SIZE, SEEK_SET);
+    rec_data = lib_malloc(size > 0 ? size : 1);
+    rec_size = fread(rec_data, 1, size > 0 ? size : 0, f);
+    fclose(f);
+
+    rec_chips = 1;
+    pos = 0;
+    while (pos < rec_size) {
+        while (pos < rec_size && (rec_data[pos] & 0x80)) {
+            pos++;
+        }
+        if (pos + 2 >= rec_size) {
+            break;
+        }
+        if ((rec_data[pos + 1] >> 5) >= rec_chips) {
+            rec_chips = (rec_data[pos + 1] >> 5) + 1;
+        }
+        pos += 3;
+    }
+    return 0;
+}
+
+/* Hand the samples of all chips to -o and -d.  */
+static void put_samples(int nr)
+{
+    size_t count = (size_t)nr * rec_chips;
+
+    if (out_fp != NULL) {
+        fwrite(buffer, sizeof(int16_t), count, out_fp);
+    }
+    if (diff_fp != NULL) {
+        int16_t ref[SIDREPLAY_BUFFER * SOUND_SIDS_MAX];
+        size_t got = fread(ref, sizeof(int16_t), count, diff_fp);
+        size_t i;
+
+        for (i = 0; i < count; i++) {
+            if (i >= got || ref[i] != buffer[i]) {
+                if (diff_count++ == 0) {
+                    diff_first = samples + i / rec_chips;
+                }
+            }
+        }
+    }
+    samples += nr;
+}
+
+/* Run the chips for `cycles' cycles, the way sound.c does for the engine:
+   reSID is told the cycles and fills the buffer as far as they go, fastsid
+   is told how many samples the cycles are worth.  */
+static void render(CLOCK cycles)
+{
+    int c, nr;
+
+    if (engine->cycle_based) {
+        while (cycles > 0) {
+            CLOCK delta_t = 0;
+
+            nr = 0;
+            for (c = 0; c < rec_chips; c++) {
+                delta_t = cycles;
+                nr = engine->hooks->calculate_samples(psid[c], buffer + c, SIDREPLAY_BUFFER,
+                                                      rec_chips, &delta_t);
+            }
+            put_samples(nr);
+            cycles = delta_t;
+        }
+        return;
+    }
+
+    fclk += (double)cycles;
+    nr = (int)(fclk / clkstep);
+    fclk -= nr * clkstep;
+    while (nr > 0) {
+        int n = nr < SIDREPLAY_BUFFER ? nr : SIDREPLAY_BUFFER;
+        CLOCK delta_t = 0;
+
+        for (c = 0; c < rec_chips; c++) {
+            engine->hooks->calculate_samples(psid[c], buffer + c, n, rec_chips, &delta_t);
+        }
+        put_samples(n);
+        nr -= n;
+    }
+}
+
+static uint64_t replay(void)
+{
+    uint64_t cycles = 0;
+    size_t pos = 0;
+
+    while (pos < rec_size) {
+        CLOCK delta = 0;
+        int shift = 0;
+
+        while (pos < rec_size && (rec_data[pos] & 0x80)) {
+            delta |= (CLOCK)(rec_data[pos++] & 0x7f) << shift;
+            shift += 7;
+        }
+        if (pos + 2 >= rec_size) {
+            break;
+        }
+        delta |= (CLOCK)rec_data[pos++] << shift;
+
+        render(delta);
+        cycles += delta;
+
+        engine->hooks->store(psid[rec_data[pos] >> 5], rec_data[pos] & 0x1f, rec_data[pos + 1]);
+        pos += 2;
+    }
+    return cycles;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    const char *progname = argv[0];
+    const char *out_name = NULL;
+    const char *diff_name = NULL;
+    uint8_t sidstate[32];
+    int rate = SIDREPLAY_RATE;
+    int model = -1;
+    int rec_model;
+    uint64_t cycles;
+    clock_t start;
+    double seconds;
+    int result = EXIT_SUCCESS;
+    int c;
+
+    engine = &engines[0];
+    if (engine->name == NULL) {
+        fprintf(stderr, "sidreplay: built without a SID engine.\n");
+        return EXIT_FAILURE;
+    }
+
+    while (argc > 2 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "-e") == 0) {
+            for (c = 0; engines[c].name != NULL && strcmp(engines[c].name, argv[2]) != 0; c++) {
+            }
+            if (engines[c].name == NULL) {
+                fprintf(stderr, "sidreplay: unknown engine `%s'.\n", argv[2]);
+                return EXIT_FAILURE;
+            }
+            engine = &engines[c];
+        } else if (strcmp(argv[1], "-m") == 0) {
+            model = strcmp(argv[2], "8580") == 0 ? SID_MODEL_8580 : SID_MODEL_6581;
+        } else if (strcmp(argv[1], "-s") == 0) {
+            rate = atoi(argv[2]);
+        } else if (strcmp(argv[1], "-x") == 0) {
+            sidreplay_sampling = atoi(argv[2]);
+        } else if (strcmp(argv[1], "-o") == 0) {
+            out_name = argv[2];
+        } else if (strcmp(argv[1], "-d") == 0) {
+            diff_name = argv[2];
+        } else {
+            break;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc != 2 || argv[1][0] == '-' || rate <= 0) {
+        usage(progname);
+        return EXIT_FAILURE;
+    }
+
+    if (load_recording(argv[1], &rec_model) < 0) {
+        return EXIT_FAILURE;
+    }
+    sidreplay_model = model >= 0 ? model : rec_model;
+
+    if (out_name != NULL && (out_fp = fopen(out_name, "wb")) == NULL) {
+        fprintf(stderr, "sidreplay: cannot write `%s'.\n", out_name);
+        return EXIT_FAILURE;
+    }
+    if (diff_name != NULL && (diff_fp = fopen(diff_name, "rb")) == NULL) {
+        fprintf(stderr, "sidreplay: cannot open `%s'.\n", diff_name);
+        return EXIT_FAILURE;
+    }
+
+    memset(sidstate, 0, sizeof(sidstate));
+    for (c = 0; c < rec_chips; c++) {
+        psid[c] = engine->hooks->open(sidstate);
+        engine->hooks->init(psid[c], rate, (int)rec_cycles_per_sec, 1000);
+    }
+    clkstep = (double)rec_cycles_per_sec / rate;
+
+    start = clock();
+    cycles = replay();
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("SIDREPLAY: engine=%s chips=%d cycles=%"PRIu64" samples=%"PRIu64
+           " seconds=%.3f speed=%.1fx\n",
+           engine->name, rec_chips, cycles, samples, seconds,
+           seconds > 0.0 ? (double)cycles / rec_cycles_per_sec / seconds : 0.0);
+
+    if (diff_fp != NULL) {
+        int16_t extra;
+
+        /* the reference going on counts as a difference as well */
+        if (diff_count == 0 && fread(&extra, sizeof(extra), 1, diff_fp) == 1) {
+            diff_count = 1;
+            diff_first = samples;
+        }
+        if (diff_count > 0) {
+            printf("SIDREPLAY: %"PRIu64" samples differ from `%s', the first at sample %"PRIu64"\n",
+                   diff_count, diff_name, diff_first);
+            result = EXIT_FAILURE;
+        } else {
+            printf("SIDREPLAY: identical to `%s'\n", diff_name);
+        }
+        fclose(diff_fp);
+    }
+    if (out_fp != NULL) {
+        fclose(out_fp);
+    }
+
+    for (c = 0; c < rec_chips; c++) {
+        engine->hooks->close(psid[c]);
+    }
+    lib_free(rec_data);
+
+    return result;
+}
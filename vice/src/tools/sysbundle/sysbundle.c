@@ -0,0 +1,341 @@
+/*
+ * sysbundle.c - Create and list system file bundles.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The emulators search the system file bundle (sysfiles.vbd next to the
+   binary by default, see the SystemFileBundle resource) before the system
+   path.  This tool packs the files in the subdirectories of a VICE data
+   directory (C64/kernal..., DRIVES/dos1541..., ...) into a bundle, or
+   lists the contents of one.  */
+
+#include "vice.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef main
+#  if main == SDL_main
+#    undef main
+#  endif
+#endif
+
+/* Keep in sync with src/sysfile.h.  */
+#define SYSFILE_BUNDLE_MAGIC            "VICESYS\x1a"
+#define SYSFILE_BUNDLE_MAGIC_LEN        8
+#define SYSFILE_BUNDLE_VERSION          1
+#define SYSFILE_BUNDLE_HEADER_LEN       16
+#define SYSFILE_BUNDLE_ENTRY_LEN        10
+
+typedef struct entry_s {
+    char *name;     /* "<subdirectory>/<file name>" */
+    char *path;
+    uint32_t size;
+    uint32_t offset;
+} entry_t;
+
+static entry_t *entries = NULL;
+static unsigned int num_entries = 0;
+static unsigned int max_entries = 0;
+
+/* ------------------------------------------------------------------------- */
+
+static char *join(const char *a, const char *b)
+{
+    size_t la = strlen(a), lb = strlen(b);
+    char *s = malloc(la + lb + 2);
+
+    if (s == NULL) {
+        fprintf(stderr, "sysbundle: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(s, a, la);
+    s[la] = '/';
+    memcpy(s + la + 1, b, lb + 1);
+    return s;
+}
+
+static int is_dir(const char *path)
+{
+    struct stat st;
+
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void add_entry(const char *subdir, const char *filename, const char *path, uint32_t size)
+{
+    if (num_entries == max_entries) {
+        max_entries = max_entries ? max_entries * 2 : 256;
+        entries = realloc(entries, max_entries * sizeof(entry_t));
+        if (entries == NULL) {
+            fprintf(stderr, "sysbundle: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    entries[num_entries].name = join(subdir, filename);
+    entries[num_entries].path = strdup(path);
+    entries[num_entries].size = size;
+    num_entries++;
+}
+
+/* Add the regular files of one subdirectory of the data directory.  */
+static int scan_subdir(const char *datadir, const char *subdir)
+{
+    char *dirpath = join(datadir, subdir);
+    DIR *dir = opendir(dirpath);
+    struct dirent *de;
+
+    if (dir == NULL) {
+        free(dirpath);
+        return -1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        char *path;
+        struct stat st;
+
+        /* skip hidden files and the build files of a source tree */
+        if (de->d_name[0] == '.' || strncmp(de->d_name, "Makefile", 8) == 0) {
+            continue;
+        }
+        path = join(dirpath, de->d_name);
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            if ((uint64_t)st.st_size > 0x7fffffff
+                || strlen(subdir) + 1 + strlen(de->d_name) > 0xffff) {
+                fprintf(stderr, "sysbundle: skipping `%s'.\n", path);
+            } else {
+                add_entry(subdir, de->d_name, path, (uint32_t)st.st_size);
+            }
+        }
+        free(path);
+    }
+    closedir(dir);
+    free(dirpath);
+    return 0;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    return strcmp(((const entry_t *)a)->name, ((const entry_t *)b)->name);
+}
+
+static void put_dword(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_dword(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+           | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Copy a file into the bundle, it must still have the size it had when the
+   index was written.  */
+static int copy_file(FILE *out, const entry_t *e)
+{
+    uint8_t buf[0x4000];
+    FILE *in = fopen(e->path, "rb");
+    uint32_t left = e->size;
+
+    if (in == NULL) {
+        fprintf(stderr, "sysbundle: cannot open `%s'.\n", e->path);
+        return -1;
+    }
+    while (left > 0) {
+        size_t n = left < sizeof(buf) ? left : sizeof(buf);
+
+        if (fread(buf, 1, n, in) != n || fwrite(buf, 1, n, out) != n) {
+            fprintf(stderr, "sysbundle: cannot copy `%s'.\n", e->path);
+            fclose(in);
+            return -1;
+        }
+        left -= (uint32_t)n;
+    }
+    fclose(in);
+    return 0;
+}
+
+static int create_bundle(const char *bundle, const char *datadir)
+{
+    DIR *dir;
+    struct dirent *de;
+    FILE *out;
+    uint8_t header[SYSFILE_BUNDLE_HEADER_LEN];
+    uint64_t offset;
+    unsigned int i;
+
+    dir = opendir(datadir);
+    if (dir == NULL) {
+        fprintf(stderr, "sysbundle: cannot open directory `%s'.\n", datadir);
+        return -1;
+    }
+    while ((de = readdir(dir)) != NULL) {
+        char *path;
+
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        path = join(datadir, de->d_name);
+        if (is_dir(path)) {
+            scan_subdir(datadir, de->d_name);
+        }
+        free(path);
+    }
+    closedir(dir);
+
+    if (num_entries == 0) {
+        fprintf(stderr, "sysbundle: no files found in `%s'.\n", datadir);
+        return -1;
+    }
+    /* the emulators look the names up with a binary search */
+    qsort(entries, num_entries, sizeof(entry_t), compare_entries);
+
+    offset = SYSFILE_BUNDLE_HEADER_LEN;
+    for (i = 0; i < num_entries; i++) {
+        offset += SYSFILE_BUNDLE_ENTRY_LEN + strlen(entries[i].name);
+    }
+    for (i = 0; i < num_entries; i++) {
+        if (offset + entries[i].size > 0xffffffff) {
+            fprintf(stderr, "sysbundle: the bundle would be larger than 4 GiB.\n");
+            return -1;
+        }
+        entries[i].offset = (uint32_t)offset;
+        offset += entries[i].size;
+    }
+
+    out = fopen(bundle, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "sysbundle: cannot create `%s'.\n", bundle);
+        return -1;
+    }
+
+    memcpy(header, SYSFILE_BUNDLE_MAGIC, SYSFILE_BUNDLE_MAGIC_LEN);
+    put_dword(header + SYSFILE_BUNDLE_MAGIC_LEN, SYSFILE_BUNDLE_VERSION);
+    put_dword(header + SYSFILE_BUNDLE_MAGIC_LEN + 4, num_entries);
+    if (fwrite(header, 1, sizeof(header), out) != sizeof(header)) {
+        goto fail;
+    }
+    for (i = 0; i < num_entries; i++) {
+        uint8_t index[SYSFILE_BUNDLE_ENTRY_LEN];
+        size_t len = strlen(entries[i].name);
+
+        put_dword(index, entries[i].offset);
+        put_dword(index + 4, entries[i].size);
+        index[8] = (uint8_t)len;
+        index[9] = (uint8_t)(len >> 8);
+        if (fwrite(index, 1, sizeof(index), out) != sizeof(index)
+            || fwrite(entries[i].name, 1, len, out) != len) {
+            goto fail;
+        }
+    }
+    for (i = 0; i < num_entries; i++) {
+        if (copy_file(out, &entries[i]) < 0) {
+            fclose(out);
+            remove(bundle);
+            return -1;
+        }
+    }
+    if (fclose(out) != 0) {
+        fprintf(stderr, "sysbundle: cannot write `%s'.\n", bundle);
+        remove(bundle);
+        return -1;
+    }
+
+    printf("%u files, %"PRIu64" bytes\n", num_entries, offset);
+    return 0;
+
+fail:
+    fprintf(stderr, "sysbundle: cannot write `%s'.\n", bundle);
+    fclose(out);
+    remove(bundle);
+    return -1;
+}
+
+static int list_bundle(const char *bundle)
+{
+    FILE *in = fopen(bundle, "rb");
+    uint8_t header[SYSFILE_BUNDLE_HEADER_LEN];
+    uint32_t count, i;
+
+    if (in == NULL) {
+        fprintf(stderr, "sysbundle: cannot open `%s'.\n", bundle);
+        return -1;
+    }
+    if (fread(header, 1, sizeof(header), in) != sizeof(header)
+        || memcmp(header, SYSFILE_BUNDLE_MAGIC, SYSFILE_BUNDLE_MAGIC_LEN) != 0
+        || get_dword(header + SYSFILE_BUNDLE_MAGIC_LEN) != SYSFILE_BUNDLE_VERSION) {
+        fprintf(stderr, "sysbundle: `%s' is not a system file bundle.\n", bundle);
+        fclose(in);
+        return -1;
+    }
+    count = get_dword(header + SYSFILE_BUNDLE_MAGIC_LEN + 4);
+    for (i = 0; i < count; i++) {
+        uint8_t index[SYSFILE_BUNDLE_ENTRY_LEN];
+        static char name[0x10000];
+        unsigned int len;
+
+        if (fread(index, 1, sizeof(index), in) != sizeof(index)) {
+            break;
+        }
+        len = index[8] | (index[9] << 8);
+        if (fread(name, 1, len, in) != len) {
+            break;
+        }
+        name[len] = '\0';
+        printf("%10"PRIu32"  %s\n", get_dword(index + 4), name);
+    }
+    fclose(in);
+    if (i < count) {
+        fprintf(stderr, "sysbundle: `%s' is truncated.\n", bundle);
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(const char *progname)
+{
+    printf("Usage: %s -c <bundle> <data directory>\n"
+           "       %s -l <bundle>\n"
+           "\n"
+           "  -c    create a bundle of the files in the subdirectories of the data directory\n"
+           "  -l    list the files in a bundle\n",
+           progname, progname);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && !strcmp(argv[1], "-c")) {
+        return create_bundle(argv[2], argv[3]) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    if (argc == 3 && !strcmp(argv[1], "-l")) {
+        return list_bundle(argv[2]) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,308 @@
+/*
+ * tracezone.c - Timeline of the emulator threads in Chrome trace format.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* Built with --enable-trace-zones, -tracezones <file> records when each
+   thread enters and leaves the zones of tracezone.h and writes them at
+   exit in the JSON format of the Chrome trace viewer (chrome://tracing,
+   Perfetto), which the Tracy profiler can import as well.
+
+   The events go into one preallocated buffer; every thread takes the next
+   slot with an atomic increment and keeps its zone stack in thread local
+   storage, so recording takes no lock.  Once the buffer is full later
+   events are dropped.  */
+
+#include "vice.h"
+
+#include <stdio.h>
+
+#ifdef USE_TRACE_ZONES
+#include <stdatomic.h>
+#ifdef WINDOWS_COMPILE
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+#include "archdep.h"
+#include "cmdline.h"
+#include "lib.h"
+#include "log.h"
+#include "tracezone.h"
+#include "types.h"
+#include "util.h"
+
+#ifdef USE_TRACE_ZONES
+
+#define TRACEZONE_MAX_EVENTS    (1 << 22)   /* 64 MiB */
+#define TRACEZONE_MAX_ZONES     64
+#define TRACEZONE_MAX_THREADS   32
+#define TRACEZONE_MAX_DEPTH     32
+
+/* Marks the main CPU zone on the stack while a nested zone runs.  */
+#define TRACEZONE_SUSPENDED     0x8000
+
+#if defined(__GNUC__)
+#define TRACEZONE_THREAD_LOCAL  __thread
+#else
+#define TRACEZONE_THREAD_LOCAL  _Thread_local
+#endif
+
+typedef struct tracezone_event_s {
+    uint64_t ns;        /* since the trace was started */
+    uint16_t zone;
+    uint8_t thread;
+    uint8_t phase;      /* 'B', 'E', or 0 if the slot was never written */
+} tracezone_event_t;
+
+int tracezone_enabled = 0;
+
+static char *trace_filename = NULL;
+
+static tracezone_event_t *events = NULL;
+static atomic_uint next_event;
+static uint64_t start_ns;
+
+static const char *zone_names[TRACEZONE_MAX_ZONES] = {
+    "maincpu", "drive", "sound", "render handoff", "render", "vsync",
+    "yield", "sleep", "mainlock wait", "ui"
+};
+static char *registered_names[TRACEZONE_MAX_ZONES];
+static int num_zones = TRACEZONE_NUM;
+
+static atomic_int num_threads;
+static const char *thread_names[TRACEZONE_MAX_THREADS];
+
+static TRACEZONE_THREAD_LOCAL int thread_index = -1;
+static TRACEZONE_THREAD_LOCAL int depth = 0;
+static TRACEZONE_THREAD_LOCAL uint16_t stack[TRACEZONE_MAX_DEPTH];
+
+static uint64_t tracezone_now(void)
+{
+#ifdef WINDOWS_COMPILE
+    LARGE_INTEGER frequency, now;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static int tracezone_thread(void)
+{
+    if (thread_index < 0) {
+        thread_index = atomic_fetch_add(&num_threads, 1);
+        if (thread_index >= TRACEZONE_MAX_THREADS) {
+            thread_index = TRACEZONE_MAX_THREADS - 1;
+        }
+    }
+    return thread_index;
+}
+
+static void tracezone_record(int zone, int phase)
+{
+    tracezone_event_t *event;
+    unsigned int i;
+
+    if (atomic_load_explicit(&next_event, memory_order_relaxed) >= TRACEZONE_MAX_EVENTS) {
+        return;
+    }
+    i = atomic_fetch_add_explicit(&next_event, 1, memory_order_relaxed);
+    if (i >= TRACEZONE_MAX_EVENTS) {
+        return;
+    }
+
+    event = &events[i];
+    event->ns = tracezone_now() - start_ns;
+    event->zone = (uint16_t)zone;
+    event->thread = (uint8_t)tracezone_thread();
+    event->phase = (uint8_t)phase;
+}
+
+void tracezone_begin(int zone)
+{
+    if (depth > 0 && depth <= TRACEZONE_MAX_DEPTH
+        && stack[depth - 1] == TRACEZONE_MAINCPU) {
+        tracezone_record(TRACEZONE_MAINCPU, 'E');
+        stack[depth - 1] |= TRACEZONE_SUSPENDED;
+    }
+    if (depth < TRACEZONE_MAX_DEPTH) {
+        stack[depth] = (uint16_t)zone;
+    }
+    depth++;
+    tracezone_record(zone, 'B');
+}
+
+void tracezone_end(int zone)
+{
+    tracezone_record(zone, 'E');
+    if (depth > 0) {
+        depth--;
+    }
+    if (depth > 0 && depth <= TRACEZONE_MAX_DEPTH
+        && stack[depth - 1] == (TRACEZONE_MAINCPU | TRACEZONE_SUSPENDED)) {
+        stack[depth - 1] = TRACEZONE_MAINCPU;
+        tracezone_record(TRACEZONE_MAINCPU, 'B');
+    }
+}
+
+void tracezone_thread_name(const char *name)
+{
+    thread_names[tracezone_thread()] = name;
+}
+
+int tracezone_register(const char *name)
+{
+    if (num_zones == TRACEZONE_MAX_ZONES) {
+        return TRACEZONE_MAINCPU;
+    }
+    registered_names[num_zones] = lib_strdup(name);
+    zone_names[num_zones] = registered_names[num_zones];
+    return num_zones++;
+}
+
+void tracezone_write(void)
+{
+    FILE *fp;
+    unsigned int count;
+    unsigned int i;
+    int threads;
+    int first = 1;
+
+    if (trace_filename == NULL || events == NULL) {
+        return;
+    }
+    tracezone_enabled = 0;
+
+    fp = fopen(trace_filename, MODE_WRITE_TEXT);
+    if (fp == NULL) {
+        log_error(LOG_DEFAULT, "Cannot write trace `%s'.", trace_filename);
+        return;
+    }
+
+    count = atomic_load(&next_event);
+    if (count >= TRACEZONE_MAX_EVENTS) {
+        log_warning(LOG_DEFAULT, "Trace buffer full, only the first %d events were recorded.",
+                    TRACEZONE_MAX_EVENTS);
+        count = TRACEZONE_MAX_EVENTS;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    threads = atomic_load(&num_threads);
+    if (threads > TRACEZONE_MAX_THREADS) {
+        threads = TRACEZONE_MAX_THREADS;
+    }
+    for (i = 0; i < (unsigned int)threads; i++) {
+        if (thread_names[i] != NULL) {
+            fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",", i, thread_names[i]);
+            first = 0;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        tracezone_event_t *event = &events[i];
+
+        if (event->phase == 0) {
+            continue;
+        }
+        fprintf(fp, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%"PRIu64".%03u}",
+                first ? "" : ",", zone_names[event->zone],
+                event->zone < TRACEZONE_NUM ? "vice" : "alarm",
+                event->phase, event->thread,
+                event->ns / 1000, (unsigned int)(event->ns % 1000));
+        first = 0;
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    log_message(LOG_DEFAULT, "Wrote %u trace events to `%s'.", count, trace_filename);
+}
+
+void tracezone_shutdown(void)
+{
+    int i;
+
+    tracezone_enabled = 0;
+    lib_free(events);
+    events = NULL;
+    lib_free(trace_filename);
+    trace_filename = NULL;
+
+    for (i = TRACEZONE_NUM; i < num_zones; i++) {
+        lib_free(registered_names[i]);
+        registered_names[i] = NULL;
+        zone_names[i] = NULL;
+    }
+    num_zones = TRACEZONE_NUM;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int cmdline_tracezones(const char *param, void *extra_param)
+{
+    util_string_set(&trace_filename, param);
+
+    if (events == NULL) {
+        events = lib_calloc(TRACEZONE_MAX_EVENTS, sizeof(tracezone_event_t));
+    }
+    start_ns = tracezone_now();
+    tracezone_enabled = 1;
+    return 0;
+}
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-tracezones", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
+      cmdline_tracezones, NULL, NULL, NULL,
+      "<filename>", "Record the main loop phases of all threads and write them to <filename> as a Chrome trace at exit" },
+    CMDLINE_LIST_END
+};
+
+int tracezone_cmdline_options_init(void)
+{
+    return cmdline_register_options(cmdline_options);
+}
+
+#else
+
+void tracezone_write(void)
+{
+}
+
+void tracezone_shutdown(void)
+{
+}
+
+int tracezone_cmdline_options_init(void)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * tracezone.h - Timeline of the emulator threads in Chrome trace format.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_TRACEZONE_H
+#define VICE_TRACEZONE_H
+
+#include "vice.h"
+
+/* The zones with a fixed name.  Every alarm context registers a zone of
+   its own, named after the context.  */
+typedef enum tracezone_e {
+    TRACEZONE_MAINCPU,          /* main CPU between alarm dispatches */
+    TRACEZONE_DRIVE,            /* drive_cpu_execute_all() */
+    TRACEZONE_SOUND,            /* sound_flush() */
+    TRACEZONE_RENDER_HANDOFF,   /* passing a frame to the render thread */
+    TRACEZONE_RENDER,           /* render thread job */
+    TRACEZONE_VSYNC,            /* vsync_do_end_of_line() */
+    TRACEZONE_YIELD,            /* VICE thread lets the UI have the mainlock */
+    TRACEZONE_SLEEP,            /* VICE thread sleeps to keep the speed */
+    TRACEZONE_MAINLOCK_WAIT,    /* UI thread waits for the mainlock */
+    TRACEZONE_UI,               /* UI thread holds the mainlock */
+    TRACEZONE_NUM
+} tracezone_t;
+
+#ifdef USE_TRACE_ZONES
+
+extern int tracezone_enabled;
+
+/* Zones nest per thread; every TRACEZONE_BEGIN() needs the matching
+   TRACEZONE_END() on the same thread.  The main CPU zone is left open
+   while the CPU runs and is interrupted by any zone started inside.  */
+#define TRACEZONE_BEGIN(zone) \
+    do { if (tracezone_enabled) { tracezone_begin(zone); } } while (0)
+#define TRACEZONE_END(zone) \
+    do { if (tracezone_enabled) { tracezone_end(zone); } } while (0)
+#define TRACEZONE_THREAD_NAME(name) tracezone_thread_name(name)
+
+void tracezone_begin(int zone);
+void tracezone_end(int zone);
+void tracezone_thread_name(const char *name);
+
+/* Add a zone named `name'; used for the alarm contexts.  Only called while
+   the machine is being set up.  */
+int tracezone_register(const char *name);
+
+#else
+
+#define TRACEZONE_BEGIN(zone)
+#define TRACEZONE_END(zone)
+#define TRACEZONE_THREAD_NAME(name)
+
+#endif
+
+/* Write the trace, if one was requested with -tracezones.  Called by
+   machine_shutdown().  */
+void tracezone_write(void);
+
+int tracezone_cmdline_options_init(void);
+void tracezone_shutdown(void);
+
+#endif
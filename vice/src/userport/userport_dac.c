@@ -167,20 +167,25 @@ int userport_dac_resources_init(void)
 
 static uint8_t userport_dac_sound_data;
 
-static void userport_dac_store_pbx(uint8_t value, int pulse)
-{
-    userport_dac_sound_data = value;
-
-    /* call sound store function in order to update the sound output buffer */
-    sound_store(userport_dac_sound_chip_offset, value, 0);
-}
-
 struct userport_dac_sound_s {
     uint8_t voice0;
 };
 
 static struct userport_dac_sound_s snd;
 
+static void userport_dac_store_pbx(uint8_t value, int pulse)
+{
+    userport_dac_sound_data = value;
+
+    /* queue the store with its clock, or call sound store function in order
+       to update the sound output buffer */
+    if (sound_dac_store(&userport_dac_dac, (int)value * 128) == 0) {
+        snd.voice0 = value;
+    } else {
+        sound_store(userport_dac_sound_chip_offset, value, 0);
+    }
+}
+
 #ifdef SOUND_SYSTEM_FLOAT
 /* FIXME */
 static int userport_dac_sound_machine_calculate_samples(sound_t **psid, float *pbuf, int nr, int scc, CLOCK *delta_t)
@@ -214,6 +219,7 @@ static uint8_t userport_dac_sound_machine_read(sound_t *psid, uint16_t addr)
 
 static void userport_dac_sound_reset(sound_t *psid, CLOCK cpu_clk)
 {
+    sound_dac_discard(&userport_dac_dac);
     snd.voice0 = 0;
     userport_dac_sound_data = 0;
 }
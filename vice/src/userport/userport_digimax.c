@@ -136,8 +136,7 @@ static void userport_digimax_store_pbx(uint8_t value, int pulse)
             break;
     }
 
-    digimax_sound_data[addr] = value;
-    sound_store((uint16_t)(digimax_sound_chip_offset | addr), value, 0);
+    digimax_sound_dac_store(addr, value);
 }
 
 /* ---------------------------------------------------------------------*/
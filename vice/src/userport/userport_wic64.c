@@ -152,7 +152,6 @@ static userport_device_t userport_wic64_device = {
 
 static struct alarm_s *http_get_alarm = NULL;
 static struct alarm_s *http_post_alarm = NULL;
-static struct alarm_s *http_post_endalarm = NULL;
 static struct alarm_s *tcp_get_alarm = NULL;
 static struct alarm_s *tcp_send_alarm = NULL;
 static struct alarm_s *cmd_timeout_alarm = NULL;
@@ -183,12 +182,7 @@ static int wic64_colorize_log = 0;
 static char wic64_protocol = 'U'; /* invalid, so we see in trace even the legacy */
 static int big_load = 0;
 static char wic64_last_status[40]; /* according spec 40 bytes, hold status string. incl. \0 */
-static char *post_data = NULL;
-static size_t post_data_rcvd;
-static size_t post_data_new;
-static size_t post_data_size;
 static char *post_url = NULL;
-static int post_error;
 static int cheatlen = 0;
 
 static const resource_string_t wic64_resources[] =
@@ -401,16 +395,274 @@ static char *encoded_helper = NULL;
 #include <unistd.h>
 #endif
 #include <curl/curl.h>
+#include <pthread.h>
 
-#define MAX_PARALLEL 1 /* number of simultaneous transfers */
-#define NUM_URLS 10
-static int still_alive = 0;
-static CURLM *cm = NULL;               /* used for http(s) */
 static CURL *curl = NULL;              /* used for telnet */
 static uint8_t curl_buf[240];          /* this slows down by smaller chunks sent to C64, improves BBSs  */
 static uint8_t *curl_send_buf = NULL;
 static uint16_t curl_send_len;
 
+/* ---------------------------------------------------------------------*/
+/*    HTTP worker                                                       */
+
+/* HTTP requests run on a worker thread, so network latency never stalls
+   the emulation: the alarms polling for the result only look at a flag.
+   The worker uses the same curl handle for all requests, which keeps the
+   connection to the server alive and caches resolved host names.  */
+
+#define HTTP_JOB_GET    0
+#define HTTP_JOB_POST   1
+
+#define HTTP_DNS_CACHE_SECONDS  600
+
+typedef struct http_job_s {
+    int type;                   /* HTTP_JOB_GET or HTTP_JOB_POST */
+    char *url;
+    const char *user_agent;
+    uint8_t *post;              /* form data of a POST */
+    size_t post_len;
+    int verbose;
+
+    /* set by the worker, valid once done */
+    CURLcode result;
+    long response;
+    char *effective_url;
+    curl_off_t content_length;  /* -1 if the server didn't tell */
+    uint8_t *data;
+    size_t data_len;
+    size_t data_size;
+    int overflow;               /* reply was longer than HTTPREPLY_MAXLEN */
+
+    /* protected by http_lock */
+    int done;
+    int abandoned;              /* nobody waits for it, the worker frees it */
+    struct http_job_s *next;
+} http_job_t;
+
+static pthread_mutex_t http_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t http_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_t http_thread;
+static int http_thread_running = 0;
+static int http_thread_quit = 0;        /* protected by http_lock */
+static http_job_t *http_queue = NULL;   /* protected by http_lock */
+static http_job_t *http_job = NULL;     /* the job the emulation waits for */
+
+static void http_job_free(http_job_t *job)
+{
+    lib_free(job->url);
+    lib_free(job->post);
+    lib_free(job->effective_url);
+    lib_free(job->data);
+    lib_free(job);
+}
+
+static size_t http_worker_write(char *data, size_t n, size_t l, void *userp)
+{
+    http_job_t *job = userp;
+    size_t len = n * l;
+
+    if (job->data_len + len > HTTPREPLY_MAXLEN) {
+        job->overflow = 1;
+        len = HTTPREPLY_MAXLEN - job->data_len;
+    }
+    if (job->data_len + len > job->data_size) {
+        job->data_size = (job->data_len + len) * 2;
+        if (job->data_size > HTTPREPLY_MAXLEN) {
+            job->data_size = HTTPREPLY_MAXLEN;
+        }
+        job->data = lib_realloc(job->data, job->data_size);
+    }
+    memcpy(job->data + job->data_len, data, len);
+    job->data_len += len;
+
+    /* returning less than we got aborts the transfer */
+    return job->overflow ? len : n * l;
+}
+
+static int http_worker_progress(void *userp, curl_off_t dltotal, curl_off_t dlnow,
+                                curl_off_t ultotal, curl_off_t ulnow)
+{
+    http_job_t *job = userp;
+    int abort;
+
+    pthread_mutex_lock(&http_lock);
+    abort = job->abandoned || http_thread_quit;
+    pthread_mutex_unlock(&http_lock);
+    return abort;
+}
+
+static void http_worker_run(CURL *eh, http_job_t *job)
+{
+    curl_mime *mime = NULL;
+    curl_mimepart *part;
+    char *url = NULL;
+
+    /* keeps the open connections and the DNS cache */
+    curl_easy_reset(eh);
+
+    curl_easy_setopt(eh, CURLOPT_VERBOSE, job->verbose ? 1L : 0L);
+    curl_easy_setopt(eh, CURLOPT_URL, job->url);
+    curl_easy_setopt(eh, CURLOPT_USERAGENT, job->user_agent);
+    curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, http_worker_write);
+    curl_easy_setopt(eh, CURLOPT_WRITEDATA, job);
+    curl_easy_setopt(eh, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(eh, CURLOPT_XFERINFOFUNCTION, http_worker_progress);
+    curl_easy_setopt(eh, CURLOPT_XFERINFODATA, job);
+    curl_easy_setopt(eh, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(eh, CURLOPT_DNS_CACHE_TIMEOUT, (long)HTTP_DNS_CACHE_SECONDS);
+    /* work around bug 1964 (https://sourceforge.net/p/vice-emu/bugs/1964/) */
+#ifdef CURLSSLOPT_NATIVE_CA
+    curl_easy_setopt(eh, CURLOPT_SSL_OPTIONS, CURLSSLOPT_NATIVE_CA);
+#endif
+    if (job->type == HTTP_JOB_POST) {
+        /* Build an HTTP form with a single field named "data", */
+        mime = curl_mime_init(eh);
+        part = curl_mime_addpart(mime);
+        curl_mime_data(part, (const char *)job->post, job->post_len);
+        curl_mime_name(part, "data");
+        curl_easy_setopt(eh, CURLOPT_MIMEPOST, mime);
+    }
+
+    job->result = curl_easy_perform(eh);
+
+    job->response = 0;
+    curl_easy_getinfo(eh, CURLINFO_RESPONSE_CODE, &job->response);
+    if (curl_easy_getinfo(eh, CURLINFO_EFFECTIVE_URL, &url) == CURLE_OK && url != NULL) {
+        job->effective_url = lib_strdup(url);
+    }
+    if (curl_easy_getinfo(eh, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                          &job->content_length) != CURLE_OK) {
+        job->content_length = -1;
+    }
+
+    curl_mime_free(mime);
+}
+
+static void *http_worker_main(void *unused)
+{
+    CURL *eh = curl_easy_init();
+    http_job_t *job;
+
+    pthread_mutex_lock(&http_lock);
+    while (!http_thread_quit) {
+        if (http_queue == NULL) {
+            pthread_cond_wait(&http_wakeup, &http_lock);
+            continue;
+        }
+        job = http_queue;
+        http_queue = job->next;
+        pthread_mutex_unlock(&http_lock);
+
+        if (eh != NULL) {
+            http_worker_run(eh, job);
+        } else {
+            job->result = CURLE_FAILED_INIT;
+        }
+
+        pthread_mutex_lock(&http_lock);
+        if (job->abandoned) {
+            http_job_free(job);
+        } else {
+            job->done = 1;
+        }
+    }
+    pthread_mutex_unlock(&http_lock);
+
+    if (eh != NULL) {
+        curl_easy_cleanup(eh);
+    }
+    return NULL;
+}
+
+/* queue a request, returns NULL if the worker can't be started */
+static http_job_t *http_job_submit(int type, const char *url, const uint8_t *post, size_t post_len)
+{
+    http_job_t *job, **tail;
+
+    if (!http_thread_running) {
+        curl_global_init(CURL_GLOBAL_ALL);
+        http_thread_quit = 0;
+        if (pthread_create(&http_thread, NULL, http_worker_main, NULL) != 0) {
+            wic64_log(CONS_COL_RED, "%s: could not create the HTTP worker thread", __FUNCTION__);
+            curl_global_cleanup();
+            return NULL;
+        }
+        http_thread_running = 1;
+    }
+
+    job = lib_calloc(1, sizeof *job);
+    job->type = type;
+    job->url = lib_strdup(url);
+    job->user_agent = http_user_agent;
+    job->verbose = (wic64_loglevel > 1);
+    job->content_length = -1;
+    if (post != NULL) {
+        job->post = lib_malloc(post_len);
+        memcpy(job->post, post, post_len);
+        job->post_len = post_len;
+    }
+
+    pthread_mutex_lock(&http_lock);
+    for (tail = &http_queue; *tail != NULL; tail = &(*tail)->next) {
+    }
+    *tail = job;
+    pthread_cond_signal(&http_wakeup);
+    pthread_mutex_unlock(&http_lock);
+
+    return job;
+}
+
+static int http_job_done(void)
+{
+    int done;
+
+    pthread_mutex_lock(&http_lock);
+    done = http_job->done;
+    pthread_mutex_unlock(&http_lock);
+    return done;
+}
+
+/* stop waiting for the current job, a running transfer is aborted */
+static void http_job_release(void)
+{
+    if (http_job == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&http_lock);
+    if (http_job->done) {
+        http_job_free(http_job);
+    } else {
+        http_job->abandoned = 1;
+    }
+    pthread_mutex_unlock(&http_lock);
+    http_job = NULL;
+}
+
+static void http_worker_shutdown(void)
+{
+    http_job_t *job;
+
+    if (!http_thread_running) {
+        return;
+    }
+    http_job_release();
+
+    pthread_mutex_lock(&http_lock);
+    http_thread_quit = 1;
+    pthread_cond_signal(&http_wakeup);
+    pthread_mutex_unlock(&http_lock);
+    pthread_join(http_thread, NULL);
+    http_thread_running = 0;
+
+    /* requests the worker didn't get to */
+    while (http_queue != NULL) {
+        job = http_queue;
+        http_queue = job->next;
+        http_job_free(job);
+    }
+    curl_global_cleanup();
+}
+
 /* ------------------------------------------------------------------------- */
 static int userport_wic64_enable(int value)
 {
@@ -463,10 +715,7 @@ static int userport_wic64_enable(int value)
             lib_free(curl_send_buf);
             curl_send_buf = NULL;
         }
-        if (post_data) {
-            lib_free(post_data);
-            post_data = NULL;
-        }
+        http_worker_shutdown();
         if (curl) {
             /* connection closed */
             curl_easy_cleanup(curl);
@@ -485,10 +734,6 @@ static int userport_wic64_enable(int value)
             alarm_destroy(http_post_alarm);
             http_post_alarm = NULL;
         }
-        if (http_post_endalarm) {
-            alarm_destroy(http_post_endalarm);
-            http_post_endalarm = NULL;
-        }
         if (tcp_get_alarm) {
             alarm_destroy(tcp_get_alarm);
             tcp_get_alarm = NULL;
@@ -635,6 +880,7 @@ int userport_wic64_resources_init(void)
 void userport_wic64_resources_shutdown(void)
 {
     wic64_log(CONS_COL_NO, "%s: shutting down wic64", __FUNCTION__);
+    http_worker_shutdown();
     lib_free(default_server_hostname);
     lib_free(wic64_mac_address);
     lib_free(wic64_internal_ip);
@@ -867,45 +1113,6 @@ static void _hexdump(const char *col, const int lv, const char *buf, int len)
     hexdump(col, buf, len);
 }
 
-static size_t write_cb(char *data, size_t n, size_t l, void *userp)
-{
-    size_t tmp = httpbufferptr + n * l;
-
-    if (tmp >= HTTPREPLY_MAXLEN) {
-        wic64_log(CONS_COL_NO, "libcurl reply too long, dropping %"PRI_SIZE_T" bytes.\n",
-                  tmp - HTTPREPLY_MAXLEN);
-        return CURLE_WRITE_ERROR;
-    }
-    memcpy(&httpbuffer[httpbufferptr], data, n * l);
-    httpbufferptr += (n * l);
-    return n*l;
-}
-
-static void add_transfer(CURLM *cmulti, char *url)
-{
-    CURL *eh = curl_easy_init();
-    if (wic64_loglevel > 1) {
-        curl_easy_setopt(eh, CURLOPT_VERBOSE, 1L);
-    } else {
-        curl_easy_setopt(eh, CURLOPT_VERBOSE, 0L);
-    }
-    curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, write_cb);
-    curl_easy_setopt(eh, CURLOPT_URL, url);
-    curl_easy_setopt(eh, CURLOPT_PRIVATE, url);
-    /* work around bug 1964 (https://sourceforge.net/p/vice-emu/bugs/1964/) */
-#ifdef CURLSSLOPT_NATIVE_CA
-    curl_easy_setopt(eh, CURLOPT_SSL_OPTIONS, CURLSSLOPT_NATIVE_CA);
-#endif
-    /* set USERAGENT: otherwise the server won't return data, e.g. wicradio */
-    if (wic64_protocol == WIC64_PROT_LEGACY) {
-        http_user_agent = HTTP_AGENT_LEGACY;
-    } else {
-        http_user_agent = HTTP_AGENT_REVISED;
-    }
-    curl_easy_setopt(eh, CURLOPT_USERAGENT, http_user_agent);
-    curl_multi_add_handle(cmulti, eh);
-}
-
 static void update_prefs(uint8_t *buffer, size_t len)
 {
     /* manage preferences in memory only for now */
@@ -954,26 +1161,8 @@ static void update_prefs(uint8_t *buffer, size_t len)
 
 static void http_get_alarm_handler(CLOCK offset, void *data)
 {
-    CURLMsg *msg;
-    CURLMcode r;
-    int msgs_left = -1;
-    long response = -1;
-    char *url = "<unknown>";
-
-    r = curl_multi_perform(cm, &still_alive);
-    if (r != CURLM_OK) {
-        wic64_log(CONS_COL_NO, "%s: curl_multi_perform failed: %s", __FUNCTION__, curl_multi_strerror(r));
-        msg = curl_multi_info_read(cm, &msgs_left);
-        if (msg) {
-            _wic64_log(CONS_COL_RED, 2, "%s: msg: %u, %s", __FUNCTION__,
-                       msg->data.result, curl_easy_strerror(msg->data.result));
-            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &url);
-            _wic64_log(CONS_COL_RED, 2, "%s, R: %u - %s <%s>", __FUNCTION__,
-                       msg->data.result, curl_easy_strerror(msg->data.result), url);
-        }
-        send_reply_revised(NETWORK_ERROR, "Failed to read HTTP response", NULL, 0, "!0"); /* maybe wrong here */
-        goto out;
-    }
+    long response;
+    char *url;
 
     if (wic64_remote_timeout_triggered) {
         _wic64_log(CONS_COL_RED, 2, "Remote timout expired");
@@ -983,7 +1172,7 @@ static void http_get_alarm_handler(CLOCK offset, void *data)
         goto out;
     }
 
-    if (still_alive) {
+    if (!http_job_done()) {
         /* http request not yet finished */
         alarm_unset(http_get_alarm);
         alarm_set(http_get_alarm, maincpu_clk + (312 * 65));
@@ -992,25 +1181,18 @@ static void http_get_alarm_handler(CLOCK offset, void *data)
     alarm_unset(cmd_remote_timeout_alarm);
     remote_to = wic64_remote_timeout;
 
-    msg = curl_multi_info_read(cm, &msgs_left);
-    if (msg) {
-        CURLcode res;
-        res = curl_easy_getinfo(msg->easy_handle,
-                                CURLINFO_RESPONSE_CODE,
-                                &response);
-        if (res != CURLE_OK) {
-            wic64_log(CONS_COL_RED, "%s: curl_easy_getinfo(...&response failed: %s", __FUNCTION__,
-                      curl_easy_strerror(res));
-            send_reply_revised(NETWORK_ERROR, "Failed to read HTTP response", NULL, 0, "!0");
-            goto out;
-        }
-        res = curl_easy_getinfo(msg->easy_handle, CURLINFO_EFFECTIVE_URL, &url);
-        if (res != CURLE_OK) {
-            /* ignore problem, URL is only for debugging */
-            wic64_log(CONS_COL_RED, "%s: curl_easy_getinfo(...&URL failed: %s", __FUNCTION__,
-                      curl_easy_strerror(res));
-            url = "<unknown>";
-        }
+    url = http_job->effective_url ? http_job->effective_url : "<unknown>";
+    if (http_job->result != CURLE_OK) {
+        _wic64_log(CONS_COL_RED, 2, "%s, R: %u - %s <%s>", __FUNCTION__,
+                   http_job->result, curl_easy_strerror(http_job->result), url);
+    }
+    if (http_job->overflow) {
+        wic64_log(CONS_COL_NO, "libcurl reply too long, dropped the rest.\n");
+    }
+    response = http_job->response;
+    httpbufferptr = http_job->data_len;
+    if (httpbufferptr > 0) {
+        memcpy(httpbuffer, http_job->data, httpbufferptr);
     }
 
     if (response == 201) {
@@ -1053,8 +1235,7 @@ static void http_get_alarm_handler(CLOCK offset, void *data)
     }
 
   out:
-    curl_multi_cleanup(cm);
-    curl_global_cleanup();
+    http_job_release();
     alarm_unset(http_get_alarm);
     memset(httpbuffer, 0, httpbufferptr);
     big_load = 0;
@@ -1063,18 +1244,21 @@ static void http_get_alarm_handler(CLOCK offset, void *data)
 static void do_http_get(char *url)
 {
     cmd_remote_timeout(1);
-    cm = curl_multi_init();
-    if (!cm) {
-        send_reply_revised(CONNECTION_ERROR, "Can't send HTTP request", NULL, 0, "!0");
-        return;
-    }
 
-    /* Limit the amount of simultaneous connections curl should allow: */
-    curl_multi_setopt(cm, CURLMOPT_MAXCONNECTS, (long)MAX_PARALLEL);
+    /* set USERAGENT: otherwise the server won't return data, e.g. wicradio */
+    if (wic64_protocol == WIC64_PROT_LEGACY) {
+        http_user_agent = HTTP_AGENT_LEGACY;
+    } else {
+        http_user_agent = HTTP_AGENT_REVISED;
+    }
 
-    still_alive = 1;
     httpbufferptr = 0;
-    add_transfer(cm, url);
+    http_job_release();
+    http_job = http_job_submit(HTTP_JOB_GET, url, NULL, 0);
+    if (http_job == NULL) {
+        send_reply_revised(CONNECTION_ERROR, "Can't send HTTP request", NULL, 0, "!0");
+        return;
+    }
 
     if (http_get_alarm == NULL) {
         http_get_alarm = alarm_new(maincpu_alarm_context, "HTTPGetAlarm",
@@ -1494,92 +1678,45 @@ static void cmd_http_get(void)
     do_http_get(url);
 }
 
-static void http_post_endalarm_handler(CLOCK offset, void *data)
-{
-    _wic64_log(CONS_COL_NO, 2, "http post endalarm triggered...");
-    send_reply_revised(SUCCESS, "Success", (uint8_t *)post_data, post_data_rcvd, NULL);
-    alarm_unset(http_post_endalarm);
-    alarm_unset(http_post_alarm);
-    lib_free(post_data);
-    post_data = NULL;
-    post_error = post_data_rcvd = post_data_new = 0;
-    _wic64_log(CONS_COL_NO, 2, "http post done");
-}
-
 static void http_post_alarm_handler(CLOCK offset, void *data)
 {
-    _wic64_log(CONS_COL_NO, 2, "%s: post_data_rcvd = %d, expected = %d",
-               __FUNCTION__, post_data_rcvd, post_data_size);
+    size_t post_data_rcvd;
+    size_t post_data_size;
+    uint8_t *post_data;
 
-    if (post_error) {
-        send_reply_revised(SERVER_ERROR, "Server error",
-                           (uint8_t *)post_data,
-                           post_data_rcvd, NULL);
-        goto out;
-    }
-    if (post_data_rcvd >= post_data_size) { /* post_data_size is size_t so unsigned */
-        send_reply_revised(SUCCESS, "Success", (uint8_t *)post_data, post_data_rcvd, NULL);
-        goto out;
+    if (!http_job_done()) {
+        /* http request not yet finished */
+        alarm_unset(http_post_alarm);
+        alarm_set(http_post_alarm, maincpu_clk + (312 * 65));
+        return;
     }
-    if (post_data_size == -1) {
-        /* reply header didn't tell us the size, so read up to 64kB */
-        if (post_data_rcvd > 0xffff) {
-            send_reply_revised(SUCCESS, "Success", (uint8_t *)post_data, 0xffff, NULL);
-            goto out;
-        }
-        /* if new data has arrived, re-arm end-timeout */
-        if (post_data_new != post_data_rcvd) {
-            alarm_unset(http_post_endalarm);
-            /* reset alarm to 33% of wic64 timeout - should be fine in general */
-            alarm_set(http_post_endalarm,
-                      maincpu_clk + wic64_timeout * machine_get_cycles_per_second() / 3);
-            post_data_new = post_data_rcvd;
-        }
+
+    post_data = http_job->data;
+    post_data_rcvd = http_job->data_len;
+    post_data_size = (size_t)http_job->content_length; /* if -1 => largest size_t, so unknown */
+    _wic64_log(CONS_COL_NO, 2, "%s: post_data_rcvd = %d, expected = %d",
+               __FUNCTION__, post_data_rcvd, post_data_size);
+    _hexdump(CONS_COL_NO, 2, (const char *)post_data, (int)post_data_rcvd);
+
+    if (http_job->overflow) {
+        send_reply_revised(SERVER_ERROR, "Server error", post_data, post_data_rcvd, NULL);
+    } else if (http_job->result != CURLE_OK) {
+        wic64_log(CONS_COL_NO, "perform failed: %s", curl_easy_strerror(http_job->result));
+        send_reply_revised(NETWORK_ERROR, "Failed to send POST data to server", NULL, 0, "!0");
+    } else if (post_data_size == (size_t)-1 && post_data_rcvd > 0xffff) {
+        /* reply header didn't tell us the size, so send up to 64kB */
+        send_reply_revised(SUCCESS, "Success", post_data, 0xffff, NULL);
+    } else {
+        send_reply_revised(SUCCESS, "Success", post_data, post_data_rcvd, NULL);
     }
-    alarm_set(http_post_alarm, maincpu_clk +  machine_get_cycles_per_second() / 2);
-    return;
 
-out:
-    alarm_unset(http_post_endalarm);
+    http_job_release();
     alarm_unset(http_post_alarm);
-    lib_free(post_data);
-    post_data = NULL;
-    post_error = post_data_new = post_data_rcvd = 0;
     _wic64_log(CONS_COL_NO, 2, "http post done");
 }
 
-static size_t post_write_func(char *buffer, size_t size, size_t nitems, void *userdata)
-{
-    CURLcode res;
-    curl_off_t cl;
-    size_t ret;
-
-    ret = size * nitems;
-    res = curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &cl);
-    _wic64_log(CONS_COL_NO, 2, "http_post returned %d/0x%x bytes, expected len = %d...", ret, ret, cl);
-    if (res != CURLE_OK) {
-        _wic64_log(CONS_COL_NO, 2, "post callback failed to read length");
-        post_error = 1;
-        goto out;
-    }
-    if ((post_data_rcvd + ret) > HTTPREPLY_MAXLEN) {
-        post_error = 1;
-        ret = HTTPREPLY_MAXLEN - post_data_rcvd;
-    }
-    memcpy(post_data + post_data_rcvd, buffer, ret);
-    post_data_rcvd += ret;
-    _hexdump(CONS_COL_NO, 2, buffer, (int)ret);
-  out:
-    post_data_size = (size_t) cl; /* if -1 => largest size_t, so unknown */
-    return ret;
-}
-
 static void cmd_http_post(int cmd)
 {
-    CURLcode res;
-    static curl_mime *mime;
-    static curl_mimepart *part;
-
     if (cmd == WIC64_CMD_HTTP_POST_URL) {
         if (post_url == NULL) {
             post_url = lib_malloc(URL_MAXLEN);
@@ -1596,55 +1733,16 @@ static void cmd_http_post(int cmd)
             return;
         }
 
-        if (!curl) {
-            curl = curl_easy_init();
-        }
-
-        if (wic64_loglevel > 1) {
-            curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-        } else {
-            curl_easy_setopt(curl, CURLOPT_VERBOSE, 0L);
-        }
-        res = curl_easy_setopt(curl, CURLOPT_USERAGENT, http_user_agent);
-        if (res != CURLE_OK) {
-            wic64_log(CONS_COL_NO, "curl set user agent failed: %s", curl_easy_strerror(res));
-            send_reply_revised(NETWORK_ERROR, "Failed to open connection", NULL, 0, "!0");
-            return;
-        }
-        curl_easy_setopt(curl, CURLOPT_URL, post_url);
-        res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, post_write_func);
-        if (res != CURLE_OK) {
-            wic64_log(CONS_COL_NO, "perform failed: %s", curl_easy_strerror(res));
+        http_job_release();
+        http_job = http_job_submit(HTTP_JOB_POST, post_url, commandbuffer, commandptr);
+        if (http_job == NULL) {
             send_reply_revised(NETWORK_ERROR, "Failed to open connection", NULL, 0, "!0");
             return;
         }
-        post_data_rcvd = post_data_new = post_error = 0;
-        post_data_size = HTTPREPLY_MAXLEN;
-        /* first time prepare for receiving post resonses */
-        post_data = lib_malloc(HTTPREPLY_MAXLEN);
-        if (!post_data) {
-            send_reply_revised(INTERNAL_ERROR, "Out of memory", NULL, 0, NULL);
-            return;
-        }
-        mime = curl_mime_init(curl);
-        part = curl_mime_addpart(mime);
-        curl_mime_data(part, (const char *) commandbuffer, (size_t) commandptr);
-        /* Build an HTTP form with a single field named "data", */
-        curl_mime_name(part, "data");
-        curl_easy_setopt(curl, CURLOPT_MIMEPOST, mime);
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            wic64_log(CONS_COL_NO, "perform failed: %s", curl_easy_strerror(res));
-            send_reply_revised(NETWORK_ERROR, "Failed to send POST data to server", NULL, 0, "!0");
-        }
         if (http_post_alarm == NULL) {
             http_post_alarm = alarm_new(maincpu_alarm_context, "HTTPPostAlarm",
                                         http_post_alarm_handler, NULL);
         }
-        if (http_post_endalarm == NULL) {
-            http_post_endalarm = alarm_new(maincpu_alarm_context, "HTTPPostAlarm",
-                                           http_post_endalarm_handler, NULL);
-        }
         alarm_unset(http_post_alarm);
         alarm_set(http_post_alarm, maincpu_clk + (312 * 65));
     }
@@ -2439,9 +2537,7 @@ static void userport_wic64_reset(void)
     if (http_post_alarm) {
         alarm_unset(http_post_alarm);
     }
-    if (http_post_endalarm) {
-        alarm_unset(http_post_endalarm);
-    }
+    http_job_release();
     if (tcp_get_alarm) {
         alarm_unset(tcp_get_alarm);
     }
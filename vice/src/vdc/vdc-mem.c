@@ -78,11 +78,24 @@ static void vdc_write_data(void)
 }
 
 
+/* The mask of the VDC addresses when they map straight to the RAM, 0 when
+   they must be translated by vdc_ram_read() and vdc_ram_store().  */
+static int vdc_ram_linear_mask(void)
+{
+    if (vdc.regs[28] & 0x10) {
+        /* 64KB addressing, direct only with 4464 chips 64KB */
+        return vdc_resources.vdc_64kb_expansion ? 0xffff : 0;
+    }
+    /* 16KB addressing, direct only with 4416 chips 16KB */
+    return vdc_resources.vdc_64kb_expansion ? 0 : 0x3fff;
+}
+
 static void vdc_perform_fillcopy(void)
 {
     int ptr, ptr2;
     int i;
     int blklen;
+    int mask = vdc_ram_linear_mask();
 
     /* Word count, # of bytes to copy */
     blklen = vdc.regs[30] ? vdc.regs[30] : 256;
@@ -90,12 +103,27 @@ static void vdc_perform_fillcopy(void)
     /* Update address.  */
     ptr = (vdc.regs[18] << 8) + vdc.regs[19];
 
+    /* The whole block is done at once, the CPU can only see the busy flag
+       until the time it would have taken.  Where the addresses are not
+       translated and the block does not wrap around, it is done in one
+       memmove() or memset() on the RAM.  */
     if (vdc.regs[24] & 0x80) { /* COPY flag */
+        int src, dst;
+
         /* Block start address.  */
         ptr2 = (vdc.regs[32] << 8) + vdc.regs[33];
-        for (i = 0; i < blklen; i++) {
-            vdc_ram_store((ptr + i),
-                vdc_ram_read(ptr2 + i));
+        src = ptr2 & mask;
+        dst = ptr & mask;
+        /* the VDC copies upwards byte by byte, so a destination just above
+           the source repeats the bytes instead of moving them */
+        if (mask && src + blklen <= mask + 1 && dst + blklen <= mask + 1
+            && (dst <= src || dst >= src + blklen)) {
+            memmove(vdc.ram + dst, vdc.ram + src, blklen);
+        } else {
+            for (i = 0; i < blklen; i++) {
+                vdc_ram_store((ptr + i),
+                    vdc_ram_read(ptr2 + i));
+            }
         }
         ptr2 += blklen;
         vdc.regs[31] = vdc_ram_read(ptr2 - 1);
@@ -108,8 +136,22 @@ static void vdc_perform_fillcopy(void)
         log_message(vdc.log, "Fill mem %04i, len %03i, data %02x",
                     ptr, blklen, vdc.regs[31]);
 #endif
-        for (i = 0; i < blklen; i++) {
-            vdc_ram_store((ptr + i), vdc.regs[31]);
+        if (mask) {
+            int dst = ptr & mask;
+            int len = blklen;
+
+            /* at most once around the end of the RAM */
+            while (len > 0) {
+                int chunk = (mask + 1 - dst < len) ? mask + 1 - dst : len;
+
+                memset(vdc.ram + dst, vdc.regs[31], chunk);
+                len -= chunk;
+                dst = 0;
+            }
+        } else {
+            for (i = 0; i < blklen; i++) {
+                vdc_ram_store((ptr + i), vdc.regs[31]);
+            }
         }
         /* Set the clock for when the vdc status will be clear after this operation */
         vdc_status_clear_clock = maincpu_clk + (blklen*66/100);
@@ -215,6 +215,66 @@ static int vdrive_bam_get_interleave(vdrive_t *vdrive)
     }
 }
 
+static uint8_t *vdrive_bam_get_track_entry(vdrive_t *vdrive, unsigned int track,
+                                           unsigned int sector);
+
+/*
+Check the BAM bitmap of a track for any free sector, a word at a time, so
+the searches below can skip full tracks without trying every sector; on
+DNPs with 256 sectors per track this saves most of the work. It is only a
+hint: bits past the last sector may make a full track look free, which
+just means it is scanned as before.
+returns 0 if the track is full, 1 otherwise (or if it cannot tell).
+*/
+static int vdrive_bam_track_has_free(vdrive_t *vdrive, unsigned int track)
+{
+    uint8_t *bamp;
+    unsigned int bytes, i, first, last;
+    uint32_t word, any = 0;
+
+    switch (vdrive->image_format) {
+        case VDRIVE_IMAGE_FORMAT_1571:
+            /* Tracks > 70 don't go into the (regular) BAM on 1571 */
+            if (track > NUM_TRACKS_1571) {
+                return 0;
+            }
+            break;
+        case VDRIVE_IMAGE_FORMAT_1541:
+        case VDRIVE_IMAGE_FORMAT_2040:
+        case VDRIVE_IMAGE_FORMAT_1581:
+        case VDRIVE_IMAGE_FORMAT_8050:
+        case VDRIVE_IMAGE_FORMAT_8250:
+        case VDRIVE_IMAGE_FORMAT_NP:
+            break;
+        default:
+            /* D9090/60 keep the bitmap in groups of 32 sectors */
+            return 1;
+    }
+
+    bamp = vdrive_bam_get_track_entry(vdrive, track, 0);
+    if (bamp == NULL) {
+        return 1;
+    }
+    bytes = (vdrive_get_max_sectors(vdrive, track) + 7) >> 3;
+
+    /* make sure bam data is loaded */
+    first = (unsigned int)((bamp + 1 - vdrive->bam) >> 8);
+    last = (unsigned int)((bamp + bytes - vdrive->bam) >> 8);
+    if (vdrive_bam_read_bam_block(vdrive, first) != CBMDOS_IPE_OK
+        || vdrive_bam_read_bam_block(vdrive, last) != CBMDOS_IPE_OK) {
+        return 1;
+    }
+
+    for (i = 0; i + sizeof(word) <= bytes; i += sizeof(word)) {
+        memcpy(&word, bamp + 1 + i, sizeof(word));
+        any |= word;
+    }
+    for (; i < bytes; i++) {
+        any |= bamp[1 + i];
+    }
+    return any != 0;
+}
+
 /*
 This function is used by the next 3 to find an available sector in
 a single track. Typically this would be a simple loop, but the D9090/60
@@ -227,6 +287,10 @@ static int vdrive_bam_alloc_worker(vdrive_t *vdrive,
 {
     unsigned int max_sector, max_sector_all, s, h, s2, h2;
 
+    if (!vdrive_bam_track_has_free(vdrive, track)) {
+        return -1;
+    }
+
     max_sector = vdrive_get_max_sectors_per_head(vdrive, track);
     max_sector_all = vdrive_get_max_sectors(vdrive, track);
     /* start at supplied sector - but it is usually always 0 */
@@ -490,6 +554,17 @@ int vdrive_bam_alloc_next_free_sector_interleave(vdrive_t *vdrive,
             if (*track == DIR_TRACK_NP && *sector < 64) {
                 *sector = 64;
             }
+            /* skip the rest of a full track at once */
+            if (!vdrive_bam_track_has_free(vdrive, *track)) {
+                unsigned int left = max_sector - 1 - *sector;
+
+                if (left > s) {
+                    left = s;
+                }
+                s -= left;
+                *sector += left;
+                continue;
+            }
             /* try the sector */
             if (vdrive_bam_allocate_sector(vdrive, *track, *sector)) {
                 /* it is good, leave */
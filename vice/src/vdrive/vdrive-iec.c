@@ -1058,6 +1058,41 @@ int vdrive_iec_read(vdrive_t *vdrive, uint8_t *data, unsigned int secondary)
     return status;
 }
 
+/* Read up to `*len' bytes into `data', the same as calling vdrive_iec_read()
+   for each of them, but the bytes of a sequential file up to the last one of
+   the current sector are copied at once.  Stops after the first byte that
+   does not return SERIAL_OK and returns its status, `*len' is set to the
+   number of bytes read.  */
+int vdrive_iec_read_block(vdrive_t *vdrive, uint8_t *data, unsigned int *len,
+                          unsigned int secondary)
+{
+    bufferinfo_t *p = &(vdrive->buffers[secondary]);
+    unsigned int count = 0;
+    unsigned int end, run;
+    int status = SERIAL_OK;
+
+    while (count < *len && status == SERIAL_OK) {
+        if (p->mode == BUFFER_SEQUENTIAL && p->readmode == CBMDOS_FAM_READ) {
+            end = p->length ? p->length : 0xff;
+            if (p->bufptr < end) {
+                run = end - p->bufptr;
+                if (run > *len - count) {
+                    run = *len - count;
+                }
+                memcpy(data + count, p->buffer + p->bufptr, run);
+                p->bufptr += run;
+                count += run;
+                continue;
+            }
+        }
+        status = vdrive_iec_read(vdrive, data + count, secondary);
+        count++;
+    }
+
+    *len = count;
+    return status;
+}
+
 /* ------------------------------------------------------------------------- */
 
 int vdrive_iec_write(vdrive_t *vdrive, uint8_t data, unsigned int secondary)
@@ -1144,6 +1179,39 @@ int vdrive_iec_write(vdrive_t *vdrive, uint8_t data, unsigned int secondary)
     return SERIAL_OK;
 }
 
+/* Write `len' bytes from `data', the same as calling vdrive_iec_write() for
+   each of them, but the bytes of a sequential file that fit into the current
+   sector are copied at once.  Returns SERIAL_OK or the status of the first
+   byte that failed.  */
+int vdrive_iec_write_block(vdrive_t *vdrive, const uint8_t *data, unsigned int len,
+                           unsigned int secondary)
+{
+    bufferinfo_t *p = &(vdrive->buffers[secondary]);
+    unsigned int count = 0;
+    unsigned int run;
+    int status;
+
+    while (count < len) {
+        if (vdrive->image != NULL && p->mode == BUFFER_SEQUENTIAL
+            && p->readmode != CBMDOS_FAM_READ && p->bufptr < 256) {
+            run = 256 - p->bufptr;
+            if (run > len - count) {
+                run = len - count;
+            }
+            memcpy(p->buffer + p->bufptr, data + count, run);
+            p->bufptr += run;
+            count += run;
+            continue;
+        }
+        status = vdrive_iec_write(vdrive, data[count], secondary);
+        if (status != SERIAL_OK) {
+            return status;
+        }
+        count++;
+    }
+    return SERIAL_OK;
+}
+
 /* ------------------------------------------------------------------------- */
 
 void vdrive_iec_flush(vdrive_t *vdrive, unsigned int secondary)
@@ -40,6 +40,8 @@ int vdrive_iec_open(struct vdrive_s *vdrive, const uint8_t *name, unsigned int l
 int vdrive_iec_close(struct vdrive_s *vdrive, unsigned int secondary);
 int vdrive_iec_read(struct vdrive_s *vdrive, uint8_t *data, unsigned int secondary);
 int vdrive_iec_write(struct vdrive_s *vdrive, uint8_t data, unsigned int secondary);
+int vdrive_iec_read_block(struct vdrive_s *vdrive, uint8_t *data, unsigned int *len, unsigned int secondary);
+int vdrive_iec_write_block(struct vdrive_s *vdrive, const uint8_t *data, unsigned int len, unsigned int secondary);
 void vdrive_iec_flush(struct vdrive_s *vdrive, unsigned int secondary);
 
 int vdrive_iec_attach(unsigned int unit, const char *name);
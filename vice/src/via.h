@@ -156,6 +156,7 @@ typedef struct via_context_s {
     CLOCK t2zero;    /* When T2 reaches/last read 0000 or at least yy00 */
     CLOCK t1zero;    /* T1: when alarm viacore_t1_zero_alarm() goes off, sets VIA_IM_T1, after 0000 */
     bool t2xx00;     /* T2: set if T2 should give an IRQ at the first 0000, or if it is in 8-bit mode */
+    bool t1_idle;    /* T1: free running without alarm, t1zero/t1_pb7/VIA_IM_T1 catch up on access */
     uint8_t t1_pb7;  /* 0x00 or 0x80 */
     uint8_t oldpa;
     uint8_t oldpb;
@@ -27,10 +27,12 @@
 #include "vice.h"
 
 #include "archdep.h"
+#include "batch.h"
 #include "cartio.h"
 #include "cartridge.h"
 #include "cmdline.h"
 #include "export.h"
+#include "forkserver.h"
 #include "lib.h"
 #include "resources.h"
 #include "machine.h"
@@ -73,10 +75,14 @@ static const export_resource_t export_res = {
 
 static void debugcart_store(uint16_t addr, uint8_t value)
 {
+    if (forkserver_debugcart_write(value)) {
+        return;
+    }
+
     fprintf(stdout, "DBGCART: exit(%d) cycles elapsed: %"PRIu64"\n",
             (int)value, maincpu_clk);
 
-    archdep_vice_exit(value);
+    batch_vice_exit(value);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -327,10 +327,48 @@ static inline void vic_cycle_fetch(void)
 }
 
 /* ------------------------------------------------------------------------- */
+
+/* Find the last cycle of the line up to which nothing happens but the
+   counting: no fetch, no flipflop change, no latch and no end of line.
+   Stores to $9000 and $9001 clear it again (see vic_store()). */
+static inline void vic_cycle_update_quiet(void)
+{
+    unsigned int limit, xpos;
+
+    if (vic.fetch_state != VIC_FETCH_IDLE && vic.fetch_state != VIC_FETCH_DONE) {
+        vic.quiet_cycle = 0;
+        return;
+    }
+
+    if (vic.area == VIC_AREA_IDLE && vic.regs[1] == (vic.raster_line >> 1)) {
+        vic.quiet_cycle = 0;
+        return;
+    }
+
+    limit = vic.cycles_per_line - 1;
+
+    if (((vic.area == VIC_AREA_DISPLAY) || (vic.area == VIC_AREA_PENDING))
+        && (vic.fetch_state == VIC_FETCH_IDLE)) {
+        xpos = vic.regs[0] & 0x7fu;
+        if (xpos > vic.raster_cycle && xpos <= limit) {
+            limit = xpos - 1;
+        }
+    }
+
+    vic.quiet_cycle = limit;
+}
+
 void vic_cycle(void)
 {
     int interlace_enable_flag;
 
+    /* Fast path for the cycles of a line without any VIC work */
+    if (vic.raster_cycle >= 2 && vic.raster_cycle < vic.quiet_cycle
+        && vic.light_pen.trigger_cycle != maincpu_clk) {
+        vic.raster_cycle++;
+        return;
+    }
+
     if (vic.area == VIC_AREA_IDLE) {
         /* Check for vertical flipflop */
         if (vic.regs[1] == (vic.raster_line >> 1)) {
@@ -456,4 +494,6 @@ void vic_cycle(void)
 
     /* Perform fetch */
     vic_cycle_fetch();
+
+    vic_cycle_update_quiet();
 }
@@ -60,8 +60,6 @@ void vic_store(uint16_t addr, uint8_t value)
     VIC_DEBUG_REGISTER (("VIC: write $90%02X, value = $%02X.", addr, value));
 
     switch (addr) {
-#if 0
-        /* handled in vic_cycle.c */
         case 0:                   /* $9000  Screen X Location. */
         /*
             VIC checks in cycle n for peek($9000)=n
@@ -73,6 +71,12 @@ void vic_store(uint16_t addr, uint8_t value)
             if peek($9001)=r is true and in this case it opens the vertical
             flipflop
         */
+            /* handled in vic_cycle.c, which must check the cycles again */
+            vic.quiet_cycle = 0;
+            return;
+
+#if 0
+        /* handled in vic_cycle.c */
         case 2:                   /* $9002  Columns Displayed. */
         case 5:                   /* $9005  Video and char matrix base
                                    address. */
@@ -269,6 +269,7 @@ void vic_reset(void)
     vic.raster_line = 0;
     vic.raster_cycle = 6; /* magic value from cpu_reset() (mainviccpu.c) */
     vic.fetch_state = VIC_FETCH_IDLE;
+    vic.quiet_cycle = 0;
 }
 
 void vic_shutdown(void)
@@ -103,7 +103,12 @@ CLOCK maincpu_clk_limit = 0L;
 
 /* HACK: memmap updates for the reg_pc < bank_limit case */
 #ifdef FEATURE_CPUMEMHISTORY
-#define MEMMAP_UPDATE(addr) memmap_mem_update(addr, 0, 0)
+#define MEMMAP_UPDATE(addr)                    \
+    do {                                       \
+        if (monitor_cpuhistory_enabled) {      \
+            memmap_mem_update(addr, 0, 0);     \
+        }                                      \
+    } while (0)
 #else
 #define MEMMAP_UPDATE(addr)
 #endif
@@ -142,7 +142,7 @@ uint8_t iec_drive_read(unsigned int dnr)
 
 uint8_t iec_pa_read(void)
 {
-    drive_cpu_execute_all(maincpu_clk);
+    drive_cpu_execute_all_read(maincpu_clk);
 
     cpu_bus_val = (bus_data << 1) | bus_clock | (NOT(bus_atn) << 7);
 
@@ -385,10 +385,43 @@ void vic_sound_store(uint16_t addr, uint8_t value)
 static uint16_t noise_LFSR = 0x0000;
 static uint8_t noise_LFSR0_old = 0;
 
+/* Counter `j' reached zero: reload it and shift the next bit out.  */
+static void vic_sound_underflow(int j, int chspeed)
+{
+    int a = (~snd.ch[j].reg) & 127;
+    int enabled, edge_trigger;
+
+    a = a ? a : 128;
+    snd.ch[j].ctr += a << chspeed;
+    enabled = (snd.ch[j].reg & 128) >> 7;
+    edge_trigger = (noise_LFSR & 1) & !noise_LFSR0_old;
+
+    if((j != 3) || ((j == 3) && edge_trigger)) {
+        uint8_t shift = snd.ch[j].shift;
+        shift = ((shift << 1) | (((((shift & 128) >> 7)) ^ 1) & enabled));
+        snd.ch[j].shift = shift;
+    }
+    if(j == 3) {
+        int bit3  = (noise_LFSR >> 3) & 1;
+        int bit12 = (noise_LFSR >> 12) & 1;
+        int bit14 = (noise_LFSR >> 14) & 1;
+        int bit15 = (noise_LFSR >> 15) & 1;
+        int gate1 = bit3 ^ bit12;
+        int gate2 = bit14 ^ bit15;
+        int gate3 = (gate1 ^ gate2) ^ 1;
+        int gate4 = (gate3 & enabled) ^ 1;
+        noise_LFSR0_old = noise_LFSR & 1;
+        noise_LFSR = (noise_LFSR << 1) | gate4;
+    }
+    snd.ch[j].out = snd.ch[j].shift & (j == 3 ? enabled : 1);
+}
+
+/* The output of a channel only changes when its counter underflows, so
+   the cycles in between are accumulated as one run.  */
 void vic_sound_clock(CLOCK cycles)
 {
-    CLOCK i;
-    int j, enabled;
+    CLOCK left, run;
+    int j;
 
     if (cycles <= 0) {
         return;
@@ -397,41 +430,19 @@ void vic_sound_clock(CLOCK cycles)
     for (j = 0; j < 4; j++) {
         int chspeed = "\4\3\2\1"[j];
 
-        if (snd.ch[j].ctr > cycles) {
-            snd.accum += snd.ch[j].out * cycles;
-            snd.ch[j].ctr -= cycles;
-        } else {
-            for (i = cycles; i; i--) {
-                snd.ch[j].ctr--;
-                if (snd.ch[j].ctr <= 0) {
-                    int a = (~snd.ch[j].reg) & 127;
-                    int edge_trigger;
-                    a = a ? a : 128;
-                    snd.ch[j].ctr += a << chspeed;
-                    enabled = (snd.ch[j].reg & 128) >> 7;
-                    edge_trigger = (noise_LFSR & 1) & !noise_LFSR0_old;
-
-                    if((j != 3) || ((j == 3) && edge_trigger)) {
-                        uint8_t shift = snd.ch[j].shift;
-                        shift = ((shift << 1) | (((((shift & 128) >> 7)) ^ 1) & enabled));
-                        snd.ch[j].shift = shift;
-                    }
-                    if(j == 3) {
-                        int bit3  = (noise_LFSR >> 3) & 1;
-                        int bit12 = (noise_LFSR >> 12) & 1;
-                        int bit14 = (noise_LFSR >> 14) & 1;
-                        int bit15 = (noise_LFSR >> 15) & 1;
-                        int gate1 = bit3 ^ bit12;
-                        int gate2 = bit14 ^ bit15;
-                        int gate3 = (gate1 ^ gate2) ^ 1;
-                        int gate4 = (gate3 & enabled) ^ 1;
-                        noise_LFSR0_old = noise_LFSR & 1;
-                        noise_LFSR = (noise_LFSR << 1) | gate4;
-                    }
-                    snd.ch[j].out = snd.ch[j].shift & (j == 3 ? enabled : 1);
-                }
-                snd.accum += snd.ch[j].out; /* FIXME: doesn't take DC offset into account */
+        left = cycles;
+        while (left > 0) {
+            if (snd.ch[j].ctr > 0 && (CLOCK)snd.ch[j].ctr > left) {
+                snd.accum += snd.ch[j].out * (int)left;
+                snd.ch[j].ctr -= (signed short)left;
+                break;
             }
+            run = snd.ch[j].ctr > 0 ? (CLOCK)snd.ch[j].ctr : 1;
+            snd.accum += snd.ch[j].out * (int)(run - 1);
+            snd.ch[j].ctr -= (signed short)run;
+            left -= run;
+            vic_sound_underflow(j, chspeed);
+            snd.accum += snd.ch[j].out; /* FIXME: doesn't take DC offset into account */
         }
     }
 
@@ -242,6 +242,10 @@ struct vic_s {
     int interlace_field;
     /* cycle at which the current frame started */
     CLOCK framestart_cycle;
+
+    /* vic_cycle() only counts cycles until raster_cycle reaches this
+       value; 0 makes it check every cycle */
+    unsigned int quiet_cycle;
 };
 typedef struct vic_s vic_t;
 
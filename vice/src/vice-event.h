@@ -45,6 +45,7 @@
 #define EVENT_SYNC_TEST         14
 #define EVENT_KEYBOARD_CLEAR    15
 #define EVENT_RESOURCE          16
+#define EVENT_KEYFRAME          17
 
 #define EVENT_START_MODE_FILE_SAVE 0
 #define EVENT_START_MODE_FILE_LOAD 1
@@ -86,6 +87,11 @@ int event_record_active(void);
 int event_playback_active(void);
 int event_record_set_milestone(void);
 int event_record_reset_milestone(void);
+/* Seconds the UI seek actions step back or forward.  */
+#define EVENT_SEEK_STEP 10
+
+int event_playback_seek(unsigned int seconds);
+int event_playback_seek_by(int seconds);
 
 void event_reset_ack(void);
 
@@ -38,6 +38,9 @@ typedef struct vice_network_socket_address_s vice_network_socket_address_t;
 
 vice_network_socket_t * vice_network_server(const vice_network_socket_address_t * server_address);
 vice_network_socket_t * vice_network_client(const vice_network_socket_address_t * server_address);
+vice_network_socket_t * vice_network_datagram(const vice_network_socket_address_t * local_address,
+                                              const vice_network_socket_address_t * remote_address);
+int vice_network_datagram_accept(vice_network_socket_t * sockfd, void * buffer, size_t buffer_length);
 
 vice_network_socket_address_t * vice_network_address_generate(const char * address, unsigned short port);
 void vice_network_address_close(vice_network_socket_address_t *);
@@ -50,7 +53,9 @@ int vice_network_send(vice_network_socket_t * sockfd, const void * buffer, size_
 int vice_network_receive(vice_network_socket_t * sockfd, void * buffer, size_t buffer_length, int flags);
 
 int vice_network_select_poll_one(vice_network_socket_t * readsockfd);
+int vice_network_select_poll_stream(vice_network_socket_t * readsockfd);
 int vice_network_select_multiple(vice_network_socket_t ** readsockfd);
+int vice_network_select_multiple_timeout(vice_network_socket_t ** readsockfd, unsigned int timeout_usec);
 
 int vice_network_get_errorcode(void);
 
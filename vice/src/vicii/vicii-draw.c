@@ -52,6 +52,16 @@
 /* foreground(4) | background(4) | nibble(4) -> 4 pixels.  */
 static uint32_t hr_table[16 * 16 * 16];
 
+/* byte -> 8 pixels, 0xff where the bit is set, and color -> 8 pixels of
+   it.  Together they draw a hires byte with one 64-bit store from 2 KiB of
+   tables, instead of two lookups into the 16 KiB of hr_table.  */
+static uint64_t hr_mask_table[256];
+static uint64_t hr_color_table[16];
+
+#define DRAW_HIRES_BYTE(p, d, f, b)                                      \
+    *((uint64_t *)(p)) = hr_color_table[b]                               \
+                         ^ (hr_mask_table[d] & (hr_color_table[f] ^ hr_color_table[b]))
+
 /* mc flag(1) | idx(2) | byte(8) -> index into double-pixel table.  */
 static uint8_t mc_table[3 * 256];
 static uint8_t mcmsktable[256];
@@ -156,13 +166,13 @@ static void draw_idle_std_background(unsigned int start_pixel,
            end_pixel - start_pixel + 1);
 }
 
-/* If unaligned 32-bit access is not allowed, the graphics is stored in a
-   temporary aligned buffer, and later copied to the real frame buffer.  This
-   is ugly, but should be hopefully faster than accessing 8 bits at a time
-   anyway.  */
+/* If unaligned 32-bit and 64-bit access is not allowed, the graphics is
+   stored in a temporary aligned buffer, and later copied to the real frame
+   buffer.  This is ugly, but should be hopefully faster than accessing 8
+   bits at a time anyway.  */
 
 #ifndef ALLOW_UNALIGNED_ACCESS
-static uint32_t _aligned_line_buffer[VICII_SCREEN_XPIX / 2 + 1];
+static uint64_t _aligned_line_buffer[VICII_SCREEN_XPIX / 4 + 1];
 static uint8_t *const aligned_line_buffer = (uint8_t *)_aligned_line_buffer;
 #endif
 
@@ -218,20 +228,18 @@ static int get_std_text(raster_cache_t *cache, unsigned int *xs,
 inline static void _draw_std_text(uint8_t *p, unsigned int xs, unsigned int xe,
                                   uint8_t *gfx_msk_ptr)
 {
-    uint32_t *table_ptr;
     uint8_t *char_ptr, *msk_ptr;
+    unsigned int background;
     unsigned int i;
 
-    table_ptr = hr_table + (vicii.raster.background_color << 4);
+    background = vicii.raster.background_color;
     char_ptr = vicii.chargen_ptr + vicii.raster.ycounter;
     msk_ptr = gfx_msk_ptr + GFX_MSK_LEFTBORDER_SIZE;
 
     for (i = xs; i <= xe; i++) {
-        uint32_t *ptr = table_ptr + (vicii.cbuf[i] << 8);
         int d = msk_ptr[i] = char_ptr[vicii.vbuf[i] * 8];
 
-        *((uint32_t *)p + i * 2) = ptr[d >> 4];
-        *((uint32_t *)p + i * 2 + 1) = ptr[d & 0xf];
+        DRAW_HIRES_BYTE(p + i * 8, d, vicii.cbuf[i], background);
     }
 }
 
@@ -239,21 +247,19 @@ inline static void _draw_std_text_cached(uint8_t *p, unsigned int xs,
                                          unsigned int xe,
                                          raster_cache_t *cache)
 {
-    uint32_t *table_ptr;
     uint8_t *msk_ptr, *foreground_data, *color_data;
+    unsigned int background;
     unsigned int i;
 
-    table_ptr = hr_table + (cache->background_data[0] << 4);
+    background = cache->background_data[0];
     msk_ptr = cache->gfx_msk + GFX_MSK_LEFTBORDER_SIZE;
     foreground_data = cache->foreground_data;
     color_data = cache->color_data_1;
 
     for (i = xs; i <= xe; i++) {
-        uint32_t *ptr = table_ptr + (color_data[i] << 8);
         int d = msk_ptr[i] = foreground_data[i];
 
-        *((uint32_t *)p + i * 2) = ptr[d >> 4];
-        *((uint32_t *)p + i * 2 + 1) = ptr[d & 0xf];
+        DRAW_HIRES_BYTE(p + i * 8, d, color_data[i], background);
     }
 }
 
@@ -369,7 +375,6 @@ inline static void _draw_hires_bitmap(uint8_t *p, unsigned int xs,
 
     for (j = ((vicii.memptr + xs) << 3) + vicii.raster.ycounter, i = xs;
          i <= xe; i++, j += 8) {
-        uint32_t *ptr = hr_table + (vicii.vbuf[i] << 4);
         int d;
 
         if (j & 0x1000) {
@@ -379,8 +384,7 @@ inline static void _draw_hires_bitmap(uint8_t *p, unsigned int xs,
         }
 
         d = msk_ptr[i] = bmval;
-        *((uint32_t *)p + i * 2) = ptr[d >> 4];
-        *((uint32_t *)p + i * 2 + 1) = ptr[d & 0xf];
+        DRAW_HIRES_BYTE(p + i * 8, d, vicii.vbuf[i] >> 4, vicii.vbuf[i] & 0xf);
     }
 }
 
@@ -396,12 +400,10 @@ inline static void _draw_hires_bitmap_cached(uint8_t *p, unsigned int xs,
     msk_ptr = cache->gfx_msk + GFX_MSK_LEFTBORDER_SIZE;
 
     for (i = xs; i <= xe; i++) {
-        uint32_t *ptr = hr_table + (background_data[i] << 4);
         int d;
 
         d = msk_ptr[i] = foreground_data[i];
-        *((uint32_t *)p + i * 2) = ptr[d >> 4];
-        *((uint32_t *)p + i * 2 + 1) = ptr[d & 0xf];
+        DRAW_HIRES_BYTE(p + i * 8, d, background_data[i] >> 4, background_data[i] & 0xf);
     }
 }
 
@@ -431,7 +433,7 @@ inline static void _draw_hires_bitmap_foreground(uint8_t *p, unsigned int xs,
 
     for (j = ((vicii.memptr + xs) << 3) + vicii.raster.ycounter, i = xs;
          i <= xe; i++, j += 8) {
-        uint32_t *ptr = hr_table + (vicii.vbuf[i - vicii.buf_offset] << 4);
+        uint8_t colors = vicii.vbuf[i - vicii.buf_offset];
         int d;
 
         if (vicii.raster.last_video_mode == VICII_ILLEGAL_BITMAP_MODE_1) {
@@ -451,8 +453,7 @@ inline static void _draw_hires_bitmap_foreground(uint8_t *p, unsigned int xs,
 
         d = msk_ptr[i] = bmval;
 
-        *((uint32_t *)p + i * 2) = ptr[d >> 4];
-        *((uint32_t *)p + i * 2 + 1) = ptr[d & 0xf];
+        DRAW_HIRES_BYTE(p + i * 8, d, colors >> 4, colors & 0xf);
     }
 }
 
@@ -499,12 +500,12 @@ inline static void _draw_mc_text(uint8_t *p, unsigned int xs, unsigned int xe,
                                  uint8_t *gfx_msk_ptr)
 {
     uint8_t c[8];
-    uint32_t *table_ptr;
+    unsigned int background;
     uint8_t *char_ptr, *msk_ptr;
     uint16_t *ptmp;
     unsigned int i;
 
-    table_ptr = hr_table + (vicii.raster.background_color << 4);
+    background = vicii.raster.background_color;
     char_ptr = vicii.chargen_ptr + vicii.raster.ycounter;
     msk_ptr = gfx_msk_ptr + GFX_MSK_LEFTBORDER_SIZE;
 
@@ -526,9 +527,7 @@ inline static void _draw_mc_text(uint8_t *p, unsigned int xs, unsigned int xe,
             ptmp += 4;
             msk_ptr[i] = mcmsktable[d];
         } else {
-            uint32_t *ptr = table_ptr + (c3 << 8);
-            *((uint32_t *)ptmp) = ptr[d >> 4];
-            *((uint32_t *)(ptmp + 2)) = ptr[d & 0xf];
+            DRAW_HIRES_BYTE(ptmp, d, c3, background);
             ptmp += 4;
             msk_ptr[i] = d;
         }
@@ -538,14 +537,14 @@ inline static void _draw_mc_text(uint8_t *p, unsigned int xs, unsigned int xe,
 inline static void _draw_mc_text_cached(uint8_t *p, unsigned int xs, unsigned int xe, raster_cache_t *cache)
 {
     uint8_t c[8];
-    uint32_t *table_ptr;
+    unsigned int background;
     uint8_t *foreground_data, *color_data_3, *msk_ptr;
     uint16_t *ptmp;
     unsigned int i;
 
     foreground_data = cache->foreground_data;
     color_data_3 = cache->color_data_3;
-    table_ptr = hr_table + (cache->background_data[0] << 4);
+    background = cache->background_data[0];
     msk_ptr = cache->gfx_msk + GFX_MSK_LEFTBORDER_SIZE;
 
     c[1] = c[0] = cache->background_data[0];
@@ -566,9 +565,7 @@ inline static void _draw_mc_text_cached(uint8_t *p, unsigned int xs, unsigned in
             ptmp += 4;
             msk_ptr[i] = mcmsktable[d];
         } else {
-            uint32_t *ptr = table_ptr + (c3 << 8);
-            *((uint32_t *)ptmp) = ptr[d >> 4];
-            *((uint32_t *)(ptmp + 2)) = ptr[d & 0xf];
+            DRAW_HIRES_BYTE(ptmp, d, c3, background);
             ptmp += 4;
             msk_ptr[i] = d;
         }
@@ -1496,6 +1493,19 @@ static void init_drawing_tables(void)
         }
     }
 
+    p = (uint8_t *)hr_mask_table;
+    for (i = 0; i <= 0xff; i++) {
+        for (b = 0; b < 8; b++) {
+            *p++ = i & (0x80 >> b) ? 0xff : 0x00;
+        }
+    }
+    p = (uint8_t *)hr_color_table;
+    for (f = 0; f <= 0xf; f++) {
+        for (b = 0; b < 8; b++) {
+            *p++ = (uint8_t)f;
+        }
+    }
+
     for (i = 0; i <= 0xff; i++) {
         mc_table[i] = (uint8_t)(i >> 6);
         mc_table[i + 0x100] = (uint8_t)((i >> 4) & 0x3);
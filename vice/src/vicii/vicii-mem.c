@@ -1617,6 +1617,8 @@ inline static uint8_t d019_read(void)
 
 inline static uint8_t d01e_read(void)
 {
+    vicii.raster.sprite_collision_frames = VICII_SPRITE_COLLISION_FRAMES;
+
     /* Remove the pending sprite-sprite interrupt, as the collision
        register is reset upon read accesses.  */
     if (!vicii.viciidtv) {
@@ -1640,6 +1642,8 @@ inline static uint8_t d01e_read(void)
 
 inline static uint8_t d01f_read(void)
 {
+    vicii.raster.sprite_collision_frames = VICII_SPRITE_COLLISION_FRAMES;
+
     /* Remove the pending sprite-background interrupt, as the collision
        register is reset upon read accesses.  */
     if (!vicii.viciidtv) {
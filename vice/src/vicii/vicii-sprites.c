@@ -1139,9 +1139,15 @@ static void draw_all_sprites_partial(uint8_t *line_ptr, uint8_t *gfx_msk_ptr,
     sprite_status = vicii.raster.sprite_status;
 
     if (sprite_status->dma_msk || sprite_status->new_dma_msk) {
+        int dma_msk = sprite_status->dma_msk | sprite_status->new_dma_msk;
         int n;
 
         for (n = 0; n < 8; n++) {
+            /* sprites without DMA on this line draw nothing */
+            if (!(dma_msk & (1 << n))) {
+                sprite_status->sprites[n].mc_bug = 0;
+                continue;
+            }
             if (sprite_status->sprites[n].x < vicii.sprite_wrap_x) {
                 sprite_offset = sprite_status->sprites[n].x + sprite_status->sprites[n].x_shift;
 
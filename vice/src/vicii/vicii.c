@@ -1211,6 +1211,19 @@ void vicii_update_video_mode(unsigned int cycle)
 #endif
 }
 
+/* In 2MHz mode the 8502 gets no bad lines and the screen shows no useful
+   graphics, so while the 40 column screen is not shown either (the VDC in
+   a single canvas) the next frame is not drawn.  Like a skipped frame only
+   the changes and the sprite collisions the program uses are emulated,
+   raster IRQs and the light pen don't depend on drawing.  Called at the
+   end of each frame.  */
+static void vicii_fastmode_skip_frame(void)
+{
+    if (vicii.fastmode != 0 && !vicii.raster.canvas->viewport->update_canvas) {
+        vicii.raster.skip_frame = 1;
+    }
+}
+
 /* Redraw the current raster line.  This happens at cycle VICII_DRAW_CYCLE
    of each line.  */
 void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
@@ -1240,6 +1253,11 @@ void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
 
     vicii_sprites_reset_xshift();
 
+    /* collision interrupts need the collisions of every frame */
+    if (vicii.regs[0x1a] & 0x6) {
+        vicii.raster.sprite_collision_frames = VICII_SPRITE_COLLISION_FRAMES;
+    }
+
     raster_line_emulate(&vicii.raster);
 
 #if 0
@@ -1263,6 +1281,7 @@ void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
     if (vicii.raster.current_line == 0) {
         /* no vsync here for NTSC  */
         if ((unsigned int)vicii.last_displayed_line < vicii.screen_height) {
+            vicii_fastmode_skip_frame();
             vsync_do_vsync(vicii.raster.canvas);
         }
         vicii.memptr = 0;
@@ -1304,6 +1323,7 @@ void vicii_raster_draw_alarm_handler(CLOCK offset, void *data)
     /* vsync for NTSC */
     if ((unsigned int)vicii.last_displayed_line >= vicii.screen_height
         && vicii.raster.current_line == vicii.last_displayed_line - vicii.screen_height + 1) {
+        vicii_fastmode_skip_frame();
         vsync_do_vsync(vicii.raster.canvas);
     }
 
@@ -115,6 +115,10 @@ typedef enum vicii_video_mode_s vicii_video_mode_t;
    that needs at least 2 cycles to detect it.  */
 #define VICII_RASTER_IRQ_DELAY     2
 
+/* Frames in which frames that are not drawn still compute the sprite
+   collisions, after the program last read them.  */
+#define VICII_SPRITE_COLLISION_FRAMES 50
+
 /* Current char being drawn by the raster.  < 0 or >= VICII_SCREEN_TEXTCOLS
    if outside the visible range.  */
 #define VICII_RASTER_CHAR(cycle)   ((int)(cycle) - 15)
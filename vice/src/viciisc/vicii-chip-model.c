@@ -808,6 +808,63 @@ static void vicii_chip_model_set(const struct ViciiChipModel *cm)
             vicii.cycle_table[cycle - 1] = entry;
         }
     }
+
+    for (i = 0; i < cm->cycles_per_line; i++) {
+        unsigned int flags = vicii.cycle_table[i];
+        uint8_t steps = 0;
+
+        if (flags & CHECK_BRD_M) {
+            steps |= CYCLE_BORDER;
+        }
+        if (cycle_is_update_mcbase(flags) || cycle_is_check_spr_dma(flags)
+            || cycle_is_check_spr_exp(flags) || cycle_is_check_spr_disp(flags)) {
+            steps |= CYCLE_SPRITE_CHECK;
+        }
+        if (cycle_is_update_vc(flags) || cycle_is_update_rc(flags)) {
+            steps |= CYCLE_VC_RC;
+        }
+        if (cycle_is_fetch_ba(flags) || cycle_get_sprite_ba_mask(flags)) {
+            steps |= CYCLE_BA;
+        }
+        if (cycle_may_fetch_c(flags)) {
+            steps |= CYCLE_FETCH_C;
+        }
+        vicii.cycle_steps[i] = steps;
+    }
+
+    for (i = 0; i < cm->cycles_per_line; i++) {
+        int bad_line;
+
+        for (bad_line = 0; bad_line < 2; bad_line++) {
+            int cycle = i;
+            int n = 0;
+
+            while (1) {
+                unsigned int flags;
+
+                cycle = (cycle + 1) % cm->cycles_per_line;
+                flags = vicii.cycle_table[cycle];
+                if (cycle == VICII_PAL_CYCLE(1) || cycle == VICII_PAL_CYCLE(2)
+                    || cycle_is_check_spr_dma(flags)
+                    || (bad_line && cycle_is_fetch_ba(flags))) {
+                    break;
+                }
+                n++;
+            }
+            vicii.quiet_cycles[bad_line][i] = (uint8_t)n;
+        }
+    }
+
+    for (i = 0; i < cm->cycles_per_line; i++) {
+        int cycle = (i + 1) % cm->cycles_per_line;
+        int n = 0;
+
+        while (n < cm->cycles_per_line && cycle_is_fetch_ba(vicii.cycle_table[cycle])) {
+            cycle = (cycle + 1) % cm->cycles_per_line;
+            n++;
+        }
+        vicii.ba_low_cycles[i] = (uint8_t)n;
+    }
 }
 
 void vicii_chip_model_init(void)
@@ -116,6 +116,17 @@ void vicii_chip_model_init(void);
 #define SPRITE_BA_MASK_M  0x000000ff
 #define SPRITE_BA_MASK_B  0
 
+/*
+ * Steps of vicii_cycle() a cycle needs, derived from its flags (see
+ * vicii_chip_model_set()), so that the cycles without them skip each
+ * group with a single test.
+ */
+#define CYCLE_BORDER        0x01    /* left or right border check */
+#define CYCLE_SPRITE_CHECK  0x02    /* sprite MCBASE, DMA, expansion or display */
+#define CYCLE_VC_RC         0x04    /* VC or RC update */
+#define CYCLE_BA            0x08    /* matrix or sprite BA */
+#define CYCLE_FETCH_C       0x10    /* matrix fetch on a bad line */
+
 static inline uint8_t cycle_get_sprite_ba_mask(unsigned int flags)
 {
     return (flags & SPRITE_BA_MASK_M) >> SPRITE_BA_MASK_B;
@@ -152,6 +152,12 @@ static const cmdline_option_t cmdline_options[] =
     { "+VICIIvspbug", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, "VICIIVSPBug", (void *)0,
       NULL, "Disable VSP bug emulation" },
+    { "-VICIIlinecache", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VICIILineCache", (void *)1,
+      NULL, "Reuse the pixels of lines that did not change since the last frame" },
+    { "+VICIIlinecache", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VICIILineCache", (void *)0,
+      NULL, "Draw every line" },
     /* NOTE: although we use CALL_FUNCTION, we put the resource that will be
              modified into the array - this helps reconstructing the cmdline */
     { "-VICIImodel", CALL_FUNCTION, CMDLINE_ATTRIB_NEED_ARGS,
@@ -129,37 +129,21 @@ static inline void check_sprite_dma(void)
 
 static inline uint8_t cycle_phi1_fetch(unsigned int cycle_flags)
 {
-    uint8_t data;
-    int s;
-
-    if (cycle_is_fetch_g(cycle_flags)) {
-        if (!vicii.idle_state) {
-            data = vicii_fetch_graphics();
-        } else {
-            data = vicii_fetch_idle_gfx();
-        }
-        return data;
-    }
-
-    if (cycle_is_sprite_ptr_dma0(cycle_flags)) {
-        s = cycle_get_sprite_num(cycle_flags);
-        data = vicii_fetch_sprite_pointer(s);
-        return data;
-    }
-    if (cycle_is_sprite_dma1_dma2(cycle_flags)) {
-        s = cycle_get_sprite_num(cycle_flags);
-        data = vicii_fetch_sprite_dma_1(s);
-        return data;
-    }
-
-    if (cycle_is_refresh(cycle_flags)) {
-        data = vicii_fetch_refresh();
-        return data;
+    switch (cycle_flags & PHI1_TYPE_M) {
+        case PHI1_FETCH_G:
+            if (!vicii.idle_state) {
+                return vicii_fetch_graphics();
+            }
+            return vicii_fetch_idle_gfx();
+        case PHI1_SPR_PTR:
+            return vicii_fetch_sprite_pointer(cycle_get_sprite_num(cycle_flags));
+        case PHI1_SPR_DMA1:
+            return vicii_fetch_sprite_dma_1(cycle_get_sprite_num(cycle_flags));
+        case PHI1_REFRESH:
+            return vicii_fetch_refresh();
+        default:
+            return vicii_fetch_idle();
     }
-
-    data = vicii_fetch_idle();
-
-    return data;
 }
 
 static inline void check_vborder_top(int line)
@@ -371,11 +355,12 @@ static inline void vicii_handle_vsp_bug(void)
     }
 }
 
-int vicii_cycle(void)
+static inline int cycle(void)
 {
     int ba_low = 0;
     int can_sprite_sprite, can_sprite_background;
     int vsp_may_crash;
+    unsigned int steps;
 
     /*VICII_DEBUG_CYCLE(("cycle: line %i, clk %i", vicii.raster_line, vicii.raster_cycle));*/
 
@@ -391,6 +376,7 @@ int vicii_cycle(void)
     /* Next cycle */
     next_vicii_cycle();
     vicii.cycle_flags = vicii.cycle_table[vicii.raster_cycle];
+    steps = vicii.cycle_steps[vicii.raster_cycle];
 
     /******
      *
@@ -402,7 +388,9 @@ int vicii_cycle(void)
     vicii.last_read_phi1 = cycle_phi1_fetch(vicii.cycle_flags);
 
     /* Check horizontal border flag */
-    check_hborder(vicii.cycle_flags);
+    if (steps & CYCLE_BORDER) {
+        check_hborder(vicii.cycle_flags);
+    }
 
     can_sprite_sprite = (vicii.sprite_sprite_collisions == 0);
     can_sprite_background = (vicii.sprite_background_collisions == 0);
@@ -487,29 +475,31 @@ int vicii_cycle(void)
      *
      */
 
-    /* Update sprite mcbase (Cycle 16 on PAL) */
-    /* if (vicii.raster_cycle == VICII_PAL_CYCLE(16)) { */
-    if (cycle_is_update_mcbase(vicii.cycle_flags)) {
-        sprite_mcbase_update();
-    }
+    if (steps & CYCLE_SPRITE_CHECK) {
+        /* Update sprite mcbase (Cycle 16 on PAL) */
+        /* if (vicii.raster_cycle == VICII_PAL_CYCLE(16)) { */
+        if (cycle_is_update_mcbase(vicii.cycle_flags)) {
+            sprite_mcbase_update();
+        }
 
-    /* Check sprite DMA (Cycles 55 & 56 on PAL) */
-    /* if (vicii.raster_cycle == VICII_PAL_CYCLE(55)
-       || vicii.raster_cycle == VICII_PAL_CYCLE(56) ) { */
-    if (cycle_is_check_spr_dma(vicii.cycle_flags)) {
-        check_sprite_dma();
-    }
+        /* Check sprite DMA (Cycles 55 & 56 on PAL) */
+        /* if (vicii.raster_cycle == VICII_PAL_CYCLE(55)
+           || vicii.raster_cycle == VICII_PAL_CYCLE(56) ) { */
+        if (cycle_is_check_spr_dma(vicii.cycle_flags)) {
+            check_sprite_dma();
+        }
 
-    /* Check sprite expansion flags (Cycle 56 on PAL) */
-    /* if (vicii.raster_cycle == VICII_PAL_CYCLE(56)) { */
-    if (cycle_is_check_spr_exp(vicii.cycle_flags)) {
-        check_exp();
-    }
+        /* Check sprite expansion flags (Cycle 56 on PAL) */
+        /* if (vicii.raster_cycle == VICII_PAL_CYCLE(56)) { */
+        if (cycle_is_check_spr_exp(vicii.cycle_flags)) {
+            check_exp();
+        }
 
-    /* Check sprite display (Cycle 58 on PAL) */
-    /* if (vicii.raster_cycle == VICII_PAL_CYCLE(58)) { */
-    if (cycle_is_check_spr_disp(vicii.cycle_flags)) {
-        check_sprite_display();
+        /* Check sprite display (Cycle 58 on PAL) */
+        /* if (vicii.raster_cycle == VICII_PAL_CYCLE(58)) { */
+        if (cycle_is_check_spr_disp(vicii.cycle_flags)) {
+            check_sprite_display();
+        }
     }
 
     /******
@@ -540,7 +530,7 @@ int vicii_cycle(void)
 
     /* Update VC (Cycle 14 on PAL) */
     /*  if (vicii.raster_cycle == VICII_PAL_CYCLE(14)) { */
-    if (cycle_is_update_vc(vicii.cycle_flags)) {
+    if ((steps & CYCLE_VC_RC) && cycle_is_update_vc(vicii.cycle_flags)) {
         vicii.vc = vicii.vcbase;
         vicii.vmli = 0;
         if (vicii.bad_line) {
@@ -550,7 +540,7 @@ int vicii_cycle(void)
 
     /* Update RC (Cycle 58 on PAL) */
     /* if (vicii.raster_cycle == VICII_PAL_CYCLE(58)) { */
-    if (cycle_is_update_rc(vicii.cycle_flags)) {
+    if ((steps & CYCLE_VC_RC) && cycle_is_update_rc(vicii.cycle_flags)) {
         /* `rc' makes the chip go to idle state when it reaches the
            maximum value.  */
         if (vicii.rc == 7) {
@@ -569,13 +559,15 @@ int vicii_cycle(void)
      *
      */
 
-    /* Check BA for matrix fetch */
-    if (vicii.bad_line && cycle_is_fetch_ba(vicii.cycle_flags)) {
-        ba_low = 1;
-    }
+    if (steps & CYCLE_BA) {
+        /* Check BA for matrix fetch */
+        if (vicii.bad_line && cycle_is_fetch_ba(vicii.cycle_flags)) {
+            ba_low = 1;
+        }
 
-    /* Check BA for Sprite Phi2 fetch */
-    ba_low |= vicii_check_sprite_ba(vicii.cycle_flags);
+        /* Check BA for Sprite Phi2 fetch */
+        ba_low |= vicii_check_sprite_ba(vicii.cycle_flags);
+    }
 
     /* if ba_low transitioning from non-active to active, always count
        3 cycles before allowing any Phi2 accesses. */
@@ -592,7 +584,7 @@ int vicii_cycle(void)
 
 
     /* Matrix fetch */
-    if (vicii.bad_line && cycle_may_fetch_c(vicii.cycle_flags)) {
+    if (vicii.bad_line && (steps & CYCLE_FETCH_C)) {
 #ifdef DEBUG
         if (debug.maincpu_traceflg) {
             log_debug("DMA at cycle %u   %"PRIu64"", vicii.raster_cycle, maincpu_clk);
@@ -615,6 +607,56 @@ int vicii_cycle(void)
     return ba_low;
 }
 
+int vicii_cycle(void)
+{
+    return cycle();
+}
+
+/*
+ * The CPU may run ahead of the VIC-II over cycles in which nothing the
+ * VIC-II does can reach the CPU: BA stays high, no interrupt is raised and
+ * no memory is written.  That holds for the cycles before the next line or
+ * frame starts, sprite DMA is checked, BA goes low for a bad line, the
+ * light pen triggers, or a raster or collision interrupt is due, provided
+ * the CPU writes nothing and reads no I/O in the meantime.  The VIC-II
+ * runs those cycles later with vicii_cycle_catch_up(), with the same
+ * results as one by one.
+ */
+
+/* Number of the next cycles the CPU may run ahead of, 0 if none.  */
+unsigned int vicii_cycle_quiet(void)
+{
+    unsigned int quiet;
+
+    if (vicii.sprite_dma || vicii.sprite_display_bits || !vicii_draw_cycle_sprites_idle()) {
+        return 0;
+    }
+    if (vicii.raster_line == vicii.raster_irq_line && !vicii.raster_irq_triggered) {
+        return 0;
+    }
+
+    quiet = vicii.quiet_cycles[vicii.bad_line ? 1 : 0][vicii.raster_cycle];
+
+    if (vicii.light_pen.trigger_cycle > maincpu_clk
+        && vicii.light_pen.trigger_cycle <= maincpu_clk + quiet) {
+        quiet = (unsigned int)(vicii.light_pen.trigger_cycle - maincpu_clk - 1);
+    }
+    return quiet;
+}
+
+/* Run the last `cycles' cycles counted in maincpu_clk, which
+   vicii_cycle_quiet() allowed the CPU to run ahead of.  */
+void vicii_cycle_catch_up(unsigned int cycles)
+{
+    CLOCK clk = maincpu_clk;
+
+    maincpu_clk -= cycles;
+    while (maincpu_clk != clk) {
+        maincpu_clk++;
+        cycle();
+    }
+}
+
 /* The REU can use an additional cycle at the point where the dma of sprite 0 is turned on */
 /* this is because of late setting of BA due to internal delays */
 /* The CPU can't use this cycle as it checks the state later */
@@ -624,13 +666,24 @@ int vicii_cycle_reu(void)
     return vicii_cycle() && !check;
 }
 
-/* Steal cycles from CPU  */
+/* Steal cycles from CPU.  On a bad line BA is known to stay low up to the
+   end of the matrix fetch, whatever the sprites do, so those cycles run
+   without looking at BA; only after them BA is checked cycle by cycle.
+   The CPU dispatches the alarms that fell inside the window once the
+   VIC-II releases the bus.  */
 void vicii_steal_cycles(void)
 {
     int ba_low;
 
     do {
+        unsigned int known = vicii.bad_line ? vicii.ba_low_cycles[vicii.raster_cycle] : 0;
+
+        while (known > 0) {
+            maincpu_clk++;
+            cycle();
+            known--;
+        }
         maincpu_clk++;
-        ba_low = vicii_cycle();
+        ba_low = cycle();
     } while (ba_low);
 }
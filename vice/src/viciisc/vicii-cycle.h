@@ -29,6 +29,8 @@
 
 int vicii_cycle(void);
 int vicii_cycle_reu(void);
+unsigned int vicii_cycle_quiet(void);
+void vicii_cycle_catch_up(unsigned int cycles);
 void vicii_steal_cycles(void);
 
 void vicii_init_vsp_bug(void);
@@ -28,6 +28,7 @@
 
 #include <string.h>
 
+#include "lib.h"
 #include "types.h"
 #include "snapshot.h"
 #include "vicii-chip-model.h"
@@ -60,68 +61,140 @@
 #define COL_D02D     0x2d
 #define COL_D02E     0x2e
 
-/* foreground/background graphics */
-
-static uint8_t gbuf_pipe0_reg = 0;
-static uint8_t cbuf_pipe0_reg = 0;
-static uint8_t vbuf_pipe0_reg = 0;
-static uint8_t gbuf_pipe1_reg = 0;
-static uint8_t cbuf_pipe1_reg = 0;
-static uint8_t vbuf_pipe1_reg = 0;
-
-static uint8_t xscroll_pipe = 0;
-static uint8_t vmode11_pipe = 0;
-static uint8_t vmode16_pipe = 0;
-static uint8_t vmode16_pipe2 = 0;
-
-/* gbuf shift register */
-static uint8_t gbuf_reg = 0;
-static uint8_t gbuf_mc_flop = 0;
-static uint8_t gbuf_pixel_reg = 0;
-
-/* cbuf and vbuf registers */
-static uint8_t cbuf_reg = 0;
-static uint8_t vbuf_reg = 0;
-
+/* The complete state of the pixel pipeline between two cycles.  Only four
+   byte members come before the byte members so that there is no padding,
+   the line cache compares whole states with memcmp().  */
+typedef struct draw_state_s {
+    /* sprites */
+    int sprite_x_pipe[8];
+
+    /* sbuf shift registers */
+    uint32_t sbuf_reg[8];
+
+    /* border */
+    int border_state;
+
+    /* foreground/background graphics */
+    uint8_t gbuf_pipe0_reg;
+    uint8_t cbuf_pipe0_reg;
+    uint8_t vbuf_pipe0_reg;
+    uint8_t gbuf_pipe1_reg;
+    uint8_t cbuf_pipe1_reg;
+    uint8_t vbuf_pipe1_reg;
+
+    uint8_t xscroll_pipe;
+    uint8_t vmode11_pipe;
+    uint8_t vmode16_pipe;
+    uint8_t vmode16_pipe2;
+
+    /* gbuf shift register */
+    uint8_t gbuf_reg;
+    uint8_t gbuf_mc_flop;
+    uint8_t gbuf_pixel_reg;
+
+    /* cbuf and vbuf registers */
+    uint8_t cbuf_reg;
+    uint8_t vbuf_reg;
+
+    /* sprites */
+    uint8_t sprite_pri_bits;
+    uint8_t sprite_mc_bits;
+    uint8_t sprite_expx_bits;
+
+    uint8_t sprite_pending_bits;
+    uint8_t sprite_active_bits;
+    uint8_t sprite_halt_bits;
+
+    /* sbuf shift registers */
+    uint8_t sbuf_pixel_reg[8];
+    uint8_t sbuf_expx_flops;
+    uint8_t sbuf_mc_flops;
+
+    /* pixel buffer */
+    uint8_t render_buffer[8];
+    uint8_t pri_buffer[8];
+
+    uint8_t pixel_buffer[8];
+
+    /* color resolution registers */
+    uint8_t cregs[0x2f];
+    uint8_t last_color_reg;
+    uint8_t last_color_value;
+} draw_state_t;
+
+/* Everything one cycle of drawing reads from the VIC-II, gathered by
+   fetch_input().  Values the cycle does not use are 0, so that they do not
+   make otherwise identical cycles differ.  */
+typedef struct draw_input_s {
+    int sprite_x[8];
+    uint32_t sprite_data;
+    unsigned int cycle_flags;
+
+    uint8_t reg11;
+    uint8_t reg16;
+    uint8_t reg1b;
+    uint8_t reg1c;
+    uint8_t reg1d;
+
+    uint8_t gbuf;
+    uint8_t vbuf;
+    uint8_t cbuf;
+    uint8_t vborder;
+    uint8_t idle_state;
+    uint8_t main_border;
+    uint8_t sprite_display_bits;
+
+    uint8_t last_color_reg;
+    uint8_t last_color_value;
+    uint8_t color_latency;
+    uint8_t unused;
+} draw_input_t;
+
+static draw_state_t st;
+
+/* collisions found by the last drawn cycle */
+static uint8_t sprite_sprite_collisions;
+static uint8_t sprite_background_collisions;
+
+/* state of fetch_input() */
 static uint8_t dmli = 0;
+static unsigned int cycle_flags_pipe;
 
-/* sprites */
-static int sprite_x_pipe[8];
-static uint8_t sprite_pri_bits = 0;
-static uint8_t sprite_mc_bits = 0;
-static uint8_t sprite_expx_bits = 0;
-
-static uint8_t sprite_pending_bits = 0;
-static uint8_t sprite_active_bits = 0;
-static uint8_t sprite_halt_bits = 0;
+/* line cache */
 
-/* sbuf shift registers */
-static uint32_t sbuf_reg[8];
-static uint8_t sbuf_pixel_reg[8];
-static uint8_t sbuf_expx_flops;
-static uint8_t sbuf_mc_flops;
+/* most raster lines and cycles per line of all models */
+#define LINE_CACHE_LINES    312
+#define LINE_CACHE_CYCLES   (VICII_DRAW_BUFFER_SIZE / 8)
 
-/* border */
-static int border_state = 0;
+typedef struct line_cache_entry_s {
+    int valid;
+    unsigned int cycles;
+    draw_state_t start;
+    draw_state_t end;
+    draw_input_t input[LINE_CACHE_CYCLES];
+    uint8_t sprite_sprite_collisions[LINE_CACHE_CYCLES];
+    uint8_t sprite_background_collisions[LINE_CACHE_CYCLES];
+    uint8_t dbuf[VICII_DRAW_BUFFER_SIZE];
+} line_cache_entry_t;
 
-/* pixel buffer */
-static uint8_t render_buffer[8];
-static uint8_t pri_buffer[8];
+static line_cache_entry_t *line_cache = NULL;
 
-static uint8_t pixel_buffer[8];
+/* entry of the line being drawn, NULL if the line is not cached */
+static line_cache_entry_t *line_cache_line = NULL;
+static unsigned int line_cache_cycle;
 
-/* color resolution registers */
-static uint8_t cregs[0x2f];
-static uint8_t last_color_reg;
-static uint8_t last_color_value;
+/* Flag: the line matched its entry so far and drawing is skipped, `st' is
+   still the state at the start of the line.  */
+static int line_cache_reuse = 0;
 
-static unsigned int cycle_flags_pipe;
+static void line_cache_sync(void);
 
 void vicii_monitor_colreg_store(int reg, int value)
 {
-    cregs[reg] = value;
-    last_color_reg = reg;
-    last_color_value = value;
+    line_cache_sync();
+    st.cregs[reg] = value;
+    st.last_color_reg = reg;
+    st.last_color_value = value;
 }
 
 /**************************************************************************
@@ -149,27 +222,27 @@ static DRAW_INLINE void draw_graphics(int i)
     uint8_t vmode;
 
     /* Load new gbuf/vbuf/cbuf values at offset == xscroll */
-    if (i == xscroll_pipe) {
+    if (i == st.xscroll_pipe) {
         /* latch values at time xs */
-        vbuf_reg = vbuf_pipe1_reg;
-        cbuf_reg = cbuf_pipe1_reg;
-        gbuf_reg = gbuf_pipe1_reg;
-        gbuf_mc_flop = 1;
+        st.vbuf_reg = st.vbuf_pipe1_reg;
+        st.cbuf_reg = st.cbuf_pipe1_reg;
+        st.gbuf_reg = st.gbuf_pipe1_reg;
+        st.gbuf_mc_flop = 1;
     }
 
     /*
      * read pixels depending on video mode
      * mc pixels if MCM=1 and BMM=1, or MCM=1 and cbuf bit 3 = 1
      */
-    if (vmode16_pipe2) {
-        if ((vmode11_pipe & 0x08) || (cbuf_reg & 0x08)) {
+    if (st.vmode16_pipe2) {
+        if ((st.vmode11_pipe & 0x08) || (st.cbuf_reg & 0x08)) {
             /* mc pixels */
-            if (gbuf_mc_flop) {
-                gbuf_pixel_reg = gbuf_reg >> 6;
+            if (st.gbuf_mc_flop) {
+                st.gbuf_pixel_reg = st.gbuf_reg >> 6;
             }
         } else {
             /* hires pixels */
-            gbuf_pixel_reg = (gbuf_reg & 0x80) ? 3 : 0;
+            st.gbuf_pixel_reg = (st.gbuf_reg & 0x80) ? 3 : 0;
         }
     } else {
         /*
@@ -177,22 +250,22 @@ static DRAW_INLINE void draw_graphics(int i)
          * MC and non-MC chars.
          * This is rather ugly. There must be a simpler solution.
          */
-        if ((vmode11_pipe & 0x08) || (cbuf_reg & 0x08)) {
+        if ((st.vmode11_pipe & 0x08) || (st.cbuf_reg & 0x08)) {
             /* hires pixels */
-            gbuf_pixel_reg = (gbuf_reg & 0x80) ? 2 : 0;
+            st.gbuf_pixel_reg = (st.gbuf_reg & 0x80) ? 2 : 0;
         } else {
             /* hires pixels */
-            gbuf_pixel_reg = (gbuf_reg & 0x80) ? 3 : 0;
+            st.gbuf_pixel_reg = (st.gbuf_reg & 0x80) ? 3 : 0;
         }
     }
-    px = gbuf_pixel_reg;
+    px = st.gbuf_pixel_reg;
 
     /* shift the graphics buffer */
-    gbuf_reg <<= 1;
-    gbuf_mc_flop ^= 1;
+    st.gbuf_reg <<= 1;
+    st.gbuf_mc_flop ^= 1;
 
     /* Determine pixel color and priority */
-    vmode = vmode11_pipe | vmode16_pipe;
+    vmode = st.vmode11_pipe | st.vmode16_pipe;
     pixel_pri = (px & 0x2);
     cc = colors[vmode | px];
 
@@ -202,33 +275,33 @@ static DRAW_INLINE void draw_graphics(int i)
             cc = 0;
             break;
         case COL_VBUF_L:
-            cc = vbuf_reg & 0x0f;
+            cc = st.vbuf_reg & 0x0f;
             break;
         case COL_VBUF_H:
-            cc = vbuf_reg >> 4;
+            cc = st.vbuf_reg >> 4;
             break;
         case COL_CBUF:
-            cc = cbuf_reg;
+            cc = st.cbuf_reg;
             break;
         case COL_CBUF_MC:
-            cc = cbuf_reg & 0x07;
+            cc = st.cbuf_reg & 0x07;
             break;
         case COL_D02X_EXT:
-            cc = COL_D021 + (vbuf_reg >> 6);
+            cc = COL_D021 + (st.vbuf_reg >> 6);
             break;
         default:
             break;
     }
 
-    render_buffer[i] = cc;
-    pri_buffer[i] = pixel_pri;
+    st.render_buffer[i] = cc;
+    st.pri_buffer[i] = pixel_pri;
 }
 
-static DRAW_INLINE void draw_graphics8(unsigned int cycle_flags)
+static DRAW_INLINE void draw_graphics8(const draw_input_t *in)
 {
     int vis_en;
 
-    vis_en = cycle_is_visible(cycle_flags);
+    vis_en = cycle_is_visible(in->cycle_flags);
 
     /* render pixels */
     /* pixel 0 */
@@ -240,57 +313,50 @@ static DRAW_INLINE void draw_graphics8(unsigned int cycle_flags)
     /* pixel 3 */
     draw_graphics(3);
     /* pixel 4 */
-    vmode16_pipe = ( vicii.regs[0x16] & 0x10 ) >> 2;
-    if (vicii.color_latency) {
+    st.vmode16_pipe = ( in->reg16 & 0x10 ) >> 2;
+    if (in->color_latency) {
         /* handle rising edge of internal signal */
-        vmode11_pipe |= ( vicii.regs[0x11] & 0x60 ) >> 2;
+        st.vmode11_pipe |= ( in->reg11 & 0x60 ) >> 2;
     }
     draw_graphics(4);
     /* pixel 5 */
     draw_graphics(5);
     /* pixel 6 */
-    if (vicii.color_latency) {
+    if (in->color_latency) {
         /* handle falling edge of internal signal */
-        vmode11_pipe &= ( vicii.regs[0x11] & 0x60 ) >> 2;
+        st.vmode11_pipe &= ( in->reg11 & 0x60 ) >> 2;
     }
     draw_graphics(6);
     /* pixel 7 */
-    if (vmode16_pipe && !vmode16_pipe2) {
-        gbuf_mc_flop = 0;
+    if (st.vmode16_pipe && !st.vmode16_pipe2) {
+        st.gbuf_mc_flop = 0;
     }
-    vmode16_pipe2 = vmode16_pipe;
+    st.vmode16_pipe2 = st.vmode16_pipe;
     draw_graphics(7);
 
-    if (!vicii.color_latency) {
-        vmode11_pipe = ( vicii.regs[0x11] & 0x60 ) >> 2;
+    if (!in->color_latency) {
+        st.vmode11_pipe = ( in->reg11 & 0x60 ) >> 2;
     }
 
     /* shift and put the next data into the pipe. */
-    vbuf_pipe1_reg = vbuf_pipe0_reg;
-    cbuf_pipe1_reg = cbuf_pipe0_reg;
-    gbuf_pipe1_reg = gbuf_pipe0_reg;
+    st.vbuf_pipe1_reg = st.vbuf_pipe0_reg;
+    st.cbuf_pipe1_reg = st.cbuf_pipe0_reg;
+    st.gbuf_pipe1_reg = st.gbuf_pipe0_reg;
 
     /* this makes sure gbuf is 0 outside the visible area
        It should probably be done somewhere around the fetch instead */
-    if (vis_en && vicii.vborder == 0) {
-        gbuf_pipe0_reg = vicii.gbuf;
-        xscroll_pipe = vicii.regs[0x16] & 0x07;
+    if (vis_en && in->vborder == 0) {
+        st.gbuf_pipe0_reg = in->gbuf;
+        st.xscroll_pipe = in->reg16 & 0x07;
     } else {
-        gbuf_pipe0_reg = 0;
+        st.gbuf_pipe0_reg = 0;
     }
 
-    /* Only update vbuf and cbuf registers in the display state. */
-    if (vis_en && vicii.vborder == 0) {
-        if (!vicii.idle_state) {
-            vbuf_pipe0_reg = vicii.vbuf[dmli];
-            cbuf_pipe0_reg = vicii.cbuf[dmli];
-            dmli++;
-        } else {
-            vbuf_pipe0_reg = 0;
-            cbuf_pipe0_reg = 0;
-        }
-    } else {
-        dmli = 0;
+    /* Only update vbuf and cbuf registers in the display state.
+       fetch_input() has read them from vbuf/cbuf at dmli.  */
+    if (vis_en && in->vborder == 0) {
+        st.vbuf_pipe0_reg = in->vbuf;
+        st.cbuf_pipe0_reg = in->cbuf;
     }
 }
 
@@ -308,7 +374,7 @@ static DRAW_INLINE uint8_t get_trigger_candidates(int xpos)
 
     /* check for partial xpos match */
     for (s = 0; s < 8; s++) {
-        if ((xpos & 0x1f8) == (sprite_x_pipe[s] & 0x1f8)) {
+        if ((xpos & 0x1f8) == (st.sprite_x_pipe[s] & 0x1f8)) {
             candidate_bits |= 1 << s;
         }
     }
@@ -320,7 +386,7 @@ static DRAW_INLINE void trigger_sprites(int xpos, uint8_t candidate_bits)
     int s;
 
     /* do nothing if no sprites are candidates or pending */
-    if (!candidate_bits || !sprite_pending_bits) {
+    if (!candidate_bits || !st.sprite_pending_bits) {
         return;
     }
 
@@ -329,11 +395,11 @@ static DRAW_INLINE void trigger_sprites(int xpos, uint8_t candidate_bits)
         uint8_t m = 1 << s;
 
         /* start rendering on position match */
-        if ((candidate_bits & m) && (sprite_pending_bits & m) && !(sprite_active_bits & m) && !(sprite_halt_bits & m)) {
-            if (xpos == sprite_x_pipe[s]) {
-                sbuf_expx_flops |= m;
-                sbuf_mc_flops |= m;
-                sprite_active_bits |= m;
+        if ((candidate_bits & m) && (st.sprite_pending_bits & m) && !(st.sprite_active_bits & m) && !(st.sprite_halt_bits & m)) {
+            if (xpos == st.sprite_x_pipe[s]) {
+                st.sbuf_expx_flops |= m;
+                st.sbuf_mc_flops |= m;
+                st.sprite_active_bits |= m;
             }
         }
     }
@@ -346,7 +412,7 @@ static DRAW_INLINE void draw_sprites(int i)
     uint8_t collision_mask;
 
     /* do nothing if all sprites are inactive */
-    if (!sprite_active_bits) {
+    if (!st.sprite_active_bits) {
         return;
     }
 
@@ -356,31 +422,31 @@ static DRAW_INLINE void draw_sprites(int i)
     for (s = 7; s >= 0; --s) {
         uint8_t m = 1 << s;
 
-        if (sprite_active_bits & m) {
+        if (st.sprite_active_bits & m) {
             /* render pixels if shift register or pixel reg still contains data */
-            if (sbuf_reg[s] || sbuf_pixel_reg[s]) {
-                if (!(sprite_halt_bits & m)) {
-                    if (sbuf_expx_flops & m) {
-                        if (sprite_mc_bits & m) {
-                            if (sbuf_mc_flops & m) {
+            if (st.sbuf_reg[s] || st.sbuf_pixel_reg[s]) {
+                if (!(st.sprite_halt_bits & m)) {
+                    if (st.sbuf_expx_flops & m) {
+                        if (st.sprite_mc_bits & m) {
+                            if (st.sbuf_mc_flops & m) {
                                 /* fetch 2 bits */
-                                sbuf_pixel_reg[s] = (uint8_t)((sbuf_reg[s] >> 22) & 0x03);
+                                st.sbuf_pixel_reg[s] = (uint8_t)((st.sbuf_reg[s] >> 22) & 0x03);
                             }
-                            sbuf_mc_flops ^= m;
+                            st.sbuf_mc_flops ^= m;
                         } else {
                             /* fetch 1 bit and make it 0 or 2 */
-                            sbuf_pixel_reg[s] = (uint8_t)(((sbuf_reg[s] >> 23) & 0x01 ) << 1);
+                            st.sbuf_pixel_reg[s] = (uint8_t)(((st.sbuf_reg[s] >> 23) & 0x01 ) << 1);
                         }
                     }
 
                     /* shift the sprite buffer and handle expansion flags */
-                    if (sbuf_expx_flops & m) {
-                        sbuf_reg[s] <<= 1;
+                    if (st.sbuf_expx_flops & m) {
+                        st.sbuf_reg[s] <<= 1;
                     }
-                    if (sprite_expx_bits & m) {
-                        sbuf_expx_flops ^= m;
+                    if (st.sprite_expx_bits & m) {
+                        st.sbuf_expx_flops ^= m;
                     } else {
-                        sbuf_expx_flops |= m;
+                        st.sbuf_expx_flops |= m;
                     }
                 }
 
@@ -388,30 +454,30 @@ static DRAW_INLINE void draw_sprites(int i)
                  * set collision mask bits and determine the highest
                  * priority sprite number that has a pixel.
                  */
-                if (sbuf_pixel_reg[s]) {
+                if (st.sbuf_pixel_reg[s]) {
                     active_sprite = s;
                     collision_mask |= m;
                 }
             } else {
-                sprite_active_bits &= ~m;
+                st.sprite_active_bits &= ~m;
             }
         }
     }
 
     if (collision_mask) {
-        uint8_t pixel_pri = pri_buffer[i];
+        uint8_t pixel_pri = st.pri_buffer[i];
         int as = active_sprite;
-        uint8_t spri = sprite_pri_bits & (1 << as);
+        uint8_t spri = st.sprite_pri_bits & (1 << as);
         if (!(pixel_pri && spri)) {
-            switch (sbuf_pixel_reg[as]) {
+            switch (st.sbuf_pixel_reg[as]) {
                 case 1:
-                    render_buffer[i] = COL_D025;
+                    st.render_buffer[i] = COL_D025;
                     break;
                 case 2:
-                    render_buffer[i] = COL_D027 + as;
+                    st.render_buffer[i] = COL_D027 + as;
                     break;
                 case 3:
-                    render_buffer[i] = COL_D026;
+                    st.render_buffer[i] = COL_D026;
                     break;
                 default:
                     break;
@@ -419,55 +485,56 @@ static DRAW_INLINE void draw_sprites(int i)
         }
         /* if there was a foreground pixel, trigger collision */
         if (pixel_pri) {
-            vicii.sprite_background_collisions |= collision_mask;
+            sprite_background_collisions |= collision_mask;
         }
     }
 
     /* if 2 or more bits are set, trigger collisions */
     if (collision_mask & (collision_mask - 1)) {
-        vicii.sprite_sprite_collisions |= collision_mask;
+        sprite_sprite_collisions |= collision_mask;
     }
 }
 
 
-static DRAW_INLINE void update_sprite_mc_bits_6569(void)
+static DRAW_INLINE void update_sprite_mc_bits_6569(const draw_input_t *in)
 {
-    uint8_t next_mc_bits = vicii.regs[0x1c];
-    uint8_t toggled = next_mc_bits ^ sprite_mc_bits;
+    uint8_t next_mc_bits = in->reg1c;
+    uint8_t toggled = next_mc_bits ^ st.sprite_mc_bits;
 
-    sbuf_mc_flops &= ~toggled;
-    sprite_mc_bits = next_mc_bits;
+    st.sbuf_mc_flops &= ~toggled;
+    st.sprite_mc_bits = next_mc_bits;
 }
 
-static DRAW_INLINE void update_sprite_mc_bits_8565(void)
+static DRAW_INLINE void update_sprite_mc_bits_8565(const draw_input_t *in)
 {
-    uint8_t next_mc_bits = vicii.regs[0x1c];
-    uint8_t toggled = next_mc_bits ^ sprite_mc_bits;
+    uint8_t next_mc_bits = in->reg1c;
+    uint8_t toggled = next_mc_bits ^ st.sprite_mc_bits;
 
-    sbuf_mc_flops ^= toggled & (~sbuf_expx_flops);
-    sprite_mc_bits = next_mc_bits;
+    st.sbuf_mc_flops ^= toggled & (~st.sbuf_expx_flops);
+    st.sprite_mc_bits = next_mc_bits;
 }
 
-static DRAW_INLINE void update_sprite_data(unsigned int cycle_flags)
+static DRAW_INLINE void update_sprite_data(const draw_input_t *in)
 {
-    if (cycle_is_sprite_dma1_dma2(cycle_flags)) {
-        int s = cycle_get_sprite_num(cycle_flags);
-        sbuf_reg[s] = vicii.sprite[s].data;
+    if (cycle_is_sprite_dma1_dma2(in->cycle_flags)) {
+        int s = cycle_get_sprite_num(in->cycle_flags);
+        st.sbuf_reg[s] = in->sprite_data;
     }
 }
 
-static DRAW_INLINE void update_sprite_xpos(void)
+static DRAW_INLINE void update_sprite_xpos(const draw_input_t *in)
 {
     int s;
     for (s = 0; s < 8; s++) {
-        sprite_x_pipe[s] = vicii.sprite[s].x;
+        st.sprite_x_pipe[s] = in->sprite_x[s];
     }
 }
 
 
 
-static DRAW_INLINE void draw_sprites8(unsigned int cycle_flags)
+static DRAW_INLINE void draw_sprites8(const draw_input_t *in)
 {
+    unsigned int cycle_flags = in->cycle_flags;
     uint8_t candidate_bits;
     uint8_t dma_cycle_0 = 0;
     uint8_t dma_cycle_2 = 0;
@@ -484,6 +551,28 @@ static DRAW_INLINE void draw_sprites8(unsigned int cycle_flags)
     if (cycle_is_sprite_dma1_dma2(cycle_flags)) {
         dma_cycle_2 = 1 << cycle_get_sprite_num(cycle_flags);
     }
+
+    /* No sprite is shifting out, waiting for its x position or about to:
+       only the registers piped to the sprite sequencers change.  */
+    if (!(st.sprite_pending_bits | st.sprite_active_bits)
+        && !(spr_en && in->sprite_display_bits)) {
+        st.sprite_halt_bits |= dma_cycle_0;
+        if (spr_en) {
+            st.sprite_pending_bits = 0;
+        }
+        update_sprite_data(in);
+        if (in->color_latency) {
+            update_sprite_mc_bits_6569(in);
+        } else {
+            update_sprite_mc_bits_8565(in);
+        }
+        st.sprite_pri_bits = in->reg1b;
+        st.sprite_expx_bits = in->reg1d;
+        st.sprite_halt_bits &= ~dma_cycle_2;
+        update_sprite_xpos(in);
+        return;
+    }
+
     candidate_bits = get_trigger_candidates(xpos);
 
     /* process and render sprites */
@@ -494,41 +583,41 @@ static DRAW_INLINE void draw_sprites8(unsigned int cycle_flags)
     trigger_sprites(xpos + 1, candidate_bits);
     draw_sprites(1);
     /* pixel 2 */
-    sprite_active_bits &= ~dma_cycle_2;
+    st.sprite_active_bits &= ~dma_cycle_2;
     trigger_sprites(xpos + 2, candidate_bits);
     draw_sprites(2);
     /* pixel 3 */
-    sprite_halt_bits |= dma_cycle_0;
+    st.sprite_halt_bits |= dma_cycle_0;
     trigger_sprites(xpos + 3, candidate_bits);
     draw_sprites(3);
     /* pixel 4 */
     if (spr_en) {
-        sprite_pending_bits = vicii.sprite_display_bits;
+        st.sprite_pending_bits = in->sprite_display_bits;
     }
-    update_sprite_data(cycle_flags);
+    update_sprite_data(in);
     trigger_sprites(xpos + 4, candidate_bits);
     draw_sprites(4);
     /* pixel 5 */
     trigger_sprites(xpos + 5, candidate_bits);
     draw_sprites(5);
     /* pixel 6 */
-    if (!vicii.color_latency) {
-        update_sprite_mc_bits_8565();
+    if (!in->color_latency) {
+        update_sprite_mc_bits_8565(in);
     }
-    sprite_pri_bits = vicii.regs[0x1b];
-    sprite_expx_bits = vicii.regs[0x1d];
+    st.sprite_pri_bits = in->reg1b;
+    st.sprite_expx_bits = in->reg1d;
     trigger_sprites(xpos + 6, candidate_bits);
     draw_sprites(6);
     /* pixel 7 */
-    if (vicii.color_latency) {
-        update_sprite_mc_bits_6569();
+    if (in->color_latency) {
+        update_sprite_mc_bits_6569(in);
     }
-    sprite_halt_bits &= ~dma_cycle_2;
+    st.sprite_halt_bits &= ~dma_cycle_2;
     trigger_sprites(xpos + 7, candidate_bits);
     draw_sprites(7);
 
     /* pipe xpos */
-    update_sprite_xpos();
+    update_sprite_xpos(in);
 }
 
 
@@ -538,18 +627,18 @@ static DRAW_INLINE void draw_sprites8(unsigned int cycle_flags)
  *
  ******/
 
-static DRAW_INLINE void draw_border8(void)
+static DRAW_INLINE void draw_border8(const draw_input_t *in)
 {
-    uint8_t csel = vicii.regs[0x16] & 0x8;
+    uint8_t csel = in->reg16 & 0x8;
 
 #if 1
     /* early exit for the no border case */
-    if (!(border_state || vicii.main_border)) {
+    if (!(st.border_state || in->main_border)) {
         return;
     }
     /* early exit for the continuous border case */
-    if (border_state && vicii.main_border) {
-        memset(render_buffer, COL_D020, 8);
+    if (st.border_state && in->main_border) {
+        memset(st.render_buffer, COL_D020, 8);
         return;
     }
 #endif
@@ -559,17 +648,17 @@ static DRAW_INLINE void draw_border8(void)
      * (the code below can handle all border logic)
      */
     if (csel) {
-        if (border_state) {
-            memset(render_buffer, COL_D020, 8);
+        if (st.border_state) {
+            memset(st.render_buffer, COL_D020, 8);
         }
-        border_state = vicii.main_border;
+        st.border_state = in->main_border;
     } else {
-        if (border_state) {
-            memset(render_buffer, COL_D020, 7);
+        if (st.border_state) {
+            memset(st.render_buffer, COL_D020, 7);
         }
-        border_state = vicii.main_border;
-        if (border_state) {
-            render_buffer[7] = COL_D020;
+        st.border_state = in->main_border;
+        if (st.border_state) {
+            st.render_buffer[7] = COL_D020;
         }
     }
 }
@@ -582,11 +671,10 @@ static DRAW_INLINE void draw_border8(void)
  ******/
 
 /* used by draw_colors8() */
-static DRAW_INLINE void update_cregs(void)
+static DRAW_INLINE void update_cregs(const draw_input_t *in)
 {
-    last_color_reg = vicii.last_color_reg;
-    last_color_value = vicii.last_color_value;
-    vicii.last_color_reg = 0xff;
+    st.last_color_reg = in->last_color_reg;
+    st.last_color_value = in->last_color_value;
 }
 
 static DRAW_INLINE void draw_colors_6569(int offs, int i)
@@ -595,12 +683,12 @@ static DRAW_INLINE void draw_colors_6569(int offs, int i)
 
     /* resolve any unresolved colors */
     lookup_index = (i + 1) & 0x07;
-    pixel_buffer[lookup_index] = cregs[pixel_buffer[lookup_index]];
+    st.pixel_buffer[lookup_index] = st.cregs[st.pixel_buffer[lookup_index]];
 
     /* draw pixel to buffer */
-    vicii.dbuf[offs + i] = pixel_buffer[i];
+    vicii.dbuf[offs + i] = st.pixel_buffer[i];
 
-    pixel_buffer[i] = render_buffer[i];
+    st.pixel_buffer[i] = st.render_buffer[i];
 }
 
 static DRAW_INLINE void draw_colors_8565(int offs, int i)
@@ -611,19 +699,19 @@ static DRAW_INLINE void draw_colors_8565(int offs, int i)
     /* resolve any unresolved colors */
 
     /* special case for grey dot handling */
-    if (i == 0 && pixel_buffer[lookup_index] == last_color_reg) {
-        pixel_buffer[lookup_index] = 0x0f;
+    if (i == 0 && st.pixel_buffer[lookup_index] == st.last_color_reg) {
+        st.pixel_buffer[lookup_index] = 0x0f;
     } else {
-        pixel_buffer[lookup_index] = cregs[pixel_buffer[lookup_index]];
+        st.pixel_buffer[lookup_index] = st.cregs[st.pixel_buffer[lookup_index]];
     }
 
     /* draw pixel to buffer */
-    vicii.dbuf[offs + i] = pixel_buffer[i];
+    vicii.dbuf[offs + i] = st.pixel_buffer[i];
 
-    pixel_buffer[i] = render_buffer[i];
+    st.pixel_buffer[i] = st.render_buffer[i];
 }
 
-static DRAW_INLINE void draw_colors8(void)
+static DRAW_INLINE void draw_colors8(const draw_input_t *in)
 {
     int offs = vicii.dbuf_offset;
 
@@ -633,12 +721,12 @@ static DRAW_INLINE void draw_colors8(void)
     }
 
     /* update color register (if written) */
-    if (last_color_reg != 0xff) {
-        cregs[last_color_reg] = last_color_value;
+    if (st.last_color_reg != 0xff) {
+        st.cregs[st.last_color_reg] = st.last_color_value;
     }
 
     /* render pixels */
-    if (vicii.color_latency) {
+    if (in->color_latency) {
         draw_colors_6569(offs, 0);
         draw_colors_6569(offs, 1);
         draw_colors_6569(offs, 2);
@@ -659,7 +747,254 @@ static DRAW_INLINE void draw_colors8(void)
     }
     vicii.dbuf_offset += 8;
 
-    update_cregs();
+    update_cregs(in);
+}
+
+/* Same as draw_colors8() for a frame that is not drawn: the pipeline ends
+   in the same state, but no pixels are resolved and written.  */
+static DRAW_INLINE void skip_colors8(const draw_input_t *in)
+{
+    int offs = vicii.dbuf_offset;
+
+    if (offs > VICII_DRAW_BUFFER_SIZE - 8) {
+        return;
+    }
+
+    if (st.last_color_reg != 0xff) {
+        st.cregs[st.last_color_reg] = st.last_color_value;
+    }
+
+    memcpy(st.pixel_buffer, st.render_buffer, 8);
+    if (in->color_latency) {
+        /* draw_colors_6569() resolves the first pixel one cycle ahead */
+        st.pixel_buffer[0] = st.cregs[st.pixel_buffer[0]];
+    }
+    vicii.dbuf_offset += 8;
+
+    update_cregs(in);
+}
+
+
+/* No sprite is being shifted out or waiting to start, so drawing can't
+   find collisions until sprite DMA is turned on.  Not known while a cached
+   line is reused.  */
+int vicii_draw_cycle_sprites_idle(void)
+{
+    return !line_cache_reuse && !(st.sprite_pending_bits | st.sprite_active_bits);
+}
+
+
+/**************************************************************************
+ *
+ * SECTION  vicii_draw_cycle()
+ *
+ ******/
+
+static DRAW_INLINE void fetch_input(draw_input_t *in)
+{
+    unsigned int cycle_flags = cycle_flags_pipe;
+    int s;
+
+    for (s = 0; s < 8; s++) {
+        in->sprite_x[s] = vicii.sprite[s].x;
+    }
+    if (cycle_is_sprite_dma1_dma2(cycle_flags)) {
+        in->sprite_data = vicii.sprite[cycle_get_sprite_num(cycle_flags)].data;
+    } else {
+        in->sprite_data = 0;
+    }
+    in->cycle_flags = cycle_flags;
+
+    in->reg11 = vicii.regs[0x11];
+    in->reg16 = vicii.regs[0x16];
+    in->reg1b = vicii.regs[0x1b];
+    in->reg1c = vicii.regs[0x1c];
+    in->reg1d = vicii.regs[0x1d];
+
+    in->vborder = vicii.vborder != 0;
+    in->idle_state = vicii.idle_state != 0;
+    in->main_border = vicii.main_border != 0;
+
+    /* Only update vbuf and cbuf registers in the display state. */
+    in->gbuf = 0;
+    in->vbuf = 0;
+    in->cbuf = 0;
+    if (cycle_is_visible(cycle_flags) && vicii.vborder == 0) {
+        in->gbuf = vicii.gbuf;
+        if (!vicii.idle_state) {
+            in->vbuf = vicii.vbuf[dmli];
+            in->cbuf = vicii.cbuf[dmli];
+            dmli++;
+        }
+    } else {
+        dmli = 0;
+    }
+
+    if (cycle_is_check_spr_disp(cycle_flags)) {
+        in->sprite_display_bits = vicii.sprite_display_bits;
+    } else {
+        in->sprite_display_bits = 0;
+    }
+
+    in->last_color_reg = vicii.last_color_reg;
+    in->last_color_value = (vicii.last_color_reg != 0xff) ? vicii.last_color_value : 0;
+    in->color_latency = vicii.color_latency != 0;
+    in->unused = 0;
+
+    cycle_flags_pipe = vicii.cycle_flags;
+}
+
+static void draw_cycle(const draw_input_t *in)
+{
+    sprite_sprite_collisions = 0;
+    sprite_background_collisions = 0;
+
+    draw_graphics8(in);
+
+    draw_sprites8(in);
+
+    draw_border8(in);
+
+    if (vicii.raster.skip_frame) {
+        skip_colors8(in);
+    } else {
+        draw_colors8(in);
+    }
+}
+
+
+/**************************************************************************
+ *
+ * SECTION  line cache
+ *
+ ******/
+
+/*
+ * The pixels of a line only depend on the state of the pipeline at the
+ * start of the line and on what each cycle reads from the VIC-II.  Both are
+ * kept per raster line.  As long as the cycles of a line read the same as
+ * in the last frame, the pixels and collisions of the last frame are used
+ * instead of drawing.  On the first difference the state of the start of
+ * the line is restored and the cycles so far are drawn from the inputs
+ * kept, so that the rest of the line is drawn exactly as without the cache.
+ */
+
+/* draw the first `cycles' cycles of the current line from its entry */
+static void line_cache_catch_up(unsigned int cycles)
+{
+    line_cache_entry_t *entry = line_cache_line;
+    unsigned int i;
+
+    memcpy(&st, &entry->start, sizeof(st));
+    vicii.dbuf_offset = 0;
+    for (i = 0; i < cycles; i++) {
+        draw_cycle(&entry->input[i]);
+    }
+    line_cache_reuse = 0;
+}
+
+static void line_cache_end_line(void)
+{
+    line_cache_entry_t *entry = line_cache_line;
+
+    if (entry == NULL) {
+        return;
+    }
+
+    if (line_cache_reuse && line_cache_cycle == entry->cycles) {
+        memcpy(&st, &entry->end, sizeof(st));
+        line_cache_reuse = 0;
+    } else {
+        if (line_cache_reuse) {
+            line_cache_catch_up(line_cache_cycle);
+        }
+        memcpy(&entry->end, &st, sizeof(st));
+        memcpy(entry->dbuf, vicii.dbuf, VICII_DRAW_BUFFER_SIZE);
+        entry->cycles = line_cache_cycle;
+        entry->valid = 1;
+    }
+    line_cache_line = NULL;
+}
+
+static void line_cache_start_line(void)
+{
+    line_cache_entry_t *entry;
+
+    line_cache_end_line();
+
+    if (vicii.raster_line >= LINE_CACHE_LINES) {
+        return;
+    }
+
+    entry = &line_cache[vicii.raster_line];
+    line_cache_reuse = entry->valid && memcmp(&entry->start, &st, sizeof(st)) == 0;
+    if (!line_cache_reuse) {
+        entry->valid = 0;
+        memcpy(&entry->start, &st, sizeof(st));
+    }
+    line_cache_line = entry;
+    line_cache_cycle = 0;
+}
+
+static void line_cache_draw_cycle(const draw_input_t *in)
+{
+    line_cache_entry_t *entry = line_cache_line;
+    unsigned int cycle = line_cache_cycle;
+
+    if (cycle >= LINE_CACHE_CYCLES) {
+        line_cache_sync();
+        draw_cycle(in);
+        return;
+    }
+    line_cache_cycle++;
+
+    if (line_cache_reuse) {
+        if (cycle < entry->cycles
+            && memcmp(&entry->input[cycle], in, sizeof(draw_input_t)) == 0) {
+            int offs = vicii.dbuf_offset;
+
+            if (offs <= VICII_DRAW_BUFFER_SIZE - 8) {
+                memcpy(vicii.dbuf + offs, entry->dbuf + offs, 8);
+                vicii.dbuf_offset += 8;
+            }
+            sprite_sprite_collisions = entry->sprite_sprite_collisions[cycle];
+            sprite_background_collisions = entry->sprite_background_collisions[cycle];
+            return;
+        }
+        line_cache_catch_up(cycle);
+    }
+
+    memcpy(&entry->input[cycle], in, sizeof(draw_input_t));
+    draw_cycle(in);
+    entry->sprite_sprite_collisions[cycle] = sprite_sprite_collisions;
+    entry->sprite_background_collisions[cycle] = sprite_background_collisions;
+}
+
+/* Bring `st' up to date and stop caching the current line, before anything
+   outside of the drawing looks at or changes the state.  */
+static void line_cache_sync(void)
+{
+    if (line_cache_line == NULL) {
+        return;
+    }
+    if (line_cache_reuse) {
+        line_cache_catch_up(line_cache_cycle);
+    }
+    line_cache_line->valid = 0;
+    line_cache_line = NULL;
+}
+
+int vicii_draw_cycle_set_line_cache(int enable)
+{
+    line_cache_sync();
+
+    if (enable && line_cache == NULL) {
+        line_cache = lib_calloc(LINE_CACHE_LINES, sizeof(line_cache_entry_t));
+    } else if (!enable && line_cache != NULL) {
+        lib_free(line_cache);
+        line_cache = NULL;
+    }
+    return 0;
 }
 
 
@@ -671,20 +1006,36 @@ static DRAW_INLINE void draw_colors8(void)
 
 void vicii_draw_cycle(void)
 {
+    draw_input_t input;
+    int offs;
+
     /* reset rendering on raster cycle 1 */
     if (vicii.raster_cycle == 1) {
+        if (line_cache != NULL && !vicii.raster.skip_frame) {
+            line_cache_start_line();
+        }
         vicii.dbuf_offset = 0;
     }
 
-    draw_graphics8(cycle_flags_pipe);
-
-    draw_sprites8(cycle_flags_pipe);
+    /* the line cache only keeps lines that are drawn */
+    if (vicii.raster.skip_frame) {
+        line_cache_sync();
+    }
+    offs = vicii.dbuf_offset;
 
-    draw_border8();
+    fetch_input(&input);
 
-    draw_colors8();
+    if (line_cache_line != NULL) {
+        line_cache_draw_cycle(&input);
+    } else {
+        draw_cycle(&input);
+    }
 
-    cycle_flags_pipe = vicii.cycle_flags;
+    vicii.sprite_sprite_collisions |= sprite_sprite_collisions;
+    vicii.sprite_background_collisions |= sprite_background_collisions;
+    if (offs <= VICII_DRAW_BUFFER_SIZE - 8) {
+        vicii.last_color_reg = 0xff;
+    }
 }
 
 
@@ -692,24 +1043,31 @@ void vicii_draw_cycle_init(void)
 {
     int i;
 
+    line_cache_sync();
+
     /* initialize the draw buffer */
     memset(vicii.dbuf, 0, VICII_DRAW_BUFFER_SIZE);
     vicii.dbuf_offset = 0;
 
     /* initialize the pixel ring buffer. */
-    memset(pixel_buffer, 0, sizeof(pixel_buffer));
+    memset(st.pixel_buffer, 0, sizeof(st.pixel_buffer));
 
     /* clear cregs and fill 0x00-0x0f with 1:1 mapping */
-    memset(cregs, 0, sizeof(cregs));
+    memset(st.cregs, 0, sizeof(st.cregs));
     for (i = 0; i < 0x10; i++) {
-        cregs[i] = i;
+        st.cregs[i] = i;
     }
     vicii.last_color_reg = 0xff;
-    last_color_reg = 0xff;
+    st.last_color_reg = 0xff;
 
     cycle_flags_pipe = 0;
 }
 
+void vicii_draw_cycle_shutdown(void)
+{
+    vicii_draw_cycle_set_line_cache(0);
+}
+
 
 /**************************************************************************
  *
@@ -723,59 +1081,61 @@ int vicii_draw_cycle_snapshot_write(snapshot_module_t *m)
 {
     int i;
 
+    line_cache_sync();
+
     if (0
-        || SMW_B(m, gbuf_pipe0_reg) < 0
-        || SMW_B(m, cbuf_pipe0_reg) < 0
-        || SMW_B(m, vbuf_pipe0_reg) < 0
-        || SMW_B(m, gbuf_pipe1_reg) < 0
-        || SMW_B(m, cbuf_pipe1_reg) < 0
-        || SMW_B(m, vbuf_pipe1_reg) < 0
-        || SMW_B(m, xscroll_pipe) < 0
-        || SMW_B(m, vmode11_pipe) < 0
-        || SMW_B(m, vmode16_pipe) < 0
-        || SMW_B(m, vmode16_pipe2) < 0
-        || SMW_B(m, gbuf_reg) < 0
-        || SMW_B(m, gbuf_mc_flop) < 0
-        || SMW_B(m, gbuf_pixel_reg) < 0
-        || SMW_B(m, cbuf_reg) < 0
-        || SMW_B(m, vbuf_reg) < 0
+        || SMW_B(m, st.gbuf_pipe0_reg) < 0
+        || SMW_B(m, st.cbuf_pipe0_reg) < 0
+        || SMW_B(m, st.vbuf_pipe0_reg) < 0
+        || SMW_B(m, st.gbuf_pipe1_reg) < 0
+        || SMW_B(m, st.cbuf_pipe1_reg) < 0
+        || SMW_B(m, st.vbuf_pipe1_reg) < 0
+        || SMW_B(m, st.xscroll_pipe) < 0
+        || SMW_B(m, st.vmode11_pipe) < 0
+        || SMW_B(m, st.vmode16_pipe) < 0
+        || SMW_B(m, st.vmode16_pipe2) < 0
+        || SMW_B(m, st.gbuf_reg) < 0
+        || SMW_B(m, st.gbuf_mc_flop) < 0
+        || SMW_B(m, st.gbuf_pixel_reg) < 0
+        || SMW_B(m, st.cbuf_reg) < 0
+        || SMW_B(m, st.vbuf_reg) < 0
         || SMW_B(m, dmli) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMW_DW(m, (uint32_t)sprite_x_pipe[i]) < 0) {
+        if (SMW_DW(m, (uint32_t)st.sprite_x_pipe[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMW_B(m, sprite_pri_bits) < 0
-        || SMW_B(m, sprite_mc_bits) < 0
-        || SMW_B(m, sprite_expx_bits) < 0
-        || SMW_B(m, sprite_pending_bits) < 0
-        || SMW_B(m, sprite_active_bits) < 0
-        || SMW_B(m, sprite_halt_bits) < 0) {
+        || SMW_B(m, st.sprite_pri_bits) < 0
+        || SMW_B(m, st.sprite_mc_bits) < 0
+        || SMW_B(m, st.sprite_expx_bits) < 0
+        || SMW_B(m, st.sprite_pending_bits) < 0
+        || SMW_B(m, st.sprite_active_bits) < 0
+        || SMW_B(m, st.sprite_halt_bits) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMW_DW(m, sbuf_reg[i]) < 0) {
+        if (SMW_DW(m, st.sbuf_reg[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMW_BA(m, sbuf_pixel_reg, 8) < 0
-        || SMW_B(m, sbuf_expx_flops) < 0
-        || SMW_B(m, sbuf_mc_flops) < 0
-        || SMW_B(m, (uint8_t)border_state) < 0
-        || SMW_BA(m, render_buffer, 8) < 0
-        || SMW_BA(m, pri_buffer, 8) < 0
-        || SMW_BA(m, pixel_buffer, 8) < 0
-        || SMW_BA(m, cregs, 0x2f) < 0
-        || SMW_B(m, last_color_reg) < 0
-        || SMW_B(m, last_color_value) < 0
+        || SMW_BA(m, st.sbuf_pixel_reg, 8) < 0
+        || SMW_B(m, st.sbuf_expx_flops) < 0
+        || SMW_B(m, st.sbuf_mc_flops) < 0
+        || SMW_B(m, (uint8_t)st.border_state) < 0
+        || SMW_BA(m, st.render_buffer, 8) < 0
+        || SMW_BA(m, st.pri_buffer, 8) < 0
+        || SMW_BA(m, st.pixel_buffer, 8) < 0
+        || SMW_BA(m, st.cregs, 0x2f) < 0
+        || SMW_B(m, st.last_color_reg) < 0
+        || SMW_B(m, st.last_color_value) < 0
         || SMW_DW(m, (uint32_t)cycle_flags_pipe) < 0) {
         return -1;
     }
@@ -787,59 +1147,61 @@ int vicii_draw_cycle_snapshot_read(snapshot_module_t *m)
 {
     int i;
 
+    line_cache_sync();
+
     if (0
-        || SMR_B(m, &gbuf_pipe0_reg) < 0
-        || SMR_B(m, &cbuf_pipe0_reg) < 0
-        || SMR_B(m, &vbuf_pipe0_reg) < 0
-        || SMR_B(m, &gbuf_pipe1_reg) < 0
-        || SMR_B(m, &cbuf_pipe1_reg) < 0
-        || SMR_B(m, &vbuf_pipe1_reg) < 0
-        || SMR_B(m, &xscroll_pipe) < 0
-        || SMR_B(m, &vmode11_pipe) < 0
-        || SMR_B(m, &vmode16_pipe) < 0
-        || SMR_B(m, &vmode16_pipe2) < 0
-        || SMR_B(m, &gbuf_reg) < 0
-        || SMR_B(m, &gbuf_mc_flop) < 0
-        || SMR_B(m, &gbuf_pixel_reg) < 0
-        || SMR_B(m, &cbuf_reg) < 0
-        || SMR_B(m, &vbuf_reg) < 0
+        || SMR_B(m, &st.gbuf_pipe0_reg) < 0
+        || SMR_B(m, &st.cbuf_pipe0_reg) < 0
+        || SMR_B(m, &st.vbuf_pipe0_reg) < 0
+        || SMR_B(m, &st.gbuf_pipe1_reg) < 0
+        || SMR_B(m, &st.cbuf_pipe1_reg) < 0
+        || SMR_B(m, &st.vbuf_pipe1_reg) < 0
+        || SMR_B(m, &st.xscroll_pipe) < 0
+        || SMR_B(m, &st.vmode11_pipe) < 0
+        || SMR_B(m, &st.vmode16_pipe) < 0
+        || SMR_B(m, &st.vmode16_pipe2) < 0
+        || SMR_B(m, &st.gbuf_reg) < 0
+        || SMR_B(m, &st.gbuf_mc_flop) < 0
+        || SMR_B(m, &st.gbuf_pixel_reg) < 0
+        || SMR_B(m, &st.cbuf_reg) < 0
+        || SMR_B(m, &st.vbuf_reg) < 0
         || SMR_B(m, &dmli) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMR_DW_INT(m, &sprite_x_pipe[i]) < 0) {
+        if (SMR_DW_INT(m, &st.sprite_x_pipe[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMR_B(m, &sprite_pri_bits) < 0
-        || SMR_B(m, &sprite_mc_bits) < 0
-        || SMR_B(m, &sprite_expx_bits) < 0
-        || SMR_B(m, &sprite_pending_bits) < 0
-        || SMR_B(m, &sprite_active_bits) < 0
-        || SMR_B(m, &sprite_halt_bits) < 0) {
+        || SMR_B(m, &st.sprite_pri_bits) < 0
+        || SMR_B(m, &st.sprite_mc_bits) < 0
+        || SMR_B(m, &st.sprite_expx_bits) < 0
+        || SMR_B(m, &st.sprite_pending_bits) < 0
+        || SMR_B(m, &st.sprite_active_bits) < 0
+        || SMR_B(m, &st.sprite_halt_bits) < 0) {
         return -1;
     }
 
     for (i = 0; i < 8; i++) {
-        if (SMR_DW(m, &sbuf_reg[i]) < 0) {
+        if (SMR_DW(m, &st.sbuf_reg[i]) < 0) {
             return -1;
         }
     }
 
     if (0
-        || SMR_BA(m, sbuf_pixel_reg, 8) < 0
-        || SMR_B(m, &sbuf_expx_flops) < 0
-        || SMR_B(m, &sbuf_mc_flops) < 0
-        || SMR_B_INT(m, &border_state) < 0
-        || SMR_BA(m, render_buffer, 8) < 0
-        || SMR_BA(m, pri_buffer, 8) < 0
-        || SMR_BA(m, pixel_buffer, 8) < 0
-        || SMR_BA(m, cregs, 0x2f) < 0
-        || SMR_B(m, &last_color_reg) < 0
-        || SMR_B(m, &last_color_value) < 0
+        || SMR_BA(m, st.sbuf_pixel_reg, 8) < 0
+        || SMR_B(m, &st.sbuf_expx_flops) < 0
+        || SMR_B(m, &st.sbuf_mc_flops) < 0
+        || SMR_B_INT(m, &st.border_state) < 0
+        || SMR_BA(m, st.render_buffer, 8) < 0
+        || SMR_BA(m, st.pri_buffer, 8) < 0
+        || SMR_BA(m, st.pixel_buffer, 8) < 0
+        || SMR_BA(m, st.cregs, 0x2f) < 0
+        || SMR_B(m, &st.last_color_reg) < 0
+        || SMR_B(m, &st.last_color_value) < 0
         || SMR_DW_UINT(m, &cycle_flags_pipe) < 0) {
         return -1;
     }
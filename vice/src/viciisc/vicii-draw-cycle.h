@@ -29,6 +29,10 @@
 
 void vicii_draw_cycle(void);
 void vicii_draw_cycle_init(void);
+void vicii_draw_cycle_shutdown(void);
+
+int vicii_draw_cycle_set_line_cache(int enable);
+int vicii_draw_cycle_sprites_idle(void);
 
 void vicii_monitor_colreg_store(int reg, int value);
 
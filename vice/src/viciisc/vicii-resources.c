@@ -37,6 +37,7 @@
 #include "vicii-chip-model.h"
 #include "vicii-cycle.h"
 #include "vicii-color.h"
+#include "vicii-draw-cycle.h"
 #include "vicii-resources.h"
 #include "vicii-timing.h"
 #include "vicii.h"
@@ -92,6 +93,12 @@ static int set_vsp_bug_enabled(int val, void *param)
     return 0;
 }
 
+static int set_line_cache_enabled(int val, void *param)
+{
+    vicii_resources.line_cache_enabled = val ? 1 : 0;
+    return vicii_draw_cycle_set_line_cache(vicii_resources.line_cache_enabled);
+}
+
 struct vicii_model_info_s {
     int video;
     int luma;
@@ -162,6 +169,9 @@ static const resource_int_t resources_int[] =
     { "VICIIVSPBug", 0, RES_EVENT_SAME, NULL,
       &vicii_resources.vsp_bug_enabled,
       set_vsp_bug_enabled, NULL },
+    { "VICIILineCache", 0, RES_EVENT_NO, NULL,
+      &vicii_resources.line_cache_enabled,
+      set_line_cache_enabled, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -45,6 +45,9 @@ struct vicii_resources_s {
 
     /* Flag: Do we emulate the "VSP bug" behaviour? */
     int vsp_bug_enabled;
+
+    /* Flag: Do we reuse the pixels of lines that did not change?  */
+    int line_cache_enabled;
 };
 typedef struct vicii_resources_s vicii_resources_t;
 
@@ -457,6 +457,7 @@ void vicii_set_canvas_refresh(int enable)
 
 void vicii_shutdown(void)
 {
+    vicii_draw_cycle_shutdown();
     raster_shutdown(&vicii.raster);
 }
 
@@ -227,6 +227,19 @@ struct vicii_s {
     /* cycle table (set by vicii-chip-model). */
     unsigned int cycle_table[65];
 
+    /* CYCLE_* steps per cycle (set by vicii-chip-model). */
+    uint8_t cycle_steps[65];
+
+    /* number of cycles after each cycle before one that checks sprite DMA
+       or starts a line or a frame, [1] also before a matrix fetch BA cycle
+       (set by vicii-chip-model, see vicii_cycle_quiet()). */
+    uint8_t quiet_cycles[2][65];
+
+    /* number of cycles after each cycle in which BA is low for the matrix
+       fetch of a bad line (set by vicii-chip-model, see
+       vicii_steal_cycles()). */
+    uint8_t ba_low_cycles[65];
+
     /* last color register update (set by vicii-mem.c,
        cleared by vicii-draw-cycle.c */
     uint8_t last_color_reg;
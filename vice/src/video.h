@@ -42,6 +42,7 @@
 #define VIDEO_GLFILTER_NEAREST      0
 #define VIDEO_GLFILTER_BILINEAR     1
 #define VIDEO_GLFILTER_BICUBIC      2
+#define VIDEO_GLFILTER_CRT          3   /* PAL CRT emulation in a shader */
 
 /* These constants are used to configure the video output.  */
 
@@ -86,6 +87,19 @@ struct canvas_refresh_s {
 };
 typedef struct canvas_refresh_s canvas_refresh_t;
 
+/* Target area of a video_canvas_render_changed() call */
+struct video_render_area_s {
+    uint8_t *trg;
+    int width;
+    int height;
+    int xs;
+    int ys;
+    int xt;
+    int yt;
+    int pitcht;
+};
+typedef struct video_render_area_s video_render_area_t;
+
 struct draw_buffer_s {
     /* The real drawing buffers, with padding bytes on either side to workaround CRT and Scale2x bugs */
     uint8_t *draw_buffer_padded_allocations[2];
@@ -114,6 +128,24 @@ struct draw_buffer_s {
     unsigned int visible_width;
     /* Height of the visible subset of draw_buffer, in pixels */
     unsigned int visible_height;
+    /* Copy of draw_buffer as of the last refresh by the raster code, to find the lines that changed */
+    uint8_t *draw_buffer_previous;
+    /* One flag per line of draw_buffer, nonzero if the line changed since the last refresh */
+    uint8_t *dirty_lines;
+    /* Nonzero only during the refresh by the raster code, dirty_lines is not valid otherwise */
+    int dirty_lines_valid;
+    /* Nonzero if all lines must be considered changed at the next refresh */
+    int dirty_lines_reset;
+    /* Area of the last video_canvas_render_changed() call */
+    video_render_area_t render_area;
+    /* Hash of each line of draw_buffer as it was when last rendered, for the refreshes that do not come from the raster code */
+    uint64_t *line_hashes;
+    /* One flag per line of draw_buffer, nonzero if its hash changed at the last refresh */
+    uint8_t *hashed_lines;
+    /* Number of lines of line_hashes and hashed_lines */
+    unsigned int line_hashes_size;
+    /* Bytes allocated by the raster code for the buffers above, for the memory report */
+    size_t draw_buffer_bytes;
 };
 typedef struct draw_buffer_s draw_buffer_t;
 
@@ -170,6 +202,7 @@ struct video_render_color_tables_s {
     uint32_t yuv_table[512];
     int32_t line_yuv_0[VIDEO_MAX_OUTPUT_WIDTH * 3];
     int16_t prevrgbline[VIDEO_MAX_OUTPUT_WIDTH * 3];
+    int32_t yuvline[3][VIDEO_MAX_OUTPUT_WIDTH];  /* Y, U, V of the line being converted */
     uint8_t rgbscratchbuffer[VIDEO_MAX_OUTPUT_WIDTH * 4];
 
     /*
@@ -184,6 +217,14 @@ struct video_render_color_tables_s {
     uint32_t gamma_grn_fac[256 * 3 * 2];
     uint32_t gamma_blu_fac[256 * 3 * 2];
 
+    /* parameters the gamma tables above were calculated for */
+    int gamma_valid;
+    int gamma_brightness;
+    int gamma_contrast;
+    int gamma_gamma;
+    int gamma_scanlineshade;
+    int gamma_video;
+
     /* optional alpha value for 32bit rendering */
     uint32_t alpha;
 
@@ -226,6 +267,7 @@ struct video_render_config_s {
     int vsync;                     /* <CHIP>VSync */
     int external_palette;          /* Use an external palette?  */
     char *external_palette_name;   /* Name of the external palette.  */
+    struct palette_s *external_palette_loaded; /* External palette as loaded from the file.  */
     int readable;                  /* reading of frame buffer is safe and fast */
     int interlaced;                /* Is the output currently interlaced? */
     int interlace_field;           /* Which of the two interlaced frames is current? */
@@ -278,6 +320,14 @@ void video_canvas_map(struct video_canvas_s *canvas);
 void video_canvas_unmap(struct video_canvas_s *canvas);
 void video_canvas_resize(struct video_canvas_s *canvas, char resize_canvas);
 void video_canvas_render(struct video_canvas_s *canvas, uint8_t *trg, int width, int height, int xs, int ys, int xt, int yt, int pitcht);
+int video_canvas_render_changed(struct video_canvas_s *canvas, uint8_t *trg, int width, int height, int xs, int ys, int xt, int yt, int pitcht, uint8_t *trg_rows);
+/* Refresh rendered later, possibly on another thread */
+typedef struct video_render_deferred_s video_render_deferred_t;
+video_render_deferred_t *video_render_deferred_new(void);
+void video_render_deferred_free(video_render_deferred_t *job);
+void video_canvas_render_deferred(struct video_canvas_s *canvas, video_render_deferred_t *job, int width, int height, int xs, int ys, int xt, int yt, int full);
+int video_render_deferred_run(video_render_deferred_t *job, uint8_t *trg, int pitcht, uint8_t *trg_rows);
+void video_canvas_render_indexed(struct video_canvas_s *canvas, uint8_t *trg, int width, int height, int xs, int ys, int xt, int yt, int pitcht);
 void video_canvas_refresh_all(struct video_canvas_s *canvas);
 char video_canvas_can_resize(struct video_canvas_s *canvas);
 void video_viewport_get(struct video_canvas_s *canvas, struct viewport_s **viewport, struct geometry_s **geometry);
@@ -322,5 +372,6 @@ typedef struct video_cbm_palette_s {
 void video_color_palette_internal(struct video_canvas_s *canvas, struct video_cbm_palette_s *cbm_palette);
 int video_color_update_palette(struct video_canvas_s *canvas);
 void video_color_palette_free(struct palette_s *palette);
+void video_color_palette_forget(struct video_render_config_s *videoconfig);
 
 #endif
@@ -0,0 +1,257 @@
+/*
+ * render-yuv.c - YUV to RGB conversion kernels of the CRT renderers.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* The vector versions do the same 32 bit integer arithmetic as the C
+   version, including the arithmetic right shifts, so the output is the
+   same bit for bit.  The gamma table lookups that follow stay with the
+   renderers.  */
+
+#include "vice.h"
+
+#include "render-yuv.h"
+#include "types.h"
+
+#ifdef RENDER_YUV_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef RENDER_YUV_AVX2
+#include <immintrin.h>
+#endif
+#ifdef RENDER_YUV_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+    YUV to RGB
+
+    R = Y + V
+    G = Y - (0.1953 * U + 0.5078 * V)
+    B = Y + U
+*/
+static inline void yuv_to_rgb_pal(int32_t *y, int32_t *u, int32_t *v)
+{
+    int32_t red = (*y + *v) >> 16;
+    int32_t blu = (*y + *u) >> 16;
+    int32_t grn = (*y - ((50 * *u + 130 * *v) >> 8)) >> 16;
+
+    *y = red;
+    *u = grn;
+    *v = blu;
+}
+
+/*
+    YIQ->RGB (Sony CXA2025AS US decoder matrix)
+
+    R = Y + (1.630 * I + 0.317 * Q)
+    G = Y - (0.378 * I + 0.466 * Q)
+    B = Y - (1.089 * I - 1.677 * Q)
+*/
+static inline void yuv_to_rgb_ntsc(int32_t *y, int32_t *u, int32_t *v)
+{
+    int32_t red = (*y + ((209 * *u +  41 * *v) >> 7)) >> 15;
+    int32_t grn = (*y - (( 48 * *u +  69 * *v) >> 7)) >> 15;
+    int32_t blu = (*y - ((139 * *u - 215 * *v) >> 7)) >> 15;
+
+    *y = red;
+    *u = grn;
+    *v = blu;
+}
+
+void render_yuv_to_rgb_pal_c(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        yuv_to_rgb_pal(&y[i], &u[i], &v[i]);
+    }
+}
+
+void render_yuv_to_rgb_ntsc_c(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        yuv_to_rgb_ntsc(&y[i], &u[i], &v[i]);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef RENDER_YUV_SSE2
+
+/* SSE2 has no 32 bit multiply, use two 32x32->64 bit ones.  The low halves
+   are the same for signed and unsigned numbers.  */
+static inline __m128i mullo_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+void render_yuv_to_rgb_pal_sse2(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    const __m128i k50 = _mm_set1_epi32(50);
+    const __m128i k130 = _mm_set1_epi32(130);
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i vy = _mm_loadu_si128((const __m128i *)&y[i]);
+        __m128i vu = _mm_loadu_si128((const __m128i *)&u[i]);
+        __m128i vv = _mm_loadu_si128((const __m128i *)&v[i]);
+        __m128i uv = _mm_srai_epi32(_mm_add_epi32(mullo_sse2(vu, k50), mullo_sse2(vv, k130)), 8);
+
+        _mm_storeu_si128((__m128i *)&y[i], _mm_srai_epi32(_mm_add_epi32(vy, vv), 16));
+        _mm_storeu_si128((__m128i *)&u[i], _mm_srai_epi32(_mm_sub_epi32(vy, uv), 16));
+        _mm_storeu_si128((__m128i *)&v[i], _mm_srai_epi32(_mm_add_epi32(vy, vu), 16));
+    }
+    render_yuv_to_rgb_pal_c(&y[i], &u[i], &v[i], n - i);
+}
+
+void render_yuv_to_rgb_ntsc_sse2(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    const __m128i k209 = _mm_set1_epi32(209);
+    const __m128i k41 = _mm_set1_epi32(41);
+    const __m128i k48 = _mm_set1_epi32(48);
+    const __m128i k69 = _mm_set1_epi32(69);
+    const __m128i k139 = _mm_set1_epi32(139);
+    const __m128i k215 = _mm_set1_epi32(215);
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i vy = _mm_loadu_si128((const __m128i *)&y[i]);
+        __m128i vu = _mm_loadu_si128((const __m128i *)&u[i]);
+        __m128i vv = _mm_loadu_si128((const __m128i *)&v[i]);
+        __m128i r = _mm_srai_epi32(_mm_add_epi32(mullo_sse2(vu, k209), mullo_sse2(vv, k41)), 7);
+        __m128i g = _mm_srai_epi32(_mm_add_epi32(mullo_sse2(vu, k48), mullo_sse2(vv, k69)), 7);
+        __m128i b = _mm_srai_epi32(_mm_sub_epi32(mullo_sse2(vu, k139), mullo_sse2(vv, k215)), 7);
+
+        _mm_storeu_si128((__m128i *)&y[i], _mm_srai_epi32(_mm_add_epi32(vy, r), 15));
+        _mm_storeu_si128((__m128i *)&u[i], _mm_srai_epi32(_mm_sub_epi32(vy, g), 15));
+        _mm_storeu_si128((__m128i *)&v[i], _mm_srai_epi32(_mm_sub_epi32(vy, b), 15));
+    }
+    render_yuv_to_rgb_ntsc_c(&y[i], &u[i], &v[i], n - i);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef RENDER_YUV_AVX2
+
+/* Only called if the CPU has AVX2, see video-render.c.  */
+
+__attribute__((target("avx2")))
+void render_yuv_to_rgb_pal_avx2(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    const __m256i k50 = _mm256_set1_epi32(50);
+    const __m256i k130 = _mm256_set1_epi32(130);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i vy = _mm256_loadu_si256((const __m256i *)&y[i]);
+        __m256i vu = _mm256_loadu_si256((const __m256i *)&u[i]);
+        __m256i vv = _mm256_loadu_si256((const __m256i *)&v[i]);
+        __m256i uv = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(vu, k50),
+                                                        _mm256_mullo_epi32(vv, k130)), 8);
+
+        _mm256_storeu_si256((__m256i *)&y[i], _mm256_srai_epi32(_mm256_add_epi32(vy, vv), 16));
+        _mm256_storeu_si256((__m256i *)&u[i], _mm256_srai_epi32(_mm256_sub_epi32(vy, uv), 16));
+        _mm256_storeu_si256((__m256i *)&v[i], _mm256_srai_epi32(_mm256_add_epi32(vy, vu), 16));
+    }
+    render_yuv_to_rgb_pal_c(&y[i], &u[i], &v[i], n - i);
+}
+
+__attribute__((target("avx2")))
+void render_yuv_to_rgb_ntsc_avx2(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    const __m256i k209 = _mm256_set1_epi32(209);
+    const __m256i k41 = _mm256_set1_epi32(41);
+    const __m256i k48 = _mm256_set1_epi32(48);
+    const __m256i k69 = _mm256_set1_epi32(69);
+    const __m256i k139 = _mm256_set1_epi32(139);
+    const __m256i k215 = _mm256_set1_epi32(215);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i vy = _mm256_loadu_si256((const __m256i *)&y[i]);
+        __m256i vu = _mm256_loadu_si256((const __m256i *)&u[i]);
+        __m256i vv = _mm256_loadu_si256((const __m256i *)&v[i]);
+        __m256i r = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(vu, k209),
+                                                       _mm256_mullo_epi32(vv, k41)), 7);
+        __m256i g = _mm256_srai_epi32(_mm256_add_epi32(_mm256_mullo_epi32(vu, k48),
+                                                       _mm256_mullo_epi32(vv, k69)), 7);
+        __m256i b = _mm256_srai_epi32(_mm256_sub_epi32(_mm256_mullo_epi32(vu, k139),
+                                                       _mm256_mullo_epi32(vv, k215)), 7);
+
+        _mm256_storeu_si256((__m256i *)&y[i], _mm256_srai_epi32(_mm256_add_epi32(vy, r), 15));
+        _mm256_storeu_si256((__m256i *)&u[i], _mm256_srai_epi32(_mm256_sub_epi32(vy, g), 15));
+        _mm256_storeu_si256((__m256i *)&v[i], _mm256_srai_epi32(_mm256_sub_epi32(vy, b), 15));
+    }
+    render_yuv_to_rgb_ntsc_c(&y[i], &u[i], &v[i], n - i);
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef RENDER_YUV_NEON
+
+void render_yuv_to_rgb_pal_neon(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        int32x4_t vy = vld1q_s32(&y[i]);
+        int32x4_t vu = vld1q_s32(&u[i]);
+        int32x4_t vv = vld1q_s32(&v[i]);
+        int32x4_t uv = vshrq_n_s32(vmlaq_n_s32(vmulq_n_s32(vu, 50), vv, 130), 8);
+
+        vst1q_s32(&y[i], vshrq_n_s32(vaddq_s32(vy, vv), 16));
+        vst1q_s32(&u[i], vshrq_n_s32(vsubq_s32(vy, uv), 16));
+        vst1q_s32(&v[i], vshrq_n_s32(vaddq_s32(vy, vu), 16));
+    }
+    render_yuv_to_rgb_pal_c(&y[i], &u[i], &v[i], n - i);
+}
+
+void render_yuv_to_rgb_ntsc_neon(int32_t *y, int32_t *u, int32_t *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        int32x4_t vy = vld1q_s32(&y[i]);
+        int32x4_t vu = vld1q_s32(&u[i]);
+        int32x4_t vv = vld1q_s32(&v[i]);
+        int32x4_t r = vshrq_n_s32(vmlaq_n_s32(vmulq_n_s32(vu, 209), vv, 41), 7);
+        int32x4_t g = vshrq_n_s32(vmlaq_n_s32(vmulq_n_s32(vu, 48), vv, 69), 7);
+        int32x4_t b = vshrq_n_s32(vmlsq_n_s32(vmulq_n_s32(vu, 139), vv, 215), 7);
+
+        vst1q_s32(&y[i], vshrq_n_s32(vaddq_s32(vy, r), 15));
+        vst1q_s32(&u[i], vshrq_n_s32(vsubq_s32(vy, g), 15));
+        vst1q_s32(&v[i], vshrq_n_s32(vsubq_s32(vy, b), 15));
+    }
+    render_yuv_to_rgb_ntsc_c(&y[i], &u[i], &v[i], n - i);
+}
+
+#endif
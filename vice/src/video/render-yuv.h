@@ -0,0 +1,66 @@
+/*
+ * render-yuv.h - YUV to RGB conversion kernels of the CRT renderers.
+ *
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef VICE_RENDER_YUV_H
+#define VICE_RENDER_YUV_H
+
+#include "types.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RENDER_YUV_SSE2
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define RENDER_YUV_AVX2
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RENDER_YUV_NEON
+#endif
+
+/* Convert `n' pixels of a line from YUV (YIQ for NTSC) to the indices into
+   the gamma tables, in place: `y' becomes red, `u' green and `v' blue.  All
+   kernels give exactly the same result as the C version.  */
+typedef void (*render_yuv_to_rgb_func_t)(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+
+void render_yuv_to_rgb_pal_c(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+void render_yuv_to_rgb_ntsc_c(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+#ifdef RENDER_YUV_SSE2
+void render_yuv_to_rgb_pal_sse2(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+void render_yuv_to_rgb_ntsc_sse2(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+#endif
+#ifdef RENDER_YUV_AVX2
+void render_yuv_to_rgb_pal_avx2(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+void render_yuv_to_rgb_ntsc_avx2(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+#endif
+#ifdef RENDER_YUV_NEON
+void render_yuv_to_rgb_pal_neon(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+void render_yuv_to_rgb_ntsc_neon(int32_t *y, int32_t *u, int32_t *v, unsigned int n);
+#endif
+
+/* The kernels used by the renderers, chosen by video-render.c for the
+   features of the host CPU.  */
+extern render_yuv_to_rgb_func_t render_yuv_to_rgb_pal;
+extern render_yuv_to_rgb_func_t render_yuv_to_rgb_ntsc;
+
+#endif
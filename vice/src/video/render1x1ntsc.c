@@ -27,6 +27,7 @@
 
 #include "vice.h"
 
+#include "render-yuv.h"
 #include "render1x1ntsc.h"
 #include "types.h"
 #include "video-color.h"
@@ -35,42 +36,13 @@
     right now this is basically the PAL renderer without delay line emulation
 */
 
-/*
-    YIQ->RGB (Sony CXA2025AS US decoder matrix)
-
-    R = Y + (1.630 * I + 0.317 * Q)
-    G = Y - (0.378 * I + 0.466 * Q)
-    B = Y - (1.089 * I - 1.677 * Q)
-*/
 static inline
-void yuv_to_rgb(int32_t y, int32_t u, int32_t v,
-                int32_t *red, int32_t *grn, int32_t *blu)
+uint32_t gamma_pixel(video_render_color_tables_t *color_tab, int32_t red, int32_t grn, int32_t blu)
 {
-    *red = (y + ((209 * u +  41 * v) >> 7)) >> 15;
-    *grn = (y - (( 48 * u +  69 * v) >> 7)) >> 15;
-    *blu = (y - ((139 * u - 215 * v) >> 7)) >> 15;
-}
-
-static inline
-void store_pixel_4(video_render_color_tables_t *color_tab, uint8_t *trg, int32_t y1, int32_t u1, int32_t v1, int32_t y2, int32_t u2, int32_t v2)
-{
-    uint32_t *tmp;
-    int32_t red;
-    int32_t grn;
-    int32_t blu;
-
-    yuv_to_rgb(y1, u1, v1, &red, &grn, &blu);
-    tmp = (uint32_t *) trg;
-    tmp[0] = color_tab->gamma_red[256 + red]
-             | color_tab->gamma_grn[256 + grn]
-             | color_tab->gamma_blu[256 + blu]
-             | color_tab->alpha;
-
-    yuv_to_rgb(y2, u2, v2, &red, &grn, &blu);
-    tmp[1] = color_tab->gamma_red[256 + red]
-             | color_tab->gamma_grn[256 + grn]
-             | color_tab->gamma_blu[256 + blu]
-             | color_tab->alpha;
+    return color_tab->gamma_red[256 + red]
+           | color_tab->gamma_grn[256 + grn]
+           | color_tab->gamma_blu[256 + blu]
+           | color_tab->alpha;
 }
 
 /* NTSC 1x1 renderers */
@@ -87,11 +59,13 @@ render_generic_1x1_ntsc(video_render_color_tables_t *color_tab, const uint8_t *s
     const int32_t *crtable;
     const int32_t *ytablel = color_tab->ytablel;
     const int32_t *ytableh = color_tab->ytableh;
+    int32_t *yline = color_tab->yuvline[0];
+    int32_t *uline = color_tab->yuvline[1];
+    int32_t *vline = color_tab->yuvline[2];
     const uint8_t *tmpsrc;
     uint8_t *tmptrg;
     unsigned int x, y;
-    int32_t l1, l2, u1, u2, v1, v2, unew, vnew;
-    uint8_t cl0, cl1, cl2, cl3;
+    int32_t unew, vnew;
     int off_flip;
 
     /* ensure starting on even coords */
@@ -104,7 +78,8 @@ render_generic_1x1_ntsc(video_render_color_tables_t *color_tab, const uint8_t *s
     src = src + pitchs * ys + xs - 2;
     trg = trg + pitcht * yt + (xt >> 1) * pixelstride;
 
-    width >>= 1;
+    /* pixels are written in pairs */
+    width &= ~1;
 
     off_flip = 1 << 6;
 
@@ -115,31 +90,27 @@ render_generic_1x1_ntsc(video_render_color_tables_t *color_tab, const uint8_t *s
         cbtable = yuvtarget ? color_tab->cutable : color_tab->cbtable;
         crtable = yuvtarget ? color_tab->cvtable : color_tab->crtable;
 
-        /* one scanline */
+        /* one scanline: blur */
+        unew = cbtable[tmpsrc[0]] + cbtable[tmpsrc[1]] + cbtable[tmpsrc[2]];
+        vnew = crtable[tmpsrc[0]] + crtable[tmpsrc[1]] + crtable[tmpsrc[2]];
         for (x = 0; x < width; x++) {
-            cl0 = tmpsrc[0];
-            cl1 = tmpsrc[1];
-            cl2 = tmpsrc[2];
-            cl3 = tmpsrc[3];
-            tmpsrc += 1;
-            l1 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
-            u1 = (unew) * off_flip;
-            v1 = (vnew) * off_flip;
-
-            cl0 = tmpsrc[0];
-            cl1 = tmpsrc[1];
-            cl2 = tmpsrc[2];
-            cl3 = tmpsrc[3];
-            tmpsrc += 1;
-            l2 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
-            u2 = (unew) * off_flip;
-            v2 = (vnew) * off_flip;
-
-            store_pixel_4(color_tab, tmptrg, l1, u1, v1, l2, u2, v2);
+            yline[x] = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
+            unew += cbtable[tmpsrc[3]];
+            vnew += crtable[tmpsrc[3]];
+            uline[x] = unew * off_flip;
+            vline[x] = vnew * off_flip;
+            unew -= cbtable[tmpsrc[0]];
+            vnew -= crtable[tmpsrc[0]];
+            tmpsrc++;
+        }
+
+        render_yuv_to_rgb_ntsc(yline, uline, vline, width);
+
+        for (x = 0; x < width; x += 2) {
+            uint32_t *tmp = (uint32_t *)tmptrg;
+
+            tmp[0] = gamma_pixel(color_tab, yline[x], uline[x], vline[x]);
+            tmp[1] = gamma_pixel(color_tab, yline[x + 1], uline[x + 1], vline[x + 1]);
             tmptrg += pixelstride;
         }
 
@@ -26,46 +26,18 @@
 
 #include "vice.h"
 
+#include "render-yuv.h"
 #include "render1x1pal.h"
 #include "types.h"
 #include "video-color.h"
 
-/*
-    YUV to RGB
-
-    R = Y + V
-    G = Y - (0.1953 * U + 0.5078 * V)
-    B = Y + U
-*/
-static inline
-void yuv_to_rgb(int32_t y, int32_t u, int32_t v,
-                int32_t *red, int32_t *grn, int32_t *blu)
-{
-    *red = (y + v) >> 16;
-    *blu = (y + u) >> 16;
-    *grn = (y - ((50 * u + 130 * v) >> 8)) >> 16;
-}
-
 static inline
-void store_pixel_4(video_render_color_tables_t *color_tab, uint8_t *trg, int32_t y1, int32_t u1, int32_t v1, int32_t y2, int32_t u2, int32_t v2)
+uint32_t gamma_pixel(video_render_color_tables_t *color_tab, int32_t red, int32_t grn, int32_t blu)
 {
-    uint32_t *tmp;
-    int32_t red;
-    int32_t grn;
-    int32_t blu;
-
-    yuv_to_rgb(y1, u1, v1, &red, &grn, &blu);
-    tmp = (uint32_t *) trg;
-    tmp[0] = color_tab->gamma_red[256 + red]
-             | color_tab->gamma_grn[256 + grn]
-             | color_tab->gamma_blu[256 + blu]
-             | color_tab->alpha;
-
-    yuv_to_rgb(y2, u2, v2, &red, &grn, &blu);
-    tmp[1] = color_tab->gamma_red[256 + red]
-             | color_tab->gamma_grn[256 + grn]
-             | color_tab->gamma_blu[256 + blu]
-             | color_tab->alpha;
+    return color_tab->gamma_red[256 + red]
+           | color_tab->gamma_grn[256 + grn]
+           | color_tab->gamma_blu[256 + blu]
+           | color_tab->alpha;
 }
 
 /* PAL 1x1 renderers */
@@ -82,11 +54,13 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
     const int32_t *crtable;
     const int32_t *ytablel = color_tab->ytablel;
     const int32_t *ytableh = color_tab->ytableh;
+    int32_t *yline = color_tab->yuvline[0];
+    int32_t *uline = color_tab->yuvline[1];
+    int32_t *vline = color_tab->yuvline[2];
     const uint8_t *tmpsrc;
     uint8_t *tmptrg;
     unsigned int x, y;
-    int32_t *line, l1, l2, u1, u2, v1, v2, unew, vnew;
-    uint8_t cl0, cl1, cl2, cl3;
+    int32_t *line, unew, vnew;
     int off, off_flip;
 
     /* ensure starting on even coords */
@@ -112,18 +86,21 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
     }
 
     /* prepare previous (delay-)line */
+    unew = cbtable[tmpsrc[0]] + cbtable[tmpsrc[1]] + cbtable[tmpsrc[2]];
+    vnew = crtable[tmpsrc[0]] + crtable[tmpsrc[1]] + crtable[tmpsrc[2]];
     for (x = 0; x < width; x++) {
-        cl0 = tmpsrc[0];
-        cl1 = tmpsrc[1];
-        cl2 = tmpsrc[2];
-        cl3 = tmpsrc[3];
-        tmpsrc += 1;
-        line[0] = (cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3]);
-        line[1] = (crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3]);
+        unew += cbtable[tmpsrc[3]];
+        vnew += crtable[tmpsrc[3]];
+        line[0] = unew;
+        line[1] = vnew;
+        unew -= cbtable[tmpsrc[0]];
+        vnew -= crtable[tmpsrc[0]];
+        tmpsrc++;
         line += 2;
     }
 
-    width >>= 1;
+    /* pixels are written in pairs */
+    width &= ~1;
 
     /* Calculate odd line shading */
     off = (int) (((float) config->video_resources.pal_oddlines_offset * (1.5f / 2000.0f) - (1.5f / 2.0f - 1.0f)) * (1 << 5));
@@ -144,37 +121,30 @@ render_generic_1x1_pal(video_render_color_tables_t *color_tab, const uint8_t *sr
             crtable = yuvtarget ? color_tab->cvtable : color_tab->crtable;
         }
 
-        /* one scanline */
+        /* one scanline: blur and delay line */
+        unew = cbtable[tmpsrc[0]] + cbtable[tmpsrc[1]] + cbtable[tmpsrc[2]];
+        vnew = crtable[tmpsrc[0]] + crtable[tmpsrc[1]] + crtable[tmpsrc[2]];
         for (x = 0; x < width; x++) {
-            cl0 = tmpsrc[0];
-            cl1 = tmpsrc[1];
-            cl2 = tmpsrc[2];
-            cl3 = tmpsrc[3];
-            tmpsrc += 1;
-            l1 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
-            u1 = (unew + line[0]) * off_flip;
-            v1 = (vnew + line[1]) * off_flip;
+            yline[x] = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
+            unew += cbtable[tmpsrc[3]];
+            vnew += crtable[tmpsrc[3]];
+            uline[x] = (unew + line[0]) * off_flip;
+            vline[x] = (vnew + line[1]) * off_flip;
             line[0] = unew;
             line[1] = vnew;
+            unew -= cbtable[tmpsrc[0]];
+            vnew -= crtable[tmpsrc[0]];
+            tmpsrc++;
             line += 2;
+        }
 
-            cl0 = tmpsrc[0];
-            cl1 = tmpsrc[1];
-            cl2 = tmpsrc[2];
-            cl3 = tmpsrc[3];
-            tmpsrc += 1;
-            l2 = ytablel[cl1] + ytableh[cl2] + ytablel[cl3];
-            unew = cbtable[cl0] + cbtable[cl1] + cbtable[cl2] + cbtable[cl3];
-            vnew = crtable[cl0] + crtable[cl1] + crtable[cl2] + crtable[cl3];
-            u2 = (unew + line[0]) * off_flip;
-            v2 = (vnew + line[1]) * off_flip;
-            line[0] = unew;
-            line[1] = vnew;
-            line += 2;
+        render_yuv_to_rgb_pal(yline, uline, vline, width);
+
+        for (x = 0; x < width; x += 2) {
+            uint32_t *tmp = (uint32_t *)tmptrg;
 
-            store_pixel_4(color_tab, tmptrg, l1, u1, v1, l2, u2, v2);
+            tmp[0] = gamma_pixel(color_tab, yline[x], uline[x], vline[x]);
+            tmp[1] = gamma_pixel(color_tab, yline[x + 1], uline[x + 1], vline[x + 1]);
             tmptrg += pixelstride;
         }
 
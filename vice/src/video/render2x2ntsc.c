@@ -29,6 +29,7 @@
 
 #include <stdio.h>
 
+#include "render-yuv.h"
 #include "render2x2.h"
 #include "render2x2ntsc.h"
 #include "types.h"
@@ -38,21 +39,6 @@
     right now this is basically the PAL renderer without delay line emulation
 */
 
-/*
-    YIQ->RGB (Sony CXA2025AS US decoder matrix)
-
-    R = Y + (1.630 * I + 0.317 * Q)
-    G = Y - (0.378 * I + 0.466 * Q)
-    B = Y - (1.089 * I - 1.677 * Q)
-*/
-static inline
-void yuv_to_rgb(int32_t y, int32_t u, int32_t v, int16_t *red, int16_t *grn, int16_t *blu)
-{
-    *red = (y + ((209 * u +  41 * v) >> 7)) >> 15;
-    *grn = (y - (( 48 * u +  69 * v) >> 7)) >> 15;
-    *blu = (y - ((139 * u - 215 * v) >> 7)) >> 15;
-}
-
 /* Often required function that stores gamma-corrected pixel to current line,
  * averages the current rgb with the contents of previous non-scanline-line,
  * stores the gamma-corrected scanline, and updates the prevline rgb buffer.
@@ -63,11 +49,9 @@ void store_line_and_scanline_4(
     video_render_color_tables_t *color_tab,
     uint8_t *const line, uint8_t *const scanline,
     int16_t *const prevline, const int shade, /* ignored by RGB modes */
-    const int32_t y, const int32_t u, const int32_t v)
+    const int16_t red, const int16_t grn, const int16_t blu)
 {
-    int16_t red, grn, blu;
     uint32_t *tmp1, *tmp2;
-    yuv_to_rgb(y, u, v, &red, &grn, &blu);
 
     tmp1 = (uint32_t *) scanline;
     tmp2 = (uint32_t *) line;
@@ -111,7 +95,10 @@ void render_generic_2x2_ntsc(video_render_color_tables_t *color_tab,
     const uint8_t *tmpsrc;
     uint8_t *tmptrg, *tmptrgscanline;
     int32_t *cbtable, *crtable;
-    uint32_t x, y, wfirst, wlast, yys;
+    int32_t *yline = color_tab->yuvline[0];
+    int32_t *uline = color_tab->yuvline[1];
+    int32_t *vline = color_tab->yuvline[2];
+    uint32_t x, y, wfirst, wlast, yys, n;
     int32_t l, l2, u, u2, unew, v, v2, vnew, off_flip, shade;
 
     int first_line = viewport_first_line * 2;
@@ -179,8 +166,8 @@ void render_generic_2x2_ntsc(video_render_color_tables_t *color_tab,
         vnew -= crtable[tmpsrc[0]];
         tmpsrc += 1;
 
-        /* actual line */
-        prevrgblineptr = &color_tab->prevrgbline[0];
+        /* actual line, first the YUV values of every pixel */
+        n = 0;
         if (wfirst) {
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -191,10 +178,10 @@ void render_generic_2x2_ntsc(video_render_color_tables_t *color_tab,
             tmpsrc += 1;
 
             if (write_interpolated_pixels) {
-                store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
-                tmptrgscanline += pixelstride;
-                tmptrg += pixelstride;
-                prevrgblineptr += 3;
+                yline[n] = (l + l2) >> 1;
+                uline[n] = (u + u2) >> 1;
+                vline[n] = (v + v2) >> 1;
+                n++;
             }
 
             l = l2;
@@ -202,10 +189,10 @@ void render_generic_2x2_ntsc(video_render_color_tables_t *color_tab,
             v = v2;
         }
         for (x = 0; x < width; x++) {
-            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
-            tmptrgscanline += pixelstride;
-            tmptrg += pixelstride;
-            prevrgblineptr += 3;
+            yline[n] = l;
+            uline[n] = u;
+            vline[n] = v;
+            n++;
 
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -216,10 +203,10 @@ void render_generic_2x2_ntsc(video_render_color_tables_t *color_tab,
             tmpsrc += 1;
 
             if (write_interpolated_pixels) {
-                store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
-                tmptrgscanline += pixelstride;
-                tmptrg += pixelstride;
-                prevrgblineptr += 3;
+                yline[n] = (l + l2) >> 1;
+                uline[n] = (u + u2) >> 1;
+                vline[n] = (v + v2) >> 1;
+                n++;
             }
 
             l = l2;
@@ -227,7 +214,21 @@ void render_generic_2x2_ntsc(video_render_color_tables_t *color_tab,
             v = v2;
         }
         if (wlast) {
-            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
+            yline[n] = l;
+            uline[n] = u;
+            vline[n] = v;
+            n++;
+        }
+
+        render_yuv_to_rgb_ntsc(yline, uline, vline, n);
+
+        prevrgblineptr = &color_tab->prevrgbline[0];
+        for (x = 0; x < n; x++) {
+            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade,
+                                      (int16_t)yline[x], (int16_t)uline[x], (int16_t)vline[x]);
+            tmptrgscanline += pixelstride;
+            tmptrg += pixelstride;
+            prevrgblineptr += 3;
         }
 
         src += pitchs;
@@ -28,36 +28,20 @@
 
 #include <stdio.h>
 
+#include "render-yuv.h"
 #include "render2x2.h"
 #include "render2x2pal.h"
 #include "types.h"
 #include "video-color.h"
 
-/*
-    YUV to RGB
-
-    R = Y + V
-    G = Y - (0.1953 * U + 0.5078 * V)
-    B = Y + U
-*/
-static inline
-void yuv_to_rgb(int32_t y, int32_t u, int32_t v, int16_t *red, int16_t *grn, int16_t *blu)
-{
-    *red = (y + v) >> 16;
-    *blu = (y + u) >> 16;
-    *grn = (y - ((50 * u + 130 * v) >> 8)) >> 16;
-}
-
 static inline
 void store_line_and_scanline_4(
     video_render_color_tables_t *color_tab,
     uint8_t *const line, uint8_t *const scanline,
     int16_t *const prevline, const int shade, /* ignored by RGB modes */
-    const int32_t y, const int32_t u, const int32_t v)
+    const int16_t red, const int16_t grn, const int16_t blu)
 {
-    int16_t red, grn, blu;
     uint32_t *tmp1, *tmp2;
-    yuv_to_rgb(y, u, v, &red, &grn, &blu);
 
     tmp1 = (uint32_t *) scanline;
     tmp2 = (uint32_t *) line;
@@ -104,7 +88,10 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
     const uint8_t *tmpsrc;
     uint8_t *tmptrg, *tmptrgscanline;
     int32_t *line, *cbtable, *crtable;
-    uint32_t x, y, wfirst, wlast, yys;
+    int32_t *yline = color_tab->yuvline[0];
+    int32_t *uline = color_tab->yuvline[1];
+    int32_t *vline = color_tab->yuvline[2];
+    uint32_t x, y, wfirst, wlast, yys, n;
     int32_t l, l2, u, u2, unew, v, v2, vnew, off, off_flip, shade;
     int first_line = viewport_first_line * 2;
     int last_line = (viewport_last_line * 2) + 1;
@@ -207,8 +194,8 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
         tmpsrc += 1;
         line += 2;
 
-        /* actual line */
-        prevrgblineptr = &color_tab->prevrgbline[0];
+        /* actual line, first the YUV values of every pixel */
+        n = 0;
         if (wfirst) {
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -217,13 +204,13 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             unew -= cbtable[tmpsrc[0]];
             vnew -= crtable[tmpsrc[0]];
             tmpsrc += 1;
-            line += 2;
+        line += 2;
 
             if (write_interpolated_pixels) {
-                store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
-                tmptrgscanline += pixelstride;
-                tmptrg += pixelstride;
-                prevrgblineptr += 3;
+                yline[n] = (l + l2) >> 1;
+                uline[n] = (u + u2) >> 1;
+                vline[n] = (v + v2) >> 1;
+                n++;
             }
 
             l = l2;
@@ -231,10 +218,10 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             v = v2;
         }
         for (x = 0; x < width; x++) {
-            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
-            tmptrgscanline += pixelstride;
-            tmptrg += pixelstride;
-            prevrgblineptr += 3;
+            yline[n] = l;
+            uline[n] = u;
+            vline[n] = v;
+            n++;
 
             l2 = ytablel[tmpsrc[1]] + ytableh[tmpsrc[2]] + ytablel[tmpsrc[3]];
             unew += cbtable[tmpsrc[3]];
@@ -243,13 +230,13 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             unew -= cbtable[tmpsrc[0]];
             vnew -= crtable[tmpsrc[0]];
             tmpsrc += 1;
-            line += 2;
+        line += 2;
 
             if (write_interpolated_pixels) {
-                store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, (l + l2) >> 1, (u + u2) >> 1, (v + v2) >> 1);
-                tmptrgscanline += pixelstride;
-                tmptrg += pixelstride;
-                prevrgblineptr += 3;
+                yline[n] = (l + l2) >> 1;
+                uline[n] = (u + u2) >> 1;
+                vline[n] = (v + v2) >> 1;
+                n++;
             }
 
             l = l2;
@@ -257,7 +244,21 @@ void render_generic_2x2_pal(video_render_color_tables_t *color_tab,
             v = v2;
         }
         if (wlast) {
-            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade, l, u, v);
+            yline[n] = l;
+            uline[n] = u;
+            vline[n] = v;
+            n++;
+        }
+
+        render_yuv_to_rgb_pal(yline, uline, vline, n);
+
+        prevrgblineptr = &color_tab->prevrgbline[0];
+        for (x = 0; x < n; x++) {
+            store_line_and_scanline_4(color_tab, tmptrg, tmptrgscanline, prevrgblineptr, shade,
+                                      (int16_t)yline[x], (int16_t)uline[x], (int16_t)vline[x]);
+            tmptrgscanline += pixelstride;
+            tmptrg += pixelstride;
+            prevrgblineptr += 3;
         }
 
         src += pitchs;
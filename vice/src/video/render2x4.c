@@ -53,7 +53,7 @@ void render_32_2x4_interlaced(const video_render_color_tables_t *color_tab,
 
     src = src + pitchs * ys + xs;
     trg = trg + pitcht * yt + (xt << 2);
-    yys = (ys << 1) | (yt & 1);
+    yys = (ys << 2) | (yt & 3);
     wfirst = xt & 1;
     width -= wfirst;
     wlast = width & 1;
@@ -125,7 +125,7 @@ static void render_32_2x4_non_interlaced(const video_render_color_tables_t *colo
 
     src = src + pitchs * ys + xs;
     trg = trg + pitcht * yt + (xt << 2);
-    yys = (ys << 1) | (yt & 1);
+    yys = (ys << 2) | (yt & 3);
     wfirst = xt & 1;
     width -= wfirst;
     wlast = width & 1;
@@ -108,7 +108,7 @@ void render_generic_2x4_rgbi(video_render_color_tables_t *color_tab,
 
     src = src + pitchs * ys + xs - 2;
     trg = trg + pitcht * yt + xt * pixelstride;
-    yys = (ys << 1) | (yt & 1);
+    yys = (ys << 2) | (yt & 3);
     wfirst = xt & 1;
     width -= wfirst;
     wlast = width & 1;
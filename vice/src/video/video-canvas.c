@@ -38,6 +38,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "lib.h"
 #include "log.h"
@@ -46,6 +47,7 @@
 #include "video-canvas.h"
 #include "video-color.h"
 #include "video-render.h"
+#include "video-sound.h"
 #include "video.h"
 #include "viewport.h"
 
@@ -104,6 +106,8 @@ void video_canvas_shutdown(video_canvas_t *canvas)
         }
 
         lib_free(canvas->videoconfig);
+        lib_free(canvas->draw_buffer->line_hashes);
+        lib_free(canvas->draw_buffer->hashed_lines);
         lib_free(canvas->draw_buffer);
         lib_free(canvas->viewport);
         lib_free(canvas->geometry);
@@ -111,15 +115,9 @@ void video_canvas_shutdown(video_canvas_t *canvas)
     }
 }
 
-void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
-                         int height, int xs, int ys, int xt, int yt,
-                         int pitcht)
+static void video_canvas_update_color_tables(video_canvas_t *canvas)
 {
     viewport_t *viewport = canvas->viewport;
-#ifdef VIDEO_SCALE_SOURCE
-    xs /= canvas->videoconfig->scalex;
-    ys /= canvas->videoconfig->scaley;
-#endif
 
     /* when the color encoding changed, the palette must be recalculated */
     if (viewport->crt_type != canvas->crt_type) {
@@ -130,12 +128,407 @@ void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
     if (!canvas->videoconfig->color_tables.updated) { /* update colors as necessary */
         video_color_update_palette(canvas);
     }
+}
+
+void video_canvas_render(video_canvas_t *canvas, uint8_t *trg, int width,
+                         int height, int xs, int ys, int xt, int yt,
+                         int pitcht)
+{
+    viewport_t *viewport = canvas->viewport;
+#ifdef VIDEO_SCALE_SOURCE
+    xs /= canvas->videoconfig->scalex;
+    ys /= canvas->videoconfig->scaley;
+#endif
+
+    video_canvas_update_color_tables(canvas);
     video_render_main(canvas->videoconfig, canvas->draw_buffer->draw_buffer,
                       trg, width, height, xs, ys, xt, yt,
                       canvas->draw_buffer->draw_buffer_width, pitcht,
                       viewport);
 }
 
+typedef void (*render_lines_func_t)(video_render_config_t *, uint8_t *, uint8_t *,
+                                    int, int, int, int, int, int, int, int, viewport_t *);
+
+/* Is everything to be rendered, rather than the lines that changed?
+   Remembers the area for the next refresh.  */
+static int video_canvas_render_full(video_canvas_t *canvas, uint8_t *trg, int width,
+                                    int height, int xs, int ys, int xt, int yt,
+                                    int pitcht)
+{
+    video_render_config_t *config = canvas->videoconfig;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    video_render_area_t area;
+    int full;
+
+    memset(&area, 0, sizeof area);
+    area.trg = trg;
+    area.width = width;
+    area.height = height;
+    area.xs = xs;
+    area.ys = ys;
+    area.xt = xt;
+    area.yt = yt;
+    area.pitcht = pitcht;
+
+    full = !config->color_tables.updated
+           || canvas->viewport->crt_type != canvas->crt_type
+           || config->interlaced
+           || memcmp(&area, &draw_buffer->render_area, sizeof area) != 0;
+
+    if (!draw_buffer->dirty_lines_valid) {
+        /* the draw buffer may hold something else than the emulated screen
+           (menus, status bars), make the raster code start over */
+        draw_buffer->dirty_lines_reset = 1;
+    }
+    draw_buffer->render_area = area;
+
+    return full;
+}
+
+static uint64_t hash_line(const uint8_t *line, unsigned int width)
+{
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    uint64_t word;
+    unsigned int x;
+
+    for (x = 0; x + 8 <= width; x += 8) {
+        memcpy(&word, line + x, 8);
+        hash = (hash ^ word) * UINT64_C(0x100000001b3);
+    }
+    for (; x < width; x++) {
+        hash = (hash ^ line[x]) * UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/* The lines of the draw buffer to render, one flag per line, or NULL if
+   all of them must be.  When the refresh does not come from the raster
+   code (the monitor, the menus and status bars drawn into the draw buffer)
+   the changed lines are found by comparing a hash of each line with the
+   one it had when it was last rendered.  The hashes are kept up to date
+   on every refresh, so they always match what the target holds.  */
+static const uint8_t *video_canvas_changed_lines(video_canvas_t *canvas, int full,
+                                                 int ys, int lines)
+{
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    unsigned int pitch = draw_buffer->draw_buffer_width;
+    int height = (int)draw_buffer->draw_buffer_height;
+    int first, last, y;
+
+    if (draw_buffer->line_hashes_size != draw_buffer->draw_buffer_height) {
+        lib_free(draw_buffer->line_hashes);
+        lib_free(draw_buffer->hashed_lines);
+        draw_buffer->line_hashes = lib_malloc(height * sizeof(uint64_t));
+        draw_buffer->hashed_lines = lib_malloc(height);
+        draw_buffer->line_hashes_size = height;
+        full = 1;
+    }
+
+    /* the filters also read the lines above and below */
+    lines = MIN(lines, height - ys);
+    first = ys > 0 ? ys - 1 : 0;
+    last = MIN(ys + lines + 1, height);
+
+    if (!full && draw_buffer->dirty_lines != NULL && draw_buffer->dirty_lines_valid) {
+        for (y = first; y < last; y++) {
+            if (draw_buffer->dirty_lines[y]) {
+                draw_buffer->line_hashes[y] = hash_line(draw_buffer->draw_buffer + y * pitch, pitch);
+            }
+        }
+        return draw_buffer->dirty_lines;
+    }
+
+    for (y = first; y < last; y++) {
+        uint64_t hash = hash_line(draw_buffer->draw_buffer + y * pitch, pitch);
+
+        draw_buffer->hashed_lines[y] = hash != draw_buffer->line_hashes[y];
+        draw_buffer->line_hashes[y] = hash;
+    }
+
+    if (full) {
+        return NULL;
+    }
+
+    if (lines > 0) {
+        if (first < ys && draw_buffer->hashed_lines[first]) {
+            draw_buffer->hashed_lines[ys] = 1;
+        }
+        if (last > ys + lines && draw_buffer->hashed_lines[last - 1]) {
+            draw_buffer->hashed_lines[ys + lines - 1] = 1;
+        }
+    }
+    return draw_buffer->hashed_lines;
+}
+
+/* Render the runs of lines flagged in dirty, with a line of margin.  The
+   coordinates of the source are already scaled.  */
+static int render_dirty_lines(render_lines_func_t render, video_render_config_t *config,
+                              uint8_t *src, int pitchs, const uint8_t *dirty,
+                              viewport_t *viewport, uint8_t *trg, int width, int height,
+                              int xs, int ys, int xt, int yt, int pitcht,
+                              uint8_t *trg_rows)
+{
+    int lines, margin, written, y;
+
+    lines = height / config->scaley;
+    /* the CRT emulation and Scale2x use the lines above and below */
+    margin = config->filter != VIDEO_FILTER_NONE ? 1 : 0;
+    written = 0;
+
+    for (y = 0; y < lines; y++) {
+        int first, last;
+
+        if (!dirty[ys + y]) {
+            continue;
+        }
+        first = y;
+        while (y + 1 < lines && dirty[ys + y + 1]) {
+            y++;
+        }
+        last = y;
+
+        first = first > margin ? first - margin : 0;
+        last = last + margin < lines ? last + margin : lines - 1;
+
+        render(config, src, trg, width, (last - first + 1) * config->scaley,
+               xs, ys + first, xt, yt + first * config->scaley,
+               pitchs, pitcht, viewport);
+        memset(trg_rows + yt + first * config->scaley, 1, (last - first + 1) * config->scaley);
+        written += (last - first + 1) * config->scaley;
+    }
+
+    return written;
+}
+
+/** \brief Render only the lines that changed since the last refresh.
+ *
+ * Like video_canvas_render(), for targets that keep their contents from one
+ * frame to the next.  The lines are those flagged by the raster code, or
+ * those whose hash changed when the refresh does not come from the raster
+ * code.  Everything is rendered when the colors or the area changed.  The rows
+ * of the target that were written are flagged in \a trg_rows, one entry per
+ * row of the target, which the caller clears beforehand.
+ *
+ * \return the number of target rows written
+ */
+int video_canvas_render_changed(video_canvas_t *canvas, uint8_t *trg, int width,
+                                int height, int xs, int ys, int xt, int yt,
+                                int pitcht, uint8_t *trg_rows)
+{
+    video_render_config_t *config = canvas->videoconfig;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    const uint8_t *changed;
+    int full;
+
+    if (height <= 0) {
+        return 0;
+    }
+
+    full = video_canvas_render_full(canvas, trg, width, height, xs, ys, xt, yt, pitcht);
+
+#ifdef VIDEO_SCALE_SOURCE
+    changed = video_canvas_changed_lines(canvas, full, ys / config->scaley, height / config->scaley);
+#else
+    changed = video_canvas_changed_lines(canvas, full, ys, height / config->scaley);
+#endif
+
+    if (changed == NULL) {
+        video_canvas_render(canvas, trg, width, height, xs, ys, xt, yt, pitcht);
+        memset(trg_rows + yt, 1, height);
+        return height;
+    }
+
+#ifdef VIDEO_SCALE_SOURCE
+    xs /= config->scalex;
+    ys /= config->scaley;
+#endif
+
+    return render_dirty_lines(video_render_main, config, draw_buffer->draw_buffer,
+                              draw_buffer->draw_buffer_width, changed,
+                              canvas->viewport, trg, width, height, xs, ys, xt, yt,
+                              pitcht, trg_rows);
+}
+
+/* A refresh kept for rendering later: the lines of the draw buffer it shows,
+   which of them changed, and copies of the render config and the viewport
+   as they were, so the emulation can go on meanwhile.  The render functions
+   use scratch buffers in the config, so the copy also keeps them apart from
+   the ones of the canvas.  */
+struct video_render_deferred_s {
+    video_render_config_t config;
+    viewport_t viewport;
+    uint8_t *src;
+    unsigned int src_size;
+    int pitchs;
+    /* one flag per draw buffer line, set if it must be rendered */
+    uint8_t *src_rows;
+    unsigned int src_rows_size;
+    int full;
+    int width, height, xs, ys, xt, yt;
+};
+
+video_render_deferred_t *video_render_deferred_new(void)
+{
+    return lib_calloc(1, sizeof(video_render_deferred_t));
+}
+
+void video_render_deferred_free(video_render_deferred_t *job)
+{
+    if (job != NULL) {
+        lib_free(job->src);
+        lib_free(job->src_rows);
+        lib_free(job);
+    }
+}
+
+/** \brief Prepare a refresh to be rendered by video_render_deferred_run().
+ *
+ * Takes the arguments of video_canvas_render_changed() but renders nothing:
+ * the color tables and the video to audio leak are updated as when
+ * rendering, and what the rendering needs is copied to \a job.  Everything
+ * is rendered if \a full is nonzero, as for video_canvas_render().
+ */
+void video_canvas_render_deferred(video_canvas_t *canvas, video_render_deferred_t *job,
+                                  int width, int height, int xs, int ys, int xt, int yt,
+                                  int full)
+{
+    video_render_config_t *config = canvas->videoconfig;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    unsigned int pitch = draw_buffer->draw_buffer_width;
+    const uint8_t *changed = NULL;
+    unsigned int size;
+    int lines, first, last;
+
+    if (height > 0 && video_canvas_render_full(canvas, NULL, width, height, xs, ys, xt, yt, 0)) {
+        full = 1;
+    }
+
+#ifdef VIDEO_SCALE_SOURCE
+    xs /= config->scalex;
+    ys /= config->scaley;
+#endif
+
+    if (width > 0 && height > 0) {
+        changed = video_canvas_changed_lines(canvas, full, ys, height / config->scaley);
+        full = changed == NULL;
+    }
+
+    job->full = full;
+    job->width = width;
+    job->height = height;
+    job->xs = xs;
+    job->ys = ys;
+    job->xt = xt;
+    job->yt = yt;
+    job->pitchs = pitch;
+
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    video_canvas_update_color_tables(canvas);
+    video_sound_update(config, draw_buffer->draw_buffer, width, height, xs, ys,
+                       pitch, canvas->viewport);
+
+    size = pitch * draw_buffer->draw_buffer_height;
+    if (job->src_size < size) {
+        lib_free(job->src);
+        job->src = lib_malloc(size);
+        job->src_size = size;
+    }
+    if (job->src_rows_size < draw_buffer->draw_buffer_height) {
+        lib_free(job->src_rows);
+        job->src_rows = lib_malloc(draw_buffer->draw_buffer_height);
+        job->src_rows_size = draw_buffer->draw_buffer_height;
+    }
+
+    /* the filters also read the lines above and below */
+    lines = MIN(height / config->scaley, (int)draw_buffer->draw_buffer_height - ys);
+    first = ys > 0 ? ys - 1 : 0;
+    last = MIN(ys + lines + 1, (int)draw_buffer->draw_buffer_height);
+    memcpy(job->src + first * pitch, draw_buffer->draw_buffer + first * pitch,
+           (last - first) * pitch);
+
+    if (full) {
+        memset(job->src_rows + ys, 1, lines);
+    } else {
+        memcpy(job->src_rows + ys, changed + ys, lines);
+    }
+
+    memcpy(&job->config, config, sizeof(video_render_config_t));
+    job->viewport = *canvas->viewport;
+}
+
+/** \brief Render a refresh prepared by video_canvas_render_deferred().
+ *
+ * Does not touch the canvas, so it may run on another thread, as long as
+ * \a job is not prepared again meanwhile.  The rows of the target that were
+ * written are flagged in \a trg_rows, as by video_canvas_render_changed().
+ *
+ * \return the number of target rows written
+ */
+int video_render_deferred_run(video_render_deferred_t *job, uint8_t *trg,
+                              int pitcht, uint8_t *trg_rows)
+{
+    if (job->width <= 0 || job->height <= 0) {
+        return 0;
+    }
+
+    if (job->full) {
+        video_render_pixels(&job->config, job->src, trg, job->width, job->height,
+                            job->xs, job->ys, job->xt, job->yt, job->pitchs, pitcht,
+                            &job->viewport);
+        memset(trg_rows + job->yt, 1, job->height);
+        return job->height;
+    }
+
+    return render_dirty_lines(video_render_pixels, &job->config, job->src, job->pitchs,
+                              job->src_rows, &job->viewport, trg, job->width, job->height,
+                              job->xs, job->ys, job->xt, job->yt, pitcht, trg_rows);
+}
+
+/** \brief Copy the palette indices of the draw buffer instead of rendering.
+ *
+ * For backends that do the CRT emulation on the GPU.  The arguments are
+ * the same as for video_canvas_render(), \a trg gets one byte per pixel of
+ * the draw buffer, without the scaling of the render mode.  The color
+ * tables are kept up to date as when rendering.
+ */
+void video_canvas_render_indexed(video_canvas_t *canvas, uint8_t *trg, int width,
+                                 int height, int xs, int ys, int xt, int yt,
+                                 int pitcht)
+{
+    video_render_config_t *config = canvas->videoconfig;
+    draw_buffer_t *draw_buffer = canvas->draw_buffer;
+    const uint8_t *src;
+    int y;
+
+#ifdef VIDEO_SCALE_SOURCE
+    xs /= config->scalex;
+    ys /= config->scaley;
+#endif
+
+    if (width <= 0) {
+        return;
+    }
+
+    video_canvas_update_color_tables(canvas);
+    video_sound_update(config, draw_buffer->draw_buffer, width, height, xs, ys,
+                       draw_buffer->draw_buffer_width, canvas->viewport);
+
+    width /= config->scalex;
+    height /= config->scaley;
+    trg += (yt / config->scaley) * pitcht + xt / config->scalex;
+    src = draw_buffer->draw_buffer + ys * draw_buffer->draw_buffer_width + xs;
+
+    for (y = 0; y < height; y++) {
+        memcpy(trg, src, width);
+        src += draw_buffer->draw_buffer_width;
+        trg += pitcht;
+    }
+}
+
 /** \brief Force refresh all tracked canvases.
  *
  * Added to enable visible updates each time the monitor
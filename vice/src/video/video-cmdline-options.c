@@ -36,8 +36,21 @@
 #include "util.h"
 #include "video.h"
 
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-renderbands", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "RenderBands", NULL,
+      "<1-16>", "Render the frames in this many horizontal bands in parallel (needs OpenMP)" },
+    CMDLINE_LIST_END
+};
+
 int video_cmdline_options_init(void)
 {
+    if (machine_class != VICE_MACHINE_VSID) {
+        if (cmdline_register_options(cmdline_options) < 0) {
+            return -1;
+        }
+    }
     return video_arch_cmdline_options_init();
 }
 
@@ -243,7 +256,7 @@ static cmdline_option_t cmdline_options_chip_gloptions[] =
       "<aspect ratio>", "Set custom aspect ratio (0.5 - 2.0)" },
     { NULL, SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
       NULL, NULL, NULL, (resource_value_t)VIDEO_GLFILTER_BICUBIC,
-      "<mode>", "Set OpenGL filtering mode (0 = nearest, 1 = linear, 2 = bicubic)" },
+      "<mode>", "Set OpenGL filtering mode (0 = nearest, 1 = linear, 2 = bicubic, 3 = CRT shader)" },
     { NULL, SET_RESOURCE, CMDLINE_ATTRIB_NONE,
       NULL, NULL, NULL, (resource_value_t)1,
       NULL, "Enable X flip" },
@@ -76,6 +76,7 @@ void video_render_setrawrgb(video_render_color_tables_t *color_tab, unsigned int
     color_tab->color_red[index] = r;
     color_tab->color_grn[index] = g;
     color_tab->color_blu[index] = b;
+    color_tab->gamma_valid = 0;
 }
 
 void video_render_setrawalpha(video_render_color_tables_t *color_tab, uint32_t a)
@@ -509,6 +510,23 @@ static void video_calc_gammatable(video_render_color_tables_t *color_tab, video_
     gam = video_get_gamma(video_resources, video);
     scn = ((float)(video_resources->pal_scanlineshade)) / 1000.0f;
 #endif
+    /* the gamma tables only depend on these, keep them while the other
+       parameters change */
+    if (color_tab->gamma_valid
+        && color_tab->gamma_brightness == video_resources->color_brightness
+        && color_tab->gamma_contrast == video_resources->color_contrast
+        && color_tab->gamma_gamma == video_resources->color_gamma
+        && color_tab->gamma_scanlineshade == video_resources->pal_scanlineshade
+        && color_tab->gamma_video == video) {
+        return;
+    }
+    color_tab->gamma_valid = 1;
+    color_tab->gamma_brightness = video_resources->color_brightness;
+    color_tab->gamma_contrast = video_resources->color_contrast;
+    color_tab->gamma_gamma = video_resources->color_gamma;
+    color_tab->gamma_scanlineshade = video_resources->pal_scanlineshade;
+    color_tab->gamma_video = video;
+
     factor = pow(255.0f, 1.0f - gam);
     DBG((" bri:%f con:%f gam:%f scn:%f", bri, con, gam, scn));
     for (i = 0; i < (256 * 3); i++) {
@@ -928,8 +946,18 @@ int video_color_update_palette(struct video_canvas_s *canvas)
 #endif
 
     if (canvas->videoconfig->external_palette) {
-        palette = video_load_palette(canvas->videoconfig->cbm_palette,
-                                     canvas->videoconfig->external_palette_name);
+        /* the file is only read again when the palette was changed, not when
+           the color parameters were */
+        palette = canvas->videoconfig->external_palette_loaded;
+        if (palette != NULL && palette->num_entries != canvas->videoconfig->cbm_palette->num_entries) {
+            video_color_palette_forget(canvas->videoconfig);
+            palette = NULL;
+        }
+        if (palette == NULL) {
+            palette = video_load_palette(canvas->videoconfig->cbm_palette,
+                                         canvas->videoconfig->external_palette_name);
+            canvas->videoconfig->external_palette_loaded = palette;
+        }
 
         if (!palette) {
             /* loading the external palette did not work (file not found?), so
@@ -941,7 +969,6 @@ int video_color_update_palette(struct video_canvas_s *canvas)
             video_palette_to_ycbcr(palette, ycbcr, video);
             video_calc_ycbcrtable(video_resources, ycbcr, &canvas->videoconfig->color_tables, video);
             /* if (canvas->videoconfig->filter == VIDEO_FILTER_CRT) */ {
-                palette_free(palette);
                 palette = video_calc_palette(canvas, ycbcr, video);
             }
             /* additional table for odd lines */
@@ -976,6 +1003,7 @@ void video_color_palette_internal(struct video_canvas_s *canvas,
 {
     canvas->videoconfig->cbm_palette = cbm_palette;
     canvas->videoconfig->color_tables.updated = 0;
+    video_color_palette_forget(canvas->videoconfig);
 }
 
 void video_color_palette_free(struct palette_s *palette)
@@ -983,6 +1011,13 @@ void video_color_palette_free(struct palette_s *palette)
     palette_free(palette);
 }
 
+/* Drop the external palette loaded last, so the file is read again.  */
+void video_color_palette_forget(struct video_render_config_s *videoconfig)
+{
+    palette_free(videoconfig->external_palette_loaded);
+    videoconfig->external_palette_loaded = NULL;
+}
+
 /* called by archdep code for first initial setup */
 void video_render_initraw(struct video_render_config_s *videoconfig)
 {
@@ -28,8 +28,11 @@
 #include "vice.h"
 
 #include <stdio.h>
+#include <string.h>
 
+#include "lib.h"
 #include "log.h"
+#include "render-yuv.h"
 #include "types.h"
 #include "video-render.h"
 #include "video-sound.h"
@@ -39,10 +42,59 @@ static render_pal_ntsc_func_t  render_pal_ntsc_func  = video_render_pal_ntsc_mai
 static render_rgbi_func_t render_rgbi_func = video_render_rgbi_main;
 static render_crt_mono_func_t render_crt_mono_func = video_render_crt_mono_main;
 
+/* The frames are split into up to this many horizontal bands, which are
+   rendered in parallel (RenderBands).  */
+#define VIDEO_RENDER_MAX_BANDS  16
+
+/* A band has at least this many lines of the draw buffer.  */
+#define VIDEO_RENDER_MIN_BAND_LINES 32
+
+#if defined(__GNUC__)
+#define VIDEO_RENDER_THREAD_LOCAL __thread
+#else
+#define VIDEO_RENDER_THREAD_LOCAL _Thread_local
+#endif
+
+static int render_bands = 1;
+
+render_yuv_to_rgb_func_t render_yuv_to_rgb_pal = render_yuv_to_rgb_pal_c;
+render_yuv_to_rgb_func_t render_yuv_to_rgb_ntsc = render_yuv_to_rgb_ntsc_c;
+
+/* pick the YUV to RGB kernels of the CRT renderers for the host CPU */
+static void video_render_select_kernels(void)
+{
+    static int selected = 0;
+
+    if (selected) {
+        return;
+    }
+    selected = 1;
+
+#ifdef RENDER_YUV_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        render_yuv_to_rgb_pal = render_yuv_to_rgb_pal_avx2;
+        render_yuv_to_rgb_ntsc = render_yuv_to_rgb_ntsc_avx2;
+        log_message(LOG_DEFAULT, "Video: using AVX2 for the CRT emulation.");
+        return;
+    }
+#endif
+#ifdef RENDER_YUV_SSE2
+    render_yuv_to_rgb_pal = render_yuv_to_rgb_pal_sse2;
+    render_yuv_to_rgb_ntsc = render_yuv_to_rgb_ntsc_sse2;
+#endif
+#ifdef RENDER_YUV_NEON
+    render_yuv_to_rgb_pal = render_yuv_to_rgb_pal_neon;
+    render_yuv_to_rgb_ntsc = render_yuv_to_rgb_ntsc_neon;
+#endif
+}
+
 void video_render_initconfig(video_render_config_t *config)
 {
     int i;
 
+    video_render_select_kernels();
+
     config->rendermode = VIDEO_RENDER_NULL;
     config->doublescan = 0;
 
@@ -75,8 +127,6 @@ void video_render_main(video_render_config_t *config, uint8_t *src, uint8_t *trg
                        int width, int height, int xs, int ys, int xt, int yt,
                        int pitchs, int pitcht, viewport_t *viewport)
 {
-    int rendermode;
-
 #if 0
     log_debug("w:%i h:%i xs:%i ys:%i xt:%i yt:%i ps:%i pt:%i d%i",
               width, height, xs, ys, xt, yt, pitchs, pitcht, depth);
@@ -87,8 +137,14 @@ void video_render_main(video_render_config_t *config, uint8_t *src, uint8_t *trg
     }
 
     video_sound_update(config, src, width, height, xs, ys, pitchs, viewport);
+    video_render_pixels(config, src, trg, width, height, xs, ys, xt, yt, pitchs, pitcht, viewport);
+}
 
-    rendermode = config->rendermode;
+static void render_pixels(video_render_config_t *config, uint8_t *src, uint8_t *trg,
+                          int width, int height, int xs, int ys, int xt, int yt,
+                          int pitchs, int pitcht, viewport_t *viewport)
+{
+    int rendermode = config->rendermode;
 
     switch (rendermode) {
         case VIDEO_RENDER_NULL:
@@ -123,6 +179,78 @@ void video_render_main(video_render_config_t *config, uint8_t *src, uint8_t *trg
     rendermode_error = rendermode;
 }
 
+/* Render the area in horizontal bands on the OpenMP threads.  The renderers
+   keep the history of the line above in the scratch buffers of the config,
+   so each thread renders with a copy of its own.  A renderer starts from the
+   line above its area and writes the scanline below its last line, but not
+   the one above its first line, so the bands put together are the same as
+   the area rendered at once.  */
+static void render_pixels_bands(video_render_config_t *config, uint8_t *src, uint8_t *trg,
+                                int width, int height, int xs, int ys, int xt, int yt,
+                                int pitchs, int pitcht, viewport_t *viewport, int bands)
+{
+    static VIDEO_RENDER_THREAD_LOCAL video_render_config_t *band_config = NULL;
+    int lines = height / config->scaley;
+    int band;
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(bands) schedule(static, 1)
+#endif
+    for (band = 0; band < bands; band++) {
+        int first = lines * band / bands;
+        int rows = band == bands - 1
+                   ? height - first * config->scaley
+                   : (lines * (band + 1) / bands - first) * config->scaley;
+
+        if (band_config == NULL) {
+            band_config = lib_malloc(sizeof(video_render_config_t));
+        }
+        memcpy(band_config, config, sizeof(video_render_config_t));
+
+        render_pixels(band_config, src, trg, width, rows, xs, ys + first,
+                      xt, yt + first * config->scaley, pitchs, pitcht, viewport);
+    }
+}
+
+/* Like video_render_main(), without the video to audio leak.  Only touches
+   config and the buffers, so it may run on another thread than the
+   emulation.  */
+void video_render_pixels(video_render_config_t *config, uint8_t *src, uint8_t *trg,
+                         int width, int height, int xs, int ys, int xt, int yt,
+                         int pitchs, int pitcht, viewport_t *viewport)
+{
+    int bands;
+
+    if (width <= 0) {
+        return;
+    }
+
+    bands = render_bands;
+    if (bands > height / config->scaley / VIDEO_RENDER_MIN_BAND_LINES) {
+        bands = height / config->scaley / VIDEO_RENDER_MIN_BAND_LINES;
+    }
+    if (bands > 1) {
+        render_pixels_bands(config, src, trg, width, height, xs, ys, xt, yt,
+                            pitchs, pitcht, viewport, bands);
+        return;
+    }
+
+    render_pixels(config, src, trg, width, height, xs, ys, xt, yt, pitchs, pitcht, viewport);
+}
+
+/* Set the number of bands the frames are rendered in, 1 to render them
+   at once.  Only has an effect when built with OpenMP.  */
+int video_render_bands_set(int bands)
+{
+    if (bands < 1 || bands > VIDEO_RENDER_MAX_BANDS) {
+        return -1;
+    }
+#ifdef _OPENMP
+    render_bands = bands;
+#endif
+    return 0;
+}
+
 void video_render_palntscfunc_set(render_pal_ntsc_func_t func)
 {
     render_pal_ntsc_func = func;
@@ -47,6 +47,7 @@
 #include "machine.h"
 #include "resources.h"
 #include "video-color.h"
+#include "video-render.h"
 #include "video.h"
 #include "viewport.h"
 #include "util.h"
@@ -55,8 +56,38 @@
 /*-----------------------------------------------------------------------*/
 /* global resources.  */
 
+static int render_bands;
+
+/** \brief  Setter for integer resource "RenderBands"
+ *
+ * \param[in]   val     number of bands the frames are rendered in
+ * \param[in]   param   unused
+ *
+ * \return  0 on success, -1 on failure
+ */
+static int set_render_bands(int val, void *param)
+{
+    if (video_render_bands_set(val) < 0) {
+        return -1;
+    }
+    render_bands = val;
+    return 0;
+}
+
+static const resource_int_t resources_int[] =
+{
+    { "RenderBands", 1, RES_EVENT_NO, NULL,
+      &render_bands, set_render_bands, NULL },
+    RESOURCE_INT_LIST_END
+};
+
 int video_resources_init(void)
 {
+    if (machine_class != VICE_MACHINE_VSID) {
+        if (resources_register_int(resources_int) < 0) {
+            return -1;
+        }
+    }
     return video_arch_resources_init();
 }
 
@@ -361,6 +392,7 @@ static int set_palette_is_external(int external, void *canvas)
 
     cv->videoconfig->external_palette = external ? 1 : 0;
     cv->videoconfig->color_tables.updated = 0;
+    video_color_palette_forget(cv->videoconfig);
     return 0;
 }
 
@@ -377,6 +409,7 @@ static int set_palette_file_name(const char *filename, void *canvas)
 
     util_string_set(&(cv->videoconfig->external_palette_name), filename);
     cv->videoconfig->color_tables.updated = 0;
+    video_color_palette_forget(cv->videoconfig);
     return 0;
 }
 
@@ -1152,6 +1185,7 @@ void video_resources_chip_shutdown(struct video_canvas_s *canvas)
     lib_free(canvas->videoconfig->aspect_ratio_s);
     lib_free(canvas->videoconfig->aspect_ratio_factory_value_s);
     lib_free(canvas->videoconfig->external_palette_name);
+    video_color_palette_forget(canvas->videoconfig);
     lib_free(canvas->videoconfig->chip_name);
 
     /* NOTE: in x128 this actually shuts down the respective resources of both
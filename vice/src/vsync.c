@@ -42,6 +42,7 @@
 
 /* Port me... */
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -50,8 +51,11 @@
 #endif
 
 #include "archdep.h"
+#include "autowarp.h"
 #include "cmdline.h"
 #include "debug.h"
+#include "framestats.h"
+#include "hosttime.h"
 #include "joystick.h"
 #include "kbdbuf.h"
 #include "lib.h"
@@ -64,8 +68,13 @@
 #endif
 #include "network.h"
 #include "resources.h"
+#include "rewind.h"
+#include "runahead.h"
 #include "sound.h"
+#include "starttrace.h"
+#include "tracezone.h"
 #include "types.h"
+#include "vice-event.h"
 #include "videoarch.h"
 #include "vsync.h"
 #include "vsyncapi.h"
@@ -79,6 +88,7 @@
 /* public metrics, updated every vsync */
 static double vsync_metric_cpu_percent;
 static double vsync_metric_emulated_fps;
+static double vsync_metric_input_latency_ms;
 
 #ifdef USE_VICE_THREAD
 #   include <pthread.h>
@@ -159,6 +169,40 @@ static int initial_warp_mode_cmdline = -1;
 /* When the next frame should be rendered, not skipped, during warp. */
 static tick_t warp_render_tick_interval;
 
+/* "MaxWarp": frames skipped during warp are not even drawn. */
+static int max_warp_enabled;
+
+/* true while a program embedding the emulator steps it (libvice.c): the
+   frames are neither paced nor skipped */
+static bool stepped = false;
+
+/* "VsyncJustInTime": delay the start of each frame so that emulating it
+   finishes just before the frame is due. */
+static int just_in_time_enabled;
+
+/* "VsyncLateInput": poll the input devices right before each frame is
+   emulated. */
+static int late_input_enabled;
+
+/* "VsyncHostGrid": sleep once per frame, until a frame boundary of the host
+   clock shared by all emulator processes on the host. */
+static int host_grid_enabled;
+
+/* "VsyncPreciseSleep": sleep until the frame deadlines with
+   tick_sleep_until(), spinning for the last part of the wait. */
+static int precise_sleep_enabled;
+
+#define VSYNC_INTERVAL_DEFAULT  1000
+#define VSYNC_INTERVAL_MAX      5000
+
+/* "VsyncInterval": microseconds of emulated time between the sound flushes
+   and host time syncs done at the end of a raster line, 0 for every line. */
+static int sync_interval_us;
+
+/* The same in CPU cycles, and the cycle at which the next one is due. */
+static CLOCK sync_interval_clk;
+static CLOCK sync_next_clk;
+
 /* Triggers the vice thread to update its priorty */
 static volatile int update_thread_priority = 1;
 
@@ -191,6 +235,13 @@ int vsync_get_warp_mode(void)
     return warp_enabled;
 }
 
+/* Let the program embedding the emulator pace it: no sleeping and no
+   skipped frames.  */
+void vsync_set_stepped(bool enabled)
+{
+    stepped = enabled;
+}
+
 static int set_initial_warp_mode_resource(int val, void *param)
 {
     initial_warp_mode_resource = val ? 1 : 0;
@@ -198,6 +249,57 @@ static int set_initial_warp_mode_resource(int val, void *param)
     return 0;
 }
 
+static int set_max_warp_enabled(int val, void *param)
+{
+    max_warp_enabled = val ? 1 : 0;
+
+    return 0;
+}
+
+static int set_just_in_time_enabled(int val, void *param)
+{
+    just_in_time_enabled = val ? 1 : 0;
+    vsync_suspend_speed_eval();
+
+    return 0;
+}
+
+static int set_host_grid_enabled(int val, void *param)
+{
+    host_grid_enabled = val ? 1 : 0;
+    vsync_suspend_speed_eval();
+
+    return 0;
+}
+
+static int set_precise_sleep_enabled(int val, void *param)
+{
+    precise_sleep_enabled = val ? 1 : 0;
+
+    return 0;
+}
+
+static void update_sync_interval(void);
+
+static int set_sync_interval(int val, void *param)
+{
+    if (val < 0 || val > VSYNC_INTERVAL_MAX) {
+        return -1;
+    }
+
+    sync_interval_us = val;
+    update_sync_interval();
+
+    return 0;
+}
+
+static int set_late_input_enabled(int val, void *param)
+{
+    late_input_enabled = val ? 1 : 0;
+
+    return 0;
+}
+
 /* Vsync-related resources. */
 static const resource_int_t resources_int[] = {
     { "Speed", 100, RES_EVENT_SAME, NULL,
@@ -205,6 +307,18 @@ static const resource_int_t resources_int[] = {
     { "InitialWarpMode", 0, RES_EVENT_STRICT, (resource_value_t)0,
       /* FIXME: maybe RES_EVENT_NO */
       &initial_warp_mode_resource, set_initial_warp_mode_resource, NULL },
+    { "MaxWarp", 0, RES_EVENT_NO, NULL,
+      &max_warp_enabled, set_max_warp_enabled, NULL },
+    { "VsyncJustInTime", 0, RES_EVENT_NO, NULL,
+      &just_in_time_enabled, set_just_in_time_enabled, NULL },
+    { "VsyncLateInput", 0, RES_EVENT_NO, NULL,
+      &late_input_enabled, set_late_input_enabled, NULL },
+    { "VsyncHostGrid", 0, RES_EVENT_NO, NULL,
+      &host_grid_enabled, set_host_grid_enabled, NULL },
+    { "VsyncPreciseSleep", 1, RES_EVENT_NO, NULL,
+      &precise_sleep_enabled, set_precise_sleep_enabled, NULL },
+    { "VsyncInterval", VSYNC_INTERVAL_DEFAULT, RES_EVENT_NO, NULL,
+      &sync_interval_us, set_sync_interval, NULL },
     RESOURCE_INT_LIST_END
 };
 
@@ -239,6 +353,39 @@ static const cmdline_option_t cmdline_options[] =
     { "+warp", CALL_FUNCTION, CMDLINE_ATTRIB_NONE,
       set_initial_warp_mode_cmdline, vice_int_to_ptr(0), NULL, NULL,
       NULL, "Do not initially enable warp mode (default)" },
+    { "-maxwarp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MaxWarp", (resource_value_t)1,
+      NULL, "Do not draw the frames that are skipped in warp mode" },
+    { "+maxwarp", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "MaxWarp", (resource_value_t)0,
+      NULL, "Draw all frames in warp mode, only skip showing them (default)" },
+    { "-vsyncjit", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncJustInTime", (resource_value_t)1,
+      NULL, "Start emulating each frame just in time to finish it when it is due" },
+    { "+vsyncjit", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncJustInTime", (resource_value_t)0,
+      NULL, "Emulate each frame at the speed of the real machine (default)" },
+    { "-lateinput", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncLateInput", (resource_value_t)1,
+      NULL, "Poll the input devices right before emulating each frame" },
+    { "+lateinput", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncLateInput", (resource_value_t)0,
+      NULL, "Only poll the input devices while emulating a frame (default)" },
+    { "-vsynchostgrid", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncHostGrid", (resource_value_t)1,
+      NULL, "Sleep once per frame, in step with the other emulators on the host" },
+    { "+vsynchostgrid", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncHostGrid", (resource_value_t)0,
+      NULL, "Sleep every few milliseconds while emulating a frame (default)" },
+    { "-vsyncprecise", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncPreciseSleep", (resource_value_t)1,
+      NULL, "Wake up precisely when a frame is due, spinning for the last part of the wait (default)" },
+    { "+vsyncprecise", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "VsyncPreciseSleep", (resource_value_t)0,
+      NULL, "Leave waking up when a frame is due to the sleep of the host" },
+    { "-vsyncinterval", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "VsyncInterval", NULL,
+      "<microseconds>", "Flush the sound and sync to the host every <microseconds> of emulated time, 0 at every raster line (0-5000, default 1000)" },
     CMDLINE_LIST_END
 };
 
@@ -279,6 +426,24 @@ static int timer_speed = 0;
 static bool sync_reset = true;
 static bool metrics_reset = false;
 
+/* false while the sound device paces the emulation */
+static bool sync_tick_based = true;
+
+/* when the emulation of the current frame started */
+static tick_t frame_start_tick;
+
+/* Frames emulated (calls to vsync_do_vsync()) and rendered (frames a
+   canvas was told not to skip) since startup.  */
+static unsigned long frames_emulated = 0;
+static unsigned long frames_rendered = 0;
+
+/* host ticks needed to emulate a frame, follows increases immediately and
+   decreases slowly */
+static double frame_emulation_ticks;
+
+/* when the input was first polled during the current frame, 0 if not yet */
+static tick_t frame_input_tick;
+
 /* Initialize vsync timers and set relative speed of emulation in percent. */
 static int set_timer_speed(int speed)
 {
@@ -307,6 +472,13 @@ static int set_timer_speed(int speed)
     return 0;
 }
 
+/* Convert the sync interval to machine cycles and sync at the next line. */
+static void update_sync_interval(void)
+{
+    sync_interval_clk = (CLOCK)((double)cycles_per_sec * sync_interval_us / 1000000.0);
+    sync_next_clk = 0;
+}
+
 /* ------------------------------------------------------------------------- */
 
 void vsync_set_machine_parameter(double refresh, long cycles)
@@ -315,6 +487,7 @@ void vsync_set_machine_parameter(double refresh, long cycles)
     cycles_per_sec = cycles;
     cycles_per_frame = (double)cycles / refresh;
     set_timer_speed(relative_speed);
+    update_sync_interval();
 }
 
 double vsync_get_refresh_frequency(void)
@@ -355,10 +528,17 @@ void vsync_shutdown(void)
    emulation happens, so that we don't display bogus speed values. */
 void vsync_suspend_speed_eval(void)
 {
+    if (runahead_restoring() || network_rollback_restoring()) {
+        /* restoring the state is part of running ahead or rolling back */
+        return;
+    }
+    runahead_cancel();
+
     /* TODO - Is this needed any more now that late vsync is detected
        in vsync_do_vsync() */
     network_suspend();
     sync_reset = true;
+    sync_next_clk = 0;
 }
 
 void vsync_reset_hook(void)
@@ -368,13 +548,14 @@ void vsync_reset_hook(void)
     vsync_suspend_speed_eval();
 }
 
-void vsyncarch_get_metrics(double *cpu_percent, double *emulated_fps, int *is_warp_enabled)
+void vsyncarch_get_metrics(double *cpu_percent, double *emulated_fps, int *is_warp_enabled, double *input_latency_ms)
 {
     METRIC_LOCK();
 
     *cpu_percent = vsync_metric_cpu_percent;
     *emulated_fps = vsync_metric_emulated_fps;
     *is_warp_enabled = warp_enabled;
+    *input_latency_ms = vsync_metric_input_latency_ms;
 
     METRIC_UNLOCK();
 }
@@ -425,6 +606,7 @@ static void reset_performance_metrics(tick_t frame_tick)
         vsync_metric_emulated_fps = (0.0 - timer_speed);
         vsync_metric_cpu_percent  = (0.0 - timer_speed) / refresh_frequency * 100;
     }
+    vsync_metric_input_latency_ms = 0.0;
 
     METRIC_UNLOCK();
 }
@@ -483,6 +665,108 @@ static void update_performance_metrics(tick_t frame_tick)
     }
 }
 
+/* Poll the input devices, remember when that first happened in this frame. */
+static void poll_input(tick_t now)
+{
+    joystick();
+
+    if (frame_input_tick == 0) {
+        frame_input_tick = now;
+    }
+}
+
+/*
+ * Sleep until host tick `deadline', with the main lock released, and record
+ * how far from it the emulation woke up.
+ */
+static void vsync_sleep_until(tick_t deadline)
+{
+    tick_t now = tick_now();
+
+    if (precise_sleep_enabled) {
+        mainlock_yield_and_sleep_until(deadline);
+    } else if ((int32_t)(deadline - now) > 0) {
+        mainlock_yield_and_sleep(deadline - now);
+    } else {
+        mainlock_yield();
+    }
+
+    framestats_sleep_end((int64_t)TICK_TO_NANO(1) * (int32_t)(tick_now_after(now) - deadline));
+}
+
+/*
+ * Called when a frame has been emulated and handed to the video output.
+ *
+ * Measures how long emulating the frame took and how old the input it saw
+ * was.  With VsyncJustInTime, sleeps until emulating the next frame as fast
+ * as possible just finishes it when it is due, so the image is based on
+ * input polled shortly before it is displayed rather than up to a frame
+ * earlier.  This only works while the emulation is paced by the host timer:
+ * when the sound device paces it, the frames keep being emulated as the
+ * sound buffer drains.
+ *
+ * With VsyncHostGrid, sleeps until the frame is due instead, moved to the
+ * nearest multiple of the frame duration on the host clock.  All emulators
+ * of the same video standard on the host then wake up at the same moments
+ * and emulate their frames back-to-back, rather than each waking up every
+ * few milliseconds at its own times.
+ */
+static void vsync_frame_pacing(tick_t now)
+{
+    tick_t sample = now - frame_start_tick;
+    double latency_ms;
+
+    if (frame_start_tick != 0 && !warp_enabled) {
+        if (sample > frame_emulation_ticks) {
+            frame_emulation_ticks = sample;
+        } else {
+            frame_emulation_ticks = frame_emulation_ticks * 0.95 + sample * 0.05;
+        }
+    }
+
+    if (frame_input_tick != 0) {
+        latency_ms = (double)(now - frame_input_tick) * 1000.0 / tick_per_second();
+
+        METRIC_LOCK();
+        if (vsync_metric_input_latency_ms == 0.0) {
+            vsync_metric_input_latency_ms = latency_ms;
+        } else {
+            vsync_metric_input_latency_ms = (MEASUREMENT_SMOOTH_FACTOR * vsync_metric_input_latency_ms) + (1.0 - MEASUREMENT_SMOOTH_FACTOR) * latency_ms;
+        }
+        METRIC_UNLOCK();
+
+        frame_input_tick = 0;
+    }
+
+    if (just_in_time_enabled && !warp_enabled && sync_tick_based && !sync_reset) {
+        /* host tick at which the frame just emulated is due */
+        double frame_due = sync_target_tick + (double)tick_per_second() * (maincpu_clk - last_sync_clk) / emulated_clk_per_second;
+
+        /* start the next one late enough to finish it just before it is due */
+        double next_start = frame_due + ticks_per_frame - frame_emulation_ticks * 1.25 - tick_per_second() / 1000.0;
+
+        if (next_start > (double)now && next_start - now < ticks_per_frame) {
+            vsync_sleep_until(now + (tick_t)(next_start - now));
+        }
+    } else if (host_grid_enabled && !warp_enabled && sync_tick_based && !sync_reset) {
+        double frame_due = sync_target_tick + (double)tick_per_second() * (maincpu_clk - last_sync_clk) / emulated_clk_per_second;
+        double wake = floor(frame_due / ticks_per_frame + 0.5) * ticks_per_frame;
+
+        /* keep the emulation in phase with the grid */
+        sync_target_tick = (tick_t)(sync_target_tick + (wake - frame_due));
+
+        if (wake > (double)now && wake - now < 2 * ticks_per_frame) {
+            vsync_sleep_until(now + (tick_t)(wake - now));
+        }
+    }
+
+    frame_start_tick = tick_now();
+
+    if (late_input_enabled) {
+        poll_input(frame_start_tick);
+    }
+}
+
 void vsync_do_end_of_line(void)
 {
     const int microseconds_between_sync = 2 * 1000;
@@ -501,6 +785,8 @@ void vsync_do_end_of_line(void)
     /* used to preserve the fractional ticks betwen calls */
     static double sync_emulated_ticks_offset;
 
+    int hosttime_previous;
+
     /*
      * Ideally the vic chip draw alarm wouldn't be triggered
      * during shutdown but here we are - apply workaround.
@@ -515,8 +801,34 @@ void vsync_do_end_of_line(void)
         return;
     }
 
+    /*
+     * Most lines have nothing to do: the sound is flushed and the host time
+     * synced only every VsyncInterval of emulated time.  The clock can also
+     * go back (snapshots, running ahead), then sync right away.
+     */
+
+    if (main_cpu_clock < sync_next_clk
+        && sync_next_clk - main_cpu_clock <= sync_interval_clk
+        && !update_thread_priority) {
+        return;
+    }
+    sync_next_clk = main_cpu_clock + sync_interval_clk;
+
+    hosttime_previous = HOSTTIME_ENTER(HOSTTIME_SYNC);
+    TRACEZONE_BEGIN(TRACEZONE_VSYNC);
+
     /* deal with any accumulated sound immediately */
+    TRACEZONE_BEGIN(TRACEZONE_SOUND);
     tick_based_sync_timing = sound_flush();
+    TRACEZONE_END(TRACEZONE_SOUND);
+
+    if (runahead_in_progress() || network_rollback_in_progress() || stepped) {
+        /* the frames ahead or rolled back are emulated as fast as possible */
+        TRACEZONE_END(TRACEZONE_VSYNC);
+        HOSTTIME_LEAVE(hosttime_previous);
+        return;
+    }
+    sync_tick_based = tick_based_sync_timing;
 
     tick_now = tick_now_after(last_sync_tick);
 
@@ -530,6 +842,8 @@ void vsync_do_end_of_line(void)
         last_sync_clk = main_cpu_clock;
         sync_target_tick = tick_now;
 
+        TRACEZONE_END(TRACEZONE_VSYNC);
+        HOSTTIME_LEAVE(hosttime_previous);
         return;
     }
 
@@ -575,8 +889,11 @@ void vsync_do_end_of_line(void)
                 /* Emulation timing / sync is OK. */
 
                 /* If we can't rely on the audio device for timing, slow down here. */
-                if (tick_based_sync_timing) {
-                    mainlock_yield_and_sleep(ticks_until_target);
+                if (tick_based_sync_timing && !just_in_time_enabled && !host_grid_enabled) {
+                    vsync_sleep_until(sync_target_tick);
+                } else if (tick_based_sync_timing) {
+                    /* vsync_frame_pacing() sleeps between the frames */
+                    mainlock_yield();
                 }
             } else if ((tick_t)0 - ticks_until_target > tick_per_second()) {
                 /* We are more than a second behind, reset sync and accept that we're not running at full speed. */
@@ -592,11 +909,11 @@ void vsync_do_end_of_line(void)
             }
         }
 
-        /* deal with pending user input */
-        joystick();
-
         last_sync_tick = tick_now;
         last_sync_clk = main_cpu_clock;
+
+        /* deal with pending user input */
+        poll_input(tick_now);
     }
 
     /* Do we need to update the thread priority? */
@@ -611,6 +928,33 @@ void vsync_do_end_of_line(void)
         /* TODO: BSD thread prio stuff */
 #endif
     }
+
+    TRACEZONE_END(TRACEZONE_VSYNC);
+    HOSTTIME_LEAVE(hosttime_previous);
+}
+
+/* Get the CPU cycle that is due at host tick `tick' by the last sync, or
+   the current cycle if the emulation is not paced by the host clock.  */
+CLOCK vsync_clk_at_tick(tick_t tick)
+{
+    double cycles;
+
+    if (warp_enabled || !sync_tick_based || sync_reset) {
+        return maincpu_clk;
+    }
+
+    cycles = (double)(int32_t)(tick - sync_target_tick) * emulated_clk_per_second / tick_per_second();
+    if (cycles < 0 && (CLOCK)-cycles > last_sync_clk) {
+        return 0;
+    }
+    return (CLOCK)((double)last_sync_clk + cycles);
+}
+
+/* Get the number of frames emulated and rendered since startup.  */
+void vsync_get_frame_counts(unsigned long *emulated, unsigned long *rendered)
+{
+    *emulated = frames_emulated;
+    *rendered = frames_rendered;
 }
 
 bool vsync_should_skip_frame(struct video_canvas_s *canvas)
@@ -627,6 +971,22 @@ bool vsync_should_skip_frame(struct video_canvas_s *canvas)
         return true;
     }
 
+    if (runahead_should_skip_frame()) {
+        /* a real frame or one of the frames ahead but the last */
+        return true;
+    }
+
+    if (network_rollback_in_progress()) {
+        /* emulated again after a netplay rollback */
+        return true;
+    }
+
+    if (stepped) {
+        /* every frame is looked at by the embedding program */
+        frames_rendered++;
+        return false;
+    }
+
     /*
      * Limit rendering fps if we're in warp mode.
      * It's ugly enough for dqh to weep but makes warp faster.
@@ -648,14 +1008,36 @@ bool vsync_should_skip_frame(struct video_canvas_s *canvas)
                 canvas->warp_next_render_tick = now + warp_render_tick_interval;
             }
             /* render this frame */
+            frames_rendered++;
             return false;
         }
     }
 
     /* render this frame */
+    frames_rendered++;
     return false;
 }
 
+/*
+ * In max warp the frames that vsync_should_skip_frame() would not show are
+ * not drawn either.  This decides it at the start of a frame: the frame is
+ * drawn once the time for the next rendered one has come.  Not drawing can
+ * lose sprite collisions the program did not use before, so recordings,
+ * playbacks and netplay always draw.
+ */
+bool vsync_should_skip_drawing(struct video_canvas_s *canvas)
+{
+    if (!warp_enabled || !max_warp_enabled) {
+        return false;
+    }
+
+    if (network_connected() || event_record_active() || event_playback_active()) {
+        return false;
+    }
+
+    return tick_now() < canvas->warp_next_render_tick;
+}
+
 /* This is called at the end of each screen frame. */
 void vsync_do_vsync(struct video_canvas_s *c)
 {
@@ -664,8 +1046,19 @@ void vsync_do_vsync(struct video_canvas_s *c)
     tick_t now;
     tick_t network_hook_time = 0;
 
+    frames_emulated++;
+
+    if (runahead_in_progress()) {
+        runahead_vsync_hook();
+        return;
+    }
+
     monitor_vsync_hook();
 
+    autowarp_vsync_hook();
+
+    starttrace_frame();
+
     /*
      * process everything wich should be done before the synchronisation
      * e.g. OS/2: exit the programm if trigger_shutdown set
@@ -695,6 +1088,7 @@ void vsync_do_vsync(struct video_canvas_s *c)
 #endif
 
     now = tick_now_after(last_vsync);
+    framestats_frame_end(TICK_TO_NANO(now - last_vsync), metrics_reset || last_vsync == 0);
     update_performance_metrics(now);
 
     vsyncarch_postsync();
@@ -704,9 +1098,19 @@ void vsync_do_vsync(struct video_canvas_s *c)
                 now, delay, sound_delay * 1000000, tick_now(), next_frame_start, ticks_per_frame);
 #endif
 
+    rewind_vsync_hook();
+
+    runahead_vsync_hook();
+
     execute_vsync_callbacks();
 
     kbdbuf_flush();
 
+    hosttime_frame_end();
+
+    if (!stepped) {
+        vsync_frame_pacing(now);
+    }
+
     last_vsync = now;
 }
@@ -27,6 +27,9 @@
 #ifndef VICE_VSYNC_H
 #define VICE_VSYNC_H
 
+#include "archdep_tick.h"
+#include "types.h"
+
 /* Manually defined */
 /* To enable/disable this option by hand change the 0 below to 1. */
 #if 0
@@ -51,9 +54,13 @@ void vsync_set_machine_parameter(double refresh_rate, long cycles);
 double vsync_get_refresh_frequency(void);
 void vsync_do_end_of_line(void);
 bool vsync_should_skip_frame(struct video_canvas_s *canvas);
+bool vsync_should_skip_drawing(struct video_canvas_s *canvas);
 void vsync_do_vsync(struct video_canvas_s *c);
 void vsync_on_vsync_do(vsync_callback_func_t callback_func, void *callback_param);
 void vsync_set_warp_mode(int val);
 int vsync_get_warp_mode(void);
+void vsync_set_stepped(bool enabled);
+void vsync_get_frame_counts(unsigned long *emulated, unsigned long *rendered);
+CLOCK vsync_clk_at_tick(tick_t tick);
 
 #endif
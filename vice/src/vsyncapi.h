@@ -33,8 +33,10 @@ struct video_canvas_s;
 
 typedef void (*void_hook_t)(void);
 
-/* current performance metrics */
-void vsyncarch_get_metrics(double *cpu_percent, double *emulated_fps, int *warp_enabled);
+/* current performance metrics; the input latency is the average time from
+   the first input poll of a frame to the frame being handed to the video
+   output, in milliseconds */
+void vsyncarch_get_metrics(double *cpu_percent, double *emulated_fps, int *warp_enabled, double *input_latency_ms);
 
 /* this is called before vsync_do_vsync does the synchroniation */
 void vsyncarch_presync(void);
@@ -101,6 +101,10 @@ static void z80core_reset(void)
                                 | (LOAD(z80_reg_pc + 2) << 16) \
                                 | (LOAD(z80_reg_pc + 3) << 24)))
 
+/* After a DD or FD prefix the bytes already fetched move down by one, only
+   the last one has to be read.  */
+#define FETCH_PREFIXED_OPCODE(o) ((o) = ((o) >> 8) | (LOAD(z80_reg_pc + 3) << 24))
+
 #define p0 (opcode & 0xff)
 #define p1 ((opcode >> 8) & 0xff)
 #define p2 ((opcode >> 16) & 0xff)
@@ -4061,8 +4065,8 @@ static void z80_maincpu_loop(interrupt_cpu_status_t *cpu_int_status, alarm_conte
         }
 
         SET_LAST_ADDR(z80_reg_pc);
-fetchmore:
         FETCH_OPCODE(opcode);
+decode:
 
 #ifdef DEBUG
         if (debug.maincpu_traceflg) {
@@ -4902,7 +4906,7 @@ fetchmore:
                 CALL_COND(p12, LOCAL_CARRY(), 3, 3, 11, 10, 3);
                 break;
             case 0xdd: /*  OPCODE DD */
-                INSTS(inst_mode = INST_IX; CLK_ADD(CLK, 4); INC_PC(1); goto fetchmore, NOP(4,1), NOP(4,1));
+                INSTS(inst_mode = INST_IX; CLK_ADD(CLK, 4); INC_PC(1); FETCH_PREFIXED_OPCODE(opcode); goto decode, NOP(4,1), NOP(4,1));
                 break;
             case 0xde: /* SBC # */
                 SBC(p1, 4, 3, 2);
@@ -5008,7 +5012,7 @@ fetchmore:
                 CALL_COND(p12, LOCAL_SIGN(), 3, 3, 11, 10, 3);
                 break;
             case 0xfd: /* OPCODE FD */
-                INSTS(inst_mode = INST_IY; CLK_ADD(CLK, 4); INC_PC(1); goto fetchmore, NOP(4,1), NOP(4,1));
+                INSTS(inst_mode = INST_IY; CLK_ADD(CLK, 4); INC_PC(1); FETCH_PREFIXED_OPCODE(opcode); goto decode, NOP(4,1), NOP(4,1));
                 break;
             case 0xfe: /* CP # */
                 CP(p1, 4, 3, 2);
@@ -5023,7 +5027,7 @@ fetchmore:
 
         if (maincpu_clk_limit && (CLK > maincpu_clk_limit)) {
             log_error(LOG_DEFAULT, "cycle limit reached.");
-            archdep_vice_exit(1);
+            batch_vice_exit(1);
         }
 
     } while (Z80_LOOP_COND);
@@ -31,6 +31,11 @@
 
 /* This code might be improved a lot...  */
 
+/* fopencookie() */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
 #include "vice.h"
 
 #include <ctype.h>
@@ -46,14 +51,24 @@
 #ifdef HAVE_ZLIB
 #include <zlib.h>
 #endif
+#ifdef HAVE_BZIP2
+#include <bzlib.h>
+#endif
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
 #endif
 
+#ifdef USE_IMAGE_WRITEBACK
+#include <pthread.h>
+#include <time.h>
+#endif
+
 #include "archdep.h"
+#include "cmdline.h"
 #include "lib.h"
 #include "log.h"
+#include "resources.h"
 #include "util.h"
 #include "zipcode.h"
 
@@ -93,6 +108,7 @@ struct zfile_s {
     struct zfile_s *prev, *next; /* Link to the previous and next nodes.  */
     zfile_action_t action;       /* action on close */
     char *request_string;        /* ui string for action=ZFILE_REQUEST */
+    int in_memory;               /* Non-zero for cached and memory streams. */
 };
 typedef struct zfile_s zfile_t;
 
@@ -105,91 +121,1218 @@ static log_t zlog = LOG_ERR;
 static int zinit_done = 0;
 
 
-/** \@brief 'Check' is file \a name is a gzip or compress file
- *
- * \param[in]   name    filename or path
- *
- * \return  bool
- *
- * \fixme   this is a silly function and should be reimplemented using the
- *          2-byte header of the file
- */
-static int file_is_gzip(const char *name)
+/** \@brief 'Check' is file \a name is a gzip or compress file
+ *
+ * \param[in]   name    filename or path
+ *
+ * \return  bool
+ *
+ * \fixme   this is a silly function and should be reimplemented using the
+ *          2-byte header of the file
+ */
+static int file_is_gzip(const char *name)
+{
+    size_t l = strlen(name);
+
+    if ((l < 4 || util_strcasecmp(name + l - 3, ".gz"))
+        && (l < 3 || util_strcasecmp(name + l - 2, ".z"))
+        && (l < 4 || toupper((unsigned char)name[l - 1]) != 'Z' || name[l - 4] != '.')) {
+          return 0;
+    }
+    return 1;
+}
+
+
+static void zfile_list_destroy(void)
+{
+    zfile_t *p;
+
+    for (p = zfile_list; p != NULL; ) {
+        zfile_t *next;
+
+        lib_free(p->orig_name);
+        lib_free(p->tmp_name);
+        next = p->next;
+        lib_free(p);
+        p = next;
+    }
+
+    zfile_list = NULL;
+}
+
+static int zinit(void)
+{
+    zlog = log_open("ZFile");
+
+    /* Free the `zfile_list' if not empty.  */
+    zfile_list_destroy();
+
+    zinit_done = 1;
+
+    return 0;
+}
+
+/* Add one zfile to the list.  `orig_name' is automatically expanded to the
+   complete path.  */
+static void zfile_list_add(const char *tmp_name,
+                           const char *orig_name,
+                           enum compression_type type,
+                           int write_mode,
+                           FILE *stream, FILE *fd)
+{
+    zfile_t *new_zfile = lib_malloc(sizeof(zfile_t));
+
+    /* Make sure we have the complete path of the file.  */
+    archdep_expand_path(&new_zfile->orig_name, orig_name);
+
+    /* The new zfile becomes first on the list.  */
+    new_zfile->tmp_name = tmp_name ? lib_strdup(tmp_name) : NULL;
+    new_zfile->write_mode = write_mode;
+    new_zfile->stream = stream;
+    new_zfile->fd = fd;
+    new_zfile->type = type;
+    new_zfile->action = ZFILE_KEEP;
+    new_zfile->request_string = NULL;
+    new_zfile->in_memory = 0;
+    new_zfile->next = zfile_list;
+    new_zfile->prev = NULL;
+    if (zfile_list != NULL) {
+        zfile_list->prev = new_zfile;
+    }
+    zfile_list = new_zfile;
+}
+
+
+/* ------------------------------------------------------------------------ */
+
+/* In-memory files.
+
+   Disk and tape images are accessed with a lot of small seeks and reads,
+   each of which costs at least one system call with plain stdio.  A cached
+   stream serves reads from a copy of the whole file kept in memory.  Writes
+   update the copy and go through to the file whenever stdio flushes the
+   stream, just like they would without the cache, so other readers of the
+   file (directory listings, c1541) do not see stale data.  Only if that is
+   traded for fewer writes, they can be held back for a while (see below).
+
+   Compressed files that can be uncompressed in-process are opened as memory
+   streams with no file behind them.  If such a stream has been written to,
+   its contents are compressed back into the original file when it is
+   closed.  */
+
+#if defined(HAVE_FOPENCOOKIE) || defined(HAVE_FUNOPEN)
+#define ZFILE_IN_MEMORY
+#endif
+
+/* Writes are only held back in the copies of cached streams.  */
+#if defined(USE_IMAGE_WRITEBACK) && defined(ZFILE_IN_MEMORY)
+#define ZFILE_WRITEBACK
+#endif
+
+/* Files are read ahead on a thread of the same build option, into the
+   memory of cached and memory streams.  */
+#ifdef ZFILE_WRITEBACK
+#define ZFILE_PREFETCH
+#endif
+
+#ifdef ZFILE_IN_MEMORY
+
+/* Larger files are accessed through stdio or temporary files.  */
+#define ZFILE_CACHE_MAX  (64 * 1024 * 1024)
+
+typedef struct zfile_cache_s {
+    FILE *backing;      /* Stream of the file itself, NULL for memory streams.  */
+    char *orig_name;    /* Compressed file behind a memory stream.  */
+    int borrowed;       /* `data' belongs to the caller.  */
+    enum compression_type type;
+    int dirty;          /* Memory stream has been written to.  */
+    uint8_t *data;
+    size_t size;        /* Current size of the file.  */
+    size_t alloc;       /* Allocated size of `data'.  */
+    size_t pos;
+    int write_mode;
+    struct zfile_memory_file_s *memory_file;    /* Memory file the data belongs to.  */
+#ifdef ZFILE_WRITEBACK
+    /* Held back writes, see below.  */
+    uint8_t *held_map;          /* One bit per ZFILE_WRITEBACK_BLOCK bytes.  */
+    size_t held_map_size;       /* Allocated size of `held_map'.  */
+    int64_t first_write;        /* Time of the oldest held back write, 0 if none.  */
+    int64_t last_write;         /* Time of the newest held back write.  */
+    int busy;                   /* Being written by the writer thread.  */
+    char *journal_name;         /* NULL if the file cannot have a journal.  */
+    struct zfile_cache_s *next; /* Next stream that can hold back writes.  */
+#endif
+} zfile_cache_t;
+
+static long zfile_cache_read(void *cookie, char *buf, size_t len)
+{
+    zfile_cache_t *cache = cookie;
+
+    if (cache->pos >= cache->size) {
+        return 0;
+    }
+    if (len > cache->size - cache->pos) {
+        len = cache->size - cache->pos;
+    }
+    memcpy(buf, cache->data + cache->pos, len);
+    cache->pos += len;
+
+    return (long)len;
+}
+
+/* Store `len' bytes at the position of `cache' into the copy of the file.  */
+static void zfile_cache_store(zfile_cache_t *cache, const char *buf, size_t len)
+{
+    size_t end = cache->pos + len;
+
+    if (end > cache->alloc) {
+        while (end > cache->alloc) {
+            cache->alloc *= 2;
+        }
+        cache->data = lib_realloc(cache->data, cache->alloc);
+    }
+    if (cache->pos > cache->size) {
+        /* The file system fills the gap with zeroes.  */
+        memset(cache->data + cache->size, 0, cache->pos - cache->size);
+    }
+    memcpy(cache->data + cache->pos, buf, len);
+
+    if (end > cache->size) {
+        cache->size = end;
+    }
+    cache->pos = end;
+}
+
+#ifdef ZFILE_WRITEBACK
+
+/* Held back writes.
+
+   With a write-back delay set, writes to cached streams of files only go to
+   the copy in memory, and the blocks they touch are flagged.  A writer
+   thread writes the flagged blocks, merged into runs, to the file once the
+   stream has not been written to for a second, or once the oldest held
+   back write is as old as the delay.  The rest is written on the calling
+   thread when the stream is closed or the write-back delay is set to 0,
+   and on shutdown.
+
+   With the journal enabled, the runs are first written to `<file>.journal'
+   and synced, then to the file, which is synced before the journal is
+   removed.  A journal left behind by a crash is written into the file when
+   it is opened the next time.
+
+   The lock protects the held back state of all streams and their copies of
+   the files: the emulation changes a copy only with the lock held, and the
+   writer thread copies the runs out with the lock held.  */
+
+#define ZFILE_WRITEBACK_BLOCK       256
+#define ZFILE_WRITEBACK_IDLE_MS     1000
+#define ZFILE_WRITEBACK_DELAY_MAX   3600
+
+#define ZFILE_JOURNAL_MAGIC         "VICEJRNL"
+#define ZFILE_JOURNAL_MAGIC_LEN     8
+#define ZFILE_JOURNAL_END           0xffffffffU
+
+/* A run of flagged blocks, copied out of the stream.  */
+typedef struct zfile_writeback_run_s {
+    uint32_t offset;
+    uint32_t len;
+    uint8_t *data;
+} zfile_writeback_run_t;
+
+static int writeback_delay = 0;     /* in seconds, 0 writes through */
+static int writeback_journal = 0;
+
+static pthread_mutex_t writeback_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writeback_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t writeback_idle_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t writeback_thread;
+static int writeback_running = 0;
+static int writeback_quit = 0;
+static int writeback_shut_down = 0;
+
+/* Streams that can hold back writes.  */
+static zfile_cache_t *writeback_list = NULL;
+
+static int64_t writeback_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void writeback_put_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t writeback_get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void writeback_free_runs(zfile_writeback_run_t *runs, int num)
+{
+    int i;
+
+    for (i = 0; i < num; i++) {
+        lib_free(runs[i].data);
+    }
+    lib_free(runs);
+}
+
+/* Write `runs' to the journal `name' and sync it.  */
+static int writeback_journal_write(const char *name,
+                                   const zfile_writeback_run_t *runs, int num)
+{
+    FILE *f;
+    uint8_t hdr[8];
+    int i, err;
+
+    f = fopen(name, MODE_WRITE);
+    if (f == NULL) {
+        return -1;
+    }
+
+    err = fwrite(ZFILE_JOURNAL_MAGIC, ZFILE_JOURNAL_MAGIC_LEN, 1, f) != 1;
+    for (i = 0; i < num && !err; i++) {
+        writeback_put_le32(hdr, runs[i].offset);
+        writeback_put_le32(hdr + 4, runs[i].len);
+        err = fwrite(hdr, sizeof(hdr), 1, f) != 1
+              || fwrite(runs[i].data, runs[i].len, 1, f) != 1;
+    }
+    if (!err) {
+        writeback_put_le32(hdr, ZFILE_JOURNAL_END);
+        writeback_put_le32(hdr + 4, 0);
+        err = fwrite(hdr, sizeof(hdr), 1, f) != 1 || archdep_fsync(f) < 0;
+    }
+
+    if (fclose(f) != 0) {
+        err = 1;
+    }
+    return err ? -1 : 0;
+}
+
+/* Write the journal `name' into `stream' if it is complete, and remove it.
+   A journal that cannot be written is kept for the next time.  */
+static void writeback_journal_replay(const char *name, FILE *stream)
+{
+    FILE *f;
+    uint8_t hdr[8];
+    zfile_writeback_run_t *runs = NULL;
+    int num = 0, complete = 0, err = 0, i;
+
+    f = fopen(name, MODE_READ);
+    if (f == NULL) {
+        return;
+    }
+
+    if (fread(hdr, ZFILE_JOURNAL_MAGIC_LEN, 1, f) == 1
+        && memcmp(hdr, ZFILE_JOURNAL_MAGIC, ZFILE_JOURNAL_MAGIC_LEN) == 0) {
+        while (fread(hdr, sizeof(hdr), 1, f) == 1) {
+            zfile_writeback_run_t *run;
+
+            if (writeback_get_le32(hdr) == ZFILE_JOURNAL_END) {
+                complete = 1;
+                break;
+            }
+            if (writeback_get_le32(hdr + 4) == 0
+                || writeback_get_le32(hdr + 4) > ZFILE_CACHE_MAX) {
+                break;
+            }
+            runs = lib_realloc(runs, (num + 1) * sizeof(zfile_writeback_run_t));
+            run = &runs[num++];
+            run->offset = writeback_get_le32(hdr);
+            run->len = writeback_get_le32(hdr + 4);
+            run->data = lib_malloc(run->len);
+            if (fread(run->data, run->len, 1, f) != 1) {
+                break;
+            }
+        }
+    }
+    fclose(f);
+
+    if (complete) {
+        long pos = ftell(stream);
+
+        for (i = 0; i < num && !err; i++) {
+            err = util_fpwrite(stream, runs[i].data, runs[i].len, (long)runs[i].offset) < 0;
+        }
+        if (!err) {
+            err = archdep_fsync(stream) < 0;
+        }
+        fseek(stream, pos, SEEK_SET);
+        if (err) {
+            log_error(zlog, "Cannot write the journal `%s' into its file.", name);
+        } else {
+            log_message(zlog, "Wrote the changes kept in the journal `%s'.", name);
+        }
+    } else {
+        log_warning(zlog, "Discarding the incomplete journal `%s'.", name);
+    }
+    writeback_free_runs(runs, num);
+
+    if (!err && archdep_remove(name) < 0) {
+        log_error(zlog, "Cannot unlink `%s': %s", name, strerror(errno));
+    }
+}
+
+/* Copy the flagged blocks of `cache' out as runs and clear the flags.  */
+static int writeback_take_runs(zfile_cache_t *cache, zfile_writeback_run_t **runs)
+{
+    size_t blocks, b, start, end;
+    int num = 0;
+
+    *runs = NULL;
+    blocks = (cache->size + ZFILE_WRITEBACK_BLOCK - 1) / ZFILE_WRITEBACK_BLOCK;
+    if (blocks > cache->held_map_size * 8) {
+        blocks = cache->held_map_size * 8;
+    }
+
+    b = 0;
+    while (b < blocks) {
+        if (!(cache->held_map[b >> 3] & (1 << (b & 7)))) {
+            b++;
+            continue;
+        }
+        start = b;
+        while (b < blocks && (cache->held_map[b >> 3] & (1 << (b & 7)))) {
+            b++;
+        }
+        end = b * ZFILE_WRITEBACK_BLOCK;
+        if (end > cache->size) {
+            end = cache->size;
+        }
+
+        *runs = lib_realloc(*runs, (num + 1) * sizeof(zfile_writeback_run_t));
+        (*runs)[num].offset = (uint32_t)(start * ZFILE_WRITEBACK_BLOCK);
+        (*runs)[num].len = (uint32_t)(end - start * ZFILE_WRITEBACK_BLOCK);
+        (*runs)[num].data = lib_malloc((*runs)[num].len);
+        memcpy((*runs)[num].data, cache->data + (*runs)[num].offset, (*runs)[num].len);
+        num++;
+    }
+
+    if (cache->held_map != NULL) {
+        memset(cache->held_map, 0, cache->held_map_size);
+    }
+    cache->first_write = 0;
+
+    return num;
+}
+
+/* Write the held back blocks of `cache' to its file.  Called with the lock
+   held, which is released while writing.  */
+static void writeback_flush(zfile_cache_t *cache)
+{
+    zfile_writeback_run_t *runs;
+    int num, i, err = 0, journal;
+
+    num = writeback_take_runs(cache, &runs);
+    if (num == 0) {
+        return;
+    }
+    journal = writeback_journal && cache->journal_name != NULL;
+    cache->busy = 1;
+    pthread_mutex_unlock(&writeback_lock);
+
+    if (journal && writeback_journal_write(cache->journal_name, runs, num) < 0) {
+        log_error(zlog, "Cannot write the journal `%s'.", cache->journal_name);
+        journal = 0;
+    }
+    for (i = 0; i < num && !err; i++) {
+        err = util_fpwrite(cache->backing, runs[i].data, runs[i].len, (long)runs[i].offset) < 0;
+    }
+    if (!err) {
+        err = journal ? archdep_fsync(cache->backing) < 0 : fflush(cache->backing) != 0;
+    }
+    if (err) {
+        log_error(zlog, "Cannot write back the changes of an image.");
+    } else if (journal && archdep_remove(cache->journal_name) < 0) {
+        log_error(zlog, "Cannot unlink `%s': %s", cache->journal_name, strerror(errno));
+    }
+    writeback_free_runs(runs, num);
+
+    pthread_mutex_lock(&writeback_lock);
+    cache->busy = 0;
+    pthread_cond_broadcast(&writeback_idle_cond);
+}
+
+static void *writeback_main(void *arg)
+{
+    zfile_cache_t *cache;
+    int64_t now, due, next;
+    struct timespec ts;
+
+    pthread_mutex_lock(&writeback_lock);
+    while (!writeback_quit) {
+        now = writeback_now();
+        next = 0;
+        for (cache = writeback_list; cache != NULL; cache = cache->next) {
+            if (cache->first_write == 0 || cache->busy) {
+                continue;
+            }
+            due = cache->last_write + ZFILE_WRITEBACK_IDLE_MS;
+            if (due > cache->first_write + writeback_delay * 1000) {
+                due = cache->first_write + writeback_delay * 1000;
+            }
+            if (due <= now) {
+                break;
+            }
+            if (next == 0 || due < next) {
+                next = due;
+            }
+        }
+
+        if (cache != NULL) {
+            writeback_flush(cache);
+        } else if (next == 0) {
+            pthread_cond_wait(&writeback_cond, &writeback_lock);
+        } else {
+            ts.tv_sec = (time_t)(next / 1000);
+            ts.tv_nsec = (long)(next % 1000) * 1000000;
+            pthread_cond_timedwait(&writeback_cond, &writeback_lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&writeback_lock);
+
+    return NULL;
+}
+
+/* Store a write to a stream of a file only in the copy and flag it for the
+   writer thread.  Returns -1 if it must go through to the file.  */
+static int writeback_hold(zfile_cache_t *cache, const char *buf, size_t len)
+{
+    size_t first, last, b, size;
+    int64_t now;
+
+    if (writeback_delay == 0 || len == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&writeback_lock);
+
+    if (!writeback_running) {
+        writeback_quit = 0;
+        if (pthread_create(&writeback_thread, NULL, writeback_main, NULL) != 0) {
+            log_error(zlog, "Cannot create the image write-back thread.");
+            writeback_delay = 0;
+            pthread_mutex_unlock(&writeback_lock);
+            return -1;
+        }
+        writeback_running = 1;
+    }
+
+    first = cache->pos / ZFILE_WRITEBACK_BLOCK;
+    last = (cache->pos + len - 1) / ZFILE_WRITEBACK_BLOCK;
+    zfile_cache_store(cache, buf, len);
+
+    size = last / 8 + 1;
+    if (size > cache->held_map_size) {
+        if (size < cache->held_map_size * 2) {
+            size = cache->held_map_size * 2;
+        }
+        cache->held_map = lib_realloc(cache->held_map, size);
+        memset(cache->held_map + cache->held_map_size, 0, size - cache->held_map_size);
+        cache->held_map_size = size;
+    }
+    for (b = first; b <= last; b++) {
+        cache->held_map[b >> 3] |= (uint8_t)(1 << (b & 7));
+    }
+
+    now = writeback_now();
+    if (cache->first_write == 0) {
+        cache->first_write = now;
+        pthread_cond_signal(&writeback_cond);
+    }
+    cache->last_write = now;
+
+    pthread_mutex_unlock(&writeback_lock);
+    return 0;
+}
+
+/* Write all held back blocks, waiting for the writer thread too.  */
+static void writeback_flush_all(void)
+{
+    zfile_cache_t *cache;
+
+    pthread_mutex_lock(&writeback_lock);
+    cache = writeback_list;
+    while (cache != NULL) {
+        if (cache->busy) {
+            pthread_cond_wait(&writeback_idle_cond, &writeback_lock);
+            cache = writeback_list;
+        } else if (cache->first_write != 0) {
+            writeback_flush(cache);
+            cache = writeback_list;
+        } else {
+            cache = cache->next;
+        }
+    }
+    pthread_mutex_unlock(&writeback_lock);
+}
+
+/* Name of the journal for the file of `ptr', NULL if it has none.
+   Temporary files of compressed images are not worth a journal.  */
+static char *writeback_journal_name(const zfile_t *ptr)
+{
+    if (ptr->tmp_name != NULL || ptr->orig_name == NULL) {
+        return NULL;
+    }
+    return util_concat(ptr->orig_name, ".journal", NULL);
+}
+
+/* Let the stream of `ptr' hold back writes.  */
+static void writeback_add(zfile_cache_t *cache, const zfile_t *ptr)
+{
+    cache->journal_name = writeback_journal_name(ptr);
+
+    pthread_mutex_lock(&writeback_lock);
+    cache->next = writeback_list;
+    writeback_list = cache;
+    pthread_mutex_unlock(&writeback_lock);
+}
+
+/* Write the held back blocks of a stream that is closed.  */
+static void writeback_remove(zfile_cache_t *cache)
+{
+    zfile_cache_t **p;
+
+    pthread_mutex_lock(&writeback_lock);
+    while (cache->busy) {
+        pthread_cond_wait(&writeback_idle_cond, &writeback_lock);
+    }
+    writeback_flush(cache);
+    for (p = &writeback_list; *p != NULL; p = &(*p)->next) {
+        if (*p == cache) {
+            *p = cache->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&writeback_lock);
+
+    lib_free(cache->held_map);
+    lib_free(cache->journal_name);
+}
+
+/* Stop the writer thread and write what is held back.  Later writes go
+   through.  */
+static void writeback_shutdown(void)
+{
+    pthread_mutex_lock(&writeback_lock);
+    writeback_delay = 0;
+    writeback_shut_down = 1;
+    if (writeback_running) {
+        writeback_quit = 1;
+        pthread_cond_signal(&writeback_cond);
+        pthread_mutex_unlock(&writeback_lock);
+        pthread_join(writeback_thread, NULL);
+        pthread_mutex_lock(&writeback_lock);
+        writeback_running = 0;
+    }
+    pthread_mutex_unlock(&writeback_lock);
+
+    writeback_flush_all();
+}
+
+static int set_writeback_delay(int val, void *param)
+{
+    if (val < 0 || val > ZFILE_WRITEBACK_DELAY_MAX) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&writeback_lock);
+    if (!writeback_shut_down) {
+        writeback_delay = val;
+    }
+    pthread_cond_signal(&writeback_cond);
+    pthread_mutex_unlock(&writeback_lock);
+
+    if (val == 0) {
+        writeback_flush_all();
+    }
+    return 0;
+}
+
+static int set_writeback_journal(int val, void *param)
+{
+    writeback_journal = val ? 1 : 0;
+
+    return 0;
+}
+
+#ifdef ZFILE_PREFETCH
+
+/* Prefetched files.
+
+   zfile_prefetch() reads a file that is likely to be opened soon, like the
+   next image of a flip list, on a separate thread: the whole file, or what
+   it uncompresses to in-process.  When the file is opened, the contents are
+   taken from there instead of being read and uncompressed while the
+   emulation waits, as long as the size and modification time of the file
+   have not changed.  A file that is opened while it is being read waits
+   for the thread to finish it.  */
+
+#define ZFILE_PREFETCH_MAX  4
+
+typedef struct zfile_prefetch_s {
+    char *name;                 /* Complete path, NULL for a free slot.  */
+    enum compression_type type;
+    uint8_t *data;              /* NULL if the file could not be read.  */
+    size_t size;
+    size_t file_size;           /* Size and modification time of the file  */
+    time_t mtime;               /* when it was read.  */
+    int done;                   /* Has been read.  */
+    int busy;                   /* Being read by the prefetch thread.  */
+    unsigned long used;         /* Age, the oldest slot is reused.  */
+} zfile_prefetch_t;
+
+static enum compression_type try_uncompress_to_memory(const char *name,
+                                                      int write_mode,
+                                                      uint8_t **data,
+                                                      size_t *size);
+
+static int prefetch_enabled = 1;
+
+static zfile_prefetch_t prefetch_slots[ZFILE_PREFETCH_MAX];
+static unsigned long prefetch_age = 0;
+
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t prefetch_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t prefetch_thread;
+static int prefetch_running = 0;
+static int prefetch_quit = 0;
+
+static void prefetch_clear(zfile_prefetch_t *slot)
+{
+    lib_free(slot->name);
+    lib_free(slot->data);
+    memset(slot, 0, sizeof(zfile_prefetch_t));
+}
+
+/* Read `slot' without the lock held.  */
+static void prefetch_read(zfile_prefetch_t *slot, const char *name)
+{
+    uint8_t *data = NULL;
+    size_t size = 0;
+    size_t file_size;
+    unsigned int isdir;
+    time_t mtime;
+    enum compression_type type;
+
+    if (archdep_stat(name, &file_size, &isdir) < 0 || isdir
+        || archdep_file_mtime(name, &mtime) < 0) {
+        return;
+    }
+
+    type = try_uncompress_to_memory(name, 0, &data, &size);
+    if (type == COMPR_NONE && file_size <= ZFILE_CACHE_MAX) {
+        FILE *fd = fopen(name, MODE_READ);
+
+        if (fd != NULL) {
+            size = file_size;
+            data = lib_malloc(size > 0 ? size : 1);
+            if (size > 0 && fread(data, size, 1, fd) != 1) {
+                lib_free(data);
+                data = NULL;
+            }
+            fclose(fd);
+        }
+    }
+
+    pthread_mutex_lock(&prefetch_lock);
+    slot->type = type;
+    slot->data = data;
+    slot->size = size;
+    slot->file_size = file_size;
+    slot->mtime = mtime;
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+static void *prefetch_main(void *arg)
+{
+    pthread_mutex_lock(&prefetch_lock);
+    while (!prefetch_quit) {
+        zfile_prefetch_t *slot = NULL;
+        int i;
+
+        for (i = 0; i < ZFILE_PREFETCH_MAX; i++) {
+            if (prefetch_slots[i].name != NULL && !prefetch_slots[i].done) {
+                slot = &prefetch_slots[i];
+                break;
+            }
+        }
+        if (slot == NULL) {
+            pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+            continue;
+        }
+
+        /* the slot is not reused while it is busy, so the name stays */
+        slot->busy = 1;
+        pthread_mutex_unlock(&prefetch_lock);
+        prefetch_read(slot, slot->name);
+        pthread_mutex_lock(&prefetch_lock);
+        slot->busy = 0;
+        slot->done = 1;
+        pthread_cond_broadcast(&prefetch_done_cond);
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+
+    return NULL;
+}
+
+/* Take the contents of `name' (a complete path) if they have been read
+   ahead and the file is unchanged.  With `compressed' only what a
+   compressed file uncompresses to is taken, else only a plain file.  */
+static uint8_t *prefetch_take(const char *name, int compressed, int write_mode,
+                              enum compression_type *type, size_t *size)
+{
+    zfile_prefetch_t *slot = NULL;
+    uint8_t *data = NULL;
+    size_t file_size;
+    unsigned int isdir;
+    time_t mtime;
+    int i;
+
+    pthread_mutex_lock(&prefetch_lock);
+    for (i = 0; i < ZFILE_PREFETCH_MAX; i++) {
+        if (prefetch_slots[i].name != NULL && strcmp(prefetch_slots[i].name, name) == 0) {
+            slot = &prefetch_slots[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        pthread_mutex_unlock(&prefetch_lock);
+        return NULL;
+    }
+    if (!slot->busy && !slot->done) {
+        /* not started yet, reading it here is just as fast */
+        prefetch_clear(slot);
+        pthread_mutex_unlock(&prefetch_lock);
+        return NULL;
+    }
+    while (slot->busy) {
+        pthread_cond_wait(&prefetch_done_cond, &prefetch_lock);
+    }
+
+    if (slot->name == NULL || strcmp(slot->name, name) != 0) {
+        /* reused in the meantime */
+        pthread_mutex_unlock(&prefetch_lock);
+        return NULL;
+    }
+    if (slot->data == NULL
+        || (slot->type != COMPR_NONE) != (compressed != 0)
+        /* zip archives cannot be written, see try_uncompress_to_memory() */
+        || (slot->type == COMPR_ARCHIVE && write_mode)) {
+        pthread_mutex_unlock(&prefetch_lock);
+        return NULL;
+    }
+
+    if (archdep_stat(name, &file_size, &isdir) == 0
+        && archdep_file_mtime(name, &mtime) == 0
+        && file_size == slot->file_size && mtime == slot->mtime) {
+        data = slot->data;
+        *type = slot->type;
+        *size = slot->size;
+        slot->data = NULL;
+    }
+    prefetch_clear(slot);
+    pthread_mutex_unlock(&prefetch_lock);
+
+    return data;
+}
+
+/* Stop the prefetch thread and forget what it has read.  */
+static void prefetch_shutdown(void)
+{
+    int i;
+
+    pthread_mutex_lock(&prefetch_lock);
+    prefetch_enabled = 0;
+    if (prefetch_running) {
+        prefetch_quit = 1;
+        pthread_cond_signal(&prefetch_cond);
+        pthread_mutex_unlock(&prefetch_lock);
+        pthread_join(prefetch_thread, NULL);
+        pthread_mutex_lock(&prefetch_lock);
+        prefetch_running = 0;
+    }
+    for (i = 0; i < ZFILE_PREFETCH_MAX; i++) {
+        prefetch_clear(&prefetch_slots[i]);
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+static int set_prefetch_enabled(int val, void *param)
+{
+    int i;
+
+    pthread_mutex_lock(&prefetch_lock);
+    prefetch_enabled = val ? 1 : 0;
+    if (!prefetch_enabled) {
+        for (i = 0; i < ZFILE_PREFETCH_MAX; i++) {
+            if (!prefetch_slots[i].busy) {
+                prefetch_clear(&prefetch_slots[i]);
+            }
+        }
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+
+    return 0;
+}
+
+#endif /* ZFILE_PREFETCH */
+
+static const resource_int_t resources_int[] = {
+    { "ImageWriteBackDelay", 0, RES_EVENT_NO, NULL,
+      &writeback_delay, set_writeback_delay, NULL },
+    { "ImageJournal", 0, RES_EVENT_NO, NULL,
+      &writeback_journal, set_writeback_journal, NULL },
+    { "ImagePrefetch", 1, RES_EVENT_NO, NULL,
+      &prefetch_enabled, set_prefetch_enabled, NULL },
+    RESOURCE_INT_LIST_END
+};
+
+static const cmdline_option_t cmdline_options[] =
+{
+    { "-imagewritebackdelay", SET_RESOURCE, CMDLINE_ATTRIB_NEED_ARGS,
+      NULL, NULL, "ImageWriteBackDelay", NULL,
+      "<Seconds>", "Hold back writes to disk and tape images for up to this many seconds (0: write at once)" },
+    { "-imagejournal", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "ImageJournal", (resource_value_t)1,
+      NULL, "Write held back image changes to a journal first" },
+    { "+imagejournal", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "ImageJournal", (resource_value_t)0,
+      NULL, "Write held back image changes without a journal" },
+    { "-imageprefetch", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "ImagePrefetch", (resource_value_t)1,
+      NULL, "Read the images next to the attached one in the flip list ahead (default)" },
+    { "+imageprefetch", SET_RESOURCE, CMDLINE_ATTRIB_NONE,
+      NULL, NULL, "ImagePrefetch", (resource_value_t)0,
+      NULL, "Do not read flip list images ahead" },
+    CMDLINE_LIST_END
+};
+
+#endif /* ZFILE_WRITEBACK */
+
+static long zfile_cache_write(void *cookie, const char *buf, size_t len)
+{
+    zfile_cache_t *cache = cookie;
+
+    if (!cache->write_mode) {
+        errno = EBADF;
+        return -1;
+    }
+
+#ifdef ZFILE_WRITEBACK
+    if (cache->backing != NULL && writeback_hold(cache, buf, len) == 0) {
+        return (long)len;
+    }
+#endif
+
+    if (cache->backing == NULL) {
+        cache->dirty = 1;
+    } else if (util_fpwrite(cache->backing, buf, len, (long)cache->pos) < 0
+               || fflush(cache->backing) != 0) {
+        return -1;
+    }
+
+    zfile_cache_store(cache, buf, len);
+
+    return (long)len;
+}
+
+static int zfile_cache_seek(void *cookie, int64_t *offset, int whence)
+{
+    zfile_cache_t *cache = cookie;
+    int64_t pos;
+
+    switch (whence) {
+        case SEEK_SET:
+            pos = *offset;
+            break;
+        case SEEK_CUR:
+            pos = (int64_t)cache->pos + *offset;
+            break;
+        case SEEK_END:
+            pos = (int64_t)cache->size + *offset;
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+    if (pos < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cache->pos = (size_t)pos;
+    *offset = pos;
+
+    return 0;
+}
+
+static int zfile_compress(const char *src, const uint8_t *data, size_t size,
+                          const char *dest, enum compression_type type);
+static void zfile_memory_file_release(zfile_cache_t *cache);
+
+static int zfile_cache_close(void *cookie)
+{
+    zfile_cache_t *cache = cookie;
+    int retval = 0;
+
+    if (cache->memory_file != NULL) {
+        zfile_memory_file_release(cache);
+        lib_free(cache);
+        return 0;
+    }
+
+    if (cache->backing != NULL) {
+#ifdef ZFILE_WRITEBACK
+        if (cache->write_mode) {
+            writeback_remove(cache);
+        }
+#endif
+        retval = fclose(cache->backing);
+    } else if (cache->dirty) {
+        retval = zfile_compress(NULL, cache->data, cache->size,
+                                cache->orig_name, cache->type);
+    }
+
+    lib_free(cache->orig_name);
+    if (!cache->borrowed) {
+        lib_free(cache->data);
+    }
+    lib_free(cache);
+
+    return retval;
+}
+
+#ifdef HAVE_FOPENCOOKIE
+
+static ssize_t zfile_cookie_read(void *cookie, char *buf, size_t len)
+{
+    return zfile_cache_read(cookie, buf, len);
+}
+
+static ssize_t zfile_cookie_write(void *cookie, const char *buf, size_t len)
+{
+    /* glibc expects 0 on errors */
+    long retval = zfile_cache_write(cookie, buf, len);
+
+    return retval < 0 ? 0 : retval;
+}
+
+static int zfile_cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+    int64_t pos = *offset;
+
+    if (zfile_cache_seek(cookie, &pos, whence) < 0) {
+        return -1;
+    }
+    *offset = pos;
+    return 0;
+}
+
+static FILE *zfile_cache_stream(zfile_cache_t *cache)
+{
+    cookie_io_functions_t funcs;
+
+    funcs.read = zfile_cookie_read;
+    funcs.write = zfile_cookie_write;
+    funcs.seek = zfile_cookie_seek;
+    funcs.close = zfile_cache_close;
+
+    return fopencookie(cache, cache->write_mode ? MODE_READ_WRITE : MODE_READ, funcs);
+}
+
+#else
+
+static int zfile_funopen_read(void *cookie, char *buf, int len)
+{
+    return (int)zfile_cache_read(cookie, buf, (size_t)len);
+}
+
+static int zfile_funopen_write(void *cookie, const char *buf, int len)
+{
+    return (int)zfile_cache_write(cookie, buf, (size_t)len);
+}
+
+static fpos_t zfile_funopen_seek(void *cookie, fpos_t offset, int whence)
+{
+    int64_t pos = offset;
+
+    if (zfile_cache_seek(cookie, &pos, whence) < 0) {
+        return -1;
+    }
+    return (fpos_t)pos;
+}
+
+static FILE *zfile_cache_stream(zfile_cache_t *cache)
+{
+    return funopen(cache, zfile_funopen_read, zfile_funopen_write,
+                   zfile_funopen_seek, zfile_cache_close);
+}
+
+#endif
+
+/* Return a stream reading from `data', which the stream takes over.  If the
+   stream is opened for writing, its contents are compressed into `orig_name'
+   with `type' when it has been changed.  */
+static FILE *zfile_memory_stream(uint8_t *data, size_t size, const char *orig_name,
+                                 enum compression_type type, int write_mode)
+{
+    zfile_cache_t *cache;
+    FILE *stream;
+
+    cache = lib_calloc(1, sizeof(zfile_cache_t));
+    cache->orig_name = lib_strdup(orig_name);
+    cache->type = type;
+    cache->size = size;
+    cache->alloc = size > 0 ? size : 1;
+    cache->data = lib_realloc(data, cache->alloc);
+    cache->write_mode = write_mode;
+
+    stream = zfile_cache_stream(cache);
+    if (stream == NULL) {
+        lib_free(cache->orig_name);
+        lib_free(cache->data);
+        lib_free(cache);
+    }
+
+    return stream;
+}
+
+/* Make sure there is room for at least one more byte after `size' bytes in
+   `*data'.  */
+static int zfile_memory_reserve(uint8_t **data, size_t *alloc, size_t size)
+{
+    if (size < *alloc) {
+        return 0;
+    }
+    if (*alloc >= ZFILE_CACHE_MAX) {
+        return -1;
+    }
+    *alloc *= 2;
+    *data = lib_realloc(*data, *alloc);
+    return 0;
+}
+
+/* Memory files have a name like a file on disk, but only exist in memory
+   until they are removed or the emulator quits.  Images that are thrown
+   away anyway, like the one autostart copies PRG files to, are built there
+   so that creating them costs no file I/O at all.  zfile_fopen() opens
+   them as memory streams, one at a time.  */
+
+typedef struct zfile_memory_file_s {
+    char *name;         /* Complete path of the file.  */
+    uint8_t *data;
+    size_t size;
+    size_t alloc;
+    int open;           /* A stream is open on the file.  */
+    int removed;        /* Removed while open, freed when it is closed.  */
+    struct zfile_memory_file_s *next;
+} zfile_memory_file_t;
+
+static zfile_memory_file_t *zfile_memory_files = NULL;
+
+static zfile_memory_file_t *zfile_memory_file_find(const char *name)
 {
-    size_t l = strlen(name);
+    zfile_memory_file_t *p;
+    char *full_name;
 
-    if ((l < 4 || util_strcasecmp(name + l - 3, ".gz"))
-        && (l < 3 || util_strcasecmp(name + l - 2, ".z"))
-        && (l < 4 || toupper((unsigned char)name[l - 1]) != 'Z' || name[l - 4] != '.')) {
-          return 0;
+    archdep_expand_path(&full_name, name);
+    for (p = zfile_memory_files; p != NULL; p = p->next) {
+        if (strcmp(p->name, full_name) == 0) {
+            break;
+        }
     }
-    return 1;
-}
+    lib_free(full_name);
 
+    return p;
+}
 
-static void zfile_list_destroy(void)
+static void zfile_memory_file_free(zfile_memory_file_t *file)
 {
-    zfile_t *p;
+    lib_free(file->name);
+    lib_free(file->data);
+    lib_free(file);
+}
 
-    for (p = zfile_list; p != NULL; ) {
-        zfile_t *next;
+/* Take `file' off the list.  If a stream is still open on it, it keeps the
+   data until it is closed, like an unlinked file.  */
+static void zfile_memory_file_unlink(zfile_memory_file_t *file)
+{
+    zfile_memory_file_t **p;
 
-        lib_free(p->orig_name);
-        lib_free(p->tmp_name);
-        next = p->next;
-        lib_free(p);
-        p = next;
+    for (p = &zfile_memory_files; *p != NULL; p = &(*p)->next) {
+        if (*p == file) {
+            *p = file->next;
+            break;
+        }
+    }
+    if (file->open) {
+        file->removed = 1;
+    } else {
+        zfile_memory_file_free(file);
     }
-
-    zfile_list = NULL;
 }
 
-static int zinit(void)
+/* Open a stream on memory file `file' with fopen() mode `mode'.  */
+static FILE *zfile_memory_file_open(zfile_memory_file_t *file, const char *mode)
 {
-    zlog = log_open("ZFile");
+    zfile_cache_t *cache;
+    FILE *stream;
 
-    /* Free the `zfile_list' if not empty.  */
-    zfile_list_destroy();
+    if (file->open) {
+        errno = EBUSY;
+        return NULL;
+    }
 
-    zinit_done = 1;
+    cache = lib_calloc(1, sizeof(zfile_cache_t));
+    cache->memory_file = file;
+    cache->data = file->data;
+    cache->size = mode[0] == 'w' ? 0 : file->size;
+    cache->alloc = file->alloc;
+    cache->pos = mode[0] == 'a' ? cache->size : 0;
+    cache->write_mode = mode[0] != 'r' || strchr(mode, '+') != NULL;
 
-    return 0;
+    stream = zfile_cache_stream(cache);
+    if (stream == NULL) {
+        lib_free(cache);
+        return NULL;
+    }
+    file->open = 1;
+
+    return stream;
 }
 
-/* Add one zfile to the list.  `orig_name' is automatically expanded to the
-   complete path.  */
-static void zfile_list_add(const char *tmp_name,
-                           const char *orig_name,
-                           enum compression_type type,
-                           int write_mode,
-                           FILE *stream, FILE *fd)
+/* Hand the data of the stream of `cache' back to its memory file.  */
+static void zfile_memory_file_release(zfile_cache_t *cache)
 {
-    zfile_t *new_zfile = lib_malloc(sizeof(zfile_t));
-
-    /* Make sure we have the complete path of the file.  */
-    archdep_expand_path(&new_zfile->orig_name, orig_name);
+    zfile_memory_file_t *file = cache->memory_file;
 
-    /* The new zfile becomes first on the list.  */
-    new_zfile->tmp_name = tmp_name ? lib_strdup(tmp_name) : NULL;
-    new_zfile->write_mode = write_mode;
-    new_zfile->stream = stream;
-    new_zfile->fd = fd;
-    new_zfile->type = type;
-    new_zfile->action = ZFILE_KEEP;
-    new_zfile->request_string = NULL;
-    new_zfile->next = zfile_list;
-    new_zfile->prev = NULL;
-    if (zfile_list != NULL) {
-        zfile_list->prev = new_zfile;
+    file->data = cache->data;
+    file->size = cache->size;
+    file->alloc = cache->alloc;
+    file->open = 0;
+    if (file->removed) {
+        zfile_memory_file_free(file);
     }
-    zfile_list = new_zfile;
 }
 
-void zfile_shutdown(void)
+static void zfile_memory_files_destroy(void)
 {
-    zfile_list_destroy();
+    while (zfile_memory_files != NULL) {
+        zfile_memory_file_unlink(zfile_memory_files);
+    }
 }
 
+#endif
+
 /* ------------------------------------------------------------------------ */
 
 /* Uncompression.  */
@@ -732,47 +1875,395 @@ static char *try_uncompress_lynx(const char *name, int write_mode)
 
     exit_status = archdep_spawn("c1541", argv, NULL, NULL);
 
-    lib_free(argv[0]);
-    lib_free(argv[1]);
-    lib_free(argv[2]);
-    lib_free(argv[3]);
-    lib_free(argv[4]);
-    lib_free(argv[5]);
-    lib_free(argv[6]);
+    lib_free(argv[0]);
+    lib_free(argv[1]);
+    lib_free(argv[2]);
+    lib_free(argv[3]);
+    lib_free(argv[4]);
+    lib_free(argv[5]);
+    lib_free(argv[6]);
+
+    if (exit_status) {
+        archdep_remove(tmp_name);
+        lib_free(tmp_name);
+        return NULL;
+    }
+    /* everything ok */
+    return tmp_name;
+}
+
+struct valid_archives_s {
+    const char *program;
+    const char *listopts;
+    const char *extractopts;
+    const char *extension;
+    const char *search;
+};
+typedef struct valid_archives_s valid_archives_t;
+
+static const valid_archives_t valid_archives[] = {
+    { "unzip",   "-l",   "-p",    ".zip",    "Name" },
+    { "lha",     "lv",   "pq",    ".lzh",    NULL },
+    { "lha",     "lv",   "pq",    ".lha",    NULL },
+    /* Hmmm.  Did non-gnu tar have a -O -option?  */
+    { "gtar",    "-tf",  "-xOf",  ".tar",    NULL },
+    { "tar",     "-tf",  "-xOf",  ".tar",    NULL },
+    { "gtar",    "-ztf", "-zxOf", ".tar.gz", NULL },
+    { "tar",     "-ztf", "-zxOf", ".tar.gz", NULL },
+    { "gtar",    "-ztf", "-zxOf", ".tgz",    NULL },
+    { "tar",     "-ztf", "-zxOf", ".tgz",    NULL },
+    /* this might be overkill, but adding this was sooo easy...  */
+    { "zoo",     "lf1q", "xpq",   ".zoo",    NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+#ifdef ZFILE_IN_MEMORY
+
+/* In-process uncompression into memory.  */
+
+#ifdef HAVE_ZLIB
+
+static uint8_t *uncompress_gzip_to_memory(const char *name, size_t *size)
+{
+    gzFile fdsrc;
+    uint8_t *data;
+    size_t alloc = 0x10000;
+    int len;
+
+    fdsrc = gzopen(name, MODE_READ);
+    if (fdsrc == NULL) {
+        return NULL;
+    }
+
+    data = lib_malloc(alloc);
+    *size = 0;
+
+    do {
+        if (zfile_memory_reserve(&data, &alloc, *size) < 0) {
+            len = -1;
+            break;
+        }
+        len = gzread(fdsrc, data + *size, (unsigned int)(alloc - *size));
+        if (len > 0) {
+            *size += (size_t)len;
+        }
+    } while (len > 0);
+
+    gzclose(fdsrc);
+
+    if (len < 0) {
+        lib_free(data);
+        return NULL;
+    }
+
+    return data;
+}
+
+#define ZIP_LOCAL_HEADER_SIG    0x04034b50
+#define ZIP_CENTRAL_HEADER_SIG  0x02014b50
+#define ZIP_END_SIG             0x06054b50
+
+#define ZIP_LOCAL_HEADER_SIZE   30
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_END_SIZE            22
+
+static unsigned int zip_word(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t zip_dword(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Find the central directory entry of the first file in the ZIP archive
+   `zip' with an extension we know about.  Return its offset, or 0 if there
+   is none.  `*zipcode' is set if that file is part of a zipcode set.  */
+static size_t zip_find_entry(const uint8_t *zip, size_t zip_size, int *zipcode)
+{
+    const uint8_t *end = NULL;
+    size_t pos, cd_pos, cd_end;
+    unsigned int entries;
+
+    if (zip_size < ZIP_END_SIZE) {
+        return 0;
+    }
+
+    /* The end record is followed by a comment of up to 64 KiB.  */
+    for (pos = zip_size - ZIP_END_SIZE; ; pos--) {
+        if (zip_dword(zip + pos) == ZIP_END_SIG) {
+            end = zip + pos;
+            break;
+        }
+        if (pos == 0 || zip_size - pos >= ZIP_END_SIZE + 0xffff) {
+            break;
+        }
+    }
+
+    if (end == NULL) {
+        return 0;
+    }
+
+    entries = zip_word(end + 10);
+    cd_pos = zip_dword(end + 16);
+    cd_end = cd_pos + zip_dword(end + 12);
+    if (cd_end > (size_t)(end - zip)) {
+        return 0;
+    }
+
+    while (entries-- > 0 && cd_pos + ZIP_CENTRAL_HEADER_SIZE <= cd_end) {
+        const uint8_t *hdr = zip + cd_pos;
+        size_t name_len = zip_word(hdr + 28);
+        size_t next = cd_pos + ZIP_CENTRAL_HEADER_SIZE + name_len
+                      + zip_word(hdr + 30) + zip_word(hdr + 32);
+        char name[1024];
+
+        if (zip_dword(hdr) != ZIP_CENTRAL_HEADER_SIG || next > cd_end) {
+            return 0;
+        }
+
+        if (name_len < sizeof(name)) {
+            memcpy(name, hdr + ZIP_CENTRAL_HEADER_SIZE, name_len);
+            name[name_len] = 0;
+            if (is_valid_extension(name, name_len, 0)) {
+                ZDEBUG(("zip_find_entry: found `%s'.", name));
+                *zipcode = is_zipcode_name(name);
+                return cd_pos;
+            }
+        }
+
+        cd_pos = next;
+    }
+
+    return 0;
+}
+
+/* Uncompress the file described by the central directory entry at `cd_pos'
+   of the ZIP archive `zip'.  Only stored and deflated files are supported.  */
+static uint8_t *zip_extract_entry(const uint8_t *zip, size_t zip_size,
+                                  size_t cd_pos, size_t *size)
+{
+    const uint8_t *hdr = zip + cd_pos;
+    const uint8_t *local;
+    unsigned int method = zip_word(hdr + 10);
+    size_t csize = zip_dword(hdr + 20);
+    size_t usize = zip_dword(hdr + 24);
+    size_t local_pos = zip_dword(hdr + 42);
+    size_t data_pos;
+    uint8_t *data;
+
+    /* encrypted */
+    if (zip_word(hdr + 8) & 1) {
+        return NULL;
+    }
+    if (usize > ZFILE_CACHE_MAX
+        || local_pos + ZIP_LOCAL_HEADER_SIZE > zip_size) {
+        return NULL;
+    }
+    local = zip + local_pos;
+    if (zip_dword(local) != ZIP_LOCAL_HEADER_SIG) {
+        return NULL;
+    }
+    data_pos = local_pos + ZIP_LOCAL_HEADER_SIZE
+               + zip_word(local + 26) + zip_word(local + 28);
+    if (data_pos + csize > zip_size) {
+        return NULL;
+    }
+
+    data = lib_malloc(usize > 0 ? usize : 1);
+
+    if (method == 0 && csize == usize) {
+        memcpy(data, zip + data_pos, usize);
+    } else if (method == 8) {
+        z_stream strm;
+        int ret;
+
+        memset(&strm, 0, sizeof(strm));
+        if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+            lib_free(data);
+            return NULL;
+        }
+        strm.next_in = (Bytef *)(zip + data_pos);
+        strm.avail_in = (uInt)csize;
+        strm.next_out = data;
+        strm.avail_out = (uInt)usize;
+        ret = inflate(&strm, Z_FINISH);
+        inflateEnd(&strm);
+        if (ret != Z_STREAM_END || strm.total_out != usize) {
+            lib_free(data);
+            return NULL;
+        }
+    } else {
+        lib_free(data);
+        return NULL;
+    }
+
+    if (crc32(0L, data, (uInt)usize) != zip_dword(hdr + 16)) {
+        log_error(zlog, "CRC error in ZIP archive.");
+        lib_free(data);
+        return NULL;
+    }
+
+    *size = usize;
+    return data;
+}
+
+/* Uncompress the first file with a known extension from the ZIP archive
+   `name' into `*data', or only check for it if `extract' is zero.  Return
+   -1 if this cannot be done in-process: the archive is not understood, has
+   no such file, or the file is part of a zipcode set, which needs unzip to
+   extract all four parts.  */
+static int uncompress_zip_to_memory(const char *name, int extract,
+                                    uint8_t **data, size_t *size)
+{
+    FILE *fd;
+    uint8_t *zip;
+    off_t zip_size;
+    size_t cd_pos;
+    int zipcode = 0;
+    int retval = -1;
+
+    fd = fopen(name, MODE_READ);
+    if (fd == NULL) {
+        return -1;
+    }
+    zip_size = archdep_file_size(fd);
+    if (zip_size <= 0 || zip_size > ZFILE_CACHE_MAX) {
+        fclose(fd);
+        return -1;
+    }
+    zip = lib_malloc((size_t)zip_size);
+    if (fread(zip, (size_t)zip_size, 1, fd) != 1) {
+        fclose(fd);
+        lib_free(zip);
+        return -1;
+    }
+    fclose(fd);
+
+    cd_pos = zip_find_entry(zip, (size_t)zip_size, &zipcode);
+    if (cd_pos != 0 && !zipcode) {
+        if (!extract) {
+            retval = 0;
+        } else {
+            *data = zip_extract_entry(zip, (size_t)zip_size, cd_pos, size);
+            retval = *data ? 0 : -1;
+        }
+    }
+
+    lib_free(zip);
+    return retval;
+}
+
+#endif /* HAVE_ZLIB */
+
+#ifdef HAVE_BZIP2
+
+static uint8_t *uncompress_bzip_to_memory(const char *name, size_t *size)
+{
+    FILE *fdsrc;
+    BZFILE *bz;
+    uint8_t *data;
+    size_t alloc = 0x10000;
+    char unused[BZ_MAX_UNUSED];
+    int num_unused = 0;
+    int bzerror;
+
+    fdsrc = fopen(name, MODE_READ);
+    if (fdsrc == NULL) {
+        return NULL;
+    }
+
+    data = lib_malloc(alloc);
+    *size = 0;
+
+    /* Files made by parallel compressors consist of several streams.  */
+    do {
+        bz = BZ2_bzReadOpen(&bzerror, fdsrc, 0, 0, unused, num_unused);
+        if (bzerror != BZ_OK) {
+            break;
+        }
+        do {
+            int len;
+
+            if (zfile_memory_reserve(&data, &alloc, *size) < 0) {
+                bzerror = BZ_MEM_ERROR;
+                break;
+            }
+            len = BZ2_bzRead(&bzerror, bz, data + *size, (int)(alloc - *size));
+            if (bzerror == BZ_OK || bzerror == BZ_STREAM_END) {
+                *size += (size_t)len;
+            }
+        } while (bzerror == BZ_OK);
+
+        if (bzerror == BZ_STREAM_END) {
+            void *rest;
+
+            BZ2_bzReadGetUnused(&bzerror, bz, &rest, &num_unused);
+            memcpy(unused, rest, (size_t)num_unused);
+            BZ2_bzReadClose(&bzerror, bz);
+            if (num_unused == 0 && feof(fdsrc)) {
+                break;
+            }
+        } else {
+            BZ2_bzReadClose(&bzerror, bz);
+            bzerror = BZ_DATA_ERROR;
+            break;
+        }
+    } while (1);
+
+    fclose(fdsrc);
 
-    if (exit_status) {
-        archdep_remove(tmp_name);
-        lib_free(tmp_name);
+    if (bzerror != BZ_OK || *size == 0) {
+        lib_free(data);
         return NULL;
     }
-    /* everything ok */
-    return tmp_name;
+
+    return data;
 }
 
-struct valid_archives_s {
-    const char *program;
-    const char *listopts;
-    const char *extractopts;
-    const char *extension;
-    const char *search;
-};
-typedef struct valid_archives_s valid_archives_t;
+#endif /* HAVE_BZIP2 */
 
-static const valid_archives_t valid_archives[] = {
-    { "unzip",   "-l",   "-p",    ".zip",    "Name" },
-    { "lha",     "lv",   "pq",    ".lzh",    NULL },
-    { "lha",     "lv",   "pq",    ".lha",    NULL },
-    /* Hmmm.  Did non-gnu tar have a -O -option?  */
-    { "gtar",    "-tf",  "-xOf",  ".tar",    NULL },
-    { "tar",     "-tf",  "-xOf",  ".tar",    NULL },
-    { "gtar",    "-ztf", "-zxOf", ".tar.gz", NULL },
-    { "tar",     "-ztf", "-zxOf", ".tar.gz", NULL },
-    { "gtar",    "-ztf", "-zxOf", ".tgz",    NULL },
-    { "tar",     "-ztf", "-zxOf", ".tgz",    NULL },
-    /* this might be overkill, but adding this was sooo easy...  */
-    { "zoo",     "lf1q", "xpq",   ".zoo",    NULL },
-    { NULL, NULL, NULL, NULL, NULL }
-};
+/* Try to uncompress `name' into memory.  Return the compression type used,
+   or `COMPR_NONE' if this cannot be done in-process; `*data' is NULL if the
+   file is valid but cannot be opened in write mode.  */
+static enum compression_type try_uncompress_to_memory(const char *name,
+                                                      int write_mode,
+                                                      uint8_t **data,
+                                                      size_t *size)
+{
+    size_t l = strlen(name);
+
+    *data = NULL;
+
+#ifdef HAVE_ZLIB
+    if (l > 4 && util_strcasecmp(name + l - 4, ".zip") == 0) {
+        if (uncompress_zip_to_memory(name, !write_mode, data, size) == 0) {
+            return COMPR_ARCHIVE;
+        }
+        return COMPR_NONE;
+    }
+
+    /* leave tar archives to tar */
+    if (file_is_gzip(name)
+        && (l < 5 || util_strcasecmp(name + l - 4, ".tgz") != 0)
+        && (l < 8 || util_strcasecmp(name + l - 7, ".tar.gz") != 0)) {
+        *data = uncompress_gzip_to_memory(name, size);
+        return *data ? COMPR_GZIP : COMPR_NONE;
+    }
+#endif
+
+#ifdef HAVE_BZIP2
+    if (l > 4 && util_strcasecmp(name + l - 4, ".bz2") == 0) {
+        *data = uncompress_bzip_to_memory(name, size);
+        return *data ? COMPR_BZIP : COMPR_NONE;
+    }
+#endif
+
+    return COMPR_NONE;
+}
+
+#endif /* ZFILE_IN_MEMORY */
 
 /* Try to uncompress file `name' using the algorithms we know of.  If this is
    not possible, return `COMPR_NONE'.  Otherwise, uncompress the file into a
@@ -834,12 +2325,12 @@ static int compress_with_gzip(const char *src, const char *dest)
     gzFile fddest;
     size_t len;
 
-    fdsrc = fopen(dest, MODE_READ);
+    fdsrc = fopen(src, MODE_READ);
     if (fdsrc == NULL) {
         return -1;
     }
 
-    fddest = gzopen(src, MODE_WRITE "9");
+    fddest = gzopen(dest, MODE_WRITE "9");
     if (fddest == NULL) {
         fclose(fdsrc);
         return -1;
@@ -847,7 +2338,7 @@ static int compress_with_gzip(const char *src, const char *dest)
 
     do {
         char buf[256];
-        len = fread((void *)buf, 256, 1, fdsrc);
+        len = fread((void *)buf, 1, 256, fdsrc);
         if (len > 0) {
             gzwrite(fddest, (void *)buf, (unsigned int)len);
         }
@@ -924,9 +2415,85 @@ static int compress_with_bzip(const char *src, const char *dest)
     }
 }
 
-/* Compress `src' into `dest' using algorithm `type'.  */
-static int zfile_compress(const char *src, const char *dest,
-                          enum compression_type type)
+#ifdef ZFILE_IN_MEMORY
+
+#ifdef HAVE_ZLIB
+/* Compress `size' bytes at `data' into `dest' using zlib.  */
+static int compress_memory_with_gzip(const uint8_t *data, size_t size,
+                                     const char *dest)
+{
+    gzFile fddest;
+    int retval = 0;
+
+    fddest = gzopen(dest, MODE_WRITE "9");
+    if (fddest == NULL) {
+        return -1;
+    }
+
+    while (size > 0) {
+        unsigned int len = size > 0x10000 ? 0x10000 : (unsigned int)size;
+
+        if (gzwrite(fddest, data, len) != (int)len) {
+            retval = -1;
+            break;
+        }
+        data += len;
+        size -= len;
+    }
+
+    if (gzclose(fddest) != Z_OK) {
+        retval = -1;
+    }
+
+    return retval;
+}
+#endif
+
+#ifdef HAVE_BZIP2
+/* Compress `size' bytes at `data' into `dest' using libbz2.  */
+static int compress_memory_with_bzip(const uint8_t *data, size_t size,
+                                     const char *dest)
+{
+    FILE *fddest;
+    BZFILE *bz;
+    int bzerror;
+
+    fddest = fopen(dest, MODE_WRITE);
+    if (fddest == NULL) {
+        return -1;
+    }
+
+    bz = BZ2_bzWriteOpen(&bzerror, fddest, 9, 0, 0);
+    while (bzerror == BZ_OK && size > 0) {
+        int len = size > 0x10000 ? 0x10000 : (int)size;
+
+        BZ2_bzWrite(&bzerror, bz, (void *)data, len);
+        data += len;
+        size -= (size_t)len;
+    }
+    if (bz != NULL) {
+        int closeerror;
+
+        BZ2_bzWriteClose(&closeerror, bz, bzerror != BZ_OK, NULL, NULL);
+        if (bzerror == BZ_OK) {
+            bzerror = closeerror;
+        }
+    }
+
+    if (fclose(fddest) != 0 || bzerror != BZ_OK) {
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+#endif
+
+/* Compress `src' into `dest' using algorithm `type'.  If `src' is NULL,
+   `size' bytes at `data' are compressed instead.  */
+static int zfile_compress(const char *src, const uint8_t *data, size_t size,
+                          const char *dest, enum compression_type type)
 {
     char *dest_backup_name;
     int retval;
@@ -989,10 +2556,22 @@ static int zfile_compress(const char *src, const char *dest,
 
     switch (type) {
         case COMPR_GZIP:
-            retval = compress_with_gzip(src, dest);
+#if defined(ZFILE_IN_MEMORY) && defined(HAVE_ZLIB)
+            if (src == NULL) {
+                retval = compress_memory_with_gzip(data, size, dest);
+                break;
+            }
+#endif
+            retval = src ? compress_with_gzip(src, dest) : -1;
             break;
         case COMPR_BZIP:
-            retval = compress_with_bzip(src, dest);
+#if defined(ZFILE_IN_MEMORY) && defined(HAVE_BZIP2)
+            if (src == NULL) {
+                retval = compress_memory_with_bzip(data, size, dest);
+                break;
+            }
+#endif
+            retval = src ? compress_with_bzip(src, dest) : -1;
             break;
         default:
             retval = -1;
@@ -1052,11 +2631,58 @@ FILE *zfile_fopen(const char *name, const char *mode)
         write_mode = 1;
     }
 
+#ifdef ZFILE_IN_MEMORY
+    {
+        zfile_memory_file_t *file = zfile_memory_file_find(name);
+
+        if (file != NULL) {
+            stream = zfile_memory_file_open(file, mode);
+            if (stream != NULL) {
+                zfile_list_add(NULL, name, COMPR_NONE, write_mode, stream, NULL);
+                zfile_list->in_memory = 1;
+            }
+            return stream;
+        }
+    }
+#endif
+
     /* Check for write permissions.  */
     if (write_mode && archdep_access(name, ARCHDEP_ACCESS_W_OK) < 0) {
         return NULL;
     }
 
+#ifdef ZFILE_IN_MEMORY
+    /* Files opened for truncating or appending go through a temporary
+       file.  */
+    if (mode[0] == 'r') {
+        uint8_t *data = NULL;
+        size_t size;
+
+#ifdef ZFILE_PREFETCH
+        char *full_name;
+
+        archdep_expand_path(&full_name, name);
+        data = prefetch_take(full_name, 1, write_mode, &type, &size);
+        lib_free(full_name);
+#endif
+        if (data == NULL) {
+            type = try_uncompress_to_memory(name, write_mode, &data, &size);
+        }
+        if (type != COMPR_NONE && data == NULL) {
+            errno = EACCES;
+            return NULL;
+        }
+        if (type != COMPR_NONE) {
+            stream = zfile_memory_stream(data, size, name, type, write_mode);
+            if (stream != NULL) {
+                zfile_list_add(NULL, name, type, write_mode, stream, NULL);
+                zfile_list->in_memory = 1;
+                return stream;
+            }
+        }
+    }
+#endif
+
     type = try_uncompress(name, &tmp_name, write_mode);
     if (type == COMPR_NONE) {
         stream = fopen(name, mode);
@@ -1120,7 +2746,7 @@ static int handle_close(zfile_t *ptr)
         /* Recompress into the original file.  */
         if (ptr->orig_name
             && ptr->write_mode
-            && zfile_compress(ptr->tmp_name, ptr->orig_name, ptr->type)) {
+            && zfile_compress(ptr->tmp_name, NULL, 0, ptr->orig_name, ptr->type)) {
             return -1;
         }
 
@@ -1187,6 +2813,253 @@ int zfile_fclose(FILE *stream)
     return fclose(stream);
 }
 
+/* ------------------------------------------------------------------------ */
+
+#ifdef ZFILE_IN_MEMORY
+
+/* Replace `stream', returned by zfile_fopen(), by a stream that reads from an
+   in-memory copy of the file.  The new stream must be closed with
+   zfile_fclose(), which also closes `stream'.  If the file cannot be cached,
+   `stream' itself is returned.  */
+FILE *zfile_fcache(FILE *stream)
+{
+    zfile_t *ptr;
+    zfile_cache_t *cache;
+    FILE *cached;
+    long pos;
+    off_t size;
+
+    for (ptr = zfile_list; ptr != NULL; ptr = ptr->next) {
+        if (ptr->stream == stream) {
+            break;
+        }
+    }
+    if (ptr == NULL || ptr->in_memory) {
+        return stream;
+    }
+
+#ifdef ZFILE_WRITEBACK
+    /* write the changes a crash has left in the journal */
+    if (ptr->write_mode) {
+        char *journal_name = writeback_journal_name(ptr);
+
+        if (journal_name != NULL) {
+            writeback_journal_replay(journal_name, stream);
+            lib_free(journal_name);
+        }
+    }
+#endif
+
+    pos = ftell(stream);
+    size = archdep_file_size(stream);
+    if (pos < 0 || size < 0 || size > ZFILE_CACHE_MAX) {
+        return stream;
+    }
+
+    cache = lib_calloc(1, sizeof(zfile_cache_t));
+    cache->backing = stream;
+    cache->size = (size_t)size;
+    cache->alloc = size > 0 ? (size_t)size : 1;
+    cache->pos = (size_t)pos;
+    cache->write_mode = ptr->write_mode;
+
+#ifdef ZFILE_PREFETCH
+    {
+        enum compression_type type;
+        size_t prefetched_size;
+
+        cache->data = prefetch_take(ptr->orig_name, 0, ptr->write_mode, &type, &prefetched_size);
+        if (cache->data != NULL && prefetched_size != cache->size) {
+            lib_free(cache->data);
+            cache->data = NULL;
+        }
+    }
+#endif
+    if (cache->data == NULL) {
+        cache->data = lib_malloc(cache->alloc);
+        if (cache->size > 0 && util_fpread(stream, cache->data, cache->size, 0) < 0) {
+            lib_free(cache->data);
+            cache->data = NULL;
+        }
+    }
+
+    if (cache->data == NULL
+        || (cached = zfile_cache_stream(cache)) == NULL) {
+        ZDEBUG(("zfile_fcache: cannot cache `%s'", ptr->orig_name));
+        fseek(stream, pos, SEEK_SET);
+        lib_free(cache->data);
+        lib_free(cache);
+        return stream;
+    }
+
+    ptr->stream = cached;
+    ptr->in_memory = 1;
+
+#ifdef ZFILE_WRITEBACK
+    if (cache->write_mode) {
+        writeback_add(cache, ptr);
+    }
+#endif
+
+    return cached;
+}
+
+/* Return a read-only stream over `size' bytes at `data', for files that are
+   already in memory.  `data' is not copied and must stay valid until the
+   stream has been closed with fclose().  */
+FILE *zfile_fopen_memory(const uint8_t *data, size_t size)
+{
+    zfile_cache_t *cache;
+    FILE *stream;
+
+    cache = lib_calloc(1, sizeof(zfile_cache_t));
+    cache->data = (uint8_t *)data;
+    cache->size = size;
+    cache->alloc = size;
+    cache->borrowed = 1;
+
+    stream = zfile_cache_stream(cache);
+    if (stream == NULL) {
+        lib_free(cache);
+    }
+
+    return stream;
+}
+
+#else
+
+FILE *zfile_fcache(FILE *stream)
+{
+    return stream;
+}
+
+/* Without custom streams the data goes through an anonymous temporary
+   file.  */
+FILE *zfile_fopen_memory(const uint8_t *data, size_t size)
+{
+    FILE *stream = tmpfile();
+
+    if (stream == NULL) {
+        return NULL;
+    }
+    if ((size > 0 && fwrite(data, size, 1, stream) < 1)
+        || fseek(stream, 0, SEEK_SET) != 0) {
+        fclose(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+#endif
+
+/* Start reading file `name' ahead on the prefetch thread, so that opening
+   it soon does not have to wait for the file to be read and uncompressed.
+   Only a few files are kept, the oldest one is replaced.  */
+void zfile_prefetch(const char *name)
+{
+#ifdef ZFILE_PREFETCH
+    zfile_prefetch_t *slot = NULL;
+    char *full_name;
+    int i;
+
+    if (name == NULL || name[0] == 0 || !prefetch_enabled) {
+        return;
+    }
+    if (archdep_expand_path(&full_name, name) != 0) {
+        lib_free(full_name);
+        return;
+    }
+
+    pthread_mutex_lock(&prefetch_lock);
+    for (i = 0; i < ZFILE_PREFETCH_MAX; i++) {
+        zfile_prefetch_t *p = &prefetch_slots[i];
+
+        if (p->name != NULL && strcmp(p->name, full_name) == 0) {
+            /* already there */
+            p->used = ++prefetch_age;
+            pthread_mutex_unlock(&prefetch_lock);
+            lib_free(full_name);
+            return;
+        }
+        if (!p->busy && (slot == NULL || p->used < slot->used)) {
+            slot = p;
+        }
+    }
+
+    if (slot != NULL && prefetch_enabled) {
+        prefetch_clear(slot);
+        slot->name = full_name;
+        slot->used = ++prefetch_age;
+        full_name = NULL;
+
+        if (!prefetch_running) {
+            prefetch_quit = 0;
+            if (pthread_create(&prefetch_thread, NULL, prefetch_main, NULL) == 0) {
+                prefetch_running = 1;
+            } else {
+                log_error(zlog, "Cannot start the image prefetch thread.");
+                prefetch_enabled = 0;
+                prefetch_clear(slot);
+            }
+        }
+        pthread_cond_signal(&prefetch_cond);
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+    lib_free(full_name);
+#endif
+}
+
+/* Create the empty memory file `name', see above.  An existing memory file
+   of that name is replaced.  Return -1 if memory files are not supported.  */
+int zfile_memory_file_create(const char *name)
+{
+#ifdef ZFILE_IN_MEMORY
+    zfile_memory_file_t *file;
+
+    if (name == NULL || name[0] == 0) {
+        return -1;
+    }
+
+    zfile_memory_file_remove(name);
+
+    file = lib_calloc(1, sizeof(zfile_memory_file_t));
+    archdep_expand_path(&file->name, name);
+    file->alloc = 64 * 1024;
+    file->data = lib_malloc(file->alloc);
+    file->next = zfile_memory_files;
+    zfile_memory_files = file;
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* Remove memory file `name'.  Return -1 if there is none.  */
+int zfile_memory_file_remove(const char *name)
+{
+#ifdef ZFILE_IN_MEMORY
+    zfile_memory_file_t *file = zfile_memory_file_find(name);
+
+    if (file != NULL) {
+        zfile_memory_file_unlink(file);
+        return 0;
+    }
+#endif
+    return -1;
+}
+
+/* Return non-zero if `name' is a memory file.  */
+int zfile_memory_file_exists(const char *name)
+{
+#ifdef ZFILE_IN_MEMORY
+    return zfile_memory_file_find(name) != NULL;
+#else
+    return 0;
+#endif
+}
+
 int zfile_close_action(const char *filename, zfile_action_t action,
                        const char *request_str)
 {
@@ -1208,3 +3081,35 @@ int zfile_close_action(const char *filename, zfile_action_t action,
     lib_free(fullname);
     return -1;
 }
+
+void zfile_shutdown(void)
+{
+#ifdef ZFILE_PREFETCH
+    prefetch_shutdown();
+#endif
+#ifdef ZFILE_WRITEBACK
+    writeback_shutdown();
+#endif
+    zfile_list_destroy();
+#ifdef ZFILE_IN_MEMORY
+    zfile_memory_files_destroy();
+#endif
+}
+
+int zfile_resources_init(void)
+{
+#ifdef ZFILE_WRITEBACK
+    return resources_register_int(resources_int);
+#else
+    return 0;
+#endif
+}
+
+int zfile_cmdline_options_init(void)
+{
+#ifdef ZFILE_WRITEBACK
+    return cmdline_register_options(cmdline_options);
+#else
+    return 0;
+#endif
+}
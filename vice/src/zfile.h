@@ -30,6 +30,8 @@
 
 #include <stdio.h>
 
+#include "types.h"
+
 /* actions to be done when a zfile is closed */
 typedef enum {
     ZFILE_KEEP,         /* Nothing, keep original file (default).  */
@@ -39,9 +41,18 @@ typedef enum {
 
 FILE *zfile_fopen(const char *name, const char *mode);
 int zfile_fclose(FILE *stream);
+FILE *zfile_fcache(FILE *stream);
+FILE *zfile_fopen_memory(const uint8_t *data, size_t size);
+void zfile_prefetch(const char *name);
+int zfile_memory_file_create(const char *name);
+int zfile_memory_file_remove(const char *name);
+int zfile_memory_file_exists(const char *name);
 
 void zfile_shutdown(void);
 
+int zfile_resources_init(void);
+int zfile_cmdline_options_init(void);
+
 int zfile_close_action(const char *filename, zfile_action_t action, const char *request_string);
 
 #if 0